@@ -16,7 +16,13 @@ limitations under the License.
 #include "stablehlo/api/PortableApi.h"
 
 #include <string>
+#include <utility>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "mlir/Bytecode/BytecodeWriter.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/MLIRContext.h"
@@ -35,6 +41,46 @@ void loadSerializationDialects(MLIRContext& context) {
   mlir::stablehlo::registerAllDialects(registry);
   context.appendDialectRegistry(registry);
 }
+
+LogicalResult serializeInContext(StringRef moduleStr, StringRef targetVersion,
+                                 raw_ostream& os, MLIRContext& context) {
+  loadSerializationDialects(context);
+  auto module = mlir::parseSourceString<mlir::ModuleOp>(moduleStr, &context);
+  if (!module || failed(module->verifyInvariants())) return failure();
+
+  return serializePortableArtifact(*module, targetVersion, os);
+}
+
+LogicalResult deserializeInContext(StringRef artifactStr, raw_ostream& os,
+                                   MLIRContext& context) {
+  loadSerializationDialects(context);
+  auto module = deserializePortableArtifact(artifactStr, &context);
+  if (!module) return failure();
+
+  // This bytecode does not need to specify version number or producer string,
+  // since it is not required to be any more stable than textual assembly.
+  return writeBytecodeToFile(*module, os);
+}
+
+// Applies `convert` to each of `inputs` on a pool of `numThreads` threads.
+// Every input gets its own context without a thread pool of its own, since
+// the inputs are already converted concurrently.
+template <typename ConvertFn>
+SmallVector<FailureOr<std::string>> convertConcurrently(
+    ArrayRef<StringRef> inputs, unsigned numThreads, ConvertFn convert) {
+  SmallVector<FailureOr<std::string>> outputs(inputs.size(), failure());
+  llvm::DefaultThreadPool threadPool(llvm::hardware_concurrency(numThreads));
+  for (auto [input, output] : llvm::zip_equal(inputs, outputs)) {
+    threadPool.async([&, input = input, output = &output] {
+      MLIRContext context(MLIRContext::Threading::DISABLED);
+      std::string buffer;
+      llvm::raw_string_ostream os(buffer);
+      if (succeeded(convert(input, os, context))) *output = std::move(buffer);
+    });
+  }
+  threadPool.wait();
+  return outputs;
+}
 }  // namespace
 
 std::string getCurrentVersion() {
@@ -49,23 +95,32 @@ LogicalResult serializePortableArtifact(StringRef moduleStr,
                                         StringRef targetVersion,
                                         raw_ostream& os) {
   MLIRContext context;
-  loadSerializationDialects(context);
-  auto module = mlir::parseSourceString<mlir::ModuleOp>(moduleStr, &context);
-  if (!module || failed(module->verifyInvariants())) return failure();
-
-  return serializePortableArtifact(*module, targetVersion, os);
+  return serializeInContext(moduleStr, targetVersion, os, context);
 }
 
 LogicalResult deserializePortableArtifact(StringRef artifactStr,
                                           raw_ostream& os) {
   MLIRContext context;
-  loadSerializationDialects(context);
-  auto module = deserializePortableArtifact(artifactStr, &context);
-  if (!module) return failure();
+  return deserializeInContext(artifactStr, os, context);
+}
 
-  // This bytecode does not need to specify version number or producer string,
-  // since it is not required to be any more stable than textual assembly.
-  return writeBytecodeToFile(*module, os);
+SmallVector<FailureOr<std::string>> serializePortableArtifacts(
+    ArrayRef<StringRef> moduleStrs, StringRef targetVersion,
+    unsigned numThreads) {
+  return convertConcurrently(
+      moduleStrs, numThreads,
+      [&](StringRef moduleStr, raw_ostream& os, MLIRContext& context) {
+        return serializeInContext(moduleStr, targetVersion, os, context);
+      });
+}
+
+SmallVector<FailureOr<std::string>> deserializePortableArtifacts(
+    ArrayRef<StringRef> artifactStrs, unsigned numThreads) {
+  return convertConcurrently(
+      artifactStrs, numThreads,
+      [&](StringRef artifactStr, raw_ostream& os, MLIRContext& context) {
+        return deserializeInContext(artifactStr, os, context);
+      });
 }
 
 }  // namespace stablehlo
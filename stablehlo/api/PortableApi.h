@@ -18,6 +18,8 @@ limitations under the License.
 
 #include <string>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/raw_ostream.h"
 #include "mlir/Support/LogicalResult.h"
@@ -27,7 +29,7 @@ namespace stablehlo {
 
 /// Return the current version for portable API.
 /// Increments on all meaningful changes to this file.
-inline int64_t getApiVersion() { return 6; }
+inline int64_t getApiVersion() { return 7; }
 
 // Get the current StableHLO version.
 //
@@ -72,6 +74,23 @@ LogicalResult serializePortableArtifact(StringRef moduleStr,
 LogicalResult deserializePortableArtifact(StringRef artifactStr,
                                           raw_ostream& os);
 
+// Write each of `moduleStrs` to a portable artifact like
+// `serializePortableArtifact`, concurrently on `numThreads` threads, or one
+// per hardware thread if 0. Each module is processed in a context of its own,
+// so this can be called from many threads at once. Returns the artifacts in
+// the order of `moduleStrs`, with failures for the modules which can't be
+// serialized.
+SmallVector<FailureOr<std::string>> serializePortableArtifacts(
+    ArrayRef<StringRef> moduleStrs, StringRef targetVersion,
+    unsigned numThreads = 0);
+
+// Read each of `artifactStrs` like `deserializePortableArtifact`, concurrently
+// on `numThreads` threads, or one per hardware thread if 0. Returns the
+// modules as MLIR bytecode in the order of `artifactStrs`, with failures for
+// the artifacts which can't be deserialized.
+SmallVector<FailureOr<std::string>> deserializePortableArtifacts(
+    ArrayRef<StringRef> artifactStrs, unsigned numThreads = 0);
+
 }  // namespace stablehlo
 }  // namespace mlir
 
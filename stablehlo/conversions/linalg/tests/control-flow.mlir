@@ -0,0 +1,140 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg="enable-control-flow" --split-input-file --canonicalize | FileCheck %s
+
+// CHECK-LABEL: func @while_to_for
+// CHECK-SAME:    %[[CACHE:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[UPDATE:[a-zA-Z0-9_]*]]
+func.func @while_to_for(%cache: tensor<8x4xf32>, %update: tensor<1x4xf32>) -> tensor<8x4xf32> {
+  %c0 = stablehlo.constant dense<0> : tensor<i32>
+  %0:2 = stablehlo.while(%iv = %c0, %acc = %cache) : tensor<i32>, tensor<8x4xf32>
+  cond {
+    %c8 = stablehlo.constant dense<8> : tensor<i32>
+    %1 = stablehlo.compare LT, %iv, %c8 : (tensor<i32>, tensor<i32>) -> tensor<i1>
+    stablehlo.return %1 : tensor<i1>
+  } do {
+    %c1 = stablehlo.constant dense<1> : tensor<i32>
+    %zero = stablehlo.constant dense<0> : tensor<i32>
+    %1 = stablehlo.dynamic_update_slice %acc, %update, %iv, %zero : (tensor<8x4xf32>, tensor<1x4xf32>, tensor<i32>, tensor<i32>) -> tensor<8x4xf32>
+    %2 = stablehlo.add %iv, %c1 : tensor<i32>
+    stablehlo.return %2, %1 : tensor<i32>, tensor<8x4xf32>
+  }
+  func.return %0#1 : tensor<8x4xf32>
+}
+// CHECK-DAG:   %[[C0:.+]] = arith.constant 0 : index
+// CHECK-DAG:   %[[C1:.+]] = arith.constant 1 : index
+// CHECK-DAG:   %[[C8:.+]] = arith.constant 8 : index
+// CHECK:       %[[RESULT:.+]] = scf.for %[[I:.+]] = %[[C0]] to %[[C8]] step %[[C1]] iter_args(%[[ACC:.+]] = %[[CACHE]]) -> (tensor<8x4xf32>)
+// CHECK-NOT:     scf.while
+// CHECK:         %[[INSERTED:.+]] = tensor.insert_slice %[[UPDATE]] into %[[ACC]][%{{.+}}, 0] [1, 4] [1, 1]
+// CHECK:         scf.yield %[[INSERTED]] : tensor<8x4xf32>
+// CHECK:       return %[[RESULT]]
+
+// -----
+
+// CHECK-LABEL: func @while_to_for_iv_result
+// CHECK-SAME:    %[[START:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[LIMIT:[a-zA-Z0-9_]*]]
+func.func @while_to_for_iv_result(%start: tensor<i64>, %limit: tensor<i64>) -> tensor<i64> {
+  %0:2 = stablehlo.while(%iv = %start, %bound = %limit) : tensor<i64>, tensor<i64>
+  cond {
+    %1 = stablehlo.compare GT, %bound, %iv : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %1 : tensor<i1>
+  } do {
+    %c1 = stablehlo.constant dense<1> : tensor<i64>
+    %1 = stablehlo.add %c1, %iv : tensor<i64>
+    stablehlo.return %1, %bound : tensor<i64>, tensor<i64>
+  }
+  func.return %0#0 : tensor<i64>
+}
+// CHECK-DAG:   %[[LB_SCALAR:.+]] = tensor.extract %[[START]][] : tensor<i64>
+// CHECK-DAG:   %[[LB:.+]] = arith.index_cast %[[LB_SCALAR]] : i64 to index
+// CHECK-DAG:   %[[UB_SCALAR:.+]] = tensor.extract %[[LIMIT]][] : tensor<i64>
+// CHECK-DAG:   %[[UB:.+]] = arith.index_cast %[[UB_SCALAR]] : i64 to index
+// CHECK:       scf.for %{{.+}} = %[[LB]] to %[[UB]]
+// CHECK:       %[[FINAL:.+]] = arith.maxsi %[[LB]], %[[UB]] : index
+// CHECK:       %[[FINAL_SCALAR:.+]] = arith.index_cast %[[FINAL]] : index to i64
+// CHECK:       %[[FINAL_TENSOR:.+]] = tensor.from_elements %[[FINAL_SCALAR]] : tensor<i64>
+// CHECK:       return %[[FINAL_TENSOR]]
+
+// -----
+
+// CHECK-LABEL: func @while_to_while
+// CHECK-SAME:    %[[ARG:[a-zA-Z0-9_]*]]
+func.func @while_to_while(%arg: tensor<i64>) -> tensor<i64> {
+  %0 = stablehlo.while(%x = %arg) : tensor<i64>
+  cond {
+    %c100 = stablehlo.constant dense<100> : tensor<i64>
+    %1 = stablehlo.compare LT, %x, %c100 : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %1 : tensor<i1>
+  } do {
+    %1 = stablehlo.multiply %x, %x : tensor<i64>
+    stablehlo.return %1 : tensor<i64>
+  }
+  func.return %0 : tensor<i64>
+}
+// CHECK:       %[[RESULT:.+]] = scf.while (%[[BEFORE:.+]] = %[[ARG]]) : (tensor<i64>) -> tensor<i64>
+// CHECK:         %[[CMP:.+]] = linalg.generic
+// CHECK:           arith.cmpi slt
+// CHECK:         %[[PRED:.+]] = tensor.extract %[[CMP]][] : tensor<i1>
+// CHECK:         scf.condition(%[[PRED]]) %[[BEFORE]] : tensor<i64>
+// CHECK:       } do {
+// CHECK:       ^{{.+}}(%[[AFTER:.+]]: tensor<i64>):
+// CHECK:         %[[SQUARE:.+]] = linalg.generic
+// CHECK-SAME:      ins(%[[AFTER]], %[[AFTER]] : tensor<i64>, tensor<i64>)
+// CHECK:           arith.muli
+// CHECK:         scf.yield %[[SQUARE]] : tensor<i64>
+// CHECK:       return %[[RESULT]]
+
+// -----
+
+// CHECK-LABEL: func @if
+// CHECK-SAME:    %[[PRED:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ARG:[a-zA-Z0-9_]*]]
+func.func @if(%pred: tensor<i1>, %arg: tensor<4xf32>) -> tensor<4xf32> {
+  %0 = "stablehlo.if"(%pred) ({
+    %1 = stablehlo.add %arg, %arg : tensor<4xf32>
+    stablehlo.return %1 : tensor<4xf32>
+  }, {
+    %1 = stablehlo.multiply %arg, %arg : tensor<4xf32>
+    stablehlo.return %1 : tensor<4xf32>
+  }) : (tensor<i1>) -> tensor<4xf32>
+  func.return %0 : tensor<4xf32>
+}
+// CHECK:       %[[COND:.+]] = tensor.extract %[[PRED]][] : tensor<i1>
+// CHECK:       %[[RESULT:.+]] = scf.if %[[COND]] -> (tensor<4xf32>) {
+// CHECK:         %[[SUM:.+]] = linalg.generic
+// CHECK:           arith.addf
+// CHECK:         scf.yield %[[SUM]] : tensor<4xf32>
+// CHECK:       } else {
+// CHECK:         %[[PRODUCT:.+]] = linalg.generic
+// CHECK:           arith.mulf
+// CHECK:         scf.yield %[[PRODUCT]] : tensor<4xf32>
+// CHECK:       return %[[RESULT]]
+
+// -----
+
+// CHECK-LABEL: func @case
+// CHECK-SAME:    %[[INDEX:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ARG:[a-zA-Z0-9_]*]]
+func.func @case(%index: tensor<i32>, %arg: tensor<4xf32>) -> tensor<4xf32> {
+  %0 = "stablehlo.case"(%index) ({
+    %1 = stablehlo.add %arg, %arg : tensor<4xf32>
+    stablehlo.return %1 : tensor<4xf32>
+  }, {
+    %1 = stablehlo.multiply %arg, %arg : tensor<4xf32>
+    stablehlo.return %1 : tensor<4xf32>
+  }, {
+    %1 = stablehlo.negate %arg : tensor<4xf32>
+    stablehlo.return %1 : tensor<4xf32>
+  }) : (tensor<i32>) -> tensor<4xf32>
+  func.return %0 : tensor<4xf32>
+}
+// CHECK:       %[[SCALAR:.+]] = tensor.extract %[[INDEX]][] : tensor<i32>
+// CHECK:       %[[CASE:.+]] = arith.index_cast %[[SCALAR]] : i32 to index
+// CHECK:       %[[RESULT:.+]] = scf.index_switch %[[CASE]] -> tensor<4xf32>
+// CHECK:       case 0 {
+// CHECK:         arith.addf
+// CHECK:       case 1 {
+// CHECK:         arith.mulf
+// CHECK:       default {
+// CHECK:         arith.negf
+// CHECK:       return %[[RESULT]]
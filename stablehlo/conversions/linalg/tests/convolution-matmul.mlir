@@ -0,0 +1,59 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg="winograd-output-tile-size=2" --split-input-file --canonicalize | FileCheck %s --check-prefix=WINOGRAD
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg="enable-im2col=true" --split-input-file --canonicalize | FileCheck %s --check-prefix=IM2COL
+
+// WINOGRAD-LABEL: func @conv_3x3
+// WINOGRAD-SAME:    (%[[INPUT:.*]]: tensor<1x6x6x4xf32>, %[[FILTER:.*]]: tensor<3x3x4x8xf32>)
+// WINOGRAD-NOT:   linalg.conv_2d_nhwc_hwcf
+// WINOGRAD:       %[[U:.*]] = linalg.generic
+// WINOGRAD-SAME:    ins(%{{.*}}, %[[FILTER]], %{{.*}} : tensor<4x3xf32>, tensor<3x3x4x8xf32>, tensor<4x3xf32>)
+// WINOGRAD-SAME:    -> tensor<4x4x4x8xf32>
+// WINOGRAD:       %[[V:.*]] = linalg.generic
+// WINOGRAD-SAME:    ins(%{{.*}}, %[[INPUT]], %{{.*}} : tensor<4x4xf32>, tensor<1x6x6x4xf32>, tensor<4x4xf32>)
+// WINOGRAD-SAME:    -> tensor<4x4x1x2x2x4xf32>
+// WINOGRAD-DAG:   %[[LHS:.*]] = tensor.collapse_shape %[[V]] {{\[}}[0, 1], [2, 3, 4], [5]]
+// WINOGRAD-DAG:   %[[RHS:.*]] = tensor.collapse_shape %[[U]] {{\[}}[0, 1], [2], [3]]
+// WINOGRAD:       %[[M:.*]] = linalg.batch_matmul
+// WINOGRAD-SAME:    ins(%[[LHS]], %[[RHS]] : tensor<16x4x4xf32>, tensor<16x4x8xf32>)
+// WINOGRAD:       %[[TILES:.*]] = tensor.expand_shape %[[M]]
+// WINOGRAD:       %[[Y:.*]] = linalg.generic
+// WINOGRAD-SAME:    ins(%{{.*}}, %[[TILES]], %{{.*}} : tensor<2x4xf32>, tensor<4x4x1x2x2x8xf32>, tensor<2x4xf32>)
+// WINOGRAD-SAME:    -> tensor<1x2x2x2x2x8xf32>
+// WINOGRAD:       %[[RESULT:.*]] = tensor.collapse_shape %[[Y]] {{\[}}[0], [1, 2], [3, 4], [5]]
+// WINOGRAD:       return %[[RESULT]] : tensor<1x4x4x8xf32>
+
+// IM2COL-LABEL: func @conv_3x3
+// IM2COL-NOT:   linalg.conv_2d_nhwc_hwcf
+// IM2COL:       linalg.generic
+// IM2COL-SAME:    -> tensor<1x16x36xf32>
+// IM2COL:       linalg.generic
+// IM2COL-SAME:    iterator_types = ["parallel", "parallel", "parallel", "reduction"]
+func.func @conv_3x3(%arg0: tensor<1x6x6x4xf32>, %arg1: tensor<3x3x4x8xf32>)
+    -> tensor<1x4x4x8xf32> {
+  %0 = stablehlo.convolution(%arg0, %arg1)
+         dim_numbers = [b, 0, 1, f]x[0, 1, i, o]->[b, 0, 1, f],
+         window = {stride = [1, 1], pad = [[0, 0], [0, 0]], rhs_dilate = [1, 1]}
+         {
+           batch_group_count = 1 : i64, feature_group_count = 1 : i64
+         } : (tensor<1x6x6x4xf32>, tensor<3x3x4x8xf32>) -> tensor<1x4x4x8xf32>
+  func.return %0 : tensor<1x4x4x8xf32>
+}
+
+// -----
+
+// Strided convolutions don't use the Winograd algorithm.
+
+// WINOGRAD-LABEL: func @conv_strided
+// WINOGRAD:       linalg.conv_2d_nhwc_hwcf
+
+// IM2COL-LABEL: func @conv_strided
+// IM2COL-NOT:   linalg.conv_2d_nhwc_hwcf
+func.func @conv_strided(%arg0: tensor<1x7x7x4xf32>, %arg1: tensor<3x3x4x8xf32>)
+    -> tensor<1x3x3x8xf32> {
+  %0 = stablehlo.convolution(%arg0, %arg1)
+         dim_numbers = [b, 0, 1, f]x[0, 1, i, o]->[b, 0, 1, f],
+         window = {stride = [2, 2], pad = [[0, 0], [0, 0]], rhs_dilate = [1, 1]}
+         {
+           batch_group_count = 1 : i64, feature_group_count = 1 : i64
+         } : (tensor<1x7x7x4xf32>, tensor<3x3x4x8xf32>) -> tensor<1x3x3x8xf32>
+  func.return %0 : tensor<1x3x3x8xf32>
+}
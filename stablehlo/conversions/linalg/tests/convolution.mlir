@@ -592,3 +592,39 @@ func.func @depthwise_conv3d_m1(%arg0: tensor<2x3x5x4x6xf32>,
 }
 // CHECK:       %[[CONV:.+]] = linalg.depthwise_conv_3d_ndhwc_dhwc
 // CHECK:       return %[[CONV]]
+
+// -----
+
+// CHECK-DAG:   #[[INPUT_MAP:.+]] = affine_map<(d0, d1, d2, d3, d4, d5, d6, d7) -> (d0, d1 + d5 * 2, d2 + d6 * 2, d3 * 2 + d7)>
+// CHECK-DAG:   #[[FILTER_MAP:.+]] = affine_map<(d0, d1, d2, d3, d4, d5, d6, d7) -> (d5, d6, d7, d3 * 3 + d4)>
+// CHECK-DAG:   #[[RESULT_MAP:.+]] = affine_map<(d0, d1, d2, d3, d4, d5, d6, d7) -> (d0, d1, d2, d3, d4)>
+// CHECK-LABEL:  func @grouped_conv
+// CHECK-SAME:   %[[IN:[a-zA-Z0-9_]*]]
+// CHECK-SAME:   %[[FILTER:[a-zA-Z0-9_]*]]
+func.func @grouped_conv(%arg0: tensor<1x8x8x4xf32>,
+                        %arg1: tensor<3x3x2x6xf32>) -> tensor<1x4x4x6xf32> {
+  %0 = stablehlo.convolution(%arg0, %arg1)
+    dim_numbers = [b, 0, 1, f]x[0, 1, i, o]->[b, 0, 1, f],
+    window = {
+      stride = [1, 1],
+      pad = [[0, 0], [0, 0]],
+      lhs_dilate = [1, 1],
+      rhs_dilate = [2, 2],
+      reverse = [0, 0]} {
+    batch_group_count = 1 : i64,
+    feature_group_count = 2 : i64} : (tensor<1x8x8x4xf32>, tensor<3x3x2x6xf32>)
+                                   -> tensor<1x4x4x6xf32>
+  func.return %0 : tensor<1x4x4x6xf32>
+}
+// CHECK-NOT:   tensor.expand_shape
+// CHECK:       %[[INIT:.+]] = tensor.empty() : tensor<1x4x4x2x3xf32>
+// CHECK:       %[[FILL:.+]] = linalg.fill ins(%{{.+}} : f32) outs(%[[INIT]] : tensor<1x4x4x2x3xf32>)
+// CHECK:       %[[CONV:.+]] = linalg.generic
+// CHECK-SAME:    indexing_maps = [#[[INPUT_MAP]], #[[FILTER_MAP]], #[[RESULT_MAP]]]
+// CHECK-SAME:    iterator_types = ["parallel", "parallel", "parallel", "parallel", "parallel", "reduction", "reduction", "reduction"]
+// CHECK-SAME:    ins(%[[IN]], %[[FILTER]] : tensor<1x8x8x4xf32>, tensor<3x3x2x6xf32>)
+// CHECK-SAME:    outs(%[[FILL]] : tensor<1x4x4x2x3xf32>)
+// CHECK:       %[[OUT:.+]] = tensor.collapse_shape %[[CONV]]
+// CHECK-SAME:    [0], [1], [2], [3, 4]
+// CHECK-SAME:    : tensor<1x4x4x2x3xf32> into tensor<1x4x4x6xf32>
+// CHECK:       return %[[OUT]]
@@ -0,0 +1,76 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg="enable-destination-passing-style" --split-input-file --canonicalize | FileCheck %s
+
+// CHECK-LABEL: func @concatenate
+// CHECK-SAME:    %[[ARG0:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ARG1:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ARG2:[a-zA-Z0-9_]*]]
+func.func @concatenate(%a: tensor<2x3xi32>, %b: tensor<2x4xi32>, %c: tensor<2x5xi32>) -> tensor<2x12xi32> {
+  %0 = "stablehlo.concatenate"(%a, %b, %c) {dimension = 1 : i64}
+    : (tensor<2x3xi32>, tensor<2x4xi32>, tensor<2x5xi32>) -> tensor<2x12xi32>
+  func.return %0 : tensor<2x12xi32>
+}
+// CHECK:       %[[EMPTY:.+]] = tensor.empty() : tensor<2x12xi32>
+// CHECK:       %[[INSERT0:.+]] = tensor.insert_slice %[[ARG0]] into %[[EMPTY]][0, 0] [2, 3] [1, 1]
+// CHECK:       %[[INSERT1:.+]] = tensor.insert_slice %[[ARG1]] into %[[INSERT0]][0, 3] [2, 4] [1, 1]
+// CHECK:       %[[INSERT2:.+]] = tensor.insert_slice %[[ARG2]] into %[[INSERT1]][0, 7] [2, 5] [1, 1]
+// CHECK:       return %[[INSERT2]]
+
+// -----
+
+// CHECK-LABEL: func @concatenate_dynamic
+// CHECK-SAME:    %[[ARG0:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ARG1:[a-zA-Z0-9_]*]]
+func.func @concatenate_dynamic(%a: tensor<?x3xi32>, %b: tensor<?x3xi32>) -> tensor<?x3xi32> {
+  %0 = "stablehlo.concatenate"(%a, %b) {dimension = 0 : i64}
+    : (tensor<?x3xi32>, tensor<?x3xi32>) -> tensor<?x3xi32>
+  func.return %0 : tensor<?x3xi32>
+}
+// CHECK-DAG:   %[[C0:.+]] = arith.constant 0 : index
+// CHECK:       %[[EMPTY:.+]] = tensor.empty
+// CHECK:       %[[SIZE0:.+]] = tensor.dim %[[ARG0]], %[[C0]]
+// CHECK:       %[[INSERT0:.+]] = tensor.insert_slice %[[ARG0]] into %[[EMPTY]][0, 0] [%[[SIZE0]], 3] [1, 1]
+// CHECK:       %[[SIZE1:.+]] = tensor.dim %[[ARG1]], %[[C0]]
+// CHECK:       %[[INSERT1:.+]] = tensor.insert_slice %[[ARG1]] into %[[INSERT0]][%[[SIZE0]], 0] [%[[SIZE1]], 3] [1, 1]
+// CHECK:       return %[[INSERT1]]
+
+// -----
+
+// CHECK-LABEL: func @pad
+// CHECK-SAME:    %[[ARG0:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ARG1:[a-zA-Z0-9_]*]]
+func.func @pad(%arg0: tensor<12x4xf32>, %arg1: tensor<f32>) -> tensor<18x12xf32> {
+  %0 = "stablehlo.pad"(%arg0, %arg1) {
+    edge_padding_high = array<i64: 2, 3>,
+    edge_padding_low = array<i64: 4, 5>,
+    interior_padding = array<i64: 0, 0>
+  } : (tensor<12x4xf32>, tensor<f32>) -> tensor<18x12xf32>
+  func.return %0 : tensor<18x12xf32>
+}
+// CHECK-NOT:   tensor.pad
+// CHECK:       %[[PAD:.+]] = tensor.extract %[[ARG1]][] : tensor<f32>
+// CHECK:       %[[EMPTY:.+]] = tensor.empty() : tensor<18x12xf32>
+// CHECK:       %[[FILL:.+]] = linalg.fill ins(%[[PAD]] : f32) outs(%[[EMPTY]] : tensor<18x12xf32>)
+// CHECK:       %[[RESULT:.+]] = tensor.insert_slice %[[ARG0]] into %[[FILL]][4, 5] [12, 4] [1, 1]
+// CHECK:       return %[[RESULT]]
+
+// -----
+
+// CHECK-DAG:   #[[SCALAR_MAP:.+]] = affine_map<(d0, d1) -> ()>
+// CHECK-DAG:   #[[MAP:.+]] = affine_map<(d0, d1) -> (d0, d1)>
+// CHECK-LABEL: func @select
+// CHECK-SAME:    %[[PRED:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ON_TRUE:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ON_FALSE:[a-zA-Z0-9_]*]]
+func.func @select(%pred: tensor<i1>, %on_true: tensor<2x3xf32>, %on_false: tensor<2x3xf32>) -> tensor<2x3xf32> {
+  %0 = "stablehlo.select"(%pred, %on_true, %on_false)
+    : (tensor<i1>, tensor<2x3xf32>, tensor<2x3xf32>) -> tensor<2x3xf32>
+  func.return %0 : tensor<2x3xf32>
+}
+// CHECK:       %[[RESULT:.+]] = linalg.generic
+// CHECK-SAME:    indexing_maps = [#[[SCALAR_MAP]], #[[MAP]], #[[MAP]]]
+// CHECK-SAME:    ins(%[[PRED]], %[[ON_TRUE]] : tensor<i1>, tensor<2x3xf32>)
+// CHECK-SAME:    outs(%[[ON_FALSE]] : tensor<2x3xf32>)
+// CHECK:       ^{{.+}}(%[[P:.+]]: i1, %[[T:.+]]: f32, %[[F:.+]]: f32):
+// CHECK:         %[[SELECT:.+]] = arith.select %[[P]], %[[T]], %[[F]] : f32
+// CHECK:         linalg.yield %[[SELECT]] : f32
+// CHECK:       return %[[RESULT]]
@@ -0,0 +1,92 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg="enable-widened-accumulation" --split-input-file --canonicalize | FileCheck %s
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg --split-input-file --canonicalize | FileCheck %s --check-prefix=DEFAULT
+
+// CHECK-LABEL: func @dot_bf16
+// CHECK-SAME:    (%[[ARG0:.*]]: tensor<4x8xbf16>, %[[ARG1:.*]]: tensor<8x16xbf16>)
+// CHECK:         %[[ZERO:.*]] = arith.constant 0.000000e+00 : f32
+// CHECK:         %[[INIT:.*]] = tensor.empty() : tensor<4x16xf32>
+// CHECK:         %[[FILL:.*]] = linalg.fill ins(%[[ZERO]] : f32) outs(%[[INIT]] : tensor<4x16xf32>)
+// CHECK:         %[[ACC:.*]] = linalg.matmul
+// CHECK-SAME:      ins(%[[ARG0]], %[[ARG1]] : tensor<4x8xbf16>, tensor<8x16xbf16>)
+// CHECK-SAME:      outs(%[[FILL]] : tensor<4x16xf32>)
+// CHECK:         %[[EMPTY:.*]] = tensor.empty() : tensor<4x16xbf16>
+// CHECK:         %[[RESULT:.*]] = linalg.generic
+// CHECK-SAME:      ins(%[[ACC]] : tensor<4x16xf32>) outs(%[[EMPTY]] : tensor<4x16xbf16>)
+// CHECK:           %[[TRUNC:.*]] = arith.truncf %{{.*}} : f32 to bf16
+// CHECK:           linalg.yield %[[TRUNC]] : bf16
+// CHECK:         return %[[RESULT]]
+
+// DEFAULT-LABEL: func @dot_bf16
+// DEFAULT:         linalg.matmul
+// DEFAULT-SAME:      outs(%{{.*}} : tensor<4x16xbf16>)
+// DEFAULT-NOT:     arith.truncf
+func.func @dot_bf16(%arg0: tensor<4x8xbf16>, %arg1: tensor<8x16xbf16>) -> tensor<4x16xbf16> {
+  %0 = "stablehlo.dot"(%arg0, %arg1) : (tensor<4x8xbf16>, tensor<8x16xbf16>) -> tensor<4x16xbf16>
+  func.return %0 : tensor<4x16xbf16>
+}
+
+// -----
+
+// CHECK-LABEL: func @dot_general_highest_f16
+// CHECK:         linalg.batch_matmul
+// CHECK-SAME:      outs(%{{.*}} : tensor<2x4x16xf32>)
+// CHECK:         arith.truncf %{{.*}} : f32 to f16
+
+// DEFAULT-LABEL: func @dot_general_highest_f16
+// DEFAULT:         linalg.batch_matmul
+// DEFAULT-SAME:      outs(%{{.*}} : tensor<2x4x16xf32>)
+// DEFAULT:         arith.truncf %{{.*}} : f32 to f16
+func.func @dot_general_highest_f16(%arg0: tensor<2x4x8xf16>, %arg1: tensor<2x8x16xf16>) -> tensor<2x4x16xf16> {
+  %0 = "stablehlo.dot_general"(%arg0, %arg1) {
+    dot_dimension_numbers = #stablehlo.dot<
+      lhs_batching_dimensions = [0],
+      lhs_contracting_dimensions = [2],
+      rhs_batching_dimensions = [0],
+      rhs_contracting_dimensions = [1]
+    >,
+    precision_config = [#stablehlo<precision HIGHEST>, #stablehlo<precision HIGHEST>]
+  } : (tensor<2x4x8xf16>, tensor<2x8x16xf16>) -> tensor<2x4x16xf16>
+  func.return %0 : tensor<2x4x16xf16>
+}
+
+// -----
+
+// CHECK-LABEL: func @dot_general_generic_bf16
+// CHECK-SAME:    (%[[ARG0:.*]]: tensor<?x4x8xbf16>, %[[ARG1:.*]]: tensor<8x?x4xbf16>)
+// CHECK:         %[[INIT:.*]] = tensor.empty({{.*}}) : tensor<4x?x?xf32>
+// CHECK:         %[[FILL:.*]] = linalg.fill ins(%{{.*}} : f32) outs(%[[INIT]] : tensor<4x?x?xf32>)
+// CHECK:         %[[ACC:.*]] = linalg.generic
+// CHECK-SAME:      ins(%[[ARG0]], %[[ARG1]] : tensor<?x4x8xbf16>, tensor<8x?x4xbf16>)
+// CHECK-SAME:      outs(%[[FILL]] : tensor<4x?x?xf32>)
+// CHECK:         ^bb0(%[[LHS:.*]]: bf16, %[[RHS:.*]]: bf16, %[[OUT:.*]]: f32):
+// CHECK:           %[[LHS_EXT:.*]] = arith.extf %[[LHS]] : bf16 to f32
+// CHECK:           %[[RHS_EXT:.*]] = arith.extf %[[RHS]] : bf16 to f32
+// CHECK:           %[[MUL:.*]] = arith.mulf %[[LHS_EXT]], %[[RHS_EXT]] : f32
+// CHECK:           %[[SUM:.*]] = arith.addf %[[OUT]], %[[MUL]] : f32
+// CHECK:           linalg.yield %[[SUM]] : f32
+// CHECK:         %[[EMPTY:.*]] = tensor.empty({{.*}}) : tensor<4x?x?xbf16>
+// CHECK:         linalg.generic
+// CHECK-SAME:      ins(%[[ACC]] : tensor<4x?x?xf32>) outs(%[[EMPTY]] : tensor<4x?x?xbf16>)
+// CHECK:           arith.truncf %{{.*}} : f32 to bf16
+func.func @dot_general_generic_bf16(%arg0: tensor<?x4x8xbf16>, %arg1: tensor<8x?x4xbf16>) -> tensor<4x?x?xbf16> {
+  %0 = "stablehlo.dot_general"(%arg0, %arg1) {
+    dot_dimension_numbers = #stablehlo.dot<
+      lhs_batching_dimensions = [1],
+      lhs_contracting_dimensions = [2],
+      rhs_batching_dimensions = [2],
+      rhs_contracting_dimensions = [0]
+    >
+  } : (tensor<?x4x8xbf16>, tensor<8x?x4xbf16>) -> tensor<4x?x?xbf16>
+  func.return %0 : tensor<4x?x?xbf16>
+}
+
+// -----
+
+// CHECK-LABEL: func @dot_f32
+// CHECK:         linalg.matvec
+// CHECK-SAME:      outs(%{{.*}} : tensor<4xf32>)
+// CHECK-NOT:     arith.truncf
+func.func @dot_f32(%arg0: tensor<4x8xf32>, %arg1: tensor<8xf32>) -> tensor<4xf32> {
+  %0 = "stablehlo.dot"(%arg0, %arg1) : (tensor<4x8xf32>, tensor<8xf32>) -> tensor<4xf32>
+  func.return %0 : tensor<4xf32>
+}
@@ -347,3 +347,66 @@ func.func @simple_dot_general_dot(%arg0: tensor<?xf32>,
 // CHECK: linalg.dot
 // CHECK-SAME: ins(%[[ARG0]], %[[ARG1]] : tensor<?xf32>, tensor<?xf32>)
 // CHECK-SAME: outs(%[[FILL]] : tensor<f32>)
+
+// -----
+
+func.func @dot_general_matmul_transpose_a(%arg0: tensor<3x2xf32>,
+             %arg1: tensor<3x?xf32>) -> tensor<2x?xf32> {
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [0] x [0] {someattr}
+       : (tensor<3x2xf32>, tensor<3x?xf32>) -> tensor<2x?xf32>
+  func.return %0 : tensor<2x?xf32>
+}
+
+// CHECK-LABEL: func @dot_general_matmul_transpose_a
+// CHECK-SAME:  (%[[ARG0:.*]]: tensor<3x2xf32>, %[[ARG1:.*]]: tensor<3x?xf32>)
+// CHECK: %[[FILL:.*]] = linalg.fill
+// CHECK: linalg.matmul_transpose_a
+// CHECK-SAME: {someattr}
+// CHECK-SAME: ins(%[[ARG0]], %[[ARG1]] : tensor<3x2xf32>, tensor<3x?xf32>)
+// CHECK-SAME: outs(%[[FILL]] : tensor<2x?xf32>)
+
+// -----
+
+func.func @dot_general_batch_matmul_transpose_b(%arg0: tensor<?x2x3xf32>,
+             %arg1: tensor<?x4x3xf32>) -> tensor<?x2x4xf32> {
+  %0 = "stablehlo.dot_general"(%arg0, %arg1) {
+    dot_dimension_numbers = #stablehlo.dot<
+      lhs_batching_dimensions = [0],
+      rhs_batching_dimensions = [0],
+      lhs_contracting_dimensions = [2],
+      rhs_contracting_dimensions = [2]>
+  } : (tensor<?x2x3xf32>, tensor<?x4x3xf32>) -> tensor<?x2x4xf32>
+  func.return %0 : tensor<?x2x4xf32>
+}
+
+// CHECK-LABEL: func @dot_general_batch_matmul_transpose_b
+// CHECK-SAME:  (%[[ARG0:.*]]: tensor<?x2x3xf32>, %[[ARG1:.*]]: tensor<?x4x3xf32>)
+// CHECK: %[[FILL:.*]] = linalg.fill
+// CHECK: linalg.batch_matmul_transpose_b
+// CHECK-SAME: ins(%[[ARG0]], %[[ARG1]] : tensor<?x2x3xf32>, tensor<?x4x3xf32>)
+// CHECK-SAME: outs(%[[FILL]] : tensor<?x2x4xf32>)
+
+// -----
+
+func.func @dot_general_collapsed_batch_matmul(%arg0: tensor<3x4x2x5xf32>,
+             %arg1: tensor<3x4x5x?xf32>) -> tensor<3x4x2x?xf32> {
+  %0 = "stablehlo.dot_general"(%arg0, %arg1) {
+    dot_dimension_numbers = #stablehlo.dot<
+      lhs_batching_dimensions = [0, 1],
+      rhs_batching_dimensions = [0, 1],
+      lhs_contracting_dimensions = [3],
+      rhs_contracting_dimensions = [2]>
+  } : (tensor<3x4x2x5xf32>, tensor<3x4x5x?xf32>) -> tensor<3x4x2x?xf32>
+  func.return %0 : tensor<3x4x2x?xf32>
+}
+
+// CHECK-LABEL: func @dot_general_collapsed_batch_matmul
+// CHECK-SAME:  (%[[ARG0:.*]]: tensor<3x4x2x5xf32>, %[[ARG1:.*]]: tensor<3x4x5x?xf32>)
+// CHECK-DAG: %[[LHS:.*]] = tensor.collapse_shape %[[ARG0]] {{\[}}[0, 1], [2], [3]] : tensor<3x4x2x5xf32> into tensor<12x2x5xf32>
+// CHECK-DAG: %[[RHS:.*]] = tensor.collapse_shape %[[ARG1]] {{\[}}[0, 1], [2], [3]] : tensor<3x4x5x?xf32> into tensor<12x5x?xf32>
+// CHECK: %[[FILL:.*]] = linalg.fill
+// CHECK: %[[MATMUL:.*]] = linalg.batch_matmul
+// CHECK-SAME: ins(%[[LHS]], %[[RHS]] : tensor<12x2x5xf32>, tensor<12x5x?xf32>)
+// CHECK-SAME: outs(%[[FILL]] : tensor<12x2x?xf32>)
+// CHECK: tensor.expand_shape %[[MATMUL]] {{\[}}[0, 1], [2], [3]]
+// CHECK-SAME: tensor<12x2x?xf32> into tensor<3x4x2x?xf32>
@@ -0,0 +1,63 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg="forall-num-threads=4" --split-input-file --canonicalize | FileCheck %s
+
+// CHECK-LABEL: func @add
+// CHECK-SAME:    %[[LHS:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[RHS:[a-zA-Z0-9_]*]]
+func.func @add(%lhs: tensor<64x32xf32>, %rhs: tensor<64x32xf32>) -> tensor<64x32xf32> {
+  %0 = stablehlo.add %lhs, %rhs : tensor<64x32xf32>
+  func.return %0 : tensor<64x32xf32>
+}
+// CHECK:       %[[EMPTY:.+]] = tensor.empty() : tensor<64x32xf32>
+// CHECK:       %[[RESULT:.+]] = scf.forall (%[[I:.+]]) = (0) to (64) step (16) shared_outs(%[[OUT:.+]] = %[[EMPTY]]) -> (tensor<64x32xf32>)
+// CHECK-DAG:     %[[LHS_TILE:.+]] = tensor.extract_slice %[[LHS]][%[[I]], 0] [16, 32] [1, 1]
+// CHECK-DAG:     %[[RHS_TILE:.+]] = tensor.extract_slice %[[RHS]][%[[I]], 0] [16, 32] [1, 1]
+// CHECK-DAG:     %[[OUT_TILE:.+]] = tensor.extract_slice %[[OUT]][%[[I]], 0] [16, 32] [1, 1]
+// CHECK:         %[[SUM:.+]] = linalg.generic
+// CHECK-SAME:      ins(%[[LHS_TILE]], %[[RHS_TILE]] : tensor<16x32xf32>, tensor<16x32xf32>)
+// CHECK-SAME:      outs(%[[OUT_TILE]] : tensor<16x32xf32>)
+// CHECK:         scf.forall.in_parallel
+// CHECK:           tensor.parallel_insert_slice %[[SUM]] into %[[OUT]][%[[I]], 0] [16, 32] [1, 1]
+// CHECK:       return %[[RESULT]]
+
+// -----
+
+// The first loop is too small to be distributed, so the second one is tiled.
+
+// CHECK-LABEL: func @add_batch
+func.func @add_batch(%lhs: tensor<2x10xf32>, %rhs: tensor<2x10xf32>) -> tensor<2x10xf32> {
+  %0 = stablehlo.add %lhs, %rhs : tensor<2x10xf32>
+  func.return %0 : tensor<2x10xf32>
+}
+// CHECK:       scf.forall (%[[I:.+]]) = (0) to (10) step (3)
+// CHECK:         %[[SIZE:.+]] = affine.min
+// CHECK:         tensor.extract_slice %{{.+}}[0, %[[I]]] [2, %[[SIZE]]] [1, 1]
+
+// -----
+
+// CHECK-LABEL: func @small
+func.func @small(%lhs: tensor<2x3xf32>, %rhs: tensor<2x3xf32>) -> tensor<2x3xf32> {
+  %0 = stablehlo.add %lhs, %rhs : tensor<2x3xf32>
+  func.return %0 : tensor<2x3xf32>
+}
+// CHECK-NOT:   scf.forall
+// CHECK:       linalg.generic
+
+// -----
+
+// CHECK-LABEL: func @dot
+// CHECK-SAME:    %[[LHS:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[RHS:[a-zA-Z0-9_]*]]
+func.func @dot(%lhs: tensor<64x128xf32>, %rhs: tensor<128x32xf32>) -> tensor<64x32xf32> {
+  %0 = "stablehlo.dot"(%lhs, %rhs) : (tensor<64x128xf32>, tensor<128x32xf32>) -> tensor<64x32xf32>
+  func.return %0 : tensor<64x32xf32>
+}
+// CHECK:       %[[FILL:.+]] = scf.forall
+// CHECK:         linalg.fill
+// CHECK:       %[[RESULT:.+]] = scf.forall (%[[I:.+]]) = (0) to (64) step (16) shared_outs(%[[OUT:.+]] = %[[FILL]])
+// CHECK-DAG:     %[[LHS_TILE:.+]] = tensor.extract_slice %[[LHS]][%[[I]], 0] [16, 128] [1, 1]
+// CHECK-DAG:     %[[OUT_TILE:.+]] = tensor.extract_slice %[[OUT]][%[[I]], 0] [16, 32] [1, 1]
+// CHECK:         %[[PRODUCT:.+]] = linalg.matmul
+// CHECK-SAME:      ins(%[[LHS_TILE]], %[[RHS]] : tensor<16x128xf32>, tensor<128x32xf32>)
+// CHECK-SAME:      outs(%[[OUT_TILE]] : tensor<16x32xf32>)
+// CHECK:           tensor.parallel_insert_slice %[[PRODUCT]] into %[[OUT]][%[[I]], 0] [16, 32] [1, 1]
+// CHECK:       return %[[RESULT]]
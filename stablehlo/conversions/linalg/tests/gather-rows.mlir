@@ -0,0 +1,99 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg="enable-row-gather" --split-input-file --canonicalize | FileCheck %s
+
+// CHECK-LABEL: func @gather_rows
+// CHECK-SAME:    %[[OPERAND:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[INDICES:[a-zA-Z0-9_]*]]
+func.func @gather_rows(%operand : tensor<100x64xf32>, %start_indices : tensor<8x1xi32>) -> tensor<8x64xf32> {
+  %res = "stablehlo.gather"(%operand, %start_indices) {
+    dimension_numbers = #stablehlo.gather<
+      collapsed_slice_dims = [0],
+      index_vector_dim = 1,
+      offset_dims = [1],
+      start_index_map = [0]
+    >,
+    indices_are_sorted = false,
+    slice_sizes = array<i64: 1, 64>
+  } : (tensor<100x64xf32>, tensor<8x1xi32>) -> tensor<8x64xf32>
+  func.return %res : tensor<8x64xf32>
+}
+// CHECK-DAG:   %[[C0:.+]] = arith.constant 0 : index
+// CHECK-DAG:   %[[C99:.+]] = arith.constant 99 : index
+// CHECK:       %[[FLAT:.+]] = tensor.collapse_shape %[[INDICES]]
+// CHECK-SAME{literal}: [[0, 1]] : tensor<8x1xi32> into tensor<8xi32>
+// CHECK:       %[[EMPTY:.+]] = tensor.empty() : tensor<8x64xf32>
+// CHECK:       %[[RESULT:.+]] = scf.forall (%[[I:.+]]) in (8) shared_outs(%[[OUT:.+]] = %[[EMPTY]]) -> (tensor<8x64xf32>)
+// CHECK:         %[[INDEX:.+]] = tensor.extract %[[FLAT]][%[[I]]] : tensor<8xi32>
+// CHECK:         %[[CAST:.+]] = arith.index_cast %[[INDEX]] : i32 to index
+// CHECK:         %[[MAX:.+]] = arith.maxsi %{{.+}}, %{{.+}} : index
+// CHECK:         %[[CLAMPED:.+]] = arith.minsi %[[MAX]], %[[C99]] : index
+// CHECK:         %[[ROW:.+]] = tensor.extract_slice %[[OPERAND]][%[[CLAMPED]], 0] [1, 64] [1, 1] : tensor<100x64xf32> to tensor<1x64xf32>
+// CHECK:         scf.forall.in_parallel
+// CHECK:           tensor.parallel_insert_slice %[[ROW]] into %[[OUT]][%[[I]], 0] [1, 64] [1, 1] : tensor<1x64xf32> into tensor<8x64xf32>
+// CHECK:       return %[[RESULT]]
+
+// -----
+
+// CHECK-LABEL: func @gather_rows_batch
+// CHECK-SAME:    %[[OPERAND:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[INDICES:[a-zA-Z0-9_]*]]
+func.func @gather_rows_batch(%operand : tensor<10x4x8xi32>, %start_indices : tensor<2x3xi32>) -> tensor<2x3x4x8xi32> {
+  %res = "stablehlo.gather"(%operand, %start_indices) {
+    dimension_numbers = #stablehlo.gather<
+      collapsed_slice_dims = [0],
+      index_vector_dim = 2,
+      offset_dims = [2, 3],
+      start_index_map = [0]
+    >,
+    indices_are_sorted = false,
+    slice_sizes = array<i64: 1, 4, 8>
+  } : (tensor<10x4x8xi32>, tensor<2x3xi32>) -> tensor<2x3x4x8xi32>
+  func.return %res : tensor<2x3x4x8xi32>
+}
+// CHECK:       %[[FLAT:.+]] = tensor.collapse_shape %[[INDICES]]
+// CHECK-SAME{literal}: [[0, 1]] : tensor<2x3xi32> into tensor<6xi32>
+// CHECK:       %[[EMPTY:.+]] = tensor.empty() : tensor<6x4x8xi32>
+// CHECK:       %[[ROWS:.+]] = scf.forall (%[[I:.+]]) in (6) shared_outs(%[[OUT:.+]] = %[[EMPTY]]) -> (tensor<6x4x8xi32>)
+// CHECK:         %[[ROW:.+]] = tensor.extract_slice %[[OPERAND]][%{{.+}}, 0, 0] [1, 4, 8] [1, 1, 1] : tensor<10x4x8xi32> to tensor<1x4x8xi32>
+// CHECK:         tensor.parallel_insert_slice %[[ROW]] into %[[OUT]][%[[I]], 0, 0] [1, 4, 8] [1, 1, 1]
+// CHECK:       %[[RESULT:.+]] = tensor.expand_shape %[[ROWS]]
+// CHECK-SAME{literal}: [[0, 1], [2], [3]] : tensor<6x4x8xi32> into tensor<2x3x4x8xi32>
+// CHECK:       return %[[RESULT]]
+
+// -----
+
+// CHECK-LABEL: func @gather_partial_rows
+func.func @gather_partial_rows(%operand : tensor<100x64xf32>, %start_indices : tensor<8x1xi32>) -> tensor<8x32xf32> {
+  %res = "stablehlo.gather"(%operand, %start_indices) {
+    dimension_numbers = #stablehlo.gather<
+      collapsed_slice_dims = [0],
+      index_vector_dim = 1,
+      offset_dims = [1],
+      start_index_map = [0]
+    >,
+    indices_are_sorted = false,
+    slice_sizes = array<i64: 1, 32>
+  } : (tensor<100x64xf32>, tensor<8x1xi32>) -> tensor<8x32xf32>
+  func.return %res : tensor<8x32xf32>
+}
+// CHECK-NOT:   scf.forall
+// CHECK:       linalg.generic
+
+// -----
+
+// CHECK-LABEL: func @torch_index_select_rows
+// CHECK-SAME:    %[[OPERAND:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[INDEX:[a-zA-Z0-9_]*]]
+func.func @torch_index_select_rows(%arg0: tensor<5x1x5xui32>,
+                                   %arg1: tensor<2xui32>) -> tensor<2x1x5xui32> {
+  %0 = "stablehlo.torch_index_select"(%arg0, %arg1) {
+    dim = 0 : i64,
+    batch_dims = 0 : i64
+  } : (tensor<5x1x5xui32>, tensor<2xui32>) -> tensor<2x1x5xui32>
+  func.return %0 : tensor<2x1x5xui32>
+}
+// CHECK-DAG:   %[[OPERAND_SIGNLESS:.+]] = builtin.unrealized_conversion_cast %[[OPERAND]] : tensor<5x1x5xui32> to tensor<5x1x5xi32>
+// CHECK-DAG:   %[[INDEX_SIGNLESS:.+]] = builtin.unrealized_conversion_cast %[[INDEX]] : tensor<2xui32> to tensor<2xi32>
+// CHECK:       scf.forall (%[[I:.+]]) in (2)
+// CHECK:         %[[ELEMENT:.+]] = tensor.extract %[[INDEX_SIGNLESS]][%[[I]]] : tensor<2xi32>
+// CHECK:         arith.index_castui %[[ELEMENT]] : i32 to index
+// CHECK:         tensor.extract_slice %[[OPERAND_SIGNLESS]][%{{.+}}, 0, 0] [1, 1, 5] [1, 1, 1]
@@ -1585,6 +1585,34 @@ func.func @dynamic_update_slice_float(%target: tensor<3x3xf32>,
 
 // -----
 
+// CHECK-LABEL: func @dynamic_update_slice_dynamic(
+// CHECK-SAME:    %[[ARG0:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ARG1:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[ARG2:[a-zA-Z0-9_]*]]
+func.func @dynamic_update_slice_dynamic(%target: tensor<?x3xf32>,
+                                        %update: tensor<?x2xf32>,
+                                        %c0: tensor<i32>) -> tensor<?x3xf32> {
+  %0 = "stablehlo.dynamic_update_slice"(%target, %update, %c0, %c0)
+    : (tensor<?x3xf32>, tensor<?x2xf32>, tensor<i32>, tensor<i32>) -> tensor<?x3xf32>
+  func.return %0 : tensor<?x3xf32>
+}
+// CHECK-DAG:     %[[C0:.*]] = arith.constant 0 : index
+// CHECK-DAG:     %[[C1:.*]] = arith.constant 1 : index
+// CHECK:         %[[SIZE:.*]] = tensor.dim %[[ARG1]], %[[C0]] : tensor<?x2xf32>
+// CHECK:         %[[EXTRACT1:.*]] = tensor.extract %[[ARG2]][] : tensor<i32>
+// CHECK:         %[[SCALAR1:.*]] = arith.index_cast %[[EXTRACT1]]
+// CHECK:         %[[DIM:.*]] = tensor.dim %[[ARG0]], %[[C0]] : tensor<?x3xf32>
+// CHECK:         %[[UB:.*]] = arith.subi %[[DIM]], %[[SIZE]] : index
+// CHECK:         %[[T1:.*]] = arith.maxsi %[[SCALAR1]], %[[C0]] : index
+// CHECK:         %[[CLAMPED1:.*]] = arith.minsi %[[T1]], %[[UB]] : index
+// CHECK:         %[[CLAMPED2:.*]] = arith.minsi %{{.*}}, %[[C1]] : index
+// CHECK:         %[[RES:.*]] = tensor.insert_slice %[[ARG1]] into %[[ARG0]]
+// CHECK-SAME:      [%[[CLAMPED1]], %[[CLAMPED2]]] [%[[SIZE]], 2] [1, 1]
+// CHECK-SAME:    : tensor<?x2xf32> into tensor<?x3xf32>
+// CHECK:         return %[[RES]] : tensor<?x3xf32>
+
+// -----
+
 // CHECK-DAG: #[[OPERAND_MAP:.*]] = affine_map<(d0, d1, d2, d3) -> (d1, d0, d3, d2)>
 // CHECK-DAG: #[[RESULT_MAP:.*]] = affine_map<(d0, d1, d2, d3) -> (d0, d1, d2, d3)>
 // CHECK: func @transpose
@@ -0,0 +1,81 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg="enable-elementwise-fusion=true" --split-input-file --canonicalize | FileCheck %s
+
+// CHECK: #[[MAP:.*]] = affine_map<(d0, d1) -> (d0, d1)>
+// CHECK-LABEL: func @fused_chain
+// CHECK-SAME:    (%[[ARG0:.*]]: tensor<2x?xf32>, %[[ARG1:.*]]: tensor<2x?xf32>)
+func.func @fused_chain(%arg0: tensor<2x?xf32>, %arg1: tensor<2x?xf32>)
+    -> tensor<2x?xf32> {
+  // CHECK:      %[[C1:.*]] = arith.constant 1 : index
+  // CHECK:      %[[DIM:.*]] = tensor.dim %[[ARG0]], %[[C1]]
+  // CHECK:      %[[EMPTY:.*]] = tensor.empty(%[[DIM]]) : tensor<2x?xf32>
+  // CHECK:      %[[RESULT:.*]] = linalg.generic
+  // CHECK-SAME:   indexing_maps = [#[[MAP]], #[[MAP]], #[[MAP]]]
+  // CHECK-SAME:   ins(%[[ARG0]], %[[ARG1]] : tensor<2x?xf32>, tensor<2x?xf32>)
+  // CHECK-SAME:   outs(%[[EMPTY]] : tensor<2x?xf32>)
+  // CHECK-NEXT: ^bb0(%[[LHS:.*]]: f32, %[[RHS:.*]]: f32, %{{.*}}: f32):
+  // CHECK-NEXT:   %[[ADD:.*]] = arith.addf %[[LHS]], %[[RHS]] : f32
+  // CHECK-NEXT:   %[[MUL:.*]] = arith.mulf %[[ADD]], %[[LHS]] : f32
+  // CHECK-NEXT:   %[[EXP:.*]] = math.exp %[[MUL]] : f32
+  // CHECK-NEXT:   linalg.yield %[[EXP]] : f32
+  // CHECK-NOT:  linalg.generic
+  // CHECK:      return %[[RESULT]]
+  %0 = stablehlo.add %arg0, %arg1 : tensor<2x?xf32>
+  %1 = stablehlo.multiply %0, %arg0 : tensor<2x?xf32>
+  %2 = stablehlo.exponential %1 : tensor<2x?xf32>
+  func.return %2 : tensor<2x?xf32>
+}
+
+// -----
+
+// CHECK-DAG: #[[ID:.*]] = affine_map<(d0, d1) -> (d0, d1)>
+// CHECK-DAG: #[[ROW:.*]] = affine_map<(d0, d1) -> (d1)>
+// CHECK-DAG: #[[EXPAND:.*]] = affine_map<(d0, d1) -> (d0, 0)>
+// CHECK-LABEL: func @fused_broadcasts
+// CHECK-SAME:    (%[[ARG0:.*]]: tensor<4x3xf32>, %[[ARG1:.*]]: tensor<3xf32>, %[[ARG2:.*]]: tensor<4x1xf32>)
+func.func @fused_broadcasts(%arg0: tensor<4x3xf32>, %arg1: tensor<3xf32>,
+                            %arg2: tensor<4x1xf32>) -> tensor<4x3xf32> {
+  // CHECK:      linalg.generic
+  // CHECK-SAME:   indexing_maps = [#[[ID]], #[[ROW]], #[[EXPAND]], #[[ID]]]
+  // CHECK-SAME:   ins(%[[ARG0]], %[[ARG1]], %[[ARG2]] : tensor<4x3xf32>, tensor<3xf32>, tensor<4x1xf32>)
+  // CHECK:        arith.addf
+  // CHECK:        arith.mulf
+  // CHECK-NOT:  linalg.generic
+  %0 = stablehlo.broadcast_in_dim %arg1, dims = [1] : (tensor<3xf32>) -> tensor<4x3xf32>
+  %1 = stablehlo.broadcast_in_dim %arg2, dims = [0, 1] : (tensor<4x1xf32>) -> tensor<4x3xf32>
+  %2 = stablehlo.add %arg0, %0 : tensor<4x3xf32>
+  %3 = stablehlo.multiply %2, %1 : tensor<4x3xf32>
+  func.return %3 : tensor<4x3xf32>
+}
+
+// -----
+
+// Results with several uses are computed once by their own linalg.generic.
+
+// CHECK-LABEL: func @multiple_uses
+func.func @multiple_uses(%arg0: tensor<4xf32>, %arg1: tensor<4xf32>)
+    -> (tensor<4xf32>, tensor<4xf32>) {
+  // CHECK:      %[[ADD:.*]] = linalg.generic
+  // CHECK:        arith.addf
+  // CHECK:      linalg.generic
+  // CHECK-SAME:   ins(%[[ADD]]
+  // CHECK:        math.exp
+  // CHECK:        arith.negf
+  %0 = stablehlo.add %arg0, %arg1 : tensor<4xf32>
+  %1 = stablehlo.exponential %0 : tensor<4xf32>
+  %2 = stablehlo.negate %1 : tensor<4xf32>
+  func.return %0, %2 : tensor<4xf32>, tensor<4xf32>
+}
+
+// -----
+
+// Unsigned types are converted, so these ops aren't fused.
+
+// CHECK-LABEL: func @unsigned_not_fused
+func.func @unsigned_not_fused(%arg0: tensor<4xui32>, %arg1: tensor<4xui32>)
+    -> tensor<4xui32> {
+  // CHECK: linalg.generic
+  // CHECK: linalg.generic
+  %0 = stablehlo.add %arg0, %arg1 : tensor<4xui32>
+  %1 = stablehlo.multiply %0, %arg1 : tensor<4xui32>
+  func.return %1 : tensor<4xui32>
+}
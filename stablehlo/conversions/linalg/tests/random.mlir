@@ -229,17 +229,11 @@ func.func @three_fry_i32(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<8xi32>)
 // CHECK-SAME: iterator_types = ["parallel"]}
 // CHECK-SAME: outs(%[[DEST0]], %[[DEST1]] : tensor<4xi32>, tensor<4xi32>)
 
-// CHECK: %expanded = tensor.expand_shape %[[GENERIC]]#0
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi32> into tensor<4x1xi32>
-
-// CHECK: %expanded_1 = tensor.expand_shape %[[GENERIC]]#1
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi32> into tensor<4x1xi32>
-
 // CHECK: %[[EMPTY:.+]] = tensor.empty() : tensor<4x2xi32>
-// CHECK: %[[CONCAT:.+]] = linalg.generic
+// CHECK: %[[INTERLEAVE:.+]] = linalg.generic
 // CHECK-SAME: outs(%[[EMPTY]] : tensor<4x2xi32>)
 
-// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[CONCAT]]
+// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[INTERLEAVE]]
 // CHECK-SAME{literal}: [[0, 1]] : tensor<4x2xi32> into tensor<8xi32>
 // CHECK: %[[INSERTED:.+]] = tensor.insert %[[NEWSTATE]] into %[[ARG0]][%[[C1]]] : tensor<2xi64>
 
@@ -269,17 +263,22 @@ func.func @three_fry_odd_i32(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<7x1
 // CHECK-SAME: iterator_types = ["parallel"]}
 // CHECK-SAME: outs(%[[DEST0]], %[[DEST1]] : tensor<42xi32>, tensor<42xi32>)
 
-// CHECK: %expanded = tensor.expand_shape %[[GENERIC]]#0
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi32> into tensor<7x6x1xi32>
+// CHECK: %[[LANE0:.+]] = tensor.expand_shape %[[GENERIC]]#0
+// CHECK-SAME{literal}: [[0, 1]] : tensor<42xi32> into tensor<7x6xi32>
 
-// CHECK: %expanded_1 = tensor.expand_shape %[[GENERIC]]#1
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi32> into tensor<7x6x1xi32>
+// CHECK: %[[LANE1:.+]] = tensor.expand_shape %[[GENERIC]]#1
+// CHECK-SAME{literal}: [[0, 1]] : tensor<42xi32> into tensor<7x6xi32>
 
 // CHECK: %[[EMPTY:.+]] = tensor.empty() : tensor<7x6x2xi32>
-// CHECK: %[[CONCAT:.+]] = linalg.generic
+// CHECK: %[[INTERLEAVE:.+]] = linalg.generic
+// CHECK-SAME: ins(%[[LANE0]], %[[LANE1]] : tensor<7x6xi32>, tensor<7x6xi32>)
 // CHECK-SAME: outs(%[[EMPTY]] : tensor<7x6x2xi32>)
+// CHECK:   %[[LANE:.+]] = linalg.index 2 : index
+// CHECK:   %[[IS_LANE0:.+]] = arith.cmpi eq, %[[LANE]], %[[C0]] : index
+// CHECK:   %[[SELECT:.+]] = arith.select %[[IS_LANE0]]
+// CHECK:   linalg.yield %[[SELECT]] : i32
 
-// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %10
+// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[INTERLEAVE]]
 // CHECK-SAME{literal}: [[0], [1, 2]] : tensor<7x6x2xi32> into tensor<7x12xi32>
 
 // CHECK: %[[SLICE:.+]] = tensor.extract_slice %[[COLLAPSE]][0, 0] [7, 11] [1, 1]
@@ -309,17 +308,11 @@ func.func @three_fry_i16(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<8xi16>)
 // CHECK-SAME: iterator_types = ["parallel"]}
 // CHECK-SAME: outs(%[[DEST0]], %[[DEST1]] : tensor<4xi16>, tensor<4xi16>)
 
-// CHECK: %expanded = tensor.expand_shape %[[GENERIC]]#0
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi16> into tensor<4x1xi16>
-
-// CHECK: %expanded_1 = tensor.expand_shape %[[GENERIC]]#1
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi16> into tensor<4x1xi16>
-
 // CHECK: %[[EMPTY:.+]] = tensor.empty() : tensor<4x2xi16>
-// CHECK: %[[CONCAT:.+]] = linalg.generic
+// CHECK: %[[INTERLEAVE:.+]] = linalg.generic
 // CHECK-SAME: outs(%[[EMPTY]] : tensor<4x2xi16>)
 
-// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[CONCAT]]
+// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[INTERLEAVE]]
 // CHECK-SAME{literal}: [[0, 1]] : tensor<4x2xi16> into tensor<8xi16>
 // CHECK: %[[INSERTED:.+]] = tensor.insert %[[NEWSTATE]] into %[[ARG0]][%[[C1]]] : tensor<2xi64>
 
@@ -348,17 +341,11 @@ func.func @three_fry_i8(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<8xi8>) {
 // CHECK-SAME: iterator_types = ["parallel"]}
 // CHECK-SAME: outs(%[[DEST0]], %[[DEST1]] : tensor<4xi8>, tensor<4xi8>)
 
-// CHECK: %expanded = tensor.expand_shape %[[GENERIC]]#0
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi8> into tensor<4x1xi8>
-
-// CHECK: %expanded_1 = tensor.expand_shape %[[GENERIC]]#1
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi8> into tensor<4x1xi8>
-
 // CHECK: %[[EMPTY:.+]] = tensor.empty() : tensor<4x2xi8>
-// CHECK: %[[CONCAT:.+]] = linalg.generic
+// CHECK: %[[INTERLEAVE:.+]] = linalg.generic
 // CHECK-SAME: outs(%[[EMPTY]] : tensor<4x2xi8>)
 
-// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[CONCAT]]
+// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[INTERLEAVE]]
 // CHECK-SAME{literal}: [[0, 1]] : tensor<4x2xi8> into tensor<8xi8>
 // CHECK: %[[INSERTED:.+]] = tensor.insert %[[NEWSTATE]] into %[[ARG0]][%[[C1]]] : tensor<2xi64>
 
@@ -480,9 +467,8 @@ func.func @philox_i64(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<8xi64>) {
 // CHECK-DAG:   %[[VAL_101:.*]] = arith.xori %[[VAL_100]], %[[VAL_87]] : i32
 
 // CHECK: linalg.yield %[[YIELDED_1:.*]], %[[YIELDED_2:.*]] : i64, i64
-// CHECK-DAG: %[[VAL_206:.*]] = tensor.expand_shape %[[VAL_207:.*]]#0 {{\[\[}}0, 1]]
-// CHECK-DAG: %[[VAL_208:.*]] = tensor.expand_shape %[[VAL_207]]#1 {{\[\[}}0, 1]]
 // CHECK-DAG: %[[VAL_209:.*]] = tensor.empty() : tensor<4x2xi64>
+// CHECK-DAG: %[[VAL_210:.*]] = linalg.generic {{.*}} ins(%[[VAL_207:.*]]#0, %[[VAL_207]]#1 : tensor<4xi64>, tensor<4xi64>) outs(%[[VAL_209]] : tensor<4x2xi64>)
 // CHECK-DAG: %[[VAL_213:.*]] = tensor.insert %[[VAL_30]] into %[[VAL_0]]{{\[}}%[[VAL_19]]] : tensor<2xi64>
 
 // CHECK: return %[[VAL_213]], %[[GENERIC:.*]] : tensor<2xi64>, tensor<8xi64>
@@ -515,9 +501,9 @@ func.func @philox_i32(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<8xi32>) {
 // CHECK-SAME: iterator_types = ["parallel"]}
 // CHECK-SAME: outs(%[[DEST0]], %[[DEST1]], %[[DEST2]], %[[DEST3]] : tensor<2xi32>, tensor<2xi32>, tensor<2xi32>, tensor<2xi32>)
 
-// CHECK: %[[CONCAT:.+]] = linalg.generic
+// CHECK: %[[INTERLEAVE:.+]] = linalg.generic
 
-// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[CONCAT]]
+// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[INTERLEAVE]]
 // CHECK-SAME{literal}: [[0, 1]] : tensor<2x4xi32> into tensor<8xi32>
 // CHECK: %[[INSERTED:.+]] = tensor.insert %[[NEWSTATE]] into %[[ARG0]][%[[C1]]] : tensor<2xi64>
 
@@ -561,24 +547,14 @@ func.func @philox_i32_odd(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<7x11xi
 // CHECK-SAME: outs(%[[DEST0]], %[[DEST1]], %[[DEST2]], %[[DEST3]] : tensor<20xi32>, tensor<20xi32>, tensor<20xi32>, tensor<20xi32>)
 
 
-// CHECK: %expanded = tensor.expand_shape %[[GENERIC]]#0
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi32> into tensor<4x1xi32>
-
-// CHECK: %expanded_1 = tensor.expand_shape %[[GENERIC]]#1
-// CHECK-SAME{literal}: [[0, 1]] : tensor<4xi32> into tensor<4x1xi32>
-
-
 // CHECK: %[[EMPTY:.+]] = tensor.empty() : tensor<20x4xi32>
-// CHECK: %[[CONCAT:.+]] = linalg.generic
+// CHECK: %[[INTERLEAVE:.+]] = linalg.generic
 // CHECK-SAME: outs(%[[EMPTY]] : tensor<20x4xi32>)
 
-// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[CONCAT]]
-
-
-// CHECK: %[[VAL_213:.*]] = tensor.expand_shape %[[COLLAPSE]] {{\[\[}}0, 1]]
-// CHECK: %[[VAL_214:.*]] = tensor.extract_slice %[[VAL_213]][0, 0] [77, 1] [1, 1] : tensor<80x1xi32> to tensor<77x1xi32>
-// CHECK: %[[VAL_215:.*]] = tensor.collapse_shape %[[VAL_214]] {{\[\[}}0, 1]] : tensor<77x1xi32> into tensor<77xi32>
-// CHECK: %[[VAL_216:.*]] = tensor.expand_shape %[[VAL_215]] {{\[\[}}0, 1]]
+// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[INTERLEAVE]]
+// CHECK-SAME{literal}: [[0, 1]] : tensor<20x4xi32> into tensor<80xi32>
+// CHECK: %[[VAL_214:.*]] = tensor.extract_slice %[[COLLAPSE]][0] [77] [1] : tensor<80xi32> to tensor<77xi32>
+// CHECK: %[[VAL_216:.*]] = tensor.expand_shape %[[VAL_214]] {{\[\[}}0, 1]]
 // CHECK: %[[VAL_217:.*]] = tensor.insert %[[NEWSTATE]] into %[[ARG0]]{{\[}}%[[C1]]] : tensor<2xi64>
 // CHECK: return %[[VAL_217]], %[[VAL_216]] : tensor<2xi64>, tensor<7x11xi32>
 
@@ -610,16 +586,14 @@ func.func @philox_i64_odd(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<3x5xi6
 // CHECK-SAME: outs(%[[DEST2]], %[[DEST3]] : tensor<8xi64>, tensor<8xi64>)
 
 // CHECK: %[[EMPTY:.+]] = tensor.empty() : tensor<8x2xi64>
-// CHECK: %[[CONCAT:.+]] = linalg.generic
+// CHECK: %[[INTERLEAVE:.+]] = linalg.generic
 // CHECK-SAME: outs(%[[EMPTY]] : tensor<8x2xi64>)
 
-// CHECK-DAG: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[CONCAT]] {{\[\[}}0, 1]] : tensor<8x2xi64> into tensor<16xi64>
+// CHECK-DAG: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[INTERLEAVE]] {{\[\[}}0, 1]] : tensor<8x2xi64> into tensor<16xi64>
 
 
-// CHECK-DAG: %[[EXPANDED:.*]] = tensor.expand_shape %[[COLLAPSE]] {{\[\[}}0, 1]]
-// CHECK-DAG: %[[SLICE:.*]] = tensor.extract_slice %[[EXPANDED]][0, 0] [15, 1] [1, 1] : tensor<16x1xi64> to tensor<15x1xi64>
-// CHECK-DAG: %[[EXPAND_2:.*]] = tensor.collapse_shape %[[SLICE]] {{\[\[}}0, 1]] : tensor<15x1xi64> into tensor<15xi64>
-// CHECK-DAG: %[[RESHAPE:.*]] = tensor.expand_shape %[[EXPAND_2]] {{\[\[}}0, 1]]
+// CHECK-DAG: %[[SLICE:.*]] = tensor.extract_slice %[[COLLAPSE]][0] [15] [1] : tensor<16xi64> to tensor<15xi64>
+// CHECK-DAG: %[[RESHAPE:.*]] = tensor.expand_shape %[[SLICE]] {{\[\[}}0, 1]]
 // CHECK-DAG: %[[INSERTED:.+]] = tensor.insert %[[NEWSTATE]] into %[[ARG0]][%[[C1]]] : tensor<2xi64>
 // CHECK: return %[[INSERTED]], %[[RESHAPE]]
 
@@ -651,10 +625,10 @@ func.func @philox_i16(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<8xi16>) {
 // CHECK-SAME: outs(%[[DEST0]], %[[DEST1]], %[[DEST2]], %[[DEST3]] : tensor<2xi16>, tensor<2xi16>, tensor<2xi16>, tensor<2xi16>)
 
 // CHECK: %[[EMPTY:.+]] = tensor.empty() : tensor<2x4xi16>
-// CHECK: %[[CONCAT:.+]] = linalg.generic
+// CHECK: %[[INTERLEAVE:.+]] = linalg.generic
 // CHECK-SAME: outs(%[[EMPTY]] : tensor<2x4xi16>)
 
-// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[CONCAT]]
+// CHECK: %[[COLLAPSE:.+]] = tensor.collapse_shape %[[INTERLEAVE]]
 // CHECK-SAME{literal}: [[0, 1]] : tensor<2x4xi16> into tensor<8xi16>
 // CHECK: %[[INSERTED:.+]] = tensor.insert %[[NEWSTATE]] into %[[ARG0]][%[[C1]]] : tensor<2xi64>
 
@@ -688,5 +662,5 @@ func.func @philox_i8(%arg0: tensor<2xi64>) -> (tensor<2xi64>, tensor<8xi8>) {
 // CHECK-SAME: outs(%[[DEST0]], %[[DEST1]], %[[DEST2]], %[[DEST3]] : tensor<2xi8>, tensor<2xi8>, tensor<2xi8>, tensor<2xi8>)
 
 // CHECK: %[[EMPTY:.+]] = tensor.empty() : tensor<2x4xi8>
-// CHECK: %[[CONCAT:.+]] = linalg.generic
+// CHECK: %[[INTERLEAVE:.+]] = linalg.generic
 // CHECK-SAME: outs(%[[EMPTY]] : tensor<2x4xi8>)
@@ -0,0 +1,34 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg="split-reduction-ratio=8" --split-input-file --canonicalize | FileCheck %s
+
+// CHECK-LABEL: func @reduce_sum
+// CHECK-SAME:    (%[[ARG0:.*]]: tensor<1024xf32>, %[[ARG1:.*]]: tensor<f32>)
+func.func @reduce_sum(%arg0: tensor<1024xf32>, %arg1: tensor<f32>) -> tensor<f32> {
+  // CHECK:      %[[EXPANDED:.*]] = tensor.expand_shape %[[ARG0]] {{\[}}[0, 1]]
+  // CHECK-SAME:   tensor<1024xf32> into tensor<8x128xf32>
+  // CHECK:      %[[PARTIAL:.*]] = linalg.generic
+  // CHECK-SAME:   iterator_types = ["parallel", "reduction"]
+  // CHECK-SAME:   ins(%[[EXPANDED]] : tensor<8x128xf32>)
+  // CHECK-SAME:   -> tensor<8xf32>
+  // CHECK:      linalg.generic
+  // CHECK-SAME:   iterator_types = ["reduction"]
+  // CHECK-SAME:   ins(%[[PARTIAL]] : tensor<8xf32>)
+  // CHECK:        arith.addf
+  %0 = stablehlo.reduce(%arg0 init: %arg1) applies stablehlo.add across dimensions = [0]
+       : (tensor<1024xf32>, tensor<f32>) -> tensor<f32>
+  func.return %0 : tensor<f32>
+}
+
+// -----
+
+// Reductions whose size isn't a multiple of the ratio aren't split.
+
+// CHECK-LABEL: func @reduce_sum_indivisible
+func.func @reduce_sum_indivisible(%arg0: tensor<1023xf32>, %arg1: tensor<f32>) -> tensor<f32> {
+  // CHECK-NOT:  tensor.expand_shape
+  // CHECK:      linalg.generic
+  // CHECK-SAME:   iterator_types = ["reduction"]
+  // CHECK-NOT:  linalg.generic
+  %0 = stablehlo.reduce(%arg0 init: %arg1) applies stablehlo.add across dimensions = [0]
+       : (tensor<1023xf32>, tensor<f32>) -> tensor<f32>
+  func.return %0 : tensor<f32>
+}
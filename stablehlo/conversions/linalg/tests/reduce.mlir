@@ -810,3 +810,62 @@ func.func @reduce_window_generic_scalar(%arg0: tensor<f32>, %arg1: tensor<f32>)
   func.return %0 : tensor<f32>
 }
 // CHECK: linalg.generic {indexing_maps = [#[[MAP]], #[[MAP]], #[[MAP]]]
+
+// -----
+
+// CHECK-LABEL: func @reduce_window_cumsum
+// CHECK-SAME:    %[[ARG0:[a-zA-Z0-9_]*]]
+// CHECK-PRIMITIVE-LABEL: func @reduce_window_cumsum
+func.func @reduce_window_cumsum(%arg0: tensor<4x128xf32>) -> tensor<4x128xf32> {
+  %0 = stablehlo.constant dense<0.0> : tensor<f32>
+  %1 = "stablehlo.reduce_window"(%arg0, %0) ({
+  ^bb0(%arg1: tensor<f32>, %arg2: tensor<f32>):
+    %2 = stablehlo.add %arg1, %arg2 : tensor<f32>
+    stablehlo.return %2 : tensor<f32>
+  }) {
+    padding = dense<[[0, 0], [127, 0]]> : tensor<2x2xi64>,
+    window_dimensions = array<i64: 1, 128>
+  } : (tensor<4x128xf32>, tensor<f32>) -> tensor<4x128xf32>
+  func.return %1 : tensor<4x128xf32>
+}
+// CHECK-DAG:  %[[C0:.+]] = arith.constant 0 : index
+// CHECK-DAG:  %[[C1:.+]] = arith.constant 1 : index
+// CHECK-DAG:  %[[C128:.+]] = arith.constant 128 : index
+// CHECK:      %[[SUM:.+]] = linalg.fill {{.*}} -> tensor<4xf32>
+// CHECK:      %[[INIT:.+]] = tensor.empty() : tensor<4x128xf32>
+// CHECK:      %[[LOOP:.+]]:2 = scf.for %[[IV:.+]] = %[[C0]] to %[[C128]] step %[[C1]]
+// CHECK-SAME:     iter_args(%[[ACC:.+]] = %[[SUM]], %[[OUT:.+]] = %[[INIT]])
+// CHECK:        %[[SLICE:.+]] = tensor.extract_slice %[[ARG0]][0, %[[IV]]] [4, 1] [1, 1] : tensor<4x128xf32> to tensor<4xf32>
+// CHECK:        %[[NEW:.+]] = linalg.generic
+// CHECK-SAME:     ins(%[[SLICE]] : tensor<4xf32>) outs(%[[ACC]] : tensor<4xf32>)
+// CHECK:          arith.addf
+// CHECK:        %[[INSERTED:.+]] = tensor.insert_slice %[[NEW]] into %[[OUT]][0, %[[IV]]] [4, 1] [1, 1]
+// CHECK:        scf.yield %[[NEW]], %[[INSERTED]]
+// CHECK:      return %[[LOOP]]#1
+
+// CHECK-PRIMITIVE: scf.for
+
+// -----
+
+// Reverse cumulative sums scan from the end.
+
+// CHECK-LABEL: func @reduce_window_reverse_cumsum
+// CHECK-PRIMITIVE-LABEL: func @reduce_window_reverse_cumsum
+func.func @reduce_window_reverse_cumsum(%arg0: tensor<16xi32>) -> tensor<16xi32> {
+  %0 = stablehlo.constant dense<0> : tensor<i32>
+  %1 = "stablehlo.reduce_window"(%arg0, %0) ({
+  ^bb0(%arg1: tensor<i32>, %arg2: tensor<i32>):
+    %2 = stablehlo.add %arg1, %arg2 : tensor<i32>
+    stablehlo.return %2 : tensor<i32>
+  }) {
+    padding = dense<[[0, 15]]> : tensor<1x2xi64>,
+    window_dimensions = array<i64: 16>
+  } : (tensor<16xi32>, tensor<i32>) -> tensor<16xi32>
+  func.return %1 : tensor<16xi32>
+}
+// CHECK:      scf.for %[[IV:.+]] =
+// CHECK:        %[[INDEX:.+]] = arith.subi %{{.+}}, %[[IV]]
+// CHECK:        tensor.extract_slice %{{.+}}[%[[INDEX]]] [1] [1] : tensor<16xi32> to tensor<i32>
+// CHECK:        arith.addi
+
+// CHECK-PRIMITIVE: scf.for
@@ -0,0 +1,75 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg --split-input-file --canonicalize | FileCheck %s
+
+// CHECK-LABEL: func @scatter_rows
+// CHECK-SAME:    %[[INPUT:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[INDICES:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[UPDATES:[a-zA-Z0-9_]*]]
+func.func @scatter_rows(%input: tensor<10x4xf32>, %indices: tensor<3x1xi32>, %updates: tensor<3x4xf32>) -> tensor<10x4xf32> {
+  %0 = "stablehlo.scatter"(%input, %indices, %updates) ({
+  ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+    stablehlo.return %rhs : tensor<f32>
+  }) {
+    scatter_dimension_numbers = #stablehlo.scatter<
+      update_window_dims = [1],
+      inserted_window_dims = [0],
+      scatter_dims_to_operand_dims = [0],
+      index_vector_dim = 1
+    >,
+    indices_are_sorted = false,
+    unique_indices = false
+  } : (tensor<10x4xf32>, tensor<3x1xi32>, tensor<3x4xf32>) -> tensor<10x4xf32>
+  func.return %0 : tensor<10x4xf32>
+}
+// CHECK-DAG:   %[[C0:.+]] = arith.constant 0 : index
+// CHECK-DAG:   %[[C1:.+]] = arith.constant 1 : index
+// CHECK-DAG:   %[[C3:.+]] = arith.constant 3 : index
+// CHECK-DAG:   %[[C6:.+]] = arith.constant 6 : index
+// CHECK:       %[[RESULT:.+]] = scf.for %[[I:.+]] = %[[C0]] to %[[C3]] step %[[C1]] iter_args(%[[ACC:.+]] = %[[INPUT]]) -> (tensor<10x4xf32>)
+// CHECK:         %[[INDEX:.+]] = tensor.extract %[[INDICES]][%[[I]], %[[C0]]] : tensor<3x1xi32>
+// CHECK:         %[[START:.+]] = arith.index_cast %[[INDEX]] : i32 to index
+// CHECK:         %[[ABOVE:.+]] = arith.cmpi sge, %[[START]], %[[C0]] : index
+// CHECK:         %[[BELOW:.+]] = arith.cmpi sle, %[[START]], %[[C6]] : index
+// CHECK:         %[[IN_BOUNDS:.+]] = arith.andi %[[ABOVE]], %[[BELOW]] : i1
+// CHECK:         %[[UPDATED:.+]] = scf.if %[[IN_BOUNDS]] -> (tensor<10x4xf32>)
+// CHECK:           %[[WINDOW:.+]] = tensor.extract_slice %[[UPDATES]][%[[I]], 0] [1, 4] [1, 1] : tensor<3x4xf32> to tensor<4xf32>
+// CHECK:           %[[INSERTED:.+]] = tensor.insert_slice %[[WINDOW]] into %[[ACC]][%[[START]], 0] [1, 4] [1, 1] : tensor<4xf32> into tensor<10x4xf32>
+// CHECK:           scf.yield %[[INSERTED]]
+// CHECK:         else
+// CHECK:           scf.yield %[[ACC]]
+// CHECK:         scf.yield %[[UPDATED]]
+// CHECK:       return %[[RESULT]]
+
+// -----
+
+// CHECK-LABEL: func @scatter_add
+// CHECK-SAME:    %[[INPUT:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[INDICES:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[UPDATES:[a-zA-Z0-9_]*]]
+func.func @scatter_add(%input: tensor<8xf32>, %indices: tensor<5x1xi32>, %updates: tensor<5xf32>) -> tensor<8xf32> {
+  %0 = "stablehlo.scatter"(%input, %indices, %updates) ({
+  ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+    %1 = stablehlo.add %lhs, %rhs : tensor<f32>
+    stablehlo.return %1 : tensor<f32>
+  }) {
+    scatter_dimension_numbers = #stablehlo.scatter<
+      update_window_dims = [],
+      inserted_window_dims = [0],
+      scatter_dims_to_operand_dims = [0],
+      index_vector_dim = 1
+    >,
+    indices_are_sorted = false,
+    unique_indices = false
+  } : (tensor<8xf32>, tensor<5x1xi32>, tensor<5xf32>) -> tensor<8xf32>
+  func.return %0 : tensor<8xf32>
+}
+// CHECK:       scf.for %[[I:.+]] = {{.+}} iter_args(%[[ACC:.+]] = %[[INPUT]]) -> (tensor<8xf32>)
+// CHECK:         %[[START:.+]] = arith.index_cast
+// CHECK:         scf.if
+// CHECK:           %[[UPDATE:.+]] = tensor.extract_slice %[[UPDATES]][%[[I]]] [1] [1] : tensor<5xf32> to tensor<f32>
+// CHECK:           %[[CURRENT:.+]] = tensor.extract_slice %[[ACC]][%[[START]]] [1] [1] : tensor<8xf32> to tensor<f32>
+// CHECK:           %[[SUM:.+]] = linalg.generic
+// CHECK-SAME:        ins(%[[UPDATE]] : tensor<f32>) outs(%[[CURRENT]] : tensor<f32>)
+// CHECK:           ^{{.+}}(%[[IN:.+]]: f32, %[[OUT:.+]]: f32):
+// CHECK:             %[[ADD:.+]] = arith.addf %[[OUT]], %[[IN]] : f32
+// CHECK:             linalg.yield %[[ADD]] : f32
+// CHECK:           tensor.insert_slice %[[SUM]] into %[[ACC]][%[[START]]] [1] [1] : tensor<f32> into tensor<8xf32>
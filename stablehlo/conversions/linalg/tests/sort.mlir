@@ -0,0 +1,105 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-linalg --split-input-file | FileCheck %s
+
+// CHECK-DAG:   #[[LO:.+]] = affine_map<(d0, d1, d2, d3) -> (d0, d1, 0, d3)>
+// CHECK-DAG:   #[[HI:.+]] = affine_map<(d0, d1, d2, d3) -> (d0, d1, 1, d3)>
+// CHECK-DAG:   #[[ID:.+]] = affine_map<(d0, d1, d2, d3) -> (d0, d1, d2, d3)>
+
+// CHECK-LABEL: func @sort_bitonic
+// CHECK-SAME:    %[[INPUT:[a-zA-Z0-9_]*]]
+func.func @sort_bitonic(%input: tensor<2x4xf32>) -> tensor<2x4xf32> {
+  %0 = "stablehlo.sort"(%input) ({
+  ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+    %1 = stablehlo.compare LT, %lhs, %rhs, FLOAT : (tensor<f32>, tensor<f32>) -> tensor<i1>
+    stablehlo.return %1 : tensor<i1>
+  }) {dimension = 1 : i64, is_stable = false} : (tensor<2x4xf32>) -> tensor<2x4xf32>
+  func.return %0 : tensor<2x4xf32>
+}
+// CHECK:       %[[PAIRS:.+]] = tensor.expand_shape %[[INPUT]] {{\[}}[0], [1, 2, 3]] {{.*}} : tensor<2x4xf32> into tensor<2x2x2x1xf32>
+// CHECK:       %[[STAGE:.+]] = linalg.generic
+// CHECK-SAME:    indexing_maps = [#[[LO]], #[[HI]], #[[ID]]]
+// CHECK-SAME:    iterator_types = ["parallel", "parallel", "parallel", "parallel"]
+// CHECK-SAME:    ins(%[[PAIRS]], %[[PAIRS]] : tensor<2x2x2x1xf32>, tensor<2x2x2x1xf32>)
+// CHECK-NEXT:  ^{{.+}}(%[[LO_VALUE:.+]]: f32, %[[HI_VALUE:.+]]: f32, %{{.+}}: f32):
+// CHECK:         %[[BLOCK:.+]] = linalg.index 1 : index
+// CHECK:         %[[DIRECTION:.+]] = arith.andi %[[BLOCK]]
+// CHECK:         %[[ASCENDING:.+]] = arith.cmpi eq, %[[DIRECTION]]
+// CHECK:         %[[FIRST:.+]] = arith.select %[[ASCENDING]], %[[HI_VALUE]], %[[LO_VALUE]] : f32
+// CHECK:         %[[SECOND:.+]] = arith.select %[[ASCENDING]], %[[LO_VALUE]], %[[HI_VALUE]] : f32
+// CHECK:         %[[SWAP:.+]] = arith.cmpf olt, %[[FIRST]], %[[SECOND]] : f32
+// CHECK:         %[[HALF:.+]] = linalg.index 2 : index
+// CHECK:         %[[IS_HI:.+]] = arith.cmpi ne, %[[HALF]]
+// CHECK:         %[[TAKE_HI:.+]] = arith.xori %[[SWAP]], %[[IS_HI]] : i1
+// CHECK:         %[[RESULT:.+]] = arith.select %[[TAKE_HI]], %[[HI_VALUE]], %[[LO_VALUE]] : f32
+// CHECK:         linalg.yield %[[RESULT]] : f32
+// CHECK:       tensor.collapse_shape %[[STAGE]] {{\[}}[0], [1, 2, 3]] : tensor<2x2x2x1xf32> into tensor<2x4xf32>
+// CHECK:       tensor.expand_shape {{.*}} into tensor<2x1x2x2xf32>
+// CHECK:       linalg.generic
+// CHECK:       tensor.expand_shape {{.*}} into tensor<2x2x2x1xf32>
+// CHECK:       linalg.generic
+// CHECK:       %[[SORTED:.+]] = tensor.collapse_shape
+// CHECK-NOT:   linalg.generic
+// CHECK:       return %[[SORTED]]
+
+// -----
+
+// CHECK-LABEL: func @sort_stable_merge
+// CHECK-SAME:    %[[KEYS:[a-zA-Z0-9_]*]]
+// CHECK-SAME:    %[[VALUES:[a-zA-Z0-9_]*]]
+func.func @sort_stable_merge(%keys: tensor<3x40xi32>, %values: tensor<3x40xf32>) -> (tensor<3x40xi32>, tensor<3x40xf32>) {
+  %0:2 = "stablehlo.sort"(%keys, %values) ({
+  ^bb0(%lhs: tensor<i32>, %rhs: tensor<i32>, %lhs_value: tensor<f32>, %rhs_value: tensor<f32>):
+    %1 = stablehlo.compare GT, %lhs, %rhs, SIGNED : (tensor<i32>, tensor<i32>) -> tensor<i1>
+    stablehlo.return %1 : tensor<i1>
+  }) {dimension = 1 : i64, is_stable = true} : (tensor<3x40xi32>, tensor<3x40xf32>) -> (tensor<3x40xi32>, tensor<3x40xf32>)
+  func.return %0#0, %0#1 : tensor<3x40xi32>, tensor<3x40xf32>
+}
+// CHECK:       %[[ROWS:.+]]:2 = scf.for %[[I:.+]] = {{.+}} iter_args(%[[KEYS_ACC:.+]] = %[[KEYS]], %[[VALUES_ACC:.+]] = %[[VALUES]])
+// CHECK:         %[[KEY_ROW:.+]] = tensor.extract_slice %[[KEYS_ACC]][%[[I]], 0] [1, 40] [1, 1] : tensor<3x40xi32> to tensor<40xi32>
+// CHECK:         %[[VALUE_ROW:.+]] = tensor.extract_slice %[[VALUES_ACC]][%[[I]], 0] [1, 40] [1, 1] : tensor<3x40xf32> to tensor<40xf32>
+// CHECK:         %[[C16:.+]] = arith.constant 16 : index
+// CHECK:         %[[TILES:.+]]:2 = scf.for {{.+}} step %[[C16]] iter_args({{.+}} = %[[KEY_ROW]], {{.+}} = %[[VALUE_ROW]])
+// CHECK:           scf.for
+// CHECK:             scf.while
+// CHECK:               arith.cmpi sgt, {{.+}} : i32
+// CHECK:               scf.condition
+// CHECK:         %[[PASSES:.+]]:5 = scf.while {{.+}} = %[[C16]], {{.+}} = %[[TILES]]#0, {{.+}} = %[[TILES]]#1
+// CHECK:           scf.condition
+// CHECK:           scf.for
+// CHECK:             scf.for
+// CHECK:               arith.cmpi sgt, {{.+}} : i32
+// CHECK:               arith.select
+// CHECK:         %[[KEYS_SORTED:.+]] = tensor.insert_slice %[[PASSES]]#1 into %[[KEYS_ACC]][%[[I]], 0] [1, 40] [1, 1]
+// CHECK:         %[[VALUES_SORTED:.+]] = tensor.insert_slice %[[PASSES]]#2 into %[[VALUES_ACC]][%[[I]], 0] [1, 40] [1, 1]
+// CHECK:         scf.yield %[[KEYS_SORTED]], %[[VALUES_SORTED]]
+// CHECK:       return %[[ROWS]]#0, %[[ROWS]]#1
+
+// -----
+
+// CHECK-LABEL: func @sort_non_power_of_two
+func.func @sort_non_power_of_two(%input: tensor<6xui32>) -> tensor<6xui32> {
+  %0 = "stablehlo.sort"(%input) ({
+  ^bb0(%lhs: tensor<ui32>, %rhs: tensor<ui32>):
+    %1 = stablehlo.compare LT, %lhs, %rhs, UNSIGNED : (tensor<ui32>, tensor<ui32>) -> tensor<i1>
+    stablehlo.return %1 : tensor<i1>
+  }) {dimension = 0 : i64, is_stable = false} : (tensor<6xui32>) -> tensor<6xui32>
+  func.return %0 : tensor<6xui32>
+}
+// CHECK-NOT:   linalg.generic
+// CHECK:       scf.while
+// CHECK:         arith.cmpi ult, {{.+}} : i32
+// CHECK:       scf.while
+// CHECK:         arith.cmpi ult, {{.+}} : i32
+
+// -----
+
+// CHECK-LABEL: func @sort_with_call
+func.func @sort_with_call(%input: tensor<4xf32>) -> tensor<4xf32> {
+  %0 = "stablehlo.sort"(%input) ({
+  ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+    %1 = func.call @less(%lhs, %rhs) : (tensor<f32>, tensor<f32>) -> tensor<i1>
+    stablehlo.return %1 : tensor<i1>
+  }) {dimension = 0 : i64, is_stable = false} : (tensor<4xf32>) -> tensor<4xf32>
+  func.return %0 : tensor<4xf32>
+}
+func.func private @less(tensor<f32>, tensor<f32>) -> tensor<i1>
+// CHECK:       stablehlo.sort
@@ -16,11 +16,11 @@ func.func @dot_matmul(%arg0: tensor<2x3xf32, #CSR>,
 // CHECK: %[[C1:.*]] = arith.constant 1 : index
 // CHECK: %[[D1:.*]] = tensor.dim %[[ARG1]], %[[C1]] : tensor<3x?xf32, #sparse>
 // CHECK: %[[INIT:.*]] = bufferization.alloc_tensor(%[[D1]]) : tensor<2x?xf32, #sparse>
-// CHECK: %[[FILL:.*]] = linalg.fill ins(%{{.*}}{{.*}}outs(%[[INIT]]
+// CHECK-NOT: linalg.fill
 // CHECK: %[[OUT:.*]] = linalg.matmul
 // CHECK-SAME: {someattr}
 // CHECK-SAME: ins(%[[ARG0]], %[[ARG1]] : tensor<2x3xf32, #sparse>, tensor<3x?xf32, #sparse>)
-// CHECK-SAME: outs(%[[FILL]] : tensor<2x?xf32, #sparse>)
+// CHECK-SAME: outs(%[[INIT]] : tensor<2x?xf32, #sparse>)
 // CHECK: %[[RETURN:.*]] = sparse_tensor.convert %[[OUT]] : tensor<2x?xf32, #sparse> to tensor<2x?xf32>
 // CHECK: %[[RETURN]]
 
@@ -493,3 +493,93 @@ func.func @imag_real(%arg0: tensor<?xf32, #SV>) -> tensor<?xf32, #SV> {
   // CHECK: yield %[[CST]]
   func.return %1 : tensor<?xf32, #SV>
 }
+
+// -----
+
+#CSR = #sparse_tensor.encoding<{
+  map = (d0, d1) -> (d0 : dense, d1 : compressed)
+}>
+
+// CHECK-LABEL: func @dot_general_spmv
+// CHECK-SAME:    (%[[ARG0:.*]]: tensor<4x8xf32, #sparse>, %[[ARG1:.*]]: tensor<8xf32>)
+func.func @dot_general_spmv(%arg0: tensor<4x8xf32, #CSR>,
+                            %arg1: tensor<8xf32>) -> tensor<4xf32> {
+  %0 = "stablehlo.dot_general"(%arg0, %arg1) {
+    dot_dimension_numbers = #stablehlo.dot<
+      lhs_contracting_dimensions = [1],
+      rhs_contracting_dimensions = [0]
+    >
+  } : (tensor<4x8xf32, #CSR>, tensor<8xf32>) -> tensor<4xf32>
+  func.return %0 : tensor<4xf32>
+}
+// CHECK: %[[INIT:.*]] = tensor.empty() : tensor<4xf32>
+// CHECK: %[[FILL:.*]] = linalg.fill ins(%{{.*}}{{.*}}outs(%[[INIT]]
+// CHECK: %[[OUT:.*]] = linalg.matvec
+// CHECK-SAME: ins(%[[ARG0]], %[[ARG1]] : tensor<4x8xf32, #sparse>, tensor<8xf32>)
+// CHECK-SAME: outs(%[[FILL]] : tensor<4xf32>)
+// CHECK: return %[[OUT]]
+
+// -----
+
+#CSR = #sparse_tensor.encoding<{
+  map = (d0, d1) -> (d0 : dense, d1 : compressed)
+}>
+
+#SV = #sparse_tensor.encoding<{
+  map = (d0) -> (d0 : compressed)
+}>
+
+// CHECK-LABEL: func @reduce_add_sparse_result
+// CHECK-SAME:    (%[[ARG0:.*]]: tensor<5x4xf32, #sparse>
+func.func @reduce_add_sparse_result(%arg0: tensor<5x4xf32, #CSR>) -> tensor<5xf32, #SV> {
+  %init = stablehlo.constant dense<0.0> : tensor<f32>
+  %0 = "stablehlo.reduce"(%arg0, %init) ({
+  ^bb0(%arg3: tensor<f32>, %arg4 : tensor<f32>):
+    %1 = stablehlo.add %arg3, %arg4 : tensor<f32>
+    "stablehlo.return"(%1) : (tensor<f32>) -> ()
+  }) {dimensions = array<i64: 1>} : (tensor<5x4xf32, #CSR>, tensor<f32>) -> tensor<5xf32, #SV>
+  func.return %0 : tensor<5xf32, #SV>
+}
+// CHECK: %[[INIT:.*]] = bufferization.alloc_tensor() : tensor<5xf32, #sparse{{[0-9]*}}>
+// CHECK-NOT: linalg.fill
+// CHECK: %[[OUT:.*]] = linalg.generic
+// CHECK-SAME: iterator_types = ["parallel", "reduction"]
+// CHECK-SAME: ins(%[[ARG0]] : tensor<5x4xf32, #sparse>)
+// CHECK-SAME: outs(%[[INIT]] : tensor<5xf32, #sparse{{[0-9]*}}>)
+// CHECK: arith.addf
+// CHECK: return %[[OUT]]
+
+// -----
+
+#CSR = #sparse_tensor.encoding<{
+  map = (d0, d1) -> (d0 : dense, d1 : compressed)
+}>
+
+// CHECK-LABEL: func @float_max
+// CHECK-SAME:    (%[[LHS:.*]]: tensor<2x2xf32, #sparse>, %[[RHS:.*]]: tensor<2x2xf32, #sparse>)
+func.func @float_max(%lhs: tensor<2x2xf32, #CSR>,
+                     %rhs: tensor<2x2xf32, #CSR>) -> tensor<2x2xf32, #CSR> {
+  %0 = "stablehlo.maximum"(%lhs, %rhs)
+      : (tensor<2x2xf32, #CSR>, tensor<2x2xf32, #CSR>) -> tensor<2x2xf32, #CSR>
+  func.return %0 : tensor<2x2xf32, #CSR>
+}
+// CHECK: %[[INIT:.*]] = bufferization.alloc_tensor() : tensor<2x2xf32, #sparse>
+// CHECK: %[[OUT:.*]] = linalg.generic
+// CHECK-SAME: ins(%[[LHS]], %[[RHS]] : tensor<2x2xf32, #sparse>, tensor<2x2xf32, #sparse>)
+// CHECK-SAME: outs(%[[INIT]] : tensor<2x2xf32, #sparse>)
+// CHECK: ^{{.*}}(%[[A:.*]]: f32, %[[B:.*]]: f32, %{{.*}}: f32):
+// CHECK:   %[[MAX:.*]] = sparse_tensor.binary %[[A]], %[[B]] : f32, f32 to f32
+// CHECK:   overlap = {
+// CHECK:   ^{{.*}}(%[[X:.*]]: f32, %[[Y:.*]]: f32):
+// CHECK:     %[[BOTH:.*]] = arith.maximumf %[[X]], %[[Y]] : f32
+// CHECK:     sparse_tensor.yield %[[BOTH]] : f32
+// CHECK:   left = {
+// CHECK:   ^{{.*}}(%[[X:.*]]: f32):
+// CHECK:     %[[LEFT:.*]] = arith.maximumf %[[X]], %{{.*}} : f32
+// CHECK:     sparse_tensor.yield %[[LEFT]] : f32
+// CHECK:   right = {
+// CHECK:   ^{{.*}}(%[[Y:.*]]: f32):
+// CHECK:     %[[RIGHT:.*]] = arith.maximumf %{{.*}}, %[[Y]] : f32
+// CHECK:     sparse_tensor.yield %[[RIGHT]] : f32
+// CHECK:   linalg.yield %[[MAX]] : f32
+// CHECK: return %[[OUT]]
@@ -26,6 +26,7 @@ limitations under the License.
 #include "mlir/Dialect/Bufferization/IR/Bufferization.h"
 #include "mlir/Dialect/SparseTensor/IR/SparseTensor.h"
 #include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "stablehlo/conversions/linalg/transforms/MapStablehloToScalarOp.h"
 #include "stablehlo/dialect/ChloOps.h"
 #include "stablehlo/dialect/StablehloOps.h"
 
@@ -36,6 +37,22 @@ bool hasIntegralShapeType(Operation *op) {
   return stp && stp.getElementType().isIntOrIndex();
 }
 
+bool hasSparseOperandOrResult(Operation *op) {
+  return llvm::any_of(op->getOperandTypes(),
+                      [](Type type) {
+                        return sparse_tensor::getSparseTensorEncoding(type);
+                      }) ||
+         sparse_tensor::getSparseTensorEncoding(op->getResult(0).getType());
+}
+
+// Maps the max or min `op` to scalar ops on `args`.
+Value mapMaxOrMinOp(Operation *op, Type rtp, ValueRange args, OpBuilder *b) {
+  if (auto maxOp = dyn_cast<mlir::stablehlo::MaxOp>(op))
+    return StablehloOpToStdScalarOp::mapOp(maxOp, rtp, args, b);
+  return StablehloOpToStdScalarOp::mapOp(cast<mlir::stablehlo::MinOp>(op), rtp,
+                                         args, b);
+}
+
 }  // namespace
 
 SmallVector<utils::IteratorType, 3> getParallelAndReductionIterators(
@@ -102,6 +119,7 @@ Value coerceTensorShape(OpBuilder &builder, Location loc,
 
 Value fillTensorWithZeros(OpBuilder &builder, Location loc, Value tensor) {
   auto type = cast<ShapedType>(tensor.getType());
+  if (sparse_tensor::getSparseTensorEncoding(type)) return tensor;
   Value zero;
   // Complex numbers are a special case.
   if (auto complexType = llvm::dyn_cast<ComplexType>(type.getElementType())) {
@@ -138,6 +156,36 @@ Value preSparsify(Operation *op, llvm::SmallVector<Value, 2> &values, Type rtp,
     values[0] = present->getArgument(0);
     return semiring;
   }
+  // Apply for max and min, which the sparse compiler doesn't know but which
+  // map two zeros to zero, so that entries absent from both operands stay
+  // absent. Entries present in a single operand are combined with zero.
+  if (isa<mlir::stablehlo::MaxOp, mlir::stablehlo::MinOp>(op)) {
+    if (!hasSparseOperandOrResult(op) || isa<ComplexType>(rtp))
+      return Value();
+    Location loc = op->getLoc();
+    auto semiring = b->create<sparse_tensor::BinaryOp>(
+        loc, rtp, values[0], values[1], /*left_identity=*/false,
+        /*right_identity=*/false);
+    Type ltp = values[0].getType();
+    Type rtp1 = values[1].getType();
+    Block *left = b->createBlock(&semiring.getLeftRegion(), {}, ltp, loc);
+    Value rightZero =
+        b->create<arith::ConstantOp>(loc, b->getZeroAttr(rtp1)).getResult();
+    b->create<sparse_tensor::YieldOp>(
+        loc, mapMaxOrMinOp(op, rtp, {left->getArgument(0), rightZero}, b));
+    Block *right = b->createBlock(&semiring.getRightRegion(), {}, rtp1, loc);
+    Value leftZero =
+        b->create<arith::ConstantOp>(loc, b->getZeroAttr(ltp)).getResult();
+    b->create<sparse_tensor::YieldOp>(
+        loc, mapMaxOrMinOp(op, rtp, {leftZero, right->getArgument(0)}, b));
+    Block *overlap =
+        b->createBlock(&semiring.getOverlapRegion(), {},
+                       ArrayRef<Type>{ltp, rtp1}, ArrayRef<Location>{loc, loc});
+    b->setInsertionPointToStart(overlap);
+    values[0] = overlap->getArgument(0);
+    values[1] = overlap->getArgument(1);
+    return semiring;
+  }
   return Value();
 }
 
@@ -78,7 +78,8 @@ Value coerceTensorShape(OpBuilder &builder, Location loc,
                         TypedValue<ShapedType> value, ShapedType targetType);
 
 /// Fills |tensor| with a zero constant of the matching type. Returns the new
-/// value.
+/// value. Sparse tensors are returned as is: they are only ever created empty,
+/// which is all zeros, and the sparse compiler requires outputs to be fresh.
 Value fillTensorWithZeros(OpBuilder &builder, Location loc, Value tensor);
 
 /// Sparsifies a (block of) operation(s) that cannot be handled directly
@@ -94,6 +95,9 @@ Value fillTensorWithZeros(OpBuilder &builder, Location loc, Value tensor);
 ///     }
 ///     absent={}
 ///   linalg.yield %result
+///
+/// Binary max and min ops yield a sparse_tensor.binary instead, whose left
+/// and right regions combine entries present in a single operand with zero.
 Value preSparsify(Operation *op, llvm::SmallVector<Value, 2> &values, Type rtp,
                   OpBuilder *b);
 
@@ -1284,6 +1284,43 @@ struct StablehloOpToStdScalarOp {
   }
 };
 
+/// Maps any of the ops `OpTys` to scalar ops, for patterns which convert
+/// regions of such ops without knowing their types statically.
+template <typename... OpTys>
+struct StablehloOpsToStdScalarOps {
+  static bool contains(Operation *op) { return isa<OpTys...>(op); }
+
+  /// Maps `op` to scalar ops on `args`, or returns nullptr if it can't.
+  static Value mapToScalarOp(Operation *op, Type resultType, ValueRange args,
+                             OpBuilder *b) {
+    Value result;
+    (void)((isa<OpTys>(op) &&
+            (result = StablehloOpToStdScalarOp::mapOp(cast<OpTys>(op),
+                                                      resultType, args, b),
+             true)) ||
+           ...);
+    return result;
+  }
+};
+
+/// Elementwise ops which map to scalar ops on their operands alone.
+using ElementwiseStablehloOps = StablehloOpsToStdScalarOps<
+    stablehlo::AbsOp, stablehlo::AddOp, stablehlo::AndOp, stablehlo::Atan2Op,
+    stablehlo::BitcastConvertOp, stablehlo::CbrtOp, stablehlo::CeilOp,
+    stablehlo::ClampOp, stablehlo::ClzOp, stablehlo::CompareOp,
+    stablehlo::ComplexOp, stablehlo::ConvertOp, stablehlo::CosineOp,
+    stablehlo::DivOp, stablehlo::ExpOp, stablehlo::Expm1Op, stablehlo::FloorOp,
+    stablehlo::ImagOp, stablehlo::IsFiniteOp, stablehlo::Log1pOp,
+    stablehlo::LogOp, stablehlo::LogisticOp, stablehlo::MaxOp,
+    stablehlo::MinOp, stablehlo::MulOp, stablehlo::NegOp, stablehlo::NotOp,
+    stablehlo::OrOp, stablehlo::PopulationCountOp, stablehlo::PowOp,
+    stablehlo::RealOp, stablehlo::ReducePrecisionOp, stablehlo::RemOp,
+    stablehlo::RoundNearestEvenOp, stablehlo::RoundOp, stablehlo::RsqrtOp,
+    stablehlo::SelectOp, stablehlo::ShiftLeftOp,
+    stablehlo::ShiftRightArithmeticOp, stablehlo::ShiftRightLogicalOp,
+    stablehlo::SignOp, stablehlo::SineOp, stablehlo::SqrtOp,
+    stablehlo::SubtractOp, stablehlo::TanhOp, stablehlo::XorOp>;
+
 }  // namespace stablehlo
 }  // namespace mlir
 
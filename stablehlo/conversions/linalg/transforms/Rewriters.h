@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef STABLEHLO_CONVERSIONS_LINALG_TRANSFORMS_REWRITERS_H
 #define STABLEHLO_CONVERSIONS_LINALG_TRANSFORMS_REWRITERS_H
 
+#include <cstdint>
+
 #include "mlir/Transforms/DialectConversion.h"
 
 namespace mlir::stablehlo {
@@ -55,17 +57,35 @@ void populatePointwiseStablehloToLinalgConversionPatterns(
     MLIRContext *context, TypeConverter &typeConverter,
     RewritePatternSet *patterns, bool enablePrimitiveOps);
 
+/// Populates the patterns that convert groups of connected elementwise
+/// StableHLO ops, and broadcasts of their operands, to a single linalg.generic
+/// on tensors. These take precedence over the patterns for single ops.
+void populateFusedPointwiseStablehloToLinalgConversionPatterns(
+    MLIRContext *context, TypeConverter &typeConverter,
+    RewritePatternSet *patterns);
+
 /// Populates the patterns that convert from convolution StableHLO ops to Linalg
 /// on tensors.
 void populateStablehloConvolutionToLinalgConversionPatterns(
     MLIRContext *context, TypeConverter &typeConverter,
     RewritePatternSet *patterns);
 
+/// Rewrites the linalg.conv_2d_nhwc_hwcf ops in `root` to matmuls, for
+/// backends whose matmuls are much faster than their convolutions. 3x3
+/// convolutions with unit strides and dilations use the Winograd algorithm
+/// F(m x m, 3 x 3) if `winogradOutputTileSize` is m = 2 or 4, and other
+/// convolutions with static shapes use im2col if `enableIm2col`.
+void rewriteConvolutionsToMatmuls(Operation *root,
+                                  int64_t winogradOutputTileSize,
+                                  bool enableIm2col);
+
 /// Populates the patterns that convert from dot product StableHLO ops to Linalg
-/// on tensors.
+/// on tensors. Dots with results of floats narrower than f32 accumulate in f32
+/// and truncate their result if `enableWidenedAccumulation` or they have
+/// HIGHEST precision.
 void populateStablehloDotProdToLinalgConversionPatterns(
     MLIRContext *context, TypeConverter &typeConverter,
-    RewritePatternSet *patterns);
+    RewritePatternSet *patterns, bool enableWidenedAccumulation);
 
 /// Populates the patterns that convert from random number generation StableHLO
 /// ops to Linalg on tensors.
@@ -79,6 +99,18 @@ void populateStablehloReductionToLinalgConversionPatterns(
     MLIRContext *context, TypeConverter &typeConverter,
     RewritePatternSet *patterns, bool enablePrimitiveOps);
 
+/// Populates the patterns that convert sort StableHLO ops whose comparator
+/// consists of elementwise ops to Linalg and SCF on tensors.
+void populateStablehloSortToLinalgConversionPatterns(
+    MLIRContext *context, TypeConverter &typeConverter,
+    RewritePatternSet *patterns);
+
+/// Splits the reductions in `root` over a single large dimension into partial
+/// reductions over `ratio` chunks, which can run in parallel, followed by a
+/// reduction of the partial results. Only reductions whose combiner is a
+/// single associative op with a neutral element are split.
+void splitReductions(Operation *root, int64_t ratio);
+
 /// Populates the patterns that convert scalar StableHLO ops to Arith ops.
 void populateScalarHloToArithConversionPatterns(
     MLIRContext *context, TypeConverter &typeConverter,
@@ -15,6 +15,7 @@ limitations under the License.
 ==============================================================================*/
 
 #include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Arith/Utils/Utils.h"
 #include "mlir/Dialect/Bufferization/IR/Bufferization.h"
 #include "mlir/Dialect/Complex/IR/Complex.h"
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
@@ -23,10 +24,16 @@ limitations under the License.
 #include "mlir/Dialect/Math/IR/Math.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/SCF/Transforms/Patterns.h"
+#include "mlir/Dialect/SCF/Transforms/TileUsingInterface.h"
 #include "mlir/Dialect/Shape/IR/Shape.h"
 #include "mlir/Dialect/SparseTensor/IR/SparseTensor.h"
 #include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/Dialect/Utils/ReshapeOpsUtils.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
 #include "mlir/IR/Operation.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
+#include "mlir/Interfaces/TilingInterface.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
@@ -1362,6 +1369,56 @@ struct ConcatenateConverter final
   }
 };
 
+/// Converts stablehlo.concatenate operation to tensor.insert_slice ops of
+/// every operand into a single destination, so that the operands can be
+/// bufferized in place into the result.
+struct ConcatenateToInsertSliceConverter final
+    : OpConversionPattern<mlir::stablehlo::ConcatenateOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      mlir::stablehlo::ConcatenateOp op, OpAdaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    auto resultType = getTypeConverter()->convertType<ShapedType>(op.getType());
+    if (!resultType)
+      return rewriter.notifyMatchFailure(op, "type conversion failed");
+    if (sparse_tensor::getSparseTensorEncoding(resultType) ||
+        llvm::any_of(adaptor.getOperands(), [](Value operand) {
+          return sparse_tensor::getSparseTensorEncoding(operand.getType());
+        }))
+      return rewriter.notifyMatchFailure(
+          op, "ConcatenateToInsertSliceConverter cannot legalize sparse types");
+
+    uint64_t dim = op.getDimension();
+    Location loc = op.getLoc();
+    int64_t rank = resultType.getRank();
+    Value result =
+        getEmptyTensorFor(rewriter, loc, resultType, op, adaptor.getOperands());
+
+    SmallVector<OpFoldResult> offsets(rank, rewriter.getIndexAttr(0));
+    SmallVector<OpFoldResult> strides(rank, rewriter.getIndexAttr(1));
+    for (Value operand : adaptor.getOperands()) {
+      SmallVector<OpFoldResult> sizes =
+          tensor::getMixedSizes(rewriter, loc, operand);
+      result = rewriter.create<tensor::InsertSliceOp>(loc, operand, result,
+                                                      offsets, sizes, strides);
+
+      // Offset the next operand along the concatenate dimension.
+      std::optional<int64_t> offset = getConstantIntValue(offsets[dim]);
+      std::optional<int64_t> size = getConstantIntValue(sizes[dim]);
+      if (offset && size) {
+        offsets[dim] = rewriter.getIndexAttr(*offset + *size);
+      } else {
+        offsets[dim] = rewriter.createOrFold<arith::AddIOp>(
+            loc, getValueOrCreateConstantIndexOp(rewriter, loc, offsets[dim]),
+            getValueOrCreateConstantIndexOp(rewriter, loc, sizes[dim]));
+      }
+    }
+    rewriter.replaceOp(op, result);
+    return success();
+  }
+};
+
 /// Converts stablehlo.concatenate operation to a sparse_tensor.concatenate op.
 struct SparseConcatenateConverter final
     : OpConversionPattern<mlir::stablehlo::ConcatenateOp> {
@@ -1531,6 +1588,48 @@ struct DynamicSliceConverter final
   }
 };
 
+/// Converts stablehlo.select to a linalg.generic which writes into
+/// `on_false`, so that its buffer can be updated in place if it isn't used
+/// after the select. Takes precedence over the pointwise lowering.
+struct SelectToDestinationConverter final
+    : OpConversionPattern<mlir::stablehlo::SelectOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      mlir::stablehlo::SelectOp op, OpAdaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    auto resultType =
+        getTypeConverter()->convertType<RankedTensorType>(op.getType());
+    auto predType = dyn_cast<RankedTensorType>(adaptor.getPred().getType());
+    if (!resultType || !predType ||
+        adaptor.getOnFalse().getType() != resultType ||
+        adaptor.getOnTrue().getType() != resultType ||
+        sparse_tensor::getSparseTensorEncoding(resultType))
+      return rewriter.notifyMatchFailure(op, "expected dense operands");
+
+    // The predicate is either a scalar or has the shape of the result.
+    int64_t rank = resultType.getRank();
+    AffineMap identityMap = rewriter.getMultiDimIdentityMap(rank);
+    AffineMap predMap =
+        predType.getRank() == 0
+            ? AffineMap::get(rank, /*symbolCount=*/0, rewriter.getContext())
+            : identityMap;
+    rewriter.replaceOpWithNewOp<linalg::GenericOp>(
+        op, /*resultTensorTypes=*/resultType,
+        /*inputs=*/ValueRange{adaptor.getPred(), adaptor.getOnTrue()},
+        /*outputs=*/adaptor.getOnFalse(),
+        ArrayRef<AffineMap>{predMap, identityMap, identityMap},
+        getNParallelLoopsAttrs(rank),
+        [&](OpBuilder &b, Location loc, ValueRange args) {
+          Value select =
+              b.create<arith::SelectOp>(loc, args[0], args[1], args[2]);
+          b.create<linalg::YieldOp>(loc, select);
+        },
+        linalg::getPrunedAttributeList(op));
+    return success();
+  }
+};
+
 struct DynamicUpdateSliceConverter final
     : OpConversionPattern<mlir::stablehlo::DynamicUpdateSliceOp> {
   using OpConversionPattern::OpConversionPattern;
@@ -1540,26 +1639,21 @@ struct DynamicUpdateSliceConverter final
       ConversionPatternRewriter &rewriter) const override {
     Location loc = op.getLoc();
     auto operandType =
-        llvm::cast<RankedTensorType>(adaptor.getOperand().getType());
-    if (!operandType.hasStaticShape()) {
-      return rewriter.notifyMatchFailure(
-          op, "require static ranked type for operand");
-    }
-
+        llvm::dyn_cast<RankedTensorType>(adaptor.getOperand().getType());
     auto updateType =
-        llvm::cast<RankedTensorType>(adaptor.getUpdate().getType());
-    if (!updateType.hasStaticShape()) {
-      return rewriter.notifyMatchFailure(
-          op, "require static ranked type for operand");
+        llvm::dyn_cast<RankedTensorType>(adaptor.getUpdate().getType());
+    if (!operandType || !updateType) {
+      return rewriter.notifyMatchFailure(op,
+                                         "require ranked types for operands");
     }
 
-    // We do not have to clamp sizes because the semantic of `update`
-    // guarantees that it is always in the bounds. See
+    // The update is inserted into the operand, which is the destination of
+    // the result, so that it can be updated in place. We do not have to
+    // clamp sizes because the semantic of `update` guarantees that it is
+    // always in the bounds. See
     // https://www.tensorflow.org/xla/operation_semantics#dynamicupdateslice
-    SmallVector<OpFoldResult, 3> sizes;
-    for (int64_t size : updateType.getShape()) {
-      sizes.push_back(rewriter.getIndexAttr(size));
-    }
+    SmallVector<OpFoldResult, 3> sizes =
+        tensor::getMixedSizes(rewriter, loc, adaptor.getUpdate());
 
     SmallVector<OpFoldResult, 3> startIndices;
     Value zero = rewriter.create<arith::ConstantIndexOp>(loc, 0);
@@ -1570,8 +1664,10 @@ struct DynamicUpdateSliceConverter final
       Value startIndex = extractIndexFromTensor(
           rewriter, loc, start,
           cast<ShapedType>(op.getStartIndices()[idx].getType()));
-      Value ub = rewriter.create<arith::ConstantIndexOp>(
-          loc, operandType.getDimSize(idx) - updateType.getDimSize(idx));
+      Value ub = rewriter.createOrFold<arith::SubIOp>(
+          loc,
+          rewriter.createOrFold<tensor::DimOp>(loc, adaptor.getOperand(), idx),
+          getValueOrCreateConstantIndexOp(rewriter, loc, sizes[idx]));
 
       startIndex = rewriter.create<arith::MaxSIOp>(loc, startIndex, zero);
       startIndex = rewriter.create<arith::MinSIOp>(loc, startIndex, ub);
@@ -1911,6 +2007,303 @@ struct GatherConversion final : OpConversionPattern<mlir::stablehlo::GatherOp> {
   }
 };
 
+/// Reshapes `value` to `type`, which must have the same number of elements.
+Value reshapeTo(OpBuilder &b, Location loc, Value value,
+                RankedTensorType type) {
+  auto valueType = cast<RankedTensorType>(value.getType());
+  if (valueType == type) return value;
+  SmallVector<ReassociationIndices> reassociation =
+      *getReassociationIndicesForReshape(valueType, type);
+  if (valueType.getRank() > type.getRank())
+    return b.create<tensor::CollapseShapeOp>(loc, type, value, reassociation);
+  return b.create<tensor::ExpandShapeOp>(loc, type, value, reassociation);
+}
+
+/// Gathers the rows of `operand`, i.e. its slices along the first dimension,
+/// at `indices` into a tensor of `resultType`, whose shape is the shape of
+/// `indices` followed by the shape of the rows. Every row is copied with a
+/// slice in an scf.forall over the indices, which can use vector loads and
+/// be distributed, unlike extracting every element. Indices are clamped to
+/// the rows of `operand`. `originalIndicesType` is the type of `indices`
+/// before type conversion.
+Value gatherRows(OpBuilder &b, Location loc, Value operand, Value indices,
+                 ShapedType originalIndicesType,
+                 RankedTensorType resultType) {
+  auto operandType = cast<RankedTensorType>(operand.getType());
+  auto indicesType = cast<RankedTensorType>(indices.getType());
+  int64_t rank = operandType.getRank();
+  int64_t numRows = indicesType.getNumElements();
+
+  // Gather into a matrix of rows, indexed by the flattened indices.
+  indices = reshapeTo(
+      b, loc, indices,
+      RankedTensorType::get({numRows}, indicesType.getElementType()));
+  SmallVector<int64_t> rowsShape(operandType.getShape());
+  rowsShape[0] = numRows;
+  Value empty =
+      b.create<tensor::EmptyOp>(loc, rowsShape, resultType.getElementType());
+
+  Value zero = b.create<arith::ConstantIndexOp>(loc, 0);
+  Value lastRow = b.createOrFold<arith::SubIOp>(
+      loc, b.createOrFold<tensor::DimOp>(loc, operand, 0),
+      b.create<arith::ConstantIndexOp>(loc, 1));
+
+  auto forallOp = b.create<scf::ForallOp>(
+      loc, ArrayRef<OpFoldResult>{b.getIndexAttr(numRows)},
+      ValueRange{empty}, /*mapping=*/std::nullopt);
+  OpBuilder::InsertionGuard guard(b);
+  b.setInsertionPoint(forallOp.getTerminator());
+  Value iv = forallOp.getInductionVars()[0];
+  Value index =
+      extractIndexFromTensor(b, loc, indices, originalIndicesType, {iv});
+  index = b.create<arith::MinSIOp>(
+      loc, b.create<arith::MaxSIOp>(loc, zero, index), lastRow);
+
+  SmallVector<OpFoldResult> offsets(rank, b.getIndexAttr(0));
+  SmallVector<OpFoldResult> sizes;
+  sizes.push_back(b.getIndexAttr(1));
+  for (int64_t size : operandType.getShape().drop_front())
+    sizes.push_back(b.getIndexAttr(size));
+  SmallVector<OpFoldResult> strides(rank, b.getIndexAttr(1));
+  offsets[0] = index;
+  Value row =
+      b.create<tensor::ExtractSliceOp>(loc, operand, offsets, sizes, strides);
+
+  b.setInsertionPointToStart(forallOp.getTerminator().getBody());
+  offsets[0] = iv;
+  b.create<tensor::ParallelInsertSliceOp>(
+      loc, row, forallOp.getRegionIterArgs()[0], offsets, sizes, strides);
+
+  b.setInsertionPointAfter(forallOp);
+  return reshapeTo(b, loc, forallOp.getResult(0), resultType);
+}
+
+/// Lowers gathers of whole rows, where every index selects a slice along the
+/// first dimension of the operand which spans all other dimensions, e.g.
+/// embedding lookups, to copies of the rows with `gatherRows`. Takes
+/// precedence over GatherConversion.
+struct GatherRowsConversion final
+    : OpConversionPattern<mlir::stablehlo::GatherOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      mlir::stablehlo::GatherOp gatherOp, OpAdaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    auto operandType =
+        dyn_cast<RankedTensorType>(adaptor.getOperand().getType());
+    auto indicesType =
+        dyn_cast<RankedTensorType>(adaptor.getStartIndices().getType());
+    auto resultType =
+        getTypeConverter()->convertType<RankedTensorType>(gatherOp.getType());
+    if (!operandType || !indicesType || !resultType ||
+        !indicesType.hasStaticShape() || !resultType.hasStaticShape())
+      return rewriter.notifyMatchFailure(gatherOp, "expected static shapes");
+
+    auto dims = gatherOp.getDimensionNumbers();
+    ArrayRef<int64_t> startIndexMap = dims.getStartIndexMap();
+    ArrayRef<int64_t> collapsedSliceDims = dims.getCollapsedSliceDims();
+    if (startIndexMap.size() != 1 || startIndexMap[0] != 0 ||
+        collapsedSliceDims.size() != 1 || collapsedSliceDims[0] != 0 ||
+        !dims.getOperandBatchingDims().empty())
+      return rewriter.notifyMatchFailure(gatherOp, "expected row indices");
+
+    // The index vector dimension has a single index, so it doesn't change
+    // the order of the indices.
+    int64_t indexVectorDim = dims.getIndexVectorDim();
+    int64_t batchRank = indicesType.getRank();
+    if (indexVectorDim != batchRank) {
+      if (indicesType.getDimSize(indexVectorDim) != 1)
+        return rewriter.notifyMatchFailure(gatherOp, "expected row indices");
+      --batchRank;
+    }
+
+    // The slices must be whole rows, following the batch dimensions.
+    ArrayRef<int64_t> sliceSizes = gatherOp.getSliceSizes();
+    ArrayRef<int64_t> offsetDims = dims.getOffsetDims();
+    for (int64_t i = 1, e = operandType.getRank(); i < e; ++i) {
+      if (operandType.isDynamicDim(i) ||
+          sliceSizes[i] != operandType.getDimSize(i) ||
+          offsetDims[i - 1] != batchRank + i - 1)
+        return rewriter.notifyMatchFailure(gatherOp, "expected whole rows");
+    }
+
+    rewriter.replaceOp(
+        gatherOp, gatherRows(rewriter, gatherOp.getLoc(), adaptor.getOperand(),
+                             adaptor.getStartIndices(),
+                             gatherOp.getStartIndices().getType(),
+                             resultType));
+    return success();
+  }
+};
+
+/// Returns whether the update computation of `op` returns the update, i.e.
+/// whether `op` overwrites the windows of its input.
+bool isOverwritingScatter(mlir::stablehlo::ScatterOp op) {
+  Block &body = op.getUpdateComputation().front();
+  auto returnOp = dyn_cast<mlir::stablehlo::ReturnOp>(body.front());
+  return returnOp && returnOp->getNumOperands() == 1 &&
+         returnOp->getOperand(0) == body.getArgument(1);
+}
+
+/// Lowers scatter ops with a single input to a loop nest over the update
+/// scatter dimensions, which carries the result. Every iteration updates a
+/// window of the result in place: the update window is inserted with
+/// tensor.insert_slice if the scatter overwrites, and otherwise combined with
+/// the window of the result by a linalg.generic with the update computation
+/// first. The loops are sequential, so duplicate indices are accumulated
+/// correctly whether or not the indices are unique. Like in XLA, windows
+/// which are out of bounds are skipped.
+struct ScatterConversion final
+    : OpConversionPattern<mlir::stablehlo::ScatterOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      mlir::stablehlo::ScatterOp op, OpAdaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    if (op.getInputs().size() != 1)
+      return rewriter.notifyMatchFailure(op, "expected a single input");
+    auto dims = op.getScatterDimensionNumbers();
+    if (!dims.getInputBatchingDims().empty())
+      return rewriter.notifyMatchFailure(op, "batching dims are unsupported");
+
+    Value input = adaptor.getInputs().front();
+    Value updates = adaptor.getUpdates().front();
+    Value indices = adaptor.getScatterIndices();
+    auto inputType = dyn_cast<RankedTensorType>(input.getType());
+    auto updatesType = dyn_cast<RankedTensorType>(updates.getType());
+    auto indicesType = dyn_cast<RankedTensorType>(indices.getType());
+    if (!inputType || !updatesType || !indicesType)
+      return rewriter.notifyMatchFailure(op, "expected ranked tensors");
+
+    Location loc = op.getLoc();
+    ArrayRef<int64_t> updateWindowDims = dims.getUpdateWindowDims();
+    ArrayRef<int64_t> insertedWindowDims = dims.getInsertedWindowDims();
+    ArrayRef<int64_t> scatterDimsToOperandDims =
+        dims.getScatterDimsToOperandDims();
+    int64_t indexVectorDim = dims.getIndexVectorDim();
+    int64_t inputRank = inputType.getRank();
+    int64_t updatesRank = updatesType.getRank();
+
+    // The loops iterate over the update dimensions which aren't window
+    // dimensions, which are also the batch dimensions of the indices.
+    Value zero = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value one = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+    SmallVector<Value> lbs, ubs, steps;
+    for (int64_t dim = 0; dim < updatesRank; ++dim) {
+      if (llvm::is_contained(updateWindowDims, dim)) continue;
+      lbs.push_back(zero);
+      ubs.push_back(rewriter.createOrFold<tensor::DimOp>(loc, updates, dim));
+      steps.push_back(one);
+    }
+
+    // The windows span the input dimensions which aren't inserted.
+    SmallVector<OpFoldResult> windowSizes(inputRank, rewriter.getIndexAttr(1));
+    SmallVector<int64_t> windowShape;
+    for (int64_t dim = 0, i = 0; dim < inputRank; ++dim) {
+      if (llvm::is_contained(insertedWindowDims, dim)) continue;
+      int64_t updateDim = updateWindowDims[i++];
+      windowSizes[dim] =
+          tensor::getMixedSize(rewriter, loc, updates, updateDim);
+      windowShape.push_back(updatesType.getDimSize(updateDim));
+    }
+    auto windowType =
+        RankedTensorType::get(windowShape, inputType.getElementType());
+    SmallVector<OpFoldResult> strides(inputRank, rewriter.getIndexAttr(1));
+    bool overwrite = isOverwritingScatter(op);
+
+    auto buildWindowUpdate = [&](OpBuilder &b, Location loc, ValueRange ivs,
+                                 Value result,
+                                 ArrayRef<OpFoldResult> offsets) -> Value {
+      SmallVector<OpFoldResult> updateOffsets(updatesRank, b.getIndexAttr(0));
+      SmallVector<OpFoldResult> updateSizes(updatesRank, b.getIndexAttr(1));
+      for (int64_t dim = 0, i = 0; dim < updatesRank; ++dim) {
+        if (llvm::is_contained(updateWindowDims, dim))
+          updateSizes[dim] = tensor::getMixedSize(b, loc, updates, dim);
+        else
+          updateOffsets[dim] = ivs[i++];
+      }
+      SmallVector<OpFoldResult> updateStrides(updatesRank, b.getIndexAttr(1));
+      Value window = b.create<tensor::ExtractSliceOp>(
+          loc, windowType, updates, updateOffsets, updateSizes, updateStrides);
+
+      if (!overwrite) {
+        Value current = b.create<tensor::ExtractSliceOp>(
+            loc, windowType, result, offsets, windowSizes, strides);
+        int64_t windowRank = windowType.getRank();
+        SmallVector<AffineMap, 2> indexingMaps(
+            2, b.getMultiDimIdentityMap(windowRank));
+        auto linalgOp = b.create<linalg::GenericOp>(
+            loc, /*resultTensorTypes=*/TypeRange{windowType},
+            /*inputs=*/ValueRange{window}, /*outputs=*/ValueRange{current},
+            indexingMaps, getNParallelLoopsAttrs(windowRank));
+
+        // The update computation takes the input element first, which is the
+        // output of the linalg.generic.
+        Region &region = linalgOp.getRegion();
+        rewriter.inlineRegionBefore(op.getUpdateComputation(), region,
+                                    region.end());
+        TypeConverter::SignatureConversion signatureConverter(2);
+        signatureConverter.addInputs(/*origInputNo=*/1,
+                                     windowType.getElementType());
+        signatureConverter.addInputs(/*origInputNo=*/0,
+                                     windowType.getElementType());
+        rewriter.applySignatureConversion(&region, signatureConverter,
+                                          getTypeConverter());
+        window = linalgOp.getResult(0);
+      }
+
+      return b.create<tensor::InsertSliceOp>(loc, window, result, offsets,
+                                             windowSizes, strides);
+    };
+
+    scf::LoopNest loopNest = scf::buildLoopNest(
+        rewriter, loc, lbs, ubs, steps, ValueRange{input},
+        [&](OpBuilder &b, Location loc, ValueRange ivs,
+            ValueRange iterArgs) -> scf::ValueVector {
+          Value result = iterArgs.front();
+
+          // Computes the start of the window in the result, and whether the
+          // window is in bounds.
+          SmallVector<OpFoldResult> offsets(inputRank, b.getIndexAttr(0));
+          Value inBounds = b.create<arith::ConstantIntOp>(loc, 1, 1);
+          for (auto [i, dim] : llvm::enumerate(scatterDimsToOperandDims)) {
+            SmallVector<Value> index = llvm::to_vector(ivs);
+            if (indexVectorDim < indicesType.getRank()) {
+              index.insert(index.begin() + indexVectorDim,
+                           b.create<arith::ConstantIndexOp>(loc, i));
+            }
+            Value start = extractIndexFromTensor(
+                b, loc, indices, op.getScatterIndices().getType(), index);
+            Value limit = b.createOrFold<arith::SubIOp>(
+                loc, b.createOrFold<tensor::DimOp>(loc, result, dim),
+                getValueOrCreateConstantIndexOp(b, loc, windowSizes[dim]));
+            Value isAboveZero = b.create<arith::CmpIOp>(
+                loc, arith::CmpIPredicate::sge, start, zero);
+            Value isBelowLimit = b.create<arith::CmpIOp>(
+                loc, arith::CmpIPredicate::sle, start, limit);
+            inBounds = b.create<arith::AndIOp>(
+                loc, inBounds,
+                b.create<arith::AndIOp>(loc, isAboveZero, isBelowLimit));
+            offsets[dim] = start;
+          }
+
+          auto ifOp = b.create<scf::IfOp>(
+              loc, inBounds,
+              [&](OpBuilder &b, Location loc) {
+                b.create<scf::YieldOp>(
+                    loc, buildWindowUpdate(b, loc, ivs, result, offsets));
+              },
+              [&](OpBuilder &b, Location loc) {
+                b.create<scf::YieldOp>(loc, result);
+              });
+          return {ifOp.getResult(0)};
+        });
+
+    rewriter.replaceOp(op, ArrayRef<Value>(loopNest.results));
+    return success();
+  }
+};
+
 /// Converts xla-hlo.select_and_scatter op to a sequence of linalg.generics ops.
 /// The current version computes the scattered index and populates the correct
 /// value for each tile. It does not currently handle overlapping tiles.
@@ -2324,6 +2717,43 @@ struct PadOpNegativePaddingConversion final
   }
 };
 
+/// Pads the operand of `op` by inserting it into a result-sized tensor filled
+/// with `paddingVal`, with the interior padding as strides.
+Value padWithInsertSlice(ConversionPatternRewriter &rewriter,
+                         mlir::stablehlo::PadOp op,
+                         mlir::stablehlo::PadOp::Adaptor adaptor,
+                         ShapedType resultType, Value paddingVal) {
+  Location loc = op.getLoc();
+  auto emptyTensor =
+      getEmptyTensorFor(rewriter, loc, resultType, op, adaptor.getOperands());
+  auto fill =
+      rewriter.create<linalg::FillOp>(loc, paddingVal, emptyTensor).result();
+
+  // Get sizes of the original operand.
+  auto operandType = llvm::cast<ShapedType>(adaptor.getOperand().getType());
+  auto sizes = llvm::map_to_vector(
+      llvm::seq<int64_t>(0, operandType.getRank()),
+      [&](int64_t dim) -> OpFoldResult {
+        if (!operandType.isDynamicDim(dim))
+          return rewriter.getIndexAttr(operandType.getDimSize(dim));
+        return rewriter.create<tensor::DimOp>(loc, adaptor.getOperand(), dim)
+            .getResult();
+      });
+  auto i64ToFoldResult = [&](const int64_t &i) -> OpFoldResult {
+    return rewriter.getIntegerAttr(rewriter.getI64Type(), i);
+  };
+  // Map interior padding to strides.
+  auto strides = llvm::map_to_vector(
+      op.getInteriorPadding(), [&](const int64_t &stride) -> OpFoldResult {
+        return rewriter.getIntegerAttr(rewriter.getI64Type(), stride + 1);
+      });
+
+  return rewriter.create<tensor::InsertSliceOp>(
+      loc, adaptor.getOperand(), fill,
+      llvm::map_to_vector(op.getEdgePaddingLow(), i64ToFoldResult), sizes,
+      strides);
+}
+
 /// Converts stablehlo.pad operation to tensor.pad or tensor.insert_slice.
 struct PadOpConversion final : OpConversionPattern<mlir::stablehlo::PadOp> {
   using OpConversionPattern::OpConversionPattern;
@@ -2362,32 +2792,36 @@ struct PadOpConversion final : OpConversionPattern<mlir::stablehlo::PadOp> {
     }
 
     // We have interior padding, which can be lowered to tensor.insert_slice.
-    // Start by filling a result-sized tensor with the pad value.
-    auto emptyTensor =
-        getEmptyTensorFor(rewriter, loc, resultType, op, adaptor.getOperands());
-    auto fill =
-        rewriter.create<linalg::FillOp>(loc, paddingVal, emptyTensor).result();
-
-    // Get sizes of the original operand.
-    auto operandType = llvm::cast<ShapedType>(adaptor.getOperand().getType());
-    auto sizes = llvm::map_to_vector(
-        llvm::seq<int64_t>(0, operandType.getRank()),
-        [&](int64_t dim) -> OpFoldResult {
-          if (!operandType.isDynamicDim(dim))
-            return rewriter.getIndexAttr(operandType.getDimSize(dim));
-          return rewriter.create<tensor::DimOp>(loc, adaptor.getOperand(), dim)
-              .getResult();
-        });
-    // Map interior padding to strides.
-    auto strides = llvm::map_to_vector(
-        op.getInteriorPadding(), [&](const int64_t &stride) -> OpFoldResult {
-          return rewriter.getIntegerAttr(rewriter.getI64Type(), stride + 1);
-        });
+    rewriter.replaceOp(op, padWithInsertSlice(rewriter, op, adaptor,
+                                              resultType, paddingVal));
+    return success();
+  }
+};
 
-    rewriter.replaceOpWithNewOp<tensor::InsertSliceOp>(
-        op, adaptor.getOperand(), fill,
-        llvm::map_to_vector(op.getEdgePaddingLow(), i64ToFoldResult), sizes,
-        strides);
+/// Converts stablehlo.pad operation with non-negative padding to
+/// tensor.insert_slice into the padded destination, which bufferizes in
+/// place unlike tensor.pad.
+struct PadOpToInsertSliceConversion final
+    : OpConversionPattern<mlir::stablehlo::PadOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      mlir::stablehlo::PadOp op, OpAdaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    auto resultType = getTypeConverter()->convertType<ShapedType>(op.getType());
+    if (!resultType)
+      return rewriter.notifyMatchFailure(op, "type conversion failed");
+
+    // Negative edge padding is decomposed separately.
+    auto isNegative = [](const int64_t &i) { return i < 0; };
+    if (llvm::any_of(op.getEdgePaddingLow(), isNegative) ||
+        llvm::any_of(op.getEdgePaddingHigh(), isNegative))
+      return failure();
+
+    Value paddingVal = rewriter.createOrFold<tensor::ExtractOp>(
+        op.getLoc(), adaptor.getPaddingValue());
+    rewriter.replaceOp(op, padWithInsertSlice(rewriter, op, adaptor,
+                                              resultType, paddingVal));
     return success();
   }
 };
@@ -2518,6 +2952,40 @@ struct TorchIndexSelectOpConversion final
   }
 };
 
+/// Lowers torch_index_select ops which select rows, i.e. along the first
+/// dimension without batch dimensions, to copies of the rows with
+/// `gatherRows`. Takes precedence over TorchIndexSelectOpConversion.
+struct TorchIndexSelectRowsConversion final
+    : OpConversionPattern<mlir::stablehlo::TorchIndexSelectOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      mlir::stablehlo::TorchIndexSelectOp op, OpAdaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    auto operandType =
+        dyn_cast<RankedTensorType>(adaptor.getOperand().getType());
+    auto indexType = dyn_cast<RankedTensorType>(adaptor.getIndex().getType());
+    auto resultType =
+        getTypeConverter()->convertType<RankedTensorType>(op.getType());
+    if (!operandType || !indexType || !resultType ||
+        !indexType.hasStaticShape() || !resultType.hasStaticShape())
+      return rewriter.notifyMatchFailure(op, "expected static shapes");
+
+    int64_t axis = op.getDim();
+    int64_t batch = op.getBatchDims();
+    if (axis < 0) axis += operandType.getRank();
+    if (batch < 0) batch += indexType.getRank();
+    if (axis != 0 || batch != 0)
+      return rewriter.notifyMatchFailure(op, "expected row indices");
+
+    rewriter.replaceOp(
+        op, gatherRows(rewriter, op.getLoc(), adaptor.getOperand(),
+                       adaptor.getIndex(), op.getIndex().getType(),
+                       resultType));
+    return success();
+  }
+};
+
 struct SetDimensionSizeConverter final
     : OpConversionPattern<mlir::stablehlo::SetDimensionSizeOp> {
   using OpConversionPattern::OpConversionPattern;
@@ -2558,11 +3026,12 @@ static void populateConversionPatterns(MLIRContext *context,
                                        TypeConverter &typeConverter,
                                        RewritePatternSet *patterns,
                                        bool enablePrimitiveOps,
-                                       bool enableSparseOps) {
+                                       bool enableSparseOps,
+                                       bool enableDestinationPassingStyle,
+                                       bool enableWidenedAccumulation) {
   // clang-format off
   patterns->add<
       BitcastConvertConverter,
-      ConcatenateConverter,
       ConstConverterTensor,
       EinsumToLinalgConverter,
       GatherConversion,
@@ -2573,9 +3042,9 @@ static void populateConversionPatterns(MLIRContext *context,
       SliceConverter,
       DynamicSliceConverter,
       DynamicUpdateSliceConverter,
-      PadOpConversion,
       PadOpNegativePaddingConversion,
       TorchIndexSelectOpConversion,
+      ScatterConversion,
       SelectAndScatterNoOverlapConverter
       >(typeConverter, context);
 
@@ -2586,6 +3055,20 @@ static void populateConversionPatterns(MLIRContext *context,
     patterns->add<SparseConcatenateConverter>(typeConverter, context);
   }
 
+  if (enableDestinationPassingStyle) {
+    patterns->add<
+      ConcatenateToInsertSliceConverter,
+      PadOpToInsertSliceConversion
+    >(typeConverter, context);
+    patterns->add<SelectToDestinationConverter>(typeConverter, context,
+                                                /*benefit=*/2);
+  } else {
+    patterns->add<
+      ConcatenateConverter,
+      PadOpConversion
+    >(typeConverter, context);
+  }
+
   if (enablePrimitiveOps) {
     patterns->add<
       BroadcastInDimOpToBroadcastConverter,
@@ -2613,16 +3096,65 @@ static void populateConversionPatterns(MLIRContext *context,
   detail::populateStablehloConvolutionToLinalgConversionPatterns(
       context, typeConverter, patterns);
   detail::populateStablehloDotProdToLinalgConversionPatterns(
-      context, typeConverter, patterns);
+      context, typeConverter, patterns, enableWidenedAccumulation);
   detail::populateStablehloRandomToLinalgConversionPatterns(
       context, typeConverter, patterns);
   detail::populateStablehloReductionToLinalgConversionPatterns(
       context, typeConverter, patterns, enablePrimitiveOps);
+  detail::populateStablehloSortToLinalgConversionPatterns(
+      context, typeConverter, patterns);
   detail::populateScalarHloToArithConversionPatterns(
       context, typeConverter, patterns, isInBodyOfLinalgOps);
   linalg::populateEraseUnusedOperandsAndResultsPatterns(*patterns);
 }
 
+/// Tiles the first parallel loop with at least `numThreads` iterations of
+/// every linalg op on tensors in `root` into an scf.forall of `numThreads`
+/// iterations, which a runtime can distribute over as many threads. Ops in
+/// loops are left as is, since their enclosing loop is parallelized instead
+/// if it's a linalg op, and may not be parallel otherwise.
+void tileParallelLoopsToForall(Operation *root, int64_t numThreads) {
+  SmallVector<linalg::LinalgOp> linalgOps;
+  root->walk([&](linalg::LinalgOp op) {
+    if (op.hasPureTensorSemantics() &&
+        !op->getParentOfType<LoopLikeOpInterface>() &&
+        !op->getParentOfType<linalg::LinalgOp>())
+      linalgOps.push_back(op);
+  });
+
+  IRRewriter rewriter(root->getContext());
+  for (linalg::LinalgOp op : linalgOps) {
+    auto tilingOp = dyn_cast<TilingInterface>(op.getOperation());
+    if (!tilingOp) continue;
+    SmallVector<int64_t> loopRanges = op.getStaticLoopRanges();
+    SmallVector<utils::IteratorType> iteratorTypes =
+        op.getIteratorTypesArray();
+    std::optional<size_t> dim;
+    for (auto [i, range] : llvm::enumerate(loopRanges)) {
+      if (linalg::isParallelIterator(iteratorTypes[i]) &&
+          !ShapedType::isDynamic(range) && range >= numThreads) {
+        dim = i;
+        break;
+      }
+    }
+    if (!dim) continue;
+
+    // Tile sizes of zero leave the other loops untiled.
+    SmallVector<OpFoldResult> tileSizes(loopRanges.size(),
+                                        rewriter.getIndexAttr(0));
+    tileSizes[*dim] =
+        rewriter.getIndexAttr(llvm::divideCeil(loopRanges[*dim], numThreads));
+    scf::SCFTilingOptions options;
+    options.setLoopType(scf::SCFTilingOptions::LoopType::ForallOp);
+    options.setTileSizes(tileSizes);
+    rewriter.setInsertionPoint(op);
+    FailureOr<scf::SCFTilingResult> tiled =
+        scf::tileUsingSCF(rewriter, tilingOp, options);
+    if (failed(tiled)) continue;
+    rewriter.replaceOp(op, tiled->replacements);
+  }
+}
+
 struct StablehloLegalizeToLinalgPass
     : impl::StablehloLegalizeToLinalgPassBase<StablehloLegalizeToLinalgPass> {
   using StablehloLegalizeToLinalgPassBase::StablehloLegalizeToLinalgPassBase;
@@ -2638,21 +3170,69 @@ struct StablehloLegalizeToLinalgPass
 
     RewritePatternSet patterns_(context);
     populateConversionPatterns(context, converter, &patterns_,
-                               enablePrimitiveOps, enableSparseOps);
+                               enablePrimitiveOps, enableSparseOps,
+                               enableDestinationPassingStyle,
+                               enableWidenedAccumulation);
+    if (enableElementwiseFusion) {
+      detail::populateFusedPointwiseStablehloToLinalgConversionPatterns(
+          context, converter, &patterns_);
+    }
+    if (enableRowGather) {
+      patterns_.add<GatherRowsConversion, TorchIndexSelectRowsConversion>(
+          converter, context, /*benefit=*/2);
+    }
+    if (enableControlFlow) {
+      scf::populateSCFStructuralTypeConversionsAndLegality(converter,
+                                                           patterns_, *target);
+      RewritePatternSet controlFlowPatterns_(context);
+      populateLegalizeControlFlowPatterns(context, &controlFlowPatterns_);
+      controlFlowPatterns = std::move(controlFlowPatterns_);
+    }
     patterns = std::move(patterns_);
 
     return success();
   }
 
   void runOnOperation() override {
+    if (winogradOutputTileSize != 0 && winogradOutputTileSize != 2 &&
+        winogradOutputTileSize != 4) {
+      getOperation().emitError()
+          << "winograd-output-tile-size must be 0, 2 or 4";
+      return signalPassFailure();
+    }
+    if (enableControlFlow) {
+      // Only the control flow ops are rewritten, so that nothing else is
+      // folded before the conversion.
+      SmallVector<Operation *> controlFlowOps;
+      getOperation()->walk([&](Operation *op) {
+        if (isa<mlir::stablehlo::CaseOp, mlir::stablehlo::IfOp,
+                mlir::stablehlo::WhileOp>(op))
+          controlFlowOps.push_back(op);
+      });
+      GreedyRewriteConfig config;
+      config.strictMode = GreedyRewriteStrictness::ExistingOps;
+      (void)applyOpPatternsAndFold(controlFlowOps, controlFlowPatterns,
+                                   config);
+    }
     if (failed(applyPartialConversion(getOperation(), *target, patterns))) {
       return signalPassFailure();
     }
+    if (winogradOutputTileSize != 0 || enableIm2col) {
+      detail::rewriteConvolutionsToMatmuls(
+          getOperation(), winogradOutputTileSize, enableIm2col);
+    }
+    if (splitReductionRatio > 1) {
+      detail::splitReductions(getOperation(), splitReductionRatio);
+    }
+    if (forallNumThreads > 1) {
+      tileParallelLoopsToForall(getOperation(), forallNumThreads);
+    }
   }
 
  private:
   std::shared_ptr<ConversionTarget> target;
   FrozenRewritePatternSet patterns;
+  FrozenRewritePatternSet controlFlowPatterns;
   LinalgTypeConverter converter;
 };
 }  // namespace
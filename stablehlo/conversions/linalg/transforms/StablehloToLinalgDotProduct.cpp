@@ -14,8 +14,16 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
 #include "mlir/Dialect/SparseTensor/IR/SparseTensor.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/Dialect/Utils/ReshapeOpsUtils.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "stablehlo/conversions/linalg/transforms/LegalizeToLinalgUtils.h"
@@ -72,10 +80,62 @@ SmallVector<Value, 2> getDotOpEmptyTensorDynSizes(OpBuilder &b, Location loc,
   return dynShape;
 }
 
+// Returns the type of the accumulator of a dot with result `outputType`, which
+// is f32 for dense results of floats narrower than f32 if
+// `enableWidenedAccumulation` or an operand has HIGHEST precision, and
+// `outputType` otherwise.
+template <typename OpTy>
+ShapedType getAccumulatorType(OpBuilder &b, OpTy op, ShapedType outputType,
+                              bool enableWidenedAccumulation) {
+  auto floatType = dyn_cast<FloatType>(outputType.getElementType());
+  if (!floatType || floatType.getWidth() >= 32 ||
+      sparse_tensor::getSparseTensorEncoding(outputType))
+    return outputType;
+  bool isHighest = false;
+  if (std::optional<ArrayAttr> precisionConfig = op.getPrecisionConfig()) {
+    isHighest = llvm::any_of(*precisionConfig, [](Attribute attr) {
+      auto precision = dyn_cast<PrecisionAttr>(attr);
+      return precision && precision.getValue() == Precision::HIGHEST;
+    });
+  }
+  if (!enableWidenedAccumulation && !isHighest) return outputType;
+  return outputType.clone(b.getF32Type());
+}
+
+// Truncates the dot result `accumulator` to `outputType`, unless it already
+// has the element type of `outputType`.
+Value truncateAccumulator(OpBuilder &b, Location loc, Value accumulator,
+                          ShapedType outputType) {
+  auto accumulatorType = cast<ShapedType>(accumulator.getType());
+  if (accumulatorType.getElementType() == outputType.getElementType())
+    return accumulator;
+  SmallVector<Value> dynSizes;
+  for (int64_t i = 0, e = accumulatorType.getRank(); i < e; ++i) {
+    if (accumulatorType.isDynamicDim(i))
+      dynSizes.push_back(b.create<tensor::DimOp>(loc, accumulator, i));
+  }
+  Value emptyTensor = getEmptyTensor(b, loc, outputType, dynSizes);
+  int64_t rank = outputType.getRank();
+  return b
+      .create<linalg::GenericOp>(
+          loc, /*resultTensorTypes=*/TypeRange{outputType},
+          /*inputs=*/ValueRange{accumulator},
+          /*outputBuffers=*/ValueRange{emptyTensor},
+          SmallVector<AffineMap, 2>(2, b.getMultiDimIdentityMap(rank)),
+          getNParallelLoopsAttrs(rank),
+          [&](OpBuilder &nestedBuilder, Location nestedLoc, ValueRange args) {
+            Value truncated = nestedBuilder.create<arith::TruncFOp>(
+                nestedLoc, outputType.getElementType(), args[0]);
+            nestedBuilder.create<linalg::YieldOp>(nestedLoc, truncated);
+          })
+      ->getResult(0);
+}
+
 template <typename OpTy, typename LinalgOpTy>
 LogicalResult lowerDotOp(ConversionPatternRewriter &rewriter,
                          const TypeConverter *typeConverter, OpTy op,
-                         typename OpTy::Adaptor adaptor) {
+                         typename OpTy::Adaptor adaptor,
+                         bool enableWidenedAccumulation) {
   if (!opMatchesLinalgTarget<LinalgOpTy>(op)) return failure();
 
   auto loc = op.getLoc();
@@ -83,38 +143,60 @@ LogicalResult lowerDotOp(ConversionPatternRewriter &rewriter,
   // Convert unsigned to signed. This works because signed and unsigned
   // integer matmul is the same operation in two's complement.
   auto outputType = cast<ShapedType>(typeConverter->convertType(op.getType()));
+  ShapedType accumulatorType = getAccumulatorType(
+      rewriter, op, outputType, enableWidenedAccumulation);
 
   SmallVector<Value, 2> dynShape = getDotOpEmptyTensorDynSizes<LinalgOpTy>(
       rewriter, loc, adaptor.getLhs(), adaptor.getRhs());
 
   Value emptyTensor =
       !sparse_tensor::getSparseTensorEncoding(outputType)
-          ? getEmptyTensor(rewriter, loc, outputType, dynShape)
+          ? getEmptyTensor(rewriter, loc, accumulatorType, dynShape)
           : getEmptySparseTensor(rewriter, loc, outputType, dynShape);
   Value zeroTensor = fillTensorWithZeros(rewriter, loc, emptyTensor);
 
-  rewriter.replaceOpWithNewOp<LinalgOpTy>(
-      op, TypeRange{outputType}, ValueRange{adaptor.getLhs(), adaptor.getRhs()},
-      ValueRange{zeroTensor}, linalg::getPrunedAttributeList(op));
+  Value result =
+      rewriter
+          .create<LinalgOpTy>(loc, TypeRange{accumulatorType},
+                              ValueRange{adaptor.getLhs(), adaptor.getRhs()},
+                              ValueRange{zeroTensor},
+                              linalg::getPrunedAttributeList(op))
+          ->getResult(0);
+  rewriter.replaceOp(op,
+                     truncateAccumulator(rewriter, loc, result, outputType));
   return success();
 }
 
+// Base of the dot patterns, whose linalg ops accumulate results of floats
+// narrower than f32 in f32 and truncate them afterwards if
+// `enableWidenedAccumulation` or the dot has HIGHEST precision, rather than
+// accumulating in the result type.
+template <typename OpTy>
+struct DotConversionBase : OpConversionPattern<OpTy> {
+  DotConversionBase(const TypeConverter &typeConverter, MLIRContext *context,
+                    bool enableWidenedAccumulation, PatternBenefit benefit)
+      : OpConversionPattern<OpTy>(typeConverter, context, benefit),
+        enableWidenedAccumulation(enableWidenedAccumulation) {}
+
+  bool enableWidenedAccumulation;
+};
+
 template <typename LinalgOpTy>
-struct DotOpConversion final : OpConversionPattern<mlir::stablehlo::DotOp> {
-  using OpConversionPattern<mlir::stablehlo::DotOp>::OpConversionPattern;
+struct DotOpConversion final : DotConversionBase<mlir::stablehlo::DotOp> {
+  using DotConversionBase<mlir::stablehlo::DotOp>::DotConversionBase;
   using OpAdaptor = mlir::stablehlo::DotOp::Adaptor;
 
   LogicalResult matchAndRewrite(
       mlir::stablehlo::DotOp op, OpAdaptor adaptor,
       ConversionPatternRewriter &rewriter) const final {
     return lowerDotOp<DotOp, LinalgOpTy>(rewriter, getTypeConverter(), op,
-                                         adaptor);
+                                         adaptor, enableWidenedAccumulation);
   }
 };
 
 struct DotGeneralBatchMatMulOpConversion final
-    : OpConversionPattern<mlir::stablehlo::DotGeneralOp> {
-  using OpConversionPattern::OpConversionPattern;
+    : DotConversionBase<mlir::stablehlo::DotGeneralOp> {
+  using DotConversionBase::DotConversionBase;
 
   LogicalResult matchAndRewrite(
       mlir::stablehlo::DotGeneralOp op, OpAdaptor adaptor,
@@ -153,38 +235,183 @@ struct DotGeneralBatchMatMulOpConversion final
     // integer matmul is the same operation in two's complement.
     auto outputType =
         cast<ShapedType>(typeConverter->convertType(op.getType()));
-    Value emptyTensor =
-        getEmptyTensorFor(rewriter, loc, outputType, op, adaptor.getOperands());
+    ShapedType accumulatorType = getAccumulatorType(
+        rewriter, op, outputType, enableWidenedAccumulation);
+    Value emptyTensor = getEmptyTensorFor(rewriter, loc, accumulatorType, op,
+                                          adaptor.getOperands());
     Value zeroTensor = fillTensorWithZeros(rewriter, loc, emptyTensor);
     Operation *linalgOp = rewriter.create<linalg::BatchMatmulOp>(
-        loc, /*resultTensorTypes=*/TypeRange{outputType},
+        loc, /*resultTensorTypes=*/TypeRange{accumulatorType},
         /*inputs=*/ValueRange{adaptor.getLhs(), adaptor.getRhs()},
         /*outputBuffers=*/ValueRange{zeroTensor},
         linalg::getPrunedAttributeList(op));
 
-    rewriter.replaceOp(op, linalgOp->getResults());
+    rewriter.replaceOp(op, truncateAccumulator(rewriter, loc,
+                                               linalgOp->getResult(0),
+                                               outputType));
+    return success();
+  }
+};
+
+// Creates the named linalg op for a (batch) matmul whose operands may have
+// their contracting dimension before their free dimension.
+Value createNamedMatmul(OpBuilder &b, Location loc, bool isBatch,
+                        bool transposeLhs, bool transposeRhs, Type resultType,
+                        Value lhs, Value rhs, Value init,
+                        ArrayRef<NamedAttribute> attrs) {
+  auto create = [&](auto opTag) -> Value {
+    using LinalgOpTy = decltype(opTag);
+    return b
+        .create<LinalgOpTy>(loc, TypeRange{resultType}, ValueRange{lhs, rhs},
+                            ValueRange{init}, attrs)
+        ->getResult(0);
+  };
+  if (isBatch) {
+    if (transposeLhs) return create(linalg::BatchMatmulTransposeAOp());
+    if (transposeRhs) return create(linalg::BatchMatmulTransposeBOp());
+    return create(linalg::BatchMatmulOp());
+  }
+  if (transposeLhs) return create(linalg::MatmulTransposeAOp());
+  if (transposeRhs) return create(linalg::MatmulTransposeBOp());
+  return create(linalg::MatmulOp());
+}
+
+// Lowers dot_generals with leading batch dimensions, one contracting and one
+// free dimension per operand to named (batch) matmul ops, which downstream
+// tiling and vectorization handle much better than linalg.generic. Operands
+// whose contracting dimension precedes their free dimension use the
+// transposed variants, and multiple static batch dimensions are collapsed
+// into one.
+struct DotGeneralNamedMatmulOpConversion final
+    : DotConversionBase<mlir::stablehlo::DotGeneralOp> {
+  using DotConversionBase::DotConversionBase;
+
+  LogicalResult matchAndRewrite(
+      mlir::stablehlo::DotGeneralOp op, OpAdaptor adaptor,
+      ConversionPatternRewriter &rewriter) const final {
+    mlir::stablehlo::DotDimensionNumbersAttr dimNumbers =
+        op.getDotDimensionNumbers();
+    ArrayRef<int64_t> lhsBatchingDims = dimNumbers.getLhsBatchingDimensions();
+    ArrayRef<int64_t> rhsBatchingDims = dimNumbers.getRhsBatchingDimensions();
+    ArrayRef<int64_t> lhsContractingDims =
+        dimNumbers.getLhsContractingDimensions();
+    ArrayRef<int64_t> rhsContractingDims =
+        dimNumbers.getRhsContractingDimensions();
+
+    auto lhsType = cast<RankedTensorType>(adaptor.getLhs().getType());
+    auto rhsType = cast<RankedTensorType>(adaptor.getRhs().getType());
+    auto outputType =
+        cast<RankedTensorType>(typeConverter->convertType(op.getType()));
+    if (sparse_tensor::getSparseTensorEncoding(lhsType) ||
+        sparse_tensor::getSparseTensorEncoding(rhsType) ||
+        sparse_tensor::getSparseTensorEncoding(outputType))
+      return rewriter.notifyMatchFailure(op, "expected dense tensors");
+
+    int64_t numBatch = lhsBatchingDims.size();
+    auto isLeading = [](ArrayRef<int64_t> dims) {
+      return llvm::all_of(llvm::enumerate(dims), [](auto dim) {
+        return dim.value() == static_cast<int64_t>(dim.index());
+      });
+    };
+    if (!isLeading(lhsBatchingDims) || !isLeading(rhsBatchingDims))
+      return rewriter.notifyMatchFailure(op, "expected leading batch dims");
+    if (lhsContractingDims.size() != 1 || rhsContractingDims.size() != 1 ||
+        lhsType.getRank() != numBatch + 2 || rhsType.getRank() != numBatch + 2)
+      return rewriter.notifyMatchFailure(
+          op, "expected one contracting and one free dim per operand");
+
+    bool transposeLhs = lhsContractingDims[0] == numBatch;
+    bool transposeRhs = rhsContractingDims[0] == numBatch + 1;
+    if (transposeLhs && transposeRhs)
+      return rewriter.notifyMatchFailure(op, "expected one matmul layout");
+    // These are handled by the patterns for simple dots and batch matmuls.
+    if (!transposeLhs && !transposeRhs && numBatch <= 1)
+      return rewriter.notifyMatchFailure(op, "expected non-canonical layout");
+
+    Location loc = op.getLoc();
+    auto attrs = linalg::getPrunedAttributeList(op);
+    Type accumulatorElementType =
+        getAccumulatorType(rewriter, op, outputType, enableWidenedAccumulation)
+            .getElementType();
+    if (numBatch <= 1) {
+      auto accumulatorType = outputType.clone(accumulatorElementType);
+      Value emptyTensor = getEmptyTensorFor(rewriter, loc, accumulatorType, op,
+                                            adaptor.getOperands());
+      Value zeroTensor = fillTensorWithZeros(rewriter, loc, emptyTensor);
+      Value result = createNamedMatmul(
+          rewriter, loc, numBatch == 1, transposeLhs, transposeRhs,
+          accumulatorType, adaptor.getLhs(), adaptor.getRhs(), zeroTensor,
+          attrs);
+      rewriter.replaceOp(
+          op, truncateAccumulator(rewriter, loc, result, outputType));
+      return success();
+    }
+
+    // Collapse the batch dimensions into one, which requires them to be
+    // static to expand the result again.
+    ArrayRef<int64_t> batchShape = outputType.getShape().take_front(numBatch);
+    if (ShapedType::isDynamicShape(batchShape))
+      return rewriter.notifyMatchFailure(op, "expected static batch dims");
+    SmallVector<ReassociationIndices> reassociation(1);
+    for (int64_t i = 0; i < numBatch; ++i) reassociation[0].push_back(i);
+    reassociation.push_back({numBatch});
+    reassociation.push_back({numBatch + 1});
+    Value lhs = rewriter.create<tensor::CollapseShapeOp>(loc, adaptor.getLhs(),
+                                                         reassociation);
+    Value rhs = rewriter.create<tensor::CollapseShapeOp>(loc, adaptor.getRhs(),
+                                                         reassociation);
+
+    // The free dimension of each operand is the one which isn't contracted.
+    int64_t lhsFreeDim = transposeLhs ? 2 : 1;
+    int64_t rhsFreeDim = transposeRhs ? 1 : 2;
+    SmallVector<int64_t> collapsedShape = {
+        ShapedType::getNumElements(batchShape),
+        outputType.getDimSize(numBatch), outputType.getDimSize(numBatch + 1)};
+    SmallVector<Value> dynSizes;
+    if (ShapedType::isDynamic(collapsedShape[1]))
+      dynSizes.push_back(rewriter.create<tensor::DimOp>(loc, lhs, lhsFreeDim));
+    if (ShapedType::isDynamic(collapsedShape[2]))
+      dynSizes.push_back(rewriter.create<tensor::DimOp>(loc, rhs, rhsFreeDim));
+    auto collapsedType =
+        RankedTensorType::get(collapsedShape, outputType.getElementType());
+    auto accumulatorType = collapsedType.clone(accumulatorElementType);
+    Value emptyTensor =
+        getEmptyTensor(rewriter, loc, accumulatorType, dynSizes);
+    Value zeroTensor = fillTensorWithZeros(rewriter, loc, emptyTensor);
+    Value result = truncateAccumulator(
+        rewriter, loc,
+        createNamedMatmul(rewriter, loc, /*isBatch=*/true, transposeLhs,
+                          transposeRhs, accumulatorType, lhs, rhs, zeroTensor,
+                          attrs),
+        collapsedType);
+    rewriter.replaceOpWithNewOp<tensor::ExpandShapeOp>(op, outputType, result,
+                                                       reassociation);
     return success();
   }
 };
 
 struct DotGeneralOpConversion final
-    : OpConversionPattern<mlir::stablehlo::DotGeneralOp> {
-  using OpConversionPattern::OpConversionPattern;
+    : DotConversionBase<mlir::stablehlo::DotGeneralOp> {
+  using DotConversionBase::DotConversionBase;
   LogicalResult matchAndRewrite(
       mlir::stablehlo::DotGeneralOp op, OpAdaptor adaptor,
       ConversionPatternRewriter &rewriter) const final {
     if (op.isSimpleDot()) {
       if (succeeded(lowerDotOp<DotGeneralOp, linalg::MatmulOp>(
-              rewriter, getTypeConverter(), op, adaptor)))
+              rewriter, getTypeConverter(), op, adaptor,
+              enableWidenedAccumulation)))
         return success();
       if (succeeded(lowerDotOp<DotGeneralOp, linalg::MatvecOp>(
-              rewriter, getTypeConverter(), op, adaptor)))
+              rewriter, getTypeConverter(), op, adaptor,
+              enableWidenedAccumulation)))
         return success();
       if (succeeded(lowerDotOp<DotGeneralOp, linalg::VecmatOp>(
-              rewriter, getTypeConverter(), op, adaptor)))
+              rewriter, getTypeConverter(), op, adaptor,
+              enableWidenedAccumulation)))
         return success();
       if (succeeded(lowerDotOp<DotGeneralOp, linalg::DotOp>(
-              rewriter, getTypeConverter(), op, adaptor)))
+              rewriter, getTypeConverter(), op, adaptor,
+              enableWidenedAccumulation)))
         return success();
       std::string str;
       llvm::raw_string_ostream os(str);
@@ -222,8 +449,10 @@ struct DotGeneralOpConversion final
         llvm::cast<ShapedType>(adaptor.getRhs().getType()).getRank();
 
     Location loc = op.getLoc();
-    Value emptyTensor =
-        getEmptyTensorFor(rewriter, loc, outputType, op, adaptor.getOperands());
+    ShapedType accumulatorType = getAccumulatorType(
+        rewriter, op, outputType, enableWidenedAccumulation);
+    Value emptyTensor = getEmptyTensorFor(rewriter, loc, accumulatorType, op,
+                                          adaptor.getOperands());
     Value zeroTensor = fillTensorWithZeros(rewriter, loc, emptyTensor);
     SmallVector<AffineMap, 3> indexingMaps;
 
@@ -261,7 +490,7 @@ struct DotGeneralOpConversion final
     }
 
     Operation *linalgOp = rewriter.create<linalg::GenericOp>(
-        loc, /*resultTensorTypes=*/TypeRange{outputType},
+        loc, /*resultTensorTypes=*/TypeRange{accumulatorType},
         /*inputs=*/ValueRange{adaptor.getLhs(), adaptor.getRhs()},
         /*outputBuffers=*/ValueRange{zeroTensor}, indexingMaps,
         getParallelAndReductionIterators(
@@ -273,7 +502,9 @@ struct DotGeneralOpConversion final
         },
         linalg::getPrunedAttributeList(op));
 
-    rewriter.replaceOp(op, linalgOp->getResults());
+    rewriter.replaceOp(op, truncateAccumulator(rewriter, loc,
+                                               linalgOp->getResult(0),
+                                               outputType));
     return success();
   }
 };
@@ -283,16 +514,16 @@ struct DotGeneralOpConversion final
 namespace detail {
 void populateStablehloDotProdToLinalgConversionPatterns(
     MLIRContext *context, TypeConverter &typeConverter,
-    RewritePatternSet *patterns) {
+    RewritePatternSet *patterns, bool enableWidenedAccumulation) {
   // Ensure specialized patterns are higher priority than their generic
   // versions.
   patterns->add<
       DotOpConversion<linalg::MatmulOp>, DotOpConversion<linalg::MatvecOp>,
       DotOpConversion<linalg::VecmatOp>, DotOpConversion<linalg::DotOp>,
-      DotGeneralBatchMatMulOpConversion>(typeConverter, context,
-                                         PatternBenefit(2));
-  patterns->add<DotGeneralOpConversion>(typeConverter, context,
-                                        PatternBenefit(1));
+      DotGeneralBatchMatMulOpConversion, DotGeneralNamedMatmulOpConversion>(
+      typeConverter, context, enableWidenedAccumulation, PatternBenefit(2));
+  patterns->add<DotGeneralOpConversion>(
+      typeConverter, context, enableWidenedAccumulation, PatternBenefit(1));
 }
 }  // namespace detail
 }  // namespace mlir::stablehlo
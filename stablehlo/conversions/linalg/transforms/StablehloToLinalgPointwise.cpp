@@ -18,6 +18,11 @@ limitations under the License.
 // These patterns are separated out to their own file to save on the compilation
 // times, given that we instantiate a large number of class templates here.
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "mlir/Dialect/SparseTensor/IR/SparseTensor.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
 #include "mlir/IR/ValueRange.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
@@ -211,9 +216,237 @@ struct PointwiseToLinalgConverter final : OpConversionPattern<OpTy> {
     return success();
   }
 };
+
+/// Elementwise ops which can be converted as part of a fused linalg.generic.
+using FusibleElementwiseOps = ElementwiseStablehloOps;
+
+/// Returns whether the operands and results of `op` are dense tensors which
+/// the type converter leaves unchanged, so that they can be used as is.
+bool hasUnconvertedDenseTypes(Operation *op,
+                              const TypeConverter &typeConverter) {
+  auto isUnconverted = [&](Type type) {
+    return isa<RankedTensorType>(type) &&
+           !sparse_tensor::getSparseTensorEncoding(type) &&
+           typeConverter.convertType(type) == type;
+  };
+  return llvm::all_of(op->getOperandTypes(), isUnconverted) &&
+         llvm::all_of(op->getResultTypes(), isUnconverted);
+}
+
+/// Returns whether `op` is an elementwise op which can be fused.
+bool isFusibleElementwiseOp(Operation *op,
+                            const TypeConverter &typeConverter) {
+  if (!FusibleElementwiseOps::contains(op) || op->getNumResults() != 1 ||
+      isInBodyOfLinalgOps(op) || !hasUnconvertedDenseTypes(op, typeConverter))
+    return false;
+  auto resultTy = cast<RankedTensorType>(op->getResult(0).getType());
+  Type elementTy = resultTy.getElementType();
+  if (resultTy.getRank() == 0 ||
+      !(elementTy.isSignlessIntOrFloat() || isa<ComplexType>(elementTy)))
+    return false;
+  return llvm::all_of(op->getOperands(), [&](Value operand) {
+    return isScalar(operand) || getRank(operand) == resultTy.getRank();
+  });
+}
+
+/// Returns whether `op` is a broadcast which can be fused into its user,
+/// which requires a static operand to know which dimensions are expanded.
+bool isFusibleBroadcast(Operation *op, const TypeConverter &typeConverter) {
+  auto broadcastOp = dyn_cast<mlir::stablehlo::BroadcastInDimOp>(op);
+  return broadcastOp && !isInBodyOfLinalgOps(op) &&
+         cast<ShapedType>(broadcastOp.getOperand().getType())
+             .hasStaticShape() &&
+         hasUnconvertedDenseTypes(op, typeConverter);
+}
+
+/// Returns the elementwise op which `op` is fused into, if any. Ops are only
+/// fused into their only user, so that no value is computed twice.
+Operation *getFusedUser(Operation *op, const TypeConverter &typeConverter) {
+  bool isBroadcast = isFusibleBroadcast(op, typeConverter);
+  if (!isBroadcast && !isFusibleElementwiseOp(op, typeConverter))
+    return nullptr;
+  Value result = op->getResult(0);
+  if (!result.hasOneUse()) return nullptr;
+  Operation *user = *result.getUsers().begin();
+  if (user->getBlock() != op->getBlock() ||
+      !isFusibleElementwiseOp(user, typeConverter) ||
+      getRank(user->getResult(0)) != getRank(result))
+    return nullptr;
+  // The sizes of dynamic results are taken from inputs which aren't
+  // broadcasted.
+  if (isBroadcast &&
+      !cast<ShapedType>(user->getResult(0).getType()).hasStaticShape())
+    return nullptr;
+  return user;
+}
+
+/// Returns the ops which are fused into the linalg.generic of `root` in
+/// program order, including `root`.
+SmallVector<Operation *> getFusedOps(Operation *root,
+                                     const TypeConverter &typeConverter) {
+  SmallVector<Operation *> fusedOps = {root};
+  bool hasIdentityInput = false;
+  for (size_t i = 0; i < fusedOps.size(); ++i) {
+    if (isa<mlir::stablehlo::BroadcastInDimOp>(fusedOps[i])) continue;
+    for (Value operand : fusedOps[i]->getOperands()) {
+      Operation *producer = operand.getDefiningOp();
+      if (producer && getFusedUser(producer, typeConverter) == fusedOps[i]) {
+        fusedOps.push_back(producer);
+      } else if (!isScalar(operand)) {
+        hasIdentityInput = true;
+      }
+    }
+  }
+  // Dynamic sizes of the result are taken from an input which isn't
+  // broadcasted, e.g. a dynamic result can't be computed from constants
+  // and results of ops which aren't fused.
+  if (!hasIdentityInput &&
+      !cast<ShapedType>(root->getResult(0).getType()).hasStaticShape())
+    return {root};
+  llvm::sort(fusedOps,
+             [](Operation *a, Operation *b) { return a->isBeforeInBlock(b); });
+  return fusedOps;
+}
+
+/// Returns the indexing map of the operand of `broadcastOp` in a loop nest
+/// over its result. Dimensions which are expanded are always accessed at 0.
+AffineMap getBroadcastIndexingMap(mlir::stablehlo::BroadcastInDimOp broadcastOp,
+                                  MLIRContext *context) {
+  auto operandTy = cast<ShapedType>(broadcastOp.getOperand().getType());
+  auto resultTy = cast<ShapedType>(broadcastOp.getType());
+  SmallVector<AffineExpr> exprs;
+  for (auto [operandDim, resultDim] :
+       llvm::enumerate(broadcastOp.getBroadcastDimensions())) {
+    bool isExpanded = operandTy.getDimSize(operandDim) == 1 &&
+                      resultTy.getDimSize(resultDim) != 1;
+    exprs.push_back(isExpanded ? getAffineConstantExpr(0, context)
+                               : getAffineDimExpr(resultDim, context));
+  }
+  return AffineMap::get(resultTy.getRank(), /*symbolCount=*/0, exprs, context);
+}
+
+/// Converts connected elementwise HLO ops, and broadcasts of their operands,
+/// to a single linalg.generic whose body contains the scalar operations of all
+/// of them. This avoids materializing the intermediate tensors and doesn't
+/// need a separate fusion pass. An op is fused into its user if it's the
+/// only one, and the types of the ops don't need to be converted.
+///
+/// The pattern matches every op of a group, and the first op of the group
+/// which is converted converts the whole group. Groups of one op are left to
+/// the patterns which convert single ops.
+struct FusedPointwiseToLinalgConverter final : ConversionPattern {
+  FusedPointwiseToLinalgConverter(TypeConverter &typeConverter,
+                                  MLIRContext *context)
+      : ConversionPattern(typeConverter, MatchAnyOpTypeTag(),
+                          /*benefit=*/2, context) {}
+
+  LogicalResult matchAndRewrite(
+      Operation *op, ArrayRef<Value> /*operands*/,
+      ConversionPatternRewriter &rewriter) const override {
+    if (!isFusibleElementwiseOp(op, *typeConverter) &&
+        !isFusibleBroadcast(op, *typeConverter))
+      return failure();
+    Operation *root = op;
+    while (Operation *user = getFusedUser(root, *typeConverter)) root = user;
+    SmallVector<Operation *> fusedOps = getFusedOps(root, *typeConverter);
+    if (fusedOps.size() < 2 || !llvm::is_contained(fusedOps, op))
+      return rewriter.notifyMatchFailure(op, "no ops to fuse");
+
+    MLIRContext *context = rewriter.getContext();
+    auto resultTy = cast<RankedTensorType>(root->getResult(0).getType());
+    int64_t rank = resultTy.getRank();
+    AffineMap scalarMap = AffineMap::get(rank, 0, context);
+    AffineMap idMap = rewriter.getMultiDimIdentityMap(rank);
+
+    // Find the inputs of the fused ops, which are deduplicated.
+    llvm::DenseSet<Operation *> fusedOpSet(fusedOps.begin(), fusedOps.end());
+    SmallVector<Value> inputs;
+    SmallVector<AffineMap> maps;
+    llvm::DenseMap<OpOperand *, unsigned> inputIndices;
+    for (Operation *fusedOp : fusedOps) {
+      auto broadcastOp = dyn_cast<mlir::stablehlo::BroadcastInDimOp>(fusedOp);
+      for (OpOperand &operand : fusedOp->getOpOperands()) {
+        Operation *producer = operand.get().getDefiningOp();
+        if (producer && fusedOpSet.contains(producer)) continue;
+        AffineMap map = broadcastOp
+                            ? getBroadcastIndexingMap(broadcastOp, context)
+                        : isScalar(operand.get()) ? scalarMap
+                                                  : idMap;
+        Value input = rewriter.getRemappedValue(operand.get());
+        unsigned index = 0;
+        while (index < inputs.size() &&
+               (inputs[index] != input || maps[index] != map))
+          ++index;
+        if (index == inputs.size()) {
+          inputs.push_back(input);
+          maps.push_back(map);
+        }
+        inputIndices[&operand] = index;
+      }
+    }
+
+    Location loc = root->getLoc();
+    rewriter.setInsertionPoint(root);
+    SmallVector<Value> dynSizes;
+    for (int64_t i = 0; i < rank; ++i) {
+      if (!resultTy.isDynamicDim(i)) continue;
+      auto *it = llvm::find(maps, idMap);
+      dynSizes.push_back(
+          rewriter.create<tensor::DimOp>(loc, inputs[it - maps.begin()], i));
+    }
+    Value output = getEmptyTensor(rewriter, loc, resultTy, dynSizes);
+    maps.push_back(idMap);
+
+    bool failed = false;
+    auto linalgOp = rewriter.create<linalg::GenericOp>(
+        loc, TypeRange{resultTy}, inputs, output, maps,
+        getNParallelLoopsAttrs(rank),
+        [&](OpBuilder &nestedBuilder, Location /*nested_loc*/,
+            ValueRange args) {
+          llvm::DenseMap<Value, Value> scalars;
+          for (Operation *fusedOp : fusedOps) {
+            SmallVector<Value> scalarArgs;
+            for (OpOperand &operand : fusedOp->getOpOperands()) {
+              auto it = inputIndices.find(&operand);
+              scalarArgs.push_back(it != inputIndices.end()
+                                       ? args[it->second]
+                                       : scalars.lookup(operand.get()));
+            }
+            Value result = fusedOp->getResult(0);
+            if (isa<mlir::stablehlo::BroadcastInDimOp>(fusedOp)) {
+              scalars[result] = scalarArgs.front();
+              continue;
+            }
+            Value scalarResult = FusibleElementwiseOps::mapToScalarOp(
+                fusedOp, getElementTypeOrSelf(result), scalarArgs,
+                &nestedBuilder);
+            if (!scalarResult) {
+              failed = true;
+              return;
+            }
+            scalars[result] = scalarResult;
+          }
+          nestedBuilder.create<linalg::YieldOp>(
+              loc, scalars.lookup(root->getResult(0)));
+        },
+        linalg::getPrunedAttributeList(root));
+    if (failed) return failure();
+
+    rewriter.replaceOp(root, linalgOp->getResults());
+    for (Operation *fusedOp : llvm::reverse(fusedOps))
+      if (fusedOp != root) rewriter.eraseOp(fusedOp);
+    return success();
+  }
+};
 }  // namespace
 
 namespace detail {
+void populateFusedPointwiseStablehloToLinalgConversionPatterns(
+    MLIRContext *context, TypeConverter &typeConverter,
+    RewritePatternSet *patterns) {
+  patterns->add<FusedPointwiseToLinalgConverter>(typeConverter, context);
+}
+
 void populatePointwiseStablehloToLinalgConversionPatterns(
     MLIRContext *context, TypeConverter &typeConverter,
     RewritePatternSet *patterns, bool enablePrimitiveOps) {
@@ -17,7 +17,14 @@ limitations under the License.
 // Implements logic for lowering StableHLO random number generation to Linalg
 // dialect.
 
+#include <cstdint>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/Dialect/Utils/ReshapeOpsUtils.h"
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
@@ -342,13 +349,80 @@ std::pair<ShapedType, int64_t> threeFry32Shape(ShapedType resultTy) {
   return {RankedTensorType::get(newShape, resultTy.getElementType()), halfDim};
 }
 
+// Interleaves the 1-D `lanes` of values generated for every counter into a
+// tensor of `shape`, such that index j of `dim` holds lane j % n of the
+// counter at index j / n, where n is the number of lanes. The counters are
+// laid out like `shape` with `dim` divided by n, rounded up. This is the
+// layout of the XLA implementation, built with a single elementwise generic
+// which selects the lane, rather than concatenating, reshaping and slicing,
+// so that it vectorizes.
+Value interleaveLanes(OpBuilder &builder, Location loc, ValueRange lanes,
+                      ArrayRef<int64_t> shape, int64_t dim) {
+  int64_t numLanes = lanes.size();
+  int64_t rank = shape.size();
+  Type elementTy = cast<ShapedType>(lanes.front().getType()).getElementType();
+
+  SmallVector<int64_t> laneShape(shape);
+  laneShape[dim] = llvm::divideCeil(shape[dim], numLanes);
+  auto laneTy = RankedTensorType::get(laneShape, elementTy);
+  SmallVector<Value> inputs;
+  for (Value lane : lanes)
+    inputs.push_back(reshapeToTarget(builder, loc, laneTy, lane));
+
+  // The lanes are the loop following `dim`, which the inputs don't use.
+  SmallVector<int64_t> interleavedShape(laneShape);
+  interleavedShape.insert(interleavedShape.begin() + dim + 1, numLanes);
+  SmallVector<AffineExpr> laneExprs;
+  for (int64_t i = 0; i <= rank; ++i)
+    if (i != dim + 1) laneExprs.push_back(builder.getAffineDimExpr(i));
+  SmallVector<AffineMap> indexingMaps(
+      numLanes, AffineMap::get(rank + 1, 0, laneExprs, builder.getContext()));
+  indexingMaps.push_back(builder.getMultiDimIdentityMap(rank + 1));
+  SmallVector<utils::IteratorType> iterators(rank + 1,
+                                             utils::IteratorType::parallel);
+
+  Value empty =
+      builder.create<tensor::EmptyOp>(loc, interleavedShape, elementTy);
+  auto generic = builder.create<linalg::GenericOp>(
+      loc, empty.getType(), inputs, empty, indexingMaps, iterators,
+      [&](OpBuilder &b, Location nestedLoc, ValueRange args) {
+        Value lane = b.create<linalg::IndexOp>(nestedLoc, dim + 1);
+        Value value = args[numLanes - 1];
+        for (int64_t i = numLanes - 2; i >= 0; --i) {
+          Value index = b.create<arith::ConstantIndexOp>(nestedLoc, i);
+          Value isLane = b.create<arith::CmpIOp>(
+              nestedLoc, arith::CmpIPredicate::eq, lane, index);
+          value = b.create<arith::SelectOp>(nestedLoc, isLane, args[i], value);
+        }
+        b.create<linalg::YieldOp>(nestedLoc, value);
+      });
+
+  // Merge the lanes into `dim` and drop the values past its end.
+  SmallVector<ReassociationIndices> reassociation;
+  for (int64_t i = 0; i < rank; ++i) {
+    if (i < dim) reassociation.push_back({i});
+    if (i == dim) reassociation.push_back({i, i + 1});
+    if (i > dim) reassociation.push_back({i + 1});
+  }
+  SmallVector<int64_t> collapsedShape(shape);
+  collapsedShape[dim] = laneShape[dim] * numLanes;
+  Value collapsed = builder.create<tensor::CollapseShapeOp>(
+      loc, RankedTensorType::get(collapsedShape, elementTy),
+      generic.getResult(0), reassociation);
+  if (collapsedShape[dim] == shape[dim]) return collapsed;
+
+  SmallVector<OpFoldResult> offsets(rank, builder.getIndexAttr(0));
+  SmallVector<OpFoldResult> sizes;
+  for (int64_t size : shape) sizes.push_back(builder.getIndexAttr(size));
+  SmallVector<OpFoldResult> strides(rank, builder.getIndexAttr(1));
+  return builder.create<tensor::ExtractSliceOp>(
+      loc, RankedTensorType::get(shape, elementTy), collapsed, offsets, sizes,
+      strides);
+}
+
 /// This implementation generates a 32-bit tensor of ThreeFry random numbers.
-/// It matches the XLA implementation bit-exact and includes an inefficient
-/// method of concatenating / slicing the pairs of generated numbers.
-///
-/// We should consider dropping the complex slicing and simply generating
-/// 2x the values, then downcast to a 32-bit. It substantially simplifies
-/// the computation and avoids the concat / slice behavior.
+/// It matches the XLA implementation bit-exact by interleaving the pairs of
+/// generated numbers along the halved dimension.
 LogicalResult generateLinalgThreeFry32(OpBuilder &builder, Location loc,
                                        ShapedType resultTy, Value &store,
                                        Value &result) {
@@ -407,33 +481,10 @@ LogicalResult generateLinalgThreeFry32(OpBuilder &builder, Location loc,
     return success();
   }
 
-  // Reshape to the target size and concatenate on the dimension following the
-  // half dimension.
-  Value random0 =
-      reshapeToTarget(builder, loc, intermediateType, generic.getResult(0));
-  Value random1 =
-      reshapeToTarget(builder, loc, intermediateType, generic.getResult(1));
-  Value concatenate = builder.create<mlir::stablehlo::ConcatenateOp>(
-      loc, ValueRange{random0, random1},
-      builder.getI64IntegerAttr(halfDim + 1));
-
-  // Collapse the concat dimension back into the parent.
-  llvm::SmallVector<int64_t> collapseShape(resultTy.getShape());
-  collapseShape[halfDim] =
-      collapseShape[halfDim] + (collapseShape[halfDim] & 1);
-  Value reshape = builder.create<mlir::stablehlo::ReshapeOp>(
-      loc, resultTy.clone(collapseShape), concatenate);
-
-  // Slice to only the required results.
-  llvm::SmallVector<int64_t> offset(resultTy.getRank(), 0);
-  llvm::SmallVector<int64_t> stride(resultTy.getRank(), 1);
-  Value slice = builder.create<mlir::stablehlo::SliceOp>(
-      loc, resultTy, reshape, offset, resultTy.getShape(), stride);
-
-  // Set the new tensor values.
+  // Interleave the pairs along the halved dimension.
+  result = interleaveLanes(builder, loc, generic.getResults(),
+                           resultTy.getShape(), halfDim);
   store = setState64(builder, loc, store, newState);
-  result = slice;
-
   return success();
 }
 
@@ -563,9 +614,6 @@ LogicalResult generateLinalgPhilox32(OpBuilder &builder, Location loc,
 
   int64_t numElements = resultTy.getNumElements();
   int64_t count = (numElements + 3) / 4;
-  ShapedType intermediateType =
-      RankedTensorType::get({count, 1}, resultTy.getElementType());
-  int64_t concatDim = 1;
 
   // Compute the number of random i64s generated and increment state.
   Value countVal =
@@ -611,39 +659,12 @@ LogicalResult generateLinalgPhilox32(OpBuilder &builder, Location loc,
     return success();
   }
 
-  Value r0 =
-      reshapeToTarget(builder, loc, intermediateType, generic.getResult(0));
-  Value r1 =
-      reshapeToTarget(builder, loc, intermediateType, generic.getResult(1));
-  Value r2 =
-      reshapeToTarget(builder, loc, intermediateType, generic.getResult(2));
-  Value r3 =
-      reshapeToTarget(builder, loc, intermediateType, generic.getResult(3));
-
-  Value concatenate = builder.create<mlir::stablehlo::ConcatenateOp>(
-      loc, ValueRange{r0, r1, r2, r3}, builder.getI64IntegerAttr(concatDim));
-
-  // Collapse the concat dimension back into the parent.
-  llvm::SmallVector<int64_t> collapseShape(intermediateType.getShape());
-  collapseShape[0] = collapseShape[0] * 4;
-  Value reshapeIntermediate = builder.create<mlir::stablehlo::ReshapeOp>(
-      loc, resultTy.clone(collapseShape), concatenate);
-
-  // Slice to only the required results.
-  collapseShape[0] = resultTy.getNumElements();
-
-  llvm::SmallVector<int64_t> offset(collapseShape.size(), 0);
-  llvm::SmallVector<int64_t> stride(collapseShape.size(), 1);
-  Value slice = builder.create<mlir::stablehlo::SliceOp>(
-      loc, intermediateType.clone(collapseShape), reshapeIntermediate, offset,
-      collapseShape, stride);
-  Value reshapeResult =
-      builder.create<mlir::stablehlo::ReshapeOp>(loc, resultTy, slice);
-
-  // Set the new tensor values.
+  // Interleave the values of every counter and reshape to the target.
+  Value interleaved =
+      interleaveLanes(builder, loc, generic.getResults(),
+                      ArrayRef<int64_t>(numElements), /*dim=*/0);
+  result = reshapeToTarget(builder, loc, resultTy, interleaved);
   store = setState64(builder, loc, store, newState);
-  result = reshapeResult;
-
   return success();
 }
 
@@ -660,9 +681,6 @@ LogicalResult generateLinalgPhilox64(OpBuilder &builder, Location loc,
 
   int64_t numElements = resultTy.getNumElements();
   int64_t count = (numElements + 1) / 2;
-  ShapedType intermediateType =
-      RankedTensorType::get({count, 1}, resultTy.getElementType());
-  int64_t concatDim = 1;
 
   // Compute the number of random i64s generated and increment state.
   Value countVal =
@@ -704,34 +722,12 @@ LogicalResult generateLinalgPhilox64(OpBuilder &builder, Location loc,
     return success();
   }
 
-  Value r0 =
-      reshapeToTarget(builder, loc, intermediateType, generic.getResult(0));
-  Value r1 =
-      reshapeToTarget(builder, loc, intermediateType, generic.getResult(1));
-  Value concatenate = builder.create<mlir::stablehlo::ConcatenateOp>(
-      loc, ValueRange{r0, r1}, builder.getI64IntegerAttr(concatDim));
-
-  // Collapse the concat dimension back into the parent.
-  llvm::SmallVector<int64_t> collapseShape(intermediateType.getShape());
-  collapseShape[0] = collapseShape[0] * 2;
-  Value reshapeIntermediate = builder.create<mlir::stablehlo::ReshapeOp>(
-      loc, resultTy.clone(collapseShape), concatenate);
-
-  // Slice to only the required results.
-  collapseShape[0] = resultTy.getNumElements();
-
-  llvm::SmallVector<int64_t> offset(collapseShape.size(), 0);
-  llvm::SmallVector<int64_t> stride(collapseShape.size(), 1);
-  Value slice = builder.create<mlir::stablehlo::SliceOp>(
-      loc, intermediateType.clone(collapseShape), reshapeIntermediate, offset,
-      collapseShape, stride);
-  Value reshapeResult =
-      builder.create<mlir::stablehlo::ReshapeOp>(loc, resultTy, slice);
-
-  // Set the new tensor values.
+  // Interleave the values of every counter and reshape to the target.
+  Value interleaved =
+      interleaveLanes(builder, loc, generic.getResults(),
+                      ArrayRef<int64_t>(numElements), /*dim=*/0);
+  result = reshapeToTarget(builder, loc, resultTy, interleaved);
   store = setState64(builder, loc, store, newState);
-  result = reshapeResult;
-
   return success();
 }
 
@@ -18,8 +18,17 @@ limitations under the License.
 // These patterns are separated out to their own file to save on the compilation
 // times.
 
+#include <cstdint>
+
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/Linalg/Transforms/Transforms.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/SparseTensor/IR/SparseTensor.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/PatternMatch.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "stablehlo/conversions/linalg/transforms/LegalizeToLinalgUtils.h"
@@ -141,6 +150,20 @@ struct ReduceOpToGenericConverter final
 
       SmallVector<Value, 8> dynShape = getReduceOpEmptyTensorDynSizes(
           rewriter, loc, operand, cast<ShapedType>(resultType), reductionDims);
+
+      // Sparse results are reduced into an empty sparse tensor, which holds
+      // zeros, so that they aren't densified by filling them with the init
+      // value. This requires the reduction to start from zero.
+      if (sparse_tensor::getSparseTensorEncoding(resultType)) {
+        if (!matchPattern(initValue, m_Zero()) &&
+            !matchPattern(initValue, m_AnyZeroFloat()))
+          return rewriter.notifyMatchFailure(
+              op, "expected zero init value for sparse result");
+        outputs.push_back(getEmptySparseTensor(
+            rewriter, loc, cast<ShapedType>(resultType), dynShape));
+        continue;
+      }
+
       auto emptyTensor =
           getEmptyTensor(rewriter, loc, cast<ShapedType>(resultType), dynShape);
       Value filledTensor =
@@ -472,6 +495,137 @@ struct ReduceWindowOpOnTensorsGenericConversion final
   }
 };
 
+/// Converts the reduce_window ops which frameworks emit for cumulative sums to
+/// a loop over the scanned dimension which adds every slice of the input to
+/// the sum of the previous ones. This takes O(output) additions rather than
+/// the O(output * window) of a generic window reduction. A cumulative sum is
+/// a sum with a zero init value over a window which covers the whole scanned
+/// dimension, padded by its size - 1 before (or after, for reverse sums) it.
+struct ReduceWindowOpCumulativeSumConversion final
+    : OpConversionPattern<mlir::stablehlo::ReduceWindowOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      mlir::stablehlo::ReduceWindowOp op, OpAdaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    if (op.getInputs().size() != 1)
+      return rewriter.notifyMatchFailure(op, "expected a single input");
+    Block &body = op.getBody().front();
+    auto addOp = dyn_cast<mlir::stablehlo::AddOp>(body.front());
+    if (!addOp || &body.front() != body.getTerminator()->getPrevNode() ||
+        body.getTerminator()->getOperand(0) != addOp.getResult() ||
+        !isa<BlockArgument>(addOp.getLhs()) ||
+        !isa<BlockArgument>(addOp.getRhs()) ||
+        addOp.getLhs() == addOp.getRhs())
+      return rewriter.notifyMatchFailure(op, "expected a sum");
+    Value initValue = op.getInitValues().front();
+    if (!matchPattern(initValue, m_Zero()) &&
+        !matchPattern(initValue, m_AnyZeroFloat()))
+      return rewriter.notifyMatchFailure(op, "expected a zero init value");
+
+    auto inputType =
+        dyn_cast<RankedTensorType>(adaptor.getInputs()[0].getType());
+    if (!inputType || !inputType.hasStaticShape() ||
+        !inputType.getElementType().isIntOrFloat())
+      return rewriter.notifyMatchFailure(op, "expected static int/float input");
+    auto isOne = [](int64_t value) { return value == 1; };
+    if ((op.getWindowStrides() &&
+         !llvm::all_of(*op.getWindowStrides(), isOne)) ||
+        (op.getBaseDilations() &&
+         !llvm::all_of(*op.getBaseDilations(), isOne)) ||
+        (op.getWindowDilations() &&
+         !llvm::all_of(*op.getWindowDilations(), isOne)))
+      return rewriter.notifyMatchFailure(op, "expected unit strides");
+
+    // Find the scanned dimension, which is the only one with a window.
+    int64_t rank = inputType.getRank();
+    ArrayRef<int64_t> windowDims = op.getWindowDimensions();
+    auto isWindowDim = [](int64_t w) { return w != 1; };
+    if (llvm::count_if(windowDims, isWindowDim) != 1)
+      return rewriter.notifyMatchFailure(op, "expected a single window dim");
+    int64_t scanDim =
+        llvm::find_if(windowDims, isWindowDim) - windowDims.begin();
+    int64_t size = inputType.getDimSize(scanDim);
+    SmallVector<int64_t> padding(2 * rank, 0);
+    if (op.getPadding()) padding = extract1DVector(*op.getPadding());
+    for (int64_t i = 0; i < rank; ++i) {
+      if (i != scanDim && (padding[2 * i] != 0 || padding[2 * i + 1] != 0))
+        return rewriter.notifyMatchFailure(op, "expected no other padding");
+    }
+    bool isForward =
+        padding[2 * scanDim] == size - 1 && padding[2 * scanDim + 1] == 0;
+    bool isReverse =
+        padding[2 * scanDim] == 0 && padding[2 * scanDim + 1] == size - 1;
+    if (windowDims[scanDim] != size || (!isForward && !isReverse))
+      return rewriter.notifyMatchFailure(op, "expected a cumulative sum");
+
+    auto resultType = dyn_cast_or_null<RankedTensorType>(
+        typeConverter->convertType(op.getResultTypes()[0]));
+    if (!resultType || resultType.getShape() != inputType.getShape())
+      return rewriter.notifyMatchFailure(op, "type conversion failed");
+
+    // Every iteration extracts the slice of the input at the current index,
+    // adds it to the running sum and inserts the sum into the result.
+    Location loc = op.getLoc();
+    Type elementType = resultType.getElementType();
+    SmallVector<int64_t> sliceShape(inputType.getShape());
+    sliceShape.erase(sliceShape.begin() + scanDim);
+    auto sliceType = RankedTensorType::get(sliceShape, elementType);
+    Value sum = fillTensorWithZeros(
+        rewriter, loc,
+        rewriter.create<tensor::EmptyOp>(loc, sliceShape, elementType));
+    Value result = rewriter.create<tensor::EmptyOp>(
+        loc, resultType.getShape(), elementType);
+    Value lowerBound = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+    Value upperBound = rewriter.create<arith::ConstantIndexOp>(loc, size);
+    Value step = rewriter.create<arith::ConstantIndexOp>(loc, 1);
+    Value input = adaptor.getInputs()[0];
+    AffineMap idMap = rewriter.getMultiDimIdentityMap(rank - 1);
+
+    auto forOp = rewriter.create<scf::ForOp>(
+        loc, lowerBound, upperBound, step, ValueRange{sum, result},
+        [&](OpBuilder &b, Location loc, Value iv, ValueRange args) {
+          Value index = iv;
+          if (isReverse) {
+            Value last = b.create<arith::ConstantIndexOp>(loc, size - 1);
+            index = b.create<arith::SubIOp>(loc, last, iv);
+          }
+          SmallVector<OpFoldResult> offsets(rank, b.getIndexAttr(0));
+          offsets[scanDim] = index;
+          SmallVector<OpFoldResult> sizes;
+          for (int64_t dimSize : inputType.getShape())
+            sizes.push_back(b.getIndexAttr(dimSize));
+          sizes[scanDim] = b.getIndexAttr(1);
+          SmallVector<OpFoldResult> strides(rank, b.getIndexAttr(1));
+
+          Value slice = b.create<tensor::ExtractSliceOp>(
+              loc, sliceType, input, offsets, sizes, strides);
+          auto addOp = b.create<linalg::GenericOp>(
+              loc, TypeRange{sliceType}, slice, args[0],
+              SmallVector<AffineMap>{idMap, idMap},
+              getNParallelLoopsAttrs(rank - 1),
+              [&](OpBuilder &nestedBuilder, Location nestedLoc,
+                  ValueRange blockArgs) {
+                Value add;
+                if (isa<FloatType>(elementType)) {
+                  add = nestedBuilder.create<arith::AddFOp>(
+                      nestedLoc, blockArgs[1], blockArgs[0]);
+                } else {
+                  add = nestedBuilder.create<arith::AddIOp>(
+                      nestedLoc, blockArgs[1], blockArgs[0]);
+                }
+                nestedBuilder.create<linalg::YieldOp>(nestedLoc, add);
+              });
+          Value newSum = addOp->getResult(0);
+          Value newResult = b.create<tensor::InsertSliceOp>(
+              loc, newSum, args[1], offsets, sizes, strides);
+          b.create<scf::YieldOp>(loc, ValueRange{newSum, newResult});
+        });
+    rewriter.replaceOp(op, forOp.getResult(1));
+    return success();
+  }
+};
+
 struct ReduceWindowOpConversion final
     : OpConversionPattern<mlir::stablehlo::ReduceWindowOp> {
   using OpConversionPattern::OpConversionPattern;
@@ -601,9 +755,9 @@ struct ReduceWindowOpConversion final
       Value input = std::get<1>(it);
       Value initValue = std::get<2>(it);
       auto resultType = cast<ShapedType>(result.getType());
-      if (!cast<ShapedType>(input.getType()).getElementType().isF32()) {
-        return rewriter.notifyMatchFailure(op,
-                                           "expected element type to be f32");
+      if (!isa<FloatType>(cast<ShapedType>(input.getType()).getElementType())) {
+        return rewriter.notifyMatchFailure(
+            op, "expected element type to be floating-point");
       }
 
       // Create a fake window dimension.
@@ -698,9 +852,49 @@ struct ReduceWindowOpConversion final
   }
 };
 
+/// Returns whether `op` is a reduction over a single dimension of static size
+/// `ratio` * k for some k > 1, whose inputs are read without broadcasts like
+/// the reductions which are lowered from stablehlo.reduce, and which is
+/// therefore split by `splitReductions`.
+bool isSplittableReduction(linalg::LinalgOp op, int64_t ratio) {
+  if (!isa<linalg::GenericOp, linalg::ReduceOp>(op) ||
+      op.getNumReductionLoops() != 1 || op.getNumDpsInits() != 1 ||
+      !op.hasPureTensorSemantics())
+    return false;
+  if (!llvm::all_of(op.getDpsInputOperands(), [&](OpOperand *operand) {
+        return op.getMatchingIndexingMap(operand).isPermutation();
+      }))
+    return false;
+
+  SmallVector<unsigned> reductionDims;
+  op.getReductionDims(reductionDims);
+  SmallVector<int64_t> loopRanges = op.getStaticLoopRanges();
+  int64_t size = loopRanges[reductionDims.front()];
+  return !ShapedType::isDynamic(size) && size > ratio && size % ratio == 0;
+}
 }  // namespace
 
 namespace detail {
+void splitReductions(Operation *root, int64_t ratio) {
+  SmallVector<linalg::LinalgOp> reductionOps;
+  root->walk([&](linalg::LinalgOp op) {
+    if (isSplittableReduction(op, ratio)) reductionOps.push_back(op);
+  });
+
+  IRRewriter rewriter(root->getContext());
+  for (linalg::LinalgOp op : reductionOps) {
+    rewriter.setInsertionPoint(op);
+    // The partial results are reduced over their innermost dimension.
+    int64_t resultRank =
+        cast<ShapedType>(op.getDpsInitOperand(0)->get().getType()).getRank();
+    (void)linalg::splitReduction(rewriter, op, [&](linalg::LinalgOp) {
+      return linalg::SplitReductionOptions{ratio,
+                                           static_cast<unsigned>(resultRank),
+                                           /*innerParallel=*/false};
+    });
+  }
+}
+
 void populateStablehloReductionToLinalgConversionPatterns(
     MLIRContext *context, TypeConverter &typeConverter,
     RewritePatternSet *patterns, bool enablePrimitiveOps) {
@@ -717,6 +911,8 @@ void populateStablehloReductionToLinalgConversionPatterns(
   // versions.
   patterns->add<ReduceWindowOpConversion>(typeConverter, context,
                                           PatternBenefit(2));
+  patterns->add<ReduceWindowOpCumulativeSumConversion>(typeConverter, context,
+                                                       PatternBenefit(3));
 }
 }  // namespace detail
 }  // namespace mlir::stablehlo
@@ -0,0 +1,484 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Implements logic for lowering StableHLO sort ops to Linalg and SCF dialects.
+// The comparator is inlined as scalar ops, so that the sort needs no calls.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Linalg/IR/Linalg.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/SparseTensor/IR/SparseTensor.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/IR/AffineMap.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Transforms/DialectConversion.h"
+#include "stablehlo/conversions/linalg/transforms/LegalizeToLinalgUtils.h"
+#include "stablehlo/conversions/linalg/transforms/MapStablehloToScalarOp.h"
+#include "stablehlo/conversions/linalg/transforms/Rewriters.h"
+#include "stablehlo/dialect/StablehloOps.h"
+
+namespace mlir::stablehlo {
+namespace {
+
+/// Largest static sort dimension which is sorted by a bitonic network rather
+/// than by a merge sort, since the network takes O(n log^2 n) comparisons.
+constexpr int64_t kMaxBitonicSortSize = 128;
+
+/// Number of elements which the merge sort sorts by insertion before merging.
+constexpr int64_t kMergeSortTileSize = 16;
+
+/// Returns whether all ops of `comparator` can be mapped to scalar ops.
+bool isScalarComparator(Region &comparator) {
+  if (!comparator.hasOneBlock()) return false;
+  Block &block = comparator.front();
+  auto returnOp = dyn_cast<mlir::stablehlo::ReturnOp>(block.getTerminator());
+  if (!returnOp || returnOp->getNumOperands() != 1) return false;
+  return llvm::all_of(block.without_terminator(), [](Operation &op) {
+    if (auto constantOp = dyn_cast<mlir::stablehlo::ConstantOp>(op)) {
+      auto value = dyn_cast<SplatElementsAttr>(constantOp.getValue());
+      return value && isa<IntegerType, FloatType>(value.getElementType());
+    }
+    return ElementwiseStablehloOps::contains(&op) && op.getNumResults() == 1;
+  });
+}
+
+/// Inlines the comparator of a sort as scalar ops on converted types.
+class ComparatorBuilder {
+ public:
+  ComparatorBuilder(Region &comparator, const TypeConverter &typeConverter)
+      : comparator(comparator), typeConverter(typeConverter) {}
+
+  /// Returns whether the elements `lhs` of all operands at a position precede
+  /// the elements `rhs` at another one. If an op can't be mapped, returns
+  /// false and records the failure, so that the sort can still be built.
+  Value less(OpBuilder &b, Location loc, ValueRange lhs, ValueRange rhs) const {
+    Block &block = comparator.front();
+    IRMapping mapping;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      mapping.map(block.getArgument(2 * i), lhs[i]);
+      mapping.map(block.getArgument(2 * i + 1), rhs[i]);
+    }
+    for (Operation &op : block.without_terminator()) {
+      Value result = mapToScalarOp(b, op, mapping);
+      if (!result) {
+        failed = true;
+        return b.create<arith::ConstantIntOp>(loc, 0, /*width=*/1);
+      }
+      mapping.map(op.getResult(0), result);
+    }
+    return mapping.lookup(block.getTerminator()->getOperand(0));
+  }
+
+  /// Returns whether an op of the comparator couldn't be mapped.
+  bool hasFailed() const { return failed; }
+
+ private:
+  Value mapToScalarOp(OpBuilder &b, Operation &op,
+                      const IRMapping &mapping) const {
+    Type resultType = typeConverter.convertType(op.getResult(0).getType());
+    if (!resultType) return nullptr;
+    resultType = getElementTypeOrSelf(resultType);
+
+    auto constantOp = dyn_cast<mlir::stablehlo::ConstantOp>(op);
+    if (!constantOp) {
+      auto args = llvm::map_to_vector(op.getOperands(), [&](Value operand) {
+        return mapping.lookup(operand);
+      });
+      return ElementwiseStablehloOps::mapToScalarOp(&op, resultType, args, &b);
+    }
+
+    // Unsigned constants are built with the signless converted type.
+    auto value = cast<SplatElementsAttr>(constantOp.getValue())
+                     .getSplatValue<Attribute>();
+    TypedAttr attr;
+    if (auto intAttr = dyn_cast<IntegerAttr>(value))
+      attr = IntegerAttr::get(resultType, intAttr.getValue());
+    else
+      attr = FloatAttr::get(resultType, cast<FloatAttr>(value).getValue());
+    return b.create<arith::ConstantOp>(op.getLoc(), attr);
+  }
+
+  Region &comparator;
+  const TypeConverter &typeConverter;
+  mutable bool failed = false;
+};
+
+/// Sorts `operands` along `dim`, whose size n is a static power of two, with a
+/// bitonic network. Each of its log(n) (log(n) + 1) / 2 stages compares the
+/// elements i and i ^ j of all blocks of k elements, and orders them
+/// ascendingly if i & k == 0 and descendingly otherwise. A stage is a single
+/// linalg.generic over the sort dimension expanded to [n / 2j, 2, j], which
+/// reads both elements of each pair at the same index, so it vectorizes
+/// without any gathers. The network isn't stable.
+SmallVector<Value> buildBitonicSort(OpBuilder &b, Location loc,
+                                    ValueRange operands, int64_t dim,
+                                    const ComparatorBuilder &comparator) {
+  auto type = cast<RankedTensorType>(operands.front().getType());
+  int64_t rank = type.getRank();
+  int64_t size = type.getDimSize(dim);
+  size_t numOperands = operands.size();
+
+  SmallVector<ReassociationIndices> reassociation;
+  for (int64_t i = 0; i < rank; ++i) {
+    if (i < dim) reassociation.push_back({i});
+    if (i == dim) reassociation.push_back({dim, dim + 1, dim + 2});
+    if (i > dim) reassociation.push_back({i + 2});
+  }
+  AffineMap identityMap = b.getMultiDimIdentityMap(rank + 2);
+  auto getPairMap = [&](int64_t half) {
+    SmallVector<AffineExpr> exprs(identityMap.getResults());
+    exprs[dim + 1] = b.getAffineConstantExpr(half);
+    return AffineMap::get(rank + 2, 0, exprs, b.getContext());
+  };
+  SmallVector<AffineMap> indexingMaps(numOperands, getPairMap(0));
+  indexingMaps.append(numOperands, getPairMap(1));
+  indexingMaps.append(numOperands, identityMap);
+
+  SmallVector<Value> values(operands);
+  for (int64_t k = 2; k <= size; k *= 2) {
+    for (int64_t j = k / 2; j >= 1; j /= 2) {
+      SmallVector<int64_t> shape(type.getShape());
+      shape[dim] = j;
+      shape.insert(shape.begin() + dim, {size / (2 * j), 2});
+
+      SmallVector<Value> pairs, inits;
+      for (Value value : values) {
+        auto expandedType = RankedTensorType::get(
+            shape, cast<ShapedType>(value.getType()).getElementType());
+        pairs.push_back(b.create<tensor::ExpandShapeOp>(
+            loc, expandedType, value, reassociation));
+        inits.push_back(getEmptyTensor(b, loc, expandedType, {}));
+      }
+      SmallVector<Value> inputs(pairs);
+      inputs.append(pairs);
+
+      auto stage = b.create<linalg::GenericOp>(
+          loc, TypeRange(ValueRange(inits)), inputs, inits, indexingMaps,
+          getNParallelLoopsAttrs(rank + 2),
+          [&](OpBuilder &nestedBuilder, Location nestedLoc, ValueRange args) {
+            ValueRange lo = args.take_front(numOperands);
+            ValueRange hi = args.slice(numOperands, numOperands);
+            Value zero = nestedBuilder.create<arith::ConstantIndexOp>(
+                nestedLoc, 0);
+            Value direction = nestedBuilder.create<arith::AndIOp>(
+                nestedLoc,
+                nestedBuilder.create<linalg::IndexOp>(nestedLoc, dim),
+                nestedBuilder.create<arith::ConstantIndexOp>(nestedLoc,
+                                                             k / (2 * j)));
+            Value ascending = nestedBuilder.create<arith::CmpIOp>(
+                nestedLoc, arith::CmpIPredicate::eq, direction, zero);
+
+            // The elements are swapped if the one which should come second
+            // precedes the other.
+            SmallVector<Value> first, second;
+            for (auto [loValue, hiValue] : llvm::zip(lo, hi)) {
+              first.push_back(nestedBuilder.create<arith::SelectOp>(
+                  nestedLoc, ascending, hiValue, loValue));
+              second.push_back(nestedBuilder.create<arith::SelectOp>(
+                  nestedLoc, ascending, loValue, hiValue));
+            }
+            Value swap =
+                comparator.less(nestedBuilder, nestedLoc, first, second);
+            Value isHi = nestedBuilder.create<arith::CmpIOp>(
+                nestedLoc, arith::CmpIPredicate::ne,
+                nestedBuilder.create<linalg::IndexOp>(nestedLoc, dim + 1),
+                zero);
+            Value takeHi =
+                nestedBuilder.create<arith::XOrIOp>(nestedLoc, swap, isHi);
+
+            SmallVector<Value> results;
+            for (auto [loValue, hiValue] : llvm::zip(lo, hi))
+              results.push_back(nestedBuilder.create<arith::SelectOp>(
+                  nestedLoc, takeHi, hiValue, loValue));
+            nestedBuilder.create<linalg::YieldOp>(nestedLoc, results);
+          });
+
+      for (size_t i = 0; i < numOperands; ++i)
+        values[i] = b.create<tensor::CollapseShapeOp>(
+            loc, values[i].getType(), stage.getResult(i), reassociation);
+    }
+  }
+  return values;
+}
+
+/// Returns the elements of `rows` at `index`.
+SmallVector<Value> extractElements(OpBuilder &b, Location loc,
+                                   ValueRange rows, Value index) {
+  return llvm::map_to_vector(rows, [&](Value row) -> Value {
+    return b.create<tensor::ExtractOp>(loc, row, index);
+  });
+}
+
+/// Sorts the 1-D tensors `rows` stably. Tiles of kMergeSortTileSize elements
+/// are sorted by insertion, then runs of doubling width are merged pairwise
+/// from the rows into scratch tensors and back until a single run is left.
+SmallVector<Value> buildRowMergeSort(OpBuilder &b, Location loc,
+                                     ValueRange rows,
+                                     const ComparatorBuilder &comparator) {
+  Value zero = b.create<arith::ConstantIndexOp>(loc, 0);
+  Value one = b.create<arith::ConstantIndexOp>(loc, 1);
+  Value tileSize = b.create<arith::ConstantIndexOp>(loc, kMergeSortTileSize);
+  Value size = b.create<tensor::DimOp>(loc, rows.front(), 0);
+
+  // Inserts every element of a tile after the preceding ones which don't
+  // follow it, shifting the others right.
+  auto tiles = b.create<scf::ForOp>(
+      loc, zero, size, tileSize, rows,
+      [&](OpBuilder &b, Location loc, Value start, ValueRange rows) {
+        Value end = b.create<arith::MinSIOp>(
+            loc, b.create<arith::AddIOp>(loc, start, tileSize), size);
+        Value second = b.create<arith::AddIOp>(loc, start, one);
+        auto insertions = b.create<scf::ForOp>(
+            loc, second, end, one, rows,
+            [&](OpBuilder &b, Location loc, Value i, ValueRange rows) {
+              SmallVector<Value> elements = extractElements(b, loc, rows, i);
+              SmallVector<Value> init = {i};
+              llvm::append_range(init, rows);
+              auto shifts = b.create<scf::WhileOp>(
+                  loc, TypeRange(ValueRange(init)), init,
+                  [&](OpBuilder &b, Location loc, ValueRange args) {
+                    // The index is clamped into the tile, since the element
+                    // before the tile is never compared.
+                    Value previous = b.create<arith::MaxSIOp>(
+                        loc, b.create<arith::SubIOp>(loc, args[0], one),
+                        start);
+                    Value inTile = b.create<arith::CmpIOp>(
+                        loc, arith::CmpIPredicate::sgt, args[0], start);
+                    Value precedes = comparator.less(
+                        b, loc, elements,
+                        extractElements(b, loc, args.drop_front(), previous));
+                    b.create<scf::ConditionOp>(
+                        loc, b.create<arith::AndIOp>(loc, inTile, precedes),
+                        args);
+                  },
+                  [&](OpBuilder &b, Location loc, ValueRange args) {
+                    Value previous =
+                        b.create<arith::SubIOp>(loc, args[0], one);
+                    SmallVector<Value> results = {previous};
+                    for (Value row : args.drop_front())
+                      results.push_back(b.create<tensor::InsertOp>(
+                          loc, b.create<tensor::ExtractOp>(loc, row, previous),
+                          row, args[0]));
+                    b.create<scf::YieldOp>(loc, results);
+                  });
+
+              Value position = shifts.getResult(0);
+              SmallVector<Value> results;
+              for (auto [element, row] :
+                   llvm::zip(elements, shifts.getResults().drop_front()))
+                results.push_back(
+                    b.create<tensor::InsertOp>(loc, element, row, position));
+              b.create<scf::YieldOp>(loc, results);
+            });
+        b.create<scf::YieldOp>(loc, insertions.getResults());
+      });
+
+  // Merges the runs of the sources into the destinations, which then become
+  // the sources of the next, twice as wide, runs.
+  size_t numRows = rows.size();
+  SmallVector<Value> init = {tileSize};
+  llvm::append_range(init, tiles.getResults());
+  for (Value row : rows) {
+    auto rowType = cast<RankedTensorType>(row.getType());
+    SmallVector<Value> dynSizes;
+    if (rowType.isDynamicDim(0)) dynSizes.push_back(size);
+    init.push_back(getEmptyTensor(b, loc, rowType, dynSizes));
+  }
+  auto passes = b.create<scf::WhileOp>(
+      loc, TypeRange(ValueRange(init)), init,
+      [&](OpBuilder &b, Location loc, ValueRange args) {
+        Value isUnmerged = b.create<arith::CmpIOp>(
+            loc, arith::CmpIPredicate::slt, args[0], size);
+        b.create<scf::ConditionOp>(loc, isUnmerged, args);
+      },
+      [&](OpBuilder &b, Location loc, ValueRange args) {
+        Value width = args[0];
+        ValueRange sources = args.slice(1, numRows);
+        Value mergedWidth = b.create<arith::AddIOp>(loc, width, width);
+        auto merges = b.create<scf::ForOp>(
+            loc, zero, size, mergedWidth, args.drop_front(1 + numRows),
+            [&](OpBuilder &b, Location loc, Value lo, ValueRange dests) {
+              Value mid = b.create<arith::MinSIOp>(
+                  loc, b.create<arith::AddIOp>(loc, lo, width), size);
+              Value hi = b.create<arith::MinSIOp>(
+                  loc, b.create<arith::AddIOp>(loc, lo, mergedWidth), size);
+              Value lastLeft = b.create<arith::SubIOp>(loc, mid, one);
+              Value lastRight = b.create<arith::SubIOp>(loc, hi, one);
+              SmallVector<Value> mergeInit = {lo, mid};
+              llvm::append_range(mergeInit, dests);
+              auto merge = b.create<scf::ForOp>(
+                  loc, lo, hi, one, mergeInit,
+                  [&](OpBuilder &b, Location loc, Value k, ValueRange state) {
+                    Value i = state[0];
+                    Value j = state[1];
+                    // The indices are clamped into the runs, since the
+                    // elements of an exhausted run are never taken.
+                    SmallVector<Value> left = extractElements(
+                        b, loc, sources,
+                        b.create<arith::MinSIOp>(loc, i, lastLeft));
+                    SmallVector<Value> right = extractElements(
+                        b, loc, sources,
+                        b.create<arith::MinSIOp>(loc, j, lastRight));
+                    // Equal elements are taken from the left run first,
+                    // which keeps the sort stable.
+                    Value isLeftDone = b.create<arith::CmpIOp>(
+                        loc, arith::CmpIPredicate::sge, i, mid);
+                    Value isRightLeft = b.create<arith::CmpIOp>(
+                        loc, arith::CmpIPredicate::slt, j, hi);
+                    Value takeRight = b.create<arith::AndIOp>(
+                        loc, isRightLeft,
+                        b.create<arith::OrIOp>(
+                            loc, isLeftDone,
+                            comparator.less(b, loc, right, left)));
+
+                    SmallVector<Value> results = {
+                        b.create<arith::SelectOp>(
+                            loc, takeRight, i,
+                            b.create<arith::AddIOp>(loc, i, one)),
+                        b.create<arith::SelectOp>(
+                            loc, takeRight,
+                            b.create<arith::AddIOp>(loc, j, one), j)};
+                    for (auto [leftValue, rightValue, dest] :
+                         llvm::zip(left, right, state.drop_front(2)))
+                      results.push_back(b.create<tensor::InsertOp>(
+                          loc,
+                          b.create<arith::SelectOp>(loc, takeRight, rightValue,
+                                                    leftValue),
+                          dest, k));
+                    b.create<scf::YieldOp>(loc, results);
+                  });
+              b.create<scf::YieldOp>(loc, merge.getResults().drop_front(2));
+            });
+
+        SmallVector<Value> results = {mergedWidth};
+        llvm::append_range(results, merges.getResults());
+        llvm::append_range(results, sources);
+        b.create<scf::YieldOp>(loc, results);
+      });
+  return llvm::to_vector(passes.getResults().slice(1, numRows));
+}
+
+/// Sorts `operands` along `dim` with a merge sort of each of their rows along
+/// `dim`, which loops over all other dimensions.
+SmallVector<Value> buildMergeSort(OpBuilder &b, Location loc,
+                                  ValueRange operands, int64_t dim,
+                                  const ComparatorBuilder &comparator) {
+  auto type = cast<RankedTensorType>(operands.front().getType());
+  int64_t rank = type.getRank();
+  Value zero = b.create<arith::ConstantIndexOp>(loc, 0);
+  Value one = b.create<arith::ConstantIndexOp>(loc, 1);
+  SmallVector<Value> lbs, ubs, steps;
+  for (int64_t i = 0; i < rank; ++i) {
+    if (i == dim) continue;
+    lbs.push_back(zero);
+    ubs.push_back(b.createOrFold<tensor::DimOp>(loc, operands.front(), i));
+    steps.push_back(one);
+  }
+
+  scf::LoopNest loopNest = scf::buildLoopNest(
+      b, loc, lbs, ubs, steps, operands,
+      [&](OpBuilder &b, Location loc, ValueRange ivs,
+          ValueRange results) -> scf::ValueVector {
+        SmallVector<OpFoldResult> offsets, sizes;
+        for (int64_t i = 0, iv = 0; i < rank; ++i) {
+          offsets.push_back(i == dim ? b.getIndexAttr(0) : ivs[iv++]);
+          sizes.push_back(i == dim ? tensor::getMixedSize(b, loc, results[0], i)
+                                   : b.getIndexAttr(1));
+        }
+        SmallVector<OpFoldResult> strides(rank, b.getIndexAttr(1));
+
+        SmallVector<Value> rows;
+        for (Value result : results) {
+          auto rowType = RankedTensorType::get(
+              {type.getDimSize(dim)},
+              cast<ShapedType>(result.getType()).getElementType());
+          rows.push_back(b.create<tensor::ExtractSliceOp>(
+              loc, rowType, result, offsets, sizes, strides));
+        }
+        SmallVector<Value> sortedRows =
+            buildRowMergeSort(b, loc, rows, comparator);
+
+        scf::ValueVector updated;
+        for (auto [row, result] : llvm::zip(sortedRows, results))
+          updated.push_back(b.create<tensor::InsertSliceOp>(
+              loc, row, result, offsets, sizes, strides));
+        return updated;
+      });
+  return SmallVector<Value>(loopNest.results);
+}
+
+/// Converts a sort whose comparator consists of elementwise ops. Small static
+/// sorts which needn't be stable use a bitonic network, which vectorizes,
+/// and others use a merge sort, whose number of comparisons is O(n log n).
+struct SortOpConversion final : OpConversionPattern<mlir::stablehlo::SortOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      mlir::stablehlo::SortOp op, OpAdaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    if (!isScalarComparator(op.getComparator()))
+      return rewriter.notifyMatchFailure(
+          op, "expected a comparator of elementwise ops");
+    if (!llvm::all_of(adaptor.getInputs().getTypes(), [](Type type) {
+          return isa<RankedTensorType>(type) &&
+                 !sparse_tensor::getSparseTensorEncoding(type);
+        }))
+      return rewriter.notifyMatchFailure(op, "expected dense ranked tensors");
+
+    auto type = cast<RankedTensorType>(adaptor.getInputs().front().getType());
+    int64_t dim = op.getDimension();
+    if (dim < 0) dim += type.getRank();
+    int64_t size = type.getDimSize(dim);
+
+    Location loc = op.getLoc();
+    ComparatorBuilder comparator(op.getComparator(), *getTypeConverter());
+    SmallVector<Value> results;
+    if (!op.getIsStable() && type.hasStaticShape() && size > 1 &&
+        size <= kMaxBitonicSortSize && llvm::isPowerOf2_64(size)) {
+      results =
+          buildBitonicSort(rewriter, loc, adaptor.getInputs(), dim, comparator);
+    } else {
+      results =
+          buildMergeSort(rewriter, loc, adaptor.getInputs(), dim, comparator);
+    }
+    if (comparator.hasFailed())
+      return rewriter.notifyMatchFailure(
+          op, "failed to map the comparator to scalar ops");
+
+    rewriter.replaceOp(op, results);
+    return success();
+  }
+};
+
+}  // namespace
+
+namespace detail {
+void populateStablehloSortToLinalgConversionPatterns(
+    MLIRContext *context, TypeConverter &typeConverter,
+    RewritePatternSet *patterns) {
+  patterns->add<SortOpConversion>(typeConverter, context);
+}
+}  // namespace detail
+}  // namespace mlir::stablehlo
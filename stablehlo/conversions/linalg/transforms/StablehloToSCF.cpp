@@ -0,0 +1,306 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Implements the lowering of StableHLO control flow ops to SCF.
+
+#include <cstdint>
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Tensor/IR/Tensor.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Support/LogicalResult.h"
+#include "stablehlo/conversions/linalg/transforms/Rewriters.h"
+#include "stablehlo/dialect/StablehloOps.h"
+
+namespace mlir::stablehlo {
+namespace {
+
+/// Replaces the stablehlo.return terminating the only block of `region` with
+/// a terminator of type `TerminatorOpTy` built with its operands.
+template <typename TerminatorOpTy>
+void replaceReturn(PatternRewriter &rewriter, Region &region) {
+  auto returnOp = cast<ReturnOp>(region.front().getTerminator());
+  rewriter.setInsertionPoint(returnOp);
+  rewriter.replaceOpWithNewOp<TerminatorOpTy>(returnOp,
+                                              returnOp.getOperands());
+}
+
+/// Extracts the element of the rank-0 tensor `value`.
+Value extractScalar(PatternRewriter &rewriter, Location loc, Value value) {
+  return rewriter.create<tensor::ExtractOp>(loc, value, ValueRange{});
+}
+
+/// Converts stablehlo.while to scf.while with the same loop-carried values.
+struct WhileOpToSCFWhile final : OpRewritePattern<WhileOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(WhileOp op,
+                                PatternRewriter &rewriter) const override {
+    Location loc = op.getLoc();
+    auto whileOp = rewriter.create<scf::WhileOp>(loc, op.getResultTypes(),
+                                                 op.getOperands());
+
+    rewriter.inlineRegionBefore(op.getCond(), whileOp.getBefore(),
+                                whileOp.getBefore().end());
+    Block &before = whileOp.getBefore().front();
+    auto returnOp = cast<ReturnOp>(before.getTerminator());
+    rewriter.setInsertionPoint(returnOp);
+    Value pred = extractScalar(rewriter, loc, returnOp.getOperand(0));
+    rewriter.replaceOpWithNewOp<scf::ConditionOp>(returnOp, pred,
+                                                  before.getArguments());
+
+    rewriter.inlineRegionBefore(op.getBody(), whileOp.getAfter(),
+                                whileOp.getAfter().end());
+    replaceReturn<scf::YieldOp>(rewriter, whileOp.getAfter());
+
+    rewriter.replaceOp(op, whileOp.getResults());
+    return success();
+  }
+};
+
+/// Converts stablehlo.while to scf.for if it has an induction variable which
+/// starts from its initial value and is incremented by a positive constant
+/// while it's less than a limit which is invariant in the loop, e.g.
+///
+///   %0:2 = stablehlo.while(%i = %start, %acc = %init) cond {
+///     %1 = stablehlo.compare LT, %i, %limit
+///     stablehlo.return %1
+///   } do {
+///     ...
+///     %2 = stablehlo.add %i, %c1
+///     stablehlo.return %2, %acc'
+///   }
+///
+/// The other loop-carried values become the iter_args of the scf.for, which
+/// one-shot bufferization updates in place, unlike those of scf.while. The
+/// induction variable is a signless integer of less than 64 bits, or of 64
+/// bits if it's compared as a signed integer, so that it fits an index. The
+/// loop mustn't overflow it, which is the case for unit steps and for limits
+/// which are constants at least a step below the largest integer.
+struct WhileOpToSCFFor final : OpRewritePattern<WhileOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(WhileOp op,
+                                PatternRewriter &rewriter) const override {
+    Block &cond = op.getCond().front();
+    Block &body = op.getBody().front();
+    if (!llvm::all_of(cond.without_terminator(), [](Operation &nested) {
+          return isMemoryEffectFree(&nested);
+        }))
+      return rewriter.notifyMatchFailure(op, "expected side-effect free cond");
+    auto compare =
+        cond.getTerminator()->getOperand(0).getDefiningOp<CompareOp>();
+    if (!compare) return rewriter.notifyMatchFailure(op, "expected compare");
+
+    // Finds the induction variable and the limit it's compared to, in this
+    // order.
+    auto direction = compare.getComparisonDirection();
+    auto arg = dyn_cast<BlockArgument>(compare.getLhs());
+    Value limit = compare.getRhs();
+    if (direction == ComparisonDirection::GT) {
+      arg = dyn_cast<BlockArgument>(compare.getRhs());
+      limit = compare.getLhs();
+      direction = ComparisonDirection::LT;
+    }
+    if (direction != ComparisonDirection::LT || !arg ||
+        arg.getOwner() != &cond)
+      return rewriter.notifyMatchFailure(op, "expected iv < limit");
+    unsigned ivIndex = arg.getArgNumber();
+
+    auto ivType = cast<RankedTensorType>(arg.getType());
+    auto elementType = dyn_cast<IntegerType>(ivType.getElementType());
+    bool isUnsigned = compare.getCompareType() == ComparisonType::UNSIGNED;
+    if (!elementType || !elementType.isSignless() ||
+        elementType.getWidth() > 64 ||
+        (isUnsigned && elementType.getWidth() == 64))
+      return rewriter.notifyMatchFailure(op, "expected index-sized iv");
+
+    // The body must increment the induction variable by a positive constant.
+    auto add = body.getTerminator()->getOperand(ivIndex).getDefiningOp<AddOp>();
+    if (!add) return rewriter.notifyMatchFailure(op, "expected iv increment");
+    Value stepValue = add.getRhs();
+    if (add.getLhs() != body.getArgument(ivIndex)) {
+      if (add.getRhs() != body.getArgument(ivIndex))
+        return rewriter.notifyMatchFailure(op, "expected iv increment");
+      stepValue = add.getLhs();
+    }
+    APInt step;
+    if (!matchPattern(stepValue, m_ConstantInt(&step)) || step.isZero() ||
+        step.isNegative() || step.getActiveBits() > 62)
+      return rewriter.notifyMatchFailure(op, "expected positive step");
+
+    // The limit must be invariant: defined above the loop, a constant in the
+    // cond, or a loop-carried value which the body forwards unchanged.
+    Operation *limitOp = limit.getDefiningOp();
+    if (auto limitArg = dyn_cast<BlockArgument>(limit);
+        limitArg && limitArg.getOwner() == &cond) {
+      unsigned index = limitArg.getArgNumber();
+      if (body.getTerminator()->getOperand(index) != body.getArgument(index))
+        return rewriter.notifyMatchFailure(op, "expected invariant limit");
+      limit = op.getOperand()[index];
+    } else if (limitOp && limitOp->getBlock() == &cond &&
+               !matchPattern(limit, m_Constant())) {
+      return rewriter.notifyMatchFailure(op, "expected invariant limit");
+    }
+
+    // The induction variable mustn't overflow before reaching the limit.
+    if (!step.isOne()) {
+      APInt limitValue;
+      if (!matchPattern(limit, m_ConstantInt(&limitValue)))
+        return rewriter.notifyMatchFailure(op, "expected constant limit");
+      unsigned width = elementType.getWidth();
+      APInt maxValue = isUnsigned ? APInt::getMaxValue(width)
+                                  : APInt::getSignedMaxValue(width);
+      APInt margin = maxValue - step.zextOrTrunc(width) + 1;
+      if (isUnsigned ? limitValue.ugt(margin) : limitValue.sgt(margin))
+        return rewriter.notifyMatchFailure(op, "iv may overflow");
+    }
+
+    Location loc = op.getLoc();
+    rewriter.setInsertionPoint(op);
+    if (limitOp && limitOp->getBlock() == &cond)
+      limit = rewriter.clone(*limitOp)->getResult(0);
+    auto toIndex = [&](Value value) -> Value {
+      Value scalar = extractScalar(rewriter, loc, value);
+      if (isUnsigned)
+        return rewriter.create<arith::IndexCastUIOp>(
+            loc, rewriter.getIndexType(), scalar);
+      return rewriter.create<arith::IndexCastOp>(loc, rewriter.getIndexType(),
+                                                 scalar);
+    };
+    auto fromIndex = [&](Value index) -> Value {
+      Value scalar;
+      if (isUnsigned)
+        scalar = rewriter.create<arith::IndexCastUIOp>(loc, elementType, index);
+      else
+        scalar = rewriter.create<arith::IndexCastOp>(loc, elementType, index);
+      return rewriter.create<tensor::FromElementsOp>(loc, ivType, scalar);
+    };
+    Value lowerBound = toIndex(op.getOperand()[ivIndex]);
+    Value upperBound = toIndex(limit);
+    Value stepIndex =
+        rewriter.create<arith::ConstantIndexOp>(loc, step.getZExtValue());
+
+    SmallVector<Value> initArgs;
+    for (auto [index, operand] : llvm::enumerate(op.getOperand()))
+      if (index != ivIndex) initArgs.push_back(operand);
+    auto forOp = rewriter.create<scf::ForOp>(loc, lowerBound, upperBound,
+                                             stepIndex, initArgs);
+
+    // Moves the body into the scf.for, whose builder only adds a terminator
+    // if there are no iter_args.
+    Block *forBody = forOp.getBody();
+    if (!forBody->empty()) rewriter.eraseOp(forBody->getTerminator());
+    rewriter.setInsertionPointToStart(forBody);
+    auto bodyArgs = llvm::to_vector_of<Value>(forOp.getRegionIterArgs());
+    bodyArgs.insert(bodyArgs.begin() + ivIndex,
+                    fromIndex(forOp.getInductionVar()));
+    rewriter.mergeBlocks(&body, forBody, bodyArgs);
+    auto returnOp = cast<ReturnOp>(forBody->getTerminator());
+    SmallVector<Value> yielded(returnOp.getOperands());
+    yielded.erase(yielded.begin() + ivIndex);
+    rewriter.setInsertionPoint(returnOp);
+    rewriter.replaceOpWithNewOp<scf::YieldOp>(returnOp, yielded);
+
+    // The final induction variable is the first value of the sequence which
+    // reaches the limit, or the initial value if the loop doesn't run.
+    rewriter.setInsertionPointAfter(forOp);
+    Value finalIv;
+    if (step.isOne()) {
+      finalIv = rewriter.create<arith::MaxSIOp>(loc, lowerBound, upperBound);
+    } else {
+      Value zero = rewriter.create<arith::ConstantIndexOp>(loc, 0);
+      Value distance = rewriter.create<arith::MaxSIOp>(
+          loc, rewriter.create<arith::SubIOp>(loc, upperBound, lowerBound),
+          zero);
+      Value tripCount =
+          rewriter.create<arith::CeilDivSIOp>(loc, distance, stepIndex);
+      finalIv = rewriter.create<arith::AddIOp>(
+          loc, lowerBound,
+          rewriter.create<arith::MulIOp>(loc, tripCount, stepIndex));
+    }
+
+    auto results = llvm::to_vector_of<Value>(forOp.getResults());
+    results.insert(results.begin() + ivIndex, fromIndex(finalIv));
+    rewriter.replaceOp(op, results);
+    return success();
+  }
+};
+
+/// Converts stablehlo.if to scf.if.
+struct IfOpToSCF final : OpRewritePattern<IfOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(IfOp op,
+                                PatternRewriter &rewriter) const override {
+    Value pred = extractScalar(rewriter, op.getLoc(), op.getPred());
+    auto ifOp = rewriter.create<scf::IfOp>(op.getLoc(), op.getResultTypes(),
+                                           pred, /*addThenBlock=*/false,
+                                           /*addElseBlock=*/false);
+    rewriter.inlineRegionBefore(op.getTrueBranch(), ifOp.getThenRegion(),
+                                ifOp.getThenRegion().end());
+    rewriter.inlineRegionBefore(op.getFalseBranch(), ifOp.getElseRegion(),
+                                ifOp.getElseRegion().end());
+    replaceReturn<scf::YieldOp>(rewriter, ifOp.getThenRegion());
+    replaceReturn<scf::YieldOp>(rewriter, ifOp.getElseRegion());
+    rewriter.replaceOp(op, ifOp.getResults());
+    return success();
+  }
+};
+
+/// Converts stablehlo.case to scf.index_switch, whose default region is the
+/// last branch, which is also taken for out-of-range indices.
+struct CaseOpToSCF final : OpRewritePattern<CaseOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(CaseOp op,
+                                PatternRewriter &rewriter) const override {
+    Location loc = op.getLoc();
+    Value index = rewriter.create<arith::IndexCastOp>(
+        loc, rewriter.getIndexType(),
+        extractScalar(rewriter, loc, op.getIndex()));
+    int64_t numCases = op.getBranches().size() - 1;
+    auto cases = llvm::to_vector(llvm::seq<int64_t>(0, numCases));
+    auto switchOp = rewriter.create<scf::IndexSwitchOp>(
+        loc, op.getResultTypes(), index, cases, numCases);
+    for (auto [branch, caseRegion] :
+         llvm::zip(op.getBranches().drop_back(), switchOp.getCaseRegions())) {
+      rewriter.inlineRegionBefore(branch, caseRegion, caseRegion.end());
+      replaceReturn<scf::YieldOp>(rewriter, caseRegion);
+    }
+    Region &defaultRegion = switchOp.getDefaultRegion();
+    rewriter.inlineRegionBefore(op.getBranches().back(), defaultRegion,
+                                defaultRegion.end());
+    replaceReturn<scf::YieldOp>(rewriter, defaultRegion);
+    rewriter.replaceOp(op, switchOp.getResults());
+    return success();
+  }
+};
+
+}  // namespace
+
+void populateLegalizeControlFlowPatterns(MLIRContext *context,
+                                         RewritePatternSet *patterns) {
+  patterns->add<CaseOpToSCF, IfOpToSCF, WhileOpToSCFWhile>(context);
+  patterns->add<WhileOpToSCFFor>(context, /*benefit=*/2);
+}
+
+}  // namespace mlir::stablehlo
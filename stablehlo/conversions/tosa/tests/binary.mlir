@@ -7,6 +7,31 @@ func.func @add(%arg0 : tensor<10xf32>, %arg1 : tensor<10xf32>) -> tensor<10xf32>
   return %0 : tensor<10xf32>
 }
 
+// CHECK-LABEL: @add_broadcast
+func.func @add_broadcast(%arg0 : tensor<2x3x4xf32>, %arg1 : tensor<4xf32>) -> tensor<2x3x4xf32> {
+  // CHECK: %[[RESHAPE:.*]] = tosa.reshape %arg1 {new_shape = array<i64: 1, 1, 4>}
+  // CHECK-NOT: tosa.tile
+  // CHECK: tosa.add %arg0, %[[RESHAPE]] : (tensor<2x3x4xf32>, tensor<1x1x4xf32>) -> tensor<2x3x4xf32>
+  %0 = "stablehlo.broadcast_in_dim"(%arg1) {broadcast_dimensions = array<i64: 2>} : (tensor<4xf32>) -> tensor<2x3x4xf32>
+  %1 = "stablehlo.add"(%arg0, %0) : (tensor<2x3x4xf32>, tensor<2x3x4xf32>) -> tensor<2x3x4xf32>
+  return %1 : tensor<2x3x4xf32>
+}
+
+// CHECK-LABEL: @avg_pool
+func.func @avg_pool(%arg0 : tensor<1x8x8x3xf32>) -> tensor<1x4x4x3xf32> {
+  // CHECK: tosa.avg_pool2d %arg0 {acc_type = f32, kernel = array<i64: 2, 2>, pad = array<i64: 0, 0, 0, 0>, stride = array<i64: 2, 2>}
+  // CHECK-NOT: tosa.mul
+  %init = stablehlo.constant dense<0.0> : tensor<f32>
+  %size = stablehlo.constant dense<4.0> : tensor<1x4x4x3xf32>
+  %0 = "stablehlo.reduce_window"(%arg0, %init) ({
+  ^bb0(%arg1: tensor<f32>, %arg2: tensor<f32>):
+    %2 = stablehlo.add %arg1, %arg2 : tensor<f32>
+    "stablehlo.return"(%2) : (tensor<f32>) -> ()
+  }) {window_dimensions = array<i64: 1, 2, 2, 1>, window_strides = array<i64: 1, 2, 2, 1>} : (tensor<1x8x8x3xf32>, tensor<f32>) -> tensor<1x4x4x3xf32>
+  %1 = stablehlo.divide %0, %size : tensor<1x4x4x3xf32>
+  return %1 : tensor<1x4x4x3xf32>
+}
+
 // CHECK-LABEL: @and
 func.func @and(%arg0 : tensor<10xi32>, %arg1 : tensor<10xi32>) -> tensor<10xi32> {
   // CHECK: tosa.bitwise_and
@@ -43,6 +68,46 @@ func.func @concatenate(%arg0 : tensor<3x3xf32>, %arg1 : tensor<3x3xf32>) -> tens
   return %0 : tensor<6x3xf32>
 }
 
+// CHECK-LABEL: @convolution
+func.func @convolution(%arg0 : tensor<1x8x8x3xf32>, %arg1 : tensor<3x3x3x16xf32>) -> tensor<1x8x8x16xf32> {
+  // CHECK-DAG: %[[BIAS:.*]] = "tosa.const"() <{value = dense<0.000000e+00> : tensor<16xf32>}>
+  // CHECK-DAG: %[[PERMS:.*]] = "tosa.const"() <{value = dense<[3, 0, 1, 2]> : tensor<4xi64>}>
+  // CHECK: %[[WEIGHT:.*]] = tosa.transpose %arg1, %[[PERMS]] : (tensor<3x3x3x16xf32>, tensor<4xi64>) -> tensor<16x3x3x3xf32>
+  // CHECK: tosa.conv2d %arg0, %[[WEIGHT]], %[[BIAS]] {dilation = array<i64: 1, 1>, pad = array<i64: 1, 1, 1, 1>, stride = array<i64: 1, 1>}
+  %0 = stablehlo.convolution(%arg0, %arg1)
+    dim_numbers = [b, 0, 1, f]x[0, 1, i, o]->[b, 0, 1, f],
+    window = {stride = [1, 1], pad = [[1, 1], [1, 1]]}
+    {batch_group_count = 1 : i64, feature_group_count = 1 : i64}
+    : (tensor<1x8x8x3xf32>, tensor<3x3x3x16xf32>) -> tensor<1x8x8x16xf32>
+  return %0 : tensor<1x8x8x16xf32>
+}
+
+// CHECK-LABEL: @convolution_depthwise
+func.func @convolution_depthwise(%arg0 : tensor<1x8x8x4xf32>, %arg1 : tensor<3x3x1x8xf32>) -> tensor<1x4x4x8xf32> {
+  // CHECK: %[[WEIGHT:.*]] = tosa.reshape %arg1 {new_shape = array<i64: 3, 3, 4, 2>}
+  // CHECK: tosa.depthwise_conv2d %arg0, %[[WEIGHT]], %{{.*}} {dilation = array<i64: 1, 1>, pad = array<i64: 0, 1, 0, 1>, stride = array<i64: 2, 2>}
+  %0 = stablehlo.convolution(%arg0, %arg1)
+    dim_numbers = [b, 0, 1, f]x[0, 1, i, o]->[b, 0, 1, f],
+    window = {stride = [2, 2], pad = [[0, 1], [0, 1]]}
+    {batch_group_count = 1 : i64, feature_group_count = 4 : i64}
+    : (tensor<1x8x8x4xf32>, tensor<3x3x1x8xf32>) -> tensor<1x4x4x8xf32>
+  return %0 : tensor<1x4x4x8xf32>
+}
+
+// CHECK-LABEL: @convolution_nchw
+func.func @convolution_nchw(%arg0 : tensor<1x3x8x8xf32>, %arg1 : tensor<16x3x3x3xf32>) -> tensor<1x16x6x6xf32> {
+  // CHECK: %[[INPUT:.*]] = tosa.transpose %arg0, %{{.*}} : (tensor<1x3x8x8xf32>, tensor<4xi64>) -> tensor<1x8x8x3xf32>
+  // CHECK: %[[WEIGHT:.*]] = tosa.transpose %arg1, %{{.*}} : (tensor<16x3x3x3xf32>, tensor<4xi64>) -> tensor<16x3x3x3xf32>
+  // CHECK: %[[CONV:.*]] = tosa.conv2d %[[INPUT]], %[[WEIGHT]], %{{.*}} -> tensor<1x6x6x16xf32>
+  // CHECK: tosa.transpose %[[CONV]], %{{.*}} : (tensor<1x6x6x16xf32>, tensor<4xi64>) -> tensor<1x16x6x6xf32>
+  %0 = stablehlo.convolution(%arg0, %arg1)
+    dim_numbers = [b, f, 0, 1]x[o, i, 0, 1]->[b, f, 0, 1],
+    window = {}
+    {batch_group_count = 1 : i64, feature_group_count = 1 : i64}
+    : (tensor<1x3x8x8xf32>, tensor<16x3x3x3xf32>) -> tensor<1x16x6x6xf32>
+  return %0 : tensor<1x16x6x6xf32>
+}
+
 // CHECK-LABEL: @divide
 func.func @divide(%arg0 : tensor<10xi32>, %arg1 : tensor<10xi32>) -> tensor<10xi32> {
   // CHECK: tosa.int_div
@@ -130,6 +195,40 @@ func.func @dot_general_matrix_matrix(%arg0: tensor<2x3xf32>, %arg1: tensor<3x4xf
   return %0 : tensor<2x4xf32>
 }
 
+// CHECK-LABEL: @dot_general_batch
+func.func @dot_general_batch(%arg0: tensor<2x3x4xf32>, %arg1: tensor<2x4x5xf32>) -> tensor<2x3x5xf32> {
+  // CHECK-NOT: tosa.transpose
+  // CHECK-NOT: tosa.reshape
+  // CHECK: %[[VAR0:.*]] = tosa.matmul %arg0, %arg1 : (tensor<2x3x4xf32>, tensor<2x4x5xf32>) -> tensor<2x3x5xf32>
+  // CHECK: return %[[VAR0]]
+  %0 = stablehlo.dot_general %arg0, %arg1, batching_dims = [0] x [0], contracting_dims = [2] x [1] : (tensor<2x3x4xf32>, tensor<2x4x5xf32>) -> tensor<2x3x5xf32>
+  return %0 : tensor<2x3x5xf32>
+}
+
+// CHECK-LABEL: @dot_general_multiple_contracting
+func.func @dot_general_multiple_contracting(%arg0: tensor<4x2x3x6xf32>, %arg1: tensor<2x4x6x5xf32>) -> tensor<2x3x5xf32> {
+  // CHECK-DAG: %[[PERMS:.*]] = "tosa.const"() <{value = dense<[1, 2, 0, 3]> : tensor<4xi64>}>
+  // CHECK: %[[VAR0:.*]] = tosa.transpose %arg0, %[[PERMS]] : (tensor<4x2x3x6xf32>, tensor<4xi64>) -> tensor<2x3x4x6xf32>
+  // CHECK: %[[VAR1:.*]] = tosa.reshape %[[VAR0]] {new_shape = array<i64: 2, 3, 24>}
+  // CHECK-NOT: tosa.transpose
+  // CHECK: %[[VAR2:.*]] = tosa.reshape %arg1 {new_shape = array<i64: 2, 24, 5>}
+  // CHECK: %[[VAR3:.*]] = tosa.matmul %[[VAR1]], %[[VAR2]] : (tensor<2x3x24xf32>, tensor<2x24x5xf32>) -> tensor<2x3x5xf32>
+  // CHECK: return %[[VAR3]]
+  %0 = stablehlo.dot_general %arg0, %arg1, batching_dims = [1] x [0], contracting_dims = [0, 3] x [1, 2] : (tensor<4x2x3x6xf32>, tensor<2x4x6x5xf32>) -> tensor<2x3x5xf32>
+  return %0 : tensor<2x3x5xf32>
+}
+
+// CHECK-LABEL: @dot_general_chained
+func.func @dot_general_chained(%arg0: tensor<2x3x4x5xf32>, %arg1: tensor<2x3x5x6xf32>, %arg2: tensor<2x3x6x7xf32>) -> tensor<2x3x4x7xf32> {
+  // The reshapes between the chained matmuls fold away.
+  // CHECK: %[[VAR0:.*]] = tosa.matmul %{{.*}}, %{{.*}} : (tensor<6x4x5xf32>, tensor<6x5x6xf32>) -> tensor<6x4x6xf32>
+  // CHECK: %[[VAR1:.*]] = tosa.matmul %[[VAR0]], %{{.*}} : (tensor<6x4x6xf32>, tensor<6x6x7xf32>) -> tensor<6x4x7xf32>
+  // CHECK: tosa.reshape %[[VAR1]] {new_shape = array<i64: 2, 3, 4, 7>}
+  %0 = stablehlo.dot_general %arg0, %arg1, batching_dims = [0, 1] x [0, 1], contracting_dims = [3] x [2] : (tensor<2x3x4x5xf32>, tensor<2x3x5x6xf32>) -> tensor<2x3x4x6xf32>
+  %1 = stablehlo.dot_general %0, %arg2, batching_dims = [0, 1] x [0, 1], contracting_dims = [3] x [2] : (tensor<2x3x4x6xf32>, tensor<2x3x6x7xf32>) -> tensor<2x3x4x7xf32>
+  return %1 : tensor<2x3x4x7xf32>
+}
+
 // CHECK-LABEL: @gather
 func.func @gather(%arg0 : tensor<3x4x5xi32>, %arg1 : tensor<3x2xi32>) -> tensor<3x2x5xi32> {
   // CHECK: tosa.gather
@@ -174,6 +273,15 @@ func.func @multiply(%arg0 : tensor<10xf32>, %arg1 : tensor<10xf32>) -> tensor<10
   return %0 : tensor<10xf32>
 }
 
+// CHECK-LABEL: @multiply_broadcast
+func.func @multiply_broadcast(%arg0 : tensor<f32>, %arg1 : tensor<2x3xf32>) -> tensor<2x3xf32> {
+  // CHECK: %[[RESHAPE:.*]] = tosa.reshape %arg0 {new_shape = array<i64: 1, 1>}
+  // CHECK: tosa.mul %[[RESHAPE]], %arg1 {shift = 0 : i8} : (tensor<1x1xf32>, tensor<2x3xf32>) -> tensor<2x3xf32>
+  %0 = "stablehlo.broadcast_in_dim"(%arg0) {broadcast_dimensions = array<i64>} : (tensor<f32>) -> tensor<2x3xf32>
+  %1 = "stablehlo.multiply"(%0, %arg1) : (tensor<2x3xf32>, tensor<2x3xf32>) -> tensor<2x3xf32>
+  return %1 : tensor<2x3xf32>
+}
+
 // CHECK-LABEL: @or
 func.func @or(%arg0 : tensor<10xi32>, %arg1 : tensor<10xi32>) -> tensor<10xi32> {
   // CHECK: tosa.bitwise_or
@@ -181,6 +289,29 @@ func.func @or(%arg0 : tensor<10xi32>, %arg1 : tensor<10xi32>) -> tensor<10xi32>
   return %0 : tensor<10xi32>
 }
 
+// CHECK-LABEL: @pad
+func.func @pad(%arg0 : tensor<2x3xf32>, %arg1 : tensor<f32>) -> tensor<5x7xf32> {
+  // CHECK: %[[PADDING:.*]] = "tosa.const"() <{value = dense<{{\[\[}}1, 2], [0, 4]]> : tensor<2x2xi64>}>
+  // CHECK: tosa.pad %arg0, %[[PADDING]], %arg1 : (tensor<2x3xf32>, tensor<2x2xi64>, tensor<f32>) -> tensor<5x7xf32>
+  %0 = "stablehlo.pad"(%arg0, %arg1) {
+    edge_padding_low = array<i64: 1, 0>,
+    edge_padding_high = array<i64: 2, 4>,
+    interior_padding = array<i64: 0, 0>
+  } : (tensor<2x3xf32>, tensor<f32>) -> tensor<5x7xf32>
+  return %0 : tensor<5x7xf32>
+}
+
+// CHECK-LABEL: @pad_interior
+func.func @pad_interior(%arg0 : tensor<2x3xf32>, %arg1 : tensor<f32>) -> tensor<3x3xf32> {
+  // CHECK: stablehlo.pad
+  %0 = "stablehlo.pad"(%arg0, %arg1) {
+    edge_padding_low = array<i64: 0, 0>,
+    edge_padding_high = array<i64: 0, 0>,
+    interior_padding = array<i64: 1, 0>
+  } : (tensor<2x3xf32>, tensor<f32>) -> tensor<3x3xf32>
+  return %0 : tensor<3x3xf32>
+}
+
 // CHECK-LABEL: @power
 func.func @power(%arg0 : tensor<10xf32>, %arg1 : tensor<10xf32>) -> tensor<10xf32> {
   // CHECK: tosa.pow
@@ -212,6 +343,36 @@ func.func @reduce_sum(%arg0: tensor<5x4xf32>, %arg1: tensor<f32>) -> tensor<4xf3
   return %0 : tensor<4xf32>
 }
 
+// CHECK-LABEL: @reduce_window_max
+func.func @reduce_window_max(%arg0 : tensor<1x8x8x3xf32>) -> tensor<1x4x4x3xf32> {
+  // CHECK: tosa.max_pool2d %arg0 {kernel = array<i64: 3, 3>, pad = array<i64: 0, 1, 0, 1>, stride = array<i64: 2, 2>}
+  %init = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %0 = "stablehlo.reduce_window"(%arg0, %init) ({
+  ^bb0(%arg1: tensor<f32>, %arg2: tensor<f32>):
+    %1 = stablehlo.maximum %arg1, %arg2 : tensor<f32>
+    "stablehlo.return"(%1) : (tensor<f32>) -> ()
+  }) {
+    window_dimensions = array<i64: 1, 3, 3, 1>,
+    window_strides = array<i64: 1, 2, 2, 1>,
+    padding = dense<[[0, 0], [0, 1], [0, 1], [0, 0]]> : tensor<4x2xi64>
+  } : (tensor<1x8x8x3xf32>, tensor<f32>) -> tensor<1x4x4x3xf32>
+  return %0 : tensor<1x4x4x3xf32>
+}
+
+// CHECK-LABEL: @reduce_window_sum
+func.func @reduce_window_sum(%arg0 : tensor<1x8x8x3xf32>) -> tensor<1x4x4x3xf32> {
+  // CHECK-DAG: %[[SCALE:.*]] = "tosa.const"() <{value = dense<4.000000e+00> : tensor<1x1x1x1xf32>}>
+  // CHECK-DAG: %[[AVG:.*]] = tosa.avg_pool2d %arg0 {acc_type = f32, kernel = array<i64: 2, 2>, pad = array<i64: 0, 0, 0, 0>, stride = array<i64: 2, 2>}
+  // CHECK: tosa.mul %[[AVG]], %[[SCALE]] {shift = 0 : i8}
+  %init = stablehlo.constant dense<0.0> : tensor<f32>
+  %0 = "stablehlo.reduce_window"(%arg0, %init) ({
+  ^bb0(%arg1: tensor<f32>, %arg2: tensor<f32>):
+    %1 = stablehlo.add %arg1, %arg2 : tensor<f32>
+    "stablehlo.return"(%1) : (tensor<f32>) -> ()
+  }) {window_dimensions = array<i64: 1, 2, 2, 1>, window_strides = array<i64: 1, 2, 2, 1>} : (tensor<1x8x8x3xf32>, tensor<f32>) -> tensor<1x4x4x3xf32>
+  return %0 : tensor<1x4x4x3xf32>
+}
+
 // CHECK-LABEL: @shift_left
 func.func @shift_left(%arg0 : tensor<10xi32>, %arg1 : tensor<10xi32>) -> tensor<10xi32> {
   // CHECK: tosa.logical_left_shift
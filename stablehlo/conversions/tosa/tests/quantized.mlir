@@ -0,0 +1,77 @@
+// RUN: stablehlo-opt %s --stablehlo-legalize-to-tosa | FileCheck %s
+
+// CHECK-LABEL: @dot_general
+func.func @dot_general(%arg0 : tensor<4x8x!quant.uniform<i8:f32, 5.000000e-01:1>>, %arg1 : tensor<8x16x!quant.uniform<i8:f32, 2.500000e-01>>) -> tensor<4x16x!quant.uniform<i8:f32, 1.250000e-01:-2>> {
+  // CHECK: %[[MATMUL:.*]] = tosa.matmul %{{.*}}, %{{.*}} {quantization_info = #tosa.matmul_quant<a_zp = 1, b_zp = 0>} : {{.*}} -> tensor<1x4x16xi32>
+  // CHECK: %[[RESCALE:.*]] = tosa.rescale %[[MATMUL]]
+  // CHECK-SAME: input_zp = 0 : i32, multiplier = array<i32: 1073741824>, output_zp = -2 : i32
+  // CHECK-SAME: shift = array<i8: 30>
+  // CHECK: tosa.reshape %[[RESCALE]]
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<4x8x!quant.uniform<i8:f32, 5.000000e-01:1>>, tensor<8x16x!quant.uniform<i8:f32, 2.500000e-01>>) -> tensor<4x16x!quant.uniform<i8:f32, 1.250000e-01:-2>>
+  return %0 : tensor<4x16x!quant.uniform<i8:f32, 1.250000e-01:-2>>
+}
+
+// CHECK-LABEL: @dot_general_requantize
+func.func @dot_general_requantize(%arg0 : tensor<4x8x!quant.uniform<i8:f32, 5.000000e-01>>, %arg1 : tensor<8x16x!quant.uniform<i8:f32, 2.500000e-01>>) -> tensor<4x16x!quant.uniform<i8:f32, 2.500000e-01:3>> {
+  // The rescale of the i32 accumulator and the requantization to i8 are fused.
+  // CHECK: %[[MATMUL:.*]] = tosa.matmul
+  // CHECK: %[[RESCALE:.*]] = tosa.rescale %[[MATMUL]]
+  // CHECK-SAME: input_zp = 0 : i32, multiplier = array<i32: 1073741824>, output_zp = 3 : i32
+  // CHECK-SAME: shift = array<i8: 31>
+  // CHECK-SAME: -> tensor<1x4x16x!quant.uniform<i8:f32, 2.500000e-01:3>>
+  // CHECK-NOT: tosa.rescale
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<4x8x!quant.uniform<i8:f32, 5.000000e-01>>, tensor<8x16x!quant.uniform<i8:f32, 2.500000e-01>>) -> tensor<4x16x!quant.uniform<i32:f32, 1.250000e-01>>
+  %1 = stablehlo.uniform_quantize %0 : (tensor<4x16x!quant.uniform<i32:f32, 1.250000e-01>>) -> tensor<4x16x!quant.uniform<i8:f32, 2.500000e-01:3>>
+  return %1 : tensor<4x16x!quant.uniform<i8:f32, 2.500000e-01:3>>
+}
+
+// CHECK-LABEL: @convolution
+func.func @convolution(%arg0 : tensor<1x8x8x3x!quant.uniform<i8:f32, 5.000000e-01>>, %arg1 : tensor<3x3x3x2x!quant.uniform<i8:f32:3, {2.500000e-01, 1.250000e-01}>>) -> tensor<1x8x8x2x!quant.uniform<i8:f32, 2.500000e-01>> {
+  // CHECK-DAG: %[[BIAS:.*]] = "tosa.const"() <{value = dense<0> : tensor<2xi32>}>
+  // CHECK: %[[WEIGHT:.*]] = tosa.transpose %arg1, %{{.*}} -> tensor<2x3x3x3x!quant.uniform<i8:f32:0, {2.500000e-01,1.250000e-01}>>
+  // CHECK: %[[CONV:.*]] = tosa.conv2d %arg0, %[[WEIGHT]], %[[BIAS]]
+  // CHECK-SAME: -> tensor<1x8x8x2xi32>
+  // CHECK: tosa.rescale %[[CONV]]
+  // CHECK-SAME: multiplier = array<i32: 1073741824, 1073741824>
+  // CHECK-SAME: per_channel = true
+  // CHECK-SAME: shift = array<i8: 31, 32>
+  %0 = stablehlo.convolution(%arg0, %arg1)
+    dim_numbers = [b, 0, 1, f]x[0, 1, i, o]->[b, 0, 1, f],
+    window = {stride = [1, 1], pad = [[1, 1], [1, 1]]}
+    {batch_group_count = 1 : i64, feature_group_count = 1 : i64}
+    : (tensor<1x8x8x3x!quant.uniform<i8:f32, 5.000000e-01>>, tensor<3x3x3x2x!quant.uniform<i8:f32:3, {2.500000e-01, 1.250000e-01}>>) -> tensor<1x8x8x2x!quant.uniform<i8:f32, 2.500000e-01>>
+  return %0 : tensor<1x8x8x2x!quant.uniform<i8:f32, 2.500000e-01>>
+}
+
+// CHECK-LABEL: @add
+func.func @add(%arg0 : tensor<10x!quant.uniform<i8:f32, 5.000000e-01:-1>>, %arg1 : tensor<10x!quant.uniform<i8:f32, 2.500000e-01:2>>) -> tensor<10x!quant.uniform<i8:f32, 1.000000e+00>> {
+  // CHECK: %[[LHS:.*]] = tosa.rescale %arg0 {{.*}}input_zp = -1 : i32{{.*}} -> tensor<10xi32>
+  // CHECK: %[[RHS:.*]] = tosa.rescale %arg1 {{.*}}input_zp = 2 : i32{{.*}} -> tensor<10xi32>
+  // CHECK: %[[ADD:.*]] = tosa.add %[[LHS]], %[[RHS]] : (tensor<10xi32>, tensor<10xi32>) -> tensor<10xi32>
+  // CHECK: tosa.rescale %[[ADD]] {{.*}} -> tensor<10x!quant.uniform<i8:f32, 1.000000e+00>>
+  %0 = stablehlo.add %arg0, %arg1 : (tensor<10x!quant.uniform<i8:f32, 5.000000e-01:-1>>, tensor<10x!quant.uniform<i8:f32, 2.500000e-01:2>>) -> tensor<10x!quant.uniform<i8:f32, 1.000000e+00>>
+  return %0 : tensor<10x!quant.uniform<i8:f32, 1.000000e+00>>
+}
+
+// CHECK-LABEL: @uniform_quantize
+func.func @uniform_quantize(%arg0 : tensor<10xf32>) -> tensor<10x!quant.uniform<i8:f32, 5.000000e-01:3>> {
+  // CHECK-DAG: %[[SCALE:.*]] = "tosa.const"() <{value = dense<2.000000e+00> : tensor<1xf32>}>
+  // CHECK-DAG: %[[ZP:.*]] = "tosa.const"() <{value = dense<3.000000e+00> : tensor<1xf32>}>
+  // CHECK: %[[MUL:.*]] = tosa.mul %arg0, %[[SCALE]]
+  // CHECK: %[[ADD:.*]] = tosa.add %[[MUL]], %[[ZP]]
+  // CHECK: %[[CLAMP:.*]] = tosa.clamp %[[ADD]] {max_fp = 1.270000e+02 : f32, max_int = 127 : i64, min_fp = -1.280000e+02 : f32, min_int = -128 : i64}
+  // CHECK: tosa.cast %[[CLAMP]] : (tensor<10xf32>) -> tensor<10x!quant.uniform<i8:f32, 5.000000e-01:3>>
+  %0 = stablehlo.uniform_quantize %arg0 : (tensor<10xf32>) -> tensor<10x!quant.uniform<i8:f32, 5.000000e-01:3>>
+  return %0 : tensor<10x!quant.uniform<i8:f32, 5.000000e-01:3>>
+}
+
+// CHECK-LABEL: @uniform_dequantize
+func.func @uniform_dequantize(%arg0 : tensor<10x!quant.uniform<i8:f32, 5.000000e-01:3>>) -> tensor<10xf32> {
+  // CHECK-DAG: %[[ZP:.*]] = "tosa.const"() <{value = dense<3.000000e+00> : tensor<1xf32>}>
+  // CHECK-DAG: %[[SCALE:.*]] = "tosa.const"() <{value = dense<5.000000e-01> : tensor<1xf32>}>
+  // CHECK: %[[CAST:.*]] = tosa.cast %arg0 : (tensor<10x!quant.uniform<i8:f32, 5.000000e-01:3>>) -> tensor<10xf32>
+  // CHECK: %[[SUB:.*]] = tosa.sub %[[CAST]], %[[ZP]]
+  // CHECK: tosa.mul %[[SUB]], %[[SCALE]]
+  %0 = stablehlo.uniform_dequantize %arg0 : (tensor<10x!quant.uniform<i8:f32, 5.000000e-01:3>>) -> tensor<10xf32>
+  return %0 : tensor<10xf32>
+}
@@ -7,6 +7,14 @@ func.func @abs(%arg : tensor<10xf32>) -> tensor<10xf32> {
   return %0 : tensor<10xf32>
 }
 
+// CHECK-LABEL: @broadcast_in_dim
+func.func @broadcast_in_dim(%arg : tensor<3x1xf32>) -> tensor<2x3x4xf32> {
+  // CHECK: %[[RESHAPE:.*]] = tosa.reshape %arg {new_shape = array<i64: 1, 3, 1>}
+  // CHECK: tosa.tile %[[RESHAPE]] {multiples = array<i64: 2, 1, 4>}
+  %0 = "stablehlo.broadcast_in_dim"(%arg) {broadcast_dimensions = array<i64: 1, 2>} : (tensor<3x1xf32>) -> tensor<2x3x4xf32>
+  return %0 : tensor<2x3x4xf32>
+}
+
 // CHECK-LABEL: @ceil
 func.func @ceil(%arg : tensor<10xf32>) -> tensor<10xf32> {
   // CHECK: tosa.ceil
@@ -13,13 +13,27 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <type_traits>
 #include <utility>
 
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/Quant/QuantTypes.h"
 #include "mlir/Dialect/Tosa/IR/TosaOps.h"
+#include "mlir/Dialect/Tosa/Utils/QuantUtils.h"
+#include "mlir/Dialect/Utils/IndexingUtils.h"
 #include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
 #include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/TypeUtilities.h"
 #include "mlir/Parser/Parser.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
@@ -48,6 +62,235 @@ struct StablehloLegalizeToTosaPass
   FrozenRewritePatternSet patterns;
 };
 
+// Returns `value` transposed by `permutation`, or `value` itself if
+// `permutation` is the identity. The quantized dimension of per-axis
+// quantized values is permuted as well.
+Value transposeIfNeeded(PatternRewriter& rewriter, Location loc, Value value,
+                        ArrayRef<int64_t> permutation) {
+  if (isIdentityPermutation(permutation)) return value;
+
+  auto type = cast<RankedTensorType>(value.getType());
+  llvm::SmallVector<int64_t, 4> shape;
+  for (int64_t dim : permutation) shape.push_back(type.getDimSize(dim));
+  Type elementType = type.getElementType();
+  if (auto perAxisType =
+          dyn_cast<quant::UniformQuantizedPerAxisType>(elementType)) {
+    auto quantizedDim = llvm::find(permutation,
+                                   perAxisType.getQuantizedDimension()) -
+                        permutation.begin();
+    elementType = quant::UniformQuantizedPerAxisType::get(
+        perAxisType.getFlags(), perAxisType.getStorageType(),
+        perAxisType.getExpressedType(), perAxisType.getScales(),
+        perAxisType.getZeroPoints(), quantizedDim,
+        perAxisType.getStorageTypeMin(), perAxisType.getStorageTypeMax());
+  }
+
+  auto permsType = RankedTensorType::get(
+      {static_cast<int64_t>(permutation.size())}, rewriter.getI64Type());
+  auto permsOp = rewriter.create<tosa::ConstOp>(
+      loc, permsType, DenseIntElementsAttr::get(permsType, permutation));
+  return rewriter.create<tosa::TransposeOp>(
+      loc, RankedTensorType::get(shape, elementType), value, permsOp);
+}
+
+// Returns a constant of `elementType` and `rank` dimensions of size 1, which
+// TOSA elementwise ops broadcast to the shape of their other operand.
+Value createSplatConst(PatternRewriter& rewriter, Location loc,
+                       Type elementType, int64_t rank, double value) {
+  auto type =
+      RankedTensorType::get(llvm::SmallVector<int64_t>(rank, 1), elementType);
+  Attribute element = isa<FloatType>(elementType)
+                          ? Attribute(rewriter.getFloatAttr(elementType, value))
+                          : Attribute(rewriter.getIntegerAttr(
+                                elementType, static_cast<int64_t>(value)));
+  return rewriter.create<tosa::ConstOp>(loc, type,
+                                        DenseElementsAttr::get(type, element));
+}
+
+// Returns whether `type` is a per-tensor quantized type with 8-bit storage,
+// which is the input type of the quantized TOSA ops supported here.
+bool isQuantized8Bit(Type type) {
+  auto quantizedType = dyn_cast_if_present<quant::UniformQuantizedType>(type);
+  return quantizedType && quantizedType.getStorageTypeIntegralWidth() == 8;
+}
+
+// Returns a tosa.rescale of `input` to `outputType`, which computes
+// `(input - inputZp) * scale + outputZp` for one of `scales` per channel of
+// the last dimension, or for the single one of `scales`.
+Value createRescale(PatternRewriter& rewriter, Location loc, Type outputType,
+                    Value input, ArrayRef<double> scales, int64_t inputZp,
+                    int64_t outputZp) {
+  llvm::SmallVector<int32_t, 1> multipliers;
+  llvm::SmallVector<int8_t, 1> shifts;
+  for (double scale : scales) {
+    int32_t multiplier, shift;
+    computeMultiplierAndShift(scale, multiplier, shift, /*scaleWidth=*/32);
+    multipliers.push_back(multiplier);
+    shifts.push_back(shift);
+  }
+  return rewriter.create<tosa::RescaleOp>(
+      loc, outputType, input, rewriter.getI32IntegerAttr(inputZp),
+      rewriter.getI32IntegerAttr(outputZp),
+      rewriter.getDenseI32ArrayAttr(multipliers),
+      rewriter.getDenseI8ArrayAttr(shifts),
+      /*scale32=*/rewriter.getBoolAttr(true),
+      /*double_round=*/rewriter.getBoolAttr(true),
+      /*per_channel=*/rewriter.getBoolAttr(scales.size() > 1));
+}
+
+// Returns the broadcast_in_dim which defines `value` if TOSA elementwise ops
+// can broadcast its operand implicitly, i.e. if it only adds dimensions or
+// expands dimensions of size 1 without transposing its operand.
+stablehlo::BroadcastInDimOp getFoldableBroadcast(Value value) {
+  auto broadcastOp = value.getDefiningOp<stablehlo::BroadcastInDimOp>();
+  if (!broadcastOp || !broadcastOp.getOperand().getType().hasStaticShape())
+    return nullptr;
+  if (!llvm::is_sorted(broadcastOp.getBroadcastDimensions())) return nullptr;
+  return broadcastOp;
+}
+
+// Returns the operand of the foldable `broadcastOp` reshaped to the rank of
+// its result, with dimensions of size 1 where it is broadcasted.
+Value foldBroadcast(PatternRewriter& rewriter,
+                    stablehlo::BroadcastInDimOp broadcastOp) {
+  auto operand = broadcastOp.getOperand();
+  auto operandType = operand.getType();
+  auto resultRank = broadcastOp.getType().getRank();
+  if (operandType.getRank() == resultRank) return operand;
+
+  llvm::SmallVector<int64_t, 4> shape(resultRank, 1);
+  for (auto [operandDim, resultDim] :
+       llvm::enumerate(broadcastOp.getBroadcastDimensions()))
+    shape[resultDim] = operandType.getDimSize(operandDim);
+  return rewriter.create<tosa::ReshapeOp>(
+      broadcastOp->getLoc(), operandType.clone(shape), operand,
+      rewriter.getDenseI64ArrayAttr(shape));
+}
+
+// Returns whether `op` is lowered by `ConvertStablehloBroadcastingBinaryOp`.
+bool foldsBroadcasts(Operation* op) {
+  return isa<stablehlo::AddOp, stablehlo::MaxOp, stablehlo::MinOp,
+             stablehlo::MulOp, stablehlo::SubtractOp>(op);
+}
+
+// Lowers a broadcast_in_dim to a tosa.reshape and a tosa.tile, unless all its
+// users fold it, see `ConvertStablehloBroadcastingBinaryOp`.
+struct ConvertStablehloBroadcastInDimOp
+    : public OpRewritePattern<stablehlo::BroadcastInDimOp> {
+  using OpRewritePattern<stablehlo::BroadcastInDimOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(stablehlo::BroadcastInDimOp op,
+                                PatternRewriter& rewriter) const override {
+    if (!getFoldableBroadcast(op.getResult()))
+      return rewriter.notifyMatchFailure(
+          op, "only broadcasts of static operands without transposes "
+              "supported");
+    auto resultType = op.getType();
+    if (!resultType.hasStaticShape())
+      return rewriter.notifyMatchFailure(op, "result tensor must be static");
+
+    if (!op->use_empty() && llvm::all_of(op->getUsers(), foldsBroadcasts))
+      return rewriter.notifyMatchFailure(op, "folded into its users");
+
+    Value reshaped = foldBroadcast(rewriter, op);
+    auto reshapedShape = cast<RankedTensorType>(reshaped.getType()).getShape();
+    llvm::SmallVector<int64_t, 4> multiples;
+    for (auto [reshapedSize, resultSize] :
+         llvm::zip_equal(reshapedShape, resultType.getShape()))
+      multiples.push_back(reshapedSize == resultSize ? 1 : resultSize);
+    rewriter.replaceOpWithNewOp<tosa::TileOp>(
+        op, resultType, reshaped, rewriter.getDenseI64ArrayAttr(multiples));
+    return success();
+  }
+};
+
+// Lowers an elementwise binary op with an operand defined by a foldable
+// broadcast_in_dim to a TOSA op which broadcasts the operand of the
+// broadcast_in_dim implicitly, so that the broadcast is never materialized.
+template <typename StablehloOpTy, typename TosaOpTy>
+struct ConvertStablehloBroadcastingBinaryOp
+    : public OpRewritePattern<StablehloOpTy> {
+  explicit ConvertStablehloBroadcastingBinaryOp(MLIRContext* context)
+      : OpRewritePattern<StablehloOpTy>(context, /*benefit=*/2) {}
+
+  LogicalResult matchAndRewrite(StablehloOpTy op,
+                                PatternRewriter& rewriter) const override {
+    if (isa<quant::QuantizedType>(getElementTypeOrSelf(op.getType())))
+      return rewriter.notifyMatchFailure(op, "quantized types not supported");
+    auto lhsBroadcastOp = getFoldableBroadcast(op.getLhs());
+    auto rhsBroadcastOp = getFoldableBroadcast(op.getRhs());
+    if (!lhsBroadcastOp && !rhsBroadcastOp)
+      return rewriter.notifyMatchFailure(op, "no broadcast to fold");
+
+    Value lhs =
+        lhsBroadcastOp ? foldBroadcast(rewriter, lhsBroadcastOp) : op.getLhs();
+    Value rhs =
+        rhsBroadcastOp ? foldBroadcast(rewriter, rhsBroadcastOp) : op.getRhs();
+    if constexpr (std::is_same_v<TosaOpTy, tosa::MulOp>) {
+      rewriter.replaceOpWithNewOp<tosa::MulOp>(op, op.getType(), lhs, rhs,
+                                               rewriter.getI8IntegerAttr(0));
+    } else {
+      rewriter.replaceOpWithNewOp<TosaOpTy>(op, op.getType(), lhs, rhs);
+    }
+    return success();
+  }
+};
+
+// Lowers an add or subtract of per-tensor quantized 8-bit values to a TOSA
+// op on i32 values. Both operands are rescaled to twice the larger of their
+// scales, with 20 bits of headroom for precision, and the result is rescaled
+// to the result type.
+template <typename StablehloOpTy, typename TosaOpTy>
+struct ConvertStablehloQuantizedBinaryOp
+    : public OpRewritePattern<StablehloOpTy> {
+  explicit ConvertStablehloQuantizedBinaryOp(MLIRContext* context)
+      : OpRewritePattern<StablehloOpTy>(context, /*benefit=*/2) {}
+
+  LogicalResult matchAndRewrite(StablehloOpTy op,
+                                PatternRewriter& rewriter) const override {
+    auto lhsType = cast<ShapedType>(op.getLhs().getType());
+    auto rhsType = cast<ShapedType>(op.getRhs().getType());
+    auto resultType = cast<ShapedType>(op.getType());
+    auto lhsQType =
+        dyn_cast<quant::UniformQuantizedType>(lhsType.getElementType());
+    auto rhsQType =
+        dyn_cast<quant::UniformQuantizedType>(rhsType.getElementType());
+    auto resultQType =
+        dyn_cast<quant::UniformQuantizedType>(resultType.getElementType());
+    if (!lhsQType && !rhsQType && !resultQType)
+      return rewriter.notifyMatchFailure(op, "not quantized");
+    if (!isQuantized8Bit(lhsQType) || !isQuantized8Bit(rhsQType) ||
+        !isQuantized8Bit(resultQType)) {
+      return rewriter.notifyMatchFailure(
+          op, "only per-tensor quantized 8-bit types supported");
+    }
+
+    constexpr int kInputShift = 20;
+    double inputShiftScale = static_cast<double>(1 << kInputShift);
+    double maxScale2x =
+        2.0 * std::max(lhsQType.getScale(), rhsQType.getScale());
+
+    auto loc = op->getLoc();
+    auto i32Type = rewriter.getI32Type();
+    Value lhs = createRescale(
+        rewriter, loc, lhsType.clone(i32Type), op.getLhs(),
+        {lhsQType.getScale() * inputShiftScale / maxScale2x},
+        lhsQType.getZeroPoint(), /*outputZp=*/0);
+    Value rhs = createRescale(
+        rewriter, loc, rhsType.clone(i32Type), op.getRhs(),
+        {rhsQType.getScale() * inputShiftScale / maxScale2x},
+        rhsQType.getZeroPoint(), /*outputZp=*/0);
+    Value result =
+        rewriter.create<TosaOpTy>(loc, resultType.clone(i32Type), lhs, rhs);
+    rewriter.replaceOp(
+        op, createRescale(
+                rewriter, loc, resultType, result,
+                {maxScale2x / (resultQType.getScale() * inputShiftScale)},
+                /*inputZp=*/0, resultQType.getZeroPoint()));
+    return success();
+  }
+};
+
 struct ConvertStablehloCompareOp
     : public OpRewritePattern<stablehlo::CompareOp> {
   using OpRewritePattern<stablehlo::CompareOp>::OpRewritePattern;
@@ -92,86 +335,284 @@ struct ConvertStablehloConcatenateOp
   }
 };
 
-template <typename DotOpTy>
-LogicalResult rewriteSimpleDotOp(DotOpTy op, PatternRewriter& rewriter) {
-  auto lhsType = op.getLhs().getType();
-  auto rhsType = op.getRhs().getType();
+// Lowers 2D convolutions, and depthwise convolutions, i.e. grouped
+// convolutions with one input feature per group, to tosa.conv2d and
+// tosa.depthwise_conv2d. Other layouts than NHWC are transposed.
+struct ConvertStablehloConvolutionOp
+    : public OpRewritePattern<stablehlo::ConvolutionOp> {
+  using OpRewritePattern<stablehlo::ConvolutionOp>::OpRewritePattern;
 
-  auto resultType = op.getType();
+  LogicalResult matchAndRewrite(stablehlo::ConvolutionOp op,
+                                PatternRewriter& rewriter) const override {
+    auto lhsType = op.getLhs().getType();
+    auto rhsType = cast<RankedTensorType>(op.getRhs().getType());
+    auto resultType = cast<RankedTensorType>(op.getType());
+    if (!rhsType.hasStaticShape()) {
+      return rewriter.notifyMatchFailure(op, "rhs tensor must be static");
+    }
+
+    auto dims = op.getDimensionNumbers();
+    // Quantized convolutions accumulate in i32 and are rescaled to the result
+    // type, with one scale per output feature for per-axis quantized weights.
+    auto inputQType =
+        dyn_cast<quant::UniformQuantizedType>(lhsType.getElementType());
+    auto resultQType =
+        dyn_cast<quant::UniformQuantizedType>(resultType.getElementType());
+    llvm::SmallVector<double, 1> weightScales;
+    if (inputQType) {
+      Type weightType = rhsType.getElementType();
+      if (auto weightQType = dyn_cast<quant::UniformQuantizedType>(weightType);
+          isQuantized8Bit(weightQType)) {
+        weightScales.push_back(weightQType.getScale());
+      } else if (auto perAxisType =
+                     dyn_cast<quant::UniformQuantizedPerAxisType>(weightType);
+                 perAxisType &&
+                 perAxisType.getStorageTypeIntegralWidth() == 8 &&
+                 perAxisType.getQuantizedDimension() ==
+                     dims.getKernelOutputFeatureDimension() &&
+                 op.getFeatureGroupCount() == 1) {
+        weightScales = llvm::to_vector<1>(perAxisType.getScales());
+      }
+      if (!isQuantized8Bit(inputQType) || weightScales.empty() ||
+          !resultQType) {
+        return rewriter.notifyMatchFailure(
+            op, "only quantized convolutions of 8-bit types with per-tensor "
+                "or per-output-feature weights supported");
+      }
+    } else if (!isa<FloatType>(lhsType.getElementType()) ||
+               lhsType.getElementType() != rhsType.getElementType()) {
+      return rewriter.notifyMatchFailure(
+          op, "only float convolutions with matching types supported");
+    }
+    if (dims.getInputSpatialDimensions().size() != 2) {
+      return rewriter.notifyMatchFailure(op, "only 2D convolutions supported");
+    }
+    if (op.getBatchGroupCount() != 1) {
+      return rewriter.notifyMatchFailure(op, "batch groups not supported");
+    }
+    auto isOne = [](int64_t value) { return value == 1; };
+    if (op.getLhsDilation() && !llvm::all_of(*op.getLhsDilation(), isOne)) {
+      return rewriter.notifyMatchFailure(op, "lhs dilation not supported");
+    }
+    if (op.getWindowReversal() &&
+        llvm::is_contained(*op.getWindowReversal(), true)) {
+      return rewriter.notifyMatchFailure(op, "window reversal not supported");
+    }
+
+    // TOSA padding is [top, bottom, left, right].
+    llvm::SmallVector<int64_t, 4> pad(4, 0);
+    if (auto padding = op.getPadding()) {
+      pad = llvm::to_vector<4>(padding->getValues<int64_t>());
+      if (llvm::any_of(pad, [](int64_t value) { return value < 0; })) {
+        return rewriter.notifyMatchFailure(op,
+                                           "negative padding not supported");
+      }
+    }
+    llvm::SmallVector<int64_t, 2> stride(2, 1);
+    if (auto windowStrides = op.getWindowStrides()) {
+      stride = llvm::to_vector<2>(*windowStrides);
+    }
+    llvm::SmallVector<int64_t, 2> dilation(2, 1);
+    if (auto rhsDilation = op.getRhsDilation()) {
+      dilation = llvm::to_vector<2>(*rhsDilation);
+    }
+
+    int64_t groups = op.getFeatureGroupCount();
+    int64_t kernelInputFeatures =
+        rhsType.getDimSize(dims.getKernelInputFeatureDimension());
+    if (groups != 1 && kernelInputFeatures != 1) {
+      return rewriter.notifyMatchFailure(
+          op, "only depthwise grouped convolutions supported");
+    }
+
+    auto loc = op->getLoc();
+    auto inputSpatial = dims.getInputSpatialDimensions();
+    Value input = transposeIfNeeded(
+        rewriter, loc, op.getLhs(),
+        {dims.getInputBatchDimension(), inputSpatial[0], inputSpatial[1],
+         dims.getInputFeatureDimension()});
+
+    auto outputSpatial = dims.getOutputSpatialDimensions();
+    llvm::SmallVector<int64_t, 4> outputPermutation = {
+        dims.getOutputBatchDimension(), outputSpatial[0], outputSpatial[1],
+        dims.getOutputFeatureDimension()};
+    llvm::SmallVector<int64_t, 4> outputShape;
+    for (int64_t dim : outputPermutation)
+      outputShape.push_back(resultType.getDimSize(dim));
+    Type accType =
+        inputQType ? rewriter.getI32Type() : resultType.getElementType();
+    auto outputType = RankedTensorType::get(outputShape, accType);
+
+    int64_t outputFeatures = outputShape[3];
+    auto biasType = RankedTensorType::get({outputFeatures}, accType);
+    auto biasOp = rewriter.create<tosa::ConstOp>(
+        loc, biasType, DenseElementsAttr::get(biasType, rewriter.getZeroAttr(
+                                                            accType)));
+
+    auto kernelSpatial = dims.getKernelSpatialDimensions();
+    Value output;
+    if (groups == 1) {
+      // tosa.conv2d takes weights as [OC, KH, KW, IC].
+      Value weight = transposeIfNeeded(
+          rewriter, loc, op.getRhs(),
+          {dims.getKernelOutputFeatureDimension(), kernelSpatial[0],
+           kernelSpatial[1], dims.getKernelInputFeatureDimension()});
+      output = rewriter.create<tosa::Conv2DOp>(
+          loc, outputType, input, weight, biasOp,
+          rewriter.getDenseI64ArrayAttr(pad),
+          rewriter.getDenseI64ArrayAttr(stride),
+          rewriter.getDenseI64ArrayAttr(dilation));
+    } else {
+      // tosa.depthwise_conv2d takes weights as [KH, KW, C, M], where the
+      // output features c * M to c * M + M - 1 are computed from the input
+      // feature c, as the output features of group c of the convolution.
+      Value weight = transposeIfNeeded(
+          rewriter, loc, op.getRhs(),
+          {kernelSpatial[0], kernelSpatial[1],
+           dims.getKernelInputFeatureDimension(),
+           dims.getKernelOutputFeatureDimension()});
+      llvm::SmallVector<int64_t, 4> weightShape = {
+          rhsType.getDimSize(kernelSpatial[0]),
+          rhsType.getDimSize(kernelSpatial[1]), groups,
+          outputFeatures / groups};
+      weight = rewriter.create<tosa::ReshapeOp>(
+          loc, rhsType.clone(weightShape), weight,
+          rewriter.getDenseI64ArrayAttr(weightShape));
+      output = rewriter.create<tosa::DepthwiseConv2DOp>(
+          loc, outputType, input, weight, biasOp,
+          rewriter.getDenseI64ArrayAttr(pad),
+          rewriter.getDenseI64ArrayAttr(stride),
+          rewriter.getDenseI64ArrayAttr(dilation));
+    }
+
+    if (inputQType) {
+      llvm::SmallVector<double, 1> scales;
+      for (double weightScale : weightScales)
+        scales.push_back(inputQType.getScale() * weightScale /
+                         resultQType.getScale());
+      output = createRescale(rewriter, loc, outputType.clone(resultQType),
+                             output, scales, /*inputZp=*/0,
+                             resultQType.getZeroPoint());
+    }
+
+    rewriter.replaceOp(op, transposeIfNeeded(
+                               rewriter, loc, output,
+                               invertPermutationVector(outputPermutation)));
+    return success();
+  }
+};
+
+// Returns `value` reshaped to the static `shape`, or `value` itself if it
+// already has that shape.
+Value reshapeIfNeeded(PatternRewriter& rewriter, Location loc, Value value,
+                      ArrayRef<int64_t> shape) {
+  auto type = cast<RankedTensorType>(value.getType());
+  if (type.getShape() == shape) return value;
+  return rewriter.create<tosa::ReshapeOp>(loc, type.clone(shape), value,
+                                          rewriter.getDenseI64ArrayAttr(shape));
+}
+
+// Lowers a dot with arbitrary batching and contracting dimensions to a single
+// tosa.matmul. The lhs is transposed to [batch..., free..., contracting...]
+// and the rhs to [batch..., contracting..., free...], which are collapsed to
+// [B, M, K] and [B, K, N]. The [B, M, N] product is then already in the
+// dimension order of the result, and only needs to be expanded. Transposes
+// and reshapes are only emitted where the layout differs, and the reshapes
+// between chained dots fold away.
+LogicalResult rewriteDotOp(Operation* op, Value lhs, Value rhs,
+                           ArrayRef<int64_t> lhsBatchingDims,
+                           ArrayRef<int64_t> rhsBatchingDims,
+                           ArrayRef<int64_t> lhsContractingDims,
+                           ArrayRef<int64_t> rhsContractingDims,
+                           PatternRewriter& rewriter) {
+  auto lhsType = cast<RankedTensorType>(lhs.getType());
+  auto rhsType = cast<RankedTensorType>(rhs.getType());
+  auto resultType = dyn_cast<RankedTensorType>(op->getResult(0).getType());
   if (!resultType) {
     return rewriter.notifyMatchFailure(op, "result tensor does not have shape");
   }
+  if (!lhsType.hasStaticShape() || !rhsType.hasStaticShape()) {
+    return rewriter.notifyMatchFailure(op, "operands must be static");
+  }
 
-  if (lhsType.getElementType() != rhsType.getElementType()) {
+  // Quantized dots accumulate in i32 and are rescaled to the result type.
+  auto lhsQType =
+      dyn_cast<quant::UniformQuantizedType>(lhsType.getElementType());
+  auto rhsQType =
+      dyn_cast<quant::UniformQuantizedType>(rhsType.getElementType());
+  auto resultQType =
+      dyn_cast<quant::UniformQuantizedType>(resultType.getElementType());
+  bool isQuantized = lhsQType || rhsQType || resultQType;
+  if (isQuantized) {
+    if (!isQuantized8Bit(lhsQType) || !isQuantized8Bit(rhsQType) ||
+        !resultQType) {
+      return rewriter.notifyMatchFailure(
+          op, "only per-tensor quantized dots of 8-bit types supported");
+    }
+  } else if (lhsType.getElementType() != rhsType.getElementType()) {
     return rewriter.notifyMatchFailure(op,
                                        "lhs and rhs element types must match");
   }
 
-  auto lhsShape = lhsType.getShape();
-  auto rhsShape = rhsType.getShape();
-  auto resultShape = resultType.getShape();
-  llvm::SmallVector<int64_t, 3> lhsReshape;
-  llvm::SmallVector<int64_t, 3> rhsReshape;
-  llvm::SmallVector<int64_t, 3> matMulShape;
-
-  // tosa.matmul requires input tensors to have a rank of 3, so lhs and rhs
-  // need to be reshaped first.
-  if (lhsType.getRank() == 1) {
-    // Reshape lhs to [1, 1, N].
-    lhsReshape = {1, 1, lhsShape[0]};
-    if (rhsType.getRank() == 1) {
-      // Reshape rhs to [1, N, 1].
-      rhsReshape = {1, rhsShape[0], 1};
-      // MatMul shape is [1, 1, 1].
-      matMulShape = {1, 1, 1};
-    } else if (rhsType.getRank() == 2) {
-      // Reshape rhs to [1, N, K].
-      rhsReshape = {1, rhsShape[0], rhsShape[1]};
-      // MatMul shape is [1, 1, K].
-      matMulShape = {1, 1, rhsShape[1]};
-    } else {
-      return rewriter.notifyMatchFailure(op, "rhs must have rank of 1 or 2");
-    }
-  } else if (lhsType.getRank() == 2) {
-    // Reshape lhs to [1, M, K].
-    lhsReshape = {1, lhsShape[0], lhsShape[1]};
-    if (rhsType.getRank() == 1) {
-      // Reshape rhs to [1, K, 1].
-      rhsReshape = {1, rhsShape[0], 1};
-      // MatMul shape is [1, M, 1].
-      matMulShape = {1, lhsShape[0], 1};
-    } else if (rhsType.getRank() == 2) {
-      // Reshape rhs to [1, K, N].
-      rhsReshape = {1, rhsShape[0], rhsShape[1]};
-      // MatMul shape is [1, M, N].
-      matMulShape = {1, lhsShape[0], rhsShape[1]};
-    } else {
-      return rewriter.notifyMatchFailure(op, "rhs must have rank of 1 or 2");
+  auto getFreeDims = [](int64_t rank, ArrayRef<int64_t> batchingDims,
+                        ArrayRef<int64_t> contractingDims) {
+    llvm::SmallVector<int64_t, 4> freeDims;
+    for (int64_t dim = 0; dim < rank; ++dim) {
+      if (!llvm::is_contained(batchingDims, dim) &&
+          !llvm::is_contained(contractingDims, dim))
+        freeDims.push_back(dim);
     }
-  } else {
-    return rewriter.notifyMatchFailure(op, "lhs must have rank of 1 or 2");
+    return freeDims;
+  };
+  auto getSize = [](RankedTensorType type, ArrayRef<int64_t> dims) {
+    int64_t size = 1;
+    for (int64_t dim : dims) size *= type.getDimSize(dim);
+    return size;
+  };
+  auto lhsFreeDims =
+      getFreeDims(lhsType.getRank(), lhsBatchingDims, lhsContractingDims);
+  auto rhsFreeDims =
+      getFreeDims(rhsType.getRank(), rhsBatchingDims, rhsContractingDims);
+  int64_t batchSize = getSize(lhsType, lhsBatchingDims);
+  int64_t lhsFreeSize = getSize(lhsType, lhsFreeDims);
+  int64_t contractingSize = getSize(lhsType, lhsContractingDims);
+  int64_t rhsFreeSize = getSize(rhsType, rhsFreeDims);
+
+  auto loc = op->getLoc();
+  llvm::SmallVector<int64_t, 4> lhsPermutation(lhsBatchingDims);
+  llvm::append_range(lhsPermutation, lhsFreeDims);
+  llvm::append_range(lhsPermutation, lhsContractingDims);
+  Value lhs3d = reshapeIfNeeded(
+      rewriter, loc, transposeIfNeeded(rewriter, loc, lhs, lhsPermutation),
+      {batchSize, lhsFreeSize, contractingSize});
+
+  llvm::SmallVector<int64_t, 4> rhsPermutation(rhsBatchingDims);
+  llvm::append_range(rhsPermutation, rhsContractingDims);
+  llvm::append_range(rhsPermutation, rhsFreeDims);
+  Value rhs3d = reshapeIfNeeded(
+      rewriter, loc, transposeIfNeeded(rewriter, loc, rhs, rhsPermutation),
+      {batchSize, contractingSize, rhsFreeSize});
+
+  auto matMulType = RankedTensorType::get(
+      {batchSize, lhsFreeSize, rhsFreeSize},
+      isQuantized ? rewriter.getI32Type() : lhsType.getElementType());
+  Value matMul =
+      rewriter.create<tosa::MatMulOp>(loc, matMulType, lhs3d, rhs3d);
+  if (isQuantized) {
+    matMul = createRescale(
+        rewriter, loc, matMulType.clone(resultQType), matMul,
+        {lhsQType.getScale() * rhsQType.getScale() / resultQType.getScale()},
+        /*inputZp=*/0, resultQType.getZeroPoint());
   }
 
-  auto lhsReshapeType =
-      RankedTensorType::get(lhsReshape, lhsType.getElementType());
-  auto lhsReshapeOp = rewriter.create<tosa::ReshapeOp>(
-      op->getLoc(), lhsReshapeType, op.getLhs(),
-      rewriter.getDenseI64ArrayAttr(lhsReshape));
-
-  auto rhsReshapeType =
-      RankedTensorType::get(rhsReshape, rhsType.getElementType());
-  auto rhsReshapeOp = rewriter.create<tosa::ReshapeOp>(
-      op->getLoc(), rhsReshapeType, op.getRhs(),
-      rewriter.getDenseI64ArrayAttr(rhsReshape));
-
-  auto matMulType =
-      RankedTensorType::get(matMulShape, lhsType.getElementType());
-  auto matMulOp = rewriter.create<tosa::MatMulOp>(op->getLoc(), matMulType,
-                                                  lhsReshapeOp, rhsReshapeOp);
-
-  // Reshape the matmul result back to the original result shape.
-  rewriter.replaceOpWithNewOp<tosa::ReshapeOp>(
-      op, resultType, matMulOp, rewriter.getDenseI64ArrayAttr(resultShape));
+  // Expand the matmul result back to the original result shape.
+  if (matMul.getType() == resultType) {
+    rewriter.replaceOp(op, matMul);
+  } else {
+    rewriter.replaceOpWithNewOp<tosa::ReshapeOp>(
+        op, resultType, matMul,
+        rewriter.getDenseI64ArrayAttr(resultType.getShape()));
+  }
   return success();
 }
 
@@ -180,7 +621,13 @@ struct ConvertStablehloDotOp : public OpRewritePattern<stablehlo::DotOp> {
 
   LogicalResult matchAndRewrite(stablehlo::DotOp op,
                                 PatternRewriter& rewriter) const override {
-    return rewriteSimpleDotOp(op, rewriter);
+    int64_t lhsRank = op.getLhs().getType().getRank();
+    if (lhsRank > 2 || op.getRhs().getType().getRank() > 2) {
+      return rewriter.notifyMatchFailure(op,
+                                         "operands must have rank of 1 or 2");
+    }
+    return rewriteDotOp(op, op.getLhs(), op.getRhs(), {}, {}, {lhsRank - 1},
+                        {0}, rewriter);
   }
 };
 
@@ -190,9 +637,12 @@ struct ConvertStablehloDotGeneralOp
 
   LogicalResult matchAndRewrite(stablehlo::DotGeneralOp op,
                                 PatternRewriter& rewriter) const override {
-    if (!op.isSimpleDot())
-      return rewriter.notifyMatchFailure(op, "only simple dot op supported");
-    return rewriteSimpleDotOp(op, rewriter);
+    auto dims = op.getDotDimensionNumbers();
+    return rewriteDotOp(op, op.getLhs(), op.getRhs(),
+                        dims.getLhsBatchingDimensions(),
+                        dims.getRhsBatchingDimensions(),
+                        dims.getLhsContractingDimensions(),
+                        dims.getRhsContractingDimensions(), rewriter);
   }
 };
 
@@ -311,6 +761,41 @@ struct ConvertStablehloGatherOp : public OpRewritePattern<stablehlo::GatherOp> {
   }
 };
 
+struct ConvertStablehloPadOp : public OpRewritePattern<stablehlo::PadOp> {
+  using OpRewritePattern<stablehlo::PadOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(stablehlo::PadOp op,
+                                PatternRewriter& rewriter) const override {
+    auto isZero = [](int64_t value) { return value == 0; };
+    if (!llvm::all_of(op.getInteriorPadding(), isZero)) {
+      return rewriter.notifyMatchFailure(op, "interior padding not supported");
+    }
+
+    auto isNegative = [](int64_t value) { return value < 0; };
+    if (llvm::any_of(op.getEdgePaddingLow(), isNegative) ||
+        llvm::any_of(op.getEdgePaddingHigh(), isNegative)) {
+      return rewriter.notifyMatchFailure(op, "negative padding not supported");
+    }
+
+    // tosa.pad takes the low and high padding of every dimension as a
+    // [rank, 2] tensor.
+    llvm::SmallVector<int64_t, 8> padding;
+    for (auto [low, high] :
+         llvm::zip_equal(op.getEdgePaddingLow(), op.getEdgePaddingHigh())) {
+      padding.push_back(low);
+      padding.push_back(high);
+    }
+    auto paddingType = RankedTensorType::get(
+        {op.getType().getRank(), 2}, rewriter.getI64Type());
+    auto paddingOp = rewriter.create<tosa::ConstOp>(
+        op->getLoc(), paddingType,
+        DenseIntElementsAttr::get(paddingType, padding));
+    rewriter.replaceOpWithNewOp<tosa::PadOp>(op, op.getType(), op.getOperand(),
+                                             paddingOp, op.getPaddingValue());
+    return success();
+  }
+};
+
 struct ConvertStablehloReduceOp : public OpRewritePattern<stablehlo::ReduceOp> {
   using OpRewritePattern<stablehlo::ReduceOp>::OpRewritePattern;
 
@@ -372,6 +857,188 @@ struct ConvertStablehloReduceOp : public OpRewritePattern<stablehlo::ReduceOp> {
   }
 };
 
+// The parameters of a reduce_window which is a 2D pooling of an NHWC tensor,
+// see `matchPool2d`.
+struct Pool2d {
+  // Whether this is a sum pooling, or a max pooling otherwise.
+  bool isSum;
+  llvm::SmallVector<int64_t, 2> kernel;
+  llvm::SmallVector<int64_t, 2> stride;
+  // [top, bottom, left, right], like TOSA.
+  llvm::SmallVector<int64_t, 4> pad;
+};
+
+// Returns the parameters of `op` if it is a float sum or max pooling over the
+// spatial dimensions of an NHWC tensor, i.e. an add or max reduce_window with
+// an initial value of zero or -inf respectively.
+FailureOr<Pool2d> matchPool2d(stablehlo::ReduceWindowOp op,
+                              PatternRewriter& rewriter) {
+  if (op.getInputs().size() != 1) {
+    return rewriter.notifyMatchFailure(op, "only single inputs supported");
+  }
+  auto inputType = cast<RankedTensorType>(op.getInputs().front().getType());
+  if (inputType.getRank() != 4 || !isa<FloatType>(inputType.getElementType())) {
+    return rewriter.notifyMatchFailure(op, "input must be a 4D float tensor");
+  }
+
+  auto isOne = [](int64_t value) { return value == 1; };
+  if ((op.getBaseDilations() && !llvm::all_of(*op.getBaseDilations(), isOne)) ||
+      (op.getWindowDilations() &&
+       !llvm::all_of(*op.getWindowDilations(), isOne))) {
+    return rewriter.notifyMatchFailure(op, "dilations not supported");
+  }
+
+  auto window = op.getWindowDimensions();
+  llvm::SmallVector<int64_t, 4> strides(4, 1);
+  if (auto windowStrides = op.getWindowStrides()) {
+    strides = llvm::to_vector<4>(*windowStrides);
+  }
+  llvm::SmallVector<int64_t, 8> padding(8, 0);
+  if (auto paddingAttr = op.getPadding()) {
+    padding = llvm::to_vector<8>(paddingAttr->getValues<int64_t>());
+  }
+  if (window[0] != 1 || window[3] != 1 || strides[0] != 1 || strides[3] != 1 ||
+      padding[0] != 0 || padding[1] != 0 || padding[6] != 0 ||
+      padding[7] != 0) {
+    return rewriter.notifyMatchFailure(
+        op, "only windows over the spatial dimensions of NHWC supported");
+  }
+  if (llvm::any_of(padding, [](int64_t value) { return value < 0; })) {
+    return rewriter.notifyMatchFailure(op, "negative padding not supported");
+  }
+
+  // The body should contain the reducer and a return op. Its ops may have
+  // been lowered already.
+  Block& bodyBlock = op.getBody().front();
+  if (bodyBlock.getOperations().size() != 2) {
+    return rewriter.notifyMatchFailure(op, "body required to contain 2 ops");
+  }
+  Operation& innerOp = bodyBlock.front();
+  bool isSum = isa<stablehlo::AddOp, tosa::AddOp>(innerOp);
+  if (!isSum && !isa<stablehlo::MaxOp, tosa::MaximumOp>(innerOp)) {
+    return rewriter.notifyMatchFailure(
+        op, "reducing along a " + innerOp.getName().getStringRef().str() +
+                " op not supported");
+  }
+
+  DenseFPElementsAttr initAttr;
+  if (!matchPattern(op.getInitValues().front(), m_Constant(&initAttr))) {
+    return rewriter.notifyMatchFailure(op, "init value must be a constant");
+  }
+  auto init = initAttr.getSplatValue<APFloat>();
+  if (isSum ? !init.isZero() : !(init.isInfinity() && init.isNegative())) {
+    return rewriter.notifyMatchFailure(
+        op, "init value must be the identity of the reducer");
+  }
+  // tosa.avg_pool2d doesn't count padding, so only sum poolings without
+  // padding can be computed from it.
+  bool isPadded =
+      llvm::any_of(padding, [](int64_t value) { return value != 0; });
+  if (isSum && isPadded) {
+    return rewriter.notifyMatchFailure(op, "padded sum pooling not supported");
+  }
+
+  return Pool2d{isSum,
+                {window[1], window[2]},
+                {strides[1], strides[2]},
+                {padding[2], padding[3], padding[4], padding[5]}};
+}
+
+// Returns a tosa.avg_pool2d of `input` with the parameters of `pool`.
+Value createAvgPool2d(PatternRewriter& rewriter, Location loc, Type type,
+                      Value input, const Pool2d& pool) {
+  return rewriter.create<tosa::AvgPool2dOp>(
+      loc, type, input, rewriter.getDenseI64ArrayAttr(pool.kernel),
+      rewriter.getDenseI64ArrayAttr(pool.stride),
+      rewriter.getDenseI64ArrayAttr(pool.pad),
+      TypeAttr::get(rewriter.getF32Type()));
+}
+
+// Returns whether `value` is a constant whose elements are the size of the
+// window of `pool`, which sum poolings are divided by to average them.
+bool isWindowSize(Value value, const Pool2d& pool) {
+  DenseFPElementsAttr attr;
+  return matchPattern(value, m_Constant(&attr)) && attr.isSplat() &&
+         attr.getSplatValue<APFloat>().convertToDouble() ==
+             pool.kernel[0] * pool.kernel[1];
+}
+
+// Lowers max poolings to tosa.max_pool2d and sum poolings to a
+// tosa.avg_pool2d scaled by the size of the window.
+struct ConvertStablehloReduceWindowOp
+    : public OpRewritePattern<stablehlo::ReduceWindowOp> {
+  using OpRewritePattern<stablehlo::ReduceWindowOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(stablehlo::ReduceWindowOp op,
+                                PatternRewriter& rewriter) const override {
+    auto pool = matchPool2d(op, rewriter);
+    if (failed(pool)) return failure();
+
+    auto loc = op->getLoc();
+    auto input = op.getInputs().front();
+    auto resultType = cast<RankedTensorType>(op.getResultTypes().front());
+    if (!pool->isSum) {
+      rewriter.replaceOpWithNewOp<tosa::MaxPool2dOp>(
+          op, resultType, input, rewriter.getDenseI64ArrayAttr(pool->kernel),
+          rewriter.getDenseI64ArrayAttr(pool->stride),
+          rewriter.getDenseI64ArrayAttr(pool->pad));
+      return success();
+    }
+
+    if (op->hasOneUse()) {
+      auto divOp = dyn_cast<stablehlo::DivOp>(*op->user_begin());
+      if (divOp && divOp.getLhs() == op.getResult(0) &&
+          isWindowSize(divOp.getRhs(), *pool)) {
+        return rewriter.notifyMatchFailure(
+            op, "folded into its user, see ConvertStablehloAvgPoolOp");
+      }
+    }
+
+    auto avgPool = createAvgPool2d(rewriter, loc, resultType, input, *pool);
+    auto scaleType = RankedTensorType::get({1, 1, 1, 1},
+                                           resultType.getElementType());
+    auto scaleOp = rewriter.create<tosa::ConstOp>(
+        loc, scaleType,
+        DenseElementsAttr::get(
+            scaleType,
+            rewriter.getFloatAttr(resultType.getElementType(),
+                                  pool->kernel[0] * pool->kernel[1])));
+    rewriter.replaceOpWithNewOp<tosa::MulOp>(op, resultType, avgPool, scaleOp,
+                                             rewriter.getI8IntegerAttr(0));
+    return success();
+  }
+};
+
+// Lowers average poolings, i.e. sum poolings divided by the size of the
+// window, to a single tosa.avg_pool2d.
+struct ConvertStablehloAvgPoolOp : public OpRewritePattern<stablehlo::DivOp> {
+  explicit ConvertStablehloAvgPoolOp(MLIRContext* context)
+      : OpRewritePattern<stablehlo::DivOp>(context, /*benefit=*/2) {}
+
+  LogicalResult matchAndRewrite(stablehlo::DivOp op,
+                                PatternRewriter& rewriter) const override {
+    auto reduceWindowOp =
+        op.getLhs().getDefiningOp<stablehlo::ReduceWindowOp>();
+    if (!reduceWindowOp || !reduceWindowOp->hasOneUse()) {
+      return rewriter.notifyMatchFailure(op, "lhs must be a reduce_window");
+    }
+    auto pool = matchPool2d(reduceWindowOp, rewriter);
+    if (failed(pool) || !pool->isSum) {
+      return rewriter.notifyMatchFailure(op, "lhs must be a sum pooling");
+    }
+
+    if (!isWindowSize(op.getRhs(), *pool)) {
+      return rewriter.notifyMatchFailure(
+          op, "rhs must be the size of the window");
+    }
+
+    rewriter.replaceOp(
+        op, createAvgPool2d(rewriter, op->getLoc(), op.getType(),
+                            reduceWindowOp.getInputs().front(), *pool));
+    return success();
+  }
+};
+
 struct ConvertStablehloReturnOp : public OpRewritePattern<stablehlo::ReturnOp> {
   using OpRewritePattern<stablehlo::ReturnOp>::OpRewritePattern;
 
@@ -446,6 +1113,93 @@ struct ConvertStablehloTransposeOp
   }
 };
 
+// Lowers a uniform_quantize of a quantized value to a tosa.rescale, and of a
+// float value to a scale and shift by the zero point, which are clamped to the
+// storage range and cast to the result type.
+struct ConvertStablehloUniformQuantizeOp
+    : public OpRewritePattern<stablehlo::UniformQuantizeOp> {
+  using OpRewritePattern<stablehlo::UniformQuantizeOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(stablehlo::UniformQuantizeOp op,
+                                PatternRewriter& rewriter) const override {
+    auto operandType = cast<ShapedType>(op.getOperand().getType());
+    auto resultType = cast<ShapedType>(op.getType());
+    auto resultQType =
+        dyn_cast<quant::UniformQuantizedType>(resultType.getElementType());
+    if (!resultQType)
+      return rewriter.notifyMatchFailure(
+          op, "only per-tensor quantized results supported");
+
+    auto loc = op->getLoc();
+    if (auto operandQType = dyn_cast<quant::UniformQuantizedType>(
+            operandType.getElementType())) {
+      rewriter.replaceOp(
+          op, createRescale(rewriter, loc, resultType, op.getOperand(),
+                            {operandQType.getScale() / resultQType.getScale()},
+                            operandQType.getZeroPoint(),
+                            resultQType.getZeroPoint()));
+      return success();
+    }
+
+    auto floatType = dyn_cast<FloatType>(operandType.getElementType());
+    if (!floatType)
+      return rewriter.notifyMatchFailure(op, "operand must be quantized or "
+                                             "float");
+    int64_t rank = operandType.getRank();
+    Value scaled = rewriter.create<tosa::MulOp>(
+        loc, operandType, op.getOperand(),
+        createSplatConst(rewriter, loc, floatType, rank,
+                         1.0 / resultQType.getScale()),
+        rewriter.getI8IntegerAttr(0));
+    Value shifted = rewriter.create<tosa::AddOp>(
+        loc, operandType, scaled,
+        createSplatConst(rewriter, loc, floatType, rank,
+                         resultQType.getZeroPoint()));
+    Value clamped = rewriter.create<tosa::ClampOp>(
+        loc, operandType, shifted,
+        rewriter.getI64IntegerAttr(resultQType.getStorageTypeMin()),
+        rewriter.getI64IntegerAttr(resultQType.getStorageTypeMax()),
+        rewriter.getF32FloatAttr(resultQType.getStorageTypeMin()),
+        rewriter.getF32FloatAttr(resultQType.getStorageTypeMax()));
+    rewriter.replaceOpWithNewOp<tosa::CastOp>(op, resultType, clamped);
+    return success();
+  }
+};
+
+// Lowers a uniform_dequantize of a per-tensor quantized value to a cast to
+// float, which is shifted by the zero point and scaled.
+struct ConvertStablehloUniformDequantizeOp
+    : public OpRewritePattern<stablehlo::UniformDequantizeOp> {
+  using OpRewritePattern<stablehlo::UniformDequantizeOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(stablehlo::UniformDequantizeOp op,
+                                PatternRewriter& rewriter) const override {
+    auto operandType = cast<ShapedType>(op.getOperand().getType());
+    auto operandQType =
+        dyn_cast<quant::UniformQuantizedType>(operandType.getElementType());
+    if (!operandQType)
+      return rewriter.notifyMatchFailure(
+          op, "only per-tensor quantized operands supported");
+
+    auto loc = op->getLoc();
+    auto resultType = cast<ShapedType>(op.getType());
+    Type floatType = resultType.getElementType();
+    int64_t rank = resultType.getRank();
+    Value cast =
+        rewriter.create<tosa::CastOp>(loc, resultType, op.getOperand());
+    Value shifted = rewriter.create<tosa::SubOp>(
+        loc, resultType, cast,
+        createSplatConst(rewriter, loc, floatType, rank,
+                         operandQType.getZeroPoint()));
+    rewriter.replaceOpWithNewOp<tosa::MulOp>(
+        op, resultType, shifted,
+        createSplatConst(rewriter, loc, floatType, rank,
+                         operandQType.getScale()),
+        rewriter.getI8IntegerAttr(0));
+    return success();
+  }
+};
+
 struct ConvertStablehloWhileOp : public OpRewritePattern<stablehlo::WhileOp> {
   using OpRewritePattern<stablehlo::WhileOp>::OpRewritePattern;
 
@@ -471,24 +1225,149 @@ struct ConvertStablehloWhileOp : public OpRewritePattern<stablehlo::WhileOp> {
   }
 };
 
+// Fuses a tosa.rescale of the result of another tosa.rescale, such as the
+// rescale of an i32 quantized dot or convolution followed by a
+// uniform_quantize to 8 bits. The intermediate values must be at least 32 bits
+// wide, so that the first rescale does not saturate. A per-tensor producer may
+// be separated from the rescale by a reshape, like the one which expands the
+// result of a tosa.matmul, which is then applied to the fused rescale.
+struct FuseTosaRescaleOps : public OpRewritePattern<tosa::RescaleOp> {
+  using OpRewritePattern<tosa::RescaleOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(tosa::RescaleOp op,
+                                PatternRewriter& rewriter) const override {
+    Value input = op.getInput();
+    auto reshapeOp = input.getDefiningOp<tosa::ReshapeOp>();
+    if (reshapeOp && reshapeOp->hasOneUse()) input = reshapeOp.getInput1();
+    auto producer = input.getDefiningOp<tosa::RescaleOp>();
+    if (!producer || !producer->hasOneUse())
+      return rewriter.notifyMatchFailure(op, "input is not a rescale");
+    if (reshapeOp && producer.getPerChannel())
+      return rewriter.notifyMatchFailure(op, "reshape of per-channel rescale");
+
+    Type intermediateType = getElementTypeOrSelf(producer.getType());
+    unsigned intermediateWidth = 0;
+    if (auto quantizedType = dyn_cast<quant::QuantizedType>(intermediateType))
+      intermediateWidth = quantizedType.getStorageTypeIntegralWidth();
+    else if (auto integerType = dyn_cast<IntegerType>(intermediateType))
+      intermediateWidth = integerType.getWidth();
+    if (intermediateWidth < 32)
+      return rewriter.notifyMatchFailure(op,
+                                         "intermediate values may saturate");
+    if (producer.getOutputZp() != op.getInputZp() || op.getPerChannel() ||
+        producer.getScale32() != op.getScale32() ||
+        producer.getDoubleRound() != op.getDoubleRound()) {
+      return rewriter.notifyMatchFailure(op, "incompatible rescales");
+    }
+
+    double scale = op.getMultiplier().front() *
+                   std::ldexp(1.0, -op.getShift().front());
+    llvm::SmallVector<int32_t, 1> multipliers;
+    llvm::SmallVector<int8_t, 1> shifts;
+    for (auto [producerMultiplier, producerShift] :
+         llvm::zip_equal(producer.getMultiplier(), producer.getShift())) {
+      double combined =
+          producerMultiplier * std::ldexp(1.0, -producerShift) * scale;
+      // Scales of 2^30 and above can't be represented with a shift of at least
+      // 2, and don't occur in practice.
+      if (combined <= 0 || combined >= std::ldexp(1.0, 30))
+        return rewriter.notifyMatchFailure(op, "unrepresentable scale");
+      int32_t multiplier, shift;
+      computeMultiplierAndShift(combined, multiplier, shift,
+                                op.getScale32() ? 32 : 16);
+      multipliers.push_back(multiplier);
+      shifts.push_back(shift);
+    }
+    auto fusedType = cast<ShapedType>(producer.getType())
+                         .clone(getElementTypeOrSelf(op.getType()));
+    Value fused = rewriter.create<tosa::RescaleOp>(
+        op->getLoc(), fusedType, producer.getInput(),
+        producer.getInputZpAttr(), op.getOutputZpAttr(),
+        rewriter.getDenseI32ArrayAttr(multipliers),
+        rewriter.getDenseI8ArrayAttr(shifts), op.getScale32Attr(),
+        op.getDoubleRoundAttr(), producer.getPerChannelAttr());
+    if (reshapeOp) {
+      fused = rewriter.create<tosa::ReshapeOp>(
+          op->getLoc(), op.getType(), fused, reshapeOp.getNewShapeAttr());
+    }
+    rewriter.replaceOp(op, fused);
+    return success();
+  }
+};
+
+// Fuses a tosa.transpose of the result of another tosa.transpose, such as the
+// transposes back and forth between the layouts of chained dots and
+// convolutions. Consecutive reshapes are folded by tosa.reshape itself.
+struct FuseTosaTransposeOps : public OpRewritePattern<tosa::TransposeOp> {
+  using OpRewritePattern<tosa::TransposeOp>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(tosa::TransposeOp op,
+                                PatternRewriter& rewriter) const override {
+    auto producer = op.getInput1().getDefiningOp<tosa::TransposeOp>();
+    if (!producer)
+      return rewriter.notifyMatchFailure(op, "input is not a transpose");
+    DenseIntElementsAttr perms, producerPerms;
+    if (!matchPattern(op.getPerms(), m_Constant(&perms)) ||
+        !matchPattern(producer.getPerms(), m_Constant(&producerPerms)))
+      return rewriter.notifyMatchFailure(op, "permutations must be constant");
+
+    auto producerPermutation =
+        llvm::to_vector<4>(producerPerms.getValues<int64_t>());
+    llvm::SmallVector<int64_t, 4> permutation;
+    for (int64_t dim : perms.getValues<int64_t>())
+      permutation.push_back(producerPermutation[dim]);
+    rewriter.replaceOp(
+        op, transposeIfNeeded(rewriter, op->getLoc(), producer.getInput1(),
+                              permutation));
+    return success();
+  }
+};
+
 LogicalResult StablehloLegalizeToTosaPass::initialize(MLIRContext* ctx) {
   RewritePatternSet patternList(ctx);
   populateGeneratedPDLLPatterns(patternList);
+  patternList.addWithLabel<ConvertStablehloAvgPoolOp>({"StablehloAvgPool"},
+                                                      ctx);
+  patternList.addWithLabel<ConvertStablehloBroadcastInDimOp>(
+      {"StablehloBroadcastInDim"}, ctx);
+  patternList.addWithLabel<
+      ConvertStablehloBroadcastingBinaryOp<stablehlo::AddOp, tosa::AddOp>,
+      ConvertStablehloBroadcastingBinaryOp<stablehlo::MaxOp, tosa::MaximumOp>,
+      ConvertStablehloBroadcastingBinaryOp<stablehlo::MinOp, tosa::MinimumOp>,
+      ConvertStablehloBroadcastingBinaryOp<stablehlo::MulOp, tosa::MulOp>,
+      ConvertStablehloBroadcastingBinaryOp<stablehlo::SubtractOp,
+                                           tosa::SubOp>>(
+      {"StablehloBroadcastingBinary"}, ctx);
   patternList.addWithLabel<ConvertStablehloCompareOp>({"StablehloCompare"},
                                                       ctx);
   patternList.addWithLabel<ConvertStablehloConcatenateOp>(
       {"StablehloConcatenate"}, ctx);
+  patternList.addWithLabel<ConvertStablehloConvolutionOp>(
+      {"StablehloConvolution"}, ctx);
   patternList.addWithLabel<ConvertStablehloDotOp>({"StablehloDot"}, ctx);
   patternList.addWithLabel<ConvertStablehloDotGeneralOp>(
       {"StablehloDotGeneral"}, ctx);
   patternList.addWithLabel<ConvertStablehloGatherOp>({"StablehloGather"}, ctx);
   patternList.addWithLabel<ConvertStablehloIotaOp>({"StablehloIota"}, ctx);
+  patternList.addWithLabel<ConvertStablehloPadOp>({"StablehloPad"}, ctx);
+  patternList.addWithLabel<
+      ConvertStablehloQuantizedBinaryOp<stablehlo::AddOp, tosa::AddOp>,
+      ConvertStablehloQuantizedBinaryOp<stablehlo::SubtractOp, tosa::SubOp>>(
+      {"StablehloQuantizedBinary"}, ctx);
   patternList.addWithLabel<ConvertStablehloReduceOp>({"StablehloReduce"}, ctx);
+  patternList.addWithLabel<ConvertStablehloReduceWindowOp>(
+      {"StablehloReduceWindow"}, ctx);
   patternList.addWithLabel<ConvertStablehloReturnOp>({"StablehloReturn"}, ctx);
   patternList.addWithLabel<ConvertStablehloSliceOp>({"StablehloSlice"}, ctx);
   patternList.addWithLabel<ConvertStablehloTransposeOp>({"StablehloTranspose"},
                                                         ctx);
+  patternList.addWithLabel<ConvertStablehloUniformDequantizeOp>(
+      {"StablehloUniformDequantize"}, ctx);
+  patternList.addWithLabel<ConvertStablehloUniformQuantizeOp>(
+      {"StablehloUniformQuantize"}, ctx);
   patternList.addWithLabel<ConvertStablehloWhileOp>({"StablehloWhile"}, ctx);
+  patternList.addWithLabel<FuseTosaRescaleOps>({"FuseTosaRescales"}, ctx);
+  patternList.addWithLabel<FuseTosaTransposeOps>({"FuseTosaTransposes"}, ctx);
   patterns = std::move(patternList);
   return success();
 }
@@ -16,20 +16,39 @@ limitations under the License.
 #include "stablehlo/dialect/AssemblyFormat.h"
 
 #include <cassert>
+#include <complex>
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <vector>
 
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/APInt.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/bit.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/SMLoc.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include "mlir/IR/AsmState.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinDialect.h"
 #include "mlir/IR/BuiltinTypeInterfaces.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/DialectResourceBlobManager.h"
 #include "mlir/IR/OpImplementation.h"
 #include "mlir/IR/OperationSupport.h"
 #include "mlir/IR/Region.h"
@@ -133,6 +152,481 @@ ParseResult parseVariadicSameOperandsAndResultType(
   return detail::parseSameOperandsAndResultTypeImpl(parser, typePtrs, result);
 }
 
+namespace {
+// Constants of at least this many bytes are parsed into
+// DenseResourceElementsAttr blobs, which aren't hashed and uniqued in the
+// context like DenseElementsAttr. Folding patterns use the same threshold.
+constexpr int64_t kConstantResourceByteThreshold = 64 * 1024;
+
+// A number in a dense literal, which is converted to an element once the type
+// that follows the literal is known.
+struct DenseLiteralNumber {
+  // Integers, booleans, and hexadecimal bit patterns of floats.
+  APInt intValue;
+  // Floating-point literals, parsed as doubles like the builtin parser does.
+  double floatValue = 0.0;
+  bool isFloat = false;
+  bool isHex = false;
+  bool isBool = false;
+  bool isNegative = false;
+};
+
+// The contents of `dense<...>` other than hexadecimal strings.
+struct DenseLiteral {
+  // The numbers of all elements in order, two per element for complex ones.
+  std::vector<DenseLiteralNumber> numbers;
+  int64_t numElements = 0;
+  bool isComplex = false;
+  // The sizes of nested lists, which is empty for splats.
+  SmallVector<int64_t> shape;
+  // The nesting depth of elements, which is the same for all of them.
+  std::optional<size_t> elementDepth;
+};
+
+ParseResult parseDenseLiteralNumber(OpAsmParser& parser,
+                                    DenseLiteral& literal) {
+  // The current token is a literal followed by a delimiter, so it can be
+  // classified by its spelling without running off the end of the buffer.
+  DenseLiteralNumber number;
+  const char* spelling = parser.getCurrentLocation().getPointer();
+  number.isNegative = *spelling == '-';
+  if (number.isNegative) ++spelling;
+  number.isHex = spelling[0] == '0' && spelling[1] == 'x';
+  number.isBool = *spelling == 't' || *spelling == 'f';
+  if (!number.isHex) {
+    while (llvm::isDigit(*spelling)) ++spelling;
+    number.isFloat = *spelling == '.';
+  }
+
+  if (number.isBool) {
+    bool value = succeeded(parser.parseOptionalKeyword("true"));
+    if (!value && parser.parseKeyword("false")) return failure();
+    number.intValue = APInt(/*numBits=*/1, value);
+  } else if (number.isFloat) {
+    if (parser.parseFloat(number.floatValue)) return failure();
+  } else {
+    auto parseResult = parser.parseOptionalInteger(number.intValue);
+    if (!parseResult.has_value())
+      return parser.emitError(parser.getCurrentLocation(),
+                              "expected element literal of primitive type");
+    if (failed(*parseResult)) return failure();
+  }
+  literal.numbers.push_back(std::move(number));
+  return success();
+}
+
+// Parses a nested list of elements, or a single element for splats.
+ParseResult parseDenseLiteralElements(OpAsmParser& parser,
+                                      DenseLiteral& literal, size_t depth) {
+  llvm::SMLoc loc = parser.getCurrentLocation();
+  if (succeeded(parser.parseOptionalLSquare())) {
+    int64_t size = 0;
+    if (failed(parser.parseOptionalRSquare())) {
+      do {
+        ++size;
+        if (failed(parseDenseLiteralElements(parser, literal, depth + 1)))
+          return failure();
+      } while (succeeded(parser.parseOptionalComma()));
+      if (parser.parseRSquare()) return failure();
+    }
+
+    if (literal.shape.size() <= depth) literal.shape.resize(depth + 1, -1);
+    if (literal.shape[depth] == -1) literal.shape[depth] = size;
+    if (literal.shape[depth] != size ||
+        (size == 0 && literal.elementDepth))
+      return parser.emitError(loc, "tensor literal is invalid; ranks are not "
+                                   "consistent between elements");
+    return success();
+  }
+
+  if (!literal.elementDepth) literal.elementDepth = depth;
+  if (*literal.elementDepth != depth)
+    return parser.emitError(
+        loc, "tensor literal is invalid; ranks are not consistent between "
+             "elements");
+  bool isComplex = succeeded(parser.parseOptionalLParen());
+  if (literal.numElements++ == 0) literal.isComplex = isComplex;
+  if (isComplex != literal.isComplex)
+    return parser.emitError(loc, "complex and non-complex elements are mixed");
+  if (!isComplex) return parseDenseLiteralNumber(parser, literal);
+  if (parseDenseLiteralNumber(parser, literal) || parser.parseComma() ||
+      parseDenseLiteralNumber(parser, literal) || parser.parseRParen())
+    return failure();
+  return success();
+}
+
+// Returns the size in bytes of elements of `type` in DenseElementsAttr raw
+// data, or std::nullopt if they're bit-packed, e.g. i1 and i4.
+std::optional<int64_t> getByteSizedElementSize(Type type) {
+  if (auto complexType = dyn_cast<ComplexType>(type)) {
+    auto componentSize = getByteSizedElementSize(complexType.getElementType());
+    if (!componentSize) return std::nullopt;
+    return 2 * *componentSize;
+  }
+  if (type.isIndex()) return IndexType::kInternalStorageBitWidth / 8;
+  if (!type.isIntOrFloat() || type.getIntOrFloatBitWidth() % 8 != 0)
+    return std::nullopt;
+  return type.getIntOrFloatBitWidth() / 8;
+}
+
+// Converts `number` to the bits of an element of type `type`, which is an
+// integer, index or float type, with the same rules as the builtin parser.
+ParseResult convertDenseLiteralNumber(OpAsmParser& parser, llvm::SMLoc loc,
+                                      const DenseLiteralNumber& number,
+                                      Type type, APInt& bits) {
+  if (auto floatType = dyn_cast<FloatType>(type)) {
+    if (number.isFloat) {
+      APFloat value(number.floatValue);
+      bool losesInfo;
+      value.convert(floatType.getFloatSemantics(),
+                    APFloat::rmNearestTiesToEven, &losesInfo);
+      bits = value.bitcastToAPInt();
+      return success();
+    }
+    if (!number.isHex)
+      return parser.emitError(
+          loc, "expected floating-point elements, but parsed integer");
+    if (number.isNegative)
+      return parser.emitError(
+          loc, "hexadecimal float literal should not have a leading minus");
+    if (number.intValue.getActiveBits() > floatType.getWidth())
+      return parser.emitError(
+          loc, "hexadecimal float constant out of range for type");
+    bits = number.intValue.zextOrTrunc(floatType.getWidth());
+    return success();
+  }
+
+  if (number.isFloat)
+    return parser.emitError(
+        loc, "expected integer elements, but parsed floating-point");
+  if (number.isBool && !type.isInteger(1))
+    return parser.emitError(loc,
+                            "expected i1 type for 'true' or 'false' values");
+  if (number.isNegative && type.isUnsignedInteger())
+    return parser.emitError(
+        loc, "expected unsigned integer elements, but parsed negative value");
+  unsigned width = type.isIndex() ? IndexType::kInternalStorageBitWidth
+                                  : type.getIntOrFloatBitWidth();
+  const APInt& value = number.intValue;
+  bool isSigned = type.isSignedInteger() || type.isIndex();
+  if (number.isNegative ? value.getSignificantBits() > width
+                        : value.getActiveBits() > width - isSigned)
+    return parser.emitError(loc, "integer constant out of range for type");
+  bits = value.sextOrTrunc(width);
+  return success();
+}
+
+// Builds the elements of `literal` of type `type`. Large constants whose
+// elements are byte-sized are written straight into blobs.
+ParseResult buildDenseLiteralElements(OpAsmParser& parser, llvm::SMLoc loc,
+                                      const DenseLiteral& literal,
+                                      ShapedType type, ElementsAttr& value) {
+  if (literal.numElements == 0) {
+    if (type.getNumElements() != 0)
+      return parser.emitError(loc)
+             << "parsed zero elements, but type (" << type
+             << ") expected at least 1";
+    value = DenseElementsAttr::get(type, ArrayRef<Attribute>());
+    return success();
+  }
+
+  bool isSplat = literal.numElements == 1 && literal.shape.empty();
+  if (!isSplat && ArrayRef(literal.shape) != type.getShape()) {
+    auto diag = parser.emitError(loc)
+                << "inferred shape of elements literal ([";
+    llvm::interleaveComma(literal.shape, diag);
+    diag << "]) does not match type ([";
+    llvm::interleaveComma(type.getShape(), diag);
+    return diag << "])";
+  }
+
+  Type elementType = type.getElementType();
+  auto complexType = dyn_cast<ComplexType>(elementType);
+  Type componentType = complexType ? complexType.getElementType() : elementType;
+  if (!componentType.isIntOrIndexOrFloat())
+    return parser.emitError(loc)
+           << "expected integer, index or floating-point elements, but got "
+           << elementType;
+  if (literal.isComplex != static_cast<bool>(complexType))
+    return parser.emitError(loc) << "expected "
+                                 << (complexType ? "complex" : "non-complex")
+                                 << " elements for " << elementType;
+
+  SmallVector<APInt> components;
+  auto convertComponents = [&](auto callback) -> LogicalResult {
+    for (auto [i, number] : llvm::enumerate(literal.numbers)) {
+      APInt bits;
+      if (convertDenseLiteralNumber(parser, loc, number, componentType, bits))
+        return failure();
+      callback(i, bits);
+    }
+    return success();
+  };
+
+  // Bit-packed elements go through APInt.
+  auto elementSize = getByteSizedElementSize(elementType);
+  if (!elementSize) {
+    if (failed(convertComponents(
+            [&](size_t, const APInt& bits) { components.push_back(bits); })))
+      return failure();
+    if (!complexType) {
+      value = DenseElementsAttr::get(type, components);
+      return success();
+    }
+    SmallVector<std::complex<APInt>> values;
+    for (size_t i = 0; i < components.size(); i += 2)
+      values.emplace_back(components[i], components[i + 1]);
+    value = DenseElementsAttr::get(type, values);
+    return success();
+  }
+
+  int64_t byteSize = static_cast<int64_t>(literal.numElements) * *elementSize;
+  int64_t componentSize = complexType ? *elementSize / 2 : *elementSize;
+  bool useResource = !isSplat && byteSize >= kConstantResourceByteThreshold;
+  AsmResourceBlob blob;
+  SmallVector<char> buffer;
+  MutableArrayRef<char> data;
+  if (useResource) {
+    blob = HeapAsmResourceBlob::allocate(byteSize, alignof(uint64_t));
+    data = blob.getMutableData();
+  } else {
+    buffer.resize(byteSize);
+    data = buffer;
+  }
+  if (failed(convertComponents([&](size_t i, const APInt& bits) {
+        llvm::StoreIntToMemory(
+            bits, reinterpret_cast<uint8_t*>(&data[i * componentSize]),
+            componentSize);
+      })))
+    return failure();
+
+  if (useResource)
+    value = DenseResourceElementsAttr::get(type, "constant", std::move(blob));
+  else
+    value = DenseElementsAttr::getFromRawBuffer(type, data);
+  return success();
+}
+
+// Builds the elements of type `type` encoded by the hexadecimal string `hex`.
+ParseResult buildDenseHexElements(OpAsmParser& parser, llvm::SMLoc loc,
+                                  StringRef hex, ShapedType type,
+                                  ElementsAttr& value) {
+  if (!hex.consume_front("0x") || !llvm::all_of(hex, llvm::isHexDigit))
+    return parser.emitError(
+        loc, "expected string containing hex digits starting with `0x`");
+
+  // An odd number of digits has an implicit leading zero, like in fromHex.
+  int64_t byteSize = (hex.size() + 1) / 2;
+  auto decode = [&](MutableArrayRef<char> data) {
+    size_t digit = 0;
+    if (hex.size() % 2) data[0] = llvm::hexDigitValue(hex[digit++]);
+    for (size_t i = hex.size() % 2; i < data.size(); ++i, digit += 2)
+      data[i] = llvm::hexDigitValue(hex[digit]) << 4 |
+                llvm::hexDigitValue(hex[digit + 1]);
+  };
+
+  // Hexadecimal strings are little-endian like blobs on little-endian hosts.
+  auto elementSize = getByteSizedElementSize(type.getElementType());
+  if (llvm::endianness::native == llvm::endianness::little && elementSize &&
+      type.getNumElements() > 1 &&
+      byteSize == type.getNumElements() * *elementSize &&
+      byteSize >= kConstantResourceByteThreshold) {
+    auto blob = HeapAsmResourceBlob::allocate(byteSize, alignof(uint64_t));
+    decode(blob.getMutableData());
+    value = DenseResourceElementsAttr::get(type, "constant", std::move(blob));
+    return success();
+  }
+
+  SmallVector<char> data(byteSize);
+  decode(data);
+  bool detectedSplat = false;
+  if (!DenseElementsAttr::isValidRawBuffer(type, data, detectedSplat))
+    return parser.emitError(
+        loc, "elements hex data size is invalid for provided type");
+  if (llvm::endianness::native == llvm::endianness::big) {
+    SmallVector<char> converted(byteSize);
+    DenseIntOrFPElementsAttr::convertEndianOfArrayRefForBEmachine(
+        data, converted, type);
+    data = std::move(converted);
+  }
+  value = DenseElementsAttr::getFromRawBuffer(type, data);
+  return success();
+}
+
+// Parses the `<...> : type` of a `dense` elements attribute. Large literals
+// take minutes to go through the builtin parser, which keeps every element as
+// a token and hashes the data to unique it in the context, so this parses
+// them into blobs directly instead.
+ParseResult parseDenseElements(OpAsmParser& parser, llvm::SMLoc loc,
+                               ElementsAttr& value) {
+  std::string hex;
+  DenseLiteral literal;
+  if (parser.parseLess()) return failure();
+  bool isHex = succeeded(parser.parseOptionalString(&hex));
+  if (!isHex && failed(parser.parseOptionalGreater())) {
+    if (parseDenseLiteralElements(parser, literal, /*depth=*/0) ||
+        parser.parseGreater())
+      return failure();
+  }
+
+  Type type;
+  llvm::SMLoc typeLoc;
+  if (isHex && parser.parseGreater()) return failure();
+  if (parser.parseColon()) return failure();
+  typeLoc = parser.getCurrentLocation();
+  if (parser.parseType(type)) return failure();
+  auto shapedType = dyn_cast<ShapedType>(type);
+  if (!shapedType)
+    return parser.emitError(typeLoc, "elements literal must be a shaped type");
+  if (!shapedType.hasStaticShape())
+    return parser.emitError(typeLoc,
+                            "elements literal type must have static shape");
+
+  if (isHex) return buildDenseHexElements(parser, loc, hex, shapedType, value);
+  return buildDenseLiteralElements(parser, loc, literal, shapedType, value);
+}
+
+struct ConstantPrintingCLOptions {
+  llvm::cl::opt<uint64_t> resourceByteThreshold{
+      "stablehlo-print-constants-as-resources-larger-than",
+      llvm::cl::desc("Print stablehlo.constant ops whose data takes at least "
+                     "this many bytes as dense_resource blobs (0 disables)"),
+      llvm::cl::init(0)};
+  llvm::cl::opt<std::string> resourceDir{
+      "stablehlo-constant-resource-dir",
+      llvm::cl::desc("Write the blobs of large constants to files in this "
+                     "directory when printing, and read undefined blobs "
+                     "from there when parsing")};
+};
+
+llvm::ManagedStatic<ConstantPrintingCLOptions> clConstantPrintingOptions;
+
+uint64_t getConstantResourceByteThreshold() {
+  if (!clConstantPrintingOptions.isConstructed()) return 0;
+  return clConstantPrintingOptions->resourceByteThreshold;
+}
+
+StringRef getConstantResourceDir() {
+  if (!clConstantPrintingOptions.isConstructed()) return {};
+  return clConstantPrintingOptions->resourceDir;
+}
+
+std::string getConstantResourcePath(StringRef dir, StringRef name) {
+  SmallString<128> path(dir);
+  llvm::sys::path::append(path, name + ".bin");
+  return std::string(path);
+}
+
+// Returns the resource of the builtin dialect named `name`, which is created
+// with `blob` if it doesn't exist. Names are hashes of the data of constants,
+// so that printing a program twice, or equal constants, reuse resources.
+DenseResourceElementsHandle getOrInsertConstantResource(
+    MLIRContext* context, StringRef name,
+    std::optional<AsmResourceBlob> blob) {
+  auto& interface = DenseResourceElementsHandle::getManagerInterface(context);
+  if (auto* entry = interface.getBlobManager().lookup(name)) {
+    if (blob && !entry->getBlob()) entry->setBlob(std::move(*blob));
+    return DenseResourceElementsHandle(
+        entry, context->getLoadedDialect<BuiltinDialect>());
+  }
+  return interface.insert(name, std::move(blob));
+}
+
+// Returns the attribute to print for the value of a constant, which is a
+// resource blob for large constants when they're printed as resources.
+//
+// In memory, blobs alias the data of the constant, which lives as long as the
+// context. With a sidecar directory, blobs are written there instead and the
+// resources are left empty, so that the printer doesn't write their data.
+ElementsAttr getPrintedConstantValue(ElementsAttr value) {
+  uint64_t threshold = getConstantResourceByteThreshold();
+  StringRef dir = getConstantResourceDir();
+  if (!threshold || llvm::endianness::native != llvm::endianness::little)
+    return value;
+
+  // Constants that are already resources are only rewritten to be written to
+  // sidecar files.
+  ArrayRef<char> data;
+  if (auto denseAttr = dyn_cast<DenseIntOrFPElementsAttr>(value)) {
+    if (denseAttr.isSplat()) return value;
+    data = denseAttr.getRawData();
+  } else if (auto resourceAttr = dyn_cast<DenseResourceElementsAttr>(value)) {
+    auto* blob = resourceAttr.getRawHandle().getBlob();
+    if (dir.empty() || !blob) return value;
+    data = blob->getData();
+  } else {
+    return value;
+  }
+  auto type = cast<ShapedType>(value.getType());
+  auto elementSize = getByteSizedElementSize(type.getElementType());
+  if (!elementSize || data.size() < threshold ||
+      static_cast<int64_t>(data.size()) != type.getNumElements() * *elementSize)
+    return value;
+
+  uint64_t hash = llvm::xxh3_64bits(
+      ArrayRef(reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+  std::string name = (dir.empty() ? "stablehlo_constant_"
+                                  : "stablehlo_external_") +
+                     llvm::utohexstr(hash, /*LowerCase=*/true, /*Width=*/16);
+  std::optional<AsmResourceBlob> blob;
+  if (dir.empty()) {
+    blob = UnmanagedAsmResourceBlob::allocateWithAlign(
+        data, alignof(uint64_t), /*deleter=*/{}, /*dataIsMutable=*/false);
+  } else {
+    // Writes go through a temporary file, so concurrent printers of the same
+    // constant don't observe partial files.
+    std::string path = getConstantResourcePath(dir, name);
+    if (!llvm::sys::fs::exists(path)) {
+      auto error = llvm::writeToOutput(path, [&](raw_ostream& os) {
+        os.write(data.data(), data.size());
+        return llvm::Error::success();
+      });
+      if (error) {
+        llvm::consumeError(std::move(error));
+        return value;
+      }
+    }
+  }
+
+  auto handle =
+      getOrInsertConstantResource(type.getContext(), name, std::move(blob));
+  return DenseResourceElementsAttr::get(type, handle);
+}
+
+// Loads the blob of `value` from the sidecar directory if it's a resource that
+// isn't defined in the input. The data is copied into a fresh resource, so the
+// printer writes it back to the sidecar directory rather than the output.
+ParseResult loadExternalConstant(OpAsmParser& parser, llvm::SMLoc loc,
+                                 ElementsAttr& value) {
+  auto resourceAttr = dyn_cast<DenseResourceElementsAttr>(value);
+  StringRef dir = getConstantResourceDir();
+  if (!resourceAttr || dir.empty() || resourceAttr.getRawHandle().getBlob())
+    return success();
+
+  auto type = resourceAttr.getType();
+  std::string path =
+      getConstantResourcePath(dir, resourceAttr.getRawHandle().getKey());
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return parser.emitError(loc)
+           << "failed to read constant data from '" << path
+           << "': " << buffer.getError().message();
+  auto elementSize = getByteSizedElementSize(type.getElementType());
+  StringRef data = (*buffer)->getBuffer();
+  if (!elementSize ||
+      static_cast<int64_t>(data.size()) != type.getNumElements() * *elementSize)
+    return parser.emitError(loc) << "constant data in '" << path
+                                 << "' has invalid size for type " << type;
+
+  value = DenseResourceElementsAttr::get(
+      type, "constant",
+      HeapAsmResourceBlob::allocateAndCopyWithAlign(
+          ArrayRef(data.data(), data.size()), alignof(uint64_t)));
+  return success();
+}
+}  // namespace
+
 void printConstantOp(OpAsmPrinter& p, Operation* op, ElementsAttr value) {
   assert(op->getNumResults() == 1);
   // If not all types are the same, use generic form.
@@ -143,7 +637,12 @@ void printConstantOp(OpAsmPrinter& p, Operation* op, ElementsAttr value) {
 
   p.printOptionalAttrDict(op->getAttrs(), /*elidedAttrs=*/{"value"});
   p << ' ';
-  p.printStrippedAttrOrType(value);
+  p.printStrippedAttrOrType(getPrintedConstantValue(value));
+}
+
+void registerConstantPrintingCLOptions() {
+  // Make sure that the options struct has been initialized.
+  *clConstantPrintingOptions;
 }
 
 ParseResult parseConstantOp(OpAsmParser& parser, OperationState& result) {
@@ -171,9 +670,17 @@ ParseResult parseConstantOp(OpAsmParser& parser, OperationState& result) {
 
   ElementsAttr valueAttr;
   if (parser.parseOptionalAttrDict(result.attributes)) return failure();
-  if (parser.parseCustomAttributeWithFallback(valueAttr, Type{}, "value",
-                                              result.attributes))
-    return failure();
+  llvm::SMLoc loc = parser.getCurrentLocation();
+  if (succeeded(parser.parseOptionalKeyword("dense"))) {
+    if (parseDenseElements(parser, loc, valueAttr)) return failure();
+    result.addAttribute("value", valueAttr);
+  } else {
+    if (parser.parseCustomAttributeWithFallback(valueAttr, Type{}, "value",
+                                                result.attributes) ||
+        loadExternalConstant(parser, loc, valueAttr))
+      return failure();
+    result.attributes.set("value", valueAttr);
+  }
   result.addTypes(valueAttr.getType());
   return success();
 }
@@ -107,10 +107,29 @@ ParseResult parseVariadicSameOperandsAndResultType(
 //
 // When the `value` and `output` have different type, it just uses the default
 // operator assembly format as a fallback.
+//
+// Large constants can be printed as `dense_resource` blobs, whose data is
+// written in the resource section at the end of the output, or to sidecar
+// binary files, see `registerConstantPrintingCLOptions`.
 void printConstantOp(OpAsmPrinter& p, Operation* op, ElementsAttr value);
 
+// Parse a `constant` op. Resource blobs that aren't defined in the input are
+// loaded from the sidecar directory of `registerConstantPrintingCLOptions`
+// when it's set.
 ParseResult parseConstantOp(OpAsmParser& parser, OperationState& result);
 
+// Registers the command-line options for printing large constants:
+//
+//   --stablehlo-print-constants-as-resources-larger-than=<bytes>
+//     Prints constants whose data takes at least this many bytes as
+//     `dense_resource<stablehlo_constant_HASH>`, named after a hash of their
+//     data. Their data is written once per blob in hexadecimal, rather than
+//     formatted element by element in the body of the program.
+//   --stablehlo-constant-resource-dir=<dir>
+//     Writes the data of such constants to `<dir>/<name>.bin` instead of the
+//     output, and loads undefined blobs from there when parsing.
+void registerConstantPrintingCLOptions();
+
 // TuplesOp - only print result type. Operand type is trivially inferrable.
 //
 // Inferring operand types from tuple type:
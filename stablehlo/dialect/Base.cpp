@@ -16,9 +16,15 @@ limitations under the License.
 
 #include "stablehlo/dialect/Base.h"
 
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <tuple>
+#include <utility>
 
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/TypeSwitch.h"
 #include "mlir/Dialect/Quant/QuantTypes.h"
@@ -33,7 +39,61 @@ limitations under the License.
 namespace mlir {
 namespace hlo {
 
+// Memoized results of type inference helpers, keyed by uniqued types. Only
+// successful inferences are memoized, so that failures are diagnosed at every
+// location.
+class TypeInferenceCache {
+ public:
+  std::optional<bool> lookupCompatible(Type tp1, Type tp2) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = compatible.find({tp1, tp2});
+    if (it == compatible.end()) return std::nullopt;
+    return it->second;
+  }
+
+  void insertCompatible(Type tp1, Type tp2, bool result) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    compatible.try_emplace({tp1, tp2}, result);
+  }
+
+  Type lookupInferred(bool mostSpecific, Type tp1, Type tp2) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return inferred.lookup({mostSpecific, tp1, tp2});
+  }
+
+  void insertInferred(bool mostSpecific, Type tp1, Type tp2, Type result) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    inferred.try_emplace({mostSpecific, tp1, tp2}, result);
+  }
+
+ private:
+  std::shared_mutex mutex;
+  llvm::DenseMap<std::pair<Type, Type>, bool> compatible;
+  llvm::DenseMap<std::tuple<bool, Type, Type>, Type> inferred;
+};
+
+HloDialectInterface::HloDialectInterface(Dialect *dialect)
+    : Base(dialect), typeInferenceCache(new TypeInferenceCache) {}
+
+HloDialectInterface::~HloDialectInterface() = default;
+
+namespace {
+
+// Returns the cache of the StableHLO dialect in `context`, or nullptr if it
+// isn't loaded.
+TypeInferenceCache *getTypeInferenceCache(MLIRContext *context) {
+  auto *dialect = context->getLoadedDialect("stablehlo");
+  if (!dialect) return nullptr;
+  auto *interface = dialect->getRegisteredInterface<HloDialectInterface>();
+  return interface ? &interface->getTypeInferenceCache() : nullptr;
+}
+
+}  // namespace
+
 LogicalResult verifyCompatibleShapeWithBounds(Type type1, Type type2) {
+  // Types with bounds only bound their dynamic dimensions, so equal types
+  // are always compatible.
+  if (type1 == type2) return success();
   if (failed(verifyCompatibleShape(type1, type2))) return failure();
 
   // Verify shapes against bounds
@@ -104,7 +164,7 @@ bool isCompatibleElementTypeForHloTypeInference(Type tp1, Type tp2) {
   return tp1 == tp2;
 }
 
-bool isCompatibleForHloTypeInference(Type tp1, Type tp2) {
+static bool isCompatibleForHloTypeInferenceImpl(Type tp1, Type tp2) {
   // Dynamism: We don't require shapes to be the same, we only require them
   // to be compatible, which means that:
   //   1) At least one of the shapes is unranked.
@@ -124,6 +184,16 @@ bool isCompatibleForHloTypeInference(Type tp1, Type tp2) {
   return isCompatibleElementTypeForHloTypeInference(tp1, tp2);
 }
 
+bool isCompatibleForHloTypeInference(Type tp1, Type tp2) {
+  if (tp1 == tp2) return true;
+  auto *cache = getTypeInferenceCache(tp1.getContext());
+  if (!cache) return isCompatibleForHloTypeInferenceImpl(tp1, tp2);
+  if (auto result = cache->lookupCompatible(tp1, tp2)) return *result;
+  bool result = isCompatibleForHloTypeInferenceImpl(tp1, tp2);
+  cache->insertCompatible(tp1, tp2, result);
+  return result;
+}
+
 bool isCompatibleForHloTypeInference(TypeRange tp1, TypeRange tp2) {
   if (tp1.size() != tp2.size()) return false;
   for (auto [lt, rt] : llvm::zip(tp1, tp2))
@@ -135,8 +205,22 @@ bool isCompatibleForHloTypeInference(ArrayRef<int64_t> shape1, Type tp2) {
   if (llvm::any_of(shape1, [&](int64_t x) { return x < 0; })) return false;
   auto stp2 = dyn_cast<ShapedType>(tp2);
   if (!stp2) return false;
-  return isCompatibleForHloTypeInference(
-      RankedTensorType::get(shape1, stp2.getElementType()), tp2);
+
+  // Equivalent to checking a static tensor of shape `shape1` and the element
+  // type of `tp2` against `tp2`, without creating that type.
+  if (!stp2.hasRank()) return true;
+  if (stp2.getShape().size() != shape1.size()) return false;
+  ArrayRef<int64_t> bounds2;
+  if (auto rankedType2 = dyn_cast<RankedTensorType>(tp2))
+    bounds2 = encodingToBounds(rankedType2.getEncoding());
+  for (auto [dim, dimSize1] : llvm::enumerate(shape1)) {
+    int64_t dimSize2 = stp2.getDimSize(dim);
+    if (!isDynamicDimSize(dimSize2) && dimSize2 != dimSize1) return false;
+    if (!bounds2.empty() && !isDynamicDimSize(bounds2[dim]) &&
+        bounds2[dim] < dimSize1)
+      return false;
+  }
+  return true;
 }
 
 bool isCompatibleForHloTypeInference(Value shape1, Type tp2) {
@@ -360,8 +444,8 @@ FailureOr<std::pair<int64_t, int64_t>> inferLeastSpecificDimAndBound(
 }
 
 FailureOr<ShapedType> inferTypeWithCustomFn(
-    std::optional<Location> location, SmallVector<RankedTensorType> rankedTypes,
-    std::function<FailureOr<std::pair<int64_t, int64_t>>(
+    std::optional<Location> location, ArrayRef<RankedTensorType> rankedTypes,
+    function_ref<FailureOr<std::pair<int64_t, int64_t>>(
         std::optional<Location>, int64_t, int64_t, int64_t, int64_t, int64_t)>
         inferDimAndBoundFn) {
   auto rank = rankedTypes[0].getRank();
@@ -372,11 +456,12 @@ FailureOr<ShapedType> inferTypeWithCustomFn(
                                type.getRank());
     }
   }
-  SmallVector<int64_t> inferredSizes = to_vector(rankedTypes[0].getShape());
-  SmallVector<int64_t> inferredBounds(rank, ShapedType::kDynamic);
+  SmallVector<int64_t> inferredSizes(rankedTypes[0].getShape());
   ArrayRef<int64_t> bounds = encodingToBounds(rankedTypes[0].getEncoding());
-  if (!bounds.empty()) inferredBounds = to_vector(bounds);
   bool anyInputHaveBounds = !bounds.empty();
+  SmallVector<int64_t> inferredBounds =
+      anyInputHaveBounds ? SmallVector<int64_t>(bounds)
+                         : SmallVector<int64_t>(rank, ShapedType::kDynamic);
 
   for (unsigned i = 1; i < rankedTypes.size(); ++i) {
     bounds = encodingToBounds(rankedTypes[i].getEncoding());
@@ -467,16 +552,37 @@ FailureOr<Type> mapOverTupleElements(
   return fn(location, inputTypes);
 }
 
+// Applies `fn` to `inputTypes` like `mapOverTupleElements`, memoizing the
+// results for pairs of ranked tensor types, which most ops infer types from.
+FailureOr<Type> inferTypeWithCache(
+    std::optional<Location> location, TypeRange inputTypes, bool mostSpecific,
+    function_ref<FailureOr<Type>(std::optional<Location>, TypeRange types)>
+        fn) {
+  if (inputTypes.size() != 2 || !isa<RankedTensorType>(inputTypes[0]) ||
+      !isa<RankedTensorType>(inputTypes[1]))
+    return mapOverTupleElements(location, inputTypes, fn);
+
+  auto *cache = getTypeInferenceCache(inputTypes[0].getContext());
+  if (!cache) return fn(location, inputTypes);
+  if (Type result =
+          cache->lookupInferred(mostSpecific, inputTypes[0], inputTypes[1]))
+    return result;
+  auto result = fn(location, inputTypes);
+  if (succeeded(result))
+    cache->insertInferred(mostSpecific, inputTypes[0], inputTypes[1], *result);
+  return result;
+}
+
 FailureOr<Type> inferLeastSpecificType(std::optional<Location> location,
                                        TypeRange inputTypes) {
-  return mapOverTupleElements(location, inputTypes,
-                              inferLeastSpecificShapedType);
+  return inferTypeWithCache(location, inputTypes, /*mostSpecific=*/false,
+                            inferLeastSpecificShapedType);
 }
 
 FailureOr<Type> inferMostSpecificType(std::optional<Location> location,
                                       TypeRange inputTypes) {
-  return mapOverTupleElements(location, inputTypes,
-                              inferMostSpecificShapedType);
+  return inferTypeWithCache(location, inputTypes, /*mostSpecific=*/true,
+                            inferMostSpecificShapedType);
 }
 
 LogicalResult inferMostSpecificTypeComponents(
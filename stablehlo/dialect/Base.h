@@ -18,6 +18,7 @@ limitations under the License.
 #define STABLEHLO_DIALECT_BASE_H
 
 #include <algorithm>
+#include <memory>
 #include <optional>
 
 #include "llvm/ADT/APSInt.h"
@@ -218,9 +219,12 @@ ShapedType createShapedType(ShapedTypeComponents components);
 // This interface is implemented by both StableHLO and MHLO dialects
 // and is used as the foundation for sharing verification, type inference and
 // prettyprinting logic between them.
+class TypeInferenceCache;
+
 class HloDialectInterface : public DialectInterface::Base<HloDialectInterface> {
  public:
-  HloDialectInterface(Dialect *dialect) : Base(dialect) {}
+  HloDialectInterface(Dialect *dialect);
+  ~HloDialectInterface() override;
 
   // Creates a TokenType type, specific to this dialect.
   // See docs for the particular type in the corresponding dialect.
@@ -232,6 +236,16 @@ class HloDialectInterface : public DialectInterface::Base<HloDialectInterface> {
   // Creates a TypeExtensions attribute, specific to this dialect.
   // See docs for the particular attribute in the corresponding dialect.
   virtual Attribute createTypeExtensions(ArrayRef<int64_t> bounds) const = 0;
+
+  // Memoizes the results of pure type inference helpers such as
+  // `isCompatibleForHloTypeInference` for the types of this dialect's
+  // context, which are uniqued. Safe to use from multiple threads.
+  TypeInferenceCache &getTypeInferenceCache() const {
+    return *typeInferenceCache;
+  }
+
+ private:
+  std::unique_ptr<TypeInferenceCache> typeInferenceCache;
 };
 
 namespace bytecode {
@@ -16,23 +16,292 @@ limitations under the License.
 #include "stablehlo/dialect/Serialization.h"
 
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/bit.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 #include "mlir/Bytecode/BytecodeWriter.h"
 #include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Location.h"
 #include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OperationSupport.h"
 #include "mlir/Parser/Parser.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/LogicalResult.h"
 #include "stablehlo/dialect/Version.h"
+#include "stablehlo/dialect/VhloBytecode.h"
 #include "stablehlo/dialect/VhloOps.h"
 #include "stablehlo/transforms/Passes.h"
 
 namespace mlir {
 namespace stablehlo {
+namespace {
 
-LogicalResult serializePortableArtifact(ModuleOp module,
-                                        StringRef targetVersion,
-                                        raw_ostream& os) {
+// Reads the parts of the MLIR bytecode format which `readPortableArtifactInfo`
+// needs, see mlir/lib/Bytecode/Encoding.h. Like the MLIR bytecode reader, but
+// only follows the structure of the program and skips everything else.
+class BytecodeSummaryReader {
+ public:
+  // Versions of the bytecode format which changed the parts read here.
+  static constexpr uint64_t kDialectVersioning = 1;
+  static constexpr uint64_t kLazyLoading = 2;
+  static constexpr uint64_t kUseListOrdering = 3;
+  static constexpr uint64_t kElideUnknownBlockArgLocation = 4;
+  static constexpr uint64_t kNativePropertiesEncoding = 5;
+
+  // Sections of the bytecode format.
+  static constexpr uint8_t kStringSection = 0;
+  static constexpr uint8_t kDialectSection = 1;
+  static constexpr uint8_t kIRSection = 4;
+  static constexpr uint8_t kNumSections = 9;
+
+  // Bits of the mask which says which parts an encoded op has.
+  static constexpr uint8_t kHasAttrs = 1 << 0;
+  static constexpr uint8_t kHasResults = 1 << 1;
+  static constexpr uint8_t kHasOperands = 1 << 2;
+  static constexpr uint8_t kHasSuccessors = 1 << 3;
+  static constexpr uint8_t kHasInlineRegions = 1 << 4;
+  static constexpr uint8_t kHasUseListOrders = 1 << 5;
+  static constexpr uint8_t kHasProperties = 1 << 6;
+
+  // Reads `data`, which starts at `offset` in the artifact. Alignment is
+  // relative to the start of the artifact.
+  explicit BytecodeSummaryReader(ArrayRef<uint8_t> data = {},
+                                 uint64_t offset = 0)
+      : data_(data), offset_(offset) {}
+
+  bool empty() const { return position_ == data_.size(); }
+  uint64_t getPosition() const { return position_; }
+  ArrayRef<uint8_t> getData() const { return data_; }
+
+  LogicalResult readByte(uint8_t& value) {
+    if (empty()) return failure();
+    value = data_[position_++];
+    return success();
+  }
+
+  LogicalResult readBytes(uint64_t size, ArrayRef<uint8_t>& bytes) {
+    if (size > data_.size() - position_) return failure();
+    bytes = data_.slice(position_, size);
+    position_ += size;
+    return success();
+  }
+
+  // Reads a prefix varint: the number of trailing zeros of the first byte is
+  // the number of bytes which follow it, or 8 if it is 0.
+  LogicalResult readVarInt(uint64_t& value) {
+    uint8_t first;
+    if (failed(readByte(first))) return failure();
+    ArrayRef<uint8_t> bytes;
+    if (first == 0) {
+      if (failed(readBytes(sizeof(uint64_t), bytes))) return failure();
+      value = llvm::support::endian::read64le(bytes.data());
+      return success();
+    }
+    unsigned numBytes = llvm::countr_zero(first);
+    if (failed(readBytes(numBytes, bytes))) return failure();
+    value = first;
+    for (auto [i, byte] : llvm::enumerate(bytes))
+      value |= static_cast<uint64_t>(byte) << (8 * (i + 1));
+    value >>= numBytes + 1;
+    return success();
+  }
+
+  LogicalResult readVarIntWithFlag(uint64_t& value, bool& flag) {
+    if (failed(readVarInt(value))) return failure();
+    flag = value & 1;
+    value >>= 1;
+    return success();
+  }
+
+  LogicalResult readNullTerminatedString(StringRef& value) {
+    auto rest = data_.drop_front(position_);
+    auto* end = llvm::find(rest, 0);
+    if (end == rest.end()) return failure();
+    value = StringRef(reinterpret_cast<const char*>(rest.data()),
+                      end - rest.begin());
+    position_ += value.size() + 1;
+    return success();
+  }
+
+  // Reads the header of a section, which is followed by its data.
+  LogicalResult readSection(uint8_t& id, BytecodeSummaryReader& section) {
+    uint8_t idAndIsAligned;
+    uint64_t length;
+    if (failed(readByte(idAndIsAligned)) || failed(readVarInt(length)))
+      return failure();
+    id = idAndIsAligned & 0x7F;
+    if (id >= kNumSections) return failure();
+    if (idAndIsAligned & 0x80) {
+      uint64_t alignment;
+      if (failed(readVarInt(alignment)) || alignment == 0) return failure();
+      uint8_t padding;
+      while ((offset_ + position_) % alignment != 0)
+        if (failed(readByte(padding)) || padding != 0xCB) return failure();
+    }
+    uint64_t sectionOffset = offset_ + position_;
+    ArrayRef<uint8_t> bytes;
+    if (failed(readBytes(length, bytes))) return failure();
+    section = BytecodeSummaryReader(bytes, sectionOffset);
+    return success();
+  }
+
+ private:
+  ArrayRef<uint8_t> data_;
+  uint64_t offset_;
+  uint64_t position_ = 0;
+};
+
+// Counts the ops of a bytecode program by name, following the nesting of
+// blocks and regions in the IR section.
+class OpCounter {
+ public:
+  OpCounter(uint64_t version, ArrayRef<std::string> opNames,
+            std::map<std::string, int64_t>& opCounts)
+      : version_(version), opNames_(opNames), opCounts_(opCounts) {}
+
+  LogicalResult countBlock(BytecodeSummaryReader& reader) {
+    uint64_t numOps, numArgs = 0;
+    bool hasArgs;
+    if (failed(reader.readVarIntWithFlag(numOps, hasArgs))) return failure();
+    if (hasArgs) {
+      if (failed(reader.readVarInt(numArgs))) return failure();
+      for (uint64_t i = 0; i < numArgs; ++i) {
+        uint64_t type, location;
+        bool hasLocation = true;
+        if (version_ >= BytecodeSummaryReader::kElideUnknownBlockArgLocation
+                ? failed(reader.readVarIntWithFlag(type, hasLocation))
+                : failed(reader.readVarInt(type)))
+          return failure();
+        if (hasLocation && failed(reader.readVarInt(location)))
+          return failure();
+      }
+      uint8_t hasUseListOrders = 0;
+      if (version_ >= BytecodeSummaryReader::kUseListOrdering &&
+          (failed(reader.readByte(hasUseListOrders)) ||
+           (hasUseListOrders && failed(skipUseListOrders(reader, numArgs)))))
+        return failure();
+    }
+    for (uint64_t i = 0; i < numOps; ++i)
+      if (failed(countOp(reader))) return failure();
+    return success();
+  }
+
+ private:
+  LogicalResult countOp(BytecodeSummaryReader& reader) {
+    uint64_t name, location;
+    uint8_t mask;
+    if (failed(reader.readVarInt(name)) || name >= opNames_.size() ||
+        failed(reader.readByte(mask)) || failed(reader.readVarInt(location)))
+      return failure();
+    ++opCounts_[opNames_[name]];
+
+    uint64_t index, numResults = 0;
+    if ((mask & BytecodeSummaryReader::kHasAttrs) &&
+        failed(reader.readVarInt(index)))
+      return failure();
+    if ((mask & BytecodeSummaryReader::kHasProperties) &&
+        failed(reader.readVarInt(index)))
+      return failure();
+    if ((mask & BytecodeSummaryReader::kHasResults) &&
+        failed(skipList(reader, numResults)))
+      return failure();
+    uint64_t numValues;
+    if ((mask & BytecodeSummaryReader::kHasOperands) &&
+        failed(skipList(reader, numValues)))
+      return failure();
+    if ((mask & BytecodeSummaryReader::kHasSuccessors) &&
+        failed(skipList(reader, numValues)))
+      return failure();
+    if ((mask & BytecodeSummaryReader::kHasUseListOrders) &&
+        failed(skipUseListOrders(reader, numResults)))
+      return failure();
+    if (!(mask & BytecodeSummaryReader::kHasInlineRegions)) return success();
+
+    uint64_t numRegions;
+    bool isIsolatedFromAbove;
+    if (failed(reader.readVarIntWithFlag(numRegions, isIsolatedFromAbove)))
+      return failure();
+    if (numRegions == 0) return success();
+
+    // Since lazy loading, the regions of isolated ops are sections of their
+    // own.
+    if (isIsolatedFromAbove &&
+        version_ >= BytecodeSummaryReader::kLazyLoading) {
+      uint8_t id;
+      BytecodeSummaryReader section;
+      if (failed(reader.readSection(id, section)) ||
+          id != BytecodeSummaryReader::kIRSection)
+        return failure();
+      return countRegions(section, numRegions);
+    }
+    return countRegions(reader, numRegions);
+  }
+
+  LogicalResult countRegions(BytecodeSummaryReader& reader,
+                             uint64_t numRegions) {
+    for (uint64_t i = 0; i < numRegions; ++i) {
+      uint64_t numBlocks, numValues;
+      if (failed(reader.readVarInt(numBlocks))) return failure();
+      if (numBlocks == 0) continue;
+      if (failed(reader.readVarInt(numValues))) return failure();
+      for (uint64_t j = 0; j < numBlocks; ++j)
+        if (failed(countBlock(reader))) return failure();
+    }
+    return success();
+  }
+
+  // Skips a list of indices, which is preceded by its size.
+  static LogicalResult skipList(BytecodeSummaryReader& reader,
+                                uint64_t& size) {
+    uint64_t index;
+    if (failed(reader.readVarInt(size))) return failure();
+    for (uint64_t i = 0; i < size; ++i)
+      if (failed(reader.readVarInt(index))) return failure();
+    return success();
+  }
+
+  // Skips the orders of the uses of some of `numValues` values.
+  static LogicalResult skipUseListOrders(BytecodeSummaryReader& reader,
+                                         uint64_t numValues) {
+    uint64_t numOrders = 1, index;
+    if (numValues > 1 && failed(reader.readVarInt(numOrders)))
+      return failure();
+    for (uint64_t i = 0; i < numOrders; ++i) {
+      uint64_t numUses;
+      bool isIndexPairEncoding;
+      if ((numValues > 1 && failed(reader.readVarInt(index))) ||
+          failed(reader.readVarIntWithFlag(numUses, isIndexPairEncoding)))
+        return failure();
+      for (uint64_t j = 0; j < numUses * (isIndexPairEncoding ? 2 : 1); ++j)
+        if (failed(reader.readVarInt(index))) return failure();
+    }
+    return success();
+  }
+
+  uint64_t version_;
+  ArrayRef<std::string> opNames_;
+  std::map<std::string, int64_t>& opCounts_;
+};
+
+}  // namespace
+
+LogicalResult serializePortableArtifact(
+    ModuleOp module, StringRef targetVersion, raw_ostream& os,
+    std::optional<int64_t> minCompressedSize) {
   MLIRContext* context = module.getContext();
 
   // Convert StableHLO --> VHLO. Will fail if entire program is not StableHLO.
@@ -46,8 +315,10 @@ LogicalResult serializePortableArtifact(ModuleOp module,
 
   // Convert VHLO --> VHLO(version x.y.z).
   // Doing separately for now since we need to improve error messaging around
-  // target version failures.
-  {
+  // target version failures. Legalization produces VHLO of the current
+  // version, so this walk is skipped when targeting it.
+  auto version = vhlo::Version::fromString(targetVersion);
+  if (failed(version) || !(*version == vhlo::Version::getCurrentVersion())) {
     PassManager pm(context);
     pm.addPass(stablehlo::createVhloToVersionPass({targetVersion.str()}));
     if (!succeeded(pm.run(module))) {
@@ -63,9 +334,42 @@ LogicalResult serializePortableArtifact(ModuleOp module,
       vhlo::Version::fromString(targetVersion)->getBytecodeVersion();
   if (failed(bytecodeVersion)) return failure();
   writerConfig.setDesiredBytecodeVersion(bytecodeVersion.value());
+
+  // Compressed tensors are an encoding of the VHLO bytecode interface, which
+  // only sees the options of a write as the VHLO dialect version.
+  if (minCompressedSize) {
+    if (*version < vhlo::Version::getMinimumCompressedTensorVersion())
+      return module.emitError()
+             << "compressed constants require a target version of at least "
+             << vhlo::Version::getMinimumCompressedTensorVersion();
+    writerConfig.setDialectVersion<vhlo::VhloDialect>(
+        std::make_unique<vhlo::VhloBytecodeWriterOptions>(*minCompressedSize));
+  }
   return writeBytecodeToFile(module, os, writerConfig);
 }
 
+LogicalResult serializePortableArtifactToFile(
+    ModuleOp module, StringRef targetVersion, StringRef filename,
+    std::optional<int64_t> minCompressedSize) {
+  LogicalResult result = success();
+  auto error = llvm::writeToOutput(filename, [&](raw_ostream& os) {
+    result = serializePortableArtifact(module, targetVersion, os,
+                                       minCompressedSize);
+    if (failed(result))
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     "failed to serialize module");
+    return llvm::Error::success();
+  });
+  if (!error) return success();
+  // Serialization failures have been reported already.
+  if (succeeded(result))
+    module.emitError() << "failed to write portable artifact " << filename
+                       << ": " << llvm::toString(std::move(error));
+  else
+    llvm::consumeError(std::move(error));
+  return failure();
+}
+
 OwningOpRef<ModuleOp> deserializePortableArtifact(StringRef sourceStr,
                                                   MLIRContext* context) {
   context->loadDialect<vhlo::VhloDialect>();
@@ -84,5 +388,161 @@ OwningOpRef<ModuleOp> deserializePortableArtifact(StringRef sourceStr,
   return module;
 }
 
+OwningOpRef<ModuleOp> deserializePortableArtifactFromFile(
+    StringRef filename, MLIRContext* context, int64_t minResourceSize) {
+  auto buffer = llvm::MemoryBuffer::getFile(filename, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    emitError(UnknownLoc::get(context))
+        << "failed to read portable artifact " << filename << ": "
+        << buffer.getError().message();
+    return nullptr;
+  }
+  return deserializePortableArtifact(std::move(*buffer), context,
+                                     minResourceSize);
+}
+
+OwningOpRef<ModuleOp> deserializePortableArtifact(
+    std::unique_ptr<llvm::MemoryBuffer> buffer, MLIRContext* context,
+    int64_t minResourceSize) {
+  auto* dialect = context->getOrLoadDialect<vhlo::VhloDialect>();
+  StringRef sourceStr = buffer->getBuffer();
+  dialect->retainArtifact(std::move(buffer), minResourceSize);
+  return deserializePortableArtifact(sourceStr, context);
+}
+
+FailureOr<PortableArtifactInfo> readPortableArtifactInfo(StringRef artifact) {
+  using Reader = BytecodeSummaryReader;
+  Reader reader(llvm::arrayRefFromStringRef(artifact));
+  ArrayRef<uint8_t> magic;
+  uint64_t version;
+  StringRef producer;
+  if (failed(reader.readBytes(4, magic)) ||
+      llvm::toStringRef(magic) != "ML\xefR" ||
+      failed(reader.readVarInt(version)) ||
+      failed(reader.readNullTerminatedString(producer)))
+    return failure();
+
+  PortableArtifactInfo info;
+  info.producer = producer.str();
+  info.bytecodeVersion = version;
+  if (producer.consume_front("StableHLO_v")) {
+    auto producerVersion = vhlo::Version::fromString(producer);
+    if (succeeded(producerVersion)) info.version = *producerVersion;
+  }
+
+  SmallVector<Reader> sections(Reader::kNumSections);
+  while (!reader.empty()) {
+    uint8_t id;
+    Reader section;
+    if (failed(reader.readSection(id, section))) return failure();
+    sections[id] = section;
+  }
+
+  // Strings are listed by size, from last to first, followed by their data,
+  // each with a null terminator.
+  auto& stringSection = sections[Reader::kStringSection];
+  uint64_t numStrings;
+  if (failed(stringSection.readVarInt(numStrings))) return failure();
+  SmallVector<StringRef> strings(numStrings);
+  auto stringData = stringSection.getData();
+  uint64_t end = stringData.size();
+  for (StringRef& string : llvm::reverse(strings)) {
+    uint64_t size;
+    if (failed(stringSection.readVarInt(size)) || size == 0 ||
+        stringSection.getPosition() > end ||
+        size > end - stringSection.getPosition())
+      return failure();
+    string = llvm::toStringRef(stringData.slice(end - size, size - 1));
+    end -= size;
+  }
+
+  // Dialects are followed by the names of ops, grouped by dialect.
+  auto& dialectSection = sections[Reader::kDialectSection];
+  uint64_t numDialects, index;
+  if (failed(dialectSection.readVarInt(numDialects))) return failure();
+  SmallVector<StringRef> dialects;
+  for (uint64_t i = 0; i < numDialects; ++i) {
+    bool hasVersion = false;
+    if (version < Reader::kDialectVersioning
+            ? failed(dialectSection.readVarInt(index))
+            : failed(dialectSection.readVarIntWithFlag(index, hasVersion)))
+      return failure();
+    if (index >= numStrings) return failure();
+    dialects.push_back(strings[index]);
+
+    uint8_t id;
+    Reader versionSection;
+    if (hasVersion && failed(dialectSection.readSection(id, versionSection)))
+      return failure();
+  }
+  uint64_t numOps;
+  if (version >= Reader::kElideUnknownBlockArgLocation &&
+      failed(dialectSection.readVarInt(numOps)))
+    return failure();
+  SmallVector<std::string> opNames;
+  while (!dialectSection.empty()) {
+    uint64_t dialect, numDialectOps;
+    if (failed(dialectSection.readVarInt(dialect)) ||
+        dialect >= numDialects ||
+        failed(dialectSection.readVarInt(numDialectOps)))
+      return failure();
+    for (uint64_t i = 0; i < numDialectOps; ++i) {
+      bool wasRegistered;
+      if (version < Reader::kNativePropertiesEncoding
+              ? failed(dialectSection.readVarInt(index))
+              : failed(dialectSection.readVarIntWithFlag(index, wasRegistered)))
+        return failure();
+      if (index >= numStrings) return failure();
+      opNames.push_back((dialects[dialect] + "." + strings[index]).str());
+    }
+  }
+
+  // The IR section is the top-level block of the program.
+  auto& irSection = sections[Reader::kIRSection];
+  OpCounter counter(version, opNames, info.opCounts);
+  if (failed(counter.countBlock(irSection)) || !irSection.empty())
+    return failure();
+  return info;
+}
+
+bool isPortableArtifactCompatible(const PortableArtifactInfo& info,
+                                  const vhlo::Version& targetVersion,
+                                  MLIRContext* context) {
+  if (targetVersion < vhlo::Version::getMinimumVersion() ||
+      vhlo::Version::getCurrentVersion() < targetVersion)
+    return false;
+  context->loadDialect<vhlo::VhloDialect>();
+
+  // Ops of all versions are named `<op>_v<N>`, so an op is compatible if any
+  // op of the same prefix exists in `targetVersion`. The versions of ops are
+  // properties of their classes, which are queried through ops without
+  // operands or attributes.
+  auto isLegal = [&](RegisteredOperationName name) {
+    OperationState state(UnknownLoc::get(context), name);
+    Operation* op = Operation::create(state);
+    auto versionedOp = dyn_cast<vhlo::VersionedOpInterface>(op);
+    bool isLegal = versionedOp &&
+                   versionedOp.getMinVersion() <= targetVersion &&
+                   targetVersion <= versionedOp.getMaxVersion();
+    op->destroy();
+    return isLegal;
+  };
+  // Artifacts are modules of VHLO ops.
+  llvm::StringMap<bool> isLegalPrefix;
+  for (const auto& opCount : info.opCounts) {
+    StringRef name = opCount.first;
+    if (name != ModuleOp::getOperationName())
+      isLegalPrefix[name.rsplit("_v").first] = false;
+  }
+  for (auto name : context->getRegisteredOperations()) {
+    auto it = isLegalPrefix.find(name.getStringRef().rsplit("_v").first);
+    if (it != isLegalPrefix.end() && !it->second) it->second = isLegal(name);
+  }
+
+  return llvm::all_of(isLegalPrefix,
+                      [](const auto& entry) { return entry.second; });
+}
+
 }  // namespace stablehlo
 }  // namespace mlir
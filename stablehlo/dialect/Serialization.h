@@ -16,9 +16,17 @@ limitations under the License.
 #ifndef STABLEHLO_DIALECT_SERIALIZATION_H
 #define STABLEHLO_DIALECT_SERIALIZATION_H
 
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "llvm/Support/MemoryBuffer.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/Support/LogicalResult.h"
+#include "stablehlo/dialect/Version.h"
 
 namespace mlir {
 namespace stablehlo {
@@ -31,9 +39,25 @@ namespace stablehlo {
 // Can fail if `module` cannot be expressed in the `targetVersion` version of
 // StableHLO, e.g. if it's using new or removed features, or if it involves
 // unsupported dialects.
-LogicalResult serializePortableArtifact(ModuleOp module,
-                                        StringRef targetVersion,
-                                        raw_ostream& os);
+//
+// If `minCompressedSize` is provided, constants of at least that many bytes
+// are compressed with zstd, or zlib if LLVM was built without zstd, in chunks
+// which are decompressed in parallel when the artifact is read. This requires
+// a `targetVersion` of at least `Version::getMinimumCompressedTensorVersion`.
+LogicalResult serializePortableArtifact(
+    ModuleOp module, StringRef targetVersion, raw_ostream& os,
+    std::optional<int64_t> minCompressedSize = std::nullopt);
+
+// Write a StableHLO program to a portable artifact file
+// Like the above, but streams the payload to the file `filename` (or to
+// stdout if it is "-") as it is written rather than buffering it. The file
+// is first written to a temporary file, so that it is only replaced once the
+// artifact is complete. Constants are referenced rather than copied when
+// `module` is converted to VHLO, so the peak memory of serializing large
+// models stays close to the size of `module` itself.
+LogicalResult serializePortableArtifactToFile(
+    ModuleOp module, StringRef targetVersion, StringRef filename,
+    std::optional<int64_t> minCompressedSize = std::nullopt);
 
 // Read StableHLO portable artifact
 //
@@ -43,6 +67,53 @@ LogicalResult serializePortableArtifact(ModuleOp module,
 OwningOpRef<ModuleOp> deserializePortableArtifact(StringRef sourceStr,
                                                   MLIRContext* context);
 
+// Read StableHLO portable artifact file
+// Like the above, but maps the file `filename` into memory and keeps it alive
+// as long as `context` rather than copying its contents. Tensors are read
+// without copying their data, and constants of at least `minResourceSize`
+// bytes become `DenseResourceElementsAttr` which reference the mapped file,
+// so the cost of loading large models doesn't depend on the size of their
+// weights. Returns nullptr if the file can't be read or fails to deserialize.
+OwningOpRef<ModuleOp> deserializePortableArtifactFromFile(
+    StringRef filename, MLIRContext* context,
+    int64_t minResourceSize = 1 << 16);
+
+// Like `deserializePortableArtifactFromFile`, but reads the artifact from
+// `buffer`, which is kept alive as long as `context`.
+OwningOpRef<ModuleOp> deserializePortableArtifact(
+    std::unique_ptr<llvm::MemoryBuffer> buffer, MLIRContext* context,
+    int64_t minResourceSize);
+
+// Summary of a portable artifact, see `readPortableArtifactInfo`.
+struct PortableArtifactInfo {
+  // The producer string of the artifact, e.g. "StableHLO_v1.0.0".
+  std::string producer;
+  // The version in the producer string, if any.
+  std::optional<vhlo::Version> version;
+  // The version of the MLIR bytecode format of the artifact.
+  int64_t bytecodeVersion = 0;
+  // The number of ops of every kind in the artifact, by name, e.g.
+  // "vhlo.add_v1".
+  std::map<std::string, int64_t> opCounts;
+};
+
+// Read the summary of a portable artifact without deserializing it
+// Reads only the bytecode header, the names of ops and the structure of the
+// program, skipping attributes, types and resources, so that constants and
+// VHLO aren't even decoded, let alone converted to StableHLO. Returns failure
+// if `artifact` isn't valid MLIR bytecode.
+FailureOr<PortableArtifactInfo> readPortableArtifactInfo(StringRef artifact);
+
+// Check whether the ops of a portable artifact exist in a version
+// Returns whether every VHLO op of `info` has a version which is legal in
+// `targetVersion`, so that `VhloToVersion` can convert it to that version.
+// Attributes, types and the versioned constraints of ops aren't checked, so
+// conversion can still fail for artifacts which pass this check, but not for
+// ops which fail it.
+bool isPortableArtifactCompatible(const PortableArtifactInfo& info,
+                                  const vhlo::Version& targetVersion,
+                                  MLIRContext* context);
+
 }  // namespace stablehlo
 }  // namespace mlir
 
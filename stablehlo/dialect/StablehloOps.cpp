@@ -27,6 +27,7 @@ limitations under the License.
 #include <numeric>
 #include <optional>
 #include <set>
+#include <shared_mutex>
 #include <unordered_map>
 #include <utility>
 
@@ -107,6 +108,17 @@ Value maybeCastTo(OpBuilder& b, Location loc, Value value, Type type) {
   assert(type.isIndex() || value.getType().isIndex());
   return b.create<arith::IndexCastOp>(loc, type, value);
 }
+
+// Runs `verifyFn` unless an op with the same types and attributes as `op` was
+// verified successfully before. See `StablehloDialect::isVerified`.
+template <typename VerifyFn>
+LogicalResult verifyMemoized(Operation* op, VerifyFn verifyFn) {
+  auto* dialect = cast<StablehloDialect>(op->getDialect());
+  if (dialect->isVerified(op)) return success();
+  if (failed(verifyFn())) return failure();
+  dialect->setVerified(op);
+  return success();
+}
 }  // namespace
 
 LogicalResult TypeExtensionsAttr::verifyEncoding(
@@ -555,13 +567,15 @@ ParseResult parsePrecisionConfig(OpAsmParser& parser, mlir::ArrayAttr& attr) {
 //===----------------------------------------------------------------------===//
 
 LogicalResult DotGeneralOp::verify() {
-  return hlo::verifyDotGeneralOp(
-      getLoc(), getLhs(), getRhs(),
-      getDotDimensionNumbersAttr().getLhsBatchingDimensions(),
-      getDotDimensionNumbersAttr().getRhsBatchingDimensions(),
-      getDotDimensionNumbersAttr().getLhsContractingDimensions(),
-      getDotDimensionNumbersAttr().getRhsContractingDimensions(),
-      getPrecisionConfig(), getResult());
+  return verifyMemoized(*this, [&] {
+    return hlo::verifyDotGeneralOp(
+        getLoc(), getLhs(), getRhs(),
+        getDotDimensionNumbersAttr().getLhsBatchingDimensions(),
+        getDotDimensionNumbersAttr().getRhsBatchingDimensions(),
+        getDotDimensionNumbersAttr().getLhsContractingDimensions(),
+        getDotDimensionNumbersAttr().getRhsContractingDimensions(),
+        getPrecisionConfig(), getResult());
+  });
 }
 
 LogicalResult DotGeneralOp::reifyReturnTypeShapes(
@@ -1020,20 +1034,22 @@ LogicalResult CollectivePermuteOp::verify() {
 //===----------------------------------------------------------------------===//
 
 LogicalResult ConvolutionOp::verify() {
-  return hlo::verifyConvolutionOp(
-      getLoc(), getLhs().getType(), getRhs().getType(), getWindowStrides(),
-      getPadding(), getLhsDilation(), getRhsDilation(), getWindowReversal(),
-      getDimensionNumbers().getInputBatchDimension(),
-      getDimensionNumbers().getInputFeatureDimension(),
-      getDimensionNumbers().getInputSpatialDimensions(),
-      getDimensionNumbers().getKernelInputFeatureDimension(),
-      getDimensionNumbers().getKernelOutputFeatureDimension(),
-      getDimensionNumbers().getKernelSpatialDimensions(),
-      getDimensionNumbers().getOutputBatchDimension(),
-      getDimensionNumbers().getOutputFeatureDimension(),
-      getDimensionNumbers().getOutputSpatialDimensions(),
-      getFeatureGroupCount(), getBatchGroupCount(), getPrecisionConfig(),
-      getResult().getType());
+  return verifyMemoized(*this, [&] {
+    return hlo::verifyConvolutionOp(
+        getLoc(), getLhs().getType(), getRhs().getType(), getWindowStrides(),
+        getPadding(), getLhsDilation(), getRhsDilation(), getWindowReversal(),
+        getDimensionNumbers().getInputBatchDimension(),
+        getDimensionNumbers().getInputFeatureDimension(),
+        getDimensionNumbers().getInputSpatialDimensions(),
+        getDimensionNumbers().getKernelInputFeatureDimension(),
+        getDimensionNumbers().getKernelOutputFeatureDimension(),
+        getDimensionNumbers().getKernelSpatialDimensions(),
+        getDimensionNumbers().getOutputBatchDimension(),
+        getDimensionNumbers().getOutputFeatureDimension(),
+        getDimensionNumbers().getOutputSpatialDimensions(),
+        getFeatureGroupCount(), getBatchGroupCount(), getPrecisionConfig(),
+        getResult().getType());
+  });
 }
 
 mlir::Speculation::Speculatability ConvolutionOp::getSpeculatability() {
@@ -3497,5 +3513,44 @@ void StablehloDialect::setVersion(
   this->version = version;
 }
 
+SmallVector<const void*> StablehloDialect::getVerificationKey(Operation* op) {
+  SmallVector<const void*> key = {op->getName().getAsOpaquePointer()};
+  // Types are never null, so nulls separate the operand and result types.
+  for (Type type : op->getOperandTypes())
+    key.push_back(type.getAsOpaquePointer());
+  key.push_back(nullptr);
+  for (Type type : op->getResultTypes())
+    key.push_back(type.getAsOpaquePointer());
+  key.push_back(nullptr);
+  // Inherent attributes are stored in properties, and their names only depend
+  // on the op name. Absent ones are null.
+  for (StringAttr name : op->getName().getAttributeNames())
+    key.push_back(op->getInherentAttr(name.getValue())
+                      .value_or(Attribute())
+                      .getAsOpaquePointer());
+  for (NamedAttribute attr : op->getDiscardableAttrs()) {
+    key.push_back(attr.getName().getAsOpaquePointer());
+    key.push_back(attr.getValue().getAsOpaquePointer());
+  }
+  return key;
+}
+
+bool StablehloDialect::isVerified(Operation* op) const {
+  auto key = getVerificationKey(op);
+  std::shared_lock<std::shared_mutex> lock(verifiedOpsMutex);
+  return verifiedOps.contains(key);
+}
+
+void StablehloDialect::setVerified(Operation* op) {
+  auto key = getVerificationKey(op);
+  std::unique_lock<std::shared_mutex> lock(verifiedOpsMutex);
+  if (verifiedOps.contains(key)) return;
+  if (verifiedOps.size() >= kMaxVerifiedOps) {
+    verifiedOps.clear();
+    verifiedOpsAllocator.Reset();
+  }
+  verifiedOps.insert(ArrayRef(key).copy(verifiedOpsAllocator));
+}
+
 }  // namespace stablehlo
 }  // namespace mlir
@@ -19,8 +19,14 @@ limitations under the License.
 
 #include <algorithm>
 #include <optional>
+#include <cstddef>
+#include <shared_mutex>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
 #include "mlir/Dialect/Quant/QuantTypes.h"
 #include "mlir/Dialect/Shape/IR/Shape.h"
 #include "mlir/IR/Attributes.h"
@@ -105,8 +111,34 @@ class StablehloDialect : public Dialect {
   // Note: there is currently no validation.
   void setVersion(std::optional<StablehloDialectVersion> version);
 
+  // Returns whether an op with the same name, operand and result types and
+  // attributes as `op` was verified successfully before. Only valid for ops
+  // whose verifiers depend on nothing else, e.g. dot_general and convolution,
+  // whose verification is memoized since passes verify every op again after
+  // every pass. Thread-safe, so that functions can be verified in parallel.
+  bool isVerified(Operation *op) const;
+
+  // Records that `op` was verified successfully. Once `kMaxVerifiedOps` ops
+  // are recorded, the records are dropped and start over, which bounds their
+  // memory in long-lived contexts.
+  void setVerified(Operation *op);
+
+  static constexpr size_t kMaxVerifiedOps = 4096;
+
  private:
+  // Returns the name, operand and result types and attributes of `op`. They
+  // are all uniqued in the context, so their pointers identify them without
+  // creating any new types or attributes.
+  static SmallVector<const void *> getVerificationKey(Operation *op);
+
   std::optional<StablehloDialectVersion> version;
+
+  // Guards the members below.
+  mutable std::shared_mutex verifiedOpsMutex;
+  // The keys of the ops which verified successfully, which are allocated in
+  // `verifiedOpsAllocator`.
+  llvm::DenseSet<ArrayRef<const void *>> verifiedOps;
+  llvm::BumpPtrAllocator verifiedOpsAllocator;
 };
 
 // Verifies the source target pairs attached to collective permute.
@@ -352,6 +352,32 @@ LogicalResult verifyBroadcastInDimOpQuantConstraints(
 // Utils for shape functions.
 //===----------------------------------------------------------------------===//
 
+// A set of distinct dimensions of a tensor, one bit per dimension, which
+// checks dimension numbers in one pass without allocating. Only supports
+// ranks up to `kMaxRank`, beyond which callers fall back to the general
+// checks below, which they also use to report errors.
+class DimensionMask {
+ public:
+  static constexpr int64_t kMaxRank = 64;
+
+  // Adds `dims` of a tensor of `rank`. Returns false if one of them is out of
+  // range or was already added.
+  bool insert(ArrayRef<int64_t> dims, int64_t rank) {
+    return llvm::all_of(dims, [&](int64_t dim) { return insert(dim, rank); });
+  }
+  bool insert(int64_t dim, int64_t rank) {
+    if (dim < 0 || dim >= rank || rank > kMaxRank || contains(dim))
+      return false;
+    bits_ |= uint64_t{1} << dim;
+    return true;
+  }
+
+  bool contains(int64_t dim) const { return (bits_ >> dim) & 1; }
+
+ private:
+  uint64_t bits_ = 0;
+};
+
 // Checks if the vector `nums` has duplicates.
 bool isUnique(ArrayRef<int64_t> nums) {
   llvm::SmallDenseSet<int64_t> dimSet;
@@ -1177,6 +1203,21 @@ LogicalResult isSpatialDimensionsValid(
                              kernelSpatialDimensions.size(), ", and ",
                              outputSpatialDimensions.size(), " resp.");
 
+  // Valid dimension numbers, which are the common case, are checked without
+  // copying them.
+  auto numDims = cast<RankedTensorType>(lhsType).getRank();
+  DimensionMask inputMask, windowMask, outputMask;
+  if (inputMask.insert(inputBatchDimension, numDims) &&
+      inputMask.insert(inputFeatureDimension, numDims) &&
+      inputMask.insert(inputSpatialDimensions, numDims) &&
+      windowMask.insert(kernelInputFeatureDimension, numDims) &&
+      windowMask.insert(kernelOutputFeatureDimension, numDims) &&
+      windowMask.insert(kernelSpatialDimensions, numDims) &&
+      outputMask.insert(outputBatchDimension, numDims) &&
+      outputMask.insert(outputFeatureDimension, numDims) &&
+      outputMask.insert(outputSpatialDimensions, numDims))
+    return success();
+
   SmallVector<int64_t> inputDimNums(spatialDimNum + 2);
   inputDimNums[0] = inputBatchDimension;
   inputDimNums[1] = inputFeatureDimension;
@@ -1195,7 +1236,6 @@ LogicalResult isSpatialDimensionsValid(
   std::copy(outputSpatialDimensions.begin(), outputSpatialDimensions.end(),
             outputDimNums.begin() + 2);
 
-  auto numDims = cast<RankedTensorType>(lhsType).getRank();
   const auto inRange = [numDims](int64_t i) { return 0 <= i && i < numDims; };
   // convolution_c13, convolution_c18, convolution_c20, dynamic_conv_c13,
   // dynamic_conv_c18, dynamic_conv_c20
@@ -2329,14 +2369,27 @@ LogicalResult inferDotGeneralOp(
                              "lhs and rhs should have the same "
                              "number of contracting dimensions");
 
+  // Valid dimension numbers, which are the common case, are checked in one
+  // pass, and the general checks only run to report errors or for high ranks.
+  auto lhsRankedType = cast<RankedTensorType>(lhsType);
+  auto rhsRankedType = cast<RankedTensorType>(rhsType);
+  DimensionMask lhsMask, rhsMask;
+  bool isMasked =
+      lhsMask.insert(lhsBatchingDimensions, lhsRankedType.getRank()) &&
+      lhsMask.insert(lhsContractingDimensions, lhsRankedType.getRank()) &&
+      rhsMask.insert(rhsBatchingDimensions, rhsRankedType.getRank()) &&
+      rhsMask.insert(rhsContractingDimensions, rhsRankedType.getRank());
+
   // dot_general_c3
-  if (failed(checkDimsDistinct(
+  if (!isMasked &&
+      failed(checkDimsDistinct(
           location, lhsBatchingDimensions, lhsContractingDimensions,
           "lhs_batching_dimensions", "lhs_contracting_dimensions")))
     return failure();
 
   // dot_general_c4
-  if (failed(checkDimsDistinct(
+  if (!isMasked &&
+      failed(checkDimsDistinct(
           location, rhsBatchingDimensions, rhsContractingDimensions,
           "rhs_batching_dimensions", "rhs_contracting_dimensions")))
     return failure();
@@ -2352,22 +2405,24 @@ LogicalResult inferDotGeneralOp(
     return success();
   };
 
-  auto lhsRankedType = cast<RankedTensorType>(lhsType);
   // dot_general_c5
   // dot_general_c6
-  if (failed(checkDimsInRange(lhsRankedType.getRank(), lhsBatchingDimensions,
+  if (!isMasked &&
+      (failed(checkDimsInRange(lhsRankedType.getRank(), lhsBatchingDimensions,
                               "lhs_batching_dimensions")) ||
-      failed(checkDimsInRange(lhsRankedType.getRank(), lhsContractingDimensions,
-                              "lhs_contracting_dimensions")))
+       failed(checkDimsInRange(lhsRankedType.getRank(),
+                               lhsContractingDimensions,
+                               "lhs_contracting_dimensions"))))
     return failure();
 
-  auto rhsRankedType = cast<RankedTensorType>(rhsType);
   // dot_general_c7
   // dot_general_c8
-  if (failed(checkDimsInRange(rhsRankedType.getRank(), rhsBatchingDimensions,
+  if (!isMasked &&
+      (failed(checkDimsInRange(rhsRankedType.getRank(), rhsBatchingDimensions,
                               "rhs_batching_dimensions")) ||
-      failed(checkDimsInRange(rhsRankedType.getRank(), rhsContractingDimensions,
-                              "rhs_contracting_dimensions")))
+       failed(checkDimsInRange(rhsRankedType.getRank(),
+                               rhsContractingDimensions,
+                               "rhs_contracting_dimensions"))))
     return failure();
 
   auto lhsShape = lhsRankedType.getShape();
@@ -2394,15 +2449,20 @@ LogicalResult inferDotGeneralOp(
 
   // Infer the output dimensions of the operation.
   SmallVector<int64_t> dimensions;
+  dimensions.reserve(lhsRankedType.getRank() + rhsRankedType.getRank());
   for (const int64_t lhsBatchingDim : lhsBatchingDimensions)
     dimensions.push_back(lhsShape[lhsBatchingDim]);
+  auto isFreeDim = [&](const DimensionMask& mask, ArrayRef<int64_t> batching,
+                       ArrayRef<int64_t> contracting, int64_t i) {
+    if (isMasked) return !mask.contains(i);
+    return !llvm::is_contained(batching, i) &&
+           !llvm::is_contained(contracting, i);
+  };
   for (int64_t i = 0; i < lhsRankedType.getRank(); i++)
-    if (!llvm::is_contained(lhsBatchingDimensions, i) &&
-        !llvm::is_contained(lhsContractingDimensions, i))
+    if (isFreeDim(lhsMask, lhsBatchingDimensions, lhsContractingDimensions, i))
       dimensions.push_back(lhsShape[i]);
   for (int64_t i = 0; i < rhsRankedType.getRank(); i++)
-    if (!llvm::is_contained(rhsBatchingDimensions, i) &&
-        !llvm::is_contained(rhsContractingDimensions, i))
+    if (isFreeDim(rhsMask, rhsBatchingDimensions, rhsContractingDimensions, i))
       dimensions.push_back(rhsShape[i]);
 
   // dot_general_c12
@@ -43,6 +43,12 @@ class Version {
   /// Return a Version representing the minimum supported VHLO dialect version.
   static Version getMinimumVersion() { return Version(0, 9, 0); }
 
+  /// Return the minimum VHLO dialect version whose readers decode compressed
+  /// tensors. Older readers reject them as unknown attributes.
+  static Version getMinimumCompressedTensorVersion() {
+    return Version(1, 1, 0);
+  }
+
   /// Return the MLIR Bytecode Format associated with the version instance.
   /// Returns failure if version is not in compatibility window.
   FailureOr<int64_t> getBytecodeVersion() const;
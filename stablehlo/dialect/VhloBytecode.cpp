@@ -15,15 +15,23 @@ limitations under the License.
 
 #include "stablehlo/dialect/VhloBytecode.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <memory>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/TypeSwitch.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "mlir/Bytecode/BytecodeImplementation.h"
 #include "mlir/Dialect/Shape/IR/Shape.h"
 #include "mlir/IR/Attributes.h"
@@ -31,6 +39,7 @@ limitations under the License.
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/OpImplementation.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Support/LogicalResult.h"
 #include "stablehlo/dialect/Base.h"  // for readEnumAttribute
 #include "stablehlo/dialect/VhloOps.h"
@@ -68,6 +77,12 @@ limitations under the License.
 namespace {
 namespace vhlo_encoding {
 
+/// Attributes and types are written once to the tables of MLIR bytecode and
+/// referenced by index from ops and from other attributes, so repeated
+/// attributes like dimension numbers are already deduplicated (see
+/// docs/bytecode.md). Writers must refer to nested attributes and types with
+/// `writeAttribute` and `writeType` to preserve this.
+///
 /// This enum contains marker codes used to indicate which attribute is
 /// currently being decoded, and how it should be decoded. The order of these
 /// codes must not be changed, as any changes will break compatibility
@@ -175,6 +190,25 @@ enum AttributeCode {
   ///     bounds : svarint[]
   ///   }
   kTypeExtensionsV1Attr = 18,
+
+  ///   CompressedTensorV1Attr {
+  ///     type: Type
+  ///     format: varint (encoded CompressionFormat)
+  ///     size: varint
+  ///     chunkSize: varint
+  ///     chunks: blob[]
+  ///   }
+  /// A TensorV1Attr of `size` bytes, compressed in chunks of `chunkSize`
+  /// bytes which are decompressed independently. Only written when opted into
+  /// through VhloBytecodeWriterOptions, and read as a TensorV1Attr.
+  kCompressedTensorV1Attr = 19,
+};
+
+/// This enum contains the formats of CompressedTensorV1Attr. The order of
+/// these codes must not be changed either.
+enum CompressionFormat {
+  kZlib = 0,
+  kZstd = 1,
 };
 
 /// This enum contains marker codes used to indicate which type is
@@ -372,6 +406,7 @@ class VhloBytecodeInterface : public BytecodeDialectInterface {
       DialectBytecodeReader &reader) const;
   CustomCallApiVersionV1Attr readCustomCallApiVersionV1Attr(
       DialectBytecodeReader &reader) const;
+  TensorV1Attr readCompressedTensorV1Attr(DialectBytecodeReader &reader) const;
   DictionaryV1Attr readDictionaryV1Attr(DialectBytecodeReader &reader) const;
   FftTypeV1Attr readFftTypeV1Attr(DialectBytecodeReader &reader) const;
   FloatV1Attr readFloatV1Attr(DialectBytecodeReader &reader) const;
@@ -410,6 +445,8 @@ class VhloBytecodeInterface : public BytecodeDialectInterface {
   void write(RngDistributionV1Attr attr, DialectBytecodeWriter &writer) const;
   void write(StringV1Attr attr, DialectBytecodeWriter &writer) const;
   void write(TensorV1Attr attr, DialectBytecodeWriter &writer) const;
+  LogicalResult writeCompressed(TensorV1Attr attr,
+                                DialectBytecodeWriter &writer) const;
   void write(TransposeV1Attr attr, DialectBytecodeWriter &writer) const;
   void write(TypeV1Attr attr, DialectBytecodeWriter &writer) const;
   void write(TypeExtensionsV1Attr attr, DialectBytecodeWriter &writer) const;
@@ -497,6 +534,8 @@ Attribute VhloBytecodeInterface::readAttribute(
       return readTypeV1Attr(reader);
     case vhlo_encoding::kTypeExtensionsV1Attr:
       return readTypeExtensionsV1Attr(reader);
+    case vhlo_encoding::kCompressedTensorV1Attr:
+      return readCompressedTensorV1Attr(reader);
     default:
       reader.emitError() << "unknown vhlo attribute code: " << code;
       return Attribute();
@@ -863,11 +902,134 @@ TensorV1Attr VhloBytecodeInterface::readTensorV1Attr(
 
 void VhloBytecodeInterface::write(TensorV1Attr attr,
                                   DialectBytecodeWriter &writer) const {
+  if (succeeded(writeCompressed(attr, writer))) return;
   writer.writeVarInt(vhlo_encoding::kTensorV1Attr);
   writer.writeType(attr.getType());
   writer.writeOwnedBlob(attr.getData());
 }
 
+//===----------------------------------------------------------------------===//
+// CompressedTensorV1Attr
+//===----------------------------------------------------------------------===//
+
+// Decompresses the chunks in parallel into a buffer of their own. Tensors of
+// retained artifacts keep referencing rather than copying their data, so that
+// large constants still become resources, and since MLIR bytecode reads
+// attributes when they are first used, lazily loaded functions only decompress
+// their constants when they are materialized.
+TensorV1Attr VhloBytecodeInterface::readCompressedTensorV1Attr(
+    DialectBytecodeReader &reader) const {
+  LOG_READ_CALL;
+  Type type;
+  uint64_t format, size, chunkSize;
+  if (failed(reader.readType(type)) || failed(reader.readVarInt(format)) ||
+      failed(reader.readVarInt(size)) || failed(reader.readVarInt(chunkSize)))
+    return TensorV1Attr();
+  if (format != vhlo_encoding::kZlib && format != vhlo_encoding::kZstd) {
+    reader.emitError() << "unknown vhlo compression format: " << format;
+    return TensorV1Attr();
+  }
+  bool isZstd = format == vhlo_encoding::kZstd;
+  if (isZstd ? !llvm::compression::zstd::isAvailable()
+             : !llvm::compression::zlib::isAvailable()) {
+    reader.emitError() << "vhlo tensor is compressed with "
+                       << (isZstd ? "zstd" : "zlib")
+                       << ", which is not available";
+    return TensorV1Attr();
+  }
+  if (size != 0 && chunkSize == 0) {
+    reader.emitError() << "invalid vhlo compressed tensor chunk size";
+    return TensorV1Attr();
+  }
+  SmallVector<ArrayRef<char>> chunks;
+  for (uint64_t offset = 0; offset < size; offset += chunkSize)
+    if (failed(reader.readBlob(chunks.emplace_back())))
+      return TensorV1Attr();
+  if (chunks.empty())
+    return TensorV1Attr::get(getContext(), type, ArrayRef<char>());
+
+  auto buffer = llvm::WritableMemoryBuffer::getNewUninitMemBuffer(size);
+  if (!buffer) {
+    reader.emitError() << "failed to allocate " << size
+                       << " bytes for vhlo compressed tensor";
+    return TensorV1Attr();
+  }
+  auto *output = reinterpret_cast<uint8_t *>(buffer->getBufferStart());
+  std::atomic<bool> hasFailed = false;
+  parallelFor(getContext(), 0, chunks.size(), [&](size_t i) {
+    ArrayRef<uint8_t> chunk(reinterpret_cast<const uint8_t *>(chunks[i].data()),
+                            chunks[i].size());
+    size_t chunkBytes = std::min<uint64_t>(chunkSize, size - i * chunkSize);
+    size_t decompressedBytes = chunkBytes;
+    llvm::Error error =
+        isZstd ? llvm::compression::zstd::decompress(
+                     chunk, output + i * chunkSize, decompressedBytes)
+               : llvm::compression::zlib::decompress(
+                     chunk, output + i * chunkSize, decompressedBytes);
+    if (error || decompressedBytes != chunkBytes) hasFailed = true;
+    llvm::consumeError(std::move(error));
+  });
+  if (hasFailed) {
+    reader.emitError() << "failed to decompress vhlo tensor";
+    return TensorV1Attr();
+  }
+
+  ArrayRef<char> data(buffer->getBufferStart(), size);
+  auto *dialect = cast<VhloDialect>(getDialect());
+  if (auto minResourceSize =
+          dialect->getRetainedArtifactResourceSize(chunks.front()))
+    dialect->retainArtifact(std::move(buffer), *minResourceSize);
+  return TensorV1Attr::get(getContext(), type, data);
+}
+
+// Writes `attr` as a CompressedTensorV1Attr if the write opted into it through
+// VhloBytecodeWriterOptions and compression makes it smaller. Returns failure
+// without writing anything otherwise.
+LogicalResult VhloBytecodeInterface::writeCompressed(
+    TensorV1Attr attr, DialectBytecodeWriter &writer) const {
+  auto version = writer.getDialectVersion(VhloDialect::getDialectNamespace());
+  if (failed(version)) return failure();
+  const auto *options =
+      static_cast<const VhloBytecodeWriterOptions *>(*version);
+  ArrayRef<char> data = attr.getData();
+  if (data.empty() || options->getChunkSize() <= 0 ||
+      static_cast<int64_t>(data.size()) < options->getMinCompressedSize())
+    return failure();
+
+  // Zstd decompresses faster than zlib at a similar ratio, and zlib is the
+  // fallback of LLVM builds without zstd.
+  bool isZstd = llvm::compression::zstd::isAvailable();
+  if (!isZstd && !llvm::compression::zlib::isAvailable()) return failure();
+
+  uint64_t chunkSize = options->getChunkSize();
+  SmallVector<SmallVector<uint8_t>> chunks(
+      llvm::divideCeil(data.size(), chunkSize));
+  parallelFor(getContext(), 0, chunks.size(), [&](size_t i) {
+    ArrayRef<uint8_t> chunk(
+        reinterpret_cast<const uint8_t *>(data.data()) + i * chunkSize,
+        std::min<uint64_t>(chunkSize, data.size() - i * chunkSize));
+    if (isZstd)
+      llvm::compression::zstd::compress(chunk, chunks[i]);
+    else
+      llvm::compression::zlib::compress(chunk, chunks[i]);
+  });
+  SmallVector<char> compressed;
+  for (auto &chunk : chunks) compressed.append(chunk.begin(), chunk.end());
+  if (compressed.size() >= data.size()) return failure();
+
+  ArrayRef<char> blobs = options->retain(std::move(compressed));
+  writer.writeVarInt(vhlo_encoding::kCompressedTensorV1Attr);
+  writer.writeType(attr.getType());
+  writer.writeVarInt(isZstd ? vhlo_encoding::kZstd : vhlo_encoding::kZlib);
+  writer.writeVarInt(data.size());
+  writer.writeVarInt(chunkSize);
+  for (auto &chunk : chunks) {
+    writer.writeOwnedBlob(blobs.take_front(chunk.size()));
+    blobs = blobs.drop_front(chunk.size());
+  }
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // TransposeV1Attr
 //===----------------------------------------------------------------------===//
@@ -15,6 +15,13 @@ limitations under the License.
 #ifndef STABLEHLO_DIALECT_VHLO_BYTECODE_H
 #define STABLEHLO_DIALECT_VHLO_BYTECODE_H
 
+#include <cstdint>
+#include <memory>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Bytecode/BytecodeImplementation.h"
+
 namespace mlir {
 namespace vhlo {
 class VhloDialect;
@@ -22,6 +29,35 @@ class VhloDialect;
 // Add the interface necessary for encoding and decoding VHLO dialect
 // components in bytecode.
 void addBytecodeInterface(VhloDialect *dialect);
+
+// Options of a single bytecode write of VHLO, which are passed to the VHLO
+// bytecode interface as the VHLO dialect version of the BytecodeWriterConfig,
+// the only state of a write which dialects can access.
+class VhloBytecodeWriterOptions : public DialectVersion {
+ public:
+  // Tensors of at least `minCompressedSize` bytes are compressed in chunks of
+  // `chunkSize` bytes, which readers decompress in parallel.
+  explicit VhloBytecodeWriterOptions(int64_t minCompressedSize,
+                                     int64_t chunkSize = 1 << 20)
+      : minCompressedSize(minCompressedSize), chunkSize(chunkSize) {}
+
+  int64_t getMinCompressedSize() const { return minCompressedSize; }
+  int64_t getChunkSize() const { return chunkSize; }
+
+  // Keeps `data` alive until the end of the write, since bytecode writers
+  // reference blobs rather than copying them.
+  ArrayRef<char> retain(SmallVector<char> data) const {
+    retainedData.push_back(
+        std::make_unique<SmallVector<char>>(std::move(data)));
+    return *retainedData.back();
+  }
+
+ private:
+  int64_t minCompressedSize;
+  int64_t chunkSize;
+  mutable SmallVector<std::unique_ptr<SmallVector<char>>> retainedData;
+};
+
 }  // namespace vhlo
 }  // namespace mlir
 
@@ -17,6 +17,10 @@ limitations under the License.
 #include "stablehlo/dialect/VhloOps.h"
 
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
@@ -195,8 +199,7 @@ Attribute TensorV1Attr::parse(AsmParser& parser, mlir::Type) {
     return TensorV1Attr();
   }
   return TensorV1Attr::get(parser.getContext(),
-                           convertTypeToVhloForParse(attr.getType()),
-                           attr.getRawData());
+                           convertTypeToVhloForParse(attr.getType()), attr);
 }
 
 void printEscapedString(AsmPrinter& p, llvm::StringRef value) {
@@ -242,6 +245,23 @@ VhloDialect::VhloDialect(MLIRContext* context)
       >();
 }
 
+void VhloDialect::retainArtifact(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                                 int64_t minResourceSize) {
+  std::lock_guard<std::mutex> lock(retainedArtifactsMutex);
+  retainedArtifacts.emplace_back(std::move(buffer), minResourceSize);
+}
+
+std::optional<int64_t> VhloDialect::getRetainedArtifactResourceSize(
+    ArrayRef<char> data) const {
+  std::lock_guard<std::mutex> lock(retainedArtifactsMutex);
+  for (auto& [buffer, minResourceSize] : retainedArtifacts) {
+    if (data.begin() >= buffer->getBufferStart() &&
+        data.end() <= buffer->getBufferEnd())
+      return minResourceSize;
+  }
+  return std::nullopt;
+}
+
 void VhloDialect::addVhloTypes() {
   // Idiomatically, this functionality is expressed as shown below:
   //
@@ -17,7 +17,16 @@ limitations under the License.
 #ifndef STABLEHLO_DIALECT_VHLO_OPS_H
 #define STABLEHLO_DIALECT_VHLO_OPS_H
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/DialectImplementation.h"
 #include "mlir/IR/Location.h"
@@ -46,6 +55,19 @@ class VhloDialect : public Dialect {
   // Prints an attribute registered to this dialect.
   void printAttribute(Attribute attr, DialectAsmPrinter &os) const override;
 
+  // Keeps the portable artifact `buffer`, e.g. a file mapped into memory,
+  // alive as long as the context, so that tensor attributes read from it
+  // reference its data rather than copying it. Tensors of at least
+  // `minResourceSize` bytes from `buffer` are legalized to StableHLO as
+  // DenseResourceElementsAttr, which also references its data.
+  void retainArtifact(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                      int64_t minResourceSize);
+
+  // Returns the `minResourceSize` of the retained artifact which contains
+  // `data`, or nullopt if `data` isn't part of a retained artifact.
+  std::optional<int64_t> getRetainedArtifactResourceSize(
+      ArrayRef<char> data) const;
+
  private:
   // Adds VHLO types to this dialect.
   // See implementation comments for additional details.
@@ -57,6 +79,11 @@ class VhloDialect : public Dialect {
   void addTypesWithoutRegistering() {
     (addType(Types::getTypeID(), AbstractType::get<Types>(*this)), ...);
   }
+
+  // Guards `retainedArtifacts`.
+  mutable std::mutex retainedArtifactsMutex;
+  SmallVector<std::pair<std::unique_ptr<llvm::MemoryBuffer>, int64_t>>
+      retainedArtifacts;
 };
 
 }  // namespace vhlo
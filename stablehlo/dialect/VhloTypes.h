@@ -16,7 +16,10 @@ limitations under the License.
 #ifndef STABLEHLO_DIALECT_VHLOTYPES_H
 #define STABLEHLO_DIALECT_VHLOTYPES_H
 
+#include <mutex>
+
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/MLIRContext.h"
@@ -34,6 +37,32 @@ class VhloTypeConverterBase : public TypeConverter {
   virtual ~VhloTypeConverterBase() = default;
 
   virtual Attribute convertEncoding(Attribute attr) const = 0;
+
+  // Returns the conversion of `attr` recorded by `cacheAttribute`, or null.
+  // Legalizations look attributes up here before converting them, so that
+  // attributes which are used by many ops, e.g. dimension numbers or large
+  // constants, are only converted once.
+  Attribute lookupAttribute(Attribute attr) const {
+    std::lock_guard<std::mutex> lock(attributeCacheMutex);
+    return attributeCache.lookup(attr);
+  }
+
+  // Records that `attr` converts to `convertedAttr`.
+  void cacheAttribute(Attribute attr, Attribute convertedAttr) const {
+    std::lock_guard<std::mutex> lock(attributeCacheMutex);
+    attributeCache[attr] = convertedAttr;
+  }
+
+  // Forgets all conversions, which must be done before converting attributes
+  // of another context.
+  void clearAttributeCache() {
+    std::lock_guard<std::mutex> lock(attributeCacheMutex);
+    attributeCache.clear();
+  }
+
+ private:
+  mutable std::mutex attributeCacheMutex;
+  mutable llvm::DenseMap<Attribute, Attribute> attributeCache;
 };
 
 // This class is used to manage conversions between VHLO and Builtin
@@ -0,0 +1,154 @@
+/* Copyright 2024 The StableHLO Authors.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/integrations/c/StablehloInterpreter.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/CAPI/IR.h"
+#include "mlir/CAPI/Support.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Location.h"
+#include "stablehlo/reference/Api.h"
+#include "stablehlo/reference/Configuration.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Value.h"
+
+namespace {
+
+struct Executable {
+  mlir::ModuleOp module;
+  mlir::stablehlo::InterpreterConfiguration config;
+  std::unique_ptr<mlir::stablehlo::InterpreterExecutable> executable;
+};
+
+struct Results {
+  llvm::SmallVector<mlir::stablehlo::InterpreterValue> values;
+};
+
+Executable *unwrap(StablehloInterpreterExecutable executable) {
+  return static_cast<Executable *>(executable.ptr);
+}
+
+Results *unwrap(StablehloInterpreterResults results) {
+  return static_cast<Results *>(results.ptr);
+}
+
+// Returns the size in bytes of elements of `elementType` in interpreter
+// storage, or 0 if they aren't stored in whole bytes.
+int64_t getElementSize(mlir::Type elementType) {
+  if (elementType.isInteger(1)) return 1;
+  if (auto complexType = llvm::dyn_cast<mlir::ComplexType>(elementType))
+    return 2 * getElementSize(complexType.getElementType());
+  if (!elementType.isIntOrFloat()) return 0;
+  unsigned width = elementType.getIntOrFloatBitWidth();
+  return width % 8 == 0 ? width / 8 : 0;
+}
+
+// Wraps the storage of `buffer` in a tensor without copying it, unless it's
+// misaligned, like `makeTensor` in the Python bindings.
+mlir::FailureOr<mlir::stablehlo::Tensor> makeTensor(
+    mlir::MLIRContext *context, const StablehloInterpreterBuffer &buffer) {
+  auto elementType = unwrap(buffer.elementType);
+  int64_t elementSize = getElementSize(elementType);
+  if (!elementSize) {
+    mlir::emitError(mlir::UnknownLoc::get(context))
+        << "unsupported buffer element type: " << elementType;
+    return mlir::failure();
+  }
+
+  auto type = mlir::RankedTensorType::get(
+      llvm::ArrayRef(buffer.shape, buffer.rank), elementType);
+  if (type.getNumElements() == 0) return mlir::stablehlo::Tensor(type);
+
+  llvm::ArrayRef<char> storage(static_cast<const char *>(buffer.data),
+                               type.getNumElements() * elementSize);
+  size_t alignment = llvm::isa<mlir::ComplexType>(elementType)
+                         ? elementSize / 2
+                         : elementSize;
+  if (reinterpret_cast<uintptr_t>(buffer.data) % alignment != 0) {
+    return mlir::stablehlo::Tensor(
+        type, mlir::HeapAsmResourceBlob::allocateAndCopyWithAlign(storage,
+                                                                  alignment));
+  }
+  return mlir::stablehlo::Tensor(
+      type, mlir::AsmResourceBlob(storage, alignment, /*deleter=*/nullptr,
+                                  /*dataIsMutable=*/false));
+}
+
+}  // namespace
+
+StablehloInterpreterExecutable stablehloInterpreterExecutableCreate(
+    MlirModule module, MlirStringRef mainFunction) {
+  auto executable = std::make_unique<Executable>();
+  executable->module = unwrap(module);
+  executable->config.mainFunction = unwrap(mainFunction).str();
+  auto created = mlir::stablehlo::InterpreterExecutable::create(
+      executable->module, executable->config);
+  if (mlir::failed(created)) return {nullptr};
+  executable->executable = std::move(*created);
+  return {executable.release()};
+}
+
+void stablehloInterpreterExecutableDestroy(
+    StablehloInterpreterExecutable executable) {
+  delete unwrap(executable);
+}
+
+StablehloInterpreterResults stablehloInterpreterExecutableEvaluate(
+    StablehloInterpreterExecutable executable, intptr_t numInputs,
+    const StablehloInterpreterBuffer *inputs) {
+  auto *context = unwrap(executable)->module.getContext();
+  llvm::SmallVector<mlir::stablehlo::InterpreterValue> values;
+  for (const auto &input : llvm::ArrayRef(inputs, numInputs)) {
+    auto tensor = makeTensor(context, input);
+    if (mlir::failed(tensor)) return {nullptr};
+    values.emplace_back(*tensor);
+  }
+
+  auto results = unwrap(executable)->executable->evaluate(values);
+  if (mlir::failed(results)) return {nullptr};
+  return {new Results{std::move(*results)}};
+}
+
+intptr_t stablehloInterpreterResultsGetNumResults(
+    StablehloInterpreterResults results) {
+  return unwrap(results)->values.size();
+}
+
+bool stablehloInterpreterResultsGetBuffer(StablehloInterpreterResults results,
+                                          intptr_t pos,
+                                          StablehloInterpreterBuffer *buffer) {
+  const auto &value = unwrap(results)->values[pos];
+  if (!value.isTensor()) return false;
+
+  // The shape is uniqued in the context, and strided views are copied into
+  // canonical order on first access, once for the lifetime of the results.
+  auto tensor = value.getTensor();
+  auto shape = tensor.getType().getShape();
+  buffer->data = tensor.getData();
+  buffer->shape = shape.data();
+  buffer->rank = shape.size();
+  buffer->elementType = wrap(tensor.getElementType());
+  return true;
+}
+
+void stablehloInterpreterResultsDestroy(StablehloInterpreterResults results) {
+  delete unwrap(results);
+}
@@ -0,0 +1,102 @@
+/* Copyright 2024 The StableHLO Authors.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_INTEGRATIONS_C_STABLEHLO_INTERPRETER_H
+#define STABLEHLO_INTEGRATIONS_C_STABLEHLO_INTERPRETER_H
+
+#include <stdint.h>
+
+#include "mlir-c/IR.h"
+#include "mlir-c/Support.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A module prepared for repeated evaluation by the reference interpreter, see
+// `mlir::stablehlo::InterpreterExecutable`.
+typedef struct StablehloInterpreterExecutable {
+  void *ptr;
+} StablehloInterpreterExecutable;
+
+// The results of an evaluation, which own the storage of their buffers.
+typedef struct StablehloInterpreterResults {
+  void *ptr;
+} StablehloInterpreterResults;
+
+// A dense buffer of `rank` dimensions of sizes `shape`, whose elements of
+// type `elementType` are laid out contiguously in row-major order at `data`.
+// Booleans take one byte per element, and complex numbers are pairs of their
+// real and imaginary parts.
+typedef struct StablehloInterpreterBuffer {
+  const void *data;
+  const int64_t *shape;
+  intptr_t rank;
+  MlirType elementType;
+} StablehloInterpreterBuffer;
+
+// Prepares the function `mainFunction` of `module` for evaluation. `module`
+// must outlive the executable and must not be modified while it's alive.
+// Returns a null executable and emits an error on the context of `module` if
+// it has no such function.
+MLIR_CAPI_EXPORTED StablehloInterpreterExecutable
+stablehloInterpreterExecutableCreate(MlirModule module,
+                                     MlirStringRef mainFunction);
+
+// Destroys `executable`. Results of its evaluations remain valid.
+MLIR_CAPI_EXPORTED void stablehloInterpreterExecutableDestroy(
+    StablehloInterpreterExecutable executable);
+
+// Returns whether `executable` is null, i.e. failed to be created.
+static inline bool stablehloInterpreterExecutableIsNull(
+    StablehloInterpreterExecutable executable) {
+  return !executable.ptr;
+}
+
+// Evaluates `executable` with `numInputs` buffers. The storage of the inputs
+// is used in place rather than copied, unless it isn't aligned to the size of
+// their elements, so inputs must not be modified while they're evaluated.
+// Results may share the storage of inputs, which must then outlive the
+// results. Can be called concurrently from multiple threads. Returns null
+// results and emits an error on the context of the module if the evaluation
+// fails.
+MLIR_CAPI_EXPORTED StablehloInterpreterResults
+stablehloInterpreterExecutableEvaluate(
+    StablehloInterpreterExecutable executable, intptr_t numInputs,
+    const StablehloInterpreterBuffer *inputs);
+
+// Returns whether `results` is null, i.e. the evaluation failed.
+static inline bool stablehloInterpreterResultsIsNull(
+    StablehloInterpreterResults results) {
+  return !results.ptr;
+}
+
+// Returns the number of results.
+MLIR_CAPI_EXPORTED intptr_t
+stablehloInterpreterResultsGetNumResults(StablehloInterpreterResults results);
+
+// Sets `buffer` to a view of the result at `pos`, which borrows the storage
+// of `results` and stays valid until they are destroyed. Returns false if the
+// result is not a tensor, e.g. a token or a tuple.
+MLIR_CAPI_EXPORTED bool stablehloInterpreterResultsGetBuffer(
+    StablehloInterpreterResults results, intptr_t pos,
+    StablehloInterpreterBuffer *buffer);
+
+// Destroys `results` and releases their storage.
+MLIR_CAPI_EXPORTED void stablehloInterpreterResultsDestroy(
+    StablehloInterpreterResults results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STABLEHLO_INTEGRATIONS_C_STABLEHLO_INTERPRETER_H
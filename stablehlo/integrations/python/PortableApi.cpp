@@ -15,14 +15,98 @@ limitations under the License.
 
 #include "stablehlo/integrations/python/PortableApi.h"
 
+#include <memory>
 #include <string>
+#include <system_error>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
 #include "stablehlo/api/PortableApi.h"
 
 namespace py = pybind11;
 
 namespace mlir {
 namespace stablehlo {
+namespace {
+
+// A view of the contents of a `str`, or of an object supporting the buffer
+// protocol, which stays valid while the view is alive, even without the GIL.
+class ContentsView {
+ public:
+  explicit ContentsView(py::handle obj) {
+    if (py::isinstance<py::str>(obj)) {
+      // The UTF-8 representation is cached by the `str` object itself.
+      str_ = py::reinterpret_borrow<py::str>(obj);
+      Py_ssize_t size;
+      const char* data = PyUnicode_AsUTF8AndSize(str_.ptr(), &size);
+      if (!data) throw py::error_already_set();
+      contents_ = StringRef(data, size);
+      return;
+    }
+    if (PyObject_GetBuffer(obj.ptr(), &buffer_, PyBUF_SIMPLE) != 0)
+      throw py::error_already_set();
+    hasBuffer_ = true;
+    contents_ = StringRef(static_cast<const char*>(buffer_.buf), buffer_.len);
+  }
+  ~ContentsView() {
+    if (hasBuffer_) PyBuffer_Release(&buffer_);
+  }
+  ContentsView(const ContentsView&) = delete;
+  ContentsView& operator=(const ContentsView&) = delete;
+
+  StringRef str() const { return contents_; }
+
+ private:
+  py::object str_;
+  Py_buffer buffer_;
+  bool hasBuffer_ = false;
+  StringRef contents_;
+};
+
+// Reads `inputPath`, converts its contents with `convert` and writes the
+// result to `outputPath`. Returns an error message on failure, and doesn't need
+// the GIL.
+template <typename ConvertFn>
+std::string convertFile(const std::string& inputPath,
+                        const std::string& outputPath, ConvertFn convert) {
+  auto input = llvm::MemoryBuffer::getFile(inputPath, /*IsText=*/false,
+                                           /*RequiresNullTerminator=*/false);
+  std::string error;
+  if (!input) {
+    error = "failed to read " + inputPath + ": " + input.getError().message();
+  } else {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(outputPath, ec);
+    if (ec)
+      error = "failed to open " + outputPath + ": " + ec.message();
+    else if (failed(convert((*input)->getBuffer(), os)))
+      error = "failed to convert " + inputPath;
+  }
+  return error;
+}
+
+// Returns `outputs` as `bytes`, or raises a ValueError with `message` and the
+// index of the first failed output.
+std::vector<py::bytes> toBytes(ArrayRef<FailureOr<std::string>> outputs,
+                               StringRef message) {
+  std::vector<py::bytes> results;
+  for (auto [index, output] : llvm::enumerate(outputs)) {
+    if (failed(output))
+      throw py::value_error((message + " at index " + Twine(index)).str());
+    results.push_back(py::bytes(*output));
+  }
+  return results;
+}
+
+}  // namespace
 
 void AddPortableApi(py::module& m) {
   //
@@ -39,33 +123,149 @@ void AddPortableApi(py::module& m) {
 
   m.def("get_minimum_version", []() { return getMinimumVersion(); });
 
+  // Modules and artifacts can be passed as `str` or `bytes`, or without being
+  // copied as any object supporting the buffer protocol, e.g. `memoryview`.
+  // Conversions release the GIL, and each one uses a context of its own, so
+  // they can run concurrently from Python threads.
+  auto serialize = [](StringRef moduleStr,
+                      StringRef targetVersion) -> py::bytes {
+    std::string buffer;
+    llvm::raw_string_ostream os(buffer);
+    LogicalResult result = failure();
+    {
+      py::gil_scoped_release release;
+      result = serializePortableArtifact(moduleStr, targetVersion, os);
+    }
+    if (failed(result)) {
+      PyErr_SetString(PyExc_ValueError, "failed to serialize module");
+      return "";
+    }
+
+    return py::bytes(buffer);
+  };
+
+  auto deserialize = [](StringRef artifactStr) -> py::bytes {
+    std::string buffer;
+    llvm::raw_string_ostream os(buffer);
+    LogicalResult result = failure();
+    {
+      py::gil_scoped_release release;
+      result = deserializePortableArtifact(artifactStr, os);
+    }
+    if (failed(result)) {
+      PyErr_SetString(PyExc_ValueError, "failed to deserialize module");
+      return "";
+    }
+
+    return py::bytes(buffer);
+  };
+
   m.def(
       "serialize_portable_artifact",
-      [](std::string moduleStr, std::string targetVersion) -> py::bytes {
-        std::string buffer;
-        llvm::raw_string_ostream os(buffer);
-        if (failed(serializePortableArtifact(moduleStr, targetVersion, os))) {
-          PyErr_SetString(PyExc_ValueError, "failed to serialize module");
-          return "";
-        }
+      [=](std::string moduleStr, std::string targetVersion) -> py::bytes {
+        return serialize(moduleStr, targetVersion);
+      },
+      py::arg("module_str"), py::arg("target_version"));
 
-        return py::bytes(buffer);
+  m.def(
+      "serialize_portable_artifact",
+      [=](py::buffer module, std::string targetVersion) -> py::bytes {
+        ContentsView moduleView(module);
+        return serialize(moduleView.str(), targetVersion);
       },
       py::arg("module_str"), py::arg("target_version"));
 
   m.def(
       "deserialize_portable_artifact",
-      [](std::string artifactStr) -> py::bytes {
-        std::string buffer;
-        llvm::raw_string_ostream os(buffer);
-        if (failed(deserializePortableArtifact(artifactStr, os))) {
-          PyErr_SetString(PyExc_ValueError, "failed to deserialize module");
-          return "";
-        }
+      [=](std::string artifactStr) -> py::bytes {
+        return deserialize(artifactStr);
+      },
+      py::arg("artifact_str"));
 
-        return py::bytes(buffer);
+  m.def(
+      "deserialize_portable_artifact",
+      [=](py::buffer artifact) -> py::bytes {
+        ContentsView artifactView(artifact);
+        return deserialize(artifactView.str());
       },
       py::arg("artifact_str"));
+
+  m.def(
+      "serialize_portable_artifact_file",
+      [](std::string modulePath, std::string artifactPath,
+         std::string targetVersion) {
+        std::string error;
+        {
+          py::gil_scoped_release release;
+          error = convertFile(modulePath, artifactPath,
+                              [&](StringRef module, raw_ostream& os) {
+                                return serializePortableArtifact(
+                                    module, targetVersion, os);
+                              });
+        }
+        if (!error.empty()) throw py::value_error(error);
+      },
+      py::arg("module_path"), py::arg("artifact_path"),
+      py::arg("target_version"));
+
+  m.def(
+      "deserialize_portable_artifact_file",
+      [](std::string artifactPath, std::string modulePath) {
+        std::string error;
+        {
+          py::gil_scoped_release release;
+          error = convertFile(artifactPath, modulePath,
+                              [&](StringRef artifact, raw_ostream& os) {
+                                return deserializePortableArtifact(artifact,
+                                                                   os);
+                              });
+        }
+        if (!error.empty()) throw py::value_error(error);
+      },
+      py::arg("artifact_path"), py::arg("module_path"));
+
+  // Batched conversions run on `num_threads` threads, or one per hardware
+  // thread if 0, and raise a ValueError naming the first input which failed.
+  m.def(
+      "serialize_portable_artifacts",
+      [](py::list modules, std::string targetVersion,
+         unsigned numThreads) -> std::vector<py::bytes> {
+        std::vector<std::unique_ptr<ContentsView>> views;
+        SmallVector<StringRef> moduleStrs;
+        for (py::handle module : modules)
+          moduleStrs.push_back(
+              views.emplace_back(std::make_unique<ContentsView>(module))
+                  ->str());
+
+        SmallVector<FailureOr<std::string>> artifacts;
+        {
+          py::gil_scoped_release release;
+          artifacts =
+              serializePortableArtifacts(moduleStrs, targetVersion, numThreads);
+        }
+        return toBytes(artifacts, "failed to serialize module");
+      },
+      py::arg("module_strs"), py::arg("target_version"),
+      py::arg("num_threads") = 0);
+
+  m.def(
+      "deserialize_portable_artifacts",
+      [](py::list artifacts, unsigned numThreads) -> std::vector<py::bytes> {
+        std::vector<std::unique_ptr<ContentsView>> views;
+        SmallVector<StringRef> artifactStrs;
+        for (py::handle artifact : artifacts)
+          artifactStrs.push_back(
+              views.emplace_back(std::make_unique<ContentsView>(artifact))
+                  ->str());
+
+        SmallVector<FailureOr<std::string>> modules;
+        {
+          py::gil_scoped_release release;
+          modules = deserializePortableArtifacts(artifactStrs, numThreads);
+        }
+        return toBytes(modules, "failed to deserialize module");
+      },
+      py::arg("artifact_strs"), py::arg("num_threads") = 0);
 }
 
 }  // namespace stablehlo
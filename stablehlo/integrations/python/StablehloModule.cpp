@@ -11,18 +11,45 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/bit.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "mlir-c/IR.h"
 #include "mlir/Bindings/Python/PybindAdaptors.h"
 #include "mlir/CAPI/IR.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/Builders.h"
 #include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/DialectRegistry.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/LogicalResult.h"
 #include "stablehlo/dialect/Serialization.h"
 #include "stablehlo/integrations/c/StablehloAttributes.h"
 #include "stablehlo/integrations/c/StablehloDialect.h"
 #include "stablehlo/integrations/c/StablehloTypes.h"
 #include "stablehlo/integrations/python/PortableApi.h"
 #include "stablehlo/reference/Api.h"
+#include "stablehlo/reference/Configuration.h"
+#include "stablehlo/reference/InterpreterOps.h"
+#include "stablehlo/reference/Ops.h"
+#include "stablehlo/reference/ProcessGrid.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Value.h"
+#include "stablehlo/transforms/Passes.h"
+#include "stablehlo/transforms/SpecializationCache.h"
 
 namespace py = pybind11;
 
@@ -45,6 +72,227 @@ auto toPyString(MlirStringRef mlirStringRef) {
   return py::str(mlirStringRef.data, mlirStringRef.length);
 }
 
+// Returns the element type of tensors with the storage of `info`, or a null
+// type if it has no StableHLO counterpart. Signed integers map to signless
+// integers, like in the interpreter.
+mlir::Type getElementType(mlir::MLIRContext *context,
+                          const py::buffer_info &info) {
+  mlir::Builder builder(context);
+  llvm::StringRef format = info.format;
+  // Only native byte order is supported, except for single bytes.
+  bool isLittleEndian = llvm::endianness::native == llvm::endianness::little;
+  if (!format.empty() && llvm::StringRef("@=<>!").contains(format[0])) {
+    bool isNative = format[0] == '@' || format[0] == '=' ||
+                    (format[0] == '<') == isLittleEndian;
+    if (!isNative && info.itemsize > 1) return {};
+    format = format.drop_front();
+  }
+
+  unsigned width = info.itemsize * 8;
+  if (format == "?" && info.itemsize == 1) return builder.getI1Type();
+  if (format.size() == 1 && llvm::StringRef("bhilq").contains(format[0]))
+    return builder.getIntegerType(width);
+  if (format.size() == 1 && llvm::StringRef("BHILQ").contains(format[0]))
+    return builder.getIntegerType(width, /*isSigned=*/false);
+  if (format == "e" && width == 16) return builder.getF16Type();
+  if (format == "f" && width == 32) return builder.getF32Type();
+  if (format == "d" && width == 64) return builder.getF64Type();
+  if (format == "Zf" && width == 64)
+    return mlir::ComplexType::get(builder.getF32Type());
+  if (format == "Zd" && width == 128)
+    return mlir::ComplexType::get(builder.getF64Type());
+  return {};
+}
+
+// Returns the buffer format of tensors with `elementType`, or an empty string
+// if there is none, e.g. for bf16 and f8 types.
+std::string getBufferFormat(mlir::Type elementType) {
+  if (elementType.isInteger(1)) return py::format_descriptor<bool>::format();
+  if (elementType.isSignlessInteger(8))
+    return py::format_descriptor<int8_t>::format();
+  if (elementType.isSignlessInteger(16))
+    return py::format_descriptor<int16_t>::format();
+  if (elementType.isSignlessInteger(32))
+    return py::format_descriptor<int32_t>::format();
+  if (elementType.isSignlessInteger(64))
+    return py::format_descriptor<int64_t>::format();
+  if (elementType.isUnsignedInteger(8))
+    return py::format_descriptor<uint8_t>::format();
+  if (elementType.isUnsignedInteger(16))
+    return py::format_descriptor<uint16_t>::format();
+  if (elementType.isUnsignedInteger(32))
+    return py::format_descriptor<uint32_t>::format();
+  if (elementType.isUnsignedInteger(64))
+    return py::format_descriptor<uint64_t>::format();
+  if (elementType.isF16()) return "e";
+  if (elementType.isF32()) return py::format_descriptor<float>::format();
+  if (elementType.isF64()) return py::format_descriptor<double>::format();
+  if (auto complexType = llvm::dyn_cast<mlir::ComplexType>(elementType)) {
+    if (complexType.getElementType().isF32())
+      return py::format_descriptor<std::complex<float>>::format();
+    if (complexType.getElementType().isF64())
+      return py::format_descriptor<std::complex<double>>::format();
+  }
+  return "";
+}
+
+// Returns the alignment of elements of `elementType` in buffers.
+size_t getAlignment(mlir::Type elementType, int64_t itemsize) {
+  return llvm::isa<mlir::ComplexType>(elementType) ? itemsize / 2 : itemsize;
+}
+
+// Wraps `storage`, which lies in the buffer of `info`, in a blob which keeps
+// the buffer alive instead of copying it. Misaligned storage is copied, like
+// in `numpy::deserializeTensor`.
+mlir::AsmResourceBlob makeBlob(std::unique_ptr<py::buffer_info> info,
+                               llvm::ArrayRef<char> storage,
+                               size_t alignment) {
+  if (reinterpret_cast<uintptr_t>(storage.data()) % alignment != 0)
+    return mlir::HeapAsmResourceBlob::allocateAndCopyWithAlign(storage,
+                                                               alignment);
+
+  // Blobs may be released without the GIL, e.g. on intra-op threads.
+  return mlir::AsmResourceBlob(
+      storage, alignment,
+      [info = std::move(info)](void *, size_t, size_t) mutable {
+        py::gil_scoped_acquire gil;
+        info.reset();
+      },
+      /*dataIsMutable=*/false);
+}
+
+// Wraps the storage of `buffer` in a tensor without copying it. The tensor
+// keeps `buffer` alive and is read-only, so ops which write to their inputs
+// copy it first. Buffers which aren't laid out in canonical order are wrapped
+// in strided views.
+mlir::FailureOr<mlir::stablehlo::Tensor> makeTensor(mlir::MLIRContext *context,
+                                                    py::buffer buffer) {
+  auto info = std::make_unique<py::buffer_info>(buffer.request());
+  auto elementType = getElementType(context, *info);
+  if (!elementType) {
+    PyErr_Format(PyExc_ValueError, "unsupported buffer format: %s",
+                 info->format.c_str());
+    return mlir::failure();
+  }
+
+  // The storage spans the elements between the first and last element in
+  // memory, which are at the first and last index unless strides are
+  // negative.
+  llvm::SmallVector<int64_t> shape(info->shape.begin(), info->shape.end());
+  auto type = mlir::RankedTensorType::get(shape, elementType);
+  llvm::SmallVector<int64_t> strides;
+  int64_t first = 0, last = 0;
+  for (auto [size, stride] : llvm::zip(info->shape, info->strides)) {
+    if (stride % info->itemsize != 0) {
+      PyErr_SetString(PyExc_ValueError,
+                      "buffer strides must be multiples of the item size");
+      return mlir::failure();
+    }
+    strides.push_back(stride / info->itemsize);
+    if (size > 0) (stride < 0 ? first : last) += (size - 1) * strides.back();
+  }
+  if (type.getNumElements() == 0) return mlir::stablehlo::Tensor(type);
+
+  int64_t itemsize = info->itemsize;
+  auto *data = static_cast<const char *>(info->ptr) + first * itemsize;
+  llvm::ArrayRef<char> storage(data, (last - first + 1) * itemsize);
+  auto storageType =
+      mlir::RankedTensorType::get({last - first + 1}, elementType);
+
+  auto base = mlir::stablehlo::Tensor(
+      storageType,
+      makeBlob(std::move(info), storage, getAlignment(elementType, itemsize)));
+  return mlir::stablehlo::makeStridedView(base, type, -first, strides);
+}
+
+// Wraps the storage of `buffer` in a resource attribute named after `name`
+// without copying it, unless it is misaligned. The attribute keeps `buffer`
+// alive as long as `context`. Unlike tensors, attributes can't be strided
+// views, so only C-contiguous buffers are supported.
+mlir::FailureOr<mlir::DenseResourceElementsAttr> makeResourceElementsAttr(
+    mlir::MLIRContext *context, py::buffer buffer, llvm::StringRef name) {
+  auto info = std::make_unique<py::buffer_info>(buffer.request());
+  auto elementType = getElementType(context, *info);
+  // Resource attributes store booleans as bits rather than bytes.
+  if (!elementType || elementType.isInteger(1)) {
+    PyErr_Format(PyExc_ValueError, "unsupported buffer format: %s",
+                 info->format.c_str());
+    return mlir::failure();
+  }
+
+  int64_t itemsize = info->itemsize;
+  int64_t stride = itemsize;
+  for (int64_t i = info->ndim - 1; i >= 0; --i) {
+    if (info->shape[i] > 1 && info->strides[i] != stride) {
+      PyErr_SetString(PyExc_ValueError, "buffer must be C-contiguous");
+      return mlir::failure();
+    }
+    stride *= info->shape[i];
+  }
+
+  llvm::SmallVector<int64_t> shape(info->shape.begin(), info->shape.end());
+  auto type = mlir::RankedTensorType::get(shape, elementType);
+  llvm::ArrayRef<char> storage(static_cast<const char *>(info->ptr),
+                               type.getNumElements() * itemsize);
+  return mlir::DenseResourceElementsAttr::get(
+      type, name,
+      makeBlob(std::move(info), storage, getAlignment(elementType, itemsize)));
+}
+
+// Exposes the storage of a tensor through the buffer protocol without copying
+// it, e.g. to `numpy.asarray`. Strided views are copied into canonical order
+// on first access.
+py::buffer_info getBufferInfo(const mlir::stablehlo::Tensor &tensor) {
+  auto elementType = tensor.getElementType();
+  py::ssize_t itemsize = 1;
+  if (auto complexType = llvm::dyn_cast<mlir::ComplexType>(elementType))
+    itemsize = 2 * complexType.getElementType().getIntOrFloatBitWidth() / 8;
+  else if (!elementType.isInteger(1))
+    itemsize = elementType.getIntOrFloatBitWidth() / 8;
+
+  auto tensorShape = tensor.getShape();
+  std::vector<py::ssize_t> shape(tensorShape.begin(), tensorShape.end());
+  std::vector<py::ssize_t> strides(shape.size());
+  py::ssize_t stride = itemsize;
+  for (int64_t i = shape.size() - 1; i >= 0; --i) {
+    strides[i] = stride;
+    stride *= shape[i];
+  }
+  return py::buffer_info(const_cast<char *>(tensor.getData()), itemsize,
+                         getBufferFormat(elementType),
+                         shape.size(), shape, strides, /*readonly=*/true);
+}
+
+// Passes the entries of StableHLO `outfeed` to `callback` as soon as they're
+// produced, as lists of `Tensor` objects which share the storage of the
+// interpreter. The entries are produced on the threads of the processes of
+// `interpreter.run_parallel`, so the evaluation must not hold the GIL, and
+// `callback` is captured by reference so that copies of the consumer don't
+// touch reference counts without it. The first exception raised by
+// `callback` is stored in `error`, after which entries are dropped.
+mlir::stablehlo::OutfeedConsumer makeOutfeedConsumer(
+    const py::object &callback, std::optional<py::error_already_set> &error) {
+  return [&callback, &error](llvm::ArrayRef<mlir::stablehlo::Tensor> inputs) {
+    py::gil_scoped_acquire acquire;
+    if (error) return;
+    try {
+      py::list entry;
+      for (const auto &input : inputs) entry.append(py::cast(input));
+      callback(entry);
+    } catch (py::error_already_set &e) {
+      error = std::move(e);
+    }
+  };
+}
+
+// An `InterpreterExecutable` of a module of `context`, with the configuration
+// which it references.
+struct PyInterpreterExecutable {
+  mlir::MLIRContext *context;
+  mlir::stablehlo::InterpreterConfiguration config;
+  std::unique_ptr<mlir::stablehlo::InterpreterExecutable> executable;
+};
+
 }  // namespace
 
 PYBIND11_MODULE(_stablehlo, m) {
@@ -532,34 +780,336 @@ PYBIND11_MODULE(_stablehlo, m) {
   //
   // Reference APIs
   //
+
+  // Registers the `interpreter` dialect in `context`, e.g. for modules which
+  // evaluate programs with `interpreter.run_parallel`.
+  m.def(
+      "register_interpreter_dialect",
+      [](MlirContext context) {
+        mlir::DialectRegistry registry;
+        registry.insert<mlir::stablehlo::interpreter::InterpreterDialect>();
+        unwrap(context)->appendDialectRegistry(registry);
+        unwrap(context)
+            ->loadDialect<mlir::stablehlo::interpreter::InterpreterDialect>();
+      },
+      py::arg("context"));
+
+  // If `outfeed_callback` is set, it's called with every entry of StableHLO
+  // `outfeed` as soon as it's produced, as a list of `Tensor` objects which
+  // view the storage of the interpreter without copying it, instead of
+  // accumulating the entries until the evaluation ends. Exceptions raised by
+  // the callback are raised by `eval_module` once the evaluation ends.
   m.def(
       "eval_module",
-      [](MlirModule module,
-         std::vector<MlirAttribute> &args) -> std::vector<MlirAttribute> {
-        std::vector<mlir::DenseElementsAttr> inputs;
+      [](MlirModule module, std::vector<MlirAttribute> &args,
+         py::object outfeedCallback) -> std::vector<MlirAttribute> {
+        // Resource attributes are read in place, see `constantOp`.
+        llvm::SmallVector<mlir::stablehlo::InterpreterValue> inputs;
         for (auto arg : args) {
-          auto attr = llvm::dyn_cast<mlir::DenseElementsAttr>(unwrap(arg));
-          if (!attr) {
+          auto attr = llvm::dyn_cast<mlir::ElementsAttr>(unwrap(arg));
+          if (!llvm::isa_and_present<mlir::DenseElementsAttr,
+                                     mlir::DenseResourceElementsAttr>(attr)) {
             PyErr_SetString(PyExc_ValueError,
-                            "input args must be DenseElementsAttr");
+                            "input args must be DenseElementsAttr or "
+                            "DenseResourceElementsAttr");
             return {};
           }
-          inputs.push_back(attr);
+          inputs.emplace_back(mlir::stablehlo::constantOp(attr));
         }
 
         mlir::stablehlo::InterpreterConfiguration config;
-        auto results =
-            mlir::stablehlo::evalModule(unwrap(module), inputs, config);
+        std::optional<py::error_already_set> outfeedError;
+        if (!outfeedCallback.is_none())
+          config.outfeedConsumer =
+              makeOutfeedConsumer(outfeedCallback, outfeedError);
+        mlir::FailureOr<llvm::SmallVector<mlir::stablehlo::InterpreterValue>>
+            results = mlir::failure();
+        {
+          py::gil_scoped_release release;
+          results = mlir::stablehlo::evalModule(unwrap(module), inputs, config);
+        }
+        if (outfeedError) throw *outfeedError;
         if (failed(results)) {
           PyErr_SetString(PyExc_ValueError, "interpreter failed");
           return {};
         }
 
         std::vector<MlirAttribute> pyResults;
-        for (auto res : *results) pyResults.push_back(wrap(res));
+        for (auto &result : *results)
+          pyResults.push_back(wrap(mlir::stablehlo::makeDenseElementsAttr(
+              result.getTensor())));
         return pyResults;
       },
-      py::arg("module"), py::arg("args"));
+      py::arg("module"), py::arg("args"),
+      py::arg("outfeed_callback") = py::none());
+
+  // Wraps a C-contiguous buffer, e.g. a NumPy array, in a
+  // `DenseResourceElementsAttr` without copying it, for use as a constant in
+  // modules or as an input of `eval_module`. The attribute keeps the buffer
+  // alive as long as the context, and the buffer must not be modified in the
+  // meantime. `name` is made unique if needed.
+  m.def(
+      "make_resource_elements_attr",
+      [](py::buffer buffer, std::string name,
+         MlirContext context) -> MlirAttribute {
+        auto attr = makeResourceElementsAttr(unwrap(context), buffer, name);
+        if (failed(attr)) return {};
+        return wrap(*attr);
+      },
+      py::arg("buffer"), py::arg("name") = "buffer",
+      py::arg("context") = py::none());
+
+  // Results of `eval_module_buffers`, which support the buffer protocol.
+  py::class_<mlir::stablehlo::Tensor>(m, "Tensor", py::buffer_protocol())
+      .def_buffer(&getBufferInfo)
+      .def_property_readonly("shape",
+                             [](const mlir::stablehlo::Tensor &self) {
+                               auto shape = self.getShape();
+                               return std::vector<int64_t>(shape.begin(),
+                                                           shape.end());
+                             })
+      .def("__str__", [](const mlir::stablehlo::Tensor &self) {
+        std::string result;
+        llvm::raw_string_ostream os(result);
+        self.print(os);
+        return os.str();
+      });
+
+  // Unlike `eval_module`, reads inputs from objects which support the buffer
+  // protocol, e.g. NumPy arrays, and returns results which support it, both
+  // without copying them or creating attributes in the context of `module`.
+  // `outfeed_callback` is like in `eval_module`.
+  m.def(
+      "eval_module_buffers",
+      [](MlirModule module, std::vector<py::buffer> &args,
+         py::object outfeedCallback) -> std::vector<py::object> {
+        auto *context = unwrap(module)->getContext();
+        llvm::SmallVector<mlir::stablehlo::InterpreterValue> inputs;
+        for (auto &arg : args) {
+          auto tensor = makeTensor(context, arg);
+          if (failed(tensor)) return {};
+          inputs.emplace_back(*tensor);
+        }
+
+        mlir::stablehlo::InterpreterConfiguration config;
+        std::optional<py::error_already_set> outfeedError;
+        if (!outfeedCallback.is_none())
+          config.outfeedConsumer =
+              makeOutfeedConsumer(outfeedCallback, outfeedError);
+        mlir::FailureOr<llvm::SmallVector<mlir::stablehlo::InterpreterValue>>
+            results = mlir::failure();
+        {
+          py::gil_scoped_release release;
+          results = mlir::stablehlo::evalModule(unwrap(module), inputs, config);
+        }
+        if (outfeedError) throw *outfeedError;
+        if (failed(results)) {
+          PyErr_SetString(PyExc_ValueError, "interpreter failed");
+          return {};
+        }
+
+        std::vector<py::object> pyResults;
+        for (auto &result : *results) {
+          if (!result.isTensor() ||
+              getBufferFormat(result.getTensor().getElementType()).empty()) {
+            PyErr_SetString(PyExc_ValueError,
+                            "results must be tensors with a buffer format");
+            return {};
+          }
+          pyResults.push_back(py::cast(result.getTensor()));
+        }
+        return pyResults;
+      },
+      py::arg("module"), py::arg("args"),
+      py::arg("outfeed_callback") = py::none());
+
+  // Evaluates `module` once for every list of inputs of `batches`, like
+  // `eval_module_buffers`, concurrently on `num_threads` threads (or one per
+  // hardware thread if 0) without holding the GIL.
+  m.def(
+      "eval_module_batch",
+      [](MlirModule module, std::vector<std::vector<py::buffer>> &batches,
+         unsigned numThreads) -> std::vector<std::vector<py::object>> {
+        auto *context = unwrap(module)->getContext();
+        llvm::SmallVector<llvm::SmallVector<mlir::stablehlo::InterpreterValue>>
+            inputs;
+        for (auto &args : batches) {
+          auto &batchInputs = inputs.emplace_back();
+          for (auto &arg : args) {
+            auto tensor = makeTensor(context, arg);
+            if (failed(tensor)) return {};
+            batchInputs.emplace_back(*tensor);
+          }
+        }
+
+        mlir::FailureOr<llvm::SmallVector<
+            llvm::SmallVector<mlir::stablehlo::InterpreterValue>>>
+            results = mlir::failure();
+        {
+          py::gil_scoped_release release;
+          mlir::stablehlo::InterpreterConfiguration config;
+          llvm::DefaultThreadPool threadPool(
+              llvm::hardware_concurrency(numThreads));
+          results = mlir::stablehlo::evalModuleBatch(unwrap(module), inputs,
+                                                     config, &threadPool);
+        }
+        if (failed(results)) {
+          PyErr_SetString(PyExc_ValueError, "interpreter failed");
+          return {};
+        }
+
+        std::vector<std::vector<py::object>> pyResults;
+        for (auto &batchResults : *results) {
+          auto &pyBatchResults = pyResults.emplace_back();
+          for (auto &result : batchResults) {
+            if (!result.isTensor() ||
+                getBufferFormat(result.getTensor().getElementType()).empty()) {
+              PyErr_SetString(PyExc_ValueError,
+                              "results must be tensors with a buffer format");
+              return {};
+            }
+            pyBatchResults.push_back(py::cast(result.getTensor()));
+          }
+        }
+        return pyResults;
+      },
+      py::arg("module"), py::arg("batches"), py::arg("num_threads") = 0);
+
+  // Evaluates `module` repeatedly from one `InterpreterExecutable`, like
+  // `eval_module_buffers` without an outfeed callback. If the main function
+  // has dynamic argument shapes, it is specialized only once per list of
+  // argument types while the specialization stays among the
+  // `specialization_cache_capacity` most recently used ones. The executable
+  // keeps `module` alive, which must not be modified in the meantime.
+  py::class_<PyInterpreterExecutable>(m, "InterpreterExecutable")
+      .def(py::init([](MlirModule module, size_t specializationCacheCapacity) {
+             auto result = std::make_unique<PyInterpreterExecutable>();
+             result->context = unwrap(module)->getContext();
+             result->config.specializationCacheCapacity =
+                 specializationCacheCapacity;
+             auto executable = mlir::stablehlo::InterpreterExecutable::create(
+                 unwrap(module), result->config);
+             if (failed(executable))
+               throw py::value_error("failed to create executable");
+             result->executable = std::move(*executable);
+             return result;
+           }),
+           py::arg("module"),
+           py::arg("specialization_cache_capacity") =
+               mlir::stablehlo::InterpreterConfiguration()
+                   .specializationCacheCapacity,
+           py::keep_alive<1, 2>())
+      .def(
+          "evaluate",
+          [](const PyInterpreterExecutable &self,
+             std::vector<py::buffer> &args) -> std::vector<py::object> {
+            llvm::SmallVector<mlir::stablehlo::InterpreterValue> inputs;
+            for (auto &arg : args) {
+              auto tensor = makeTensor(self.context, arg);
+              if (failed(tensor)) return {};
+              inputs.emplace_back(*tensor);
+            }
+
+            mlir::FailureOr<
+                llvm::SmallVector<mlir::stablehlo::InterpreterValue>>
+                results = mlir::failure();
+            {
+              py::gil_scoped_release release;
+              results = self.executable->evaluate(inputs);
+            }
+            if (failed(results)) {
+              PyErr_SetString(PyExc_ValueError, "interpreter failed");
+              return {};
+            }
+
+            std::vector<py::object> pyResults;
+            for (auto &result : *results) {
+              if (!result.isTensor() ||
+                  getBufferFormat(result.getTensor().getElementType())
+                      .empty()) {
+                PyErr_SetString(
+                    PyExc_ValueError,
+                    "results must be tensors with a buffer format");
+                return {};
+              }
+              pyResults.push_back(py::cast(result.getTensor()));
+            }
+            return pyResults;
+          },
+          py::arg("args"))
+      .def_property_readonly(
+          "specialization_statistics",
+          [](const PyInterpreterExecutable &self) {
+            auto statistics = self.executable->getSpecializationStatistics();
+            py::dict result;
+            result["hits"] = statistics.numHits;
+            result["misses"] = statistics.numMisses;
+            result["evictions"] = statistics.numEvictions;
+            return result;
+          });
+
+  //
+  // Shape refinement APIs.
+  //
+
+  // Returns a copy of `module` whose main function is refined to the static
+  // `arg_types`, see `createStablehloRemoveDynamismPipeline`.
+  m.def(
+      "refine_module",
+      [](MlirModule module, std::vector<MlirType> &argTypes) -> MlirModule {
+        auto refinedTypes = llvm::map_to_vector(
+            argTypes, [](MlirType type) { return unwrap(type); });
+        mlir::OwningOpRef<mlir::ModuleOp> refinedModule =
+            unwrap(module).clone();
+        mlir::PassManager pm(refinedModule->getContext());
+        mlir::stablehlo::createStablehloRemoveDynamismPipeline(pm,
+                                                               refinedTypes);
+        if (failed(pm.run(*refinedModule))) {
+          PyErr_SetString(PyExc_ValueError, "failed to refine module");
+          return {};
+        }
+        return wrap(refinedModule.release());
+      },
+      py::arg("module"), py::arg("arg_types"));
+
+  // Like `refine_module`, but runs the pipeline only once per list of
+  // argument types, e.g. to serve a shape-polymorphic model. The cache keeps
+  // `module` alive, which must not be modified in the meantime.
+  py::class_<mlir::stablehlo::ShapeSpecializationCache>(
+      m, "ShapeSpecializationCache")
+      .def(py::init([](MlirModule module, size_t capacity) {
+             return std::make_unique<
+                 mlir::stablehlo::ShapeSpecializationCache>(unwrap(module),
+                                                            capacity);
+           }),
+           py::arg("module"), py::arg("capacity") = 0, py::keep_alive<1, 2>())
+      .def(
+          "refine_module",
+          [](mlir::stablehlo::ShapeSpecializationCache &self,
+             std::vector<MlirType> &argTypes) -> MlirModule {
+            auto refinedTypes = llvm::map_to_vector(
+                argTypes, [](MlirType type) { return unwrap(type); });
+            auto specialization = self.get(refinedTypes);
+            if (failed(specialization)) {
+              PyErr_SetString(PyExc_ValueError, "failed to refine module");
+              return {};
+            }
+            // Specializations are shared, so callers get copies of their own,
+            // whose attributes are still shared.
+            return wrap((*specialization)->get().clone());
+          },
+          py::arg("arg_types"))
+      .def_property_readonly(
+          "statistics",
+          [](const mlir::stablehlo::ShapeSpecializationCache &self) {
+            auto statistics = self.getStatistics();
+            py::dict result;
+            result["hits"] = statistics.numHits;
+            result["misses"] = statistics.numMisses;
+            result["evictions"] = statistics.numEvictions;
+            return result;
+          })
+      .def("clear", &mlir::stablehlo::ShapeSpecializationCache::clear);
 
   //
   // Serialization APIs.
@@ -580,6 +1130,15 @@ PYBIND11_MODULE(_stablehlo, m) {
       },
       py::arg("module"), py::arg("target"));
 
+  m.def(
+      "serialize_portable_artifact_to_file",
+      [](MlirModule module, std::string target, std::string path) {
+        if (failed(mlir::stablehlo::serializePortableArtifactToFile(
+                unwrap(module), target, path)))
+          PyErr_SetString(PyExc_ValueError, "failed to serialize module");
+      },
+      py::arg("module"), py::arg("target"), py::arg("path"));
+
   m.def(
       "deserialize_portable_artifact",
       [](MlirContext context, std::string artifact) -> MlirModule {
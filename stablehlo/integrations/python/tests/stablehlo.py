@@ -19,6 +19,8 @@
 
 import re
 import io
+import os
+import tempfile
 from mlir import ir
 from mlir.dialects import stablehlo
 import numpy as np
@@ -284,6 +286,234 @@ def test_reference_api():
     assert (actual == expected).all()
 
 
+@run
+def test_reference_api_buffers():
+  # Formatted as (tensor_type, np_value)
+  # Program runs arg + arg, which is used for expected value
+  tests = [
+    ("f16", np.asarray(1, np.float16)),
+    ("f32", np.asarray(2, np.float32)),
+    ("f64", np.asarray(3, np.double)),
+    ("1xi8", np.asarray([4], np.int8)),
+    ("1xi16", np.asarray([5], np.int16)),
+    ("1xi32", np.asarray([-6], np.int32)),
+    ("1xi64", np.asarray([-7], np.int64)),
+    ("1xui32", np.asarray([8], np.uint32)),
+    ("2xcomplex<f32>", np.asarray([1 + 2j, 3 - 4j], np.complex64)),
+    ("2x2xf32", np.asarray([1, 2, 3, 4], np.float32).reshape(2,2)),
+    # Non-contiguous buffers are read in place as strided views.
+    ("2x2xf32", np.asarray([1, 2, 3, 4], np.float32).reshape(2,2).T),
+    ("3xf32", np.asarray([1, 2, 3, 4, 5, 6], np.float32)[::-2]),
+    ("?x2xf32", np.asarray([1, 2, 3, 4], np.float32).reshape(2,2)),
+  ]
+  for test in tests:
+    tensor_type, arg = test
+    with ir.Context() as context:
+      stablehlo.register_dialect(context)
+      m = ir.Module.parse(ASM_FORMAT.format(tensor_type))
+
+    result = stablehlo.eval_module_buffers(m, [arg])[0]
+    actual = np.asarray(result)
+    expected = arg + arg
+    assert actual.dtype == expected.dtype
+    assert (actual == expected).all()
+    # Results are read-only views of the interpreter's storage.
+    assert not actual.flags.writeable
+
+
+@run
+def test_reference_api_batch():
+  with ir.Context() as context:
+    stablehlo.register_dialect(context)
+    m = ir.Module.parse(ASM_FORMAT.format("?x2xf32"))
+
+  batches = [[np.full((i + 1, 2), i, np.float32)] for i in range(8)]
+  results = stablehlo.eval_module_batch(m, batches, num_threads=4)
+  assert len(results) == len(batches)
+  for [arg], [result] in zip(batches, results):
+    assert (np.asarray(result) == arg + arg).all()
+
+
+@run
+def test_interpreter_executable():
+  m = ir.Module.parse(ASM_FORMAT.format("?x2xf32"))
+  executable = stablehlo.InterpreterExecutable(m)
+  for rows in [3, 3, 4, 3, 4]:
+    arg = np.arange(rows * 2, dtype=np.float32).reshape(rows, 2)
+    result = executable.evaluate([arg])[0]
+    assert (np.asarray(result) == arg + arg).all()
+  # The pipeline which removes dynamism runs once per signature.
+  statistics = executable.specialization_statistics
+  assert statistics == {"hits": 3, "misses": 2, "evictions": 0}
+
+  # Specializations beyond the capacity are evicted and specialized again.
+  executable = stablehlo.InterpreterExecutable(
+      m, specialization_cache_capacity=1)
+  for rows in [3, 3, 4, 3]:
+    executable.evaluate([np.zeros((rows, 2), dtype=np.float32)])
+  statistics = executable.specialization_statistics
+  assert statistics == {"hits": 1, "misses": 3, "evictions": 2}
+
+
+OUTFEED_ASM = """
+func.func @outfeed(%arg0: tensor<2xf32>, %token: !stablehlo.token) -> !stablehlo.token {
+  %0 = "stablehlo.outfeed"(%arg0, %token) : (tensor<2xf32>, !stablehlo.token) -> !stablehlo.token
+  %1 = stablehlo.add %arg0, %arg0 : tensor<2xf32>
+  %2 = "stablehlo.outfeed"(%1, %0) : (tensor<2xf32>, !stablehlo.token) -> !stablehlo.token
+  func.return %2 : !stablehlo.token
+}
+func.func @main(%arg0: tensor<2xf32>) {
+  %token = stablehlo.after_all : !stablehlo.token
+  %0 = "interpreter.run_parallel"(%arg0, %token) {
+    programs=[[@outfeed]]
+  } : (tensor<2xf32>, !stablehlo.token) -> !stablehlo.token
+  func.return
+}
+"""
+
+
+@run
+def test_reference_api_outfeed():
+  arg = np.asarray([1, 2], np.float32)
+  with ir.Context() as context:
+    stablehlo.register_dialect(context)
+    stablehlo.register_interpreter_dialect(context)
+    m = ir.Module.parse(OUTFEED_ASM)
+
+  entries = []
+  stablehlo.eval_module_buffers(m, [arg], outfeed_callback=entries.append)
+  assert len(entries) == 2
+  for [tensor], expected in zip(entries, [arg, arg + arg]):
+    assert tensor.shape == [2]
+    assert (np.asarray(tensor) == expected).all()
+
+  # Exceptions raised by the callback are raised once the evaluation ends.
+  def fail(entry):
+    raise RuntimeError("outfeed failed")
+  try:
+    stablehlo.eval_module_buffers(m, [arg], outfeed_callback=fail)
+    assert False, "expected an exception"
+  except RuntimeError as e:
+    assert str(e) == "outfeed failed"
+
+
+@run
+def test_resource_elements_attr():
+  arg = np.arange(6, dtype=np.float32).reshape(2, 3)
+  expected = arg + arg
+  with ir.Context() as context:
+    stablehlo.register_dialect(context)
+    m = ir.Module.parse(ASM_FORMAT.format("2x3xf32"))
+    attr = stablehlo.make_resource_elements_attr(arg, "weights")
+    assert str(attr.type) == "tensor<2x3xf32>"
+
+    # Attributes are usable as constants and keep their buffers alive.
+    constants = ir.Module.create(ir.Location.unknown())
+    with ir.Location.unknown(), ir.InsertionPoint(constants.body):
+      stablehlo.ConstantOp(attr)
+    assert "dense_resource<weights" in str(constants)
+    del arg
+
+    actual = np.array(stablehlo.eval_module(m, [attr])[0])
+    assert (actual == expected).all()
+
+    try:
+      stablehlo.make_resource_elements_attr(expected.T)
+      assert False, "non-contiguous buffers must be rejected"
+    except ValueError:
+      pass
+
+
+DOT_GENERAL_ASM = """
+func.func @main(%lhs: tensor<2x3xf32>, %rhs: tensor<3x4xf32>) -> tensor<2x4xf32> {
+  %0 = stablehlo.dot_general %lhs, %rhs, contracting_dims = [1] x [0] : (tensor<2x3xf32>, tensor<3x4xf32>) -> tensor<2x4xf32>
+  func.return %0 : tensor<2x4xf32>
+}
+"""
+
+
+@run
+def test_verification_after_mutation():
+  # The verification of dot_general is memoized, which must not hide errors
+  # in ops that are modified after they verified.
+  m = ir.Module.parse(DOT_GENERAL_ASM)
+  m.operation.verify()
+  dot = m.body.operations[0].regions[0].blocks[0].operations[0]
+  valid_dims = dot.attributes["dot_dimension_numbers"]
+  dot.attributes["dot_dimension_numbers"] = stablehlo.DotDimensionNumbers.get(
+      lhs_batching_dimensions=[],
+      rhs_batching_dimensions=[],
+      lhs_contracting_dimensions=[1],
+      rhs_contracting_dimensions=[1])
+  for _ in range(2):
+    try:
+      m.operation.verify()
+      assert False, "expected a verification error"
+    except ir.MLIRError as e:
+      assert "contracting dimension sizes must match" in str(e)
+  dot.attributes["dot_dimension_numbers"] = valid_dims
+  m.operation.verify()
+
+
+@run
+def test_refine_module():
+  m = ir.Module.parse(ASM_FORMAT.format("?x2xf32"))
+  arg_type = ir.RankedTensorType.get([3, 2], ir.F32Type.get())
+  refined = stablehlo.refine_module(m, [arg_type])
+  assert "tensor<3x2xf32>" in str(refined)
+  assert "tensor<?x2xf32>" in str(m)
+
+  cache = stablehlo.ShapeSpecializationCache(m, capacity=1)
+  for _ in range(2):
+    refined = cache.refine_module([arg_type])
+    assert "tensor<3x2xf32>" in str(refined)
+  other_type = ir.RankedTensorType.get([4, 2], ir.F32Type.get())
+  assert "tensor<4x2xf32>" in str(cache.refine_module([other_type]))
+  assert cache.statistics == {"hits": 1, "misses": 2, "evictions": 1}
+
+
+@run
+def test_shape_specialization_cache():
+  m = ir.Module.parse(ASM_FORMAT.format("?x2xf32"))
+  types = {
+      rows: ir.RankedTensorType.get([rows, 2], ir.F32Type.get())
+      for rows in [1, 2, 3]
+  }
+
+  # Repeated signatures hit, in any order.
+  cache = stablehlo.ShapeSpecializationCache(m)
+  for rows in [1, 2, 1, 1, 3, 2]:
+    refined = cache.refine_module([types[rows]])
+    assert f"tensor<{rows}x2xf32>" in str(refined)
+  assert cache.statistics == {"hits": 3, "misses": 3, "evictions": 0}
+  cache.clear()
+  cache.refine_module([types[1]])
+  assert cache.statistics == {"hits": 3, "misses": 4, "evictions": 3}
+
+  # At capacity, the least recently used specialization is evicted: 2 rather
+  # than 1, which was requested again since.
+  cache = stablehlo.ShapeSpecializationCache(m, capacity=2)
+  for rows in [1, 2, 1, 3]:
+    cache.refine_module([types[rows]])
+  assert cache.statistics == {"hits": 1, "misses": 3, "evictions": 1}
+  cache.refine_module([types[1]])
+  cache.refine_module([types[2]])
+  assert cache.statistics == {"hits": 2, "misses": 4, "evictions": 2}
+
+  # Failed specializations aren't cached, so they are tried again.
+  cache = stablehlo.ShapeSpecializationCache(m)
+  invalid_type = ir.RankedTensorType.get([3, 3], ir.F32Type.get())
+  for _ in range(2):
+    try:
+      cache.refine_module([invalid_type])
+      assert False, "expected an exception"
+    except ValueError as e:
+      assert str(e) == "failed to refine module"
+  assert cache.statistics == {"hits": 0, "misses": 2, "evictions": 0}
+  assert "tensor<1x2xf32>" in str(cache.refine_module([types[1]]))
+  assert cache.statistics == {"hits": 0, "misses": 3, "evictions": 0}
+
+
 @run
 def test_serialization_apis():
   curr_version = stablehlo.get_current_version()
@@ -297,6 +527,23 @@ def test_serialization_apis():
     deserialized = stablehlo.deserialize_portable_artifact(context, serialized)
     assert module_str == str(deserialized)
 
+@run
+def test_file_serialization_apis():
+  curr_version = stablehlo.get_current_version()
+
+  with ir.Context() as context:
+    stablehlo.register_dialect(context)
+    m = ir.Module.parse(ASM_FORMAT.format("2xf32"))
+    assert m is not None
+    module_str = str(m)
+    with tempfile.TemporaryDirectory() as directory:
+      path = os.path.join(directory, "artifact.mlirbc")
+      stablehlo.serialize_portable_artifact_to_file(m, curr_version, path)
+      with open(path, "rb") as f:
+        serialized = f.read()
+    deserialized = stablehlo.deserialize_portable_artifact(context, serialized)
+    assert module_str == str(deserialized)
+
 @run
 def test_str_serialization_apis():
   curr_version = stablehlo.get_current_version()
@@ -316,3 +563,52 @@ def test_str_serialization_apis():
     deserialized = stablehlo.deserialize_portable_artifact(serialized)
     deserialized_module = ir.Module.parse(deserialized)
     assert module_str == str(deserialized_module)
+
+
+@run
+def test_batched_serialization_apis():
+  curr_version = stablehlo.get_current_version()
+  shapes = ["2xf32", "3xf32", "4xi32"]
+  module_strs = [ASM_FORMAT.format(shape) for shape in shapes]
+
+  # Modules and artifacts can be passed as any buffer, without copies.
+  serialized = stablehlo.serialize_portable_artifacts(
+      [memoryview(module_str.encode()) for module_str in module_strs],
+      curr_version, num_threads=2)
+  deserialized = stablehlo.deserialize_portable_artifacts(
+      [memoryview(artifact) for artifact in serialized])
+  assert len(deserialized) == len(shapes)
+
+  with ir.Context() as context:
+    stablehlo.register_dialect(context)
+    for module_str, module in zip(module_strs, deserialized):
+      assert str(ir.Module.parse(module)) == str(ir.Module.parse(module_str))
+
+  try:
+    stablehlo.serialize_portable_artifacts(
+        [module_strs[0], "invalid"], curr_version)
+    assert False, "expected a ValueError"
+  except ValueError as e:
+    assert "index 1" in str(e)
+
+
+@run
+def test_file_str_serialization_apis():
+  curr_version = stablehlo.get_current_version()
+  module_str = ASM_FORMAT.format("2xf32")
+
+  with tempfile.TemporaryDirectory() as directory:
+    module_path = os.path.join(directory, "module.mlir")
+    artifact_path = os.path.join(directory, "artifact.mlirbc")
+    bytecode_path = os.path.join(directory, "module.mlirbc")
+    with open(module_path, "w") as f:
+      f.write(module_str)
+    stablehlo.serialize_portable_artifact_file(module_path, artifact_path,
+                                               curr_version)
+    stablehlo.deserialize_portable_artifact_file(artifact_path, bytecode_path)
+    with open(bytecode_path, "rb") as f:
+      bytecode = f.read()
+
+  with ir.Context() as context:
+    stablehlo.register_dialect(context)
+    assert str(ir.Module.parse(bytecode)) == str(ir.Module.parse(module_str))
@@ -15,7 +15,12 @@ limitations under the License.
 #include "stablehlo/reference/Api.h"
 
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
 
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -23,26 +28,38 @@ limitations under the License.
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/DialectRegistry.h"
 #include "mlir/IR/Location.h"
+#include "mlir/IR/OwningOpRef.h"
 #include "mlir/IR/TypeRange.h"
 #include "mlir/Parser/Parser.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/LogicalResult.h"
 #include "stablehlo/dialect/Register.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/reference/BufferPool.h"
 #include "stablehlo/reference/Configuration.h"
 #include "stablehlo/reference/Errors.h"
+#include "stablehlo/reference/EvaluationContext.h"
 #include "stablehlo/reference/InterpreterOps.h"
+#include "stablehlo/reference/Jit.h"
+#include "stablehlo/reference/Kernels.h"
 #include "stablehlo/reference/NumPy.h"
 #include "stablehlo/reference/Ops.h"
+#include "stablehlo/reference/ProbeWriter.h"
 #include "stablehlo/reference/Process.h"
 #include "stablehlo/reference/Scope.h"
 #include "stablehlo/reference/Tensor.h"
 #include "stablehlo/reference/Value.h"
 #include "stablehlo/transforms/Passes.h"
+#include "stablehlo/transforms/SpecializationCache.h"
 
 namespace mlir {
 namespace stablehlo {
@@ -68,7 +85,9 @@ FailureOr<func::FuncOp> getMainFunction(ModuleOp module, StringRef mainName) {
 class DefaultInterpreterFallback : public InterpreterFallback {
  public:
   DefaultInterpreterFallback(const InterpreterConfiguration &config)
-      : config(config){};
+      : config(config),
+        probeWriter(config.probeInstrumentationDir, config.probeQueueCapacity,
+                    config.probeSamplingInterval, config.probeContainer){};
 
   virtual llvm::Error operator()(Operation &op, Scope &scope,
                                  Process *process) final {
@@ -78,8 +97,8 @@ class DefaultInterpreterFallback : public InterpreterFallback {
       auto input =
           stablehlo::InterpreterValue(scope.findTensor(probeOp.getOperand()));
       auto status = stablehlo::interpreter::evalProbeOp(
-          input, probeOp.getProbeId(), config.probeInstrumentationDir,
-          ++serializedProbeFileId);
+          input, probeOp.getProbeId(), probeWriter, probeOp.getSummarize(),
+          probeOp.getDigest());
       scope.add(probeOp.getResult(), input);
       return wrapFallbackStatus(std::move(status), funcName,
                                 "interpreter.probe");
@@ -101,22 +120,76 @@ class DefaultInterpreterFallback : public InterpreterFallback {
 
       SymbolTable symbolTable{op.getParentOfType<ModuleOp>()};
       auto results = stablehlo::interpreter::evalRunParallelOp(
-          runtimeOperands, infeed, programs, symbolTable);
+          runtimeOperands, infeed, programs, symbolTable,
+          config.collectiveTimeout, config.processThreadPool,
+          config.pinProcessThreads, config.processTransport,
+          config.infeedProducer, config.outfeedConsumer, config.channelDepth,
+          config.linkModel, config.communicationStatisticsStream);
       scope.add(runParallelOp.getResults(), results);
       return wrapFallbackStatus(llvm::Error::success(), funcName,
                                 "interpreter.run_parallel");
     }
 
+    // User fallbacks may read the probes written so far, e.g. to check them.
+    if (auto status = probeWriter.flush())
+      return wrapFallbackStatus(std::move(status), funcName,
+                                "interpreter.probe");
     return (*config.fallback)(op, scope, process);
   }
 
+  /// Writes the remaining probes and completes their files.
+  llvm::Error finishProbes() { return probeWriter.finish(); }
+
  private:
   /// Interpreter configuration.
   const InterpreterConfiguration &config;
 
-  /// Probe instrumentation counter for uniquely identifying instrumented tensor
-  /// filenames.
-  int64_t serializedProbeFileId = 0;
+  /// Serializes the tensors of `interpreter.probe` ops.
+  ProbeWriter probeWriter;
+};
+
+EvaluationContext makeEvaluationContext(
+    const InterpreterConfiguration &config) {
+  EvaluationContext context;
+  context.kernelOptions.enableNativeKernels = config.enableNativeKernels;
+  context.kernelOptions.exactAccumulation = config.exactAccumulation;
+  context.kernelOptions.pairwiseSummation = config.pairwiseSummation;
+  context.intraOpThreadPool = config.intraOpThreadPool;
+  context.dataflowExecution = config.dataflowExecution;
+  context.profiler = config.profiler;
+  context.numericsChecker = config.numericsChecker;
+  context.memoryTracker = config.memoryTracker;
+  context.checkpointer = config.checkpointer;
+  context.kernelRegistry = config.kernelRegistry;
+  return context;
+}
+
+// Capacities of the buffer pool requested by the evaluations in progress,
+// guarded by `bufferPoolUsersMutex`.
+std::mutex bufferPoolUsersMutex;
+std::multiset<size_t> bufferPoolCapacities;
+
+// Registers an evaluation with the process-wide buffer pool, which is shared
+// by concurrent evaluations and keeps the largest capacity they request. Once
+// the last of them is done, cached buffers are released.
+class ScopedBufferPoolUse {
+ public:
+  explicit ScopedBufferPoolUse(size_t capacity) : capacity_(capacity) {
+    std::lock_guard<std::mutex> lock(bufferPoolUsersMutex);
+    bufferPoolCapacities.insert(capacity);
+    BufferPool::get().setCapacity(*bufferPoolCapacities.rbegin());
+  }
+
+  ~ScopedBufferPoolUse() {
+    std::lock_guard<std::mutex> lock(bufferPoolUsersMutex);
+    bufferPoolCapacities.erase(bufferPoolCapacities.find(capacity_));
+    if (bufferPoolCapacities.empty())
+      return BufferPool::get().releaseCachedMemory();
+    BufferPool::get().setCapacity(*bufferPoolCapacities.rbegin());
+  }
+
+ private:
+  size_t capacity_;
 };
 
 LogicalResult validateEntrySignature(func::FuncOp func,
@@ -138,29 +211,27 @@ LogicalResult validateEntrySignature(func::FuncOp func,
   return success();
 }
 
+// Returns whether all arguments of `func` have static shapes.
+bool hasStaticArguments(func::FuncOp func) {
+  return llvm::all_of(func.getArgumentTypes(), [](Type type) {
+    return llvm::cast<ShapedType>(type).hasStaticShape();
+  });
+}
+
 // Specializes the shapes of arguments in function 'func' based on runtime input
-// values. If all argument types already have static shapes, this function does
-// nothing. Otherwise, it constructs a pipeline of MLIR passes to refine
-// argument shapes using the provided `inputs`.
+// values. It constructs a pipeline of MLIR passes to refine argument shapes
+// using the provided `inputs`.
 //
 // Args:
 //   module: The MLIR module containing the function.
 //   func: The function whose argument shapes need specialization.
-//   inputs: The runtime input values.
+//   refinedTypes: The types of the runtime input values.
 //
 // Returns:
 //   A `LogicalResult` indicating success or failure of the shape
 //   refinement pipeline.
 LogicalResult removeDynamism(ModuleOp module, func::FuncOp func,
-                             ArrayRef<InterpreterValue> inputs) {
-  if (llvm::all_of(func.getArgumentTypes(), [](Type type) {
-        return llvm::cast<ShapedType>(type).hasStaticShape();
-      })) {
-    return success();
-  }
-  SmallVector<Type> refinedTypes = llvm::to_vector(llvm::map_range(
-      inputs, [](InterpreterValue input) { return input.getType(); }));
-
+                             TypeRange refinedTypes) {
   PassManager pm(module.getContext());
   stablehlo::createStablehloRemoveDynamismPipeline(pm, refinedTypes);
   if (failed(pm.run(module))) {
@@ -172,34 +243,244 @@ LogicalResult removeDynamism(ModuleOp module, func::FuncOp func,
 
 }  // namespace
 
-FailureOr<SmallVector<InterpreterValue>> evalModule(
-    ModuleOp module, ArrayRef<InterpreterValue> inputs,
-    const InterpreterConfiguration &config) {
+// A copy of the module of an executable whose entry function is specialized
+// to static argument types, and its own executable.
+struct InterpreterExecutable::Specialization {
+  OwningOpRef<ModuleOp> module;
+  std::unique_ptr<InterpreterExecutable> executable;
+};
+
+InterpreterExecutable::InterpreterExecutable(
+    ModuleOp module, Operation *mainFunc,
+    const InterpreterConfiguration &config)
+    : module_(module),
+      mainFunc_(mainFunc),
+      config_(config),
+      context_(makeEvaluationContext(config)),
+      preparedRegions_(std::make_unique<PreparedRegionCache>(module)),
+      isDynamic_(mainFunc &&
+                 !hasStaticArguments(cast<func::FuncOp>(mainFunc))) {
+  context_.entryFunction = mainFunc;
+  if (mainFunc && !isDynamic_ && config.executionMode == ExecutionMode::Jit)
+    jit_ = JitExecutable::getOrCompile(module, cast<func::FuncOp>(mainFunc));
+  if (isDynamic_)
+    specializations_ = std::make_unique<SpecializationCache<Specialization>>(
+        module.getContext(), config.specializationCacheCapacity,
+        [this](TypeRange refinedTypes) { return specialize(refinedTypes); });
+}
+
+InterpreterExecutable::~InterpreterExecutable() = default;
+
+FailureOr<std::unique_ptr<InterpreterExecutable>> InterpreterExecutable::create(
+    ModuleOp module, const InterpreterConfiguration &config) {
   // Additional error checking at main function boundary.
   // This is most likely user error, where future errors during interpreting are
   // more likely invalid IR or interpreter bugs.
   if (module.getOps<func::FuncOp>().empty())
-    return SmallVector<InterpreterValue>();
+    return std::unique_ptr<InterpreterExecutable>(
+        new InterpreterExecutable(module, nullptr, config));
 
   auto mainFunc = getMainFunction(module, config.mainFunction);
-  if (failed(mainFunc) || failed(removeDynamism(module, *mainFunc, inputs)) ||
-      failed(validateEntrySignature(*mainFunc, inputs))) {
+  if (failed(mainFunc)) return failure();
+  return create(module, *mainFunc, config);
+}
+
+FailureOr<std::unique_ptr<InterpreterExecutable>> InterpreterExecutable::create(
+    ModuleOp module, func::FuncOp entryFunc,
+    const InterpreterConfiguration &config) {
+  return std::unique_ptr<InterpreterExecutable>(
+      new InterpreterExecutable(module, entryFunc, config));
+}
+
+FailureOr<std::shared_ptr<const InterpreterExecutable::Specialization>>
+InterpreterExecutable::getSpecialization(
+    ArrayRef<InterpreterValue> inputs) const {
+  auto mainFunc = cast<func::FuncOp>(mainFunc_);
+  if (mainFunc.getNumArguments() != inputs.size())
+    return mainFunc->emitError()
+           << "incorrect number of arguments specified, provided "
+           << inputs.size() << " inputs but function expected"
+           << mainFunc.getNumArguments();
+
+  SmallVector<Type> refinedTypes = llvm::map_to_vector(
+      inputs, [](const InterpreterValue &input) { return input.getType(); });
+  return specializations_->get(refinedTypes);
+}
+
+FailureOr<std::shared_ptr<const InterpreterExecutable::Specialization>>
+InterpreterExecutable::specialize(TypeRange refinedTypes) const {
+  auto mainFunc = cast<func::FuncOp>(mainFunc_);
+  ModuleOp module = module_;
+  OwningOpRef<ModuleOp> refinedModule = module.clone();
+  auto refinedFunc =
+      refinedModule->lookupSymbol<func::FuncOp>(mainFunc.getSymName());
+  if (failed(removeDynamism(*refinedModule, refinedFunc, refinedTypes)))
     return failure();
+  auto executable = create(*refinedModule, refinedFunc, config_);
+  if (failed(executable)) return failure();
+
+  auto specialization = std::make_shared<Specialization>();
+  specialization->module = std::move(refinedModule);
+  specialization->executable = std::move(*executable);
+  return std::shared_ptr<const Specialization>(std::move(specialization));
+}
+
+FailureOr<SmallVector<InterpreterValue>> InterpreterExecutable::evaluate(
+    ArrayRef<InterpreterValue> inputs) const {
+  if (!mainFunc_) return SmallVector<InterpreterValue>();
+  if (isDynamic_) {
+    auto specialization = getSpecialization(inputs);
+    if (failed(specialization)) return failure();
+    return (*specialization)->executable->evaluate(inputs);
   }
 
-  if (!config.probeInstrumentationDir.empty()) {
+  auto mainFunc = cast<func::FuncOp>(mainFunc_);
+  if (failed(validateEntrySignature(mainFunc, inputs))) return failure();
+
+  if (!config_.probeInstrumentationDir.empty()) {
     llvm::SmallString<128> instrumentationMetadataFile(
-        config.probeInstrumentationDir);
+        config_.probeInstrumentationDir);
     llvm::sys::path::append(instrumentationMetadataFile,
                             stablehlo::numpy::kInstrumentationMetadataFilename);
     if (llvm::sys::fs::remove(instrumentationMetadataFile))
       return emitError(
-          UnknownLoc::get(module.getContext()),
+          UnknownLoc::get(module_.getContext()),
           "Failed to remove existing instrumentation metadata file.");
   }
 
-  DefaultInterpreterFallback fallback(config);
-  return stablehlo::eval(mainFunc->getBody(), inputs, &fallback);
+  ScopedBufferPoolUse bufferPoolUse(config_.bufferPoolCapacity);
+  ScopedEvaluationContext context(context_);
+  DefaultInterpreterFallback fallback(config_);
+  auto results =
+      jit_ ? jit_->evaluate(mainFunc, inputs, fallback)
+           : stablehlo::eval(preparedRegions_->getOrPrepare(mainFunc.getBody()),
+                             SmallVector<InterpreterValue>(inputs), &fallback);
+  if (auto probeStatus = fallback.finishProbes())
+    return emitError(UnknownLoc::get(module_.getContext()),
+                     llvm::toString(std::move(probeStatus)));
+  return results;
+}
+
+FailureOr<SmallVector<SmallVector<InterpreterValue>>>
+InterpreterExecutable::evaluateBatch(
+    ArrayRef<SmallVector<InterpreterValue>> inputs,
+    llvm::ThreadPoolInterface &threadPool) const {
+  // Keeps the buffer pool in use for the whole batch, so that cached buffers
+  // aren't released whenever no evaluation happens to be in progress.
+  ScopedBufferPoolUse bufferPoolUse(config_.bufferPoolCapacity);
+  SmallVector<FailureOr<SmallVector<InterpreterValue>>> results(inputs.size(),
+                                                                failure());
+  llvm::ThreadPoolTaskGroup group(threadPool);
+  for (size_t i = 0; i < inputs.size(); ++i)
+    group.async([&, i]() { results[i] = evaluate(inputs[i]); });
+  group.wait();
+
+  SmallVector<SmallVector<InterpreterValue>> batchResults;
+  for (auto &result : results) {
+    if (failed(result)) return failure();
+    batchResults.push_back(std::move(*result));
+  }
+  return batchResults;
+}
+
+SpecializationStatistics InterpreterExecutable::getSpecializationStatistics()
+    const {
+  if (!specializations_) return {};
+  return specializations_->getStatistics();
+}
+
+FailureOr<SmallVector<InterpreterValue>> evalModule(
+    ModuleOp module, ArrayRef<InterpreterValue> inputs,
+    const InterpreterConfiguration &config) {
+  auto executable = InterpreterExecutable::create(module, config);
+  if (failed(executable)) return failure();
+  return (*executable)->evaluate(inputs);
+}
+
+FailureOr<SmallVector<SmallVector<InterpreterValue>>> evalModuleBatch(
+    ModuleOp module, ArrayRef<SmallVector<InterpreterValue>> inputs,
+    const InterpreterConfiguration &config,
+    llvm::ThreadPoolInterface *threadPool) {
+  auto executable = InterpreterExecutable::create(module, config);
+  if (failed(executable)) return failure();
+
+  std::optional<llvm::DefaultThreadPool> defaultThreadPool;
+  if (!threadPool) {
+    defaultThreadPool.emplace(llvm::hardware_concurrency());
+    threadPool = &*defaultThreadPool;
+  }
+  return (*executable)->evaluateBatch(inputs, *threadPool);
+}
+
+FailureOr<SmallVector<InterpreterValue>> evalModuleWithStreamedInputs(
+    ModuleOp module, ArrayRef<InterpreterValue> inputs,
+    ArrayRef<StreamedInput> streamedInputs,
+    const InterpreterConfiguration &config) {
+  OwningOpRef<ModuleOp> streamedModule = module.clone();
+  auto func = getMainFunction(*streamedModule, config.mainFunction);
+  if (failed(func)) return failure();
+  unsigned numArguments = func->getNumArguments();
+  if (inputs.size() + streamedInputs.size() != numArguments)
+    return func->emitError("expected ")
+           << numArguments << " inputs, got " << inputs.size() << " and "
+           << streamedInputs.size() << " streamed inputs";
+
+  // Every reduce op of a streamed argument is replaced with an argument which
+  // is appended to the entry function and whose input is its result. The
+  // reductions use the native kernels which `config` enables.
+  EvaluationContext context = makeEvaluationContext(config);
+  std::optional<ScopedEvaluationContext> scopedContext(std::in_place, context);
+  SmallVector<InterpreterValue> streamedModuleInputs(inputs);
+  llvm::BitVector streamedArgs(numArguments);
+  for (const auto &streamedInput : streamedInputs) {
+    unsigned argNumber = streamedInput.argNumber;
+    if (argNumber >= numArguments || streamedArgs.test(argNumber))
+      return func->emitError("invalid streamed argument ") << argNumber;
+    streamedArgs.set(argNumber);
+    auto argument = func->getArgument(argNumber);
+    auto type = dyn_cast<RankedTensorType>(argument.getType());
+    if (!type || !type.hasStaticShape())
+      return func->emitError("streamed arguments require static types, got ")
+             << argument.getType();
+
+    SmallVector<ReduceOp> reduceOps;
+    SmallVector<std::unique_ptr<StreamingReduction>> reductions;
+    for (Operation *user : argument.getUsers()) {
+      auto reduceOp = dyn_cast<ReduceOp>(user);
+      auto reduction = reduceOp ? makeStreamingReduction(reduceOp) : nullptr;
+      if (!reduction)
+        return user->emitError(
+            "streamed arguments can only be the single input of reduce ops "
+            "with constant init values and bodies which apply one "
+            "associative op");
+      reduceOps.push_back(reduceOp);
+      reductions.push_back(std::move(reduction));
+    }
+
+    auto status = numpy::readTensorChunks(
+        streamedInput.filename, type, streamedInput.chunkSize,
+        [&](ArrayRef<char> chunk) {
+          for (auto &reduction : reductions) reduction->consume(chunk);
+        });
+    if (status)
+      return func->emitError("failed to stream input file ")
+             << streamedInput.filename << ": "
+             << llvm::toString(std::move(status));
+
+    for (auto [reduceOp, reduction] : llvm::zip(reduceOps, reductions)) {
+      func->insertArgument(func->getNumArguments(),
+                           reduceOp.getResult(0).getType(),
+                           /*argAttrs=*/{}, reduceOp.getLoc());
+      reduceOp.getResult(0).replaceAllUsesWith(
+          func->getArgument(func->getNumArguments() - 1));
+      reduceOp.erase();
+      streamedModuleInputs.push_back(InterpreterValue(reduction->finish()));
+    }
+  }
+  streamedArgs.resize(func->getNumArguments());
+  func->eraseArguments(streamedArgs);
+  scopedContext.reset();
+  return evalModule(*streamedModule, streamedModuleInputs, config);
 }
 
 FailureOr<SmallVector<DenseElementsAttr>> evalModule(
@@ -16,16 +16,23 @@ limitations under the License.
 #ifndef STABLEHLO_REFERENCE_API_H
 #define STABLEHLO_REFERENCE_API_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
 
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/ThreadPool.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/OwningOpRef.h"
+#include "mlir/IR/Types.h"
 #include "mlir/Support/LLVM.h"
 #include "stablehlo/reference/Configuration.h"
+#include "stablehlo/reference/EvaluationContext.h"
 #include "stablehlo/reference/Value.h"
+#include "stablehlo/transforms/SpecializationCache.h"
 
 namespace mlir {
 namespace stablehlo {
@@ -33,11 +40,143 @@ namespace stablehlo {
 /// Invoke the StableHLO reference interpreter with the given parsed MLIR
 /// module input and provided inputs. Returns a list of interpreter outputs.
 /// Can optionally pass a fallback interpreter callback which executes when no
-/// builtin kernels are matched.
+/// builtin kernels are matched. If the entry function has dynamic argument
+/// shapes, a copy of `module` is specialized to the types of `inputs`, see
+/// `InterpreterExecutable`, and `module` itself isn't modified.
 FailureOr<SmallVector<InterpreterValue>> evalModule(
     ModuleOp module, ArrayRef<InterpreterValue> inputs,
     const InterpreterConfiguration &config);
 
+class JitExecutable;
+class PreparedRegionCache;
+
+/// Module prepared for repeated evaluation with the same configuration, e.g.
+/// by fuzzers or benchmarks which evaluate a module many times with different
+/// inputs. Unlike `evalModule`, the entry function is looked up only once, and
+/// the regions of the module are prepared only once, on their first
+/// evaluation, see `PreparedRegionCache`. `module` and `config` must outlive
+/// the executable, and `module` must not be modified while it's alive.
+///
+/// If the entry function has dynamic argument shapes, every evaluation with
+/// inputs of new types specializes a copy of `module` to these types with
+/// `createStablehloRemoveDynamismPipeline` and prepares the copy for repeated
+/// evaluation in turn. The copies are cached by the types of the inputs, see
+/// `SpecializationCache`, so that shape-polymorphic modules run the pipeline
+/// only once per input signature while it stays in the cache, whose capacity
+/// is `config.specializationCacheCapacity`.
+///
+/// With `ExecutionMode::Jit`, the entry function is compiled to native code
+/// once, when the executable is created, see `JitExecutable`.
+class InterpreterExecutable {
+ public:
+  /// Returns failure and emits an error if `module` has no entry function
+  /// according to `config.mainFunction`.
+  static FailureOr<std::unique_ptr<InterpreterExecutable>> create(
+      ModuleOp module, const InterpreterConfiguration &config);
+
+  /// Like `create`, with `entryFunc` of `module` as the entry function rather
+  /// than the function named `config.mainFunction`, e.g. to evaluate several
+  /// functions of a module with the same configuration.
+  static FailureOr<std::unique_ptr<InterpreterExecutable>> create(
+      ModuleOp module, func::FuncOp entryFunc,
+      const InterpreterConfiguration &config);
+
+  ~InterpreterExecutable();
+
+  /// Evaluates the entry function with `inputs`, like `evalModule`. Can be
+  /// called concurrently from multiple threads, provided that `config`
+  /// doesn't serialize probes, whose files would be overwritten by concurrent
+  /// evaluations, and that its fallback is thread-safe. Executables with
+  /// different configurations evaluate concurrently without interfering,
+  /// since every evaluation reads the settings of its configuration from the
+  /// `EvaluationContext` of its executable.
+  FailureOr<SmallVector<InterpreterValue>> evaluate(
+      ArrayRef<InterpreterValue> inputs) const;
+
+  /// Evaluates the entry function once for every element of `inputs`,
+  /// concurrently on `threadPool`, and returns the results in the order of
+  /// `inputs`. The evaluations share the prepared regions, including their
+  /// constants, and the buffer pool, which is released only once all of them
+  /// are done. Returns failure if any evaluation fails. The same restrictions
+  /// as for concurrent calls to `evaluate` apply, and `threadPool` must not
+  /// be `config.processThreadPool`.
+  FailureOr<SmallVector<SmallVector<InterpreterValue>>> evaluateBatch(
+      ArrayRef<SmallVector<InterpreterValue>> inputs,
+      llvm::ThreadPoolInterface &threadPool) const;
+
+  /// Returns the counters of the cache of specializations of an entry
+  /// function with dynamic argument shapes, whose misses are the runs of
+  /// `createStablehloRemoveDynamismPipeline`.
+  SpecializationStatistics getSpecializationStatistics() const;
+
+ private:
+  struct Specialization;
+
+  InterpreterExecutable(ModuleOp module, Operation *mainFunc,
+                        const InterpreterConfiguration &config);
+
+  /// Returns the copy of `module_` specialized to the types of `inputs` and
+  /// its executable, creating them on first use. Returns failure and emits an
+  /// error if the entry function can't be refined to these types.
+  FailureOr<std::shared_ptr<const Specialization>> getSpecialization(
+      ArrayRef<InterpreterValue> inputs) const;
+
+  /// Specializes a copy of `module_` to `refinedTypes` for
+  /// `specializations_`.
+  FailureOr<std::shared_ptr<const Specialization>> specialize(
+      TypeRange refinedTypes) const;
+
+  ModuleOp module_;
+  /// The entry function, or nullptr if `module` has no functions.
+  Operation *mainFunc_;
+  const InterpreterConfiguration &config_;
+  /// The settings of `config_` which are current while evaluating.
+  EvaluationContext context_;
+  std::unique_ptr<PreparedRegionCache> preparedRegions_;
+
+  /// The compiled entry function, or nullptr if it's interpreted.
+  std::shared_ptr<const JitExecutable> jit_;
+
+  /// Whether the entry function has dynamic argument shapes.
+  bool isDynamic_ = false;
+
+  /// Executables of copies of `module_` specialized to the types of the
+  /// inputs of evaluations, if the entry function is dynamic.
+  std::unique_ptr<SpecializationCache<Specialization>> specializations_;
+};
+
+/// Evaluates `module` once for every element of `inputs` with a single
+/// `InterpreterExecutable`, see `InterpreterExecutable::evaluateBatch`. If
+/// `threadPool` is null, a thread pool with one thread per hardware thread is
+/// created for the batch.
+FailureOr<SmallVector<SmallVector<InterpreterValue>>> evalModuleBatch(
+    ModuleOp module, ArrayRef<SmallVector<InterpreterValue>> inputs,
+    const InterpreterConfiguration &config,
+    llvm::ThreadPoolInterface *threadPool = nullptr);
+
+/// Argument of the entry function whose value is read from the NumPy file
+/// `filename` in chunks of at most `chunkSize` bytes rather than loaded into
+/// memory, see `evalModuleWithStreamedInputs`.
+struct StreamedInput {
+  unsigned argNumber;
+  std::string filename;
+  int64_t chunkSize = int64_t{64} << 20;
+};
+
+/// Like `evalModule`, where the arguments of the entry function described by
+/// `streamedInputs` are streamed from files, so that inputs larger than memory
+/// can be reduced, and `inputs` are the other arguments in order. Streamed
+/// arguments must have static shapes and may only be used as the single input
+/// of `reduce` ops with constant init values whose bodies apply one
+/// associative op, e.g. sums and max reductions, see
+/// `makeStreamingReduction`. These ops are evaluated while the files are
+/// read, every file once, and the entry function is then evaluated on a copy
+/// of `module` whose entry function takes their results as arguments instead.
+FailureOr<SmallVector<InterpreterValue>> evalModuleWithStreamedInputs(
+    ModuleOp module, ArrayRef<InterpreterValue> inputs,
+    ArrayRef<StreamedInput> streamedInputs,
+    const InterpreterConfiguration &config);
+
 /// This wrapper is intended to be easily used by the StableHLO Python bindings.
 // It wraps the InterpreterValue API.
 FailureOr<SmallVector<DenseElementsAttr>> evalModule(
@@ -0,0 +1,133 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/BufferPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemAlloc.h"
+#include "mlir/IR/AsmState.h"
+#include "stablehlo/reference/MemoryTracker.h"
+
+namespace mlir {
+namespace stablehlo {
+
+namespace {
+
+constexpr size_t kAlignment = alignof(std::max_align_t);
+
+// Storage of up to 2^kMinSizeClass bytes is allocated from the smallest size
+// class, and storage of more than 2^kMaxSizeClass bytes bypasses the pool.
+// Such large tensors are rare enough for the system allocator to be fine, and
+// rounding them up to a power of two would waste too much memory.
+constexpr unsigned kMinSizeClass = 6;
+constexpr unsigned kMaxSizeClass = 26;
+
+unsigned getSizeClass(size_t size) {
+  return std::max(llvm::Log2_64_Ceil(std::max(size, size_t(1))),
+                  kMinSizeClass);
+}
+
+size_t getCapacity(unsigned sizeClass) { return size_t(1) << sizeClass; }
+
+thread_local uint64_t numBytesAllocatedOnThread = 0;
+
+}  // namespace
+
+BufferPool &BufferPool::get() {
+  // Intentionally leaked, so that tensors destroyed during static destruction
+  // can still return their storage.
+  static BufferPool *pool = new BufferPool();
+  return *pool;
+}
+
+AsmResourceBlob BufferPool::allocate(size_t size) {
+  numBytesAllocatedOnThread += size;
+  llvm::unique_function<void()> release;
+  if (auto *tracker = getMemoryTracker()) release = tracker->track(size);
+  auto sizeClass = getSizeClass(size);
+  if (sizeClass > kMaxSizeClass) {
+    if (!release) return HeapAsmResourceBlob::allocate(size, kAlignment);
+    void *data = llvm::allocate_buffer(size, kAlignment);
+    return AsmResourceBlob(
+        ArrayRef<char>(static_cast<char *>(data), size), kAlignment,
+        [release = std::move(release)](void *data, size_t size,
+                                       size_t alignment) mutable {
+          release();
+          llvm::deallocate_buffer(data, size, alignment);
+        },
+        /*dataIsMutable=*/true);
+  }
+
+  void *data = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sizeClass < freeLists_.size() && !freeLists_[sizeClass].empty()) {
+      data = freeLists_[sizeClass].pop_back_val();
+      cachedBytes_ -= getCapacity(sizeClass);
+    }
+  }
+  if (!data) data = llvm::allocate_buffer(getCapacity(sizeClass), kAlignment);
+
+  return AsmResourceBlob(
+      ArrayRef<char>(static_cast<char *>(data), size), kAlignment,
+      [this, sizeClass, release = std::move(release)](void *data, size_t,
+                                                      size_t) mutable {
+        if (release) release();
+        deallocate(data, sizeClass);
+      },
+      /*dataIsMutable=*/true);
+}
+
+uint64_t BufferPool::getNumBytesAllocatedOnThread() {
+  return numBytesAllocatedOnThread;
+}
+
+void BufferPool::setCapacity(size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+}
+
+void BufferPool::releaseCachedMemory() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (unsigned sizeClass = 0; sizeClass < freeLists_.size(); ++sizeClass) {
+    for (auto *data : freeLists_[sizeClass])
+      llvm::deallocate_buffer(data, getCapacity(sizeClass), kAlignment);
+    freeLists_[sizeClass].clear();
+  }
+  cachedBytes_ = 0;
+}
+
+void BufferPool::deallocate(void *data, unsigned sizeClass) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cachedBytes_ + getCapacity(sizeClass) <= capacity_) {
+      if (sizeClass >= freeLists_.size()) freeLists_.resize(sizeClass + 1);
+      freeLists_[sizeClass].push_back(data);
+      cachedBytes_ += getCapacity(sizeClass);
+      return;
+    }
+  }
+  llvm::deallocate_buffer(data, getCapacity(sizeClass), kAlignment);
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
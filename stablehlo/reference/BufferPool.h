@@ -0,0 +1,76 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_BUFFERPOOL_H
+#define STABLEHLO_REFERENCE_BUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/AsmState.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Process-wide pool of memory for the storage of interpreter tensors.
+/// Allocations are rounded up to power-of-two size classes. When the last
+/// reference to a tensor goes away, its storage is returned to the free list
+/// of its size class, so that subsequent tensors of similar sizes (e.g. the
+/// intermediates of every iteration of a `while` loop) reuse it instead of
+/// going through the system allocator. Allocations are accounted for by the
+/// `MemoryTracker` of the current `EvaluationContext`, if any. The pool is
+/// thread-safe.
+class BufferPool {
+ public:
+  /// Default value for `setCapacity`.
+  static constexpr size_t kDefaultCapacity = size_t(1) << 30;
+
+  /// Returns the process-wide pool.
+  static BufferPool &get();
+
+  /// Returns a mutable blob of `size` bytes aligned to
+  /// `alignof(std::max_align_t)`. The contents of the blob are unspecified.
+  AsmResourceBlob allocate(size_t size);
+
+  /// Sets the maximum number of bytes kept in free lists. Storage released
+  /// beyond that is returned to the system allocator, and zero disables
+  /// caching altogether. Shrinking the capacity doesn't release memory which
+  /// is already cached, see `releaseCachedMemory`.
+  void setCapacity(size_t capacity);
+
+  /// Returns all memory kept in free lists to the system allocator.
+  void releaseCachedMemory();
+
+  /// Returns the number of bytes which `allocate` has returned on the calling
+  /// thread so far, e.g. to attribute allocations to the ops which make them.
+  static uint64_t getNumBytesAllocatedOnThread();
+
+ private:
+  BufferPool() = default;
+
+  void deallocate(void *data, unsigned sizeClass);
+
+  std::mutex mutex_;
+  SmallVector<SmallVector<void *>> freeLists_;
+  size_t cachedBytes_ = 0;
+  size_t capacity_ = kDefaultCapacity;
+};
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_BUFFERPOOL_H
@@ -0,0 +1,240 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/Checkpoint.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Operation.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/reference/Errors.h"
+#include "stablehlo/reference/EvaluationContext.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Token.h"
+#include "stablehlo/reference/Value.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+constexpr StringLiteral kMagic = "STABLEHLO_CHECKPOINT_V1\n";
+constexpr StringLiteral kExtension = ".ckpt";
+
+// Size written in place of the bytes of tokens, which have no storage.
+constexpr int64_t kTokenSize = -1;
+
+// Returns the name of the function of `whileOp` followed by the positions of
+// `whileOp` and of its ancestors in their blocks (and of their regions in
+// their ops, for ops with multiple regions), or nullopt if `whileOp` is
+// nested in another loop.
+std::optional<std::string> getLoopPosition(Operation &whileOp) {
+  SmallVector<std::string> positions;
+  Operation *op = &whileOp;
+  while (!isa<func::FuncOp>(op)) {
+    Block *block = op->getBlock();
+    Operation *parent = op->getParentOp();
+    if (!block || !parent || isa<WhileOp>(parent)) return std::nullopt;
+    positions.push_back(
+        std::to_string(std::distance(block->begin(), op->getIterator())));
+    if (parent->getNumRegions() > 1)
+      positions.push_back(
+          std::to_string(block->getParent()->getRegionNumber()));
+    op = parent;
+  }
+
+  std::string result = cast<func::FuncOp>(op).getSymName().str();
+  for (auto &position : llvm::reverse(positions)) result += "." + position;
+  return result;
+}
+
+std::string getCheckpointFilename(StringRef directory, StringRef key,
+                                  int64_t iteration) {
+  llvm::SmallString<128> path(directory);
+  llvm::sys::path::append(path,
+                          key + "-" + std::to_string(iteration) + kExtension);
+  return path.str().str();
+}
+
+// Returns the iteration of the latest checkpoint of the loop `key` in
+// `directory`, if any.
+std::optional<int64_t> findLatestCheckpoint(StringRef directory,
+                                            StringRef key) {
+  std::optional<int64_t> latest;
+  std::error_code ec;
+  std::string prefix = (key + "-").str();
+  for (llvm::sys::fs::directory_iterator it(directory, ec), end;
+       it != end && !ec; it.increment(ec)) {
+    StringRef filename = llvm::sys::path::filename(it->path());
+    if (!filename.consume_front(prefix) || !filename.consume_back(kExtension))
+      continue;
+    int64_t iteration;
+    if (filename.getAsInteger(10, iteration)) continue;
+    if (!latest || iteration > *latest) latest = iteration;
+  }
+  return latest;
+}
+
+void writeInt(raw_ostream &os, int64_t value) {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+bool readInt(StringRef &data, int64_t &value) {
+  if (data.size() < sizeof(value)) return false;
+  std::memcpy(&value, data.data(), sizeof(value));
+  data = data.drop_front(sizeof(value));
+  return true;
+}
+
+// Reads the checkpoint `filename` into `loop` and `values`, whose types must
+// match those of the checkpoint.
+llvm::Error readCheckpoint(StringRef filename, MLIRContext *context,
+                           Checkpointer::Loop &loop,
+                           SmallVector<InterpreterValue> &values) {
+  auto buffer = llvm::MemoryBuffer::getFile(filename);
+  if (!buffer)
+    return invalidArgument("Failed to read checkpoint %s: %s",
+                           filename.str().c_str(),
+                           buffer.getError().message().c_str());
+
+  StringRef data = (*buffer)->getBuffer();
+  int64_t finished, numValues;
+  if (!data.consume_front(kMagic) || !readInt(data, loop.iteration) ||
+      !readInt(data, finished) || !readInt(data, numValues))
+    return invalidArgument("Malformed checkpoint %s", filename.str().c_str());
+  if (numValues != static_cast<int64_t>(values.size()))
+    return invalidArgument("Checkpoint %s has %ld values, expected %zu",
+                           filename.str().c_str(), (long)numValues,
+                           values.size());
+
+  for (auto &value : values) {
+    int64_t size;
+    if (!readInt(data, size) || size > static_cast<int64_t>(data.size()))
+      return invalidArgument("Malformed checkpoint %s", filename.str().c_str());
+    if (size == kTokenSize) {
+      if (!value.isToken())
+        return invalidArgument("Checkpoint %s doesn't match the loop",
+                               filename.str().c_str());
+      continue;
+    }
+
+    auto tensor = deserializeTensorBytes(data.take_front(size), context);
+    if (!tensor) return tensor.takeError();
+    if (!value.isTensor() || tensor->getType() != value.getType())
+      return invalidArgument("Checkpoint %s doesn't match the loop",
+                             filename.str().c_str());
+    value = InterpreterValue(*tensor);
+    data = data.drop_front(size);
+  }
+
+  loop.finished = finished != 0;
+  loop.savedIteration = loop.iteration;
+  return llvm::Error::success();
+}
+
+}  // namespace
+
+Checkpointer::Checkpointer(StringRef directory, int64_t interval, bool keepAll,
+                           bool resume)
+    : directory_(directory.str()),
+      interval_(interval),
+      keepAll_(keepAll),
+      resume_(resume) {}
+
+std::optional<Checkpointer::Loop> Checkpointer::beginLoop(
+    Operation &whileOp, Process *process,
+    SmallVector<InterpreterValue> &values) {
+  if (process) return std::nullopt;
+  if (llvm::any_of(values, [](auto &value) { return value.isTuple(); }))
+    return std::nullopt;
+  auto position = getLoopPosition(whileOp);
+  if (!position) return std::nullopt;
+
+  Loop loop;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loop.key = *position + "@" + std::to_string(occurrences_[*position]++);
+  }
+  if (!resume_) return loop;
+
+  auto iteration = findLatestCheckpoint(directory_, loop.key);
+  if (!iteration) return loop;
+  auto filename = getCheckpointFilename(directory_, loop.key, *iteration);
+  if (auto status =
+          readCheckpoint(filename, whileOp.getContext(), loop, values))
+    llvm::report_fatal_error(std::move(status));
+  return loop;
+}
+
+void Checkpointer::endIteration(Loop &loop, ArrayRef<InterpreterValue> values) {
+  ++loop.iteration;
+  if (interval_ > 0 && loop.iteration % interval_ == 0)
+    save(loop, /*finished=*/false, values);
+}
+
+void Checkpointer::endLoop(Loop &loop, ArrayRef<InterpreterValue> values) {
+  if (!loop.finished) save(loop, /*finished=*/true, values);
+}
+
+void Checkpointer::save(Loop &loop, bool finished,
+                        ArrayRef<InterpreterValue> values) {
+  auto filename = getCheckpointFilename(directory_, loop.key, loop.iteration);
+  // Writes to a temporary file which is renamed once it's complete.
+  auto status = llvm::writeToOutput(filename, [&](raw_ostream &os) {
+    os << kMagic;
+    writeInt(os, loop.iteration);
+    writeInt(os, finished);
+    writeInt(os, values.size());
+    for (auto &value : values) {
+      if (value.isToken()) {
+        writeInt(os, kTokenSize);
+        continue;
+      }
+      auto bytes = serializeTensorBytes(value.getTensor());
+      writeInt(os, bytes.size());
+      os << bytes;
+    }
+    return llvm::Error::success();
+  });
+  if (status)
+    llvm::report_fatal_error(invalidArgument(
+        "Failed to write checkpoint %s: %s", filename.c_str(),
+        llvm::toString(std::move(status)).c_str()));
+
+  if (!keepAll_ && loop.savedIteration >= 0 &&
+      loop.savedIteration != loop.iteration)
+    llvm::sys::fs::remove(
+        getCheckpointFilename(directory_, loop.key, loop.savedIteration));
+  loop.savedIteration = loop.iteration;
+}
+
+Checkpointer *getCheckpointer() { return getEvaluationContext().checkpointer; }
+
+}  // namespace stablehlo
+}  // namespace mlir
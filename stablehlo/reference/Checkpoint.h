@@ -0,0 +1,114 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_CHECKPOINT_H
+#define STABLEHLO_REFERENCE_CHECKPOINT_H
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/LLVM.h"
+#include "stablehlo/reference/Value.h"
+
+namespace mlir {
+namespace stablehlo {
+
+class Process;
+
+/// Saves the loop-carried values of `while` loops to files at iteration
+/// boundaries while it is set in the `EvaluationContext`, and resumes loops
+/// from these files, so that long evaluations can continue after the process
+/// dies and numerical divergences can be bisected from the middle of a loop.
+///
+/// Only loops which aren't nested in other loops and aren't evaluated by the
+/// processes of `interpreter.run_parallel` are checkpointed. Values defined
+/// outside of a loop aren't saved: the ops before a loop are evaluated again
+/// when resuming, which is deterministic, and loops which finished before
+/// the process died are skipped by restoring their results from their last
+/// checkpoint. A loop is identified by its position in its function and by
+/// how many times it was evaluated before, so resuming requires the same
+/// module and inputs.
+///
+/// Every checkpoint is a file `<function>.<positions>@<occurrence>-
+/// <iteration>.ckpt` with the iteration count, whether the loop finished and
+/// the loop-carried values, whose storage is written as raw bytes like
+/// `serializeTensorBytes`. Files are written to a temporary file first and
+/// then renamed, so that a checkpoint is never partially written.
+class Checkpointer {
+ public:
+  /// Checkpoints are written to `directory` every `interval` iterations, and
+  /// once a loop finishes. If `keepAll`, earlier checkpoints of a loop are
+  /// kept rather than removed, so that evaluation can be resumed from any of
+  /// them by removing the later ones. If `resume`, loops continue from the
+  /// latest checkpoint in `directory`, if any.
+  Checkpointer(StringRef directory, int64_t interval, bool keepAll,
+               bool resume);
+
+  /// State of a loop which is checkpointed.
+  struct Loop {
+    /// Prefix of the files of the checkpoints of the loop.
+    std::string key;
+    /// Number of iterations evaluated so far.
+    int64_t iteration = 0;
+    /// Whether the loop was restored from a checkpoint of its last iteration
+    /// and doesn't need to be evaluated.
+    bool finished = false;
+    /// Iteration of the last checkpoint of the loop, or -1 if there is none.
+    int64_t savedIteration = -1;
+  };
+
+  /// Begins the evaluation of `whileOp` with loop-carried `values`. Returns
+  /// nullopt if the loop isn't checkpointed. If resuming and the loop has a
+  /// checkpoint, `values` are replaced with the values of the checkpoint.
+  /// Fails fatally if the checkpoint can't be read or doesn't match the
+  /// loop.
+  std::optional<Loop> beginLoop(Operation &whileOp, Process *process,
+                                SmallVector<InterpreterValue> &values);
+
+  /// Records that `loop` evaluated another iteration which resulted in
+  /// `values`, and saves a checkpoint if it's due.
+  void endIteration(Loop &loop, ArrayRef<InterpreterValue> values);
+
+  /// Records that `loop` finished with `values` and saves its last
+  /// checkpoint.
+  void endLoop(Loop &loop, ArrayRef<InterpreterValue> values);
+
+ private:
+  void save(Loop &loop, bool finished, ArrayRef<InterpreterValue> values);
+
+  std::string directory_;
+  int64_t interval_;
+  bool keepAll_;
+  bool resume_;
+
+  /// Guards `occurrences_`.
+  std::mutex mutex_;
+  /// Number of evaluations of every loop so far, by the position of the loop.
+  llvm::StringMap<int64_t> occurrences_;
+};
+
+/// Returns the checkpointer which `whileOp` saves and restores loops with
+/// according to the current `EvaluationContext`, or nullptr if there is none.
+Checkpointer *getCheckpointer();
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_CHECKPOINT_H
@@ -16,8 +16,20 @@ limitations under the License.
 #ifndef STABLEHLO_REFERENCE_CONFIGURATION_H
 #define STABLEHLO_REFERENCE_CONFIGURATION_H
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
 #include "llvm/Support/Error.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "stablehlo/reference/BufferPool.h"
+#include "stablehlo/reference/Checkpoint.h"
+#include "stablehlo/reference/KernelRegistry.h"
+#include "stablehlo/reference/MemoryTracker.h"
+#include "stablehlo/reference/NumericsChecker.h"
 #include "stablehlo/reference/Process.h"
+#include "stablehlo/reference/Profiler.h"
 #include "stablehlo/reference/Scope.h"
 
 namespace mlir {
@@ -35,6 +47,16 @@ class InterpreterFallback {
   virtual ~InterpreterFallback() = default;
 };
 
+/// How `evalModule` and `InterpreterExecutable` evaluate the entry function.
+enum class ExecutionMode {
+  /// Evaluate ops one at a time with the reference interpreter.
+  Interpreter,
+
+  /// Compile the entry function to native code, see `JitExecutable`. Entry
+  /// functions which can't be compiled are evaluated with the interpreter.
+  Jit,
+};
+
 struct InterpreterConfiguration {
   InterpreterConfiguration()
       : fallback(std::make_unique<InterpreterFallback>()) {}
@@ -43,6 +65,20 @@ struct InterpreterConfiguration {
   /// be serialized to disk.
   std::string probeInstrumentationDir = "";
 
+  /// Number of tensors of `interpreter.probe` ops which wait to be serialized
+  /// on a background thread before evaluation waits for them. Zero serializes
+  /// them during evaluation.
+  size_t probeQueueCapacity = 16;
+
+  /// Only every `probeSamplingInterval`-th tensor of every probe ID, starting
+  /// with the first, is serialized, e.g. to probe only some iterations of a
+  /// loop.
+  int64_t probeSamplingInterval = 1;
+
+  /// If true, tensors of `interpreter.probe` ops are appended to a single
+  /// container file instead of one NumPy file each. See `ProbeWriter`.
+  bool probeContainer = false;
+
   /// Use the specified named function as the main entrypoint into a module.
   /// Defaults to `main` for modules with multiple functions. If a module only
   /// contains 1 function and the default `main` value is used, the singular
@@ -50,6 +86,129 @@ struct InterpreterConfiguration {
   /// match).
   std::string mainFunction = "main";
 
+  /// Whether the entry function is interpreted or compiled, see
+  /// `ExecutionMode`. Other functions, e.g. the programs of
+  /// `interpreter.run_parallel`, are always interpreted.
+  ExecutionMode executionMode = ExecutionMode::Interpreter;
+
+  /// Maximum number of specializations of an entry function with dynamic
+  /// argument shapes which an `InterpreterExecutable` keeps, one per input
+  /// signature, beyond which the least recently used ones are evicted. Zero
+  /// keeps all of them.
+  size_t specializationCacheCapacity = 64;
+
+  /// If false, ops are always evaluated one `Element` at a time, bypassing
+  /// the native kernels from Kernels.h. Useful to check native kernels against
+  /// the reference semantics.
+  bool enableNativeKernels = true;
+
+  /// If true, native kernels which accumulate values, like the one for
+  /// `dot_general`, produce bit-exact results with the `Element`-based
+  /// implementations at the cost of some performance.
+  bool exactAccumulation = false;
+
+  /// If true, native kernels for sums over many elements, like the one for
+  /// `reduce`, add them pairwise instead of one after another, which is more
+  /// accurate but deviates from the `Element`-based implementations. Ignored
+  /// if `exactAccumulation` is true.
+  bool pairwiseSummation = false;
+
+  /// Maximum number of bytes of storage released by tensors that is cached
+  /// for reuse by subsequently allocated tensors during evaluation. The cache
+  /// is emptied once evaluation finishes. Zero disables caching. Concurrent
+  /// evaluations share the cache, which keeps the largest of their
+  /// capacities.
+  size_t bufferPoolCapacity = BufferPool::kDefaultCapacity;
+
+  /// If set, ops with large outputs, like elementwise ops, `dot_general`,
+  /// `convolution`, `gather`, `transpose` and `reduce`, split them into chunks
+  /// which are evaluated in parallel on this thread pool. The thread pool is
+  /// not owned and must outlive the evaluation, and it can be shared with
+  /// other evaluations.
+  llvm::ThreadPoolInterface *intraOpThreadPool = nullptr;
+
+  /// If true and `intraOpThreadPool` is set, ops of a region which don't
+  /// depend on each other, e.g. independent attention heads, are evaluated
+  /// concurrently on `intraOpThreadPool` as well. Ops with side effects keep
+  /// their order.
+  bool dataflowExecution = false;
+
+  /// How long processes of `interpreter.run_parallel` wait for each other in
+  /// collectives, `send` and `recv` before evaluation fails with a fatal
+  /// error. Zero waits indefinitely.
+  std::chrono::milliseconds collectiveTimeout = ProcessGrid::kDefaultTimeout;
+
+  /// If set and it has at least as many threads as the processes of an
+  /// `interpreter.run_parallel`, the processes are evaluated on this thread
+  /// pool, which avoids creating threads for every `interpreter.run_parallel`.
+  /// Otherwise, a thread pool with one thread per process is created for the
+  /// evaluation. The thread pool is not owned, must outlive the evaluation and
+  /// must not be shared with `intraOpThreadPool`, since every process blocks
+  /// its thread while it waits for the others.
+  llvm::ThreadPoolInterface *processThreadPool = nullptr;
+
+  /// If true, the threads evaluating processes of `interpreter.run_parallel`
+  /// are pinned to the available CPUs round-robin, which keeps the storage of
+  /// every process in the caches of its CPU. Only supported on Linux.
+  bool pinProcessThreads = false;
+
+  /// If set, the processes of `interpreter.run_parallel` are distributed over
+  /// multiple hosts, each of which evaluates the same module with its own
+  /// transport, and this host only evaluates the processes which are local
+  /// according to the transport. Not owned, must outlive the evaluation.
+  ProcessTransport *processTransport = nullptr;
+
+  /// If set, `infeed` ops pull entries from this callback once the entries of
+  /// the `infeed` attribute of `interpreter.run_parallel` are exhausted, so
+  /// that the feed doesn't have to be materialized upfront.
+  InfeedProducer infeedProducer;
+
+  /// If set, `outfeed` ops pass their inputs to this callback instead of
+  /// accumulating them in memory. See `OutfeedConsumer`.
+  OutfeedConsumer outfeedConsumer;
+
+  /// Number of messages which every `send`/`recv` channel of
+  /// `interpreter.run_parallel` buffers before `send` waits for a `recv`.
+  /// Zero makes every `send` wait for its `recv`.
+  size_t channelDepth = 0;
+
+  /// If set, the time which moving data between the processes of
+  /// `interpreter.run_parallel` takes is estimated with this model in the
+  /// communication statistics. See `LinkModel`.
+  LinkModel linkModel;
+
+  /// If set, the bytes moved, wait times and skews of the collectives of
+  /// every `interpreter.run_parallel`, and the messages, bytes and wait times
+  /// of its `send`/`recv` channels, are printed to this stream at its end.
+  llvm::raw_ostream *communicationStatisticsStream = nullptr;
+
+  /// If set, the ops which the evaluation evaluates are recorded with this
+  /// profiler. See `Profiler`. Not owned, must outlive the evaluation.
+  Profiler *profiler = nullptr;
+
+  /// If set, the results of the ops which the evaluation evaluates are
+  /// scanned for NaN and infinite values with this checker, which reports the
+  /// first op producing them. See `NumericsChecker`. Not owned, must outlive
+  /// the evaluation.
+  NumericsChecker *numericsChecker = nullptr;
+
+  /// If set, the storage of the tensors which the evaluation allocates is
+  /// accounted for by this tracker, which also enforces its memory limit.
+  /// See `MemoryTracker`. Not owned, must outlive the evaluation.
+  MemoryTracker *memoryTracker = nullptr;
+
+  /// If set, `while` loops save their loop-carried values to checkpoints and
+  /// resume from them with this checkpointer. See `Checkpointer`. Not owned,
+  /// must outlive the evaluation, and must not be shared by concurrent
+  /// evaluations, which would count the evaluations of loops together.
+  Checkpointer *checkpointer = nullptr;
+
+  /// If set, `custom_call` ops and `composite` ops whose call target or name
+  /// has a kernel in this registry are evaluated with it, rather than with
+  /// `fallback` or their decomposition. See `KernelRegistry`. Not owned, must
+  /// outlive the evaluation.
+  KernelRegistry *kernelRegistry = nullptr;
+
   /// If specified, use the callback to run on ops which do not have a
   /// registered kernel.
   std::unique_ptr<InterpreterFallback> fallback;
@@ -15,7 +15,10 @@ limitations under the License.
 
 #include "stablehlo/reference/Element.h"
 
+#include <cmath>
 #include <complex>
+#include <optional>
+#include <type_traits>
 
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APSInt.h"
@@ -105,6 +108,11 @@ Element mapWithUpcastToDouble(const Element &el, FloatFn floatFn,
                               ComplexFn complexFn) {
   auto type = el.getType();
 
+  if (auto *value = el.getNativeFloatValue<float>())
+    return Element(type, static_cast<float>(floatFn(*value)));
+  if (auto *value = el.getNativeFloatValue<double>())
+    return Element(type, static_cast<double>(floatFn(*value)));
+
   if (isSupportedFloatType(type))
     return convert(type, floatFn(el.getFloatValue().convertToDouble()));
 
@@ -126,6 +134,11 @@ Element mapWithUpcastToDouble(const Element &lhs, const Element &rhs,
                                        debugString(lhs.getType()).c_str(),
                                        debugString(rhs.getType()).c_str()));
 
+  if (auto result = mapNativeFloat(lhs, rhs, [&](auto x, auto y) {
+        return static_cast<decltype(x)>(floatFn(x, y));
+      }))
+    return *result;
+
   if (isSupportedFloatType(type)) {
     return convert(type, floatFn(lhs.getFloatValue().convertToDouble(),
                                  rhs.getFloatValue().convertToDouble()));
@@ -145,6 +158,39 @@ Element mapWithUpcastToDouble(const Element &lhs, const Element &rhs,
                                      debugString(type).c_str()));
 }
 
+// Evaluates `fn` on the native values of `el` if it is an f32 or f64
+// element, see `Element::getNativeFloatValue`, and returns std::nullopt
+// otherwise.
+template <typename Fn>
+std::optional<Element> mapNativeFloat(const Element &el, Fn fn) {
+  if (auto *value = el.getNativeFloatValue<float>())
+    return Element(el.getType(), fn(*value));
+  if (auto *value = el.getNativeFloatValue<double>())
+    return Element(el.getType(), fn(*value));
+  return std::nullopt;
+}
+
+// Binary counterpart of the above, which evaluates `fn` if `lhs` and `rhs`
+// are both f32 or both f64 elements. `fn` returns a value of the same native
+// type, or a bool for comparisons, whose result is an i1 element.
+template <typename Fn>
+std::optional<Element> mapNativeFloat(const Element &lhs, const Element &rhs,
+                                      Fn fn) {
+  auto makeElement = [&](auto result) {
+    if constexpr (std::is_same_v<decltype(result), bool>)
+      return Element(IntegerType::get(lhs.getType().getContext(), 1), result);
+    else
+      return Element(lhs.getType(), result);
+  };
+  if (auto *lhsValue = lhs.getNativeFloatValue<float>())
+    if (auto *rhsValue = rhs.getNativeFloatValue<float>())
+      return makeElement(fn(*lhsValue, *rhsValue));
+  if (auto *lhsValue = lhs.getNativeFloatValue<double>())
+    if (auto *rhsValue = rhs.getNativeFloatValue<double>())
+      return makeElement(fn(*lhsValue, *rhsValue));
+  return std::nullopt;
+}
+
 // Checks if two APFloat values, f and g, are almost equal.
 bool areApproximatelyEqual(APFloat f, APFloat g) {
   if (&f.getSemantics() != &g.getSemantics()) return false;
@@ -208,6 +254,27 @@ Element::Element(Type type, APFloat value) {
     report_fatal_error(invalidArgument(
         "Semantics mismatch between provided type and float value"));
   type_ = type;
+  if (type.isF32())
+    value_ = value.convertToFloat();
+  else if (type.isF64())
+    value_ = value.convertToDouble();
+  else
+    value_ = value;
+}
+
+Element::Element(Type type, float value) {
+  if (!type.isF32())
+    report_fatal_error(invalidArgument("Unsupported element type: %s",
+                                       debugString(type).c_str()));
+  type_ = type;
+  value_ = value;
+}
+
+Element::Element(Type type, double value) {
+  if (!type.isF64())
+    report_fatal_error(invalidArgument("Unsupported element type: %s",
+                                       debugString(type).c_str()));
+  type_ = type;
   value_ = value;
 }
 
@@ -249,6 +316,8 @@ APFloat Element::getFloatValue() const {
   if (!isSupportedFloatType(type_))
     llvm::report_fatal_error("Element is not a floating-point");
 
+  if (auto *value = getNativeFloatValue<float>()) return APFloat(*value);
+  if (auto *value = getNativeFloatValue<double>()) return APFloat(*value);
   return std::get<APFloat>(value_);
 }
 
@@ -323,6 +392,9 @@ Element Element::operator&(const Element &other) const {
 }
 
 Element Element::operator*(const Element &other) const {
+  if (auto result = mapNativeFloat(
+          *this, other, [](auto lhs, auto rhs) { return lhs * rhs; }))
+    return *result;
   return map(
       *this, other, [](APInt lhs, APInt rhs) { return lhs * rhs; },
       [](bool lhs, bool rhs) -> bool { return lhs & rhs; },
@@ -336,6 +408,9 @@ Element Element::operator*(const Element &other) const {
 }
 
 Element Element::operator+(const Element &other) const {
+  if (auto result = mapNativeFloat(
+          *this, other, [](auto lhs, auto rhs) { return lhs + rhs; }))
+    return *result;
   return map(
       *this, other, [](APInt lhs, APInt rhs) { return lhs + rhs; },
       [](bool lhs, bool rhs) -> bool { return lhs | rhs; },
@@ -349,6 +424,8 @@ Element Element::operator+(const Element &other) const {
 }
 
 Element Element::operator-() const {
+  if (auto result = mapNativeFloat(*this, [](auto val) { return -val; }))
+    return *result;
   return map(
       *this, [&](APInt val) { return -val; },
       [](bool val) -> bool {
@@ -359,6 +436,9 @@ Element Element::operator-() const {
 }
 
 Element Element::operator-(const Element &other) const {
+  if (auto result = mapNativeFloat(
+          *this, other, [](auto lhs, auto rhs) { return lhs - rhs; }))
+    return *result;
   return map(
       *this, other, [](APInt lhs, APInt rhs) { return lhs - rhs; },
       [](bool lhs, bool rhs) -> bool {
@@ -374,6 +454,10 @@ Element Element::operator-(const Element &other) const {
 }
 
 Element Element::operator/(const Element &other) const {
+  if (auto result = mapNativeFloat(
+          *this, other, [](auto lhs, auto rhs) { return lhs / rhs; }))
+    return *result;
+
   auto lhs = *this;
   auto rhs = other;
 
@@ -419,6 +503,10 @@ Element Element::operator/(const Element &other) const {
 }
 
 Element Element::operator<(const Element &other) const {
+  if (auto result = mapNativeFloat(
+          *this, other, [](auto lhs, auto rhs) { return lhs < rhs; }))
+    return *result;
+
   auto type = other.getType();
   auto i1Type = IntegerType::get(getType().getContext(), 1);
   if (type_ != type)
@@ -455,6 +543,10 @@ Element Element::operator<=(const Element &other) const {
 }
 
 Element Element::operator==(const Element &other) const {
+  if (auto result = mapNativeFloat(
+          *this, other, [](auto lhs, auto rhs) { return lhs == rhs; }))
+    return *result;
+
   auto type = other.getType();
   auto i1Type = IntegerType::get(getType().getContext(), 1);
   if (type_ != type)
@@ -492,6 +584,10 @@ Element Element::operator==(const Element &other) const {
 }
 
 Element Element::operator>(const Element &other) const {
+  if (auto result = mapNativeFloat(
+          *this, other, [](auto lhs, auto rhs) { return lhs > rhs; }))
+    return *result;
+
   auto type = other.getType();
   auto i1Type = IntegerType::get(getType().getContext(), 1);
   if (type_ != type)
@@ -578,6 +674,9 @@ Element abs(const Element &el) {
     return Element(type, intEl.abs());
   }
 
+  if (auto result = mapNativeFloat(el, [](auto val) { return std::fabs(val); }))
+    return *result;
+
   if (isSupportedFloatType(type)) {
     auto elVal = el.getFloatValue();
     return Element(type, llvm::abs(elVal));
@@ -693,6 +792,9 @@ Element cbrt(const Element &el) {
 }
 
 Element ceil(const Element &el) {
+  if (auto result = mapNativeFloat(el, [](auto val) { return std::ceil(val); }))
+    return *result;
+
   APFloat val = el.getFloatValue();
   val.roundToIntegral(APFloat::rmTowardPositive);
   return Element(el.getType(), val);
@@ -816,6 +918,10 @@ Element exponentialMinusOne(const Element &el) {
 }
 
 Element floor(const Element &el) {
+  if (auto result =
+          mapNativeFloat(el, [](auto val) { return std::floor(val); }))
+    return *result;
+
   APFloat val = el.getFloatValue();
   val.roundToIntegral(APFloat::rmTowardNegative);
   return Element(el.getType(), val);
@@ -867,6 +973,15 @@ Element logistic(const Element &el) {
 }
 
 Element max(const Element &e1, const Element &e2) {
+  // Matches llvm::maximum: propagates NaNs and orders -0.0 before +0.0.
+  if (auto result = mapNativeFloat(e1, e2, [](auto lhs, auto rhs) {
+        if (std::isnan(lhs)) return lhs;
+        if (std::isnan(rhs)) return rhs;
+        if (lhs == 0 && rhs == 0 && std::signbit(lhs) != std::signbit(rhs))
+          return std::signbit(lhs) ? rhs : lhs;
+        return lhs < rhs ? rhs : lhs;
+      }))
+    return *result;
   return map(
       e1, e2,
       [&](APInt lhs, APInt rhs) {
@@ -885,6 +1000,15 @@ Element max(const Element &e1, const Element &e2) {
 }
 
 Element min(const Element &e1, const Element &e2) {
+  // Matches llvm::minimum: propagates NaNs and orders -0.0 before +0.0.
+  if (auto result = mapNativeFloat(e1, e2, [](auto lhs, auto rhs) {
+        if (std::isnan(lhs)) return lhs;
+        if (std::isnan(rhs)) return rhs;
+        if (lhs == 0 && rhs == 0 && std::signbit(lhs) != std::signbit(rhs))
+          return std::signbit(lhs) ? lhs : rhs;
+        return rhs < lhs ? rhs : lhs;
+      }))
+    return *result;
   return map(
       e1, e2,
       [&](APInt lhs, APInt rhs) {
@@ -1011,6 +1135,10 @@ Element reducePrecision(const Element &el, int32_t exponentBits,
 }
 
 Element rem(const Element &e1, const Element &e2) {
+  // std::fmod is exact like APFloat::mod.
+  if (auto result = mapNativeFloat(
+          e1, e2, [](auto lhs, auto rhs) { return std::fmod(lhs, rhs); }))
+    return *result;
   return map(
       e1, e2,
       [&](APInt lhs, APInt rhs) {
@@ -1035,6 +1163,10 @@ Element rem(const Element &e1, const Element &e2) {
 }
 
 Element roundNearestAfz(const Element &el) {
+  if (auto result =
+          mapNativeFloat(el, [](auto val) { return std::round(val); }))
+    return *result;
+
   auto type = el.getType();
   auto val = el.getFloatValue();
   val.roundToIntegral(llvm::RoundingMode::NearestTiesToAway);
@@ -1042,6 +1174,11 @@ Element roundNearestAfz(const Element &el) {
 }
 
 Element roundNearestEven(const Element &el) {
+  // std::nearbyint rounds to nearest even in the default rounding mode.
+  if (auto result =
+          mapNativeFloat(el, [](auto val) { return std::nearbyint(val); }))
+    return *result;
+
   auto type = el.getType();
   auto val = el.getFloatValue();
   val.roundToIntegral(llvm::RoundingMode::NearestTiesToEven);
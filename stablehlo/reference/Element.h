@@ -30,6 +30,13 @@ namespace stablehlo {
 /// Class to represent an element of a tensor. An Element object stores the
 /// element type of the tensor and, depending on that element type, a constant
 /// value of type integer, floating-paint, or complex type.
+///
+/// f32 and f64 values are stored natively as `float` and `double`, whose
+/// arithmetic is evaluated in hardware and rounds like `APFloat` with
+/// round-to-nearest-even, so that it gives bit-identical results apart from
+/// NaN payloads. Other floating-point types, which need `APFloat` rounding,
+/// are stored as `APFloat`. Integers are stored as `APInt`, which keeps
+/// values of up to 64 bits inline.
 class Element {
  public:
   /// \name Constructors
@@ -46,6 +53,14 @@ class Element {
   /// be a floating-point type of the same semantics as `value`.
   Element(Type type, APFloat value);
 
+  /// Initializes Element object with type `type` and value `value`. `type` must
+  /// be f32.
+  Element(Type type, float value);
+
+  /// Initializes Element object with type `type` and value `value`. `type` must
+  /// be f64.
+  Element(Type type, double value);
+
   /// Initializes Element object with type `type` and value `value`. `type` must
   /// be a complex type of the same semantics as `value`.
   Element(Type type, std::complex<APFloat> value);
@@ -71,6 +86,14 @@ class Element {
   /// with floating-point type.
   APFloat getFloatValue() const;
 
+  /// Returns a pointer to the native value of an Element object with f32 type
+  /// if `T` is `float`, or with f64 type if `T` is `double`, and nullptr
+  /// otherwise. Unlike `getFloatValue`, this doesn't construct an `APFloat`.
+  template <typename T>
+  const T *getNativeFloatValue() const {
+    return std::get_if<T>(&value_);
+  }
+
   /// Returns the underlying complex value stored in an Element object with
   /// complex type.
   std::complex<APFloat> getComplexValue() const;
@@ -140,7 +163,9 @@ class Element {
 
  private:
   Type type_;
-  std::variant<APInt, bool, APFloat, std::pair<APFloat, APFloat>> value_;
+  std::variant<APInt, bool, APFloat, std::pair<APFloat, APFloat>, float,
+               double>
+      value_;
 };
 
 /// Returns abs of Element object.
@@ -0,0 +1,44 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/EvaluationContext.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+const EvaluationContext defaultContext;
+
+// Context of the evaluation in progress on this thread, if any.
+thread_local const EvaluationContext *currentContext = nullptr;
+
+}  // namespace
+
+const EvaluationContext &getEvaluationContext() {
+  return currentContext ? *currentContext : defaultContext;
+}
+
+ScopedEvaluationContext::ScopedEvaluationContext(
+    const EvaluationContext &context)
+    : previous_(currentContext) {
+  currentContext = &context;
+}
+
+ScopedEvaluationContext::~ScopedEvaluationContext() {
+  currentContext = previous_;
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
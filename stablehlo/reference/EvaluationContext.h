@@ -0,0 +1,101 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_EVALUATIONCONTEXT_H
+#define STABLEHLO_REFERENCE_EVALUATIONCONTEXT_H
+
+namespace llvm {
+class ThreadPoolInterface;
+}  // namespace llvm
+
+namespace mlir {
+
+class Operation;
+
+namespace stablehlo {
+
+class Checkpointer;
+class KernelRegistry;
+class MemoryTracker;
+class NumericsChecker;
+class Profiler;
+
+/// Options of the native kernels from Kernels.h, which take them as their
+/// first argument.
+struct KernelOptions {
+  /// Whether native kernels apply at all. If disabled, every kernel returns
+  /// false or an empty tensor and ops use their `Element`-based
+  /// implementations.
+  bool enableNativeKernels = true;
+
+  /// If enabled, native kernels which accumulate values, like the one for
+  /// `dotGeneralOp`, do so in the same order and precision as the
+  /// corresponding `Element`-based implementations, which makes their results
+  /// bit-exact. Otherwise, they may accumulate f8, f16 and bf16 values in a
+  /// wider type and leave compilers free to fuse multiplications and
+  /// additions.
+  bool exactAccumulation = false;
+
+  /// If enabled and exact accumulation is disabled, native kernels which sum
+  /// many floating-point values, like the one for `reduceOp`, add them
+  /// pairwise, which bounds the rounding error by O(log n) instead of O(n) but
+  /// changes the results compared to the `Element`-based implementations.
+  bool pairwiseSummation = false;
+};
+
+/// Settings of an evaluation which ops, kernels and instrumentation read
+/// while it is in progress, built from its `InterpreterConfiguration`, whose
+/// fields of the same names document them. `InterpreterExecutable` makes its
+/// context current on the threads which evaluate its ops, so that concurrent
+/// evaluations with different configurations don't interfere. Outside of
+/// evaluations, the current context has the default settings.
+struct EvaluationContext {
+  /// The entry function of the evaluation, e.g. for fallbacks to attribute
+  /// the failures of ops in the functions which it calls to it.
+  Operation *entryFunction = nullptr;
+  KernelOptions kernelOptions;
+  llvm::ThreadPoolInterface *intraOpThreadPool = nullptr;
+  bool dataflowExecution = false;
+  Profiler *profiler = nullptr;
+  NumericsChecker *numericsChecker = nullptr;
+  MemoryTracker *memoryTracker = nullptr;
+  Checkpointer *checkpointer = nullptr;
+  KernelRegistry *kernelRegistry = nullptr;
+};
+
+/// Returns the context of the evaluation in progress on the calling thread.
+const EvaluationContext &getEvaluationContext();
+
+/// Makes `context` current on the calling thread from construction to
+/// destruction, then restores the previous context. `context` must outlive
+/// it. Code which hands work of an evaluation to other threads, e.g.
+/// `parallelForChunks`, makes the context current on these threads.
+class ScopedEvaluationContext {
+ public:
+  explicit ScopedEvaluationContext(const EvaluationContext &context);
+  ~ScopedEvaluationContext();
+
+  ScopedEvaluationContext(const ScopedEvaluationContext &) = delete;
+  ScopedEvaluationContext &operator=(const ScopedEvaluationContext &) =
+      delete;
+
+ private:
+  const EvaluationContext *previous_;
+};
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_EVALUATIONCONTEXT_H
@@ -0,0 +1,227 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/Fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "stablehlo/reference/Parallel.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+using Complex = std::complex<double>;
+
+/// Prime factors up to this radix are transformed by Cooley-Tukey butterflies,
+/// which cost O(radix) per element. Lengths made of larger prime factors are
+/// transformed by Bluestein's algorithm.
+constexpr int64_t kMaxRadix = 7;
+
+/// The maximum number of lengths whose plans are cached.
+constexpr size_t kMaxCachedPlans = 64;
+
+/// Returns the smallest prime factor of `n` if it is at most `kMaxRadix`, and
+/// 0 otherwise.
+int64_t getSmallRadix(int64_t n) {
+  for (int64_t radix : {2, 3, 5, 7})
+    if (n % radix == 0) return radix;
+  return 0;
+}
+
+/// The precomputed factors of forward transforms of one length.
+class FftPlan {
+ public:
+  /// Returns the plan of length `n`, which is computed once and cached.
+  static std::shared_ptr<const FftPlan> get(int64_t n);
+
+  explicit FftPlan(int64_t n);
+
+  /// Computes the forward transform of `data` in place.
+  void transform(llvm::MutableArrayRef<Complex> data) const {
+    std::vector<Complex> input(data.begin(), data.end());
+    transform(input.data(), /*stride=*/1, n_, data.data());
+  }
+
+ private:
+  /// Transforms the `length` elements of `input` at `stride` into `output`,
+  /// where `length` divides the length of the plan.
+  void transform(const Complex *input, int64_t stride, int64_t length,
+                 Complex *output) const;
+
+  /// Transforms the `bluesteinLength_` elements of `input` at `stride` into
+  /// `output` as a convolution with a chirp.
+  void transformBluestein(const Complex *input, int64_t stride,
+                          Complex *output) const;
+
+  int64_t n_;
+  /// `exp(-2 * pi * i * j / n)` for every `j` in [0, n).
+  std::vector<Complex> twiddles_;
+
+  /// The factor of `n` without small prime factors, if greater than 1.
+  int64_t bluesteinLength_ = 1;
+  /// `exp(-pi * i * j^2 / bluesteinLength_)` for every `j`.
+  std::vector<Complex> chirp_;
+  /// The transform of the conjugate chirp, wrapped around to the padded
+  /// length of the convolution.
+  std::vector<Complex> filter_;
+  std::shared_ptr<const FftPlan> paddedPlan_;
+};
+
+std::shared_ptr<const FftPlan> FftPlan::get(int64_t n) {
+  static std::mutex mutex;
+  static auto *plans =
+      new llvm::DenseMap<int64_t, std::shared_ptr<const FftPlan>>();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = plans->find(n);
+    if (it != plans->end()) return it->second;
+  }
+
+  // Plans are computed outside of the lock, since Bluestein plans get the
+  // plans of their padded lengths.
+  auto plan = std::make_shared<const FftPlan>(n);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (plans->size() >= kMaxCachedPlans) plans->clear();
+  return plans->try_emplace(n, std::move(plan)).first->second;
+}
+
+FftPlan::FftPlan(int64_t n) : n_(n), twiddles_(n) {
+  for (int64_t j = 0; j < n; ++j)
+    twiddles_[j] = std::polar(1.0, -2.0 * llvm::numbers::pi * j / n);
+
+  bluesteinLength_ = n;
+  while (int64_t radix = getSmallRadix(bluesteinLength_))
+    bluesteinLength_ /= radix;
+  if (bluesteinLength_ == 1) return;
+
+  // j^2 is reduced modulo 2 * length, over which the chirp is periodic, to
+  // keep the angles accurate.
+  int64_t length = bluesteinLength_;
+  chirp_.resize(length);
+  for (int64_t j = 0; j < length; ++j) {
+    int64_t square = (j * j) % (2 * length);
+    chirp_[j] = std::polar(1.0, -llvm::numbers::pi * square / length);
+  }
+  int64_t paddedLength = llvm::PowerOf2Ceil(2 * length - 1);
+  paddedPlan_ = get(paddedLength);
+  filter_.assign(paddedLength, Complex());
+  filter_[0] = std::conj(chirp_[0]);
+  for (int64_t j = 1; j < length; ++j)
+    filter_[j] = filter_[paddedLength - j] = std::conj(chirp_[j]);
+  paddedPlan_->transform(filter_);
+}
+
+void FftPlan::transform(const Complex *input, int64_t stride, int64_t length,
+                        Complex *output) const {
+  if (length == 1) {
+    output[0] = input[0];
+    return;
+  }
+  int64_t radix = getSmallRadix(length);
+  if (radix == 0) return transformBluestein(input, stride, output);
+
+  // Transforms the `radix` interleaved subsequences, then combines them with
+  // butterflies: X[k + q * m] = sum(W^(r * (k + q * m)) * Y_r[k]), where W is
+  // the root of unity of `length`.
+  int64_t m = length / radix;
+  for (int64_t r = 0; r < radix; ++r)
+    transform(input + r * stride, stride * radix, m, output + r * m);
+
+  int64_t step = n_ / length;
+  Complex terms[kMaxRadix];
+  for (int64_t k = 0; k < m; ++k) {
+    for (int64_t r = 0; r < radix; ++r)
+      terms[r] = output[r * m + k] * twiddles_[(r * k * step) % n_];
+    for (int64_t q = 0; q < radix; ++q) {
+      Complex sum = terms[0];
+      for (int64_t r = 1; r < radix; ++r)
+        sum += terms[r] * twiddles_[(r * q * m * step) % n_];
+      output[q * m + k] = sum;
+    }
+  }
+}
+
+void FftPlan::transformBluestein(const Complex *input, int64_t stride,
+                                 Complex *output) const {
+  // X[k] = chirp[k] * sum(x[j] * chirp[j] * conj(chirp[k - j])), which is a
+  // convolution computed by transforms of the padded length.
+  int64_t paddedLength = filter_.size();
+  std::vector<Complex> convolution(paddedLength);
+  for (int64_t j = 0; j < bluesteinLength_; ++j)
+    convolution[j] = input[j * stride] * chirp_[j];
+  paddedPlan_->transform(convolution);
+  for (int64_t j = 0; j < paddedLength; ++j)
+    convolution[j] = std::conj(convolution[j] * filter_[j]);
+  paddedPlan_->transform(convolution);
+  for (int64_t k = 0; k < bluesteinLength_; ++k)
+    output[k] = std::conj(convolution[k]) * chirp_[k] /
+                static_cast<double>(paddedLength);
+}
+
+void transform(const FftPlan &plan, llvm::MutableArrayRef<Complex> data,
+               bool inverse) {
+  // The inverse transform is the conjugate of the forward transform of the
+  // conjugate, divided by n.
+  if (inverse)
+    for (Complex &element : data) element = std::conj(element);
+  plan.transform(data);
+  if (inverse)
+    for (Complex &element : data)
+      element = std::conj(element) / static_cast<double>(data.size());
+}
+
+}  // namespace
+
+void fft(llvm::MutableArrayRef<std::complex<double>> data, bool inverse) {
+  if (data.size() <= 1) return;
+  transform(*FftPlan::get(data.size()), data, inverse);
+}
+
+void fftAlongDim(llvm::MutableArrayRef<std::complex<double>> data,
+                 llvm::ArrayRef<int64_t> shape, int64_t dim, bool inverse) {
+  int64_t length = shape[dim];
+  int64_t stride = 1;
+  for (int64_t size : shape.drop_front(dim + 1)) stride *= size;
+  if (length <= 1) return;
+
+  auto plan = FftPlan::get(length);
+  auto transformLines = [&](int64_t begin, int64_t end) {
+    llvm::SmallVector<Complex> line(length);
+    for (int64_t i = begin; i < end; ++i) {
+      Complex *first = data.data() + (i / stride) * length * stride +
+                       i % stride;
+      for (int64_t j = 0; j < length; ++j) line[j] = first[j * stride];
+      transform(*plan, line, inverse);
+      for (int64_t j = 0; j < length; ++j) first[j * stride] = line[j];
+    }
+  };
+  int64_t numLines = data.size() / length;
+  parallelForChunks(numLines, std::max<int64_t>(1, 4096 / length),
+                    transformLines);
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
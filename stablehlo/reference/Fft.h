@@ -0,0 +1,47 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_FFT_H
+#define STABLEHLO_REFERENCE_FFT_H
+
+#include <complex>
+#include <cstdint>
+
+#include "llvm/ADT/ArrayRef.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Computes the discrete Fourier transform of `data` in place, i.e.
+/// `X[k] = sum(x[j] * exp(-2 * pi * i * j * k / n))`, or, if `inverse`, the
+/// inverse transform, which also divides by `n`.
+///
+/// Runs in O(n log n) for any `n`: lengths are split into their small prime
+/// factors by a mixed-radix Cooley-Tukey algorithm, and the remaining factor,
+/// if any, is transformed by Bluestein's algorithm as a convolution of
+/// power-of-two length. Twiddle factors and Bluestein filters are computed
+/// once per length and shared by all subsequent calls.
+void fft(llvm::MutableArrayRef<std::complex<double>> data, bool inverse);
+
+/// Computes the discrete Fourier transforms of all the lines of `data` along
+/// its dimension `dim`, where `data` holds a tensor of shape `shape` in
+/// row-major order.
+void fftAlongDim(llvm::MutableArrayRef<std::complex<double>> data,
+                 llvm::ArrayRef<int64_t> shape, int64_t dim, bool inverse);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_FFT_H
@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "stablehlo/reference/Index.h"
 
+#include <cstdint>
+#include <optional>
+
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Error.h"
 
@@ -115,33 +118,38 @@ Sizes clamp(const Sizes &min, const Sizes &x, const Sizes &max) {
   return result;
 }
 
+IndexSpaceIterator::IndexSpaceIterator(Sizes shape)
+    : IndexSpaceIterator(shape, std::nullopt) {}
+
+IndexSpaceIterator::IndexSpaceIterator(Sizes shape, std::optional<Index> index)
+    : shape_(shape), index_(shape.size()), numElements_(1) {
+  for (auto dimSize : shape_) numElements_ *= dimSize;
+  linearIndex_ = numElements_;
+  if (!index || !index->inBounds(shape_)) return;
+
+  index_ = *index;
+  linearIndex_ = 0;
+  for (auto [dimSize, i] : llvm::zip(shape_, index_))
+    linearIndex_ = linearIndex_ * dimSize + i;
+}
+
 const Index &IndexSpaceIterator::operator*() const {
-  if (!index_)
+  if (linearIndex_ == numElements_)
     llvm::report_fatal_error("Dereferencing a past-the-end iterator.");
-  return *index_;
+  return index_;
 }
 
-const Index *IndexSpaceIterator::operator->() const { return &(*index_); }
+const Index *IndexSpaceIterator::operator->() const { return &**this; }
 
 IndexSpaceIterator &IndexSpaceIterator::operator++() {
-  if (!index_)
+  if (linearIndex_ == numElements_)
     llvm::report_fatal_error("Incrementing a past-the-end iterator.");
 
-  if (shape_.empty()) index_.reset();
-
+  ++linearIndex_;
   for (int64_t i = shape_.size() - 1; i >= 0; --i) {
-    (*index_)[i] += 1;
-    if ((*index_)[i] >= shape_[i]) {
-      (*index_)[i] = 0;
-      if (i == 0) {
-        index_.reset();
-        break;
-      }
-    } else {
-      break;
-    }
+    if (++index_[i] < shape_[i]) break;
+    index_[i] = 0;
   }
-
   return *this;
 }
 
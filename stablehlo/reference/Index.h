@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef STABLEHLO_REFERENCE_INDEX_H
 #define STABLEHLO_REFERENCE_INDEX_H
 
+#include <cstdint>
 #include <optional>
 
 #include "llvm/ADT/SmallVector.h"
@@ -27,9 +28,14 @@ namespace stablehlo {
 
 class IndexSpaceIterator;
 
+/// Number of dimensions up to which `Sizes` are stored inline rather than on
+/// the heap, so that iterating over the index space of tensors of such ranks
+/// doesn't allocate.
+constexpr unsigned kInlineRank = 8;
+
 /// Represents per axis metadata (e.g. tensor shape, slice sizes etc.) of type
 /// `int64_t`.
-class Sizes : public SmallVector<int64_t> {
+class Sizes : public SmallVector<int64_t, kInlineRank> {
  public:
   Sizes() = default;
   Sizes(const Sizes &other) = default;
@@ -118,15 +124,16 @@ using Index = Sizes;
 /// [2,3], the iterator enumerates the indices (0,0), (0,1), (0,2), (1,0),
 /// (1,1), (1,2) and <END> (special past-the-end element which cannot be
 /// dereferenced).
+///
+/// Alongside the index, the iterator tracks its position in the enumeration,
+/// which is the offset of the element in canonical order, see
+/// `getLinearIndex`. Both are updated incrementally, carrying into the next
+/// dimension only when a dimension wraps around.
 class IndexSpaceIterator {
  public:
   /// \name Constructor
-  IndexSpaceIterator(Sizes shape) : shape_(shape) { index_ = std::nullopt; }
-
-  IndexSpaceIterator(Sizes shape, std::optional<Index> index)
-      : shape_(shape), index_(std::nullopt) {
-    if (index && index->inBounds(shape)) index_ = index;
-  }
+  IndexSpaceIterator(Sizes shape);
+  IndexSpaceIterator(Sizes shape, std::optional<Index> index);
 
   /// Get the current index.
   /// At any point in time, the iterator can either reference an actual index
@@ -135,13 +142,19 @@ class IndexSpaceIterator {
   const Index &operator*() const;
   const Index *operator->() const;
 
+  /// Get the offset of the current index in canonical order, i.e. the number
+  /// of indices which precede it. `Tensor::get` and `Tensor::set` take it in
+  /// place of the index, which saves flattening the index for every access.
+  /// Returns the number of elements for the past-the-end iterator.
+  int64_t getLinearIndex() const { return linearIndex_; }
+
   /// Compare the iterator to another iterator.
   /// Two iterators are equal if they have the same underlying shape and
   /// reference the same element in the index space.
-  bool operator==(const IndexSpaceIterator &it) {
-    return shape_ == it.shape_ && index_ == it.index_;
+  bool operator==(const IndexSpaceIterator &it) const {
+    return linearIndex_ == it.linearIndex_ && shape_ == it.shape_;
   }
-  bool operator!=(const IndexSpaceIterator &it) { return !(*this == it); }
+  bool operator!=(const IndexSpaceIterator &it) const { return !(*this == it); }
 
   /// Increment to the next index while iterating over the index space
   /// of a tensor in lexicographical order.
@@ -155,9 +168,15 @@ class IndexSpaceIterator {
   /// Shape of the tensor whose index space to be iterated on.
   Sizes shape_;
 
-  /// Current multi-dimensional index.
-  /// If the optional is empty, then we're at the end
-  std::optional<Index> index_;
+  /// Current multi-dimensional index, which is all zeros at the end.
+  Index index_;
+
+  /// Offset of `index_` in canonical order, which is the number of elements
+  /// at the end.
+  int64_t linearIndex_;
+
+  /// Number of elements in the index space.
+  int64_t numElements_;
 };
 
 }  // namespace stablehlo
@@ -15,12 +15,29 @@ limitations under the License.
 
 #include "stablehlo/reference/InterpreterOps.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
 #include <queue>
+#include <string>
+#include <utility>
 
-#include "llvm/Support/Errc.h"
-#include "llvm/Support/FileSystem.h"
-#include "llvm/Support/Path.h"
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/BuiltinOps.h"
@@ -31,9 +48,14 @@ limitations under the License.
 #include "mlir/Support/DebugStringHelper.h"
 #include "mlir/Support/LLVM.h"
 #include "stablehlo/dialect/Base.h"
-#include "stablehlo/reference/NumPy.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/reference/Errors.h"
+#include "stablehlo/reference/EvaluationContext.h"
 #include "stablehlo/reference/Ops.h"
+#include "stablehlo/reference/ProbeWriter.h"
 #include "stablehlo/reference/ProcessGrid.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Token.h"
 #include "stablehlo/reference/Value.h"
 
 #define GET_OP_CLASSES
@@ -44,30 +66,126 @@ namespace stablehlo {
 namespace interpreter {
 namespace {
 
-// Appends a new line item to an instrumentation metadata file, `index.json` in
-// the form: `probeId,probeOutputDir/filename`.
-llvm::Error writeProbeMetadata(StringRef probeId, Type type, StringRef filename,
-                               StringRef probeOutputDir) {
-  if (probeOutputDir.empty())
-    return createStringError(llvm::errc::invalid_argument,
-                             "Probe serialization directory cannot be empty.");
-
-  llvm::SmallString<128> filepath(probeOutputDir);
-  llvm::sys::path::append(filepath, numpy::kInstrumentationMetadataFilename);
-
-  int fd;
-  if (llvm::sys::fs::openFileForWrite(filepath, fd,
-                                      llvm::sys::fs::CD_CreateAlways,
-                                      llvm::sys::fs::OF_Append))
-    return createStringError(llvm::errc::io_error,
-                             "Failed to open instrumentation metadata file.");
-
-  llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
-  out << probeId.str() << ',' << debugString(type) << ',' << filename.str()
-      << '\n';
-
-  return llvm::Error::success();
+// Pins the calling thread to the `index`-th CPU, modulo their number, among
+// the CPUs which it may run on, and restores its previous affinity once
+// destroyed. Does nothing on platforms other than Linux or if that fails.
+class ScopedThreadPinning {
+ public:
+  explicit ScopedThreadPinning(int64_t index) {
+#if defined(__linux__)
+    if (sched_getaffinity(0, sizeof(previous_), &previous_) != 0) return;
+    int64_t target = index % CPU_COUNT(&previous_);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (!CPU_ISSET(cpu, &previous_) || target-- > 0) continue;
+      cpu_set_t pinned;
+      CPU_ZERO(&pinned);
+      CPU_SET(cpu, &pinned);
+      pinned_ = pthread_setaffinity_np(pthread_self(), sizeof(pinned),
+                                       &pinned) == 0;
+      return;
+    }
+#endif
+  }
+
+  ~ScopedThreadPinning() {
+#if defined(__linux__)
+    if (pinned_)
+      pthread_setaffinity_np(pthread_self(), sizeof(previous_), &previous_);
+#endif
+  }
+
+ private:
+#if defined(__linux__)
+  cpu_set_t previous_;
+  bool pinned_ = false;
+#endif
+};
+
+// Fills in `results` of the remote processes of a distributed process grid,
+// given those of its local processes, by exchanging the tensor results of all
+// processes with `transport`, one round per result position. Every host has
+// the programs `funcs` of all processes, indexed by flattened process id, so
+// it knows which results to expect. Token results aren't exchanged.
+void exchangeResults(ProcessTransport &transport, ArrayRef<func::FuncOp> funcs,
+                     uint32_t numPartitions,
+                     MutableArrayRef<SmallVector<InterpreterValue>> results) {
+  ProcessGroup processGroup;
+  size_t numRounds = 0;
+  for (auto [flattenedId, func] : llvm::enumerate(funcs)) {
+    ProcessId processId{uint32_t(flattenedId / numPartitions),
+                        uint32_t(flattenedId % numPartitions)};
+    processGroup.push_back(processId);
+    numRounds = std::max<size_t>(numRounds, func.getNumResults());
+    if (transport.isLocal(processId)) continue;
+
+    for (auto resultType : func.getResultTypes()) {
+      if (isa<TokenType>(resultType))
+        results[flattenedId].emplace_back(Token(func.getContext()));
+      else if (isa<ShapedType>(resultType))
+        results[flattenedId].emplace_back(Tensor());
+      else
+        llvm::report_fatal_error(
+            invalidArgument("Unsupported result type of remote process: %s",
+                            debugString(resultType).c_str()));
+    }
+  }
+
+  for (size_t round = 0; round < numRounds; ++round) {
+    SmallVector<std::pair<ProcessId, Tensor>> contributions;
+    for (auto [flattenedId, processId] : llvm::enumerate(processGroup))
+      if (transport.isLocal(processId) && round < results[flattenedId].size() &&
+          results[flattenedId][round].isTensor())
+        contributions.emplace_back(processId,
+                                   results[flattenedId][round].getTensor());
+
+    auto remoteContributions =
+        transport.exchange(processGroup, ProcessGrid::kResultsChannelId, round,
+                           contributions);
+    if (!remoteContributions)
+      llvm::report_fatal_error(remoteContributions.takeError());
+    for (auto &[processId, tensor] : *remoteContributions) {
+      auto flattenedId =
+          uint64_t(processId.replicaId) * numPartitions + processId.partitionId;
+      if (flattenedId >= results.size() ||
+          round >= results[flattenedId].size())
+        llvm::report_fatal_error("Unexpected result of remote process");
+      results[flattenedId][round] = tensor;
+    }
+  }
+}
+
+// Prints tables of the statistics of the collectives and the `send`/`recv`
+// channels of `processGrid` to `os`, one row per kind of collective and
+// channel, with times in milliseconds.
+void printCommunicationStatistics(ProcessGrid &processGrid,
+                                  llvm::raw_ostream &os) {
+  auto toMilliseconds = [](std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  os << llvm::format("%-12s %10s %10s %14s %12s %12s %14s\n", "collective",
+                     "channel", "rounds", "bytes", "wait (ms)", "skew (ms)",
+                     "modeled (ms)");
+  for (const auto &[key, statistics] : processGrid.getCollectiveStatistics())
+    os << llvm::format(
+        "%-12s %10ld %10lu %14lu %12.3f %12.3f %14.3f\n",
+        key.first == CollectiveKind::AllReduce ? "all_reduce" : "rendezvous",
+        (long)key.second, (unsigned long)statistics.numRounds,
+        (unsigned long)statistics.numBytes, toMilliseconds(statistics.waitTime),
+        toMilliseconds(statistics.skew),
+        toMilliseconds(statistics.modeledTime));
+
+  os << llvm::format("%-10s %10s %14s %16s %16s %14s\n", "channel",
+                     "messages", "bytes", "send wait (ms)", "recv wait (ms)",
+                     "modeled (ms)");
+  for (const auto &[channelId, statistics] : processGrid.getChannelStatistics())
+    os << llvm::format("%-10ld %10lu %14lu %16.3f %16.3f %14.3f\n",
+                       (long)channelId, (unsigned long)statistics.numMessages,
+                       (unsigned long)statistics.numBytes,
+                       toMilliseconds(statistics.sendWaitTime),
+                       toMilliseconds(statistics.recvWaitTime),
+                       toMilliseconds(statistics.modeledTime));
 }
+
 }  // namespace
 
 //===----------------------------------------------------------------------===//
@@ -154,28 +272,69 @@ LogicalResult RunParallelOp::verify() {
   return success();
 }
 
+LogicalResult ProbeOp::verify() {
+  if (getSummarize() && getDigest())
+    return emitOptionalError(getLoc(),
+                             "`summarize` and `digest` cannot both be set");
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // Interpreter Ops Evaluator
 //===----------------------------------------------------------------------===//
 
 SmallVector<InterpreterValue> evalRunParallelOp(
     ArrayRef<InterpreterValue> inputs, std::queue<StringAttr> &infeed,
-    SmallVector<SmallVector<StringAttr>> programs, SymbolTable &symbolTable) {
-  llvm::DefaultThreadPool threadPool;
-  SmallVector<std::shared_future<SmallVector<InterpreterValue>>> futures;
-
+    SmallVector<SmallVector<StringAttr>> programs, SymbolTable &symbolTable,
+    std::chrono::milliseconds collectiveTimeout,
+    llvm::ThreadPoolInterface *processThreadPool, bool pinProcessThreads,
+    ProcessTransport *transport, InfeedProducer infeedProducer,
+    OutfeedConsumer outfeedConsumer, size_t channelDepth, LinkModel linkModel,
+    llvm::raw_ostream *communicationStatisticsStream) {
   uint32_t numReplicas = programs.size();
   uint32_t numPartitions = programs[0].size();
-  ProcessGrid processGrid(numReplicas, numPartitions, infeed);
+
+  // With a transport, only the local processes are evaluated on this host.
+  auto isLocal = [&](ProcessId processId) {
+    return !transport || transport->isLocal(processId);
+  };
+
+  // A process which waits for the others in a collective keeps its thread,
+  // so fewer threads than processes could deadlock.
+  std::optional<llvm::DefaultThreadPool> ownedThreadPool;
+  unsigned numProcesses = 0;
+  for (uint32_t i = 0; i < numReplicas; ++i)
+    for (uint32_t j = 0; j < numPartitions; ++j)
+      numProcesses += isLocal(ProcessId{i, j});
+  if (!processThreadPool ||
+      processThreadPool->getMaxConcurrency() < numProcesses) {
+    ownedThreadPool.emplace(llvm::hardware_concurrency(numProcesses));
+    processThreadPool = &*ownedThreadPool;
+  }
+  SmallVector<std::shared_future<SmallVector<InterpreterValue>>> futures;
+  SmallVector<func::FuncOp> funcs;
+
+  ProcessGrid processGrid(numReplicas, numPartitions, infeed,
+                          collectiveTimeout, transport,
+                          std::move(infeedProducer),
+                          std::move(outfeedConsumer), channelDepth,
+                          std::move(linkModel));
 
   auto inputsIt = inputs.begin();
+  const EvaluationContext &context = getEvaluationContext();
 
   for (uint32_t i = 0; i < numReplicas; ++i) {
     for (uint32_t j = 0; j < numPartitions; ++j) {
       auto funcName = programs[i][j];
       auto func = llvm::cast<func::FuncOp>(symbolTable.lookup(funcName));
+      funcs.push_back(func);
       auto evalWrapper = [&](Region &region, ArrayRef<InterpreterValue> args,
                              ProcessId processId) {
+        ScopedEvaluationContext scopedContext(context);
+        std::optional<ScopedThreadPinning> pinning;
+        if (pinProcessThreads)
+          pinning.emplace(processId.replicaId * numPartitions +
+                          processId.partitionId);
         Process process{processId, &processGrid};
         return eval(region, args, /*config=*/nullptr, &process,
                     /*parent=*/nullptr);
@@ -185,37 +344,159 @@ SmallVector<InterpreterValue> evalRunParallelOp(
       SmallVector<InterpreterValue> args(inputsIt, inputsIt + numArgs);
       inputsIt += numArgs;
 
-      futures.emplace_back(threadPool.async(
+      if (!isLocal(ProcessId{i, j})) {
+        futures.emplace_back();
+        continue;
+      }
+      futures.emplace_back(processThreadPool->async(
           evalWrapper, std::ref(func.getBody()), args, ProcessId{i, j}));
     }
   }
 
+  SmallVector<SmallVector<InterpreterValue>> processResults(futures.size());
+  for (auto [future, processResult] : llvm::zip(futures, processResults))
+    if (future.valid()) processResult = future.get();
+  if (transport)
+    exchangeResults(*transport, funcs, numPartitions, processResults);
+
   SmallVector<InterpreterValue> results;
-  for (auto &future : futures) results.append(future.get());
+  for (auto &processResult : processResults) results.append(processResult);
+  if (communicationStatisticsStream)
+    printCommunicationStatistics(processGrid, *communicationStatisticsStream);
   // TODO(#1725): Figure out how to test the outfeed queue.
   return results;
 }
 
-// `serializedProbeFileId` should be a unique positive integer which can be used
-// to unambiguously derive a serialized filename for a given `probeId`.
+namespace {
+
+// Number of significant bits to which the elements of tensors are rounded
+// for their quantized hashes.
+constexpr int kQuantizedHashBits = 12;
+
+// Number of quantized elements which are hashed together.
+constexpr int64_t kQuantizedHashChunkSize = 4096;
+
+// Calls `fn` with every element of `tensor` converted to f64.
+template <typename Fn>
+void forEachElementAsDouble(const Tensor &tensor, Fn fn) {
+  bool isNative = dispatchOnNativeType(tensor.getElementType(), [&](auto zero) {
+    using T = decltype(zero);
+    for (T value : tensor.getData<T>()) fn(static_cast<double>(value));
+  });
+  if (isNative) return;
+  auto f64 = Float64Type::get(tensor.getType().getContext());
+  for (int64_t i = 0; i < tensor.getNumElements(); ++i)
+    fn(convert(f64, tensor.getLinear(i)).getFloatValue().convertToDouble());
+}
+
+// The statistics of the elements of a tensor which probes serialize.
+struct ProbeStatistics {
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+  double sum = 0.0;
+  int64_t numElements = 0;
+
+  void add(double value) {
+    if (!std::isnan(value)) {
+      min = std::min(min, value);
+      max = std::max(max, value);
+    }
+    sum += value;
+    ++numElements;
+  }
+
+  // Replaces the bounds by NaNs if there were no non-NaN elements.
+  void finish() {
+    if (min > max) min = max = std::numeric_limits<double>::quiet_NaN();
+  }
+
+  double getMean() const { return sum / numElements; }
+};
+
+// Returns the summary of `tensor` which `ProbeOp` serializes if `summarize`
+// is set.
+Tensor summarizeProbe(const Tensor &tensor) {
+  ProbeStatistics statistics;
+  forEachElementAsDouble(tensor,
+                         [&](double value) { statistics.add(value); });
+  statistics.finish();
+
+  // FNV-1a, folded to 53 bits.
+  uint64_t hash = 0xcbf29ce484222325;
+  for (char byte : tensor.getData<char>()) {
+    hash ^= static_cast<uint8_t>(byte);
+    hash *= 0x100000001b3;
+  }
+
+  auto f64 = Float64Type::get(tensor.getType().getContext());
+  Tensor summary(RankedTensorType::get({4}, f64));
+  auto data = summary.getMutableData<double>();
+  data[0] = statistics.min;
+  data[1] = statistics.max;
+  data[2] = statistics.getMean();
+  data[3] = static_cast<double>(hash >> 11);
+  return summary;
+}
+
+// Rounds `value` to `kQuantizedHashBits` significant bits, and all zeros and
+// NaNs to the same value.
+double quantize(double value) {
+  if (value == 0.0 || std::isnan(value)) return std::fabs(value);
+  int exponent;
+  double mantissa = std::frexp(value, &exponent);
+  return std::ldexp(std::round(std::ldexp(mantissa, kQuantizedHashBits)),
+                    exponent - kQuantizedHashBits);
+}
+
+// Returns the digest of `tensor` which `ProbeOp` records if `digest` is set.
+std::string digestProbe(const Tensor &tensor) {
+  auto bytes = tensor.getData<char>();
+  uint64_t hash = llvm::xxh3_64bits(llvm::ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size()));
+
+  // Quantized elements are hashed in chunks, and then the hashes of the
+  // chunks, to bound the memory which they take.
+  ProbeStatistics statistics;
+  SmallVector<double> chunk;
+  SmallVector<uint64_t> chunkHashes;
+  auto hashChunk = [&] {
+    chunkHashes.push_back(llvm::xxh3_64bits(llvm::ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(chunk.data()),
+        chunk.size() * sizeof(double))));
+    chunk.clear();
+  };
+  forEachElementAsDouble(tensor, [&](double value) {
+    statistics.add(value);
+    chunk.push_back(quantize(value));
+    if (static_cast<int64_t>(chunk.size()) == kQuantizedHashChunkSize)
+      hashChunk();
+  });
+  if (!chunk.empty()) hashChunk();
+  statistics.finish();
+  uint64_t quantizedHash = llvm::xxh3_64bits(llvm::ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(chunkHashes.data()),
+      chunkHashes.size() * sizeof(uint64_t)));
+
+  std::string digest;
+  llvm::raw_string_ostream os(digest);
+  os << "digest:" << llvm::format_hex_no_prefix(hash, 16) << ':'
+     << llvm::format_hex_no_prefix(quantizedHash, 16) << ':'
+     << llvm::format("%.17g", statistics.min) << ':'
+     << llvm::format("%.17g", statistics.max) << ':'
+     << llvm::format("%.17g", statistics.getMean());
+  return digest;
+}
+
+}  // namespace
+
 llvm::Error evalProbeOp(InterpreterValue input, StringRef probeId,
-                        StringRef probeOutputDir,
-                        int64_t serializedProbeFileId) {
-  llvm::SmallString<128> filepath(probeOutputDir);
-
-  // Use an increasing unique integer to write to disk to avoid any odd file
-  // names as a result of unsafe probe_id values.
-  llvm::sys::path::append(
-      filepath, "probe" + std::to_string(serializedProbeFileId) + ".npy");
-  auto tensor = input.getTensor();
-  if (auto serializationResultError =
-          numpy::serializeTensor(filepath, tensor.getType(), tensor.getData()))
-    return serializationResultError;
-
-  // After the tensor has been serialized to disk, append it to a metadata file
-  // to associate the serialized probe_id with the filepath. By default, this
-  // will live in an `index.csv` file generated in specified `probeOutputDir`.
-  return writeProbeMetadata(probeId, input.getType(), filepath, probeOutputDir);
+                        ProbeWriter &probeWriter, bool summarize,
+                        bool digest) {
+  if (digest)
+    return probeWriter.writeDigest(probeId, input.getTensor(), digestProbe);
+  if (summarize)
+    return probeWriter.write(probeId, summarizeProbe(input.getTensor()));
+  return probeWriter.write(probeId, input.getTensor());
 }
 
 }  // namespace interpreter
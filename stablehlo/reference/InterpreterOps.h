@@ -16,13 +16,19 @@ limitations under the License.
 #ifndef STABLEHLO_REFERENCE_INTERPRETEROPS_H
 #define STABLEHLO_REFERENCE_INTERPRETEROPS_H
 
+#include <chrono>
+#include <cstddef>
 #include <queue>
 
 #include "llvm/Support/Error.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
 #include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/Support/LLVM.h"
+#include "stablehlo/reference/ProbeWriter.h"
+#include "stablehlo/reference/ProcessGrid.h"
 #include "stablehlo/reference/Value.h"
 
 namespace mlir {
@@ -35,13 +41,42 @@ class InterpreterDialect : public Dialect {
   static StringRef getDialectNamespace() { return "interpreter"; }
 };
 
+/// Evaluates every program of `programs` as a StableHLO process on its own
+/// thread, since processes block each other in collectives. The threads come
+/// from `processThreadPool` if it has at least one thread per process, and
+/// from a thread pool created for this evaluation otherwise. If
+/// `pinProcessThreads`, every thread is pinned to one of the CPUs available to
+/// the interpreter while it evaluates a process, round-robin by process.
+///
+/// If `transport` is set, only the processes which are local to this host are
+/// evaluated, and the results of the remote processes are received from
+/// their hosts, which evaluate the same module. See `ProcessTransport`.
+///
+/// `infeedProducer` and `outfeedConsumer` stream StableHLO `infeed` and
+/// `outfeed`, see `ProcessGrid::infeed` and `ProcessGrid::outfeed`.
+///
+/// `send`/`recv` channels buffer `channelDepth` messages, see
+/// `ProcessGrid::send`. If `communicationStatisticsStream` is set, the
+/// statistics of all collectives and channels are printed to it at the end,
+/// including the times which their communication takes according to
+/// `linkModel`, if set. This estimates the communication cost of a sharding
+/// without the hardware it's meant for.
 SmallVector<InterpreterValue> evalRunParallelOp(
     ArrayRef<InterpreterValue> inputs, std::queue<StringAttr> &infeed,
-    SmallVector<SmallVector<StringAttr>> programs, SymbolTable &symbolTable);
+    SmallVector<SmallVector<StringAttr>> programs, SymbolTable &symbolTable,
+    std::chrono::milliseconds collectiveTimeout = ProcessGrid::kDefaultTimeout,
+    llvm::ThreadPoolInterface *processThreadPool = nullptr,
+    bool pinProcessThreads = false, ProcessTransport *transport = nullptr,
+    InfeedProducer infeedProducer = nullptr,
+    OutfeedConsumer outfeedConsumer = nullptr, size_t channelDepth = 0,
+    LinkModel linkModel = nullptr,
+    llvm::raw_ostream *communicationStatisticsStream = nullptr);
 
+/// Schedules `input`, or its summary if `summarize`, or only its digest if
+/// `digest`, see `ProbeOp`, to be serialized for `probeId` by `probeWriter`.
 llvm::Error evalProbeOp(InterpreterValue input, StringRef probeId,
-                        StringRef probeOutputDir,
-                        int64_t serializedProbeFileId);
+                        ProbeWriter &probeWriter, bool summarize = false,
+                        bool digest = false);
 
 }  // namespace interpreter
 }  // namespace stablehlo
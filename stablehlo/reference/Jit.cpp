@@ -0,0 +1,355 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/Jit.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
+#include "mlir/Conversion/ArithToLLVM/ArithToLLVM.h"
+#include "mlir/Conversion/ControlFlowToLLVM/ControlFlowToLLVM.h"
+#include "mlir/Conversion/FuncToLLVM/ConvertFuncToLLVMPass.h"
+#include "mlir/Conversion/IndexToLLVM/IndexToLLVM.h"
+#include "mlir/Conversion/MathToLLVM/MathToLLVM.h"
+#include "mlir/Conversion/MathToLibm/MathToLibm.h"
+#include "mlir/Conversion/MemRefToLLVM/MemRefToLLVM.h"
+#include "mlir/Conversion/ReconcileUnrealizedCasts/ReconcileUnrealizedCasts.h"
+#include "mlir/Conversion/SCFToControlFlow/SCFToControlFlow.h"
+#include "mlir/Dialect/Arith/Transforms/BufferizableOpInterfaceImpl.h"
+#include "mlir/Dialect/Bufferization/IR/Bufferization.h"
+#include "mlir/Dialect/Bufferization/Pipelines/Passes.h"
+#include "mlir/Dialect/Bufferization/Transforms/FuncBufferizableOpInterfaceImpl.h"
+#include "mlir/Dialect/Bufferization/Transforms/OneShotAnalysis.h"
+#include "mlir/Dialect/Bufferization/Transforms/Passes.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/Linalg/Passes.h"
+#include "mlir/Dialect/Linalg/Transforms/BufferizableOpInterfaceImpl.h"
+#include "mlir/Dialect/MemRef/Transforms/AllocationOpInterfaceImpl.h"
+#include "mlir/Dialect/MemRef/Transforms/Passes.h"
+#include "mlir/Dialect/SCF/Transforms/BufferizableOpInterfaceImpl.h"
+#include "mlir/Dialect/Tensor/Transforms/BufferizableOpInterfaceImpl.h"
+#include "mlir/ExecutionEngine/ExecutionEngine.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/DialectRegistry.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/OperationSupport.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Target/LLVMIR/Dialect/Builtin/BuiltinToLLVMIRTranslation.h"
+#include "mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h"
+#include "mlir/Transforms/Passes.h"
+#include "stablehlo/conversions/linalg/transforms/Passes.h"
+#include "stablehlo/dialect/Register.h"
+#include "stablehlo/reference/Configuration.h"
+#include "stablehlo/reference/Scope.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Value.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Returns whether compiled code lays out tensors of `type` like `Tensor`,
+// i.e. whether it's a statically shaped tensor with a native element type.
+bool isCompilableType(Type type) {
+  auto tensorType = dyn_cast<RankedTensorType>(type);
+  if (!tensorType || !tensorType.hasStaticShape()) return false;
+  return dispatchOnNativeType(tensorType.getElementType(), [](auto) {});
+}
+
+// Returns whether `op` at the top level of an entry function is evaluated by
+// the interpreter after the compiled function rather than compiled, see
+// `JitExecutable`.
+bool isHostOp(Operation &op) {
+  return op.getNumResults() == 0 && !op.hasTrait<OpTrait::IsTerminator>() &&
+         op.getName().getDialectNamespace() != "stablehlo";
+}
+
+void registerJitDialects(DialectRegistry &registry) {
+  stablehlo::registerAllDialects(registry);
+  registry.insert<bufferization::BufferizationDialect, func::FuncDialect,
+                  LLVM::LLVMDialect>();
+  arith::registerBufferizableOpInterfaceExternalModels(registry);
+  bufferization::func_ext::registerBufferizableOpInterfaceExternalModels(
+      registry);
+  linalg::registerBufferizableOpInterfaceExternalModels(registry);
+  memref::registerAllocationOpInterfaceExternalModels(registry);
+  scf::registerBufferizableOpInterfaceExternalModels(registry);
+  tensor::registerBufferizableOpInterfaceExternalModels(registry);
+  registerBuiltinDialectTranslation(registry);
+  registerLLVMDialectTranslation(registry);
+}
+
+// Lowers `module` from StableHLO to the LLVM dialect. Results of functions are
+// turned into out-parameters, so that compiled code writes them directly
+// into the storage of the result tensors.
+LogicalResult lowerToLLVM(ModuleOp module) {
+  PassManager pm(module.getContext());
+  pm.addPass(stablehlo::createStablehloLegalizeToLinalgPass());
+  pm.addNestedPass<func::FuncOp>(createCanonicalizerPass());
+
+  bufferization::OneShotBufferizationOptions bufferizationOptions;
+  bufferizationOptions.bufferizeFunctionBoundaries = true;
+  bufferizationOptions.setFunctionBoundaryTypeConversion(
+      bufferization::LayoutMapOption::IdentityLayoutMap);
+  pm.addPass(bufferization::createOneShotBufferizePass(bufferizationOptions));
+  bufferization::BufferResultsToOutParamsOpts outParamsOptions;
+  outParamsOptions.hoistStaticAllocs = true;
+  pm.addPass(
+      bufferization::createBufferResultsToOutParamsPass(outParamsOptions));
+  bufferization::buildBufferDeallocationPipeline(
+      pm, bufferization::BufferDeallocationPipelineOptions());
+
+  // These lowerings are local to each function, so functions are lowered
+  // concurrently rather than one module-wide pass after another.
+  OpPassManager &funcPm = pm.nest<func::FuncOp>();
+  funcPm.addPass(createConvertLinalgToLoopsPass());
+  funcPm.addPass(createLowerAffinePass());
+  funcPm.addPass(createConvertSCFToCFPass());
+  funcPm.addPass(memref::createExpandStridedMetadataPass());
+  funcPm.addPass(createLowerAffinePass());
+  pm.addPass(createConvertMathToLibmPass());
+  pm.addPass(createConvertMathToLLVMPass());
+  pm.addPass(createArithToLLVMConversionPass());
+  pm.addPass(createConvertIndexToLLVMPass());
+  pm.addPass(createFinalizeMemRefToLLVMConversionPass());
+  pm.addPass(createConvertFuncToLLVMPass());
+  pm.addPass(createConvertControlFlowToLLVMPass());
+  pm.addPass(createReconcileUnrealizedCastsPass());
+  return pm.run(module);
+}
+
+// Returns the memref descriptor of the storage at `data` for a tensor of
+// `type` in canonical order: the allocated and aligned pointers, the offset,
+// the sizes and the strides, as laid out by `StridedMemRefType`.
+SmallVector<int64_t> makeDescriptor(const char *data, ShapedType type) {
+  SmallVector<int64_t> descriptor;
+  descriptor.push_back(reinterpret_cast<intptr_t>(data));
+  descriptor.push_back(reinterpret_cast<intptr_t>(data));
+  descriptor.push_back(0);
+  llvm::append_range(descriptor, type.getShape());
+  SmallVector<int64_t> strides(type.getRank(), 1);
+  for (int64_t d = type.getRank() - 2; d >= 0; --d)
+    strides[d] = strides[d + 1] * type.getDimSize(d + 1);
+  llvm::append_range(descriptor, strides);
+  return descriptor;
+}
+
+// Returns the ops of the body of `func` at `positions`.
+SmallVector<Operation *> getOpsAt(func::FuncOp func,
+                                  ArrayRef<int64_t> positions) {
+  SmallVector<Operation *> ops;
+  auto it = positions.begin();
+  for (auto [i, op] : llvm::enumerate(func.getBody().front())) {
+    if (it == positions.end()) break;
+    if ((int64_t)i != *it) continue;
+    ops.push_back(&op);
+    ++it;
+  }
+  return ops;
+}
+
+// Compiled functions by the hash of their module and name, see
+// `JitExecutable::getOrCompile`. Functions which can't be compiled are cached
+// as nullptr, so that they aren't compiled again either.
+std::mutex jitCacheMutex;
+llvm::StringMap<std::shared_ptr<const JitExecutable>> &getJitCache() {
+  static auto *cache =
+      new llvm::StringMap<std::shared_ptr<const JitExecutable>>();
+  return *cache;
+}
+
+// Prints `module` in the generic form, which ops of unregistered dialects
+// can be parsed from.
+std::string printModule(ModuleOp module) {
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  module->print(
+      os, OpPrintingFlags().printGenericOpForm().enableDebugInfo(false));
+  return text;
+}
+
+std::string hashModule(StringRef text, func::FuncOp func) {
+  llvm::SHA256 hasher;
+  hasher.update(text);
+  hasher.update(func.getSymName());
+  auto digest = hasher.final();
+  return std::string(digest.begin(), digest.end());
+}
+
+}  // namespace
+
+JitExecutable::JitExecutable(std::unique_ptr<ExecutionEngine> engine,
+                             PackedFunction function,
+                             SmallVector<int64_t> hostOpPositions)
+    : engine_(std::move(engine)),
+      function_(function),
+      hostOpPositions_(std::move(hostOpPositions)) {}
+
+JitExecutable::~JitExecutable() = default;
+
+std::shared_ptr<const JitExecutable> JitExecutable::getOrCompile(
+    ModuleOp module, func::FuncOp func) {
+  auto text = printModule(module);
+  auto key = hashModule(text, func);
+  std::lock_guard<std::mutex> lock(jitCacheMutex);
+  auto [it, inserted] = getJitCache().try_emplace(key);
+  if (!inserted) return it->second;
+
+  static std::once_flag initializeTarget;
+  std::call_once(initializeTarget, [] {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  });
+
+  // Compiles a copy of the module in a context of its own, so that the
+  // dialects of the lowering aren't loaded into the context of `module`,
+  // which may be in use by other threads. Ops of unregistered dialects, like
+  // the check dialect, can only be removed ops, see `isHostOp`.
+
+  DialectRegistry registry;
+  registerJitDialects(registry);
+  MLIRContext context(registry, MLIRContext::Threading::DISABLED);
+  context.allowUnregisteredDialects();
+  ScopedDiagnosticHandler silenceDiagnostics(
+      &context, [](Diagnostic &) { return success(); });
+
+  auto copy = parseSourceString<ModuleOp>(text, &context);
+  if (!copy) return nullptr;
+  auto copyFunc = copy->lookupSymbol<func::FuncOp>(func.getSymName());
+  if (!copyFunc || !copyFunc.getBody().hasOneBlock()) return nullptr;
+  if (!llvm::all_of(copyFunc.getArgumentTypes(), isCompilableType) ||
+      !llvm::all_of(copyFunc.getResultTypes(), isCompilableType))
+    return nullptr;
+
+  SmallVector<int64_t> hostOpPositions;
+  SmallVector<Operation *> hostOps;
+  auto &body = copyFunc.getBody().front();
+  for (auto [i, op] : llvm::enumerate(body)) {
+    if (!isHostOp(op)) continue;
+    if (!llvm::all_of(op.getOperandTypes(), isCompilableType)) return nullptr;
+    hostOpPositions.push_back(i);
+    hostOps.push_back(&op);
+  }
+  auto *returnOp = body.getTerminator();
+  for (auto *op : hostOps) {
+    returnOp->insertOperands(returnOp->getNumOperands(), op->getOperands());
+    op->erase();
+  }
+  copyFunc.setType(FunctionType::get(&context, copyFunc.getArgumentTypes(),
+                                     returnOp->getOperandTypes()));
+
+  // Inputs are shared with the caller and must not be written to.
+  for (unsigned i = 0; i < copyFunc.getNumArguments(); ++i)
+    copyFunc.setArgAttr(i,
+                        bufferization::BufferizationDialect::kWritableAttrName,
+                        BoolAttr::get(&context, false));
+  copyFunc->setAttr(LLVM::LLVMDialect::getEmitCWrapperAttrName(),
+                    UnitAttr::get(&context));
+
+  if (failed(lowerToLLVM(*copy))) return nullptr;
+
+  ExecutionEngineOptions options;
+  options.transformer = makeOptimizingTransformer(
+      /*optLevel=*/3, /*sizeLevel=*/0, /*targetMachine=*/nullptr);
+  options.jitCodeGenOptLevel = llvm::CodeGenOptLevel::Aggressive;
+  auto engine = ExecutionEngine::create(*copy, options);
+  if (!engine) {
+    llvm::consumeError(engine.takeError());
+    return nullptr;
+  }
+  auto function =
+      (*engine)->lookupPacked(("_mlir_ciface_" + func.getSymName()).str());
+  if (!function) {
+    llvm::consumeError(function.takeError());
+    return nullptr;
+  }
+
+  it->second = std::shared_ptr<const JitExecutable>(
+      new JitExecutable(std::move(*engine), *function,
+                        std::move(hostOpPositions)));
+  return it->second;
+}
+
+SmallVector<InterpreterValue> JitExecutable::evaluate(
+    func::FuncOp func, ArrayRef<InterpreterValue> inputs,
+    InterpreterFallback &fallback) const {
+  auto hostOps = getOpsAt(func, hostOpPositions_);
+
+  // Results are followed by the operands of the removed ops, like the
+  // results of the compiled function.
+  SmallVector<Tensor> outputs;
+  for (auto type : func.getResultTypes())
+    outputs.emplace_back(cast<ShapedType>(type));
+  for (auto *op : hostOps)
+    for (auto type : op->getOperandTypes())
+      outputs.emplace_back(cast<ShapedType>(type));
+
+  SmallVector<SmallVector<int64_t>> descriptors;
+  for (auto &input : inputs) {
+    auto tensor = input.getTensor();
+    descriptors.push_back(makeDescriptor(tensor.getData(), tensor.getType()));
+  }
+  for (auto &output : outputs)
+    descriptors.push_back(makeDescriptor(
+        output.getMutableData<char>().data(), output.getType()));
+
+  // The C interface takes a pointer to every descriptor, and its packed form
+  // takes a pointer to every argument.
+  SmallVector<void *> descriptorPointers = llvm::map_to_vector(
+      descriptors, [](SmallVector<int64_t> &d) -> void * { return d.data(); });
+  SmallVector<void *> args = llvm::map_to_vector(
+      descriptorPointers, [](void *&pointer) -> void * { return &pointer; });
+  function_(args.data());
+
+  SmallVector<InterpreterValue> results;
+  auto output = outputs.begin();
+  for (unsigned i = 0; i < func.getNumResults(); ++i)
+    results.push_back(InterpreterValue(*output++));
+
+  for (auto *op : hostOps) {
+    Scope scope(/*parent=*/nullptr);
+    llvm::SmallDenseSet<Value> added;
+    for (auto operand : op->getOperands()) {
+      auto value = *output++;
+      if (added.insert(operand).second) scope.add(operand, value);
+    }
+    auto status = fallback(*op, scope, /*process=*/nullptr);
+    if (status) llvm::report_fatal_error(std::move(status));
+  }
+  return results;
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,89 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_JIT_H
+#define STABLEHLO_REFERENCE_JIT_H
+
+#include <cstdint>
+#include <memory>
+
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Support/LLVM.h"
+#include "stablehlo/reference/Configuration.h"
+#include "stablehlo/reference/Value.h"
+
+namespace mlir {
+class ExecutionEngine;
+
+namespace stablehlo {
+
+/// Entry function of a module compiled to native code, which evaluates
+/// modules with `ExecutionMode::Jit`. A copy of the module is lowered with
+/// `stablehlo-legalize-to-linalg`, bufferized, lowered to the LLVM dialect
+/// and compiled with MLIR's `ExecutionEngine`.
+///
+/// Ops at the top level of the entry function which have no results and
+/// aren't StableHLO ops, e.g. `check.expect_eq`, are removed from the compiled
+/// function, which returns their operands in addition to its results instead.
+/// `evaluate` evaluates these ops on the returned operands with the fallback
+/// of the interpreter after the compiled function, in their order.
+///
+/// Compiled functions are cached by the hash of their module for the lifetime
+/// of the process, so that evaluating the same module again, e.g. with
+/// another `InterpreterExecutable` or in another context, compiles it only
+/// once.
+class JitExecutable {
+ public:
+  /// Returns the compiled `func` of `module`, compiling it on first use.
+  /// Returns nullptr if `func` can't be compiled, e.g. because it has ops
+  /// which `stablehlo-legalize-to-linalg` doesn't support, or arguments or
+  /// results which aren't statically shaped tensors of integer or
+  /// floating-point types which compiled code lays out like `Tensor`.
+  static std::shared_ptr<const JitExecutable> getOrCompile(ModuleOp module,
+                                                           func::FuncOp func);
+
+  ~JitExecutable();
+
+  /// Evaluates `func`, which must be the function which the executable was
+  /// compiled from or a function equivalent to it, with `inputs`. Ops removed
+  /// from the compiled function are evaluated with `fallback`.
+  SmallVector<InterpreterValue> evaluate(func::FuncOp func,
+                                         ArrayRef<InterpreterValue> inputs,
+                                         InterpreterFallback &fallback) const;
+
+ private:
+  using PackedFunction = void (*)(void **);
+
+  JitExecutable(std::unique_ptr<ExecutionEngine> engine,
+                PackedFunction function, SmallVector<int64_t> hostOpPositions);
+
+  std::unique_ptr<ExecutionEngine> engine_;
+
+  /// Packed C interface of the compiled function, which takes pointers to
+  /// the memref descriptors of its arguments, followed by those of its
+  /// results and of the operands of the removed ops as out-parameters.
+  PackedFunction function_;
+
+  /// Positions of the ops in the body of the entry function which were
+  /// removed from the compiled function, see above.
+  SmallVector<int64_t> hostOpPositions_;
+};
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_JIT_H
@@ -0,0 +1,98 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_KERNELPLUGIN_H
+#define STABLEHLO_REFERENCE_KERNELPLUGIN_H
+
+// Stable C ABI of native kernel plugins for the reference interpreter, which
+// implement `custom_call` targets and `composite` ops over raw buffers. This
+// header doesn't depend on MLIR, so that plugins can be built separately and
+// loaded with `KernelRegistry::loadPlugin`.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Version of the ABI, which plugins are passed and must check, and which
+// changes whenever the declarations below change incompatibly.
+#define STABLEHLO_KERNEL_PLUGIN_ABI_VERSION 1
+
+// Element types of buffers. Booleans take one byte per element, and complex
+// numbers are pairs of their real and imaginary parts.
+typedef enum StablehloKernelElementType {
+  STABLEHLO_KERNEL_PRED = 0,
+  STABLEHLO_KERNEL_S8 = 1,
+  STABLEHLO_KERNEL_S16 = 2,
+  STABLEHLO_KERNEL_S32 = 3,
+  STABLEHLO_KERNEL_S64 = 4,
+  STABLEHLO_KERNEL_U8 = 5,
+  STABLEHLO_KERNEL_U16 = 6,
+  STABLEHLO_KERNEL_U32 = 7,
+  STABLEHLO_KERNEL_U64 = 8,
+  STABLEHLO_KERNEL_F16 = 9,
+  STABLEHLO_KERNEL_BF16 = 10,
+  STABLEHLO_KERNEL_F32 = 11,
+  STABLEHLO_KERNEL_F64 = 12,
+  STABLEHLO_KERNEL_C64 = 13,
+  STABLEHLO_KERNEL_C128 = 14,
+} StablehloKernelElementType;
+
+// A dense buffer of `rank` dimensions of sizes `shape`, whose elements are
+// laid out contiguously in row-major order at `data`, aligned to the size of
+// their scalars.
+typedef struct StablehloKernelBuffer {
+  void *data;
+  const int64_t *shape;
+  int64_t rank;
+  StablehloKernelElementType elementType;
+} StablehloKernelBuffer;
+
+// Computes the `numOutputs` results of an op from its `numInputs` operands.
+// Inputs must not be modified, and outputs are allocated with the types of
+// the results of the op. `config` is the `backend_config` of `custom_call`
+// ops if it's a string, the printed `composite_attributes` of `composite`
+// ops, and empty otherwise. Returns 0 on success. On failure, `*error` may be
+// set to a message which stays valid until the next call on the thread.
+typedef int (*StablehloKernelFn)(void *userData, const char *config,
+                                 int64_t numInputs,
+                                 const StablehloKernelBuffer *inputs,
+                                 int64_t numOutputs,
+                                 const StablehloKernelBuffer *outputs,
+                                 const char **error);
+
+// Registers `fn`, which is called with `userData`, as the kernel of the
+// `custom_call` targets or `composite` ops named `name` in `registry`.
+typedef void (*StablehloKernelRegisterFn)(void *registry, const char *name,
+                                          StablehloKernelFn fn,
+                                          void *userData);
+
+// Name of the function which plugins export to register their kernels, of
+// type `StablehloKernelPluginInitFn`.
+#define STABLEHLO_KERNEL_PLUGIN_INIT_SYMBOL "stablehlo_kernel_plugin_init"
+
+// Registers the kernels of a plugin with `registerKernel(registry, ...)`.
+// Returns 0 on success, and nonzero e.g. if the plugin doesn't support
+// `abiVersion`.
+typedef int (*StablehloKernelPluginInitFn)(
+    int32_t abiVersion, void *registry,
+    StablehloKernelRegisterFn registerKernel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // STABLEHLO_REFERENCE_KERNELPLUGIN_H
@@ -0,0 +1,182 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/KernelRegistry.h"
+
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/DebugStringHelper.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/reference/Errors.h"
+#include "stablehlo/reference/EvaluationContext.h"
+#include "stablehlo/reference/KernelPlugin.h"
+#include "stablehlo/reference/Tensor.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+std::optional<StablehloKernelElementType> getKernelElementType(Type type) {
+  if (auto complexType = dyn_cast<ComplexType>(type)) {
+    if (complexType.getElementType().isF32()) return STABLEHLO_KERNEL_C64;
+    if (complexType.getElementType().isF64()) return STABLEHLO_KERNEL_C128;
+    return std::nullopt;
+  }
+  if (type.isInteger(1)) return STABLEHLO_KERNEL_PRED;
+  if (type.isSignlessInteger(8)) return STABLEHLO_KERNEL_S8;
+  if (type.isSignlessInteger(16)) return STABLEHLO_KERNEL_S16;
+  if (type.isSignlessInteger(32)) return STABLEHLO_KERNEL_S32;
+  if (type.isSignlessInteger(64)) return STABLEHLO_KERNEL_S64;
+  if (type.isUnsignedInteger(8)) return STABLEHLO_KERNEL_U8;
+  if (type.isUnsignedInteger(16)) return STABLEHLO_KERNEL_U16;
+  if (type.isUnsignedInteger(32)) return STABLEHLO_KERNEL_U32;
+  if (type.isUnsignedInteger(64)) return STABLEHLO_KERNEL_U64;
+  if (type.isF16()) return STABLEHLO_KERNEL_F16;
+  if (type.isBF16()) return STABLEHLO_KERNEL_BF16;
+  if (type.isF32()) return STABLEHLO_KERNEL_F32;
+  if (type.isF64()) return STABLEHLO_KERNEL_F64;
+  return std::nullopt;
+}
+
+// Returns a buffer of the storage `data` of a tensor of `type`. Shapes are
+// uniqued in the context, so their storage outlives the buffer.
+llvm::Expected<StablehloKernelBuffer> makeBuffer(ShapedType type,
+                                                 const char *data) {
+  auto elementType = getKernelElementType(type.getElementType());
+  if (!elementType)
+    return invalidArgument("Unsupported element type of native kernel: %s",
+                           debugString(type.getElementType()).c_str());
+  return StablehloKernelBuffer{const_cast<char *>(data),
+                               type.getShape().data(), type.getRank(),
+                               *elementType};
+}
+
+std::string getKernelConfig(Operation &op) {
+  if (auto customCallOp = dyn_cast<CustomCallOp>(op))
+    return customCallOp.getBackendConfig().str();
+  std::string config;
+  if (auto compositeOp = dyn_cast<CompositeOp>(op)) {
+    llvm::raw_string_ostream os(config);
+    os << compositeOp.getCompositeAttributes();
+  }
+  return config;
+}
+
+void registerPluginKernel(void *registry, const char *name,
+                          StablehloKernelFn fn, void *userData) {
+  static_cast<KernelRegistry *>(registry)->registerKernel(name, fn, userData);
+}
+
+}  // namespace
+
+void KernelRegistry::registerKernel(StringRef name, Kernel kernel) {
+  kernels_[name] = std::move(kernel);
+}
+
+void KernelRegistry::registerKernel(StringRef name, StablehloKernelFn fn,
+                                    void *userData) {
+  registerKernel(name, [fn, userData](
+                           Operation &op, ArrayRef<Tensor> operands,
+                           SmallVectorImpl<Tensor> &results) -> llvm::Error {
+    SmallVector<StablehloKernelBuffer> inputs;
+    for (const Tensor &operand : operands) {
+      auto buffer = makeBuffer(operand.getType(), operand.getData());
+      if (!buffer) return buffer.takeError();
+      inputs.push_back(*buffer);
+    }
+
+    SmallVector<StablehloKernelBuffer> outputs;
+    for (Type type : op.getResultTypes()) {
+      auto tensorType = dyn_cast<RankedTensorType>(type);
+      if (!tensorType || !tensorType.hasStaticShape())
+        return invalidArgument("Unsupported result type of native kernel: %s",
+                               debugString(type).c_str());
+      Tensor &result = results.emplace_back(tensorType);
+      auto buffer =
+          makeBuffer(tensorType, result.getMutableData<char>().data());
+      if (!buffer) return buffer.takeError();
+      outputs.push_back(*buffer);
+    }
+
+    std::string config = getKernelConfig(op);
+    const char *error = nullptr;
+    if (fn(userData, config.c_str(), inputs.size(), inputs.data(),
+           outputs.size(), outputs.data(), &error) != 0)
+      return invalidArgument("Native kernel %s failed: %s",
+                             getKernelName(op)->str().c_str(),
+                             error ? error : "unknown error");
+    return llvm::Error::success();
+  });
+}
+
+const KernelRegistry::Kernel *KernelRegistry::lookup(StringRef name) const {
+  auto it = kernels_.find(name);
+  return it == kernels_.end() ? nullptr : &it->second;
+}
+
+llvm::Error KernelRegistry::loadPlugin(StringRef path) {
+  std::string error;
+  auto library = llvm::sys::DynamicLibrary::getPermanentLibrary(
+      path.str().c_str(), &error);
+  if (!library.isValid())
+    return invalidArgument("Failed to load kernel plugin %s: %s",
+                           path.str().c_str(), error.c_str());
+  auto init = reinterpret_cast<StablehloKernelPluginInitFn>(
+      library.getAddressOfSymbol(STABLEHLO_KERNEL_PLUGIN_INIT_SYMBOL));
+  if (!init)
+    return invalidArgument("Kernel plugin %s doesn't export %s",
+                           path.str().c_str(),
+                           STABLEHLO_KERNEL_PLUGIN_INIT_SYMBOL);
+  if (init(STABLEHLO_KERNEL_PLUGIN_ABI_VERSION, this, registerPluginKernel))
+    return invalidArgument("Kernel plugin %s failed to register its kernels",
+                           path.str().c_str());
+  return llvm::Error::success();
+}
+
+std::optional<StringRef> getKernelName(Operation &op) {
+  if (auto customCallOp = dyn_cast<CustomCallOp>(op))
+    return customCallOp.getCallTargetName();
+  if (auto compositeOp = dyn_cast<CompositeOp>(op))
+    return compositeOp.getName();
+  return std::nullopt;
+}
+
+std::optional<llvm::Expected<SmallVector<Tensor>>> evalWithRegisteredKernel(
+    Operation &op, ArrayRef<Tensor> operands) {
+  auto *registry = getKernelRegistry();
+  auto name = getKernelName(op);
+  if (!registry || !name) return std::nullopt;
+  const auto *kernel = registry->lookup(*name);
+  if (!kernel) return std::nullopt;
+  SmallVector<Tensor> results;
+  if (auto error = (*kernel)(op, operands, results)) return std::move(error);
+  return std::move(results);
+}
+
+KernelRegistry *getKernelRegistry() {
+  return getEvaluationContext().kernelRegistry;
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
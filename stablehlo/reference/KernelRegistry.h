@@ -0,0 +1,85 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_KERNELREGISTRY_H
+#define STABLEHLO_REFERENCE_KERNELREGISTRY_H
+
+#include <functional>
+#include <optional>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/LLVM.h"
+#include "stablehlo/reference/KernelPlugin.h"
+#include "stablehlo/reference/Tensor.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Native kernels of `custom_call` targets and `composite` ops, keyed by
+/// call target name and composite name, which `eval` uses while the registry
+/// is set in the `EvaluationContext`. Composites with a kernel aren't
+/// decomposed, and `custom_call` ops with a kernel don't reach the
+/// `InterpreterFallback`. Kernels are registered in C++, or over raw buffers
+/// by plugin libraries loaded with `loadPlugin`, see KernelPlugin.h.
+///
+/// Registration isn't thread-safe and must happen before evaluations, which
+/// may call kernels concurrently.
+class KernelRegistry {
+ public:
+  /// Computes the results of `op`, which must have the types of the results
+  /// of `op`, from its `operands`.
+  using Kernel = std::function<llvm::Error(
+      Operation &op, ArrayRef<Tensor> operands, SmallVectorImpl<Tensor> &)>;
+
+  /// Registers `kernel` for `name`, replacing any previous kernel.
+  void registerKernel(StringRef name, Kernel kernel);
+
+  /// Registers a kernel of the plugin ABI for `name`, see
+  /// `StablehloKernelFn`.
+  void registerKernel(StringRef name, StablehloKernelFn fn, void *userData);
+
+  /// Returns the kernel registered for `name`, if any.
+  const Kernel *lookup(StringRef name) const;
+
+  /// Loads the plugin library at `path` and registers its kernels, see
+  /// `StablehloKernelPluginInitFn`. The library stays loaded for the
+  /// lifetime of the process.
+  llvm::Error loadPlugin(StringRef path);
+
+ private:
+  llvm::StringMap<Kernel> kernels_;
+};
+
+/// Returns the name by which the kernel of `op` is registered, i.e. the call
+/// target name of `custom_call` ops and the name of `composite` ops.
+std::optional<StringRef> getKernelName(Operation &op);
+
+/// Evaluates `op` with the kernel registered for it in the registry returned
+/// by `getKernelRegistry`, if any.
+std::optional<llvm::Expected<SmallVector<Tensor>>> evalWithRegisteredKernel(
+    Operation &op, ArrayRef<Tensor> operands);
+
+/// Returns the registry whose kernels `eval` evaluates ops with according to
+/// the current `EvaluationContext`, or nullptr if there is none.
+KernelRegistry *getKernelRegistry();
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_KERNELREGISTRY_H
@@ -0,0 +1,3112 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/Kernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/bit.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "stablehlo/reference/Axes.h"
+#include "stablehlo/reference/Index.h"
+#include "stablehlo/reference/Parallel.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Converts the bits of a binary floating-point value with `kExponentBits`
+// exponent bits and `kMantissaBits` explicit mantissa bits to a double. Such
+// formats are subsets of double, so the conversion is exact. Like APFloat,
+// quiets signaling NaNs and keeps NaN payloads in the high mantissa bits.
+// Normal values, i.e. almost all of them, are converted by rebiasing the
+// exponent and shifting the mantissa into place.
+template <int kExponentBits, int kMantissaBits>
+double narrowFloatToDouble(uint16_t bits) {
+  constexpr int kBias = (1 << (kExponentBits - 1)) - 1;
+  constexpr uint16_t kExponentMask = (1 << kExponentBits) - 1;
+  constexpr uint16_t kMantissaMask = (1 << kMantissaBits) - 1;
+  uint64_t sign = uint64_t((bits >> (kExponentBits + kMantissaBits)) & 1)
+                  << 63;
+  uint16_t exponent = (bits >> kMantissaBits) & kExponentMask;
+  uint64_t mantissa = uint64_t(bits & kMantissaMask) << (52 - kMantissaBits);
+  if (exponent == kExponentMask) {
+    uint64_t result = sign | (uint64_t(0x7FF) << 52) | mantissa;
+    if (mantissa != 0) result |= uint64_t(1) << 51;
+    return llvm::bit_cast<double>(result);
+  }
+  if (exponent == 0) {
+    double magnitude =
+        std::ldexp(bits & kMantissaMask, 1 - kBias - kMantissaBits);
+    return sign ? -magnitude : magnitude;
+  }
+  return llvm::bit_cast<double>(
+      sign | (uint64_t(exponent - kBias + 1023) << 52) | mantissa);
+}
+
+// Rounds `value` to the nearest binary floating-point value with
+// `kExponentBits` exponent bits and `kMantissaBits` explicit mantissa bits,
+// breaking ties to even, and returns its bits. Like APFloat::convert with
+// rmNearestTiesToEven, overflows to infinity, underflows gradually and returns
+// quiet NaNs with truncated payloads.
+template <int kExponentBits, int kMantissaBits>
+uint16_t doubleToNarrowFloat(double value) {
+  constexpr int kBias = (1 << (kExponentBits - 1)) - 1;
+  constexpr uint16_t kInfinity = ((1 << kExponentBits) - 1) << kMantissaBits;
+  constexpr uint16_t kQuietBit = 1 << (kMantissaBits - 1);
+  auto bits = llvm::bit_cast<uint64_t>(value);
+  uint16_t sign = (bits >> 63) << (kExponentBits + kMantissaBits);
+  int doubleExponent = (bits >> 52) & 0x7FF;
+  uint64_t doubleMantissa = bits & ((uint64_t(1) << 52) - 1);
+  if (doubleExponent == 0x7FF) {
+    if (doubleMantissa == 0) return sign | kInfinity;
+    return sign | kInfinity | kQuietBit |
+           static_cast<uint16_t>(doubleMantissa >> (52 - kMantissaBits));
+  }
+
+  // Double subnormals are way below half of the smallest narrow subnormal.
+  if (doubleExponent == 0) return sign;
+  int exponent = doubleExponent - 1023 + kBias;
+  uint64_t significand = doubleMantissa | (uint64_t(1) << 52);
+  int shift = 52 - kMantissaBits + (exponent < 1 ? 1 - exponent : 0);
+  if (shift > 53) return sign;
+  uint64_t truncated = significand >> shift;
+  uint64_t remainder = significand & ((uint64_t(1) << shift) - 1);
+  uint64_t halfway = uint64_t(1) << (shift - 1);
+  if (remainder > halfway || (remainder == halfway && (truncated & 1)))
+    ++truncated;
+
+  // For normal results, `truncated` includes the implicit bit, so adding it to
+  // `exponent - 1` produces the encoding, with mantissa overflow carrying into
+  // the exponent. Subnormal results are encoded as is.
+  uint64_t result =
+      exponent < 1 ? truncated
+                   : (uint64_t(exponent - 1) << kMantissaBits) + truncated;
+  if (result >= kInfinity) return sign | kInfinity;
+  return sign | static_cast<uint16_t>(result);
+}
+
+// Policies describing how kernels access elements of a given element type.
+// `Storage` is the type used by `Tensor` to store elements, `Compute` is the
+// type in which kernels compute, and `load`/`store` convert between the two,
+// with `store` rounding to the element type if needed.
+template <typename T>
+struct NativeFloat {
+  using Storage = T;
+  using Compute = T;
+  static Compute load(Storage value) { return value; }
+  static Storage store(Compute value) { return value; }
+
+  // Rounds results of ops which `Element` computes in double precision, see
+  // `mapWithUpcastToDouble`.
+  static Storage fromDouble(double value) { return static_cast<T>(value); }
+};
+
+// f16 and bf16 have no builtin C++ types, so they are computed in double.
+// Double has more than twice as many mantissa bits as these types, so
+// rounding the result of a basic arithmetic operation computed in double
+// yields the correctly rounded result, i.e. the same result as APFloat.
+template <int kExponentBits, int kMantissaBits>
+struct NarrowFloat {
+  using Storage = uint16_t;
+  using Compute = double;
+  static Compute load(Storage value) {
+    return narrowFloatToDouble<kExponentBits, kMantissaBits>(value);
+  }
+  static Storage store(Compute value) {
+    return doubleToNarrowFloat<kExponentBits, kMantissaBits>(value);
+  }
+  static Storage fromDouble(double value) { return store(value); }
+};
+
+using Float16 = NarrowFloat<5, 10>;
+using BFloat16 = NarrowFloat<8, 7>;
+
+// Conversions between an f8 type and double. The f8 types differ in their
+// biases and in how they encode NaNs, infinities and negative zero, so instead
+// of handling every variant with bit manipulation, their 256 values are
+// converted with APFloat once. Doubles are rounded by searching the finite
+// non-negative values, which are ordered like their encodings in all
+// variants.
+class Float8Table {
+ public:
+  explicit Float8Table(const llvm::fltSemantics &semantics)
+      : semantics_(semantics) {
+    for (unsigned bits = 0; bits < values_.size(); ++bits) {
+      APFloat value(semantics, APInt(8, bits));
+      bool losesInfo;
+      value.convert(APFloat::IEEEdouble(), APFloat::rmNearestTiesToEven,
+                    &losesInfo);
+      values_[bits] = value.convertToDouble();
+    }
+    while (numMagnitudes_ < 0x80 && std::isfinite(values_[numMagnitudes_]))
+      ++numMagnitudes_;
+    positiveZero_ = roundWithAPFloat(0.0);
+    negativeZero_ = roundWithAPFloat(-0.0);
+    positiveOverflow_ = roundWithAPFloat(std::numeric_limits<double>::max());
+    negativeOverflow_ = roundWithAPFloat(-std::numeric_limits<double>::max());
+  }
+
+  double toDouble(uint8_t bits) const { return values_[bits]; }
+
+  // Rounds `value` to the nearest f8 value, breaking ties to even, with the
+  // same results as APFloat::convert with rmNearestTiesToEven. Double has
+  // more than twice as many mantissa bits as f8 types, so rounding the result
+  // of a basic arithmetic operation computed in double yields the correctly
+  // rounded result.
+  uint8_t fromDouble(double value) const {
+    // NaN payloads are rare and differ between the variants.
+    if (std::isnan(value)) return roundWithAPFloat(value);
+    bool isNegative = std::signbit(value);
+    double magnitude = std::fabs(value);
+    const double *magnitudes = values_.data();
+    int64_t lower = std::upper_bound(magnitudes, magnitudes + numMagnitudes_,
+                                     magnitude) -
+                    magnitudes - 1;
+    // Past the largest finite value, the next encoding stands for the value
+    // which it would have with an unbounded exponent range, so that values
+    // which round to it overflow like in APFloat. The midpoint of two f8
+    // values is exact in double.
+    double lowerValue = magnitudes[lower];
+    double upperValue = lower + 1 < numMagnitudes_
+                            ? magnitudes[lower + 1]
+                            : 2 * lowerValue - magnitudes[lower - 1];
+    double midpoint = (lowerValue + upperValue) / 2;
+    int64_t bits = magnitude < midpoint ||
+                           (magnitude == midpoint && lower % 2 == 0)
+                       ? lower
+                       : lower + 1;
+    if (bits == numMagnitudes_)
+      return isNegative ? negativeOverflow_ : positiveOverflow_;
+    if (bits == 0) return isNegative ? negativeZero_ : positiveZero_;
+    return static_cast<uint8_t>(isNegative ? bits | 0x80 : bits);
+  }
+
+ private:
+  uint8_t roundWithAPFloat(double value) const {
+    APFloat result(value);
+    bool losesInfo;
+    result.convert(semantics_, APFloat::rmNearestTiesToEven, &losesInfo);
+    return static_cast<uint8_t>(result.bitcastToAPInt().getZExtValue());
+  }
+
+  const llvm::fltSemantics &semantics_;
+  std::array<double, 256> values_;
+  // Number of finite non-negative values, whose encodings are 0, 1, ...
+  int64_t numMagnitudes_ = 0;
+  uint8_t positiveZero_;
+  uint8_t negativeZero_;
+  uint8_t positiveOverflow_;
+  uint8_t negativeOverflow_;
+};
+
+// f8 types are computed in double like f16 and bf16, converting with the
+// `Float8Table` of `getSemantics()`.
+template <const llvm::fltSemantics &(*getSemantics)()>
+struct Float8 {
+  using Storage = uint8_t;
+  using Compute = double;
+  static const Float8Table &getTable() {
+    static const Float8Table table(getSemantics());
+    return table;
+  }
+  static Compute load(Storage value) { return getTable().toDouble(value); }
+  static Storage store(Compute value) { return getTable().fromDouble(value); }
+  static Storage fromDouble(double value) { return store(value); }
+};
+
+using Float8E4M3B11FNUZ = Float8<&llvm::APFloatBase::Float8E4M3B11FNUZ>;
+using Float8E4M3FN = Float8<&llvm::APFloatBase::Float8E4M3FN>;
+using Float8E4M3FNUZ = Float8<&llvm::APFloatBase::Float8E4M3FNUZ>;
+using Float8E5M2 = Float8<&llvm::APFloatBase::Float8E5M2>;
+using Float8E5M2FNUZ = Float8<&llvm::APFloatBase::Float8E5M2FNUZ>;
+
+template <typename T>
+struct NativeInteger {
+  using Storage = T;
+  using Compute = T;
+  static Compute load(Storage value) { return value; }
+  static Storage store(Compute value) { return value; }
+};
+
+// Complex numbers are stored as `std::complex` of their f32 or f64 parts,
+// and computed natively rather than as pairs of APFloat like in `Element`.
+// Ops which `Element` computes in complex double precision round the result
+// of the double computation once, like `mapWithUpcastToDouble`.
+template <typename T>
+struct NativeComplex {
+  using Storage = std::complex<T>;
+  using Compute = std::complex<T>;
+  static Compute load(Storage value) { return value; }
+  static Storage store(Compute value) { return value; }
+  static Storage fromDouble(std::complex<double> value) {
+    return {static_cast<T>(value.real()), static_cast<T>(value.imag())};
+  }
+};
+
+template <typename T>
+constexpr bool isComplex = false;
+
+template <typename T>
+constexpr bool isComplex<std::complex<T>> = true;
+
+template <typename Policy>
+constexpr bool isFloatPolicy =
+    std::is_floating_point_v<typename Policy::Compute>;
+
+// Invokes `fn` with a value-initialized policy object for `elementType` and
+// returns its result. Returns false if kernels don't support `elementType`.
+template <typename Fn>
+bool dispatchOnPolicy(Type elementType, Fn &&fn) {
+  if (elementType.isF16()) return fn(Float16());
+  if (elementType.isBF16()) return fn(BFloat16());
+  if (elementType.isFloat8E4M3B11FNUZ()) return fn(Float8E4M3B11FNUZ());
+  if (elementType.isFloat8E4M3FN()) return fn(Float8E4M3FN());
+  if (elementType.isFloat8E4M3FNUZ()) return fn(Float8E4M3FNUZ());
+  if (elementType.isFloat8E5M2()) return fn(Float8E5M2());
+  if (elementType.isFloat8E5M2FNUZ()) return fn(Float8E5M2FNUZ());
+  bool applied = false;
+  dispatchOnNativeType(elementType, [&](auto zero) {
+    using T = decltype(zero);
+    if constexpr (std::is_floating_point_v<T>)
+      applied = fn(NativeFloat<T>());
+    else
+      applied = fn(NativeInteger<T>());
+  });
+  return applied;
+}
+
+// Invokes `fn` with a value-initialized `NativeComplex` policy for the
+// complex `elementType` and returns its result. Returns false if kernels
+// don't support `elementType`, e.g. because it isn't complex.
+template <typename Fn>
+bool dispatchOnComplexPolicy(Type elementType, Fn &&fn) {
+  auto complexType = dyn_cast<ComplexType>(elementType);
+  if (!complexType) return false;
+  if (complexType.getElementType().isF32()) return fn(NativeComplex<float>());
+  if (complexType.getElementType().isF64())
+    return fn(NativeComplex<double>());
+  return false;
+}
+
+// Type used to carry out integer arithmetic on the native type `T` with the
+// same wraparound semantics as APInt. Unsigned types don't have undefined
+// behavior on overflow, and widening to at least `unsigned` makes sure that
+// integral promotion doesn't turn e.g. `uint16_t * uint16_t` into a signed
+// multiplication.
+template <typename T>
+using WrappingType = std::common_type_t<std::make_unsigned_t<T>, unsigned>;
+
+template <typename T>
+T wrappingAdd(T lhs, T rhs) {
+  using U = WrappingType<T>;
+  return static_cast<T>(static_cast<U>(lhs) + static_cast<U>(rhs));
+}
+
+template <typename T>
+T wrappingSubtract(T lhs, T rhs) {
+  using U = WrappingType<T>;
+  return static_cast<T>(static_cast<U>(lhs) - static_cast<U>(rhs));
+}
+
+template <typename T>
+T wrappingMultiply(T lhs, T rhs) {
+  using U = WrappingType<T>;
+  return static_cast<T>(static_cast<U>(lhs) * static_cast<U>(rhs));
+}
+
+template <typename T>
+T wrappingNegate(T operand) {
+  using U = WrappingType<T>;
+  return static_cast<T>(U(0) - static_cast<U>(operand));
+}
+
+// Like llvm::maximum, propagates NaNs and treats -0.0 as less than +0.0.
+template <typename T>
+T maximum(T lhs, T rhs) {
+  if constexpr (std::is_floating_point_v<T>) {
+    if (std::isnan(lhs)) return lhs;
+    if (std::isnan(rhs)) return rhs;
+    if (lhs == rhs) return std::signbit(lhs) ? rhs : lhs;
+  }
+  return lhs < rhs ? rhs : lhs;
+}
+
+// Like llvm::minimum, propagates NaNs and treats -0.0 as less than +0.0.
+template <typename T>
+T minimum(T lhs, T rhs) {
+  if constexpr (std::is_floating_point_v<T>) {
+    if (std::isnan(lhs)) return lhs;
+    if (std::isnan(rhs)) return rhs;
+    if (lhs == rhs) return std::signbit(lhs) ? lhs : rhs;
+  }
+  return rhs < lhs ? rhs : lhs;
+}
+
+// Like `Element::operator*`, rounds every product and sum of parts to the
+// part type. Unlike `std::complex::operator*`, doesn't try to recover
+// infinities from NaN results, which keeps the loops vectorizable.
+template <typename T>
+std::complex<T> complexMultiply(std::complex<T> lhs, std::complex<T> rhs) {
+  return {lhs.real() * rhs.real() - lhs.imag() * rhs.imag(),
+          lhs.real() * rhs.imag() + lhs.imag() * rhs.real()};
+}
+
+template <typename T>
+std::complex<double> toComplexDouble(std::complex<T> value) {
+  return {static_cast<double>(value.real()),
+          static_cast<double>(value.imag())};
+}
+
+// Minimum amount of work, in elements or multiply-adds, which kernels hand to
+// `parallelForChunks` per chunk, so that scheduling overhead stays negligible.
+constexpr int64_t kMinChunkSize = 1 << 14;
+
+// Merges the dimensions of `shape` which are contiguous with each other in all
+// of `N` operands with `strides` and drops dimensions of size 1, appending the
+// resulting shape and strides to `runShape` and `runStrides`.
+template <size_t N>
+void mergeStridedDims(const Sizes &shape, const std::array<Sizes, N> &strides,
+                      Sizes &runShape, std::array<Sizes, N> &runStrides) {
+  for (size_t d = 0; d < shape.size(); ++d) {
+    if (shape[d] == 1) continue;
+    bool isMergeable = !runShape.empty();
+    for (size_t k = 0; k < N && isMergeable; ++k)
+      isMergeable = runStrides[k].back() == strides[k][d] * shape[d];
+    if (isMergeable) {
+      runShape.back() *= shape[d];
+      for (size_t k = 0; k < N; ++k) runStrides[k].back() = strides[k][d];
+      continue;
+    }
+    runShape.push_back(shape[d]);
+    for (size_t k = 0; k < N; ++k) runStrides[k].push_back(strides[k][d]);
+  }
+}
+
+// Sequential counterpart of `parallelForStridedRuns` for a shape and strides
+// which were already merged by `mergeStridedDims`, starting from `positions`.
+// Calls `fn(size, positions, innerStrides)` for every innermost row in
+// canonical order. Used by kernels which hand whole windows to
+// `parallelForChunks` rather than single elements.
+template <size_t N, typename Fn>
+void forEachStridedRun(const Sizes &runShape,
+                       const std::array<Sizes, N> &runStrides,
+                       std::array<int64_t, N> positions, Fn fn) {
+  int64_t rank = runShape.size();
+  int64_t rowSize = rank == 0 ? 1 : runShape.back();
+  std::array<int64_t, N> innerStrides{};
+  if (rank != 0)
+    for (size_t k = 0; k < N; ++k) innerStrides[k] = runStrides[k].back();
+  int64_t numRows = 1;
+  for (int64_t d = 0; d + 1 < rank; ++d) numRows *= runShape[d];
+  if (rowSize == 0) return;
+
+  Sizes index(std::max<int64_t>(rank - 1, 0), 0);
+  for (int64_t row = 0; row < numRows; ++row) {
+    fn(rowSize, positions, innerStrides);
+    for (int64_t d = rank - 2; d >= 0; --d) {
+      for (size_t k = 0; k < N; ++k) positions[k] += runStrides[k][d];
+      if (++index[d] < runShape[d]) break;
+      for (size_t k = 0; k < N; ++k)
+        positions[k] -= runStrides[k][d] * runShape[d];
+      index[d] = 0;
+    }
+  }
+}
+
+// Calls `fn(begin, size, positions, innerStrides)` in parallel for runs of
+// consecutive flattened positions [begin, begin + size) of `shape`, together
+// covering all of them, where `positions[k]` is the position of the element at
+// `begin` in the storage of the k-th of `N` operands with `strides`, see
+// `Tensor::getStrides`, and `innerStrides[k]` is the distance between the
+// elements of the run in that storage. Dimensions which are contiguous with
+// each other in all operands are merged first by `mergeStridedDims`, so that
+// runs are as long as possible.
+template <size_t N, typename Fn>
+void parallelForStridedRuns(const Sizes &shape, std::array<Sizes, N> strides,
+                            Fn fn) {
+  Sizes runShape;
+  std::array<Sizes, N> runStrides;
+  mergeStridedDims<N>(shape, strides, runShape, runStrides);
+
+  int64_t rank = runShape.size();
+  int64_t rowSize = rank == 0 ? 1 : runShape.back();
+  std::array<int64_t, N> innerStrides{};
+  if (rank != 0)
+    for (size_t k = 0; k < N; ++k) innerStrides[k] = runStrides[k].back();
+  int64_t numElements = 1;
+  for (auto size : shape) numElements *= size;
+  parallelForChunks(
+      numElements, kMinChunkSize, [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end;) {
+          std::array<int64_t, N> positions{};
+          int64_t rest = i;
+          for (int64_t d = rank - 1; d >= 0; --d) {
+            int64_t coordinate = rest % runShape[d];
+            rest /= runShape[d];
+            for (size_t k = 0; k < N; ++k)
+              positions[k] += coordinate * runStrides[k][d];
+          }
+          int64_t size = std::min(rowSize - i % rowSize, end - i);
+          fn(i, size, positions, innerStrides);
+          i += size;
+        }
+      });
+}
+
+// Returns whether `tensor` is a splat with more than one element, see
+// `Tensor::isSplat`, which elementwise kernels whose operands are all such
+// splats evaluate on a single element.
+bool isRepeatedSplat(const Tensor &tensor) {
+  return tensor.getNumElements() > 1 && tensor.isSplat();
+}
+
+// Returns the element of the splat `tensor` as a tensor of rank 0.
+Tensor getSplatElement(const Tensor &tensor) {
+  return makeStridedView(
+      tensor, RankedTensorType::get({}, tensor.getElementType()),
+      /*offset=*/0, {});
+}
+
+// Evaluates an elementwise kernel whose operands are splats once, by calling
+// `fn(element)` with a tensor of rank 0 of the element type of `result`. If
+// `fn` applies, `result` is replaced with a splat view of `element`. This
+// keeps results of splats, e.g. masks computed from broadcasts of scalars,
+// splats themselves.
+template <typename Fn>
+bool evalOnSplatElement(Tensor &result, Fn fn) {
+  Tensor element(RankedTensorType::get({}, result.getElementType()));
+  if (!fn(element)) return false;
+  result = makeSplatView(element, result.getType());
+  return true;
+}
+
+// The loops below work on contiguous arrays with the element type dispatched
+// outside of them, so that compilers can vectorize them. Strided views, e.g.
+// broadcasts, are read in place rather than materialized.
+template <typename Policy, typename Fn>
+void mapUnary(const Tensor &operand, Tensor &result, Fn fn) {
+  using Storage = typename Policy::Storage;
+  auto resultData = result.getMutableData<Storage>();
+  if (operand.isStrided()) {
+    const Storage *operandData = operand.getStridedData<Storage>();
+    parallelForStridedRuns<1>(
+        result.getShape(), {operand.getStrides()},
+        [&](int64_t begin, int64_t size, std::array<int64_t, 1> positions,
+            std::array<int64_t, 1> innerStrides) {
+          const Storage *x = operandData + positions[0];
+          for (int64_t i = 0; i < size; ++i)
+            resultData[begin + i] =
+                Policy::store(fn(Policy::load(x[i * innerStrides[0]])));
+        });
+    return;
+  }
+
+  auto operandData = operand.getData<Storage>();
+  parallelForChunks(resultData.size(), kMinChunkSize,
+                    [&](int64_t begin, int64_t end) {
+                      for (int64_t i = begin; i < end; ++i)
+                        resultData[i] =
+                            Policy::store(fn(Policy::load(operandData[i])));
+                    });
+}
+
+template <typename Policy, typename Fn>
+void mapBinary(const Tensor &lhs, const Tensor &rhs, Tensor &result, Fn fn) {
+  using Storage = typename Policy::Storage;
+  auto resultData = result.getMutableData<Storage>();
+  if (lhs.isStrided() || rhs.isStrided()) {
+    const Storage *lhsData = lhs.getStridedData<Storage>();
+    const Storage *rhsData = rhs.getStridedData<Storage>();
+    parallelForStridedRuns<2>(
+        result.getShape(), {lhs.getStrides(), rhs.getStrides()},
+        [&](int64_t begin, int64_t size, std::array<int64_t, 2> positions,
+            std::array<int64_t, 2> innerStrides) {
+          const Storage *x = lhsData + positions[0];
+          const Storage *y = rhsData + positions[1];
+          // Runs over splats, e.g. broadcasts of scalars, load their element
+          // once, so that the loops over the other operand vectorize.
+          if (innerStrides[0] == 0 && innerStrides[1] == 1) {
+            auto lhsElement = Policy::load(x[0]);
+            for (int64_t i = 0; i < size; ++i)
+              resultData[begin + i] =
+                  Policy::store(fn(lhsElement, Policy::load(y[i])));
+            return;
+          }
+          if (innerStrides[0] == 1 && innerStrides[1] == 0) {
+            auto rhsElement = Policy::load(y[0]);
+            for (int64_t i = 0; i < size; ++i)
+              resultData[begin + i] =
+                  Policy::store(fn(Policy::load(x[i]), rhsElement));
+            return;
+          }
+          for (int64_t i = 0; i < size; ++i)
+            resultData[begin + i] =
+                Policy::store(fn(Policy::load(x[i * innerStrides[0]]),
+                                 Policy::load(y[i * innerStrides[1]])));
+        });
+    return;
+  }
+
+  auto lhsData = lhs.getData<Storage>();
+  auto rhsData = rhs.getData<Storage>();
+  parallelForChunks(resultData.size(), kMinChunkSize,
+                    [&](int64_t begin, int64_t end) {
+                      for (int64_t i = begin; i < end; ++i)
+                        resultData[i] = Policy::store(fn(
+                            Policy::load(lhsData[i]),
+                            Policy::load(rhsData[i])));
+                    });
+}
+
+template <typename Policy>
+bool evalFloatUnaryKernel(UnaryKernel kernel, const Tensor &operand,
+                          Tensor &result) {
+  using C = typename Policy::Compute;
+  auto map = [&](auto fn) {
+    mapUnary<Policy>(operand, result, fn);
+    return true;
+  };
+  // Transcendental functions are computed in double precision and rounded
+  // once, like `mapWithUpcastToDouble` in Element.cpp.
+  auto mapViaDouble = [&](auto fn) {
+    mapUnary<Policy>(operand, result, [&](C x) {
+      return Policy::load(Policy::fromDouble(fn(static_cast<double>(x))));
+    });
+    return true;
+  };
+  switch (kernel) {
+    case UnaryKernel::Abs:
+      return map([](C x) { return std::fabs(x); });
+    case UnaryKernel::Cbrt:
+      return mapViaDouble([](double x) { return std::cbrt(x); });
+    case UnaryKernel::Ceil:
+      return map([](C x) { return std::ceil(x); });
+    case UnaryKernel::Cosine:
+      return mapViaDouble([](double x) { return std::cos(x); });
+    case UnaryKernel::Exponential:
+      return mapViaDouble([](double x) { return std::exp(x); });
+    case UnaryKernel::ExponentialMinusOne:
+      return mapViaDouble([](double x) { return std::expm1(x); });
+    case UnaryKernel::Floor:
+      return map([](C x) { return std::floor(x); });
+    case UnaryKernel::Log:
+      return mapViaDouble([](double x) { return std::log(x); });
+    case UnaryKernel::LogPlusOne:
+      return mapViaDouble([](double x) { return std::log1p(x); });
+    case UnaryKernel::Logistic:
+      // Like `logistic(Element)`, rounds every intermediate result to the
+      // element type: 1 / (1 + exp(-x)).
+      return map([](C x) {
+        C exp = Policy::load(Policy::fromDouble(std::exp(-double(x))));
+        C denominator = Policy::load(Policy::store(C(1) + exp));
+        return C(1) / denominator;
+      });
+    case UnaryKernel::Negate:
+      return map([](C x) { return -x; });
+    case UnaryKernel::RoundNearestAfz:
+      return map([](C x) { return std::round(x); });
+    case UnaryKernel::RoundNearestEven:
+      return map([](C x) { return std::nearbyint(x); });
+    case UnaryKernel::Rsqrt:
+      return mapViaDouble([](double x) { return 1.0 / std::sqrt(x); });
+    case UnaryKernel::Sign:
+      return map([](C x) {
+        if (std::isnan(x) || x == C(0)) return x;
+        return x < C(0) ? C(-1) : C(1);
+      });
+    case UnaryKernel::Sine:
+      return mapViaDouble([](double x) { return std::sin(x); });
+    case UnaryKernel::Sqrt:
+      return mapViaDouble([](double x) { return std::sqrt(x); });
+    case UnaryKernel::Tanh:
+      return mapViaDouble([](double x) { return std::tanh(x); });
+    case UnaryKernel::CountLeadingZeros:
+    case UnaryKernel::Not:
+    case UnaryKernel::PopulationCount:
+      return false;
+  }
+  llvm_unreachable("unknown unary kernel");
+}
+
+template <typename Policy>
+bool evalIntegerUnaryKernel(UnaryKernel kernel, const Tensor &operand,
+                            Tensor &result) {
+  using T = typename Policy::Compute;
+  using S = std::make_signed_t<T>;
+  using U = std::make_unsigned_t<T>;
+  auto map = [&](auto fn) {
+    mapUnary<Policy>(operand, result,
+                     [&](T x) { return static_cast<T>(fn(x)); });
+    return true;
+  };
+  // Like APInt, `abs` and `sign` interpret the bits of their operand as a
+  // signed value, including for unsigned types.
+  switch (kernel) {
+    case UnaryKernel::Abs:
+      return map(
+          [](T x) { return static_cast<S>(x) < 0 ? wrappingNegate(x) : x; });
+    case UnaryKernel::CountLeadingZeros:
+      return map([](T x) { return llvm::countl_zero(static_cast<U>(x)); });
+    case UnaryKernel::Negate:
+      return map([](T x) { return wrappingNegate(x); });
+    case UnaryKernel::Not:
+      return map([](T x) { return ~x; });
+    case UnaryKernel::PopulationCount:
+      return map([](T x) { return llvm::popcount(static_cast<U>(x)); });
+    case UnaryKernel::Sign:
+      return map([](T x) {
+        if (x == 0) return T(0);
+        return static_cast<S>(x) < 0 ? static_cast<T>(-1) : T(1);
+      });
+    case UnaryKernel::Cbrt:
+    case UnaryKernel::Ceil:
+    case UnaryKernel::Cosine:
+    case UnaryKernel::Exponential:
+    case UnaryKernel::ExponentialMinusOne:
+    case UnaryKernel::Floor:
+    case UnaryKernel::Log:
+    case UnaryKernel::LogPlusOne:
+    case UnaryKernel::Logistic:
+    case UnaryKernel::RoundNearestAfz:
+    case UnaryKernel::RoundNearestEven:
+    case UnaryKernel::Rsqrt:
+    case UnaryKernel::Sine:
+    case UnaryKernel::Sqrt:
+    case UnaryKernel::Tanh:
+      return false;
+  }
+  llvm_unreachable("unknown unary kernel");
+}
+
+template <typename Policy>
+bool evalFloatBinaryKernel(BinaryKernel kernel, const Tensor &lhs,
+                           const Tensor &rhs, Tensor &result) {
+  using C = typename Policy::Compute;
+  auto map = [&](auto fn) {
+    mapBinary<Policy>(lhs, rhs, result, fn);
+    return true;
+  };
+  auto mapViaDouble = [&](auto fn) {
+    mapBinary<Policy>(lhs, rhs, result, [&](C x, C y) {
+      return Policy::load(Policy::fromDouble(
+          fn(static_cast<double>(x), static_cast<double>(y))));
+    });
+    return true;
+  };
+  switch (kernel) {
+    case BinaryKernel::Add:
+      return map([](C x, C y) { return x + y; });
+    case BinaryKernel::Atan2:
+      return mapViaDouble([](double x, double y) { return std::atan2(x, y); });
+    case BinaryKernel::Divide:
+      return map([](C x, C y) { return x / y; });
+    case BinaryKernel::Maximum:
+      return map([](C x, C y) { return maximum(x, y); });
+    case BinaryKernel::Minimum:
+      return map([](C x, C y) { return minimum(x, y); });
+    case BinaryKernel::Multiply:
+      return map([](C x, C y) { return x * y; });
+    case BinaryKernel::Power:
+      return mapViaDouble([](double x, double y) { return std::pow(x, y); });
+    case BinaryKernel::Remainder:
+      // Like APFloat::mod, the result is exact and has the sign of `x`.
+      return map([](C x, C y) { return std::fmod(x, y); });
+    case BinaryKernel::Subtract:
+      return map([](C x, C y) { return x - y; });
+    case BinaryKernel::And:
+    case BinaryKernel::Or:
+    case BinaryKernel::Xor:
+      return false;
+  }
+  llvm_unreachable("unknown binary kernel");
+}
+
+template <typename Policy>
+bool evalIntegerBinaryKernel(BinaryKernel kernel, const Tensor &lhs,
+                             const Tensor &rhs, Tensor &result) {
+  using T = typename Policy::Compute;
+  auto map = [&](auto fn) {
+    mapBinary<Policy>(lhs, rhs, result,
+                      [&](T x, T y) { return static_cast<T>(fn(x, y)); });
+    return true;
+  };
+  switch (kernel) {
+    case BinaryKernel::Add:
+      return map([](T x, T y) { return wrappingAdd(x, y); });
+    case BinaryKernel::And:
+      return map([](T x, T y) { return x & y; });
+    case BinaryKernel::Maximum:
+      return map([](T x, T y) { return maximum(x, y); });
+    case BinaryKernel::Minimum:
+      return map([](T x, T y) { return minimum(x, y); });
+    case BinaryKernel::Multiply:
+      return map([](T x, T y) { return wrappingMultiply(x, y); });
+    case BinaryKernel::Or:
+      return map([](T x, T y) { return x | y; });
+    case BinaryKernel::Subtract:
+      return map([](T x, T y) { return wrappingSubtract(x, y); });
+    case BinaryKernel::Xor:
+      return map([](T x, T y) { return x ^ y; });
+    // Integer division by zero and overflow are left to `Element`.
+    case BinaryKernel::Atan2:
+    case BinaryKernel::Divide:
+    case BinaryKernel::Power:
+    case BinaryKernel::Remainder:
+      return false;
+  }
+  llvm_unreachable("unknown binary kernel");
+}
+
+template <typename Policy>
+bool evalComplexUnaryKernel(UnaryKernel kernel, const Tensor &operand,
+                            Tensor &result) {
+  using C = typename Policy::Compute;
+  auto map = [&](auto fn) {
+    mapUnary<Policy>(operand, result, fn);
+    return true;
+  };
+  // Like `mapWithUpcastToDouble` in Element.cpp.
+  auto mapViaDouble = [&](auto fn) {
+    mapUnary<Policy>(operand, result, [&](C x) {
+      return Policy::fromDouble(fn(toComplexDouble(x)));
+    });
+    return true;
+  };
+  using Complex = std::complex<double>;
+  switch (kernel) {
+    case UnaryKernel::Cosine:
+      return mapViaDouble([](Complex x) { return std::cos(x); });
+    case UnaryKernel::Exponential:
+      return mapViaDouble([](Complex x) { return std::exp(x); });
+    case UnaryKernel::ExponentialMinusOne:
+      return mapViaDouble([](Complex x) { return std::exp(x) - Complex(1.0); });
+    case UnaryKernel::Log:
+      return mapViaDouble([](Complex x) { return std::log(x); });
+    case UnaryKernel::LogPlusOne:
+      return mapViaDouble([](Complex x) { return std::log(x + Complex(1.0)); });
+    case UnaryKernel::Logistic:
+      // Like `logistic(Element)`, rounds every intermediate result to the
+      // element type: 1 / (1 + exp(-x)).
+      return map([](C x) {
+        C exp = Policy::fromDouble(std::exp(toComplexDouble(-x)));
+        C denominator = C(1) + exp;
+        return Policy::fromDouble(1.0 / toComplexDouble(denominator));
+      });
+    case UnaryKernel::Negate:
+      return map([](C x) { return -x; });
+    case UnaryKernel::Rsqrt:
+      return mapViaDouble([](Complex x) { return 1.0 / std::sqrt(x); });
+    case UnaryKernel::Sign:
+      // Like `sign(Element)`, divides by the magnitude rounded to the part
+      // type.
+      return map([](C x) {
+        using T = typename C::value_type;
+        if (std::isnan(x.real()) || std::isnan(x.imag()))
+          return C(std::numeric_limits<T>::quiet_NaN(),
+                   std::numeric_limits<T>::quiet_NaN());
+        if (x == C(0)) return C(0);
+        auto magnitude = static_cast<T>(std::abs(toComplexDouble(x)));
+        return Policy::fromDouble(toComplexDouble(x) /
+                                  static_cast<double>(magnitude));
+      });
+    case UnaryKernel::Sine:
+      return mapViaDouble([](Complex x) { return std::sin(x); });
+    case UnaryKernel::Sqrt:
+      return mapViaDouble([](Complex x) { return std::sqrt(x); });
+    case UnaryKernel::Tanh:
+      return mapViaDouble([](Complex x) { return std::tanh(x); });
+    // `abs` has a real result, and the others don't apply to complex
+    // numbers.
+    case UnaryKernel::Abs:
+    case UnaryKernel::Cbrt:
+    case UnaryKernel::Ceil:
+    case UnaryKernel::CountLeadingZeros:
+    case UnaryKernel::Floor:
+    case UnaryKernel::Not:
+    case UnaryKernel::PopulationCount:
+    case UnaryKernel::RoundNearestAfz:
+    case UnaryKernel::RoundNearestEven:
+      return false;
+  }
+  llvm_unreachable("unknown unary kernel");
+}
+
+template <typename Policy>
+bool evalComplexBinaryKernel(BinaryKernel kernel, const Tensor &lhs,
+                             const Tensor &rhs, Tensor &result) {
+  using C = typename Policy::Compute;
+  auto map = [&](auto fn) {
+    mapBinary<Policy>(lhs, rhs, result, fn);
+    return true;
+  };
+  auto mapViaDouble = [&](auto fn) {
+    mapBinary<Policy>(lhs, rhs, result, [&](C x, C y) {
+      return Policy::fromDouble(fn(toComplexDouble(x), toComplexDouble(y)));
+    });
+    return true;
+  };
+  using Complex = std::complex<double>;
+  switch (kernel) {
+    case BinaryKernel::Add:
+      return map([](C x, C y) { return x + y; });
+    case BinaryKernel::Divide:
+      return mapViaDouble([](Complex x, Complex y) { return x / y; });
+    case BinaryKernel::Multiply:
+      return map([](C x, C y) { return complexMultiply(x, y); });
+    case BinaryKernel::Power:
+      return mapViaDouble([](Complex x, Complex y) { return std::pow(x, y); });
+    case BinaryKernel::Subtract:
+      return map([](C x, C y) { return x - y; });
+    case BinaryKernel::And:
+    case BinaryKernel::Atan2:
+    case BinaryKernel::Maximum:
+    case BinaryKernel::Minimum:
+    case BinaryKernel::Or:
+    case BinaryKernel::Remainder:
+    case BinaryKernel::Xor:
+      return false;
+  }
+  llvm_unreachable("unknown binary kernel");
+}
+
+// Block sizes of the GEMM kernel, chosen so that a block of the packed rhs
+// (kBlockK x kBlockN elements) stays in a typical L2 cache while it is
+// multiplied with every row of the packed lhs.
+constexpr int64_t kBlockK = 128;
+constexpr int64_t kBlockN = 256;
+
+// Multiply-add helpers which wrap around for integers like APInt, and
+// multiply complex numbers like `Element`.
+template <typename T>
+T kernelAdd(T lhs, T rhs) {
+  if constexpr (std::is_integral_v<T>)
+    return wrappingAdd(lhs, rhs);
+  else
+    return lhs + rhs;
+}
+
+template <typename T>
+T kernelMultiply(T lhs, T rhs) {
+  if constexpr (std::is_integral_v<T>)
+    return wrappingMultiply(lhs, rhs);
+  else if constexpr (isComplex<T>)
+    return complexMultiply(lhs, rhs);
+  else
+    return lhs * rhs;
+}
+
+// Assigns row-major strides to dimensions `dims` of `shape`, the innermost of
+// which gets stride `scale`, and returns the product of their sizes.
+int64_t assignStrides(const Sizes &shape, const Axes &dims, int64_t scale,
+                      Sizes &strides) {
+  for (auto dim : llvm::reverse(dims)) {
+    strides[dim] = scale;
+    scale *= shape[dim];
+  }
+  int64_t size = 1;
+  for (auto dim : dims) size *= shape[dim];
+  return size;
+}
+
+// Copies elements of `operand` to `packed` in their compute type, such that
+// the element at index `i` ends up at offset `sum(i[d] * packedStrides[d])`.
+template <typename Policy>
+void pack(const Tensor &operand, const Sizes &packedStrides,
+          std::vector<typename Policy::Compute> &packed) {
+  auto data = operand.getData<typename Policy::Storage>();
+  auto shape = operand.getShape();
+  Sizes index(shape.size(), 0);
+  int64_t offset = 0;
+  for (auto element : data) {
+    packed[offset] = Policy::load(element);
+    for (int64_t d = shape.size() - 1; d >= 0; --d) {
+      offset += packedStrides[d];
+      if (++index[d] < shape[d]) break;
+      offset -= packedStrides[d] * shape[d];
+      index[d] = 0;
+    }
+  }
+}
+
+// Computes `result += lhs * rhs` for row-major matrices of shapes [m, k],
+// [k, n] and [m, n], whose consecutive rows are `lhsStride`, `rhsStride` and
+// `resultStride` elements apart. Blocks of k are processed in order and
+// accumulated into `result` directly, so every result element accumulates its
+// products in order. If `exact`, products and sums are rounded to the element
+// type and computed in separate loops to keep compilers from fusing them.
+template <typename Policy>
+void gemm(const typename Policy::Compute *lhs, int64_t lhsStride,
+          const typename Policy::Compute *rhs, int64_t rhsStride,
+          typename Policy::Compute *result, int64_t resultStride, int64_t m,
+          int64_t n, int64_t k, bool exact) {
+  using C = typename Policy::Compute;
+  auto round = [](C value) { return Policy::load(Policy::store(value)); };
+  std::vector<C> products(exact ? std::min(n, kBlockN) : 0);
+  for (int64_t k0 = 0; k0 < k; k0 += kBlockK) {
+    int64_t k1 = std::min(k0 + kBlockK, k);
+    for (int64_t j0 = 0; j0 < n; j0 += kBlockN) {
+      int64_t j1 = std::min(j0 + kBlockN, n);
+      for (int64_t i = 0; i < m; ++i) {
+        C *resultRow = result + i * resultStride;
+        for (int64_t l = k0; l < k1; ++l) {
+          C lhsElement = lhs[i * lhsStride + l];
+          const C *rhsRow = rhs + l * rhsStride;
+          if (!exact) {
+            for (int64_t j = j0; j < j1; ++j)
+              resultRow[j] = kernelAdd(resultRow[j],
+                                       kernelMultiply(lhsElement, rhsRow[j]));
+            continue;
+          }
+          for (int64_t j = j0; j < j1; ++j)
+            products[j - j0] = round(kernelMultiply(lhsElement, rhsRow[j]));
+          for (int64_t j = j0; j < j1; ++j)
+            resultRow[j] = round(kernelAdd(resultRow[j], products[j - j0]));
+        }
+      }
+    }
+  }
+}
+
+// Like the above, for contiguous matrices.
+template <typename Policy>
+void gemm(const typename Policy::Compute *lhs,
+          const typename Policy::Compute *rhs, typename Policy::Compute *result,
+          int64_t m, int64_t n, int64_t k, bool exact) {
+  gemm<Policy>(lhs, k, rhs, n, result, n, m, n, k, exact);
+}
+
+// Number of columns of the panels which the Cholesky and triangular solve
+// kernels factorize or solve directly, before updating the trailing matrix
+// with the GEMM kernel.
+constexpr int64_t kPanelSize = 64;
+
+// Returns the number of rows of chunks whose update of `columns` columns
+// with a panel is worth evaluating in parallel.
+int64_t getMinPanelRows(int64_t columns, int64_t panelSize) {
+  return std::max<int64_t>(
+      kMinChunkSize / std::max<int64_t>(columns * panelSize, 1), 1);
+}
+
+// Factorizes the symmetric positive definite matrix `a` of shape [n, n] in
+// place into the lower triangular `L` such that `a = L * L^T`, reading and
+// writing only the lower triangle of `a`. Factorizes panels of columns from
+// left to right: the diagonal block of a panel directly, the rows below it by
+// solving them against the diagonal block, and then subtracts the product of
+// these rows with their transpose from the trailing matrix with the GEMM
+// kernel, which also clobbers some of the upper triangle of `a`.
+template <typename Policy>
+void cholesky(typename Policy::Compute *a, int64_t n, bool exact) {
+  using C = typename Policy::Compute;
+  for (int64_t k0 = 0; k0 < n; k0 += kPanelSize) {
+    int64_t k1 = std::min(k0 + kPanelSize, n);
+    int64_t panelSize = k1 - k0;
+    for (int64_t j = k0; j < k1; ++j) {
+      C *rowJ = a + j * n;
+      C diagonal = rowJ[j];
+      for (int64_t l = k0; l < j; ++l) diagonal -= rowJ[l] * rowJ[l];
+      rowJ[j] = std::sqrt(diagonal);
+      for (int64_t i = j + 1; i < k1; ++i) {
+        C *rowI = a + i * n;
+        C sum = rowI[j];
+        for (int64_t l = k0; l < j; ++l) sum -= rowI[l] * rowJ[l];
+        rowI[j] = sum / rowJ[j];
+      }
+    }
+
+    int64_t m = n - k1;
+    if (m == 0) break;
+    std::vector<C> negatedPanel(m * panelSize);
+    std::vector<C> transposedPanel(panelSize * m);
+    parallelForChunks(m, getMinPanelRows(panelSize, panelSize),
+                      [&](int64_t begin, int64_t end) {
+                        for (int64_t i = begin; i < end; ++i) {
+                          C *row = a + (k1 + i) * n;
+                          for (int64_t j = k0; j < k1; ++j) {
+                            C sum = row[j];
+                            for (int64_t l = k0; l < j; ++l)
+                              sum -= row[l] * a[j * n + l];
+                            row[j] = sum / a[j * n + j];
+                            negatedPanel[i * panelSize + j - k0] = -row[j];
+                            transposedPanel[(j - k0) * m + i] = row[j];
+                          }
+                        }
+                      });
+
+    // Every chunk of rows of the trailing matrix only updates the columns up
+    // to its last row, which cover its part of the lower triangle.
+    parallelForChunks(m, getMinPanelRows(m, panelSize),
+                      [&](int64_t begin, int64_t end) {
+                        gemm<Policy>(negatedPanel.data() + begin * panelSize,
+                                     panelSize, transposedPanel.data(), m,
+                                     a + (k1 + begin) * n + k1, n, end - begin,
+                                     end, panelSize, exact);
+                      });
+  }
+}
+
+// Solves `L * X = B` in place of `b`, where `l` is a lower triangular matrix
+// of shape [n, n], read from its lower triangle, and `b` has shape [n, m]. If
+// `unitDiagonal`, the diagonal of `l` is assumed to be all ones. Solves
+// panels of rows from top to bottom: the rows of a panel directly, and then
+// subtracts their contributions from the rows below them with the GEMM
+// kernel.
+template <typename Policy>
+void solveLowerTriangular(const typename Policy::Compute *l, int64_t n,
+                          bool unitDiagonal, typename Policy::Compute *b,
+                          int64_t m, bool exact) {
+  using C = typename Policy::Compute;
+  for (int64_t k0 = 0; k0 < n; k0 += kPanelSize) {
+    int64_t k1 = std::min(k0 + kPanelSize, n);
+    int64_t panelSize = k1 - k0;
+    parallelForChunks(m, getMinPanelRows(panelSize, panelSize),
+                      [&](int64_t begin, int64_t end) {
+                        for (int64_t i = k0; i < k1; ++i) {
+                          C *row = b + i * m;
+                          for (int64_t r = k0; r < i; ++r) {
+                            C factor = l[i * n + r];
+                            const C *solvedRow = b + r * m;
+                            for (int64_t j = begin; j < end; ++j)
+                              row[j] -= factor * solvedRow[j];
+                          }
+                          if (unitDiagonal) continue;
+                          for (int64_t j = begin; j < end; ++j)
+                            row[j] /= l[i * n + i];
+                        }
+                      });
+
+    int64_t rows = n - k1;
+    if (rows == 0) break;
+    std::vector<C> negatedPanel(rows * panelSize);
+    for (int64_t i = 0; i < rows; ++i)
+      for (int64_t r = k0; r < k1; ++r)
+        negatedPanel[i * panelSize + r - k0] = -l[(k1 + i) * n + r];
+    parallelForChunks(rows, getMinPanelRows(m, panelSize),
+                      [&](int64_t begin, int64_t end) {
+                        gemm<Policy>(negatedPanel.data() + begin * panelSize,
+                                     panelSize, b + k0 * m, m,
+                                     b + (k1 + begin) * m, m, end - begin, m,
+                                     panelSize, exact);
+                      });
+  }
+}
+
+// Returns row-major strides of `shape`.
+Sizes getStrides(const Sizes &shape) {
+  Sizes strides(shape.size());
+  int64_t stride = 1;
+  for (int64_t d = shape.size() - 1; d >= 0; --d) {
+    strides[d] = stride;
+    stride *= shape[d];
+  }
+  return strides;
+}
+
+// Increments `index` within `shape` in row-major order.
+void incrementIndex(Sizes &index, const Sizes &shape) {
+  for (int64_t d = index.size() - 1; d >= 0; --d) {
+    if (++index[d] < shape[d]) return;
+    index[d] = 0;
+  }
+}
+
+// Returns the index of the element at `offset` in the row-major order of
+// `shape`.
+Sizes delinearize(int64_t offset, const Sizes &shape) {
+  Sizes index(shape.size());
+  for (int64_t d = shape.size() - 1; d >= 0; --d) {
+    index[d] = offset % shape[d];
+    offset /= shape[d];
+  }
+  return index;
+}
+
+int64_t getProduct(const Sizes &sizes) {
+  int64_t product = 1;
+  for (auto size : sizes) product *= size;
+  return product;
+}
+
+// Returns strides with which the elements of a tensor of `shape` with
+// `strides` can be viewed in the same canonical order with `resultShape`, or
+// std::nullopt if there are none, like `_attempt_nocopy_reshape` of NumPy.
+// The dimensions of both shapes are split into the shortest groups with equal
+// numbers of elements, and the dimensions of every group of `shape` must be
+// contiguous with each other.
+std::optional<Sizes> getReshapedStrides(const Sizes &shape,
+                                        const Sizes &strides,
+                                        const Sizes &resultShape) {
+  Sizes resultStrides(resultShape.size(), 0);
+  if (llvm::is_contained(shape, 0)) return resultStrides;
+
+  // Dimensions of size 1 don't move through the storage.
+  Sizes operandShape, operandStrides;
+  for (auto [size, stride] : llvm::zip(shape, strides)) {
+    if (size == 1) continue;
+    operandShape.push_back(size);
+    operandStrides.push_back(stride);
+  }
+
+  int64_t operandRank = operandShape.size();
+  int64_t resultRank = resultShape.size();
+  int64_t operandBegin = 0, resultBegin = 0;
+  while (operandBegin < operandRank && resultBegin < resultRank) {
+    int64_t operandEnd = operandBegin + 1, resultEnd = resultBegin + 1;
+    int64_t operandSize = operandShape[operandBegin];
+    int64_t resultSize = resultShape[resultBegin];
+    while (operandSize != resultSize) {
+      if (resultSize < operandSize)
+        resultSize *= resultShape[resultEnd++];
+      else
+        operandSize *= operandShape[operandEnd++];
+    }
+
+    for (int64_t d = operandBegin; d + 1 < operandEnd; ++d)
+      if (operandStrides[d] != operandShape[d + 1] * operandStrides[d + 1])
+        return std::nullopt;
+
+    resultStrides[resultEnd - 1] = operandStrides[operandEnd - 1];
+    for (int64_t d = resultEnd - 1; d > resultBegin; --d)
+      resultStrides[d - 1] = resultStrides[d] * resultShape[d];
+    operandBegin = operandEnd;
+    resultBegin = resultEnd;
+  }
+  // The remaining dimensions of `resultShape` have size 1.
+  return resultStrides;
+}
+
+// Invokes `fn` with the function that `kernel` computes on the compute type
+// of `Policy`, if `kernel` is associative and commutative for it, and returns
+// its result. Returns false otherwise.
+template <typename Policy, typename Fn>
+bool dispatchOnMonoid(BinaryKernel kernel, Fn &&fn) {
+  using C = typename Policy::Compute;
+  if constexpr (isFloatPolicy<Policy>) {
+    switch (kernel) {
+      case BinaryKernel::Add:
+        return fn([](C x, C y) { return x + y; });
+      case BinaryKernel::Maximum:
+        return fn([](C x, C y) { return maximum(x, y); });
+      case BinaryKernel::Minimum:
+        return fn([](C x, C y) { return minimum(x, y); });
+      case BinaryKernel::Multiply:
+        return fn([](C x, C y) { return x * y; });
+      case BinaryKernel::And:
+      case BinaryKernel::Atan2:
+      case BinaryKernel::Divide:
+      case BinaryKernel::Or:
+      case BinaryKernel::Power:
+      case BinaryKernel::Remainder:
+      case BinaryKernel::Subtract:
+      case BinaryKernel::Xor:
+        return false;
+    }
+  } else {
+    switch (kernel) {
+      case BinaryKernel::Add:
+        return fn([](C x, C y) { return wrappingAdd(x, y); });
+      case BinaryKernel::And:
+        return fn([](C x, C y) { return static_cast<C>(x & y); });
+      case BinaryKernel::Maximum:
+        return fn([](C x, C y) { return maximum(x, y); });
+      case BinaryKernel::Minimum:
+        return fn([](C x, C y) { return minimum(x, y); });
+      case BinaryKernel::Multiply:
+        return fn([](C x, C y) { return wrappingMultiply(x, y); });
+      case BinaryKernel::Or:
+        return fn([](C x, C y) { return static_cast<C>(x | y); });
+      case BinaryKernel::Xor:
+        return fn([](C x, C y) { return static_cast<C>(x ^ y); });
+      case BinaryKernel::Atan2:
+      case BinaryKernel::Divide:
+      case BinaryKernel::Power:
+      case BinaryKernel::Remainder:
+      case BinaryKernel::Subtract:
+        return false;
+    }
+  }
+  llvm_unreachable("unknown binary kernel");
+}
+
+// Returns a signed integer which compares like the floating-point value
+// stored in `value` under the totalOrder predicate of IEEE 754, i.e.
+// -NaN < -Inf < ... < -0 < +0 < ... < +Inf < +NaN. Flipping all bits but the
+// sign bit of negative values reverses their order.
+template <typename Storage>
+auto getTotalOrderKey(Storage value) {
+  using Key = std::conditional_t<
+      sizeof(Storage) == 1, int8_t,
+      std::conditional_t<
+          sizeof(Storage) == 2, int16_t,
+          std::conditional_t<sizeof(Storage) == 4, int32_t, int64_t>>>;
+  auto bits = llvm::bit_cast<Key>(value);
+  return bits < 0 ? static_cast<Key>(bits ^ std::numeric_limits<Key>::max())
+                  : bits;
+}
+
+// Invokes `fn` with a function which maps stored elements to values that
+// compare like the elements, using the totalOrder predicate for
+// floating-point elements if `isTotalOrder`, and returns its result.
+template <typename Policy, typename Fn>
+bool dispatchOnOrderKey(bool isTotalOrder, Fn &&fn) {
+  using Storage = typename Policy::Storage;
+  if constexpr (isFloatPolicy<Policy>)
+    if (isTotalOrder)
+      return fn([](Storage value) { return getTotalOrderKey(value); });
+  return fn([](Storage value) { return Policy::load(value); });
+}
+
+// Number of values which `pairwiseSum` adds one after another. Larger blocks
+// amortize the recursion, smaller blocks make the sum more accurate.
+constexpr int64_t kPairwiseBlockSize = 16;
+
+// Sums `size` values starting at `values` by recursively splitting them in
+// halves, which makes the rounding error grow with the logarithm of `size`.
+template <typename C>
+C pairwiseSum(const C *values, int64_t size) {
+  if (size <= kPairwiseBlockSize) {
+    C sum = C(0);
+    for (int64_t i = 0; i < size; ++i) sum += values[i];
+    return sum;
+  }
+  int64_t half = size / 2;
+  return pairwiseSum(values, half) + pairwiseSum(values + half, size - half);
+}
+
+}  // namespace
+
+bool evalUnaryKernel(const KernelOptions &options, UnaryKernel kernel,
+                     const Tensor &operand, Tensor &result) {
+  if (!options.enableNativeKernels || operand.getType() != result.getType())
+    return false;
+  if (isRepeatedSplat(operand))
+    return evalOnSplatElement(result, [&](Tensor &element) {
+      return evalUnaryKernel(options, kernel, getSplatElement(operand),
+                             element);
+    });
+  if (isa<ComplexType>(result.getElementType()))
+    return dispatchOnComplexPolicy(result.getElementType(), [&](auto policy) {
+      return evalComplexUnaryKernel<decltype(policy)>(kernel, operand, result);
+    });
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    if constexpr (isFloatPolicy<Policy>)
+      return evalFloatUnaryKernel<Policy>(kernel, operand, result);
+    else
+      return evalIntegerUnaryKernel<Policy>(kernel, operand, result);
+  });
+}
+
+bool evalBinaryKernel(const KernelOptions &options, BinaryKernel kernel,
+                      const Tensor &lhs, const Tensor &rhs, Tensor &result) {
+  if (!options.enableNativeKernels || lhs.getType() != result.getType() ||
+      rhs.getType() != result.getType())
+    return false;
+  if (isRepeatedSplat(lhs) && isRepeatedSplat(rhs))
+    return evalOnSplatElement(result, [&](Tensor &element) {
+      return evalBinaryKernel(options, kernel, getSplatElement(lhs),
+                              getSplatElement(rhs), element);
+    });
+  if (isa<ComplexType>(result.getElementType()))
+    return dispatchOnComplexPolicy(result.getElementType(), [&](auto policy) {
+      return evalComplexBinaryKernel<decltype(policy)>(kernel, lhs, rhs,
+                                                       result);
+    });
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    if constexpr (isFloatPolicy<Policy>)
+      return evalFloatBinaryKernel<Policy>(kernel, lhs, rhs, result);
+    else
+      return evalIntegerBinaryKernel<Policy>(kernel, lhs, rhs, result);
+  });
+}
+
+bool evalCompareKernel(
+    const KernelOptions &options, ComparisonDirection comparisonDirection,
+    bool isTotalOrder, const Tensor &lhs, const Tensor &rhs, Tensor &result) {
+  if (!options.enableNativeKernels || lhs.getType() != rhs.getType() ||
+      lhs.getNumElements() != result.getNumElements())
+    return false;
+  if (isRepeatedSplat(lhs) && isRepeatedSplat(rhs))
+    return evalOnSplatElement(result, [&](Tensor &element) {
+      return evalCompareKernel(options, comparisonDirection, isTotalOrder,
+                               getSplatElement(lhs), getSplatElement(rhs),
+                               element);
+    });
+  return dispatchOnPolicy(lhs.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    using Storage = typename Policy::Storage;
+    // Booleans are stored as uint8_t holding either 0 or 1.
+    auto resultData = result.getMutableData<uint8_t>();
+    return dispatchOnOrderKey<Policy>(isTotalOrder, [&](auto key) {
+      using K = decltype(key(std::declval<Storage>()));
+      auto compare = [&](auto fn) {
+        // Strided views, e.g. broadcasts, are read in place.
+        if (lhs.isStrided() || rhs.isStrided()) {
+          const Storage *lhsData = lhs.getStridedData<Storage>();
+          const Storage *rhsData = rhs.getStridedData<Storage>();
+          parallelForStridedRuns<2>(
+              result.getShape(), {lhs.getStrides(), rhs.getStrides()},
+              [&](int64_t begin, int64_t size, std::array<int64_t, 2> positions,
+                  std::array<int64_t, 2> innerStrides) {
+                const Storage *x = lhsData + positions[0];
+                const Storage *y = rhsData + positions[1];
+                for (int64_t i = 0; i < size; ++i)
+                  resultData[begin + i] = fn(key(x[i * innerStrides[0]]),
+                                             key(y[i * innerStrides[1]]))
+                                              ? 1
+                                              : 0;
+              });
+          return true;
+        }
+
+        auto lhsData = lhs.getData<Storage>();
+        auto rhsData = rhs.getData<Storage>();
+        parallelForChunks(resultData.size(), kMinChunkSize,
+                          [&](int64_t begin, int64_t end) {
+                            for (int64_t i = begin; i < end; ++i)
+                              resultData[i] =
+                                  fn(key(lhsData[i]), key(rhsData[i])) ? 1 : 0;
+                          });
+        return true;
+      };
+      switch (comparisonDirection) {
+        case ComparisonDirection::EQ:
+          return compare([](K x, K y) { return x == y; });
+        case ComparisonDirection::NE:
+          return compare([](K x, K y) { return x != y; });
+        case ComparisonDirection::GE:
+          return compare([](K x, K y) { return x >= y; });
+        case ComparisonDirection::GT:
+          return compare([](K x, K y) { return x > y; });
+        case ComparisonDirection::LE:
+          return compare([](K x, K y) { return x <= y; });
+        case ComparisonDirection::LT:
+          return compare([](K x, K y) { return x < y; });
+      }
+      llvm_unreachable("unknown comparison direction");
+    });
+  });
+}
+
+bool evalSelectKernel(const KernelOptions &options, const Tensor &pred,
+                      const Tensor &onTrue, const Tensor &onFalse,
+                      Tensor &result) {
+  if (!options.enableNativeKernels || onTrue.getType() != result.getType() ||
+      onFalse.getType() != result.getType())
+    return false;
+
+  // Booleans are stored as uint8_t holding either 0 or 1. A splat predicate,
+  // e.g. a scalar, selects one of the operands as a whole, which shares its
+  // storage rather than copying it.
+  if (pred.isSplat()) {
+    result = pred.getStridedData<uint8_t>()[0] ? onTrue : onFalse;
+    return true;
+  }
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Storage = typename decltype(policy)::Storage;
+    auto resultData = result.getMutableData<Storage>();
+    if (pred.isStrided() || onTrue.isStrided() || onFalse.isStrided()) {
+      const uint8_t *predData = pred.getStridedData<uint8_t>();
+      const Storage *onTrueData = onTrue.getStridedData<Storage>();
+      const Storage *onFalseData = onFalse.getStridedData<Storage>();
+      parallelForStridedRuns<3>(
+          result.getShape(),
+          {pred.getStrides(), onTrue.getStrides(), onFalse.getStrides()},
+          [&](int64_t begin, int64_t size, std::array<int64_t, 3> positions,
+              std::array<int64_t, 3> innerStrides) {
+            const uint8_t *p = predData + positions[0];
+            const Storage *x = onTrueData + positions[1];
+            const Storage *y = onFalseData + positions[2];
+            for (int64_t i = 0; i < size; ++i)
+              resultData[begin + i] = p[i * innerStrides[0]]
+                                          ? x[i * innerStrides[1]]
+                                          : y[i * innerStrides[2]];
+          });
+      return true;
+    }
+
+    auto predData = pred.getData<uint8_t>();
+    auto onTrueData = onTrue.getData<Storage>();
+    auto onFalseData = onFalse.getData<Storage>();
+    parallelForChunks(resultData.size(), kMinChunkSize,
+                      [&](int64_t begin, int64_t end) {
+                        for (int64_t i = begin; i < end; ++i)
+                          resultData[i] =
+                              predData[i] ? onTrueData[i] : onFalseData[i];
+                      });
+    return true;
+  });
+}
+
+bool evalDotGeneralKernel(
+    const KernelOptions &options, const Tensor &lhs, const Tensor &rhs,
+    const Axes &lhsBatchingDimensions, const Axes &rhsBatchingDimensions,
+    const Axes &lhsContractingDimensions, const Axes &rhsContractingDimensions,
+    Tensor &result) {
+  if (!options.enableNativeKernels ||
+      lhs.getElementType() != result.getElementType() ||
+      rhs.getElementType() != result.getElementType())
+    return false;
+
+  Axes lhsResultDims;
+  for (auto i = 0; i < lhs.getRank(); ++i)
+    if (!llvm::is_contained(lhsBatchingDimensions, i) &&
+        !llvm::is_contained(lhsContractingDimensions, i))
+      lhsResultDims.push_back(i);
+
+  Axes rhsResultDims;
+  for (auto i = 0; i < rhs.getRank(); ++i)
+    if (!llvm::is_contained(rhsBatchingDimensions, i) &&
+        !llvm::is_contained(rhsContractingDimensions, i))
+      rhsResultDims.push_back(i);
+
+  // Batching and contracting dimensions are linearized in the order in which
+  // they are listed, and result dimensions in the order in which they appear
+  // in the operands, which makes the packed result [batch, M, N] laid out
+  // exactly like `result`.
+  auto lhsShape = lhs.getShape();
+  auto rhsShape = rhs.getShape();
+  Sizes lhsStrides(lhs.getRank()), rhsStrides(rhs.getRank());
+  int64_t k = assignStrides(lhsShape, lhsContractingDimensions, 1, lhsStrides);
+  int64_t m = assignStrides(lhsShape, lhsResultDims, k, lhsStrides);
+  int64_t batchSize =
+      assignStrides(lhsShape, lhsBatchingDimensions, m * k, lhsStrides);
+  int64_t n = assignStrides(rhsShape, rhsResultDims, 1, rhsStrides);
+  assignStrides(rhsShape, rhsContractingDimensions, n, rhsStrides);
+  assignStrides(rhsShape, rhsBatchingDimensions, k * n, rhsStrides);
+
+  bool exact = options.exactAccumulation;
+  auto multiply = [&](auto policy) {
+    using Policy = decltype(policy);
+    using C = typename Policy::Compute;
+    std::vector<C> packedLhs(batchSize * m * k);
+    std::vector<C> packedRhs(batchSize * k * n);
+    std::vector<C> packedResult(batchSize * m * n, C(0));
+    pack<Policy>(lhs, lhsStrides, packedLhs);
+    pack<Policy>(rhs, rhsStrides, packedRhs);
+
+    // Rows of the packed result are independent, so chunks of rows across
+    // all batches are multiplied in parallel.
+    int64_t minRows =
+        std::max<int64_t>(kMinChunkSize / std::max<int64_t>(n * k, 1), 1);
+    parallelForChunks(batchSize * m, minRows, [&](int64_t begin, int64_t end) {
+      for (int64_t row = begin; row < end;) {
+        int64_t b = row / m;
+        int64_t rows = std::min(end, (b + 1) * m) - row;
+        gemm<Policy>(packedLhs.data() + row * k, packedRhs.data() + b * k * n,
+                     packedResult.data() + row * n, rows, n, k, exact);
+        row += rows;
+      }
+    });
+    auto resultData = result.getMutableData<typename Policy::Storage>();
+    for (size_t i = 0, e = resultData.size(); i < e; ++i)
+      resultData[i] = Policy::store(packedResult[i]);
+    return true;
+  };
+  if (isa<ComplexType>(result.getElementType()))
+    return dispatchOnComplexPolicy(result.getElementType(), multiply);
+  return dispatchOnPolicy(result.getElementType(), multiply);
+}
+
+bool loadComplexKernel(const KernelOptions &options, const Tensor &tensor,
+                       MutableArrayRef<std::complex<double>> data) {
+  if (!options.enableNativeKernels) return false;
+  auto load = [&](auto element) {
+    using T = decltype(element);
+    auto tensorData = tensor.getData<T>();
+    parallelForChunks(data.size(), kMinChunkSize,
+                      [&](int64_t begin, int64_t end) {
+                        for (int64_t i = begin; i < end; ++i)
+                          data[i] = tensorData[i];
+                      });
+    return true;
+  };
+  Type elementType = tensor.getElementType();
+  if (elementType.isF32()) return load(float());
+  if (elementType.isF64()) return load(double());
+  return dispatchOnComplexPolicy(elementType, [&](auto policy) {
+    return load(typename decltype(policy)::Storage());
+  });
+}
+
+bool storeComplexKernel(const KernelOptions &options,
+                        ArrayRef<std::complex<double>> data, Tensor &tensor) {
+  if (!options.enableNativeKernels) return false;
+  auto store = [&](auto element, auto convert) {
+    auto tensorData = tensor.getMutableData<decltype(element)>();
+    parallelForChunks(data.size(), kMinChunkSize,
+                      [&](int64_t begin, int64_t end) {
+                        for (int64_t i = begin; i < end; ++i)
+                          tensorData[i] = convert(data[i]);
+                      });
+    return true;
+  };
+  Type elementType = tensor.getElementType();
+  if (elementType.isF32())
+    return store(float(), [](std::complex<double> value) {
+      return static_cast<float>(value.real());
+    });
+  if (elementType.isF64())
+    return store(double(),
+                 [](std::complex<double> value) { return value.real(); });
+  return dispatchOnComplexPolicy(elementType, [&](auto policy) {
+    using Policy = decltype(policy);
+    return store(typename Policy::Storage(), [](std::complex<double> value) {
+      return Policy::fromDouble(value);
+    });
+  });
+}
+
+bool evalConvolutionKernel(
+    const KernelOptions &options, const Tensor &lhs, const Tensor &rhs,
+    ArrayRef<int64_t> windowStrides,
+    ArrayRef<std::pair<int64_t, int64_t>> padding,
+    ArrayRef<int64_t> lhsDilation, ArrayRef<int64_t> rhsDilation,
+    ArrayRef<bool> windowReversal, Axis inputBatchDimension,
+    Axis inputFeatureDimension, const Axes &inputSpatialDimensions,
+    Axis kernelInputFeatureDimension, Axis kernelOutputFeatureDimension,
+    const Axes &kernelSpatialDimensions, Axis outputBatchDimension,
+    Axis outputFeatureDimension, const Axes &outputSpatialDimensions,
+    int64_t featureGroupCount, int64_t batchGroupCount, Tensor &result) {
+  if (!options.enableNativeKernels ||
+      lhs.getElementType() != result.getElementType() ||
+      rhs.getElementType() != result.getElementType() ||
+      (featureGroupCount > 1 && batchGroupCount > 1))
+    return false;
+
+  auto lhsShape = lhs.getShape();
+  auto rhsShape = rhs.getShape();
+  auto resultShape = result.getShape();
+  auto lhsStrides = getStrides(lhsShape);
+  auto rhsStrides = getStrides(rhsShape);
+  auto resultStrides = getStrides(resultShape);
+
+  int64_t numSpatialDims = inputSpatialDimensions.size();
+  Sizes windowShape, outputSpatialShape;
+  for (auto dim : kernelSpatialDimensions) windowShape.push_back(rhsShape[dim]);
+  for (auto dim : outputSpatialDimensions)
+    outputSpatialShape.push_back(resultShape[dim]);
+  int64_t windowSize = getProduct(windowShape);
+  int64_t numPositions = getProduct(outputSpatialShape);
+
+  // With feature groups, every group convolves a slice of the input features
+  // with a slice of the kernel output features. With batch groups, every group
+  // convolves a slice of the batch with a slice of the kernel output features.
+  int64_t groupCount = std::max(featureGroupCount, batchGroupCount);
+  int64_t inputFeatures = rhsShape[kernelInputFeatureDimension];
+  int64_t outputFeatures = rhsShape[kernelOutputFeatureDimension] / groupCount;
+  int64_t batchSize = resultShape[outputBatchDimension];
+  int64_t k = windowSize * inputFeatures;
+
+  // For every spatial dimension, maps pairs of output and window positions to
+  // input coordinates, or to -1 if they fall into padding or between dilated
+  // input elements. Window positions are mirrored for reversed dimensions,
+  // which is the same as reversing the input window.
+  SmallVector<Sizes> inputCoordinates(numSpatialDims);
+  for (int64_t i = 0; i < numSpatialDims; ++i) {
+    int64_t inputSize = lhsShape[inputSpatialDimensions[i]];
+    for (int64_t o = 0; o < outputSpatialShape[i]; ++o) {
+      for (int64_t w = 0; w < windowShape[i]; ++w) {
+        int64_t windowPosition = windowReversal[i] ? windowShape[i] - 1 - w : w;
+        int64_t paddedPosition =
+            o * windowStrides[i] + windowPosition * rhsDilation[i];
+        int64_t dilatedPosition = paddedPosition - padding[i].first;
+        int64_t inputCoordinate = -1;
+        if (dilatedPosition >= 0 && dilatedPosition % lhsDilation[i] == 0 &&
+            dilatedPosition / lhsDilation[i] < inputSize)
+          inputCoordinate = dilatedPosition / lhsDilation[i];
+        inputCoordinates[i].push_back(inputCoordinate);
+      }
+    }
+  }
+
+  bool exact = options.exactAccumulation;
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    using C = typename Policy::Compute;
+    using Storage = typename Policy::Storage;
+    auto lhsData = lhs.getData<Storage>();
+    auto rhsData = rhs.getData<Storage>();
+    auto resultData = result.getMutableData<Storage>();
+
+    // Columns of the unrolled input and rows of the packed kernel iterate over
+    // window positions and then input features, which is the order in which
+    // `convolutionOp` contracts them.
+    std::vector<C> packedRhs(k * outputFeatures);
+    int64_t lhsFeatureStride = lhsStrides[inputFeatureDimension];
+    int64_t rhsInputFeatureStride = rhsStrides[kernelInputFeatureDimension];
+    int64_t rhsOutputFeatureStride = rhsStrides[kernelOutputFeatureDimension];
+    int64_t resultFeatureStride = resultStrides[outputFeatureDimension];
+    for (int64_t g = 0; g < groupCount; ++g) {
+      int64_t inputFeatureOffset =
+          featureGroupCount > 1 ? g * inputFeatures : 0;
+      int64_t outputFeatureOffset = g * outputFeatures;
+
+      Sizes windowIndex(numSpatialDims, 0);
+      for (int64_t w = 0; w < windowSize; ++w) {
+        int64_t rhsOffset = outputFeatureOffset * rhsOutputFeatureStride;
+        for (int64_t i = 0; i < numSpatialDims; ++i)
+          rhsOffset += windowIndex[i] * rhsStrides[kernelSpatialDimensions[i]];
+        for (int64_t c = 0; c < inputFeatures; ++c) {
+          C *row = packedRhs.data() + (w * inputFeatures + c) * outputFeatures;
+          for (int64_t o = 0; o < outputFeatures; ++o)
+            row[o] = Policy::load(rhsData[rhsOffset +
+                                          c * rhsInputFeatureStride +
+                                          o * rhsOutputFeatureStride]);
+        }
+        incrementIndex(windowIndex, windowShape);
+      }
+
+      // Output positions of all batches are independent, so chunks of them
+      // are unrolled and multiplied with the packed kernel in parallel.
+      int64_t minPositions = std::max<int64_t>(
+          kMinChunkSize / std::max<int64_t>(k * outputFeatures, 1), 1);
+      parallelForChunks(
+          batchSize * numPositions, minPositions,
+          [&](int64_t begin, int64_t end) {
+            int64_t maxPositions = std::min(end - begin, numPositions);
+            std::vector<C> packedLhs(maxPositions * k);
+            std::vector<C> packedResult(maxPositions * outputFeatures);
+            for (int64_t start = begin; start < end;) {
+              int64_t b = start / numPositions;
+              int64_t positions =
+                  std::min(end, (b + 1) * numPositions) - start;
+              int64_t inputBatch = batchGroupCount > 1 ? g * batchSize + b : b;
+              int64_t lhsBatchOffset =
+                  inputBatch * lhsStrides[inputBatchDimension] +
+                  inputFeatureOffset * lhsFeatureStride;
+              auto startIndex =
+                  delinearize(start % numPositions, outputSpatialShape);
+
+              auto outputIndex = startIndex;
+              for (int64_t p = 0; p < positions; ++p) {
+                Sizes windowIndex(numSpatialDims, 0);
+                for (int64_t w = 0; w < windowSize; ++w) {
+                  C *row = packedLhs.data() + p * k + w * inputFeatures;
+                  int64_t lhsOffset = lhsBatchOffset;
+                  bool isPadding = false;
+                  for (int64_t i = 0; i < numSpatialDims && !isPadding; ++i) {
+                    int64_t coordinate =
+                        inputCoordinates[i][outputIndex[i] * windowShape[i] +
+                                            windowIndex[i]];
+                    isPadding = coordinate < 0;
+                    lhsOffset +=
+                        coordinate * lhsStrides[inputSpatialDimensions[i]];
+                  }
+                  for (int64_t c = 0; c < inputFeatures; ++c)
+                    row[c] = isPadding
+                                 ? C(0)
+                                 : Policy::load(lhsData[lhsOffset +
+                                                        c * lhsFeatureStride]);
+                  incrementIndex(windowIndex, windowShape);
+                }
+                incrementIndex(outputIndex, outputSpatialShape);
+              }
+
+              std::fill(packedResult.begin(), packedResult.end(), C(0));
+              gemm<Policy>(packedLhs.data(), packedRhs.data(),
+                           packedResult.data(), positions, outputFeatures, k,
+                           exact);
+
+              outputIndex = startIndex;
+              for (int64_t p = 0; p < positions; ++p) {
+                int64_t resultOffset =
+                    b * resultStrides[outputBatchDimension] +
+                    outputFeatureOffset * resultFeatureStride;
+                for (int64_t i = 0; i < numSpatialDims; ++i)
+                  resultOffset += outputIndex[i] *
+                                  resultStrides[outputSpatialDimensions[i]];
+                for (int64_t o = 0; o < outputFeatures; ++o)
+                  resultData[resultOffset + o * resultFeatureStride] =
+                      Policy::store(packedResult[p * outputFeatures + o]);
+                incrementIndex(outputIndex, outputSpatialShape);
+              }
+              start += positions;
+            }
+          });
+    }
+    return true;
+  });
+}
+
+bool evalCholeskyKernel(const KernelOptions &options, const Tensor &a,
+                        bool lower, Tensor &result) {
+  if (!options.enableNativeKernels ||
+      a.getElementType() != result.getElementType())
+    return false;
+
+  auto shape = a.getShape();
+  int64_t n = shape.back();
+  int64_t matrixSize = n * n;
+  int64_t batchSize = getProduct(Sizes(shape.begin(), shape.end() - 2));
+  bool exact = options.exactAccumulation;
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    using C = typename Policy::Compute;
+    if constexpr (!isFloatPolicy<Policy>) {
+      return false;
+    } else {
+      // Upper triangles are factorized as the lower triangles of their
+      // transposes, since `a = U^T * U` for `U = L^T`.
+      auto data = a.getData<typename Policy::Storage>();
+      auto resultData = result.getMutableData<typename Policy::Storage>();
+      auto at = [&](int64_t i, int64_t j) {
+        return lower ? i * n + j : j * n + i;
+      };
+      parallelForChunks(batchSize, 1, [&](int64_t begin, int64_t end) {
+        std::vector<C> matrix(matrixSize);
+        for (int64_t batch = begin; batch < end; ++batch) {
+          int64_t offset = batch * matrixSize;
+          for (int64_t i = 0; i < n; ++i)
+            for (int64_t j = 0; j <= i; ++j)
+              matrix[i * n + j] = Policy::load(data[offset + at(i, j)]);
+          cholesky<Policy>(matrix.data(), n, exact);
+          for (int64_t i = 0; i < n; ++i)
+            for (int64_t j = 0; j < n; ++j)
+              resultData[offset + at(i, j)] =
+                  Policy::store(j <= i ? matrix[i * n + j] : C(0));
+        }
+      });
+      return true;
+    }
+  });
+}
+
+bool evalTriangularSolveKernel(const KernelOptions &options, const Tensor &a,
+                               const Tensor &b, bool leftSide, bool lower,
+                               bool unitDiagonal, bool transposeA,
+                               Tensor &result) {
+  if (!options.enableNativeKernels ||
+      a.getElementType() != result.getElementType() ||
+      b.getElementType() != result.getElementType())
+    return false;
+
+  // Every system is solved as `L * X = B` for a lower triangular `L` and a
+  // [n, m] matrix `B`. Systems `X * op(a) = b` are transposed into
+  // `op(a)^T * X^T = b^T`, and upper triangular coefficient matrices are
+  // made lower triangular by reversing the order of their rows and columns,
+  // together with the rows of `B`.
+  auto shape = b.getShape();
+  int64_t rank = shape.size();
+  int64_t n = a.getShape().back();
+  int64_t m = leftSide ? shape[rank - 1] : shape[rank - 2];
+  int64_t matrixSize = n * n;
+  int64_t rhsSize = n * m;
+  int64_t batchSize = getProduct(Sizes(shape.begin(), shape.end() - 2));
+  bool isTransposed = transposeA != !leftSide;
+  bool isReversed = lower == isTransposed;
+  bool exact = options.exactAccumulation;
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    using C = typename Policy::Compute;
+    if constexpr (!isFloatPolicy<Policy>) {
+      return false;
+    } else {
+      auto aData = a.getData<typename Policy::Storage>();
+      auto bData = b.getData<typename Policy::Storage>();
+      auto resultData = result.getMutableData<typename Policy::Storage>();
+      auto reverse = [&](int64_t i) { return isReversed ? n - 1 - i : i; };
+      auto aAt = [&](int64_t i, int64_t j) {
+        return isTransposed ? reverse(j) * n + reverse(i)
+                            : reverse(i) * n + reverse(j);
+      };
+      auto bAt = [&](int64_t i, int64_t j) {
+        return leftSide ? reverse(i) * m + j : j * n + reverse(i);
+      };
+      parallelForChunks(batchSize, 1, [&](int64_t begin, int64_t end) {
+        std::vector<C> l(matrixSize);
+        std::vector<C> x(rhsSize);
+        for (int64_t batch = begin; batch < end; ++batch) {
+          int64_t aOffset = batch * matrixSize;
+          int64_t bOffset = batch * rhsSize;
+          for (int64_t i = 0; i < n; ++i)
+            for (int64_t j = 0; j <= i; ++j)
+              l[i * n + j] = Policy::load(aData[aOffset + aAt(i, j)]);
+          for (int64_t i = 0; i < n; ++i)
+            for (int64_t j = 0; j < m; ++j)
+              x[i * m + j] = Policy::load(bData[bOffset + bAt(i, j)]);
+          solveLowerTriangular<Policy>(l.data(), n, unitDiagonal, x.data(), m,
+                                       exact);
+          for (int64_t i = 0; i < n; ++i)
+            for (int64_t j = 0; j < m; ++j)
+              resultData[bOffset + bAt(i, j)] = Policy::store(x[i * m + j]);
+        }
+      });
+      return true;
+    }
+  });
+}
+
+namespace {
+
+// The elements of a tensor viewed as [outer, features, inner] around its
+// feature dimension, in which every feature has `outerSize` rows of
+// `innerSize` contiguous elements.
+struct FeatureLayout {
+  FeatureLayout(const Sizes &shape, Axis featureIndex)
+      : numFeatures(shape[featureIndex]) {
+    for (Axis d = 0; d < featureIndex; ++d) outerSize *= shape[d];
+    for (Axis d = featureIndex + 1; d < static_cast<Axis>(shape.size()); ++d)
+      innerSize *= shape[d];
+  }
+
+  // Returns the offset of the row `outer` of feature `feature`.
+  int64_t getRowOffset(int64_t outer, int64_t feature) const {
+    return (outer * numFeatures + feature) * innerSize;
+  }
+
+  int64_t getNumElementsPerFeature() const { return outerSize * innerSize; }
+
+  int64_t outerSize = 1;
+  int64_t numFeatures;
+  int64_t innerSize = 1;
+};
+
+// Calls `fn(begin, end)` for chunks of features in parallel. Chunks of
+// features visit their rows in memory order, row `outer` of every feature
+// of the chunk before row `outer + 1`, so that they read contiguous memory
+// even if features are the innermost dimension.
+void parallelForFeatures(const FeatureLayout &layout,
+                         llvm::function_ref<void(int64_t, int64_t)> fn) {
+  int64_t minFeatures = std::max<int64_t>(
+      kMinChunkSize / std::max<int64_t>(layout.getNumElementsPerFeature(), 1),
+      1);
+  parallelForChunks(layout.numFeatures, minFeatures, fn);
+}
+
+}  // namespace
+
+bool evalBatchNormInferenceKernel(
+    const KernelOptions &options, const Tensor &operand, const Tensor &scale,
+    const Tensor &offset, const Tensor &mean, const Tensor &variance,
+    double epsilon, Axis featureIndex, Tensor &result) {
+  auto elementType = result.getElementType();
+  if (!options.enableNativeKernels || operand.getElementType() != elementType ||
+      scale.getElementType() != elementType ||
+      offset.getElementType() != elementType ||
+      mean.getElementType() != elementType ||
+      variance.getElementType() != elementType)
+    return false;
+
+  FeatureLayout layout(operand.getShape(), featureIndex);
+  return dispatchOnPolicy(elementType, [&](auto policy) {
+    using Policy = decltype(policy);
+    using Storage = typename Policy::Storage;
+    if constexpr (!isFloatPolicy<Policy>) {
+      return false;
+    } else {
+      auto load = [](Storage value) {
+        return static_cast<double>(Policy::load(value));
+      };
+      auto data = operand.getData<Storage>();
+      auto scaleData = scale.getData<Storage>();
+      auto offsetData = offset.getData<Storage>();
+      auto meanData = mean.getData<Storage>();
+      auto varianceData = variance.getData<Storage>();
+      auto resultData = result.getMutableData<Storage>();
+      parallelForFeatures(layout, [&](int64_t begin, int64_t end) {
+        for (int64_t outer = 0; outer < layout.outerSize; ++outer) {
+          for (int64_t f = begin; f < end; ++f) {
+            double featureMean = load(meanData[f]);
+            double factor = load(scaleData[f]) /
+                            std::sqrt(load(varianceData[f]) + epsilon);
+            double featureOffset = load(offsetData[f]);
+            int64_t rowOffset = layout.getRowOffset(outer, f);
+            for (int64_t i = 0; i < layout.innerSize; ++i) {
+              double x = load(data[rowOffset + i]);
+              resultData[rowOffset + i] = Policy::fromDouble(
+                  (x - featureMean) * factor + featureOffset);
+            }
+          }
+        }
+      });
+      return true;
+    }
+  });
+}
+
+bool evalBatchNormTrainingKernel(
+    const KernelOptions &options, const Tensor &operand, const Tensor &scale,
+    const Tensor &offset, double epsilon, Axis featureIndex, Tensor &output,
+    Tensor &batchMean, Tensor &batchVar) {
+  auto elementType = output.getElementType();
+  if (!options.enableNativeKernels || operand.getElementType() != elementType ||
+      scale.getElementType() != elementType ||
+      offset.getElementType() != elementType ||
+      batchMean.getElementType() != elementType ||
+      batchVar.getElementType() != elementType)
+    return false;
+
+  FeatureLayout layout(operand.getShape(), featureIndex);
+  return dispatchOnPolicy(elementType, [&](auto policy) {
+    using Policy = decltype(policy);
+    using Storage = typename Policy::Storage;
+    if constexpr (!isFloatPolicy<Policy>) {
+      return false;
+    } else {
+      auto load = [](Storage value) {
+        return static_cast<double>(Policy::load(value));
+      };
+      auto data = operand.getData<Storage>();
+      auto scaleData = scale.getData<Storage>();
+      auto offsetData = offset.getData<Storage>();
+      auto outputData = output.getMutableData<Storage>();
+      auto meanData = batchMean.getMutableData<Storage>();
+      auto varData = batchVar.getMutableData<Storage>();
+      int64_t innerSize = layout.innerSize;
+      double count = layout.getNumElementsPerFeature();
+      parallelForFeatures(layout, [&](int64_t begin, int64_t end) {
+        // Merges the mean and the sum of squared deviations of every row
+        // into those of its feature with the parallel variant of Welford's
+        // algorithm, which reads the operand once and stays accurate for
+        // large batches, unlike the difference of the mean of squares and
+        // the squared mean.
+        std::vector<double> means(end - begin, 0.0);
+        std::vector<double> squares(end - begin, 0.0);
+        for (int64_t outer = 0; innerSize > 0 && outer < layout.outerSize;
+             ++outer) {
+          double previousCount = outer * innerSize;
+          double totalCount = previousCount + innerSize;
+          for (int64_t f = begin; f < end; ++f) {
+            const Storage *row = data.data() + layout.getRowOffset(outer, f);
+            double rowSum = 0.0;
+            for (int64_t i = 0; i < innerSize; ++i) rowSum += load(row[i]);
+            double rowMean = rowSum / innerSize;
+            double rowSquares = 0.0;
+            for (int64_t i = 0; i < innerSize; ++i) {
+              double deviation = load(row[i]) - rowMean;
+              rowSquares += deviation * deviation;
+            }
+            double delta = rowMean - means[f - begin];
+            means[f - begin] += delta * innerSize / totalCount;
+            squares[f - begin] += rowSquares + delta * delta * previousCount *
+                                                   innerSize / totalCount;
+          }
+        }
+
+        for (int64_t f = begin; f < end; ++f) {
+          double variance = squares[f - begin] / count;
+          meanData[f] = Policy::fromDouble(means[f - begin]);
+          varData[f] = Policy::fromDouble(variance);
+          squares[f - begin] =
+              load(scaleData[f]) / std::sqrt(variance + epsilon);
+        }
+        for (int64_t outer = 0; outer < layout.outerSize; ++outer) {
+          for (int64_t f = begin; f < end; ++f) {
+            double featureMean = means[f - begin];
+            double factor = squares[f - begin];
+            double featureOffset = load(offsetData[f]);
+            int64_t rowOffset = layout.getRowOffset(outer, f);
+            for (int64_t i = 0; i < innerSize; ++i) {
+              double x = load(data[rowOffset + i]);
+              outputData[rowOffset + i] = Policy::fromDouble(
+                  (x - featureMean) * factor + featureOffset);
+            }
+          }
+        }
+      });
+      return true;
+    }
+  });
+}
+
+bool evalBatchNormGradKernel(
+    const KernelOptions &options, const Tensor &operand, const Tensor &scale,
+    const Tensor &mean, const Tensor &variance, const Tensor &gradOutput,
+    double epsilon, Axis featureIndex, Tensor &gradOperand, Tensor &gradScale,
+    Tensor &gradOffset) {
+  auto elementType = gradOperand.getElementType();
+  if (!options.enableNativeKernels || operand.getElementType() != elementType ||
+      scale.getElementType() != elementType ||
+      mean.getElementType() != elementType ||
+      variance.getElementType() != elementType ||
+      gradOutput.getElementType() != elementType ||
+      gradScale.getElementType() != elementType ||
+      gradOffset.getElementType() != elementType)
+    return false;
+
+  FeatureLayout layout(operand.getShape(), featureIndex);
+  return dispatchOnPolicy(elementType, [&](auto policy) {
+    using Policy = decltype(policy);
+    using Storage = typename Policy::Storage;
+    if constexpr (!isFloatPolicy<Policy>) {
+      return false;
+    } else {
+      auto load = [](Storage value) {
+        return static_cast<double>(Policy::load(value));
+      };
+      auto data = operand.getData<Storage>();
+      auto gradData = gradOutput.getData<Storage>();
+      auto scaleData = scale.getData<Storage>();
+      auto meanData = mean.getData<Storage>();
+      auto varianceData = variance.getData<Storage>();
+      auto gradOperandData = gradOperand.getMutableData<Storage>();
+      auto gradScaleData = gradScale.getMutableData<Storage>();
+      auto gradOffsetData = gradOffset.getMutableData<Storage>();
+      int64_t innerSize = layout.innerSize;
+      double count = layout.getNumElementsPerFeature();
+      parallelForFeatures(layout, [&](int64_t begin, int64_t end) {
+        // Sums the gradients and their products with the centered operand
+        // of every feature in one pass, and computes the gradient of the
+        // operand from these sums in another.
+        std::vector<double> gradSums(end - begin, 0.0);
+        std::vector<double> centeredSums(end - begin, 0.0);
+        for (int64_t outer = 0; outer < layout.outerSize; ++outer) {
+          for (int64_t f = begin; f < end; ++f) {
+            double featureMean = load(meanData[f]);
+            int64_t rowOffset = layout.getRowOffset(outer, f);
+            double gradSum = 0.0;
+            double centeredSum = 0.0;
+            for (int64_t i = 0; i < innerSize; ++i) {
+              double grad = load(gradData[rowOffset + i]);
+              gradSum += grad;
+              centeredSum += grad * (load(data[rowOffset + i]) - featureMean);
+            }
+            gradSums[f - begin] += gradSum;
+            centeredSums[f - begin] += centeredSum;
+          }
+        }
+
+        for (int64_t f = begin; f < end; ++f) {
+          double stddev = std::sqrt(load(varianceData[f]) + epsilon);
+          gradScaleData[f] =
+              Policy::fromDouble(centeredSums[f - begin] / stddev);
+          gradOffsetData[f] = Policy::fromDouble(gradSums[f - begin]);
+        }
+        for (int64_t outer = 0; outer < layout.outerSize; ++outer) {
+          for (int64_t f = begin; f < end; ++f) {
+            double featureMean = load(meanData[f]);
+            double varianceEpsilon = load(varianceData[f]) + epsilon;
+            double factor =
+                load(scaleData[f]) / std::sqrt(varianceEpsilon) / count;
+            double gradSum = gradSums[f - begin];
+            double centeredFactor = centeredSums[f - begin] / varianceEpsilon;
+            int64_t rowOffset = layout.getRowOffset(outer, f);
+            for (int64_t i = 0; i < innerSize; ++i) {
+              double grad = load(gradData[rowOffset + i]);
+              double centered = load(data[rowOffset + i]) - featureMean;
+              gradOperandData[rowOffset + i] = Policy::fromDouble(
+                  factor *
+                  (count * grad - gradSum - centered * centeredFactor));
+            }
+          }
+        }
+      });
+      return true;
+    }
+  });
+}
+
+bool evalReduceKernel(const KernelOptions &options, BinaryKernel kernel,
+                      const Tensor &input, const Tensor &initValue,
+                      const Axes &dimensions, Tensor &result) {
+  if (!options.enableNativeKernels ||
+      input.getElementType() != result.getElementType() ||
+      initValue.getElementType() != result.getElementType())
+    return false;
+
+  // Every input element is combined into the result element at offset
+  // `sum(i[d] * resultStrides[d])`, i.e. reduced dimensions have stride 0.
+  auto shape = input.getShape();
+  int64_t rank = shape.size();
+  Sizes resultStrides(rank, 0);
+  for (int64_t d = rank - 1, stride = 1; d >= 0; --d) {
+    if (llvm::is_contained(dimensions, d)) continue;
+    resultStrides[d] = stride;
+    stride *= shape[d];
+  }
+
+  bool exact = options.exactAccumulation;
+  bool pairwise = !exact && options.pairwiseSummation &&
+                  kernel == BinaryKernel::Add;
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    return dispatchOnMonoid<Policy>(kernel, [&](auto fn) {
+      using C = typename Policy::Compute;
+      using Storage = typename Policy::Storage;
+      auto inputData = input.getData<Storage>();
+      auto resultData = result.getMutableData<Storage>();
+      auto round = [&](C value) {
+        return exact ? Policy::load(Policy::store(value)) : value;
+      };
+      C init = Policy::load(initValue.getData<Storage>()[0]);
+      std::vector<C> accumulators(resultData.size(), init);
+
+      if (isFloatPolicy<Policy> && pairwise) {
+        // Gathers the elements reduced into every result element in the
+        // order in which `reduceOp` visits them and sums them pairwise.
+        auto inputStrides = getStrides(shape);
+        Sizes reducedShape, reducedStrides, keptShape, keptStrides;
+        for (int64_t d = 0; d < rank; ++d) {
+          bool isReduced = llvm::is_contained(dimensions, d);
+          (isReduced ? reducedShape : keptShape).push_back(shape[d]);
+          (isReduced ? reducedStrides : keptStrides).push_back(inputStrides[d]);
+        }
+        int64_t numReduced = getProduct(reducedShape);
+        std::vector<int64_t> reducedOffsets(numReduced);
+        Sizes reducedIndex(reducedShape.size(), 0);
+        for (auto &offset : reducedOffsets) {
+          offset = 0;
+          for (size_t i = 0; i < reducedIndex.size(); ++i)
+            offset += reducedIndex[i] * reducedStrides[i];
+          incrementIndex(reducedIndex, reducedShape);
+        }
+
+        int64_t minChunkSize = std::max<int64_t>(
+            kMinChunkSize / std::max<int64_t>(numReduced, 1), 1);
+        parallelForChunks(
+            accumulators.size(), minChunkSize, [&](int64_t begin, int64_t end) {
+              std::vector<C> values(numReduced);
+              auto keptIndex = delinearize(begin, keptShape);
+              for (int64_t a = begin; a < end; ++a) {
+                int64_t keptOffset = 0;
+                for (size_t i = 0; i < keptIndex.size(); ++i)
+                  keptOffset += keptIndex[i] * keptStrides[i];
+                for (int64_t i = 0; i < numReduced; ++i)
+                  values[i] =
+                      Policy::load(inputData[keptOffset + reducedOffsets[i]]);
+                accumulators[a] = fn(accumulators[a],
+                                     pairwiseSum(values.data(), numReduced));
+                incrementIndex(keptIndex, keptShape);
+              }
+            });
+      } else if (!inputData.empty()) {
+        // Walks the input in row-major order, like `reduceOp`, and specializes
+        // the innermost loop depending on whether its dimension is reduced,
+        // so that compilers can vectorize it. If an outer dimension comes
+        // first and is kept, its slices are reduced into disjoint result
+        // elements and are walked in parallel.
+        int64_t innerSize = rank == 0 ? 1 : shape[rank - 1];
+        bool isInnerReduced = rank != 0 && resultStrides[rank - 1] == 0;
+        Sizes outerShape = shape;
+        if (rank != 0) outerShape.pop_back();
+        int64_t numSlices =
+            rank > 1 && !llvm::is_contained(dimensions, 0) ? shape[0] : 1;
+        int64_t sliceSize = inputData.size() / numSlices;
+        parallelForChunks(
+            numSlices, std::max<int64_t>(kMinChunkSize / sliceSize, 1),
+            [&](int64_t begin, int64_t end) {
+              auto outerIndex =
+                  delinearize(begin * sliceSize / innerSize, outerShape);
+              for (int64_t i = begin * sliceSize, e = end * sliceSize; i < e;
+                   i += innerSize) {
+                int64_t resultOffset = 0;
+                for (size_t d = 0; d < outerIndex.size(); ++d)
+                  resultOffset += outerIndex[d] * resultStrides[d];
+                const Storage *values = inputData.data() + i;
+                C *results = accumulators.data() + resultOffset;
+                if (isInnerReduced) {
+                  C accumulator = *results;
+                  for (int64_t j = 0; j < innerSize; ++j)
+                    accumulator =
+                        round(fn(accumulator, Policy::load(values[j])));
+                  *results = accumulator;
+                } else {
+                  for (int64_t j = 0; j < innerSize; ++j)
+                    results[j] = round(fn(results[j], Policy::load(values[j])));
+                }
+                incrementIndex(outerIndex, outerShape);
+              }
+            });
+      }
+
+      for (size_t i = 0, e = resultData.size(); i < e; ++i)
+        resultData[i] = Policy::store(accumulators[i]);
+      return true;
+    });
+  });
+}
+
+namespace {
+
+template <typename Policy, typename Fn>
+class StreamingReductionImpl : public StreamingReduction {
+ public:
+  using C = typename Policy::Compute;
+  using Storage = typename Policy::Storage;
+
+  StreamingReductionImpl(Fn fn, ShapedType inputType, C init,
+                         const Axes &dimensions, ShapedType resultType,
+                         bool exact)
+      : fn_(fn),
+        resultType_(resultType),
+        exact_(exact),
+        accumulators_(resultType.getNumElements(), init) {
+    // Like `evalReduceKernel`, walks the input row by row along its last
+    // dimension, where reduced dimensions have result stride 0.
+    auto shape = inputType.getShape();
+    int64_t rank = shape.size();
+    rowSize_ = rank == 0 ? 1 : shape[rank - 1];
+    isInnerReduced_ = rank != 0 && llvm::is_contained(dimensions, rank - 1);
+    outerShape_.assign(shape.begin(), shape.end());
+    if (rank != 0) outerShape_.pop_back();
+    outerIndex_.assign(outerShape_.size(), 0);
+    resultStrides_.assign(outerShape_.size(), 0);
+    int64_t stride = isInnerReduced_ ? 1 : rowSize_;
+    for (int64_t d = static_cast<int64_t>(outerShape_.size()) - 1; d >= 0;
+         --d) {
+      if (llvm::is_contained(dimensions, d)) continue;
+      resultStrides_[d] = stride;
+      stride *= outerShape_[d];
+    }
+  }
+
+  void consume(ArrayRef<char> chunk) override {
+    const Storage *values = reinterpret_cast<const Storage *>(chunk.data());
+    int64_t size = chunk.size() / sizeof(Storage);
+    while (size != 0) {
+      int64_t count = std::min(size, rowSize_ - rowPosition_);
+      C *results = accumulators_.data() + resultOffset_;
+      if (isInnerReduced_) {
+        C accumulator = *results;
+        for (int64_t j = 0; j < count; ++j)
+          accumulator = round(fn_(accumulator, Policy::load(values[j])));
+        *results = accumulator;
+      } else {
+        results += rowPosition_;
+        for (int64_t j = 0; j < count; ++j)
+          results[j] = round(fn_(results[j], Policy::load(values[j])));
+      }
+      values += count;
+      size -= count;
+      rowPosition_ += count;
+      if (rowPosition_ != rowSize_) continue;
+
+      rowPosition_ = 0;
+      incrementIndex(outerIndex_, outerShape_);
+      resultOffset_ = 0;
+      for (size_t d = 0; d < outerIndex_.size(); ++d)
+        resultOffset_ += outerIndex_[d] * resultStrides_[d];
+    }
+  }
+
+  Tensor finish() override {
+    Tensor result(resultType_);
+    auto resultData = result.getMutableData<Storage>();
+    for (size_t i = 0, e = resultData.size(); i < e; ++i)
+      resultData[i] = Policy::store(accumulators_[i]);
+    return result;
+  }
+
+ private:
+  C round(C value) const {
+    return exact_ ? Policy::load(Policy::store(value)) : value;
+  }
+
+  Fn fn_;
+  ShapedType resultType_;
+  bool exact_;
+  std::vector<C> accumulators_;
+
+  int64_t rowSize_;
+  bool isInnerReduced_;
+  Sizes outerShape_;
+  Sizes resultStrides_;
+
+  /// The position of the next element to consume: the index of its row, the
+  /// offset of the result elements of the row and its position in the row.
+  Sizes outerIndex_;
+  int64_t resultOffset_ = 0;
+  int64_t rowPosition_ = 0;
+};
+
+}  // namespace
+
+std::unique_ptr<StreamingReduction> StreamingReduction::create(
+    const KernelOptions &options, BinaryKernel kernel, ShapedType inputType,
+    const Tensor &initValue, const Axes &dimensions, ShapedType resultType) {
+  if (!options.enableNativeKernels ||
+      inputType.getElementType() != resultType.getElementType() ||
+      initValue.getElementType() != resultType.getElementType())
+    return nullptr;
+
+  std::unique_ptr<StreamingReduction> reduction;
+  dispatchOnPolicy(resultType.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    return dispatchOnMonoid<Policy>(kernel, [&](auto fn) {
+      using Storage = typename Policy::Storage;
+      auto init = Policy::load(initValue.getData<Storage>()[0]);
+      reduction =
+          std::make_unique<StreamingReductionImpl<Policy, decltype(fn)>>(
+              fn, inputType, init, dimensions, resultType,
+              options.exactAccumulation);
+      return true;
+    });
+  });
+  return reduction;
+}
+
+bool evalAllReduceKernel(const KernelOptions &options, BinaryKernel kernel,
+                         ArrayRef<Tensor> operands, int64_t begin, int64_t end,
+                         Tensor &result) {
+  if (!options.enableNativeKernels || operands.empty() ||
+      llvm::any_of(operands, [&](const Tensor &operand) {
+        return operand.getType() != result.getType();
+      }))
+    return false;
+
+  bool exact = options.exactAccumulation;
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    return dispatchOnMonoid<Policy>(kernel, [&](auto fn) {
+      using C = typename Policy::Compute;
+      using Storage = typename Policy::Storage;
+      // Combines one operand after another into all accumulators, so that the
+      // innermost loop can be vectorized.
+      std::vector<C> accumulators(end - begin);
+      auto firstData = operands.front().getData<Storage>();
+      for (int64_t i = begin; i < end; ++i)
+        accumulators[i - begin] = Policy::load(firstData[i]);
+      for (const auto &operand : operands.drop_front()) {
+        auto operandData = operand.getData<Storage>();
+        for (int64_t i = begin; i < end; ++i) {
+          C value = fn(accumulators[i - begin], Policy::load(operandData[i]));
+          accumulators[i - begin] =
+              exact ? Policy::load(Policy::store(value)) : value;
+        }
+      }
+
+      auto resultData = result.getMutableData<Storage>();
+      for (int64_t i = begin; i < end; ++i)
+        resultData[i] = Policy::store(accumulators[i - begin]);
+      return true;
+    });
+  });
+}
+
+bool evalReduceWindowKernel(
+    const KernelOptions &options, BinaryKernel kernel, const Tensor &input,
+    const Tensor &initValue, const Sizes &windowDimensions,
+    const Sizes &windowStrides, const Sizes &baseDilations,
+    const Sizes &windowDilations, const Sizes &paddingLow, Tensor &result) {
+  if (!options.enableNativeKernels ||
+      input.getElementType() != result.getElementType() ||
+      initValue.getElementType() != result.getElementType())
+    return false;
+
+  auto inputShape = input.getShape();
+  auto resultShape = result.getShape();
+  auto inputStrides = getStrides(inputShape);
+  int64_t rank = inputShape.size();
+  int64_t windowSize = getProduct(windowDimensions);
+
+  // For every dimension, maps pairs of result and window positions to input
+  // coordinates, or to -1 if they fall into padding or between dilated input
+  // elements, where the padded input of `reduceWindowOp` holds `initValue`.
+  SmallVector<Sizes> inputCoordinates(rank);
+  for (int64_t d = 0; d < rank; ++d) {
+    for (int64_t o = 0; o < resultShape[d]; ++o) {
+      for (int64_t w = 0; w < windowDimensions[d]; ++w) {
+        int64_t paddedPosition = o * windowStrides[d] + w * windowDilations[d];
+        int64_t dilatedPosition = paddedPosition - paddingLow[d];
+        int64_t inputCoordinate = -1;
+        if (dilatedPosition >= 0 && dilatedPosition % baseDilations[d] == 0 &&
+            dilatedPosition / baseDilations[d] < inputShape[d])
+          inputCoordinate = dilatedPosition / baseDilations[d];
+        inputCoordinates[d].push_back(inputCoordinate);
+      }
+    }
+  }
+
+  bool exact = options.exactAccumulation;
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    return dispatchOnMonoid<Policy>(kernel, [&](auto fn) {
+      using C = typename Policy::Compute;
+      using Storage = typename Policy::Storage;
+      auto inputData = input.getData<Storage>();
+      auto resultData = result.getMutableData<Storage>();
+      C init = Policy::load(initValue.getData<Storage>()[0]);
+
+      Sizes resultIndex(rank, 0);
+      for (auto &resultElement : resultData) {
+        C accumulator = init;
+        Sizes windowIndex(rank, 0);
+        for (int64_t w = 0; w < windowSize; ++w) {
+          int64_t inputOffset = 0;
+          bool isPadding = false;
+          for (int64_t d = 0; d < rank && !isPadding; ++d) {
+            int64_t coordinate =
+                inputCoordinates[d][resultIndex[d] * windowDimensions[d] +
+                                    windowIndex[d]];
+            isPadding = coordinate < 0;
+            inputOffset += coordinate * inputStrides[d];
+          }
+          C value = isPadding ? init : Policy::load(inputData[inputOffset]);
+          accumulator = fn(accumulator, value);
+          if (exact) accumulator = Policy::load(Policy::store(accumulator));
+          incrementIndex(windowIndex, windowDimensions);
+        }
+        resultElement = Policy::store(accumulator);
+        incrementIndex(resultIndex, resultShape);
+      }
+      return true;
+    });
+  });
+}
+
+bool evalSortKernel(const KernelOptions &options, ArrayRef<Tensor> inputs,
+                    Axis dimension, bool isStable, size_t keyIndex,
+                    ComparisonDirection comparisonDirection, bool isTotalOrder,
+                    MutableArrayRef<Tensor> results) {
+  if (!options.enableNativeKernels ||
+      (comparisonDirection != ComparisonDirection::GT &&
+       comparisonDirection != ComparisonDirection::LT))
+    return false;
+
+  // Elements of a slice are `stride` elements apart, and slices which start
+  // `stride` or more elements apart are `size * stride` elements apart.
+  const Tensor &keys = inputs[keyIndex];
+  auto shape = keys.getShape();
+  int64_t size = shape[dimension];
+  int64_t stride = 1;
+  for (int64_t d = dimension + 1; d < keys.getRank(); ++d) stride *= shape[d];
+  if (keys.getNumElements() == 0) return true;
+  int64_t numSlices = keys.getNumElements() / size;
+
+  SmallVector<const char *> inputData;
+  SmallVector<char *> resultData;
+  SmallVector<size_t> elementSizes;
+  for (auto [input, result] : llvm::zip(inputs, results)) {
+    inputData.push_back(input.getData<char>().data());
+    resultData.push_back(result.getMutableData<char>().data());
+    elementSizes.push_back(input.getData<char>().size() / size / numSlices);
+  }
+
+  bool isAscending = comparisonDirection == ComparisonDirection::LT;
+  return dispatchOnPolicy(keys.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    auto keyData = keys.getData<typename Policy::Storage>();
+    return dispatchOnOrderKey<Policy>(isTotalOrder, [&](auto key) {
+      using K = decltype(key(keyData[0]));
+      // Like `sortOp`, sorts handles to the elements of every slice and then
+      // moves the elements of all inputs into place.
+      int64_t minChunkSize = std::max<int64_t>(kMinChunkSize / size, 1);
+      parallelForChunks(numSlices, minChunkSize, [&](int64_t begin,
+                                                     int64_t end) {
+        std::vector<K> sliceKeys(size);
+        std::vector<int64_t> handles(size);
+        for (int64_t s = begin; s < end; ++s) {
+          int64_t start = s / stride * size * stride + s % stride;
+          for (int64_t i = 0; i < size; ++i)
+            sliceKeys[i] = key(keyData[start + i * stride]);
+          std::iota(handles.begin(), handles.end(), 0);
+          auto comparator = [&](int64_t lhsHandle, int64_t rhsHandle) {
+            return isAscending ? sliceKeys[lhsHandle] < sliceKeys[rhsHandle]
+                               : sliceKeys[lhsHandle] > sliceKeys[rhsHandle];
+          };
+          if (isStable)
+            std::stable_sort(handles.begin(), handles.end(), comparator);
+          else
+            std::sort(handles.begin(), handles.end(), comparator);
+
+          for (size_t j = 0; j < inputs.size(); ++j) {
+            size_t elementSize = elementSizes[j];
+            for (int64_t i = 0; i < size; ++i) {
+              int64_t inputOffset = start + handles[i] * stride;
+              int64_t resultOffset = start + i * stride;
+              std::memcpy(resultData[j] + resultOffset * elementSize,
+                          inputData[j] + inputOffset * elementSize,
+                          elementSize);
+            }
+          }
+        }
+      });
+      return true;
+    });
+  });
+}
+
+bool evalCopyKernel(const KernelOptions &options, const Tensor &operand,
+                    Tensor &result) {
+  if (!options.enableNativeKernels ||
+      operand.getElementType() != result.getElementType() ||
+      operand.getNumElements() != result.getNumElements())
+    return false;
+  llvm::copy(operand.getData<char>(), result.getMutableData<char>().begin());
+  return true;
+}
+
+namespace {
+
+// Returns the strides of the canonical order of `shape`, in elements.
+Sizes getCanonicalStrides(const Sizes &shape) {
+  Sizes strides(shape.size(), 1);
+  for (int64_t d = static_cast<int64_t>(shape.size()) - 2; d >= 0; --d)
+    strides[d] = strides[d + 1] * shape[d + 1];
+  return strides;
+}
+
+// Computes `fullStartIndex + fullBatchingIndex` of `gatherOp` and `scatterOp`
+// for every index of the batch dimensions of `indices`, i.e. all dimensions
+// but `indexVectorDim`, in canonical order, and stores them in consecutive
+// rows of `rank` elements of `starts`. Returns false if `indices` doesn't have
+// a native integer element type.
+bool getWindowStarts(const Tensor &indices, Axis indexVectorDim,
+                     const Axes &startIndexMap, const Axes &operandBatchingDims,
+                     const Axes &indicesBatchingDims, int64_t rank,
+                     std::vector<int64_t> &starts) {
+  bool applied = false;
+  dispatchOnNativeType(indices.getElementType(), [&](auto zero) {
+    using T = decltype(zero);
+    if constexpr (std::is_integral_v<T>) {
+      auto indicesData = indices.getData<T>();
+      auto indicesShape = indices.getShape();
+      auto indicesStrides = getCanonicalStrides(indicesShape);
+      int64_t vectorStride = indexVectorDim < indices.getRank()
+                                 ? indicesStrides[indexVectorDim]
+                                 : 0;
+      Sizes batchShape, batchStrides;
+      for (auto d : indices.getAxes()) {
+        if (d == indexVectorDim) continue;
+        batchShape.push_back(indicesShape[d]);
+        batchStrides.push_back(indicesStrides[d]);
+      }
+      int64_t numBatches = 1;
+      for (auto size : batchShape) numBatches *= size;
+
+      starts.assign(numBatches * rank, 0);
+      Sizes batchIndex(batchShape.size(), 0);
+      int64_t position = 0;
+      for (int64_t b = 0; b < numBatches; ++b) {
+        int64_t *start = starts.data() + b * rank;
+        for (size_t k = 0; k < startIndexMap.size(); ++k)
+          start[startIndexMap[k]] = static_cast<int64_t>(
+              indicesData[position + static_cast<int64_t>(k) * vectorStride]);
+        for (size_t i = 0; i < operandBatchingDims.size(); ++i) {
+          auto d = indicesBatchingDims[i];
+          start[operandBatchingDims[i]] +=
+              batchIndex[d < indexVectorDim ? d : d - 1];
+        }
+        for (int64_t d = batchShape.size() - 1; d >= 0; --d) {
+          position += batchStrides[d];
+          if (++batchIndex[d] < batchShape[d]) break;
+          position -= batchStrides[d] * batchShape[d];
+          batchIndex[d] = 0;
+        }
+      }
+      applied = true;
+    }
+  });
+  return applied;
+}
+
+// Invokes `fn` with a value-initialized unsigned integer type of
+// `elementSize` bytes, or a 16-byte type, which kernels use to move elements
+// of any element type without interpreting them. Returns false without
+// invoking `fn` for other sizes.
+template <typename Fn>
+bool dispatchOnElementSize(int64_t elementSize, Fn &&fn) {
+  switch (elementSize) {
+    case 1:
+      fn(uint8_t());
+      return true;
+    case 2:
+      fn(uint16_t());
+      return true;
+    case 4:
+      fn(uint32_t());
+      return true;
+    case 8:
+      fn(uint64_t());
+      return true;
+    case 16:
+      fn(std::complex<double>());
+      return true;
+  }
+  return false;
+}
+
+// Copies the run of `size` elements at `from` and `to`, which are
+// `innerStrides` apart, see `parallelForStridedRuns`, as one block copy or
+// fill when they're contiguous or a splat.
+template <typename T>
+void copyStridedRun(const T *from, T *to, int64_t size,
+                    std::array<int64_t, 2> innerStrides) {
+  if (innerStrides[1] == 1 && innerStrides[0] == 1) {
+    std::copy(from, from + size, to);
+  } else if (innerStrides[1] == 1 && innerStrides[0] == 0) {
+    std::fill(to, to + size, *from);
+  } else {
+    for (int64_t i = 0; i < size; ++i)
+      to[i * innerStrides[1]] = from[i * innerStrides[0]];
+  }
+}
+
+}  // namespace
+
+bool evalConcatenateKernel(const KernelOptions &options,
+                           ArrayRef<Tensor> inputs, Axis dimension,
+                           Tensor &result) {
+  if (!options.enableNativeKernels ||
+      llvm::any_of(inputs, [&](const Tensor &input) {
+        return input.getElementType() != result.getElementType();
+      }))
+    return false;
+
+  auto resultData = result.getMutableData<char>();
+  int64_t numElements = result.getNumElements();
+  if (numElements == 0) return true;
+
+  // Every input contributes one contiguous block of bytes to every row of the
+  // result, i.e. to every index of the dimensions before `dimension`. Inputs
+  // in canonical order are copied block by block, row by row.
+  auto shape = result.getShape();
+  int64_t numRows = 1;
+  for (int64_t d = 0; d < dimension; ++d) numRows *= shape[d];
+  int64_t elementSize = resultData.size() / numElements;
+  int64_t rowSize = resultData.size() / numRows;
+  std::vector<int64_t> blockSizes;
+  for (const auto &input : inputs)
+    blockSizes.push_back(input.getNumElements() * elementSize / numRows);
+  parallelForChunks(
+      numRows, std::max<int64_t>(kMinChunkSize * elementSize / rowSize, 1),
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          char *resultRow = resultData.data() + row * rowSize;
+          for (auto [input, blockSize] : llvm::zip(inputs, blockSizes)) {
+            if (!input.isStrided()) {
+              const char *block = input.getData() + row * blockSize;
+              std::copy(block, block + blockSize, resultRow);
+            }
+            resultRow += blockSize;
+          }
+        }
+      });
+
+  // Strided views, like broadcasts of masks, are read in place rather than
+  // copied into canonical order first.
+  auto resultStrides = getCanonicalStrides(shape);
+  int64_t dimensionOffset = 0;
+  for (const auto &input : inputs) {
+    int64_t offset = dimensionOffset * resultStrides[dimension];
+    dimensionOffset += input.getShape()[dimension];
+    if (!input.isStrided()) continue;
+    dispatchOnElementSize(elementSize, [&](auto element) {
+      using T = decltype(element);
+      const T *x = reinterpret_cast<const T *>(input.getStridedData());
+      T *y = reinterpret_cast<T *>(resultData.data()) + offset;
+      parallelForStridedRuns<2>(
+          input.getShape(), {input.getStrides(), resultStrides},
+          [&](int64_t begin, int64_t size, std::array<int64_t, 2> positions,
+              std::array<int64_t, 2> innerStrides) {
+            copyStridedRun(x + positions[0], y + positions[1], size,
+                           innerStrides);
+          });
+    });
+  }
+  return true;
+}
+
+bool evalGatherKernel(
+    const KernelOptions &options, const Tensor &operand,
+    const Tensor &startIndices, const Axes &offsetDims,
+    const Axes &collapsedSliceDims, const Axes &operandBatchingDims,
+    const Axes &startIndicesBatchingDims, const Axes &startIndexMap,
+    Axis indexVectorDim, const Sizes &sliceSizes, Tensor &result) {
+  if (!options.enableNativeKernels ||
+      operand.getElementType() != result.getElementType())
+    return false;
+
+  int64_t rank = operand.getRank();
+  std::vector<int64_t> starts;
+  if (!getWindowStarts(startIndices, indexVectorDim, startIndexMap,
+                       operandBatchingDims, startIndicesBatchingDims, rank,
+                       starts))
+    return false;
+
+  auto resultData = result.getMutableData<char>();
+  int64_t numElements = result.getNumElements();
+  if (numElements == 0) return true;
+  int64_t elementSize = resultData.size() / numElements;
+
+  // Every start index selects a window of the shape `sliceSizes` of the
+  // operand, whose non-collapsed dimensions map to `offsetDims` of the result
+  // and whose other dimensions have size 1. Windows which cover whole trailing
+  // dimensions of a contiguous operand, like the rows of embedding lookups,
+  // merge into a single run which is copied as one block.
+  auto operandShape = operand.getShape();
+  auto resultShape = result.getShape();
+  auto resultStrides = getCanonicalStrides(resultShape);
+  Sizes windowResultStrides(rank, 0);
+  for (int64_t d = 0, k = 0; d < rank; ++d) {
+    if (llvm::is_contained(collapsedSliceDims, d) ||
+        llvm::is_contained(operandBatchingDims, d))
+      continue;
+    windowResultStrides[d] = resultStrides[offsetDims[k++]];
+  }
+  Sizes runShape;
+  std::array<Sizes, 2> runStrides;
+  mergeStridedDims<2>(sliceSizes, {operand.getStrides(), windowResultStrides},
+                      runShape, runStrides);
+
+  Sizes batchShape, batchStrides;
+  for (auto d : result.getAxes()) {
+    if (llvm::is_contained(offsetDims, d)) continue;
+    batchShape.push_back(resultShape[d]);
+    batchStrides.push_back(resultStrides[d]);
+  }
+  int64_t numBatches = 1;
+  for (auto size : batchShape) numBatches *= size;
+  int64_t windowSize = numElements / numBatches;
+
+  auto operandStrides = operand.getStrides();
+  const char *operandData = operand.getStridedData();
+  return dispatchOnElementSize(elementSize, [&](auto element) {
+    using T = decltype(element);
+    const T *x = reinterpret_cast<const T *>(operandData);
+    T *y = reinterpret_cast<T *>(resultData.data());
+    parallelForChunks(
+        numBatches, std::max<int64_t>(kMinChunkSize / windowSize, 1),
+        [&](int64_t begin, int64_t end) {
+          for (int64_t b = begin; b < end; ++b) {
+            std::array<int64_t, 2> positions{};
+            for (int64_t d = 0; d < rank; ++d) {
+              // Start indices are clamped so that windows stay in bounds.
+              int64_t start = starts[b * rank + d];
+              if (llvm::is_contained(startIndexMap, d))
+                start = std::clamp<int64_t>(start, 0,
+                                            operandShape[d] - sliceSizes[d]);
+              positions[0] += start * operandStrides[d];
+            }
+            for (int64_t d = batchShape.size() - 1, rest = b; d >= 0; --d) {
+              positions[1] += rest % batchShape[d] * batchStrides[d];
+              rest /= batchShape[d];
+            }
+            forEachStridedRun<2>(
+                runShape, runStrides, positions,
+                [&](int64_t size, std::array<int64_t, 2> positions,
+                    std::array<int64_t, 2> innerStrides) {
+                  const T *from = x + positions[0];
+                  T *to = y + positions[1];
+                  if (innerStrides[0] == 1 && innerStrides[1] == 1) {
+                    std::copy(from, from + size, to);
+                    return;
+                  }
+                  for (int64_t i = 0; i < size; ++i)
+                    to[i * innerStrides[1]] = from[i * innerStrides[0]];
+                });
+          }
+        });
+  });
+}
+
+bool evalScatterKernel(
+    const KernelOptions &options, std::optional<BinaryKernel> kernel,
+    const Tensor &scatterIndices, const Tensor &updates,
+    const Axes &updateWindowDims, const Axes &insertedWindowDims,
+    const Axes &inputBatchingDims, const Axes &scatterIndicesBatchingDims,
+    const Axes &scatterDimsToOperandDims, Axis indexVectorDim, Tensor &result) {
+  // Update elements are applied in the canonical order of `updates`, which
+  // visits the windows one after another only if the window dimensions are
+  // the trailing dimensions of `updates`.
+  int64_t numScatterDims = updates.getRank() - updateWindowDims.size();
+  for (size_t k = 0; k < updateWindowDims.size(); ++k)
+    if (updateWindowDims[k] != numScatterDims + static_cast<int64_t>(k))
+      return false;
+  if (!options.enableNativeKernels ||
+      updates.getElementType() != result.getElementType())
+    return false;
+  if (kernel && !dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+        return dispatchOnMonoid<decltype(policy)>(*kernel,
+                                                  [](auto) { return true; });
+      }))
+    return false;
+
+  int64_t rank = result.getRank();
+  std::vector<int64_t> starts;
+  if (!getWindowStarts(scatterIndices, indexVectorDim, scatterDimsToOperandDims,
+                       inputBatchingDims, scatterIndicesBatchingDims, rank,
+                       starts))
+    return false;
+  int64_t numUpdates = updates.getNumElements();
+  if (numUpdates == 0 || result.getNumElements() == 0) return true;
+
+  // Every window of `updates` is scattered into a box of `result` of the shape
+  // `windowShape`, whose inserted and batching dimensions have size 1. Update
+  // elements which fall out of bounds are skipped, which clips the box.
+  auto resultShape = result.getShape();
+  auto resultStrides = getCanonicalStrides(resultShape);
+  auto updatesShape = updates.getShape();
+  auto updatesStrides = getCanonicalStrides(updatesShape);
+  Sizes windowShape(rank, 1), windowUpdatesStrides(rank, 0);
+  for (int64_t d = 0, k = 0; d < rank; ++d) {
+    if (llvm::is_contained(insertedWindowDims, d) ||
+        llvm::is_contained(inputBatchingDims, d))
+      continue;
+    windowShape[d] = updatesShape[updateWindowDims[k]];
+    windowUpdatesStrides[d] = updatesStrides[updateWindowDims[k++]];
+  }
+  int64_t windowSize = 1;
+  for (auto size : windowShape) windowSize *= size;
+  int64_t numWindows = numUpdates / windowSize;
+
+  auto apply = [&](auto storage, auto fn) {
+    using Storage = decltype(storage);
+    auto updatesData = updates.getData<Storage>();
+    auto resultData = result.getMutableData<Storage>();
+    Sizes boxShape(rank);
+    for (int64_t w = 0; w < numWindows; ++w) {
+      const int64_t *start = starts.data() + w * rank;
+      std::array<int64_t, 2> positions{w * windowSize, 0};
+      bool isEmpty = false;
+      for (int64_t d = 0; d < rank && !isEmpty; ++d) {
+        isEmpty = start[d] >= resultShape[d] || start[d] <= -windowShape[d];
+        if (isEmpty) break;
+        int64_t low = std::max<int64_t>(-start[d], 0);
+        int64_t high = std::min(windowShape[d], resultShape[d] - start[d]);
+        boxShape[d] = high - low;
+        positions[0] += low * windowUpdatesStrides[d];
+        positions[1] += (start[d] + low) * resultStrides[d];
+      }
+      if (isEmpty) continue;
+
+      Sizes runShape;
+      std::array<Sizes, 2> runStrides;
+      mergeStridedDims<2>(boxShape, {windowUpdatesStrides, resultStrides},
+                          runShape, runStrides);
+      forEachStridedRun<2>(
+          runShape, runStrides, positions,
+          [&](int64_t size, std::array<int64_t, 2> positions,
+              std::array<int64_t, 2> innerStrides) {
+            const Storage *from = updatesData.data() + positions[0];
+            Storage *to = resultData.data() + positions[1];
+            for (int64_t i = 0; i < size; ++i)
+              fn(to[i * innerStrides[1]], from[i * innerStrides[0]]);
+          });
+    }
+  };
+
+  if (!kernel) {
+    int64_t elementSize = result.getMutableData<char>().size() /
+                          result.getNumElements();
+    return dispatchOnElementSize(elementSize, [&](auto element) {
+      apply(element, [](auto &to, const auto &from) { to = from; });
+    });
+  }
+  return dispatchOnPolicy(result.getElementType(), [&](auto policy) {
+    using Policy = decltype(policy);
+    return dispatchOnMonoid<Policy>(*kernel, [&](auto fn) {
+      apply(typename Policy::Storage(), [&](auto &to, const auto &from) {
+        to = Policy::store(fn(Policy::load(to), Policy::load(from)));
+      });
+      return true;
+    });
+  });
+}
+
+bool evalPadKernel(const KernelOptions &options, const Tensor &operand,
+                   const Tensor &paddingValue, const Sizes &edgePaddingLow,
+                   const Sizes &interiorPadding, Tensor &result) {
+  if (!options.enableNativeKernels ||
+      operand.getElementType() != result.getElementType() ||
+      paddingValue.getElementType() != result.getElementType())
+    return false;
+
+  auto resultData = result.getMutableData<char>();
+  int64_t numElements = result.getNumElements();
+  if (numElements == 0) return true;
+  int64_t elementSize = resultData.size() / numElements;
+
+  // Padding nothing or a splat of the padding value gives a splat.
+  const char *padding = paddingValue.getStridedData();
+  if (operand.getNumElements() == 0 ||
+      (operand.isSplat() && std::equal(padding, padding + elementSize,
+                                       operand.getStridedData()))) {
+    result = makeSplatView(paddingValue, result.getType());
+    return true;
+  }
+
+  // The operand elements at coordinates [begin, end) along every dimension
+  // land in bounds of the result, `interiorPadding + 1` elements apart, and
+  // the others are cut off by negative padding. They form a window which is
+  // copied in strided runs, reading strided views of `operand` in place.
+  auto operandShape = operand.getShape();
+  auto operandStrides = operand.getStrides();
+  auto resultShape = result.getShape();
+  auto resultStrides = getCanonicalStrides(resultShape);
+  int64_t rank = operand.getRank();
+  Sizes windowShape(rank), windowStart(rank), windowResultStrides(rank);
+  int64_t operandOffset = 0, resultOffset = 0;
+  for (int64_t d = 0; d < rank; ++d) {
+    int64_t step = interiorPadding[d] + 1;
+    int64_t low = edgePaddingLow[d];
+    int64_t begin = low >= 0 ? 0 : (-low + step - 1) / step;
+    int64_t last = resultShape[d] - 1 - low;
+    int64_t end = last < 0 ? 0 : std::min(operandShape[d], last / step + 1);
+    windowShape[d] = std::max<int64_t>(end - begin, 0);
+    windowStart[d] = low + begin * step;
+    operandOffset += begin * operandStrides[d];
+    resultOffset += windowStart[d] * resultStrides[d];
+    windowResultStrides[d] = step * resultStrides[d];
+  }
+
+  bool isEmpty = llvm::is_contained(windowShape, 0);
+  bool hasInteriorPadding =
+      llvm::any_of(interiorPadding, [](int64_t size) { return size != 0; });
+  return dispatchOnElementSize(elementSize, [&](auto element) {
+    using T = decltype(element);
+    T paddingElement;
+    std::memcpy(&paddingElement, padding, sizeof(T));
+    T *y = reinterpret_cast<T *>(resultData.data());
+    const T *x = isEmpty ? nullptr
+                         : reinterpret_cast<const T *>(
+                               operand.getStridedData()) +
+                               operandOffset;
+
+    // Without interior padding, every row of the result along its last
+    // dimension is a block of padding, a run of the window and another block
+    // of padding, or just padding, so every element is written once.
+    if (!hasInteriorPadding && rank != 0) {
+      int64_t rowSize = resultShape[rank - 1];
+      int64_t runStart = windowStart[rank - 1];
+      int64_t runSize = isEmpty ? 0 : windowShape[rank - 1];
+      parallelForChunks(
+          numElements / rowSize,
+          std::max<int64_t>(kMinChunkSize / rowSize, 1),
+          [&](int64_t begin, int64_t end) {
+            for (int64_t row = begin; row < end; ++row) {
+              T *to = y + row * rowSize;
+              const T *from = x;
+              bool isInWindow = runSize != 0;
+              for (int64_t d = rank - 2, rest = row; d >= 0 && isInWindow;
+                   --d) {
+                int64_t coordinate = rest % resultShape[d] - windowStart[d];
+                rest /= resultShape[d];
+                isInWindow = coordinate >= 0 && coordinate < windowShape[d];
+                from += coordinate * operandStrides[d];
+              }
+              if (!isInWindow) {
+                std::fill(to, to + rowSize, paddingElement);
+                continue;
+              }
+              std::fill(to, to + runStart, paddingElement);
+              copyStridedRun(from, to + runStart, runSize,
+                             {operandStrides[rank - 1], 1});
+              std::fill(to + runStart + runSize, to + rowSize,
+                        paddingElement);
+            }
+          });
+      return;
+    }
+
+    parallelForChunks(numElements, kMinChunkSize,
+                      [&](int64_t begin, int64_t end) {
+                        std::fill(y + begin, y + end, paddingElement);
+                      });
+    if (isEmpty) return;
+
+    parallelForStridedRuns<2>(
+        windowShape, {operandStrides, windowResultStrides},
+        [&](int64_t begin, int64_t size, std::array<int64_t, 2> positions,
+            std::array<int64_t, 2> innerStrides) {
+          copyStridedRun(x + positions[0], y + resultOffset + positions[1],
+                         size, innerStrides);
+        });
+  });
+}
+
+namespace {
+
+bool isViewApplicable(const KernelOptions &options, const Tensor &operand,
+                      ShapedType resultType) {
+  return options.enableNativeKernels &&
+         operand.getElementType() == resultType.getElementType();
+}
+
+}  // namespace
+
+Tensor evalBroadcastInDimView(
+    const KernelOptions &options, const Tensor &operand,
+    const Axes &broadcastDimensions, ShapedType resultType) {
+  if (!isViewApplicable(options, operand, resultType)) return {};
+  auto operandShape = operand.getShape();
+  auto operandStrides = operand.getStrides();
+  Sizes strides(resultType.getRank(), 0);
+  for (size_t d = 0; d < broadcastDimensions.size(); ++d)
+    if (operandShape[d] != 1)
+      strides[broadcastDimensions[d]] = operandStrides[d];
+  return makeStridedView(operand, resultType, 0, strides);
+}
+
+Tensor evalReshapeView(const KernelOptions &options, const Tensor &operand,
+                       ShapedType resultType) {
+  if (!isViewApplicable(options, operand, resultType) ||
+      operand.getNumElements() != resultType.getNumElements())
+    return {};
+  if (auto strides = getReshapedStrides(operand.getShape(),
+                                        operand.getStrides(),
+                                        Sizes(resultType.getShape())))
+    return makeStridedView(operand, resultType, 0, *strides);
+
+  // The storage of `operand` is materialized, once for all its users.
+  return makeTensorView(operand, 0, resultType);
+}
+
+Tensor evalReverseView(const KernelOptions &options, const Tensor &operand,
+                       const Axes &dimensions, ShapedType resultType) {
+  if (!isViewApplicable(options, operand, resultType)) return {};
+  auto shape = operand.getShape();
+  auto strides = operand.getStrides();
+  int64_t offset = 0;
+  for (auto d : dimensions) {
+    offset += (shape[d] - 1) * strides[d];
+    strides[d] = -strides[d];
+  }
+  return makeStridedView(operand, resultType, offset, strides);
+}
+
+Tensor evalSliceView(const KernelOptions &options, const Tensor &operand,
+                     const Sizes &startIndices, const Sizes &strides,
+                     ShapedType resultType) {
+  if (!isViewApplicable(options, operand, resultType)) return {};
+  auto resultStrides = operand.getStrides();
+  int64_t offset = 0;
+  for (size_t d = 0; d < resultStrides.size(); ++d) {
+    offset += startIndices[d] * resultStrides[d];
+    resultStrides[d] *= strides[d];
+  }
+  return makeStridedView(operand, resultType, offset, resultStrides);
+}
+
+Tensor evalTransposeView(const KernelOptions &options, const Tensor &operand,
+                         const Axes &permutation, ShapedType resultType) {
+  if (!isViewApplicable(options, operand, resultType)) return {};
+  auto operandStrides = operand.getStrides();
+  Sizes strides;
+  for (auto d : permutation) strides.push_back(operandStrides[d]);
+  return makeStridedView(operand, resultType, 0, strides);
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
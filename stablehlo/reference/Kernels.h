@@ -0,0 +1,372 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_KERNELS_H
+#define STABLEHLO_REFERENCE_KERNELS_H
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/reference/Axes.h"
+#include "stablehlo/reference/EvaluationContext.h"
+#include "stablehlo/reference/Index.h"
+#include "stablehlo/reference/Tensor.h"
+
+namespace mlir {
+namespace stablehlo {
+
+// Native kernels evaluate ops directly on the underlying storage of tensors
+// instead of going through `Element` one element at a time. They produce the
+// same results as the `Element`-based implementations, which remain the
+// source of truth for the semantics of the interpreter and are used whenever
+// native kernels don't apply. Every kernel takes the `KernelOptions` of the
+// evaluation as its first argument.
+
+/// Elementwise unary operations that have native kernels.
+enum class UnaryKernel {
+  Abs,
+  Cbrt,
+  Ceil,
+  CountLeadingZeros,
+  Cosine,
+  Exponential,
+  ExponentialMinusOne,
+  Floor,
+  Log,
+  LogPlusOne,
+  Logistic,
+  Negate,
+  Not,
+  PopulationCount,
+  RoundNearestAfz,
+  RoundNearestEven,
+  Rsqrt,
+  Sign,
+  Sine,
+  Sqrt,
+  Tanh,
+};
+
+/// Elementwise binary operations that have native kernels.
+enum class BinaryKernel {
+  Add,
+  And,
+  Atan2,
+  Divide,
+  Maximum,
+  Minimum,
+  Multiply,
+  Or,
+  Power,
+  Remainder,
+  Subtract,
+  Xor,
+};
+
+/// Evaluates `kernel` on each element of `operand` and stores the results in
+/// `result`. Applies if native kernels are enabled, `operand` and `result`
+/// have the same type and `kernel` has a native implementation for its
+/// element type: an f8 type, f16, bf16, f32, f64 or an 8/16/32/64-bit
+/// integer type. Returns false without modifying `result` otherwise.
+///
+/// Elementwise kernels and `evalDotGeneralKernel`, but no other kernels, also
+/// apply to complex<f32> and complex<f64>, whose elements they compute on as
+/// `std::complex` rather than as pairs of APFloat, with the same results.
+///
+/// Elementwise kernels read strided views in place, see `makeStridedView`.
+/// If all operands are splats, see `Tensor::isSplat`, the kernel is
+/// evaluated on a single element and `result` is replaced with a splat view
+/// of it.
+bool evalUnaryKernel(const KernelOptions &options, UnaryKernel kernel,
+                     const Tensor &operand, Tensor &result);
+
+/// Binary counterpart of `evalUnaryKernel`, which requires `lhs`, `rhs` and
+/// `result` to have the same type.
+bool evalBinaryKernel(const KernelOptions &options, BinaryKernel kernel,
+                      const Tensor &lhs, const Tensor &rhs, Tensor &result);
+
+/// Native kernel for `compareOp`, applicable to the same element types as
+/// `evalUnaryKernel` when `lhs` and `rhs` have the same type. If
+/// `isTotalOrder`, floating-point elements are compared with the totalOrder
+/// predicate of IEEE 754 instead of the usual IEEE comparisons.
+bool evalCompareKernel(
+    const KernelOptions &options, ComparisonDirection comparisonDirection,
+    bool isTotalOrder, const Tensor &lhs, const Tensor &rhs, Tensor &result);
+
+/// Native kernel for `selectOp`, applicable to the same element types as
+/// `evalUnaryKernel` when `onTrue`, `onFalse` and `result` have the same type.
+/// If `pred` is a splat, e.g. a scalar, `result` is replaced with `onTrue` or
+/// `onFalse`, which shares its storage, for any element type.
+bool evalSelectKernel(const KernelOptions &options, const Tensor &pred,
+                      const Tensor &onTrue, const Tensor &onFalse,
+                      Tensor &result);
+
+/// Native kernel for `dotGeneralOp`, applicable to the same element types as
+/// `evalUnaryKernel` when `lhs`, `rhs` and `result` have the same element
+/// type. Packs the operands into matrices of shapes [batch, M, K] and
+/// [batch, K, N] and multiplies them in cache-sized blocks, accumulating the
+/// products for every result element in the same order as `dotGeneralOp`.
+bool evalDotGeneralKernel(const KernelOptions &options, const Tensor &lhs,
+                          const Tensor &rhs, const Axes &lhsBatchingDimensions,
+                          const Axes &rhsBatchingDimensions,
+                          const Axes &lhsContractingDimensions,
+                          const Axes &rhsContractingDimensions, Tensor &result);
+
+/// Copies the elements of `tensor` into `data` as complex doubles, e.g. for
+/// `fftOp`, which transforms them natively. Applicable to complex<f32>,
+/// complex<f64>, f32 and f64 element types, whose elements convert exactly.
+bool loadComplexKernel(const KernelOptions &options, const Tensor &tensor,
+                       MutableArrayRef<std::complex<double>> data);
+
+/// Counterpart of `loadComplexKernel`, which rounds `data` to the element type
+/// of `tensor` like `convert`, keeping the real parts for real element types.
+bool storeComplexKernel(const KernelOptions &options,
+                        ArrayRef<std::complex<double>> data, Tensor &tensor);
+
+/// Native kernel for `convolutionOp`, applicable to the same element types as
+/// `evalUnaryKernel` when `lhs`, `rhs` and `result` have the same element
+/// type. For every feature or batch group and every batch, unrolls the
+/// (padded, dilated and possibly reversed) input windows into a matrix whose
+/// rows correspond to output spatial positions (im2col) and multiplies it with
+/// the kernel using the GEMM from `evalDotGeneralKernel`, without
+/// materializing intermediate tensors.
+bool evalConvolutionKernel(
+    const KernelOptions &options, const Tensor &lhs, const Tensor &rhs,
+    ArrayRef<int64_t> windowStrides,
+    ArrayRef<std::pair<int64_t, int64_t>> padding,
+    ArrayRef<int64_t> lhsDilation, ArrayRef<int64_t> rhsDilation,
+    ArrayRef<bool> windowReversal, Axis inputBatchDimension,
+    Axis inputFeatureDimension, const Axes &inputSpatialDimensions,
+    Axis kernelInputFeatureDimension, Axis kernelOutputFeatureDimension,
+    const Axes &kernelSpatialDimensions, Axis outputBatchDimension,
+    Axis outputFeatureDimension, const Axes &outputSpatialDimensions,
+    int64_t featureGroupCount, int64_t batchGroupCount, Tensor &result);
+
+/// Native kernel for `choleskyOp`, applicable to floating-point element types
+/// when `a` and `result` have the same element type. Factorizes every matrix
+/// in panels of columns, updating the trailing matrix after every panel with
+/// the GEMM from `evalDotGeneralKernel`, and factorizes the matrices of a
+/// batch in parallel. Elements of `result` outside of the factorized triangle
+/// are set to zero.
+bool evalCholeskyKernel(const KernelOptions &options, const Tensor &a,
+                        bool lower, Tensor &result);
+
+/// Native kernel for `triangularSolveOp`, applicable to floating-point
+/// element types when `a`, `b` and `result` have the same element type, for
+/// which transposing and taking the adjoint of `a` are the same. Solves every
+/// system by substitution in panels of rows, updating the remaining rows after
+/// every panel with the GEMM from `evalDotGeneralKernel`, and solves the
+/// systems of a batch in parallel.
+bool evalTriangularSolveKernel(const KernelOptions &options, const Tensor &a,
+                               const Tensor &b, bool leftSide, bool lower,
+                               bool unitDiagonal, bool transposeA,
+                               Tensor &result);
+
+/// Native kernel for `batchNormInferenceOp`, applicable to floating-point
+/// element types when all operands and `result` have the same element type.
+/// Normalizes every feature with a single multiply-add per element, and
+/// normalizes chunks of features in parallel.
+bool evalBatchNormInferenceKernel(
+    const KernelOptions &options, const Tensor &operand, const Tensor &scale,
+    const Tensor &offset, const Tensor &mean, const Tensor &variance,
+    double epsilon, Axis featureIndex, Tensor &result);
+
+/// Native kernel for `batchNormTrainingOp`, applicable to the same element
+/// types as `evalBatchNormInferenceKernel` when all operands and results have
+/// the same element type. Computes the mean and the variance of every feature
+/// in a single pass with Welford's algorithm, accumulating in double, then
+/// normalizes it, and processes chunks of features in parallel.
+bool evalBatchNormTrainingKernel(
+    const KernelOptions &options, const Tensor &operand, const Tensor &scale,
+    const Tensor &offset, double epsilon, Axis featureIndex, Tensor &output,
+    Tensor &batchMean, Tensor &batchVar);
+
+/// Native kernel for `batchNormGradOp`, applicable to the same element types
+/// as `evalBatchNormInferenceKernel` when all operands and results have the
+/// same element type. Computes the per-feature sums of the gradient in a
+/// single pass, accumulating in double, then the gradient of `operand`, and
+/// processes chunks of features in parallel.
+bool evalBatchNormGradKernel(
+    const KernelOptions &options, const Tensor &operand, const Tensor &scale,
+    const Tensor &mean, const Tensor &variance, const Tensor &gradOutput,
+    double epsilon, Axis featureIndex, Tensor &gradOperand, Tensor &gradScale,
+    Tensor &gradOffset);
+
+/// Native kernel for `reduceOp` with a single input whose body applies
+/// `kernel` to its two arguments, e.g. a sum or a max reduction. Applicable to
+/// the same element types as `evalBinaryKernel` when `input`, `initValue` and
+/// `result` have the same element type. Every result element starts from
+/// `initValue` and combines the elements of `input` reduced into it in the
+/// same order as `reduceOp`.
+bool evalReduceKernel(const KernelOptions &options, BinaryKernel kernel,
+                      const Tensor &input, const Tensor &initValue,
+                      const Axes &dimensions, Tensor &result);
+
+/// Native kernel for `reduceOp` like `evalReduceKernel` which consumes the
+/// elements of its input chunk by chunk rather than all at once, so that
+/// inputs which don't fit into memory, e.g. read from files by
+/// `numpy::readTensorChunks`, can be reduced. Only the result is kept in
+/// memory. Pairwise summation doesn't apply, i.e. every result element
+/// combines the elements reduced into it in the same order as `reduceOp`.
+class StreamingReduction {
+ public:
+  /// Returns a reduction of inputs of type `inputType` along `dimensions`
+  /// into a result of type `resultType`, with the same requirements as
+  /// `evalReduceKernel`, or nullptr if they aren't met.
+  static std::unique_ptr<StreamingReduction> create(
+      const KernelOptions &options, BinaryKernel kernel, ShapedType inputType,
+      const Tensor &initValue, const Axes &dimensions, ShapedType resultType);
+
+  virtual ~StreamingReduction() = default;
+
+  /// Combines the elements stored in `chunk`, which must hold whole elements
+  /// that follow the elements of the previous chunks in canonical order,
+  /// into the result.
+  virtual void consume(ArrayRef<char> chunk) = 0;
+
+  /// Returns the result, once all elements of the input were consumed.
+  virtual Tensor finish() = 0;
+};
+
+/// Native kernel for the reduction of `allReduceOp` whose computation applies
+/// `kernel` to its two arguments. Applicable to the same element types as
+/// `evalBinaryKernel` when all `operands` have the type of `result`. Combines
+/// the elements of `operands` at the flattened positions [begin, end) from
+/// left to right, like `allReduceOp`, and leaves the other elements of
+/// `result` untouched.
+bool evalAllReduceKernel(const KernelOptions &options, BinaryKernel kernel,
+                         ArrayRef<Tensor> operands, int64_t begin, int64_t end,
+                         Tensor &result);
+
+/// Native kernel for `reduceWindowOp` with a single input whose body applies
+/// `kernel` to its two arguments, with the same requirements as
+/// `evalReduceKernel`. Window elements which fall into padding or between
+/// dilated input elements are taken to be `initValue`, like in the padded
+/// input of `reduceWindowOp`, without materializing it. High padding is
+/// implied by the shape of `result`.
+bool evalReduceWindowKernel(
+    const KernelOptions &options, BinaryKernel kernel, const Tensor &input,
+    const Tensor &initValue, const Sizes &windowDimensions,
+    const Sizes &windowStrides, const Sizes &baseDilations,
+    const Sizes &windowDilations, const Sizes &paddingLow, Tensor &result);
+
+/// Native kernel for `sortOp` with a comparator which compares the pair of
+/// elements of `inputs[keyIndex]` with `comparisonDirection`, which must be GT
+/// or LT, and `isTotalOrder` like `evalCompareKernel`. Applicable to the same
+/// key element types as `evalUnaryKernel`; the other inputs can have any
+/// element type. Sorts slices along `dimension` in parallel on the intra-op
+/// thread pool, with `std::stable_sort` if `isStable` and `std::sort`
+/// otherwise, like `sortOp`.
+bool evalSortKernel(const KernelOptions &options, ArrayRef<Tensor> inputs,
+                    Axis dimension, bool isStable, size_t keyIndex,
+                    ComparisonDirection comparisonDirection, bool isTotalOrder,
+                    MutableArrayRef<Tensor> results);
+
+/// Copies the underlying storage of `operand` to `result`, which must have
+/// the same element type and number of elements. Used by ops whose results
+/// start out as copies of their operands.
+bool evalCopyKernel(const KernelOptions &options, const Tensor &operand,
+                    Tensor &result);
+
+/// Native kernel for `concatenateOp`, applicable to any element type when
+/// `inputs` have the element type of `result`. Copies one contiguous block of
+/// the underlying storage of every input into every row of `result`, i.e. for
+/// every index of the dimensions before `dimension`. Strided views are read
+/// in place rather than materialized.
+bool evalConcatenateKernel(const KernelOptions &options,
+                           ArrayRef<Tensor> inputs, Axis dimension,
+                           Tensor &result);
+
+/// Native kernel for `gatherOp`, applicable to any element type when `operand`
+/// has the element type of `result` and `startIndices` has a native integer
+/// element type. Reads all start indices once up front, then copies every
+/// window of `operand` to `result` in runs of contiguous elements, so that
+/// e.g. the rows of embedding lookups are copied as single blocks. Strided
+/// views of `operand` are read in place.
+bool evalGatherKernel(
+    const KernelOptions &options, const Tensor &operand,
+    const Tensor &startIndices, const Axes &offsetDims,
+    const Axes &collapsedSliceDims, const Axes &operandBatchingDims,
+    const Axes &startIndicesBatchingDims, const Axes &startIndexMap,
+    Axis indexVectorDim, const Sizes &sliceSizes, Tensor &result);
+
+/// Native kernel for `scatterOp` with a single input whose update computation
+/// applies `kernel` to its two arguments, e.g. a scatter-add, or returns the
+/// update if `kernel` is empty. Applies `updates` to `result`, which holds
+/// the input, in place and in the same order as `scatterOp`. Applicable to
+/// the same element types as `evalBinaryKernel` when `updates` has the
+/// element type of `result`, or to any element type if `kernel` is empty,
+/// provided that `scatterIndices` has a native integer element type and
+/// `updateWindowDims` are the trailing dimensions of `updates`.
+bool evalScatterKernel(
+    const KernelOptions &options, std::optional<BinaryKernel> kernel,
+    const Tensor &scatterIndices, const Tensor &updates,
+    const Axes &updateWindowDims, const Axes &insertedWindowDims,
+    const Axes &inputBatchingDims, const Axes &scatterIndicesBatchingDims,
+    const Axes &scatterDimsToOperandDims, Axis indexVectorDim, Tensor &result);
+
+/// Native kernel for `padOp`, applicable to any element type when `operand`
+/// and `paddingValue` have the element type of `result`. Fills `result` with
+/// the padding value and copies the elements of `operand` which aren't cut
+/// off by negative padding as one strided window, reading strided views in
+/// place. Without interior padding, every row of `result` is written once,
+/// as blocks of padding around a run of the window. If `operand` is empty or
+/// a splat of the padding value, `result` is replaced with a splat view
+/// instead, see `makeSplatView`.
+bool evalPadKernel(const KernelOptions &options, const Tensor &operand,
+                   const Tensor &paddingValue, const Sizes &edgePaddingLow,
+                   const Sizes &interiorPadding, Tensor &result);
+
+/// View kernels evaluate data-movement ops in constant time and memory by
+/// returning a strided view of `operand` of type `resultType`, see
+/// `makeStridedView`, instead of copying its elements. Elementwise kernels
+/// like `evalBinaryKernel` read views in place, so that e.g. a broadcast
+/// followed by a multiplication never materializes the broadcast. Views apply
+/// if native kernels are enabled and `operand` has the element type of
+/// `resultType`; otherwise an empty Tensor is returned.
+///
+/// View kernel for `broadcastInDimOp`, which repeats elements with zero
+/// strides.
+Tensor evalBroadcastInDimView(
+    const KernelOptions &options, const Tensor &operand,
+    const Axes &broadcastDimensions, ShapedType resultType);
+
+/// View kernel for `reshapeOp`. Views of contiguous tensors always apply;
+/// strided views whose elements can't be reached with strides in the new
+/// shape, e.g. some reshapes of transposes, are materialized first.
+Tensor evalReshapeView(const KernelOptions &options, const Tensor &operand,
+                       ShapedType resultType);
+
+/// View kernel for `reverseOp`, which negates the strides of `dimensions`.
+Tensor evalReverseView(const KernelOptions &options, const Tensor &operand,
+                       const Axes &dimensions, ShapedType resultType);
+
+/// View kernel for `sliceOp`.
+Tensor evalSliceView(const KernelOptions &options, const Tensor &operand,
+                     const Sizes &startIndices, const Sizes &strides,
+                     ShapedType resultType);
+
+/// View kernel for `transposeOp`, which permutes the strides of `operand`.
+Tensor evalTransposeView(const KernelOptions &options, const Tensor &operand,
+                         const Axes &permutation, ShapedType resultType);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_KERNELS_H
@@ -0,0 +1,188 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/MemoryTracker.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/DebugStringHelper.h"
+#include "stablehlo/reference/EvaluationContext.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Op whose allocations are tracked on this thread, if any.
+thread_local Operation *currentOp = nullptr;
+
+// Number of ops listed in the error of allocations exceeding the limit.
+constexpr size_t kNumReportedOps = 5;
+
+struct Counters {
+  int64_t numBytesAllocated = 0;
+  int64_t numLiveBytes = 0;
+  int64_t peakBytes = 0;
+};
+
+std::string getLabel(Operation *op) {
+  if (!op) return "<no op>";
+  return op->getName().getStringRef().str() + " at " +
+         debugString(op->getLoc());
+}
+
+}  // namespace
+
+struct MemoryTracker::State {
+  explicit State(std::optional<uint64_t> limit) : limit(limit) {}
+
+  // Returns the ops holding the most live bytes, most first.
+  std::vector<std::pair<Operation *, int64_t>> getLiveSet() const {
+    std::vector<std::pair<Operation *, int64_t>> liveSet;
+    for (const auto &[op, counters] : countersByOp)
+      if (counters.numLiveBytes > 0)
+        liveSet.emplace_back(op, counters.numLiveBytes);
+    std::stable_sort(
+        liveSet.begin(), liveSet.end(),
+        [](const auto &a, const auto &b) { return a.second > b.second; });
+    return liveSet;
+  }
+
+  const std::optional<uint64_t> limit;
+
+  /// Guards the members below.
+  std::mutex mutex;
+  int64_t liveBytes = 0;
+  int64_t peakBytes = 0;
+  /// Counters by op, where allocations outside of ops, e.g. of arguments, are
+  /// attributed to nullptr.
+  llvm::DenseMap<Operation *, Counters> countersByOp;
+};
+
+MemoryTracker::MemoryTracker(std::optional<uint64_t> limit)
+    : state_(std::make_shared<State>(limit)) {}
+
+llvm::unique_function<void()> MemoryTracker::track(size_t size) {
+  Operation *op = currentOp;
+  auto bytes = static_cast<int64_t>(size);
+  std::string error;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (state_->limit &&
+        static_cast<uint64_t>(state_->liveBytes + bytes) > *state_->limit) {
+      llvm::raw_string_ostream os(error);
+      os << "Interpreter memory limit of " << *state_->limit
+         << " bytes exceeded by an allocation of " << bytes << " bytes in "
+         << getLabel(op) << ", with " << state_->liveBytes
+         << " bytes live, allocated by:";
+      auto liveSet = state_->getLiveSet();
+      for (const auto &[liveOp, liveBytes] :
+           llvm::ArrayRef(liveSet).take_front(kNumReportedOps))
+        os << "\n  " << liveBytes << " bytes: " << getLabel(liveOp);
+      if (liveSet.size() > kNumReportedOps)
+        os << "\n  ... and " << liveSet.size() - kNumReportedOps
+           << " more ops";
+    } else {
+      state_->liveBytes += bytes;
+      state_->peakBytes = std::max(state_->peakBytes, state_->liveBytes);
+      auto &counters = state_->countersByOp[op];
+      counters.numBytesAllocated += bytes;
+      counters.numLiveBytes += bytes;
+      counters.peakBytes = std::max(counters.peakBytes, state_->liveBytes);
+    }
+  }
+  // Reported without holding the lock, since exiting may release tensors.
+  if (!error.empty())
+    llvm::report_fatal_error(llvm::Twine(error), /*gen_crash_diag=*/false);
+
+  return [state = state_, op, bytes]() {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->liveBytes -= bytes;
+    state->countersByOp[op].numLiveBytes -= bytes;
+  };
+}
+
+int64_t MemoryTracker::getLiveBytes() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->liveBytes;
+}
+
+int64_t MemoryTracker::getPeakBytes() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->peakBytes;
+}
+
+std::vector<MemoryTracker::OpStatistics> MemoryTracker::getOpStatistics()
+    const {
+  std::vector<OpStatistics> statistics;
+  {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    for (const auto &[op, counters] : state_->countersByOp)
+      if (op)
+        statistics.push_back(OpStatistics{
+            op->getName(), op->getLoc(), counters.numBytesAllocated,
+            counters.numLiveBytes, counters.peakBytes});
+  }
+  std::stable_sort(statistics.begin(), statistics.end(),
+                   [](const OpStatistics &a, const OpStatistics &b) {
+                     return a.peakBytes > b.peakBytes;
+                   });
+  return statistics;
+}
+
+void MemoryTracker::print(raw_ostream &os) const {
+  os << "===" << std::string(76, '-') << "===\n";
+  os << "  Interpreter memory by op\n";
+  os << "===" << std::string(76, '-') << "===\n";
+  os << "Live bytes: " << getLiveBytes() << "\n";
+  os << "Peak bytes: " << getPeakBytes() << "\n";
+  os << llvm::format("%14s %14s %14s  %s\n", "Peak", "Allocated", "Live",
+                     "Name");
+  for (const auto &row : getOpStatistics())
+    os << llvm::format("%14lld %14lld %14lld  ", (long long)row.peakBytes,
+                       (long long)row.numBytesAllocated,
+                       (long long)row.numLiveBytes)
+       << row.name.getStringRef() << " at " << debugString(row.location)
+       << "\n";
+  os << "\n";
+}
+
+MemoryTracker *getMemoryTracker() {
+  return getEvaluationContext().memoryTracker;
+}
+
+ScopedOpMemory::ScopedOpMemory(Operation &op) : parent_(currentOp) {
+  currentOp = &op;
+}
+
+ScopedOpMemory::~ScopedOpMemory() { currentOp = parent_; }
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,104 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_MEMORYTRACKER_H
+#define STABLEHLO_REFERENCE_MEMORYTRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OperationSupport.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Accounts for the storage of interpreter tensors while it is set in the
+/// `EvaluationContext`: the number of bytes allocated through `BufferPool`
+/// which are live and their peak, as well as the bytes allocated by every op
+/// which `eval` evaluates. If a limit is set, an allocation which would
+/// exceed it reports a fatal error which names the op making it and the ops
+/// whose results hold the most live bytes, rather than letting the process
+/// run out of memory. The tracker is thread-safe.
+class MemoryTracker {
+ public:
+  /// Memory statistics of the evaluations of an op.
+  struct OpStatistics {
+    OperationName name;
+    Location location;
+    int64_t numBytesAllocated = 0;
+    /// Bytes allocated by the op which are still live, e.g. its results.
+    int64_t numLiveBytes = 0;
+    /// Maximum number of live bytes right after an allocation by the op.
+    int64_t peakBytes = 0;
+  };
+
+  /// Fails allocations which would make more than `limit` bytes live, if set.
+  explicit MemoryTracker(std::optional<uint64_t> limit = std::nullopt);
+
+  /// Records an allocation of `size` bytes by the op which is evaluated on
+  /// the calling thread, see `ScopedOpMemory`, and returns a function which
+  /// records its deallocation. The function may outlive the tracker. Reports
+  /// a fatal error if the allocation exceeds the limit.
+  llvm::unique_function<void()> track(size_t size);
+
+  /// Returns the number of bytes which are live.
+  int64_t getLiveBytes() const;
+
+  /// Returns the maximum number of bytes which have been live at once.
+  int64_t getPeakBytes() const;
+
+  /// Returns the statistics of the ops which allocated memory, sorted by
+  /// descending peak. The ops must still exist.
+  std::vector<OpStatistics> getOpStatistics() const;
+
+  /// Prints the live and peak bytes, followed by a table of the statistics
+  /// of the ops, e.g. for memory regression tests.
+  void print(raw_ostream &os) const;
+
+ private:
+  struct State;
+  std::shared_ptr<State> state_;
+};
+
+/// Returns the tracker with which `BufferPool` accounts for its allocations
+/// according to the current `EvaluationContext`, or nullptr if there is none.
+MemoryTracker *getMemoryTracker();
+
+/// Attributes the allocations made on the calling thread from construction to
+/// destruction to `op`, unless ops nested in its regions are evaluated in the
+/// meantime.
+class ScopedOpMemory {
+ public:
+  explicit ScopedOpMemory(Operation &op);
+  ~ScopedOpMemory();
+
+  ScopedOpMemory(const ScopedOpMemory &) = delete;
+  ScopedOpMemory &operator=(const ScopedOpMemory &) = delete;
+
+ private:
+  Operation *parent_;
+};
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_MEMORYTRACKER_H
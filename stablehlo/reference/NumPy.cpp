@@ -15,16 +15,26 @@ limitations under the License.
 
 #include "stablehlo/reference/NumPy.h"
 
+#include <algorithm>
 #include <cctype>
-#include <fstream>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <numeric>
 #include <regex>
+#include <sstream>
+#include <vector>
 
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/AsmState.h"
 #include "mlir/IR/BuiltinTypeInterfaces.h"
+#include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Types.h"
 
 namespace mlir {
@@ -36,6 +46,7 @@ constexpr char kMagicString[] = "\x93NUMPY";
 constexpr int kMagicStringSize = 6;
 constexpr char kMajorVersion = 0x01;
 constexpr char kMinorVersion = 0x00;
+constexpr uint64_t kDataAlignment = 64;
 
 template <typename T>
 struct IsComplexT : public std::false_type {};
@@ -65,7 +76,7 @@ static constexpr char getNumPyType() {
 // `parseDescrHeader` for additional information on how the `descr` key is
 // structured.
 template <typename T>
-static void buildNumpyHeaderDict(llvm::raw_fd_ostream& out,
+static void buildNumpyHeaderDict(llvm::raw_ostream& out,
                                  ArrayRef<int64_t> shape) {
   // For now, only little endian machines are supported.
   const auto descr = std::string(1, /*endianness=*/'<') +
@@ -83,11 +94,14 @@ static void buildNumpyHeaderDict(llvm::raw_fd_ostream& out,
   outDict << "'fortran_order': False, ";
   outDict << "'shape' : (" << shapeString << "), }";
 
-  // The NumPy header is padded with spaces for proper alignment.
-  // Account for newline and the magic string length.
-  const auto headerSize = static_cast<int>(out.tell());
-  const auto padding = 16 - (headerSize + 1) % 16;
-  outDict << std::string(padding - 1, ' ') << '\n';
+  // The NumPy header is padded with spaces, so that the data which follows it
+  // is aligned to 64 bytes from the beginning of `out`, and ends in a newline.
+  // Account for the magic string, the version, the header length and the
+  // newline.
+  const auto headerSize = out.tell() + 2 + outDict.str().size() + 1;
+  const auto padding = (kDataAlignment - headerSize % kDataAlignment) %
+                       kDataAlignment;
+  outDict << std::string(padding, ' ') << '\n';
 
   const auto dictLength = static_cast<uint16_t>(outDict.str().size());
   out << (char)(dictLength & 0xff) << (char)((dictLength >> 8) & 0xff)
@@ -95,7 +109,7 @@ static void buildNumpyHeaderDict(llvm::raw_fd_ostream& out,
 }
 
 template <typename T>
-static void buildNumpyHeader(llvm::raw_fd_ostream& out,
+static void buildNumpyHeader(llvm::raw_ostream& out,
                              ArrayRef<int64_t> shape) {
   out.write(kMagicString, kMagicStringSize);
   out.write(kMajorVersion);
@@ -103,6 +117,24 @@ static void buildNumpyHeader(llvm::raw_fd_ostream& out,
   buildNumpyHeaderDict<T>(out, shape);
 }
 
+// Parsed header of a NumPy file, see `readNumpyHeader`.
+struct NumpyHeader {
+  // Byte order of the data: '<' for little endian, '>' for big endian or '|'
+  // if not applicable, i.e. for single bytes.
+  char byteOrder = '<';
+
+  // Kind of the data type, see `getNumPyType`.
+  char kind = 0;
+
+  // Size of the data type in bytes.
+  size_t wordSize = 0;
+
+  SmallVector<int64_t> shape;
+
+  // Offset of the data from the beginning of the file, in bytes.
+  size_t dataOffset = 0;
+};
+
 static llvm::Error parseFortranOrderKey(const std::string& header) {
   const std::size_t fortranOrderOffset = header.find("'fortran_order':");
   if (fortranOrderOffset == std::string::npos)
@@ -119,45 +151,51 @@ static llvm::Error parseFortranOrderKey(const std::string& header) {
 // Parses the NumPy `descr` header, which is in the following format:
 // 'descr': '<i4'
 // Where the first character determines the endianness of the data (< for little
-// endian, > for big endian), the next character determines the data type (i.e.
-// unsigned int, float, bool, etc) and the last number(s) determine the data
-// type size (8, 16, 32, etc). For now, we only support little endian values.
-// Returns the size of the underlying type in bytes (i.e. for '<i4', this will
-// return 4).
-template <typename T>
-static llvm::ErrorOr<int> parseDescrHeader(const std::string& header) {
+// endian, > for big endian, | if not applicable), the next character
+// determines the data type (i.e. unsigned int, float, bool, etc) and the last
+// number(s) determine the data type size in bytes (i.e. for '<i4', this is 4).
+static llvm::Error parseDescrHeader(const std::string& header,
+                                    NumpyHeader& result) {
   constexpr char kDescr[] = "'descr':";
   constexpr int kDescrSize = 8;
 
   const std::size_t descrOffset = header.find(kDescr);
-  if (descrOffset == std::string::npos) return llvm::errc::invalid_argument;
+  if (descrOffset == std::string::npos)
+    return llvm::createStringError(llvm::errc::invalid_argument,
+                                   "Failed to find descr header.");
 
   const std::size_t needleSize = header.find(',', descrOffset + kDescrSize + 1);
   std::string typeString = header.substr(
       descrOffset + kDescrSize, needleSize - (descrOffset + kDescrSize));
 
-  if (typeString.front() != '\'' || typeString.back() != '\'')
-    return llvm::errc::invalid_argument;
+  if (typeString.size() < 5 || typeString.front() != '\'' ||
+      typeString.back() != '\'')
+    return llvm::createStringError(llvm::errc::invalid_argument,
+                                   "Invalid descr header.");
 
   // Strip quotes from type string (i.e. '<i8' to <i8).
   typeString = typeString.substr(1, typeString.size() - 2);
 
-  if (typeString.size() < 3) return llvm::errc::invalid_argument;
-
-  // Check that the serialized type string matches the expected type string.
-  if (getNumPyType<T>() != typeString[1]) return llvm::errc::invalid_argument;
+  if (!StringRef("<>|").contains(typeString[0]) ||
+      StringRef(typeString).drop_front(2).getAsInteger(10, result.wordSize))
+    return llvm::createStringError(llvm::errc::invalid_argument,
+                                   "Unsupported descr: %s.",
+                                   typeString.c_str());
 
-  return std::stoi(typeString.substr(2));
+  result.byteOrder = typeString[0];
+  result.kind = typeString[1];
+  return llvm::Error::success();
 }
 
-// Parses the `shape` key of the NumPy file format dictionary. Returns a vector
-// representing the parsed shape or errors otherwise.
-static llvm::ErrorOr<ArrayRef<int64_t>> parseShapeHeader(
-    const std::string& header) {
+// Parses the `shape` key of the NumPy file format dictionary, e.g. (3, 1,),
+// which is empty for 0-dimensional arrays.
+static llvm::Error parseShapeHeader(const std::string& header,
+                                    NumpyHeader& result) {
   const std::size_t shapeOffset = header.find("'shape':");
   const std::size_t dimEnd = header.find(')', shapeOffset);
   if (shapeOffset == std::string::npos || dimEnd == std::string::npos)
-    return llvm::errc::invalid_argument;
+    return llvm::createStringError(llvm::errc::invalid_argument,
+                                   "Failed to find shape header.");
 
   // By convention, NumPy writers should include the shape key last (preserving
   // alphabetical ordering relative to other header keys), however we cannot
@@ -165,74 +203,192 @@ static llvm::ErrorOr<ArrayRef<int64_t>> parseShapeHeader(
   // regex matching for dimension integrals.
   std::regex dimRegex("[0-9]+");
   std::smatch dimMatch;
-  std::string shapeString = header.substr(shapeOffset, shapeOffset - dimEnd);
-  std::vector<int64_t> shape(4);
+  std::string shapeString = header.substr(shapeOffset, dimEnd - shapeOffset);
 
   while (std::regex_search(shapeString, dimMatch, dimRegex)) {
-    shape.push_back(std::stoi(dimMatch[0]));
+    result.shape.push_back(std::stoll(dimMatch[0]));
     shapeString = dimMatch.suffix();
   }
 
-  return shape;
+  return llvm::Error::success();
 }
 
-template <typename T>
-static llvm::Error readNumpyHeader(std::ifstream& in, size_t& wordSize,
-                                   ArrayRef<int64_t> shape) {
-  char magicString[kMagicStringSize];
-  if (!in.read(magicString, kMagicStringSize))
-    return llvm::createStringError(llvm::errc::io_error,
-                                   "Failed to read NumPy magic string.");
-
-  if (strncmp(magicString, kMagicString, kMagicStringSize))
+// Parses the header at the beginning of `contents`, the contents of a NumPy
+// file of format version 1.0, 2.0 or 3.0, which only differ in the size of the
+// header length and the encoding of the header.
+static llvm::Expected<NumpyHeader> readNumpyHeader(StringRef contents) {
+  if (!contents.starts_with(StringRef(kMagicString, kMagicStringSize)))
     return llvm::createStringError(llvm::errc::invalid_argument,
                                    "Invalid NumPy file format detected.");
 
-  // Currently, only supports NumPy v1.0 format
-  char majorVersion, minorVersion;
-  in.read(&majorVersion, 1);
-  in.read(&minorVersion, 1);
+  constexpr size_t kPrefixSize = kMagicStringSize + 2;
+  if (contents.size() < kPrefixSize + 2)
+    return llvm::createStringError(llvm::errc::io_error,
+                                   "Failed to read NumPy header size.");
 
-  if (majorVersion != kMajorVersion || minorVersion != kMinorVersion)
+  char majorVersion = contents[kMagicStringSize];
+  char minorVersion = contents[kMagicStringSize + 1];
+  if (majorVersion < 1 || majorVersion > 3 || minorVersion != 0)
     return llvm::createStringError(
         llvm::errc::invalid_argument,
-        "Invalid NumPy version: %c.%c. Expected version to be %c.%c.",
-        majorVersion, minorVersion, kMajorVersion, kMinorVersion);
-
-  char headerSizeBuffer[2];
-  if (!in.read(headerSizeBuffer, 2))
-    return llvm::createStringError(llvm::errc::io_error,
-                                   "Failed to read NumPy header size.");
+        "Invalid NumPy version: %d.%d. Expected version to be 1.0, 2.0 or 3.0.",
+        majorVersion, minorVersion);
+
+  size_t headerSize, headerOffset;
+  if (majorVersion == 1) {
+    headerSize = llvm::support::endian::read16le(contents.data() + kPrefixSize);
+    headerOffset = kPrefixSize + 2;
+  } else {
+    if (contents.size() < kPrefixSize + 4)
+      return llvm::createStringError(llvm::errc::io_error,
+                                     "Failed to read NumPy header size.");
+    headerSize = llvm::support::endian::read32le(contents.data() + kPrefixSize);
+    headerOffset = kPrefixSize + 4;
+  }
 
-  const int headerSize = (headerSizeBuffer[0]) | (headerSizeBuffer[1] << 8);
-  std::string header(headerSize, '\0');
-  if (!in.read(header.data(), headerSize) || header.back() != '\n')
+  if (contents.size() < headerOffset + headerSize || headerSize == 0 ||
+      contents[headerOffset + headerSize - 1] != '\n')
     return llvm::createStringError(llvm::errc::invalid_argument,
                                    "Invalid NumPy header.");
 
+  std::string header = contents.substr(headerOffset, headerSize).str();
   header.erase(std::remove_if(header.begin(), header.end(),
                               [](char c) { return std::isspace(c); }),
                header.end());
 
-  auto wordSizeOrError = parseDescrHeader<T>(header);
-  if (!wordSizeOrError)
-    return llvm::createStringError(llvm::errc::invalid_argument,
-                                   "Failed to parse descr header.");
+  NumpyHeader result;
+  result.dataOffset = headerOffset + headerSize;
+  if (auto err = parseDescrHeader(header, result)) return std::move(err);
+  if (auto err = parseFortranOrderKey(header)) return std::move(err);
+  if (auto err = parseShapeHeader(header, result)) return std::move(err);
+  return result;
+}
 
-  auto fortranOrderKeyOrError = parseFortranOrderKey(header);
-  if (fortranOrderKeyOrError)
-    return llvm::createStringError(llvm::errc::invalid_argument,
-                                   "Failed to parse fortran_order header.");
+// Returns the NumPy type abbreviation under which NumPy itself serializes
+// `elementType`, e.g. 'b' for i1 and 'c' for complex types, see
+// `getNumPyType`.
+static char getNativeNumPyType(Type elementType) {
+  if (elementType.isInteger(1)) return 'b';
+  if (elementType.isUnsignedInteger()) return 'u';
+  if (isa<IntegerType>(elementType)) return 'i';
+  if (isa<FloatType>(elementType)) return 'f';
+  if (isa<ComplexType>(elementType)) return 'c';
+  return 0;
+}
 
-  auto shapeOrError = parseShapeHeader(header);
-  if (!shapeOrError)
+// Returns the contents of the array `name` of the NumPy archive `archive`, as
+// written by `numpy.savez`, i.e. a ZIP file of NumPy files named `name.npy`.
+// The array must be stored uncompressed, so that it can be read in place.
+static llvm::Expected<StringRef> readArchiveMember(StringRef archive,
+                                                   StringRef name) {
+  using llvm::support::endian::read16le;
+  using llvm::support::endian::read32le;
+  using llvm::support::endian::read64le;
+  auto invalidArchive = [] {
     return llvm::createStringError(llvm::errc::invalid_argument,
-                                   "Failed to parse shape header.");
+                                   "Invalid NumPy archive.");
+  };
+
+  // The end of central directory record is at the end of the archive,
+  // followed by a comment of up to 64 KiB.
+  constexpr size_t kEndRecordSize = 22;
+  constexpr uint32_t kEndRecordSignature = 0x06054b50;
+  if (archive.size() < kEndRecordSize) return invalidArchive();
+  size_t endRecordOffset = archive.size() - kEndRecordSize;
+  size_t minEndRecordOffset =
+      endRecordOffset > 0xffff ? endRecordOffset - 0xffff : 0;
+  while (read32le(archive.data() + endRecordOffset) != kEndRecordSignature) {
+    if (endRecordOffset == minEndRecordOffset) return invalidArchive();
+    --endRecordOffset;
+  }
 
-  shape = *shapeOrError;
-  wordSize = *wordSizeOrError;
+  const char* endRecord = archive.data() + endRecordOffset;
+  uint64_t numEntries = read16le(endRecord + 10);
+  uint64_t directoryOffset = read32le(endRecord + 16);
+
+  // ZIP64 archives, which NumPy writes for large arrays, store these in a
+  // ZIP64 end of central directory record, which a locator right before the
+  // end of central directory record points to.
+  constexpr size_t kLocatorSize = 20;
+  constexpr uint32_t kLocatorSignature = 0x07064b50;
+  constexpr uint32_t kZip64EndRecordSignature = 0x06064b50;
+  if ((numEntries == 0xffff || directoryOffset == 0xffffffff) &&
+      endRecordOffset >= kLocatorSize &&
+      read32le(endRecord - kLocatorSize) == kLocatorSignature) {
+    uint64_t zip64EndRecordOffset = read64le(endRecord - kLocatorSize + 8);
+    if (zip64EndRecordOffset + 56 > archive.size() ||
+        read32le(archive.data() + zip64EndRecordOffset) !=
+            kZip64EndRecordSignature)
+      return invalidArchive();
+    const char* zip64EndRecord = archive.data() + zip64EndRecordOffset;
+    numEntries = read64le(zip64EndRecord + 32);
+    directoryOffset = read64le(zip64EndRecord + 48);
+  }
 
-  return llvm::Error::success();
+  constexpr size_t kEntrySize = 46;
+  constexpr uint32_t kEntrySignature = 0x02014b50;
+  std::string memberName = (name + ".npy").str();
+  uint64_t entryOffset = directoryOffset;
+  for (uint64_t i = 0; i < numEntries; ++i) {
+    if (entryOffset + kEntrySize > archive.size() ||
+        read32le(archive.data() + entryOffset) != kEntrySignature)
+      return invalidArchive();
+    const char* entry = archive.data() + entryOffset;
+    uint16_t compressionMethod = read16le(entry + 10);
+    uint64_t compressedSize = read32le(entry + 20);
+    uint64_t uncompressedSize = read32le(entry + 24);
+    uint16_t nameSize = read16le(entry + 28);
+    uint16_t extraSize = read16le(entry + 30);
+    uint16_t commentSize = read16le(entry + 32);
+    uint64_t localHeaderOffset = read32le(entry + 42);
+    if (entryOffset + kEntrySize + nameSize + extraSize > archive.size())
+      return invalidArchive();
+    StringRef entryName(entry + kEntrySize, nameSize);
+    entryOffset += kEntrySize + nameSize + extraSize + commentSize;
+    if (entryName != memberName) continue;
+
+    if (compressionMethod != 0)
+      return llvm::createStringError(
+          llvm::errc::not_supported,
+          "Compressed NumPy archives are not supported: %s.",
+          memberName.c_str());
+
+    // Sizes and offsets which don't fit into 32 bits are stored in the ZIP64
+    // extended information extra field, in this order.
+    StringRef extra(entry + kEntrySize + nameSize, extraSize);
+    while (extra.size() >= 4) {
+      uint16_t fieldId = read16le(extra.data());
+      uint16_t fieldSize = read16le(extra.data() + 2);
+      StringRef field = extra.drop_front(4).take_front(fieldSize);
+      extra = extra.drop_front(4 + fieldSize);
+      if (fieldId != 0x0001) continue;
+      for (uint64_t* value :
+           {&uncompressedSize, &compressedSize, &localHeaderOffset}) {
+        if (*value != 0xffffffff) continue;
+        if (field.size() < 8) return invalidArchive();
+        *value = read64le(field.data());
+        field = field.drop_front(8);
+      }
+    }
+
+    constexpr size_t kLocalHeaderSize = 30;
+    constexpr uint32_t kLocalHeaderSignature = 0x04034b50;
+    if (localHeaderOffset + kLocalHeaderSize > archive.size() ||
+        read32le(archive.data() + localHeaderOffset) != kLocalHeaderSignature)
+      return invalidArchive();
+    const char* localHeader = archive.data() + localHeaderOffset;
+    uint64_t dataOffset = localHeaderOffset + kLocalHeaderSize +
+                          read16le(localHeader + 26) +
+                          read16le(localHeader + 28);
+    if (compressedSize != uncompressedSize ||
+        dataOffset + compressedSize > archive.size())
+      return invalidArchive();
+    return archive.substr(dataOffset, compressedSize);
+  }
+
+  return llvm::createStringError(llvm::errc::no_such_file_or_directory,
+                                 "Failed to find %s in NumPy archive.",
+                                 memberName.c_str());
 }
 
 namespace {
@@ -248,7 +404,11 @@ class ToNumpy {
                                      "Failed to open NumPy file.");
 
     llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+    return (*this)(out, type, data);
+  }
 
+  llvm::Error operator()(llvm::raw_ostream& out, ShapedType type,
+                         const char* data) {
     buildNumpyHeader<T>(out, type.getShape());
     out.write(data, sizeof(T) * type.getNumElements());
 
@@ -259,25 +419,106 @@ class ToNumpy {
 template <typename T>
 class FromNumpy {
  public:
-  llvm::ErrorOr<Tensor> operator()(StringRef filename, ShapedType type) {
-    std::ifstream in(filename.str(), std::ifstream::binary);
-    size_t wordSize = 0;
-
-    if (readNumpyHeader<T>(in, wordSize, type.getShape()))
+  // Reads a tensor of type `type` from `contents`, the contents of a NumPy
+  // file inside of `file`. If possible, the tensor reads its elements from
+  // `file` in place and keeps it alive, so that memory-mapped files are
+  // loaded in constant time and share pages with other readers of the file.
+  llvm::ErrorOr<Tensor> operator()(std::shared_ptr<llvm::MemoryBuffer> file,
+                                   StringRef contents, ShapedType type) {
+    auto header = readNumpyHeader(contents);
+    if (!header) {
+      llvm::consumeError(header.takeError());
       return llvm::errc::invalid_argument;
+    }
 
-    const int64_t numLoadedElements = std::accumulate(
-        type.getShape().begin(), type.getShape().end(), 1, std::multiplies<>());
-
-    if (numLoadedElements != type.getNumElements() || wordSize != sizeof(T))
+    char kind = header->kind;
+    if (header->wordSize != sizeof(T) ||
+        ArrayRef<int64_t>(header->shape) != type.getShape() ||
+        (kind != getNumPyType<T>() &&
+         kind != getNativeNumPyType(type.getElementType())))
       return llvm::errc::invalid_argument;
 
-    const size_t dataBytesToRead = wordSize * numLoadedElements;
-    std::vector<T> data(dataBytesToRead);
-    in.read(reinterpret_cast<char*>(data.data()), dataBytesToRead);
+    const size_t dataBytesToRead = sizeof(T) * type.getNumElements();
+    if (contents.size() - header->dataOffset < dataBytesToRead)
+      return llvm::errc::invalid_argument;
+    ArrayRef<char> data(contents.data() + header->dataOffset,
+                        dataBytesToRead);
+
+    // Big endian data is copied and byte-swapped, one component of complex
+    // numbers at a time.
+    if (header->byteOrder == '>' && sizeof(T) > 1) {
+      auto blob = HeapAsmResourceBlob::allocateAndCopyWithAlign(
+          data, alignof(T), /*dataIsMutable=*/true);
+      size_t componentSize = kind == 'c' ? sizeof(T) / 2 : sizeof(T);
+      auto bytes = blob.getMutableData();
+      for (size_t i = 0; i < bytes.size(); i += componentSize)
+        std::reverse(bytes.begin() + i, bytes.begin() + i + componentSize);
+      return Tensor(type, std::move(blob));
+    }
+
+    if (reinterpret_cast<uintptr_t>(data.data()) % alignof(T) != 0)
+      return Tensor(type, HeapAsmResourceBlob::allocateAndCopyWithAlign(
+                              data, alignof(T)));
+
+    // The data is read-only, so that ops which update tensors in place copy
+    // it first.
+    return Tensor(type, AsmResourceBlob(
+                            data, alignof(T),
+                            [file = std::move(file)](void*, size_t, size_t) {},
+                            /*dataIsMutable=*/false));
+  }
+};
 
-    return Tensor(type,
-                  HeapAsmResourceBlob::allocateAndCopyInferAlign<T>(data));
+template <typename T>
+class ChunksFromNumpy {
+ public:
+  // Reads the data of a tensor of type `type` from the NumPy file `file` in
+  // chunks of at most `chunkSize` bytes, rounded down to whole elements, and
+  // calls `fn` with every chunk in turn. `header` is the beginning of the
+  // file, which holds its header.
+  llvm::Error operator()(llvm::sys::fs::file_t file, StringRef header,
+                         ShapedType type, int64_t chunkSize,
+                         llvm::function_ref<void(ArrayRef<char>)> fn) {
+    auto parsedHeader = readNumpyHeader(header);
+    if (!parsedHeader) return parsedHeader.takeError();
+
+    char kind = parsedHeader->kind;
+    if (parsedHeader->wordSize != sizeof(T) ||
+        ArrayRef<int64_t>(parsedHeader->shape) != type.getShape() ||
+        (kind != getNumPyType<T>() &&
+         kind != getNativeNumPyType(type.getElementType())))
+      return llvm::createStringError(llvm::errc::invalid_argument,
+                                     "NumPy file doesn't match type.");
+
+    uint64_t offset = parsedHeader->dataOffset;
+    uint64_t remaining = sizeof(T) * type.getNumElements();
+    std::vector<char> chunk(
+        std::max<uint64_t>(chunkSize / sizeof(T), 1) * sizeof(T));
+    while (remaining != 0) {
+      MutableArrayRef<char> data(chunk.data(),
+                                 std::min<uint64_t>(chunk.size(), remaining));
+      for (size_t read = 0; read < data.size();) {
+        auto size = llvm::sys::fs::readNativeFileSlice(
+            file, data.drop_front(read), offset + read);
+        if (!size) return size.takeError();
+        if (*size == 0)
+          return llvm::createStringError(llvm::errc::io_error,
+                                         "Unexpected end of NumPy file.");
+        read += *size;
+      }
+
+      // Big endian data is byte-swapped, one component of complex numbers at
+      // a time.
+      if (parsedHeader->byteOrder == '>' && sizeof(T) > 1) {
+        size_t componentSize = kind == 'c' ? sizeof(T) / 2 : sizeof(T);
+        for (size_t i = 0; i < data.size(); i += componentSize)
+          std::reverse(data.begin() + i, data.begin() + i + componentSize);
+      }
+      fn(data);
+      offset += data.size();
+      remaining -= data.size();
+    }
+    return llvm::Error::success();
   }
 };
 
@@ -328,7 +569,74 @@ llvm::ErrorOr<Tensor> deserializeTensor(StringRef filename, ShapedType type) {
   if (llvm::endianness::native == llvm::endianness::big)
     llvm::report_fatal_error("Only little endian supported.");
 
-  return dispatchType<FromNumpy>(type.getElementType(), filename, type);
+  auto file = llvm::MemoryBuffer::getFile(filename, /*IsText=*/false,
+                                          /*RequiresNullTerminator=*/false);
+  if (!file) return file.getError();
+  std::shared_ptr<llvm::MemoryBuffer> buffer = std::move(*file);
+  StringRef contents = buffer->getBuffer();
+  return dispatchType<FromNumpy>(type.getElementType(), std::move(buffer),
+                                 contents, type);
+}
+
+llvm::ErrorOr<Tensor> deserializeTensorFromContainer(StringRef filename,
+                                                     uint64_t offset,
+                                                     ShapedType type) {
+  if (llvm::endianness::native == llvm::endianness::big)
+    llvm::report_fatal_error("Only little endian supported.");
+
+  auto file = llvm::MemoryBuffer::getFile(filename, /*IsText=*/false,
+                                          /*RequiresNullTerminator=*/false);
+  if (!file) return file.getError();
+  std::shared_ptr<llvm::MemoryBuffer> buffer = std::move(*file);
+  if (offset > buffer->getBufferSize()) return llvm::errc::invalid_argument;
+  StringRef contents = buffer->getBuffer().drop_front(offset);
+  return dispatchType<FromNumpy>(type.getElementType(), std::move(buffer),
+                                 contents, type);
+}
+
+llvm::ErrorOr<Tensor> deserializeTensorFromArchive(StringRef filename,
+                                                   StringRef name,
+                                                   ShapedType type) {
+  if (llvm::endianness::native == llvm::endianness::big)
+    llvm::report_fatal_error("Only little endian supported.");
+
+  auto file = llvm::MemoryBuffer::getFile(filename, /*IsText=*/false,
+                                          /*RequiresNullTerminator=*/false);
+  if (!file) return file.getError();
+  std::shared_ptr<llvm::MemoryBuffer> buffer = std::move(*file);
+  auto contents = readArchiveMember(buffer->getBuffer(), name);
+  if (!contents) return llvm::errorToErrorCode(contents.takeError());
+  return dispatchType<FromNumpy>(type.getElementType(), std::move(buffer),
+                                 *contents, type);
+}
+
+llvm::Error readTensorChunks(StringRef filename, ShapedType type,
+                             int64_t chunkSize,
+                             llvm::function_ref<void(ArrayRef<char>)> fn) {
+  if (llvm::endianness::native == llvm::endianness::big)
+    llvm::report_fatal_error("Only little endian supported.");
+
+  auto file = llvm::sys::fs::openNativeFileForRead(filename);
+  if (!file) return file.takeError();
+  auto closeFile =
+      llvm::make_scope_exit([&] { llvm::sys::fs::closeFile(*file); });
+
+  // NumPy headers are much smaller than `kMaxHeaderSize` in practice, so
+  // reading that much of the file is enough to parse them.
+  constexpr size_t kMaxHeaderSize = 1 << 20;
+  std::vector<char> header(kMaxHeaderSize);
+  size_t headerSize = 0;
+  while (headerSize < header.size()) {
+    auto size = llvm::sys::fs::readNativeFileSlice(
+        *file, MutableArrayRef<char>(header).drop_front(headerSize),
+        headerSize);
+    if (!size) return size.takeError();
+    if (*size == 0) break;
+    headerSize += *size;
+  }
+  return dispatchType<ChunksFromNumpy>(
+      type.getElementType(), *file, StringRef(header.data(), headerSize),
+      type, chunkSize, fn);
 }
 
 llvm::Error serializeTensor(StringRef filename, ShapedType type,
@@ -339,6 +647,14 @@ llvm::Error serializeTensor(StringRef filename, ShapedType type,
   return dispatchType<ToNumpy>(type.getElementType(), filename, type, data);
 }
 
+llvm::Error serializeTensor(llvm::raw_ostream& out, ShapedType type,
+                            const char* data) {
+  if (llvm::endianness::native == llvm::endianness::big)
+    llvm::report_fatal_error("Only little endian supported.");
+
+  return dispatchType<ToNumpy>(type.getElementType(), out, type, data);
+}
+
 }  // namespace numpy
 }  // namespace stablehlo
 }  // namespace mlir
@@ -16,7 +16,12 @@ limitations under the License.
 #ifndef STABLEHLO_REFERENCE_NUMPY_H
 #define STABLEHLO_REFERENCE_NUMPY_H
 
+#include <cstdint>
+
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/raw_ostream.h"
 #include "mlir/IR/BuiltinTypeInterfaces.h"
 #include "stablehlo/reference/Tensor.h"
 
@@ -28,15 +33,52 @@ namespace numpy {
 // serialized NumPy files.
 constexpr char kInstrumentationMetadataFilename[] = "index.csv";
 
+// Filename to use for the container file which serialized NumPy files are
+// appended to instead of being stored in files of their own, see
+// `ProbeWriter`.
+constexpr char kProbeContainerFilename[] = "probes.bin";
+
 // Read a NumPy serialized tensor from disk stored at `filename` with the given
-// `type`.
+// `type`. Large files are memory-mapped, and unless the data is big endian or
+// misaligned, the tensor reads its elements from the read-only mapping instead
+// of copying them, so that it loads in constant time and shares pages with
+// other processes which read the same file.
 llvm::ErrorOr<Tensor> deserializeTensor(StringRef filename, ShapedType type);
 
+// Read the array `name` with the given `type` from a NumPy archive stored at
+// `filename`, as written by `numpy.savez`, like `deserializeTensor`. Only
+// arrays which are stored uncompressed are supported.
+llvm::ErrorOr<Tensor> deserializeTensorFromArchive(StringRef filename,
+                                                   StringRef name,
+                                                   ShapedType type);
+
+// Read a NumPy serialized tensor with the given `type` which starts `offset`
+// bytes into the file `filename`, e.g. a probe container, like
+// `deserializeTensor`.
+llvm::ErrorOr<Tensor> deserializeTensorFromContainer(StringRef filename,
+                                                     uint64_t offset,
+                                                     ShapedType type);
+
+// Read a NumPy serialized tensor with the given `type` from disk stored at
+// `filename` in chunks of at most `chunkSize` bytes, rounded down to whole
+// elements, rather than at once, and call `fn` with every chunk in turn. The
+// chunks hold consecutive elements in canonical order, and only one of them
+// is in memory at a time, so that tensors larger than memory can be consumed,
+// e.g. by `StreamingReduction`.
+llvm::Error readTensorChunks(StringRef filename, ShapedType type,
+                             int64_t chunkSize,
+                             llvm::function_ref<void(ArrayRef<char>)> fn);
+
 // Store a tensor using the NumPy file format with the given `type` to the given
 // `filename`.
 llvm::Error serializeTensor(StringRef filename, ShapedType type,
                             const char* data);
 
+// Append a tensor using the NumPy file format with the given `type` to `out`,
+// such that its data is aligned to 64 bytes from the beginning of `out`.
+llvm::Error serializeTensor(llvm::raw_ostream& out, ShapedType type,
+                            const char* data);
+
 }  // namespace numpy
 }  // namespace stablehlo
 }  // namespace mlir
@@ -0,0 +1,161 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/NumericsChecker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Operation.h"
+#include "stablehlo/reference/Element.h"
+#include "stablehlo/reference/EvaluationContext.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Types.h"
+#include "stablehlo/reference/Value.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Returns whether any of `elements` has all bits of `exponentMask` set, i.e.
+// is NaN or infinite. This has no branches, so that compilers vectorize it.
+template <typename Bits>
+bool anyExponentSaturated(ArrayRef<Bits> elements, Bits exponentMask) {
+  Bits any = 0;
+  for (Bits element : elements)
+    any |= static_cast<Bits>((element & exponentMask) == exponentMask);
+  return any != 0;
+}
+
+bool isNonFinite(const Element &element) {
+  if (isSupportedComplexType(element.getType())) {
+    auto value = element.getComplexValue();
+    return !value.real().isFinite() || !value.imag().isFinite();
+  }
+  return !element.getFloatValue().isFinite();
+}
+
+double toDouble(APFloat value) {
+  bool losesInfo;
+  value.convert(APFloat::IEEEdouble(), APFloat::rmNearestTiesToEven,
+                &losesInfo);
+  return value.convertToDouble();
+}
+
+void accumulate(NumericsChecker::Report &report, double value) {
+  if (std::isnan(value)) {
+    ++report.numNaNs;
+  } else if (std::isinf(value)) {
+    ++(value > 0 ? report.numPositiveInfinities
+                 : report.numNegativeInfinities);
+  } else {
+    report.min = report.min ? std::min(*report.min, value) : value;
+    report.max = report.max ? std::max(*report.max, value) : value;
+  }
+}
+
+}  // namespace
+
+bool hasNonFiniteElements(const Tensor &tensor) {
+  auto elementType = tensor.getElementType();
+  if (!isSupportedFloatType(elementType) &&
+      !isSupportedComplexType(elementType))
+    return false;
+  if (tensor.getNumElements() == 0) return false;
+  if (tensor.isSplat()) return isNonFinite(tensor.getLinear(0));
+
+  if (elementType.isF32())
+    return anyExponentSaturated(tensor.getData<uint32_t>(), 0x7F800000u);
+  if (elementType.isF64())
+    return anyExponentSaturated(tensor.getData<uint64_t>(),
+                                0x7FF0000000000000ull);
+  if (elementType.isF16())
+    return anyExponentSaturated(tensor.getData<uint16_t>(),
+                                static_cast<uint16_t>(0x7C00));
+  if (elementType.isBF16())
+    return anyExponentSaturated(tensor.getData<uint16_t>(),
+                                static_cast<uint16_t>(0x7F80));
+
+  // f8 types encode non-finite values differently, and complex types are
+  // rare enough that they aren't worth a kernel.
+  for (int64_t i = 0; i < tensor.getNumElements(); ++i)
+    if (isNonFinite(tensor.getLinear(i))) return true;
+  return false;
+}
+
+void NumericsChecker::check(Operation &op,
+                            ArrayRef<InterpreterValue> results) {
+  if (found_.load(std::memory_order_relaxed)) return;
+  for (auto [i, result] : llvm::enumerate(results)) {
+    if (!result.isTensor()) continue;
+    auto tensor = result.getTensor();
+    if (!hasNonFiniteElements(tensor)) continue;
+
+    // Only the first report is kept, so the rest is slow but simple.
+    Report report{op.getName(), op.getLoc(), static_cast<unsigned>(i)};
+    report.numElements = tensor.getNumElements();
+    bool isComplex = isSupportedComplexType(tensor.getElementType());
+    for (int64_t j = 0; j < report.numElements; ++j) {
+      auto element = tensor.getLinear(j);
+      if (isComplex) {
+        auto value = element.getComplexValue();
+        accumulate(report, toDouble(value.real()));
+        accumulate(report, toDouble(value.imag()));
+      } else {
+        accumulate(report, toDouble(element.getFloatValue()));
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!report_) report_ = std::move(report);
+    found_.store(true, std::memory_order_relaxed);
+    return;
+  }
+}
+
+std::optional<NumericsChecker::Report> NumericsChecker::getReport() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return report_;
+}
+
+void NumericsChecker::print(raw_ostream &os) const {
+  auto report = getReport();
+  if (!report) return;
+  os << report->name << " at " << report->location << " produced "
+     << report->numNaNs << " NaN, " << report->numPositiveInfinities
+     << " +inf and " << report->numNegativeInfinities << " -inf of "
+     << report->numElements << " elements in result " << report->resultIndex;
+  if (report->min)
+    os << ", finite range [" << llvm::format("%g", *report->min) << ", "
+       << llvm::format("%g", *report->max) << "]";
+  else
+    os << ", no finite values";
+}
+
+NumericsChecker *getNumericsChecker() {
+  return getEvaluationContext().numericsChecker;
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,92 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_NUMERICSCHECKER_H
+#define STABLEHLO_REFERENCE_NUMERICSCHECKER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OperationSupport.h"
+#include "mlir/Support/LLVM.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Value.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Locates the first op which produces NaN or infinite values while it is set
+/// in the `EvaluationContext`, without writing tensors to disk like probes do.
+/// `eval` scans the floating-point and complex results of every op it
+/// evaluates, which only tests the exponent bits of every element until a
+/// non-finite value is found. Only the first op is reported, since non-finite
+/// values usually propagate to the ops which use its results. The checker is
+/// thread-safe, and with concurrent ops "first" means first to be checked.
+class NumericsChecker {
+ public:
+  /// Non-finite values found in the results of an op.
+  struct Report {
+    OperationName name;
+    Location location;
+    /// Index of the first result with non-finite values.
+    unsigned resultIndex;
+    int64_t numElements = 0;
+    int64_t numNaNs = 0;
+    int64_t numPositiveInfinities = 0;
+    int64_t numNegativeInfinities = 0;
+    /// Range of the finite values of the result, if any. Complex results
+    /// report the range of their real and imaginary parts.
+    std::optional<double> min;
+    std::optional<double> max;
+  };
+
+  /// Scans `results` of `op` unless non-finite values have been found
+  /// already, and records a report if they contain any.
+  void check(Operation &op, ArrayRef<InterpreterValue> results);
+
+  /// Returns the report of the first op with non-finite results, if any.
+  std::optional<Report> getReport() const;
+
+  /// Prints the report, if any, e.g. "stablehlo.divide at loc("x.mlir":3:8)
+  /// produced 1 NaN, 0 +inf and 0 -inf of 4 elements in result 0, finite
+  /// range [-1, 2]".
+  void print(raw_ostream &os) const;
+
+ private:
+  std::atomic<bool> found_ = false;
+
+  /// Guards `report_`.
+  mutable std::mutex mutex_;
+  std::optional<Report> report_;
+};
+
+/// Returns whether `tensor` has NaN or infinite elements. Integer and
+/// quantized tensors have none.
+bool hasNonFiniteElements(const Tensor &tensor);
+
+/// Returns the checker with which `eval` scans the results of the ops it
+/// evaluates according to the current `EvaluationContext`, or nullptr if
+/// there is none.
+NumericsChecker *getNumericsChecker();
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_NUMERICSCHECKER_H
@@ -16,29 +16,177 @@ limitations under the License.
 #include "stablehlo/reference/Ops.h"
 
 #include <algorithm>
+#include <atomic>
+#include <complex>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
 
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/ThreadPool.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/Quant/QuantTypes.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Support/DebugStringHelper.h"
 #include "stablehlo/dialect/TypeInference.h"
 #include "stablehlo/reference/Axes.h"
+#include "stablehlo/reference/Checkpoint.h"
 #include "stablehlo/reference/Configuration.h"
 #include "stablehlo/reference/Element.h"
 #include "stablehlo/reference/Errors.h"
+#include "stablehlo/reference/EvaluationContext.h"
+#include "stablehlo/reference/Fft.h"
 #include "stablehlo/reference/Index.h"
+#include "stablehlo/reference/KernelRegistry.h"
+#include "stablehlo/reference/Kernels.h"
+#include "stablehlo/reference/MemoryTracker.h"
+#include "stablehlo/reference/NumericsChecker.h"
+#include "stablehlo/reference/Parallel.h"
 #include "stablehlo/reference/Process.h"
 #include "stablehlo/reference/ProcessGrid.h"
+#include "stablehlo/reference/Profiler.h"
+#include "stablehlo/reference/Quantization.h"
+#include "stablehlo/reference/Random.h"
 #include "stablehlo/reference/Token.h"
 #include "stablehlo/reference/Types.h"
 
 namespace mlir {
 namespace stablehlo {
+
+enum class OpKind : uint8_t {
+  Abs,
+  Add,
+  AfterAll,
+  AllGather,
+  AllReduce,
+  AllToAll,
+  And,
+  Atan2,
+  BatchNormGrad,
+  BatchNormInference,
+  BatchNormTraining,
+  BitcastConvert,
+  BroadcastInDim,
+  Broadcast,
+  FuncCall,
+  Case,
+  Cbrt,
+  Ceil,
+  Cholesky,
+  Clamp,
+  Clz,
+  CollectiveBroadcast,
+  CollectivePermute,
+  Compare,
+  Complex,
+  Composite,
+  Concatenate,
+  Constant,
+  Convert,
+  Convolution,
+  Cosine,
+  CreateToken,
+  CrossReplicaSum,
+  DequantizeOpQuantize,
+  Div,
+  Dot,
+  DotGeneral,
+  DynamicBroadcastInDim,
+  DynamicConv,
+  DynamicGather,
+  DynamicIota,
+  DynamicPad,
+  DynamicReshape,
+  DynamicSlice,
+  DynamicUpdateSlice,
+  Einsum,
+  Exp,
+  Expm1,
+  Fft,
+  Floor,
+  Gather,
+  GetDimensionSize,
+  GetTupleElement,
+  If,
+  Imag,
+  Infeed,
+  Iota,
+  IsFinite,
+  Log1p,
+  Log,
+  Logistic,
+  Map,
+  Max,
+  Min,
+  Mul,
+  Neg,
+  Not,
+  OptimizationBarrier,
+  Or,
+  Outfeed,
+  Pad,
+  PartitionId,
+  PopulationCount,
+  Pow,
+  Real,
+  Recv,
+  Reduce,
+  ReducePrecision,
+  ReduceScatter,
+  ReduceWindow,
+  Rem,
+  ReplicaId,
+  Reshape,
+  FuncReturn,
+  Return,
+  Reverse,
+  RngBitGenerator,
+  Rng,
+  RoundNearestEven,
+  Round,
+  Rsqrt,
+  Scatter,
+  SelectAndScatter,
+  Select,
+  Send,
+  ShiftLeft,
+  ShiftRightArithmetic,
+  ShiftRightLogical,
+  Sign,
+  Sine,
+  Slice,
+  Sort,
+  Sqrt,
+  Subtract,
+  Tanh,
+  TorchIndexSelect,
+  Transpose,
+  TriangularSolve,
+  Tuple,
+  UnaryEinsum,
+  UniformDequantize,
+  UniformQuantize,
+  While,
+  Xor,
+  Unknown,
+};
+
 namespace {
 
 Index evalIndex(ArrayRef<Tensor> scalars) {
@@ -55,6 +203,94 @@ Index evalIndex(Tensor tensor) {
   return result;
 }
 
+// Returns the options which the native kernels of the evaluation in progress
+// on the calling thread run with.
+const KernelOptions &getKernelOptions() {
+  return getEvaluationContext().kernelOptions;
+}
+
+// Element-based loops take on the order of a microsecond per element, so
+// splitting them into chunks pays off much earlier than for native kernels.
+constexpr int64_t kMinIndicesPerChunk = 1024;
+
+// Calls `fn` on the indices of `shape` at the flattened positions
+// [begin, end), in the canonical order.
+void forEachIndex(const Sizes &shape, int64_t begin, int64_t end,
+                  llvm::function_ref<void(const Index &)> fn) {
+  if (begin >= end) return;
+  Index index(shape.size());
+  for (int64_t d = shape.size() - 1, offset = begin; d >= 0; --d) {
+    index[d] = offset % shape[d];
+    offset /= shape[d];
+  }
+  IndexSpaceIterator it(shape, index);
+  for (int64_t i = begin; i < end; ++i, ++it) fn(*it);
+}
+
+// Calls `fn` for every index in the index space of `shape`, in chunks of
+// consecutive indices which are processed in parallel on the intra-op thread
+// pool. Every call must only write the result element at its index.
+void parallelForIndices(const Sizes &shape,
+                        llvm::function_ref<void(const Index &)> fn) {
+  int64_t size = 1;
+  for (auto dimSize : shape) size *= dimSize;
+  parallelForChunks(size, kMinIndicesPerChunk,
+                    [&](int64_t begin, int64_t end) {
+                      forEachIndex(shape, begin, end, fn);
+                    });
+}
+
+// Returns the number of bits used to store elements of type `elementType`, or
+// 0 if they aren't stored as a single integer or floating-point value.
+unsigned getStorageBitWidth(Type elementType) {
+  if (!elementType.isIntOrFloat()) return 0;
+  return std::max(elementType.getIntOrFloatBitWidth(), 8u);
+}
+
+// Returns a tensor of type `resultType` which reuses the storage of `operand`
+// if nothing else references that storage and it has the same size as the
+// storage for `resultType`, or a new tensor of type `resultType` otherwise.
+// Elementwise ops can write their results into the returned tensor while
+// reading `operand`, since they read every element of `operand` before
+// writing the result element at the same position.
+Tensor donateOrAllocate(const Tensor &operand, ShapedType resultType) {
+  if (!operand.hasUniqueStorage()) return Tensor(resultType);
+  if (operand.getType() == resultType) return operand;
+
+  auto bitWidth = getStorageBitWidth(resultType.getElementType());
+  if (!bitWidth || bitWidth != getStorageBitWidth(operand.getElementType()) ||
+      operand.getNumElements() != resultType.getNumElements())
+    return Tensor(resultType);
+
+  // The blob aliases the storage of `operand`, which its deleter keeps alive.
+  ArrayRef<char> data(const_cast<char *>(operand.getData()),
+                      resultType.getNumElements() * bitWidth / 8);
+  return Tensor(resultType,
+                AsmResourceBlob(
+                    data, alignof(std::max_align_t),
+                    [operand](void *, size_t, size_t) {},
+                    /*dataIsMutable=*/true));
+}
+
+// Binary counterpart of `donateOrAllocate`, which tries to reuse the storage
+// of `lhs` and then the storage of `rhs`.
+Tensor donateOrAllocate(const Tensor &lhs, const Tensor &rhs,
+                        ShapedType resultType) {
+  if (lhs.hasUniqueStorage()) return donateOrAllocate(lhs, resultType);
+  return donateOrAllocate(rhs, resultType);
+}
+
+// Returns `operand` if nothing else references its storage, or a copy of it
+// otherwise. Used by ops whose results are updated copies of their operands.
+Tensor donateOrCopy(const Tensor &operand) {
+  if (operand.hasUniqueStorage()) return operand;
+  Tensor result(operand.getType());
+  if (evalCopyKernel(getKernelOptions(), operand, result)) return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, operand.getLinear(i));
+  return result;
+}
+
 template <typename T>
 SmallVector<T> extractAttributeOrDefault(std::optional<ArrayRef<T>> attr,
                                          int64_t size, T value) {
@@ -176,6 +412,61 @@ Sizes extractElements(ArrayRef<int64_t> arr, ArrayRef<int64_t> indices) {
   return elements;
 }
 
+// Returns the elements of `tensor`, of a floating-point or complex element
+// type, as complex doubles.
+std::vector<std::complex<double>> getComplexData(const Tensor &tensor) {
+  std::vector<std::complex<double>> data(tensor.getNumElements());
+  if (loadComplexKernel(getKernelOptions(), tensor, data)) return data;
+  bool isComplex = isSupportedComplexType(tensor.getElementType());
+  for (int64_t i = 0, e = data.size(); i < e; ++i) {
+    auto element = tensor.getLinear(i);
+    if (isComplex) {
+      auto value = element.getComplexValue();
+      data[i] = {value.real().convertToDouble(),
+                 value.imag().convertToDouble()};
+    } else {
+      data[i] = element.getFloatValue().convertToDouble();
+    }
+  }
+  return data;
+}
+
+// Sets the elements of `tensor` from complex doubles, of which tensors of
+// floating-point element types keep the real parts.
+void setComplexData(Tensor &tensor, ArrayRef<std::complex<double>> data) {
+  if (storeComplexKernel(getKernelOptions(), data, tensor)) return;
+  auto elementType = tensor.getElementType();
+  for (int64_t i = 0, e = tensor.getNumElements(); i < e; ++i)
+    tensor.setLinear(i, convert(elementType, data[i]));
+}
+
+// Returns the elements of `tensor`, of a floating-point element type, as
+// doubles.
+std::vector<double> getFloatData(const Tensor &tensor) {
+  std::vector<double> data(tensor.getNumElements());
+  for (int64_t i = 0, e = data.size(); i < e; ++i)
+    data[i] = tensor.getLinear(i).getFloatValue().convertToDouble();
+  return data;
+}
+
+// Sets the elements of `tensor`, of a floating-point element type, from
+// doubles.
+void setFloatData(Tensor &tensor, ArrayRef<double> data) {
+  auto elementType = tensor.getElementType();
+  for (int64_t i = 0, e = tensor.getNumElements(); i < e; ++i)
+    tensor.setLinear(i, convert(elementType, data[i]));
+}
+
+// Returns the number of elements between consecutive indices of the feature
+// dimension `featureIndex` of `operand` of batch norm ops, so that its
+// element `i` belongs to the feature `(i / stride) % numFeatures`.
+int64_t getFeatureStride(const Tensor &operand, Axis featureIndex) {
+  int64_t stride = 1;
+  for (Axis d = featureIndex + 1; d < operand.getRank(); ++d)
+    stride *= operand.getShape()[d];
+  return stride;
+}
+
 void failOnDecomposableOp(Operation &op) {
   report_fatal_error(invalidArgument(
       "Operation %s is unsupported at the moment. "
@@ -286,8 +577,11 @@ Tensor makeSplat(ShapedType type, const Element &initValue) {
   return result;
 }
 
-SmallVector<Tensor> split(const Tensor &x, int64_t numResults, Axis axis,
-                          MLIRContext *context) {
+// Returns the part `i` of splitting `x` into `numResults` equal parts along
+// `axis`. If all dimensions before `axis` have size 1, the part is contiguous
+// in the storage of `x` and is returned as a view instead of being copied.
+Tensor splitPart(const Tensor &x, int64_t numResults, int64_t i, Axis axis,
+                 MLIRContext *context) {
   Sizes resultShape(x.getShape());
   if (resultShape[axis] % numResults != 0)
     report_fatal_error(
@@ -296,37 +590,927 @@ SmallVector<Tensor> split(const Tensor &x, int64_t numResults, Axis axis,
                         axis, numResults, resultShape[axis]));
 
   resultShape[axis] /= numResults;
+  auto resultType = RankedTensorType::get(resultShape, x.getElementType());
+  if (llvm::all_of(ArrayRef<int64_t>(resultShape).take_front(axis),
+                   [](int64_t dimSize) { return dimSize == 1; }))
+    return makeTensorView(x, i * resultType.getNumElements(), resultType);
+
+  SmallVector<Tensor> inputStartIndices(
+      x.getRank(), constant(0.0, IntegerType::get(context, 64)));
+  inputStartIndices[axis] =
+      constant(i * resultShape[axis], IntegerType::get(context, 64));
+  return dynamicSliceOp(x, inputStartIndices, resultShape, resultType);
+}
 
+SmallVector<Tensor> split(const Tensor &x, int64_t numResults, Axis axis,
+                          MLIRContext *context) {
   SmallVector<Tensor> results;
-  for (auto i = 0; i < numResults; ++i) {
-    SmallVector<Tensor> inputStartIndices(
-        x.getRank(), constant(0.0, IntegerType::get(context, 64)));
-    inputStartIndices[axis] =
-        constant(i * resultShape[axis], IntegerType::get(context, 64));
+  for (auto i = 0; i < numResults; ++i)
+    results.push_back(splitPart(x, numResults, i, axis, context));
+  return results;
+}
+
+// Maps ops of `block` to the values defined in `block`, i.e. its arguments and
+// the results of its ops, which are used for the last time by these ops. Uses
+// in nested regions count as uses by their ancestor in `block`. Values without
+// uses map to the ops which define them or, for arguments, to the first op.
+llvm::DenseMap<Operation *, SmallVector<Value>> getLastUses(Block &block) {
+  llvm::DenseMap<Operation *, int64_t> positions;
+  int64_t position = 0;
+  for (Operation &operation : block) positions[&operation] = position++;
+
+  llvm::DenseMap<Operation *, SmallVector<Value>> lastUses;
+  auto addLastUse = [&](Value value, Operation *definingOp) {
+    Operation *lastUser = definingOp ? definingOp : &block.front();
+    for (Operation *user : value.getUsers()) {
+      Operation *ancestor = block.findAncestorOpInBlock(*user);
+      if (ancestor && positions[ancestor] > positions[lastUser])
+        lastUser = ancestor;
+    }
+    lastUses[lastUser].push_back(value);
+  };
+  for (Value argument : block.getArguments()) addLastUse(argument, nullptr);
+  for (Operation &operation : block)
+    for (Value result : operation.getResults())
+      addLastUse(result, &operation);
+  return lastUses;
+}
 
-    auto result =
-        dynamicSliceOp(x, inputStartIndices, resultShape,
-                       RankedTensorType::get(resultShape, x.getElementType()));
-    results.push_back(result);
+// Returns the kind of `operation` regardless of its types.
+OpKind lookupOpKind(Operation &operation) {
+  static const auto *kinds = new llvm::DenseMap<TypeID, OpKind>({
+      {TypeID::get<AbsOp>(), OpKind::Abs},
+      {TypeID::get<AddOp>(), OpKind::Add},
+      {TypeID::get<AfterAllOp>(), OpKind::AfterAll},
+      {TypeID::get<AllGatherOp>(), OpKind::AllGather},
+      {TypeID::get<AllReduceOp>(), OpKind::AllReduce},
+      {TypeID::get<AllToAllOp>(), OpKind::AllToAll},
+      {TypeID::get<AndOp>(), OpKind::And},
+      {TypeID::get<Atan2Op>(), OpKind::Atan2},
+      {TypeID::get<BatchNormGradOp>(), OpKind::BatchNormGrad},
+      {TypeID::get<BatchNormInferenceOp>(), OpKind::BatchNormInference},
+      {TypeID::get<BatchNormTrainingOp>(), OpKind::BatchNormTraining},
+      {TypeID::get<BitcastConvertOp>(), OpKind::BitcastConvert},
+      {TypeID::get<BroadcastInDimOp>(), OpKind::BroadcastInDim},
+      {TypeID::get<BroadcastOp>(), OpKind::Broadcast},
+      {TypeID::get<func::CallOp>(), OpKind::FuncCall},
+      {TypeID::get<CaseOp>(), OpKind::Case},
+      {TypeID::get<CbrtOp>(), OpKind::Cbrt},
+      {TypeID::get<CeilOp>(), OpKind::Ceil},
+      {TypeID::get<CholeskyOp>(), OpKind::Cholesky},
+      {TypeID::get<ClampOp>(), OpKind::Clamp},
+      {TypeID::get<ClzOp>(), OpKind::Clz},
+      {TypeID::get<CollectiveBroadcastOp>(), OpKind::CollectiveBroadcast},
+      {TypeID::get<CollectivePermuteOp>(), OpKind::CollectivePermute},
+      {TypeID::get<CompareOp>(), OpKind::Compare},
+      {TypeID::get<ComplexOp>(), OpKind::Complex},
+      {TypeID::get<CompositeOp>(), OpKind::Composite},
+      {TypeID::get<ConcatenateOp>(), OpKind::Concatenate},
+      {TypeID::get<ConstantOp>(), OpKind::Constant},
+      {TypeID::get<ConvertOp>(), OpKind::Convert},
+      {TypeID::get<ConvolutionOp>(), OpKind::Convolution},
+      {TypeID::get<CosineOp>(), OpKind::Cosine},
+      {TypeID::get<CreateTokenOp>(), OpKind::CreateToken},
+      {TypeID::get<CrossReplicaSumOp>(), OpKind::CrossReplicaSum},
+      {TypeID::get<DivOp>(), OpKind::Div},
+      {TypeID::get<DotOp>(), OpKind::Dot},
+      {TypeID::get<DotGeneralOp>(), OpKind::DotGeneral},
+      {TypeID::get<DynamicBroadcastInDimOp>(), OpKind::DynamicBroadcastInDim},
+      {TypeID::get<DynamicConvOp>(), OpKind::DynamicConv},
+      {TypeID::get<DynamicGatherOp>(), OpKind::DynamicGather},
+      {TypeID::get<DynamicIotaOp>(), OpKind::DynamicIota},
+      {TypeID::get<DynamicPadOp>(), OpKind::DynamicPad},
+      {TypeID::get<DynamicReshapeOp>(), OpKind::DynamicReshape},
+      {TypeID::get<DynamicSliceOp>(), OpKind::DynamicSlice},
+      {TypeID::get<DynamicUpdateSliceOp>(), OpKind::DynamicUpdateSlice},
+      {TypeID::get<EinsumOp>(), OpKind::Einsum},
+      {TypeID::get<ExpOp>(), OpKind::Exp},
+      {TypeID::get<Expm1Op>(), OpKind::Expm1},
+      {TypeID::get<FftOp>(), OpKind::Fft},
+      {TypeID::get<FloorOp>(), OpKind::Floor},
+      {TypeID::get<GatherOp>(), OpKind::Gather},
+      {TypeID::get<GetDimensionSizeOp>(), OpKind::GetDimensionSize},
+      {TypeID::get<GetTupleElementOp>(), OpKind::GetTupleElement},
+      {TypeID::get<IfOp>(), OpKind::If},
+      {TypeID::get<ImagOp>(), OpKind::Imag},
+      {TypeID::get<InfeedOp>(), OpKind::Infeed},
+      {TypeID::get<IotaOp>(), OpKind::Iota},
+      {TypeID::get<IsFiniteOp>(), OpKind::IsFinite},
+      {TypeID::get<Log1pOp>(), OpKind::Log1p},
+      {TypeID::get<LogOp>(), OpKind::Log},
+      {TypeID::get<LogisticOp>(), OpKind::Logistic},
+      {TypeID::get<MapOp>(), OpKind::Map},
+      {TypeID::get<MaxOp>(), OpKind::Max},
+      {TypeID::get<MinOp>(), OpKind::Min},
+      {TypeID::get<MulOp>(), OpKind::Mul},
+      {TypeID::get<NegOp>(), OpKind::Neg},
+      {TypeID::get<NotOp>(), OpKind::Not},
+      {TypeID::get<OptimizationBarrierOp>(), OpKind::OptimizationBarrier},
+      {TypeID::get<OrOp>(), OpKind::Or},
+      {TypeID::get<OutfeedOp>(), OpKind::Outfeed},
+      {TypeID::get<PadOp>(), OpKind::Pad},
+      {TypeID::get<PartitionIdOp>(), OpKind::PartitionId},
+      {TypeID::get<PopulationCountOp>(), OpKind::PopulationCount},
+      {TypeID::get<PowOp>(), OpKind::Pow},
+      {TypeID::get<RealOp>(), OpKind::Real},
+      {TypeID::get<RecvOp>(), OpKind::Recv},
+      {TypeID::get<ReduceOp>(), OpKind::Reduce},
+      {TypeID::get<ReducePrecisionOp>(), OpKind::ReducePrecision},
+      {TypeID::get<ReduceScatterOp>(), OpKind::ReduceScatter},
+      {TypeID::get<ReduceWindowOp>(), OpKind::ReduceWindow},
+      {TypeID::get<RemOp>(), OpKind::Rem},
+      {TypeID::get<ReplicaIdOp>(), OpKind::ReplicaId},
+      {TypeID::get<ReshapeOp>(), OpKind::Reshape},
+      {TypeID::get<func::ReturnOp>(), OpKind::FuncReturn},
+      {TypeID::get<ReturnOp>(), OpKind::Return},
+      {TypeID::get<ReverseOp>(), OpKind::Reverse},
+      {TypeID::get<RngBitGeneratorOp>(), OpKind::RngBitGenerator},
+      {TypeID::get<RngOp>(), OpKind::Rng},
+      {TypeID::get<RoundNearestEvenOp>(), OpKind::RoundNearestEven},
+      {TypeID::get<RoundOp>(), OpKind::Round},
+      {TypeID::get<RsqrtOp>(), OpKind::Rsqrt},
+      {TypeID::get<ScatterOp>(), OpKind::Scatter},
+      {TypeID::get<SelectAndScatterOp>(), OpKind::SelectAndScatter},
+      {TypeID::get<SelectOp>(), OpKind::Select},
+      {TypeID::get<SendOp>(), OpKind::Send},
+      {TypeID::get<ShiftLeftOp>(), OpKind::ShiftLeft},
+      {TypeID::get<ShiftRightArithmeticOp>(), OpKind::ShiftRightArithmetic},
+      {TypeID::get<ShiftRightLogicalOp>(), OpKind::ShiftRightLogical},
+      {TypeID::get<SignOp>(), OpKind::Sign},
+      {TypeID::get<SineOp>(), OpKind::Sine},
+      {TypeID::get<SliceOp>(), OpKind::Slice},
+      {TypeID::get<SortOp>(), OpKind::Sort},
+      {TypeID::get<SqrtOp>(), OpKind::Sqrt},
+      {TypeID::get<SubtractOp>(), OpKind::Subtract},
+      {TypeID::get<TanhOp>(), OpKind::Tanh},
+      {TypeID::get<TorchIndexSelectOp>(), OpKind::TorchIndexSelect},
+      {TypeID::get<TransposeOp>(), OpKind::Transpose},
+      {TypeID::get<TriangularSolveOp>(), OpKind::TriangularSolve},
+      {TypeID::get<TupleOp>(), OpKind::Tuple},
+      {TypeID::get<UnaryEinsumOp>(), OpKind::UnaryEinsum},
+      {TypeID::get<UniformDequantizeOp>(), OpKind::UniformDequantize},
+      {TypeID::get<UniformQuantizeOp>(), OpKind::UniformQuantize},
+      {TypeID::get<WhileOp>(), OpKind::While},
+      {TypeID::get<XorOp>(), OpKind::Xor},
+  });
+  auto it = kinds->find(operation.getName().getTypeID());
+  return it != kinds->end() ? it->second : OpKind::Unknown;
+}
+
+// Returns whether the specification defines ops of `kind` with quantized
+// operands or results through `dequantize_op_quantize`, see
+// `evalDequantizedOp`.
+bool hasDequantizeOpQuantizeSemantics(OpKind kind) {
+  switch (kind) {
+    case OpKind::Abs:
+    case OpKind::Add:
+    case OpKind::Atan2:
+    case OpKind::Cbrt:
+    case OpKind::Ceil:
+    case OpKind::Cholesky:
+    case OpKind::Clamp:
+    case OpKind::Compare:
+    case OpKind::Cosine:
+    case OpKind::Div:
+    case OpKind::Exp:
+    case OpKind::Expm1:
+    case OpKind::Floor:
+    case OpKind::Log:
+    case OpKind::Log1p:
+    case OpKind::Logistic:
+    case OpKind::Max:
+    case OpKind::Min:
+    case OpKind::Mul:
+    case OpKind::Neg:
+    case OpKind::Pow:
+    case OpKind::Rem:
+    case OpKind::RoundNearestEven:
+    case OpKind::Round:
+    case OpKind::Rsqrt:
+    case OpKind::Select:
+    case OpKind::Sign:
+    case OpKind::Sine:
+    case OpKind::Sqrt:
+    case OpKind::Subtract:
+    case OpKind::Tanh:
+      return true;
+    default:
+      return false;
   }
-  return results;
+}
+
+// Returns the kind of `operation`, which `eval` dispatches on.
+OpKind getOpKind(Operation &operation) {
+  auto kind = lookupOpKind(operation);
+  if (!hasDequantizeOpQuantizeSemantics(kind)) return kind;
+  auto isQuantized = [](Type type) {
+    return isSupportedQuantizedType(getElementTypeOrSelf(type));
+  };
+  if (llvm::any_of(operation.getOperandTypes(), isQuantized) ||
+      llvm::any_of(operation.getResultTypes(), isQuantized))
+    return OpKind::DequantizeOpQuantize;
+  return kind;
+}
+
+// Evaluates the elementwise `operation`, whose kind has
+// `dequantize_op_quantize` semantics, on the dequantized `operands` with
+// floating-point results of `resultType`.
+Tensor evalDequantizedOp(Operation &operation, ArrayRef<Tensor> operands,
+                         ShapedType resultType) {
+  switch (lookupOpKind(operation)) {
+    case OpKind::Abs:
+      return absOp(operands[0], resultType);
+    case OpKind::Add:
+      return addOp(operands[0], operands[1], resultType);
+    case OpKind::Atan2:
+      return atan2Op(operands[0], operands[1], resultType);
+    case OpKind::Cbrt:
+      return cbrtOp(operands[0], resultType);
+    case OpKind::Ceil:
+      return ceilOp(operands[0], resultType);
+    case OpKind::Cholesky:
+      return choleskyOp(operands[0], cast<CholeskyOp>(operation).getLower(),
+                        resultType);
+    case OpKind::Clamp:
+      return clampOp(operands[0], operands[1], operands[2], resultType);
+    case OpKind::Compare:
+      return compareOp(operands[0], operands[1],
+                       cast<CompareOp>(operation).getComparisonDirection(),
+                       ComparisonType::FLOAT, resultType);
+    case OpKind::Cosine:
+      return cosineOp(operands[0], resultType);
+    case OpKind::Div:
+      return divideOp(operands[0], operands[1], resultType);
+    case OpKind::Exp:
+      return exponentialOp(operands[0], resultType);
+    case OpKind::Expm1:
+      return expm1Op(operands[0], resultType);
+    case OpKind::Floor:
+      return floorOp(operands[0], resultType);
+    case OpKind::Log:
+      return logOp(operands[0], resultType);
+    case OpKind::Log1p:
+      return log1pOp(operands[0], resultType);
+    case OpKind::Logistic:
+      return logisticOp(operands[0], resultType);
+    case OpKind::Max:
+      return maxOp(operands[0], operands[1], resultType);
+    case OpKind::Min:
+      return minOp(operands[0], operands[1], resultType);
+    case OpKind::Mul:
+      return multiplyOp(operands[0], operands[1], resultType);
+    case OpKind::Neg:
+      return negOp(operands[0], resultType);
+    case OpKind::Pow:
+      return powerOp(operands[0], operands[1], resultType);
+    case OpKind::Rem:
+      return remOp(operands[0], operands[1], resultType);
+    case OpKind::RoundNearestEven:
+      return roundNearestEvenOp(operands[0], resultType);
+    case OpKind::Round:
+      return roundOp(operands[0], resultType);
+    case OpKind::Rsqrt:
+      return rsqrtOp(operands[0], resultType);
+    case OpKind::Select:
+      return selectOp(operands[0], operands[1], operands[2], resultType);
+    case OpKind::Sign:
+      return signOp(operands[0], resultType);
+    case OpKind::Sine:
+      return sineOp(operands[0], resultType);
+    case OpKind::Sqrt:
+      return sqrtOp(operands[0], resultType);
+    case OpKind::Subtract:
+      return subtractOp(operands[0], operands[1], resultType);
+    case OpKind::Tanh:
+      return tanhOp(operands[0], resultType);
+    default:
+      llvm::report_fatal_error(
+          invalidArgument("Unsupported quantized op: %s",
+                          debugString(operation).c_str()));
+  }
+}
+
+// Returns the type of the dequantized elements of the quantized `type`.
+ShapedType getExpressedType(ShapedType type) {
+  return type.clone(
+      cast<quant::QuantizedType>(type.getElementType()).getExpressedType());
+}
+
+// Returns the type of the i32 accumulators of quantized ops like
+// `dotGeneralOp` with results of `type`.
+ShapedType getAccumulatorType(ShapedType type) {
+  return type.clone(IntegerType::get(type.getContext(), 32));
+}
+
+// Returns the dimension of the result of `dotGeneralOp` along which the
+// scales of a per-axis quantized `rhs` vary.
+Axis getRhsResultDimension(const Tensor &lhs, const Tensor &rhs,
+                           const Axes &rhsBatchingDimensions,
+                           const Axes &lhsContractingDimensions,
+                           const Axes &rhsContractingDimensions) {
+  auto perAxisType =
+      dyn_cast<quant::UniformQuantizedPerAxisType>(rhs.getElementType());
+  if (!perAxisType) return 0;
+  Axis dimension = perAxisType.getQuantizedDimension();
+  if (auto *it = llvm::find(rhsBatchingDimensions, dimension);
+      it != rhsBatchingDimensions.end())
+    return it - rhsBatchingDimensions.begin();
+  if (llvm::is_contained(rhsContractingDimensions, dimension))
+    llvm::report_fatal_error(invalidArgument(
+        "Unsupported quantized contracting dimension: %lld",
+        static_cast<long long>(dimension)));
+
+  // The result dimensions of `rhs` follow the batching and result dimensions
+  // of `lhs`, whose number is the number of non-contracting dimensions of
+  // `lhs`.
+  int64_t resultDimension = lhs.getRank() - lhsContractingDimensions.size();
+  for (Axis i = 0; i < dimension; ++i)
+    if (!llvm::is_contained(rhsBatchingDimensions, i) &&
+        !llvm::is_contained(rhsContractingDimensions, i))
+      ++resultDimension;
+  return resultDimension;
+}
+
+// Returns the native kernel equivalent to `body` if it applies an associative
+// and commutative binary op to its two arguments and returns the result, like
+// the bodies of sums and max reductions.
+std::optional<BinaryKernel> getReductionKernel(Region &body) {
+  if (!body.hasOneBlock()) return std::nullopt;
+  Block &block = body.front();
+  if (block.getNumArguments() != 2 || !llvm::hasNItems(block, 2))
+    return std::nullopt;
+
+  Operation &operation = block.front();
+  auto returnOp = dyn_cast<ReturnOp>(block.back());
+  if (operation.getNumOperands() != 2 || operation.getNumResults() != 1 ||
+      !returnOp || returnOp->getNumOperands() != 1 ||
+      returnOp->getOperand(0) != operation.getResult(0))
+    return std::nullopt;
+
+  Value lhs = operation.getOperand(0);
+  Value rhs = operation.getOperand(1);
+  Value arg0 = block.getArgument(0);
+  Value arg1 = block.getArgument(1);
+  if (!(lhs == arg0 && rhs == arg1) && !(lhs == arg1 && rhs == arg0))
+    return std::nullopt;
+
+  switch (getOpKind(operation)) {
+    case OpKind::Add:
+      return BinaryKernel::Add;
+    case OpKind::And:
+      return BinaryKernel::And;
+    case OpKind::Max:
+      return BinaryKernel::Maximum;
+    case OpKind::Min:
+      return BinaryKernel::Minimum;
+    case OpKind::Mul:
+      return BinaryKernel::Multiply;
+    case OpKind::Or:
+      return BinaryKernel::Or;
+    case OpKind::Xor:
+      return BinaryKernel::Xor;
+    default:
+      return std::nullopt;
+  }
+}
+
+// Returns whether `mapOp` can evaluate `operation` of the body of its
+// computation on whole tensors at once, see `evalMappedOp`. These are the
+// elementwise ops whose results only depend on their operands, except for
+// ops with quantized operands or results.
+bool isMappableOp(Operation &operation) {
+  switch (getOpKind(operation)) {
+    case OpKind::Abs:
+    case OpKind::Add:
+    case OpKind::And:
+    case OpKind::Atan2:
+    case OpKind::Cbrt:
+    case OpKind::Ceil:
+    case OpKind::Clamp:
+    case OpKind::Clz:
+    case OpKind::Compare:
+    case OpKind::Complex:
+    case OpKind::Convert:
+    case OpKind::Cosine:
+    case OpKind::Div:
+    case OpKind::Exp:
+    case OpKind::Expm1:
+    case OpKind::Floor:
+    case OpKind::Imag:
+    case OpKind::IsFinite:
+    case OpKind::Log:
+    case OpKind::Log1p:
+    case OpKind::Logistic:
+    case OpKind::Max:
+    case OpKind::Min:
+    case OpKind::Mul:
+    case OpKind::Neg:
+    case OpKind::Not:
+    case OpKind::Or:
+    case OpKind::PopulationCount:
+    case OpKind::Pow:
+    case OpKind::Real:
+    case OpKind::Rem:
+    case OpKind::RoundNearestEven:
+    case OpKind::Round:
+    case OpKind::Rsqrt:
+    case OpKind::Select:
+    case OpKind::ShiftLeft:
+    case OpKind::ShiftRightArithmetic:
+    case OpKind::ShiftRightLogical:
+    case OpKind::Sign:
+    case OpKind::Sine:
+    case OpKind::Sqrt:
+    case OpKind::Subtract:
+    case OpKind::Tanh:
+    case OpKind::Xor:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Evaluates `operation` of the body of the computation of `mapOp`, for which
+// `isMappableOp` holds, on the whole tensors `operands` rather than on
+// scalars, with results of `resultType`.
+Tensor evalMappedOp(Operation &operation, ArrayRef<Tensor> operands,
+                    ShapedType resultType) {
+  switch (getOpKind(operation)) {
+    case OpKind::Abs:
+      return absOp(operands[0], resultType);
+    case OpKind::Add:
+      return addOp(operands[0], operands[1], resultType);
+    case OpKind::And:
+      return andOp(operands[0], operands[1], resultType);
+    case OpKind::Atan2:
+      return atan2Op(operands[0], operands[1], resultType);
+    case OpKind::Cbrt:
+      return cbrtOp(operands[0], resultType);
+    case OpKind::Ceil:
+      return ceilOp(operands[0], resultType);
+    case OpKind::Clamp:
+      return clampOp(operands[0], operands[1], operands[2], resultType);
+    case OpKind::Clz:
+      return clzOp(operands[0], resultType);
+    case OpKind::Compare: {
+      auto op = cast<CompareOp>(operation);
+      return compareOp(operands[0], operands[1], op.getComparisonDirection(),
+                       op.getCompareType(), resultType);
+    }
+    case OpKind::Complex:
+      return complexOp(operands[0], operands[1], resultType);
+    case OpKind::Convert:
+      return convertOp(operands[0], resultType);
+    case OpKind::Cosine:
+      return cosineOp(operands[0], resultType);
+    case OpKind::Div:
+      return divideOp(operands[0], operands[1], resultType);
+    case OpKind::Exp:
+      return exponentialOp(operands[0], resultType);
+    case OpKind::Expm1:
+      return expm1Op(operands[0], resultType);
+    case OpKind::Floor:
+      return floorOp(operands[0], resultType);
+    case OpKind::Imag:
+      return imagOp(operands[0], resultType);
+    case OpKind::IsFinite:
+      return isFiniteOp(operands[0], resultType);
+    case OpKind::Log:
+      return logOp(operands[0], resultType);
+    case OpKind::Log1p:
+      return log1pOp(operands[0], resultType);
+    case OpKind::Logistic:
+      return logisticOp(operands[0], resultType);
+    case OpKind::Max:
+      return maxOp(operands[0], operands[1], resultType);
+    case OpKind::Min:
+      return minOp(operands[0], operands[1], resultType);
+    case OpKind::Mul:
+      return multiplyOp(operands[0], operands[1], resultType);
+    case OpKind::Neg:
+      return negOp(operands[0], resultType);
+    case OpKind::Not:
+      return notOp(operands[0], resultType);
+    case OpKind::Or:
+      return orOp(operands[0], operands[1], resultType);
+    case OpKind::PopulationCount:
+      return populationCountOp(operands[0], resultType);
+    case OpKind::Pow:
+      return powerOp(operands[0], operands[1], resultType);
+    case OpKind::Real:
+      return realOp(operands[0], resultType);
+    case OpKind::Rem:
+      return remOp(operands[0], operands[1], resultType);
+    case OpKind::RoundNearestEven:
+      return roundNearestEvenOp(operands[0], resultType);
+    case OpKind::Round:
+      return roundOp(operands[0], resultType);
+    case OpKind::Rsqrt:
+      return rsqrtOp(operands[0], resultType);
+    case OpKind::Select:
+      return selectOp(operands[0], operands[1], operands[2], resultType);
+    case OpKind::ShiftLeft:
+      return shiftLeftOp(operands[0], operands[1], resultType);
+    case OpKind::ShiftRightArithmetic:
+      return shiftRightArithmeticOp(operands[0], operands[1], resultType);
+    case OpKind::ShiftRightLogical:
+      return shiftRightLogicalOp(operands[0], operands[1], resultType);
+    case OpKind::Sign:
+      return signOp(operands[0], resultType);
+    case OpKind::Sine:
+      return sineOp(operands[0], resultType);
+    case OpKind::Sqrt:
+      return sqrtOp(operands[0], resultType);
+    case OpKind::Subtract:
+      return subtractOp(operands[0], operands[1], resultType);
+    case OpKind::Tanh:
+      return tanhOp(operands[0], resultType);
+    case OpKind::Xor:
+      return xorOp(operands[0], operands[1], resultType);
+    default:
+      llvm::report_fatal_error(invalidArgument(
+          "Unsupported mapped op: %s", debugString(operation).c_str()));
+  }
+}
+
+// Evaluates the computation of `mapOp` on the whole `inputs` at once, like a
+// fused elementwise kernel, if its body consists of constants and ops for
+// which `isMappableOp` holds. Every op then runs once with the native kernels
+// of its op, on tensors of the shape of `resultType`, rather than once per
+// element. Constants are broadcast as splat views. Returns std::nullopt if
+// the body has other ops or uses values defined outside of it.
+std::optional<Tensor> evalMapBody(ArrayRef<Tensor> inputs, Region &computation,
+                                  ShapedType resultType) {
+  if (!computation.hasOneBlock()) return std::nullopt;
+  Block &block = computation.front();
+  auto returnOp = dyn_cast<ReturnOp>(block.back());
+  if (!returnOp || returnOp->getNumOperands() != 1) return std::nullopt;
+  for (Operation &operation : block.without_terminator()) {
+    if (!isa<ConstantOp>(operation) && !isMappableOp(operation))
+      return std::nullopt;
+    for (Value operand : operation.getOperands())
+      if (operand.getParentRegion() != &computation) return std::nullopt;
+  }
+  if (returnOp->getOperand(0).getParentRegion() != &computation)
+    return std::nullopt;
+
+  llvm::DenseMap<Value, Tensor> values;
+  for (auto [argument, input] : llvm::zip(block.getArguments(), inputs))
+    values[argument] = input;
+  for (Operation &operation : block.without_terminator()) {
+    auto result = operation.getResult(0);
+    auto type = resultType.clone(getElementTypeOrSelf(result.getType()));
+    if (auto constant = dyn_cast<ConstantOp>(operation)) {
+      values[result] = makeSplatView(constantOp(constant.getValue()), type);
+      continue;
+    }
+    auto operands = llvm::map_to_vector(
+        operation.getOperands(),
+        [&](Value operand) { return values[operand]; });
+    values[result] = evalMappedOp(operation, operands, type);
+  }
+  return values[returnOp->getOperand(0)];
+}
+
+// A scalar region compiled into closures over `Element` values, like the
+// update computations of `scatterOp` and the select and scatter computations
+// of `selectAndScatterOp`, which are evaluated once per element. Unlike
+// `eval`, evaluating it creates no tensors or scopes, and dispatches on the
+// kinds of its ops only once, when it's compiled.
+class ScalarFunction {
+ public:
+  // Returns `region` compiled, or std::nullopt if it has ops other than
+  // constants and elementwise ops supported by `compileOp`, or if it uses
+  // values defined outside of it.
+  static std::optional<ScalarFunction> compile(Region &region) {
+    if (!region.hasOneBlock()) return std::nullopt;
+    Block &block = region.front();
+    auto returnOp = dyn_cast<ReturnOp>(block.back());
+    if (!returnOp) return std::nullopt;
+
+    ScalarFunction function;
+    function.numArgs_ = block.getNumArguments();
+    llvm::DenseMap<Value, int64_t> slots;
+    for (auto argument : block.getArguments())
+      slots[argument] = argument.getArgNumber();
+    auto getSlots = [&](ValueRange values) -> std::optional<Slots> {
+      Slots result;
+      for (Value value : values) {
+        auto it = slots.find(value);
+        if (it == slots.end()) return std::nullopt;
+        result.push_back(it->second);
+      }
+      return result;
+    };
+    for (Operation &operation : block.without_terminator()) {
+      auto operands = getSlots(operation.getOperands());
+      if (!operands || operation.getNumResults() != 1) return std::nullopt;
+      auto instruction = compileOp(operation, *operands);
+      if (!instruction) return std::nullopt;
+      slots[operation.getResult(0)] =
+          function.numArgs_ + function.instructions_.size();
+      function.instructions_.push_back(std::move(*instruction));
+    }
+    auto results = getSlots(returnOp->getOperands());
+    if (!results) return std::nullopt;
+    function.results_ = std::move(*results);
+    return function;
+  }
+
+  // Evaluates the region with `args` and replaces `results` with its
+  // results. `slots` holds the intermediate values and is reused across
+  // calls.
+  void operator()(ArrayRef<Element> args, SmallVectorImpl<Element> &slots,
+                  SmallVectorImpl<Element> &results) const {
+    slots.assign(args.begin(), args.end());
+    for (const auto &instruction : instructions_)
+      slots.push_back(instruction(slots));
+    results.clear();
+    for (int64_t slot : results_) results.push_back(slots[slot]);
+  }
+
+ private:
+  using Slots = SmallVector<int64_t, 3>;
+  using Instruction = std::function<Element(ArrayRef<Element>)>;
+
+  // Returns the closure which computes the result of `operation` from the
+  // values at `operands`.
+  static std::optional<Instruction> compileOp(Operation &operation,
+                                              const Slots &operands) {
+    auto unary = [&](auto fn) -> Instruction {
+      int64_t x = operands[0];
+      return [=](ArrayRef<Element> values) { return fn(values[x]); };
+    };
+    auto binary = [&](auto fn) -> Instruction {
+      int64_t x = operands[0];
+      int64_t y = operands[1];
+      return [=](ArrayRef<Element> values) {
+        return fn(values[x], values[y]);
+      };
+    };
+    using E = const Element &;
+    switch (getOpKind(operation)) {
+      case OpKind::Abs:
+        return unary([](E x) { return stablehlo::abs(x); });
+      case OpKind::Add:
+        return binary([](E x, E y) { return x + y; });
+      case OpKind::And:
+        return binary([](E x, E y) { return x & y; });
+      case OpKind::Compare: {
+        auto op = cast<CompareOp>(operation);
+        if (op.getCompareType() == ComparisonType::TOTALORDER)
+          return std::nullopt;
+        switch (op.getComparisonDirection()) {
+          case ComparisonDirection::EQ:
+            return binary([](E x, E y) { return x == y; });
+          case ComparisonDirection::NE:
+            return binary([](E x, E y) { return x != y; });
+          case ComparisonDirection::GE:
+            return binary([](E x, E y) { return x >= y; });
+          case ComparisonDirection::GT:
+            return binary([](E x, E y) { return x > y; });
+          case ComparisonDirection::LE:
+            return binary([](E x, E y) { return x <= y; });
+          case ComparisonDirection::LT:
+            return binary([](E x, E y) { return x < y; });
+        }
+        return std::nullopt;
+      }
+      case OpKind::Constant: {
+        auto value = constantOp(cast<ConstantOp>(operation).getValue()).get({});
+        return [=](ArrayRef<Element>) { return value; };
+      }
+      case OpKind::Convert: {
+        auto type = getElementTypeOrSelf(operation.getResult(0).getType());
+        return unary([=](E x) { return convert(type, x); });
+      }
+      case OpKind::Div:
+        return binary([](E x, E y) { return x / y; });
+      case OpKind::Max:
+        return binary([](E x, E y) { return stablehlo::max(x, y); });
+      case OpKind::Min:
+        return binary([](E x, E y) { return stablehlo::min(x, y); });
+      case OpKind::Mul:
+        return binary([](E x, E y) { return x * y; });
+      case OpKind::Neg:
+        return unary([](E x) { return -x; });
+      case OpKind::Not:
+        return unary([](E x) { return ~x; });
+      case OpKind::Or:
+        return binary([](E x, E y) { return x | y; });
+      case OpKind::Select: {
+        int64_t pred = operands[0];
+        int64_t onTrue = operands[1];
+        int64_t onFalse = operands[2];
+        return [=](ArrayRef<Element> values) {
+          return values[pred].getBooleanValue() ? values[onTrue]
+                                                : values[onFalse];
+        };
+      }
+      case OpKind::Subtract:
+        return binary([](E x, E y) { return x - y; });
+      case OpKind::Xor:
+        return binary([](E x, E y) { return x ^ y; });
+      default:
+        return std::nullopt;
+    }
+  }
+
+  int64_t numArgs_ = 0;
+  // The closures of the ops of the region, whose results follow the
+  // arguments in the slots.
+  SmallVector<Instruction> instructions_;
+  // The slots of the results of the region.
+  Slots results_;
+};
+
+// Returns whether `computation` returns its second argument, like the update
+// computations of scatters which overwrite the input with the updates.
+bool isReplaceComputation(Region &computation) {
+  if (!computation.hasOneBlock()) return false;
+  Block &block = computation.front();
+  if (block.getNumArguments() != 2 || !llvm::hasSingleElement(block))
+    return false;
+  auto returnOp = dyn_cast<ReturnOp>(block.back());
+  return returnOp && returnOp->getNumOperands() == 1 &&
+         returnOp->getOperand(0) == block.getArgument(1);
+}
+
+// Returns an integer which compares like `value` under the totalOrder
+// predicate of IEEE 754 when both are interpreted as signed integers, i.e.
+// -NaN < -Inf < ... < -0 < +0 < ... < +Inf < +NaN. Flipping all bits but the
+// sign bit of negative values reverses their order.
+APInt getTotalOrderKey(const APFloat &value) {
+  auto bits = value.bitcastToAPInt();
+  if (bits.isNegative()) bits ^= APInt::getSignedMaxValue(bits.getBitWidth());
+  return bits;
+}
+
+// Comparators of `sortOp` which compare one pair of elements with GT or LT and
+// ignore the other elements, like the comparators of simple and key-value
+// sorts.
+struct SortComparator {
+  size_t keyIndex;
+  ComparisonDirection comparisonDirection;
+  bool isTotalOrder;
+};
+
+std::optional<SortComparator> getSortComparator(Region &comparator) {
+  if (!comparator.hasOneBlock()) return std::nullopt;
+  Block &block = comparator.front();
+  if (block.getNumArguments() % 2 != 0 || !llvm::hasNItems(block, 2))
+    return std::nullopt;
+
+  auto compare = dyn_cast<CompareOp>(block.front());
+  auto returnOp = dyn_cast<ReturnOp>(block.back());
+  if (!compare || !returnOp || returnOp->getNumOperands() != 1 ||
+      returnOp->getOperand(0) != compare.getResult())
+    return std::nullopt;
+
+  auto lhs = dyn_cast<BlockArgument>(compare.getLhs());
+  auto rhs = dyn_cast<BlockArgument>(compare.getRhs());
+  if (!lhs || !rhs || lhs.getOwner() != &block || rhs.getOwner() != &block ||
+      lhs.getArgNumber() / 2 != rhs.getArgNumber() / 2 ||
+      lhs.getArgNumber() == rhs.getArgNumber())
+    return std::nullopt;
+
+  auto comparisonDirection = compare.getComparisonDirection();
+  if (comparisonDirection != ComparisonDirection::GT &&
+      comparisonDirection != ComparisonDirection::LT)
+    return std::nullopt;
+
+  // Comparing the elements in reverse order flips the direction.
+  if (lhs.getArgNumber() > rhs.getArgNumber())
+    comparisonDirection = comparisonDirection == ComparisonDirection::GT
+                              ? ComparisonDirection::LT
+                              : ComparisonDirection::GT;
+
+  bool isTotalOrder = compare.getCompareType() == ComparisonType::TOTALORDER;
+  return SortComparator{lhs.getArgNumber() / 2, comparisonDirection,
+                        isTotalOrder};
+}
+
+using EvalOpFn =
+    llvm::function_ref<std::optional<SmallVector<InterpreterValue>>(
+        const PreparedRegion::PreparedOp &, llvm::function_ref<void()>)>;
+
+// Evaluates the ops of `region` as tasks of `threadPool`, which start once
+// the ops they depend on according to the dataflow graph of the region are
+// done, and then evaluates its terminator. Values are released once the last
+// of their users is done with them, which may be any of these users.
+SmallVector<InterpreterValue> evalDataflow(
+    const PreparedRegion &region, llvm::ThreadPoolInterface &threadPool,
+    Scope &scope, EvalOpFn evalOp) {
+  auto ops = region.getOps();
+  auto values = region.getValues();
+  auto numUsers = region.getNumUsers();
+  auto remainingUsers =
+      std::make_unique<std::atomic<unsigned>[]>(values.size());
+  for (size_t i = 0; i < values.size(); ++i) remainingUsers[i] = numUsers[i];
+  auto remainingPredecessors =
+      std::make_unique<std::atomic<unsigned>[]>(ops.size());
+  for (size_t i = 0; i < ops.size(); ++i)
+    remainingPredecessors[i] = ops[i].numPredecessors;
+
+  auto releaseUses = [&](ArrayRef<unsigned> uses) {
+    for (unsigned use : uses)
+      if (--remainingUsers[use] == 0) scope.erase(values[use]);
+  };
+
+  // Ops continue with one of the successors they make ready on the same
+  // thread, so that chains of dependent ops don't go through the pool.
+  const EvaluationContext &context = getEvaluationContext();
+  llvm::ThreadPoolTaskGroup taskGroup(threadPool);
+  std::function<void(unsigned)> evalTask = [&](unsigned position) {
+    ScopedEvaluationContext scopedContext(context);
+    for (std::optional<unsigned> next = position; next;) {
+      const auto &preparedOp = ops[*next];
+      evalOp(preparedOp, [&]() { releaseUses(preparedOp.operandUses); });
+      releaseUses(preparedOp.regionUses);
+      for (Value result : preparedOp.operation->getResults())
+        if (result.use_empty()) scope.erase(result);
+
+      next = std::nullopt;
+      for (unsigned successor : preparedOp.successors) {
+        if (--remainingPredecessors[successor] != 0) continue;
+        if (!next)
+          next = successor;
+        else
+          taskGroup.async([&evalTask, successor]() { evalTask(successor); });
+      }
+    }
+  };
+  for (unsigned i = 0; i + 1 < ops.size(); ++i)
+    if (ops[i].numPredecessors == 0)
+      taskGroup.async([&evalTask, i]() { evalTask(i); });
+  taskGroup.wait();
+
+  auto results = evalOp(ops.back(), []() {});
+  if (!results)
+    llvm::report_fatal_error("Expected a terminator when evaluating a region");
+  return std::move(*results);
 }
 
 }  // namespace
 
-SmallVector<InterpreterValue> eval(Region &region,
-                                   ArrayRef<InterpreterValue> args,
-                                   InterpreterFallback *fallback,
-                                   Process *process, Scope *parent) {
-  Block &block = region.front();
-  if (block.getArguments().size() != args.size())
-    report_fatal_error(invalidArgument(
-        "Expected same number of block arguments and runtime arguments (%d)",
-        args.size()));
+bool isDataflowExecutionEnabled() {
+  return getEvaluationContext().dataflowExecution;
+}
 
-  Scope scope(parent);
-  scope.add(block.getArguments(), args);
+namespace {
 
+// Caches which are alive, by module. Lookups skip the lock while there are
+// none.
+std::atomic<int> numPreparedRegionCaches = 0;
+std::shared_mutex preparedRegionCachesMutex;
+llvm::DenseMap<Operation *, PreparedRegionCache *> preparedRegionCaches;
+
+}  // namespace
+
+PreparedRegionCache::PreparedRegionCache(ModuleOp module) : module_(module) {
+  std::unique_lock<std::shared_mutex> lock(preparedRegionCachesMutex);
+  if (preparedRegionCaches.try_emplace(module, this).second)
+    ++numPreparedRegionCaches;
+}
+
+PreparedRegionCache::~PreparedRegionCache() {
+  std::unique_lock<std::shared_mutex> lock(preparedRegionCachesMutex);
+  auto it = preparedRegionCaches.find(module_);
+  if (it == preparedRegionCaches.end() || it->second != this) return;
+  preparedRegionCaches.erase(it);
+  --numPreparedRegionCaches;
+}
+
+const PreparedRegion &PreparedRegionCache::getOrPrepare(Region &region) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = regions_.find(&region);
+    if (it != regions_.end()) return *it->second;
+  }
+
+  // Regions are prepared outside of the lock, so that threads which prepare
+  // different regions don't wait for each other. If several threads prepare
+  // the same region, the first one wins.
+  auto prepared = std::make_unique<PreparedRegion>(region);
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  return *regions_.try_emplace(&region, std::move(prepared)).first->second;
+}
+
+std::shared_ptr<const PreparedRegion> prepareRegion(Region &region) {
+  if (numPreparedRegionCaches > 0) {
+    std::shared_lock<std::shared_mutex> lock(preparedRegionCachesMutex);
+    auto it = preparedRegionCaches.find(region.getParentOfType<ModuleOp>());
+    // Cached regions live as long as their cache, so they aren't owned.
+    if (it != preparedRegionCaches.end())
+      return std::shared_ptr<const PreparedRegion>(
+          std::shared_ptr<void>(), &it->second->getOrPrepare(region));
+  }
+  return std::make_shared<const PreparedRegion>(region);
+}
+
+PreparedRegion::PreparedRegion(Region &region) : region_(&region) {
+  Block &block = region.front();
+  auto lastUses = getLastUses(block);
   for (Operation &operation : block) {
     if (!llvm::all_of(operation.getResults(), [](OpResult r) {
           if (auto shaped = dyn_cast<ShapedType>(r.getType()))
@@ -336,752 +1520,1353 @@ SmallVector<InterpreterValue> eval(Region &region,
       llvm::report_fatal_error(
           "dynamic result types are not supported at the moment");
 
-    if (auto op = dyn_cast<AbsOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = absOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<AddOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = addOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<AfterAllOp>(operation)) {
-      auto inputs = scope.findTokens(op.getInputs());
-      auto result = afterAllOp(inputs, op->getContext());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<AllGatherOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-
-      auto replicaGroupsAttr = op.getReplicaGroups();
-      auto replicaGroupsShape = replicaGroupsAttr.getShapedType().getShape();
-      SmallVector<SmallVector<uint32_t>> replicaGroups(replicaGroupsShape[0]);
-      auto replicaGroupsIt = replicaGroupsAttr.getValues<int64_t>().begin();
-      for (auto &replicaGroup : replicaGroups)
-        for (auto i = 0; i < replicaGroupsShape[1]; ++i, ++replicaGroupsIt)
-          replicaGroup.push_back(*replicaGroupsIt);
-
-      ChannelId channelId = 0;
-      if (auto channelHandle = op.getChannelHandle())
-        channelId = channelHandle->getHandle();
-
-      auto result =
-          allGatherOp(operand, op.getAllGatherDim(), replicaGroups, channelId,
-                      op.getUseGlobalDeviceIds(), process, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<AllReduceOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto replicaGroups = getReplicaGroups(op.getReplicaGroups());
-
-      ChannelId channelId = 0;
-      if (auto channelHandle = op.getChannelHandle())
-        channelId = channelHandle->getHandle();
-
-      auto result = allReduceOp(operand, replicaGroups, channelId,
-                                op.getUseGlobalDeviceIds(), op.getComputation(),
-                                process, scope, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<AllToAllOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto replicaGroupsAttr = op.getReplicaGroups();
-      auto replicaGroupsShape = replicaGroupsAttr.getShapedType().getShape();
-      SmallVector<SmallVector<uint32_t>> replicaGroups(replicaGroupsShape[0]);
-      auto replicaGroupsIt = replicaGroupsAttr.getValues<int64_t>().begin();
-      for (auto &replicaGroup : replicaGroups)
-        for (auto i = 0; i < replicaGroupsShape[1]; ++i, ++replicaGroupsIt)
-          replicaGroup.push_back(*replicaGroupsIt);
-
-      ChannelId channelId = 0;
-      if (auto channelHandle = op.getChannelHandle())
-        channelId = channelHandle->getHandle();
-
-      auto result = allToAllOp(operand, op.getSplitDimension(),
-                               op.getConcatDimension(), op.getSplitCount(),
-                               replicaGroups, channelId, process, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<AndOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = andOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<Atan2Op>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = atan2Op(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (isa<BatchNormGradOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (isa<BatchNormInferenceOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (isa<BatchNormTrainingOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<BitcastConvertOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = bitcastConvertOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<BroadcastInDimOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto broadcastDimensions = Axes(op.getBroadcastDimensions());
-      auto result =
-          broadcastInDimOp(operand, broadcastDimensions, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (isa<BroadcastOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<func::CallOp>(operation)) {
-      auto operands = scope.findTensors(op.getOperands());
-      auto results =
-          callOp(operands, fallback, process, &operation, op.getCallee());
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<CaseOp>(operation)) {
-      auto index = scope.findTensor(op.getIndex());
-      auto branches = op.getBranches();
-      auto results = caseOp(index, branches, process, scope);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<CbrtOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = cbrtOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<CeilOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = ceilOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (isa<CholeskyOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<ClampOp>(operation)) {
-      auto min = scope.findTensor(op.getMin());
-      auto operand = scope.findTensor(op.getOperand());
-      auto max = scope.findTensor(op.getMax());
-      auto result = clampOp(min, operand, max, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ClzOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = clzOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<CollectiveBroadcastOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-
-      auto replicaGroupsAttr = op.getReplicaGroups();
-      auto replicaGroupsShape = replicaGroupsAttr.getShapedType().getShape();
-      SmallVector<SmallVector<uint32_t>> replicaGroups(replicaGroupsShape[0]);
-      auto replicaGroupsIt = replicaGroupsAttr.getValues<int64_t>().begin();
-      for (auto &replicaGroup : replicaGroups)
-        for (auto i = 0; i < replicaGroupsShape[1]; ++i, ++replicaGroupsIt)
-          replicaGroup.push_back(*replicaGroupsIt);
-
-      ChannelId channelId = 0;
-      if (auto channelHandle = op.getChannelHandle())
-        channelId = channelHandle->getHandle();
-
-      auto result =
-          collectiveBroadcastOp(operand, replicaGroups, channelId, process);
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<CollectivePermuteOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-
-      auto sourceTargetPairsAttr = op.getSourceTargetPairs();
-      SmallVector<SmallVector<uint32_t>> sourceTargetPairs(
-          sourceTargetPairsAttr.getNumElements() / 2);
-      auto sourceTargetPairsIt =
-          sourceTargetPairsAttr.getValues<int64_t>().begin();
-      for (auto &sourceTargetPair : sourceTargetPairs) {
-        sourceTargetPair.push_back(*sourceTargetPairsIt++);
-        sourceTargetPair.push_back(*sourceTargetPairsIt++);
-      }
-
-      ChannelId channelId = 0;
-      if (auto channelHandle = op.getChannelHandle())
-        channelId = channelHandle->getHandle();
-
-      auto result =
-          collectivePermuteOp(operand, sourceTargetPairs, channelId, process);
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<CompareOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto comparisonDirection = op.getComparisonDirection();
-      auto result = compareOp(lhs, rhs, comparisonDirection, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ComplexOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = complexOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<CompositeOp>(operation)) {
-      auto operands = scope.findTensors(op.getOperands());
-      auto results = callOp(operands, fallback, process, &operation,
-                            op.getDecomposition());
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<ConcatenateOp>(operation)) {
-      auto operands = scope.findTensors(op.getOperands());
-      auto result = concatenateOp(operands, op.getDimension(), op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ConstantOp>(operation)) {
-      auto result = constantOp(op.getValue());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ConvertOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = convertOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ConvolutionOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto rank = lhs.getRank();
-
-      SmallVector<int64_t> windowStrides = extractAttributeOrDefault<int64_t>(
-          op.getWindowStrides(), rank - 2, 1);
-
-      SmallVector<std::pair<int64_t, int64_t>> padding(rank - 2, {0, 0});
-      if (auto paddingAttr = op.getPaddingAttr()) {
-        auto paddingOrErr = hlo::convertPaddingAttribute(paddingAttr, {});
-        if (failed(paddingOrErr))
-          report_fatal_error(invalidArgument("Invalid padding format found."));
-        padding = *paddingOrErr;
-      }
-
-      SmallVector<int64_t> lhsDilation(rank - 2, 1);
-      if (auto lhsDilationAttr = op.getLhsDilation())
-        lhsDilation = SmallVector<int64_t>(lhsDilationAttr.value());
-
-      SmallVector<int64_t> rhsDilation(rank - 2, 1);
-      if (auto rhsDilationAttr = op.getRhsDilation())
-        rhsDilation = SmallVector<int64_t>(rhsDilationAttr.value());
-
-      SmallVector<bool> windowReversal(rank - 2, false);
-      if (auto windowReversalAttr = op.getWindowReversal())
-        windowReversal = SmallVector<bool>(windowReversalAttr.value());
-
-      auto dimensionNumbers = op.getDimensionNumbers();
-      auto result = convolutionOp(
-          lhs, rhs, windowStrides, padding, lhsDilation, rhsDilation,
-          windowReversal, dimensionNumbers.getInputBatchDimension(),
-          dimensionNumbers.getInputFeatureDimension(),
-          Axes(dimensionNumbers.getInputSpatialDimensions()),
-          dimensionNumbers.getKernelInputFeatureDimension(),
-          dimensionNumbers.getKernelOutputFeatureDimension(),
-          Axes(dimensionNumbers.getKernelSpatialDimensions()),
-          dimensionNumbers.getOutputBatchDimension(),
-          dimensionNumbers.getOutputFeatureDimension(),
-          Axes(dimensionNumbers.getOutputSpatialDimensions()),
-          op.getFeatureGroupCount(), op.getBatchGroupCount(), op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<CosineOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = cosineOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (isa<CreateTokenOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (isa<CrossReplicaSumOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<DivOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = divideOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (isa<DotOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<DotGeneralOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto lhsBatchingDimensions =
-          Axes(op.getDotDimensionNumbers().getLhsBatchingDimensions());
-      auto rhsBatchingDimensions =
-          Axes(op.getDotDimensionNumbers().getRhsBatchingDimensions());
-      auto lhsContractingDimensions =
-          Axes(op.getDotDimensionNumbers().getLhsContractingDimensions());
-      auto rhsContractingDimensions =
-          Axes(op.getDotDimensionNumbers().getRhsContractingDimensions());
-      auto result = dotGeneralOp(
-          lhs, rhs, lhsBatchingDimensions, rhsBatchingDimensions,
-          lhsContractingDimensions, rhsContractingDimensions, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<DynamicBroadcastInDimOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto broadcastDimensions = Axes(op.getBroadcastDimensions());
-      auto result =
-          broadcastInDimOp(operand, broadcastDimensions, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<DynamicConvOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto dPadding = scope.findTensor(op.getPadding());
-      auto rank = lhs.getRank();
-
-      SmallVector<int64_t> windowStrides(rank - 2, 1);
-      if (auto windowStridesAttr = op.getWindowStrides())
-        windowStrides = SmallVector<int64_t>(windowStridesAttr.value());
-
-      SmallVector<int64_t> lhsDilation(rank - 2, 1);
-      if (auto lhsDilationAttr = op.getLhsDilation())
-        lhsDilation = SmallVector<int64_t>(lhsDilationAttr.value());
-
-      SmallVector<int64_t> rhsDilation(rank - 2, 1);
-      if (auto rhsDilationAttr = op.getRhsDilation())
-        rhsDilation = SmallVector<int64_t>(rhsDilationAttr.value());
-
-      SmallVector<bool> windowReversal(rank - 2, false);
-      if (auto windowReversalAttr = op.getWindowReversal())
-        windowReversal = SmallVector<bool>(windowReversalAttr.value());
-
-      auto dimensionNumbers = op.getDimensionNumbers();
-      SmallVector<std::pair<int64_t, int64_t>> padding;
-      for (auto it = dPadding.index_begin(); it != dPadding.index_end(); ++it) {
-        auto paddingLow = dPadding.get(*it).getIntegerValue().getSExtValue();
-        auto paddingHigh =
-            dPadding.get(*(++it)).getIntegerValue().getSExtValue();
-        padding.push_back({paddingLow, paddingHigh});
-      }
-      auto result = convolutionOp(
-          lhs, rhs, windowStrides, padding, lhsDilation, rhsDilation,
-          windowReversal, dimensionNumbers.getInputBatchDimension(),
-          dimensionNumbers.getInputFeatureDimension(),
-          Axes(dimensionNumbers.getInputSpatialDimensions()),
-          dimensionNumbers.getKernelInputFeatureDimension(),
-          dimensionNumbers.getKernelOutputFeatureDimension(),
-          Axes(dimensionNumbers.getKernelSpatialDimensions()),
-          dimensionNumbers.getOutputBatchDimension(),
-          dimensionNumbers.getOutputFeatureDimension(),
-          Axes(dimensionNumbers.getOutputSpatialDimensions()),
-          op.getFeatureGroupCount(), op.getBatchGroupCount(), op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<DynamicGatherOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto startIndices = scope.findTensor(op.getStartIndices());
-      auto sliceSizes = scope.findTensor(op.getSliceSizes());
-      auto result = gatherOp(
-          operand, startIndices, Axes(op.getDimensionNumbers().getOffsetDims()),
-          Axes(op.getDimensionNumbers().getCollapsedSliceDims()),
-          Axes(op.getDimensionNumbers().getOperandBatchingDims()),
-          Axes(op.getDimensionNumbers().getStartIndicesBatchingDims()),
-          Axes(op.getDimensionNumbers().getStartIndexMap()),
-          Axis(op.getDimensionNumbers().getIndexVectorDim()),
-          makeSizes(sliceSizes), op.getIndicesAreSorted(), op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<DynamicIotaOp>(operation)) {
-      auto iotaDimension = op.getIotaDimension();
-      auto result = iotaOp(iotaDimension, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<DynamicPadOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto paddingValue = scope.findTensor(op.getPaddingValue());
-      auto edgePaddingLow = scope.findTensor(op.getEdgePaddingLow());
-      auto edgePaddingHigh = scope.findTensor(op.getEdgePaddingHigh());
-      auto interiorPadding = scope.findTensor(op.getInteriorPadding());
-      auto result =
-          padOp(operand, paddingValue, makeSizes(edgePaddingLow),
-                makeSizes(edgePaddingHigh), makeSizes(interiorPadding));
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<DynamicReshapeOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = reshapeOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<DynamicSliceOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto startIndices = scope.findTensors(op.getStartIndices());
-      auto sliceSizes = Sizes(op.getSliceSizes());
-      auto result =
-          dynamicSliceOp(operand, startIndices, sliceSizes, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<DynamicUpdateSliceOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto update = scope.findTensor(op.getUpdate());
-      auto startIndices = scope.findTensors(op.getStartIndices());
-      auto result =
-          dynamicUpdateSliceOp(operand, update, startIndices, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (isa<EinsumOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<ExpOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = exponentialOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<Expm1Op>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = expm1Op(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<FloorOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = floorOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<GatherOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto startIndices = scope.findTensor(op.getStartIndices());
-      auto result = gatherOp(
-          operand, startIndices, Axes(op.getDimensionNumbers().getOffsetDims()),
-          Axes(op.getDimensionNumbers().getCollapsedSliceDims()),
-          Axes(op.getDimensionNumbers().getOperandBatchingDims()),
-          Axes(op.getDimensionNumbers().getStartIndicesBatchingDims()),
-          Axes(op.getDimensionNumbers().getStartIndexMap()),
-          Axis(op.getDimensionNumbers().getIndexVectorDim()),
-          Sizes(op.getSliceSizes()), op.getIndicesAreSorted(), op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<GetDimensionSizeOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto dimension = op.getDimension();
-      auto result = getDimensionSizeOp(operand, dimension, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<GetTupleElementOp>(operation)) {
-      auto operand = scope.findTuple(op.getOperand());
-      auto result = getTupleElementOp(operand, op.getIndex());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<IfOp>(operation)) {
-      auto pred = scope.findTensor(op.getPred());
-      auto &trueBranch = op.getTrueBranch();
-      auto &falseBranch = op.getFalseBranch();
-      auto results = ifOp(pred, trueBranch, falseBranch, process, scope);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<ImagOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = imagOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<InfeedOp>(operation)) {
-      auto token = scope.findToken(op.getToken());
-      auto results = infeedOp(token, process, region, scope);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<IotaOp>(operation)) {
-      auto iotaDimension = op.getIotaDimension();
-      auto result = iotaOp(iotaDimension, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<IsFiniteOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = isFiniteOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<Log1pOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = log1pOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<LogOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = logOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<LogisticOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = logisticOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<MapOp>(operation)) {
-      auto inputs = scope.findTensors(op.getInputs());
-      auto &computation = op.getComputation();
-      auto result = mapOp(inputs, computation, process, scope, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<MaxOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = maxOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<MinOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = minOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<MulOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = multiplyOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<NegOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = negOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<NotOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = notOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<OptimizationBarrierOp>(operation)) {
-      auto operand = scope.find(op.getOperand());
-      auto results = optimizationBarrierOp(operand);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<OrOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = orOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<OutfeedOp>(operation)) {
-      auto inputs = scope.findTensors(op.getInputs());
-      auto token = scope.findToken(op.getToken());
-      auto result = outfeedOp(inputs, token, process);
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<PadOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto paddingValue = scope.findTensor(op.getPaddingValue());
-      auto edgePaddingLow = Sizes(op.getEdgePaddingLow());
-      auto interiorPadding = Sizes(op.getInteriorPadding());
-      auto result = padOp(operand, paddingValue, edgePaddingLow,
-                          interiorPadding, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<PartitionIdOp>(operation)) {
-      auto result = partitionIdOp(process, op.getContext());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<PopulationCountOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = populationCountOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<PowOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = powerOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<RealOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = realOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<RecvOp>(operation)) {
-      auto token = scope.findToken(op.getToken());
-      ChannelId channelId = 0;
-      if (auto channelHandle = op.getChannelHandle())
-        channelId = channelHandle.getHandle();
-      auto results = recvOp(token, channelId, process);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<ReduceOp>(operation)) {
-      auto inputs = scope.findTensors(op.getInputs());
-      auto initValues = scope.findTensors(op.getInitValues());
-      SmallVector<ShapedType> resultTypes;
-      for (auto resultType : op.getResultTypes())
-        resultTypes.push_back(cast<ShapedType>(resultType));
-      auto results = reduceOp(inputs, initValues, Axes(op.getDimensions()),
-                              op.getBody(), process, scope, resultTypes);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<ReducePrecisionOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      int32_t exponentBits = op.getExponentBits();
-      int32_t mantissaBits = op.getMantissaBits();
-      auto result =
-          reducePrecisionOp(operand, exponentBits, mantissaBits, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ReduceScatterOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      int64_t scatterDimension = op.getScatterDimension();
-      auto replicaGroups = getReplicaGroups(op.getReplicaGroups());
-
-      ChannelId channelId = 0;
-      if (auto channelHandle = op.getChannelHandle())
-        channelId = channelHandle->getHandle();
-
-      auto result =
-          reduceScatterOp(operand, scatterDimension, replicaGroups, channelId,
-                          op.getUseGlobalDeviceIds(), op.getComputation(),
-                          process, scope, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ReduceWindowOp>(operation)) {
-      auto inputs = scope.findTensors(op.getInputs());
-      auto initValues = scope.findTensors(op.getInitValues());
-      int64_t rank = inputs[0].getRank();
-
-      Sizes windowStrides(rank, 1);
-      if (auto windowStridesAttr = op.getWindowStrides())
-        windowStrides = Sizes(*windowStridesAttr);
-
-      Sizes baseDilations(rank, 1);
-      if (auto baseDilationsAttr = op.getBaseDilations())
-        baseDilations = Sizes(*baseDilationsAttr);
-
-      Sizes windowDilations(rank, 1);
-      if (auto windowDilationsAttr = op.getWindowDilations())
-        windowDilations = Sizes(*windowDilationsAttr);
-
-      Sizes paddingLow(rank, 0), paddingHigh(rank, 0);
-      if (auto paddingAttr = op.getPadding()) {
-        auto paddingOrErr = hlo::convertPaddingAttribute(paddingAttr, {});
-        if (failed(paddingOrErr))
-          report_fatal_error(invalidArgument("Invalid padding format found."));
-        for (auto i = 0; i < static_cast<int64_t>(paddingOrErr->size()); ++i) {
-          paddingLow[i] = (*paddingOrErr)[i].first;
-          paddingHigh[i] = (*paddingOrErr)[i].second;
+    PreparedOp preparedOp{&operation, getOpKind(operation), {}, {}};
+    if (preparedOp.kind == OpKind::Constant) {
+      auto op = cast<ConstantOp>(operation);
+      preparedOp.constant = constantOp(op.getValue());
+      if (isSupportedQuantizedType(op.getType().getElementType()))
+        preparedOp.constant =
+            makeQuantizedTensor(preparedOp.constant, op.getType());
+    }
+    for (Value value : lastUses.lookup(&operation)) {
+      bool isOperand =
+          value.getDefiningOp() != &operation &&
+          llvm::none_of(value.getUsers(), [&](Operation *user) {
+            return operation.isProperAncestor(user);
+          });
+      if (isOperand)
+        preparedOp.deadOperands.push_back(value);
+      else
+        preparedOp.deadValues.push_back(value);
+    }
+    ops_.push_back(std::move(preparedOp));
+  }
+  if (!isDataflowExecutionEnabled()) return;
+
+  // Ops depend on the ops which define the values they use, and ops with side
+  // effects also depend on the previous op with side effects. The terminator
+  // is evaluated after all other ops and isn't part of the graph, but counts
+  // as a user of the values it returns, so that they are never released.
+  llvm::DenseMap<Operation *, unsigned> positions;
+  llvm::DenseMap<Value, unsigned> valuePositions;
+  auto addValue = [&](Value value) {
+    if (value.use_empty()) return;
+    valuePositions[value] = values_.size();
+    values_.push_back(value);
+    numUsers_.push_back(0);
+  };
+  for (Value argument : block.getArguments()) addValue(argument);
+  for (unsigned position = 0; position < ops_.size(); ++position) {
+    positions[ops_[position].operation] = position;
+    for (Value result : ops_[position].operation->getResults())
+      addValue(result);
+  }
+
+  std::optional<unsigned> lastOpWithSideEffects;
+  for (unsigned position = 0; position < ops_.size(); ++position) {
+    auto &preparedOp = ops_[position];
+    Operation *operation = preparedOp.operation;
+    llvm::SetVector<unsigned> operandUses, regionUses;
+    operation->walk([&](Operation *user) {
+      for (Value operand : user->getOperands()) {
+        auto it = valuePositions.find(operand);
+        if (it == valuePositions.end()) continue;
+        (user == operation ? operandUses : regionUses).insert(it->second);
+      }
+    });
+    operandUses.remove_if(
+        [&](unsigned use) { return regionUses.contains(use); });
+
+    llvm::SetVector<unsigned> predecessors;
+    auto addUses = [&](ArrayRef<unsigned> uses) {
+      for (unsigned use : uses) {
+        ++numUsers_[use];
+        if (Operation *definingOp = values_[use].getDefiningOp())
+          predecessors.insert(positions[definingOp]);
+      }
+    };
+    addUses(operandUses.getArrayRef());
+    addUses(regionUses.getArrayRef());
+    preparedOp.operandUses.assign(operandUses.begin(), operandUses.end());
+    preparedOp.regionUses.assign(regionUses.begin(), regionUses.end());
+    if (position + 1 == ops_.size()) break;
+
+    if (preparedOp.kind == OpKind::Unknown || !isMemoryEffectFree(operation)) {
+      if (lastOpWithSideEffects) predecessors.insert(*lastOpWithSideEffects);
+      lastOpWithSideEffects = position;
+    }
+    preparedOp.numPredecessors = predecessors.size();
+    for (unsigned predecessor : predecessors)
+      ops_[predecessor].successors.push_back(position);
+    if (position != 0 && !predecessors.contains(position - 1))
+      hasConcurrentOps_ = true;
+  }
+}
+
+bool isInterpretable(Operation &operation) {
+  auto result = operation.walk([](Operation *op) {
+    return getOpKind(*op) == OpKind::Unknown ? WalkResult::interrupt()
+                                             : WalkResult::advance();
+  });
+  return !result.wasInterrupted();
+}
+
+SmallVector<InterpreterValue> eval(Region &region,
+                                   ArrayRef<InterpreterValue> args,
+                                   InterpreterFallback *fallback,
+                                   Process *process, Scope *parent) {
+  return eval(*prepareRegion(region), SmallVector<InterpreterValue>(args),
+              fallback, process, parent);
+}
+
+SmallVector<InterpreterValue> eval(const PreparedRegion &region,
+                                   SmallVector<InterpreterValue> args,
+                                   InterpreterFallback *fallback,
+                                   Process *process, Scope *parent) {
+  Scope scope(parent);
+  return evalInScope(region, std::move(args), fallback, process, scope);
+}
+
+SmallVector<InterpreterValue> evalInScope(const PreparedRegion &region,
+                                          SmallVector<InterpreterValue> args,
+                                          InterpreterFallback *fallback,
+                                          Process *process, Scope &scope) {
+  Block &block = region.getRegion().front();
+  if (block.getArguments().size() != args.size())
+    report_fatal_error(invalidArgument(
+        "Expected same number of block arguments and runtime arguments (%d)",
+        args.size()));
+
+  // Moves the arguments into the scope, so that it holds the only references
+  // to those which aren't referenced elsewhere.
+  for (auto [blockArg, arg] : llvm::zip(block.getArguments(), args))
+    scope.add(blockArg, std::move(arg));
+  args.clear();
+
+  // Evaluates `preparedOp` and returns the results of the region if it is its
+  // terminator. `releaseOperands` releases the operands which are dead after
+  // the op. Ops whose kernels can reuse the storage of their operands call it
+  // before evaluation, so that they hold the only references to these
+  // operands, and it is called after evaluation otherwise.
+  auto evalOp = [&](const PreparedRegion::PreparedOp &preparedOp,
+                    llvm::function_ref<void()> releaseOperands)
+      -> std::optional<SmallVector<InterpreterValue>> {
+    Operation &operation = *preparedOp.operation;
+    std::optional<ScopedOpProfile> profile;
+    if (auto *profiler = getProfiler()) profile.emplace(*profiler, operation);
+    std::optional<ScopedOpMemory> memory;
+    if (getMemoryTracker()) memory.emplace(operation);
+
+    bool releasedDeadOperands = false;
+    auto releaseDeadOperands = [&]() {
+      releaseOperands();
+      releasedDeadOperands = true;
+    };
+
+    switch (preparedOp.kind) {
+      case OpKind::Abs: {
+        auto op = cast<AbsOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = absOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Add: {
+        auto op = cast<AddOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        releaseDeadOperands();
+        auto result = addOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::AfterAll: {
+        auto op = cast<AfterAllOp>(operation);
+        auto inputs = scope.findTokens(op.getInputs());
+        auto result = afterAllOp(inputs, op->getContext());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::AllGather: {
+        auto op = cast<AllGatherOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+
+        auto replicaGroupsAttr = op.getReplicaGroups();
+        auto replicaGroupsShape = replicaGroupsAttr.getShapedType().getShape();
+        SmallVector<SmallVector<uint32_t>> replicaGroups(replicaGroupsShape[0]);
+        auto replicaGroupsIt = replicaGroupsAttr.getValues<int64_t>().begin();
+        for (auto &replicaGroup : replicaGroups)
+          for (auto i = 0; i < replicaGroupsShape[1]; ++i, ++replicaGroupsIt)
+            replicaGroup.push_back(*replicaGroupsIt);
+
+        ChannelId channelId = 0;
+        if (auto channelHandle = op.getChannelHandle())
+          channelId = channelHandle->getHandle();
+
+        auto result =
+            allGatherOp(operand, op.getAllGatherDim(), replicaGroups, channelId,
+                        op.getUseGlobalDeviceIds(), process, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::AllReduce: {
+        auto op = cast<AllReduceOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto replicaGroups = getReplicaGroups(op.getReplicaGroups());
+
+        ChannelId channelId = 0;
+        if (auto channelHandle = op.getChannelHandle())
+          channelId = channelHandle->getHandle();
+
+        auto result =
+            allReduceOp(operand, replicaGroups, channelId,
+                        op.getUseGlobalDeviceIds(), op.getComputation(),
+                        process, scope, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::AllToAll: {
+        auto op = cast<AllToAllOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto replicaGroupsAttr = op.getReplicaGroups();
+        auto replicaGroupsShape = replicaGroupsAttr.getShapedType().getShape();
+        SmallVector<SmallVector<uint32_t>> replicaGroups(replicaGroupsShape[0]);
+        auto replicaGroupsIt = replicaGroupsAttr.getValues<int64_t>().begin();
+        for (auto &replicaGroup : replicaGroups)
+          for (auto i = 0; i < replicaGroupsShape[1]; ++i, ++replicaGroupsIt)
+            replicaGroup.push_back(*replicaGroupsIt);
+
+        ChannelId channelId = 0;
+        if (auto channelHandle = op.getChannelHandle())
+          channelId = channelHandle->getHandle();
+
+        auto result =
+            allToAllOp(operand, op.getSplitDimension(), op.getConcatDimension(),
+                       op.getSplitCount(), replicaGroups, channelId, process,
+                       op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::And: {
+        auto op = cast<AndOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = andOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Atan2: {
+        auto op = cast<Atan2Op>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = atan2Op(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::BatchNormGrad: {
+        auto op = cast<BatchNormGradOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto scale = scope.findTensor(op.getScale());
+        auto mean = scope.findTensor(op.getMean());
+        auto variance = scope.findTensor(op.getVariance());
+        auto gradOutput = scope.findTensor(op.getGradOutput());
+        auto results = batchNormGradOp(
+            operand, scale, mean, variance, gradOutput,
+            op.getEpsilon().convertToDouble(), op.getFeatureIndex(),
+            op.getGradOperand().getType(), op.getGradScale().getType(),
+            op.getGradOffset().getType());
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::BatchNormInference: {
+        auto op = cast<BatchNormInferenceOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto scale = scope.findTensor(op.getScale());
+        auto offset = scope.findTensor(op.getOffset());
+        auto mean = scope.findTensor(op.getMean());
+        auto variance = scope.findTensor(op.getVariance());
+        auto result = batchNormInferenceOp(
+            operand, scale, offset, mean, variance,
+            op.getEpsilon().convertToDouble(), op.getFeatureIndex(),
+            op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::BatchNormTraining: {
+        auto op = cast<BatchNormTrainingOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto scale = scope.findTensor(op.getScale());
+        auto offset = scope.findTensor(op.getOffset());
+        auto results = batchNormTrainingOp(
+            operand, scale, offset, op.getEpsilon().convertToDouble(),
+            op.getFeatureIndex(), op.getOutput().getType(),
+            op.getBatchMean().getType(), op.getBatchVar().getType());
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::BitcastConvert: {
+        auto op = cast<BitcastConvertOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = bitcastConvertOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::BroadcastInDim: {
+        auto op = cast<BroadcastInDimOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto broadcastDimensions = Axes(op.getBroadcastDimensions());
+        auto result =
+            broadcastInDimOp(operand, broadcastDimensions, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Broadcast: {
+        failOnDecomposableOp(operation);
+        break;
+      }
+      case OpKind::FuncCall: {
+        auto op = cast<func::CallOp>(operation);
+        auto operands = scope.findTensors(op.getOperands());
+        auto results =
+            callOp(operands, fallback, process, &operation, op.getCallee());
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Case: {
+        auto op = cast<CaseOp>(operation);
+        auto index = scope.findTensor(op.getIndex());
+        auto branches = op.getBranches();
+        auto results = caseOp(index, branches, process, scope);
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Cbrt: {
+        auto op = cast<CbrtOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = cbrtOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Ceil: {
+        auto op = cast<CeilOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = ceilOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Cholesky: {
+        auto op = cast<CholeskyOp>(operation);
+        auto a = scope.findTensor(op.getA());
+        auto result = choleskyOp(a, op.getLower(), op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Clamp: {
+        auto op = cast<ClampOp>(operation);
+        auto min = scope.findTensor(op.getMin());
+        auto operand = scope.findTensor(op.getOperand());
+        auto max = scope.findTensor(op.getMax());
+        auto result = clampOp(min, operand, max, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Clz: {
+        auto op = cast<ClzOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = clzOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::CollectiveBroadcast: {
+        auto op = cast<CollectiveBroadcastOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+
+        auto replicaGroupsAttr = op.getReplicaGroups();
+        auto replicaGroupsShape = replicaGroupsAttr.getShapedType().getShape();
+        SmallVector<SmallVector<uint32_t>> replicaGroups(replicaGroupsShape[0]);
+        auto replicaGroupsIt = replicaGroupsAttr.getValues<int64_t>().begin();
+        for (auto &replicaGroup : replicaGroups)
+          for (auto i = 0; i < replicaGroupsShape[1]; ++i, ++replicaGroupsIt)
+            replicaGroup.push_back(*replicaGroupsIt);
+
+        ChannelId channelId = 0;
+        if (auto channelHandle = op.getChannelHandle())
+          channelId = channelHandle->getHandle();
+
+        auto result =
+            collectiveBroadcastOp(operand, replicaGroups, channelId, process);
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::CollectivePermute: {
+        auto op = cast<CollectivePermuteOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+
+        auto sourceTargetPairsAttr = op.getSourceTargetPairs();
+        SmallVector<SmallVector<uint32_t>> sourceTargetPairs(
+            sourceTargetPairsAttr.getNumElements() / 2);
+        auto sourceTargetPairsIt =
+            sourceTargetPairsAttr.getValues<int64_t>().begin();
+        for (auto &sourceTargetPair : sourceTargetPairs) {
+          sourceTargetPair.push_back(*sourceTargetPairsIt++);
+          sourceTargetPair.push_back(*sourceTargetPairsIt++);
         }
+
+        ChannelId channelId = 0;
+        if (auto channelHandle = op.getChannelHandle())
+          channelId = channelHandle->getHandle();
+
+        auto result =
+            collectivePermuteOp(operand, sourceTargetPairs, channelId, process);
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Compare: {
+        auto op = cast<CompareOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto comparisonDirection = op.getComparisonDirection();
+        auto result = compareOp(lhs, rhs, comparisonDirection,
+                                op.getCompareType(), op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Complex: {
+        auto op = cast<ComplexOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = complexOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Composite: {
+        auto op = cast<CompositeOp>(operation);
+        auto operands = scope.findTensors(op.getOperands());
+        if (auto results = evalWithRegisteredKernel(operation, operands)) {
+          if (!*results) llvm::report_fatal_error(results->takeError());
+          scope.add(op.getResults(), **results);
+          break;
+        }
+        auto results = callOp(operands, fallback, process, &operation,
+                              op.getDecomposition());
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Concatenate: {
+        auto op = cast<ConcatenateOp>(operation);
+        auto operands = scope.findTensors(op.getOperands());
+        auto result = concatenateOp(operands, op.getDimension(), op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Constant: {
+        auto op = cast<ConstantOp>(operation);
+        scope.add(op.getResult(), preparedOp.constant);
+        break;
+      }
+      case OpKind::Convert: {
+        auto op = cast<ConvertOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        releaseDeadOperands();
+        auto result = convertOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Convolution: {
+        auto op = cast<ConvolutionOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto rank = lhs.getRank();
+
+        SmallVector<int64_t> windowStrides = extractAttributeOrDefault<int64_t>(
+            op.getWindowStrides(), rank - 2, 1);
+
+        SmallVector<std::pair<int64_t, int64_t>> padding(rank - 2, {0, 0});
+        if (auto paddingAttr = op.getPaddingAttr()) {
+          auto paddingOrErr = hlo::convertPaddingAttribute(paddingAttr, {});
+          if (failed(paddingOrErr))
+            report_fatal_error(
+                invalidArgument("Invalid padding format found."));
+          padding = *paddingOrErr;
+        }
+
+        SmallVector<int64_t> lhsDilation(rank - 2, 1);
+        if (auto lhsDilationAttr = op.getLhsDilation())
+          lhsDilation = SmallVector<int64_t>(lhsDilationAttr.value());
+
+        SmallVector<int64_t> rhsDilation(rank - 2, 1);
+        if (auto rhsDilationAttr = op.getRhsDilation())
+          rhsDilation = SmallVector<int64_t>(rhsDilationAttr.value());
+
+        SmallVector<bool> windowReversal(rank - 2, false);
+        if (auto windowReversalAttr = op.getWindowReversal())
+          windowReversal = SmallVector<bool>(windowReversalAttr.value());
+
+        auto dimensionNumbers = op.getDimensionNumbers();
+        auto result = convolutionOp(
+            lhs, rhs, windowStrides, padding, lhsDilation, rhsDilation,
+            windowReversal, dimensionNumbers.getInputBatchDimension(),
+            dimensionNumbers.getInputFeatureDimension(),
+            Axes(dimensionNumbers.getInputSpatialDimensions()),
+            dimensionNumbers.getKernelInputFeatureDimension(),
+            dimensionNumbers.getKernelOutputFeatureDimension(),
+            Axes(dimensionNumbers.getKernelSpatialDimensions()),
+            dimensionNumbers.getOutputBatchDimension(),
+            dimensionNumbers.getOutputFeatureDimension(),
+            Axes(dimensionNumbers.getOutputSpatialDimensions()),
+            op.getFeatureGroupCount(), op.getBatchGroupCount(), op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Cosine: {
+        auto op = cast<CosineOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = cosineOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::CreateToken: {
+        failOnDecomposableOp(operation);
+        break;
+      }
+      case OpKind::CrossReplicaSum: {
+        failOnDecomposableOp(operation);
+        break;
+      }
+      case OpKind::DequantizeOpQuantize: {
+        auto operands = scope.findTensors(operation.getOperands());
+        releaseDeadOperands();
+        auto result = dequantizeOpQuantize(
+            operands, cast<ShapedType>(operation.getResult(0).getType()),
+            [&](ArrayRef<Tensor> dequantizedOperands, ShapedType resultType) {
+              return evalDequantizedOp(operation, dequantizedOperands,
+                                       resultType);
+            });
+        scope.add(operation.getResult(0), result);
+        break;
+      }
+      case OpKind::Div: {
+        auto op = cast<DivOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        releaseDeadOperands();
+        auto result = divideOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Dot: {
+        failOnDecomposableOp(operation);
+        break;
+      }
+      case OpKind::DotGeneral: {
+        auto op = cast<DotGeneralOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto lhsBatchingDimensions =
+            Axes(op.getDotDimensionNumbers().getLhsBatchingDimensions());
+        auto rhsBatchingDimensions =
+            Axes(op.getDotDimensionNumbers().getRhsBatchingDimensions());
+        auto lhsContractingDimensions =
+            Axes(op.getDotDimensionNumbers().getLhsContractingDimensions());
+        auto rhsContractingDimensions =
+            Axes(op.getDotDimensionNumbers().getRhsContractingDimensions());
+        auto result = dotGeneralOp(
+            lhs, rhs, lhsBatchingDimensions, rhsBatchingDimensions,
+            lhsContractingDimensions, rhsContractingDimensions, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::DynamicBroadcastInDim: {
+        auto op = cast<DynamicBroadcastInDimOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto broadcastDimensions = Axes(op.getBroadcastDimensions());
+        auto result =
+            broadcastInDimOp(operand, broadcastDimensions, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::DynamicConv: {
+        auto op = cast<DynamicConvOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto dPadding = scope.findTensor(op.getPadding());
+        auto rank = lhs.getRank();
+
+        SmallVector<int64_t> windowStrides(rank - 2, 1);
+        if (auto windowStridesAttr = op.getWindowStrides())
+          windowStrides = SmallVector<int64_t>(windowStridesAttr.value());
+
+        SmallVector<int64_t> lhsDilation(rank - 2, 1);
+        if (auto lhsDilationAttr = op.getLhsDilation())
+          lhsDilation = SmallVector<int64_t>(lhsDilationAttr.value());
+
+        SmallVector<int64_t> rhsDilation(rank - 2, 1);
+        if (auto rhsDilationAttr = op.getRhsDilation())
+          rhsDilation = SmallVector<int64_t>(rhsDilationAttr.value());
+
+        SmallVector<bool> windowReversal(rank - 2, false);
+        if (auto windowReversalAttr = op.getWindowReversal())
+          windowReversal = SmallVector<bool>(windowReversalAttr.value());
+
+        auto dimensionNumbers = op.getDimensionNumbers();
+        SmallVector<std::pair<int64_t, int64_t>> padding;
+        for (auto it = dPadding.index_begin(); it != dPadding.index_end();
+             ++it) {
+          auto paddingLow = dPadding.get(*it).getIntegerValue().getSExtValue();
+          auto paddingHigh =
+              dPadding.get(*(++it)).getIntegerValue().getSExtValue();
+          padding.push_back({paddingLow, paddingHigh});
+        }
+        auto result = convolutionOp(
+            lhs, rhs, windowStrides, padding, lhsDilation, rhsDilation,
+            windowReversal, dimensionNumbers.getInputBatchDimension(),
+            dimensionNumbers.getInputFeatureDimension(),
+            Axes(dimensionNumbers.getInputSpatialDimensions()),
+            dimensionNumbers.getKernelInputFeatureDimension(),
+            dimensionNumbers.getKernelOutputFeatureDimension(),
+            Axes(dimensionNumbers.getKernelSpatialDimensions()),
+            dimensionNumbers.getOutputBatchDimension(),
+            dimensionNumbers.getOutputFeatureDimension(),
+            Axes(dimensionNumbers.getOutputSpatialDimensions()),
+            op.getFeatureGroupCount(), op.getBatchGroupCount(), op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::DynamicGather: {
+        auto op = cast<DynamicGatherOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto startIndices = scope.findTensor(op.getStartIndices());
+        auto sliceSizes = scope.findTensor(op.getSliceSizes());
+        auto result = gatherOp(
+            operand, startIndices,
+            Axes(op.getDimensionNumbers().getOffsetDims()),
+            Axes(op.getDimensionNumbers().getCollapsedSliceDims()),
+            Axes(op.getDimensionNumbers().getOperandBatchingDims()),
+            Axes(op.getDimensionNumbers().getStartIndicesBatchingDims()),
+            Axes(op.getDimensionNumbers().getStartIndexMap()),
+            Axis(op.getDimensionNumbers().getIndexVectorDim()),
+            makeSizes(sliceSizes), op.getIndicesAreSorted(), op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::DynamicIota: {
+        auto op = cast<DynamicIotaOp>(operation);
+        auto iotaDimension = op.getIotaDimension();
+        auto result = iotaOp(iotaDimension, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::DynamicPad: {
+        auto op = cast<DynamicPadOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto paddingValue = scope.findTensor(op.getPaddingValue());
+        auto edgePaddingLow = scope.findTensor(op.getEdgePaddingLow());
+        auto edgePaddingHigh = scope.findTensor(op.getEdgePaddingHigh());
+        auto interiorPadding = scope.findTensor(op.getInteriorPadding());
+        auto result =
+            padOp(operand, paddingValue, makeSizes(edgePaddingLow),
+                  makeSizes(edgePaddingHigh), makeSizes(interiorPadding));
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::DynamicReshape: {
+        auto op = cast<DynamicReshapeOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = reshapeOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::DynamicSlice: {
+        auto op = cast<DynamicSliceOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto startIndices = scope.findTensors(op.getStartIndices());
+        auto sliceSizes = Sizes(op.getSliceSizes());
+        auto result =
+            dynamicSliceOp(operand, startIndices, sliceSizes, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::DynamicUpdateSlice: {
+        auto op = cast<DynamicUpdateSliceOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto update = scope.findTensor(op.getUpdate());
+        auto startIndices = scope.findTensors(op.getStartIndices());
+        releaseDeadOperands();
+        auto result =
+            dynamicUpdateSliceOp(operand, update, startIndices, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Einsum: {
+        failOnDecomposableOp(operation);
+        break;
+      }
+      case OpKind::Exp: {
+        auto op = cast<ExpOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = exponentialOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Expm1: {
+        auto op = cast<Expm1Op>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = expm1Op(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Fft: {
+        auto op = cast<FftOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = fftOp(operand, op.getFftType(), op.getFftLength(),
+                            op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Floor: {
+        auto op = cast<FloorOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = floorOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Gather: {
+        auto op = cast<GatherOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto startIndices = scope.findTensor(op.getStartIndices());
+        auto result = gatherOp(
+            operand, startIndices,
+            Axes(op.getDimensionNumbers().getOffsetDims()),
+            Axes(op.getDimensionNumbers().getCollapsedSliceDims()),
+            Axes(op.getDimensionNumbers().getOperandBatchingDims()),
+            Axes(op.getDimensionNumbers().getStartIndicesBatchingDims()),
+            Axes(op.getDimensionNumbers().getStartIndexMap()),
+            Axis(op.getDimensionNumbers().getIndexVectorDim()),
+            Sizes(op.getSliceSizes()), op.getIndicesAreSorted(), op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::GetDimensionSize: {
+        auto op = cast<GetDimensionSizeOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto dimension = op.getDimension();
+        auto result = getDimensionSizeOp(operand, dimension, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::GetTupleElement: {
+        auto op = cast<GetTupleElementOp>(operation);
+        auto operand = scope.findTuple(op.getOperand());
+        auto result = getTupleElementOp(operand, op.getIndex());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::If: {
+        auto op = cast<IfOp>(operation);
+        auto pred = scope.findTensor(op.getPred());
+        auto &trueBranch = op.getTrueBranch();
+        auto &falseBranch = op.getFalseBranch();
+        auto results = ifOp(pred, trueBranch, falseBranch, process, scope);
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Imag: {
+        auto op = cast<ImagOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = imagOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Infeed: {
+        auto op = cast<InfeedOp>(operation);
+        auto token = scope.findToken(op.getToken());
+        auto results = infeedOp(token, process, region.getRegion(), scope);
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Iota: {
+        auto op = cast<IotaOp>(operation);
+        auto iotaDimension = op.getIotaDimension();
+        auto result = iotaOp(iotaDimension, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::IsFinite: {
+        auto op = cast<IsFiniteOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = isFiniteOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Log1p: {
+        auto op = cast<Log1pOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = log1pOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Log: {
+        auto op = cast<LogOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = logOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Logistic: {
+        auto op = cast<LogisticOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = logisticOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Map: {
+        auto op = cast<MapOp>(operation);
+        auto inputs = scope.findTensors(op.getInputs());
+        auto &computation = op.getComputation();
+        auto result = mapOp(inputs, computation, process, scope, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Max: {
+        auto op = cast<MaxOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        releaseDeadOperands();
+        auto result = maxOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Min: {
+        auto op = cast<MinOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        releaseDeadOperands();
+        auto result = minOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Mul: {
+        auto op = cast<MulOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        releaseDeadOperands();
+        auto result = multiplyOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Neg: {
+        auto op = cast<NegOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = negOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Not: {
+        auto op = cast<NotOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = notOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::OptimizationBarrier: {
+        auto op = cast<OptimizationBarrierOp>(operation);
+        auto operand = scope.find(op.getOperand());
+        auto results = optimizationBarrierOp(operand);
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Or: {
+        auto op = cast<OrOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = orOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Outfeed: {
+        auto op = cast<OutfeedOp>(operation);
+        auto inputs = scope.findTensors(op.getInputs());
+        auto token = scope.findToken(op.getToken());
+        auto result = outfeedOp(inputs, token, process);
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Pad: {
+        auto op = cast<PadOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto paddingValue = scope.findTensor(op.getPaddingValue());
+        auto edgePaddingLow = Sizes(op.getEdgePaddingLow());
+        auto interiorPadding = Sizes(op.getInteriorPadding());
+        auto result = padOp(operand, paddingValue, edgePaddingLow,
+                            interiorPadding, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::PartitionId: {
+        auto op = cast<PartitionIdOp>(operation);
+        auto result = partitionIdOp(process, op.getContext());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::PopulationCount: {
+        auto op = cast<PopulationCountOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = populationCountOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Pow: {
+        auto op = cast<PowOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = powerOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Real: {
+        auto op = cast<RealOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = realOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Recv: {
+        auto op = cast<RecvOp>(operation);
+        auto token = scope.findToken(op.getToken());
+        ChannelId channelId = 0;
+        if (auto channelHandle = op.getChannelHandle())
+          channelId = channelHandle.getHandle();
+        auto results = recvOp(token, channelId, process);
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Reduce: {
+        auto op = cast<ReduceOp>(operation);
+        auto inputs = scope.findTensors(op.getInputs());
+        auto initValues = scope.findTensors(op.getInitValues());
+        SmallVector<ShapedType> resultTypes;
+        for (auto resultType : op.getResultTypes())
+          resultTypes.push_back(cast<ShapedType>(resultType));
+        auto results = reduceOp(inputs, initValues, Axes(op.getDimensions()),
+                                op.getBody(), process, scope, resultTypes);
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::ReducePrecision: {
+        auto op = cast<ReducePrecisionOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        int32_t exponentBits = op.getExponentBits();
+        int32_t mantissaBits = op.getMantissaBits();
+        auto result = reducePrecisionOp(operand, exponentBits, mantissaBits,
+                                        op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::ReduceScatter: {
+        auto op = cast<ReduceScatterOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        int64_t scatterDimension = op.getScatterDimension();
+        auto replicaGroups = getReplicaGroups(op.getReplicaGroups());
+
+        ChannelId channelId = 0;
+        if (auto channelHandle = op.getChannelHandle())
+          channelId = channelHandle->getHandle();
+
+        auto result =
+            reduceScatterOp(operand, scatterDimension, replicaGroups, channelId,
+                            op.getUseGlobalDeviceIds(), op.getComputation(),
+                            process, scope, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::ReduceWindow: {
+        auto op = cast<ReduceWindowOp>(operation);
+        auto inputs = scope.findTensors(op.getInputs());
+        auto initValues = scope.findTensors(op.getInitValues());
+        int64_t rank = inputs[0].getRank();
+
+        Sizes windowStrides(rank, 1);
+        if (auto windowStridesAttr = op.getWindowStrides())
+          windowStrides = Sizes(*windowStridesAttr);
+
+        Sizes baseDilations(rank, 1);
+        if (auto baseDilationsAttr = op.getBaseDilations())
+          baseDilations = Sizes(*baseDilationsAttr);
+
+        Sizes windowDilations(rank, 1);
+        if (auto windowDilationsAttr = op.getWindowDilations())
+          windowDilations = Sizes(*windowDilationsAttr);
+
+        Sizes paddingLow(rank, 0), paddingHigh(rank, 0);
+        if (auto paddingAttr = op.getPadding()) {
+          auto paddingOrErr = hlo::convertPaddingAttribute(paddingAttr, {});
+          if (failed(paddingOrErr))
+            report_fatal_error(
+                invalidArgument("Invalid padding format found."));
+          for (auto i = 0; i < static_cast<int64_t>(paddingOrErr->size());
+               ++i) {
+            paddingLow[i] = (*paddingOrErr)[i].first;
+            paddingHigh[i] = (*paddingOrErr)[i].second;
+          }
+        }
+
+        SmallVector<ShapedType> resultTypes;
+        for (auto resultType : op.getResultTypes())
+          resultTypes.push_back(cast<ShapedType>(resultType));
+
+        auto results = reduceWindowOp(
+            inputs, initValues, Sizes(op.getWindowDimensions()), windowStrides,
+            baseDilations, windowDilations, paddingLow, paddingHigh,
+            op.getBody(), process, scope, resultTypes);
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Rem: {
+        auto op = cast<RemOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = remOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::ReplicaId: {
+        auto op = cast<ReplicaIdOp>(operation);
+        auto result = replicaIdOp(process, op.getContext());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Reshape: {
+        auto op = cast<ReshapeOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = reshapeOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::FuncReturn: {
+        auto op = cast<func::ReturnOp>(operation);
+        return scope.find(op.getOperands());
+      }
+      case OpKind::Return: {
+        auto op = cast<ReturnOp>(operation);
+        return scope.find(op.getResults());
+      }
+      case OpKind::Reverse: {
+        auto op = cast<ReverseOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto dimensions = Axes(op.getDimensions());
+        auto result = reverseOp(operand, dimensions, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::RngBitGenerator: {
+        auto op = cast<RngBitGeneratorOp>(operation);
+        auto initialState = scope.findTensor(op.getInitialState());
+        auto results = rngBitGeneratorOp(op.getRngAlgorithm(), initialState,
+                                         op.getOutput().getType());
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Rng: {
+        failOnDecomposableOp(operation);
+        break;
+      }
+      case OpKind::RoundNearestEven: {
+        auto op = cast<RoundNearestEvenOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = roundNearestEvenOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Round: {
+        auto op = cast<RoundOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = roundOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Rsqrt: {
+        auto op = cast<RsqrtOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = rsqrtOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Scatter: {
+        auto op = cast<ScatterOp>(operation);
+        auto inputs = scope.findTensors(op.getInputs());
+        auto scatterIndices = scope.findTensor(op.getScatterIndices());
+        auto updates = scope.findTensors(op.getUpdates());
+        releaseDeadOperands();
+        auto scatterDimensionNumbers = op.getScatterDimensionNumbers();
+        Axes updateWindowDims(scatterDimensionNumbers.getUpdateWindowDims());
+        Axes insertedWindowDims(
+            scatterDimensionNumbers.getInsertedWindowDims());
+        Axes inputBatchingDims(scatterDimensionNumbers.getInputBatchingDims());
+        Axes scatterIndicesBatchingDims(
+            scatterDimensionNumbers.getScatterIndicesBatchingDims());
+        Axes scatterDimsToOperandDims(
+            scatterDimensionNumbers.getScatterDimsToOperandDims());
+        Axis indexVectorDim(scatterDimensionNumbers.getIndexVectorDim());
+        auto &updateComputation = op.getUpdateComputation();
+        SmallVector<ShapedType> resultTypes(op->getResultTypes());
+        auto results =
+            scatterOp(inputs, scatterIndices, updates, updateWindowDims,
+                      insertedWindowDims, inputBatchingDims,
+                      scatterIndicesBatchingDims, scatterDimsToOperandDims,
+                      indexVectorDim, updateComputation, process, scope,
+                      resultTypes);
+        scope.add(op.getResults(), results);
+        break;
       }
+      case OpKind::SelectAndScatter: {
+        auto op = cast<SelectAndScatterOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto source = scope.findTensor(op.getSource());
+        auto initValue = scope.findTensor(op.getInitValue());
+        auto rank = operand.getRank();
+
+        Sizes windowDimensions(rank, 1);
+        if (auto windowDimensionsAttr = op.getWindowDimensions())
+          windowDimensions.assign(windowDimensionsAttr->begin(),
+                                  windowDimensionsAttr->end());
+
+        Sizes windowStrides(rank, 1);
+        if (auto windowStridesAttr = op.getWindowStrides())
+          windowStrides.assign(windowStridesAttr->begin(),
+                               windowStridesAttr->end());
+
+        Sizes paddingLow(rank, 0);
+        if (auto padding = op.getPadding()) {
+          auto paddingOrErr = hlo::convertPaddingAttribute(padding, {});
+          if (failed(paddingOrErr))
+            report_fatal_error(
+                invalidArgument("Invalid padding format found."));
+          for (auto i = 0; i < static_cast<int64_t>(paddingOrErr->size());
+               ++i) {
+            paddingLow[i] = (*paddingOrErr)[i].first;
+          }
+        }
 
-      SmallVector<ShapedType> resultTypes;
-      for (auto resultType : op.getResultTypes())
-        resultTypes.push_back(cast<ShapedType>(resultType));
-
-      auto results = reduceWindowOp(
-          inputs, initValues, Sizes(op.getWindowDimensions()), windowStrides,
-          baseDilations, windowDilations, paddingLow, paddingHigh, op.getBody(),
-          process, scope, resultTypes);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<RemOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = remOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ReplicaIdOp>(operation)) {
-      auto result = replicaIdOp(process, op.getContext());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ReshapeOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = reshapeOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<func::ReturnOp>(operation)) {
-      return scope.find(op.getOperands());
-    } else if (auto op = dyn_cast<ReturnOp>(operation)) {
-      return scope.find(op.getResults());
-    } else if (auto op = dyn_cast<ReverseOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto dimensions = Axes(op.getDimensions());
-      auto result = reverseOp(operand, dimensions, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (isa<RngBitGeneratorOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (isa<RngOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<RoundNearestEvenOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = roundNearestEvenOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<RoundOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = roundOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<RsqrtOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = rsqrtOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ScatterOp>(operation)) {
-      auto inputs = scope.findTensors(op.getInputs());
-      auto scatterIndices = scope.findTensor(op.getScatterIndices());
-      auto updates = scope.findTensors(op.getUpdates());
-      auto scatterDimensionNumbers = op.getScatterDimensionNumbers();
-      Axes updateWindowDims(scatterDimensionNumbers.getUpdateWindowDims());
-      Axes insertedWindowDims(scatterDimensionNumbers.getInsertedWindowDims());
-      Axes inputBatchingDims(scatterDimensionNumbers.getInputBatchingDims());
-      Axes scatterIndicesBatchingDims(
-          scatterDimensionNumbers.getScatterIndicesBatchingDims());
-      Axes scatterDimsToOperandDims(
-          scatterDimensionNumbers.getScatterDimsToOperandDims());
-      Axis indexVectorDim(scatterDimensionNumbers.getIndexVectorDim());
-      auto &updateComputation = op.getUpdateComputation();
-      SmallVector<ShapedType> resultTypes(op->getResultTypes());
-      auto results = scatterOp(inputs, scatterIndices, updates,
-                               updateWindowDims, insertedWindowDims,
-                               inputBatchingDims, scatterIndicesBatchingDims,
-                               scatterDimsToOperandDims, indexVectorDim,
-                               updateComputation, process, scope, resultTypes);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<SelectAndScatterOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto source = scope.findTensor(op.getSource());
-      auto initValue = scope.findTensor(op.getInitValue());
-      auto rank = operand.getRank();
-
-      Sizes windowDimensions(rank, 1);
-      if (auto windowDimensionsAttr = op.getWindowDimensions())
-        windowDimensions.assign(windowDimensionsAttr->begin(),
-                                windowDimensionsAttr->end());
-
-      Sizes windowStrides(rank, 1);
-      if (auto windowStridesAttr = op.getWindowStrides())
-        windowStrides.assign(windowStridesAttr->begin(),
-                             windowStridesAttr->end());
-
-      Sizes paddingLow(rank, 0);
-      if (auto padding = op.getPadding()) {
-        auto paddingOrErr = hlo::convertPaddingAttribute(padding, {});
-        if (failed(paddingOrErr))
-          report_fatal_error(invalidArgument("Invalid padding format found."));
-        for (auto i = 0; i < static_cast<int64_t>(paddingOrErr->size()); ++i) {
-          paddingLow[i] = (*paddingOrErr)[i].first;
+        auto result =
+            selectAndScatterOp(operand, source, initValue, windowDimensions,
+                               windowStrides, paddingLow, op.getSelect(),
+                               op.getScatter(), process, scope, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Select: {
+        auto op = cast<SelectOp>(operation);
+        auto pred = scope.findTensor(op.getPred());
+        auto onTrue = scope.findTensor(op.getOnTrue());
+        auto onFalse = scope.findTensor(op.getOnFalse());
+        auto result = selectOp(pred, onTrue, onFalse, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Send: {
+        auto op = cast<SendOp>(operation);
+        auto inputs = scope.findTensors(op.getInputs());
+        auto token = scope.findToken(op.getToken());
+        ChannelId channelId = 0;
+        if (auto channelHandle = op.getChannelHandle())
+          channelId = channelHandle.getHandle();
+        auto result = sendOp(inputs, token, channelId, process);
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::ShiftLeft: {
+        auto op = cast<ShiftLeftOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = shiftLeftOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::ShiftRightArithmetic: {
+        auto op = cast<ShiftRightArithmeticOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = shiftRightArithmeticOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::ShiftRightLogical: {
+        auto op = cast<ShiftRightLogicalOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = shiftRightLogicalOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Sign: {
+        auto op = cast<SignOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = signOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Sine: {
+        auto op = cast<SineOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = sineOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Slice: {
+        auto op = cast<SliceOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto startIndices = Sizes(op.getStartIndices());
+        auto strides = Sizes(op.getStrides());
+        auto result = sliceOp(operand, startIndices, strides, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Sort: {
+        auto op = cast<SortOp>(operation);
+        auto operands = scope.findTensors(op.getInputs());
+        auto dimension = op.getDimension();
+        auto isStable = op.getIsStable();
+        auto &comparator = op.getComparator();
+        auto results =
+            sortOp(operands, dimension, isStable, comparator, process, scope);
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Sqrt: {
+        auto op = cast<SqrtOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = sqrtOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Subtract: {
+        auto op = cast<SubtractOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        releaseDeadOperands();
+        auto result = subtractOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Tanh: {
+        auto op = cast<TanhOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = tanhOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::TorchIndexSelect: {
+        failOnDecomposableOp(operation);
+        break;
+      }
+      case OpKind::Transpose: {
+        auto op = cast<TransposeOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto permutation = Axes(op.getPermutation());
+        auto result = transposeOp(operand, permutation, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::TriangularSolve: {
+        auto op = cast<TriangularSolveOp>(operation);
+        auto a = scope.findTensor(op.getA());
+        auto b = scope.findTensor(op.getB());
+        auto result =
+            triangularSolveOp(a, b, op.getLeftSide(), op.getLower(),
+                              op.getUnitDiagonal(), op.getTransposeA(),
+                              op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Tuple: {
+        auto op = cast<TupleOp>(operation);
+        auto val = scope.find(op.getVal());
+        auto result = tupleOp(val, cast<TupleType>(op.getType()));
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::UnaryEinsum: {
+        failOnDecomposableOp(operation);
+        break;
+      }
+      case OpKind::UniformDequantize: {
+        auto op = cast<UniformDequantizeOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = uniformDequantizeOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::UniformQuantize: {
+        auto op = cast<UniformQuantizeOp>(operation);
+        auto operand = scope.findTensor(op.getOperand());
+        auto result = uniformQuantizeOp(operand, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::While: {
+        auto op = cast<WhileOp>(operation);
+        auto operand = scope.find(op.getOperand());
+        releaseDeadOperands();
+        auto &cond = op.getCond();
+        auto &body = op.getBody();
+        auto results =
+            whileOp(std::move(operand), cond, body, fallback, process, scope);
+        scope.add(op.getResults(), results);
+        break;
+      }
+      case OpKind::Xor: {
+        auto op = cast<XorOp>(operation);
+        auto lhs = scope.findTensor(op.getLhs());
+        auto rhs = scope.findTensor(op.getRhs());
+        auto result = xorOp(lhs, rhs, op.getType());
+        scope.add(op.getResult(), result);
+        break;
+      }
+      case OpKind::Unknown: {
+        // Custom calls of tensors may have native kernels.
+        if (isa<CustomCallOp>(operation) &&
+            llvm::all_of(operation.getOperandTypes(),
+                         llvm::IsaPred<TensorType>)) {
+          auto operands = scope.findTensors(operation.getOperands());
+          if (auto results = evalWithRegisteredKernel(operation, operands)) {
+            if (!*results) llvm::report_fatal_error(results->takeError());
+            scope.add(operation.getResults(), **results);
+            break;
+          }
         }
+        if (!fallback)
+          report_fatal_error(invalidArgument("Unsupported op: %s",
+                                             debugString(operation).c_str()));
+        auto status = (*fallback)(operation, scope, process);
+        if (status) llvm::report_fatal_error(std::move(status));
+        break;
       }
+    }
 
-      auto result =
-          selectAndScatterOp(operand, source, initValue, windowDimensions,
-                             windowStrides, paddingLow, op.getSelect(),
-                             op.getScatter(), process, scope, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<SelectOp>(operation)) {
-      auto pred = scope.findTensor(op.getPred());
-      auto onTrue = scope.findTensor(op.getOnTrue());
-      auto onFalse = scope.findTensor(op.getOnFalse());
-      auto result = selectOp(pred, onTrue, onFalse, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<SendOp>(operation)) {
-      auto inputs = scope.findTensors(op.getInputs());
-      auto token = scope.findToken(op.getToken());
-      ChannelId channelId = 0;
-      if (auto channelHandle = op.getChannelHandle())
-        channelId = channelHandle.getHandle();
-      auto result = sendOp(inputs, token, channelId, process);
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ShiftLeftOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = shiftLeftOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ShiftRightArithmeticOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = shiftRightArithmeticOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<ShiftRightLogicalOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = shiftRightLogicalOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<SignOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = signOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<SineOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = sineOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<SliceOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto startIndices = Sizes(op.getStartIndices());
-      auto strides = Sizes(op.getStrides());
-      auto result = sliceOp(operand, startIndices, strides, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<SortOp>(operation)) {
-      auto operands = scope.findTensors(op.getInputs());
-      auto dimension = op.getDimension();
-      auto isStable = op.getIsStable();
-      auto &comparator = op.getComparator();
-      auto results =
-          sortOp(operands, dimension, isStable, comparator, process, scope);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<SqrtOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = sqrtOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<SubtractOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = subtractOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (auto op = dyn_cast<TanhOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto result = tanhOp(operand, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (isa<TorchIndexSelectOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<TransposeOp>(operation)) {
-      auto operand = scope.findTensor(op.getOperand());
-      auto permutation = Axes(op.getPermutation());
-      auto result = transposeOp(operand, permutation, op.getType());
-      scope.add(op.getResult(), result);
-    } else if (isa<TriangularSolveOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<TupleOp>(operation)) {
-      auto val = scope.find(op.getVal());
-      auto result = tupleOp(val, cast<TupleType>(op.getType()));
-      scope.add(op.getResult(), result);
-    } else if (isa<UnaryEinsumOp>(operation)) {
-      failOnDecomposableOp(operation);
-    } else if (auto op = dyn_cast<WhileOp>(operation)) {
-      auto operand = scope.find(op.getOperand());
-      auto &cond = op.getCond();
-      auto &body = op.getBody();
-      auto results = whileOp(operand, cond, body, fallback, process, scope);
-      scope.add(op.getResults(), results);
-    } else if (auto op = dyn_cast<XorOp>(operation)) {
-      auto lhs = scope.findTensor(op.getLhs());
-      auto rhs = scope.findTensor(op.getRhs());
-      auto result = xorOp(lhs, rhs, op.getType());
-      scope.add(op.getResult(), result);
-    } else {
-      if (!fallback)
-        report_fatal_error(invalidArgument("Unsupported op: %s",
-                                           debugString(operation).c_str()));
-      auto status = (*fallback)(operation, scope, process);
-      if (status) llvm::report_fatal_error(std::move(status));
+    if (auto *checker = getNumericsChecker())
+      checker->check(operation, scope.find(operation.getResults()));
+    if (!releasedDeadOperands) releaseOperands();
+    return std::nullopt;
+  };
+
+  auto *threadPool = getIntraOpThreadPool();
+  if (threadPool && region.hasConcurrentOps()) {
+    auto results = evalDataflow(region, *threadPool, scope, evalOp);
+    scope.clear();
+    return results;
+  }
+
+  // Release values as soon as they are dead, so that their storage can be
+  // reused while the rest of the region is evaluated.
+  for (const auto &preparedOp : region.getOps()) {
+    auto results = evalOp(preparedOp, [&]() {
+      for (Value value : preparedOp.deadOperands) scope.erase(value);
+    });
+    if (results) {
+      scope.clear();
+      return std::move(*results);
     }
+    for (Value value : preparedOp.deadValues) scope.erase(value);
   }
 
   llvm::report_fatal_error("Expected a terminator when evaluating a region");
@@ -1089,15 +2874,19 @@ SmallVector<InterpreterValue> eval(Region &region,
 
 Tensor absOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, abs(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Abs, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, abs(operand.getLinear(i)));
   return result;
 }
 
 Tensor addOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
-  Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, lhs.get(*it) + rhs.get(*it));
+  auto result = donateOrAllocate(lhs, rhs, resultType);
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Add, lhs, rhs, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, lhs.getLinear(i) + rhs.getLinear(i));
   return result;
 }
 
@@ -1159,26 +2948,33 @@ Tensor allReduceOp(const Tensor &operand,
         "Failed to find process group with process_id: (%d, %d)",
         process->getId().replicaId, process->getId().partitionId));
 
-  auto groupOperands =
-      process->rendezvous(*processGroup, channelId, operand).getSortedTensors();
-
-  Tensor result(resultType);
-  for (auto resultIt = result.index_begin(); resultIt != result.index_end();
-       ++resultIt) {
-    Tensor resultElement;
-    for (const auto &groupOperand : groupOperands) {
-      auto groupOperandElement = constant(groupOperand.get(*resultIt));
-      if (resultElement)
-        resultElement = eval(computation, {resultElement, groupOperandElement},
-                             /*fallback=*/nullptr, process, &scope)[0]
-                            .getTensor();
-      else
-        resultElement = groupOperandElement;
-    }
-    result.set(*resultIt, resultElement.get({}));
-  }
+  auto kernel = getReductionKernel(computation);
+  auto preparedComputation = prepareRegion(computation);
+  auto reduceShard = [&](ArrayRef<Tensor> groupOperands, int64_t begin,
+                         int64_t end, Tensor &result) {
+    if (kernel &&
+        evalAllReduceKernel(getKernelOptions(), *kernel, groupOperands, begin,
+                            end, result))
+      return;
+
+    forEachIndex(result.getShape(), begin, end, [&](const Index &index) {
+      Tensor resultElement;
+      for (const auto &groupOperand : groupOperands) {
+        auto groupOperandElement = constant(groupOperand.get(index));
+        if (resultElement)
+          resultElement =
+              eval(*preparedComputation, {resultElement, groupOperandElement},
+                   /*fallback=*/nullptr, process, &scope)[0]
+                  .getTensor();
+        else
+          resultElement = groupOperandElement;
+      }
+      result.set(index, resultElement.get({}));
+    });
+  };
 
-  return result;
+  return process->allReduce(*processGroup, channelId, operand, resultType,
+                            reduceShard);
 }
 
 Tensor allToAllOp(const Tensor &operand, Axis splitDimension,
@@ -1203,31 +2999,180 @@ Tensor allToAllOp(const Tensor &operand, Axis splitDimension,
   auto groupOperands =
       process->rendezvous(*processGroup, channelId, operand).getSortedTensors();
 
+  // Only the part of every operand which is scattered to this process is
+  // sliced, and it shares the storage of the operand where possible.
+  int64_t part = llvm::find(*processGroup, process->getId()) -
+                 processGroup->begin();
   SmallVector<Tensor> scatteredParts;
-  for (const auto &groupOperand : groupOperands) {
-    auto splitParts = split(groupOperand, splitCount, splitDimension,
-                            operand.getType().getContext());
-    for (auto [i, processId] : llvm::enumerate(*processGroup))
-      if (processId == process->getId())
-        scatteredParts.push_back(splitParts[i]);
-  }
+  for (const auto &groupOperand : groupOperands)
+    scatteredParts.push_back(splitPart(groupOperand, splitCount, part,
+                                       splitDimension,
+                                       operand.getType().getContext()));
   return concatenateOp(scatteredParts, concatDimension, resultType);
 }
 
 Tensor andOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, lhs.get(*it) & rhs.get(*it));
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::And, lhs, rhs, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, lhs.getLinear(i) & rhs.getLinear(i));
   return result;
 }
 
 Tensor atan2Op(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, atan2(lhs.get(*it), rhs.get(*it)));
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Atan2, lhs, rhs,
+                       result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, atan2(lhs.getLinear(i), rhs.getLinear(i)));
+  return result;
+}
+
+SmallVector<Tensor> batchNormGradOp(
+    const Tensor &operand, const Tensor &scale, const Tensor &mean,
+    const Tensor &variance, const Tensor &gradOutput, double epsilon,
+    Axis featureIndex, ShapedType gradOperandType, ShapedType gradScaleType,
+    ShapedType gradOffsetType) {
+  if (isSupportedQuantizedType(operand.getElementType())) {
+    auto results = batchNormGradOp(
+        dequantize(operand, getExpressedType(operand.getType())),
+        dequantize(scale, getExpressedType(scale.getType())),
+        dequantize(mean, getExpressedType(mean.getType())),
+        dequantize(variance, getExpressedType(variance.getType())),
+        dequantize(gradOutput, getExpressedType(gradOutput.getType())),
+        epsilon, featureIndex, getExpressedType(gradOperandType),
+        getExpressedType(gradScaleType), getExpressedType(gradOffsetType));
+    return {quantize(results[0], gradOperandType),
+            quantize(results[1], gradScaleType),
+            quantize(results[2], gradOffsetType)};
+  }
+
+  Tensor gradOperand(gradOperandType);
+  Tensor gradScale(gradScaleType);
+  Tensor gradOffset(gradOffsetType);
+  if (evalBatchNormGradKernel(getKernelOptions(), operand, scale, mean,
+                              variance, gradOutput, epsilon, featureIndex,
+                              gradOperand, gradScale, gradOffset))
+    return {gradOperand, gradScale, gradOffset};
+
+  auto x = getFloatData(operand);
+  auto g = getFloatData(gradOutput);
+  auto scaleData = getFloatData(scale);
+  auto meanData = getFloatData(mean);
+  auto varianceData = getFloatData(variance);
+  int64_t numFeatures = scale.getNumElements();
+  int64_t stride = getFeatureStride(operand, featureIndex);
+  double count = x.size() / std::max<int64_t>(numFeatures, 1);
+  std::vector<double> gradSums(numFeatures);
+  std::vector<double> centeredSums(numFeatures);
+  for (int64_t i = 0, e = x.size(); i < e; ++i) {
+    int64_t f = (i / stride) % numFeatures;
+    gradSums[f] += g[i];
+    centeredSums[f] += g[i] * (x[i] - meanData[f]);
+  }
+  std::vector<double> gradScaleData(numFeatures);
+  for (int64_t f = 0; f < numFeatures; ++f)
+    gradScaleData[f] = centeredSums[f] / std::sqrt(varianceData[f] + epsilon);
+  for (int64_t i = 0, e = x.size(); i < e; ++i) {
+    int64_t f = (i / stride) % numFeatures;
+    double varianceEpsilon = varianceData[f] + epsilon;
+    x[i] = scaleData[f] / std::sqrt(varianceEpsilon) / count *
+           (count * g[i] - gradSums[f] -
+            (x[i] - meanData[f]) * centeredSums[f] / varianceEpsilon);
+  }
+  setFloatData(gradOperand, x);
+  setFloatData(gradScale, gradScaleData);
+  setFloatData(gradOffset, gradSums);
+  return {gradOperand, gradScale, gradOffset};
+}
+
+Tensor batchNormInferenceOp(const Tensor &operand, const Tensor &scale,
+                            const Tensor &offset, const Tensor &mean,
+                            const Tensor &variance, double epsilon,
+                            Axis featureIndex, ShapedType resultType) {
+  if (isSupportedQuantizedType(operand.getElementType())) {
+    auto result = batchNormInferenceOp(
+        dequantize(operand, getExpressedType(operand.getType())),
+        dequantize(scale, getExpressedType(scale.getType())),
+        dequantize(offset, getExpressedType(offset.getType())),
+        dequantize(mean, getExpressedType(mean.getType())),
+        dequantize(variance, getExpressedType(variance.getType())), epsilon,
+        featureIndex, getExpressedType(resultType));
+    return quantize(result, resultType);
+  }
+
+  Tensor result(resultType);
+  if (evalBatchNormInferenceKernel(getKernelOptions(), operand, scale, offset,
+                                   mean, variance, epsilon, featureIndex,
+                                   result))
+    return result;
+
+  auto x = getFloatData(operand);
+  auto scaleData = getFloatData(scale);
+  auto offsetData = getFloatData(offset);
+  auto meanData = getFloatData(mean);
+  auto varianceData = getFloatData(variance);
+  int64_t numFeatures = scale.getNumElements();
+  int64_t stride = getFeatureStride(operand, featureIndex);
+  for (int64_t i = 0, e = x.size(); i < e; ++i) {
+    int64_t f = (i / stride) % numFeatures;
+    x[i] = (x[i] - meanData[f]) * scaleData[f] /
+               std::sqrt(varianceData[f] + epsilon) +
+           offsetData[f];
+  }
+  setFloatData(result, x);
   return result;
 }
 
+SmallVector<Tensor> batchNormTrainingOp(const Tensor &operand,
+                                        const Tensor &scale,
+                                        const Tensor &offset, double epsilon,
+                                        Axis featureIndex,
+                                        ShapedType outputType,
+                                        ShapedType batchMeanType,
+                                        ShapedType batchVarType) {
+  if (isSupportedQuantizedType(operand.getElementType())) {
+    auto results = batchNormTrainingOp(
+        dequantize(operand, getExpressedType(operand.getType())),
+        dequantize(scale, getExpressedType(scale.getType())),
+        dequantize(offset, getExpressedType(offset.getType())), epsilon,
+        featureIndex, getExpressedType(outputType),
+        getExpressedType(batchMeanType), getExpressedType(batchVarType));
+    return {quantize(results[0], outputType),
+            quantize(results[1], batchMeanType),
+            quantize(results[2], batchVarType)};
+  }
+
+  Tensor output(outputType);
+  Tensor batchMean(batchMeanType);
+  Tensor batchVar(batchVarType);
+  if (evalBatchNormTrainingKernel(getKernelOptions(), operand, scale, offset,
+                                  epsilon, featureIndex, output, batchMean,
+                                  batchVar))
+    return {output, batchMean, batchVar};
+
+  auto x = getFloatData(operand);
+  int64_t numFeatures = scale.getNumElements();
+  int64_t stride = getFeatureStride(operand, featureIndex);
+  double count = x.size() / std::max<int64_t>(numFeatures, 1);
+  std::vector<double> meanData(numFeatures);
+  std::vector<double> varData(numFeatures);
+  for (int64_t i = 0, e = x.size(); i < e; ++i)
+    meanData[(i / stride) % numFeatures] += x[i] / count;
+  for (int64_t i = 0, e = x.size(); i < e; ++i) {
+    double deviation = x[i] - meanData[(i / stride) % numFeatures];
+    varData[(i / stride) % numFeatures] += deviation * deviation / count;
+  }
+  setFloatData(batchMean, meanData);
+  setFloatData(batchVar, varData);
+  auto result = batchNormInferenceOp(operand, scale, offset, batchMean,
+                                     batchVar, epsilon, featureIndex,
+                                     outputType);
+  return {result, batchMean, batchVar};
+}
+
 Tensor bitcastConvertOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
 
@@ -1260,14 +3205,17 @@ Tensor bitcastConvertOp(const Tensor &operand, ShapedType resultType) {
     return result;
   }
 
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it,
-               bitcastConvertOneToOne(resultElementType, operand.get(*it)));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(
+        i, bitcastConvertOneToOne(resultElementType, operand.getLinear(i)));
   return result;
 }
 
 Tensor broadcastInDimOp(const Tensor &operand, const Axes &broadcastDimensions,
                         ShapedType resultType) {
+  if (auto view = evalBroadcastInDimView(getKernelOptions(), operand,
+                                         broadcastDimensions, resultType))
+    return view;
   Tensor result(resultType);
   for (auto resultIt = result.index_begin(); resultIt != result.index_end();
        ++resultIt) {
@@ -1293,38 +3241,95 @@ SmallVector<InterpreterValue> caseOp(const Tensor &index, RegionRange branches,
 
 Tensor cbrtOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, cbrt(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Cbrt, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, cbrt(operand.getLinear(i)));
   return result;
 }
 
 Tensor ceilOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, ceil(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Ceil, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, ceil(operand.getLinear(i)));
+  return result;
+}
+
+Tensor choleskyOp(const Tensor &a, bool lower, ShapedType resultType) {
+  Tensor result(resultType);
+  if (evalCholeskyKernel(getKernelOptions(), a, lower, result)) return result;
+
+  // Factorizes every matrix into `L` such that `a = L * L^H`, reading upper
+  // triangles as the adjoints of lower ones, since `a = U^H * U` for
+  // `U = L^H`.
+  auto data = getComplexData(a);
+  int64_t n = a.getShape().back();
+  auto at = [&](int64_t i, int64_t j) { return lower ? i * n + j : j * n + i; };
+  auto read = [&](std::complex<double> value) {
+    return lower ? value : std::conj(value);
+  };
+  std::vector<std::complex<double>> l(n * n);
+  for (int64_t offset = 0, e = data.size(); offset < e; offset += n * n) {
+    for (int64_t j = 0; j < n; ++j) {
+      double diagonal = data[offset + at(j, j)].real();
+      for (int64_t k = 0; k < j; ++k) diagonal -= std::norm(l[j * n + k]);
+      l[j * n + j] = std::sqrt(diagonal);
+      for (int64_t i = j + 1; i < n; ++i) {
+        auto sum = read(data[offset + at(i, j)]);
+        for (int64_t k = 0; k < j; ++k)
+          sum -= l[i * n + k] * std::conj(l[j * n + k]);
+        l[i * n + j] = sum / l[j * n + j];
+      }
+    }
+    for (int64_t i = 0; i < n; ++i)
+      for (int64_t j = 0; j < n; ++j)
+        data[offset + at(i, j)] =
+            j <= i ? read(l[i * n + j]) : std::complex<double>();
+  }
+  setComplexData(result, data);
   return result;
 }
 
 Tensor clampOp(const Tensor &min, const Tensor &operand, const Tensor &max,
                ShapedType resultType) {
+  // Scalar bounds are broadcast as splat views, which the native kernels read
+  // as scalars.
+  auto broadcast = [&](const Tensor &bound) {
+    if (bound.getRank() != 0 || resultType.getRank() == 0) return bound;
+    return makeSplatView(bound, resultType);
+  };
+  auto clamped = donateOrAllocate(operand, resultType);
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Maximum, operand,
+                       broadcast(min), clamped) &&
+      evalBinaryKernel(getKernelOptions(), BinaryKernel::Minimum, clamped,
+                       broadcast(max), clamped))
+    return clamped;
+
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it) {
-    Element minElement = min.getRank() != 0 ? min.get(*it) : min.get({});
-    Element maxElement = max.getRank() != 0 ? max.get(*it) : max.get({});
-    result.set(*it, stablehlo::min(stablehlo::max(operand.get(*it), minElement),
-                                   maxElement));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i) {
+    Element minElement = min.getRank() != 0 ? min.getLinear(i) : min.get({});
+    Element maxElement = max.getRank() != 0 ? max.getLinear(i) : max.get({});
+    result.setLinear(
+        i, stablehlo::min(stablehlo::max(operand.getLinear(i), minElement),
+                          maxElement));
   }
   return result;
 }
 
 Tensor clzOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it) {
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::CountLeadingZeros,
+                      operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i) {
     auto element =
         convert(resultType.getElementType(),
-                static_cast<uint64_t>(
-                    operand.get(*it).getIntegerValue().countLeadingZeros()));
-    result.set(*it, element);
+                static_cast<uint64_t>(operand.getLinear(i)
+                                          .getIntegerValue()
+                                          .countLeadingZeros()));
+    result.setLinear(i, element);
   }
   return result;
 }
@@ -1381,27 +3386,62 @@ Tensor collectivePermuteOp(const Tensor &operand,
 
 Tensor compareOp(const Tensor &lhs, const Tensor &rhs,
                  ComparisonDirection comparisonDirection,
+                 std::optional<ComparisonType> compareType,
                  ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it) {
+  bool isTotalOrder = compareType == ComparisonType::TOTALORDER &&
+                      isSupportedFloatType(lhs.getElementType());
+  if (evalCompareKernel(getKernelOptions(), comparisonDirection, isTotalOrder,
+                        lhs, rhs, result))
+    return result;
+  if (isTotalOrder) {
+    for (int64_t i = 0, e = result.getNumElements(); i < e; ++i) {
+      auto lhsKey = getTotalOrderKey(lhs.getLinear(i).getFloatValue());
+      auto rhsKey = getTotalOrderKey(rhs.getLinear(i).getFloatValue());
+      bool isTrue = false;
+      switch (comparisonDirection) {
+        case ComparisonDirection::EQ:
+          isTrue = lhsKey.eq(rhsKey);
+          break;
+        case ComparisonDirection::NE:
+          isTrue = lhsKey.ne(rhsKey);
+          break;
+        case ComparisonDirection::GE:
+          isTrue = lhsKey.sge(rhsKey);
+          break;
+        case ComparisonDirection::GT:
+          isTrue = lhsKey.sgt(rhsKey);
+          break;
+        case ComparisonDirection::LE:
+          isTrue = lhsKey.sle(rhsKey);
+          break;
+        case ComparisonDirection::LT:
+          isTrue = lhsKey.slt(rhsKey);
+          break;
+      }
+      result.setLinear(i, Element(result.getElementType(), isTrue));
+    }
+    return result;
+  }
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i) {
     switch (comparisonDirection) {
       case ComparisonDirection::EQ:
-        result.set(*it, lhs.get(*it) == rhs.get(*it));
+        result.setLinear(i, lhs.getLinear(i) == rhs.getLinear(i));
         break;
       case ComparisonDirection::NE:
-        result.set(*it, lhs.get(*it) != rhs.get(*it));
+        result.setLinear(i, lhs.getLinear(i) != rhs.getLinear(i));
         break;
       case ComparisonDirection::GE:
-        result.set(*it, lhs.get(*it) >= rhs.get(*it));
+        result.setLinear(i, lhs.getLinear(i) >= rhs.getLinear(i));
         break;
       case ComparisonDirection::GT:
-        result.set(*it, lhs.get(*it) > rhs.get(*it));
+        result.setLinear(i, lhs.getLinear(i) > rhs.getLinear(i));
         break;
       case ComparisonDirection::LE:
-        result.set(*it, lhs.get(*it) <= rhs.get(*it));
+        result.setLinear(i, lhs.getLinear(i) <= rhs.getLinear(i));
         break;
       case ComparisonDirection::LT:
-        result.set(*it, lhs.get(*it) < rhs.get(*it));
+        result.setLinear(i, lhs.getLinear(i) < rhs.getLinear(i));
         break;
     }
   }
@@ -1410,14 +3450,19 @@ Tensor compareOp(const Tensor &lhs, const Tensor &rhs,
 
 Tensor complexOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, complex(lhs.get(*it), rhs.get(*it)));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, complex(lhs.getLinear(i), rhs.getLinear(i)));
   return result;
 }
 
 Tensor concatenateOp(ArrayRef<Tensor> inputs, Axis dimension,
                      ShapedType resultType) {
+  if (inputs.size() == 1 && inputs[0].getType() == resultType)
+    return inputs[0];
+
   Tensor result(resultType);
+  if (evalConcatenateKernel(getKernelOptions(), inputs, dimension, result))
+    return result;
   int64_t dimensionOffset = 0;
   for (const auto &input : inputs) {
     for (auto inputIt = input.index_begin(); inputIt != input.index_end();
@@ -1433,13 +3478,40 @@ Tensor concatenateOp(ArrayRef<Tensor> inputs, Axis dimension,
 }
 
 Tensor constantOp(ElementsAttr value) {
-  return makeTensor(cast<DenseElementsAttr>(value));
+  // Large constants are parsed into resource blobs, whose byte-sized elements
+  // are laid out like tensor storage, so they're used in place. Blobs live as
+  // long as the context, which outlives evaluation.
+  if (auto resourceAttr = dyn_cast<DenseResourceElementsAttr>(value)) {
+    auto type = resourceAttr.getType();
+    auto elementType = type.getElementType();
+    if (auto complexType = dyn_cast<ComplexType>(elementType))
+      elementType = complexType.getElementType();
+    auto *blob = resourceAttr.getRawHandle().getBlob();
+    if (!blob || !elementType.isIntOrFloat() ||
+        elementType.getIntOrFloatBitWidth() % 8 != 0)
+      report_fatal_error(
+          invalidArgument("Unsupported resource constant of type %s",
+                          debugString(type).c_str()));
+    return Tensor(type, UnmanagedAsmResourceBlob::allocateWithAlign(
+                            blob->getData(), blob->getDataAlignment(),
+                            /*deleter=*/{}, /*dataIsMutable=*/false));
+  }
+
+  auto attr = cast<DenseElementsAttr>(value);
+  auto type = attr.getType();
+  if (!attr.isSplat() || type.getNumElements() <= 1) return makeTensor(attr);
+
+  // Splats are views which repeat their only element, so that they take
+  // constant time and memory until they are read in canonical order.
+  auto element = makeTensor(
+      attr.resizeSplat(RankedTensorType::get({}, type.getElementType())));
+  return makeSplatView(element, type);
 }
 
 Tensor convertOp(const Tensor &operand, ShapedType resultType) {
-  Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, convert(result.getElementType(), operand.get(*it)));
+  auto result = donateOrAllocate(operand, resultType);
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, convert(result.getElementType(), operand.getLinear(i)));
   return result;
 }
 
@@ -1453,7 +3525,34 @@ Tensor convolutionOp(
     const Axes &kernelSpatialDimensions, Axis outputBatchDimension,
     Axis outputFeatureDimension, const Axes &outputSpatialDimensions,
     int64_t featureGroupCount, int64_t batchGroupCount, ShapedType resultType) {
+  // Quantized convolutions accumulate the products of the integers of `lhs`
+  // and `rhs` in i32, and hybrid ones compute with the dequantized `rhs`.
+  if (isSupportedQuantizedType(rhs.getElementType())) {
+    bool isHybrid = !isSupportedQuantizedType(lhs.getElementType());
+    auto accumulators = convolutionOp(
+        isHybrid ? lhs : subtractZeroPoints(lhs),
+        isHybrid ? dequantize(rhs, getExpressedType(rhs.getType()))
+                 : subtractZeroPoints(rhs),
+        windowStrides, padding, lhsDilation, rhsDilation, windowReversal,
+        inputBatchDimension, inputFeatureDimension, inputSpatialDimensions,
+        kernelInputFeatureDimension, kernelOutputFeatureDimension,
+        kernelSpatialDimensions, outputBatchDimension, outputFeatureDimension,
+        outputSpatialDimensions, featureGroupCount, batchGroupCount,
+        isHybrid ? resultType : getAccumulatorType(resultType));
+    if (isHybrid) return accumulators;
+    return quantizeAccumulators(accumulators, lhs.getType(), rhs.getType(),
+                                outputFeatureDimension, resultType);
+  }
+
   Tensor result(resultType);
+  if (evalConvolutionKernel(
+          getKernelOptions(), lhs, rhs, windowStrides, padding, lhsDilation,
+          rhsDilation, windowReversal, inputBatchDimension,
+          inputFeatureDimension, inputSpatialDimensions,
+          kernelInputFeatureDimension, kernelOutputFeatureDimension,
+          kernelSpatialDimensions, outputBatchDimension, outputFeatureDimension,
+          outputSpatialDimensions, featureGroupCount, batchGroupCount, result))
+    return result;
 
   if (featureGroupCount > 1) {
     auto lhses = split(lhs, featureGroupCount, inputFeatureDimension,
@@ -1589,15 +3688,20 @@ Tensor convolutionOp(
 
 Tensor cosineOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, cosine(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Cosine, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, cosine(operand.getLinear(i)));
   return result;
 }
 
 Tensor divideOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
-  Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, lhs.get(*it) / rhs.get(*it));
+  auto result = donateOrAllocate(lhs, rhs, resultType);
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Divide, lhs, rhs,
+                       result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, lhs.getLinear(i) / rhs.getLinear(i));
   return result;
 }
 
@@ -1607,7 +3711,32 @@ Tensor dotGeneralOp(const Tensor &lhs, const Tensor &rhs,
                     const Axes &lhsContractingDimensions,
                     const Axes &rhsContractingDimensions,
                     ShapedType resultType) {
+  // Quantized dot products accumulate the products of the integers of `lhs`
+  // and `rhs` in i32, and hybrid ones compute with the dequantized `rhs`.
+  if (isSupportedQuantizedType(rhs.getElementType())) {
+    bool isHybrid = !isSupportedQuantizedType(lhs.getElementType());
+    auto accumulators = dotGeneralOp(
+        isHybrid ? lhs : subtractZeroPoints(lhs),
+        isHybrid ? dequantize(rhs, getExpressedType(rhs.getType()))
+                 : subtractZeroPoints(rhs),
+        lhsBatchingDimensions, rhsBatchingDimensions, lhsContractingDimensions,
+        rhsContractingDimensions,
+        isHybrid ? resultType : getAccumulatorType(resultType));
+    if (isHybrid) return accumulators;
+    return quantizeAccumulators(
+        accumulators, lhs.getType(), rhs.getType(),
+        getRhsResultDimension(lhs, rhs, rhsBatchingDimensions,
+                              lhsContractingDimensions,
+                              rhsContractingDimensions),
+        resultType);
+  }
+
   Tensor result(resultType);
+  if (evalDotGeneralKernel(getKernelOptions(), lhs, rhs, lhsBatchingDimensions,
+                           rhsBatchingDimensions, lhsContractingDimensions,
+                           rhsContractingDimensions, result))
+    return result;
+
   Axes lhsResultDims;
   for (auto i = 0; i < lhs.getType().getRank(); ++i)
     if (!llvm::is_contained(lhsBatchingDimensions, i) &&
@@ -1691,39 +3820,98 @@ Tensor dynamicSliceOp(const Tensor &operand, ArrayRef<Tensor> startIndices,
 Tensor dynamicUpdateSliceOp(const Tensor &operand, const Tensor &update,
                             ArrayRef<Tensor> startIndices,
                             ShapedType resultType) {
-  Tensor result(resultType);
+  auto result = donateOrCopy(operand);
   auto adjustedStartIndices =
       clamp(0, evalIndex(startIndices), operand.getShape() - update.getShape());
-  for (auto resultIt = result.index_begin(); resultIt != result.index_end();
-       ++resultIt) {
-    auto resultIndex = *resultIt;
-    auto updateIndex = resultIndex - adjustedStartIndices;
-    if (updateIndex.inBounds(update.getShape()))
-      result.set(resultIndex, update.get(updateIndex));
-    else
-      result.set(resultIndex, operand.get(resultIndex));
-  }
+  for (auto updateIt = update.index_begin(); updateIt != update.index_end();
+       ++updateIt)
+    result.set(*updateIt + adjustedStartIndices, update.get(*updateIt));
   return result;
 }
 
 Tensor expm1Op(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, exponentialMinusOne(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::ExponentialMinusOne,
+                      operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, exponentialMinusOne(operand.getLinear(i)));
   return result;
 }
 
 Tensor exponentialOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, exponential(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Exponential, operand,
+                      result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, exponential(operand.getLinear(i)));
+  return result;
+}
+
+Tensor fftOp(const Tensor &operand, FftType fftType,
+             ArrayRef<int64_t> fftLength, ShapedType resultType) {
+  // Transforms a copy of the operand as complex doubles, one dimension at a
+  // time, since multidimensional transforms are separable.
+  SmallVector<int64_t> shape(operand.getShape());
+  auto data = getComplexData(operand);
+
+  int64_t rank = shape.size();
+  int64_t firstDim = rank - fftLength.size();
+  int64_t lastDim = rank - 1;
+  switch (fftType) {
+    case FftType::FFT:
+    case FftType::IFFT:
+      for (int64_t dim = firstDim; dim <= lastDim; ++dim)
+        fftAlongDim(data, shape, dim, fftType == FftType::IFFT);
+      break;
+    case FftType::RFFT: {
+      // Transforms the innermost dimension first, and only keeps the
+      // non-redundant half of its Hermitian-symmetric results.
+      fftAlongDim(data, shape, lastDim, /*inverse=*/false);
+      int64_t length = shape[lastDim];
+      int64_t halfLength = fftLength.back() / 2 + 1;
+      std::vector<std::complex<double>> half;
+      for (int64_t i = 0, e = data.size(); i < e; i += length)
+        half.insert(half.end(), data.begin() + i,
+                    data.begin() + i + halfLength);
+      data = std::move(half);
+      shape[lastDim] = halfLength;
+      for (int64_t dim = firstDim; dim < lastDim; ++dim)
+        fftAlongDim(data, shape, dim, /*inverse=*/false);
+      break;
+    }
+    case FftType::IRFFT: {
+      // Transforms the innermost dimension last, after restoring its
+      // redundant half from the Hermitian symmetry of real transforms.
+      for (int64_t dim = firstDim; dim < lastDim; ++dim)
+        fftAlongDim(data, shape, dim, /*inverse=*/true);
+      int64_t halfLength = shape[lastDim];
+      int64_t length = fftLength.back();
+      std::vector<std::complex<double>> full;
+      for (int64_t i = 0, e = data.size(); i < e; i += halfLength)
+        for (int64_t j = 0; j < length; ++j)
+          full.push_back(j < halfLength ? data[i + j]
+                                        : std::conj(data[i + length - j]));
+      data = std::move(full);
+      shape[lastDim] = length;
+      fftAlongDim(data, shape, lastDim, /*inverse=*/true);
+      break;
+    }
+  }
+
+  // Real results, i.e. of IRFFT, keep the real parts.
+  Tensor result(resultType);
+  setComplexData(result, data);
   return result;
 }
 
 Tensor floorOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, floor(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Floor, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, floor(operand.getLinear(i)));
   return result;
 }
 
@@ -1734,14 +3922,17 @@ Tensor gatherOp(const Tensor &operand, const Tensor &startIndices,
                 Axis indexVectorDim, const Sizes &sliceSizes,
                 bool indicesAreSorted, ShapedType resultType) {
   Tensor result(resultType);
+  if (evalGatherKernel(getKernelOptions(), operand, startIndices, offsetDims,
+                       collapsedSliceDims, operandBatchingDims,
+                       startIndicesBatchingDims, startIndexMap, indexVectorDim,
+                       sliceSizes, result))
+    return result;
+
   Axes batchDims;
   for (auto d : result.getAxes())
     if (!llvm::is_contained(offsetDims, d)) batchDims.push_back(d);
 
-  for (auto resultIt = result.index_begin(); resultIt != result.index_end();
-       ++resultIt) {
-    auto resultIndex = *resultIt;
-
+  parallelForIndices(result.getShape(), [&](const Index &resultIndex) {
     Index batchIndex;
     for (auto d : batchDims) batchIndex.push_back(resultIndex[d]);
 
@@ -1783,7 +3974,7 @@ Tensor gatherOp(const Tensor &operand, const Tensor &startIndices,
 
     auto operandIndex = fullStartIndex + fullBatchingIndex + fullOffsetIndex;
     result.set(resultIndex, operand.get(operandIndex));
-  }
+  });
   return result;
 }
 
@@ -1809,8 +4000,8 @@ SmallVector<InterpreterValue> ifOp(const Tensor &pred, Region &trueBranch,
 
 Tensor imagOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, imag(operand.get(*it)));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, imag(operand.getLinear(i)));
   return result;
 }
 
@@ -1820,11 +4011,16 @@ SmallVector<InterpreterValue> infeedOp(Token token, Process *process,
     llvm::report_fatal_error(
         "infeed is only supported when run via interpreter.run_parallel");
 
-  auto mnemonic = process->infeed();
-  auto results = eval(region.getParentOfType<ModuleOp>()
-                          .lookupSymbol<func::FuncOp>(mnemonic)
-                          .getBody(),
-                      {}, /*fallback=*/nullptr, process, &scope);
+  auto tensors = process->infeed([&](StringAttr mnemonic) {
+    auto programResults = eval(region.getParentOfType<ModuleOp>()
+                                   .lookupSymbol<func::FuncOp>(mnemonic)
+                                   .getBody(),
+                               {}, /*fallback=*/nullptr, process, &scope);
+    return llvm::map_to_vector(
+        programResults,
+        [](const InterpreterValue &value) { return value.getTensor(); });
+  });
+  SmallVector<InterpreterValue> results(tensors.begin(), tensors.end());
   results.push_back(token);
   return results;
 }
@@ -1832,89 +4028,116 @@ SmallVector<InterpreterValue> infeedOp(Token token, Process *process,
 Tensor iotaOp(Axis iotaDimension, ShapedType resultType) {
   Tensor result(resultType);
   auto elementType = result.getElementType();
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, convert(elementType, (*it)[iotaDimension]));
+  for (auto it = result.index_begin(), end = result.index_end(); it != end;
+       ++it)
+    result.setLinear(it.getLinearIndex(),
+                     convert(elementType, (*it)[iotaDimension]));
   return result;
 }
 
 Tensor isFiniteOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, isFinite(operand.get(*it)));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, isFinite(operand.getLinear(i)));
   return result;
 }
 
 Tensor log1pOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, logPlusOne(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::LogPlusOne, operand,
+                      result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, logPlusOne(operand.getLinear(i)));
   return result;
 }
 
 Tensor logOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, log(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Log, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, log(operand.getLinear(i)));
   return result;
 }
 
 Tensor logisticOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, logistic(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Logistic, operand,
+                      result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, logistic(operand.getLinear(i)));
   return result;
 }
 
 Tensor mapOp(ArrayRef<Tensor> inputs, Region &computation, Process *process,
              Scope &scope, ShapedType resultType) {
+  if (auto result = evalMapBody(inputs, computation, resultType))
+    return *result;
+
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it) {
+  auto preparedComputation = prepareRegion(computation);
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i) {
     SmallVector<InterpreterValue> args;
-    for (size_t i = 0; i < inputs.size(); ++i) {
-      Tensor tensor(cast<ShapedType>(computation.getArgument(i).getType()));
-      tensor.set({}, inputs[i].get(*it));
+    for (size_t j = 0; j < inputs.size(); ++j) {
+      Tensor tensor(cast<ShapedType>(computation.getArgument(j).getType()));
+      tensor.set({}, inputs[j].getLinear(i));
       args.emplace_back(tensor);
     }
-    result.set(*it,
-               eval(computation, args, /*fallback=*/nullptr, process, &scope)[0]
-                   .getTensor()
-                   .get({}));
+    result.setLinear(i, eval(*preparedComputation, std::move(args),
+                         /*fallback=*/nullptr, process, &scope)[0]
+                        .getTensor()
+                        .get({}));
   }
   return result;
 }
 
 Tensor maxOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
-  Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, max(lhs.get(*it), rhs.get(*it)));
+  auto result = donateOrAllocate(lhs, rhs, resultType);
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Maximum, lhs, rhs,
+                       result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, max(lhs.getLinear(i), rhs.getLinear(i)));
   return result;
 }
 
 Tensor minOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
-  Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, min(lhs.get(*it), rhs.get(*it)));
+  auto result = donateOrAllocate(lhs, rhs, resultType);
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Minimum, lhs, rhs,
+                       result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, min(lhs.getLinear(i), rhs.getLinear(i)));
   return result;
 }
 
 Tensor multiplyOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
-  Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, lhs.get(*it) * rhs.get(*it));
+  auto result = donateOrAllocate(lhs, rhs, resultType);
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Multiply, lhs, rhs,
+                       result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, lhs.getLinear(i) * rhs.getLinear(i));
   return result;
 }
 
 Tensor negOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, -operand.get(*it));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Negate, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, -operand.getLinear(i));
   return result;
 }
 
 Tensor notOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, ~operand.get(*it));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Not, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, ~operand.getLinear(i));
   return result;
 }
 
@@ -1925,8 +4148,10 @@ SmallVector<InterpreterValue> optimizationBarrierOp(
 
 Tensor orOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, lhs.get(*it) | rhs.get(*it));
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Or, lhs, rhs, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, lhs.getLinear(i) | rhs.getLinear(i));
   return result;
 }
 
@@ -1942,7 +4167,12 @@ Token outfeedOp(ArrayRef<Tensor> inputs, Token token, Process *process) {
 Tensor padOp(const Tensor &operand, const Tensor &paddingValue,
              const Sizes &edgePaddingLow, const Sizes &interiorPadding,
              ShapedType resultType) {
-  auto result = makeSplat(resultType, paddingValue.get({}));
+  Tensor result(resultType);
+  if (evalPadKernel(getKernelOptions(), operand, paddingValue, edgePaddingLow,
+                    interiorPadding, result))
+    return result;
+
+  result = makeSplat(resultType, paddingValue.get({}));
   for (auto operandIt = operand.index_begin(); operandIt != operand.index_end();
        ++operandIt) {
     auto operandIndex = *operandIt;
@@ -1966,22 +4196,28 @@ Tensor partitionIdOp(Process *process, MLIRContext *context) {
 
 Tensor populationCountOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, popcnt(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::PopulationCount, operand,
+                      result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, popcnt(operand.getLinear(i)));
   return result;
 }
 
 Tensor powerOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, power(lhs.get(*it), rhs.get(*it)));
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Power, lhs, rhs,
+                       result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, power(lhs.getLinear(i), rhs.getLinear(i)));
   return result;
 }
 
 Tensor realOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, real(operand.get(*it)));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, real(operand.getLinear(i)));
   return result;
 }
 
@@ -1998,10 +4234,20 @@ SmallVector<Tensor> reduceOp(ArrayRef<Tensor> inputs,
                              const Axes &dimensions, Region &body,
                              Process *process, Scope &scope,
                              ArrayRef<ShapedType> resultTypes) {
+  if (inputs.size() == 1) {
+    if (auto kernel = getReductionKernel(body)) {
+      Tensor result(resultTypes[0]);
+      if (evalReduceKernel(getKernelOptions(), *kernel, inputs[0],
+                           initValues[0], dimensions, result))
+        return {result};
+    }
+  }
+
   SmallVector<Tensor> results;
   for (auto [resultType, initValue] : llvm::zip(resultTypes, initValues))
     results.push_back(makeSplat(resultType, initValue.get({})));
 
+  auto preparedBody = prepareRegion(body);
   for (auto inputIt = inputs[0].index_begin(); inputIt != inputs[0].index_end();
        ++inputIt) {
     Index resultIndex;
@@ -2018,20 +4264,32 @@ SmallVector<Tensor> reduceOp(ArrayRef<Tensor> inputs,
       bodyArgs.emplace_back(
           makeSplat(initValue.getType(), input.get(*inputIt)));
 
-    auto bodyResult =
-        eval(body, bodyArgs, /*fallback=*/nullptr, process, &scope);
+    auto bodyResult = eval(*preparedBody, std::move(bodyArgs),
+                           /*fallback=*/nullptr, process, &scope);
     for (auto [result, value] : llvm::zip(results, bodyResult))
       result.set(resultIndex, value.getTensor().get({}));
   }
   return results;
 }
 
+std::unique_ptr<StreamingReduction> makeStreamingReduction(ReduceOp op) {
+  if (op.getInputs().size() != 1) return nullptr;
+  auto kernel = getReductionKernel(op.getBody());
+  auto initValue = op.getInitValues()[0].getDefiningOp<ConstantOp>();
+  if (!kernel || !initValue) return nullptr;
+  return StreamingReduction::create(
+      getKernelOptions(), *kernel,
+      cast<ShapedType>(op.getInputs()[0].getType()),
+      constantOp(initValue.getValue()), Axes(op.getDimensions()),
+      cast<ShapedType>(op.getResult(0).getType()));
+}
+
 Tensor reducePrecisionOp(const Tensor &operand, int32_t exponentBits,
                          int32_t mantissaBits, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it,
-               reducePrecision(operand.get(*it), exponentBits, mantissaBits));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, reducePrecision(operand.getLinear(i), exponentBits,
+                                        mantissaBits));
   return result;
 }
 
@@ -2083,6 +4341,17 @@ SmallVector<Tensor> reduceWindowOp(
     const Sizes &baseDilations, const Sizes &windowDilations,
     const Sizes &paddingLow, const Sizes &paddingHigh, Region &body,
     Process *process, Scope &scope, ArrayRef<ShapedType> resultTypes) {
+  if (inputs.size() == 1) {
+    if (auto kernel = getReductionKernel(body)) {
+      Tensor result(resultTypes[0]);
+      if (evalReduceWindowKernel(getKernelOptions(), *kernel, inputs[0],
+                                 initValues[0], windowDimensions, windowStrides,
+                                 baseDilations, windowDilations, paddingLow,
+                                 result))
+        return {result};
+    }
+  }
+
   SmallVector<Tensor> results;
   for (auto [resultType, initValue] : llvm::zip(resultTypes, initValues))
     results.push_back(makeSplat(resultType, initValue.get({})));
@@ -2110,8 +4379,11 @@ SmallVector<Tensor> reduceWindowOp(
 
 Tensor remOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, rem(lhs.get(*it), rhs.get(*it)));
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Remainder, lhs, rhs,
+                       result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, rem(lhs.getLinear(i), rhs.getLinear(i)));
   return result;
 }
 
@@ -2125,6 +4397,8 @@ Tensor replicaIdOp(Process *process, MLIRContext *context) {
 }
 
 Tensor reshapeOp(const Tensor &operand, ShapedType resultType) {
+  if (auto view = evalReshapeView(getKernelOptions(), operand, resultType))
+    return view;
   Tensor result(resultType);
   for (auto resultIt = result.index_begin(), operandIt = operand.index_begin();
        resultIt != result.index_end(); ++resultIt, ++operandIt) {
@@ -2137,6 +4411,9 @@ Tensor reshapeOp(const Tensor &operand, ShapedType resultType) {
 
 Tensor reverseOp(const Tensor &operand, const Axes &dimensions,
                  ShapedType resultType) {
+  if (auto view = evalReverseView(getKernelOptions(), operand, dimensions,
+                                  resultType))
+    return view;
   Tensor result(resultType);
   for (auto resultIt = result.index_begin(); resultIt != result.index_end();
        ++resultIt) {
@@ -2149,24 +4426,88 @@ Tensor reverseOp(const Tensor &operand, const Axes &dimensions,
   return result;
 }
 
+SmallVector<Tensor> rngBitGeneratorOp(RngAlgorithm rngAlgorithm,
+                                      const Tensor &initialState,
+                                      ShapedType outputType) {
+  // Reads the key and the counter from the state like the Linalg lowering:
+  // a tensor<2xi64> or tensor<3xi64> holds the key in its first element and
+  // the counter in its second one, and a tensor<4xi32> holds the two words
+  // of the key followed by the high and low words of the counter, whose
+  // low and high words are then written back in that order.
+  auto stateType = initialState.getType();
+  auto stateElementType = stateType.getElementType();
+  int64_t stateSize = stateType.getNumElements();
+  uint32_t key0, key1;
+  uint64_t counter;
+  if (stateElementType.isInteger(64) && (stateSize == 2 || stateSize == 3)) {
+    auto state = initialState.getData<uint64_t>();
+    key0 = static_cast<uint32_t>(state[0]);
+    key1 = static_cast<uint32_t>(state[0] >> 32);
+    counter = state[1];
+  } else if (stateElementType.isInteger(32) && stateSize == 4) {
+    auto state = initialState.getData<uint32_t>();
+    key0 = state[0];
+    key1 = state[1];
+    counter = uint64_t{state[3]} | uint64_t{state[2]} << 32;
+  } else {
+    report_fatal_error(
+        invalidArgument("Unsupported initial state of type %s",
+                        debugString(stateType).c_str()));
+  }
+
+  auto elementType = outputType.getElementType();
+  int64_t bitWidth = elementType.getIntOrFloatBitWidth();
+  if (bitWidth != 8 && bitWidth != 16 && bitWidth != 32 && bitWidth != 64)
+    report_fatal_error(invalidArgument("Unsupported output of type %s",
+                                       debugString(outputType).c_str()));
+
+  Tensor output(outputType);
+  int64_t numCounters =
+      rngAlgorithm == RngAlgorithm::THREE_FRY
+          ? generateThreeFryBits(key0, key1, counter, outputType.getShape(),
+                                 bitWidth, output.getMutableData())
+          : generatePhiloxBits(key0, key1, counter, outputType.getShape(),
+                               bitWidth, output.getMutableData());
+
+  Tensor outputState(stateType);
+  llvm::copy(initialState.getData(), outputState.getMutableData().begin());
+  counter += numCounters;
+  if (stateElementType.isInteger(64)) {
+    outputState.getMutableData<uint64_t>()[1] = counter;
+  } else {
+    auto state = outputState.getMutableData<uint32_t>();
+    state[2] = static_cast<uint32_t>(counter);
+    state[3] = static_cast<uint32_t>(counter >> 32);
+  }
+  return {outputState, output};
+}
+
 Tensor roundNearestEvenOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, roundNearestEven(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::RoundNearestEven,
+                      operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, roundNearestEven(operand.getLinear(i)));
   return result;
 }
 
 Tensor roundOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, roundNearestAfz(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::RoundNearestAfz, operand,
+                      result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, roundNearestAfz(operand.getLinear(i)));
   return result;
 }
 
 Tensor rsqrtOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, rsqrt(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Rsqrt, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, rsqrt(operand.getLinear(i)));
   return result;
 }
 
@@ -2179,7 +4520,21 @@ SmallVector<Tensor> scatterOp(
     Region &updateComputation, Process *process, Scope &scope,
     ArrayRef<ShapedType> resultTypes) {
   SmallVector<Tensor> results;
-  for (const auto &input : inputs) results.push_back(input);
+  for (const auto &input : inputs) results.push_back(donateOrCopy(input));
+  if (results.size() == 1) {
+    auto kernel = getReductionKernel(updateComputation);
+    if ((kernel || isReplaceComputation(updateComputation)) &&
+        evalScatterKernel(getKernelOptions(), kernel, scatterIndices,
+                          updates[0], updateWindowDims, insertedWindowDims,
+                          inputBatchingDims, scatterIndicesBatchingDims,
+                          scatterDimsToOperandDims, indexVectorDim, results[0]))
+      return results;
+  }
+  auto updateFunction = ScalarFunction::compile(updateComputation);
+  std::shared_ptr<const PreparedRegion> preparedUpdateComputation;
+  if (!updateFunction)
+    preparedUpdateComputation = prepareRegion(updateComputation);
+  SmallVector<Element> args, slots, updatedElements;
 
   Axes updateScatterDims;
   for (auto d : updates[0].getAxes())
@@ -2230,14 +4585,28 @@ SmallVector<Tensor> scatterOp(
     auto resultIndex = fullStartIndex + fullBatchingIndex + fullWindowIndex;
     if (!resultIndex.inBounds(results[0].getShape())) continue;
 
+    if (updateFunction) {
+      args.clear();
+      for (const auto &result : results)
+        args.push_back(result.get(resultIndex));
+      for (const auto &update : updates)
+        args.push_back(update.get(updateIndex));
+      (*updateFunction)(args, slots, updatedElements);
+      for (auto [result, updatedElement] :
+           llvm::zip(results, updatedElements))
+        result.set(resultIndex, updatedElement);
+      continue;
+    }
+
     SmallVector<InterpreterValue> updateComputationArgs;
     for (const auto &result : results)
       updateComputationArgs.push_back(constant(result.get(resultIndex)));
     for (const auto &update : updates)
       updateComputationArgs.push_back(constant(update.get(updateIndex)));
 
-    auto updatedValues = eval(updateComputation, updateComputationArgs,
-                              /*fallback=*/nullptr, process, &scope);
+    auto updatedValues =
+        eval(*preparedUpdateComputation, std::move(updateComputationArgs),
+             /*fallback=*/nullptr, process, &scope);
     for (auto [result, updatedValue] : llvm::zip(results, updatedValues))
       result.set(resultIndex, updatedValue.getTensor().get({}));
   }
@@ -2252,49 +4621,63 @@ Tensor selectAndScatterOp(const Tensor &operand, const Tensor &source,
                           Region &select, Region &scatter, Process *process,
                           Scope &scope, ShapedType resultType) {
   auto result = makeSplat(resultType, initValue.get({}));
-
+  auto init = initValue.get({});
+
+  // Both computations are evaluated through `ScalarFunction` if they can be
+  // compiled, and through `eval` otherwise.
+  auto selectFunction = ScalarFunction::compile(select);
+  auto scatterFunction = ScalarFunction::compile(scatter);
+  std::shared_ptr<const PreparedRegion> preparedSelect;
+  if (!selectFunction) preparedSelect = prepareRegion(select);
+  SmallVector<Element> slots, results;
+  auto isSelected = [&](const Element &selectedVal, const Element &currVal) {
+    if (selectFunction) {
+      (*selectFunction)({selectedVal, currVal}, slots, results);
+      return results[0].getBooleanValue();
+    }
+    InterpreterValue selectedInterpreterVal(constant(selectedVal));
+    InterpreterValue currInterpreterVal(constant(currVal));
+    auto selectResult =
+        eval(*preparedSelect, {selectedInterpreterVal, currInterpreterVal},
+             /*fallback=*/nullptr, process, &scope);
+    return selectResult[0].getTensor().get({}).getBooleanValue();
+  };
+  // Like `reduceOp` of the source value and the current value from
+  // `initValue`, which applies `scatter` to them in this order.
+  auto scatterValue = [&](const Element &sourceVal, const Element &currVal) {
+    if (scatterFunction) {
+      (*scatterFunction)({init, sourceVal}, slots, results);
+      (*scatterFunction)({results[0], currVal}, slots, results);
+      return results[0];
+    }
+    Tensor sourceValues(RankedTensorType::get({2}, initValue.getElementType()));
+    sourceValues.set({0}, sourceVal);
+    sourceValues.set({1}, currVal);
+    auto reducedResult =
+        reduceOp({sourceValues}, {initValue}, {0}, scatter, process, scope);
+    return reducedResult[0].get({});
+  };
+
+  // The window of every source element is visited once to select an operand
+  // element, into which the source element is scattered.
   for (auto sourceIt = source.index_begin(); sourceIt != source.index_end();
        ++sourceIt) {
     std::optional<Element> selectedVal;
     std::optional<Index> selectedIndex;
-    auto iterateThroughWindow = [&](std::function<void(const Index &)> body) {
-      for (auto windowIt = windowDimensions.index_begin();
-           windowIt != windowDimensions.index_end(); ++windowIt) {
-        auto operandIndex = *sourceIt * windowStrides + *windowIt - paddingLow;
-        if (!operandIndex.inBounds(operand.getShape())) continue;
-        body(operandIndex);
-      }
-    };
-    iterateThroughWindow([&](const Index &operandIndex) {
+    auto windowStart = *sourceIt * windowStrides - paddingLow;
+    for (auto windowIt = windowDimensions.index_begin();
+         windowIt != windowDimensions.index_end(); ++windowIt) {
+      auto operandIndex = windowStart + *windowIt;
+      if (!operandIndex.inBounds(operand.getShape())) continue;
       auto currVal = operand.get(operandIndex);
-      if (!selectedVal) {
-        selectedVal = currVal;
-        selectedIndex = operandIndex;
-      }
-
-      InterpreterValue selectedInterpreterVal(constant(selectedVal.value()));
-      InterpreterValue currInterpreterVal(constant(currVal));
-      auto selectResult =
-          eval(select, {selectedInterpreterVal, currInterpreterVal},
-               /*fallback=*/nullptr, process, &scope);
-
-      bool selected = !selectResult[0].getTensor().get({}).getBooleanValue();
-      if (selected) {
+      if (!selectedVal || !isSelected(*selectedVal, currVal)) {
         selectedVal = currVal;
         selectedIndex = operandIndex;
       }
-    });
-    iterateThroughWindow([&](const Index &operandIndex) {
-      if (operandIndex == selectedIndex) {
-        Tensor sourceValues(
-            RankedTensorType::get({2}, initValue.getElementType()));
-        sourceValues.set({0}, source.get(*sourceIt));
-        sourceValues.set({1}, result.get(operandIndex));
-        auto reducedResult =
-            reduceOp({sourceValues}, {initValue}, {0}, scatter, process, scope);
-        result.set(operandIndex, reducedResult[0].get({}));
-      }
-    });
+    }
+    if (selectedIndex)
+      result.set(*selectedIndex, scatterValue(source.get(*sourceIt),
+                                              result.get(*selectedIndex)));
   }
   return result;
 }
@@ -2302,6 +4685,8 @@ Tensor selectAndScatterOp(const Tensor &operand, const Tensor &source,
 Tensor selectOp(const Tensor &pred, const Tensor &onTrue, const Tensor &onFalse,
                 ShapedType resultType) {
   Tensor result(resultType);
+  if (evalSelectKernel(getKernelOptions(), pred, onTrue, onFalse, result))
+    return result;
   for (auto it = result.index_begin(); it != result.index_end(); ++it) {
     Element predValue = pred.getRank() != 0 ? pred.get(*it) : pred.get({});
     result.set(
@@ -2319,43 +4704,51 @@ Token sendOp(ArrayRef<Tensor> inputs, Token token, ChannelId channelId,
 Tensor shiftLeftOp(const Tensor &lhs, const Tensor &rhs,
                    ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, shiftLeft(lhs.get(*it), rhs.get(*it)));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, shiftLeft(lhs.getLinear(i), rhs.getLinear(i)));
   return result;
 }
 
 Tensor shiftRightArithmeticOp(const Tensor &lhs, const Tensor &rhs,
                               ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, shiftRightArithmetic(lhs.get(*it), rhs.get(*it)));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(
+        i, shiftRightArithmetic(lhs.getLinear(i), rhs.getLinear(i)));
   return result;
 }
 
 Tensor shiftRightLogicalOp(const Tensor &lhs, const Tensor &rhs,
                            ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, shiftRightLogical(lhs.get(*it), rhs.get(*it)));
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, shiftRightLogical(lhs.getLinear(i), rhs.getLinear(i)));
   return result;
 }
 
 Tensor signOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, sign(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Sign, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, sign(operand.getLinear(i)));
   return result;
 }
 
 Tensor sineOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, sine(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Sine, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, sine(operand.getLinear(i)));
   return result;
 }
 
 Tensor sliceOp(const Tensor &operand, const Sizes &startIndices,
                const Sizes &strides, ShapedType resultType) {
+  if (auto view = evalSliceView(getKernelOptions(), operand, startIndices,
+                                strides, resultType))
+    return view;
   Tensor result(resultType);
   for (auto resultIt = result.index_begin(); resultIt != result.index_end();
        ++resultIt) {
@@ -2374,6 +4767,14 @@ SmallVector<Tensor> sortOp(ArrayRef<Tensor> inputs, Axis dimension,
   auto adjustedDimension =
       dimension >= 0 ? dimension : dimension + inputs[0].getRank();
 
+  if (auto sortComparator = getSortComparator(comparator))
+    if (evalSortKernel(getKernelOptions(), inputs, adjustedDimension, isStable,
+                       sortComparator->keyIndex,
+                       sortComparator->comparisonDirection,
+                       sortComparator->isTotalOrder, results))
+      return results;
+
+  auto preparedComparator = prepareRegion(comparator);
   for (auto resultIt = results[0].index_begin();
        resultIt != results[0].index_end(); ++resultIt) {
     // resultIt iterates through all indices in the index space, but sorting
@@ -2401,8 +4802,8 @@ SmallVector<Tensor> sortOp(ArrayRef<Tensor> inputs, Axis dimension,
         args.emplace_back(constant(input.get(lhsIndex)));
         args.emplace_back(constant(input.get(rhsIndex)));
       }
-      auto comparatorResult =
-          eval(comparator, args, /*fallback=*/nullptr, process, &scope);
+      auto comparatorResult = eval(*preparedComparator, std::move(args),
+                                   /*fallback=*/nullptr, process, &scope);
       return comparatorResult[0].getTensor().get({}).getBooleanValue();
     };
     if (isStable)
@@ -2415,7 +4816,7 @@ SmallVector<Tensor> sortOp(ArrayRef<Tensor> inputs, Axis dimension,
     // After the tensor of handles has been sorted, we apply the results of
     // this sort by reshuffling input elements into result elements.
     auto &resultsTogether = inputsTogether;
-    for (auto [inputHandle, resultHandle] : llvm::enumerate(resultsTogether)) {
+    for (auto [resultHandle, inputHandle] : llvm::enumerate(resultsTogether)) {
       for (auto [input, result] : llvm::zip(inputs, results)) {
         auto inputIndex = *resultIt;
         auto resultIndex = *resultIt;
@@ -2430,36 +4831,92 @@ SmallVector<Tensor> sortOp(ArrayRef<Tensor> inputs, Axis dimension,
 
 Tensor sqrtOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, sqrt(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Sqrt, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, sqrt(operand.getLinear(i)));
   return result;
 }
 
 Tensor subtractOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
-  Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, lhs.get(*it) - rhs.get(*it));
+  auto result = donateOrAllocate(lhs, rhs, resultType);
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Subtract, lhs, rhs,
+                       result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, lhs.getLinear(i) - rhs.getLinear(i));
   return result;
 }
 
 Tensor tanhOp(const Tensor &operand, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, tanh(operand.get(*it)));
+  if (evalUnaryKernel(getKernelOptions(), UnaryKernel::Tanh, operand, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, tanh(operand.getLinear(i)));
   return result;
 }
 
 Tensor transposeOp(const Tensor &operand, const Axes &permutation,
                    ShapedType resultType) {
+  if (auto view = evalTransposeView(getKernelOptions(), operand, permutation,
+                                    resultType))
+    return view;
   Tensor result(resultType);
-  for (auto operandIt = operand.index_begin(); operandIt != operand.index_end();
-       ++operandIt) {
-    auto operandIndex = *operandIt;
-    Index resultIndex(result.getRank());
+  parallelForIndices(result.getShape(), [&](const Index &resultIndex) {
+    Index operandIndex(operand.getRank());
     for (auto d = 0; d < result.getRank(); d++)
-      resultIndex[d] = operandIndex[permutation[d]];
+      operandIndex[permutation[d]] = resultIndex[d];
     result.set(resultIndex, operand.get(operandIndex));
+  });
+  return result;
+}
+
+Tensor triangularSolveOp(const Tensor &a, const Tensor &b, bool leftSide,
+                         bool lower, bool unitDiagonal, Transpose transposeA,
+                         ShapedType resultType) {
+  Tensor result(resultType);
+  if (evalTriangularSolveKernel(getKernelOptions(), a, b, leftSide, lower,
+                                unitDiagonal,
+                                transposeA != Transpose::NO_TRANSPOSE, result))
+    return result;
+
+  // Solves every system as `T * X = B` for `T = op(a)`, where systems
+  // `X * op(a) = b` are transposed into `op(a)^T * X^T = b^T`, by forward
+  // substitution if `T` is lower triangular and backward substitution
+  // otherwise.
+  auto aData = getComplexData(a);
+  auto data = getComplexData(b);
+  auto shape = b.getShape();
+  int64_t rank = shape.size();
+  int64_t n = a.getShape().back();
+  int64_t m = leftSide ? shape[rank - 1] : shape[rank - 2];
+  bool isTransposed = (transposeA != Transpose::NO_TRANSPOSE) != !leftSide;
+  bool isConjugated = transposeA == Transpose::ADJOINT;
+  bool isLower = lower != isTransposed;
+  auto t = [&](int64_t offset, int64_t i, int64_t j) {
+    auto value = aData[offset + (isTransposed ? j * n + i : i * n + j)];
+    return isConjugated ? std::conj(value) : value;
+  };
+  auto bAt = [&](int64_t i, int64_t j) {
+    return leftSide ? i * m + j : j * n + i;
+  };
+  for (int64_t batch = 0, e = n * m == 0 ? 0 : data.size() / (n * m);
+       batch < e; ++batch) {
+    int64_t aOffset = batch * n * n;
+    int64_t bOffset = batch * n * m;
+    for (int64_t step = 0; step < n; ++step) {
+      int64_t i = isLower ? step : n - 1 - step;
+      for (int64_t j = 0; j < m; ++j) {
+        auto &x = data[bOffset + bAt(i, j)];
+        for (int64_t k = isLower ? 0 : i + 1, end = isLower ? i : n; k < end;
+             ++k)
+          x -= t(aOffset, i, k) * data[bOffset + bAt(k, j)];
+        if (!unitDiagonal) x /= t(aOffset, i, i);
+      }
+    }
   }
+  setComplexData(result, data);
   return result;
 }
 
@@ -2467,26 +4924,61 @@ Tuple tupleOp(ArrayRef<InterpreterValue> val, TupleType resultType) {
   return Tuple(val, resultType);
 }
 
+Tensor uniformDequantizeOp(const Tensor &operand, ShapedType resultType) {
+  return dequantize(operand, resultType);
+}
+
+Tensor uniformQuantizeOp(const Tensor &operand, ShapedType resultType) {
+  return quantize(operand, resultType);
+}
+
 SmallVector<InterpreterValue> whileOp(SmallVector<InterpreterValue> operand,
                                       Region &cond, Region &body,
                                       InterpreterFallback *fallback,
                                       Process *process, Scope &scope) {
-  SmallVector<InterpreterValue> results(operand);
-
-  auto condResults = eval(cond, operand, fallback, process, &scope);
-
-  while (condResults[0].getTensor().get({}).getBooleanValue()) {
-    results = eval(body, results, fallback, process, &scope);
-    condResults = eval(cond, results, fallback, process, &scope);
+  SmallVector<InterpreterValue> results(std::move(operand));
+  auto preparedCond = prepareRegion(cond);
+  auto preparedBody = prepareRegion(body);
+
+  // Every iteration evaluates `cond` and `body` in the same two scopes, which
+  // are emptied after each evaluation. The loop-carried values are moved into
+  // `body` and its results out of it, so that if nothing else references
+  // them, `body` holds the only references, e.g. to a cache which it updates
+  // in place slice by slice.
+  Scope condScope(&scope);
+  Scope bodyScope(&scope);
+  auto evalCond = [&]() {
+    auto condResults =
+        evalInScope(*preparedCond, results, fallback, process, condScope);
+    return condResults[0].getTensor().get({}).getBooleanValue();
+  };
+
+  // Loops which are checkpointed continue from their latest checkpoint, if
+  // any, and loops which finished are skipped.
+  std::optional<Checkpointer::Loop> checkpointedLoop;
+  auto *checkpointer = getCheckpointer();
+  if (checkpointer) {
+    checkpointedLoop =
+        checkpointer->beginLoop(*cond.getParentOp(), process, results);
+    if (checkpointedLoop && checkpointedLoop->finished) return results;
   }
 
+  while (evalCond()) {
+    results = evalInScope(*preparedBody, std::move(results), fallback, process,
+                          bodyScope);
+    if (checkpointedLoop)
+      checkpointer->endIteration(*checkpointedLoop, results);
+  }
+  if (checkpointedLoop) checkpointer->endLoop(*checkpointedLoop, results);
   return results;
 }
 
 Tensor xorOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType) {
   Tensor result(resultType);
-  for (auto it = result.index_begin(); it != result.index_end(); ++it)
-    result.set(*it, lhs.get(*it) ^ rhs.get(*it));
+  if (evalBinaryKernel(getKernelOptions(), BinaryKernel::Xor, lhs, rhs, result))
+    return result;
+  for (int64_t i = 0, e = result.getNumElements(); i < e; ++i)
+    result.setLinear(i, lhs.getLinear(i) ^ rhs.getLinear(i));
   return result;
 }
 
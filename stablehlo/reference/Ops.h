@@ -16,7 +16,14 @@ limitations under the License.
 #ifndef STABLEHLO_REFERENCE_OPS_H
 #define STABLEHLO_REFERENCE_OPS_H
 
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+
+#include "llvm/ADT/DenseMap.h"
 #include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
 #include "stablehlo/dialect/StablehloOps.h"
 #include "stablehlo/reference/Axes.h"
 #include "stablehlo/reference/Configuration.h"
@@ -30,6 +37,125 @@ limitations under the License.
 namespace mlir {
 namespace stablehlo {
 
+/// Kinds of ops which `eval` dispatches on.
+enum class OpKind : uint8_t;
+
+class StreamingReduction;
+
+/// Region prepared for evaluation. Preparing a region resolves the kinds of
+/// its ops, computes which values are dead after each of its ops and, if
+/// dataflow execution is enabled, computes its dataflow graph once, so
+/// that ops which evaluate the same region many times, e.g. `whileOp` and
+/// `reduceOp`, don't repeat this work for every evaluation. Assumes that the
+/// region has only one block, which isn't modified while the PreparedRegion
+/// object is alive.
+class PreparedRegion {
+ public:
+  /// An op of the region, together with the values defined in the region which
+  /// are used for the last time by the op.
+  struct PreparedOp {
+    Operation *operation;
+    OpKind kind;
+    /// Dead values used by the op only as operands, which ops that can reuse
+    /// the storage of their operands release before evaluation.
+    SmallVector<Value> deadOperands;
+    /// Other dead values, e.g. unused results of the op or values used within
+    /// its regions.
+    SmallVector<Value> deadValues;
+    /// The result of the op if it is a `constant`, which is materialized once
+    /// and shared by all evaluations of the region rather than copied from
+    /// its attribute on every evaluation.
+    Tensor constant;
+
+    /// The following fields describe the dataflow graph of the region and
+    /// are only computed if dataflow execution is enabled.
+    ///
+    /// Positions of the ops which depend on the op, either because they use
+    /// its results or because both have side effects, in which case they
+    /// keep their order in the region.
+    SmallVector<unsigned> successors;
+    /// Number of ops the op depends on.
+    unsigned numPredecessors = 0;
+    /// Positions in `getValues()` of the values defined in the region which
+    /// the op uses only as operands.
+    SmallVector<unsigned> operandUses;
+    /// Positions in `getValues()` of the values defined in the region which
+    /// are used within the regions of the op.
+    SmallVector<unsigned> regionUses;
+  };
+
+  explicit PreparedRegion(Region &region);
+
+  /// Returns the region.
+  Region &getRegion() const { return *region_; }
+
+  /// Returns the ops of the region in order.
+  ArrayRef<PreparedOp> getOps() const { return ops_; }
+
+  /// Returns whether some ops of the region can be evaluated concurrently
+  /// according to its dataflow graph.
+  bool hasConcurrentOps() const { return hasConcurrentOps_; }
+
+  /// Returns the block arguments and op results of the region which have
+  /// uses, if dataflow execution is enabled.
+  ArrayRef<Value> getValues() const { return values_; }
+
+  /// Returns the number of ops which use each of `getValues()`.
+  ArrayRef<unsigned> getNumUsers() const { return numUsers_; }
+
+ private:
+  Region *region_;
+  SmallVector<PreparedOp> ops_;
+  bool hasConcurrentOps_ = false;
+  SmallVector<Value> values_;
+  SmallVector<unsigned> numUsers_;
+};
+
+/// While alive, `eval` and ops with regions, e.g. `whileOp` and `reduceOp`,
+/// prepare every region nested in `module` only once and reuse it in
+/// subsequent evaluations, on all threads, instead of preparing it on every
+/// evaluation. This speeds up modules which are evaluated many times. The
+/// module must not be modified while the cache is alive. Only one cache per
+/// module is used at a time.
+class PreparedRegionCache {
+ public:
+  explicit PreparedRegionCache(ModuleOp module);
+  ~PreparedRegionCache();
+
+  PreparedRegionCache(const PreparedRegionCache &) = delete;
+  PreparedRegionCache &operator=(const PreparedRegionCache &) = delete;
+
+  /// Returns `region`, which is nested in the module, prepared. Thread-safe.
+  const PreparedRegion &getOrPrepare(Region &region);
+
+ private:
+  ModuleOp module_;
+
+  /// Guards `regions_`.
+  std::shared_mutex mutex_;
+  llvm::DenseMap<Region *, std::unique_ptr<PreparedRegion>> regions_;
+};
+
+/// Returns `region` prepared by the `PreparedRegionCache` of its module if
+/// there is one, and prepares it otherwise.
+std::shared_ptr<const PreparedRegion> prepareRegion(Region &region);
+
+/// If enabled and an intra-op thread pool is set, `eval` evaluates the ops of
+/// a region which don't depend on each other concurrently on that pool, as
+/// soon as the ops they depend on are done. Ops with side effects, e.g.
+/// `outfeed`, `send` and `recv`, and collectives are still evaluated in
+/// their order in the region.
+///
+/// Returns whether dataflow execution is enabled in the current
+/// `EvaluationContext`, which it isn't by default.
+bool isDataflowExecutionEnabled();
+
+/// Returns a `StreamingReduction` which evaluates `op` like `reduceOp` from
+/// chunks of its input, or nullptr if `op` has more than one input, if its
+/// init value isn't defined by a `constant` or if no native kernel applies,
+/// e.g. because its body doesn't apply one associative op to its arguments.
+std::unique_ptr<StreamingReduction> makeStreamingReduction(ReduceOp op);
+
 // Evaluators for StableHLO ops.
 Tensor absOp(const Tensor &operand, ShapedType resultType);
 Tensor addOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType);
@@ -49,6 +175,22 @@ Tensor allToAllOp(const Tensor &operand, Axis splitDimension,
                   ChannelId channelId, Process *process, ShapedType resultType);
 Tensor andOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType);
 Tensor atan2Op(const Tensor &lhs, const Tensor &rhs, ShapedType resultType);
+SmallVector<Tensor> batchNormGradOp(
+    const Tensor &operand, const Tensor &scale, const Tensor &mean,
+    const Tensor &variance, const Tensor &gradOutput, double epsilon,
+    Axis featureIndex, ShapedType gradOperandType, ShapedType gradScaleType,
+    ShapedType gradOffsetType);
+Tensor batchNormInferenceOp(const Tensor &operand, const Tensor &scale,
+                            const Tensor &offset, const Tensor &mean,
+                            const Tensor &variance, double epsilon,
+                            Axis featureIndex, ShapedType resultType);
+SmallVector<Tensor> batchNormTrainingOp(const Tensor &operand,
+                                        const Tensor &scale,
+                                        const Tensor &offset, double epsilon,
+                                        Axis featureIndex,
+                                        ShapedType outputType,
+                                        ShapedType batchMeanType,
+                                        ShapedType batchVarType);
 Tensor bitcastConvertOp(const Tensor &operand, ShapedType resultType);
 Tensor broadcastInDimOp(const Tensor &operand, const Axes &broadcastDimensions,
                         ShapedType resultType);
@@ -56,6 +198,7 @@ SmallVector<InterpreterValue> caseOp(const Tensor &index, RegionRange branches,
                                      Process *process, Scope &scope);
 Tensor cbrtOp(const Tensor &operand, ShapedType resultType);
 Tensor ceilOp(const Tensor &operand, ShapedType resultType);
+Tensor choleskyOp(const Tensor &a, bool lower, ShapedType resultType);
 Tensor clampOp(const Tensor &min, const Tensor &operand, const Tensor &max,
                ShapedType resultType);
 Tensor clzOp(const Tensor &operand, ShapedType resultType);
@@ -67,6 +210,7 @@ Tensor collectivePermuteOp(const Tensor &operand,
                            ChannelId channelId, Process *process);
 Tensor compareOp(const Tensor &lhs, const Tensor &rhs,
                  ComparisonDirection comparisonDirection,
+                 std::optional<ComparisonType> compareType,
                  ShapedType resultType);
 Tensor complexOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType);
 Tensor concatenateOp(ArrayRef<Tensor> inputs, Axis dimension,
@@ -98,6 +242,8 @@ Tensor dynamicUpdateSliceOp(const Tensor &operand, const Tensor &update,
                             ShapedType resultType);
 Tensor expm1Op(const Tensor &operand, ShapedType resultType);
 Tensor exponentialOp(const Tensor &operand, ShapedType resultType);
+Tensor fftOp(const Tensor &operand, FftType fftType,
+             ArrayRef<int64_t> fftLength, ShapedType resultType);
 Tensor floorOp(const Tensor &operand, ShapedType resultType);
 Tensor gatherOp(const Tensor &operand, const Tensor &startIndices,
                 const Axes &offsetDims, const Axes &collapsedSliceDims,
@@ -163,6 +309,9 @@ Tensor reshapeOp(const Tensor &operand, ShapedType resultType);
 Tensor reverseOp(const Tensor &operand, const Axes &dimensions,
                  ShapedType resultType);
 Tensor roundOp(const Tensor &operand, ShapedType resultType);
+SmallVector<Tensor> rngBitGeneratorOp(RngAlgorithm rngAlgorithm,
+                                      const Tensor &initialState,
+                                      ShapedType outputType);
 Tensor roundNearestEvenOp(const Tensor &operand, ShapedType resultType);
 Tensor rsqrtOp(const Tensor &operand, ShapedType resultType);
 SmallVector<Tensor> scatterOp(
@@ -200,13 +349,22 @@ Tensor subtractOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType);
 Tensor tanhOp(const Tensor &operand, ShapedType resultType);
 Tensor transposeOp(const Tensor &operand, const Axes &permutation,
                    ShapedType resultType);
+Tensor triangularSolveOp(const Tensor &a, const Tensor &b, bool leftSide,
+                         bool lower, bool unitDiagonal, Transpose transposeA,
+                         ShapedType resultType);
 Tuple tupleOp(ArrayRef<InterpreterValue> val, TupleType resultType);
+Tensor uniformDequantizeOp(const Tensor &operand, ShapedType resultType);
+Tensor uniformQuantizeOp(const Tensor &operand, ShapedType resultType);
 SmallVector<InterpreterValue> whileOp(SmallVector<InterpreterValue> operand,
                                       Region &cond, Region &body,
                                       InterpreterFallback *fallback,
                                       Process *process, Scope &scope);
 Tensor xorOp(const Tensor &lhs, const Tensor &rhs, ShapedType resultType);
 
+/// Returns whether `eval` evaluates `operation` and the ops nested in its
+/// regions itself, without calling an InterpreterFallback.
+bool isInterpretable(Operation &operation);
+
 /// Evaluates an mlir::Region `region` using the runtime values `args`
 /// corresponding to the arguments of the entry block of the region.
 /// Interprets the operations within the entry block and returns the runtime
@@ -219,6 +377,25 @@ SmallVector<InterpreterValue> eval(Region &region,
                                    Process *process = nullptr,
                                    Scope *parent = nullptr);
 
+/// Same as the above, but evaluates a prepared region and takes ownership of
+/// `args`. This lets ops within the region reuse the storage of arguments
+/// which are referenced nowhere else, e.g. to update loop-carried values of
+/// `whileOp` in place.
+SmallVector<InterpreterValue> eval(const PreparedRegion &region,
+                                   SmallVector<InterpreterValue> args,
+                                   InterpreterFallback *fallback = nullptr,
+                                   Process *process = nullptr,
+                                   Scope *parent = nullptr);
+
+/// Same as the above, but evaluates `region` in `scope`, which must be empty,
+/// rather than in a new scope, and empties it again before returning. Ops which
+/// evaluate the same region many times, e.g. `whileOp`, use this to reuse one
+/// scope for all evaluations.
+SmallVector<InterpreterValue> evalInScope(const PreparedRegion &region,
+                                          SmallVector<InterpreterValue> args,
+                                          InterpreterFallback *fallback,
+                                          Process *process, Scope &scope);
+
 }  // namespace stablehlo
 }  // namespace mlir
 
@@ -0,0 +1,68 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/Parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/Support/ThreadPool.h"
+#include "stablehlo/reference/EvaluationContext.h"
+
+namespace mlir {
+namespace stablehlo {
+
+namespace {
+
+// Splitting work into a few chunks per thread balances the load when chunks
+// take different amounts of time, e.g. because threads are shared with other
+// processes of `interpreter.run_parallel`.
+constexpr int64_t kChunksPerThread = 4;
+
+}  // namespace
+
+llvm::ThreadPoolInterface *getIntraOpThreadPool() {
+  return getEvaluationContext().intraOpThreadPool;
+}
+
+void parallelForChunks(int64_t size, int64_t minChunkSize,
+                       llvm::function_ref<void(int64_t, int64_t)> fn) {
+  if (size <= 0) return;
+  auto *threadPool = getIntraOpThreadPool();
+  int64_t numChunks = 1;
+  if (threadPool)
+    numChunks = std::min<int64_t>(
+        size / std::max<int64_t>(minChunkSize, 1),
+        kChunksPerThread * threadPool->getMaxConcurrency());
+  if (numChunks <= 1) return fn(0, size);
+
+  // Waiting for a task group from a worker thread of the pool runs the tasks
+  // of the group on that thread, so nested calls don't deadlock.
+  const EvaluationContext &context = getEvaluationContext();
+  llvm::ThreadPoolTaskGroup taskGroup(*threadPool);
+  for (int64_t i = 0; i < numChunks; ++i) {
+    int64_t begin = size * i / numChunks;
+    int64_t end = size * (i + 1) / numChunks;
+    taskGroup.async([fn, begin, end, &context] {
+      ScopedEvaluationContext scopedContext(context);
+      fn(begin, end);
+    });
+  }
+  taskGroup.wait();
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,43 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_PARALLEL_H
+#define STABLEHLO_REFERENCE_PARALLEL_H
+
+#include <cstdint>
+
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/Support/ThreadPool.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Returns the thread pool on which ops evaluate chunks of large outputs in
+/// parallel, according to the current `EvaluationContext`. If null, which is
+/// the default, ops are evaluated on the calling thread.
+llvm::ThreadPoolInterface *getIntraOpThreadPool();
+
+/// Splits [0, size) into contiguous chunks of at least `minChunkSize`
+/// elements and calls `fn(begin, end)` for every chunk, on the intra-op
+/// thread pool if there is one and more than one chunk, with the current
+/// `EvaluationContext`. Returns once all chunks are done. Chunks must not
+/// depend on each other, but they may call `parallelForChunks` themselves.
+void parallelForChunks(int64_t size, int64_t minChunkSize,
+                       llvm::function_ref<void(int64_t, int64_t)> fn);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_PARALLEL_H
@@ -0,0 +1,236 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/ProbeWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Support/DebugStringHelper.h"
+#include "stablehlo/reference/NumPy.h"
+#include "stablehlo/reference/Tensor.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Opens `filename` in `outputDir` for writing, replacing an existing file.
+llvm::Error openOutputFile(StringRef outputDir, StringRef filename,
+                           std::unique_ptr<llvm::raw_fd_ostream> &out) {
+  llvm::SmallString<128> filepath(outputDir);
+  llvm::sys::path::append(filepath, filename);
+
+  int fd;
+  if (llvm::sys::fs::openFileForWrite(filepath, fd,
+                                      llvm::sys::fs::CD_CreateAlways))
+    return llvm::createStringError(llvm::errc::io_error,
+                                   "Failed to open %s.", filepath.c_str());
+  out = std::make_unique<llvm::raw_fd_ostream>(fd, /*shouldClose=*/true);
+  return llvm::Error::success();
+}
+
+// Returns an error if writing to `out` failed, and clears it.
+llvm::Error checkOutputFile(llvm::raw_fd_ostream *out) {
+  if (!out || !out->has_error()) return llvm::Error::success();
+  auto error = out->error();
+  out->clear_error();
+  return llvm::createStringError(error, "Failed to write probe: %s.",
+                                 error.message().c_str());
+}
+
+}  // namespace
+
+ProbeWriter::ProbeWriter(std::string outputDir, size_t queueCapacity,
+                         int64_t samplingInterval, bool useContainer)
+    : outputDir_(std::move(outputDir)),
+      queueCapacity_(queueCapacity),
+      samplingInterval_(std::max<int64_t>(samplingInterval, 1)),
+      useContainer_(useContainer) {}
+
+ProbeWriter::~ProbeWriter() { llvm::consumeError(finish()); }
+
+llvm::Error ProbeWriter::write(StringRef probeId, const Tensor &tensor) {
+  return schedule(probeId, tensor, /*digestFn=*/nullptr);
+}
+
+llvm::Error ProbeWriter::writeDigest(StringRef probeId, const Tensor &tensor,
+                                     DigestFn digestFn) {
+  return schedule(probeId, tensor, std::move(digestFn));
+}
+
+llvm::Error ProbeWriter::schedule(StringRef probeId, const Tensor &tensor,
+                                  DigestFn digestFn) {
+  if (outputDir_.empty())
+    return llvm::createStringError(
+        llvm::errc::invalid_argument,
+        "Probe serialization directory cannot be empty.");
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (isFinished_)
+    return llvm::createStringError(llvm::errc::operation_not_permitted,
+                                   "Probe writer is finished.");
+  if (!error_.empty()) return getError();
+  if (numEvaluations_[probeId]++ % samplingInterval_ != 0)
+    return llvm::Error::success();
+
+  Probe probe{probeId.str(), debugString(tensor.getType()), tensor,
+              std::move(digestFn)};
+  if (queueCapacity_ == 0) {
+    if (auto err = serialize(probe)) return err;
+    return flushFiles();
+  }
+
+  if (!thread_) thread_.emplace([this] { run(); });
+  changed_.wait(lock, [&] { return queue_.size() < queueCapacity_; });
+  queue_.push_back(std::move(probe));
+  changed_.notify_all();
+  return llvm::Error::success();
+}
+
+llvm::Error ProbeWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [&] { return queue_.empty() && !isWriting_; });
+  return getError();
+}
+
+llvm::Error ProbeWriter::finish() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (isFinished_) return getError();
+    isFinished_ = true;
+    isStopping_ = true;
+    changed_.notify_all();
+  }
+  if (thread_) thread_->join();
+
+  // The background thread is gone, so that the files can be accessed without
+  // holding the lock.
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (container_ && error_.empty()) {
+    uint64_t indexOffset = container_->tell();
+    *container_ << containerIndex_;
+    char footer[sizeof(uint64_t)];
+    llvm::support::endian::write64le(footer, indexOffset);
+    container_->write(footer, sizeof(footer));
+    container_->write(kContainerMagic, sizeof(kContainerMagic) - 1);
+    if (auto err = flushFiles()) error_ = llvm::toString(std::move(err));
+  }
+  metadata_.reset();
+  container_.reset();
+  return getError();
+}
+
+void ProbeWriter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    changed_.wait(lock, [&] { return !queue_.empty() || isStopping_; });
+    if (queue_.empty()) return;
+
+    // Writes all waiting tensors as one batch, which frees up the queue for
+    // further writes in the meantime, and flushes the files once per batch.
+    std::deque<Probe> batch;
+    batch.swap(queue_);
+    isWriting_ = true;
+    changed_.notify_all();
+    lock.unlock();
+
+    llvm::Error status = llvm::Error::success();
+    for (const auto &probe : batch) {
+      status = serialize(probe);
+      if (status) break;
+    }
+    if (!status) status = flushFiles();
+    batch.clear();
+
+    lock.lock();
+    if (status && error_.empty())
+      error_ = llvm::toString(std::move(status));
+    else
+      llvm::consumeError(std::move(status));
+    isWriting_ = false;
+    changed_.notify_all();
+  }
+}
+
+llvm::Error ProbeWriter::serialize(const Probe &probe) {
+  if (!metadata_)
+    if (auto err = openOutputFile(
+            outputDir_, numpy::kInstrumentationMetadataFilename, metadata_))
+      return err;
+
+  if (probe.digestFn) {
+    *metadata_ << probe.probeId << ',' << probe.type << ','
+               << probe.digestFn(probe.tensor) << '\n';
+    return checkOutputFile(metadata_.get());
+  }
+
+  llvm::SmallString<128> filepath(outputDir_);
+  if (useContainer_) {
+    if (!container_)
+      if (auto err = openOutputFile(outputDir_, numpy::kProbeContainerFilename,
+                                    container_))
+        return err;
+
+    uint64_t offset = container_->tell();
+    if (auto err = numpy::serializeTensor(*container_, probe.tensor.getType(),
+                                          probe.tensor.getData()))
+      return err;
+    if (auto err = checkOutputFile(container_.get())) return err;
+    containerIndex_ += probe.probeId + ',' + probe.type + ',' +
+                       std::to_string(offset) + '\n';
+    llvm::sys::path::append(filepath, numpy::kProbeContainerFilename);
+    filepath += ":" + std::to_string(offset);
+  } else {
+    // Use an increasing unique integer to name files to avoid any odd file
+    // names as a result of unsafe probe_id values.
+    llvm::sys::path::append(filepath,
+                            "probe" + std::to_string(++numFiles_) + ".npy");
+    if (auto err = numpy::serializeTensor(filepath, probe.tensor.getType(),
+                                          probe.tensor.getData()))
+      return err;
+  }
+
+  *metadata_ << probe.probeId << ',' << probe.type << ',' << filepath << '\n';
+  return checkOutputFile(metadata_.get());
+}
+
+llvm::Error ProbeWriter::flushFiles() {
+  for (auto *out : {metadata_.get(), container_.get()}) {
+    if (!out) continue;
+    out->flush();
+    if (auto err = checkOutputFile(out)) return err;
+  }
+  return llvm::Error::success();
+}
+
+llvm::Error ProbeWriter::getError() const {
+  if (error_.empty()) return llvm::Error::success();
+  return llvm::createStringError(llvm::errc::io_error, error_.c_str());
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,138 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_PROBEWRITER_H
+#define STABLEHLO_REFERENCE_PROBEWRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+#include "stablehlo/reference/Tensor.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Serializes the tensors of `interpreter.probe` ops to `outputDir` and lists
+/// them in the metadata file `numpy::kInstrumentationMetadataFilename` there,
+/// one line `probeId,type,path` per tensor in the order of `write` calls, or
+/// `probeId,type,digest` for tensors of which only digests are written.
+///
+/// By default, tensors are written to NumPy files of their own. If
+/// `useContainer`, they are appended to the single file
+/// `numpy::kProbeContainerFilename` instead, with the path `container:offset`
+/// in the metadata file. Once finished, the container ends in an index of
+/// lines `probeId,type,offset`, followed by the offset of the index and the
+/// magic string `kContainerMagic`, each 8 bytes, so that it can be read
+/// without the metadata file.
+///
+/// If `queueCapacity` is positive, tensors are serialized in batches on a
+/// background thread, and `write` only blocks while `queueCapacity` tensors
+/// are waiting for it. Otherwise, `write` serializes tensors itself.
+///
+/// The writer is thread-safe.
+class ProbeWriter {
+ public:
+  /// Magic string at the end of finished probe containers.
+  static constexpr char kContainerMagic[] = "PRBINDEX";
+
+  /// Writes every `samplingInterval`-th tensor of every probe ID, starting
+  /// with the first, and skips the others, e.g. to probe only some iterations
+  /// of a loop.
+  ProbeWriter(std::string outputDir, size_t queueCapacity,
+              int64_t samplingInterval, bool useContainer);
+
+  /// Finishes writing and drops errors which weren't reported yet.
+  ~ProbeWriter();
+
+  /// Schedules `tensor` to be written for `probeId`. Returns the first error
+  /// of earlier writes if there was one.
+  llvm::Error write(StringRef probeId, const Tensor &tensor);
+
+  /// Computes the digest of a tensor which is recorded instead of its data.
+  using DigestFn = std::function<std::string(const Tensor &)>;
+
+  /// Like `write`, but only lists `probeId` in the metadata file, with
+  /// `digestFn(tensor)` in place of the path of the tensor. Digests are
+  /// computed like tensors are serialized, i.e. on the background thread if
+  /// there is one, and not at all for skipped tensors.
+  llvm::Error writeDigest(StringRef probeId, const Tensor &tensor,
+                          DigestFn digestFn);
+
+  /// Waits until all scheduled tensors have been written and flushed to disk,
+  /// so that they can be read back, and returns the first error if there was
+  /// one.
+  llvm::Error flush();
+
+  /// Flushes the writer and stops the background thread, then completes the
+  /// container, if any. Subsequent writes fail.
+  llvm::Error finish();
+
+ private:
+  struct Probe {
+    std::string probeId;
+    std::string type;
+    Tensor tensor;
+    /// If set, the digest of `tensor` is written instead of `tensor`.
+    DigestFn digestFn;
+  };
+
+  llvm::Error schedule(StringRef probeId, const Tensor &tensor,
+                       DigestFn digestFn);
+  void run();
+  llvm::Error serialize(const Probe &probe);
+  llvm::Error flushFiles();
+  llvm::Error getError() const;
+
+  const std::string outputDir_;
+  const size_t queueCapacity_;
+  const int64_t samplingInterval_;
+  const bool useContainer_;
+
+  /// Guards the members below. Notified whenever `queue_`, `isWriting_` or
+  /// `isStopping_` change.
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<Probe> queue_;
+  llvm::StringMap<int64_t> numEvaluations_;
+  std::optional<std::thread> thread_;
+  bool isWriting_ = false;
+  bool isStopping_ = false;
+  bool isFinished_ = false;
+  std::string error_;
+
+  /// Only accessed by whoever serializes tensors, i.e. the background thread
+  /// if there is one.
+  int64_t numFiles_ = 0;
+  std::unique_ptr<llvm::raw_fd_ostream> metadata_;
+  std::unique_ptr<llvm::raw_fd_ostream> container_;
+  std::string containerIndex_;
+};
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_PROBEWRITER_H
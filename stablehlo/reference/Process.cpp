@@ -20,6 +20,15 @@ namespace stablehlo {
 
 Process::Process(ProcessId id, ProcessGrid *grid) : id_(id), grid_(grid) {}
 
+Tensor Process::allReduce(
+    ProcessGroup processGroup, ChannelId channelId, const Tensor &operand,
+    ShapedType resultType,
+    llvm::function_ref<void(ArrayRef<Tensor>, int64_t, int64_t, Tensor &)>
+        reduceShard) {
+  return grid_->allReduce(processGroup, channelId, getId(), operand,
+                          resultType, reduceShard);
+}
+
 ProcessGroups Process::crossPartition(
     SmallVector<SmallVector<uint32_t>> partitionGroups) {
   return grid_->crossPartition(partitionGroups);
@@ -40,7 +49,10 @@ ProcessGroups Process::flattenedIds(
   return grid_->flattenedIds(flattenedIdGroups);
 }
 
-StringAttr Process::infeed() { return grid_->infeed(); }
+SmallVector<Tensor> Process::infeed(
+    llvm::function_ref<SmallVector<Tensor>(StringAttr)> evalProgram) {
+  return grid_->infeed(evalProgram);
+}
 
 ProcessId Process::getId() { return id_; }
 
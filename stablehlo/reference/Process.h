@@ -18,6 +18,8 @@ limitations under the License.
 
 #include <cstdint>
 
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "mlir/IR/BuiltinTypes.h"
 #include "stablehlo/reference/ProcessGrid.h"
 #include "stablehlo/reference/Tensor.h"
 
@@ -32,6 +34,13 @@ class Process {
   Process(ProcessId id, ProcessGrid *grid);
   /// @}
 
+  /// See `ProcessGrid::allReduce`.
+  Tensor allReduce(ProcessGroup processGroup, ChannelId channelId,
+                   const Tensor &operand, ShapedType resultType,
+                   llvm::function_ref<void(ArrayRef<Tensor>, int64_t, int64_t,
+                                           Tensor &)>
+                       reduceShard);
+
   /// See `ProcessGrid::crossPartition`.
   ProcessGroups crossPartition(
       SmallVector<SmallVector<uint32_t>> partitionGroups);
@@ -47,8 +56,9 @@ class Process {
   ProcessGroups flattenedIds(
       SmallVector<SmallVector<uint32_t>> flattenedIdGroups);
 
-  /// See "ProcessGrid::infeed".
-  StringAttr infeed();
+  /// See `ProcessGrid::infeed`.
+  SmallVector<Tensor> infeed(
+      llvm::function_ref<SmallVector<Tensor>(StringAttr)> evalProgram);
 
   /// Getter for the underlying StableHLO `process_id`.
   ProcessId getId();
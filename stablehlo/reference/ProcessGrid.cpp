@@ -15,11 +15,20 @@ limitations under the License.
 
 #include "stablehlo/reference/ProcessGrid.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <thread>
 #include <utility>
 
+#include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "stablehlo/reference/Tensor.h"
 
 namespace mlir {
@@ -43,6 +52,20 @@ bool ProcessId::operator==(const ProcessId &other) const {
          std::pair<uint32_t, uint32_t>{other.replicaId, other.partitionId};
 }
 
+//===----------------------------------------------------------------------===//
+// LinkModel.
+//===----------------------------------------------------------------------===//
+
+LinkModel makeUniformLinkModel(std::chrono::nanoseconds latency,
+                               double bytesPerSecond) {
+  return [=](ProcessId, ProcessId, uint64_t numBytes) {
+    if (bytesPerSecond == 0) return latency;
+    return latency + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::duration<double>(numBytes /
+                                                       bytesPerSecond));
+  };
+}
+
 //===----------------------------------------------------------------------===//
 // ProcessGroups.
 //===----------------------------------------------------------------------===//
@@ -59,22 +82,24 @@ std::optional<ProcessGroup> ProcessGroups::findGroup(ProcessId processId) {
 // RendezvousResult.
 //===----------------------------------------------------------------------===//
 
-RendezvousResult::RendezvousResult(std::map<ProcessId, Tensor> const &result)
-    : result_(result) {}
-
-void RendezvousResult::insert(ProcessId processId, Tensor tensor) {
-  result_[processId] = tensor;
-}
+RendezvousResult::RendezvousResult(
+    uint32_t numPartitions, std::shared_ptr<const SmallVector<Tensor>> slots)
+    : numPartitions_(numPartitions), slots_(std::move(slots)) {}
 
 Tensor RendezvousResult::lookup(ProcessId processId) const {
-  auto it = result_.find(processId);
-  if (it != result_.end()) return it->second;
+  if (!slots_) return {};
+  uint64_t flattenedId =
+      uint64_t(processId.replicaId) * numPartitions_ + processId.partitionId;
+  if (flattenedId < slots_->size()) return (*slots_)[flattenedId];
   return {};
 }
 
 SmallVector<Tensor> RendezvousResult::getSortedTensors() const {
-  return llvm::map_to_vector(result_,
-                             [](const auto &pair) { return pair.second; });
+  SmallVector<Tensor> result;
+  if (!slots_) return result;
+  for (const auto &tensor : *slots_)
+    if (tensor) result.push_back(tensor);
+  return result;
 }
 
 //===----------------------------------------------------------------------===//
@@ -87,26 +112,11 @@ V &detail::ThreadSafeMap<K, V>::operator[](const K &key) {
   return map_[key];
 }
 
-//===----------------------------------------------------------------------===//
-// ThreadSafeSet.
-//===----------------------------------------------------------------------===//
-
-template <typename T>
-bool detail::ThreadSafeSet<T>::contains(T value) {
-  std::lock_guard<std::mutex> lock(lock_);
-  return set_.find(value) != set_.end();
-}
-
-template <typename T>
-void detail::ThreadSafeSet<T>::erase(T value) {
-  std::lock_guard<std::mutex> lock(lock_);
-  set_.erase(value);
-}
-
-template <typename T>
-void detail::ThreadSafeSet<T>::insert(T value) {
+template <typename K, typename V>
+void detail::ThreadSafeMap<K, V>::forEach(
+    llvm::function_ref<void(const K &, V &)> fn) {
   std::lock_guard<std::mutex> lock(lock_);
-  set_.insert(value);
+  for (auto &[key, value] : map_) fn(key, value);
 }
 
 //===----------------------------------------------------------------------===//
@@ -118,8 +128,9 @@ detail::ThreadSafeQueue<T>::ThreadSafeQueue(const std::queue<T> &queue)
     : queue_(queue) {}
 
 template <typename T>
-T detail::ThreadSafeQueue<T>::pop() {
+std::optional<T> detail::ThreadSafeQueue<T>::pop() {
   std::lock_guard<std::mutex> lock(lock_);
+  if (queue_.empty()) return std::nullopt;
   auto result = queue_.front();
   queue_.pop();
   return result;
@@ -135,11 +146,98 @@ void detail::ThreadSafeQueue<T>::push(T input) {
 // ProcessGrid.
 //===----------------------------------------------------------------------===//
 
+namespace {
+
+// Number of times a process yields while waiting at a rendezvous before it
+// blocks.
+constexpr int kRendezvousSpinCount = 64;
+
+// Returns the current time of `std::chrono::steady_clock` in nanoseconds.
+int64_t getSteadyNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t getNumBytes(ArrayRef<Tensor> tensors) {
+  uint64_t numBytes = 0;
+  for (const auto &tensor : tensors)
+    if (tensor) numBytes += tensor.getData<char>().size();
+  return numBytes;
+}
+
+}  // namespace
+
 ProcessGrid::ProcessGrid(uint32_t numReplicas, uint32_t numPartitions,
-                         std::queue<StringAttr> &infeed)
+                         std::queue<StringAttr> &infeed,
+                         std::chrono::milliseconds timeout,
+                         ProcessTransport *transport,
+                         InfeedProducer infeedProducer,
+                         OutfeedConsumer outfeedConsumer, size_t channelDepth,
+                         LinkModel linkModel)
     : numReplicas_(numReplicas),
       numPartitions_(numPartitions),
-      infeed_(infeed) {}
+      timeout_(timeout),
+      transport_(transport),
+      infeedProducer_(std::move(infeedProducer)),
+      outfeedConsumer_(std::move(outfeedConsumer)),
+      infeed_(infeed),
+      channelDepth_(channelDepth),
+      linkModel_(std::move(linkModel)) {
+  if (!transport_) return;
+  for (auto entries = infeed; !entries.empty(); entries.pop())
+    infeedEntries_.push_back(entries.front());
+}
+
+template <typename Predicate>
+bool ProcessGrid::waitFor(std::condition_variable &condition,
+                          std::unique_lock<std::mutex> &lock,
+                          Predicate predicate) {
+  if (timeout_ == std::chrono::milliseconds::zero()) {
+    condition.wait(lock, predicate);
+    return true;
+  }
+  return condition.wait_for(lock, timeout_, predicate);
+}
+
+Tensor ProcessGrid::allReduce(
+    ProcessGroup processGroup, ChannelId channelId, ProcessId processId,
+    const Tensor &operand, ShapedType resultType,
+    llvm::function_ref<void(ArrayRef<Tensor>, int64_t, int64_t, Tensor &)>
+        reduceShard) {
+  auto sortedGroup = processGroup;
+  llvm::sort(sortedGroup);
+  int64_t numShards = sortedGroup.size();
+  auto operands = rendezvous(processGroup, channelId, processId, operand,
+                             CollectiveKind::AllReduce, numShards)
+                      .getSortedTensors();
+
+  int64_t numElements = resultType.getNumElements();
+  auto getShardBegin = [&](int64_t shard) {
+    return numElements * shard / numShards;
+  };
+
+  Tensor result(resultType);
+  int64_t shard = llvm::find(sortedGroup, processId) - sortedGroup.begin();
+  reduceShard(operands, getShardBegin(shard), getShardBegin(shard + 1), result);
+  if (numShards == 1 || numElements == 0) return result;
+
+  // Every process only reads the shards of the others, which they don't
+  // write anymore, and writes the rest of its own result.
+  auto shards = rendezvous(processGroup, channelId, processId, result,
+                           CollectiveKind::AllReduce, numShards);
+  auto resultData = result.getMutableData<char>();
+  int64_t elementSize = resultData.size() / numElements;
+  for (int64_t i = 0; i < numShards; ++i) {
+    if (i == shard) continue;
+    auto shardData = shards.lookup(sortedGroup[i]).getData<char>();
+    int64_t begin = getShardBegin(i) * elementSize;
+    int64_t end = getShardBegin(i + 1) * elementSize;
+    std::copy(shardData.begin() + begin, shardData.begin() + end,
+              resultData.begin() + begin);
+  }
+  return result;
+}
 
 ProcessGroups ProcessGrid::crossPartition(
     SmallVector<SmallVector<uint32_t>> partitionGroups) {
@@ -198,70 +296,248 @@ ProcessGroups ProcessGrid::flattenedIds(
   return processGroups;
 }
 
-StringAttr ProcessGrid::infeed() { return infeed_.pop(); }
+SmallVector<Tensor> ProcessGrid::infeed(
+    llvm::function_ref<SmallVector<Tensor>(StringAttr)> evalProgram) {
+  if (transport_) {
+    auto position = transport_->claimInfeed();
+    if (!position) llvm::report_fatal_error(position.takeError());
+    if (*position < infeedEntries_.size())
+      return evalProgram(infeedEntries_[*position]);
+  } else if (auto mnemonic = infeed_.pop()) {
+    return evalProgram(*mnemonic);
+  }
+
+  if (infeedProducer_) {
+    std::lock_guard<std::mutex> lock(infeedProducerMutex_);
+    if (auto entry = infeedProducer_()) return std::move(*entry);
+  }
+  llvm::report_fatal_error("infeed is empty");
+}
 
 void ProcessGrid::outfeed(ArrayRef<Tensor> inputs) {
+  if (transport_) {
+    if (auto error = transport_->outfeed(inputs))
+      llvm::report_fatal_error(std::move(error));
+    return;
+  }
+
+  if (outfeedConsumer_) {
+    std::lock_guard<std::mutex> lock(outfeedConsumerMutex_);
+    return outfeedConsumer_(inputs);
+  }
   outfeed_.push(llvm::to_vector(inputs));
 }
 
+std::map<ChannelId, ChannelStatistics> ProcessGrid::getChannelStatistics() {
+  std::map<ChannelId, ChannelStatistics> result;
+  sendRecvChannels_.forEach(
+      [&](const ChannelId &channelId, detail::SendRecvState &state) {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        result[channelId] = state.statistics;
+      });
+  return result;
+}
+
+std::map<std::pair<CollectiveKind, ChannelId>, CollectiveStatistics>
+ProcessGrid::getCollectiveStatistics() {
+  std::map<std::pair<CollectiveKind, ChannelId>, CollectiveStatistics> result;
+  channels_.forEach([&](const std::pair<ProcessGroup, ChannelId> &channelKey,
+                        detail::RendezvousState &state) {
+    for (auto kind : {CollectiveKind::AllReduce, CollectiveKind::Rendezvous}) {
+      auto &counters = state.counters[static_cast<size_t>(kind)];
+      auto numRounds = counters.numRounds.load(std::memory_order_relaxed);
+      if (numRounds == 0) continue;
+      auto &statistics = result[{kind, channelKey.second}];
+      statistics.numRounds += numRounds;
+      statistics.numBytes += counters.numBytes.load(std::memory_order_relaxed);
+      statistics.waitTime += std::chrono::nanoseconds(
+          counters.waitTime.load(std::memory_order_relaxed));
+      statistics.skew += std::chrono::nanoseconds(
+          counters.skew.load(std::memory_order_relaxed));
+      statistics.modeledTime += std::chrono::nanoseconds(
+          counters.modeledTime.load(std::memory_order_relaxed));
+    }
+  });
+  return result;
+}
+
 SmallVector<Tensor> ProcessGrid::recv(ChannelId channelId,
                                       ProcessId processId) {
-  std::unique_lock<std::mutex> lock(sendRecvChannels_[channelId].mutex);
-  sendRecvReady_.insert(channelId);
-  sendRecvConditions_[channelId].notify_one();
+  if (transport_) {
+    auto result = transport_->recv(channelId);
+    if (!result) llvm::report_fatal_error(result.takeError());
+    return std::move(*result);
+  }
 
-  if (!sendRecvConditions_[channelId].wait_for(
-          lock, std::chrono::seconds(3),
-          [&] { return !sendRecvChannels_[channelId].result.empty(); }))
-    llvm::report_fatal_error("recv timed out");
+  auto &state = sendRecvChannels_[channelId];
+  std::unique_lock<std::mutex> lock(state.mutex);
+  ++state.numWaitingReceivers;
+  state.condition.notify_all();
 
-  auto result = sendRecvChannels_[channelId].result;
-  sendRecvChannels_[channelId].result.clear();
-  return result;
+  auto start = std::chrono::steady_clock::now();
+  if (!waitFor(state.condition, lock, [&] { return !state.messages.empty(); }))
+    llvm::report_fatal_error("recv timed out");
+  state.statistics.recvWaitTime += std::chrono::steady_clock::now() - start;
+
+  auto message = std::move(state.messages.front());
+  state.messages.pop_front();
+  if (linkModel_)
+    state.statistics.modeledTime += linkModel_(
+        message.first, processId, getNumBytes(message.second));
+  --state.numWaitingReceivers;
+  state.condition.notify_all();
+  return std::move(message.second);
 }
 
 RendezvousResult ProcessGrid::rendezvous(ProcessGroup processGroup,
                                          ChannelId channelId,
                                          ProcessId processId,
                                          const Tensor &operand) {
+  return rendezvous(processGroup, channelId, processId, operand,
+                    CollectiveKind::Rendezvous, /*numShards=*/1);
+}
+
+RendezvousResult ProcessGrid::rendezvous(ProcessGroup processGroup,
+                                         ChannelId channelId,
+                                         ProcessId processId,
+                                         const Tensor &operand,
+                                         CollectiveKind kind,
+                                         uint64_t numShards) {
+  uint64_t flattenedId =
+      uint64_t(processId.replicaId) * numPartitions_ + processId.partitionId;
+  auto numSlots = uint64_t(numReplicas_) * numPartitions_;
+
   // Process wait/notify logic below doesn't work for single process.
-  if (processGroup.size() == 1)
-    return RendezvousResult({std::pair{processId, operand}});
+  if (processGroup.size() == 1) {
+    auto slots = std::make_shared<SmallVector<Tensor>>(flattenedId + 1);
+    (*slots)[flattenedId] = operand;
+    return RendezvousResult(numPartitions_, std::move(slots));
+  }
+
+  // With a transport, only local processes arrive at this barrier. The last
+  // one exchanges their contributions for those of the remote processes.
+  size_t numLocal = processGroup.size();
+  if (transport_)
+    numLocal = llvm::count_if(processGroup, [&](ProcessId id) {
+      return transport_->isLocal(id);
+    });
 
   std::pair<ProcessGroup, ChannelId> channelKey(processGroup, channelId);
   auto &state = channels_[channelKey];
-
-  std::unique_lock<std::mutex> lock(state.mutex);
-  state.values[processId] = operand;
-  state.useCount++;
-
-  // After each process contributes, wait for the last process to notify.
-  if (state.values.size() < processGroup.size()) {
-    if (!channelConditions_[channelKey].wait_for(
-            lock, std::chrono::seconds(3),
-            [&] { return state.values.size() == processGroup.size(); }))
-      llvm::report_fatal_error("rendezvous timed out");
-  } else {
-    state.result = std::move(state.values);
-    channelConditions_[channelKey].notify_all();
+  std::call_once(state.initialized, [&] {
+    state.slots = std::make_shared<SmallVector<Tensor>>(numSlots);
+  });
+
+  // Until this process arrives, the round can't complete, so the slots and
+  // the generation read here belong to the round of this process.
+  auto slots = state.slots;
+  auto generation = state.generation.load(std::memory_order_acquire);
+  (*slots)[flattenedId] = operand;
+
+  // Arrivals are published to the last process by `numArrived`.
+  auto &counters = state.counters[static_cast<size_t>(kind)];
+  int64_t arrival = getSteadyNanoseconds();
+  auto firstArrival = state.firstArrival.load(std::memory_order_relaxed);
+  while (arrival < firstArrival &&
+         !state.firstArrival.compare_exchange_weak(firstArrival, arrival,
+                                                  std::memory_order_relaxed)) {
   }
 
-  state.useCount--;
+  if (state.numArrived.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+      numLocal) {
+    if (numLocal != processGroup.size()) {
+      SmallVector<std::pair<ProcessId, Tensor>> contributions;
+      for (auto id : processGroup)
+        if (transport_->isLocal(id))
+          contributions.emplace_back(
+              id, (*slots)[uint64_t(id.replicaId) * numPartitions_ +
+                           id.partitionId]);
+      auto remoteContributions = transport_->exchange(
+          processGroup, channelId, generation, contributions);
+      if (!remoteContributions)
+        llvm::report_fatal_error(remoteContributions.takeError());
+      for (auto &[id, tensor] : *remoteContributions)
+        (*slots)[uint64_t(id.replicaId) * numPartitions_ + id.partitionId] =
+            tensor;
+    }
 
-  return state.useCount > 0 ? state.result : std::move(state.result);
+    uint64_t numBytes = 0;
+    std::chrono::nanoseconds modeledTime(0);
+    for (auto source : processGroup) {
+      auto sourceId =
+          uint64_t(source.replicaId) * numPartitions_ + source.partitionId;
+      auto shardBytes = getNumBytes((*slots)[sourceId]) / numShards;
+      numBytes += shardBytes * (processGroup.size() - 1);
+      if (!linkModel_) continue;
+      for (auto target : processGroup)
+        if (target != source)
+          modeledTime =
+              std::max(modeledTime, linkModel_(source, target, shardBytes));
+    }
+    counters.numRounds.fetch_add(1, std::memory_order_relaxed);
+    counters.numBytes.fetch_add(numBytes, std::memory_order_relaxed);
+    counters.skew.fetch_add(
+        std::max<int64_t>(
+            0, arrival - state.firstArrival.load(std::memory_order_relaxed)),
+        std::memory_order_relaxed);
+    counters.modeledTime.fetch_add(modeledTime.count(),
+                                   std::memory_order_relaxed);
+    counters.waitTime.fetch_add(getSteadyNanoseconds() - arrival,
+                                std::memory_order_relaxed);
+    state.firstArrival.store(std::numeric_limits<int64_t>::max(),
+                             std::memory_order_relaxed);
+
+    // The other processes of this round only read `slots` from now on, so
+    // the next round can start.
+    state.numArrived.store(0, std::memory_order_relaxed);
+    state.slots = std::make_shared<SmallVector<Tensor>>(numSlots);
+    {
+      std::lock_guard<std::mutex> lock(state.mutex);
+      state.generation.store(generation + 1, std::memory_order_release);
+    }
+    state.condition.notify_all();
+    return RendezvousResult(numPartitions_, std::move(slots));
+  }
+
+  // Processes usually arrive close to each other, so waiting processes spin
+  // for a while before they block.
+  auto isReleased = [&] {
+    return state.generation.load(std::memory_order_acquire) != generation;
+  };
+  for (int i = 0; i < kRendezvousSpinCount && !isReleased(); ++i)
+    std::this_thread::yield();
+  if (!isReleased()) {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    if (!waitFor(state.condition, lock, isReleased))
+      llvm::report_fatal_error("rendezvous timed out");
+  }
+  counters.waitTime.fetch_add(getSteadyNanoseconds() - arrival,
+                              std::memory_order_relaxed);
+  return RendezvousResult(numPartitions_, std::move(slots));
 }
 
 void ProcessGrid::send(ArrayRef<Tensor> inputs, ChannelId channelId,
                        ProcessId processId) {
-  std::unique_lock<std::mutex> lock(sendRecvChannels_[channelId].mutex);
-  if (!sendRecvConditions_[channelId].wait_for(
-          lock, std::chrono::seconds(3),
-          [&] { return sendRecvReady_.contains(channelId); }))
+  if (transport_) {
+    if (auto error = transport_->send(inputs, channelId))
+      llvm::report_fatal_error(std::move(error));
+    return;
+  }
+
+  auto &state = sendRecvChannels_[channelId];
+  std::unique_lock<std::mutex> lock(state.mutex);
+  auto start = std::chrono::steady_clock::now();
+  if (!waitFor(state.condition, lock, [&] {
+        return state.messages.size() <
+               channelDepth_ + state.numWaitingReceivers;
+      }))
     llvm::report_fatal_error("send timed out");
+  state.statistics.sendWaitTime += std::chrono::steady_clock::now() - start;
 
-  sendRecvChannels_[channelId].result = llvm::to_vector(inputs);
-  sendRecvReady_.erase(channelId);
-  sendRecvConditions_[channelId].notify_one();
+  state.messages.emplace_back(processId, llvm::to_vector(inputs));
+  ++state.statistics.numMessages;
+  state.statistics.numBytes += getNumBytes(inputs);
+  state.condition.notify_all();
 }
 
 }  // namespace stablehlo
@@ -16,78 +16,212 @@ limitations under the License.
 #ifndef STABLEHLO_REFERENCE_PROCESSGRID_H
 #define STABLEHLO_REFERENCE_PROCESSGRID_H
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <queue>
-#include <set>
 #include <utility>
 
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/Support/Error.h"
+#include "mlir/IR/BuiltinTypes.h"
 #include "mlir/Support/LLVM.h"
 #include "stablehlo/reference/Tensor.h"
 
 namespace mlir {
 namespace stablehlo {
 
-struct ProcessId;
+using ChannelId = int64_t;
+
+/// StableHLO `process_id`.
+struct ProcessId {
+  /// StableHLO `replica_id`.
+  uint32_t replicaId;
+
+  /// StableHLO `partition_id`.
+  uint32_t partitionId;
+
+  /// Overloaded inequality operator.
+  bool operator!=(const ProcessId &other) const;
+
+  /// The sort order for ProcessId is not defined in StableHLO, and it's
+  /// internally used in ProcessGrid::rendezvous as part of a sorted key on the
+  /// map. This operator is conveniently used to help define the ordering since
+  /// ordering is defined for StableHLO process group.
+  bool operator<(const ProcessId &other) const;
+
+  /// Overloaded equality operator.
+  bool operator==(const ProcessId &other) const;
+};
 
 /// Represents a result of a `ProcessGrid::rendezvous` where multiple processes
 /// synchronize at a barrier and contribute a Tensor each.
 /// This class is pretty much a map from ProcessId to Tensor, with the
-/// map-like API.
+/// map-like API. The tensors are stored in slots indexed by flattened process
+/// id, i.e. `replicaId * numPartitions + partitionId`, which are shared by the
+/// results of all processes of the rendezvous.
 class RendezvousResult {
  public:
   RendezvousResult() = default;
-  RendezvousResult(std::map<ProcessId, Tensor> const &result);
+  RendezvousResult(uint32_t numPartitions,
+                   std::shared_ptr<const SmallVector<Tensor>> slots);
 
-  /// Iterates through the (ProcessId, Tensor) map entires and returns a vector
-  /// of Tensors sorted by ProcessId--(replicaId, partitionId) pair--in
-  /// lexicographical order.
+  /// Returns the contributed Tensors sorted by ProcessId--(replicaId,
+  /// partitionId) pair--in lexicographical order, which is the order of
+  /// flattened process ids.
   SmallVector<Tensor> getSortedTensors() const;
 
-  /// Inserts `tensor` into the map using the key `processId`.
-  void insert(ProcessId processId, Tensor tensor);
-
-  /// Iterates through the map and returns the value associated with the key
-  /// `processId`. If key is not found, return an empty `Tensor`.
+  /// Returns the Tensor contributed by `processId`. If `processId` didn't
+  /// contribute, return an empty `Tensor`.
   Tensor lookup(ProcessId processId) const;
 
  private:
-  /// Internal map representation of the result of `ProcessGrid::rendezvous`.
-  std::map<ProcessId, Tensor> result_;
+  /// StableHLO `num_partitions`, which is used to flatten process ids.
+  uint32_t numPartitions_ = 0;
+
+  /// Contributed tensors indexed by flattened process id, with empty tensors
+  /// for processes which didn't contribute.
+  std::shared_ptr<const SmallVector<Tensor>> slots_;
+};
+
+/// Models how long moving `numBytes` over the link from the process with
+/// `source` to the process with `target` takes, e.g. on the hardware which a
+/// sharding is meant for. See `makeUniformLinkModel`.
+using LinkModel = std::function<std::chrono::nanoseconds(
+    ProcessId source, ProcessId target, uint64_t numBytes)>;
+
+/// Returns a model of links which all take `latency` plus `numBytes` divided
+/// by `bytesPerSecond`. A zero `bytesPerSecond` only models the latency.
+LinkModel makeUniformLinkModel(std::chrono::nanoseconds latency,
+                               double bytesPerSecond);
+
+/// Kinds of collectives whose statistics are recorded by `ProcessGrid`.
+enum class CollectiveKind {
+  /// `ProcessGrid::allReduce`.
+  AllReduce,
+
+  /// Other uses of `ProcessGrid::rendezvous`, e.g. by `all_gather`,
+  /// `all_to_all` and `collective_permute`.
+  Rendezvous,
+};
+
+/// Statistics of the collectives of a kind on a channel.
+struct CollectiveStatistics {
+  /// Number of barriers, which is two per `allReduce` of multiple processes.
+  uint64_t numRounds = 0;
+
+  /// Number of bytes moved between processes. Every contribution to a barrier
+  /// counts as moved to every other participant, except that `allReduce`
+  /// moves one shard of its contribution to every other participant.
+  uint64_t numBytes = 0;
+
+  /// Total time processes waited at the barriers.
+  std::chrono::nanoseconds waitTime{0};
+
+  /// Total over barriers of the time between the arrivals of the first and
+  /// the last participant, which is how much the participants are out of
+  /// step with each other.
+  std::chrono::nanoseconds skew{0};
+
+  /// Total over barriers of the time which the slowest of their moves takes
+  /// according to the link model of the process grid, or zero if there is
+  /// none. Moves of a barrier are taken to happen in parallel.
+  std::chrono::nanoseconds modeledTime{0};
+};
+
+/// Statistics of a channel used by `send` and `recv`.
+struct ChannelStatistics {
+  /// Number of messages sent over the channel.
+  uint64_t numMessages = 0;
+
+  /// Number of bytes sent over the channel.
+  uint64_t numBytes = 0;
+
+  /// Total time senders waited for room in the channel.
+  std::chrono::nanoseconds sendWaitTime{0};
+
+  /// Total time receivers waited for messages.
+  std::chrono::nanoseconds recvWaitTime{0};
+
+  /// Total time which the messages take according to the link model of the
+  /// process grid, or zero if there is none.
+  std::chrono::nanoseconds modeledTime{0};
 };
 
 namespace detail {
 
-/// Internal storage used in `rendezvous` to manage concurrent access to the
-/// shared resource. Processes contribute their data to `values` concurrently.
-/// Once all processes have added their data, the data in `values` is moved to
-/// `result` that multiple processes can concurrently read from.
+/// Counterpart of `CollectiveStatistics` which processes update concurrently
+/// without locking, with times in nanoseconds.
+struct CollectiveCounters {
+  std::atomic<uint64_t> numRounds = 0;
+  std::atomic<uint64_t> numBytes = 0;
+  std::atomic<int64_t> waitTime = 0;
+  std::atomic<int64_t> skew = 0;
+  std::atomic<int64_t> modeledTime = 0;
+};
+
+/// Internal storage used in `rendezvous` to implement a barrier. Every round
+/// of the barrier has its own preallocated `slots`, which processes write
+/// their data to concurrently without locking, at their flattened process
+/// ids. The last process to arrive, as counted by `numArrived`, allocates the
+/// slots of the next round and releases the other processes by advancing
+/// `generation`. All processes then share the slots of their round as their
+/// result.
 struct RendezvousState {
-  /// Synchronization primitive used to manage concurrent access to this
-  /// object.
-  std::mutex mutex;
+  /// Ensures that the slots of the first round are allocated once.
+  std::once_flag initialized;
+
+  /// Slots of the current round.
+  std::shared_ptr<SmallVector<Tensor>> slots;
+
+  /// Number of processes which arrived in the current round.
+  std::atomic<size_t> numArrived = 0;
+
+  /// Number of completed rounds.
+  std::atomic<uint64_t> generation = 0;
 
-  /// Internal storage used to store data contributed by the processes.
-  std::map<ProcessId, Tensor> values;
+  /// Earliest arrival time of the processes of the current round, in
+  /// nanoseconds of `std::chrono::steady_clock`.
+  std::atomic<int64_t> firstArrival = std::numeric_limits<int64_t>::max();
 
-  /// Internal state management counter which counts the number of processes
-  /// that contributed already.
-  size_t useCount;
+  /// Statistics of the rounds by `CollectiveKind`.
+  std::array<CollectiveCounters, 2> counters;
 
-  /// Stores the result of `rendezvous`.
-  RendezvousResult result;
+  /// Synchronization primitives used by processes which block until
+  /// `generation` advances.
+  std::mutex mutex;
+  std::condition_variable condition;
 };
 
+/// Internal storage of a channel used to implement `send` and `recv`. Senders
+/// append their inputs to `messages` while fewer messages are buffered than
+/// the depth of the channel plus the number of waiting receivers, and
+/// receivers take them from the front.
 struct SendRecvState {
-  /// Synchronization primitive used to manage concurrent access to this
-  /// object.
+  /// Synchronization primitives used to manage concurrent access to this
+  /// object and to wait for messages or for room for them.
   std::mutex mutex;
-  /// Internal storage used to store data contributed by the processes.
-  SmallVector<Tensor> result;
+  std::condition_variable condition;
+
+  /// Messages which were sent but not received yet, in the order of sending,
+  /// together with their senders.
+  std::deque<std::pair<ProcessId, SmallVector<Tensor>>> messages;
+
+  /// Number of receivers waiting for a message.
+  size_t numWaitingReceivers = 0;
+
+  /// See `ChannelStatistics`.
+  ChannelStatistics statistics;
 };
 
 /// Stores the result of `rendezvous` represented as a map that allows
@@ -102,6 +236,9 @@ class ThreadSafeMap {
   /// Returns a reference to the data associated with the `key`.
   V &operator[](const K &key);
 
+  /// Calls `fn` with every key and its data, in the order of keys.
+  void forEach(llvm::function_ref<void(const K &, V &)> fn);
+
  private:
   /// Synchronization primitive used to manage concurrent access to the map.
   std::mutex lock_;
@@ -109,28 +246,6 @@ class ThreadSafeMap {
   std::map<K, V> map_;
 };
 
-/// Internal set that manages concurrent access to implement `send` and
-/// `recv`.
-template <typename T>
-class ThreadSafeSet {
- public:
-  /// Returns whether the element `value` exists in the set.
-  bool contains(T value);
-
-  /// Remove `value` from the set.
-  void erase(T value);
-
-  /// Add `value` to the set.
-  void insert(T value);
-
- private:
-  /// Synchronization primitive used to manage concurrent access to the set.
-  std::mutex lock_;
-
-  /// Internal storage used to manage `send` and `recv` order.
-  std::set<T> set_;
-};
-
 /// StableHLO `infeed` and `outfeed` represented as a queue that allows
 /// concurrent access.
 template <typename T>
@@ -142,8 +257,9 @@ class ThreadSafeQueue {
   ThreadSafeQueue(const std::queue<T> &queue);
   /// @}
 
-  /// Remove the first element of the queue and return it.
-  T pop();
+  /// Remove the first element of the queue and return it, or return
+  /// std::nullopt if the queue is empty.
+  std::optional<T> pop();
 
   /// Add `inputs` to the end of the queue.
   void push(T inputs);
@@ -158,29 +274,6 @@ class ThreadSafeQueue {
 
 }  // namespace detail
 
-using ChannelId = int64_t;
-
-/// StableHLO `process_id`.
-struct ProcessId {
-  /// StableHLO `replica_id`.
-  uint32_t replicaId;
-
-  /// StableHLO `partition_id`.
-  uint32_t partitionId;
-
-  /// Overloaded inequality operator.
-  bool operator!=(const ProcessId &other) const;
-
-  /// The sort order for ProcessId is not defined in StableHLO, and it's
-  /// internally used in ProcessGrid::rendezvous as part of a sorted key on the
-  /// map. This operator is conveniently used to help define the ordering since
-  /// ordering is defined for StableHLO process group.
-  bool operator<(const ProcessId &other) const;
-
-  /// Overloaded equality operator.
-  bool operator==(const ProcessId &other) const;
-};
-
 /// StableHLO `process_group`.
 class ProcessGroup : public SmallVector<ProcessId> {};
 
@@ -193,15 +286,103 @@ class ProcessGroups : public SmallVector<ProcessGroup> {
   std::optional<ProcessGroup> findGroup(ProcessId processId);
 };
 
+/// Produces the next entry of StableHLO `infeed` on demand, or returns
+/// std::nullopt if there are no more entries. Lets long-running programs
+/// consume feeds which are read or generated while they run.
+using InfeedProducer = std::function<std::optional<SmallVector<Tensor>>()>;
+
+/// Consumes an entry of StableHLO `outfeed` as soon as it's produced. The
+/// process which produced the entry waits until this returns, so consumers
+/// which can't keep up slow down the producing process instead of buffering
+/// its entries.
+using OutfeedConsumer = std::function<void(ArrayRef<Tensor>)>;
+
+/// Moves tensors between the hosts of a process grid whose processes are
+/// distributed over multiple hosts, e.g. over TCP or MPI. Every host evaluates
+/// its local processes with its own ProcessGrid, which synchronizes them with
+/// each other in memory and uses the transport for the remote processes on
+/// the other hosts. Implementations can use `serializeTensorBytes` and
+/// `deserializeTensorBytes` to move tensors, and are expected to deliver the
+/// messages of every call site of the interface in order.
+class ProcessTransport {
+ public:
+  virtual ~ProcessTransport() = default;
+
+  /// Returns whether the process with `processId` is evaluated on this host.
+  virtual bool isLocal(ProcessId processId) = 0;
+
+  /// Exchanges the tensors contributed by the local processes of
+  /// `processGroup` to the `round`-th rendezvous of `processGroup` on
+  /// `channelId` for the tensors contributed by its remote processes. Called
+  /// once per round on every host with local processes in `processGroup`,
+  /// once all of them have arrived, and blocks until the contributions of the
+  /// remote processes are available.
+  virtual llvm::Expected<SmallVector<std::pair<ProcessId, Tensor>>> exchange(
+      const ProcessGroup &processGroup, ChannelId channelId, uint64_t round,
+      ArrayRef<std::pair<ProcessId, Tensor>> contributions) = 0;
+
+  /// Sends `inputs` to the process, possibly on another host, which receives
+  /// from the channel with `channelId`. See `ProcessGrid::send`.
+  virtual llvm::Error send(ArrayRef<Tensor> inputs, ChannelId channelId) = 0;
+
+  /// Receives the tensors sent to the channel with `channelId`, possibly from
+  /// another host. See `ProcessGrid::recv`.
+  virtual llvm::Expected<SmallVector<Tensor>> recv(ChannelId channelId) = 0;
+
+  /// Returns the position of the next entry of StableHLO `infeed`, which
+  /// every host has a copy of, and which is consumed once across hosts.
+  virtual llvm::Expected<uint64_t> claimInfeed() = 0;
+
+  /// Inserts `inputs` to StableHLO `outfeed`, which is shared across hosts.
+  virtual llvm::Error outfeed(ArrayRef<Tensor> inputs) = 0;
+};
+
 /// StableHLO process grid.
 class ProcessGrid {
  public:
   /// \name Constructors
   /// @{
   ProcessGrid(uint32_t numReplicas, uint32_t numPartitions,
-              std::queue<StringAttr> &infeed);
+              std::queue<StringAttr> &infeed,
+              std::chrono::milliseconds timeout = kDefaultTimeout,
+              ProcessTransport *transport = nullptr,
+              InfeedProducer infeedProducer = nullptr,
+              OutfeedConsumer outfeedConsumer = nullptr,
+              size_t channelDepth = 0, LinkModel linkModel = nullptr);
   /// @}
 
+  /// Default for how long `rendezvous`, `send` and `recv` wait for other
+  /// processes before failing.
+  static constexpr std::chrono::milliseconds kDefaultTimeout =
+      std::chrono::seconds(60);
+
+  /// Channel on which the results of the processes of a distributed process
+  /// grid are exchanged with `ProcessTransport::exchange` once they finish.
+  /// Not used by StableHLO ops, whose channel ids are nonnegative.
+  static constexpr ChannelId kResultsChannelId = -1;
+
+  /// Returns the transport to the processes on other hosts, or nullptr if all
+  /// processes of the grid are local.
+  ProcessTransport *getTransport() const { return transport_; }
+
+  /// Reduces `operand` with the operands of the other StableHLO processes in
+  /// `processGroup` into a tensor of type `resultType`, synchronizing with
+  /// them like `rendezvous`.
+  ///
+  /// Implemented as a reduce-scatter followed by an all-gather: the elements
+  /// are split into as many contiguous shards as there are processes, every
+  /// process calls `reduceShard(operands, begin, end, result)` to reduce only
+  /// the elements of its shard at the flattened positions [begin, end) of all
+  /// `operands`, which are sorted by ProcessId, and then copies the shards
+  /// reduced by the other processes into `result`. This way, the work of every
+  /// process doesn't grow with the number of processes.
+  Tensor allReduce(ProcessGroup processGroup, ChannelId channelId,
+                   ProcessId processId, const Tensor &operand,
+                   ShapedType resultType,
+                   llvm::function_ref<void(ArrayRef<Tensor>, int64_t, int64_t,
+                                           Tensor &)>
+                       reduceShard);
+
   /// StableHLO `cross_partition` communication strategy.
   ProcessGroups crossPartition(
       SmallVector<SmallVector<uint32_t>> partitionGroups);
@@ -217,17 +398,31 @@ class ProcessGrid {
   ProcessGroups flattenedIds(
       SmallVector<SmallVector<uint32_t>> flattenedIdGroups);
 
-  /// Retrieves input strings from StableHLO `infeed`.
-  StringAttr infeed();
-
-  /// Inserts `inputs` to StableHLO `outfeed`.
+  /// Retrieves the next entry of StableHLO `infeed`. Entries of the `infeed`
+  /// queue name programs, which are evaluated by `evalProgram`, and once the
+  /// queue is exhausted, entries are pulled from the infeed producer of the
+  /// process grid, if any. The producer is called by one process at a time.
+  /// Fails with a fatal error if there are no more entries.
+  SmallVector<Tensor> infeed(
+      llvm::function_ref<SmallVector<Tensor>(StringAttr)> evalProgram);
+
+  /// Inserts `inputs` to StableHLO `outfeed`, or passes them to the outfeed
+  /// consumer of the process grid, if any, which is called by one process at
+  /// a time.
   void outfeed(ArrayRef<Tensor> inputs);
 
+  /// Returns the statistics of every channel used by `send` and `recv` so
+  /// far, by ChannelId.
+  std::map<ChannelId, ChannelStatistics> getChannelStatistics();
+
+  /// Returns the statistics of the collectives so far, by kind and ChannelId,
+  /// summed over process groups.
+  std::map<std::pair<CollectiveKind, ChannelId>, CollectiveStatistics>
+  getCollectiveStatistics();
+
   /// Receives data from a channel with `channelId` and returns the data.
-  /// `recv` has to be called first before `send` to indicate to the sending
-  /// process that the receiver is ready to receive data. The process then waits
-  /// until there is data in the channel. The data in the channel with
-  /// `channelId` is returned.
+  /// Waits until there is data in the channel, which is received in the order
+  /// in which it was sent.
   SmallVector<Tensor> recv(ChannelId channelId, ProcessId processId);
 
   /// Synchronize a StableHLO process with the `processId` with other StableHLO
@@ -240,10 +435,10 @@ class ProcessGrid {
   /// undefined.
   ///
   /// If any of the StableHLO processes from `processGroup` fail to arrive
-  /// at the barrier within 3 seconds, the `rendezvous` fails with a fatal
-  /// error for all calling OS threads. This is to make sure that errors in
-  /// underlying StableHLO programs or bugs in the StableHLO interpreter don't
-  /// deadlock the interpreter.
+  /// at the barrier within the timeout of the process grid, the `rendezvous`
+  /// fails with a fatal error. This is to make sure that errors in underlying
+  /// StableHLO programs or bugs in the StableHLO interpreter don't deadlock
+  /// the interpreter. A zero timeout waits indefinitely.
   ///
   /// At the barrier, each StableHLO process contributes a tensor, and these
   /// tensors are accumulated in `RendezvousResult` whose shared pointer is
@@ -253,9 +448,13 @@ class ProcessGrid {
                               ProcessId processId, const Tensor &operand);
 
   /// Sends `inputs` to a channel with `channelId`.
-  /// The channel with `channelId` is emptied before the receiving process can
-  /// receive values. If there are multiple processes sending data to a
-  /// duplciate `channelId`, the behavior is undefined.
+  /// Every channel buffers up to the channel depth of the process grid of
+  /// messages which haven't been received yet, on top of the messages taken
+  /// by waiting receivers. Once the buffer is full, `send` waits until a
+  /// receiver takes a message, so with a depth of 0, `send` waits for a
+  /// matching `recv`. Larger depths let pipelined stages of a program, e.g.
+  /// on different partitions, overlap. If there are multiple processes
+  /// sending data to a duplicate `channelId`, the behavior is undefined.
   void send(ArrayRef<Tensor> inputs, ChannelId channelId, ProcessId processId);
 
  private:
@@ -265,6 +464,34 @@ class ProcessGrid {
   /// StableHLO `num_partitions`.
   const uint32_t numPartitions_;
 
+  /// How long processes wait for each other. Zero means indefinitely.
+  const std::chrono::milliseconds timeout_;
+
+  /// See `ProcessTransport`. Not owned, can be nullptr.
+  ProcessTransport *const transport_;
+
+  /// Entries of `infeed_` indexed by position, which are used instead of
+  /// `infeed_` if `transport_` is set.
+  SmallVector<StringAttr> infeedEntries_;
+
+  /// See `InfeedProducer`. Can be empty.
+  InfeedProducer infeedProducer_;
+
+  /// See `OutfeedConsumer`. Can be empty, in which case entries are inserted
+  /// to `outfeed_`.
+  OutfeedConsumer outfeedConsumer_;
+
+  /// Synchronization primitives which make sure that `infeedProducer_` and
+  /// `outfeedConsumer_` are called by one process at a time.
+  std::mutex infeedProducerMutex_;
+  std::mutex outfeedConsumerMutex_;
+
+  /// Waits on `condition` until `predicate` holds and returns false if that
+  /// doesn't happen within `timeout_`.
+  template <typename Predicate>
+  bool waitFor(std::condition_variable &condition,
+               std::unique_lock<std::mutex> &lock, Predicate predicate);
+
   /// Internal queue of strings which represents `func::FuncOp` mnemonic that
   /// returns a vector of Tensor. The function name is stored instead of the
   /// vector of tensors to save memory. See `ThreadSafeQueue`.
@@ -274,32 +501,27 @@ class ProcessGrid {
   /// StableHLO `outfeed`. See `ThreadSafeQueue`.
   detail::ThreadSafeQueue<SmallVector<Tensor>> outfeed_;
 
-  /// Internal storage used to implement `send` and `recv`.
-  /// `send` can write its data to the channel with ChannelId once the ops are
-  /// ready to communicate. `recv` receives data from the same channel once the
-  /// data is ready to read.
-  detail::ThreadSafeMap<ChannelId, detail::SendRecvState> sendRecvChannels_;
+  /// Number of messages which every channel buffers, see `send`.
+  const size_t channelDepth_;
+
+  /// See `LinkModel`. Can be empty.
+  LinkModel linkModel_;
 
-  /// Synchronization primitive used to manage concurrent access to
-  /// `sendRecvChannels_`.
-  std::map<ChannelId, std::condition_variable> sendRecvConditions_;
+  /// Implements `rendezvous` and records its statistics as a collective of
+  /// `kind`, taking every participant to read one of `numShards` shards of
+  /// the contribution of every other participant.
+  RendezvousResult rendezvous(ProcessGroup processGroup, ChannelId channelId,
+                              ProcessId processId, const Tensor &operand,
+                              CollectiveKind kind, uint64_t numShards);
 
-  /// Synchronization primitive used to signal send and recv operations are
-  /// ready to communicate.
-  /// The presence of a ChannelId in the set indicates that the receiving
-  /// process is ready to receive data using this ChannelId from the sender
-  /// process.
-  detail::ThreadSafeSet<ChannelId> sendRecvReady_;
+  /// Internal storage used to implement `send` and `recv`, see
+  /// `SendRecvState`.
+  detail::ThreadSafeMap<ChannelId, detail::SendRecvState> sendRecvChannels_;
 
   /// See `ThreadSafeMap`.
   detail::ThreadSafeMap<std::pair<ProcessGroup, ChannelId>,
                         detail::RendezvousState>
       channels_;
-
-  /// Synchronization primitive used to manage concurrent access to `channels_`.
-  detail::ThreadSafeMap<std::pair<ProcessGroup, ChannelId>,
-                        std::condition_variable>
-      channelConditions_;
 };
 
 }  // namespace stablehlo
@@ -0,0 +1,184 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/BuiltinTypeInterfaces.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Support/DebugStringHelper.h"
+#include "stablehlo/reference/BufferPool.h"
+#include "stablehlo/reference/EvaluationContext.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Innermost op which is being profiled on this thread.
+thread_local ScopedOpProfile *currentOpProfile = nullptr;
+
+// Returns the number of elements of the results of `op` which are tensors.
+int64_t getNumResultElements(Operation &op) {
+  int64_t numElements = 0;
+  for (Type type : op.getResultTypes())
+    if (auto shapedType = dyn_cast<ShapedType>(type))
+      if (shapedType.hasStaticShape())
+        numElements += shapedType.getNumElements();
+  return numElements;
+}
+
+// Prints `statistics` as a table with rows labeled by `getLabel` of their
+// keys, sorted by descending time.
+template <typename Key, typename GetLabel>
+void printStatistics(
+    raw_ostream &os, StringRef title,
+    const llvm::DenseMap<Key, Profiler::Statistics> &statistics,
+    GetLabel getLabel) {
+  std::vector<std::pair<Key, Profiler::Statistics>> rows(statistics.begin(),
+                                                         statistics.end());
+  std::chrono::nanoseconds totalTime{0};
+  for (const auto &row : rows) totalTime += row.second.time;
+  std::stable_sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+    return a.second.time > b.second.time;
+  });
+
+  os << "===" << std::string(76, '-') << "===\n";
+  os << "  " << title << "\n";
+  os << "===" << std::string(76, '-') << "===\n";
+  os << llvm::format("%12s %7s %12s %14s %14s  %s\n", "Time (ms)", "Time %",
+                     "Evaluations", "Elements", "Bytes", "Name");
+  for (const auto &[key, row] : rows) {
+    double percentage =
+        totalTime.count() ? 100.0 * row.time.count() / totalTime.count() : 0;
+    os << llvm::format("%12.3f %6.1f%% %12lld %14lld %14lld  ",
+                       row.time.count() / 1e6, percentage,
+                       (long long)row.numEvaluations,
+                       (long long)row.numElements,
+                       (long long)row.numBytesAllocated)
+       << getLabel(key) << "\n";
+  }
+  os << "\n";
+}
+
+}  // namespace
+
+Profiler::Profiler(bool recordTrace)
+    : recordTrace_(recordTrace), origin_(std::chrono::steady_clock::now()) {}
+
+void Profiler::record(Operation &op,
+                      std::chrono::steady_clock::time_point start,
+                      std::chrono::nanoseconds time,
+                      std::chrono::nanoseconds selfTime,
+                      int64_t numBytesAllocated) {
+  auto numElements = getNumResultElements(op);
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto *statistics : {&statisticsByName_[op.getName()],
+                           &statisticsByLocation_[op.getLoc()]}) {
+    ++statistics->numEvaluations;
+    statistics->time += selfTime;
+    statistics->numElements += numElements;
+    statistics->numBytesAllocated += numBytesAllocated;
+  }
+  if (recordTrace_)
+    events_.push_back(Event{op.getName(), op.getLoc(), start - origin_, time,
+                            llvm::get_threadid()});
+}
+
+llvm::DenseMap<OperationName, Profiler::Statistics>
+Profiler::getStatisticsByName() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statisticsByName_;
+}
+
+llvm::DenseMap<Location, Profiler::Statistics>
+Profiler::getStatisticsByLocation() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return statisticsByLocation_;
+}
+
+void Profiler::printTable(raw_ostream &os) const {
+  printStatistics(os, "Interpreter profile by op", getStatisticsByName(),
+                  [](OperationName name) { return name.getStringRef().str(); });
+  printStatistics(os, "Interpreter profile by location",
+                  getStatisticsByLocation(),
+                  [](Location location) { return debugString(location); });
+}
+
+void Profiler::printChromeTrace(raw_ostream &os) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  llvm::json::OStream json(os);
+  json.object([&] {
+    json.attributeArray("traceEvents", [&] {
+      for (const auto &event : events_) {
+        json.object([&] {
+          json.attribute("name", event.name.getStringRef());
+          json.attribute("cat", "op");
+          json.attribute("ph", "X");
+          json.attribute("ts", event.start.count() / 1e3);
+          json.attribute("dur", event.time.count() / 1e3);
+          json.attribute("pid", 0);
+          json.attribute("tid", static_cast<int64_t>(event.threadId));
+          json.attributeObject("args", [&] {
+            json.attribute("location", debugString(event.location));
+          });
+        });
+      }
+    });
+    json.attribute("displayTimeUnit", "ns");
+  });
+  os << "\n";
+}
+
+Profiler *getProfiler() { return getEvaluationContext().profiler; }
+
+ScopedOpProfile::ScopedOpProfile(Profiler &profiler, Operation &op)
+    : profiler_(profiler),
+      op_(op),
+      parent_(currentOpProfile),
+      start_(std::chrono::steady_clock::now()),
+      startBytesAllocated_(BufferPool::getNumBytesAllocatedOnThread()) {
+  currentOpProfile = this;
+}
+
+ScopedOpProfile::~ScopedOpProfile() {
+  auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start_);
+  int64_t bytesAllocated =
+      BufferPool::getNumBytesAllocatedOnThread() - startBytesAllocated_;
+  profiler_.record(op_, start_, time, time - nestedTime_,
+                   bytesAllocated - nestedBytesAllocated_);
+
+  currentOpProfile = parent_;
+  if (parent_) {
+    parent_->nestedTime_ += time;
+    parent_->nestedBytesAllocated_ += bytesAllocated;
+  }
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,122 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_PROFILER_H
+#define STABLEHLO_REFERENCE_PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OperationSupport.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Collects where the interpreter spends its time while it is set in the
+/// `EvaluationContext`: the wall time, number of evaluations, number of result
+/// elements and number of bytes allocated of the ops evaluated by `eval`, by
+/// op name and by location. The time and bytes of an op exclude those of the
+/// ops nested in its regions which are evaluated on the same thread, so that
+/// e.g. a `while` loop only accounts for its own overhead. The profiler is
+/// thread-safe.
+class Profiler {
+ public:
+  /// Statistics of the evaluations of ops with the same name or location.
+  struct Statistics {
+    int64_t numEvaluations = 0;
+    std::chrono::nanoseconds time{0};
+    int64_t numElements = 0;
+    int64_t numBytesAllocated = 0;
+  };
+
+  /// If `recordTrace`, every evaluation is recorded for `printChromeTrace`,
+  /// which takes memory proportional to the number of evaluations.
+  explicit Profiler(bool recordTrace = false);
+
+  /// Records an evaluation of `op` which started at `start` and took `time`
+  /// in total, of which `selfTime` and `numBytesAllocated` bytes weren't
+  /// spent in nested ops.
+  void record(Operation &op, std::chrono::steady_clock::time_point start,
+              std::chrono::nanoseconds time, std::chrono::nanoseconds selfTime,
+              int64_t numBytesAllocated);
+
+  /// Returns the statistics by op name.
+  llvm::DenseMap<OperationName, Statistics> getStatisticsByName() const;
+
+  /// Returns the statistics by op location.
+  llvm::DenseMap<Location, Statistics> getStatisticsByLocation() const;
+
+  /// Prints tables of the statistics by op name and by op location, sorted by
+  /// descending time.
+  void printTable(raw_ostream &os) const;
+
+  /// Prints the recorded evaluations as complete events in the Chrome trace
+  /// event format, which chrome://tracing and Perfetto display as a timeline.
+  void printChromeTrace(raw_ostream &os) const;
+
+ private:
+  struct Event {
+    OperationName name;
+    Location location;
+    std::chrono::nanoseconds start;
+    std::chrono::nanoseconds time;
+    uint64_t threadId;
+  };
+
+  const bool recordTrace_;
+  const std::chrono::steady_clock::time_point origin_;
+
+  /// Guards the members below.
+  mutable std::mutex mutex_;
+  llvm::DenseMap<OperationName, Statistics> statisticsByName_;
+  llvm::DenseMap<Location, Statistics> statisticsByLocation_;
+  std::vector<Event> events_;
+};
+
+/// Returns the profiler with which `eval` records the ops it evaluates
+/// according to the current `EvaluationContext`, or nullptr if there is none.
+Profiler *getProfiler();
+
+/// Measures the evaluation of `op` from construction to destruction and
+/// records it with `profiler`. The time and bytes allocated by ops which are
+/// profiled on the same thread in the meantime are subtracted.
+class ScopedOpProfile {
+ public:
+  ScopedOpProfile(Profiler &profiler, Operation &op);
+  ~ScopedOpProfile();
+
+  ScopedOpProfile(const ScopedOpProfile &) = delete;
+  ScopedOpProfile &operator=(const ScopedOpProfile &) = delete;
+
+ private:
+  Profiler &profiler_;
+  Operation &op_;
+  ScopedOpProfile *parent_;
+  std::chrono::steady_clock::time_point start_;
+  uint64_t startBytesAllocated_;
+  std::chrono::nanoseconds nestedTime_{0};
+  int64_t nestedBytesAllocated_ = 0;
+};
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_PROFILER_H
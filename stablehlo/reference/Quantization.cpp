@@ -0,0 +1,374 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/Quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "mlir/Dialect/Quant/QuantTypes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/Support/DebugStringHelper.h"
+#include "stablehlo/reference/Errors.h"
+#include "stablehlo/reference/Parallel.h"
+#include "stablehlo/reference/Types.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Number of elements which `dequantizeOpQuantize` dequantizes at a time.
+constexpr int64_t kChunkSize = 1 << 16;
+
+// Minimum number of elements which loops over tensors hand to
+// `parallelForChunks` per chunk.
+constexpr int64_t kMinParallelChunkSize = 1 << 14;
+
+// Returns the element type of `type`, which must be a supported quantized type.
+quant::QuantizedType getQuantizedElementType(ShapedType type) {
+  if (!isSupportedQuantizedType(type.getElementType()))
+    report_fatal_error(invalidArgument("Unsupported quantized type: %s",
+                                       debugString(type).c_str()));
+  return cast<quant::QuantizedType>(type.getElementType());
+}
+
+// Scales and zero points of the elements of a tensor of a quantized type,
+// together with the range and encoding of their storage type. The element at
+// position `i` in canonical order uses the parameters at `getIndex(i)`, which
+// for per-axis quantization is its index along the quantized dimension.
+struct QuantizationParameters {
+  explicit QuantizationParameters(ShapedType type)
+      : elementType(getQuantizedElementType(type)),
+        width(elementType.getStorageTypeIntegralWidth()),
+        isSigned(elementType.isSigned()),
+        storageMin(elementType.getStorageTypeMin()),
+        storageMax(elementType.getStorageTypeMax()) {
+    if (auto perAxisType =
+            dyn_cast<quant::UniformQuantizedPerAxisType>(elementType)) {
+      scales.assign(perAxisType.getScales().begin(),
+                    perAxisType.getScales().end());
+      zeroPoints.assign(perAxisType.getZeroPoints().begin(),
+                        perAxisType.getZeroPoints().end());
+      setDimension(type.getShape(), perAxisType.getQuantizedDimension());
+      return;
+    }
+    auto perTensorType = cast<quant::UniformQuantizedType>(elementType);
+    scales.push_back(perTensorType.getScale());
+    zeroPoints.push_back(perTensorType.getZeroPoint());
+  }
+
+  // Makes the parameters vary along `dimension` of `shape`.
+  void setDimension(ArrayRef<int64_t> shape, int64_t dimension) {
+    axisSize = shape[dimension];
+    innerSize = 1;
+    for (auto size : shape.drop_front(dimension + 1)) innerSize *= size;
+  }
+
+  int64_t getIndex(int64_t position) const {
+    return scales.size() == 1 ? 0 : position / innerSize % axisSize;
+  }
+
+  // Converts the bits stored for an element to its integer value.
+  int64_t load(uint64_t bits) const {
+    return isSigned ? llvm::SignExtend64(bits, width)
+                    : static_cast<int64_t>(
+                          bits & llvm::maskTrailingOnes<uint64_t>(width));
+  }
+
+  // Converts an integer value to the bits stored for it. Like `Tensor::set`,
+  // stores integers which are narrower than their storage sign-extended.
+  uint64_t store(int64_t value) const {
+    return static_cast<uint64_t>(
+        llvm::SignExtend64(static_cast<uint64_t>(value), width));
+  }
+
+  // Implements `dequantize` for an element with value `value` in the
+  // expressed type `F`.
+  template <typename F>
+  F dequantize(int64_t value, int64_t index) const {
+    return static_cast<F>(value - zeroPoints[index]) *
+           static_cast<F>(scales[index]);
+  }
+
+  // Implements `quantize` for a value of the expressed type `F`, rounding
+  // every intermediate result to `F` like the specification. NaNs, for which
+  // the specification leaves the result undefined, are quantized to 0.
+  template <typename F>
+  int64_t quantize(F value, int64_t index) const {
+    F scaled = value / static_cast<F>(scales[index]);
+    scaled = scaled + static_cast<F>(zeroPoints[index]);
+    if (std::isnan(scaled))
+      return std::clamp<int64_t>(0, storageMin, storageMax);
+    F clamped = std::min(std::max(scaled, static_cast<F>(storageMin)),
+                         static_cast<F>(storageMax));
+    return static_cast<int64_t>(std::nearbyint(clamped));
+  }
+
+  quant::QuantizedType elementType;
+  unsigned width;
+  bool isSigned;
+  int64_t storageMin;
+  int64_t storageMax;
+  SmallVector<double> scales;
+  SmallVector<int64_t> zeroPoints;
+  int64_t axisSize = 1;
+  int64_t innerSize = 1;
+};
+
+// Invokes `fn` with a value-initialized unsigned integer of the size in which
+// tensors store the elements of `type`.
+template <typename Fn>
+void dispatchOnStorage(quant::QuantizedType type, Fn &&fn) {
+  switch (std::max(type.getStorageTypeIntegralWidth(), 8u) / 8) {
+    case 1:
+      return fn(uint8_t());
+    case 2:
+      return fn(uint16_t());
+    case 4:
+      return fn(uint32_t());
+  }
+  report_fatal_error(invalidArgument("Unsupported storage type: %s",
+                                     debugString(type).c_str()));
+}
+
+// Invokes `fn` with a value-initialized object of the C++ type of the
+// floating-point type `type`, which must be f32 or f64.
+template <typename Fn>
+void dispatchOnExpressedType(Type type, Fn &&fn) {
+  if (type.isF32()) return fn(float());
+  if (type.isF64()) return fn(double());
+  report_fatal_error(invalidArgument("Unsupported expressed type: %s",
+                                     debugString(type).c_str()));
+}
+
+// Dequantizes the elements of `operand` at positions [begin, begin + size) in
+// canonical order into `result`, which has `size` elements of the expressed
+// type of `operand`.
+void dequantizeRange(const Tensor &operand,
+                     const QuantizationParameters &params, int64_t begin,
+                     Tensor &result) {
+  dispatchOnStorage(params.elementType, [&](auto storage) {
+    using S = decltype(storage);
+    auto data = operand.getData<S>();
+    dispatchOnExpressedType(result.getElementType(), [&](auto expressed) {
+      using F = decltype(expressed);
+      auto resultData = result.getMutableData<F>();
+      parallelForChunks(
+          resultData.size(), kMinParallelChunkSize,
+          [&](int64_t chunkBegin, int64_t chunkEnd) {
+            for (int64_t i = chunkBegin; i < chunkEnd; ++i) {
+              int64_t position = begin + i;
+              resultData[i] = params.dequantize<F>(
+                  params.load(data[position]), params.getIndex(position));
+            }
+          });
+    });
+  });
+}
+
+// Quantizes the elements of `values`, which have the expressed type of
+// `result`, into the elements of `result` at positions
+// [begin, begin + size(values)) in canonical order.
+void quantizeRange(const Tensor &values, const QuantizationParameters &params,
+                   int64_t begin, Tensor &result) {
+  auto expressedType = params.elementType.getExpressedType();
+  if (values.getElementType() != expressedType)
+    report_fatal_error(invalidArgument(
+        "Expected values of type %s to quantize, but got %s",
+        debugString(expressedType).c_str(),
+        debugString(values.getElementType()).c_str()));
+  dispatchOnStorage(params.elementType, [&](auto storage) {
+    using S = decltype(storage);
+    auto resultData = result.getMutableData<S>();
+    dispatchOnExpressedType(expressedType, [&](auto expressed) {
+      using F = decltype(expressed);
+      auto data = values.getData<F>();
+      parallelForChunks(
+          data.size(), kMinParallelChunkSize,
+          [&](int64_t chunkBegin, int64_t chunkEnd) {
+            for (int64_t i = chunkBegin; i < chunkEnd; ++i) {
+              int64_t position = begin + i;
+              resultData[position] = static_cast<S>(params.store(
+                  params.quantize<F>(data[i], params.getIndex(position))));
+            }
+          });
+    });
+  });
+}
+
+}  // namespace
+
+Tensor makeQuantizedTensor(const Tensor &storage, ShapedType type) {
+  auto storageType = getQuantizedElementType(type).getStorageType();
+  if (storage.getElementType() != storageType ||
+      storage.getShape() != Sizes(type.getShape()))
+    report_fatal_error(invalidArgument(
+        "Expected tensor of storage type of %s, but got %s",
+        debugString(type).c_str(), debugString(storage.getType()).c_str()));
+
+  Tensor result(type);
+  auto resultData = result.getMutableData<char>();
+  std::memcpy(resultData.data(), storage.getData(), resultData.size());
+  return result;
+}
+
+Tensor dequantize(const Tensor &operand, ShapedType resultType) {
+  QuantizationParameters params(operand.getType());
+  Tensor result(resultType);
+  dequantizeRange(operand, params, /*begin=*/0, result);
+  return result;
+}
+
+Tensor quantize(const Tensor &operand, ShapedType resultType) {
+  if (isSupportedQuantizedType(operand.getElementType()))
+    return dequantizeOpQuantize(
+        operand, resultType,
+        [](ArrayRef<Tensor> operands, ShapedType) { return operands[0]; });
+
+  QuantizationParameters params(resultType);
+  Tensor result(resultType);
+  quantizeRange(operand, params, /*begin=*/0, result);
+  return result;
+}
+
+Tensor dequantizeOpQuantize(
+    ArrayRef<Tensor> operands, ShapedType resultType,
+    llvm::function_ref<Tensor(ArrayRef<Tensor>, ShapedType)> op) {
+  std::optional<QuantizationParameters> resultParams;
+  Type chunkElementType = resultType.getElementType();
+  if (isSupportedQuantizedType(chunkElementType)) {
+    resultParams.emplace(resultType);
+    chunkElementType = resultParams->elementType.getExpressedType();
+  }
+
+  // Operands of rank 0 are dequantized once, the others a chunk at a time.
+  SmallVector<std::optional<QuantizationParameters>> params;
+  SmallVector<std::optional<Tensor>> scalars;
+  for (const auto &operand : operands) {
+    auto &operandParams = params.emplace_back();
+    if (isSupportedQuantizedType(operand.getElementType()))
+      operandParams.emplace(operand.getType());
+    auto &scalar = scalars.emplace_back();
+    if (operand.getRank() != 0 || resultType.getRank() == 0) continue;
+    scalar = operandParams ? dequantize(operand,
+                                        RankedTensorType::get(
+                                            {}, operandParams->elementType
+                                                    .getExpressedType()))
+                           : operand;
+  }
+
+  Tensor result(resultType);
+  int64_t numElements = resultType.getNumElements();
+  for (int64_t begin = 0; begin < numElements; begin += kChunkSize) {
+    int64_t size = std::min(kChunkSize, numElements - begin);
+    SmallVector<Tensor> chunkOperands;
+    for (auto [operand, operandParams, scalar] :
+         llvm::zip(operands, params, scalars)) {
+      if (scalar) {
+        chunkOperands.push_back(*scalar);
+        continue;
+      }
+      if (!operandParams) {
+        chunkOperands.push_back(makeTensorView(
+            operand, begin,
+            RankedTensorType::get({size}, operand.getElementType())));
+        continue;
+      }
+      Tensor chunk(RankedTensorType::get(
+          {size}, operandParams->elementType.getExpressedType()));
+      dequantizeRange(operand, *operandParams, begin, chunk);
+      chunkOperands.push_back(chunk);
+    }
+
+    auto chunkResult =
+        op(chunkOperands, RankedTensorType::get({size}, chunkElementType));
+    if (resultParams) {
+      quantizeRange(chunkResult, *resultParams, begin, result);
+      continue;
+    }
+    auto resultData = result.getMutableData<char>();
+    int64_t elementSize = resultData.size() / numElements;
+    std::memcpy(resultData.data() + begin * elementSize, chunkResult.getData(),
+                size * elementSize);
+  }
+  return result;
+}
+
+Tensor subtractZeroPoints(const Tensor &operand) {
+  QuantizationParameters params(operand.getType());
+  auto type = operand.getType();
+  Tensor result(type.clone(IntegerType::get(type.getContext(), 32)));
+  dispatchOnStorage(params.elementType, [&](auto storage) {
+    using S = decltype(storage);
+    auto data = operand.getData<S>();
+    auto resultData = result.getMutableData<int32_t>();
+    parallelForChunks(resultData.size(), kMinParallelChunkSize,
+                      [&](int64_t begin, int64_t end) {
+                        for (int64_t i = begin; i < end; ++i)
+                          resultData[i] = static_cast<int32_t>(
+                              params.load(data[i]) -
+                              params.zeroPoints[params.getIndex(i)]);
+                      });
+  });
+  return result;
+}
+
+Tensor quantizeAccumulators(const Tensor &accumulators, ShapedType lhsType,
+                            ShapedType rhsType, Axis rhsResultDimension,
+                            ShapedType resultType) {
+  QuantizationParameters lhsParams(lhsType);
+  QuantizationParameters rhsParams(rhsType);
+  QuantizationParameters resultParams(resultType);
+  if (lhsParams.scales.size() != 1)
+    report_fatal_error(invalidArgument(
+        "Expected per-tensor quantized lhs, but got %s",
+        debugString(lhsType).c_str()));
+  if (rhsParams.scales.size() != 1)
+    rhsParams.setDimension(resultType.getShape(), rhsResultDimension);
+
+  Tensor result(resultType);
+  dispatchOnStorage(resultParams.elementType, [&](auto storage) {
+    using S = decltype(storage);
+    auto resultData = result.getMutableData<S>();
+    dispatchOnExpressedType(
+        resultParams.elementType.getExpressedType(), [&](auto expressed) {
+          using F = decltype(expressed);
+          auto data = accumulators.getData<int32_t>();
+          parallelForChunks(
+              resultData.size(), kMinParallelChunkSize,
+              [&](int64_t begin, int64_t end) {
+                for (int64_t i = begin; i < end; ++i) {
+                  auto value = static_cast<F>(
+                      static_cast<double>(data[i]) * lhsParams.scales[0] *
+                      rhsParams.scales[rhsParams.getIndex(i)]);
+                  resultData[i] = static_cast<S>(resultParams.store(
+                      resultParams.quantize<F>(value,
+                                               resultParams.getIndex(i))));
+                }
+              });
+        });
+  });
+  return result;
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,80 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_QUANTIZATION_H
+#define STABLEHLO_REFERENCE_QUANTIZATION_H
+
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/Support/LLVM.h"
+#include "stablehlo/reference/Axes.h"
+#include "stablehlo/reference/Tensor.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Tensors of quantized types, see `isSupportedQuantizedType`, store the
+/// integers of their storage type. Ops which only move elements, e.g.
+/// `reshapeOp` or `transposeOp`, move these integers like the elements of any
+/// other type. The functions below compute with the values of quantized
+/// tensors directly from their storage, in the expressed type of their
+/// elements, without materializing dequantized copies of whole tensors.
+///
+/// Returns a tensor of the quantized type `type` which stores the elements of
+/// `storage`, a tensor of the same shape and of its storage type, e.g. the
+/// value of a quantized `constantOp`.
+Tensor makeQuantizedTensor(const Tensor &storage, ShapedType type);
+
+/// Implements `dequantize` of the StableHLO specification: converts the
+/// elements of the quantized `operand` to values of their expressed type,
+/// which is the element type of `resultType`.
+Tensor dequantize(const Tensor &operand, ShapedType resultType);
+
+/// Implements `quantize` of the StableHLO specification for floating-point
+/// `operand`s of the expressed type of the quantized `resultType`, and
+/// requantizes quantized `operand`s, i.e. quantizes their dequantized values.
+Tensor quantize(const Tensor &operand, ShapedType resultType);
+
+/// Implements `dequantize_op_quantize` of the StableHLO specification for
+/// elementwise ops, including `compareOp` and `selectOp` whose operands or
+/// results aren't all quantized. Evaluates `op` on chunks of consecutive
+/// elements in canonical order at a time, which are dequantized into
+/// floating-point tensors of rank 1 and quantized back into the result after
+/// `op`, so that memory stays bounded by the size of the chunks. Operands of
+/// rank 0, e.g. the bounds of `clampOp`, are dequantized once and passed to
+/// `op` as they are.
+Tensor dequantizeOpQuantize(
+    ArrayRef<Tensor> operands, ShapedType resultType,
+    llvm::function_ref<Tensor(ArrayRef<Tensor>, ShapedType)> op);
+
+/// Returns the elements of the quantized `operand` minus their zero points as
+/// a tensor of i32, which quantized ops like `dotGeneralOp` multiply and
+/// accumulate in i32 like integer implementations of these ops do.
+Tensor subtractZeroPoints(const Tensor &operand);
+
+/// Quantizes `accumulators`, a tensor of i32 holding sums of products of the
+/// elements of `lhsType` and `rhsType` with their zero points subtracted, see
+/// `subtractZeroPoints`, into a tensor of the quantized `resultType`. The
+/// products have the scale of `lhsType`, which must be per-tensor quantized,
+/// times the scale of `rhsType`, which varies along `rhsResultDimension` of
+/// the result if `rhsType` is per-axis quantized.
+Tensor quantizeAccumulators(const Tensor &accumulators, ShapedType lhsType,
+                            ShapedType rhsType, Axis rhsResultDimension,
+                            ShapedType resultType);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_QUANTIZATION_H
@@ -0,0 +1,236 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/reference/Random.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "stablehlo/reference/Parallel.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+/// Number of consecutive counters whose random bits are computed together,
+/// one lane per counter, in loops which compilers vectorize.
+constexpr int64_t kNumLanes = 16;
+
+/// Minimum number of blocks of `kNumLanes` counters which are worth
+/// generating in parallel.
+constexpr int64_t kMinBlocks = 64;
+
+/// The 32-bit words generated for a block of counters, lane by lane.
+template <size_t N>
+using Words = std::array<std::array<uint32_t, kNumLanes>, N>;
+
+uint32_t rotateLeft(uint32_t value, int rotation) {
+  return (value << rotation) | (value >> (32 - rotation));
+}
+
+/// Computes ThreeFry-2x32 with 20 rounds for the counters starting at
+/// `counter`, whose low and high words are the two words of the input.
+Words<2> threeFry(uint32_t key0, uint32_t key1, uint64_t counter) {
+  constexpr int kRotations[8] = {13, 15, 26, 6, 17, 29, 16, 24};
+  const uint32_t keys[3] = {key0, key1, 0x1bd11bda ^ key0 ^ key1};
+  Words<2> x;
+  for (int64_t l = 0; l < kNumLanes; ++l) {
+    uint64_t input = counter + l;
+    x[0][l] = static_cast<uint32_t>(input) + key0;
+    x[1][l] = static_cast<uint32_t>(input >> 32) + key1;
+  }
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      int rotation = kRotations[(4 * i) % 8 + j];
+      for (int64_t l = 0; l < kNumLanes; ++l) {
+        x[0][l] += x[1][l];
+        x[1][l] = rotateLeft(x[1][l], rotation) ^ x[0][l];
+      }
+    }
+    uint32_t injected0 = keys[(i + 1) % 3];
+    uint32_t injected1 = keys[(i + 2) % 3] + i + 1;
+    for (int64_t l = 0; l < kNumLanes; ++l) {
+      x[0][l] += injected0;
+      x[1][l] += injected1;
+    }
+  }
+  return x;
+}
+
+/// Computes Philox-4x32 with 10 rounds for the counters starting at
+/// `counter`. Like XLA, the input is the low and high words of the counter
+/// followed by the key.
+Words<4> philox(uint32_t key0, uint32_t key1, uint64_t counter) {
+  Words<4> x;
+  for (int64_t l = 0; l < kNumLanes; ++l) {
+    uint64_t input = counter + l;
+    x[0][l] = static_cast<uint32_t>(input);
+    x[1][l] = static_cast<uint32_t>(input >> 32);
+    x[2][l] = key0;
+    x[3][l] = key1;
+  }
+  for (int round = 0; round < 10; ++round) {
+    for (int64_t l = 0; l < kNumLanes; ++l) {
+      uint64_t product0 = uint64_t{x[0][l]} * 0xD2511F53;
+      uint64_t product1 = uint64_t{x[2][l]} * 0xCD9E8D57;
+      uint32_t word1 = x[1][l];
+      uint32_t word3 = x[3][l];
+      x[0][l] = static_cast<uint32_t>(product1 >> 32) ^ word1 ^ key0;
+      x[1][l] = static_cast<uint32_t>(product1);
+      x[2][l] = static_cast<uint32_t>(product0 >> 32) ^ word3 ^ key1;
+      x[3][l] = static_cast<uint32_t>(product0);
+    }
+    key0 += 0x9E3779B9;
+    key1 += 0xBB67AE85;
+  }
+  return x;
+}
+
+uint64_t combine(uint32_t low, uint32_t high) {
+  return uint64_t{low} | uint64_t{high} << 32;
+}
+
+int64_t getNumElements(llvm::ArrayRef<int64_t> shape) {
+  int64_t numElements = 1;
+  for (int64_t size : shape) numElements *= size;
+  return numElements;
+}
+
+/// Calls `fn(first, size, words)` with the words which `generate(first)`
+/// computes for every block of counters in [0, numCounters), where `size`
+/// is the number of counters of the block below `numCounters`. Blocks are
+/// generated in parallel.
+template <typename Generate, typename Fn>
+void forEachBlock(int64_t numCounters, Generate generate, Fn fn) {
+  int64_t numBlocks = llvm::divideCeil(numCounters, kNumLanes);
+  parallelForChunks(numBlocks, kMinBlocks, [&](int64_t begin, int64_t end) {
+    for (int64_t block = begin; block < end; ++block) {
+      int64_t first = block * kNumLanes;
+      fn(first, std::min(kNumLanes, numCounters - first), generate(first));
+    }
+  });
+}
+
+/// Calls `fn` with `output` as an array of unsigned integers of `bitWidth`
+/// bits.
+template <typename Fn>
+int64_t dispatchOnBitWidth(int64_t bitWidth, llvm::MutableArrayRef<char> output,
+                           Fn fn) {
+  switch (bitWidth) {
+    case 8:
+      return fn(reinterpret_cast<uint8_t *>(output.data()));
+    case 16:
+      return fn(reinterpret_cast<uint16_t *>(output.data()));
+    case 32:
+      return fn(reinterpret_cast<uint32_t *>(output.data()));
+    case 64:
+      return fn(reinterpret_cast<uint64_t *>(output.data()));
+  }
+  llvm::report_fatal_error("unsupported bit width of random bits");
+}
+
+}  // namespace
+
+int64_t generateThreeFryBits(uint32_t key0, uint32_t key1, uint64_t counter,
+                             llvm::ArrayRef<int64_t> shape, int64_t bitWidth,
+                             llvm::MutableArrayRef<char> output) {
+  auto generate = [&](int64_t first) {
+    return threeFry(key0, key1, counter + first);
+  };
+  return dispatchOnBitWidth(bitWidth, output, [&](auto *data) -> int64_t {
+    using T = std::remove_pointer_t<decltype(data)>;
+    if constexpr (sizeof(T) == 8) {
+      int64_t numCounters = getNumElements(shape);
+      forEachBlock(numCounters, generate,
+                   [&](int64_t first, int64_t size, const Words<2> &x) {
+                     for (int64_t l = 0; l < size; ++l)
+                       data[first + l] = combine(x[0][l], x[1][l]);
+                   });
+      return numCounters;
+    } else {
+      // Counters are laid out like `shape` with dimension `dim` halved,
+      // rounded up, and the two words of every counter go to consecutive
+      // indices of `dim`.
+      llvm::SmallVector<int64_t> dims(shape);
+      if (dims.empty()) dims.push_back(1);
+      auto evenDim = llvm::find_if(dims, [](int64_t d) { return d % 2 == 0; });
+      int64_t dim = evenDim != dims.end()
+                        ? evenDim - dims.begin()
+                        : llvm::max_element(dims) - dims.begin();
+      int64_t dimSize = dims[dim];
+      int64_t halfSize = llvm::divideCeil(dimSize, 2);
+      llvm::ArrayRef<int64_t> dimsRef(dims);
+      int64_t outerSize = getNumElements(dimsRef.take_front(dim));
+      int64_t innerSize = getNumElements(dimsRef.drop_front(dim + 1));
+      int64_t numCounters = outerSize * halfSize * innerSize;
+      forEachBlock(
+          numCounters, generate,
+          [&](int64_t first, int64_t size, const Words<2> &x) {
+            for (int64_t l = 0; l < size; ++l) {
+              int64_t i = first + l;
+              int64_t inner = i % innerSize;
+              int64_t half = i / innerSize % halfSize;
+              int64_t outer = i / innerSize / halfSize;
+              T *element = data + (outer * dimSize + 2 * half) * innerSize +
+                           inner;
+              element[0] = static_cast<T>(x[0][l]);
+              if (2 * half + 1 < dimSize)
+                element[innerSize] = static_cast<T>(x[1][l]);
+            }
+          });
+      return numCounters;
+    }
+  });
+}
+
+int64_t generatePhiloxBits(uint32_t key0, uint32_t key1, uint64_t counter,
+                           llvm::ArrayRef<int64_t> shape, int64_t bitWidth,
+                           llvm::MutableArrayRef<char> output) {
+  auto generate = [&](int64_t first) {
+    return philox(key0, key1, counter + first);
+  };
+  int64_t numElements = getNumElements(shape);
+  return dispatchOnBitWidth(bitWidth, output, [&](auto *data) -> int64_t {
+    using T = std::remove_pointer_t<decltype(data)>;
+    constexpr int64_t kNumValues = sizeof(T) == 8 ? 2 : 4;
+    int64_t numCounters = llvm::divideCeil(numElements, kNumValues);
+    forEachBlock(numCounters, generate,
+                 [&](int64_t first, int64_t size, const Words<4> &x) {
+                   for (int64_t l = 0; l < size; ++l) {
+                     int64_t offset = (first + l) * kNumValues;
+                     int64_t count =
+                         std::min(kNumValues, numElements - offset);
+                     for (int64_t v = 0; v < count; ++v) {
+                       if constexpr (sizeof(T) == 8)
+                         data[offset + v] =
+                             combine(x[2 * v][l], x[2 * v + 1][l]);
+                       else
+                         data[offset + v] = static_cast<T>(x[v][l]);
+                     }
+                   }
+                 });
+    return numCounters;
+  });
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
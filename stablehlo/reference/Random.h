@@ -0,0 +1,50 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_REFERENCE_RANDOM_H
+#define STABLEHLO_REFERENCE_RANDOM_H
+
+#include <cstdint>
+
+#include "llvm/ADT/ArrayRef.h"
+
+namespace mlir {
+namespace stablehlo {
+
+/// Generates random bits with the ThreeFry-2x32 algorithm of 20 rounds for
+/// the key (`key0`, `key1`) and the counters starting at `counter`, into
+/// `output`, the row-major storage of a tensor of `shape` whose elements have
+/// `bitWidth` bits, which must be 8, 16, 32 or 64. Returns the number of
+/// counters used, by which the state of the generator advances.
+///
+/// Bit-matches the lowering of `rng_bit_generator` to Linalg: every counter
+/// yields two 32-bit values, which are truncated and interleaved along the
+/// first dimension of even size, if any, and the largest one otherwise, or
+/// which are combined into one 64-bit value.
+int64_t generateThreeFryBits(uint32_t key0, uint32_t key1, uint64_t counter,
+                             llvm::ArrayRef<int64_t> shape, int64_t bitWidth,
+                             llvm::MutableArrayRef<char> output);
+
+/// Like `generateThreeFryBits`, with the Philox-4x32 algorithm of 10 rounds.
+/// Every counter yields four 32-bit values, which are truncated, or two 64-bit
+/// values, for consecutive elements of `output`.
+int64_t generatePhiloxBits(uint32_t key0, uint32_t key1, uint64_t counter,
+                           llvm::ArrayRef<int64_t> shape, int64_t bitWidth,
+                           llvm::MutableArrayRef<char> output);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_REFERENCE_RANDOM_H
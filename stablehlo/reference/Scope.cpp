@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "stablehlo/reference/Scope.h"
 
+#include <mutex>
+#include <utility>
+
 #include "llvm/Support/FormatVariadic.h"
 #include "mlir/Support/DebugStringHelper.h"
 #include "stablehlo/reference/Value.h"
@@ -23,17 +26,16 @@ namespace mlir {
 namespace stablehlo {
 
 void Scope::add(Value ssaValue, InterpreterValue runtimeValue) {
-  // We are instantiating a new `Scope` object every time the
-  // interpreter evaluates a region. With that, the `stack_frame_` should not
-  // have any duplicates.
-  if (stack_frame_.count(ssaValue))
-    llvm::report_fatal_error("Duplicate SSA register found in scope");
+  std::lock_guard<std::mutex> lock(mutex_);
 
+  // Every evaluation of a region uses a new or cleared `Scope` object. With
+  // that, the `stack_frame_` should not have any duplicates.
   if (ssaValue.getType() != runtimeValue.getType())
     llvm::report_fatal_error(
         "Expected same type for an SSA register and its evaluated value");
 
-  stack_frame_[ssaValue] = runtimeValue;
+  if (!stack_frame_.try_emplace(ssaValue, std::move(runtimeValue)).second)
+    llvm::report_fatal_error("Duplicate SSA register found in scope");
 }
 
 void Scope::add(Value ssaValue, Tensor runtimeValue) {
@@ -68,9 +70,11 @@ void Scope::add(ValueRange ssaValues, ArrayRef<Token> runtimeValues) {
 }
 
 InterpreterValue Scope::find(Value ssaValue) const {
-  auto it = stack_frame_.find(ssaValue);
-
-  if (it != stack_frame_.end()) return it->second;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stack_frame_.find(ssaValue);
+    if (it != stack_frame_.end()) return it->second;
+  }
 
   if (!parent_)
     llvm::report_fatal_error(llvm::formatv("value {0} not found in scope",
@@ -106,5 +110,32 @@ Tuple Scope::findTuple(Value ssaValue) const {
   return find(ssaValue).getTuple();
 }
 
+void Scope::erase(Value ssaValue) {
+  // Destroys the runtime value after unlocking, since that may take a while
+  // for large tensors.
+  InterpreterValue runtimeValue;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stack_frame_.find(ssaValue);
+    if (it == stack_frame_.end())
+      llvm::report_fatal_error(llvm::formatv("value {0} not found in scope",
+                                             debugString(ssaValue).c_str()));
+    runtimeValue = std::move(it->second);
+    stack_frame_.erase(it);
+  }
+}
+
+void Scope::clear() {
+  // Destroys the runtime values after unlocking, see `erase`.
+  SmallVector<InterpreterValue> runtimeValues;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    runtimeValues.reserve(stack_frame_.size());
+    for (auto &[ssaValue, runtimeValue] : stack_frame_)
+      runtimeValues.push_back(std::move(runtimeValue));
+    stack_frame_.clear();
+  }
+}
+
 }  // namespace stablehlo
 }  // namespace mlir
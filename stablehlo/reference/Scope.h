@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef STABLEHLO_REFERENCE_SCOPE_H
 #define STABLEHLO_REFERENCE_SCOPE_H
 
+#include <mutex>
+
 #include "stablehlo/reference/Tensor.h"
 #include "stablehlo/reference/Token.h"
 #include "stablehlo/reference/Value.h"
@@ -27,13 +29,12 @@ namespace stablehlo {
 /// evaluation. Holds (1) mapping from SSA values, defined in the current
 /// region, to their evaluated runtime `Tensor` values, and (2) handle to
 /// `Scope` object corresponding to the syntactically enclosing region.
+/// Mappings can be added, found and removed concurrently, e.g. by ops of a
+/// region which are evaluated in parallel.
 class Scope {
  public:
   Scope(Scope *parent) : parent_(parent) {}
 
-  Scope(Scope &&other) = default;
-  Scope &operator=(Scope &&other) = default;
-
   Scope(const Scope &) = delete;
   Scope &operator=(const Scope &) = delete;
 
@@ -94,11 +95,22 @@ class Scope {
   /// defined by `parent_`.
   Tuple findTuple(Value ssaValue) const;
 
+  /// Remove the mapping for SSA value (`ssaValue`), defined in the current
+  /// region. The runtime value is destroyed once nothing else references it.
+  void erase(Value ssaValue);
+
+  /// Remove all mappings defined in the current region, keeping the storage
+  /// of the mapping for subsequent evaluations of the region.
+  void clear();
+
  private:
   /// Internal store for mapping from SSA values to runtime `InterpreterValue`
   /// values.
   llvm::DenseMap<Value, InterpreterValue> stack_frame_;
 
+  /// Guards `stack_frame_`.
+  mutable std::mutex mutex_;
+
   /// A handle to the parent's scope.
   Scope *parent_;
 };
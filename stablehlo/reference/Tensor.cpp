@@ -16,13 +16,22 @@ limitations under the License.
 #include "stablehlo/reference/Tensor.h"
 
 #include <complex>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
 
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/MathExtras.h"
+#include "mlir/AsmParser/AsmParser.h"
+#include "mlir/Dialect/Quant/QuantTypes.h"
 #include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/Support/DebugStringHelper.h"
+#include "stablehlo/reference/BufferPool.h"
 #include "stablehlo/reference/Errors.h"
 #include "stablehlo/reference/Index.h"
 #include "stablehlo/reference/Types.h"
@@ -43,64 +52,97 @@ int64_t getSizeInBytes(Type type) {
   if (auto complexType = dyn_cast<mlir::ComplexType>(type))
     return getSizeInBytes(complexType.getElementType()) * 2;
 
+  if (auto quantizedType = dyn_cast<quant::QuantizedType>(type))
+    return getSizeInBytes(quantizedType.getStorageType());
+
   report_fatal_error(
       invalidArgument("Unsupported type: %s", debugString(type).c_str()));
 }
 
 // Flattens multi-dimensional index 'index' of a tensor to a linearized index
 // into the underlying storage where elements are laid out in canonical order.
-int64_t flattenIndex(const Sizes &shape, const Index &index) {
-  if (!index.inBounds(shape))
+// Example: For a tensor with shape [1,2,3] and index [0, 1, 2], the flattened
+// index = ((0*2) + 1)*3 + 2 = 5.
+int64_t flattenIndex(ArrayRef<int64_t> shape, const Index &index) {
+  if (index.size() != shape.size())
     llvm::report_fatal_error(
         "Incompatible index and shape found while flattening index");
 
   int64_t idx = 0;
-  if (shape.empty()) return idx;
-
-  // Computes strides of a tensor shape: The number of locations in memory
-  // between beginnings of successive array elements, measured in units of the
-  // size of the array's elements.
-  // Example: For a tensor shape [1,2,3], strides = [6,3,1]
-  std::vector<int64_t> strides(shape.size());
-  strides[shape.size() - 1] = 1;
-  for (int i = shape.size() - 2; i >= 0; --i)
-    strides[i] = strides[i + 1] * shape[i + 1];
-
-  // Use the computed strides to flatten the multi-dimensional index 'index'
-  // to a linearized index.
-  // Example: For a tensor with shape [1,2,3], strides = [6,3,1], and index =
-  // [0, 1, 2], the flattened index = 0*6 + 1*3 + 2*1 = 5
-  for (size_t i = 0; i < index.size(); i++) idx += strides[i] * index[i];
+  for (auto [dimSize, i] : llvm::zip(shape, index)) {
+    if (i < 0 || i >= dimSize)
+      llvm::report_fatal_error(
+          "Incompatible index and shape found while flattening index");
+    idx = idx * dimSize + i;
+  }
   return idx;
 }
 
-}  // namespace
-
-namespace detail {
-
-Buffer::Buffer(ShapedType type)
-    : type_(type),
-      blob_(
-          HeapAsmResourceBlob::allocate(getSizeInBytes(type), alignof(char))) {}
-
-Buffer::Buffer(ShapedType type, AsmResourceBlob blob)
-    : type_(type), blob_(std::move(blob)) {}
-
-}  // namespace detail
-
-Tensor::Tensor() {}
+// Returns the strides of the canonical order of `shape`, in elements.
+Sizes getCanonicalStrides(const Sizes &shape) {
+  Sizes strides(shape.size());
+  int64_t stride = 1;
+  for (int64_t d = shape.size() - 1; d >= 0; --d) {
+    strides[d] = stride;
+    stride *= shape[d];
+  }
+  return strides;
+}
 
-Tensor::Tensor(ShapedType type)
-    : impl_(llvm::makeIntrusiveRefCnt<detail::Buffer>(type)) {}
+// Copies the elements of type `T` of a strided view of shape `shape`, whose
+// element at index 0 is at `data`, to `result` in canonical order.
+template <typename T>
+void copyStridedElements(const T *data, const Sizes &shape,
+                         ArrayRef<int64_t> strides, T *result) {
+  int64_t numElements = 1;
+  for (auto size : shape) numElements *= size;
+  if (numElements == 0) return;
+
+  // Walks the index space in canonical order while keeping track of the
+  // position of the current element in `data`.
+  Sizes index(shape.size(), 0);
+  int64_t position = 0;
+  for (int64_t i = 0; i < numElements; ++i) {
+    result[i] = data[position];
+    for (int64_t d = shape.size() - 1; d >= 0; --d) {
+      position += strides[d];
+      if (++index[d] < shape[d]) break;
+      position -= strides[d] * shape[d];
+      index[d] = 0;
+    }
+  }
+}
 
-Tensor::Tensor(ShapedType type, AsmResourceBlob blob)
-    : impl_(llvm::makeIntrusiveRefCnt<detail::Buffer>(type, std::move(blob))) {}
+// Copies the elements of `elementSize` bytes each of a strided view, see
+// `copyStridedElements`.
+void copyStrided(const char *data, int64_t elementSize, const Sizes &shape,
+                 ArrayRef<int64_t> strides, char *result) {
+  auto copy = [&](auto element) {
+    using T = decltype(element);
+    copyStridedElements(reinterpret_cast<const T *>(data), shape, strides,
+                        reinterpret_cast<T *>(result));
+  };
+  switch (elementSize) {
+    case 1:
+      return copy(uint8_t());
+    case 2:
+      return copy(uint16_t());
+    case 4:
+      return copy(uint32_t());
+    case 8:
+      return copy(uint64_t());
+    case 16:
+      return copy(std::complex<double>());
+  }
+  report_fatal_error(
+      invalidArgument("Unsupported element size: %ld", (long)elementSize));
+}
 
-Element Tensor::get(const Index &index) const {
-  Type elementType = getType().getElementType();
-  const char *elementPtr =
-      impl_->getData().data() +
-      getSizeInBytes(elementType) * flattenIndex(getShape(), index);
+// Reads the element of type `elementType` stored at `elementPtr`.
+Element readElement(Type elementType, const char *elementPtr) {
+  // Quantized elements are read as integers of their storage type.
+  if (auto quantizedType = dyn_cast<quant::QuantizedType>(elementType))
+    return readElement(quantizedType.getStorageType(), elementPtr);
 
   // Handle floating-point types.
   if (elementType.isFloat8E4M3B11FNUZ()) {
@@ -142,12 +184,12 @@ Element Tensor::get(const Index &index) const {
 
   if (elementType.isF32()) {
     auto elementData = reinterpret_cast<const float *>(elementPtr);
-    return Element(elementType, APFloat(*elementData));
+    return Element(elementType, *elementData);
   }
 
   if (elementType.isF64()) {
     auto elementData = reinterpret_cast<const double *>(elementPtr);
-    return Element(elementType, APFloat(*elementData));
+    return Element(elementType, *elementData);
   }
 
   // Handle integer types.
@@ -228,11 +270,10 @@ Element Tensor::get(const Index &index) const {
                                      debugString(elementType).c_str()));
 }
 
-void Tensor::set(const Index &index, const Element &element) {
-  Type elementType = getType().getElementType();
-  char *elementPtr =
-      impl_->getMutableData().data() +
-      getSizeInBytes(elementType) * flattenIndex(getShape(), index);
+// Writes `element` of type `elementType` to the storage at `elementPtr`.
+void writeElement(Type elementType, char *elementPtr, const Element &element) {
+  if (auto quantizedType = dyn_cast<quant::QuantizedType>(elementType))
+    return writeElement(quantizedType.getStorageType(), elementPtr, element);
 
   // Handle floating-point types.
   if (elementType.isFloat8E4M3B11FNUZ() || elementType.isFloat8E4M3FN() ||
@@ -253,15 +294,19 @@ void Tensor::set(const Index &index, const Element &element) {
 
   if (elementType.isF32()) {
     auto elementData = reinterpret_cast<float *>(elementPtr);
-    auto value = element.getFloatValue();
-    *elementData = value.convertToFloat();
+    if (auto *value = element.getNativeFloatValue<float>())
+      *elementData = *value;
+    else
+      *elementData = element.getFloatValue().convertToFloat();
     return;
   }
 
   if (elementType.isF64()) {
     auto elementData = reinterpret_cast<double *>(elementPtr);
-    auto value = element.getFloatValue();
-    *elementData = value.convertToDouble();
+    if (auto *value = element.getNativeFloatValue<double>())
+      *elementData = *value;
+    else
+      *elementData = element.getFloatValue().convertToDouble();
     return;
   }
 
@@ -360,6 +405,143 @@ void Tensor::set(const Index &index, const Element &element) {
                                      debugString(elementType).c_str()));
 }
 
+}  // namespace
+
+namespace detail {
+
+Buffer::Buffer(ShapedType type)
+    : type_(type),
+      blob_(BufferPool::get().allocate(getSizeInBytes(type))) {}
+
+Buffer::Buffer(ShapedType type, AsmResourceBlob blob)
+    : type_(type), blob_(std::move(blob)) {}
+
+Buffer::Buffer(ShapedType type, llvm::IntrusiveRefCntPtr<Buffer> base,
+               int64_t offset, Sizes strides)
+    : type_(type),
+      base_(std::move(base)),
+      offset_(offset),
+      strides_(std::move(strides)) {}
+
+ArrayRef<char> Buffer::getMaterializedData() const {
+  std::call_once(materialized_, [&] {
+    int64_t elementSize = getSizeInBytes(type_.getElementType());
+    auto blob = BufferPool::get().allocate(getSizeInBytes(type_));
+    copyStrided(base_->getData().data() + offset_ * elementSize, elementSize,
+                Sizes(type_.getShape()), strides_,
+                blob.getMutableData().data());
+    blob_ = std::move(blob);
+  });
+  return blob_.getData();
+}
+
+}  // namespace detail
+
+Tensor::Tensor() {}
+
+Tensor::Tensor(ShapedType type)
+    : impl_(llvm::makeIntrusiveRefCnt<detail::Buffer>(type)) {}
+
+Tensor::Tensor(ShapedType type, AsmResourceBlob blob)
+    : impl_(llvm::makeIntrusiveRefCnt<detail::Buffer>(type, std::move(blob))) {}
+
+Tensor::Tensor(llvm::IntrusiveRefCntPtr<detail::Buffer> impl)
+    : impl_(std::move(impl)) {}
+
+Sizes Tensor::getStrides() const {
+  if (impl_->isStrided()) return impl_->getStrides();
+  return getCanonicalStrides(getShape());
+}
+
+const char *Tensor::getStridedData() const {
+  if (!impl_->isStrided()) return getData();
+  return impl_->getBase()->getData().data() +
+         impl_->getOffset() * getSizeInBytes(getElementType());
+}
+
+bool Tensor::isSplat() const {
+  if (getNumElements() == 0) return false;
+  if (!impl_->isStrided()) return getNumElements() == 1;
+  for (auto [size, stride] : llvm::zip(getShape(), impl_->getStrides()))
+    if (size != 1 && stride != 0) return false;
+  return true;
+}
+
+Element Tensor::get(const Index &index) const {
+  Type elementType = getType().getElementType();
+  const char *elementPtr;
+  if (impl_->isStrided()) {
+    // Strided views are read in place rather than materialized.
+    if (!index.inBounds(getShape()))
+      llvm::report_fatal_error("Index out of bounds of strided view");
+    const auto &strides = impl_->getStrides();
+    int64_t position = 0;
+    for (size_t d = 0; d < index.size(); ++d) position += index[d] * strides[d];
+    elementPtr = getStridedData() + getSizeInBytes(elementType) * position;
+  } else {
+    elementPtr = impl_->getData().data() +
+                 getSizeInBytes(elementType) *
+                     flattenIndex(impl_->getType().getShape(), index);
+  }
+
+  return readElement(elementType, elementPtr);
+}
+
+Element Tensor::getLinear(int64_t linearIndex) const {
+  if (linearIndex < 0 || linearIndex >= getNumElements())
+    llvm::report_fatal_error("Linear index out of bounds");
+
+  Type elementType = getElementType();
+  if (!impl_->isStrided())
+    return readElement(elementType, impl_->getData().data() +
+                                        getSizeInBytes(elementType) *
+                                            linearIndex);
+
+  // Strided views are read in place rather than materialized.
+  auto shape = impl_->getType().getShape();
+  const auto &strides = impl_->getStrides();
+  int64_t position = 0;
+  for (int64_t d = shape.size() - 1; d >= 0; --d) {
+    position += linearIndex % shape[d] * strides[d];
+    linearIndex /= shape[d];
+  }
+  return readElement(elementType,
+                     getStridedData() + getSizeInBytes(elementType) * position);
+}
+
+void Tensor::materialize() {
+  auto copy = llvm::makeIntrusiveRefCnt<detail::Buffer>(getType());
+  if (impl_->isStrided())
+    copyStrided(getStridedData(), getSizeInBytes(getElementType()),
+                getShape(), impl_->getStrides(),
+                copy->getMutableData().data());
+  else
+    llvm::copy(impl_->getData(), copy->getMutableData().begin());
+  impl_ = std::move(copy);
+}
+
+void Tensor::set(const Index &index, const Element &element) {
+  if (!impl_->isMutable()) materialize();
+  Type elementType = getElementType();
+  writeElement(elementType,
+               impl_->getMutableData().data() +
+                   getSizeInBytes(elementType) *
+                       flattenIndex(impl_->getType().getShape(), index),
+               element);
+}
+
+void Tensor::setLinear(int64_t linearIndex, const Element &element) {
+  if (linearIndex < 0 || linearIndex >= getNumElements())
+    llvm::report_fatal_error("Linear index out of bounds");
+
+  if (!impl_->isMutable()) materialize();
+  Type elementType = getElementType();
+  writeElement(elementType,
+               impl_->getMutableData().data() +
+                   getSizeInBytes(elementType) * linearIndex,
+               element);
+}
+
 IndexSpaceIterator Tensor::index_begin() const {
   return getShape().index_begin();
 }
@@ -538,6 +720,116 @@ Tensor makeTensor(DenseElementsAttr attr) {
       invalidArgument("Unsupported type: ", debugString(type).c_str()));
 }
 
+Tensor makeTensorView(const Tensor &base, int64_t offset, ShapedType type) {
+  if (base.getElementType() != type.getElementType() || offset < 0 ||
+      offset + type.getNumElements() > base.getNumElements())
+    report_fatal_error(invalidArgument(
+        "View of %d elements at offset %d doesn't fit into tensor of type %s",
+        type.getNumElements(), offset, debugString(base.getType()).c_str()));
+
+  // The blob aliases the storage of `base`, which its deleter keeps alive.
+  int64_t elementSize = getSizeInBytes(type.getElementType());
+  ArrayRef<char> data(base.getData() + offset * elementSize,
+                      type.getNumElements() * elementSize);
+  return Tensor(type, AsmResourceBlob(
+                          data, llvm::MinAlign(alignof(std::max_align_t),
+                                               offset * elementSize),
+                          [base](void *, size_t, size_t) {},
+                          /*dataIsMutable=*/false));
+}
+
+Tensor makeTensorView(DenseElementsAttr attr) {
+  auto type = attr.getType();
+  auto elementType = type.getElementType();
+  auto storageType = elementType;
+  if (auto complexType = dyn_cast<ComplexType>(elementType))
+    storageType = complexType.getElementType();
+
+  // Elements whose width isn't a whole number of bytes, like i1 and i4, are
+  // stored differently by attributes and by Tensor objects.
+  auto denseAttr = dyn_cast<DenseIntOrFPElementsAttr>(attr);
+  if (!denseAttr || !storageType.isIntOrFloat() ||
+      storageType.getIntOrFloatBitWidth() % 8 != 0 ||
+      type.getNumElements() == 0)
+    return makeTensor(attr);
+
+  // Attributes are immortal, so the blob doesn't need to keep them alive.
+  auto blob = UnmanagedAsmResourceBlob::allocateWithAlign(
+      denseAttr.getRawData(), alignof(uint64_t), /*deleter=*/{},
+      /*dataIsMutable=*/false);
+  if (!attr.isSplat()) return Tensor(type, std::move(blob));
+  Tensor element(RankedTensorType::get({}, elementType), std::move(blob));
+  return makeSplatView(element, type);
+}
+
+Tensor makeStridedView(const Tensor &operand, ShapedType type, int64_t offset,
+                       ArrayRef<int64_t> strides) {
+  if (operand.getElementType() != type.getElementType() ||
+      (int64_t)strides.size() != type.getRank())
+    report_fatal_error(invalidArgument(
+        "Strided view of type %s doesn't match tensor of type %s",
+        debugString(type).c_str(), debugString(operand.getType()).c_str()));
+  if (type.getNumElements() == 0) return Tensor(type);
+
+  // Views of views read the storage of the original tensor.
+  auto base = operand.impl_;
+  if (base->isStrided()) {
+    offset += base->getOffset();
+    base = base->getBase();
+  }
+
+  int64_t first = offset, last = offset;
+  for (auto [size, stride] : llvm::zip(type.getShape(), strides))
+    (stride < 0 ? first : last) += (size - 1) * stride;
+  if (first < 0 || last >= base->getType().getNumElements())
+    report_fatal_error(invalidArgument(
+        "Strided view of type %s doesn't fit into tensor of type %s",
+        debugString(type).c_str(), debugString(operand.getType()).c_str()));
+
+  // Views which turn out to be in canonical order are contiguous.
+  Sizes shape(type.getShape());
+  if (llvm::equal(strides, getCanonicalStrides(shape)))
+    return makeTensorView(Tensor(std::move(base)), offset, type);
+  return Tensor(llvm::makeIntrusiveRefCnt<detail::Buffer>(
+      type, std::move(base), offset, Sizes(strides)));
+}
+
+Tensor makeSplatView(const Tensor &element, ShapedType type) {
+  if (!element.isSplat())
+    report_fatal_error(invalidArgument(
+        "Splat view of type %s requires a splat, got tensor of type %s",
+        debugString(type).c_str(), debugString(element.getType()).c_str()));
+  return makeStridedView(element, type, /*offset=*/0,
+                         SmallVector<int64_t>(type.getRank(), 0));
+}
+
+std::string serializeTensorBytes(const Tensor &tensor) {
+  std::string result = debugString(tensor.getType());
+  result.push_back('\0');
+  auto data = tensor.getData<char>();
+  result.append(data.begin(), data.end());
+  return result;
+}
+
+llvm::Expected<Tensor> deserializeTensorBytes(StringRef bytes,
+                                              MLIRContext *context) {
+  auto [typeString, data] = bytes.split('\0');
+  auto type = dyn_cast_or_null<ShapedType>(parseType(typeString, context));
+  if (!type || typeString.size() == bytes.size())
+    return llvm::createStringError(llvm::errc::invalid_argument,
+                                   "Failed to parse type of tensor: %s",
+                                   typeString.str().c_str());
+  if ((int64_t)data.size() != getSizeInBytes(type))
+    return llvm::createStringError(
+        llvm::errc::invalid_argument,
+        "Expected %ld bytes for tensor of type %s, but got %zu",
+        (long)getSizeInBytes(type), typeString.str().c_str(), data.size());
+
+  Tensor result(type);
+  llvm::copy(data, result.getMutableData<char>().begin());
+  return result;
+}
+
 DenseElementsAttr makeDenseElementsAttr(Tensor tensor) {
   auto type = tensor.getType();
   auto elementType = type.getElementType();
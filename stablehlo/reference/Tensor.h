@@ -16,12 +16,18 @@ limitations under the License.
 #ifndef STABLEHLO_REFERENCE_TENSOR_H
 #define STABLEHLO_REFERENCE_TENSOR_H
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
 #include <numeric>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
 #include "mlir/IR/AsmState.h"
 #include "mlir/IR/BuiltinAttributes.h"
@@ -35,31 +41,108 @@ namespace stablehlo {
 
 namespace detail {
 
-/// Underlying storage class for Tensor objects.
-class Buffer : public llvm::ThreadSafeRefCountedBase<Buffer> {
+/// Underlying storage class for Tensor objects. Reference counted in a
+/// thread-safe way like `llvm::ThreadSafeRefCountedBase`, but also exposes
+/// whether it's uniquely referenced, so that ops can reuse its storage.
+class Buffer {
  public:
   /// \name Constructors
   /// @{
   explicit Buffer(ShapedType type);
   Buffer(ShapedType type, AsmResourceBlob blob);
-  Buffer(Buffer &&other) = default;
+
+  /// Creates a strided view of the storage of `base`, which must not be a
+  /// strided view itself. See `makeStridedView`.
+  Buffer(ShapedType type, llvm::IntrusiveRefCntPtr<Buffer> base,
+         int64_t offset, Sizes strides);
+  /// @}
+
+  /// Copying and moving are deleted since Buffer objects are reference
+  /// counted.
+  Buffer(const Buffer &other) = delete;
+  Buffer &operator=(const Buffer &other) = delete;
+
+  /// \name Reference counting for `llvm::IntrusiveRefCntPtr`
+  /// @{
+  void Retain() const { refCount_.fetch_add(1, std::memory_order_relaxed); }
+  void Release() const {
+    if (refCount_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+  }
   /// @}
 
-  /// Move assignment operator deleted in RefCountedBase
-  Buffer &operator=(Buffer &&other) = delete;
+  /// Returns whether there is exactly one reference to the Buffer object.
+  bool hasOneRef() const {
+    return refCount_.load(std::memory_order_acquire) == 1;
+  }
+
+  /// Returns whether the underlying storage can be written to. Buffer objects
+  /// which alias the storage of other Buffer objects, like views created by
+  /// `makeTensorView` and strided views, are read-only.
+  bool isMutable() const { return !base_ && blob_.isMutable(); }
+
+  /// Returns whether the Buffer object is a strided view, whose elements are
+  /// read from the storage of `getBase` rather than its own.
+  bool isStrided() const { return (bool)base_; }
+
+  /// Returns the Buffer object whose storage a strided view reads.
+  const llvm::IntrusiveRefCntPtr<Buffer> &getBase() const { return base_; }
+
+  /// Returns the position of the element at index 0 of a strided view in the
+  /// storage of `getBase`, in elements.
+  int64_t getOffset() const { return offset_; }
+
+  /// Returns the distances between consecutive elements along every
+  /// dimension of a strided view in the storage of `getBase`, in elements.
+  const Sizes &getStrides() const { return strides_; }
 
   /// Returns type of the Buffer object.
   ShapedType getType() { return type_; }
 
-  /// Provides access to the underlying non-mutable storage.
-  ArrayRef<char> getData() const { return blob_.getData(); }
+  /// Provides access to the underlying non-mutable storage. Strided views are
+  /// copied into storage in canonical order on first access, once for all
+  /// their users.
+  ArrayRef<char> getData() const {
+    if (base_) return getMaterializedData();
+    return blob_.getData();
+  }
 
   /// Provides access to the underlying mutable storage.
   MutableArrayRef<char> getMutableData() { return blob_.getMutableData(); }
 
+  /// Provides typed access to the underlying non-mutable storage. `T` must be
+  /// the storage type of the element type of the Buffer object.
+  template <typename T>
+  ArrayRef<T> getData() const {
+    auto data = getData();
+    return ArrayRef<T>(reinterpret_cast<const T *>(data.data()),
+                       data.size() / sizeof(T));
+  }
+
+  /// Provides typed access to the underlying mutable storage. `T` must be the
+  /// storage type of the element type of the Buffer object.
+  template <typename T>
+  MutableArrayRef<T> getMutableData() {
+    auto data = getMutableData();
+    return MutableArrayRef<T>(reinterpret_cast<T *>(data.data()),
+                              data.size() / sizeof(T));
+  }
+
  private:
+  /// Implements `getData` for strided views.
+  ArrayRef<char> getMaterializedData() const;
+
   ShapedType type_;
-  AsmResourceBlob blob_;
+
+  /// Storage of the Buffer object, which strided views fill in lazily.
+  mutable AsmResourceBlob blob_;
+  mutable std::once_flag materialized_;
+
+  /// See `getBase`, `getOffset` and `getStrides`. Only used by strided views.
+  llvm::IntrusiveRefCntPtr<Buffer> base_;
+  int64_t offset_ = 0;
+  Sizes strides_;
+
+  mutable std::atomic<int> refCount_ = 0;
 };
 
 }  // namespace detail
@@ -110,16 +193,81 @@ class Tensor {
   /// Provides read access to the tensor element indexed at 'index'.
   Element get(const Index &index) const;
 
+  /// Provides read access to the tensor element at offset `linearIndex` in
+  /// canonical order, e.g. `IndexSpaceIterator::getLinearIndex`. Unlike
+  /// `get`, this doesn't flatten an index for tensors in canonical order.
+  Element getLinear(int64_t linearIndex) const;
+
   /// Provides read access to underlying tensor data buffer.
   const char *getData() const { return impl_->getData().data(); }
 
+  /// Provides typed read access to underlying tensor data buffer, with
+  /// elements laid out in canonical order. `T` must be the native type of the
+  /// element type, see `dispatchOnNativeType`.
+  template <typename T>
+  ArrayRef<T> getData() const {
+    return impl_->getData<T>();
+  }
+
+  /// Provides typed write access to underlying tensor data buffer, with
+  /// elements laid out in canonical order. `T` must be the native type of the
+  /// element type, see `dispatchOnNativeType`. Copies read-only storage into
+  /// storage owned by this object first.
+  template <typename T>
+  MutableArrayRef<T> getMutableData() {
+    if (!impl_->isMutable()) materialize();
+    return impl_->getMutableData<T>();
+  }
+
+  /// Returns whether this is a strided view created by `makeStridedView`.
+  /// Kernels can read its elements through `getStridedData` and `getStrides`,
+  /// whereas `getData` copies them into storage in canonical order first.
+  bool isStrided() const { return impl_->isStrided(); }
+
+  /// Returns whether all elements are read from the same element of the
+  /// storage, like for splat constants and broadcasts of scalars, which are
+  /// strided views with zero strides, and for tensors with one element.
+  /// Kernels can treat such tensors as scalars by reading the element at
+  /// `getStridedData` once.
+  bool isSplat() const;
+
+  /// Returns the distances between consecutive elements along every
+  /// dimension in the storage which `getStridedData` points into, in
+  /// elements. These can be zero or negative for strided views, and are the
+  /// strides of the canonical order otherwise.
+  Sizes getStrides() const;
+
+  /// Returns a pointer to the element at index 0, from which the element at
+  /// `index` is the sum of `index[d] * getStrides()[d]` elements away. Unlike
+  /// `getData`, this doesn't copy the elements of strided views.
+  const char *getStridedData() const;
+
+  /// Typed counterpart of `getStridedData`, see `getData`.
+  template <typename T>
+  const T *getStridedData() const {
+    return reinterpret_cast<const T *>(getStridedData());
+  }
+
+  /// Returns whether this object holds the only reference to the underlying
+  /// storage and can write to it, in which case ops may reuse the storage for
+  /// their results.
+  bool hasUniqueStorage() const {
+    return impl_->hasOneRef() && impl_->isMutable();
+  }
+
   /// Provides write access to the tensor element indexed at 'index'.
   ///
   /// \param index The multi-dimensional index to write to.
   /// \param element The Element object \a element is used to update the
   /// underlying storage pointed to by \a index.
+  ///
+  /// Copies read-only storage into storage owned by this object first.
   void set(const Index &index, const Element &element);
 
+  /// Provides write access to the tensor element at offset `linearIndex` in
+  /// canonical order, see `getLinear`.
+  void setLinear(int64_t linearIndex, const Element &element);
+
   /// Prints Tensor objects.
   void print(raw_ostream &os) const;
   void dump() const;
@@ -129,6 +277,14 @@ class Tensor {
   IndexSpaceIterator index_end() const;
 
  private:
+  explicit Tensor(llvm::IntrusiveRefCntPtr<detail::Buffer> impl);
+
+  friend Tensor makeStridedView(const Tensor &operand, ShapedType type,
+                                int64_t offset, ArrayRef<int64_t> strides);
+
+  /// Replaces read-only storage with a mutable copy.
+  void materialize();
+
   llvm::IntrusiveRefCntPtr<detail::Buffer> impl_;
 };
 
@@ -138,9 +294,104 @@ inline raw_ostream &operator<<(raw_ostream &os, Tensor tensor) {
   return os;
 }
 
+/// Invokes `fn` with a value-initialized object of the native C++ type whose
+/// arithmetic matches the semantics of `elementType` and which is used as its
+/// storage type, then returns true. For example, f32 maps to `float` and ui16
+/// maps to `uint16_t`. Returns false without invoking `fn` if there is no such
+/// type, e.g. for f8/f16/bf16 (no builtin floating-point type), i4/ui4
+/// (narrower than their storage type), booleans and complex types. Kernels use
+/// this to dispatch on the element type once per op rather than once per
+/// element, and fall back to `Element`-based evaluation if it returns false.
+template <typename Fn>
+bool dispatchOnNativeType(Type elementType, Fn &&fn) {
+  if (elementType.isF32()) {
+    fn(float());
+    return true;
+  }
+  if (elementType.isF64()) {
+    fn(double());
+    return true;
+  }
+  if (elementType.isSignlessInteger(8)) {
+    fn(int8_t());
+    return true;
+  }
+  if (elementType.isSignlessInteger(16)) {
+    fn(int16_t());
+    return true;
+  }
+  if (elementType.isSignlessInteger(32)) {
+    fn(int32_t());
+    return true;
+  }
+  if (elementType.isSignlessInteger(64)) {
+    fn(int64_t());
+    return true;
+  }
+  if (elementType.isUnsignedInteger(8)) {
+    fn(uint8_t());
+    return true;
+  }
+  if (elementType.isUnsignedInteger(16)) {
+    fn(uint16_t());
+    return true;
+  }
+  if (elementType.isUnsignedInteger(32)) {
+    fn(uint32_t());
+    return true;
+  }
+  if (elementType.isUnsignedInteger(64)) {
+    fn(uint64_t());
+    return true;
+  }
+  return false;
+}
+
 /// Creates a Tensor from a DenseElementsAttr.
 Tensor makeTensor(DenseElementsAttr attr);
 
+/// Creates a read-only Tensor of type `type` which shares the storage of
+/// `base`, starting at the element at flattened position `offset` in
+/// canonical order, without copying it. The elements of `type` must fit into
+/// the rest of the storage of `base`, whose element type must be the element
+/// type of `type`. Used to pass contiguous parts of tensors between ops, e.g.
+/// the shards exchanged by collectives, which are copied only when written.
+Tensor makeTensorView(const Tensor &base, int64_t offset, ShapedType type);
+
+/// Creates a read-only Tensor which shares the storage of `attr` without
+/// copying it, if the raw data of `attr` is laid out like the storage of
+/// Tensor objects, i.e. unless its elements are narrower than a byte, and
+/// copies it like `makeTensor` otherwise.
+Tensor makeTensorView(DenseElementsAttr attr);
+
+/// Creates a read-only Tensor of type `type` which shares the storage of
+/// `operand` without copying it: its element at index `i` is the element
+/// `offset` plus the sum of `i[d] * strides[d]` elements away from
+/// `operand.getStridedData()`. E.g. permuting `operand.getStrides()` gives a
+/// transpose and zero strides repeat elements like a broadcast. This takes
+/// constant time and memory, and elements are copied only when they are
+/// written or read in canonical order through `getData`. The element types
+/// of `operand` and `type` must be the same.
+Tensor makeStridedView(const Tensor &operand, ShapedType type, int64_t offset,
+                       ArrayRef<int64_t> strides);
+
+/// Creates a read-only Tensor of type `type` all of whose elements are the
+/// element of `element`, which must be a splat, see `Tensor::isSplat`, without
+/// copying it. This is a strided view with zero strides, which takes constant
+/// memory until it is read in canonical order through `getData`.
+Tensor makeSplatView(const Tensor &element, ShapedType type);
+
+/// Serializes `tensor` into its type as printed by MLIR, followed by a null
+/// character and the raw bytes of its underlying storage. Unlike NumPy files,
+/// this handles every element type and doesn't convert elements, which makes
+/// it suitable for moving tensors between hosts.
+std::string serializeTensorBytes(const Tensor &tensor);
+
+/// Creates a Tensor from `bytes` produced by `serializeTensorBytes`, parsing
+/// its type in `context`.
+llvm::Expected<Tensor> deserializeTensorBytes(StringRef bytes,
+                                              MLIRContext *context);
+
 /// Creates a DenseElementsAttr from a Tensor.
 DenseElementsAttr makeDenseElementsAttr(Tensor tensor);
 
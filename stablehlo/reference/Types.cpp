@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "stablehlo/reference/Types.h"
 
+#include "mlir/Dialect/Quant/QuantTypes.h"
 #include "mlir/IR/BuiltinTypes.h"
 
 namespace mlir {
@@ -58,6 +59,16 @@ bool isSupportedComplexType(Type type) {
   return complexElemTy.isF32() || complexElemTy.isF64();
 }
 
+bool isSupportedQuantizedType(Type type) {
+  if (!isa<quant::UniformQuantizedType, quant::UniformQuantizedPerAxisType>(
+          type))
+    return false;
+  auto quantizedType = cast<quant::QuantizedType>(type);
+  auto expressedType = quantizedType.getExpressedType();
+  return quantizedType.getStorageTypeIntegralWidth() <= 32 &&
+         (expressedType.isF32() || expressedType.isF64());
+}
+
 int64_t numBits(Type type) {
   if (isSupportedComplexType(type))
     return numBits(cast<ComplexType>(type).getElementType()) * 2;
@@ -46,6 +46,12 @@ bool isSupportedFloatType(Type type);
 /// StableHLO specification. Such types are: complex<f32> and complex<f64>.
 bool isSupportedComplexType(Type type);
 
+/// Check if the type 'type' is a supported quantized type, i.e. a uniform
+/// quantized type with per-tensor or per-axis quantization whose storage type
+/// has at most 32 bits and whose expressed type is f32 or f64. Tensors of
+/// such types store the integers of the storage type.
+bool isSupportedQuantizedType(Type type);
+
 /// Returns the number of bits in the representation of an element type.
 ///   * For boolean type: 1.
 ///   * For integer types: bit width (e.g. 32 for si32).
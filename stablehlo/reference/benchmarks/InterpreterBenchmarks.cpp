@@ -0,0 +1,401 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks of the reference interpreter. Every benchmark evaluates a small
+// program, which consists of the kernel under test, from an
+// `InterpreterExecutable`, so that the numbers include the overhead of `eval`
+// which real programs pay as well.
+//
+// Besides the flags of Google Benchmark, the binary takes MLIR files, e.g. the
+// tests in stablehlo/tests/interpret, and benchmarks every function without
+// arguments in them as `e2e/<file>/<function>`. Checks are skipped.
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/reference/Api.h"
+#include "stablehlo/reference/Configuration.h"
+#include "stablehlo/reference/Process.h"
+#include "stablehlo/reference/Scope.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Value.h"
+#include "stablehlo/tests/CheckOps.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Skips the ops of the check dialect and `check.*` custom calls, which
+// interpret tests use to verify their results, so that end-to-end benchmarks
+// measure the evaluation of a test rather than its checks.
+class SkipChecksFallback : public InterpreterFallback {
+ public:
+  llvm::Error operator()(Operation &op, Scope &scope,
+                         Process *process) final {
+    if (isa_and_nonnull<check::CheckDialect>(op.getDialect()))
+      return llvm::Error::success();
+    if (auto customCall = dyn_cast<CustomCallOp>(op))
+      if (customCall.getCallTargetName().starts_with("check."))
+        return llvm::Error::success();
+    return InterpreterFallback::operator()(op, scope, process);
+  }
+};
+
+// A module which is prepared once and evaluated on every benchmark iteration.
+struct Program {
+  MLIRContext context;
+  OwningOpRef<ModuleOp> module;
+  InterpreterConfiguration config;
+  std::unique_ptr<InterpreterExecutable> executable;
+  SmallVector<InterpreterValue> inputs;
+};
+
+// Returns a tensor of `type` with pseudo-random elements, which are in [-1, 1)
+// for floats and in [0, indexBound) for integers, so that integer inputs can
+// serve as indices.
+Tensor makeInput(ShapedType type, int64_t indexBound, std::mt19937 &generator) {
+  auto elementType = type.getElementType();
+  if (auto floatType = dyn_cast<FloatType>(elementType)) {
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    SmallVector<APFloat> elements;
+    elements.reserve(type.getNumElements());
+    for (int64_t i = 0; i < type.getNumElements(); ++i) {
+      APFloat element(distribution(generator));
+      bool losesInfo;
+      element.convert(floatType.getFloatSemantics(),
+                      APFloat::rmNearestTiesToEven, &losesInfo);
+      elements.push_back(element);
+    }
+    return makeTensor(DenseElementsAttr::get(type, elements));
+  }
+  if (auto integerType = dyn_cast<IntegerType>(elementType)) {
+    std::uniform_int_distribution<int64_t> distribution(0, indexBound - 1);
+    SmallVector<APInt> elements;
+    elements.reserve(type.getNumElements());
+    for (int64_t i = 0; i < type.getNumElements(); ++i)
+      elements.emplace_back(integerType.getWidth(), distribution(generator),
+                            /*isSigned=*/true);
+    return makeTensor(DenseElementsAttr::get(type, elements));
+  }
+  llvm::report_fatal_error("Unsupported benchmark input element type");
+}
+
+// Parses `source` and prepares its function `mainFunction` for evaluation
+// with inputs from `makeInput`. Returns nullptr and reports the error to
+// `state` on failure.
+std::unique_ptr<Program> prepareProgram(benchmark::State &state,
+                                        const std::string &source,
+                                        StringRef mainFunction = "main",
+                                        int64_t indexBound = 1) {
+  auto program = std::make_unique<Program>();
+  program->context.loadDialect<check::CheckDialect>();
+  auto module = parseStablehloModule(source, program->context);
+  if (failed(module)) {
+    state.SkipWithError("Failed to parse the program");
+    return nullptr;
+  }
+  program->module = std::move(*module);
+
+  program->config.mainFunction = mainFunction.str();
+  program->config.fallback = std::make_unique<SkipChecksFallback>();
+  auto executable =
+      InterpreterExecutable::create(*program->module, program->config);
+  if (failed(executable)) {
+    state.SkipWithError("Failed to prepare the program");
+    return nullptr;
+  }
+  program->executable = std::move(*executable);
+
+  std::mt19937 generator(/*seed=*/42);
+  auto func = program->module->lookupSymbol<func::FuncOp>(mainFunction);
+  for (Type type : func.getArgumentTypes())
+    program->inputs.push_back(
+        makeInput(cast<ShapedType>(type), indexBound, generator));
+  return program;
+}
+
+// Evaluates `source` on every iteration and reports `itemsPerEvaluation`
+// items, e.g. elements or multiply-adds, per evaluation.
+void benchmarkProgram(benchmark::State &state, const std::string &source,
+                      int64_t itemsPerEvaluation, int64_t indexBound = 1) {
+  auto program = prepareProgram(state, source, "main", indexBound);
+  if (!program) return;
+
+  for (auto _ : state) {
+    auto results = program->executable->evaluate(program->inputs);
+    if (failed(results)) {
+      state.SkipWithError("Failed to evaluate the program");
+      return;
+    }
+    benchmark::DoNotOptimize(results);
+  }
+  state.SetItemsProcessed(state.iterations() * itemsPerEvaluation);
+}
+
+// `op` of two tensors with `state.range(0)` elements of `elementType`.
+void benchmarkBinary(benchmark::State &state, StringRef op,
+                     StringRef elementType) {
+  int64_t size = state.range(0);
+  auto source = llvm::formatv(R"mlir(
+func.func @main(%lhs: tensor<{0}x{1}>, %rhs: tensor<{0}x{1}>) -> tensor<{0}x{1}> {{
+  %result = {2} %lhs, %rhs : tensor<{0}x{1}>
+  func.return %result : tensor<{0}x{1}>
+})mlir",
+                              size, elementType, op);
+  benchmarkProgram(state, source.str(), size);
+}
+
+// `op` of a tensor with `state.range(0)` elements of `elementType`.
+void benchmarkUnary(benchmark::State &state, StringRef op,
+                    StringRef elementType) {
+  int64_t size = state.range(0);
+  auto source = llvm::formatv(R"mlir(
+func.func @main(%operand: tensor<{0}x{1}>) -> tensor<{0}x{1}> {{
+  %result = {2} %operand : tensor<{0}x{1}>
+  func.return %result : tensor<{0}x{1}>
+})mlir",
+                              size, elementType, op);
+  benchmarkProgram(state, source.str(), size);
+}
+
+// Multiplication of two square f32 matrices of size `state.range(0)`.
+void benchmarkDotGeneral(benchmark::State &state) {
+  int64_t size = state.range(0);
+  auto source = llvm::formatv(R"mlir(
+func.func @main(%lhs: tensor<{0}x{0}xf32>, %rhs: tensor<{0}x{0}xf32>) -> tensor<{0}x{0}xf32> {{
+  %result = stablehlo.dot_general %lhs, %rhs, contracting_dims = [1] x [0]
+    : (tensor<{0}x{0}xf32>, tensor<{0}x{0}xf32>) -> tensor<{0}x{0}xf32>
+  func.return %result : tensor<{0}x{0}xf32>
+})mlir",
+                              size);
+  benchmarkProgram(state, source.str(), size * size * size);
+}
+
+// 3x3 convolution with 16 input and output features of an f32 image of size
+// `state.range(0)`.
+void benchmarkConvolution(benchmark::State &state) {
+  int64_t size = state.range(0);
+  auto source = llvm::formatv(R"mlir(
+func.func @main(%lhs: tensor<1x{0}x{0}x16xf32>, %rhs: tensor<3x3x16x16xf32>) -> tensor<1x{0}x{0}x16xf32> {{
+  %result = stablehlo.convolution(%lhs, %rhs)
+    dim_numbers = [b, 0, 1, f]x[0, 1, i, o]->[b, 0, 1, f],
+    window = {{stride = [1, 1], pad = [[1, 1], [1, 1]]}
+    {{batch_group_count = 1 : i64, feature_group_count = 1 : i64}
+    : (tensor<1x{0}x{0}x16xf32>, tensor<3x3x16x16xf32>) -> tensor<1x{0}x{0}x16xf32>
+  func.return %result : tensor<1x{0}x{0}x16xf32>
+})mlir",
+                              size);
+  benchmarkProgram(state, source.str(), size * size * 3 * 3 * 16 * 16);
+}
+
+// Sums of the rows of `state.range(0)` x 1024 f32 elements.
+void benchmarkReduce(benchmark::State &state) {
+  int64_t size = state.range(0);
+  auto source = llvm::formatv(R"mlir(
+func.func @main(%input: tensor<{0}x1024xf32>) -> tensor<{0}xf32> {{
+  %init = stablehlo.constant dense<0.0> : tensor<f32>
+  %result = "stablehlo.reduce"(%input, %init) ({{
+    ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+      %sum = stablehlo.add %lhs, %rhs : tensor<f32>
+      stablehlo.return %sum : tensor<f32>
+  }) {{dimensions = array<i64: 1>} : (tensor<{0}x1024xf32>, tensor<f32>) -> tensor<{0}xf32>
+  func.return %result : tensor<{0}xf32>
+})mlir",
+                              size);
+  benchmarkProgram(state, source.str(), size * 1024);
+}
+
+// Sort of `state.range(0)` f32 elements.
+void benchmarkSort(benchmark::State &state) {
+  int64_t size = state.range(0);
+  auto source = llvm::formatv(R"mlir(
+func.func @main(%input: tensor<{0}xf32>) -> tensor<{0}xf32> {{
+  %result = "stablehlo.sort"(%input) ({{
+    ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+      %less = stablehlo.compare LT, %lhs, %rhs : (tensor<f32>, tensor<f32>) -> tensor<i1>
+      stablehlo.return %less : tensor<i1>
+  }) {{dimension = 0 : i64, is_stable = true} : (tensor<{0}xf32>) -> tensor<{0}xf32>
+  func.return %result : tensor<{0}xf32>
+})mlir",
+                              size);
+  benchmarkProgram(state, source.str(), size);
+}
+
+// Lookup of `state.range(0)` rows of an embedding table of 1024 x 128 f32
+// elements.
+void benchmarkGather(benchmark::State &state) {
+  int64_t size = state.range(0);
+  auto source = llvm::formatv(R"mlir(
+func.func @main(%operand: tensor<1024x128xf32>, %indices: tensor<{0}x1xi64>) -> tensor<{0}x128xf32> {{
+  %result = "stablehlo.gather"(%operand, %indices) {{
+    dimension_numbers = #stablehlo.gather<
+      offset_dims = [1],
+      collapsed_slice_dims = [0],
+      start_index_map = [0],
+      index_vector_dim = 1>,
+    slice_sizes = array<i64: 1, 128>,
+    indices_are_sorted = false
+  } : (tensor<1024x128xf32>, tensor<{0}x1xi64>) -> tensor<{0}x128xf32>
+  func.return %result : tensor<{0}x128xf32>
+})mlir",
+                              size);
+  benchmarkProgram(state, source.str(), size * 128, /*indexBound=*/1024);
+}
+
+// Accumulation of `state.range(0)` rows of 128 f32 elements into a table of
+// 1024 rows.
+void benchmarkScatter(benchmark::State &state) {
+  int64_t size = state.range(0);
+  auto source = llvm::formatv(R"mlir(
+func.func @main(%operand: tensor<1024x128xf32>, %indices: tensor<{0}x1xi64>, %updates: tensor<{0}x128xf32>) -> tensor<1024x128xf32> {{
+  %result = "stablehlo.scatter"(%operand, %indices, %updates) ({{
+    ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+      %sum = stablehlo.add %lhs, %rhs : tensor<f32>
+      stablehlo.return %sum : tensor<f32>
+  }) {{
+    scatter_dimension_numbers = #stablehlo.scatter<
+      update_window_dims = [1],
+      inserted_window_dims = [0],
+      scatter_dims_to_operand_dims = [0],
+      index_vector_dim = 1>,
+    indices_are_sorted = false,
+    unique_indices = false
+  } : (tensor<1024x128xf32>, tensor<{0}x1xi64>, tensor<{0}x128xf32>) -> tensor<1024x128xf32>
+  func.return %result : tensor<1024x128xf32>
+})mlir",
+                              size);
+  benchmarkProgram(state, source.str(), size * 128, /*indexBound=*/1024);
+}
+
+// `while` loop of `state.range(0)` iterations which only increment a counter,
+// i.e. the overhead of evaluating a region per iteration.
+void benchmarkWhile(benchmark::State &state) {
+  int64_t size = state.range(0);
+  auto source = llvm::formatv(R"mlir(
+func.func @main() -> tensor<i64> {{
+  %zero = stablehlo.constant dense<0> : tensor<i64>
+  %one = stablehlo.constant dense<1> : tensor<i64>
+  %limit = stablehlo.constant dense<{0}> : tensor<i64>
+  %result = stablehlo.while(%i = %zero) : tensor<i64>
+  cond {{
+    %less = stablehlo.compare LT, %i, %limit : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %less : tensor<i1>
+  } do {{
+    %next = stablehlo.add %i, %one : tensor<i64>
+    stablehlo.return %next : tensor<i64>
+  }
+  func.return %result : tensor<i64>
+})mlir",
+                              size);
+  benchmarkProgram(state, source.str(), size);
+}
+
+BENCHMARK_CAPTURE(benchmarkBinary, add_f32, "stablehlo.add", "f32")
+    ->RangeMultiplier(32)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK_CAPTURE(benchmarkBinary, add_bf16, "stablehlo.add", "bf16")
+    ->RangeMultiplier(32)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK_CAPTURE(benchmarkBinary, multiply_f32, "stablehlo.multiply", "f32")
+    ->RangeMultiplier(32)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK_CAPTURE(benchmarkUnary, exponential_f32, "stablehlo.exponential",
+                  "f32")
+    ->RangeMultiplier(32)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK_CAPTURE(benchmarkUnary, exponential_bf16, "stablehlo.exponential",
+                  "bf16")
+    ->RangeMultiplier(32)
+    ->Range(1 << 10, 1 << 20);
+BENCHMARK(benchmarkDotGeneral)->RangeMultiplier(4)->Range(16, 256);
+BENCHMARK(benchmarkConvolution)->RangeMultiplier(4)->Range(8, 128);
+BENCHMARK(benchmarkReduce)->RangeMultiplier(8)->Range(1, 1 << 9);
+BENCHMARK(benchmarkSort)->RangeMultiplier(8)->Range(1 << 6, 1 << 15);
+BENCHMARK(benchmarkGather)->RangeMultiplier(8)->Range(1 << 6, 1 << 12);
+BENCHMARK(benchmarkScatter)->RangeMultiplier(8)->Range(1 << 6, 1 << 12);
+BENCHMARK(benchmarkWhile)->RangeMultiplier(10)->Range(10, 10000);
+
+// Registers a benchmark `e2e/<file>/<function>` for every function without
+// arguments in the MLIR file `filename`. Returns false if it can't be parsed.
+bool registerEndToEndBenchmarks(StringRef filename) {
+  auto buffer = llvm::MemoryBuffer::getFile(filename);
+  if (!buffer) return false;
+  std::string source = (*buffer)->getBuffer().str();
+
+  MLIRContext context;
+  context.loadDialect<check::CheckDialect>();
+  auto module = parseStablehloModule(source, context);
+  if (failed(module)) return false;
+
+  auto basename = llvm::sys::path::filename(filename);
+  for (auto func : (**module).getOps<func::FuncOp>()) {
+    if (func.getNumArguments() != 0) continue;
+    std::string name = func.getSymName().str();
+    benchmark::RegisterBenchmark(
+        ("e2e/" + basename + "/" + name).str().c_str(),
+        [source, name](benchmark::State &state) {
+          auto program = prepareProgram(state, source, name);
+          if (!program) return;
+          for (auto _ : state) {
+            auto results = program->executable->evaluate({});
+            if (failed(results)) {
+              state.SkipWithError("Failed to evaluate the program");
+              return;
+            }
+            benchmark::DoNotOptimize(results);
+          }
+        });
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
+
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  for (int i = 1; i < argc; ++i) {
+    if (!mlir::stablehlo::registerEndToEndBenchmarks(argv[i])) {
+      llvm::errs() << "Failed to parse " << argv[i] << "\n";
+      return 1;
+    }
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
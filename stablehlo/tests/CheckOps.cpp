@@ -15,16 +15,26 @@ limitations under the License.
 
 #include "stablehlo/tests/CheckOps.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <type_traits>
 
 #define GET_OP_CLASSES
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/Support/DebugStringHelper.h"
 #include "stablehlo/dialect/Base.h"
 #include "stablehlo/reference/Errors.h"
+#include "stablehlo/reference/Index.h"
 #include "stablehlo/reference/NumPy.h"
 #include "stablehlo/reference/Tensor.h"
 #include "stablehlo/tests/CheckOps.cpp.inc"
@@ -47,6 +57,197 @@ llvm::ErrorOr<SerializedTensorMetadata> extractMetadata(StringRef line) {
 
   return std::make_pair(/*type=*/fields[1].str(), /*path=*/fields[2].str());
 }
+
+// Number of consecutive elements whose differences are summarized together,
+// in loops without early exits which compilers vectorize. The worst elements
+// are searched for only in blocks which contain a new worst element.
+constexpr int64_t kBlockSize = 1024;
+
+// Summary of the differences between the elements of an actual and an
+// expected tensor, computed in one pass over both.
+struct Comparison {
+  int64_t numElements = 0;
+  int64_t numMismatches = 0;
+  int64_t firstMismatch = -1;
+  // Whether the errors below were computed, i.e. for floating-point elements.
+  bool hasErrors = false;
+  // The largest absolute error, relative error and distance in units in the
+  // last place between finite elements, and the first linear indices at which
+  // they occur.
+  double maxAbsError = 0.0;
+  int64_t maxAbsErrorIndex = -1;
+  double maxRelError = 0.0;
+  int64_t maxRelErrorIndex = -1;
+  uint64_t maxUlpDistance = 0;
+  int64_t maxUlpDistanceIndex = -1;
+};
+
+// Errors between an actual and an expected element, which are zero unless
+// both are finite.
+struct ElementErrors {
+  double absError;
+  double relError;
+  uint64_t ulpDistance;
+};
+
+// Returns the bits of `value` as an integer which is ordered like the
+// floating-point values, so that adjacent values differ by 1.
+template <typename T>
+int64_t getOrderedBits(T value) {
+  using Bits = std::conditional_t<sizeof(T) == 4, int32_t, int64_t>;
+  Bits bits;
+  std::memcpy(&bits, &value, sizeof(T));
+  return bits < 0 ? std::numeric_limits<Bits>::min() - bits : bits;
+}
+
+template <typename T>
+ElementErrors getErrors(T actual, T expected) {
+  if (!std::isfinite(actual) || !std::isfinite(expected)) return {0, 0, 0};
+  double absError = std::fabs(static_cast<double>(actual) - expected);
+  double relError = expected != 0 ? absError / std::fabs(expected) : 0.0;
+  int64_t actualBits = getOrderedBits(actual);
+  int64_t expectedBits = getOrderedBits(expected);
+  uint64_t ulpDistance =
+      actualBits > expectedBits
+          ? static_cast<uint64_t>(actualBits) - expectedBits
+          : static_cast<uint64_t>(expectedBits) - actualBits;
+  return {absError, relError, ulpDistance};
+}
+
+// Like `areApproximatelyEqual` for `Element`: NaNs match each other, and
+// other elements match if they are equal, or have the same sign and differ
+// by at most 0.0001.
+template <typename T>
+bool isAlmostEqual(T actual, T expected) {
+  if (actual == expected) return true;
+  if (std::isnan(actual) || std::isnan(expected))
+    return std::isnan(actual) && std::isnan(expected);
+  return std::signbit(actual) == std::signbit(expected) &&
+         std::fabs(static_cast<double>(actual) - expected) <= 0.0001;
+}
+
+// Compares `actual` with `expected` block by block, counting the elements
+// for which `isMatch(actual, expected)` is false and, for floating-point
+// elements, tracking the largest errors.
+template <typename T, typename IsMatch>
+Comparison compare(ArrayRef<T> actual, ArrayRef<T> expected, IsMatch isMatch) {
+  Comparison comparison;
+  comparison.numElements = actual.size();
+  comparison.hasErrors = std::is_floating_point_v<T>;
+  for (int64_t begin = 0, e = actual.size(); begin < e; begin += kBlockSize) {
+    int64_t end = std::min(begin + kBlockSize, e);
+    int64_t numMismatches = 0;
+    for (int64_t i = begin; i < end; ++i)
+      numMismatches += !isMatch(actual[i], expected[i]);
+    if (numMismatches != 0 && comparison.firstMismatch < 0)
+      for (int64_t i = begin; comparison.firstMismatch < 0; ++i)
+        if (!isMatch(actual[i], expected[i])) comparison.firstMismatch = i;
+    comparison.numMismatches += numMismatches;
+
+    if constexpr (std::is_floating_point_v<T>) {
+      ElementErrors blockErrors{0, 0, 0};
+      for (int64_t i = begin; i < end; ++i) {
+        auto errors = getErrors(actual[i], expected[i]);
+        blockErrors.absError = std::max(blockErrors.absError, errors.absError);
+        blockErrors.relError = std::max(blockErrors.relError, errors.relError);
+        blockErrors.ulpDistance =
+            std::max(blockErrors.ulpDistance, errors.ulpDistance);
+      }
+      if (blockErrors.absError <= comparison.maxAbsError &&
+          blockErrors.relError <= comparison.maxRelError &&
+          blockErrors.ulpDistance <= comparison.maxUlpDistance)
+        continue;
+      for (int64_t i = begin; i < end; ++i) {
+        auto errors = getErrors(actual[i], expected[i]);
+        if (errors.absError > comparison.maxAbsError) {
+          comparison.maxAbsError = errors.absError;
+          comparison.maxAbsErrorIndex = i;
+        }
+        if (errors.relError > comparison.maxRelError) {
+          comparison.maxRelError = errors.relError;
+          comparison.maxRelErrorIndex = i;
+        }
+        if (errors.ulpDistance > comparison.maxUlpDistance) {
+          comparison.maxUlpDistance = errors.ulpDistance;
+          comparison.maxUlpDistanceIndex = i;
+        }
+      }
+    }
+  }
+  return comparison;
+}
+
+// Compares the elements of `actual` and `expected` in their native types, if
+// they have the same type of a native element type, see
+// `dispatchOnNativeType`. Elements match if they are approximately equal for
+// `isApproximate`, which requires floating-point elements, and if they are
+// equal otherwise.
+std::optional<Comparison> compareNative(const Tensor &actual,
+                                        const Tensor &expected,
+                                        bool isApproximate) {
+  if (actual.getType() != expected.getType()) return std::nullopt;
+  std::optional<Comparison> comparison;
+  dispatchOnNativeType(actual.getElementType(), [&](auto value) {
+    using T = decltype(value);
+    auto actualData = actual.getData<T>();
+    auto expectedData = expected.getData<T>();
+    if constexpr (std::is_floating_point_v<T>) {
+      if (isApproximate)
+        comparison = compare(actualData, expectedData, isAlmostEqual<T>);
+      else
+        comparison = compare(actualData, expectedData,
+                             [](T lhs, T rhs) { return lhs == rhs; });
+    } else if (!isApproximate) {
+      comparison = compare(actualData, expectedData,
+                           [](T lhs, T rhs) { return lhs == rhs; });
+    }
+  });
+  return comparison;
+}
+
+// Returns the index of the element at `linearIndex` in canonical order of
+// tensors of `shape`.
+Index getIndex(const Sizes &shape, int64_t linearIndex) {
+  Index index(shape.size());
+  for (int64_t d = shape.size() - 1; d >= 0; --d) {
+    index[d] = linearIndex % shape[d];
+    linearIndex /= shape[d];
+  }
+  return index;
+}
+
+// Returns an error which describes the first mismatch of `comparison` of
+// `actual` with `expected` like the element-wise checks, followed by a
+// summary of all mismatches and of the worst errors, if any elements don't
+// match.
+llvm::Error getComparisonError(const Tensor &actual, const Tensor &expected,
+                               const Comparison &comparison) {
+  if (comparison.numMismatches == 0) return llvm::Error::success();
+
+  auto shape = actual.getShape();
+  auto first = getIndex(shape, comparison.firstMismatch);
+  std::string message;
+  llvm::raw_string_ostream os(message);
+  os << "Element values don't match: " << debugString(actual.get(first))
+     << " (actual) vs " << debugString(expected.get(first))
+     << " (expected) at index " << debugString(first) << "\n"
+     << comparison.numMismatches << " of " << comparison.numElements
+     << " elements don't match";
+  if (comparison.hasErrors) {
+    auto printError = [&](StringRef name, auto error, int64_t index) {
+      os << ", max " << name << " " << error;
+      if (index >= 0) os << " at index " << debugString(getIndex(shape, index));
+    };
+    printError("absolute error", comparison.maxAbsError,
+               comparison.maxAbsErrorIndex);
+    printError("relative error", comparison.maxRelError,
+               comparison.maxRelErrorIndex);
+    printError("ULP distance", comparison.maxUlpDistance,
+               comparison.maxUlpDistanceIndex);
+  }
+  os << "\n";
+  return invalidArgument("%s", message.c_str());
+}
 }  // namespace
 
 //===----------------------------------------------------------------------===//
@@ -62,11 +263,14 @@ CheckDialect::CheckDialect(MLIRContext *context)
 }
 
 llvm::Error evalExpectAlmostEqConstOp(const Tensor &lhs, ElementsAttr value) {
-  auto rhs = makeTensor(cast<DenseElementsAttr>(value));
+  auto rhs = makeTensorView(cast<DenseElementsAttr>(value));
   return evalExpectAlmostEqOp(lhs, rhs);
 }
 
 llvm::Error evalExpectAlmostEqOp(const Tensor &lhs, const Tensor &rhs) {
+  if (auto comparison = compareNative(lhs, rhs, /*isApproximate=*/true))
+    return getComparisonError(lhs, rhs, *comparison);
+
   for (auto lhsIt = lhs.index_begin(), rhsIt = rhs.index_begin();
        lhsIt != lhs.index_end(); ++lhsIt, ++rhsIt)
     if (!areApproximatelyEqual(lhs.get(*lhsIt), rhs.get(*rhsIt))
@@ -81,11 +285,14 @@ llvm::Error evalExpectAlmostEqOp(const Tensor &lhs, const Tensor &rhs) {
 }
 
 llvm::Error evalExpectEqConstOp(const Tensor &lhs, ElementsAttr value) {
-  auto rhs = makeTensor(cast<DenseElementsAttr>(value));
+  auto rhs = makeTensorView(cast<DenseElementsAttr>(value));
   return evalExpectEqOp(lhs, rhs);
 }
 
 llvm::Error evalExpectEqOp(const Tensor &lhs, const Tensor &rhs) {
+  if (auto comparison = compareNative(lhs, rhs, /*isApproximate=*/false))
+    return getComparisonError(lhs, rhs, *comparison);
+
   for (auto lhsIt = lhs.index_begin(), rhsIt = rhs.index_begin();
        lhsIt != lhs.index_end(); ++lhsIt, ++rhsIt)
     if ((lhs.get(*lhsIt) != rhs.get(*rhsIt)).getBooleanValue())
@@ -138,7 +345,17 @@ llvm::Error evalExpectSerializedEqOp(const Tensor &expected, StringRef probeId,
   const std::string type = serializedMetadata->first;
   const std::string serializedPath = serializedMetadata->second;
 
-  auto tensor = numpy::deserializeTensor(serializedPath, expected.getType());
+  // Probes which were written to a container have the path `container:offset`.
+  llvm::ErrorOr<Tensor> tensor = llvm::errc::invalid_argument;
+  auto [containerPath, offset] = StringRef(serializedPath).rsplit(':');
+  uint64_t containerOffset;
+  if (llvm::sys::path::filename(containerPath) ==
+          numpy::kProbeContainerFilename &&
+      !offset.getAsInteger(10, containerOffset))
+    tensor = numpy::deserializeTensorFromContainer(
+        containerPath, containerOffset, expected.getType());
+  else
+    tensor = numpy::deserializeTensor(serializedPath, expected.getType());
 
   if (!tensor)
     return llvm::createStringError(tensor.getError(),
@@ -0,0 +1,136 @@
+/* Copyright 2024 The StableHLO Authors.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// RUN: stablehlo-capi-interpreter-test 2>&1 | FileCheck %s
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mlir-c/BuiltinTypes.h"
+#include "mlir-c/Dialect/Func.h"
+#include "mlir-c/IR.h"
+#include "mlir-c/Support.h"
+#include "stablehlo/integrations/c/StablehloDialect.h"
+#include "stablehlo/integrations/c/StablehloInterpreter.h"
+
+static const char *kModule =
+    "func.func @main(%arg0: tensor<2x2xf32>, %arg1: tensor<2x2xf32>)\n"
+    "    -> (tensor<2x2xf32>, tensor<i32>) {\n"
+    "  %0 = stablehlo.add %arg0, %arg1 : tensor<2x2xf32>\n"
+    "  %1 = stablehlo.constant dense<42> : tensor<i32>\n"
+    "  func.return %0, %1 : tensor<2x2xf32>, tensor<i32>\n"
+    "}\n";
+
+static void printShape(const StablehloInterpreterBuffer *buffer) {
+  fprintf(stderr, "shape: [");
+  for (intptr_t i = 0; i < buffer->rank; ++i)
+    fprintf(stderr, "%s%lld", i ? ", " : "", (long long)buffer->shape[i]);
+  fprintf(stderr, "]\n");
+}
+
+static int testEvaluate(MlirModule module) {
+  fprintf(stderr, "@testEvaluate\n");
+  // CHECK-LABEL: @testEvaluate
+  MlirContext ctx = mlirModuleGetContext(module);
+  StablehloInterpreterExecutable executable =
+      stablehloInterpreterExecutableCreate(
+          module, mlirStringRefCreateFromCString("main"));
+  if (stablehloInterpreterExecutableIsNull(executable)) return 1;
+
+  const float lhs[] = {1.0f, 2.0f, 3.0f, 4.0f};
+  const float rhs[] = {10.0f, 20.0f, 30.0f, 40.0f};
+  const int64_t shape[] = {2, 2};
+  const StablehloInterpreterBuffer inputs[] = {
+      {lhs, shape, 2, mlirF32TypeGet(ctx)},
+      {rhs, shape, 2, mlirF32TypeGet(ctx)},
+  };
+
+  StablehloInterpreterResults results =
+      stablehloInterpreterExecutableEvaluate(executable, 2, inputs);
+  if (stablehloInterpreterResultsIsNull(results)) return 2;
+
+  intptr_t numResults = stablehloInterpreterResultsGetNumResults(results);
+  fprintf(stderr, "num results: %ld\n", (long)numResults);
+  // CHECK: num results: 2
+
+  StablehloInterpreterBuffer sum;
+  if (!stablehloInterpreterResultsGetBuffer(results, 0, &sum) ||
+      !mlirTypeEqual(sum.elementType, mlirF32TypeGet(ctx)))
+    return 3;
+  printShape(&sum);
+  // CHECK: shape: [2, 2]
+  const float *sumData = (const float *)sum.data;
+  fprintf(stderr, "sum: %g %g %g %g\n", sumData[0], sumData[1], sumData[2],
+          sumData[3]);
+  // CHECK: sum: 11 22 33 44
+
+  StablehloInterpreterBuffer constant;
+  if (!stablehloInterpreterResultsGetBuffer(results, 1, &constant) ||
+      !mlirTypeEqual(constant.elementType,
+                     mlirIntegerTypeGet(ctx, /*bitwidth=*/32)))
+    return 4;
+  printShape(&constant);
+  // CHECK: shape: []
+  fprintf(stderr, "constant: %d\n", *(const int32_t *)constant.data);
+  // CHECK: constant: 42
+
+  // Results stay valid after the executable is destroyed.
+  stablehloInterpreterExecutableDestroy(executable);
+  fprintf(stderr, "sum after destroy: %g\n", sumData[3]);
+  // CHECK: sum after destroy: 44
+  stablehloInterpreterResultsDestroy(results);
+  return 0;
+}
+
+static int testErrors(MlirModule module) {
+  fprintf(stderr, "@testErrors\n");
+  // CHECK-LABEL: @testErrors
+
+  StablehloInterpreterExecutable missing =
+      stablehloInterpreterExecutableCreate(
+          module, mlirStringRefCreateFromCString("missing"));
+  // CHECK: error: module must have entry func with name missing
+  if (!stablehloInterpreterExecutableIsNull(missing)) return 1;
+
+  StablehloInterpreterExecutable executable =
+      stablehloInterpreterExecutableCreate(
+          module, mlirStringRefCreateFromCString("main"));
+  if (stablehloInterpreterExecutableIsNull(executable)) return 2;
+  StablehloInterpreterResults results =
+      stablehloInterpreterExecutableEvaluate(executable, 0, NULL);
+  // CHECK: error: incorrect number of arguments specified
+  if (!stablehloInterpreterResultsIsNull(results)) return 3;
+  stablehloInterpreterExecutableDestroy(executable);
+
+  fprintf(stderr, "errors reported\n");
+  // CHECK: errors reported
+  return 0;
+}
+
+int main(void) {
+  MlirContext ctx = mlirContextCreate();
+  mlirDialectHandleLoadDialect(mlirGetDialectHandle__func__(), ctx);
+  mlirDialectHandleLoadDialect(mlirGetDialectHandle__stablehlo__(), ctx);
+  MlirModule module =
+      mlirModuleCreateParse(ctx, mlirStringRefCreateFromCString(kModule));
+  if (mlirModuleIsNull(module)) return 1;
+
+  int status = testEvaluate(module);
+  if (status) return status;
+  status = testErrors(module);
+  if (status) return 10 + status;
+
+  mlirModuleDestroy(module);
+  mlirContextDestroy(ctx);
+  return 0;
+}
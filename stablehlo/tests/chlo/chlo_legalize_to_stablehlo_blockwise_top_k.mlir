@@ -0,0 +1,41 @@
+// RUN: stablehlo-opt --chlo-legalize-to-stablehlo=top-k-block-size=16 --split-input-file --verify-diagnostics %s | FileCheck %s
+
+// CHECK-LABEL: @top_k
+// CHECK-SAME: (%[[ARG:.*]]: tensor<2x100xf32>)
+func.func @top_k(%arg : tensor<2x100xf32>) -> (tensor<2x4xf32>, tensor<2x4xi32>) {
+  // CHECK-DAG:  %[[IOTA:.*]] = stablehlo.iota dim = 1 : tensor<2x100xi32>
+  // CHECK-DAG:  %[[LOWEST:.*]] = stablehlo.constant dense<0xFFFFFFFF> : tensor<f32>
+  // CHECK-DAG:  %[[ZERO:.*]] = stablehlo.constant dense<0> : tensor<i32>
+  // CHECK:      %[[PAD_VAL:.*]] = stablehlo.pad %[[ARG]], %[[LOWEST]], low = [0, 0], high = [0, 12], interior = [0, 0]
+  // CHECK-NEXT: %[[PAD_IDX:.*]] = stablehlo.pad %[[IOTA]], %[[ZERO]], low = [0, 0], high = [0, 12], interior = [0, 0]
+  // CHECK-NEXT: %[[BLOCK_VAL:.*]] = stablehlo.reshape %[[PAD_VAL]] : (tensor<2x112xf32>) -> tensor<2x7x16xf32>
+  // CHECK-NEXT: %[[BLOCK_IDX:.*]] = stablehlo.reshape %[[PAD_IDX]] : (tensor<2x112xi32>) -> tensor<2x7x16xi32>
+  // CHECK-NEXT: %[[SORT:.*]]:2 = "stablehlo.sort"(%[[BLOCK_VAL]], %[[BLOCK_IDX]]) <{dimension = 2 : i64, is_stable = true}>
+  // CHECK:      stablehlo.slice %[[SORT]]#0 [0:2, 0:7, 0:4] : (tensor<2x7x16xf32>) -> tensor<2x7x4xf32>
+  // CHECK-NEXT: stablehlo.slice %[[SORT]]#1 [0:2, 0:7, 0:4] : (tensor<2x7x16xi32>) -> tensor<2x7x4xi32>
+  // CHECK-NEXT: stablehlo.reshape {{.*}} : (tensor<2x7x4xf32>) -> tensor<2x28xf32>
+  // CHECK-NEXT: stablehlo.reshape {{.*}} : (tensor<2x7x4xi32>) -> tensor<2x28xi32>
+  // CHECK:      stablehlo.reshape {{.*}} : (tensor<2x32xf32>) -> tensor<2x2x16xf32>
+  // CHECK:      stablehlo.reshape {{.*}} : (tensor<2x2x4xf32>) -> tensor<2x8xf32>
+  // CHECK-NEXT: stablehlo.reshape {{.*}} : (tensor<2x2x4xi32>) -> tensor<2x8xi32>
+  // CHECK-NEXT: %[[FINAL:.*]]:2 = "stablehlo.sort"
+  // CHECK:      %[[VAL:.*]] = stablehlo.slice %[[FINAL]]#0 [0:2, 0:4] : (tensor<2x8xf32>) -> tensor<2x4xf32>
+  // CHECK-NEXT: %[[IDX:.*]] = stablehlo.slice %[[FINAL]]#1 [0:2, 0:4] : (tensor<2x8xi32>) -> tensor<2x4xi32>
+  // CHECK-NEXT: return %[[VAL]], %[[IDX]]
+  %1:2 = chlo.top_k(%arg, k=4) : tensor<2x100xf32> -> (tensor<2x4xf32>, tensor<2x4xi32>)
+  func.return %1#0, %1#1 : tensor<2x4xf32>, tensor<2x4xi32>
+}
+
+// -----
+
+// Blocks must have at least twice k elements, so this sorts the whole last
+// dimension.
+// CHECK-LABEL: @top_k_large_k
+func.func @top_k_large_k(%arg : tensor<100xi32>) -> (tensor<10xi32>, tensor<10xi32>) {
+  // CHECK-NOT: stablehlo.pad
+  // CHECK: "stablehlo.sort"
+  // CHECK-NOT: "stablehlo.sort"
+  // CHECK: return
+  %1:2 = chlo.top_k(%arg, k=10) : tensor<100xi32> -> (tensor<10xi32>, tensor<10xi32>)
+  func.return %1#0, %1#1 : tensor<10xi32>, tensor<10xi32>
+}
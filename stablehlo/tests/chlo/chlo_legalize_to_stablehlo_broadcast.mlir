@@ -33,6 +33,44 @@ func.func @dynamicBroadcast(%arg0: tensor<?xf32>, %arg1: tensor<?x?xf32>) -> ten
 
 // -----
 
+// CHECK-LABEL: @staticBroadcast
+func.func @staticBroadcast(%arg0: tensor<4xf32>, %arg1: tensor<3x1xf32>) -> tensor<3x4xf32> {
+  // CHECK-NOT: shape.
+  // CHECK-DAG: %[[ARG0_B:.+]] = stablehlo.broadcast_in_dim %arg0, dims = [1] : (tensor<4xf32>) -> tensor<3x4xf32>
+  // CHECK-DAG: %[[ARG1_B:.+]] = stablehlo.broadcast_in_dim %arg1, dims = [0, 1] : (tensor<3x1xf32>) -> tensor<3x4xf32>
+  // CHECK-NEXT: %[[RESULT:.+]] = stablehlo.add %[[ARG0_B]], %[[ARG1_B]]
+  // CHECK-NEXT: return %[[RESULT]]
+  %0 = chlo.broadcast_add %arg0, %arg1 : (tensor<4xf32>, tensor<3x1xf32>) -> tensor<3x4xf32>
+  func.return %0 : tensor<3x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: @staticBroadcastDimensions
+func.func @staticBroadcastDimensions(%arg0: tensor<3x4xf32>, %arg1: tensor<3xf32>) -> tensor<3x4xf32> {
+  // CHECK-NOT: shape.
+  // CHECK: %[[ARG1_B:.+]] = stablehlo.broadcast_in_dim %arg1, dims = [0] : (tensor<3xf32>) -> tensor<3x4xf32>
+  // CHECK-NEXT: stablehlo.add %arg0, %[[ARG1_B]]
+  %0 = chlo.broadcast_add %arg0, %arg1 {broadcast_dimensions = array<i64: 0>} : (tensor<3x4xf32>, tensor<3xf32>) -> tensor<3x4xf32>
+  func.return %0 : tensor<3x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: @boundedBroadcast
+func.func @boundedBroadcast(%arg0: tensor<?xf32, #stablehlo.bounds<4>>, %arg1: tensor<3x?xf32, #stablehlo.bounds<?, 4>>) -> tensor<3x?xf32> {
+  // CHECK-NOT: shape.
+  // CHECK-DAG: stablehlo.get_dimension_size %arg0, dim = 0
+  // CHECK-DAG: stablehlo.get_dimension_size %arg1, dim = 1
+  // CHECK-DAG: %[[ARG0_B:.+]] = stablehlo.dynamic_broadcast_in_dim %arg0, %{{.+}}, dims = [1]
+  // CHECK-DAG: %[[ARG1_B:.+]] = stablehlo.dynamic_broadcast_in_dim %arg1, %{{.+}}, dims = [0, 1]
+  // CHECK: stablehlo.add %[[ARG0_B]], %[[ARG1_B]] : tensor<3x?xf32>
+  %0 = chlo.broadcast_add %arg0, %arg1 : (tensor<?xf32, #stablehlo.bounds<4>>, tensor<3x?xf32, #stablehlo.bounds<?, 4>>) -> tensor<3x?xf32>
+  func.return %0 : tensor<3x?xf32>
+}
+
+// -----
+
 // CHECK-LABEL: @dynamicBroadcastComplex
 // CHECK-SAME: %[[ARG0:.+]]: tensor<?xf32>
 // CHECK-SAME: %[[ARG1:.+]]: tensor<?x?xf32>
@@ -0,0 +1,32 @@
+// RUN: stablehlo-opt --chlo-legalize-to-stablehlo=fast-special-functions --cse --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: @lgamma_digamma_f32
+// CHECK-SAME: %[[ARG:.*]]: tensor<f32>
+func.func @lgamma_digamma_f32(%arg : tensor<f32>) -> (tensor<f32>, tensor<f32>) {
+  // The Lanczos sum is a rational function whose denominator has a leading
+  // coefficient of 7!, rather than a division per coefficient.
+  // CHECK: %[[ONE:.*]] = stablehlo.constant dense<1.000000e+00> : tensor<f32>
+  // CHECK: %[[Z:.*]] = stablehlo.select
+  // CHECK: %[[Z1:.*]] = stablehlo.add %[[Z]], %[[ONE]]
+  // CHECK: %[[Y:.*]] = stablehlo.divide %[[ONE]], %[[Z1]]
+  // CHECK: stablehlo.constant dense<5.040000e+03> : tensor<f32>
+  // CHECK-NOT: dense<6.765{{[0-9]*}}e+02>
+  // CHECK-NOT: stablehlo.divide %[[ONE]], %[[Z1]]
+  // CHECK: return
+  %0 = chlo.lgamma %arg : tensor<f32> -> tensor<f32>
+  %1 = chlo.digamma %arg : tensor<f32> -> tensor<f32>
+  func.return %0, %1 : tensor<f32>, tensor<f32>
+}
+
+// -----
+
+// CHECK-LABEL: @lgamma_f16
+// CHECK-SAME: %[[ARG:.*]]: tensor<f16>
+func.func @lgamma_f16(%arg : tensor<f16>) -> tensor<f16> {
+  // CHECK: stablehlo.convert %[[ARG]] : (tensor<f16>) -> tensor<f32>
+  // CHECK-NOT: dense<6.765{{[0-9]*}}e+02>
+  // CHECK: %[[RES:.*]] = stablehlo.convert %{{.*}} : (tensor<f32>) -> tensor<f16>
+  // CHECK: return %[[RES]]
+  %1 = chlo.lgamma %arg : tensor<f16> -> tensor<f16>
+  func.return %1 : tensor<f16>
+}
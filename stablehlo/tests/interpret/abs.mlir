@@ -1,4 +1,14 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+
+func.func @abs_op_test_si8() {
+  %operand = stablehlo.constant dense<[-128, -1, 0, 1, 127]> : tensor<5xi8>
+  %result = stablehlo.abs %operand : tensor<5xi8>
+  check.expect_eq_const %result, dense<[-128, 1, 0, 1, 127]> : tensor<5xi8>
+  func.return
+}
+
+// -----
 
 func.func @abs_op_test_si64() {
   %operand = stablehlo.constant dense<[-2, 0, 2]> : tensor<3xi64>
@@ -1,4 +1,8 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --interpret-mode=jit -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 --dataflow-execution -split-input-file %s
 
 func.func @add_op_test_si4() {
   %0 = stablehlo.constant dense<[0, 1, 2, -3, 0]> : tensor<5xi4>
@@ -182,6 +186,16 @@ func.func @add_op_scalar() {
 
 // -----
 
+func.func @add_op_test_f8E4M3FN() {
+  %0 = stablehlo.constant dense<[1.0, 448.0, 2.0, -0.0, 0.25]> : tensor<5xf8E4M3FN>
+  %1 = stablehlo.constant dense<[0.125, 16.0, 0.125, 0.0, -0.25]> : tensor<5xf8E4M3FN>
+  %2 = stablehlo.add %0, %1 : tensor<5xf8E4M3FN>
+  check.expect_eq_const %2, dense<[1.125, 448.0, 2.0, 0.0, 0.0]> : tensor<5xf8E4M3FN>
+  func.return
+}
+
+// -----
+
 func.func @add_op_tensor_shape_with_zero_dim_size() {
   %0 = stablehlo.constant dense<2> : tensor<2x0x3xi4>
   %1 = stablehlo.constant dense<3> : tensor<2x0x3xi4>
@@ -189,3 +203,16 @@ func.func @add_op_tensor_shape_with_zero_dim_size() {
   check.expect_eq_const %2, dense<> : tensor<2x0x3xi4>
   func.return
 }
+
+// -----
+
+func.func @add_op_test_quantized() {
+  %0 = stablehlo.constant dense<[1.0, 2.0]> : tensor<2xf32>
+  %1 = stablehlo.constant dense<[4.0, 15.0]> : tensor<2xf32>
+  %2 = stablehlo.uniform_quantize %0 : (tensor<2xf32>) -> tensor<2x!quant.uniform<i8:f32, 0.5:-20>>
+  %3 = stablehlo.uniform_quantize %1 : (tensor<2xf32>) -> tensor<2x!quant.uniform<i8:f32, 0.5:-20>>
+  %4 = stablehlo.add %2, %3 : tensor<2x!quant.uniform<i8:f32, 0.5:-20>>
+  %5 = stablehlo.uniform_dequantize %4 : (tensor<2x!quant.uniform<i8:f32, 0.5:-20>>) -> tensor<2xf32>
+  check.expect_almost_eq_const %5, dense<[5.0, 17.0]> : tensor<2xf32>
+  func.return
+}
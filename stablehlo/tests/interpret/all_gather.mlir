@@ -1,4 +1,6 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+// RUN: stablehlo-translate --interpret --process-threads=8 --pin-process-threads -split-input-file %s
 
 module @cross_replica {
   func.func @all_gather(%arg0 : tensor<2x2xi64>) -> tensor<2x4xi64> {
@@ -1,4 +1,8 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 --dataflow-execution -split-input-file %s
+// RUN: stablehlo-translate --interpret --collective-timeout-ms=0 -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+// RUN: stablehlo-translate --interpret --print-communication-statistics --link-latency-us=5 --link-bandwidth-gbps=100 -split-input-file %s
 
 module @cross_replica {
   func.func @all_reduce(%operand : tensor<4xi64>) -> tensor<4xi64> {
@@ -0,0 +1,37 @@
+// RUN: stablehlo-translate --interpret -split-input-file %s
+
+func.func @batch_norm_grad_op_test_f64() {
+  %operand = stablehlo.constant dense<[[[1.0, 2.0], [3.0, 4.0]],
+                                       [[3.0, 4.0], [1.0, 2.0]]]> : tensor<2x2x2xf64>
+  %scale = stablehlo.constant dense<1.0> : tensor<2xf64>
+  %mean = stablehlo.constant dense<[2.0, 3.0]> : tensor<2xf64>
+  %variance = stablehlo.constant dense<1.0> : tensor<2xf64>
+  %grad_output = stablehlo.constant dense<0.1> : tensor<2x2x2xf64>
+  %grad_operand, %grad_scale, %grad_offset = "stablehlo.batch_norm_grad"(%operand, %scale, %mean, %variance, %grad_output) {
+    epsilon = 0.0 : f32,
+    feature_index = 2 : i64
+  } : (tensor<2x2x2xf64>, tensor<2xf64>, tensor<2xf64>, tensor<2xf64>, tensor<2x2x2xf64>) -> (tensor<2x2x2xf64>, tensor<2xf64>, tensor<2xf64>)
+  check.expect_almost_eq_const %grad_operand, dense<0.0> : tensor<2x2x2xf64>
+  check.expect_almost_eq_const %grad_scale, dense<0.0> : tensor<2xf64>
+  check.expect_almost_eq_const %grad_offset, dense<0.4> : tensor<2xf64>
+  func.return
+}
+
+// -----
+
+func.func @batch_norm_grad_op_test_f64_leading_feature() {
+  %operand = stablehlo.constant dense<[[1.0, 2.0, 3.0], [4.0, 6.0, 8.0]]> : tensor<2x3xf64>
+  %scale = stablehlo.constant dense<[2.0, 1.0]> : tensor<2xf64>
+  %mean = stablehlo.constant dense<[1.5, 5.0]> : tensor<2xf64>
+  %variance = stablehlo.constant dense<[0.5, 2.0]> : tensor<2xf64>
+  %grad_output = stablehlo.constant dense<[[0.5, -1.0, 2.0], [1.0, 0.0, -1.0]]> : tensor<2x3xf64>
+  %grad_operand, %grad_scale, %grad_offset = "stablehlo.batch_norm_grad"(%operand, %scale, %mean, %variance, %grad_output) {
+    epsilon = 0.5 : f32,
+    feature_index = 0 : i64
+  } : (tensor<2x3xf64>, tensor<2xf64>, tensor<2xf64>, tensor<2xf64>, tensor<2x3xf64>) -> (tensor<2x3xf64>, tensor<2xf64>, tensor<2xf64>)
+  check.expect_almost_eq_const %grad_operand, dense<[[0.75, -3.75, 0.75],
+                                                     [0.29514591494904874, 0.33730961708462714, 0.3794733192202055]]> : tensor<2x3xf64>
+  check.expect_almost_eq_const %grad_scale, dense<[2.25, -2.5298221281347035]> : tensor<2xf64>
+  check.expect_almost_eq_const %grad_offset, dense<[1.5, 0.0]> : tensor<2xf64>
+  func.return
+}
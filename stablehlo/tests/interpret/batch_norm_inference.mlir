@@ -0,0 +1,34 @@
+// RUN: stablehlo-translate --interpret -split-input-file %s
+
+func.func @batch_norm_inference_op_test_f64() {
+  %operand = stablehlo.constant dense<[[[1.0, 2.0], [3.0, 4.0]],
+                                       [[3.0, 4.0], [1.0, 2.0]]]> : tensor<2x2x2xf64>
+  %scale = stablehlo.constant dense<1.0> : tensor<2xf64>
+  %offset = stablehlo.constant dense<1.0> : tensor<2xf64>
+  %mean = stablehlo.constant dense<[2.0, 3.0]> : tensor<2xf64>
+  %variance = stablehlo.constant dense<1.0> : tensor<2xf64>
+  %result = "stablehlo.batch_norm_inference"(%operand, %scale, %offset, %mean, %variance) {
+    epsilon = 0.0 : f32,
+    feature_index = 2 : i64
+  } : (tensor<2x2x2xf64>, tensor<2xf64>, tensor<2xf64>, tensor<2xf64>, tensor<2xf64>) -> tensor<2x2x2xf64>
+  check.expect_almost_eq_const %result, dense<[[[0.0, 0.0], [2.0, 2.0]],
+                                               [[2.0, 2.0], [0.0, 0.0]]]> : tensor<2x2x2xf64>
+  func.return
+}
+
+// -----
+
+func.func @batch_norm_inference_op_test_f32_epsilon() {
+  %operand = stablehlo.constant dense<[[1.0, 2.0, 3.0], [4.0, 6.0, 8.0]]> : tensor<2x3xf32>
+  %scale = stablehlo.constant dense<[2.0, 1.0]> : tensor<2xf32>
+  %offset = stablehlo.constant dense<[0.0, 1.0]> : tensor<2xf32>
+  %mean = stablehlo.constant dense<[2.0, 6.0]> : tensor<2xf32>
+  %variance = stablehlo.constant dense<[3.5, 0.0]> : tensor<2xf32>
+  %result = "stablehlo.batch_norm_inference"(%operand, %scale, %offset, %mean, %variance) {
+    epsilon = 0.5 : f32,
+    feature_index = 0 : i64
+  } : (tensor<2x3xf32>, tensor<2xf32>, tensor<2xf32>, tensor<2xf32>, tensor<2xf32>) -> tensor<2x3xf32>
+  check.expect_almost_eq_const %result, dense<[[-1.0, 0.0, 1.0],
+                                               [-1.82842708, 1.0, 3.82842708]]> : tensor<2x3xf32>
+  func.return
+}
@@ -0,0 +1,50 @@
+// RUN: stablehlo-translate --interpret -split-input-file %s
+
+func.func @batch_norm_training_op_test_f64() {
+  %operand = stablehlo.constant dense<[[[1.0, 2.0], [3.0, 4.0]],
+                                       [[3.0, 4.0], [1.0, 2.0]]]> : tensor<2x2x2xf64>
+  %scale = stablehlo.constant dense<1.0> : tensor<2xf64>
+  %offset = stablehlo.constant dense<1.0> : tensor<2xf64>
+  %output, %batch_mean, %batch_var = "stablehlo.batch_norm_training"(%operand, %scale, %offset) {
+    epsilon = 0.0 : f32,
+    feature_index = 2 : i64
+  } : (tensor<2x2x2xf64>, tensor<2xf64>, tensor<2xf64>) -> (tensor<2x2x2xf64>, tensor<2xf64>, tensor<2xf64>)
+  check.expect_almost_eq_const %output, dense<[[[0.0, 0.0], [2.0, 2.0]],
+                                               [[2.0, 2.0], [0.0, 0.0]]]> : tensor<2x2x2xf64>
+  check.expect_almost_eq_const %batch_mean, dense<[2.0, 3.0]> : tensor<2xf64>
+  check.expect_almost_eq_const %batch_var, dense<[1.0, 1.0]> : tensor<2xf64>
+  func.return
+}
+
+// -----
+
+func.func @batch_norm_training_op_test_f32_leading_feature() {
+  %operand = stablehlo.constant dense<[[1.0, 2.0, 3.0], [4.0, 6.0, 8.0]]> : tensor<2x3xf32>
+  %scale = stablehlo.constant dense<[2.0, 1.0]> : tensor<2xf32>
+  %offset = stablehlo.constant dense<[0.0, 1.0]> : tensor<2xf32>
+  %output, %batch_mean, %batch_var = "stablehlo.batch_norm_training"(%operand, %scale, %offset) {
+    epsilon = 0.0 : f32,
+    feature_index = 0 : i64
+  } : (tensor<2x3xf32>, tensor<2xf32>, tensor<2xf32>) -> (tensor<2x3xf32>, tensor<2xf32>, tensor<2xf32>)
+  check.expect_almost_eq_const %output, dense<[[-2.44948974, 0.0, 2.44948974],
+                                               [-0.224744871, 1.0, 2.22474487]]> : tensor<2x3xf32>
+  check.expect_almost_eq_const %batch_mean, dense<[2.0, 6.0]> : tensor<2xf32>
+  check.expect_almost_eq_const %batch_var, dense<[0.666666686, 2.66666675]> : tensor<2xf32>
+  func.return
+}
+
+// -----
+
+func.func @batch_norm_training_op_test_large_batch() {
+  %iota = stablehlo.iota dim = 0 : tensor<1000x4xf64>
+  %operand = stablehlo.add %iota, %iota : tensor<1000x4xf64>
+  %scale = stablehlo.constant dense<1.0> : tensor<4xf64>
+  %offset = stablehlo.constant dense<0.0> : tensor<4xf64>
+  %output, %batch_mean, %batch_var = "stablehlo.batch_norm_training"(%operand, %scale, %offset) {
+    epsilon = 0.0 : f32,
+    feature_index = 1 : i64
+  } : (tensor<1000x4xf64>, tensor<4xf64>, tensor<4xf64>) -> (tensor<1000x4xf64>, tensor<4xf64>, tensor<4xf64>)
+  check.expect_almost_eq_const %batch_mean, dense<999.0> : tensor<4xf64>
+  check.expect_almost_eq_const %batch_var, dense<333333.0> : tensor<4xf64>
+  func.return
+}
@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
 
 func.func @broadcast_in_dim() {
   %operand = stablehlo.constant dense<[[1], [2], [3]]> : tensor<3x1xi64>
@@ -8,3 +9,19 @@ func.func @broadcast_in_dim() {
   check.expect_eq_const %result, dense<[[[1, 1], [1, 1]], [[2, 2], [2, 2]], [[3, 3], [3, 3]]]> : tensor<3x2x2xi64>
   func.return
 }
+
+// -----
+
+func.func @broadcast_in_dim_multiply() {
+  %lhs = stablehlo.constant dense<[1, 2, 3]> : tensor<3xi64>
+  %rhs = stablehlo.constant dense<[10, 20]> : tensor<2xi64>
+  %0 = "stablehlo.broadcast_in_dim"(%lhs) {
+    broadcast_dimensions = array<i64: 0>
+  } : (tensor<3xi64>) -> tensor<3x2xi64>
+  %1 = "stablehlo.broadcast_in_dim"(%rhs) {
+    broadcast_dimensions = array<i64: 1>
+  } : (tensor<2xi64>) -> tensor<3x2xi64>
+  %result = stablehlo.multiply %0, %1 : tensor<3x2xi64>
+  check.expect_eq_const %result, dense<[[10, 20], [20, 40], [30, 60]]> : tensor<3x2xi64>
+  func.return
+}
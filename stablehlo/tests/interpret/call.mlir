@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 --dataflow-execution %s
 
 func.func @add_2(%arg0: tensor<i64>) -> tensor<i64> {
   %0 = stablehlo.constant dense<2> : tensor<i64>
@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 --dataflow-execution -split-input-file %s
 
 func.func @case_negative_index_default() {
   %index = stablehlo.constant dense<-1> : tensor<i32>
@@ -0,0 +1,30 @@
+// RUN: not stablehlo-translate --interpret --test-threads=1 %s 2>&1 | FileCheck %s
+
+// CHECK: error: Error evaluating function: almost_eq_mismatches_test.
+// CHECK-NEXT: Fallback for check.expect_almost_eq_const failed: Element values don't match
+// CHECK-SAME: at index [1]
+// CHECK-NEXT: 3 of 4 elements don't match, max absolute error {{.*}} at index [1], max relative error {{.*}} at index [3], max ULP distance 8388608 at index [3]
+func.func @almost_eq_mismatches_test() {
+  %0 = stablehlo.constant dense<[1.0, 2.0, 1000.0, 0.5]> : tensor<4xf32>
+  check.expect_almost_eq_const %0, dense<[1.0, 2.5, 1000.001, 0.25]> : tensor<4xf32>
+  func.return
+}
+
+// CHECK: error: Error evaluating function: eq_mismatches_test.
+// CHECK-NEXT: Fallback for check.expect_eq_const failed: Element values don't match
+// CHECK-SAME: at index [0, 1]
+// CHECK-NEXT: 2 of 4 elements don't match{{$}}
+func.func @eq_mismatches_test() {
+  %0 = stablehlo.constant dense<[[1, 2], [3, 4]]> : tensor<2x2xi32>
+  check.expect_eq_const %0, dense<[[1, 5], [3, 6]]> : tensor<2x2xi32>
+  func.return
+}
+
+// CHECK-NOT: matching_test
+func.func @matching_test() {
+  %0 = stablehlo.constant dense<[0.0, 1.0, 0x7FC00000, 0x7F800000]> : tensor<4xf32>
+  check.expect_almost_eq_const %0, dense<[-0.0, 1.00001, 0x7FC00000, 0x7F800000]> : tensor<4xf32>
+  %1 = stablehlo.constant dense<[0.0, -2.0, 0x7F800000]> : tensor<3xf32>
+  check.expect_eq_const %1, dense<[-0.0, -2.0, 0x7F800000]> : tensor<3xf32>
+  func.return
+}
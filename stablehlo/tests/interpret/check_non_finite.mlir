@@ -0,0 +1,12 @@
+// RUN: not stablehlo-translate --interpret --check-non-finite %s 2>&1 | FileCheck %s
+
+// CHECK: error: first op producing non-finite values: stablehlo.divide
+// CHECK-SAME: produced 1 NaN, 1 +inf and 0 -inf of 4 elements in result 0, finite range [0.5, 2]
+func.func @main() {
+  %lhs = stablehlo.constant dense<[1.0, 0.0, 2.0, 1.0]> : tensor<4xf32>
+  %rhs = stablehlo.constant dense<[2.0, 0.0, 1.0, 0.0]> : tensor<4xf32>
+  %quotient = stablehlo.divide %lhs, %rhs : tensor<4xf32>
+  // Non-finite values of ops using the first op's results aren't reported.
+  %product = stablehlo.multiply %quotient, %rhs : tensor<4xf32>
+  func.return
+}
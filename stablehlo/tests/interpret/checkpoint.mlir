@@ -0,0 +1,29 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: stablehlo-translate --interpret --checkpoint-dir=%t --checkpoint-interval=4 --keep-checkpoints %s
+// RUN: ls %t | FileCheck %s --check-prefix=FILES
+// RUN: rm %t/main.4@0-10.ckpt %t/main.4@0-8.ckpt
+// RUN: stablehlo-translate --interpret --checkpoint-dir=%t --resume-from-checkpoint %s
+// RUN: stablehlo-translate --interpret --checkpoint-dir=%t --resume-from-checkpoint %s
+
+// FILES: main.4@0-10.ckpt
+// FILES-NEXT: main.4@0-4.ckpt
+// FILES-NEXT: main.4@0-8.ckpt
+func.func @main() {
+  %init_i = stablehlo.constant dense<0> : tensor<i64>
+  %init_sum = stablehlo.constant dense<0.0> : tensor<2xf32>
+  %one = stablehlo.constant dense<1> : tensor<i64>
+  %ten = stablehlo.constant dense<10> : tensor<i64>
+  %results0, %results1 = stablehlo.while(%arg0 = %init_i, %arg1 = %init_sum) : tensor<i64>, tensor<2xf32>
+  cond {
+    %cond = stablehlo.compare LT, %arg0, %ten : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %cond : tensor<i1>
+  } do {
+    %delta = stablehlo.constant dense<[1.0, 0.5]> : tensor<2xf32>
+    %new_sum = stablehlo.add %arg1, %delta : tensor<2xf32>
+    %new_i = stablehlo.add %arg0, %one : tensor<i64>
+    stablehlo.return %new_i, %new_sum : tensor<i64>, tensor<2xf32>
+  }
+  check.expect_eq_const %results0, dense<10> : tensor<i64>
+  check.expect_eq_const %results1, dense<[10.0, 5.0]> : tensor<2xf32>
+  func.return
+}
@@ -0,0 +1,51 @@
+// RUN: stablehlo-translate --interpret -split-input-file %s
+
+func.func @cholesky_op_test_f64_lower() {
+  %a = stablehlo.constant dense<[[1.0, 2.0, 3.0], [2.0, 20.0, 26.0], [3.0, 26.0, 70.0]]> : tensor<3x3xf64>
+  %result = stablehlo.cholesky %a, lower = true : tensor<3x3xf64>
+  check.expect_almost_eq_const %result, dense<[[1.0, 0.0, 0.0], [2.0, 4.0, 0.0], [3.0, 5.0, 6.0]]> : tensor<3x3xf64>
+  func.return
+}
+
+// -----
+
+func.func @cholesky_op_test_f32_upper() {
+  %a = stablehlo.constant dense<[[1.0, 2.0, 3.0], [0.0, 20.0, 26.0], [0.0, 0.0, 70.0]]> : tensor<3x3xf32>
+  %result = stablehlo.cholesky %a : tensor<3x3xf32>
+  check.expect_almost_eq_const %result, dense<[[1.0, 2.0, 3.0], [0.0, 4.0, 5.0], [0.0, 0.0, 6.0]]> : tensor<3x3xf32>
+  func.return
+}
+
+// -----
+
+func.func @cholesky_op_test_batched() {
+  %a = stablehlo.constant dense<[[[4.0, 2.0], [2.0, 5.0]], [[9.0, 3.0], [3.0, 5.0]]]> : tensor<2x2x2xf32>
+  %result = stablehlo.cholesky %a, lower = true : tensor<2x2x2xf32>
+  check.expect_almost_eq_const %result, dense<[[[2.0, 0.0], [1.0, 2.0]], [[3.0, 0.0], [1.0, 2.0]]]> : tensor<2x2x2xf32>
+  func.return
+}
+
+// -----
+
+func.func @cholesky_op_test_c64() {
+  %a = stablehlo.constant dense<[[(4.0, 0.0), (2.0, 2.0)], [(2.0, -2.0), (6.0, 0.0)]]> : tensor<2x2xcomplex<f32>>
+  %result = stablehlo.cholesky %a, lower = true : tensor<2x2xcomplex<f32>>
+  check.expect_almost_eq_const %result, dense<[[(2.0, 0.0), (0.0, 0.0)], [(1.0, -1.0), (2.0, 0.0)]]> : tensor<2x2xcomplex<f32>>
+  func.return
+}
+
+// -----
+
+// Spans several panels of the blocked kernel: `L * L^T` recomposes `a`.
+func.func @cholesky_op_test_blocked() {
+  %rows = stablehlo.iota dim = 0 : tensor<100x100xi64>
+  %columns = stablehlo.iota dim = 1 : tensor<100x100xi64>
+  %diagonal = stablehlo.compare EQ, %rows, %columns : (tensor<100x100xi64>, tensor<100x100xi64>) -> tensor<100x100xi1>
+  %on_diagonal = stablehlo.constant dense<101.0> : tensor<100x100xf64>
+  %off_diagonal = stablehlo.constant dense<1.0> : tensor<100x100xf64>
+  %a = stablehlo.select %diagonal, %on_diagonal, %off_diagonal : tensor<100x100xi1>, tensor<100x100xf64>
+  %l = stablehlo.cholesky %a, lower = true : tensor<100x100xf64>
+  %result = stablehlo.dot_general %l, %l, contracting_dims = [1] x [1] : (tensor<100x100xf64>, tensor<100x100xf64>) -> tensor<100x100xf64>
+  check.expect_almost_eq %result, %a : tensor<100x100xf64>
+  func.return
+}
@@ -41,3 +41,14 @@ func.func @clamp_op_test_si64_min_max_both_scalar() {
   check.expect_eq_const %result, dense<[1, 1, 0]> : tensor<3xi64>
   func.return
 }
+
+// -----
+
+func.func @clamp_op_test_f32_splat() {
+  %min = stablehlo.constant dense<0.0> : tensor<f32>
+  %operand = stablehlo.constant dense<2.5> : tensor<2x3xf32>
+  %max = stablehlo.constant dense<1.0> : tensor<f32>
+  %result = stablehlo.clamp %min, %operand, %max : (tensor<f32>, tensor<2x3xf32>, tensor<f32>) -> tensor<2x3xf32>
+  check.expect_eq_const %result, dense<1.0> : tensor<2x3xf32>
+  func.return
+}
@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --collective-timeout-ms=0 -split-input-file %s
 
 module @cross_replica {
   func.func @collective_permute(%operand : tensor<2x2xi64>) -> tensor<2x2xi64> {
@@ -7,3 +7,14 @@ func.func @concatenate() {
   check.expect_eq_const %result, dense<[[1, 2], [3, 4] , [5, 6], [7, 8]]> : tensor<4x2xi64>
   func.return
 }
+
+// -----
+
+func.func @concatenate_broadcast() {
+  %operand = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  %input0 = stablehlo.broadcast_in_dim %operand, dims = [1] : (tensor<2xi64>) -> tensor<2x2xi64>
+  %input1 = stablehlo.constant dense<[[3], [4]]> : tensor<2x1xi64>
+  %result = stablehlo.concatenate %input0, %input1, dim = 1 : (tensor<2x2xi64>, tensor<2x1xi64>) -> tensor<2x3xi64>
+  check.expect_eq_const %result, dense<[[1, 2, 3], [1, 2, 4]]> : tensor<2x3xi64>
+  func.return
+}
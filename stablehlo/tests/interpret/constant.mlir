@@ -172,3 +172,24 @@ func.func @constant_op_test_c128() {
   check.expect_almost_eq_const %0, dense<[(1.500000e+00, 2.500000e+00), (3.500000e+00, 4.500000e+00)]> : tensor<2xcomplex<f64>>
   func.return
 }
+
+// -----
+
+func.func @constant_op_test_splat_in_loop() {
+  %init = stablehlo.constant dense<0.0> : tensor<2x3xf32>
+  %zero = stablehlo.constant dense<0> : tensor<i64>
+  %results0, %results1 = stablehlo.while(%arg0 = %zero, %arg1 = %init) : tensor<i64>, tensor<2x3xf32>
+  cond {
+    %three = stablehlo.constant dense<3> : tensor<i64>
+    %cond = stablehlo.compare LT, %arg0, %three : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %cond : tensor<i1>
+  } do {
+    %one = stablehlo.constant dense<1> : tensor<i64>
+    %half = stablehlo.constant dense<0.5> : tensor<2x3xf32>
+    %new_i = stablehlo.add %arg0, %one : tensor<i64>
+    %new_sum = stablehlo.add %arg1, %half : tensor<2x3xf32>
+    stablehlo.return %new_i, %new_sum : tensor<i64>, tensor<2x3xf32>
+  }
+  check.expect_eq_const %results1, dense<1.5> : tensor<2x3xf32>
+  func.return
+}
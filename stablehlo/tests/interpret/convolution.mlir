@@ -1,4 +1,7 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --exact-accumulation -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 -split-input-file %s
 
 func.func @convolution_op_test_si64() {
   %lhs = stablehlo.constant dense<[[
@@ -106,3 +109,24 @@ func.func @convolution_feature_group_count_2() {
                                          [[21, 21, 29, 29]]]]> : tensor<1x2x1x4xi64>
   func.return
 }
+
+// -----
+
+func.func @convolution_op_test_rhs_dilation_reversal_f32() {
+  %lhs = stablehlo.constant dense<[[[1.0], [2.0], [3.0], [4.0], [5.0]]]> : tensor<1x5x1xf32>
+  %rhs = stablehlo.constant dense<[[[1.0]], [[10.0]]]> : tensor<2x1x1xf32>
+  %result = stablehlo.convolution(%lhs, %rhs)
+    dim_numbers = [b, 0, f]x[0, i, o]->[b, 0, f],
+    window = {
+      pad = [[1, 0]],
+      rhs_dilate = [2],
+      reverse = [true]
+    } {
+      batch_group_count = 1 : i64,
+      feature_group_count = 1 : i64,
+      precision_config = [#stablehlo<precision DEFAULT>, #stablehlo<precision DEFAULT>]
+    }
+  : (tensor<1x5x1xf32>, tensor<2x1x1xf32>) -> tensor<1x4x1xf32>
+  check.expect_almost_eq_const %result, dense<[[[2.0], [13.0], [24.0], [35.0]]]> : tensor<1x4x1xf32>
+  func.return
+}
@@ -1,4 +1,9 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --interpret-mode=jit -split-input-file %s
+// RUN: stablehlo-translate --interpret --exact-accumulation -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 --dataflow-execution -split-input-file %s
 
 func.func @dot_general_op_test_si64() {
   %lhs = stablehlo.constant dense<[[[1, 2], [3, 4]],
@@ -31,3 +36,94 @@ func.func @dot_general_op_test_empty_dims() {
                                          [[4, 0], [0, 4]]]]> : tensor<2x2x2x2xi64>
   func.return
 }
+
+// -----
+
+func.func @dot_general_op_test_transposed_f32() {
+  %lhs = stablehlo.constant dense<[[1.0, 2.0, 3.0],
+                                   [4.0, 5.0, 6.0]]> : tensor<2x3xf32>
+  %rhs = stablehlo.constant dense<[[1.0, 2.0],
+                                   [3.0, 4.0]]> : tensor<2x2xf32>
+  %result = stablehlo.dot_general %lhs, %rhs,
+    contracting_dims = [0] x [1]
+    : (tensor<2x3xf32>, tensor<2x2xf32>) -> tensor<3x2xf32>
+  check.expect_almost_eq_const %result, dense<[[9.0, 19.0],
+                                               [12.0, 26.0],
+                                               [15.0, 33.0]]> : tensor<3x2xf32>
+  func.return
+}
+
+// -----
+
+func.func @dot_general_op_test_c64() {
+  %lhs = stablehlo.constant dense<[[(1.0, 1.0), (2.0, 0.0)],
+                                   [(0.0, 1.0), (1.0, -1.0)]]> : tensor<2x2xcomplex<f32>>
+  %rhs = stablehlo.constant dense<[[(1.0, 0.0), (0.0, 1.0)],
+                                   [(1.0, 1.0), (2.0, 0.0)]]> : tensor<2x2xcomplex<f32>>
+  %result = stablehlo.dot_general %lhs, %rhs,
+    contracting_dims = [1] x [0]
+    : (tensor<2x2xcomplex<f32>>, tensor<2x2xcomplex<f32>>) -> tensor<2x2xcomplex<f32>>
+  check.expect_almost_eq_const %result, dense<[[(3.0, 3.0), (3.0, 1.0)],
+                                               [(2.0, 1.0), (1.0, -2.0)]]> : tensor<2x2xcomplex<f32>>
+  func.return
+}
+
+// -----
+
+func.func @dot_general_op_test_batching_bf16() {
+  %lhs = stablehlo.constant dense<[[[1.0, 2.0], [3.0, 4.0]],
+                                   [[5.0, 6.0], [7.0, 8.0]]]> : tensor<2x2x2xbf16>
+  %rhs = stablehlo.constant dense<[[[1.0, 1.0], [0.5, -1.0]],
+                                   [[2.0, 0.0], [0.0, 2.0]]]> : tensor<2x2x2xbf16>
+  %result = stablehlo.dot_general %lhs, %rhs,
+    batching_dims = [0] x [0],
+    contracting_dims = [2] x [1]
+    : (tensor<2x2x2xbf16>, tensor<2x2x2xbf16>) -> tensor<2x2x2xbf16>
+  check.expect_almost_eq_const %result, dense<[[[2.0, -1.0], [5.0, -1.0]],
+                                               [[10.0, 12.0], [14.0, 16.0]]]> : tensor<2x2x2xbf16>
+  func.return
+}
+
+// -----
+
+func.func @dot_general_op_test_batching_f8E4M3FN() {
+  %lhs = stablehlo.constant dense<[[[1.0, 2.0], [3.0, 4.0]],
+                                   [[5.0, 6.0], [7.0, 8.0]]]> : tensor<2x2x2xf8E4M3FN>
+  %rhs = stablehlo.constant dense<[[[1.0, 1.0], [0.5, -1.0]],
+                                   [[2.0, 0.0], [0.0, 2.0]]]> : tensor<2x2x2xf8E4M3FN>
+  %result = stablehlo.dot_general %lhs, %rhs,
+    batching_dims = [0] x [0],
+    contracting_dims = [2] x [1]
+    : (tensor<2x2x2xf8E4M3FN>, tensor<2x2x2xf8E4M3FN>) -> tensor<2x2x2xf8E4M3FN>
+  check.expect_eq_const %result, dense<[[[2.0, -1.0], [5.0, -1.0]],
+                                        [[10.0, 12.0], [14.0, 16.0]]]> : tensor<2x2x2xf8E4M3FN>
+  func.return
+}
+
+// -----
+
+func.func @dot_general_op_test_quantized_per_axis() {
+  %lhs = stablehlo.constant dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf32>
+  %rhs = stablehlo.constant dense<[[1.0, 1.0], [2.0, 2.0]]> : tensor<2x2xf32>
+  %lhs_quantized = stablehlo.uniform_quantize %lhs : (tensor<2x2xf32>) -> tensor<2x2x!quant.uniform<i8:f32, 0.5>>
+  %rhs_quantized = stablehlo.uniform_quantize %rhs : (tensor<2x2xf32>) -> tensor<2x2x!quant.uniform<i8:f32:1, {0.5, 0.25}>>
+  %result = stablehlo.dot_general %lhs_quantized, %rhs_quantized,
+    contracting_dims = [1] x [0]
+    : (tensor<2x2x!quant.uniform<i8:f32, 0.5>>, tensor<2x2x!quant.uniform<i8:f32:1, {0.5, 0.25}>>) -> tensor<2x2x!quant.uniform<i32:f32, 1.0:2>>
+  %result_dequantized = stablehlo.uniform_dequantize %result : (tensor<2x2x!quant.uniform<i32:f32, 1.0:2>>) -> tensor<2x2xf32>
+  check.expect_almost_eq_const %result_dequantized, dense<[[5.0, 5.0], [11.0, 11.0]]> : tensor<2x2xf32>
+  func.return
+}
+
+// -----
+
+func.func @dot_general_op_test_hybrid() {
+  %lhs = stablehlo.constant dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf32>
+  %rhs = stablehlo.constant dense<[[1.0, 0.0], [0.0, 2.0]]> : tensor<2x2xf32>
+  %rhs_quantized = stablehlo.uniform_quantize %rhs : (tensor<2x2xf32>) -> tensor<2x2x!quant.uniform<i8:f32, 0.5>>
+  %result = stablehlo.dot_general %lhs, %rhs_quantized,
+    contracting_dims = [1] x [0]
+    : (tensor<2x2xf32>, tensor<2x2x!quant.uniform<i8:f32, 0.5>>) -> tensor<2x2xf32>
+  check.expect_almost_eq_const %result, dense<[[1.0, 4.0], [3.0, 8.0]]> : tensor<2x2xf32>
+  func.return
+}
@@ -0,0 +1,31 @@
+// RUN: stablehlo-translate --interpret --evaluations=4 %s
+// RUN: stablehlo-translate --interpret --evaluations=4 --intra-op-threads=2 --dataflow-execution %s
+
+func.func @sum(%arg0: tensor<4xi64>) -> tensor<i64> {
+  %init = stablehlo.constant dense<0> : tensor<i64>
+  %0 = stablehlo.reduce(%arg0 init: %init) applies stablehlo.add across dimensions = [0] : (tensor<4xi64>, tensor<i64>) -> tensor<i64>
+  func.return %0 : tensor<i64>
+}
+
+func.func @main() {
+  // Every iteration calls @sum, whose regions are prepared only once for all
+  // evaluations.
+  %init_i = stablehlo.constant dense<0> : tensor<i64>
+  %init_sum = stablehlo.constant dense<0> : tensor<i64>
+  %one = stablehlo.constant dense<1> : tensor<i64>
+  %ten = stablehlo.constant dense<10> : tensor<i64>
+  %values = stablehlo.constant dense<[1, 2, 3, 4]> : tensor<4xi64>
+  %results0, %results1 = stablehlo.while(%arg0 = %init_i, %arg1 = %init_sum) : tensor<i64>, tensor<i64>
+  cond {
+    %cond = stablehlo.compare LT, %arg0, %ten : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %cond : tensor<i1>
+  } do {
+    %sum = func.call @sum(%values) : (tensor<4xi64>) -> tensor<i64>
+    %new_sum = stablehlo.add %arg1, %sum : tensor<i64>
+    %new_i = stablehlo.add %arg0, %one : tensor<i64>
+    stablehlo.return %new_i, %new_sum : tensor<i64>, tensor<i64>
+  }
+  check.expect_eq_const %results0, dense<10> : tensor<i64>
+  check.expect_eq_const %results1, dense<100> : tensor<i64>
+  func.return
+}
@@ -0,0 +1,75 @@
+// RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+
+func.func @fft_op_test_fft() {
+  %operand = stablehlo.constant dense<[(1.0, 0.0), (2.0, 0.0), (3.0, 0.0), (4.0, 0.0)]> : tensor<4xcomplex<f32>>
+  %result = stablehlo.fft %operand, type = FFT, length = [4] : (tensor<4xcomplex<f32>>) -> tensor<4xcomplex<f32>>
+  check.expect_almost_eq_const %result, dense<[(10.0, 0.0), (-2.0, 2.0), (-2.0, 0.0), (-2.0, -2.0)]> : tensor<4xcomplex<f32>>
+  func.return
+}
+
+// -----
+
+func.func @fft_op_test_ifft() {
+  %operand = stablehlo.constant dense<[(10.0, 0.0), (-2.0, 2.0), (-2.0, 0.0), (-2.0, -2.0)]> : tensor<4xcomplex<f32>>
+  %result = stablehlo.fft %operand, type = IFFT, length = [4] : (tensor<4xcomplex<f32>>) -> tensor<4xcomplex<f32>>
+  check.expect_almost_eq_const %result, dense<[(1.0, 0.0), (2.0, 0.0), (3.0, 0.0), (4.0, 0.0)]> : tensor<4xcomplex<f32>>
+  func.return
+}
+
+// -----
+
+func.func @fft_op_test_rfft() {
+  %operand = stablehlo.constant dense<[1.0, 2.0, 3.0, 4.0]> : tensor<4xf32>
+  %result = stablehlo.fft %operand, type = RFFT, length = [4] : (tensor<4xf32>) -> tensor<3xcomplex<f32>>
+  check.expect_almost_eq_const %result, dense<[(10.0, 0.0), (-2.0, 2.0), (-2.0, 0.0)]> : tensor<3xcomplex<f32>>
+  func.return
+}
+
+// -----
+
+func.func @fft_op_test_irfft() {
+  %operand = stablehlo.constant dense<[(10.0, 0.0), (-2.0, 2.0), (-2.0, 0.0)]> : tensor<3xcomplex<f32>>
+  %result = stablehlo.fft %operand, type = IRFFT, length = [4] : (tensor<3xcomplex<f32>>) -> tensor<4xf32>
+  check.expect_almost_eq_const %result, dense<[1.0, 2.0, 3.0, 4.0]> : tensor<4xf32>
+  func.return
+}
+
+// -----
+
+func.func @fft_op_test_fft_2d() {
+  %operand = stablehlo.constant dense<[[(1.0, 0.0), (2.0, 0.0)], [(3.0, 0.0), (4.0, 0.0)]]> : tensor<2x2xcomplex<f32>>
+  %result = stablehlo.fft %operand, type = FFT, length = [2, 2] : (tensor<2x2xcomplex<f32>>) -> tensor<2x2xcomplex<f32>>
+  check.expect_almost_eq_const %result, dense<[[(10.0, 0.0), (-2.0, 0.0)], [(-4.0, 0.0), (0.0, 0.0)]]> : tensor<2x2xcomplex<f32>>
+  func.return
+}
+
+// -----
+
+func.func @fft_op_test_fft_batched() {
+  %operand = stablehlo.constant dense<[[(1.0, 0.0), (2.0, 0.0)], [(3.0, 0.0), (4.0, 0.0)]]> : tensor<2x2xcomplex<f32>>
+  %result = stablehlo.fft %operand, type = FFT, length = [2] : (tensor<2x2xcomplex<f32>>) -> tensor<2x2xcomplex<f32>>
+  check.expect_almost_eq_const %result, dense<[[(3.0, 0.0), (-1.0, 0.0)], [(7.0, 0.0), (-1.0, 0.0)]]> : tensor<2x2xcomplex<f32>>
+  func.return
+}
+
+// -----
+
+// Lengths with prime factors larger than 7 are transformed by Bluestein's
+// algorithm.
+func.func @fft_op_test_fft_bluestein() {
+  %operand = stablehlo.constant dense<1.0> : tensor<11xcomplex<f64>>
+  %result = stablehlo.fft %operand, type = FFT, length = [11] : (tensor<11xcomplex<f64>>) -> tensor<11xcomplex<f64>>
+  check.expect_almost_eq_const %result, dense<[(11.0, 0.0), (0.0, 0.0), (0.0, 0.0), (0.0, 0.0), (0.0, 0.0), (0.0, 0.0), (0.0, 0.0), (0.0, 0.0), (0.0, 0.0), (0.0, 0.0), (0.0, 0.0)]> : tensor<11xcomplex<f64>>
+  func.return
+}
+
+// -----
+
+func.func @fft_op_test_round_trip_mixed_radix() {
+  %operand = stablehlo.constant dense<[1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0, 11.0, 12.0, 13.0, 14.0, 15.0, 16.0, 17.0, 18.0, 19.0, 20.0, 21.0, 22.0]> : tensor<22xf64>
+  %spectrum = stablehlo.fft %operand, type = RFFT, length = [22] : (tensor<22xf64>) -> tensor<12xcomplex<f64>>
+  %result = stablehlo.fft %spectrum, type = IRFFT, length = [22] : (tensor<12xcomplex<f64>>) -> tensor<22xf64>
+  check.expect_almost_eq %result, %operand : tensor<22xf64>
+  func.return
+}
@@ -1,4 +1,6 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
 
 func.func @gather_op_test() {
   %operand = stablehlo.constant dense<[[[1, 2], [3, 4], [5, 6], [7, 8]],
@@ -88,3 +90,25 @@ func.func @gather_op_with_batching_dim_test() {
   ]> : tensor<2x2x3x2x2xi64>
   func.return
 }
+
+// -----
+
+func.func @gather_op_embedding_lookup_test() {
+  %operand = stablehlo.constant dense<[[0.0, 0.5, 1.0],
+                                       [1.5, 2.0, 2.5],
+                                       [3.0, 3.5, 4.0],
+                                       [4.5, 5.0, 5.5]]> : tensor<4x3xf32>
+  %start_indices = stablehlo.constant dense<[[2, 0], [3, 3]]> : tensor<2x2xi32>
+  %result = "stablehlo.gather"(%operand, %start_indices) {
+    dimension_numbers = #stablehlo.gather<
+      offset_dims = [2],
+      collapsed_slice_dims = [0],
+      start_index_map = [0],
+      index_vector_dim = 2>,
+    slice_sizes = array<i64: 1, 3>,
+    indices_are_sorted = false
+  } : (tensor<4x3xf32>, tensor<2x2xi32>) -> tensor<2x2x3xf32>
+  check.expect_eq_const %result, dense<[[[3.0, 3.5, 4.0], [0.0, 0.5, 1.0]],
+                                        [[4.5, 5.0, 5.5], [4.5, 5.0, 5.5]]]> : tensor<2x2x3xf32>
+  func.return
+}
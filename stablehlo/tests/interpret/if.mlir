@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 --dataflow-execution -split-input-file %s
 
 func.func @if_ops_true_branch() {
   %pred = stablehlo.constant dense<true> : tensor<i1>
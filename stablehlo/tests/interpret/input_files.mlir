@@ -0,0 +1,10 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: stablehlo-translate --interpret --probe-output-dir=%t %S/input_files_probe.mlir
+// RUN: stablehlo-translate --interpret --input-files=%t/probe1.npy,%t/probe2.npy %s
+
+func.func @main(%lhs: tensor<2x3xf32>, %rhs: tensor<3xi64>) {
+  %result = stablehlo.add %lhs, %lhs : tensor<2x3xf32>
+  check.expect_eq_const %result, dense<[[2.0, 4.0, 6.0], [8.0, 10.0, 12.0]]> : tensor<2x3xf32>
+  check.expect_eq_const %rhs, dense<[-1, 0, 1]> : tensor<3xi64>
+  func.return
+}
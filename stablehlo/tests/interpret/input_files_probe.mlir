@@ -0,0 +1,10 @@
+// RUN: stablehlo-translate --interpret --probe-output-dir=%t %s
+
+// Writes the inputs of input_files.mlir.
+func.func @main() {
+  %0 = stablehlo.constant dense<[[1.0, 2.0, 3.0], [4.0, 5.0, 6.0]]> : tensor<2x3xf32>
+  %1 = interpreter.probe %0, probe_id = "lhs" : tensor<2x3xf32>
+  %2 = stablehlo.constant dense<[-1, 0, 1]> : tensor<3xi64>
+  %3 = interpreter.probe %2, probe_id = "rhs" : tensor<3xi64>
+  func.return
+}
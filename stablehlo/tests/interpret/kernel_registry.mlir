@@ -0,0 +1,47 @@
+// RUN: stablehlo-translate --interpret --test-kernels %s
+
+// The kernels of `--test-kernels` are registered in process, see
+// StablehloTranslateMain.cpp.
+
+func.func private @add_one(%arg0: tensor<2xi64>) -> tensor<2xi64> {
+  %0 = stablehlo.constant dense<1> : tensor<2xi64>
+  %1 = stablehlo.add %arg0, %0 : tensor<2xi64>
+  func.return %1 : tensor<2xi64>
+}
+
+// Composites with a kernel are evaluated with it rather than decomposed.
+func.func @composite_kernel() {
+  %0 = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  %1 = stablehlo.composite "test.double" %0 {
+    decomposition = @add_one
+  } : (tensor<2xi64>) -> tensor<2xi64>
+  check.expect_eq_const %1, dense<[2, 4]> : tensor<2xi64>
+  func.return
+}
+
+// Composites without a kernel are decomposed.
+func.func @composite_decomposition() {
+  %0 = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  %1 = stablehlo.composite "test.add_one" %0 {
+    decomposition = @add_one
+  } : (tensor<2xi64>) -> tensor<2xi64>
+  check.expect_eq_const %1, dense<[2, 3]> : tensor<2xi64>
+  func.return
+}
+
+// Custom calls with a kernel are evaluated with it.
+func.func @custom_call_kernel() {
+  %0 = stablehlo.constant dense<[1.5, -2.0]> : tensor<2xf32>
+  %1 = stablehlo.custom_call @test.double(%0) : (tensor<2xf32>) -> tensor<2xf32>
+  check.expect_almost_eq_const %1, dense<[3.0, -4.0]> : tensor<2xf32>
+  func.return
+}
+
+// Custom calls without a kernel reach the interpreter fallback.
+func.func @custom_call_fallback() {
+  %0 = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  %1 = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  %2 = stablehlo.custom_call @check.eq(%0, %1) : (tensor<2xi64>, tensor<2xi64>) -> tensor<i1>
+  check.expect_eq_const %2, dense<true> : tensor<i1>
+  func.return
+}
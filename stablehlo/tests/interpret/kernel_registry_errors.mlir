@@ -0,0 +1,14 @@
+// RUN: not stablehlo-translate --interpret --test-kernels %s 2>&1 | FileCheck %s --check-prefix=CHECK-KERNEL
+// RUN: not stablehlo-translate --interpret %s 2>&1 | FileCheck %s --check-prefix=CHECK-FALLBACK
+
+// The errors of kernels abort the evaluation.
+// CHECK-KERNEL: test.fail failed
+
+// Without a registered kernel, custom calls reach the interpreter fallback.
+// CHECK-FALLBACK: Unsupported custom call: {{.*}}@test.fail
+
+func.func @custom_call_error() {
+  %0 = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  %1 = stablehlo.custom_call @test.fail(%0) : (tensor<2xi64>) -> tensor<2xi64>
+  func.return
+}
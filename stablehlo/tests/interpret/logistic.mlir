@@ -1,4 +1,32 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+
+func.func @logistic_op_test_bf16() {
+  %operand = stablehlo.constant dense<[-1.0, 0.0, 1.0, 2.0]> : tensor<4xbf16>
+  %result = stablehlo.logistic %operand : tensor<4xbf16>
+  check.expect_almost_eq_const %result, dense<[2.695310e-01, 5.000000e-01, 7.304690e-01, 8.828130e-01]> : tensor<4xbf16>
+  func.return
+}
+
+// -----
+
+func.func @logistic_op_test_f16() {
+  %operand = stablehlo.constant dense<[-1.0, 0.0, 1.0, 2.0]> : tensor<4xf16>
+  %result = stablehlo.logistic %operand : tensor<4xf16>
+  check.expect_almost_eq_const %result, dense<[2.687990e-01, 5.000000e-01, 7.309570e-01, 8.803710e-01]> : tensor<4xf16>
+  func.return
+}
+
+// -----
+
+func.func @logistic_op_test_f32() {
+  %operand = stablehlo.constant dense<[-1.0, 0.0, 1.0, 2.0]> : tensor<4xf32>
+  %result = stablehlo.logistic %operand : tensor<4xf32>
+  check.expect_almost_eq_const %result, dense<[2.689414e-01, 5.000000e-01, 7.310586e-01, 8.807970e-01]> : tensor<4xf32>
+  func.return
+}
+
+// -----
 
 func.func @logistic_op_test_f64() {
   %operand = stablehlo.constant dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf64>
@@ -13,3 +13,56 @@ func.func @map_op_test_si64() {
   check.expect_eq_const %result, dense<[[0, 5], [12, 21]]> : tensor<2x2xi64>
   func.return
 }
+
+// -----
+
+func.func @map_op_test_fused_body() {
+  %input0 = stablehlo.constant dense<[[-1.0, 2.0], [3.0, -4.0]]> : tensor<2x2xf32>
+  %input1 = stablehlo.constant dense<[[1.0, 1.0], [2.0, 2.0]]> : tensor<2x2xf32>
+  %result = "stablehlo.map"(%input0, %input1) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %zero = stablehlo.constant dense<0.0> : tensor<f32>
+      %0 = stablehlo.multiply %arg0, %arg1 : tensor<f32>
+      %1 = stablehlo.compare GT, %0, %zero : (tensor<f32>, tensor<f32>) -> tensor<i1>
+      %2 = stablehlo.negate %0 : tensor<f32>
+      %3 = stablehlo.select %1, %0, %2 : tensor<i1>, tensor<f32>
+      %4 = stablehlo.convert %3 : (tensor<f32>) -> tensor<i32>
+      stablehlo.return %4 : tensor<i32>
+  }) {
+    dimensions = array<i64: 0, 1>
+  } : (tensor<2x2xf32>, tensor<2x2xf32>) -> tensor<2x2xi32>
+  check.expect_eq_const %result, dense<[[1, 2], [6, 8]]> : tensor<2x2xi32>
+  func.return
+}
+
+// -----
+
+func.func @map_op_test_returns_constant() {
+  %input = stablehlo.constant dense<[1, 2, 3]> : tensor<3xi64>
+  %result = "stablehlo.map"(%input) ({
+    ^bb0(%arg0: tensor<i64>):
+      %0 = stablehlo.constant dense<7> : tensor<i64>
+      stablehlo.return %0 : tensor<i64>
+  }) {
+    dimensions = array<i64: 0>
+  } : (tensor<3xi64>) -> tensor<3xi64>
+  check.expect_eq_const %result, dense<7> : tensor<3xi64>
+  func.return
+}
+
+// -----
+
+func.func @map_op_test_unfused_body() {
+  %input0 = stablehlo.constant dense<[1, 2, 3]> : tensor<3xi64>
+  %input1 = stablehlo.constant dense<[10, 20, 30]> : tensor<3xi64>
+  %result = "stablehlo.map"(%input0, %input1) ({
+    ^bb0(%arg0: tensor<i64>, %arg1: tensor<i64>):
+      %0 = stablehlo.reshape %arg1 : (tensor<i64>) -> tensor<i64>
+      %1 = stablehlo.subtract %0, %arg0 : tensor<i64>
+      stablehlo.return %1 : tensor<i64>
+  }) {
+    dimensions = array<i64: 0>
+  } : (tensor<3xi64>, tensor<3xi64>) -> tensor<3xi64>
+  check.expect_eq_const %result, dense<[9, 18, 27]> : tensor<3xi64>
+  func.return
+}
@@ -0,0 +1,16 @@
+// RUN: not stablehlo-translate --interpret --memory-limit=600 %s 2>&1 | FileCheck %s
+// RUN: stablehlo-translate --interpret --print-memory-statistics %s 2>&1 | FileCheck %s --check-prefix=STATS
+
+// CHECK: Interpreter memory limit of 600 bytes exceeded by an allocation of 256 bytes in stablehlo.add
+// CHECK: bytes: stablehlo.iota
+
+// STATS: Interpreter memory by op
+// STATS: Live bytes: 0
+// STATS: 256 {{ +}}0  stablehlo.add at
+func.func @main() -> (tensor<64xf32>, tensor<64xf32>, tensor<64xf32>) {
+  %lhs = stablehlo.iota dim = 0 : tensor<64xf32>
+  %rhs = stablehlo.negate %lhs : tensor<64xf32>
+  // Both operands stay live, so that the sum can't reuse their storage.
+  %sum = stablehlo.add %lhs, %rhs : tensor<64xf32>
+  func.return %lhs, %rhs, %sum : tensor<64xf32>, tensor<64xf32>, tensor<64xf32>
+}
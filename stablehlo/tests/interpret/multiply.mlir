@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
 
 func.func @mul_op_test_si8() {
   %0 = stablehlo.constant dense<[0, 1, 8, -9, 0]> : tensor<5xi8>
@@ -91,6 +92,16 @@ func.func @mul_op_test_i1() {
 
 // -----
 
+func.func @mul_op_test_f8E5M2FNUZ() {
+  %0 = stablehlo.constant dense<[1.5, -2.0, 3.0, 0.75]> : tensor<4xf8E5M2FNUZ>
+  %1 = stablehlo.constant dense<[2.0, 0.0, 0.5, 1.25]> : tensor<4xf8E5M2FNUZ>
+  %2 = stablehlo.multiply %0, %1 : tensor<4xf8E5M2FNUZ>
+  check.expect_eq_const %2, dense<[3.0, 0.0, 1.5, 1.0]> : tensor<4xf8E5M2FNUZ>
+  func.return
+}
+
+// -----
+
 func.func @mul_op_test_bf16() {
   %0 = stablehlo.constant dense<[0.0, -0.0, 1.0, 0.125, 0.1, 3.141, 0x7C00, 0x7C00, 0xFC00, 0x7C00, 0x0001]> : tensor<11xbf16>
   %1 = stablehlo.constant dense<[0.0, -0.0, 7.0, 0.75, 0.3, 3.141, 0.0, 0x7C00, 0xFC00, 0xFC00, 0x8001]> : tensor<11xbf16>
@@ -14,3 +14,38 @@ func.func @pad() {
                            [-1, -1, -1, -1, -1]]> : tensor<7x5xi64>
   func.return
 }
+
+// -----
+
+func.func @pad_splat() {
+  %operand = stablehlo.constant dense<2> : tensor<2x3xi64>
+  %padding_value = stablehlo.constant dense<2> : tensor<i64>
+  %result = stablehlo.pad %operand, %padding_value, low = [1, 0], high = [0, -1], interior = [1, 1]
+    : (tensor<2x3xi64>, tensor<i64>) -> tensor<4x4xi64>
+  check.expect_eq_const %result, dense<2> : tensor<4x4xi64>
+  func.return
+}
+
+// -----
+
+func.func @pad_splat_with_other_value() {
+  %operand = stablehlo.constant dense<1.0> : tensor<2x2xf32>
+  %padding_value = stablehlo.constant dense<0.0> : tensor<f32>
+  %result = stablehlo.pad %operand, %padding_value, low = [-1, 1], high = [1, 0], interior = [1, 0]
+    : (tensor<2x2xf32>, tensor<f32>) -> tensor<3x3xf32>
+  check.expect_eq_const %result, dense<[[0.0, 0.0, 0.0], [0.0, 1.0, 1.0],
+                                        [0.0, 0.0, 0.0]]> : tensor<3x3xf32>
+  func.return
+}
+
+// -----
+
+func.func @pad_no_interior() {
+  %operand = stablehlo.constant dense<[[1, 2, 3], [4, 5, 6]]> : tensor<2x3xi64>
+  %padding_value = stablehlo.constant dense<-1> : tensor<i64>
+  %result = stablehlo.pad %operand, %padding_value, low = [1, -1], high = [0, 1], interior = [0, 0]
+    : (tensor<2x3xi64>, tensor<i64>) -> tensor<3x3xi64>
+  check.expect_eq_const %result, dense<[[-1, -1, -1], [2, 3, -1],
+                                        [5, 6, -1]]> : tensor<3x3xi64>
+  func.return
+}
@@ -1,4 +1,6 @@
 // RUN: stablehlo-translate --interpret --probe-output-dir=%T -split-input-file %s
+// RUN: stablehlo-translate --interpret --probe-output-dir=%T --probe-queue-capacity=0 -split-input-file %s
+// RUN: stablehlo-translate --interpret --probe-output-dir=%T --probe-container -split-input-file %s
 
 // Test an empty module
 
@@ -0,0 +1,16 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: stablehlo-translate --interpret --probe-output-dir=%t %s
+// RUN: FileCheck %s --input-file=%t/index.csv
+
+// CHECK: probe_digest,tensor<4xf32>,digest:[[HASH:[0-9a-f]{16}]]:[[QUANTIZED:[0-9a-f]{16}]]:1:6:3{{$}}
+// CHECK-NEXT: probe_digest_rounded,tensor<4xf32>,digest:{{[0-9a-f]{16}}}:[[QUANTIZED]]:1.0000001192092896:6:3.0000000298023224{{$}}
+// CHECK-NEXT: probe_digest_same,tensor<4xf32>,digest:[[HASH]]:[[QUANTIZED]]:1:6:3{{$}}
+func.func @probe_digest() {
+  %0 = stablehlo.constant dense<[1.0, 2.0, 3.0, 6.0]> : tensor<4xf32>
+  %1 = interpreter.probe %0, probe_id = "probe_digest" {digest} : tensor<4xf32>
+  %2 = stablehlo.constant dense<[1.0000001, 2.0, 3.0, 6.0]> : tensor<4xf32>
+  %3 = interpreter.probe %2, probe_id = "probe_digest_rounded" {digest} : tensor<4xf32>
+  %4 = stablehlo.constant dense<[1.0, 2.0, 3.0, 6.0]> : tensor<4xf32>
+  %5 = interpreter.probe %4, probe_id = "probe_digest_same" {digest} : tensor<4xf32>
+  func.return
+}
@@ -0,0 +1,32 @@
+// RUN: stablehlo-translate --interpret --probe-output-dir=%T --probe-sampling-interval=2 %s
+// RUN: stablehlo-translate --interpret --probe-output-dir=%T --probe-sampling-interval=2 --probe-container %s
+
+func.func @probe_sampling() {
+  // int i = 0;
+  // int sum = 0;
+  // while (i < 4) {
+  //   sum += 1;
+  //   i += 1;
+  // }
+  %init_i = stablehlo.constant dense<0> : tensor<i64>
+  %init_sum = stablehlo.constant dense<0> : tensor<i64>
+  %one = stablehlo.constant dense<1> : tensor<i64>
+  %three = stablehlo.constant dense<3> : tensor<i64>
+  %four = stablehlo.constant dense<4> : tensor<i64>
+  %results0, %results1 = stablehlo.while(%arg0 = %init_i, %arg1 = %init_sum) : tensor<i64>, tensor<i64>
+  cond {
+    %cond = stablehlo.compare LT, %arg0, %four : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %cond : tensor<i1>
+  } do {
+    %new_sum = stablehlo.add %arg1, %one : tensor<i64>
+    %new_sum_instrumented = interpreter.probe %new_sum, probe_id = "probe_sampling" : tensor<i64>
+    %new_i = stablehlo.add %arg0, %one : tensor<i64>
+    stablehlo.return %new_i, %new_sum_instrumented : tensor<i64>, tensor<i64>
+  }
+
+  // Only the 1st and 3rd iterations are serialized.
+  check.expect_eq_const %results0, dense<4> : tensor<i64>
+  check.expect_serialized_eq %one, probe_id = "probe_sampling", iter = 0 : tensor<i64>
+  check.expect_serialized_eq %three, probe_id = "probe_sampling", iter = 1 : tensor<i64>
+  func.return
+}
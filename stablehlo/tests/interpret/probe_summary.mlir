@@ -0,0 +1,9 @@
+// RUN: stablehlo-translate --interpret --probe-output-dir=%T %s
+
+func.func @probe_summary() {
+  %0 = stablehlo.constant dense<[1.0, 2.0, 3.0, 6.0]> : tensor<4xf32>
+  %1 = interpreter.probe %0, probe_id = "probe_summary" {summarize} : tensor<4xf32>
+  %summary = stablehlo.constant dense<[1.0, 6.0, 3.0, 5084696943752531.0]> : tensor<4xf64>
+  check.expect_serialized_eq %summary, probe_id = "probe_summary" : tensor<4xf64>
+  func.return
+}
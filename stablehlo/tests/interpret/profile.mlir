@@ -0,0 +1,30 @@
+// RUN: stablehlo-translate --interpret --interpreter-profile=%t.txt --interpreter-profile-trace=%t.json %s
+// RUN: FileCheck %s --check-prefix=TABLE < %t.txt
+// RUN: FileCheck %s --check-prefix=TRACE < %t.json
+
+// TABLE: Interpreter profile by op
+// TABLE: Time (ms)
+// TABLE-DAG: {{ 3 +12 +[0-9]+}}  stablehlo.add
+// TABLE-DAG: {{ 1 +4 +[0-9]+}}  stablehlo.while
+// TABLE: Interpreter profile by location
+// TABLE: profile.mlir
+
+// TRACE: "traceEvents":[
+// TRACE-SAME: "name":"stablehlo.while","cat":"op","ph":"X"
+func.func @main() {
+  %init = stablehlo.constant dense<0> : tensor<4xi64>
+  %one = stablehlo.constant dense<1> : tensor<4xi64>
+  %result = stablehlo.while(%iterArg = %init) : tensor<4xi64>
+  cond {
+    %limit = stablehlo.constant dense<3> : tensor<i64>
+    %first = stablehlo.slice %iterArg [0:1] : (tensor<4xi64>) -> tensor<1xi64>
+    %element = stablehlo.reshape %first : (tensor<1xi64>) -> tensor<i64>
+    %cond = stablehlo.compare LT, %element, %limit : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %cond : tensor<i1>
+  } do {
+    %next = stablehlo.add %iterArg, %one : tensor<4xi64>
+    stablehlo.return %next : tensor<4xi64>
+  }
+  check.expect_eq_const %result, dense<3> : tensor<4xi64>
+  func.return
+}
@@ -1,4 +1,7 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+// RUN: stablehlo-translate --interpret --pairwise-summation -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 -split-input-file %s
 
 func.func @reduce() {
   %input = stablehlo.constant dense<[[0, 1, 2, 3, 4, 5]]> : tensor<1x6xi64>
@@ -13,3 +16,35 @@ func.func @reduce() {
   check.expect_eq_const %result, dense<[15]> : tensor<1xi64>
   func.return
 }
+
+// -----
+
+func.func @reduce_max_f32() {
+  %input = stablehlo.constant dense<[[1.0, -2.0, 3.0], [-4.0, 5.0, -0.0]]> : tensor<2x3xf32>
+  %init_value = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %result = "stablehlo.reduce"(%input, %init_value) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %0 = stablehlo.maximum %arg1, %arg0 : tensor<f32>
+      stablehlo.return %0 : tensor<f32>
+  }) {
+    dimensions = array<i64: 0>
+  } : (tensor<2x3xf32>, tensor<f32>) -> tensor<3xf32>
+  check.expect_eq_const %result, dense<[1.0, 5.0, 3.0]> : tensor<3xf32>
+  func.return
+}
+
+// -----
+
+func.func @reduce_sum_f32() {
+  %input = stablehlo.constant dense<[[[0.5, 1.5], [2.5, 3.5]], [[4.5, 5.5], [6.5, 7.5]]]> : tensor<2x2x2xf32>
+  %init_value = stablehlo.constant dense<1.0> : tensor<f32>
+  %result = "stablehlo.reduce"(%input, %init_value) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %0 = stablehlo.add %arg0, %arg1 : tensor<f32>
+      stablehlo.return %0 : tensor<f32>
+  }) {
+    dimensions = array<i64: 0, 2>
+  } : (tensor<2x2x2xf32>, tensor<f32>) -> tensor<2xf32>
+  check.expect_eq_const %result, dense<[13.0, 21.0]> : tensor<2xf32>
+  func.return
+}
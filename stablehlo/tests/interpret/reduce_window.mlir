@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
 
 func.func @reduce_window() {
   %input = stablehlo.constant dense<[[1, 2], [3, 4], [5, 6]]> : tensor<3x2xi64>
@@ -37,3 +38,21 @@ func.func @reduce_window_issue_1662() {
   check.expect_eq_const %result, dense<[[5, 6]]> : tensor<1x2xi64>
   func.return
 }
+
+// -----
+
+func.func @reduce_window_max_f32() {
+  %input = stablehlo.constant dense<[[1.0, 2.0, 3.0], [4.0, 5.0, 6.0]]> : tensor<2x3xf32>
+  %init_value = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %result = "stablehlo.reduce_window"(%input, %init_value) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %0 = stablehlo.maximum %arg0, %arg1 : tensor<f32>
+      stablehlo.return %0 : tensor<f32>
+  }) {
+    padding = dense<[[0, 0], [1, 1]]> : tensor<2x2xi64>,
+    window_dimensions = array<i64: 2, 2>,
+    window_strides = array<i64: 1, 2>
+  } : (tensor<2x3xf32>, tensor<f32>) -> tensor<1x2xf32>
+  check.expect_eq_const %result, dense<[[4.0, 6.0]]> : tensor<1x2xf32>
+  func.return
+}
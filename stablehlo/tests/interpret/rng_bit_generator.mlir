@@ -0,0 +1,75 @@
+// RUN: stablehlo-translate --interpret -split-input-file %s
+
+// Known answers of ThreeFry-2x32 with 20 rounds for a zero key and counter.
+func.func @rng_bit_generator_op_test_three_fry_ui32() {
+  %initial_state = stablehlo.constant dense<[0, 0]> : tensor<2xui64>
+  %output_state, %output = stablehlo.rng_bit_generator %initial_state, algorithm = THREE_FRY : (tensor<2xui64>) -> (tensor<2xui64>, tensor<2xui32>)
+  check.expect_eq_const %output_state, dense<[0, 1]> : tensor<2xui64>
+  check.expect_eq_const %output, dense<[1797259609, 2579123966]> : tensor<2xui32>
+  func.return
+}
+
+// -----
+
+// Known answers of Philox-4x32 with 10 rounds for a zero key and counter.
+func.func @rng_bit_generator_op_test_philox_ui32() {
+  %initial_state = stablehlo.constant dense<[0, 0]> : tensor<2xui64>
+  %output_state, %output = stablehlo.rng_bit_generator %initial_state, algorithm = PHILOX : (tensor<2xui64>) -> (tensor<2xui64>, tensor<4xui32>)
+  check.expect_eq_const %output_state, dense<[0, 1]> : tensor<2xui64>
+  check.expect_eq_const %output, dense<[1713891541, 3781805453, 3159862348, 2600524760]> : tensor<4xui32>
+  func.return
+}
+
+// -----
+
+func.func @rng_bit_generator_op_test_three_fry_ui64() {
+  %initial_state = stablehlo.constant dense<[81985529216486895, 42]> : tensor<2xui64>
+  %output_state, %output = stablehlo.rng_bit_generator %initial_state, algorithm = THREE_FRY : (tensor<2xui64>) -> (tensor<2xui64>, tensor<3xui64>)
+  check.expect_eq_const %output_state, dense<[81985529216486895, 45]> : tensor<2xui64>
+  check.expect_eq_const %output, dense<[10630876682261374401, 8359708655467283337, 17970838074844490493]> : tensor<3xui64>
+  func.return
+}
+
+// -----
+
+// Without dimensions of even size, the two words of every counter are
+// interleaved along the largest dimension.
+func.func @rng_bit_generator_op_test_three_fry_odd_shape() {
+  %initial_state = stablehlo.constant dense<[81985529216486895, 5, 99]> : tensor<3xui64>
+  %output_state, %output = stablehlo.rng_bit_generator %initial_state, algorithm = THREE_FRY : (tensor<3xui64>) -> (tensor<3xui64>, tensor<3x5xui32>)
+  check.expect_eq_const %output_state, dense<[81985529216486895, 14, 99]> : tensor<3xui64>
+  check.expect_eq_const %output, dense<[[2963079838, 2105865281, 1822680882, 2755357497, 3356640791],
+                                        [3039885333, 3989734403, 2516300363, 2731057536, 3933500718],
+                                        [3928695743, 741696269, 957681320, 1269266626, 1817843789]]> : tensor<3x5xui32>
+  func.return
+}
+
+// -----
+
+func.func @rng_bit_generator_op_test_three_fry_ui16() {
+  %initial_state = stablehlo.constant dense<[38654705671, 100]> : tensor<2xui64>
+  %output_state, %output = stablehlo.rng_bit_generator %initial_state, algorithm = THREE_FRY : (tensor<2xui64>) -> (tensor<2xui64>, tensor<2x3xui16>)
+  check.expect_eq_const %output_state, dense<[38654705671, 103]> : tensor<2xui64>
+  check.expect_eq_const %output, dense<[[32927, 44362, 52289], [2294, 4322, 49060]]> : tensor<2x3xui16>
+  func.return
+}
+
+// -----
+
+func.func @rng_bit_generator_op_test_default_ui8() {
+  %initial_state = stablehlo.constant dense<[38654705671, 100]> : tensor<2xui64>
+  %output_state, %output = stablehlo.rng_bit_generator %initial_state, algorithm = DEFAULT : (tensor<2xui64>) -> (tensor<2xui64>, tensor<6xui8>)
+  check.expect_eq_const %output_state, dense<[38654705671, 102]> : tensor<2xui64>
+  check.expect_eq_const %output, dense<[149, 110, 72, 161, 139, 184]> : tensor<6xui8>
+  func.return
+}
+
+// -----
+
+func.func @rng_bit_generator_op_test_philox_ui64_ui32_state() {
+  %initial_state = stablehlo.constant dense<[1, 2, 0, 0]> : tensor<4xui32>
+  %output_state, %output = stablehlo.rng_bit_generator %initial_state, algorithm = PHILOX : (tensor<4xui32>) -> (tensor<4xui32>, tensor<3xui64>)
+  check.expect_eq_const %output_state, dense<[1, 2, 2, 0]> : tensor<4xui32>
+  check.expect_eq_const %output, dense<[1465308267099262272, 1254233441902744384, 163450122269602725]> : tensor<3xui64>
+  func.return
+}
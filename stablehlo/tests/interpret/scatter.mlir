@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
 
 func.func @scatter_op_test() {
   %inputs = stablehlo.constant dense<[[[1, 2], [3, 4], [5, 6], [7, 8]],
@@ -81,3 +82,95 @@ func.func @scatter_op_with_batching_dim_test() {
   ]> : tensor<2x3x4x2xi64>
   func.return
 }
+
+// -----
+
+func.func @scatter_op_test_input_reused() {
+  %inputs = stablehlo.constant dense<[1, 2, 3, 4]> : tensor<4xi64>
+  %scatter_indices = stablehlo.constant dense<[[1]]> : tensor<1x1xi64>
+  %updates = stablehlo.constant dense<[10]> : tensor<1xi64>
+  %result = "stablehlo.scatter"(%inputs, %scatter_indices, %updates) ({
+    ^bb0(%arg0: tensor<i64>, %arg1: tensor<i64>):
+      %0 = stablehlo.add %arg0, %arg1 : tensor<i64>
+      stablehlo.return %0 : tensor<i64>
+  }) {
+    scatter_dimension_numbers = #stablehlo.scatter<
+      inserted_window_dims = [0],
+      scatter_dims_to_operand_dims = [0],
+      index_vector_dim = 1>,
+    indices_are_sorted = false,
+    unique_indices = false
+  } : (tensor<4xi64>, tensor<1x1xi64>, tensor<1xi64>) -> tensor<4xi64>
+  check.expect_eq_const %result, dense<[1, 12, 3, 4]> : tensor<4xi64>
+  check.expect_eq_const %inputs, dense<[1, 2, 3, 4]> : tensor<4xi64>
+  func.return
+}
+
+// -----
+
+func.func @scatter_op_embedding_gradient_test() {
+  %inputs = stablehlo.constant dense<0> : tensor<4x2xi32>
+  %scatter_indices = stablehlo.constant dense<[[1], [3], [1], [5]]> : tensor<4x1xi64>
+  %updates = stablehlo.constant dense<[[1, 2], [3, 4], [5, 6], [7, 8]]> : tensor<4x2xi32>
+  %result = "stablehlo.scatter"(%inputs, %scatter_indices, %updates) ({
+    ^bb0(%arg0: tensor<i32>, %arg1: tensor<i32>):
+      %0 = stablehlo.add %arg0, %arg1 : tensor<i32>
+      stablehlo.return %0 : tensor<i32>
+  }) {
+    scatter_dimension_numbers = #stablehlo.scatter<
+      update_window_dims = [1],
+      inserted_window_dims = [0],
+      scatter_dims_to_operand_dims = [0],
+      index_vector_dim = 1>,
+    indices_are_sorted = false,
+    unique_indices = false
+  } : (tensor<4x2xi32>, tensor<4x1xi64>, tensor<4x2xi32>) -> tensor<4x2xi32>
+  check.expect_eq_const %result, dense<[[0, 0], [6, 8], [0, 0], [3, 4]]> : tensor<4x2xi32>
+  func.return
+}
+
+// -----
+
+func.func @scatter_op_replace_test() {
+  %inputs = stablehlo.constant dense<[[1.0, 2.0, 3.0], [4.0, 5.0, 6.0]]> : tensor<2x3xf32>
+  %scatter_indices = stablehlo.constant dense<[[0, 1], [1, 2]]> : tensor<2x2xi32>
+  %updates = stablehlo.constant dense<[[-1.0, -2.0], [-3.0, -4.0]]> : tensor<2x2xf32>
+  %result = "stablehlo.scatter"(%inputs, %scatter_indices, %updates) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      stablehlo.return %arg1 : tensor<f32>
+  }) {
+    scatter_dimension_numbers = #stablehlo.scatter<
+      update_window_dims = [1],
+      inserted_window_dims = [0],
+      scatter_dims_to_operand_dims = [0, 1],
+      index_vector_dim = 1>,
+    indices_are_sorted = false,
+    unique_indices = false
+  } : (tensor<2x3xf32>, tensor<2x2xi32>, tensor<2x2xf32>) -> tensor<2x3xf32>
+  check.expect_eq_const %result, dense<[[1.0, -1.0, -2.0], [4.0, 5.0, -3.0]]> : tensor<2x3xf32>
+  func.return
+}
+
+// -----
+
+func.func @scatter_op_compiled_update_computation_test() {
+  %inputs = stablehlo.constant dense<[1, 1, 1, 1]> : tensor<4xi32>
+  %scatter_indices = stablehlo.constant dense<[[1], [3], [1]]> : tensor<3x1xi64>
+  %updates = stablehlo.constant dense<[2, 3, 4]> : tensor<3xi32>
+  %result = "stablehlo.scatter"(%inputs, %scatter_indices, %updates) ({
+    ^bb0(%arg0: tensor<i32>, %arg1: tensor<i32>):
+      %0 = stablehlo.multiply %arg1, %arg1 : tensor<i32>
+      %1 = stablehlo.add %arg0, %0 : tensor<i32>
+      stablehlo.return %1 : tensor<i32>
+  }) {
+    scatter_dimension_numbers = #stablehlo.scatter<
+      update_window_dims = [],
+      inserted_window_dims = [0],
+      scatter_dims_to_operand_dims = [0],
+      index_vector_dim = 1>,
+    indices_are_sorted = false,
+    unique_indices = false
+  } : (tensor<4xi32>, tensor<3x1xi64>, tensor<3xi32>) -> tensor<4xi32>
+  check.expect_eq_const %result, dense<[1, 21, 1, 10]> : tensor<4xi32>
+  func.return
+}
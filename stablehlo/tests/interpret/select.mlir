@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
 
 func.func @select_op_test_si64() {
   %pred = stablehlo.constant dense<[true, false, true]> : tensor<3xi1>
@@ -19,3 +20,14 @@ func.func @select_op_test_si64_scalar() {
   check.expect_eq_const %result, dense<[3, 7, -3]> : tensor<3xi64>
   func.return
 }
+
+// -----
+
+func.func @select_op_test_splat() {
+  %pred = stablehlo.constant dense<[[true, false], [false, true]]> : tensor<2x2xi1>
+  %on_true = stablehlo.constant dense<1.5> : tensor<2x2xf32>
+  %on_false = stablehlo.constant dense<-1.5> : tensor<2x2xf32>
+  %result = stablehlo.select %pred, %on_true, %on_false : (tensor<2x2xi1>, tensor<2x2xf32>, tensor<2x2xf32>) -> tensor<2x2xf32>
+  check.expect_eq_const %result, dense<[[1.5, -1.5], [-1.5, 1.5]]> : tensor<2x2xf32>
+  func.return
+}
@@ -27,3 +27,27 @@ func.func @select_and_scatter_op_test() {
                                         [7, 0]]> : tensor<4x2xi64>
   func.return
 }
+
+// -----
+
+func.func @select_and_scatter_op_test_max_pool_grad() {
+  %operand = stablehlo.constant dense<[[1.0, 3.0, 2.0, 4.0]]> : tensor<1x4xf32>
+  %source = stablehlo.constant dense<[[1.0, 2.0]]> : tensor<1x2xf32>
+  %init_value = stablehlo.constant dense<0.0> : tensor<f32>
+  %result = "stablehlo.select_and_scatter"(%operand, %source, %init_value) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %0 = stablehlo.compare GE, %arg0, %arg1, FLOAT : (tensor<f32>, tensor<f32>) -> tensor<i1>
+      stablehlo.return %0 : tensor<i1>
+  }, {
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %0 = stablehlo.constant dense<2.0> : tensor<f32>
+      %1 = stablehlo.multiply %arg1, %0 : tensor<f32>
+      %2 = stablehlo.add %arg0, %1 : tensor<f32>
+      stablehlo.return %2 : tensor<f32>
+  }) {
+    window_dimensions = array<i64: 1, 2>,
+    window_strides = array<i64: 1, 2>
+  } : (tensor<1x4xf32>, tensor<1x2xf32>, tensor<f32>) -> tensor<1x4xf32>
+  check.expect_almost_eq_const %result, dense<[[0.0, 2.0, 0.0, 4.0]]> : tensor<1x4xf32>
+  func.return
+}
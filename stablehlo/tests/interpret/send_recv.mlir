@@ -1,4 +1,7 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 --dataflow-execution -split-input-file %s
+// RUN: stablehlo-translate --interpret --collective-timeout-ms=0 -split-input-file %s
+// RUN: stablehlo-translate --interpret --channel-depth=2 --print-communication-statistics -split-input-file %s
 
 module @sequential_send_recv_same_channel {
   func.func @send(%operand : tensor<2x2xi64>, %token : !stablehlo.token) -> (!stablehlo.token, !stablehlo.token) {
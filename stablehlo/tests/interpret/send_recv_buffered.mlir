@@ -0,0 +1,50 @@
+// RUN: stablehlo-translate --interpret --channel-depth=2 %s
+
+// Both processes send before they receive, which only completes if the
+// channels buffer the messages.
+module @send_before_recv {
+  func.func @stage0(%operand : tensor<2x2xi64>, %token : !stablehlo.token) -> (tensor<2x2xi64>, !stablehlo.token) {
+    %token0 = "stablehlo.send"(%operand, %token) {
+      channel_handle = #stablehlo.channel_handle<handle = 1, type = 2>,
+      is_host_transfer = true
+    } : (tensor<2x2xi64>, !stablehlo.token) -> !stablehlo.token
+    %constant = stablehlo.constant dense<[[5, 6], [7, 8]]> : tensor<2x2xi64>
+    %token1 = "stablehlo.send"(%constant, %token0) {
+      channel_handle = #stablehlo.channel_handle<handle = 1, type = 2>,
+      is_host_transfer = true
+    } : (tensor<2x2xi64>, !stablehlo.token) -> !stablehlo.token
+    %results0, %results1 = "stablehlo.recv"(%token1) {
+      channel_handle = #stablehlo.channel_handle<handle = 2, type = 3>,
+      is_host_transfer = true
+    } : (!stablehlo.token) -> (tensor<2x2xi64>, !stablehlo.token)
+    return %results0, %results1 : tensor<2x2xi64>, !stablehlo.token
+  }
+  func.func @stage1(%token : !stablehlo.token) -> (tensor<2x2xi64>, tensor<2x2xi64>, !stablehlo.token) {
+    %constant = stablehlo.constant dense<[[9, 10], [11, 12]]> : tensor<2x2xi64>
+    %token0 = "stablehlo.send"(%constant, %token) {
+      channel_handle = #stablehlo.channel_handle<handle = 2, type = 2>,
+      is_host_transfer = true
+    } : (tensor<2x2xi64>, !stablehlo.token) -> !stablehlo.token
+    %results0, %results1 = "stablehlo.recv"(%token0) {
+      channel_handle = #stablehlo.channel_handle<handle = 1, type = 3>,
+      is_host_transfer = true
+    } : (!stablehlo.token) -> (tensor<2x2xi64>, !stablehlo.token)
+    %results2, %results3 = "stablehlo.recv"(%results1) {
+      channel_handle = #stablehlo.channel_handle<handle = 1, type = 3>,
+      is_host_transfer = true
+    } : (!stablehlo.token) -> (tensor<2x2xi64>, !stablehlo.token)
+    return %results0, %results2, %results3 : tensor<2x2xi64>, tensor<2x2xi64>, !stablehlo.token
+  }
+  func.func @main() {
+    %0 = stablehlo.constant dense<[[1, 2], [3, 4]]> : tensor<2x2xi64>
+    %1 = stablehlo.after_all : !stablehlo.token
+    %2:5 = "interpreter.run_parallel"(%0, %1, %1) {
+      programs=[[@stage0], [@stage1]]
+    } : (tensor<2x2xi64>, !stablehlo.token, !stablehlo.token) ->
+        (tensor<2x2xi64>, !stablehlo.token, tensor<2x2xi64>, tensor<2x2xi64>, !stablehlo.token)
+    check.expect_eq_const %2#0, dense<[[9, 10], [11, 12]]> : tensor<2x2xi64>
+    check.expect_eq_const %2#2, dense<[[1, 2], [3, 4]]> : tensor<2x2xi64>
+    check.expect_eq_const %2#3, dense<[[5, 6], [7, 8]]> : tensor<2x2xi64>
+    func.return
+  }
+}
@@ -1,4 +1,5 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
 
 func.func @slice_op() {
   %operand = stablehlo.constant dense<[[0, 0, 1, 0, 0, 1],
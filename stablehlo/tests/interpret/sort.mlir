@@ -1,4 +1,6 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 -split-input-file %s
 
 func.func @sort_stable() {
   %input0 = stablehlo.constant dense<[[1, 2, 3], [3, 2, 1]]> : tensor<2x3xi64>
@@ -15,3 +17,40 @@ func.func @sort_stable() {
   check.expect_eq_const %result1, dense<[[1, 2, 1], [3, 2, 3]]> : tensor<2x3xi64>
   func.return
 }
+
+// -----
+
+func.func @sort_by_second_input_descending() {
+  %input0 = stablehlo.constant dense<[[10, 20, 30, 40], [50, 60, 70, 80]]> : tensor<2x4xi64>
+  %input1 = stablehlo.constant dense<[[2.0, 4.0, 1.0, 3.0], [1.0, 2.0, 3.0, 2.0]]> : tensor<2x4xf32>
+  %result0, %result1 = "stablehlo.sort"(%input0, %input1) ({
+    ^bb0(%arg0: tensor<i64>, %arg1: tensor<i64>, %arg2: tensor<f32>, %arg3: tensor<f32>):
+      %predicate = stablehlo.compare LT, %arg3, %arg2 : (tensor<f32>, tensor<f32>) -> tensor<i1>
+      stablehlo.return %predicate : tensor<i1>
+  }) {
+    dimension = -1 : i64,
+    is_stable = true
+  } : (tensor<2x4xi64>, tensor<2x4xf32>) -> (tensor<2x4xi64>, tensor<2x4xf32>)
+  check.expect_eq_const %result0, dense<[[20, 40, 10, 30], [70, 60, 80, 50]]> : tensor<2x4xi64>
+  check.expect_almost_eq_const %result1, dense<[[4.0, 3.0, 2.0, 1.0], [3.0, 2.0, 2.0, 1.0]]> : tensor<2x4xf32>
+  func.return
+}
+
+// -----
+
+func.func @sort_totalorder() {
+  // +NaN, 1.0, -0.0, -Inf, +0.0, -NaN
+  %input = stablehlo.constant dense<[0x7FC00000, 1.0, 0x80000000, 0xFF800000, 0x00000000, 0xFFC00000]> : tensor<6xf32>
+  %result = "stablehlo.sort"(%input) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %predicate = stablehlo.compare LT, %arg0, %arg1, TOTALORDER : (tensor<f32>, tensor<f32>) -> tensor<i1>
+      stablehlo.return %predicate : tensor<i1>
+  }) {
+    dimension = 0 : i64,
+    is_stable = true
+  } : (tensor<6xf32>) -> tensor<6xf32>
+  %bits = stablehlo.bitcast_convert %result : (tensor<6xf32>) -> tensor<6xi32>
+  // -NaN, -Inf, -0.0, +0.0, 1.0, +NaN
+  check.expect_eq_const %bits, dense<[-4194304, -8388608, -2147483648, 0, 1065353216, 2143289344]> : tensor<6xi32>
+  func.return
+}
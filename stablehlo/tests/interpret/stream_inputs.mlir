@@ -0,0 +1,36 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: stablehlo-translate --interpret --probe-output-dir=%t %S/input_files_probe.mlir
+// RUN: stablehlo-translate --interpret --input-files=%t/probe1.npy,%t/probe2.npy --stream-inputs=0 --stream-chunk-size=8 %s
+// RUN: not stablehlo-translate --interpret --input-files=%t/probe1.npy,%t/probe2.npy --stream-inputs=1 %s 2>&1 | FileCheck %s
+
+func.func @main(%lhs: tensor<2x3xf32>, %rhs: tensor<3xi64>) {
+  %zero = stablehlo.constant dense<0.0> : tensor<f32>
+  %sum = "stablehlo.reduce"(%lhs, %zero) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %0 = stablehlo.add %arg0, %arg1 : tensor<f32>
+      stablehlo.return %0 : tensor<f32>
+  }) {
+    dimensions = array<i64: 0, 1>
+  } : (tensor<2x3xf32>, tensor<f32>) -> tensor<f32>
+  %row_sums = "stablehlo.reduce"(%lhs, %zero) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %0 = stablehlo.add %arg0, %arg1 : tensor<f32>
+      stablehlo.return %0 : tensor<f32>
+  }) {
+    dimensions = array<i64: 1>
+  } : (tensor<2x3xf32>, tensor<f32>) -> tensor<2xf32>
+  %min_value = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %column_maxima = "stablehlo.reduce"(%lhs, %min_value) ({
+    ^bb0(%arg0: tensor<f32>, %arg1: tensor<f32>):
+      %0 = stablehlo.maximum %arg0, %arg1 : tensor<f32>
+      stablehlo.return %0 : tensor<f32>
+  }) {
+    dimensions = array<i64: 0>
+  } : (tensor<2x3xf32>, tensor<f32>) -> tensor<3xf32>
+  check.expect_eq_const %sum, dense<21.0> : tensor<f32>
+  check.expect_eq_const %row_sums, dense<[6.0, 15.0]> : tensor<2xf32>
+  check.expect_eq_const %column_maxima, dense<[4.0, 5.0, 6.0]> : tensor<3xf32>
+  // CHECK: error: streamed arguments can only be the single input of reduce ops
+  check.expect_eq_const %rhs, dense<[-1, 0, 1]> : tensor<3xi64>
+  func.return
+}
@@ -0,0 +1,57 @@
+// RUN: not stablehlo-translate --interpret --test-threads=4 %s 2>&1 | FileCheck %s
+
+// Check failures don't abort the other tests, and are reported in the order
+// of the functions regardless of the order in which the tests finish.
+
+// CHECK-NOT: function: add_test
+// CHECK: error: Error evaluating function: first_failing_test.
+// CHECK-NOT: function: call_test
+// CHECK: error: Error evaluating function: second_failing_test.
+// CHECK: error: Error evaluating function: expect_doubled.
+// CHECK: func.func @helper_failing_test()
+
+func.func private @double(%arg0: tensor<2xi64>) -> tensor<2xi64> {
+  %0 = stablehlo.add %arg0, %arg0 : tensor<2xi64>
+  func.return %0 : tensor<2xi64>
+}
+
+func.func @add_test() {
+  %0 = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  %1 = stablehlo.add %0, %0 : tensor<2xi64>
+  check.expect_eq_const %1, dense<[2, 4]> : tensor<2xi64>
+  func.return
+}
+
+func.func @first_failing_test() {
+  %0 = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  check.expect_eq_const %0, dense<[1, 3]> : tensor<2xi64>
+  func.return
+}
+
+func.func @call_test() {
+  %0 = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  %1 = func.call @double(%0) : (tensor<2xi64>) -> tensor<2xi64>
+  check.expect_eq_const %1, dense<[2, 4]> : tensor<2xi64>
+  func.return
+}
+
+func.func @second_failing_test() {
+  %0 = stablehlo.constant dense<[1.0, 2.0]> : tensor<2xf32>
+  check.expect_almost_eq_const %0, dense<[1.0, 2.5]> : tensor<2xf32>
+  func.return
+}
+
+// Checks fail the test which is evaluated, even if they are in a function
+// which it calls.
+func.func private @expect_doubled(%arg0: tensor<2xi64>, %arg1: tensor<2xi64>) {
+  %0 = stablehlo.add %arg0, %arg0 : tensor<2xi64>
+  check.expect_eq %0, %arg1 : tensor<2xi64>
+  func.return
+}
+
+func.func @helper_failing_test() {
+  %0 = stablehlo.constant dense<[1, 2]> : tensor<2xi64>
+  %1 = stablehlo.constant dense<[2, 5]> : tensor<2xi64>
+  func.call @expect_doubled(%0, %1) : (tensor<2xi64>, tensor<2xi64>) -> ()
+  func.return
+}
@@ -1,4 +1,6 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 -split-input-file %s
+// RUN: stablehlo-translate --interpret --native-kernels=false -split-input-file %s
 
 func.func @transpose_op_test_si32() {
   %0 = stablehlo.constant dense<[[[1,2],[3,4],[5,6]], [[7,8],[9,10],[11,12]]]> : tensor<2x3x2xi32>
@@ -25,3 +27,23 @@ func.func @transpose_op_test_si32() {
   check.expect_eq_const %2, dense<[[[1, 2], [3, 4], [5, 6]], [[7, 8], [9, 10], [11, 12]]]> : tensor<2x3x2xi32>
   func.return
 }
+
+// -----
+
+func.func @transpose_slice_reshape_reverse() {
+  %0 = stablehlo.constant dense<[[1, 2, 3], [4, 5, 6]]> : tensor<2x3xi64>
+  %1 = "stablehlo.transpose"(%0) {permutation = array<i64: 1, 0>} : (tensor<2x3xi64>) -> tensor<3x2xi64>
+  %2 = "stablehlo.slice"(%1) {
+    start_indices = array<i64: 1, 0>,
+    limit_indices = array<i64: 3, 2>,
+    strides = array<i64: 1, 1>
+  } : (tensor<3x2xi64>) -> tensor<2x2xi64>
+  %3 = stablehlo.reshape %2 : (tensor<2x2xi64>) -> tensor<4xi64>
+  %4 = "stablehlo.reverse"(%3) {
+    dimensions = array<i64: 0>
+  } : (tensor<4xi64>) -> tensor<4xi64>
+  %5 = stablehlo.add %4, %4 : tensor<4xi64>
+  check.expect_eq_const %2, dense<[[2, 5], [3, 6]]> : tensor<2x2xi64>
+  check.expect_eq_const %5, dense<[12, 6, 10, 4]> : tensor<4xi64>
+  func.return
+}
@@ -0,0 +1,97 @@
+// RUN: stablehlo-translate --interpret -split-input-file %s
+
+func.func @triangular_solve_op_test_left_lower() {
+  %a = stablehlo.constant dense<[[1.0, 0.0, 0.0], [2.0, 4.0, 0.0], [3.0, 5.0, 6.0]]> : tensor<3x3xf32>
+  %b = stablehlo.constant dense<[[2.0, 0.0, 0.0], [4.0, 8.0, 0.0], [6.0, 10.0, 12.0]]> : tensor<3x3xf32>
+  %result = "stablehlo.triangular_solve"(%a, %b) {
+    left_side = true,
+    lower = true,
+    unit_diagonal = false,
+    transpose_a = #stablehlo<transpose NO_TRANSPOSE>
+  } : (tensor<3x3xf32>, tensor<3x3xf32>) -> tensor<3x3xf32>
+  check.expect_almost_eq_const %result, dense<[[2.0, 0.0, 0.0], [0.0, 2.0, 0.0], [0.0, 0.0, 2.0]]> : tensor<3x3xf32>
+  func.return
+}
+
+// -----
+
+func.func @triangular_solve_op_test_left_upper_transpose() {
+  %a = stablehlo.constant dense<[[1.0, 2.0, 3.0], [9.0, 4.0, 5.0], [9.0, 9.0, 6.0]]> : tensor<3x3xf64>
+  %b = stablehlo.constant dense<[[2.0, 0.0, 0.0], [4.0, 8.0, 0.0], [6.0, 10.0, 12.0]]> : tensor<3x3xf64>
+  %result = "stablehlo.triangular_solve"(%a, %b) {
+    left_side = true,
+    lower = false,
+    unit_diagonal = false,
+    transpose_a = #stablehlo<transpose TRANSPOSE>
+  } : (tensor<3x3xf64>, tensor<3x3xf64>) -> tensor<3x3xf64>
+  check.expect_almost_eq_const %result, dense<[[2.0, 0.0, 0.0], [0.0, 2.0, 0.0], [0.0, 0.0, 2.0]]> : tensor<3x3xf64>
+  func.return
+}
+
+// -----
+
+func.func @triangular_solve_op_test_right_lower() {
+  %a = stablehlo.constant dense<[[1.0, 0.0, 0.0], [2.0, 4.0, 0.0], [3.0, 5.0, 6.0]]> : tensor<3x3xf32>
+  %b = stablehlo.constant dense<[[14.0, 23.0, 18.0], [32.0, 50.0, 36.0]]> : tensor<2x3xf32>
+  %result = "stablehlo.triangular_solve"(%a, %b) {
+    left_side = false,
+    lower = true,
+    unit_diagonal = false,
+    transpose_a = #stablehlo<transpose NO_TRANSPOSE>
+  } : (tensor<3x3xf32>, tensor<2x3xf32>) -> tensor<2x3xf32>
+  check.expect_almost_eq_const %result, dense<[[1.0, 2.0, 3.0], [4.0, 5.0, 6.0]]> : tensor<2x3xf32>
+  func.return
+}
+
+// -----
+
+func.func @triangular_solve_op_test_unit_diagonal_batched() {
+  %a = stablehlo.constant dense<[[[7.0, 0.0], [2.0, 7.0]], [[7.0, 0.0], [3.0, 7.0]]]> : tensor<2x2x2xf32>
+  %b = stablehlo.constant dense<[[[1.0], [4.0]], [[1.0], [4.0]]]> : tensor<2x2x1xf32>
+  %result = "stablehlo.triangular_solve"(%a, %b) {
+    left_side = true,
+    lower = true,
+    unit_diagonal = true,
+    transpose_a = #stablehlo<transpose NO_TRANSPOSE>
+  } : (tensor<2x2x2xf32>, tensor<2x2x1xf32>) -> tensor<2x2x1xf32>
+  check.expect_almost_eq_const %result, dense<[[[1.0], [2.0]], [[1.0], [1.0]]]> : tensor<2x2x1xf32>
+  func.return
+}
+
+// -----
+
+func.func @triangular_solve_op_test_c64_adjoint() {
+  %a = stablehlo.constant dense<[[(2.0, 0.0), (0.0, 0.0)], [(1.0, 1.0), (1.0, 0.0)]]> : tensor<2x2xcomplex<f32>>
+  %b = stablehlo.constant dense<[[(2.0, 0.0)], [(1.0, 0.0)]]> : tensor<2x1xcomplex<f32>>
+  %result = "stablehlo.triangular_solve"(%a, %b) {
+    left_side = true,
+    lower = true,
+    unit_diagonal = false,
+    transpose_a = #stablehlo<transpose ADJOINT>
+  } : (tensor<2x2xcomplex<f32>>, tensor<2x1xcomplex<f32>>) -> tensor<2x1xcomplex<f32>>
+  check.expect_almost_eq_const %result, dense<[[(0.5, 0.5)], [(1.0, 0.0)]]> : tensor<2x1xcomplex<f32>>
+  func.return
+}
+
+// -----
+
+// Spans several panels of the blocked kernel: solving `L * X = L * L^T`
+// recovers `L^T`.
+func.func @triangular_solve_op_test_blocked() {
+  %rows = stablehlo.iota dim = 0 : tensor<100x100xi64>
+  %columns = stablehlo.iota dim = 1 : tensor<100x100xi64>
+  %diagonal = stablehlo.compare EQ, %rows, %columns : (tensor<100x100xi64>, tensor<100x100xi64>) -> tensor<100x100xi1>
+  %on_diagonal = stablehlo.constant dense<101.0> : tensor<100x100xf64>
+  %off_diagonal = stablehlo.constant dense<1.0> : tensor<100x100xf64>
+  %a = stablehlo.select %diagonal, %on_diagonal, %off_diagonal : tensor<100x100xi1>, tensor<100x100xf64>
+  %l = stablehlo.cholesky %a, lower = true : tensor<100x100xf64>
+  %result = "stablehlo.triangular_solve"(%l, %a) {
+    left_side = true,
+    lower = true,
+    unit_diagonal = false,
+    transpose_a = #stablehlo<transpose NO_TRANSPOSE>
+  } : (tensor<100x100xf64>, tensor<100x100xf64>) -> tensor<100x100xf64>
+  %expected = stablehlo.transpose %l, dims = [1, 0] : (tensor<100x100xf64>) -> tensor<100x100xf64>
+  check.expect_almost_eq %result, %expected : tensor<100x100xf64>
+  func.return
+}
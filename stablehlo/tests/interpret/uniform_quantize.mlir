@@ -0,0 +1,30 @@
+// RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 -split-input-file %s
+
+func.func @uniform_quantize_op_test() {
+  %operand = stablehlo.constant dense<[4.0, 15.0]> : tensor<2xf32>
+  %result = stablehlo.uniform_quantize %operand : (tensor<2xf32>) -> tensor<2x!quant.uniform<i8:f32:0, {0.1:-30,0.5:-20}>>
+  %requantized = stablehlo.uniform_quantize %result : (tensor<2x!quant.uniform<i8:f32:0, {0.1:-30,0.5:-20}>>) -> tensor<2x!quant.uniform<i8:f32:0, {0.1:-20,0.2:-30}>>
+  %dequantized = stablehlo.uniform_dequantize %requantized : (tensor<2x!quant.uniform<i8:f32:0, {0.1:-20,0.2:-30}>>) -> tensor<2xf32>
+  check.expect_almost_eq_const %dequantized, dense<[4.0, 15.0]> : tensor<2xf32>
+  func.return
+}
+
+// -----
+
+func.func @uniform_quantize_op_test_clamp() {
+  %operand = stablehlo.constant dense<[-100.0, 100.0, 1.25]> : tensor<3xf32>
+  %result = stablehlo.uniform_quantize %operand : (tensor<3xf32>) -> tensor<3x!quant.uniform<i4:f32, 0.5:1>>
+  %dequantized = stablehlo.uniform_dequantize %result : (tensor<3x!quant.uniform<i4:f32, 0.5:1>>) -> tensor<3xf32>
+  check.expect_almost_eq_const %dequantized, dense<[-4.5, 3.0, 1.5]> : tensor<3xf32>
+  func.return
+}
+
+// -----
+
+func.func @uniform_quantize_op_test_constant() {
+  %operand = stablehlo.constant() {value = dense<[10, -10]> : tensor<2xi8>} : () -> tensor<2x!quant.uniform<i8:f32, 0.5:-2>>
+  %dequantized = stablehlo.uniform_dequantize %operand : (tensor<2x!quant.uniform<i8:f32, 0.5:-2>>) -> tensor<2xf32>
+  check.expect_almost_eq_const %dequantized, dense<[6.0, -4.0]> : tensor<2xf32>
+  func.return
+}
@@ -1,4 +1,6 @@
 // RUN: stablehlo-translate --interpret -split-input-file %s
+// RUN: stablehlo-translate --interpret --buffer-pool-capacity=0 -split-input-file %s
+// RUN: stablehlo-translate --interpret --intra-op-threads=4 --dataflow-execution -split-input-file %s
 
 func.func @while() {
   // int i = 0;
@@ -24,3 +26,60 @@ func.func @while() {
   check.expect_eq_const %results1, dense<10> : tensor<i64>
   func.return
 }
+
+// -----
+
+func.func @while_dynamic_update_slice() {
+  // int i = 0;
+  // int values[3] = {0, 0, 0};
+  // while (i < 3) {
+  //   values[i] = i + 1;
+  //   i += 1;
+  // }
+  %init_i = stablehlo.constant dense<0> : tensor<i64>
+  %init_values = stablehlo.constant dense<0> : tensor<3xi64>
+  %one = stablehlo.constant dense<1> : tensor<i64>
+  %three = stablehlo.constant dense<3> : tensor<i64>
+  %results0, %results1 = stablehlo.while(%arg0 = %init_i, %arg1 = %init_values) : tensor<i64>, tensor<3xi64>
+  cond {
+    %cond = stablehlo.compare LT, %arg0, %three : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %cond : tensor<i1>
+  } do {
+    %new_i = stablehlo.add %arg0, %one : tensor<i64>
+    %update = stablehlo.reshape %new_i : (tensor<i64>) -> tensor<1xi64>
+    %new_values = stablehlo.dynamic_update_slice %arg1, %update, %arg0 : (tensor<3xi64>, tensor<1xi64>, tensor<i64>) -> tensor<3xi64>
+    stablehlo.return %new_i, %new_values : tensor<i64>, tensor<3xi64>
+  }
+  check.expect_eq_const %results0, dense<3> : tensor<i64>
+  check.expect_eq_const %results1, dense<[1, 2, 3]> : tensor<3xi64>
+  check.expect_eq_const %init_values, dense<0> : tensor<3xi64>
+  func.return
+}
+
+// -----
+
+func.func @while_update_cache_in_place() {
+  // Writes i to row i of a cache which is carried by the loop, and carries
+  // an unused value along.
+  %init_i = stablehlo.constant dense<0> : tensor<i64>
+  %init_cache = stablehlo.constant dense<0> : tensor<4x2xi64>
+  %unused = stablehlo.constant dense<7> : tensor<i64>
+  %zero = stablehlo.constant dense<0> : tensor<i64>
+  %one = stablehlo.constant dense<1> : tensor<i64>
+  %four = stablehlo.constant dense<4> : tensor<i64>
+  %results0, %results1, %results2 = stablehlo.while(%arg0 = %init_i, %arg1 = %init_cache, %arg2 = %unused) : tensor<i64>, tensor<4x2xi64>, tensor<i64>
+  cond {
+    %cond = stablehlo.compare LT, %arg0, %four : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %cond : tensor<i1>
+  } do {
+    %row = stablehlo.broadcast_in_dim %arg0, dims = [] : (tensor<i64>) -> tensor<1x2xi64>
+    %new_cache = stablehlo.dynamic_update_slice %arg1, %row, %arg0, %zero : (tensor<4x2xi64>, tensor<1x2xi64>, tensor<i64>, tensor<i64>) -> tensor<4x2xi64>
+    %new_i = stablehlo.add %arg0, %one : tensor<i64>
+    stablehlo.return %new_i, %new_cache, %arg2 : tensor<i64>, tensor<4x2xi64>, tensor<i64>
+  }
+  check.expect_eq_const %results0, dense<4> : tensor<i64>
+  check.expect_eq_const %results1, dense<[[0, 0], [1, 1], [2, 2], [3, 3]]> : tensor<4x2xi64>
+  check.expect_eq_const %results2, dense<7> : tensor<i64>
+  check.expect_eq_const %init_cache, dense<0> : tensor<4x2xi64>
+  func.return
+}
@@ -25,7 +25,7 @@ from lit.llvm import llvm_config
 # Some metadata is populated in lit.site.cfg.py.in.
 config.name = 'STABLEHLO_TESTS_SUITE'
 config.test_format = lit.formats.ShTest(not llvm_config.use_lit_shell)
-config.suffixes = ['.mlir']
+config.suffixes = ['.mlir', '.test', '.c']
 config.test_source_root = os.path.dirname(__file__)
 
 # Disallow reusing variables across CHECK-LABEL matches.
@@ -35,6 +35,8 @@ config.environment["FILECHECK_OPTS"] = "-enable-var-scope"
 # Make LLVM and StableHLO tools available in RUN directives
 tools = [
   'FileCheck',
+  'stablehlo-capi-interpreter-test',
+  'stablehlo-lsp-server',
   'stablehlo-opt',
   'stablehlo-translate',
   'not',
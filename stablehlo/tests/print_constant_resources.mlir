@@ -0,0 +1,30 @@
+// RUN: stablehlo-opt %s --stablehlo-print-constants-as-resources-larger-than=16 | FileCheck %s
+// RUN: stablehlo-opt %s --stablehlo-print-constants-as-resources-larger-than=16 | stablehlo-opt | FileCheck %s --check-prefix=ROUNDTRIP
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: stablehlo-opt %s --stablehlo-print-constants-as-resources-larger-than=16 --stablehlo-constant-resource-dir=%t | FileCheck %s --check-prefix=SIDECAR
+// RUN: stablehlo-opt %s --stablehlo-print-constants-as-resources-larger-than=16 --stablehlo-constant-resource-dir=%t | stablehlo-opt --stablehlo-constant-resource-dir=%t | FileCheck %s --check-prefix=ROUNDTRIP
+
+// CHECK-LABEL: func @constants
+// SIDECAR-LABEL: func @constants
+// ROUNDTRIP-LABEL: func @constants
+func.func @constants() -> (tensor<5xi32>, tensor<5xi32>, tensor<2xi32>, tensor<8xi32>) {
+  // CHECK:      %[[LARGE:.*]] = stablehlo.constant dense_resource<[[NAME:stablehlo_constant_[0-9a-f]+]]> : tensor<5xi32>
+  // CHECK-NEXT: %[[SAME:.*]] = stablehlo.constant dense_resource<[[NAME]]> : tensor<5xi32>
+  // CHECK-NEXT: stablehlo.constant dense<[1, 2]> : tensor<2xi32>
+  // CHECK-NEXT: stablehlo.constant dense<3> : tensor<8xi32>
+  // SIDECAR:      stablehlo.constant dense_resource<stablehlo_external_{{[0-9a-f]+}}> : tensor<5xi32>
+  // SIDECAR-NOT:  dialect_resources
+  // ROUNDTRIP:      stablehlo.constant dense_resource<{{.*}}> : tensor<5xi32>
+  // ROUNDTRIP:      stablehlo.constant dense<[1, 2]> : tensor<2xi32>
+  %0 = stablehlo.constant dense<[1, 2, 3, 4, 5]> : tensor<5xi32>
+  %1 = stablehlo.constant dense<[1, 2, 3, 4, 5]> : tensor<5xi32>
+  %2 = stablehlo.constant dense<[1, 2]> : tensor<2xi32>
+  %3 = stablehlo.constant dense<3> : tensor<8xi32>
+  return %0, %1, %2, %3 : tensor<5xi32>, tensor<5xi32>, tensor<2xi32>, tensor<8xi32>
+}
+
+// CHECK:      dialect_resources
+// CHECK-NEXT: builtin
+// CHECK-NEXT: [[NAME]]: "0x080000000100000002000000030000000400000005000000"
+// ROUNDTRIP:  dialect_resources
+// ROUNDTRIP:  "0x080000000100000002000000030000000400000005000000"
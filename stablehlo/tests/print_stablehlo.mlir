@@ -73,6 +73,27 @@ func.func @constants() -> () {
   return
 }
 
+// CHECK-LABEL: func @dense_constants
+func.func @dense_constants() -> () {
+  // CHECK:      stablehlo.constant dense<{{\[}}[1, -2], [3, 4]]> : tensor<2x2xi32>
+  // CHECK-NEXT: stablehlo.constant dense<[1.500000e+00, -2.000000e+00, 0x7F800000]> : tensor<3xf32>
+  // CHECK-NEXT: stablehlo.constant dense<[true, false]> : tensor<2xi1>
+  // CHECK-NEXT: stablehlo.constant dense<[255, 0]> : tensor<2xui8>
+  // CHECK-NEXT: stablehlo.constant dense<(1.000000e+00,-2.000000e+00)> : tensor<complex<f32>>
+  // CHECK-NEXT: stablehlo.constant dense<[1, 2, 3, 4]> : tensor<4xi16>
+  // CHECK-NEXT: stablehlo.constant dense<7> : tensor<3xi4>
+  // CHECK-NEXT: stablehlo.constant dense<> : tensor<0x2xf32>
+  %0 = stablehlo.constant dense<[[1, -2], [3, 4]]> : tensor<2x2xi32>
+  %1 = stablehlo.constant dense<[1.5, -2.0, 0x7F800000]> : tensor<3xf32>
+  %2 = stablehlo.constant dense<[true, false]> : tensor<2xi1>
+  %3 = stablehlo.constant dense<[255, 0]> : tensor<2xui8>
+  %4 = stablehlo.constant dense<(1.0, -2.0)> : tensor<complex<f32>>
+  %5 = stablehlo.constant dense<"0x0100020003000400"> : tensor<4xi16>
+  %6 = stablehlo.constant dense<[7, 7, 7]> : tensor<3xi4>
+  %7 = stablehlo.constant dense<> : tensor<0x2xf32>
+  return
+}
+
 // CHECK-LABEL: func @unary_ops
 func.func @unary_ops(%arg0 : tensor<2xi32>, %arg1 : tensor<2xf32>) -> () {
   // CHECK:      %0 = stablehlo.abs %arg0 : tensor<2xi32>
@@ -0,0 +1,30 @@
+// RUN: stablehlo-opt --shape-legalize-to-stablehlo=hoist-shape-computations --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func.func @shape_of_deduplicated
+func.func @shape_of_deduplicated(%arg0: tensor<?x4xf32>) -> (tensor<?x4xf32>, tensor<2xindex>, tensor<2xindex>) {
+  //      CHECK: %[[SIZE0:.*]] = stablehlo.get_dimension_size %arg0, dim = 0 : (tensor<?x4xf32>) -> tensor<i32>
+  // CHECK-NEXT: %[[SIZE0x1:.*]] = stablehlo.reshape %[[SIZE0]] : (tensor<i32>) -> tensor<1xi32>
+  // CHECK-NEXT: %[[SIZE1:.*]] = stablehlo.get_dimension_size %arg0, dim = 1 : (tensor<?x4xf32>) -> tensor<i32>
+  // CHECK-NEXT: %[[SIZE1x1:.*]] = stablehlo.reshape %[[SIZE1]] : (tensor<i32>) -> tensor<1xi32>
+  // CHECK-NEXT: %[[SHAPE:.*]] = stablehlo.concatenate %[[SIZE0x1]], %[[SIZE1x1]], dim = 0 : (tensor<1xi32>, tensor<1xi32>) -> tensor<2xi32>
+  // CHECK-NEXT: %[[EXP:.*]] = stablehlo.exponential %arg0
+  // CHECK-NEXT: %[[SHAPE0:.*]] = builtin.unrealized_conversion_cast %[[SHAPE]] : tensor<2xi32> to tensor<2xindex>
+  // CHECK-NEXT: %[[SHAPE1:.*]] = builtin.unrealized_conversion_cast %[[SHAPE]] : tensor<2xi32> to tensor<2xindex>
+  // CHECK-NEXT: return %[[EXP]], %[[SHAPE0]], %[[SHAPE1]]
+  %0 = shape.shape_of %arg0 : tensor<?x4xf32> -> tensor<2xindex>
+  %1 = stablehlo.exponential %arg0 : tensor<?x4xf32>
+  %2 = shape.shape_of %1 : tensor<?x4xf32> -> tensor<2xindex>
+  func.return %1, %0, %2 : tensor<?x4xf32>, tensor<2xindex>, tensor<2xindex>
+}
+
+// -----
+
+// CHECK-LABEL: func.func @tensor_dim_of_result_not_hoisted
+func.func @tensor_dim_of_result_not_hoisted(%arg0: tensor<?xf32>, %arg1: tensor<1xi32>) -> index {
+  //      CHECK: %[[RESHAPE:.*]] = stablehlo.dynamic_reshape %arg0, %arg1
+  // CHECK-NEXT: stablehlo.get_dimension_size %[[RESHAPE]], dim = 0
+  %c0 = arith.constant 0 : index
+  %0 = stablehlo.dynamic_reshape %arg0, %arg1 : (tensor<?xf32>, tensor<1xi32>) -> tensor<?xf32>
+  %dim = tensor.dim %0, %c0 : tensor<?xf32>
+  func.return %dim : index
+}
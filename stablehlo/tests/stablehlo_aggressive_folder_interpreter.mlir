@@ -0,0 +1,71 @@
+// RUN: stablehlo-opt --stablehlo-aggressive-folder=fold-with-interpreter --split-input-file %s | FileCheck %s
+// RUN: stablehlo-opt --stablehlo-aggressive-folder="fold-with-interpreter fold-op-byte-limit=8" --split-input-file %s | FileCheck %s --check-prefix=LIMIT
+// RUN: stablehlo-opt --stablehlo-aggressive-folder="fold-with-interpreter resource-byte-threshold=8" --split-input-file %s | FileCheck %s --check-prefix=RESOURCE
+
+// CHECK-LABEL: func @eval_dot_general
+// LIMIT-LABEL: func @eval_dot_general
+func.func @eval_dot_general() -> tensor<2x2xf32> {
+  // CHECK-NOT: stablehlo.dot_general
+  // CHECK: [[RESULT:%.*]] = stablehlo.constant dense<{{\[\[}}1.900000e+01, 2.200000e+01], [4.300000e+01, 5.000000e+01]]> : tensor<2x2xf32>
+  // CHECK: return [[RESULT]]
+  // LIMIT: stablehlo.dot_general
+  %lhs = stablehlo.constant dense<[[1.0, 2.0], [3.0, 4.0]]> : tensor<2x2xf32>
+  %rhs = stablehlo.constant dense<[[5.0, 6.0], [7.0, 8.0]]> : tensor<2x2xf32>
+  %0 = stablehlo.dot_general %lhs, %rhs, contracting_dims = [1] x [0] : (tensor<2x2xf32>, tensor<2x2xf32>) -> tensor<2x2xf32>
+  func.return %0 : tensor<2x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @eval_transpose_convert
+// RESOURCE-LABEL: func @eval_transpose_convert
+func.func @eval_transpose_convert() -> tensor<3x2xi32> {
+  // RESOURCE-NOT: stablehlo.transpose
+  // RESOURCE-NOT: stablehlo.convert
+  // RESOURCE: [[RESULT:%.*]] = stablehlo.constant dense_resource<folded{{.*}}> : tensor<3x2xi32>
+  // RESOURCE: return [[RESULT]]
+  // CHECK-NOT: stablehlo.transpose
+  // CHECK-NOT: stablehlo.convert
+  // CHECK: [[RESULT:%.*]] = stablehlo.constant dense<{{\[\[}}1, 4], [2, 5], [3, 6]]> : tensor<3x2xi32>
+  // CHECK: return [[RESULT]]
+  %0 = stablehlo.constant dense<[[1.5, 2.5, 3.5], [4.5, 5.5, 6.5]]> : tensor<2x3xf32>
+  %1 = stablehlo.transpose %0, dims = [1, 0] : (tensor<2x3xf32>) -> tensor<3x2xf32>
+  %2 = stablehlo.convert %1 : (tensor<3x2xf32>) -> tensor<3x2xi32>
+  func.return %2 : tensor<3x2xi32>
+}
+
+// -----
+
+// CHECK-LABEL: func @eval_reduce
+func.func @eval_reduce() -> tensor<2xf32> {
+  // CHECK-NOT: stablehlo.reduce
+  // CHECK: [[RESULT:%.*]] = stablehlo.constant dense<[6.000000e+00, 1.500000e+01]> : tensor<2xf32>
+  // CHECK: return [[RESULT]]
+  %0 = stablehlo.constant dense<[[1.0, 2.0, 3.0], [4.0, 5.0, 6.0]]> : tensor<2x3xf32>
+  %1 = stablehlo.constant dense<0.0> : tensor<f32>
+  %2 = stablehlo.reduce(%0 init: %1) applies stablehlo.add across dimensions = [1] : (tensor<2x3xf32>, tensor<f32>) -> tensor<2xf32>
+  func.return %2 : tensor<2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @eval_splat
+func.func @eval_splat() -> tensor<2x2xf32> {
+  // CHECK-NOT: stablehlo.exponential
+  // CHECK: [[RESULT:%.*]] = stablehlo.constant dense<{{.*}}1.000000e+00{{.*}}> : tensor<2x2xf32>
+  // CHECK: return [[RESULT]]
+  %0 = stablehlo.constant dense<0.0> : tensor<2x2xf32>
+  %1 = stablehlo.exponential %0 : tensor<2x2xf32>
+  func.return %1 : tensor<2x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @no_eval_non_constant
+func.func @no_eval_non_constant(%arg0: tensor<2xf32>) -> tensor<2xf32> {
+  // CHECK: stablehlo.add
+  %0 = stablehlo.constant dense<1.0> : tensor<2xf32>
+  %1 = stablehlo.add %arg0, %0 : tensor<2xf32>
+  func.return %1 : tensor<2xf32>
+}
+
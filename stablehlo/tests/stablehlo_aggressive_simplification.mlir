@@ -394,6 +394,22 @@ func.func @convert(%arg0: tensor<2xf32>) -> tensor<2xf32> {
 
 // -----
 
+// CHECK-LABEL: func.func @convert_roundtrip
+// CHECK-SAME:   ([[ARG0:%.+]]: tensor<2xbf16>, [[ARG1:%.+]]: tensor<2xf32>)
+func.func @convert_roundtrip(%arg0: tensor<2xbf16>, %arg1: tensor<2xf32>) -> (tensor<2xbf16>, tensor<2xf32>) {
+  %0 = stablehlo.convert %arg0 : (tensor<2xbf16>) -> tensor<2xf32>
+  %1 = stablehlo.convert %0 : (tensor<2xf32>) -> tensor<2xbf16>
+  %2 = stablehlo.convert %arg1 : (tensor<2xf32>) -> tensor<2xbf16>
+  %3 = stablehlo.convert %2 : (tensor<2xbf16>) -> tensor<2xf32>
+
+  // CHECK: [[NARROW:%.+]] = stablehlo.convert [[ARG1]] : (tensor<2xf32>) -> tensor<2xbf16>
+  // CHECK: [[WIDE:%.+]] = stablehlo.convert [[NARROW]] : (tensor<2xbf16>) -> tensor<2xf32>
+  // CHECK: return [[ARG0]], [[WIDE]]
+  return %1, %3 : tensor<2xbf16>, tensor<2xf32>
+}
+
+// -----
+
 // CHECK-LABEL: func @dynamic_broadcast_in_dim_op_not_actually_dynamic
 func.func @dynamic_broadcast_in_dim_op_not_actually_dynamic(%arg0: tensor<4xf32>, %arg1: tensor<2xi64>) -> tensor<5x4xf32> {
   // CHECK: %[[RESULT:.+]] = stablehlo.broadcast_in_dim %arg0, dims = [1] : (tensor<4xf32>) -> tensor<5x4xf32>
@@ -0,0 +1,20 @@
+// RUN: stablehlo-opt --stablehlo-aggressive-simplification=report-pattern-statistics %s -o /dev/null 2>&1 | FileCheck %s
+// RUN: stablehlo-opt --stablehlo-aggressive-simplification --mlir-pass-statistics %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=STATS
+// RUN: not stablehlo-opt --stablehlo-aggressive-simplification=max-iterations=1 %s -o /dev/null
+
+// Canonicalizing the add takes one iteration, and another one finds that
+// nothing changes anymore.
+
+// CHECK: remark: pattern statistics: 2 iterations, 1 applications, {{[0-9]+}} failures
+// CHECK: note: {{.*}}AddOpCanon: 1 applications, {{[0-9]+}} failures, {{[0-9]+\.[0-9]+}} ms
+
+// STATS: StablehloAggressiveSimplificationPass
+// STATS-DAG: 2 num-iterations
+// STATS-DAG: 1 num-pattern-applications
+// STATS-DAG: num-pattern-failures
+
+func.func @main(%arg0: tensor<4xi32>) -> tensor<4xi32> {
+  %0 = stablehlo.constant dense<1> : tensor<4xi32>
+  %1 = stablehlo.add %0, %arg0 : tensor<4xi32>
+  func.return %1 : tensor<4xi32>
+}
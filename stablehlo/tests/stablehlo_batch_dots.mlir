@@ -0,0 +1,54 @@
+// RUN: stablehlo-opt --stablehlo-batch-dots --split-input-file %s | FileCheck %s
+// RUN: stablehlo-opt --stablehlo-batch-dots=threshold=64 --split-input-file %s | FileCheck %s --check-prefix=THRESHOLD
+
+// CHECK-LABEL: func @batch_dots
+// CHECK-DAG:     [[LHS0:%.+]] = stablehlo.reshape %arg0 : (tensor<2x3xf32>) -> tensor<1x2x3xf32>
+// CHECK-DAG:     [[LHS1:%.+]] = stablehlo.reshape %arg2 : (tensor<2x3xf32>) -> tensor<1x2x3xf32>
+// CHECK-DAG:     [[RHS0:%.+]] = stablehlo.reshape %arg1 : (tensor<3x4xf32>) -> tensor<1x3x4xf32>
+// CHECK-DAG:     [[RHS1:%.+]] = stablehlo.reshape %arg3 : (tensor<3x4xf32>) -> tensor<1x3x4xf32>
+// CHECK-DAG:     [[LHS:%.+]] = stablehlo.concatenate [[LHS0]], [[LHS1]], dim = 0
+// CHECK-DAG:     [[RHS:%.+]] = stablehlo.concatenate [[RHS0]], [[RHS1]], dim = 0
+// CHECK:         [[DOT:%.+]] = stablehlo.dot_general [[LHS]], [[RHS]], batching_dims = [0] x [0], contracting_dims = [2] x [1] : (tensor<2x2x3xf32>, tensor<2x3x4xf32>) -> tensor<2x2x4xf32>
+// CHECK-NEXT:    [[SLICE0:%.+]] = stablehlo.slice [[DOT]] [0:1, 0:2, 0:4]
+// CHECK-NEXT:    [[RESULT0:%.+]] = stablehlo.reshape [[SLICE0]] : (tensor<1x2x4xf32>) -> tensor<2x4xf32>
+// CHECK-NEXT:    [[SLICE1:%.+]] = stablehlo.slice [[DOT]] [1:2, 0:2, 0:4]
+// CHECK-NEXT:    [[RESULT1:%.+]] = stablehlo.reshape [[SLICE1]] : (tensor<1x2x4xf32>) -> tensor<2x4xf32>
+// CHECK-NEXT:    return [[RESULT0]], [[RESULT1]]
+// THRESHOLD-LABEL: func @batch_dots
+// THRESHOLD-NOT:   stablehlo.concatenate
+func.func @batch_dots(%arg0: tensor<2x3xf32>, %arg1: tensor<3x4xf32>, %arg2: tensor<2x3xf32>, %arg3: tensor<3x4xf32>) -> (tensor<2x4xf32>, tensor<2x4xf32>) {
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<2x3xf32>, tensor<3x4xf32>) -> tensor<2x4xf32>
+  %1 = stablehlo.dot_general %arg2, %arg3, contracting_dims = [1] x [0] : (tensor<2x3xf32>, tensor<3x4xf32>) -> tensor<2x4xf32>
+  return %0, %1 : tensor<2x4xf32>, tensor<2x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @batched_dots
+// CHECK:         stablehlo.dot_general {{.*}}, batching_dims = [0, 1] x [0, 1], contracting_dims = [3] x [2] : (tensor<2x5x2x3xf32>, tensor<2x5x3x4xf32>) -> tensor<2x5x2x4xf32>
+// CHECK-NOT:     stablehlo.dot_general
+func.func @batched_dots(%arg0: tensor<5x2x3xf32>, %arg1: tensor<5x3x4xf32>, %arg2: tensor<5x2x3xf32>, %arg3: tensor<5x3x4xf32>) -> (tensor<5x2x4xf32>, tensor<5x2x4xf32>) {
+  %0 = stablehlo.dot_general %arg0, %arg1, batching_dims = [0] x [0], contracting_dims = [2] x [1] : (tensor<5x2x3xf32>, tensor<5x3x4xf32>) -> tensor<5x2x4xf32>
+  %1 = stablehlo.dot_general %arg2, %arg3, batching_dims = [0] x [0], contracting_dims = [2] x [1] : (tensor<5x2x3xf32>, tensor<5x3x4xf32>) -> tensor<5x2x4xf32>
+  return %0, %1 : tensor<5x2x4xf32>, tensor<5x2x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @dependent_dots
+// CHECK-NOT:     stablehlo.concatenate
+func.func @dependent_dots(%arg0: tensor<4x4xf32>, %arg1: tensor<4x4xf32>) -> tensor<4x4xf32> {
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+  %1 = stablehlo.dot_general %0, %arg1, contracting_dims = [1] x [0] : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<4x4xf32>
+  return %1 : tensor<4x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @different_precisions
+// CHECK-NOT:     stablehlo.concatenate
+func.func @different_precisions(%arg0: tensor<2x3xf32>, %arg1: tensor<3x4xf32>, %arg2: tensor<2x3xf32>, %arg3: tensor<3x4xf32>) -> (tensor<2x4xf32>, tensor<2x4xf32>) {
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<2x3xf32>, tensor<3x4xf32>) -> tensor<2x4xf32>
+  %1 = stablehlo.dot_general %arg2, %arg3, contracting_dims = [1] x [0], precision = [HIGHEST, HIGHEST] : (tensor<2x3xf32>, tensor<3x4xf32>) -> tensor<2x4xf32>
+  return %0, %1 : tensor<2x4xf32>, tensor<2x4xf32>
+}
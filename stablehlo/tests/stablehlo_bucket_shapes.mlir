@@ -0,0 +1,45 @@
+// RUN: stablehlo-opt --stablehlo-bucket-shapes='bucket-sizes=2,4' --split-input-file --verify-diagnostics %s | FileCheck %s
+
+// CHECK-LABEL: func.func @main
+// CHECK-SAME:    (%[[ARG0:.*]]: tensor<?x4xf32>, %[[ARG1:.*]]: tensor<4xf32>) -> tensor<?x4xf32>
+// CHECK:         %[[SIZE:.*]] = stablehlo.get_dimension_size %[[ARG0]], dim = 0
+// CHECK:         %[[INDEX:.*]] = stablehlo.add
+// CHECK:         %[[RESULT:.*]] = "stablehlo.case"(%[[INDEX]]) ({
+// CHECK:           %[[PADDED:.*]] = stablehlo.dynamic_pad %[[ARG0]], {{.*}} -> tensor<2x4xf32>
+// CHECK:           %[[CALL:.*]] = func.call @main_bucket_2(%[[PADDED]], %[[ARG1]])
+// CHECK:           %[[SLICE:.*]] = stablehlo.real_dynamic_slice %[[CALL]], {{.*}} : (tensor<2x4xf32>, tensor<2xi32>, tensor<2xi32>, tensor<2xi32>) -> tensor<?x4xf32>
+// CHECK:           stablehlo.return %[[SLICE]]
+// CHECK:         }, {
+// CHECK:           stablehlo.dynamic_pad %[[ARG0]], {{.*}} -> tensor<4x4xf32>
+// CHECK:           func.call @main_bucket_4
+// CHECK:         }, {
+// CHECK:           %[[FALLBACK:.*]] = func.call @main_dynamic(%[[ARG0]], %[[ARG1]])
+// CHECK:           stablehlo.return %[[FALLBACK]]
+// CHECK:         })
+// CHECK:         return %[[RESULT]]
+// CHECK-LABEL: func.func private @main_bucket_2
+// CHECK-SAME:    (%{{.*}}: tensor<2x4xf32>, %{{.*}}: tensor<4xf32>) -> tensor<2x4xf32>
+// CHECK:         stablehlo.exponential {{.*}} : tensor<2x4xf32>
+// CHECK-LABEL: func.func private @main_bucket_4
+// CHECK-SAME:    -> tensor<4x4xf32>
+// CHECK-LABEL: func.func private @main_dynamic
+// CHECK-SAME:    -> tensor<?x4xf32>
+func.func @main(%arg0: tensor<?x4xf32>, %arg1: tensor<4xf32>) -> tensor<?x4xf32> {
+  %0 = stablehlo.exponential %arg0 : tensor<?x4xf32>
+  func.return %0 : tensor<?x4xf32>
+}
+
+// -----
+
+// expected-error @+1 {{argument 1 must only be dynamic in dimension 0}}
+func.func @main(%arg0: tensor<?x4xf32>, %arg1: tensor<4x?xf32>) -> tensor<?x4xf32> {
+  %0 = stablehlo.exponential %arg0 : tensor<?x4xf32>
+  func.return %0 : tensor<?x4xf32>
+}
+
+// -----
+
+// expected-error @+1 {{no argument is dynamic in dimension 0}}
+func.func @main(%arg0: tensor<2x4xf32>) -> tensor<2x4xf32> {
+  func.return %arg0 : tensor<2x4xf32>
+}
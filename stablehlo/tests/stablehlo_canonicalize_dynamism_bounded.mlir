@@ -0,0 +1,55 @@
+// RUN: stablehlo-opt --stablehlo-canonicalize-dynamism=bounded --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @dynamic_iota_bounded
+func.func @dynamic_iota_bounded(%arg0: tensor<2xi32>) -> tensor<4x?xf32, #stablehlo.bounds<?, 16>> {
+  // CHECK: [[IOTA:%.*]] = stablehlo.iota dim = 1 : tensor<4x16xf32>
+  // CHECK-NEXT: [[SLICE:%.*]] = stablehlo.slice %arg0 [1:2] : (tensor<2xi32>) -> tensor<1xi32>
+  // CHECK-NEXT: [[SIZE:%.*]] = stablehlo.reshape [[SLICE]] : (tensor<1xi32>) -> tensor<i32>
+  // CHECK-NEXT: [[RESULT:%.*]] = "stablehlo.set_dimension_size"([[IOTA]], [[SIZE]]) <{dimension = 1 : i64}> : (tensor<4x16xf32>, tensor<i32>) -> tensor<4x?xf32, #stablehlo.bounds<?, 16>>
+  // CHECK-NEXT: return [[RESULT]]
+  %0 = stablehlo.dynamic_iota %arg0, dim = 1 : (tensor<2xi32>) -> tensor<4x?xf32, #stablehlo.bounds<?, 16>>
+  return %0 : tensor<4x?xf32, #stablehlo.bounds<?, 16>>
+}
+
+// -----
+
+// CHECK-LABEL: func @dynamic_iota_bounded_i64_shape
+func.func @dynamic_iota_bounded_i64_shape(%arg0: tensor<1xi64>) -> tensor<?xi32, #stablehlo.bounds<8>> {
+  // CHECK: stablehlo.iota dim = 0 : tensor<8xi32>
+  // CHECK: [[SIZE:%.*]] = stablehlo.convert {{.*}} : (tensor<i64>) -> tensor<i32>
+  // CHECK: "stablehlo.set_dimension_size"({{.*}}, [[SIZE]]) <{dimension = 0 : i64}>
+  %0 = stablehlo.dynamic_iota %arg0, dim = 0 : (tensor<1xi64>) -> tensor<?xi32, #stablehlo.bounds<8>>
+  return %0 : tensor<?xi32, #stablehlo.bounds<8>>
+}
+
+// -----
+
+// CHECK-LABEL: func @dynamic_iota_unbounded
+func.func @dynamic_iota_unbounded(%arg0: tensor<1xi32>) -> tensor<?xf32> {
+  // CHECK: stablehlo.dynamic_iota
+  %0 = stablehlo.dynamic_iota %arg0, dim = 0 : (tensor<1xi32>) -> tensor<?xf32>
+  return %0 : tensor<?xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @dynamic_broadcast_in_dim_bounded
+func.func @dynamic_broadcast_in_dim_bounded(%arg0: tensor<1x3xf32>, %arg1: tensor<3xi32>) -> tensor<?x?x3xf32, #stablehlo.bounds<4, 8, ?>> {
+  // CHECK: [[BROADCAST:%.*]] = stablehlo.broadcast_in_dim %arg0, dims = [1, 2] : (tensor<1x3xf32>) -> tensor<4x8x3xf32>
+  // CHECK: [[SIZE0:%.*]] = stablehlo.reshape {{.*}} : (tensor<1xi32>) -> tensor<i32>
+  // CHECK: [[SET0:%.*]] = "stablehlo.set_dimension_size"([[BROADCAST]], [[SIZE0]]) <{dimension = 0 : i64}> : (tensor<4x8x3xf32>, tensor<i32>) -> tensor<?x8x3xf32, #stablehlo.bounds<4, ?, ?>>
+  // CHECK: [[SIZE1:%.*]] = stablehlo.reshape {{.*}} : (tensor<1xi32>) -> tensor<i32>
+  // CHECK: [[SET1:%.*]] = "stablehlo.set_dimension_size"([[SET0]], [[SIZE1]]) <{dimension = 1 : i64}> : (tensor<?x8x3xf32, #stablehlo.bounds<4, ?, ?>>, tensor<i32>) -> tensor<?x?x3xf32, #stablehlo.bounds<4, 8, ?>>
+  // CHECK: return [[SET1]]
+  %0 = stablehlo.dynamic_broadcast_in_dim %arg0, %arg1, dims = [1, 2] : (tensor<1x3xf32>, tensor<3xi32>) -> tensor<?x?x3xf32, #stablehlo.bounds<4, 8, ?>>
+  return %0 : tensor<?x?x3xf32, #stablehlo.bounds<4, 8, ?>>
+}
+
+// -----
+
+// CHECK-LABEL: func @dynamic_broadcast_in_dim_bounded_nonexpanding
+func.func @dynamic_broadcast_in_dim_bounded_nonexpanding(%arg0: tensor<2xf32>, %arg1: tensor<1xi32>) -> tensor<?xf32, #stablehlo.bounds<4>> {
+  // CHECK: stablehlo.dynamic_broadcast_in_dim
+  %0 = stablehlo.dynamic_broadcast_in_dim %arg0, %arg1, dims = [0] : (tensor<2xf32>, tensor<1xi32>) -> tensor<?xf32, #stablehlo.bounds<4>>
+  return %0 : tensor<?xf32, #stablehlo.bounds<4>>
+}
@@ -0,0 +1,87 @@
+// RUN: stablehlo-opt --stablehlo-combine-collectives --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @all_reduce
+// CHECK-DAG:     [[LHS:%.+]] = stablehlo.reshape %arg0 : (tensor<4xf32>) -> tensor<1x4xf32>
+// CHECK-DAG:     [[RHS:%.+]] = stablehlo.reshape %arg1 : (tensor<2x3xf32>) -> tensor<1x6xf32>
+// CHECK:         [[CONCAT:%.+]] = stablehlo.concatenate [[LHS]], [[RHS]], dim = 1
+// CHECK:         [[SUM:%.+]] = "stablehlo.all_reduce"([[CONCAT]])
+// CHECK:         (tensor<1x10xf32>) -> tensor<1x10xf32>
+// CHECK-NOT:     stablehlo.all_reduce
+// CHECK:         [[SLICE0:%.+]] = stablehlo.slice [[SUM]] [0:1, 0:4]
+// CHECK-NEXT:    [[SUM0:%.+]] = stablehlo.reshape [[SLICE0]] : (tensor<1x4xf32>) -> tensor<4xf32>
+// CHECK-NEXT:    [[SLICE1:%.+]] = stablehlo.slice [[SUM]] [0:1, 4:10]
+// CHECK-NEXT:    [[SUM1:%.+]] = stablehlo.reshape [[SLICE1]] : (tensor<1x6xf32>) -> tensor<2x3xf32>
+// CHECK-NEXT:    return [[SUM0]], [[SUM1]]
+func.func @all_reduce(%arg0: tensor<4xf32>, %arg1: tensor<2x3xf32>) -> (tensor<4xf32>, tensor<2x3xf32>) {
+  %0 = "stablehlo.all_reduce"(%arg0) ({
+  ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+    %sum = stablehlo.add %lhs, %rhs : tensor<f32>
+    stablehlo.return %sum : tensor<f32>
+  }) {
+    replica_groups = dense<[[0, 1]]> : tensor<1x2xi64>,
+    channel_handle = #stablehlo.channel_handle<handle = 1, type = 1>
+  } : (tensor<4xf32>) -> tensor<4xf32>
+  %1 = "stablehlo.all_reduce"(%arg1) ({
+  ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+    %sum = stablehlo.add %lhs, %rhs : tensor<f32>
+    stablehlo.return %sum : tensor<f32>
+  }) {
+    replica_groups = dense<[[0, 1]]> : tensor<1x2xi64>,
+    channel_handle = #stablehlo.channel_handle<handle = 1, type = 1>
+  } : (tensor<2x3xf32>) -> tensor<2x3xf32>
+  return %0, %1 : tensor<4xf32>, tensor<2x3xf32>
+}
+
+// -----
+
+// All-gathers are gathered along the leading dimension, and the gathered
+// rows are moved back into the gather dimension of every result.
+
+// CHECK-LABEL: func @all_gather
+// CHECK:         "stablehlo.all_gather"
+// CHECK-SAME:    all_gather_dim = 0 : i64
+// CHECK:         (tensor<1x14xf32>) -> tensor<2x14xf32>
+// CHECK-NOT:     stablehlo.all_gather
+// CHECK:         stablehlo.slice {{.*}} [0:2, 0:8]
+// CHECK:         stablehlo.reshape {{.*}} -> tensor<2x2x4xf32>
+// CHECK:         stablehlo.transpose {{.*}} dims = [1, 0, 2]
+// CHECK:         stablehlo.reshape {{.*}} -> tensor<2x8xf32>
+// CHECK:         stablehlo.slice {{.*}} [0:2, 8:14]
+func.func @all_gather(%arg0: tensor<2x4xf32>, %arg1: tensor<6xf32>) -> (tensor<2x8xf32>, tensor<12xf32>) {
+  %0 = "stablehlo.all_gather"(%arg0) {
+    all_gather_dim = 1 : i64,
+    replica_groups = dense<[[0, 1]]> : tensor<1x2xi64>
+  } : (tensor<2x4xf32>) -> tensor<2x8xf32>
+  %1 = "stablehlo.all_gather"(%arg1) {
+    all_gather_dim = 0 : i64,
+    replica_groups = dense<[[0, 1]]> : tensor<1x2xi64>
+  } : (tensor<6xf32>) -> tensor<12xf32>
+  return %0, %1 : tensor<2x8xf32>, tensor<12xf32>
+}
+
+// -----
+
+// Collectives which depend on each other, or which differ in their
+// configuration, aren't combined.
+
+// CHECK-LABEL: func @not_combinable
+// CHECK-COUNT-3: "stablehlo.all_reduce"(%
+// CHECK-NOT:     stablehlo.concatenate
+func.func @not_combinable(%arg0: tensor<4xf32>) -> (tensor<4xf32>, tensor<4xf32>) {
+  %0 = "stablehlo.all_reduce"(%arg0) ({
+  ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+    %sum = stablehlo.add %lhs, %rhs : tensor<f32>
+    stablehlo.return %sum : tensor<f32>
+  }) {replica_groups = dense<[[0, 1]]> : tensor<1x2xi64>} : (tensor<4xf32>) -> tensor<4xf32>
+  %1 = "stablehlo.all_reduce"(%0) ({
+  ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+    %sum = stablehlo.add %lhs, %rhs : tensor<f32>
+    stablehlo.return %sum : tensor<f32>
+  }) {replica_groups = dense<[[0, 1]]> : tensor<1x2xi64>} : (tensor<4xf32>) -> tensor<4xf32>
+  %2 = "stablehlo.all_reduce"(%arg0) ({
+  ^bb0(%lhs: tensor<f32>, %rhs: tensor<f32>):
+    %max = stablehlo.maximum %lhs, %rhs : tensor<f32>
+    stablehlo.return %max : tensor<f32>
+  }) {replica_groups = dense<[[0, 1]]> : tensor<1x2xi64>} : (tensor<4xf32>) -> tensor<4xf32>
+  return %1, %2 : tensor<4xf32>, tensor<4xf32>
+}
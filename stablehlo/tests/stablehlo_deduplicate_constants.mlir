@@ -0,0 +1,54 @@
+// RUN: stablehlo-opt --stablehlo-deduplicate-constants --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @same_block
+// CHECK:         [[CST:%.+]] = stablehlo.constant dense<[1.000000e+00, 2.000000e+00]>
+// CHECK-NOT:     stablehlo.constant
+// CHECK:         [[SUM:%.+]] = stablehlo.add [[CST]], [[CST]]
+func.func @same_block() -> tensor<2xf32> {
+  %0 = stablehlo.constant dense<[1.0, 2.0]> : tensor<2xf32>
+  %1 = stablehlo.constant dense<[1.0, 2.0]> : tensor<2xf32>
+  %2 = stablehlo.add %0, %1 : tensor<2xf32>
+  return %2 : tensor<2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @first
+// CHECK:         stablehlo.constant dense_resource<first_blob> : tensor<4xi32>
+// CHECK-LABEL: func @second
+// CHECK:         stablehlo.constant dense_resource<first_blob> : tensor<4xi32>
+// CHECK-LABEL: func @dense
+// CHECK:         stablehlo.constant dense_resource<first_blob> : tensor<4xi32>
+// CHECK-LABEL: func @other_type
+// CHECK:         stablehlo.constant dense_resource<other_blob> : tensor<4xui32>
+// CHECK:       dialect_resources
+// CHECK-NOT:     second_blob
+func.func @first() -> tensor<4xi32> {
+  %0 = stablehlo.constant dense_resource<first_blob> : tensor<4xi32>
+  return %0 : tensor<4xi32>
+}
+
+func.func @second() -> tensor<4xi32> {
+  %0 = stablehlo.constant dense_resource<second_blob> : tensor<4xi32>
+  return %0 : tensor<4xi32>
+}
+
+func.func @dense() -> tensor<4xi32> {
+  %0 = stablehlo.constant dense<[1, 2, 3, 4]> : tensor<4xi32>
+  return %0 : tensor<4xi32>
+}
+
+func.func @other_type() -> tensor<4xui32> {
+  %0 = stablehlo.constant dense_resource<other_blob> : tensor<4xui32>
+  return %0 : tensor<4xui32>
+}
+
+{-#
+  dialect_resources: {
+    builtin: {
+      first_blob: "0x0400000001000000020000000300000004000000",
+      second_blob: "0x0400000001000000020000000300000004000000",
+      other_blob: "0x0400000001000000020000000300000004000000"
+    }
+  }
+#-}
@@ -0,0 +1,121 @@
+// RUN: stablehlo-opt --stablehlo-elementwise-reassociation --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @hoist_broadcast
+// CHECK-SAME: ([[A:%.+]]: tensor<4xf32>, [[B:%.+]]: tensor<4xf32>)
+func.func @hoist_broadcast(%a: tensor<4xf32>, %b: tensor<4xf32>) -> tensor<8x4xf32> {
+  // CHECK: [[ADD:%.+]] = stablehlo.add [[A]], [[B]] : tensor<4xf32>
+  // CHECK: [[EXP:%.+]] = stablehlo.exponential [[ADD]] : tensor<4xf32>
+  // CHECK: [[BROADCAST:%.+]] = stablehlo.broadcast_in_dim [[EXP]], dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  // CHECK: return [[BROADCAST]]
+  %0 = stablehlo.broadcast_in_dim %a, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  %1 = stablehlo.broadcast_in_dim %b, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  %2 = stablehlo.add %0, %1 : tensor<8x4xf32>
+  %3 = stablehlo.exponential %2 : tensor<8x4xf32>
+  func.return %3 : tensor<8x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @hoist_broadcast_splat
+// CHECK-SAME: ([[A:%.+]]: tensor<4xf32>)
+func.func @hoist_broadcast_splat(%a: tensor<4xf32>) -> tensor<8x4xf32> {
+  // CHECK: [[ONE:%.+]] = stablehlo.constant dense<1.000000e+00> : tensor<4xf32>
+  // CHECK: [[MUL:%.+]] = stablehlo.multiply [[A]], [[ONE]] : tensor<4xf32>
+  // CHECK: stablehlo.broadcast_in_dim [[MUL]], dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  %0 = stablehlo.broadcast_in_dim %a, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  %1 = stablehlo.constant dense<1.0> : tensor<8x4xf32>
+  %2 = stablehlo.multiply %0, %1 : tensor<8x4xf32>
+  func.return %2 : tensor<8x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @no_hoist_different_broadcasts
+func.func @no_hoist_different_broadcasts(%a: tensor<4xf32>, %b: tensor<4xf32>) -> tensor<4x4xf32> {
+  // CHECK: stablehlo.add {{.*}} : tensor<4x4xf32>
+  %0 = stablehlo.broadcast_in_dim %a, dims = [0] : (tensor<4xf32>) -> tensor<4x4xf32>
+  %1 = stablehlo.broadcast_in_dim %b, dims = [1] : (tensor<4xf32>) -> tensor<4x4xf32>
+  %2 = stablehlo.add %0, %1 : tensor<4x4xf32>
+  func.return %2 : tensor<4x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @sink_transpose
+// CHECK-SAME: ([[A:%.+]]: tensor<4x8xf32>, [[B:%.+]]: tensor<4x8xf32>)
+func.func @sink_transpose(%a: tensor<4x8xf32>, %b: tensor<4x8xf32>) -> tensor<8x4xf32> {
+  // CHECK: [[SUB:%.+]] = stablehlo.subtract [[A]], [[B]] : tensor<4x8xf32>
+  // CHECK: [[TRANSPOSE:%.+]] = stablehlo.transpose [[SUB]], dims = [1, 0] : (tensor<4x8xf32>) -> tensor<8x4xf32>
+  // CHECK: return [[TRANSPOSE]]
+  %0 = stablehlo.transpose %a, dims = [1, 0] : (tensor<4x8xf32>) -> tensor<8x4xf32>
+  %1 = stablehlo.transpose %b, dims = [1, 0] : (tensor<4x8xf32>) -> tensor<8x4xf32>
+  %2 = stablehlo.subtract %0, %1 : tensor<8x4xf32>
+  func.return %2 : tensor<8x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @sink_reshape
+// CHECK-SAME: ([[A:%.+]]: tensor<4x8xf32>)
+func.func @sink_reshape(%a: tensor<4x8xf32>) -> tensor<32xf32> {
+  // CHECK: [[NEG:%.+]] = stablehlo.negate [[A]] : tensor<4x8xf32>
+  // CHECK: [[RESHAPE:%.+]] = stablehlo.reshape [[NEG]] : (tensor<4x8xf32>) -> tensor<32xf32>
+  // CHECK: return [[RESHAPE]]
+  %0 = stablehlo.reshape %a : (tensor<4x8xf32>) -> tensor<32xf32>
+  %1 = stablehlo.negate %0 : tensor<32xf32>
+  func.return %1 : tensor<32xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @no_sink_transpose_with_other_users
+func.func @no_sink_transpose_with_other_users(%a: tensor<4x8xf32>) -> (tensor<8x4xf32>, tensor<8x4xf32>) {
+  // CHECK: [[TRANSPOSE:%.+]] = stablehlo.transpose
+  // CHECK: stablehlo.negate [[TRANSPOSE]] : tensor<8x4xf32>
+  %0 = stablehlo.transpose %a, dims = [1, 0] : (tensor<4x8xf32>) -> tensor<8x4xf32>
+  %1 = stablehlo.negate %0 : tensor<8x4xf32>
+  func.return %0, %1 : tensor<8x4xf32>, tensor<8x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @reassociate_broadcasts
+// CHECK-SAME: ([[X:%.+]]: tensor<8x4xi32>, [[A:%.+]]: tensor<4xi32>, [[B:%.+]]: tensor<4xi32>)
+func.func @reassociate_broadcasts(%x: tensor<8x4xi32>, %a: tensor<4xi32>, %b: tensor<4xi32>) -> tensor<8x4xi32> {
+  // CHECK: [[ADD:%.+]] = stablehlo.add [[A]], [[B]] : tensor<4xi32>
+  // CHECK: [[BROADCAST:%.+]] = stablehlo.broadcast_in_dim [[ADD]], dims = [1] : (tensor<4xi32>) -> tensor<8x4xi32>
+  // CHECK: [[RESULT:%.+]] = stablehlo.add [[X]], [[BROADCAST]] : tensor<8x4xi32>
+  // CHECK: return [[RESULT]]
+  %0 = stablehlo.broadcast_in_dim %a, dims = [1] : (tensor<4xi32>) -> tensor<8x4xi32>
+  %1 = stablehlo.broadcast_in_dim %b, dims = [1] : (tensor<4xi32>) -> tensor<8x4xi32>
+  %2 = stablehlo.add %x, %0 : tensor<8x4xi32>
+  %3 = stablehlo.add %2, %1 : tensor<8x4xi32>
+  func.return %3 : tensor<8x4xi32>
+}
+
+// -----
+
+// CHECK-LABEL: func @no_reassociate_float_add
+func.func @no_reassociate_float_add(%x: tensor<8x4xf32>, %a: tensor<4xf32>, %b: tensor<4xf32>) -> tensor<8x4xf32> {
+  // CHECK: stablehlo.add {{.*}} : tensor<8x4xf32>
+  // CHECK: stablehlo.add {{.*}} : tensor<8x4xf32>
+  %0 = stablehlo.broadcast_in_dim %a, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  %1 = stablehlo.broadcast_in_dim %b, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  %2 = stablehlo.add %x, %0 : tensor<8x4xf32>
+  %3 = stablehlo.add %2, %1 : tensor<8x4xf32>
+  func.return %3 : tensor<8x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @cse
+// CHECK-SAME: ([[A:%.+]]: tensor<4xf32>)
+func.func @cse(%a: tensor<4xf32>) -> tensor<8x4xf32> {
+  // CHECK: [[ADD:%.+]] = stablehlo.add [[A]], [[A]] : tensor<4xf32>
+  // CHECK: [[BROADCAST:%.+]] = stablehlo.broadcast_in_dim [[ADD]], dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  // CHECK: return [[BROADCAST]]
+  %0 = stablehlo.broadcast_in_dim %a, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  %1 = stablehlo.broadcast_in_dim %a, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+  %2 = stablehlo.add %0, %1 : tensor<8x4xf32>
+  func.return %2 : tensor<8x4xf32>
+}
@@ -0,0 +1,55 @@
+// RUN: stablehlo-opt --stablehlo-fuse-sibling-dots --split-input-file %s | FileCheck %s
+// RUN: stablehlo-opt --stablehlo-fuse-sibling-dots=threshold=128 --split-input-file %s | FileCheck %s --check-prefix=THRESHOLD
+
+// CHECK-LABEL: func @shared_lhs
+// CHECK:         [[WEIGHTS:%.+]] = stablehlo.concatenate %arg1, %arg2, %arg3, dim = 1 : (tensor<16x4xf32>, tensor<16x4xf32>, tensor<16x8xf32>) -> tensor<16x16xf32>
+// CHECK-NEXT:    [[DOT:%.+]] = stablehlo.dot_general %arg0, [[WEIGHTS]], contracting_dims = [2] x [0] : (tensor<2x8x16xf32>, tensor<16x16xf32>) -> tensor<2x8x16xf32>
+// CHECK-NEXT:    [[Q:%.+]] = stablehlo.slice [[DOT]] [0:2, 0:8, 0:4]
+// CHECK-NEXT:    [[K:%.+]] = stablehlo.slice [[DOT]] [0:2, 0:8, 4:8]
+// CHECK-NEXT:    [[V:%.+]] = stablehlo.slice [[DOT]] [0:2, 0:8, 8:16]
+// CHECK-NOT:     stablehlo.dot_general
+// CHECK:         return [[Q]], [[K]], [[V]]
+// THRESHOLD-LABEL: func @shared_lhs
+// THRESHOLD-NOT:   stablehlo.concatenate
+func.func @shared_lhs(%arg0: tensor<2x8x16xf32>, %arg1: tensor<16x4xf32>, %arg2: tensor<16x4xf32>, %arg3: tensor<16x8xf32>) -> (tensor<2x8x4xf32>, tensor<2x8x4xf32>, tensor<2x8x8xf32>) {
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [2] x [0] : (tensor<2x8x16xf32>, tensor<16x4xf32>) -> tensor<2x8x4xf32>
+  %1 = stablehlo.dot_general %arg0, %arg2, contracting_dims = [2] x [0] : (tensor<2x8x16xf32>, tensor<16x4xf32>) -> tensor<2x8x4xf32>
+  %2 = stablehlo.dot_general %arg0, %arg3, contracting_dims = [2] x [0] : (tensor<2x8x16xf32>, tensor<16x8xf32>) -> tensor<2x8x8xf32>
+  return %0, %1, %2 : tensor<2x8x4xf32>, tensor<2x8x4xf32>, tensor<2x8x8xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @shared_rhs
+// CHECK:         [[INPUTS:%.+]] = stablehlo.concatenate %arg0, %arg1, dim = 0 : (tensor<4x16xf32>, tensor<6x16xf32>) -> tensor<10x16xf32>
+// CHECK-NEXT:    [[DOT:%.+]] = stablehlo.dot_general [[INPUTS]], %arg2, contracting_dims = [1] x [0] : (tensor<10x16xf32>, tensor<16x8xf32>) -> tensor<10x8xf32>
+// CHECK-NEXT:    [[LHS:%.+]] = stablehlo.slice [[DOT]] [0:4, 0:8]
+// CHECK-NEXT:    [[RHS:%.+]] = stablehlo.slice [[DOT]] [4:10, 0:8]
+// CHECK-NEXT:    return [[LHS]], [[RHS]]
+func.func @shared_rhs(%arg0: tensor<4x16xf32>, %arg1: tensor<6x16xf32>, %arg2: tensor<16x8xf32>) -> (tensor<4x8xf32>, tensor<6x8xf32>) {
+  %0 = stablehlo.dot_general %arg0, %arg2, contracting_dims = [1] x [0] : (tensor<4x16xf32>, tensor<16x8xf32>) -> tensor<4x8xf32>
+  %1 = stablehlo.dot_general %arg1, %arg2, contracting_dims = [1] x [0] : (tensor<6x16xf32>, tensor<16x8xf32>) -> tensor<6x8xf32>
+  return %0, %1 : tensor<4x8xf32>, tensor<6x8xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @used_before_sibling
+// CHECK-NOT:     stablehlo.concatenate
+func.func @used_before_sibling(%arg0: tensor<8x16xf32>, %arg1: tensor<16x4xf32>, %arg2: tensor<4x4xf32>) -> tensor<8x4xf32> {
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<8x16xf32>, tensor<16x4xf32>) -> tensor<8x4xf32>
+  %1 = stablehlo.dot_general %0, %arg2, contracting_dims = [1] x [0] : (tensor<8x4xf32>, tensor<4x4xf32>) -> tensor<8x4xf32>
+  %2 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0], precision = [HIGHEST, HIGHEST] : (tensor<8x16xf32>, tensor<16x4xf32>) -> tensor<8x4xf32>
+  %3 = stablehlo.add %1, %2 : tensor<8x4xf32>
+  return %3 : tensor<8x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @different_contractions
+// CHECK-NOT:     stablehlo.concatenate
+func.func @different_contractions(%arg0: tensor<8x8xf32>, %arg1: tensor<8x4xf32>, %arg2: tensor<4x8xf32>) -> (tensor<8x4xf32>, tensor<8x4xf32>) {
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<8x8xf32>, tensor<8x4xf32>) -> tensor<8x4xf32>
+  %1 = stablehlo.dot_general %arg0, %arg2, contracting_dims = [1] x [1] : (tensor<8x8xf32>, tensor<4x8xf32>) -> tensor<8x4xf32>
+  return %0, %1 : tensor<8x4xf32>, tensor<8x4xf32>
+}
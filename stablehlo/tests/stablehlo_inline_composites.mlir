@@ -0,0 +1,65 @@
+// RUN: stablehlo-opt --stablehlo-inline-composites=op-limit=2 --split-input-file %s | FileCheck %s
+// RUN: stablehlo-opt --stablehlo-inline-composites=op-limit=2,except='foo.small' --split-input-file %s | FileCheck %s --check-prefix=EXCEPT
+
+// CHECK-LABEL: func @inline
+// EXCEPT-LABEL: func @inline
+func.func @inline(%arg0: tensor<4xf32>) -> (tensor<4xf32>, tensor<4xf32>) {
+  // CHECK-NEXT: %[[ADD:.*]] = stablehlo.add %arg0, %arg0
+  // CHECK-NEXT: %[[MUL:.*]] = stablehlo.multiply %[[ADD]], %arg0
+  // CHECK-NEXT: %[[LARGE:.*]] = stablehlo.composite "foo.large" %arg0
+  // CHECK-NEXT: return %[[MUL]], %[[LARGE]]
+  // EXCEPT-NEXT: %[[SMALL:.*]] = stablehlo.composite "foo.small" %arg0
+  // EXCEPT-NEXT: %[[LARGE:.*]] = stablehlo.composite "foo.large" %arg0
+  // EXCEPT-NEXT: return %[[SMALL]], %[[LARGE]]
+  %0 = stablehlo.composite "foo.small" %arg0 {
+    decomposition = @small
+  } : (tensor<4xf32>) -> tensor<4xf32>
+  %1 = stablehlo.composite "foo.large" %arg0 {
+    decomposition = @large
+  } : (tensor<4xf32>) -> tensor<4xf32>
+  return %0, %1 : tensor<4xf32>, tensor<4xf32>
+}
+
+// CHECK-LABEL: func @small
+func.func @small(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %0 = stablehlo.add %arg0, %arg0 : tensor<4xf32>
+  %1 = stablehlo.multiply %0, %arg0 : tensor<4xf32>
+  return %1 : tensor<4xf32>
+}
+
+// CHECK-LABEL: func @large
+func.func @large(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %0 = stablehlo.add %arg0, %arg0 : tensor<4xf32>
+  %1 = stablehlo.multiply %0, %arg0 : tensor<4xf32>
+  %2 = stablehlo.subtract %1, %arg0 : tensor<4xf32>
+  return %2 : tensor<4xf32>
+}
+
+// -----
+
+// Composites in inlined bodies are kept.
+
+// CHECK-LABEL: func @nested
+func.func @nested(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  // CHECK-NEXT: %[[INNER:.*]] = stablehlo.composite "foo.inner" %arg0
+  // CHECK-NEXT: return %[[INNER]]
+  %0 = stablehlo.composite "foo.outer" %arg0 {
+    decomposition = @outer
+  } : (tensor<4xf32>) -> tensor<4xf32>
+  return %0 : tensor<4xf32>
+}
+
+// CHECK-LABEL: func @outer
+func.func @outer(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  // CHECK-NEXT: %[[INNER:.*]] = stablehlo.add %arg0, %arg0
+  // CHECK-NEXT: return %[[INNER]]
+  %0 = stablehlo.composite "foo.inner" %arg0 {
+    decomposition = @inner
+  } : (tensor<4xf32>) -> tensor<4xf32>
+  return %0 : tensor<4xf32>
+}
+
+func.func @inner(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %0 = stablehlo.add %arg0, %arg0 : tensor<4xf32>
+  return %0 : tensor<4xf32>
+}
@@ -1,5 +1,6 @@
 // RUN: stablehlo-opt --stablehlo-legalize-composite-to-call --split-input-file %s | FileCheck %s
 // RUN: stablehlo-opt --stablehlo-legalize-composite-to-call=except='foo.baz,foo.qux' --split-input-file %s | FileCheck %s --check-prefix=EXCEPT
+// RUN: stablehlo-opt --pass-pipeline='builtin.module(func.func(stablehlo-legalize-composite-to-call))' --split-input-file %s | FileCheck %s
 
 // CHECK-LABEL: func @composite
 // EXCEPT-LABEL: func @composite
@@ -0,0 +1,76 @@
+// RUN: stablehlo-opt --stablehlo-merge-sibling-reduces --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @layer_norm_moments
+// CHECK-SAME:    ([[X:%.+]]: tensor<4x8xf32>)
+// CHECK:         [[ZERO:%.+]] = stablehlo.constant
+// CHECK:         [[SQUARES:%.+]] = stablehlo.multiply [[X]], [[X]]
+// CHECK-NEXT:    [[REDUCE:%.+]]:2 = stablehlo.reduce([[X]] init: [[ZERO]]), ([[SQUARES]] init: [[ZERO]]) across dimensions = [1] : (tensor<4x8xf32>, tensor<4x8xf32>, tensor<f32>, tensor<f32>) -> (tensor<4xf32>, tensor<4xf32>)
+// CHECK-NEXT:    reducer([[ACC0:%.+]]: tensor<f32>, [[X0:%.+]]: tensor<f32>) ([[ACC1:%.+]]: tensor<f32>, [[X1:%.+]]: tensor<f32>)
+// CHECK-NEXT:      [[SUM0:%.+]] = stablehlo.add [[ACC0]], [[X0]]
+// CHECK-NEXT:      [[SUM1:%.+]] = stablehlo.add [[ACC1]], [[X1]]
+// CHECK-NEXT:      stablehlo.return [[SUM0]], [[SUM1]]
+// CHECK:         return [[REDUCE]]#0, [[REDUCE]]#1
+func.func @layer_norm_moments(%arg0: tensor<4x8xf32>) -> (tensor<4xf32>, tensor<4xf32>) {
+  %0 = stablehlo.constant dense<0.000000e+00> : tensor<f32>
+  %1 = stablehlo.reduce(%arg0 init: %0) applies stablehlo.add across dimensions = [1] : (tensor<4x8xf32>, tensor<f32>) -> tensor<4xf32>
+  %2 = stablehlo.multiply %arg0, %arg0 : tensor<4x8xf32>
+  %3 = stablehlo.reduce(%2 init: %0) applies stablehlo.add across dimensions = [1] : (tensor<4x8xf32>, tensor<f32>) -> tensor<4xf32>
+  return %1, %3 : tensor<4xf32>, tensor<4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @different_combiners_and_types
+// CHECK:         [[REDUCE:%.+]]:3 = stablehlo.reduce(%arg0 init: %arg2), (%arg1 init: %arg3), (%arg0 init: %arg4) across dimensions = [0]
+// CHECK-NEXT:    reducer([[ACC0:%.+]]: tensor<f32>, [[X0:%.+]]: tensor<f32>) ([[ACC1:%.+]]: tensor<i32>, [[X1:%.+]]: tensor<i32>) ([[ACC2:%.+]]: tensor<f32>, [[X2:%.+]]: tensor<f32>)
+// CHECK-NEXT:      [[MAX:%.+]] = stablehlo.maximum [[ACC0]], [[X0]]
+// CHECK-NEXT:      [[SUM:%.+]] = stablehlo.add [[ACC1]], [[X1]]
+// CHECK-NEXT:      [[MIN:%.+]] = stablehlo.minimum [[ACC2]], [[X2]]
+// CHECK-NEXT:      stablehlo.return [[MAX]], [[SUM]], [[MIN]]
+// CHECK-NOT:     stablehlo.reduce
+// CHECK:         return [[REDUCE]]#0, [[REDUCE]]#1, [[REDUCE]]#2
+func.func @different_combiners_and_types(%arg0: tensor<8x4xf32>, %arg1: tensor<8x4xi32>, %arg2: tensor<f32>, %arg3: tensor<i32>, %arg4: tensor<f32>) -> (tensor<4xf32>, tensor<4xi32>, tensor<4xf32>) {
+  %0 = stablehlo.reduce(%arg0 init: %arg2) applies stablehlo.maximum across dimensions = [0] : (tensor<8x4xf32>, tensor<f32>) -> tensor<4xf32>
+  %1 = stablehlo.reduce(%arg1 init: %arg3) applies stablehlo.add across dimensions = [0] : (tensor<8x4xi32>, tensor<i32>) -> tensor<4xi32>
+  %2 = stablehlo.reduce(%arg0 init: %arg4) applies stablehlo.minimum across dimensions = [0] : (tensor<8x4xf32>, tensor<f32>) -> tensor<4xf32>
+  return %0, %1, %2 : tensor<4xf32>, tensor<4xi32>, tensor<4xf32>
+}
+
+// -----
+
+// The sum of exponentials depends on the max, so they aren't merged.
+
+// CHECK-LABEL: func @softmax
+// CHECK:         stablehlo.reduce(%arg0 init: {{.*}}) applies stablehlo.maximum
+// CHECK:         stablehlo.reduce({{.*}} init: {{.*}}) applies stablehlo.add
+func.func @softmax(%arg0: tensor<4x8xf32>) -> tensor<4xf32> {
+  %0 = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %1 = stablehlo.constant dense<0.000000e+00> : tensor<f32>
+  %2 = stablehlo.reduce(%arg0 init: %0) applies stablehlo.maximum across dimensions = [1] : (tensor<4x8xf32>, tensor<f32>) -> tensor<4xf32>
+  %3 = stablehlo.broadcast_in_dim %2, dims = [0] : (tensor<4xf32>) -> tensor<4x8xf32>
+  %4 = stablehlo.subtract %arg0, %3 : tensor<4x8xf32>
+  %5 = stablehlo.exponential %4 : tensor<4x8xf32>
+  %6 = stablehlo.reduce(%5 init: %1) applies stablehlo.add across dimensions = [1] : (tensor<4x8xf32>, tensor<f32>) -> tensor<4xf32>
+  return %6 : tensor<4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @different_dimensions
+// CHECK:         stablehlo.reduce(%arg0 init: %arg1) applies stablehlo.add across dimensions = [0]
+// CHECK:         stablehlo.reduce(%arg0 init: %arg1) applies stablehlo.add across dimensions = [1]
+func.func @different_dimensions(%arg0: tensor<4x4xf32>, %arg1: tensor<f32>) -> (tensor<4xf32>, tensor<4xf32>) {
+  %0 = stablehlo.reduce(%arg0 init: %arg1) applies stablehlo.add across dimensions = [0] : (tensor<4x4xf32>, tensor<f32>) -> tensor<4xf32>
+  %1 = stablehlo.reduce(%arg0 init: %arg1) applies stablehlo.add across dimensions = [1] : (tensor<4x4xf32>, tensor<f32>) -> tensor<4xf32>
+  return %0, %1 : tensor<4xf32>, tensor<4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @dynamic_shapes
+// CHECK-COUNT-2: stablehlo.reduce(%arg0 init: %arg1) applies stablehlo.add
+func.func @dynamic_shapes(%arg0: tensor<?x4xf32>, %arg1: tensor<f32>) -> (tensor<4xf32>, tensor<4xf32>) {
+  %0 = stablehlo.reduce(%arg0 init: %arg1) applies stablehlo.add across dimensions = [0] : (tensor<?x4xf32>, tensor<f32>) -> tensor<4xf32>
+  %1 = stablehlo.reduce(%arg0 init: %arg1) applies stablehlo.add across dimensions = [0] : (tensor<?x4xf32>, tensor<f32>) -> tensor<4xf32>
+  return %0, %1 : tensor<4xf32>, tensor<4xf32>
+}
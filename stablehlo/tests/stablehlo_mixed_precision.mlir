@@ -0,0 +1,53 @@
+// RUN: stablehlo-opt --stablehlo-mixed-precision --split-input-file %s | FileCheck %s
+// RUN: stablehlo-opt --stablehlo-mixed-precision="element-type=f16 ops=stablehlo.convolution" --split-input-file %s | FileCheck %s --check-prefix=POLICY
+// RUN: stablehlo-opt --stablehlo-mixed-precision=min-elements=64 --split-input-file %s | FileCheck %s --check-prefix=SIZE
+
+// CHECK-LABEL: func @dot_general
+// CHECK-DAG:     [[LHS:%.+]] = stablehlo.convert %arg0 : (tensor<4x8xf32>) -> tensor<4x8xbf16>
+// CHECK-DAG:     [[RHS:%.+]] = stablehlo.convert %arg1 : (tensor<8x2xf32>) -> tensor<8x2xbf16>
+// CHECK:         [[DOT:%.+]] = stablehlo.dot_general [[LHS]], [[RHS]], contracting_dims = [1] x [0] : (tensor<4x8xbf16>, tensor<8x2xbf16>) -> tensor<4x2xf32>
+// CHECK-NEXT:    return [[DOT]]
+// POLICY-LABEL: func @dot_general
+// POLICY-NOT:     stablehlo.convert
+// SIZE-LABEL:   func @dot_general
+// SIZE-NOT:       stablehlo.convert
+func.func @dot_general(%arg0: tensor<4x8xf32>, %arg1: tensor<8x2xf32>) -> tensor<4x2xf32> {
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<4x8xf32>, tensor<8x2xf32>) -> tensor<4x2xf32>
+  return %0 : tensor<4x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @cancel_converts
+// CHECK-DAG:     [[RHS:%.+]] = stablehlo.convert %arg1 : (tensor<8x2xf32>) -> tensor<8x2xbf16>
+// CHECK:         [[DOT:%.+]] = stablehlo.dot_general %arg0, [[RHS]], contracting_dims = [1] x [0] : (tensor<4x8xbf16>, tensor<8x2xbf16>) -> tensor<4x2xf32>
+// CHECK-NEXT:    return [[DOT]]
+// SIZE-LABEL:   func @cancel_converts
+// SIZE-NOT:       stablehlo.dot_general {{.*}}bf16
+func.func @cancel_converts(%arg0: tensor<4x8xbf16>, %arg1: tensor<8x2xf32>) -> tensor<4x2xf32> {
+  %0 = stablehlo.convert %arg0 : (tensor<4x8xbf16>) -> tensor<4x8xf32>
+  %1 = stablehlo.dot_general %0, %arg1, contracting_dims = [1] x [0] : (tensor<4x8xf32>, tensor<8x2xf32>) -> tensor<4x2xf32>
+  return %1 : tensor<4x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @convolution
+// CHECK:         stablehlo.convolution{{.*}} : (tensor<1x8x8x2xbf16>, tensor<3x3x2x4xbf16>) -> tensor<1x6x6x4xf32>
+// POLICY-LABEL: func @convolution
+// POLICY:         stablehlo.convolution{{.*}} : (tensor<1x8x8x2xf16>, tensor<3x3x2x4xf16>) -> tensor<1x6x6x4xf32>
+// SIZE-LABEL:   func @convolution
+// SIZE:           stablehlo.convolution{{.*}} : (tensor<1x8x8x2xbf16>, tensor<3x3x2x4xbf16>) -> tensor<1x6x6x4xf32>
+func.func @convolution(%arg0: tensor<1x8x8x2xf32>, %arg1: tensor<3x3x2x4xf32>) -> tensor<1x6x6x4xf32> {
+  %0 = stablehlo.convolution(%arg0, %arg1) dim_numbers = [b, 0, 1, f]x[0, 1, i, o]->[b, 0, 1, f], window = {} {batch_group_count = 1 : i64, feature_group_count = 1 : i64} : (tensor<1x8x8x2xf32>, tensor<3x3x2x4xf32>) -> tensor<1x6x6x4xf32>
+  return %0 : tensor<1x6x6x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @integer_dot_general
+// CHECK-NOT:     stablehlo.convert
+func.func @integer_dot_general(%arg0: tensor<4x8xi32>, %arg1: tensor<8x2xi32>) -> tensor<4x2xi32> {
+  %0 = stablehlo.dot_general %arg0, %arg1, contracting_dims = [1] x [0] : (tensor<4x8xi32>, tensor<8x2xi32>) -> tensor<4x2xi32>
+  return %0 : tensor<4x2xi32>
+}
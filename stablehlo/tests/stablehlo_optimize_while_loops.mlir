@@ -0,0 +1,115 @@
+// RUN: stablehlo-opt --stablehlo-optimize-while-loops --split-input-file %s | FileCheck %s
+// RUN: stablehlo-opt --stablehlo-optimize-while-loops=unroll-op-limit=0 --split-input-file %s | FileCheck %s --check-prefix=NO-UNROLL
+
+// CHECK-LABEL: func @hoist_invariant_ops
+// CHECK-SAME: ([[X:%.+]]: tensor<i32>, [[MASK:%.+]]: tensor<4xf32>)
+func.func @hoist_invariant_ops(%x: tensor<i32>, %mask: tensor<4xf32>) -> tensor<4xf32> {
+  // CHECK: [[EXP:%.+]] = stablehlo.exponential [[MASK]]
+  // CHECK: stablehlo.while
+  // CHECK: do
+  // CHECK: stablehlo.add %{{.+}}, [[EXP]]
+  %zero = stablehlo.constant dense<0.0> : tensor<4xf32>
+  %0:2 = stablehlo.while(%i = %x, %acc = %zero) : tensor<i32>, tensor<4xf32>
+   cond {
+    %c = stablehlo.constant dense<0> : tensor<i32>
+    %p = stablehlo.compare GT, %i, %c : (tensor<i32>, tensor<i32>) -> tensor<i1>
+    stablehlo.return %p : tensor<i1>
+  } do {
+    %one = stablehlo.constant dense<1> : tensor<i32>
+    %next = stablehlo.subtract %i, %one : tensor<i32>
+    %e = stablehlo.exponential %mask : tensor<4xf32>
+    %sum = stablehlo.add %acc, %e : tensor<4xf32>
+    stablehlo.return %next, %sum : tensor<i32>, tensor<4xf32>
+  }
+  func.return %0#1 : tensor<4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @forward_invariant_values
+// CHECK-SAME: ([[X:%.+]]: tensor<i32>, [[Y:%.+]]: tensor<f32>)
+func.func @forward_invariant_values(%x: tensor<i32>, %y: tensor<f32>) -> (tensor<i32>, tensor<f32>) {
+  // CHECK: [[W:%.+]] = stablehlo.while(%{{.+}} = [[X]]) : tensor<i32>
+  // CHECK: return [[W]], [[Y]]
+  %0:2 = stablehlo.while(%i = %x, %v = %y) : tensor<i32>, tensor<f32>
+   cond {
+    %c = stablehlo.constant dense<0> : tensor<i32>
+    %p = stablehlo.compare GT, %i, %c : (tensor<i32>, tensor<i32>) -> tensor<i1>
+    stablehlo.return %p : tensor<i1>
+  } do {
+    %one = stablehlo.constant dense<1> : tensor<i32>
+    %next = stablehlo.subtract %i, %one : tensor<i32>
+    stablehlo.return %next, %v : tensor<i32>, tensor<f32>
+  }
+  func.return %0#0, %0#1 : tensor<i32>, tensor<f32>
+}
+
+// -----
+
+// CHECK-LABEL: func @unroll
+// CHECK-SAME: ([[X:%.+]]: tensor<f32>)
+// NO-UNROLL-LABEL: func @unroll
+func.func @unroll(%x: tensor<f32>) -> tensor<f32> {
+  // CHECK-NOT: stablehlo.while
+  // CHECK: [[A:%.+]] = stablehlo.exponential [[X]]
+  // CHECK: [[B:%.+]] = stablehlo.exponential [[A]]
+  // CHECK: [[C:%.+]] = stablehlo.exponential [[B]]
+  // CHECK-NOT: stablehlo.exponential
+  // CHECK: return [[C]]
+  // NO-UNROLL: stablehlo.while
+  %init = stablehlo.constant dense<0> : tensor<i64>
+  %0:2 = stablehlo.while(%i = %init, %v = %x) : tensor<i64>, tensor<f32>
+   cond {
+    %c = stablehlo.constant dense<3> : tensor<i64>
+    %p = stablehlo.compare LT, %i, %c : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %p : tensor<i1>
+  } do {
+    %one = stablehlo.constant dense<1> : tensor<i64>
+    %next = stablehlo.add %i, %one : tensor<i64>
+    %e = stablehlo.exponential %v : tensor<f32>
+    stablehlo.return %next, %e : tensor<i64>, tensor<f32>
+  }
+  func.return %0#1 : tensor<f32>
+}
+
+// -----
+
+// CHECK-LABEL: func @unroll_zero_trips
+// CHECK-SAME: ([[X:%.+]]: tensor<f32>)
+func.func @unroll_zero_trips(%x: tensor<f32>) -> tensor<f32> {
+  // CHECK-NOT: stablehlo.while
+  // CHECK: return [[X]]
+  %init = stablehlo.constant dense<5> : tensor<i64>
+  %0:2 = stablehlo.while(%i = %init, %v = %x) : tensor<i64>, tensor<f32>
+   cond {
+    %c = stablehlo.constant dense<3> : tensor<i64>
+    %p = stablehlo.compare LT, %i, %c : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %p : tensor<i1>
+  } do {
+    %one = stablehlo.constant dense<1> : tensor<i64>
+    %next = stablehlo.add %i, %one : tensor<i64>
+    %e = stablehlo.exponential %v : tensor<f32>
+    stablehlo.return %next, %e : tensor<i64>, tensor<f32>
+  }
+  func.return %0#1 : tensor<f32>
+}
+
+// -----
+
+// CHECK-LABEL: func @no_unroll_large_trip_count
+func.func @no_unroll_large_trip_count(%x: tensor<f32>) -> tensor<f32> {
+  // CHECK: stablehlo.while
+  %init = stablehlo.constant dense<0> : tensor<i64>
+  %0:2 = stablehlo.while(%i = %init, %v = %x) : tensor<i64>, tensor<f32>
+   cond {
+    %c = stablehlo.constant dense<1000> : tensor<i64>
+    %p = stablehlo.compare LT, %i, %c : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %p : tensor<i1>
+  } do {
+    %one = stablehlo.constant dense<1> : tensor<i64>
+    %next = stablehlo.add %i, %one : tensor<i64>
+    %e = stablehlo.exponential %v : tensor<f32>
+    stablehlo.return %next, %e : tensor<i64>, tensor<f32>
+  }
+  func.return %0#1 : tensor<f32>
+}
@@ -0,0 +1,51 @@
+// RUN: stablehlo-opt --stablehlo-plan-memory --split-input-file --verify-diagnostics %s | FileCheck %s
+
+// Buffers of values which aren't live at the same time share memory.
+
+// CHECK-LABEL: func @chain
+// CHECK-SAME:    attributes {stablehlo.arena_size = 128 : i64, stablehlo.peak_live_bytes = 128 : i64}
+// CHECK:         stablehlo.abs {{.*}}stablehlo.buffer_offsets = array<i64: 0>
+// CHECK-NEXT:    stablehlo.exponential {{.*}}stablehlo.buffer_offsets = array<i64: 64>
+// CHECK-NEXT:    stablehlo.negate {{.*}}stablehlo.buffer_offsets = array<i64: 0>
+func.func @chain(%arg0: tensor<16xf32>) -> tensor<16xf32> {
+  %0 = stablehlo.abs %arg0 : tensor<16xf32>
+  %1 = stablehlo.exponential %0 : tensor<16xf32>
+  %2 = stablehlo.negate %1 : tensor<16xf32>
+  return %2 : tensor<16xf32>
+}
+
+// -----
+
+// Values used in the body of a loop stay live for all its iterations, while
+// values defined in the body are reused across its iterations.
+
+// CHECK-LABEL: func @loop
+// CHECK-SAME:    attributes {stablehlo.arena_size = 512 : i64, stablehlo.peak_live_bytes = 512 : i64}
+// CHECK:         stablehlo.abs {{.*}}stablehlo.buffer_offsets = array<i64: 0>
+// CHECK:         stablehlo.while{{.*}}stablehlo.buffer_offsets = array<i64: 384, 448>
+// CHECK:         stablehlo.add {{.*}}stablehlo.buffer_offsets = array<i64: 384>
+// CHECK-NEXT:    stablehlo.multiply {{.*}}stablehlo.buffer_offsets = array<i64: 64>
+func.func @loop(%arg0: tensor<16xf32>) -> tensor<16xf32> {
+  %0 = stablehlo.abs %arg0 : tensor<16xf32>
+  %c = stablehlo.constant dense<0> : tensor<i64>
+  %1:2 = stablehlo.while(%iterArg = %c, %iterArg_0 = %0) : tensor<i64>, tensor<16xf32>
+   cond {
+    %c_1 = stablehlo.constant dense<10> : tensor<i64>
+    %2 = stablehlo.compare LT, %iterArg, %c_1 : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %2 : tensor<i1>
+  } do {
+    %c_1 = stablehlo.constant dense<1> : tensor<i64>
+    %2 = stablehlo.add %iterArg, %c_1 : tensor<i64>
+    %3 = stablehlo.multiply %iterArg_0, %0 : tensor<16xf32>
+    stablehlo.return %2, %3 : tensor<i64>, tensor<16xf32>
+  }
+  return %1#1 : tensor<16xf32>
+}
+
+// -----
+
+func.func @unbounded(%arg0: tensor<?xf32>) -> tensor<?xf32> {
+  // expected-error@+1 {{can't plan memory for value of type 'tensor<?xf32>' with unbounded dynamic dimensions}}
+  %0 = stablehlo.abs %arg0 : tensor<?xf32>
+  return %0 : tensor<?xf32>
+}
@@ -0,0 +1,59 @@
+// RUN: stablehlo-opt --stablehlo-instrument-with-probe="ops=stablehlo.multiply" %s | FileCheck %s --check-prefix=OPS
+// RUN: stablehlo-opt --stablehlo-instrument-with-probe="functions=callee" %s | FileCheck %s --check-prefix=FUNCTIONS
+// RUN: stablehlo-opt --stablehlo-instrument-with-probe="location-regex=probed_" %s | FileCheck %s --check-prefix=LOCATION
+// RUN: stablehlo-opt --stablehlo-instrument-with-probe="loop-exits-only=true" %s | FileCheck %s --check-prefix=LOOP
+// RUN: stablehlo-opt --stablehlo-instrument-with-probe="summarize=true ops=stablehlo.add" %s | FileCheck %s --check-prefix=SUMMARIZE
+// RUN: stablehlo-opt --stablehlo-instrument-with-probe="digest=true ops=stablehlo.add" %s | FileCheck %s --check-prefix=DIGEST
+
+// OPS-LABEL: func @main
+// OPS-NOT: interpreter.probe
+// OPS: stablehlo.multiply
+// OPS-NEXT: interpreter.probe
+// OPS-NOT: interpreter.probe
+// OPS-LABEL: func @callee
+// OPS-NOT: interpreter.probe
+
+// FUNCTIONS-LABEL: func @main
+// FUNCTIONS-NOT: interpreter.probe
+// FUNCTIONS-LABEL: func @callee
+// FUNCTIONS: stablehlo.subtract
+// FUNCTIONS-NEXT: interpreter.probe
+
+// LOCATION-LABEL: func @main
+// LOCATION-NOT: interpreter.probe
+// LOCATION: stablehlo.multiply
+// LOCATION-NEXT: interpreter.probe
+// LOCATION-NOT: interpreter.probe
+// LOCATION-LABEL: func @callee
+
+// LOOP-LABEL: func @main
+// LOOP: %[[WHILE:.*]] = stablehlo.while
+// LOOP-NOT: interpreter.probe
+// LOOP: interpreter.probe %[[WHILE]]
+// LOOP-NEXT: stablehlo.multiply
+// LOOP-NEXT: interpreter.probe
+
+// SUMMARIZE-LABEL: func @main
+// SUMMARIZE: stablehlo.add
+// SUMMARIZE-NEXT: interpreter.probe {{.*}} {summarize}
+// DIGEST-LABEL: func @main
+// DIGEST: stablehlo.add
+// DIGEST-NEXT: interpreter.probe {{.*}} {digest}
+func.func @main(%arg0: tensor<i64>) -> tensor<i64> {
+  %one = stablehlo.constant dense<1> : tensor<i64>
+  %0 = stablehlo.while(%iterArg = %arg0) : tensor<i64>
+  cond {
+    %cond = stablehlo.compare LT, %iterArg, %one : (tensor<i64>, tensor<i64>) -> tensor<i1>
+    stablehlo.return %cond : tensor<i1>
+  } do {
+    %next = stablehlo.add %iterArg, %one : tensor<i64>
+    stablehlo.return %next : tensor<i64>
+  }
+  %1 = stablehlo.multiply %0, %0 : tensor<i64> loc("probed_multiply")
+  func.return %1 : tensor<i64>
+}
+
+func.func @callee(%arg0: tensor<i64>) -> tensor<i64> {
+  %0 = stablehlo.subtract %arg0, %arg0 : tensor<i64>
+  func.return %0 : tensor<i64>
+}
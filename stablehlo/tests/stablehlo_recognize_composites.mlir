@@ -0,0 +1,120 @@
+// RUN: stablehlo-opt --stablehlo-recognize-composites --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @recognize_softmax
+// CHECK-SAME:    (%[[ARG:.*]]: tensor<2x8xf32>)
+func.func @recognize_softmax(%arg0: tensor<2x8xf32>) -> tensor<2x8xf32> {
+  // CHECK-NEXT: %[[RESULT:.*]] = stablehlo.composite "stablehlo.softmax" %[[ARG]] {composite_attributes = {dimensions = array<i64: 1>}, decomposition = @softmax}
+  // CHECK-NEXT: return %[[RESULT]]
+  %cst = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %cst_0 = stablehlo.constant dense<0.000000e+00> : tensor<f32>
+  %0 = stablehlo.reduce(%arg0 init: %cst) applies stablehlo.maximum across dimensions = [1] : (tensor<2x8xf32>, tensor<f32>) -> tensor<2xf32>
+  %1 = stablehlo.broadcast_in_dim %0, dims = [0] : (tensor<2xf32>) -> tensor<2x8xf32>
+  %2 = stablehlo.subtract %arg0, %1 : tensor<2x8xf32>
+  %3 = stablehlo.exponential %2 : tensor<2x8xf32>
+  %4 = stablehlo.reduce(%3 init: %cst_0) applies stablehlo.add across dimensions = [1] : (tensor<2x8xf32>, tensor<f32>) -> tensor<2xf32>
+  %5 = stablehlo.broadcast_in_dim %4, dims = [0] : (tensor<2xf32>) -> tensor<2x8xf32>
+  %6 = stablehlo.divide %3, %5 : tensor<2x8xf32>
+  return %6 : tensor<2x8xf32>
+}
+// CHECK-LABEL: func private @softmax
+// CHECK-SAME:    (%[[ARG:.*]]: tensor<2x8xf32>) -> tensor<2x8xf32>
+// CHECK:         %[[MAX:.*]] = stablehlo.reduce(%[[ARG]] init: %{{.*}}) applies stablehlo.maximum
+// CHECK:         %[[EXP:.*]] = stablehlo.exponential
+// CHECK:         %[[SUM:.*]] = stablehlo.reduce(%[[EXP]] init: %{{.*}}) applies stablehlo.add
+// CHECK:         %[[RESULT:.*]] = stablehlo.divide %[[EXP]]
+// CHECK-NEXT:    return %[[RESULT]]
+
+// -----
+
+// CHECK-LABEL: func @recognize_softmax_keep_dims
+func.func @recognize_softmax_keep_dims(%arg0: tensor<2x8xf32>) -> tensor<2x8xf32> {
+  // CHECK-NEXT: stablehlo.composite "stablehlo.softmax" %arg0 {composite_attributes = {dimensions = array<i64: 1>}, decomposition = @softmax}
+  %cst = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %cst_0 = stablehlo.constant dense<0.000000e+00> : tensor<f32>
+  %0 = stablehlo.reduce(%arg0 init: %cst) applies stablehlo.maximum across dimensions = [1] : (tensor<2x8xf32>, tensor<f32>) -> tensor<2xf32>
+  %1 = stablehlo.reshape %0 : (tensor<2xf32>) -> tensor<2x1xf32>
+  %2 = stablehlo.broadcast_in_dim %1, dims = [0, 1] : (tensor<2x1xf32>) -> tensor<2x8xf32>
+  %3 = stablehlo.subtract %arg0, %2 : tensor<2x8xf32>
+  %4 = stablehlo.exponential %3 : tensor<2x8xf32>
+  %5 = stablehlo.reduce(%4 init: %cst_0) applies stablehlo.add across dimensions = [1] : (tensor<2x8xf32>, tensor<f32>) -> tensor<2xf32>
+  %6 = stablehlo.reshape %5 : (tensor<2xf32>) -> tensor<2x1xf32>
+  %7 = stablehlo.broadcast_in_dim %6, dims = [0, 1] : (tensor<2x1xf32>) -> tensor<2x8xf32>
+  %8 = stablehlo.divide %4, %7 : tensor<2x8xf32>
+  return %8 : tensor<2x8xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @keep_softmax_with_other_users
+func.func @keep_softmax_with_other_users(%arg0: tensor<2x8xf32>) -> (tensor<2x8xf32>, tensor<2x8xf32>) {
+  // CHECK-NOT: stablehlo.composite
+  %cst = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %cst_0 = stablehlo.constant dense<0.000000e+00> : tensor<f32>
+  %0 = stablehlo.reduce(%arg0 init: %cst) applies stablehlo.maximum across dimensions = [1] : (tensor<2x8xf32>, tensor<f32>) -> tensor<2xf32>
+  %1 = stablehlo.broadcast_in_dim %0, dims = [0] : (tensor<2xf32>) -> tensor<2x8xf32>
+  %2 = stablehlo.subtract %arg0, %1 : tensor<2x8xf32>
+  %3 = stablehlo.exponential %2 : tensor<2x8xf32>
+  %4 = stablehlo.reduce(%3 init: %cst_0) applies stablehlo.add across dimensions = [1] : (tensor<2x8xf32>, tensor<f32>) -> tensor<2xf32>
+  %5 = stablehlo.broadcast_in_dim %4, dims = [0] : (tensor<2xf32>) -> tensor<2x8xf32>
+  %6 = stablehlo.divide %3, %5 : tensor<2x8xf32>
+  return %6, %3 : tensor<2x8xf32>, tensor<2x8xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @recognize_layer_norm
+// CHECK-SAME:    (%[[ARG:.*]]: tensor<2x4xf32>)
+func.func @recognize_layer_norm(%arg0: tensor<2x4xf32>) -> tensor<2x4xf32> {
+  // CHECK-NEXT: %[[RESULT:.*]] = stablehlo.composite "stablehlo.layer_norm" %[[ARG]] {composite_attributes = {dimensions = array<i64: 1>, epsilon = {{.*}} : f32}, decomposition = @layer_norm}
+  // CHECK-NEXT: return %[[RESULT]]
+  %cst = stablehlo.constant dense<0.000000e+00> : tensor<f32>
+  %cst_0 = stablehlo.constant dense<4.000000e+00> : tensor<2xf32>
+  %cst_1 = stablehlo.constant dense<9.99999974E-6> : tensor<2xf32>
+  %0 = stablehlo.reduce(%arg0 init: %cst) applies stablehlo.add across dimensions = [1] : (tensor<2x4xf32>, tensor<f32>) -> tensor<2xf32>
+  %1 = stablehlo.divide %0, %cst_0 : tensor<2xf32>
+  %2 = stablehlo.broadcast_in_dim %1, dims = [0] : (tensor<2xf32>) -> tensor<2x4xf32>
+  %3 = stablehlo.subtract %arg0, %2 : tensor<2x4xf32>
+  %4 = stablehlo.multiply %3, %3 : tensor<2x4xf32>
+  %5 = stablehlo.reduce(%4 init: %cst) applies stablehlo.add across dimensions = [1] : (tensor<2x4xf32>, tensor<f32>) -> tensor<2xf32>
+  %6 = stablehlo.divide %5, %cst_0 : tensor<2xf32>
+  %7 = stablehlo.add %6, %cst_1 : tensor<2xf32>
+  %8 = stablehlo.rsqrt %7 : tensor<2xf32>
+  %9 = stablehlo.broadcast_in_dim %8, dims = [0] : (tensor<2xf32>) -> tensor<2x4xf32>
+  %10 = stablehlo.multiply %3, %9 : tensor<2x4xf32>
+  return %10 : tensor<2x4xf32>
+}
+// CHECK-LABEL: func private @layer_norm
+// CHECK:         stablehlo.rsqrt
+// CHECK:         %[[RESULT:.*]] = stablehlo.multiply
+// CHECK-NEXT:    return %[[RESULT]]
+
+// -----
+
+// CHECK-LABEL: func @recognize_attention
+// CHECK-SAME:    (%[[Q:.*]]: tensor<2x4x8xf32>, %[[K:.*]]: tensor<2x4x8xf32>, %[[V:.*]]: tensor<2x4x8xf32>)
+func.func @recognize_attention(%q: tensor<2x4x8xf32>, %k: tensor<2x4x8xf32>, %v: tensor<2x4x8xf32>) -> tensor<2x4x8xf32> {
+  // CHECK-NEXT: %[[RESULT:.*]] = stablehlo.composite "stablehlo.scaled_dot_product_attention" %[[Q]], %[[K]], %[[V]] {composite_attributes = {scale = 0.353553385 : f32}, decomposition = @scaled_dot_product_attention}
+  // CHECK-NEXT: return %[[RESULT]]
+  %cst = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %cst_0 = stablehlo.constant dense<0.000000e+00> : tensor<f32>
+  %cst_1 = stablehlo.constant dense<0.353553385> : tensor<2x4x4xf32>
+  %0 = stablehlo.dot_general %q, %k, batching_dims = [0] x [0], contracting_dims = [2] x [2] : (tensor<2x4x8xf32>, tensor<2x4x8xf32>) -> tensor<2x4x4xf32>
+  %1 = stablehlo.multiply %0, %cst_1 : tensor<2x4x4xf32>
+  %2 = stablehlo.reduce(%1 init: %cst) applies stablehlo.maximum across dimensions = [2] : (tensor<2x4x4xf32>, tensor<f32>) -> tensor<2x4xf32>
+  %3 = stablehlo.broadcast_in_dim %2, dims = [0, 1] : (tensor<2x4xf32>) -> tensor<2x4x4xf32>
+  %4 = stablehlo.subtract %1, %3 : tensor<2x4x4xf32>
+  %5 = stablehlo.exponential %4 : tensor<2x4x4xf32>
+  %6 = stablehlo.reduce(%5 init: %cst_0) applies stablehlo.add across dimensions = [2] : (tensor<2x4x4xf32>, tensor<f32>) -> tensor<2x4xf32>
+  %7 = stablehlo.broadcast_in_dim %6, dims = [0, 1] : (tensor<2x4xf32>) -> tensor<2x4x4xf32>
+  %8 = stablehlo.divide %5, %7 : tensor<2x4x4xf32>
+  %9 = stablehlo.dot_general %8, %v, batching_dims = [0] x [0], contracting_dims = [2] x [1] : (tensor<2x4x4xf32>, tensor<2x4x8xf32>) -> tensor<2x4x8xf32>
+  return %9 : tensor<2x4x8xf32>
+}
+// CHECK-LABEL: func private @scaled_dot_product_attention
+// CHECK-SAME:    (%[[Q:.*]]: tensor<2x4x8xf32>, %[[K:.*]]: tensor<2x4x8xf32>, %[[V:.*]]: tensor<2x4x8xf32>)
+// CHECK:         %[[SCORES:.*]] = stablehlo.dot_general %[[Q]], %[[K]]
+// CHECK:         %[[SCALED:.*]] = stablehlo.multiply %[[SCORES]]
+// CHECK-NEXT:    %[[PROBABILITIES:.*]] = stablehlo.composite "stablehlo.softmax" %[[SCALED]] {composite_attributes = {dimensions = array<i64: 2>}, decomposition = @softmax}
+// CHECK-NEXT:    %[[RESULT:.*]] = stablehlo.dot_general %[[PROBABILITIES]], %[[V]]
+// CHECK-NEXT:    return %[[RESULT]]
+// CHECK-LABEL: func private @softmax
@@ -0,0 +1,35 @@
+// RUN: stablehlo-opt --stablehlo-refine-shapes=all-functions --split-input-file --verify-diagnostics %s | FileCheck %s
+
+// CHECK-LABEL: func @first
+func.func @first(%arg0: tensor<4xf32>) -> tensor<?xi32> {
+  // CHECK: stablehlo.bitcast_convert{{.*}} -> tensor<4xi32>
+  %0 = stablehlo.bitcast_convert %arg0 : (tensor<4xf32>) -> tensor<?xi32>
+  func.return %0 : tensor<?xi32>
+}
+
+// CHECK-LABEL: func @second
+func.func @second(%arg0: tensor<8xf32>) -> tensor<?xf32> {
+  // CHECK: stablehlo.abs{{.*}} : tensor<8xf32>
+  // CHECK: call @callee{{.*}} -> tensor<?xf32>
+  // CHECK: stablehlo.add{{.*}} -> tensor<8xf32>
+  %0 = stablehlo.abs %arg0 : (tensor<8xf32>) -> tensor<?xf32>
+  %1 = func.call @callee(%arg0) : (tensor<8xf32>) -> tensor<?xf32>
+  %2 = stablehlo.add %0, %1 : tensor<?xf32>
+  func.return %2 : tensor<?xf32>
+}
+
+// CHECK-LABEL: func private @callee
+// CHECK: stablehlo.abs{{.*}} -> tensor<?xf32>
+func.func private @callee(%arg0: tensor<8xf32>) -> tensor<?xf32> {
+  %0 = stablehlo.abs %arg0 : (tensor<8xf32>) -> tensor<?xf32>
+  func.return %0 : tensor<?xf32>
+}
+
+// -----
+
+// expected-error@+1{{must have exactly one block}}
+func.func @error_too_many_blocks(%arg0: tensor<f32>) -> tensor<f32> {
+  cf.br ^bb1(%arg0 : tensor<f32>)
+^bb1(%arg1 : tensor<f32>):
+  func.return %arg1 : tensor<f32>
+}
@@ -0,0 +1,20 @@
+// RUN: stablehlo-opt --stablehlo-refine-shapes %s | FileCheck %s
+// RUN: stablehlo-opt --stablehlo-refine-shapes --mlir-pass-statistics %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=STATS
+
+// STATS: StablehloRefineShapesPass
+// STATS-DAG: 1 num-dynamic-values
+// STATS-DAG: num-updated-ops
+// STATS-DAG: num-pattern-applications
+// STATS-DAG: num-pattern-failures
+
+// CHECK-LABEL: func @main
+func.func @main(%arg0: tensor<4xf32>, %arg1: tensor<?xf32>) -> tensor<?xf32> {
+  // The chain is refined by visiting every op once, and only the operand
+  // with an unknown shape remains dynamic.
+  // CHECK: stablehlo.abs {{.*}} : tensor<4xf32>
+  // CHECK: stablehlo.exponential {{.*}} : tensor<4xf32>
+  // CHECK: return {{.*}} : tensor<4xf32>
+  %0 = stablehlo.abs %arg0 : (tensor<4xf32>) -> tensor<?xf32>
+  %1 = stablehlo.exponential %0 : tensor<?xf32>
+  func.return %1 : tensor<?xf32>
+}
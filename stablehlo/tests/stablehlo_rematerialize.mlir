@@ -0,0 +1,23 @@
+// RUN: stablehlo-opt --stablehlo-rematerialize --verify-diagnostics %s | FileCheck %s
+// RUN: stablehlo-opt --stablehlo-rematerialize=memory-budget=16384 %s | FileCheck %s --check-prefix=BUDGET
+
+// CHECK-LABEL: func @broadcast
+// CHECK:         [[BCAST:%.+]] = stablehlo.broadcast_in_dim %arg0
+// CHECK-NEXT:    [[ADD:%.+]] = stablehlo.add %arg1, [[BCAST]]
+// CHECK-NEXT:    [[EXP0:%.+]] = stablehlo.exponential [[ADD]]
+// CHECK-NEXT:    [[EXP1:%.+]] = stablehlo.exponential [[EXP0]]
+// CHECK-NEXT:    [[REMAT:%.+]] = stablehlo.broadcast_in_dim %arg0
+// CHECK-NEXT:    stablehlo.dot [[EXP1]], [[REMAT]]
+// BUDGET-LABEL: func @broadcast
+// BUDGET:         %0 = stablehlo.broadcast_in_dim %arg0
+// BUDGET-NOT:     stablehlo.broadcast_in_dim
+// BUDGET:         stablehlo.dot %{{.+}}, %0
+func.func @broadcast(%arg0: tensor<f32>, %arg1: tensor<1024xf32>) -> tensor<f32> {
+  // expected-remark@+1 {{rematerialized 1 op(s) before 'stablehlo.dot' to reduce peak live bytes from 12288 to 8196}}
+  %0 = stablehlo.broadcast_in_dim %arg0, dims = [] : (tensor<f32>) -> tensor<1024xf32>
+  %1 = stablehlo.add %arg1, %0 : tensor<1024xf32>
+  %2 = stablehlo.exponential %1 : tensor<1024xf32>
+  %3 = stablehlo.exponential %2 : tensor<1024xf32>
+  %4 = stablehlo.dot %3, %0 : (tensor<1024xf32>, tensor<1024xf32>) -> tensor<f32>
+  return %4 : tensor<f32>
+}
@@ -0,0 +1,108 @@
+// RUN: stablehlo-opt --stablehlo-remove-dead-values --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @if
+func.func @if(%pred: tensor<i1>, %a: tensor<f32>, %b: tensor<f32>) -> tensor<f32> {
+  // CHECK: [[IF:%.+]] = "stablehlo.if"
+  // CHECK-NOT: stablehlo.exponential
+  // CHECK: stablehlo.return %arg1 : tensor<f32>
+  // CHECK: stablehlo.return %arg2 : tensor<f32>
+  // CHECK: return [[IF]]
+  %0:2 = "stablehlo.if"(%pred) ({
+    %1 = stablehlo.exponential %a : tensor<f32>
+    stablehlo.return %a, %1 : tensor<f32>, tensor<f32>
+  }, {
+    stablehlo.return %b, %b : tensor<f32>, tensor<f32>
+  }) : (tensor<i1>) -> (tensor<f32>, tensor<f32>)
+  func.return %0#0 : tensor<f32>
+}
+
+// -----
+
+// CHECK-LABEL: func @while
+func.func @while(%init: tensor<i32>, %acc: tensor<f32>) -> tensor<i32> {
+  // CHECK: stablehlo.while(%{{.+}} = %arg0) : tensor<i32>
+  // CHECK-NOT: stablehlo.exponential
+  %0:2 = stablehlo.while(%i = %init, %a = %acc) : tensor<i32>, tensor<f32>
+   cond {
+    %c = stablehlo.constant dense<10> : tensor<i32>
+    %p = stablehlo.compare LT, %i, %c : (tensor<i32>, tensor<i32>) -> tensor<i1>
+    stablehlo.return %p : tensor<i1>
+  } do {
+    %one = stablehlo.constant dense<1> : tensor<i32>
+    %next = stablehlo.add %i, %one : tensor<i32>
+    %e = stablehlo.exponential %a : tensor<f32>
+    stablehlo.return %next, %e : tensor<i32>, tensor<f32>
+  }
+  func.return %0#0 : tensor<i32>
+}
+
+// -----
+
+// CHECK-LABEL: func @while_used_by_kept_value
+func.func @while_used_by_kept_value(%init: tensor<i32>, %step: tensor<i32>) -> tensor<i32> {
+  // CHECK: stablehlo.while(%{{.+}} = %arg0, %{{.+}} = %arg1) : tensor<i32>, tensor<i32>
+  %0:2 = stablehlo.while(%i = %init, %s = %step) : tensor<i32>, tensor<i32>
+   cond {
+    %c = stablehlo.constant dense<10> : tensor<i32>
+    %p = stablehlo.compare LT, %i, %c : (tensor<i32>, tensor<i32>) -> tensor<i1>
+    stablehlo.return %p : tensor<i1>
+  } do {
+    %next = stablehlo.add %i, %s : tensor<i32>
+    stablehlo.return %next, %s : tensor<i32>, tensor<i32>
+  }
+  func.return %0#0 : tensor<i32>
+}
+
+// -----
+
+// CHECK-LABEL: func @sort
+func.func @sort(%keys: tensor<4xf32>, %values: tensor<4xi32>) -> tensor<4xf32> {
+  // CHECK: stablehlo.sort
+  // CHECK: (tensor<4xf32>) -> tensor<4xf32>
+  %0:2 = "stablehlo.sort"(%keys, %values) ({
+  ^bb0(%a: tensor<f32>, %b: tensor<f32>, %c: tensor<i32>, %d: tensor<i32>):
+    %p = stablehlo.compare GT, %a, %b : (tensor<f32>, tensor<f32>) -> tensor<i1>
+    stablehlo.return %p : tensor<i1>
+  }) {dimension = 0 : i64, is_stable = true} : (tensor<4xf32>, tensor<4xi32>) -> (tensor<4xf32>, tensor<4xi32>)
+  func.return %0#0 : tensor<4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @reduce
+func.func @reduce(%x: tensor<4xf32>, %y: tensor<4xi32>, %zf: tensor<f32>, %zi: tensor<i32>) -> tensor<f32> {
+  // CHECK: stablehlo.reduce(%arg0 init: %arg2) applies stablehlo.add across dimensions = [0] : (tensor<4xf32>, tensor<f32>) -> tensor<f32>
+  %0:2 = "stablehlo.reduce"(%x, %y, %zf, %zi) ({
+  ^bb0(%a: tensor<f32>, %c: tensor<i32>, %b: tensor<f32>, %d: tensor<i32>):
+    %s = stablehlo.add %a, %b : tensor<f32>
+    %t = stablehlo.add %c, %d : tensor<i32>
+    stablehlo.return %s, %t : tensor<f32>, tensor<i32>
+  }) {dimensions = array<i64: 0>} : (tensor<4xf32>, tensor<4xi32>, tensor<f32>, tensor<i32>) -> (tensor<f32>, tensor<i32>)
+  func.return %0#0 : tensor<f32>
+}
+
+// -----
+
+// CHECK-LABEL: func @caller
+func.func @caller(%x: tensor<f32>, %y: tensor<f32>) -> tensor<f32> {
+  // CHECK: [[R:%.+]] = call @callee(%arg0) : (tensor<f32>) -> tensor<f32>
+  // CHECK: return [[R]]
+  %0:2 = func.call @callee(%x, %y) : (tensor<f32>, tensor<f32>) -> (tensor<f32>, tensor<f32>)
+  func.return %0#0 : tensor<f32>
+}
+
+// CHECK-LABEL: func private @callee
+// CHECK-SAME: (%arg0: tensor<f32>) -> tensor<f32>
+// CHECK-NOT: stablehlo.exponential
+func.func private @callee(%x: tensor<f32>, %y: tensor<f32>) -> (tensor<f32>, tensor<f32>) {
+  %0 = stablehlo.exponential %y : tensor<f32>
+  func.return %x, %0 : tensor<f32>, tensor<f32>
+}
+
+// -----
+
+// CHECK-LABEL: func @public_callee
+// CHECK-SAME: (%arg0: tensor<f32>, %arg1: tensor<f32>) -> (tensor<f32>, tensor<f32>)
+func.func @public_callee(%x: tensor<f32>, %y: tensor<f32>) -> (tensor<f32>, tensor<f32>) {
+  func.return %x, %x : tensor<f32>, tensor<f32>
+}
@@ -0,0 +1,36 @@
+// RUN: stablehlo-opt --stablehlo-schedule-for-memory --split-input-file %s | FileCheck %s
+
+// Tensors are consumed right after they are computed.
+
+// CHECK-LABEL: func @interleave
+// CHECK:         [[INIT:%.+]] = stablehlo.constant
+// CHECK-NEXT:    [[ABS0:%.+]] = stablehlo.abs %arg0
+// CHECK-NEXT:    [[SUM0:%.+]] = stablehlo.reduce([[ABS0]] init: [[INIT]])
+// CHECK-NEXT:    [[ABS1:%.+]] = stablehlo.abs %arg1
+// CHECK-NEXT:    [[SUM1:%.+]] = stablehlo.reduce([[ABS1]] init: [[INIT]])
+// CHECK-NEXT:    stablehlo.add [[SUM0]], [[SUM1]]
+func.func @interleave(%arg0: tensor<1024xf32>, %arg1: tensor<1024xf32>) -> tensor<f32> {
+  %cst = stablehlo.constant dense<0.0> : tensor<f32>
+  %0 = stablehlo.abs %arg0 : tensor<1024xf32>
+  %1 = stablehlo.abs %arg1 : tensor<1024xf32>
+  %2 = stablehlo.reduce(%0 init: %cst) applies stablehlo.add across dimensions = [0] : (tensor<1024xf32>, tensor<f32>) -> tensor<f32>
+  %3 = stablehlo.reduce(%1 init: %cst) applies stablehlo.add across dimensions = [0] : (tensor<1024xf32>, tensor<f32>) -> tensor<f32>
+  %4 = stablehlo.add %2, %3 : tensor<f32>
+  return %4 : tensor<f32>
+}
+
+// -----
+
+// Ops with side effects keep their order, and the order is kept if it doesn't
+// reduce the peak size of live tensors.
+
+// CHECK-LABEL: func @side_effects
+// CHECK:         stablehlo.custom_call @first
+// CHECK-NEXT:    stablehlo.custom_call @second
+// CHECK-NEXT:    stablehlo.add
+func.func @side_effects(%arg0: tensor<1024xf32>) -> tensor<1024xf32> {
+  %0 = stablehlo.custom_call @first(%arg0) {has_side_effect = true} : (tensor<1024xf32>) -> tensor<1024xf32>
+  %1 = stablehlo.custom_call @second(%arg0) {has_side_effect = true} : (tensor<1024xf32>) -> tensor<4xf32>
+  %2 = stablehlo.add %0, %0 : tensor<1024xf32>
+  return %2 : tensor<1024xf32>
+}
@@ -0,0 +1,109 @@
+// RUN: stablehlo-opt --stablehlo-simplify-slices --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @slice_of_concatenate_input
+// CHECK:         [[SLICE:%.+]] = stablehlo.slice %arg1 [1:3, 0:4]
+// CHECK-NEXT:    return %arg1, [[SLICE]]
+func.func @slice_of_concatenate_input(%arg0: tensor<4x4xf32>, %arg1: tensor<4x4xf32>) -> (tensor<4x4xf32>, tensor<2x4xf32>) {
+  %0 = stablehlo.concatenate %arg0, %arg1, dim = 0 : (tensor<4x4xf32>, tensor<4x4xf32>) -> tensor<8x4xf32>
+  %1 = stablehlo.slice %0 [4:8, 0:4] : (tensor<8x4xf32>) -> tensor<4x4xf32>
+  %2 = stablehlo.slice %0 [5:7, 0:4] : (tensor<8x4xf32>) -> tensor<2x4xf32>
+  return %1, %2 : tensor<4x4xf32>, tensor<2x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @slice_of_concatenate_across_inputs
+// CHECK:         [[LHS:%.+]] = stablehlo.slice %arg0 [0:2, 3:4]
+// CHECK-NEXT:    [[RHS:%.+]] = stablehlo.slice %arg2 [0:2, 0:1]
+// CHECK-NEXT:    [[RESULT:%.+]] = stablehlo.concatenate [[LHS]], %arg1, [[RHS]], dim = 1
+// CHECK-NEXT:    return [[RESULT]]
+func.func @slice_of_concatenate_across_inputs(%arg0: tensor<2x4xf32>, %arg1: tensor<2x4xf32>, %arg2: tensor<2x4xf32>) -> tensor<2x6xf32> {
+  %0 = stablehlo.concatenate %arg0, %arg1, %arg2, dim = 1 : (tensor<2x4xf32>, tensor<2x4xf32>, tensor<2x4xf32>) -> tensor<2x12xf32>
+  %1 = stablehlo.slice %0 [0:2, 3:9] : (tensor<2x12xf32>) -> tensor<2x6xf32>
+  return %1 : tensor<2x6xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @concatenate_adjacent_slices
+// CHECK:         [[SLICE:%.+]] = stablehlo.slice %arg0 [2:8, 0:4]
+// CHECK-NEXT:    [[RESULT:%.+]] = stablehlo.concatenate [[SLICE]], %arg1, dim = 0
+// CHECK-NEXT:    return %arg0, [[RESULT]]
+func.func @concatenate_adjacent_slices(%arg0: tensor<8x4xf32>, %arg1: tensor<1x4xf32>) -> (tensor<8x4xf32>, tensor<7x4xf32>) {
+  %0 = stablehlo.slice %arg0 [0:3, 0:4] : (tensor<8x4xf32>) -> tensor<3x4xf32>
+  %1 = stablehlo.slice %arg0 [3:8, 0:4] : (tensor<8x4xf32>) -> tensor<5x4xf32>
+  %2 = stablehlo.concatenate %0, %1, dim = 0 : (tensor<3x4xf32>, tensor<5x4xf32>) -> tensor<8x4xf32>
+  %3 = stablehlo.slice %arg0 [2:5, 0:4] : (tensor<8x4xf32>) -> tensor<3x4xf32>
+  %4 = stablehlo.slice %arg0 [5:8, 0:4] : (tensor<8x4xf32>) -> tensor<3x4xf32>
+  %5 = stablehlo.concatenate %3, %4, %arg1, dim = 0 : (tensor<3x4xf32>, tensor<3x4xf32>, tensor<1x4xf32>) -> tensor<7x4xf32>
+  return %2, %5 : tensor<8x4xf32>, tensor<7x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @non_adjacent_slices
+// CHECK:         stablehlo.concatenate
+func.func @non_adjacent_slices(%arg0: tensor<8x4xf32>) -> tensor<6x4xf32> {
+  %0 = stablehlo.slice %arg0 [0:3, 0:4] : (tensor<8x4xf32>) -> tensor<3x4xf32>
+  %1 = stablehlo.slice %arg0 [4:7, 0:4] : (tensor<8x4xf32>) -> tensor<3x4xf32>
+  %2 = stablehlo.concatenate %0, %1, dim = 0 : (tensor<3x4xf32>, tensor<3x4xf32>) -> tensor<6x4xf32>
+  return %2 : tensor<6x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @slice_of_pad
+// CHECK-NOT:     stablehlo.pad
+// CHECK:         [[SLICE:%.+]] = stablehlo.slice %arg0 [1:3, 0:4]
+// CHECK-NEXT:    return %arg0, [[SLICE]]
+func.func @slice_of_pad(%arg0: tensor<4x4xf32>, %arg1: tensor<f32>) -> (tensor<4x4xf32>, tensor<2x4xf32>) {
+  %0 = stablehlo.pad %arg0, %arg1, low = [2, 0], high = [1, 3], interior = [0, 0] : (tensor<4x4xf32>, tensor<f32>) -> tensor<7x7xf32>
+  %1 = stablehlo.slice %0 [2:6, 0:4] : (tensor<7x7xf32>) -> tensor<4x4xf32>
+  %2 = stablehlo.slice %0 [3:5, 0:4] : (tensor<7x7xf32>) -> tensor<2x4xf32>
+  return %1, %2 : tensor<4x4xf32>, tensor<2x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @slice_of_padding
+// CHECK:         [[PAD:%.+]] = stablehlo.pad %arg0, %arg1, low = [1, 0], high = [0, 2], interior = [0, 0]
+// CHECK-NEXT:    return [[PAD]]
+func.func @slice_of_padding(%arg0: tensor<4x4xf32>, %arg1: tensor<f32>) -> tensor<5x6xf32> {
+  %0 = stablehlo.pad %arg0, %arg1, low = [2, 0], high = [1, 3], interior = [0, 0] : (tensor<4x4xf32>, tensor<f32>) -> tensor<7x7xf32>
+  %1 = stablehlo.slice %0 [1:6, 0:6] : (tensor<7x7xf32>) -> tensor<5x6xf32>
+  return %1 : tensor<5x6xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @compose_slices
+// CHECK:         [[SLICE:%.+]] = stablehlo.slice %arg0 [3:12:4, 2:6]
+// CHECK-NEXT:    return [[SLICE]]
+func.func @compose_slices(%arg0: tensor<16x8xf32>) -> tensor<3x4xf32> {
+  %0 = stablehlo.slice %arg0 [1:16:2, 0:8] : (tensor<16x8xf32>) -> tensor<8x8xf32>
+  %1 = stablehlo.slice %0 [1:6:2, 2:6] : (tensor<8x8xf32>) -> tensor<3x4xf32>
+  return %1 : tensor<3x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @dynamic_slice_chain
+// CHECK:         [[SLICE:%.+]] = stablehlo.slice %arg0 [5:7, 4:8]
+// CHECK-NEXT:    return [[SLICE]]
+func.func @dynamic_slice_chain(%arg0: tensor<8x8xf32>) -> tensor<2x4xf32> {
+  %c1 = stablehlo.constant dense<1> : tensor<i32>
+  %c4 = stablehlo.constant dense<4> : tensor<i32>
+  %c9 = stablehlo.constant dense<9> : tensor<i64>
+  %0 = stablehlo.dynamic_slice %arg0, %c4, %c9, sizes = [4, 4] : (tensor<8x8xf32>, tensor<i32>, tensor<i64>) -> tensor<4x4xf32>
+  %1 = stablehlo.dynamic_slice %0, %c1, %c1, sizes = [2, 4] : (tensor<4x4xf32>, tensor<i32>, tensor<i32>) -> tensor<2x4xf32>
+  return %1 : tensor<2x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @dynamic_slice_non_constant
+// CHECK:         stablehlo.dynamic_slice
+func.func @dynamic_slice_non_constant(%arg0: tensor<8xf32>, %arg1: tensor<i32>) -> tensor<4xf32> {
+  %0 = stablehlo.dynamic_slice %arg0, %arg1, sizes = [4] : (tensor<8xf32>, tensor<i32>) -> tensor<4xf32>
+  return %0 : tensor<4xf32>
+}
@@ -0,0 +1,170 @@
+// RUN: stablehlo-opt --stablehlo-transpose-propagation --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @cancel_transposes
+// CHECK-SAME: ([[X:%.+]]: tensor<2x3x4xf32>)
+func.func @cancel_transposes(%x: tensor<2x3x4xf32>) -> tensor<2x3x4xf32> {
+  // CHECK-NOT: stablehlo.transpose
+  // CHECK: return [[X]]
+  %0 = stablehlo.transpose %x, dims = [1, 2, 0] : (tensor<2x3x4xf32>) -> tensor<3x4x2xf32>
+  %1 = stablehlo.transpose %0, dims = [2, 0, 1] : (tensor<3x4x2xf32>) -> tensor<2x3x4xf32>
+  func.return %1 : tensor<2x3x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @compose_transposes
+// CHECK-SAME: ([[X:%.+]]: tensor<2x3x4xf32>)
+func.func @compose_transposes(%x: tensor<2x3x4xf32>) -> tensor<4x3x2xf32> {
+  // CHECK: [[T:%.+]] = stablehlo.transpose [[X]], dims = [2, 1, 0] : (tensor<2x3x4xf32>) -> tensor<4x3x2xf32>
+  // CHECK: return [[T]]
+  %0 = stablehlo.transpose %x, dims = [1, 2, 0] : (tensor<2x3x4xf32>) -> tensor<3x4x2xf32>
+  %1 = stablehlo.transpose %0, dims = [1, 0, 2] : (tensor<3x4x2xf32>) -> tensor<4x3x2xf32>
+  func.return %1 : tensor<4x3x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @elementwise
+// CHECK-SAME: ([[A:%.+]]: tensor<2x3xf32>, [[B:%.+]]: tensor<2x3xf32>)
+func.func @elementwise(%a: tensor<2x3xf32>, %b: tensor<2x3xf32>) -> tensor<2x3xf32> {
+  // CHECK-NOT: stablehlo.transpose
+  // CHECK-DAG: [[ONE:%.+]] = stablehlo.constant dense<1.000000e+00> : tensor<2x3xf32>
+  // CHECK-DAG: [[ADD:%.+]] = stablehlo.add [[A]], [[B]] : tensor<2x3xf32>
+  // CHECK: [[MUL:%.+]] = stablehlo.multiply [[ADD]], [[ONE]] : tensor<2x3xf32>
+  // CHECK: return [[MUL]]
+  %0 = stablehlo.transpose %a, dims = [1, 0] : (tensor<2x3xf32>) -> tensor<3x2xf32>
+  %1 = stablehlo.transpose %b, dims = [1, 0] : (tensor<2x3xf32>) -> tensor<3x2xf32>
+  %2 = stablehlo.add %0, %1 : tensor<3x2xf32>
+  %3 = stablehlo.constant dense<1.0> : tensor<3x2xf32>
+  %4 = stablehlo.multiply %2, %3 : tensor<3x2xf32>
+  %5 = stablehlo.transpose %4, dims = [1, 0] : (tensor<3x2xf32>) -> tensor<2x3xf32>
+  func.return %5 : tensor<2x3xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @elementwise_different_permutations
+func.func @elementwise_different_permutations(%a: tensor<2x2xf32>, %b: tensor<2x2xf32>) -> tensor<2x2xf32> {
+  // CHECK: stablehlo.transpose
+  // CHECK: stablehlo.add
+  %0 = stablehlo.transpose %a, dims = [1, 0] : (tensor<2x2xf32>) -> tensor<2x2xf32>
+  %1 = stablehlo.add %0, %b : tensor<2x2xf32>
+  func.return %1 : tensor<2x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @elementwise_multiple_uses
+func.func @elementwise_multiple_uses(%a: tensor<2x3xf32>) -> (tensor<3x2xf32>, tensor<3x2xf32>) {
+  // CHECK: [[T:%.+]] = stablehlo.transpose
+  // CHECK: stablehlo.exponential [[T]] : tensor<3x2xf32>
+  %0 = stablehlo.transpose %a, dims = [1, 0] : (tensor<2x3xf32>) -> tensor<3x2xf32>
+  %1 = stablehlo.exponential %0 : tensor<3x2xf32>
+  func.return %0, %1 : tensor<3x2xf32>, tensor<3x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @broadcast_in_dim
+// CHECK-SAME: ([[X:%.+]]: tensor<2x3xf32>)
+func.func @broadcast_in_dim(%x: tensor<2x3xf32>) -> tensor<3x4x2xf32> {
+  // CHECK: [[B:%.+]] = stablehlo.broadcast_in_dim [[X]], dims = [2, 0] : (tensor<2x3xf32>) -> tensor<3x4x2xf32>
+  // CHECK: return [[B]]
+  %0 = stablehlo.transpose %x, dims = [1, 0] : (tensor<2x3xf32>) -> tensor<3x2xf32>
+  %1 = stablehlo.broadcast_in_dim %0, dims = [0, 2] : (tensor<3x2xf32>) -> tensor<3x4x2xf32>
+  func.return %1 : tensor<3x4x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @reduce
+// CHECK-SAME: ([[X:%.+]]: tensor<2x3x4xf32>, [[INIT:%.+]]: tensor<f32>)
+func.func @reduce(%x: tensor<2x3x4xf32>, %init: tensor<f32>) -> tensor<2x3xf32> {
+  // CHECK-NOT: stablehlo.transpose
+  // CHECK: [[R:%.+]] = stablehlo.reduce([[X]] init: [[INIT]]) applies stablehlo.add across dimensions = [2] : (tensor<2x3x4xf32>, tensor<f32>) -> tensor<2x3xf32>
+  // CHECK: return [[R]]
+  %0 = stablehlo.transpose %x, dims = [2, 0, 1] : (tensor<2x3x4xf32>) -> tensor<4x2x3xf32>
+  %1 = stablehlo.reduce(%0 init: %init) applies stablehlo.add across dimensions = [0] : (tensor<4x2x3xf32>, tensor<f32>) -> tensor<2x3xf32>
+  func.return %1 : tensor<2x3xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @reduce_permuted_result
+// CHECK-SAME: ([[X:%.+]]: tensor<2x3x4xf32>, [[INIT:%.+]]: tensor<f32>)
+func.func @reduce_permuted_result(%x: tensor<2x3x4xf32>, %init: tensor<f32>) -> tensor<4x2xf32> {
+  // CHECK: [[R:%.+]] = stablehlo.reduce([[X]] init: [[INIT]]) applies stablehlo.add across dimensions = [1] : (tensor<2x3x4xf32>, tensor<f32>) -> tensor<2x4xf32>
+  // CHECK: [[T:%.+]] = stablehlo.transpose [[R]], dims = [1, 0] : (tensor<2x4xf32>) -> tensor<4x2xf32>
+  // CHECK: return [[T]]
+  %0 = stablehlo.transpose %x, dims = [2, 1, 0] : (tensor<2x3x4xf32>) -> tensor<4x3x2xf32>
+  %1 = stablehlo.reduce(%0 init: %init) applies stablehlo.add across dimensions = [1] : (tensor<4x3x2xf32>, tensor<f32>) -> tensor<4x2xf32>
+  func.return %1 : tensor<4x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @concatenate
+// CHECK-SAME: ([[A:%.+]]: tensor<2x3xf32>, [[B:%.+]]: tensor<2x3xf32>)
+func.func @concatenate(%a: tensor<2x3xf32>, %b: tensor<2x3xf32>) -> tensor<6x2xf32> {
+  // CHECK: [[C:%.+]] = stablehlo.concatenate [[A]], [[B]], dim = 1 : (tensor<2x3xf32>, tensor<2x3xf32>) -> tensor<2x6xf32>
+  // CHECK: [[T:%.+]] = stablehlo.transpose [[C]], dims = [1, 0] : (tensor<2x6xf32>) -> tensor<6x2xf32>
+  // CHECK: return [[T]]
+  %0 = stablehlo.transpose %a, dims = [1, 0] : (tensor<2x3xf32>) -> tensor<3x2xf32>
+  %1 = stablehlo.transpose %b, dims = [1, 0] : (tensor<2x3xf32>) -> tensor<3x2xf32>
+  %2 = stablehlo.concatenate %0, %1, dim = 0 : (tensor<3x2xf32>, tensor<3x2xf32>) -> tensor<6x2xf32>
+  func.return %2 : tensor<6x2xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @pad
+// CHECK-SAME: ([[X:%.+]]: tensor<2x3xf32>, [[V:%.+]]: tensor<f32>)
+func.func @pad(%x: tensor<2x3xf32>, %v: tensor<f32>) -> tensor<4x3xf32> {
+  // CHECK: [[P:%.+]] = stablehlo.pad [[X]], [[V]], low = [0, 1], high = [1, 0], interior = [0, 0] : (tensor<2x3xf32>, tensor<f32>) -> tensor<3x4xf32>
+  // CHECK: [[T:%.+]] = stablehlo.transpose [[P]], dims = [1, 0] : (tensor<3x4xf32>) -> tensor<4x3xf32>
+  // CHECK: return [[T]]
+  %0 = stablehlo.transpose %x, dims = [1, 0] : (tensor<2x3xf32>) -> tensor<3x2xf32>
+  %1 = stablehlo.pad %0, %v, low = [1, 0], high = [0, 1], interior = [0, 0] : (tensor<3x2xf32>, tensor<f32>) -> tensor<4x3xf32>
+  func.return %1 : tensor<4x3xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @dot_general
+// CHECK-SAME: ([[A:%.+]]: tensor<4x3xf32>, [[B:%.+]]: tensor<3x5xf32>)
+func.func @dot_general(%a: tensor<4x3xf32>, %b: tensor<3x5xf32>) -> tensor<4x5xf32> {
+  // CHECK-NOT: stablehlo.transpose
+  // CHECK: [[D:%.+]] = stablehlo.dot_general [[A]], [[B]], contracting_dims = [1] x [0] : (tensor<4x3xf32>, tensor<3x5xf32>) -> tensor<4x5xf32>
+  // CHECK: return [[D]]
+  %0 = stablehlo.transpose %a, dims = [1, 0] : (tensor<4x3xf32>) -> tensor<3x4xf32>
+  %1 = stablehlo.dot_general %0, %b, contracting_dims = [0] x [0] : (tensor<3x4xf32>, tensor<3x5xf32>) -> tensor<4x5xf32>
+  func.return %1 : tensor<4x5xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @dot_general_reordered_free_dims
+func.func @dot_general_reordered_free_dims(%a: tensor<3x4x5xf32>, %b: tensor<5x6xf32>) -> tensor<4x3x6xf32> {
+  // CHECK: [[T:%.+]] = stablehlo.transpose
+  // CHECK: stablehlo.dot_general [[T]]
+  %0 = stablehlo.transpose %a, dims = [1, 0, 2] : (tensor<3x4x5xf32>) -> tensor<4x3x5xf32>
+  %1 = stablehlo.dot_general %0, %b, contracting_dims = [2] x [0] : (tensor<4x3x5xf32>, tensor<5x6xf32>) -> tensor<4x3x6xf32>
+  func.return %1 : tensor<4x3x6xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @convolution
+// CHECK-SAME: ([[X:%.+]]: tensor<1x3x8x8xf32>, [[W:%.+]]: tensor<3x3x3x16xf32>)
+func.func @convolution(%x: tensor<1x3x8x8xf32>, %w: tensor<3x3x3x16xf32>) -> tensor<1x6x6x16xf32> {
+  // CHECK-NOT: stablehlo.transpose
+  // CHECK: stablehlo.convolution([[X]], [[W]])
+  // CHECK-SAME: dim_numbers = [b, f, 0, 1]x[0, 1, i, o]->[b, 0, 1, f]
+  %0 = stablehlo.transpose %x, dims = [0, 2, 3, 1] : (tensor<1x3x8x8xf32>) -> tensor<1x8x8x3xf32>
+  %1 = stablehlo.convolution(%0, %w)
+         dim_numbers = [b, 0, 1, f]x[0, 1, i, o]->[b, 0, 1, f],
+         window = {stride = [1, 1]}
+         {batch_group_count = 1 : i64, feature_group_count = 1 : i64} :
+       (tensor<1x8x8x3xf32>, tensor<3x3x3x16xf32>) -> tensor<1x6x6x16xf32>
+  func.return %1 : tensor<1x6x6x16xf32>
+}
@@ -0,0 +1,20 @@
+// RUN: stablehlo-translate --artifact-info --target=1.0.0 %S/stablehlo_legalize_to_vhlo.1_1_0.mlir.bc | FileCheck %s
+// RUN: stablehlo-translate --artifact-info --target=0.9.0 %S/stablehlo_legalize_to_vhlo.1_1_0.mlir.bc | FileCheck %s --check-prefix=CHECK-0_9_0
+// RUN: stablehlo-translate --artifact-info %S/stablehlo_legalize_to_vhlo.0_9_0.mlir.bc | FileCheck %s --check-prefix=CHECK-BYTECODE-0
+
+// CHECK: producer: StableHLO_v1.1.0
+// CHECK-NEXT: bytecode version: 6
+// CHECK-NEXT: compatible with 1.0.0: true
+// CHECK-NEXT: ops:
+// CHECK-NEXT:   builtin.module: 1
+// CHECK-NEXT:   vhlo.abs_v1: 3
+// CHECK-NEXT:   vhlo.add_v1: 41
+// CHECK:        vhlo.func_v1: 210
+// CHECK:        vhlo.gather_v2: 3
+
+// CHECK-0_9_0: compatible with 0.9.0: false
+
+// CHECK-BYTECODE-0: producer: StableHLO_v0.9.0
+// CHECK-BYTECODE-0-NEXT: bytecode version: 0
+// CHECK-BYTECODE-0-NEXT: ops:
+// CHECK-BYTECODE-0:   vhlo.func_v1:
@@ -0,0 +1,20 @@
+// RUN: stablehlo-translate --serialize --target=current --min-compressed-size=64 %s | stablehlo-translate --deserialize | FileCheck %s
+// RUN: stablehlo-translate --serialize --target=current --min-compressed-size=64 %s | stablehlo-translate --deserialize --min-resource-size=64 | FileCheck %s --check-prefix=CHECK-RESOURCE
+// RUN: not stablehlo-translate --serialize --target=1.0.0 --min-compressed-size=64 %s 2>&1 | FileCheck %s --check-prefix=CHECK-VERSION
+
+// CHECK-VERSION: compressed constants require a target version of at least 1.1.0
+
+// CHECK-LABEL: func @main
+// CHECK-RESOURCE-LABEL: func @main
+func.func @main() -> (tensor<32xf32>, tensor<4xf32>, tensor<64xf32>) {
+  // CHECK: stablehlo.constant dense<[1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00, 1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00, 1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00, 1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00, 1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00, 1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00, 1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00, 1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00]> : tensor<32xf32>
+  // CHECK: stablehlo.constant dense<[1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00]> : tensor<4xf32>
+  // CHECK: stablehlo.constant dense<1.000000e+00> : tensor<64xf32>
+  // CHECK-RESOURCE: stablehlo.constant dense_resource<vhlo_constant> : tensor<32xf32>
+  // CHECK-RESOURCE: stablehlo.constant dense<[1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00]> : tensor<4xf32>
+  // CHECK-RESOURCE: stablehlo.constant dense<1.000000e+00> : tensor<64xf32>
+  %0 = stablehlo.constant dense<[1.0, 2.0, 3.0, 4.0, 1.0, 2.0, 3.0, 4.0, 1.0, 2.0, 3.0, 4.0, 1.0, 2.0, 3.0, 4.0, 1.0, 2.0, 3.0, 4.0, 1.0, 2.0, 3.0, 4.0, 1.0, 2.0, 3.0, 4.0, 1.0, 2.0, 3.0, 4.0]> : tensor<32xf32>
+  %1 = stablehlo.constant dense<[1.0, 2.0, 3.0, 4.0]> : tensor<4xf32>
+  %2 = stablehlo.constant dense<1.0> : tensor<64xf32>
+  func.return %0, %1, %2 : tensor<32xf32>, tensor<4xf32>, tensor<64xf32>
+}
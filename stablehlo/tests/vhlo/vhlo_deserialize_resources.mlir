@@ -0,0 +1,15 @@
+// RUN: stablehlo-translate --serialize --target=current %s | stablehlo-translate --deserialize --min-resource-size=32 | FileCheck %s
+
+// CHECK-LABEL: func @main
+func.func @main() -> (tensor<8xf32>, tensor<4xf32>, tensor<16xf32>) {
+  // CHECK: stablehlo.constant dense_resource<vhlo_constant> : tensor<8xf32>
+  // CHECK: stablehlo.constant dense<[1.000000e+00, 2.000000e+00, 3.000000e+00, 4.000000e+00]> : tensor<4xf32>
+  // CHECK: stablehlo.constant dense<1.000000e+00> : tensor<16xf32>
+  %0 = stablehlo.constant dense<[1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0]> : tensor<8xf32>
+  %1 = stablehlo.constant dense<[1.0, 2.0, 3.0, 4.0]> : tensor<4xf32>
+  %2 = stablehlo.constant dense<1.0> : tensor<16xf32>
+  func.return %0, %1, %2 : tensor<8xf32>, tensor<4xf32>, tensor<16xf32>
+}
+
+// CHECK: dialect_resources
+// CHECK: vhlo_constant: "0x040000000000803F0000004000004040000080400000A0400000C0400000E04000000041"
@@ -0,0 +1,366 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// End-to-end benchmark of the path from a portable artifact to its
+// evaluation. For every artifact of the corpus, every repetition:
+//
+//   1. deserializes the artifact, see `deserializePortableArtifact`,
+//   2. refines the main function to static shapes, see
+//      `createStablehloRemoveDynamismPipeline`,
+//   3. runs `stablehlo-aggressive-simplification`,
+//   4. lowers a clone of the simplified module with
+//      `stablehlo-legalize-to-linalg`, and
+//   5. evaluates the simplified module with the reference interpreter on
+//      zero inputs,
+//
+// and reports percentiles of the latency of every stage, the peak number of
+// bytes which the interpreter allocated, and the peak resident set size of
+// the process, as text or as JSON which can be compared across commits.
+// Dynamic dimensions of the arguments of the main function are refined to
+// `--dynamic-dim-size`, which keeps the evaluation small.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SmallVectorExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/DialectRegistry.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Support/LogicalResult.h"
+#include "stablehlo/conversions/linalg/transforms/Passes.h"
+#include "stablehlo/dialect/Register.h"
+#include "stablehlo/dialect/Serialization.h"
+#include "stablehlo/reference/Api.h"
+#include "stablehlo/reference/Configuration.h"
+#include "stablehlo/reference/MemoryTracker.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Value.h"
+#include "stablehlo/transforms/Passes.h"
+#include "stablehlo/transforms/StablehloRefineShapes.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+llvm::cl::list<std::string> artifactFilenames(
+    llvm::cl::Positional, llvm::cl::desc("<portable artifacts>"),
+    llvm::cl::OneOrMore);
+
+llvm::cl::opt<std::string> outputFilename(
+    "o", llvm::cl::desc("Output filename"), llvm::cl::value_desc("filename"),
+    llvm::cl::init("-"));
+
+llvm::cl::opt<bool> emitJson(
+    "json", llvm::cl::desc("Report the results as JSON rather than as text"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<unsigned> repetitions(
+    "repetitions",
+    llvm::cl::desc("Number of times every artifact goes through all stages"),
+    llvm::cl::init(10));
+
+llvm::cl::opt<int64_t> dynamicDimSize(
+    "dynamic-dim-size",
+    llvm::cl::desc("Size to which the dynamic dimensions of the arguments of "
+                   "the main function are refined"),
+    llvm::cl::init(1));
+
+// The stages of the benchmark, in the order in which they run.
+enum Stage { kDeserialize, kRefine, kSimplify, kLower, kInterpret, kNumStages };
+
+constexpr StringRef kStageNames[kNumStages] = {
+    "deserialize", "refine", "simplify", "legalize_to_linalg", "interpret"};
+
+// Latencies of a stage in milliseconds, one per repetition.
+using Latencies = SmallVector<double>;
+
+// Results of the benchmark of an artifact.
+struct ArtifactResult {
+  std::string filename;
+  Latencies latencies[kNumStages];
+  int64_t numOps = 0;
+  int64_t interpreterPeakBytes = 0;
+  double peakMemoryMiB = 0;
+  // Empty unless a stage failed, in which case the latencies are incomplete.
+  std::string error;
+};
+
+// Returns the peak resident set size of the process in MiB, or 0 on
+// platforms where it isn't known. It's a high-water mark across all artifacts
+// benchmarked so far.
+double getPeakMemoryMiB() {
+#if defined(__linux__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+  // Reported in bytes.
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  // Reported in KiB.
+  return usage.ru_maxrss / 1024.0;
+#endif
+#else
+  return 0;
+#endif
+}
+
+// Returns the `percentile` of `latencies`, which must be sorted, with the
+// nearest-rank method.
+double getPercentile(ArrayRef<double> latencies, double percentile) {
+  if (latencies.empty()) return 0;
+  auto rank = static_cast<size_t>(
+      std::ceil(percentile / 100 * static_cast<double>(latencies.size())));
+  return latencies[std::max<size_t>(rank, 1) - 1];
+}
+
+// Returns zero inputs for `func` whose dynamic dimensions are
+// `dynamicDimSize`, or failure if it has arguments other than tensors of
+// integers, floats or booleans.
+FailureOr<SmallVector<InterpreterValue>> makeInputs(func::FuncOp func) {
+  Builder builder(func.getContext());
+  SmallVector<InterpreterValue> inputs;
+  for (Type type : func.getArgumentTypes()) {
+    auto tensorType = dyn_cast<RankedTensorType>(type);
+    if (!tensorType ||
+        !isa<IntegerType, FloatType>(tensorType.getElementType()))
+      return func.emitError("unsupported argument type ") << type;
+
+    SmallVector<int64_t> shape(tensorType.getShape());
+    for (auto &size : shape)
+      if (ShapedType::isDynamic(size)) size = dynamicDimSize;
+    auto staticType = tensorType.clone(shape);
+    auto zero = builder.getZeroAttr(staticType.getElementType());
+    inputs.emplace_back(makeTensor(DenseElementsAttr::get(staticType, zero)));
+  }
+  return inputs;
+}
+
+// Runs `stage` and appends its latency to `result`.
+template <typename StageFn>
+LogicalResult timeStage(ArtifactResult &result, Stage stage, StageFn fn) {
+  auto start = std::chrono::steady_clock::now();
+  LogicalResult status = fn();
+  auto end = std::chrono::steady_clock::now();
+  if (failed(status)) {
+    result.error = (kStageNames[stage] + " failed").str();
+    return failure();
+  }
+  result.latencies[stage].push_back(
+      std::chrono::duration<double, std::milli>(end - start).count());
+  return success();
+}
+
+// Runs all stages on the artifact `filename` `repetitions` times. The context
+// is shared by the repetitions, like a service which keeps one context for
+// the artifacts it serves. Diagnostics are printed to stderr.
+ArtifactResult benchmarkArtifact(const DialectRegistry &registry,
+                                 StringRef filename) {
+  ArtifactResult result;
+  result.filename = filename.str();
+
+  std::string errorMessage;
+  auto file = openInputFile(filename, &errorMessage);
+  if (!file) {
+    result.error = errorMessage;
+    return result;
+  }
+
+  MLIRContext context(registry);
+  context.loadAllAvailableDialects();
+  MemoryTracker memoryTracker;
+  InterpreterConfiguration config;
+  config.memoryTracker = &memoryTracker;
+
+  for (unsigned i = 0; i < repetitions; ++i) {
+    OwningOpRef<ModuleOp> module;
+    if (failed(timeStage(result, kDeserialize, [&] {
+          module = deserializePortableArtifact(file->getBuffer(), &context);
+          return success(static_cast<bool>(module));
+        })))
+      break;
+    if (i == 0) module->walk([&](Operation *) { ++result.numOps; });
+
+    func::FuncOp main = getStablehloRefineShapesTarget(*module);
+    if (!main) {
+      result.error = "no main function";
+      break;
+    }
+    auto inputs = makeInputs(main);
+    if (failed(inputs)) {
+      result.error = "unsupported arguments";
+      break;
+    }
+    SmallVector<Type> refinedTypes = llvm::map_to_vector(
+        *inputs, [](const InterpreterValue &input) -> Type {
+          return input.getTensor().getType();
+        });
+
+    if (failed(timeStage(result, kRefine, [&] {
+          PassManager pm(&context);
+          createStablehloRemoveDynamismPipeline(pm, refinedTypes);
+          return pm.run(*module);
+        })))
+      break;
+
+    if (failed(timeStage(result, kSimplify, [&] {
+          PassManager pm(&context);
+          pm.addNestedPass<func::FuncOp>(
+              createStablehloAggressiveSimplificationPass());
+          return pm.run(*module);
+        })))
+      break;
+
+    // Lowers a clone, since the interpreter evaluates StableHLO. Cloning is
+    // not measured.
+    OwningOpRef<ModuleOp> clone = module->clone();
+    if (failed(timeStage(result, kLower, [&] {
+          PassManager pm(&context);
+          pm.addPass(createStablehloLegalizeToLinalgPass());
+          return pm.run(*clone);
+        })))
+      break;
+    clone = nullptr;
+
+    if (failed(timeStage(result, kInterpret, [&] {
+          return evalModule(*module, *inputs, config);
+        })))
+      break;
+  }
+
+  result.interpreterPeakBytes = memoryTracker.getPeakBytes();
+  result.peakMemoryMiB = getPeakMemoryMiB();
+  return result;
+}
+
+void printJson(ArrayRef<ArtifactResult> results, llvm::raw_ostream &os) {
+  llvm::json::OStream json(os, /*IndentSize=*/2);
+  json.object([&] {
+    json.attribute("repetitions", static_cast<int64_t>(repetitions));
+    json.attribute("dynamic_dim_size", dynamicDimSize.getValue());
+    json.attributeArray("artifacts", [&] {
+      for (const auto &result : results) {
+        json.object([&] {
+          json.attribute("filename", result.filename);
+          json.attribute("ops", result.numOps);
+          if (!result.error.empty()) json.attribute("error", result.error);
+          json.attributeObject("stages", [&] {
+            for (int stage = 0; stage < kNumStages; ++stage) {
+              Latencies latencies = result.latencies[stage];
+              if (latencies.empty()) continue;
+              llvm::sort(latencies);
+              double total = 0;
+              for (double latency : latencies) total += latency;
+              json.attributeObject(kStageNames[stage], [&] {
+                json.attribute("min_ms", latencies.front());
+                json.attribute("mean_ms", total / latencies.size());
+                json.attribute("p50_ms", getPercentile(latencies, 50));
+                json.attribute("p90_ms", getPercentile(latencies, 90));
+                json.attribute("p99_ms", getPercentile(latencies, 99));
+                json.attribute("max_ms", latencies.back());
+              });
+            }
+          });
+          json.attribute("interpreter_peak_bytes",
+                         result.interpreterPeakBytes);
+          json.attribute("peak_memory_MiB", result.peakMemoryMiB);
+        });
+      }
+    });
+  });
+  os << "\n";
+}
+
+void printText(ArrayRef<ArtifactResult> results, llvm::raw_ostream &os) {
+  for (const auto &result : results) {
+    os << result.filename << " (" << result.numOps << " ops)\n";
+    if (!result.error.empty()) os << "  error: " << result.error << "\n";
+    os << llvm::formatv("  {0,-20}{1,12}{2,12}{3,12}{4,12}\n", "stage",
+                        "p50 ms", "p90 ms", "p99 ms", "max ms");
+    for (int stage = 0; stage < kNumStages; ++stage) {
+      Latencies latencies = result.latencies[stage];
+      if (latencies.empty()) continue;
+      llvm::sort(latencies);
+      os << llvm::formatv("  {0,-20}{1,12:f3}{2,12:f3}{3,12:f3}{4,12:f3}\n",
+                          kStageNames[stage], getPercentile(latencies, 50),
+                          getPercentile(latencies, 90),
+                          getPercentile(latencies, 99), latencies.back());
+    }
+    os << llvm::formatv("  interpreter peak: {0} bytes, peak RSS: {1:f1} MiB\n",
+                        result.interpreterPeakBytes, result.peakMemoryMiB);
+  }
+}
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
+
+int main(int argc, char **argv) {
+  llvm::InitLLVM y(argc, argv);
+  llvm::cl::ParseCommandLineOptions(
+      argc, argv, "StableHLO end-to-end throughput benchmark\n");
+
+  mlir::DialectRegistry registry;
+  mlir::stablehlo::registerAllDialects(registry);
+
+  std::vector<mlir::stablehlo::ArtifactResult> results;
+  bool hasErrors = false;
+  for (const auto &filename : mlir::stablehlo::artifactFilenames) {
+    results.push_back(mlir::stablehlo::benchmarkArtifact(registry, filename));
+    if (!results.back().error.empty()) {
+      llvm::errs() << filename << ": " << results.back().error << "\n";
+      hasErrors = true;
+    }
+  }
+
+  std::string errorMessage;
+  auto output =
+      mlir::openOutputFile(mlir::stablehlo::outputFilename, &errorMessage);
+  if (!output) {
+    llvm::errs() << errorMessage << "\n";
+    return 1;
+  }
+  if (mlir::stablehlo::emitJson)
+    mlir::stablehlo::printJson(results, output->os());
+  else
+    mlir::stablehlo::printText(results, output->os());
+  output->keep();
+  return hasErrors ? 1 : 0;
+}
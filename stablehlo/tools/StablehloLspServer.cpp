@@ -0,0 +1,948 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/tools/StablehloLspServer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SMLoc.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include "mlir/AsmParser/AsmParser.h"
+#include "mlir/AsmParser/AsmParserState.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/IR/Verifier.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Interfaces/InferTypeOpInterface.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Tools/lsp-server-support/Logging.h"
+#include "mlir/Tools/lsp-server-support/Protocol.h"
+#include "mlir/Tools/lsp-server-support/Transport.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// The name of the buffers of chunks, which tells their locations apart from
+// the locations of the program.
+constexpr StringLiteral kBufferName = "<stablehlo-lsp-chunk>";
+
+// The resource that elided constants refer to, like the printer's.
+constexpr StringLiteral kElidedResource = "__elided__";
+
+//===----------------------------------------------------------------------===//
+// Layout
+//===----------------------------------------------------------------------===//
+
+// The lines [begin, end) of a document.
+struct LineRange {
+  unsigned size() const { return end - begin; }
+
+  unsigned begin = 0;
+  unsigned end = 0;
+};
+
+// Returns the text of `range`, which spans consecutive `lines` of a document.
+StringRef getText(ArrayRef<StringRef> lines, LineRange range) {
+  const char *begin = lines[range.begin].data();
+  return StringRef(begin, lines[range.end - 1].end() - begin);
+}
+
+// Returns the nesting depth of brackets after `line`, starting at `depth`.
+// Brackets in string literals and comments don't count.
+int scanBrackets(StringRef line, int depth) {
+  for (size_t i = 0, e = line.size(); i < e; ++i) {
+    switch (line[i]) {
+      case '"':
+        // Skip over the string, whose escapes may include quotes.
+        while ((i = line.find_first_of("\"\\", i + 1)) != StringRef::npos &&
+               line[i] == '\\')
+          ++i;
+        if (i == StringRef::npos) return depth;
+        break;
+      case '/':
+        if (line.substr(i).starts_with("//")) return depth;
+        break;
+      case '(':
+      case '[':
+      case '{':
+        ++depth;
+        break;
+      case ')':
+      case ']':
+      case '}':
+        --depth;
+        break;
+    }
+  }
+  return depth;
+}
+
+// Returns the sections of a document, i.e. the lines between `// -----`
+// markers, which are parsed independently like in `stablehlo-opt`.
+SmallVector<LineRange> splitSections(ArrayRef<StringRef> lines) {
+  SmallVector<LineRange> sections = {{0, 0}};
+  for (auto [i, line] : llvm::enumerate(lines)) {
+    if (line.trim() == "// -----") {
+      sections.back().end = i;
+      sections.push_back({static_cast<unsigned>(i) + 1, 0});
+    }
+  }
+  sections.back().end = lines.size();
+  return sections;
+}
+
+// The top-level structure of a section of a document.
+struct SectionLayout {
+  // The definitions of attribute and type aliases, e.g. `#loc1 = ...`.
+  llvm::StringMap<LineRange> aliases;
+
+  // The top-level operations of the section, or of its module.
+  SmallVector<LineRange> chunks;
+};
+
+// Lays out `section` by matching brackets rather than parsing it, which is
+// cheap enough to redo on every edit.
+SectionLayout layoutSection(ArrayRef<StringRef> lines, LineRange section) {
+  enum class StatementKind { Alias, Metadata, Operation };
+
+  SectionLayout layout;
+  int depth = 0;
+  // The depth of the statements to lay out, which is 1 within a module.
+  int topLevelDepth = 0;
+  std::optional<unsigned> statementBegin;
+  StatementKind statementKind = StatementKind::Operation;
+  StringRef aliasName;
+
+  auto endStatement = [&](unsigned end) {
+    LineRange range{*statementBegin, end};
+    if (statementKind == StatementKind::Alias)
+      layout.aliases.try_emplace(aliasName, range);
+    else if (statementKind == StatementKind::Operation)
+      layout.chunks.push_back(range);
+    // File metadata is skipped: operations can refer to resources whose blobs
+    // aren't defined, which keeps them out of every chunk.
+    statementBegin.reset();
+  };
+
+  for (unsigned i = section.begin; i < section.end; ++i) {
+    StringRef line = lines[i];
+    int lineDepth = depth;
+    depth = scanBrackets(line, depth);
+
+    if (!statementBegin) {
+      StringRef token = line.ltrim();
+      if (lineDepth != topLevelDepth || token.empty() ||
+          token.starts_with("//"))
+        continue;
+      if (token.starts_with("}")) {
+        // The end of the module.
+        topLevelDepth = std::max(depth, 0);
+        continue;
+      }
+      if (lineDepth == 0 && token.starts_with("module") && depth > 0) {
+        topLevelDepth = depth;
+        continue;
+      }
+
+      statementBegin = i;
+      if (lineDepth == 0 &&
+          (token.starts_with("#") || token.starts_with("!"))) {
+        statementKind = StatementKind::Alias;
+        aliasName =
+            token.take_until([](char c) { return c == ' ' || c == '='; });
+      } else if (lineDepth == 0 && token.starts_with("{-#")) {
+        statementKind = StatementKind::Metadata;
+      } else {
+        statementKind = StatementKind::Operation;
+      }
+    }
+
+    if (depth <= topLevelDepth) endStatement(i + 1);
+  }
+  if (statementBegin) endStatement(section.end);
+  return layout;
+}
+
+// Calls `callback` with each name in `text` that may refer to an alias, e.g.
+// `#loc1` in `loc(#loc1)`.
+void forEachAliasReference(StringRef text,
+                           llvm::function_ref<void(StringRef)> callback) {
+  auto isAliasChar = [](char c) {
+    return llvm::isAlnum(c) || c == '_' || c == '$' || c == '.';
+  };
+  size_t i = text.find_first_of("#!");
+  while (i != StringRef::npos) {
+    size_t end = i + 1;
+    while (end < text.size() && isAliasChar(text[end])) ++end;
+    if (end > i + 1) callback(text.slice(i, end));
+    i = text.find_first_of("#!", end);
+  }
+}
+
+// Returns the definitions of the aliases that `chunk` refers to, directly or
+// through other aliases, in the order of the document.
+SmallVector<LineRange> collectAliases(const SectionLayout &layout,
+                                      ArrayRef<StringRef> lines,
+                                      LineRange chunk) {
+  SmallVector<LineRange> aliases;
+  llvm::StringSet<> visited;
+  SmallVector<LineRange> worklist = {chunk};
+  while (!worklist.empty()) {
+    forEachAliasReference(
+        getText(lines, worklist.pop_back_val()), [&](StringRef name) {
+          auto it = layout.aliases.find(name);
+          if (it == layout.aliases.end() || !visited.insert(name).second)
+            return;
+          aliases.push_back(it->second);
+          worklist.push_back(it->second);
+        });
+  }
+  llvm::sort(aliases, [](LineRange lhs, LineRange rhs) {
+    return lhs.begin < rhs.begin;
+  });
+  return aliases;
+}
+
+// Replaces hexadecimal dense literals longer than `threshold` characters in
+// `text` by elided resources padded with spaces to the same length, which
+// preserves source locations.
+void elideLargeConstants(std::string &text, unsigned threshold) {
+  static constexpr StringLiteral kLiteralPrefix = "dense<\"0x";
+  static constexpr StringLiteral kElided = "dense_resource<__elided__>";
+  if (threshold == 0) return;
+
+  size_t pos = text.find(kLiteralPrefix.data());
+  while (pos != std::string::npos) {
+    size_t end = text.find("\">", pos);
+    if (end == std::string::npos) return;
+    end += 2;
+    StringRef digits =
+        StringRef(text).slice(pos + kLiteralPrefix.size(), end - 2);
+    if (end - pos > threshold && end - pos >= kElided.size() &&
+        llvm::all_of(digits, llvm::isHexDigit)) {
+      text.replace(pos, kElided.size(), kElided.data());
+      std::fill(text.begin() + pos + kElided.size(), text.begin() + end, ' ');
+    }
+    pos = text.find(kLiteralPrefix.data(), end);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// ParsedChunk
+//===----------------------------------------------------------------------===//
+
+// A top-level operation of a document, parsed and verified on its own along
+// with the aliases it refers to. It only depends on the text of its buffer,
+// so it's shared by the versions of the document in which that is the same.
+struct ParsedChunk {
+  // Returns the range of the buffer that `loc` refers to, or the beginning of
+  // the operation if there is none.
+  lsp::Range getRange(Location loc) {
+    std::optional<lsp::Range> range;
+    loc->walk([&](Location nested) {
+      auto fileLoc = dyn_cast<FileLineColLoc>(nested);
+      if (!fileLoc || fileLoc.getFilename().getValue() != kBufferName)
+        return WalkResult::advance();
+      SMLoc smLoc = sourceMgr.FindLocForLineAndColumn(
+          sourceMgr.getMainFileID(), fileLoc.getLine(), fileLoc.getColumn());
+      range = lsp::Range(sourceMgr, AsmParserState::convertIdLocToRange(smLoc));
+      return WalkResult::interrupt();
+    });
+    return range.value_or(lsp::Range(lsp::Position(prefixLines, 0)));
+  }
+
+  StringRef getBuffer() const {
+    return sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID())->getBuffer();
+  }
+
+  llvm::SourceMgr sourceMgr;
+  AsmParserState asmState;
+  Block block;
+  // The number of lines of alias definitions before the operation.
+  unsigned prefixLines = 0;
+  // Diagnostics, in lines of the buffer.
+  std::vector<lsp::Diagnostic> diagnostics;
+};
+
+// The chunk whose diagnostics are collected on this thread.
+thread_local ParsedChunk *diagnosedChunk = nullptr;
+
+lsp::DiagnosticSeverity getSeverity(DiagnosticSeverity severity) {
+  switch (severity) {
+    case DiagnosticSeverity::Note:
+      return lsp::DiagnosticSeverity::Hint;
+    case DiagnosticSeverity::Warning:
+      return lsp::DiagnosticSeverity::Warning;
+    case DiagnosticSeverity::Error:
+      return lsp::DiagnosticSeverity::Error;
+    case DiagnosticSeverity::Remark:
+      return lsp::DiagnosticSeverity::Information;
+  }
+  llvm_unreachable("unknown diagnostic severity");
+}
+
+LogicalResult collectDiagnostic(Diagnostic &diag) {
+  ParsedChunk *chunk = diagnosedChunk;
+  if (!chunk) return failure();
+
+  lsp::Diagnostic lspDiag;
+  lspDiag.source = "stablehlo";
+  lspDiag.severity = getSeverity(diag.getSeverity());
+  lspDiag.range = chunk->getRange(diag.getLocation());
+  lspDiag.message = diag.str();
+  for (Diagnostic &note : diag.getNotes())
+    lspDiag.message += "\nnote: " + note.str();
+  chunk->diagnostics.push_back(std::move(lspDiag));
+  return success();
+}
+
+std::unique_ptr<ParsedChunk> parseChunk(StringRef buffer, unsigned prefixLines,
+                                        MLIRContext &context) {
+  auto chunk = std::make_unique<ParsedChunk>();
+  chunk->prefixLines = prefixLines;
+  chunk->sourceMgr.AddNewSourceBuffer(
+      llvm::MemoryBuffer::getMemBufferCopy(buffer, kBufferName), SMLoc());
+
+  diagnosedChunk = chunk.get();
+  ParserConfig config(&context, /*verifyAfterParse=*/false);
+  if (failed(parseAsmSourceFile(chunk->sourceMgr, &chunk->block, config,
+                                &chunk->asmState))) {
+    chunk->block.clear();
+    chunk->asmState = AsmParserState();
+  } else {
+    // Programs usually have locations of their own, so the verifier could
+    // only report errors in the document through the locations of operations
+    // in the buffer.
+    for (const auto &def : chunk->asmState.getOpDefs()) {
+      auto [line, column] = chunk->sourceMgr.getLineAndColumn(def.loc.Start);
+      Location bufferLoc =
+          FileLineColLoc::get(&context, kBufferName, line, column);
+      def.op->setLoc(FusedLoc::get(&context, {bufferLoc, def.op->getLoc()}));
+    }
+    for (Operation &op : chunk->block) (void)verify(&op);
+  }
+  diagnosedChunk = nullptr;
+  return chunk;
+}
+
+//===----------------------------------------------------------------------===//
+// Hover
+//===----------------------------------------------------------------------===//
+
+// Prints the locations of `op` in the program, i.e. other than in the buffer.
+// Operations without locations of their own are located in the buffer by the
+// parser, so there may be none.
+void printProgramLocation(Operation *op, raw_ostream &os) {
+  auto fusedLoc = dyn_cast<FusedLoc>(op->getLoc());
+  if (!fusedLoc) return;
+  SmallVector<Location> locs;
+  for (Location loc : fusedLoc.getLocations().drop_front()) {
+    auto fileLoc = dyn_cast<FileLineColLoc>(loc);
+    if (!fileLoc || fileLoc.getFilename().getValue() != kBufferName)
+      locs.push_back(loc);
+  }
+  if (locs.empty()) return;
+  os << "\n\nLocation: ";
+  llvm::interleaveComma(locs, os,
+                        [&](Location loc) { os << "`" << loc << "`"; });
+}
+
+std::string buildOperationHover(Operation *op) {
+  std::string hover;
+  llvm::raw_string_ostream os(hover);
+  os << "`" << op->getName() << "`";
+
+  auto printTypes = [&](TypeRange types) {
+    llvm::interleaveComma(types, os,
+                          [&](Type type) { os << "`" << type << "`"; });
+  };
+  if (op->getNumResults()) {
+    os << "\n\nResults: ";
+    printTypes(op->getResultTypes());
+  }
+
+  // Inferring the types of a single operation is cheap, and shows what
+  // dynamic result types can be refined to.
+  if (auto inferTypeOp = dyn_cast<InferTypeOpInterface>(op)) {
+    SmallVector<Type> inferredTypes;
+    if (succeeded(inferTypeOp.inferReturnTypes(
+            op->getContext(), /*location=*/std::nullopt, op->getOperands(),
+            op->getAttrDictionary(), op->getPropertiesStorage(),
+            op->getRegions(), inferredTypes)) &&
+        !llvm::equal(inferredTypes, op->getResultTypes())) {
+      os << "\n\nInferred: ";
+      printTypes(inferredTypes);
+    }
+  }
+
+  for (NamedAttribute attr : op->getAttrs()) {
+    auto resource = dyn_cast<DenseResourceElementsAttr>(attr.getValue());
+    if (resource && resource.getRawHandle().getKey() == kElidedResource)
+      os << "\n\n`" << attr.getName().getValue()
+         << "` is elided from the in-memory IR.";
+  }
+
+  printProgramLocation(op, os);
+  return hover;
+}
+
+std::string buildValueHover(Value value) {
+  std::string hover;
+  llvm::raw_string_ostream os(hover);
+  if (auto result = dyn_cast<OpResult>(value)) {
+    os << "Result #" << result.getResultNumber() << " of `"
+       << result.getOwner()->getName() << "`";
+  } else {
+    os << "Argument #" << cast<BlockArgument>(value).getArgNumber();
+  }
+  os << "\n\nType: `" << value.getType() << "`";
+  return hover;
+}
+
+bool contains(SMRange range, SMLoc loc) {
+  return range.Start.getPointer() <= loc.getPointer() &&
+         loc.getPointer() <= range.End.getPointer();
+}
+
+//===----------------------------------------------------------------------===//
+// Document
+//===----------------------------------------------------------------------===//
+
+// A top-level operation at some lines of a version of a document.
+struct Chunk {
+  // Returns the line of the document of `line` of the buffer.
+  int toDocument(int line) const {
+    for (LineRange alias : aliases) {
+      if (line < static_cast<int>(alias.size())) return alias.begin + line;
+      line -= alias.size();
+    }
+    return range.begin + line;
+  }
+
+  lsp::Range toDocument(const lsp::Range &bufferRange) const {
+    return lsp::Range(lsp::Position(toDocument(bufferRange.start.line),
+                                    bufferRange.start.character),
+                      lsp::Position(toDocument(bufferRange.end.line),
+                                    bufferRange.end.character));
+  }
+
+  lsp::Range toDocument(SMRange bufferRange) const {
+    return toDocument(lsp::Range(parsed->sourceMgr, bufferRange));
+  }
+
+  // Returns the location in the buffer of `pos` in the operation.
+  SMLoc toBuffer(const lsp::Position &pos) const {
+    lsp::Position bufferPos(parsed->prefixLines + pos.line - range.begin,
+                            pos.character);
+    return bufferPos.getAsSMLoc(parsed->sourceMgr);
+  }
+
+  std::shared_ptr<ParsedChunk> parsed;
+  SmallVector<LineRange> aliases;
+  LineRange range;
+};
+
+using DefinitionCallback = llvm::function_ref<void(
+    const Chunk &, const AsmParserState::SMDefinition &)>;
+
+// A document open in the client.
+class Document {
+ public:
+  Document(const DialectRegistry &registry, llvm::ThreadPoolInterface &pool,
+           const LspServerOptions &options)
+      : context(registry, MLIRContext::Threading::DISABLED),
+        options(options) {
+    context.setThreadPool(pool);
+    context.getDiagEngine().registerHandler(collectDiagnostic);
+  }
+
+  std::string &getContents() { return contents; }
+  int64_t getVersion() const { return version; }
+
+  /// Updates the document after its contents changed to `version`, which
+  /// reparses the top-level operations whose text changed.
+  void update(int64_t version, std::vector<lsp::Diagnostic> &diagnostics);
+
+  void findDefinitions(const lsp::URIForFile &uri, const lsp::Position &pos,
+                       std::vector<lsp::Location> &locations);
+  void findReferences(const lsp::URIForFile &uri, const lsp::Position &pos,
+                      std::vector<lsp::Location> &locations);
+  std::optional<lsp::Hover> findHover(const lsp::Position &pos);
+  void findDocumentSymbols(std::vector<lsp::DocumentSymbol> &symbols);
+
+ private:
+  // Returns the chunk at `line` of the document, if any.
+  const Chunk *findChunk(int line) const;
+
+  // Calls `callback` with the definition of the value, block or argument
+  // defined or used at `pos`, if any.
+  void findDefinition(const lsp::Position &pos,
+                      DefinitionCallback callback);
+
+  MLIRContext context;
+  const LspServerOptions &options;
+  std::string contents;
+  int64_t version = 0;
+  std::vector<StringRef> lines;
+  std::vector<Chunk> chunks;
+  // The chunks in `chunks`, by hash of their buffer.
+  llvm::DenseMap<uint64_t, std::shared_ptr<ParsedChunk>> parsedChunks;
+};
+
+void Document::update(int64_t newVersion,
+                      std::vector<lsp::Diagnostic> &diagnostics) {
+  version = newVersion;
+  SmallVector<StringRef> splitLines;
+  StringRef(contents).split(splitLines, '\n');
+  lines.assign(splitLines.begin(), splitLines.end());
+
+  // Lay out the document, and find which chunks need to be parsed.
+  struct PendingChunk {
+    size_t index;
+    std::string buffer;
+    uint64_t hash;
+  };
+  std::vector<Chunk> newChunks;
+  std::vector<PendingChunk> pendingChunks;
+  for (LineRange section : splitSections(lines)) {
+    SectionLayout layout = layoutSection(lines, section);
+    for (LineRange range : layout.chunks) {
+      Chunk chunk;
+      chunk.aliases = collectAliases(layout, lines, range);
+      chunk.range = range;
+
+      std::string buffer;
+      for (LineRange alias : chunk.aliases)
+        (buffer += getText(lines, alias)) += '\n';
+      buffer += getText(lines, range);
+      elideLargeConstants(buffer, options.elideConstantsLargerThan);
+
+      uint64_t hash = llvm::xxh3_64bits(llvm::arrayRefFromStringRef(buffer));
+      auto it = parsedChunks.find(hash);
+      if (it != parsedChunks.end() && it->second->getBuffer() == buffer)
+        chunk.parsed = it->second;
+      else
+        pendingChunks.push_back({newChunks.size(), std::move(buffer), hash});
+      newChunks.push_back(std::move(chunk));
+    }
+  }
+
+  parallelForEach(&context, pendingChunks, [&](const PendingChunk &pending) {
+    Chunk &chunk = newChunks[pending.index];
+    unsigned prefixLines = 0;
+    for (LineRange alias : chunk.aliases) prefixLines += alias.size();
+    chunk.parsed = parseChunk(pending.buffer, prefixLines, context);
+  });
+  if (!pendingChunks.empty())
+    lsp::Logger::info("Parsed {0} of {1} chunks", pendingChunks.size(),
+                      newChunks.size());
+
+  // Drop the chunks that were edited away.
+  chunks = std::move(newChunks);
+  parsedChunks.clear();
+  for (const Chunk &chunk : chunks)
+    parsedChunks.try_emplace(llvm::xxh3_64bits(
+        llvm::arrayRefFromStringRef(chunk.parsed->getBuffer())),
+                             chunk.parsed);
+
+  // Diagnostics in alias definitions are reported by all their users.
+  llvm::StringSet<> aliasDiagnostics;
+  for (const Chunk &chunk : chunks) {
+    for (const lsp::Diagnostic &diag : chunk.parsed->diagnostics) {
+      lsp::Diagnostic lspDiag = diag;
+      lspDiag.range = chunk.toDocument(diag.range);
+      if (diag.range.start.line < static_cast<int>(chunk.parsed->prefixLines)) {
+        std::string key =
+            llvm::formatv("{0}:{1}:{2}", lspDiag.range.start.line,
+                          lspDiag.range.start.character, lspDiag.message);
+        if (!aliasDiagnostics.insert(key).second) continue;
+      }
+      diagnostics.push_back(std::move(lspDiag));
+    }
+  }
+}
+
+const Chunk *Document::findChunk(int line) const {
+  auto it = llvm::partition_point(chunks, [&](const Chunk &chunk) {
+    return static_cast<int>(chunk.range.end) <= line;
+  });
+  if (it == chunks.end() || static_cast<int>(it->range.begin) > line)
+    return nullptr;
+  return &*it;
+}
+
+void Document::findDefinition(const lsp::Position &pos,
+                              DefinitionCallback callback) {
+  const Chunk *chunk = findChunk(pos.line);
+  if (!chunk) return;
+  SMLoc loc = chunk->toBuffer(pos);
+  auto isDefinedOrUsed = [&](const AsmParserState::SMDefinition &def) {
+    return contains(def.loc, loc) ||
+           llvm::any_of(def.uses,
+                        [&](SMRange use) { return contains(use, loc); });
+  };
+
+  const AsmParserState &asmState = chunk->parsed->asmState;
+  for (const auto &op : asmState.getOpDefs()) {
+    for (const auto &group : op.resultGroups) {
+      if (isDefinedOrUsed(group.definition))
+        return callback(*chunk, group.definition);
+    }
+  }
+  for (const auto &block : asmState.getBlockDefs()) {
+    if (isDefinedOrUsed(block.definition))
+      return callback(*chunk, block.definition);
+    for (const auto &arg : block.arguments) {
+      if (isDefinedOrUsed(arg)) return callback(*chunk, arg);
+    }
+  }
+}
+
+// Returns the name of the symbol referenced at `column` of `line`, e.g.
+// `main` in `call @main`, if any.
+std::optional<StringRef> getSymbolReference(StringRef line, size_t column) {
+  auto isSymbolChar = [](char c) {
+    return llvm::isAlnum(c) || c == '_' || c == '$' || c == '.' || c == '-';
+  };
+  if (column < line.size() && line[column] == '@') ++column;
+  if (column > line.size()) return std::nullopt;
+  size_t begin = column;
+  while (begin > 0 && isSymbolChar(line[begin - 1])) --begin;
+  size_t end = column;
+  while (end < line.size() && isSymbolChar(line[end])) ++end;
+  if (begin == 0 || line[begin - 1] != '@' || begin == end)
+    return std::nullopt;
+  return line.slice(begin, end);
+}
+
+void Document::findDefinitions(const lsp::URIForFile &uri,
+                               const lsp::Position &pos,
+                               std::vector<lsp::Location> &locations) {
+  findDefinition(pos, [&](const Chunk &chunk,
+                          const AsmParserState::SMDefinition &def) {
+    locations.emplace_back(uri, chunk.toDocument(def.loc));
+  });
+  if (!locations.empty() || pos.line >= static_cast<int>(lines.size())) return;
+
+  // Symbols are mostly defined by other top-level operations.
+  std::optional<StringRef> name =
+      getSymbolReference(lines[pos.line], pos.character);
+  if (!name) return;
+  for (const Chunk &chunk : chunks) {
+    for (Operation &op : chunk.parsed->block) {
+      auto symName =
+          op.getAttrOfType<StringAttr>(SymbolTable::getSymbolAttrName());
+      if (!symName || symName.getValue() != *name) continue;
+      if (const auto *def = chunk.parsed->asmState.getOpDef(&op))
+        locations.emplace_back(uri, chunk.toDocument(def->loc));
+    }
+  }
+}
+
+void Document::findReferences(const lsp::URIForFile &uri,
+                              const lsp::Position &pos,
+                              std::vector<lsp::Location> &locations) {
+  findDefinition(pos, [&](const Chunk &chunk,
+                          const AsmParserState::SMDefinition &def) {
+    locations.emplace_back(uri, chunk.toDocument(def.loc));
+    for (SMRange use : def.uses)
+      locations.emplace_back(uri, chunk.toDocument(use));
+  });
+}
+
+std::optional<lsp::Hover> Document::findHover(const lsp::Position &pos) {
+  const Chunk *chunk = findChunk(pos.line);
+  if (!chunk) return std::nullopt;
+  SMLoc loc = chunk->toBuffer(pos);
+
+  auto buildHover = [&](SMRange range, std::string contents) {
+    lsp::Hover hover(chunk->toDocument(range));
+    hover.contents.kind = lsp::MarkupKind::Markdown;
+    hover.contents.value = std::move(contents);
+    return hover;
+  };
+  auto findRange = [&](const AsmParserState::SMDefinition &def)
+      -> std::optional<SMRange> {
+    if (contains(def.loc, loc)) return def.loc;
+    for (SMRange use : def.uses)
+      if (contains(use, loc)) return use;
+    return std::nullopt;
+  };
+
+  const AsmParserState &asmState = chunk->parsed->asmState;
+  for (const auto &op : asmState.getOpDefs()) {
+    if (contains(op.loc, loc))
+      return buildHover(op.loc, buildOperationHover(op.op));
+    for (auto [i, group] : llvm::enumerate(op.resultGroups)) {
+      std::optional<SMRange> range = findRange(group.definition);
+      if (!range) continue;
+      unsigned end = i + 1 < op.resultGroups.size()
+                         ? op.resultGroups[i + 1].startIndex
+                         : op.op->getNumResults();
+      std::string contents;
+      for (unsigned j = group.startIndex; j < end; ++j)
+        contents += (j == group.startIndex ? "" : "\n\n---\n\n") +
+                    buildValueHover(op.op->getResult(j));
+      return buildHover(*range, std::move(contents));
+    }
+  }
+  for (const auto &block : asmState.getBlockDefs()) {
+    for (auto [i, arg] : llvm::enumerate(block.arguments)) {
+      if (std::optional<SMRange> range = findRange(arg))
+        return buildHover(*range,
+                          buildValueHover(block.block->getArgument(i)));
+    }
+  }
+  return std::nullopt;
+}
+
+void Document::findDocumentSymbols(std::vector<lsp::DocumentSymbol> &symbols) {
+  for (const Chunk &chunk : chunks) {
+    for (Operation &op : chunk.parsed->block) {
+      auto symName =
+          op.getAttrOfType<StringAttr>(SymbolTable::getSymbolAttrName());
+      const auto *def = chunk.parsed->asmState.getOpDef(&op);
+      if (!symName || !def) continue;
+      lsp::Range range(lsp::Position(chunk.range.begin, 0),
+                       lsp::Position(chunk.range.end, 0));
+      symbols.emplace_back(symName.getValue(),
+                           isa<FunctionOpInterface>(op)
+                               ? lsp::SymbolKind::Function
+                               : lsp::SymbolKind::Variable,
+                           range, chunk.toDocument(def->loc));
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// LspServer
+//===----------------------------------------------------------------------===//
+
+class LspServer {
+ public:
+  LspServer(DialectRegistry &registry, const LspServerOptions &options)
+      : registry(registry), options(options) {}
+
+  void onInitialize(const lsp::InitializeParams &params,
+                    lsp::Callback<llvm::json::Value> reply);
+  void onInitialized(const lsp::InitializedParams &params) {}
+  void onShutdown(const lsp::NoParams &params,
+                  lsp::Callback<std::nullptr_t> reply);
+
+  void onDocumentDidOpen(const lsp::DidOpenTextDocumentParams &params);
+  void onDocumentDidClose(const lsp::DidCloseTextDocumentParams &params);
+  void onDocumentDidChange(const lsp::DidChangeTextDocumentParams &params);
+
+  void onGoToDefinition(const lsp::TextDocumentPositionParams &params,
+                        lsp::Callback<std::vector<lsp::Location>> reply);
+  void onReference(const lsp::ReferenceParams &params,
+                   lsp::Callback<std::vector<lsp::Location>> reply);
+  void onHover(const lsp::TextDocumentPositionParams &params,
+               lsp::Callback<std::optional<lsp::Hover>> reply);
+  void onDocumentSymbol(const lsp::DocumentSymbolParams &params,
+                        lsp::Callback<std::vector<lsp::DocumentSymbol>> reply);
+
+  lsp::OutgoingNotification<lsp::PublishDiagnosticsParams> publishDiagnostics;
+  bool shutdownRequestReceived = false;
+
+ private:
+  Document *findDocument(const lsp::URIForFile &uri) {
+    auto it = documents.find(uri.file());
+    return it == documents.end() ? nullptr : it->second.get();
+  }
+
+  DialectRegistry &registry;
+  const LspServerOptions &options;
+  // Shared by the contexts of all documents.
+  llvm::DefaultThreadPool threadPool;
+  llvm::StringMap<std::unique_ptr<Document>> documents;
+};
+
+void LspServer::onInitialize(const lsp::InitializeParams &params,
+                             lsp::Callback<llvm::json::Value> reply) {
+  llvm::json::Object serverCaps{
+      {"textDocumentSync",
+       llvm::json::Object{
+           {"openClose", true},
+           {"change", static_cast<int>(lsp::TextDocumentSyncKind::Incremental)},
+           {"save", true},
+       }},
+      {"definitionProvider", true},
+      {"referencesProvider", true},
+      {"hoverProvider", true},
+      {"documentSymbolProvider", true},
+  };
+  llvm::json::Object result{
+      {"serverInfo", llvm::json::Object{{"name", "stablehlo-lsp-server"},
+                                        {"version", "0.0.0"}}},
+      {"capabilities", std::move(serverCaps)},
+  };
+  reply(std::move(result));
+}
+
+void LspServer::onShutdown(const lsp::NoParams &params,
+                           lsp::Callback<std::nullptr_t> reply) {
+  shutdownRequestReceived = true;
+  reply(nullptr);
+}
+
+void LspServer::onDocumentDidOpen(
+    const lsp::DidOpenTextDocumentParams &params) {
+  auto document = std::make_unique<Document>(registry, threadPool, options);
+  document->getContents() = params.textDocument.text;
+  lsp::PublishDiagnosticsParams diagParams(params.textDocument.uri,
+                                           params.textDocument.version);
+  document->update(params.textDocument.version, diagParams.diagnostics);
+  documents[params.textDocument.uri.file()] = std::move(document);
+  publishDiagnostics(diagParams);
+}
+
+void LspServer::onDocumentDidClose(
+    const lsp::DidCloseTextDocumentParams &params) {
+  auto it = documents.find(params.textDocument.uri.file());
+  if (it == documents.end()) return;
+  int64_t version = it->second->getVersion();
+  documents.erase(it);
+
+  // Empty out the diagnostics shown for this document.
+  publishDiagnostics(
+      lsp::PublishDiagnosticsParams(params.textDocument.uri, version));
+}
+
+void LspServer::onDocumentDidChange(
+    const lsp::DidChangeTextDocumentParams &params) {
+  auto it = documents.find(params.textDocument.uri.file());
+  if (it == documents.end()) return;
+  if (failed(lsp::TextDocumentContentChangeEvent::applyTo(
+          params.contentChanges, it->second->getContents()))) {
+    lsp::Logger::error("Failed to update '{0}'",
+                       params.textDocument.uri.file());
+    documents.erase(it);
+    return;
+  }
+
+  lsp::PublishDiagnosticsParams diagParams(params.textDocument.uri,
+                                           params.textDocument.version);
+  it->second->update(params.textDocument.version, diagParams.diagnostics);
+  publishDiagnostics(diagParams);
+}
+
+void LspServer::onGoToDefinition(
+    const lsp::TextDocumentPositionParams &params,
+    lsp::Callback<std::vector<lsp::Location>> reply) {
+  std::vector<lsp::Location> locations;
+  if (Document *document = findDocument(params.textDocument.uri))
+    document->findDefinitions(params.textDocument.uri, params.position,
+                              locations);
+  reply(std::move(locations));
+}
+
+void LspServer::onReference(const lsp::ReferenceParams &params,
+                            lsp::Callback<std::vector<lsp::Location>> reply) {
+  std::vector<lsp::Location> locations;
+  if (Document *document = findDocument(params.textDocument.uri))
+    document->findReferences(params.textDocument.uri, params.position,
+                             locations);
+  reply(std::move(locations));
+}
+
+void LspServer::onHover(const lsp::TextDocumentPositionParams &params,
+                        lsp::Callback<std::optional<lsp::Hover>> reply) {
+  Document *document = findDocument(params.textDocument.uri);
+  reply(document ? document->findHover(params.position) : std::nullopt);
+}
+
+void LspServer::onDocumentSymbol(
+    const lsp::DocumentSymbolParams &params,
+    lsp::Callback<std::vector<lsp::DocumentSymbol>> reply) {
+  std::vector<lsp::DocumentSymbol> symbols;
+  if (Document *document = findDocument(params.textDocument.uri))
+    document->findDocumentSymbols(symbols);
+  reply(std::move(symbols));
+}
+
+}  // namespace
+
+LogicalResult runLspServer(DialectRegistry &registry,
+                           const LspServerOptions &options,
+                           lsp::JSONTransport &transport) {
+  LspServer server(registry, options);
+  lsp::MessageHandler messageHandler(transport);
+
+  messageHandler.method("initialize", &server, &LspServer::onInitialize);
+  messageHandler.notification("initialized", &server,
+                              &LspServer::onInitialized);
+  messageHandler.method("shutdown", &server, &LspServer::onShutdown);
+
+  messageHandler.notification("textDocument/didOpen", &server,
+                              &LspServer::onDocumentDidOpen);
+  messageHandler.notification("textDocument/didClose", &server,
+                              &LspServer::onDocumentDidClose);
+  messageHandler.notification("textDocument/didChange", &server,
+                              &LspServer::onDocumentDidChange);
+
+  messageHandler.method("textDocument/definition", &server,
+                        &LspServer::onGoToDefinition);
+  messageHandler.method("textDocument/references", &server,
+                        &LspServer::onReference);
+  messageHandler.method("textDocument/hover", &server, &LspServer::onHover);
+  messageHandler.method("textDocument/documentSymbol", &server,
+                        &LspServer::onDocumentSymbol);
+
+  server.publishDiagnostics =
+      messageHandler.outgoingNotification<lsp::PublishDiagnosticsParams>(
+          "textDocument/publishDiagnostics");
+
+  if (llvm::Error error = transport.run(messageHandler)) {
+    lsp::Logger::error("Transport error: {0}", error);
+    llvm::consumeError(std::move(error));
+    return failure();
+  }
+  return success(server.shutdownRequestReceived);
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
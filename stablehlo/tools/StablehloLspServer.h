@@ -0,0 +1,52 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_TOOLS_STABLEHLOLSPSERVER_H
+#define STABLEHLO_TOOLS_STABLEHLOLSPSERVER_H
+
+#include "mlir/IR/DialectRegistry.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Tools/lsp-server-support/Transport.h"
+
+namespace mlir {
+namespace stablehlo {
+
+struct LspServerOptions {
+  /// Hexadecimal dense literals longer than this many characters are elided
+  /// from the in-memory IR of documents, which keeps the contents of large
+  /// constants out of the context. 0 disables elision.
+  unsigned elideConstantsLargerThan = 1024;
+};
+
+/// Runs a language server for StableHLO programs over `transport` until the
+/// client shuts it down. `stablehlo-lsp-server` runs it with `--incremental`,
+/// and the MLIR language server otherwise.
+///
+/// Unlike the generic MLIR language server, which reparses and reverifies
+/// whole documents on every edit, documents are split into their top-level
+/// operations, e.g. functions, which are parsed and verified independently
+/// and concurrently. Parsed operations are cached by text, so an edit only
+/// reparses the operations it touches. Each operation is parsed along with
+/// the alias definitions it refers to, and file metadata such as resource
+/// blobs is skipped. Symbol uses across operations aren't verified, and code
+/// completion isn't provided.
+LogicalResult runLspServer(DialectRegistry &registry,
+                           const LspServerOptions &options,
+                           lsp::JSONTransport &transport);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_TOOLS_STABLEHLOLSPSERVER_H
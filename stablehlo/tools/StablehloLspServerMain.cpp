@@ -13,16 +13,119 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cstdio>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/raw_ostream.h"
 #include "mlir/InitAllDialects.h"
 #include "mlir/InitAllExtensions.h"
 #include "mlir/InitAllPasses.h"
+#include "mlir/Tools/lsp-server-support/Logging.h"
+#include "mlir/Tools/lsp-server-support/Transport.h"
 #include "mlir/Tools/mlir-lsp-server/MlirLspServerMain.h"
 #include "stablehlo/dialect/Register.h"
+#include "stablehlo/tools/StablehloLspServer.h"
+
+using mlir::lsp::JSONStreamStyle;
+using mlir::lsp::Logger;
+
+namespace {
+
+// Registered globally rather than with the options of the incremental
+// server, so that both servers accept it and list it in `--help`.
+llvm::cl::opt<bool> incremental{
+    "incremental",
+    llvm::cl::desc("Run the StableHLO server, which reparses only the edited "
+                   "top-level operations of documents, instead of the MLIR "
+                   "language server. It provides no code completion and "
+                   "doesn't verify symbol uses across top-level operations"),
+    llvm::cl::init(false),
+};
+
+// Returns whether `--incremental` is passed. Each server registers its
+// options when it runs, so this is decided before they are parsed.
+bool isIncremental(int argc, char **argv) {
+  return llvm::any_of(
+      llvm::ArrayRef(argv + 1, argc - 1), [](llvm::StringRef arg) {
+        arg = arg.ltrim('-');
+        return arg == "incremental" || arg == "incremental=true" ||
+               arg == "incremental=1";
+      });
+}
+
+int runIncrementalLspServer(int argc, char **argv,
+                            mlir::DialectRegistry &registry) {
+  llvm::cl::opt<JSONStreamStyle> inputStyle{
+      "input-style",
+      llvm::cl::desc("Input JSON stream encoding"),
+      llvm::cl::values(clEnumValN(JSONStreamStyle::Standard, "standard",
+                                  "usual LSP protocol"),
+                       clEnumValN(JSONStreamStyle::Delimited, "delimited",
+                                  "messages delimited by `// -----` lines, "
+                                  "with // comment support")),
+      llvm::cl::init(JSONStreamStyle::Standard),
+      llvm::cl::Hidden,
+  };
+  llvm::cl::opt<bool> litTest{
+      "lit-test",
+      llvm::cl::desc(
+          "Abbreviation for -input-style=delimited -pretty -log=verbose. "
+          "Intended to simplify lit tests"),
+      llvm::cl::init(false),
+  };
+  llvm::cl::opt<Logger::Level> logLevel{
+      "log",
+      llvm::cl::desc("Verbosity of log messages written to stderr"),
+      llvm::cl::values(
+          clEnumValN(Logger::Level::Error, "error", "Error messages only"),
+          clEnumValN(Logger::Level::Info, "info",
+                     "High level execution tracing"),
+          clEnumValN(Logger::Level::Debug, "verbose", "Low level details")),
+      llvm::cl::init(Logger::Level::Info),
+  };
+  llvm::cl::opt<bool> prettyPrint{
+      "pretty",
+      llvm::cl::desc("Pretty-print JSON output"),
+      llvm::cl::init(false),
+  };
+  llvm::cl::opt<unsigned> elideConstantsLargerThan{
+      "elide-constants-larger-than",
+      llvm::cl::desc("Elide hexadecimal dense constants longer than this "
+                     "many characters from the in-memory IR (0 disables)"),
+      llvm::cl::init(1024),
+  };
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "StableHLO LSP Language Server");
+
+  if (litTest) {
+    inputStyle = JSONStreamStyle::Delimited;
+    logLevel = Logger::Level::Debug;
+    prettyPrint = true;
+  }
+  Logger::setLogLevel(logLevel);
+
+  mlir::stablehlo::LspServerOptions options;
+  options.elideConstantsLargerThan = elideConstantsLargerThan;
+
+  llvm::sys::ChangeStdinToBinary();
+  mlir::lsp::JSONTransport transport(stdin, llvm::outs(), inputStyle,
+                                     prettyPrint);
+  return mlir::failed(
+      mlir::stablehlo::runLspServer(registry, options, transport));
+}
+
+}  // namespace
 
 int main(int argc, char **argv) {
   mlir::DialectRegistry registry;
   mlir::registerAllDialects(registry);
   mlir::registerAllExtensions(registry);
   mlir::stablehlo::registerAllDialects(registry);
+  if (isIncremental(argc, argv))
+    return runIncrementalLspServer(argc, argv, registry);
   return mlir::failed(mlir::MlirLspServerMain(argc, argv, registry));
 }
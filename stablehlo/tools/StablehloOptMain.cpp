@@ -21,6 +21,7 @@ limitations under the License.
 #include "mlir/Tools/mlir-opt/MlirOptMain.h"
 #include "stablehlo/conversions/linalg/transforms/Passes.h"
 #include "stablehlo/conversions/tosa/transforms/Passes.h"
+#include "stablehlo/dialect/AssemblyFormat.h"
 #include "stablehlo/dialect/Register.h"
 #include "stablehlo/reference/InterpreterOps.h"
 #include "stablehlo/tests/CheckOps.h"
@@ -34,6 +35,7 @@ int main(int argc, char **argv) {
   mlir::stablehlo::registerPasses();
   mlir::stablehlo::registerStablehloLinalgTransformsPasses();
   mlir::tosa::registerStablehloTOSATransformsPasses();
+  mlir::hlo::registerConstantPrintingCLOptions();
 
   mlir::DialectRegistry registry;
   mlir::registerAllDialects(registry);
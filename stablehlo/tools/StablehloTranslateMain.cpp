@@ -13,29 +13,57 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
-
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/OpDefinition.h"
 #include "mlir/InitAllDialects.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/DebugStringHelper.h"
+#include "mlir/Support/FileUtilities.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Tools/mlir-translate/MlirTranslateMain.h"
 #include "mlir/Tools/mlir-translate/Translation.h"
 #include "mlir/Transforms/Passes.h"
+#include "stablehlo/dialect/AssemblyFormat.h"
 #include "stablehlo/dialect/Register.h"
 #include "stablehlo/dialect/Serialization.h"
 #include "stablehlo/dialect/StablehloOps.h"
 #include "stablehlo/dialect/Version.h"
 #include "stablehlo/reference/Api.h"
+#include "stablehlo/reference/BufferPool.h"
+#include "stablehlo/reference/Checkpoint.h"
 #include "stablehlo/reference/Errors.h"
+#include "stablehlo/reference/EvaluationContext.h"
 #include "stablehlo/reference/InterpreterOps.h"
+#include "stablehlo/reference/KernelRegistry.h"
+#include "stablehlo/reference/MemoryTracker.h"
+#include "stablehlo/reference/NumPy.h"
+#include "stablehlo/reference/NumericsChecker.h"
+#include "stablehlo/reference/ProcessGrid.h"
+#include "stablehlo/reference/Profiler.h"
+#include "stablehlo/reference/Tensor.h"
 #include "stablehlo/tests/CheckOps.h"
 
 namespace mlir {
@@ -45,6 +73,234 @@ llvm::cl::opt<std::string> probeOutputDir(
     llvm::cl::desc("Directory for storing instrumented tensor values"),
     llvm::cl::init(""));
 
+llvm::cl::opt<unsigned> probeQueueCapacityOption(
+    "probe-queue-capacity",
+    llvm::cl::desc("Number of instrumented tensors which wait to be written "
+                   "on a background thread before the interpreter waits for "
+                   "them, or 0 to write them on the interpreter thread"),
+    llvm::cl::init(16));
+
+llvm::cl::opt<int64_t> probeSamplingIntervalOption(
+    "probe-sampling-interval",
+    llvm::cl::desc("Only write every Nth instrumented tensor of every probe"),
+    llvm::cl::init(1));
+
+llvm::cl::opt<bool> probeContainerOption(
+    "probe-container",
+    llvm::cl::desc("Append instrumented tensors to a single container file "
+                   "instead of writing one NumPy file each"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<bool> nativeKernelsOption(
+    "native-kernels",
+    llvm::cl::desc("Use native interpreter kernels where available"),
+    llvm::cl::init(true));
+
+llvm::cl::list<std::string> kernelPluginsOption(
+    "kernel-plugins",
+    llvm::cl::desc("Comma-separated shared libraries of native kernels of "
+                   "custom_call targets and composite ops, see "
+                   "stablehlo/reference/KernelPlugin.h"),
+    llvm::cl::CommaSeparated);
+
+llvm::cl::opt<bool> testKernelsOption(
+    "test-kernels",
+    llvm::cl::desc("Register the native kernels of the interpreter tests, "
+                   "which are registered in process rather than by plugins"),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
+llvm::cl::opt<bool> exactAccumulationOption(
+    "exact-accumulation",
+    llvm::cl::desc("Make accumulating native interpreter kernels bit-exact "
+                   "with their reference implementations"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<bool> pairwiseSummationOption(
+    "pairwise-summation",
+    llvm::cl::desc("Sum elements pairwise in native interpreter reductions "
+                   "for better accuracy"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<uint64_t> bufferPoolCapacityOption(
+    "buffer-pool-capacity",
+    llvm::cl::desc("Maximum number of bytes of released tensor storage that "
+                   "the interpreter caches for reuse"),
+    llvm::cl::init(stablehlo::BufferPool::kDefaultCapacity));
+
+llvm::cl::opt<unsigned> intraOpThreadsOption(
+    "intra-op-threads",
+    llvm::cl::desc("Number of threads on which interpreter ops with large "
+                   "outputs are evaluated in parallel, or 0 to evaluate them "
+                   "on the calling thread"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<bool> dataflowExecutionOption(
+    "dataflow-execution",
+    llvm::cl::desc("Evaluate independent interpreter ops concurrently on the "
+                   "threads of --intra-op-threads"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<uint64_t> collectiveTimeoutOption(
+    "collective-timeout-ms",
+    llvm::cl::desc("Milliseconds that interpreter processes wait for each "
+                   "other in collectives, send and recv before failing, or 0 "
+                   "to wait indefinitely"),
+    llvm::cl::init(stablehlo::ProcessGrid::kDefaultTimeout.count()));
+
+llvm::cl::opt<unsigned> channelDepthOption(
+    "channel-depth",
+    llvm::cl::desc("Number of messages which send/recv channels of "
+                   "interpreter.run_parallel buffer before send waits for "
+                   "recv"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<bool> printCommunicationStatisticsOption(
+    "print-communication-statistics",
+    llvm::cl::desc("Print the bytes moved and wait times of the collectives "
+                   "and send/recv channels of interpreter.run_parallel to "
+                   "stderr after every interpreter.run_parallel"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<double> linkLatencyOption(
+    "link-latency-us",
+    llvm::cl::desc("Microseconds of latency of the links between interpreter "
+                   "processes in the modeled times of "
+                   "--print-communication-statistics"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<double> linkBandwidthOption(
+    "link-bandwidth-gbps",
+    llvm::cl::desc("Gigabytes per second of bandwidth of the links between "
+                   "interpreter processes in the modeled times of "
+                   "--print-communication-statistics, or 0 to only model "
+                   "latency"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<unsigned> processThreadsOption(
+    "process-threads",
+    llvm::cl::desc("Number of threads on which the processes of "
+                   "interpreter.run_parallel are evaluated, or 0 to create one "
+                   "thread per process for every interpreter.run_parallel"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<bool> pinProcessThreadsOption(
+    "pin-process-threads",
+    llvm::cl::desc("Pin the threads evaluating the processes of "
+                   "interpreter.run_parallel to CPUs round-robin (Linux only)"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<stablehlo::ExecutionMode> interpretModeOption(
+    "interpret-mode",
+    llvm::cl::desc("How the main function is evaluated. Other functions are "
+                   "always interpreted"),
+    llvm::cl::values(
+        clEnumValN(stablehlo::ExecutionMode::Interpreter, "interpreter",
+                   "Evaluate ops one at a time with the reference "
+                   "interpreter"),
+        clEnumValN(stablehlo::ExecutionMode::Jit, "jit",
+                   "Compile the main function to native code through "
+                   "stablehlo-legalize-to-linalg, or interpret it if it "
+                   "can't be compiled")),
+    llvm::cl::init(stablehlo::ExecutionMode::Interpreter));
+
+llvm::cl::opt<unsigned> evaluationsOption(
+    "evaluations",
+    llvm::cl::desc("Number of times the module is evaluated concurrently, "
+                   "each time on a thread of its own, from one prepared "
+                   "executable. The results of the first evaluation are "
+                   "printed"),
+    llvm::cl::init(1));
+
+llvm::cl::opt<unsigned> testThreadsOption(
+    "test-threads",
+    llvm::cl::desc("Evaluate every public function of the module without "
+                   "arguments as an independent test, rather than the main "
+                   "function, concurrently on this many threads. Results and "
+                   "check failures are reported in the order of the "
+                   "functions, once all of them are evaluated. 0 evaluates "
+                   "the main function only"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<std::string> interpreterProfileOption(
+    "interpreter-profile",
+    llvm::cl::desc("File to which the wall time, evaluations, result "
+                   "elements and allocated bytes of the evaluated ops are "
+                   "written as tables by op name and by location, or - for "
+                   "stdout"),
+    llvm::cl::init(""));
+
+llvm::cl::opt<std::string> interpreterProfileTraceOption(
+    "interpreter-profile-trace",
+    llvm::cl::desc("File to which every evaluated op is written as an event "
+                   "in the Chrome trace event format, e.g. for Perfetto"),
+    llvm::cl::init(""));
+
+llvm::cl::opt<bool> checkNonFiniteOption(
+    "check-non-finite",
+    llvm::cl::desc("Scan the results of interpreter ops for NaN and infinite "
+                   "values and fail with the location of the first op "
+                   "producing them"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<uint64_t> memoryLimitOption(
+    "memory-limit",
+    llvm::cl::desc("Maximum number of bytes of tensor storage which the "
+                   "interpreter may hold at once, beyond which it fails with "
+                   "the op allocating them, or 0 for no limit"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<bool> printMemoryStatisticsOption(
+    "print-memory-statistics",
+    llvm::cl::desc("Print the live and peak bytes of tensor storage and the "
+                   "bytes allocated by every interpreter op to stderr"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<std::string> checkpointDirOption(
+    "checkpoint-dir",
+    llvm::cl::desc("Directory to which while loops save their loop-carried "
+                   "values every --checkpoint-interval iterations and once "
+                   "they finish"),
+    llvm::cl::init(""));
+
+llvm::cl::opt<int64_t> checkpointIntervalOption(
+    "checkpoint-interval",
+    llvm::cl::desc("Number of iterations between checkpoints of while loops, "
+                   "or 0 to save them only once loops finish"),
+    llvm::cl::init(1000));
+
+llvm::cl::opt<bool> keepCheckpointsOption(
+    "keep-checkpoints",
+    llvm::cl::desc("Keep every checkpoint of while loops rather than only the "
+                   "latest, so that evaluation can be resumed from any of "
+                   "them"),
+    llvm::cl::init(false));
+
+llvm::cl::opt<bool> resumeFromCheckpointOption(
+    "resume-from-checkpoint",
+    llvm::cl::desc("Resume while loops from their latest checkpoint in "
+                   "--checkpoint-dir"),
+    llvm::cl::init(false));
+
+llvm::cl::list<std::string> inputFilesOption(
+    "input-files",
+    llvm::cl::desc("Comma-separated NumPy files (.npy) or arrays of NumPy "
+                   "archives (archive.npz:name) to pass as inputs to the main "
+                   "function, which are memory-mapped rather than copied"),
+    llvm::cl::CommaSeparated);
+
+llvm::cl::list<unsigned> streamInputsOption(
+    "stream-inputs",
+    llvm::cl::desc("Comma-separated positions of --input-files which are read "
+                   "in chunks rather than memory-mapped, so that they can be "
+                   "larger than memory, and may only be reduced by reduce "
+                   "ops"),
+    llvm::cl::CommaSeparated);
+
+llvm::cl::opt<int64_t> streamChunkSizeOption(
+    "stream-chunk-size",
+    llvm::cl::desc("Size of the chunks of --stream-inputs in bytes"),
+    llvm::cl::init(int64_t{64} << 20));
+
 llvm::cl::opt<bool> stripDebuginfoOption(
     "strip-debuginfo", llvm::cl::desc("Strip debug info from all operations"),
     llvm::cl::init(false));
@@ -53,6 +309,19 @@ llvm::cl::opt<std::string> targetOption(
     "target", llvm::cl::desc("Target version for serialization"),
     llvm::cl::init(""));
 
+llvm::cl::opt<int64_t> minCompressedSizeOption(
+    "min-compressed-size",
+    llvm::cl::desc("When serializing, compress constants of at least this "
+                   "many bytes"),
+    llvm::cl::init(0));
+
+llvm::cl::opt<int64_t> minResourceSizeOption(
+    "min-resource-size",
+    llvm::cl::desc("When deserializing, keep the input alive and represent "
+                   "constants of at least this many bytes as dense_resource "
+                   "attributes which reference it rather than copying them"),
+    llvm::cl::init(0));
+
 namespace {
 
 stablehlo::Tensor makeBooleanTensor(MLIRContext *context, bool value) {
@@ -85,14 +354,174 @@ llvm::Error evalCustomCallCheckEq(stablehlo::CustomCallOp op,
   return status;
 }
 
+// Loads `inputFilesOption` as the inputs of the function `mainFunction` of
+// `module`, or of its only function like `evalModule`, using the types of its
+// arguments, which must be static. The files at the positions of
+// `streamInputsOption` are added to `streamedInputs` rather than loaded.
+LogicalResult loadInputFiles(
+    ModuleOp module, StringRef mainFunction,
+    SmallVector<stablehlo::InterpreterValue> &inputs,
+    SmallVector<stablehlo::StreamedInput> &streamedInputs) {
+  if (inputFilesOption.empty()) return success();
+  auto functions = module.getOps<func::FuncOp>();
+  auto func = module.lookupSymbol<func::FuncOp>(mainFunction);
+  if (!func && mainFunction == "main" && llvm::hasSingleElement(functions))
+    func = *functions.begin();
+  if (!func)
+    return module.emitError("Failed to find main function: ") << mainFunction;
+  if (func.getNumArguments() != inputFilesOption.size())
+    return func.emitError("Expected ")
+           << func.getNumArguments() << " input files, got "
+           << inputFilesOption.size();
+
+  for (auto [argNumber, inputFile, argumentType] : llvm::enumerate(
+           inputFilesOption, func.getArgumentTypes())) {
+    auto type = dyn_cast<RankedTensorType>(argumentType);
+    if (!type || !type.hasStaticShape())
+      return func.emitError("Input files require static argument types, got ")
+             << argumentType;
+
+    if (llvm::is_contained(streamInputsOption, argNumber)) {
+      if (StringRef(inputFile).contains(".npz:"))
+        return func.emitError("Streamed input files must be NumPy files, got ")
+               << inputFile;
+      streamedInputs.push_back(
+          {static_cast<unsigned>(argNumber), inputFile, streamChunkSizeOption});
+      continue;
+    }
+
+    // Arrays of archives are named after the archive, e.g. weights.npz:w0.
+    StringRef filename = inputFile;
+    StringRef name;
+    if (auto pos = filename.find(".npz:"); pos != StringRef::npos) {
+      name = filename.drop_front(pos + 5);
+      filename = filename.take_front(pos + 4);
+    }
+    auto tensor =
+        name.empty()
+            ? stablehlo::numpy::deserializeTensor(filename, type)
+            : stablehlo::numpy::deserializeTensorFromArchive(filename, name,
+                                                             type);
+    if (!tensor)
+      return func.emitError("Failed to load input file ")
+             << inputFile << ": " << tensor.getError().message();
+    inputs.push_back(stablehlo::InterpreterValue(*tensor));
+  }
+  return success();
+}
+
+// Writes `profiler` to the files of `--interpreter-profile` and
+// `--interpreter-profile-trace`, if any.
+LogicalResult writeProfile(ModuleOp module,
+                           const stablehlo::Profiler &profiler) {
+  auto write = [&](StringRef filename, auto print) -> LogicalResult {
+    if (filename.empty()) return success();
+    std::string errorMessage;
+    auto file = openOutputFile(filename, &errorMessage);
+    if (!file) return module.emitError(errorMessage);
+    print(file->os());
+    file->keep();
+    return success();
+  };
+  if (failed(write(interpreterProfileOption, [&](raw_ostream &os) {
+        profiler.printTable(os);
+      })))
+    return failure();
+  return write(interpreterProfileTraceOption, [&](raw_ostream &os) {
+    profiler.printChromeTrace(os);
+  });
+}
+
+// The failures of the checks of the functions evaluated by
+// `evalTestFunctions`, which are collected rather than aborting evaluation, so
+// that they can be reported in the order of the functions.
+class CheckFailures {
+ public:
+  void add(StringRef funcName, std::string message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failures_[funcName].push_back(std::move(message));
+  }
+
+  SmallVector<std::string> get(StringRef funcName) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failures_.lookup(funcName);
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  llvm::StringMap<SmallVector<std::string>> failures_;
+};
+
+// Evaluates `module` `numEvaluations` times concurrently from one executable
+// and prints the results of the first evaluation to `os`.
+LogicalResult evalConcurrently(
+    ModuleOp module, ArrayRef<stablehlo::InterpreterValue> inputs,
+    const stablehlo::InterpreterConfiguration &config, unsigned numEvaluations,
+    raw_ostream &os) {
+  auto executable = stablehlo::InterpreterExecutable::create(module, config);
+  if (failed(executable)) return failure();
+
+  SmallVector<FailureOr<SmallVector<stablehlo::InterpreterValue>>> results(
+      numEvaluations, failure());
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < numEvaluations; ++i)
+    threads.emplace_back(
+        [&, i]() { results[i] = (*executable)->evaluate(inputs); });
+  for (auto &thread : threads) thread.join();
+
+  if (llvm::any_of(results, [](const auto &result) { return failed(result); }))
+    return failure();
+  for (auto &result : *results.front()) result.print(os);
+  return success();
+}
+
+// Evaluates every public function of `module` without arguments as a test,
+// concurrently on `numThreads` threads, then prints their results to `os` and
+// emits their check failures from `checkFailures`, both in the order of the
+// functions. Returns failure if any test fails.
+LogicalResult evalTestFunctions(
+    ModuleOp module, const stablehlo::InterpreterConfiguration &config,
+    const CheckFailures &checkFailures, unsigned numThreads, raw_ostream &os) {
+  SmallVector<func::FuncOp> tests;
+  for (auto func : module.getOps<func::FuncOp>())
+    if (func.isPublic() && func.getNumArguments() == 0) tests.push_back(func);
+
+  SmallVector<std::unique_ptr<stablehlo::InterpreterExecutable>> executables;
+  for (auto test : tests) {
+    auto executable =
+        stablehlo::InterpreterExecutable::create(module, test, config);
+    if (failed(executable)) return failure();
+    executables.push_back(std::move(*executable));
+  }
+
+  SmallVector<FailureOr<SmallVector<stablehlo::InterpreterValue>>> results(
+      tests.size(), failure());
+  llvm::DefaultThreadPool threadPool(llvm::hardware_concurrency(numThreads));
+  for (size_t i = 0; i < tests.size(); ++i)
+    threadPool.async([&, i]() { results[i] = executables[i]->evaluate({}); });
+  threadPool.wait();
+
+  bool passed = true;
+  for (auto [test, result] : llvm::zip(tests, results)) {
+    auto failures = checkFailures.get(test.getSymName());
+    for (auto &message : failures) test.emitError(message);
+    if (failed(result) || !failures.empty()) passed = false;
+    if (succeeded(result))
+      for (auto &value : *result) value.print(os);
+  }
+  return success(passed);
+}
+
 /// The default fallback callback used by StableHLO for interpreter validation
 /// and module instrumentation.
 class StablehloTranslateInterpreterFallback
     : public stablehlo::InterpreterFallback {
  public:
   StablehloTranslateInterpreterFallback(
-      const std::string &probeInstrumentationDir)
-      : probeInstrumentationDir(probeInstrumentationDir) {}
+      const std::string &probeInstrumentationDir,
+      CheckFailures *checkFailures = nullptr)
+      : probeInstrumentationDir(probeInstrumentationDir),
+        checkFailures(checkFailures) {}
   virtual llvm::Error operator()(Operation &op, stablehlo::Scope &scope,
                                  stablehlo::Process *process) final {
     llvm::StringRef funcName = op.getParentOfType<func::FuncOp>().getSymName();
@@ -113,8 +542,7 @@ class StablehloTranslateInterpreterFallback
       auto runtimeRhs = scope.findTensor(expectAlmostEqOp.getRhs());
       auto status =
           stablehlo::check::evalExpectAlmostEqOp(runtimeLhs, runtimeRhs);
-      return stablehlo::wrapFallbackStatus(std::move(status), funcName,
-                                           "check.expect_almost_eq");
+      return reportCheck(std::move(status), funcName, "check.expect_almost_eq");
     }
 
     if (auto expectAlmostEqConstOp =
@@ -122,16 +550,15 @@ class StablehloTranslateInterpreterFallback
       auto runtimeOperand = scope.findTensor(expectAlmostEqConstOp.getLhs());
       auto status = stablehlo::check::evalExpectAlmostEqConstOp(
           runtimeOperand, expectAlmostEqConstOp.getValue());
-      return stablehlo::wrapFallbackStatus(std::move(status), funcName,
-                                           "check.expect_almost_eq_const");
+      return reportCheck(std::move(status), funcName,
+                         "check.expect_almost_eq_const");
     }
 
     if (auto expectEqOp = dyn_cast<stablehlo::check::ExpectEqOp>(op)) {
       auto runtimeLhs = scope.findTensor(expectEqOp.getLhs());
       auto runtimeRhs = scope.findTensor(expectEqOp.getRhs());
       auto status = stablehlo::check::evalExpectEqOp(runtimeLhs, runtimeRhs);
-      return stablehlo::wrapFallbackStatus(std::move(status), funcName,
-                                           "check.expect_eq");
+      return reportCheck(std::move(status), funcName, "check.expect_eq");
     }
 
     if (auto expectEqConstOp =
@@ -139,8 +566,7 @@ class StablehloTranslateInterpreterFallback
       auto runtimeOperand = scope.findTensor(expectEqConstOp.getLhs());
       auto status = stablehlo::check::evalExpectEqConstOp(
           runtimeOperand, expectEqConstOp.getValue());
-      return stablehlo::wrapFallbackStatus(std::move(status), funcName,
-                                           "check.expect_eq_const");
+      return reportCheck(std::move(status), funcName, "check.expect_eq_const");
     }
 
     if (auto expectSerializedEqOp =
@@ -150,8 +576,8 @@ class StablehloTranslateInterpreterFallback
       auto status = stablehlo::check::evalExpectSerializedEqOp(
           runtimeOperand, expectSerializedEqOp.getProbeId(),
           probeInstrumentationDir, expectSerializedEqOp.getIteration());
-      return stablehlo::wrapFallbackStatus(std::move(status), funcName,
-                                           "check.expect_serialized_eq");
+      return reportCheck(std::move(status), funcName,
+                         "check.expect_serialized_eq");
     }
 
     return stablehlo::invalidArgument("Unsupported op: %s",
@@ -159,11 +585,56 @@ class StablehloTranslateInterpreterFallback
   }
 
  private:
+  // Returns the failure of the check `checkName` in the function `funcName`,
+  // if any, or records it in `checkFailures` if set. Failures are recorded
+  // for the entry function of the evaluation, i.e. the test, which may have
+  // called `funcName`.
+  llvm::Error reportCheck(llvm::Error status, llvm::StringRef funcName,
+                          llvm::StringRef checkName) {
+    status = stablehlo::wrapFallbackStatus(std::move(status), funcName,
+                                           checkName);
+    if (!status || !checkFailures) return status;
+    auto test = cast<func::FuncOp>(
+        stablehlo::getEvaluationContext().entryFunction);
+    checkFailures->add(test.getSymName(), llvm::toString(std::move(status)));
+    return llvm::Error::success();
+  }
+
   // The directory in which tensors instrumented by way of `interpreter.probe`
   // will have their data serialized to.
   const std::string probeInstrumentationDir;
+
+  // The failures of checks, which are reported by `evalTestFunctions` rather
+  // than aborting evaluation, if set.
+  CheckFailures *checkFailures;
 };
 
+// Registers the kernels of `--test-kernels`:
+//   - `test.double` doubles its operand, which tells its results apart from
+//     those of the decompositions of composites.
+//   - `test.fail` fails.
+void registerTestKernels(stablehlo::KernelRegistry &registry) {
+  registry.registerKernel(
+      "test.double",
+      [](Operation &op, ArrayRef<stablehlo::Tensor> operands,
+         SmallVectorImpl<stablehlo::Tensor> &results) -> llvm::Error {
+        if (operands.size() != 1 || op.getNumResults() != 1)
+          return stablehlo::invalidArgument("Unsupported op: %s",
+                                            debugString(op).c_str());
+        const stablehlo::Tensor &operand = operands[0];
+        stablehlo::Tensor &result = results.emplace_back(operand.getType());
+        for (int64_t i = 0; i < operand.getNumElements(); ++i)
+          result.setLinear(i, operand.getLinear(i) + operand.getLinear(i));
+        return llvm::Error::success();
+      });
+  registry.registerKernel(
+      "test.fail",
+      [](Operation &op, ArrayRef<stablehlo::Tensor> operands,
+         SmallVectorImpl<stablehlo::Tensor> &results) -> llvm::Error {
+        return stablehlo::invalidArgument("test.fail failed");
+      });
+}
+
 }  // namespace
 
 TranslateFromMLIRRegistration interpretRegistration(
@@ -171,15 +642,130 @@ TranslateFromMLIRRegistration interpretRegistration(
     [](ModuleOp module, raw_ostream &os) -> LogicalResult {
       stablehlo::InterpreterConfiguration config;
       config.probeInstrumentationDir = probeOutputDir.getValue();
+      config.probeQueueCapacity = probeQueueCapacityOption.getValue();
+      config.probeSamplingInterval = probeSamplingIntervalOption.getValue();
+      config.probeContainer = probeContainerOption.getValue();
+      config.executionMode = interpretModeOption.getValue();
+      config.enableNativeKernels = nativeKernelsOption.getValue();
+      config.exactAccumulation = exactAccumulationOption.getValue();
+      config.pairwiseSummation = pairwiseSummationOption.getValue();
+      config.bufferPoolCapacity = bufferPoolCapacityOption.getValue();
+      config.collectiveTimeout =
+          std::chrono::milliseconds(collectiveTimeoutOption.getValue());
+      config.channelDepth = channelDepthOption.getValue();
+      if (printCommunicationStatisticsOption)
+        config.communicationStatisticsStream = &llvm::errs();
+      if (linkLatencyOption != 0 || linkBandwidthOption != 0)
+        config.linkModel = stablehlo::makeUniformLinkModel(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::duration<double, std::micro>(linkLatencyOption)),
+            linkBandwidthOption * 1e9);
+      std::optional<CheckFailures> checkFailures;
+      if (testThreadsOption > 0) {
+        if (!inputFilesOption.empty() || evaluationsOption > 1 ||
+            !config.probeInstrumentationDir.empty())
+          return module.emitError(
+              "--test-threads can't be combined with --input-files, "
+              "--evaluations or --probe-output-dir");
+        checkFailures.emplace();
+      }
       config.fallback = std::make_unique<StablehloTranslateInterpreterFallback>(
-          config.probeInstrumentationDir);
+          config.probeInstrumentationDir,
+          checkFailures ? &*checkFailures : nullptr);
+
+      std::optional<llvm::DefaultThreadPool> intraOpThreadPool;
+      if (intraOpThreadsOption > 0) {
+        intraOpThreadPool.emplace(
+            llvm::hardware_concurrency(intraOpThreadsOption.getValue()));
+        config.intraOpThreadPool = &*intraOpThreadPool;
+      }
+      config.dataflowExecution = dataflowExecutionOption.getValue();
 
-      llvm::SmallVector<stablehlo::InterpreterValue> inputs;
-      auto results = evalModule(module, inputs, config);
-      if (failed(results)) return failure();
+      std::optional<llvm::DefaultThreadPool> processThreadPool;
+      if (processThreadsOption > 0) {
+        processThreadPool.emplace(
+            llvm::hardware_concurrency(processThreadsOption.getValue()));
+        config.processThreadPool = &*processThreadPool;
+      }
+      config.pinProcessThreads = pinProcessThreadsOption.getValue();
+
+      std::optional<stablehlo::Profiler> profiler;
+      if (!interpreterProfileOption.empty() ||
+          !interpreterProfileTraceOption.empty()) {
+        profiler.emplace(
+            /*recordTrace=*/!interpreterProfileTraceOption.empty());
+        config.profiler = &*profiler;
+      }
+
+      std::optional<stablehlo::Checkpointer> checkpointer;
+      if (!checkpointDirOption.empty()) {
+        checkpointer.emplace(checkpointDirOption, checkpointIntervalOption,
+                             keepCheckpointsOption, resumeFromCheckpointOption);
+        config.checkpointer = &*checkpointer;
+      }
+
+      std::optional<stablehlo::KernelRegistry> kernelRegistry;
+      if (!kernelPluginsOption.empty() || testKernelsOption) {
+        kernelRegistry.emplace();
+        if (testKernelsOption) registerTestKernels(*kernelRegistry);
+        for (const std::string &path : kernelPluginsOption)
+          if (auto error = kernelRegistry->loadPlugin(path))
+            return module.emitError(llvm::toString(std::move(error)));
+        config.kernelRegistry = &*kernelRegistry;
+      }
+
+      std::optional<stablehlo::MemoryTracker> memoryTracker;
+      if (memoryLimitOption > 0 || printMemoryStatisticsOption) {
+        memoryTracker.emplace(memoryLimitOption > 0
+                                  ? std::optional<uint64_t>(memoryLimitOption)
+                                  : std::nullopt);
+        config.memoryTracker = &*memoryTracker;
+      }
+
+      std::optional<stablehlo::NumericsChecker> numericsChecker;
+      if (checkNonFiniteOption) {
+        numericsChecker.emplace();
+        config.numericsChecker = &*numericsChecker;
+      }
 
-      for (auto &result : *results) result.print(os);
+      llvm::SmallVector<stablehlo::InterpreterValue> inputs;
+      llvm::SmallVector<stablehlo::StreamedInput> streamedInputs;
+      if (failed(loadInputFiles(module, config.mainFunction, inputs,
+                                streamedInputs)))
+        return failure();
+      if (!streamedInputs.empty() && evaluationsOption > 1)
+        return module.emitError(
+            "--stream-inputs can't be combined with --evaluations");
+      if (checkFailures) {
+        if (failed(evalTestFunctions(module, config, *checkFailures,
+                                     testThreadsOption.getValue(), os)))
+          return failure();
+      } else if (evaluationsOption > 1) {
+        if (failed(evalConcurrently(module, inputs, config,
+                                    evaluationsOption.getValue(), os)))
+          return failure();
+      } else {
+        auto results = streamedInputs.empty()
+                           ? evalModule(module, inputs, config)
+                           : evalModuleWithStreamedInputs(
+                                 module, inputs, streamedInputs, config);
+        if (failed(results)) return failure();
+
+        for (auto &result : *results) result.print(os);
+      }
 
+      if (printMemoryStatisticsOption) memoryTracker->print(llvm::errs());
+      if (profiler && failed(writeProfile(module, *profiler)))
+        return failure();
+      if (numericsChecker) {
+        if (auto report = numericsChecker->getReport()) {
+          std::string message;
+          llvm::raw_string_ostream messageStream(message);
+          numericsChecker->print(messageStream);
+          return emitError(report->location)
+                 << "first op producing non-finite values: " << message;
+        }
+      }
       return success();
     },
     [](DialectRegistry &registry) {
@@ -203,7 +789,11 @@ TranslateFromMLIRRegistration serializeRegistration(
           return module.emitError("failed to strip debuginfo");
       }
 
-      return stablehlo::serializePortableArtifact(module, targetVersion, os);
+      std::optional<int64_t> minCompressedSize;
+      if (minCompressedSizeOption.getNumOccurrences())
+        minCompressedSize = minCompressedSizeOption;
+      return stablehlo::serializePortableArtifact(module, targetVersion, os,
+                                                  minCompressedSize);
     },
     [](DialectRegistry &registry) {
       mlir::registerAllDialects(registry);
@@ -213,6 +803,10 @@ TranslateFromMLIRRegistration serializeRegistration(
 TranslateToMLIRRegistration deserializeRegistration(
     "deserialize", "Deserialize a portable artifact into a StableHLO program",
     [](llvm::StringRef input, mlir::MLIRContext *context) {
+      if (minResourceSizeOption.getNumOccurrences())
+        return stablehlo::deserializePortableArtifact(
+            llvm::MemoryBuffer::getMemBufferCopy(input), context,
+            minResourceSizeOption);
       return stablehlo::deserializePortableArtifact(input, context);
     },
     [](DialectRegistry &registry) {
@@ -220,9 +814,48 @@ TranslateToMLIRRegistration deserializeRegistration(
       mlir::stablehlo::registerAllDialects(registry);
     });
 
+TranslateRegistration artifactInfoRegistration(
+    "artifact-info",
+    "Print the producer and ops of a portable artifact without deserializing "
+    "it, and whether its ops exist in the version given by --target",
+    [](const std::shared_ptr<llvm::SourceMgr> &sourceMgr, raw_ostream &os,
+       MLIRContext *context) -> LogicalResult {
+      auto *buffer = sourceMgr->getMemoryBuffer(sourceMgr->getMainFileID());
+      auto info = stablehlo::readPortableArtifactInfo(buffer->getBuffer());
+      if (failed(info))
+        return emitError(UnknownLoc::get(context),
+                         "failed to read portable artifact");
+
+      os << "producer: " << info->producer << "\n";
+      os << "bytecode version: " << info->bytecodeVersion << "\n";
+      if (!targetOption.empty()) {
+        auto targetVersion =
+            targetOption == "current"
+                ? FailureOr<vhlo::Version>(vhlo::Version::getCurrentVersion())
+                : vhlo::Version::fromString(targetOption);
+        if (failed(targetVersion))
+          return emitError(UnknownLoc::get(context), "invalid target version ")
+                 << targetOption;
+        os << "compatible with " << *targetVersion << ": "
+           << (stablehlo::isPortableArtifactCompatible(*info, *targetVersion,
+                                                       context)
+                   ? "true"
+                   : "false")
+           << "\n";
+      }
+      os << "ops:\n";
+      for (const auto &[name, count] : info->opCounts)
+        os << "  " << name << ": " << count << "\n";
+      return success();
+    },
+    [](DialectRegistry &registry) {
+      mlir::stablehlo::registerAllDialects(registry);
+    });
+
 }  //  namespace mlir
 
 int main(int argc, char **argv) {
+  mlir::hlo::registerConstantPrintingCLOptions();
   return failed(
       mlir::mlirTranslateMain(argc, argv, "StableHLO interpreter driver\n"));
 }
@@ -7,9 +7,17 @@
 // Implements logic for lowering CHLO ops to StableHLO and Shape dialect ops,
 // taking care of CHLO's broadcasting semantics
 #define _USE_MATH_DEFINES
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <utility>
 
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
 #include "mlir/Dialect/Complex/IR/Complex.h"
 #include "mlir/Dialect/Shape/IR/Shape.h"
 #include "mlir/Dialect/Tensor/IR/Tensor.h"
@@ -20,6 +28,7 @@
 #include "mlir/IR/TypeUtilities.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "stablehlo/dialect/Base.h"
 #include "stablehlo/dialect/BroadcastUtils.h"
 #include "stablehlo/dialect/ChloOps.h"
 #include "stablehlo/dialect/StablehloOps.h"
@@ -183,6 +192,132 @@ static Value getConstantLikeInfValue(OpBuilder &b, Location loc, Value val,
       b, loc, llvm::APFloat::getInf(ty.getFloatSemantics(), negative), val);
 }
 
+// Returns the dims of a result of rank `resultRank` which the dims of an
+// operand of rank `rank` map to: the explicit `broadcastDimensions` of an
+// operand of lower rank if any, or the trailing dims of the result otherwise.
+static FailureOr<SmallVector<int64_t>> getBroadcastDimensions(
+    int64_t rank, int64_t resultRank,
+    std::optional<ArrayRef<int64_t>> broadcastDimensions) {
+  if (rank > resultRank) return failure();
+  if (rank == resultRank || !broadcastDimensions)
+    return llvm::to_vector(llvm::seq<int64_t>(resultRank - rank, resultRank));
+
+  if (static_cast<int64_t>(broadcastDimensions->size()) != rank)
+    return failure();
+  llvm::SmallDenseSet<int64_t> seen;
+  for (int64_t dim : *broadcastDimensions)
+    if (dim < 0 || dim >= resultRank || !seen.insert(dim).second)
+      return failure();
+  return llvm::to_vector(*broadcastDimensions);
+}
+
+// Broadcasts statically shaped `operands` to `resultType` with
+// broadcast_in_dim ops, rather than with the shape constraints and dynamic
+// broadcasts needed when shapes are only known at runtime. Operands which
+// already have the shape of the result are used as is. Fails if any operand
+// isn't statically shaped, or if the operands aren't broadcastable to the
+// shape of `resultType`.
+static FailureOr<SmallVector<Value>> broadcastStaticOperands(
+    ConversionPatternRewriter &rewriter, Location loc, ValueRange operands,
+    RankedTensorType resultType,
+    std::optional<ArrayRef<int64_t>> broadcastDimensions = std::nullopt) {
+  if (!resultType.hasStaticShape()) return failure();
+
+  int64_t resultRank = resultType.getRank();
+  SmallVector<int64_t> resultShape(resultRank, 1);
+  SmallVector<SmallVector<int64_t>> operandsDimensions;
+  for (Value operand : operands) {
+    auto type = dyn_cast<RankedTensorType>(operand.getType());
+    if (!type || !type.hasStaticShape()) return failure();
+    auto dims = getBroadcastDimensions(type.getRank(), resultRank,
+                                       broadcastDimensions);
+    if (failed(dims)) return failure();
+    for (auto [size, dim] : llvm::zip(type.getShape(), *dims)) {
+      if (size == 1) continue;
+      if (resultShape[dim] != 1 && resultShape[dim] != size) return failure();
+      resultShape[dim] = size;
+    }
+    operandsDimensions.push_back(std::move(*dims));
+  }
+  if (!llvm::equal(resultShape, resultType.getShape())) return failure();
+
+  SmallVector<Value> broadcasted;
+  for (auto [operand, dims] : llvm::zip(operands, operandsDimensions)) {
+    auto type = cast<RankedTensorType>(operand.getType());
+    if (type.getShape() == resultType.getShape()) {
+      broadcasted.push_back(operand);
+      continue;
+    }
+    broadcasted.push_back(rewriter.create<mlir::stablehlo::BroadcastInDimOp>(
+        loc, RankedTensorType::get(resultShape, type.getElementType()),
+        operand, rewriter.getDenseI64ArrayAttr(dims)));
+  }
+  return broadcasted;
+}
+
+// Returns whether every dynamic dim of `type` has a bound.
+static bool hasBoundedShape(RankedTensorType type) {
+  if (type.hasStaticShape()) return true;
+  auto bounds = hlo::encodingToBounds(type.getEncoding());
+  if (bounds.empty()) return false;
+  for (auto [size, bound] : llvm::zip(type.getShape(), bounds))
+    if (ShapedType::isDynamic(size) && ShapedType::isDynamic(bound))
+      return false;
+  return true;
+}
+
+// Computes the extents of the result of broadcasting ranked `operands` to
+// `resultType` as a tensor<Nxi32>, whose dims map to `operandsDimensions`.
+// This uses get_dimension_size ops rather than shape dialect ops, and assumes
+// that the operands are broadcastable. Dims which have a static size other
+// than 1 in any operand are constant.
+static Value computeBroadcastExtents(
+    ConversionPatternRewriter &rewriter, Location loc, ValueRange operands,
+    ArrayRef<SmallVector<int64_t>> operandsDimensions,
+    RankedTensorType resultType) {
+  auto i32ScalarType = RankedTensorType::get({}, rewriter.getI32Type());
+  auto i32x1Type = RankedTensorType::get({1}, rewriter.getI32Type());
+  auto getConstant = [&](RankedTensorType type, int64_t value) -> Value {
+    return rewriter.create<mlir::stablehlo::ConstantOp>(
+        loc, DenseIntElementsAttr::get(type, static_cast<int32_t>(value)));
+  };
+
+  SmallVector<Value> extents;
+  for (int64_t resultDim = 0; resultDim < resultType.getRank(); ++resultDim) {
+    int64_t staticSize = 1;
+    Value dynamicSize;
+    for (auto [operand, dims] : llvm::zip(operands, operandsDimensions)) {
+      auto type = cast<RankedTensorType>(operand.getType());
+      for (auto [dim, mappedDim] : llvm::enumerate(dims)) {
+        if (mappedDim != resultDim) continue;
+        if (!type.isDynamicDim(dim)) {
+          if (type.getDimSize(dim) != 1) staticSize = type.getDimSize(dim);
+          continue;
+        }
+        Value size = rewriter.create<mlir::stablehlo::GetDimensionSizeOp>(
+            loc, operand, dim);
+        if (dynamicSize) {
+          // Sizes of 1 broadcast to the other size.
+          Value isOne = rewriter.create<mlir::stablehlo::CompareOp>(
+              loc, dynamicSize, getConstant(i32ScalarType, 1),
+              mlir::stablehlo::ComparisonDirection::EQ);
+          size = rewriter.create<mlir::stablehlo::SelectOp>(loc, isOne, size,
+                                                            dynamicSize);
+        }
+        dynamicSize = size;
+      }
+    }
+    if (staticSize != 1 || !dynamicSize) {
+      extents.push_back(getConstant(i32x1Type, staticSize));
+      continue;
+    }
+    extents.push_back(rewriter.create<mlir::stablehlo::ReshapeOp>(
+        loc, i32x1Type, dynamicSize));
+  }
+  return rewriter.create<mlir::stablehlo::ConcatenateOp>(loc, extents,
+                                                         /*dimension=*/0);
+}
+
 //===----------------------------------------------------------------------===//
 // Broadcasting Patterns.
 //===----------------------------------------------------------------------===//
@@ -222,6 +357,82 @@ struct ConvertTrivialNonBroadcastBinaryOp final
   }
 };
 
+// Converts binary ops with statically shaped operands which broadcast to
+// broadcast_in_dim ops and the corresponding stablehlo non-broadcasting op.
+template <typename ChloOpTy, typename HloOpTy, typename Adaptor>
+struct ConvertStaticBroadcastBinaryOp final : OpConversionPattern<ChloOpTy> {
+  using OpConversionPattern<ChloOpTy>::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      ChloOpTy op, typename ChloOpTy::Adaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    auto resultType = dyn_cast<RankedTensorType>(op.getType());
+    if (!resultType) return failure();
+
+    auto broadcastedOperands =
+        broadcastStaticOperands(rewriter, op.getLoc(), adaptor.getOperands(),
+                                resultType, op.getBroadcastDimensions());
+    if (failed(broadcastedOperands)) return failure();
+
+    rewriter.replaceOp(
+        op, ValueRange{Adaptor::createOp(op, resultType, *broadcastedOperands,
+                                         rewriter)});
+    return success();
+  }
+};
+
+// Converts binary ops whose dynamic dims are all bounded to
+// dynamic_broadcast_in_dim ops and the corresponding stablehlo
+// non-broadcasting op. Unlike ConvertRankedDynamicBroadcastBinaryOp, the
+// extents of the result are computed with stablehlo ops rather than shape
+// dialect ops, and there is no shape.cstr_broadcastable constraint, since
+// producers of bounded programs check that their shapes are broadcastable.
+template <typename ChloOpTy, typename HloOpTy, typename Adaptor>
+struct ConvertBoundedBroadcastBinaryOp final : OpConversionPattern<ChloOpTy> {
+  using OpConversionPattern<ChloOpTy>::OpConversionPattern;
+
+  LogicalResult matchAndRewrite(
+      ChloOpTy op, typename ChloOpTy::Adaptor adaptor,
+      ConversionPatternRewriter &rewriter) const override {
+    Value lhs = adaptor.getLhs();
+    Value rhs = adaptor.getRhs();
+    auto lhsType = dyn_cast<RankedTensorType>(lhs.getType());
+    auto rhsType = dyn_cast<RankedTensorType>(rhs.getType());
+    auto resultType = dyn_cast<RankedTensorType>(op.getType());
+    if (!lhsType || !rhsType || !resultType) return failure();
+    if (lhsType.hasStaticShape() && rhsType.hasStaticShape()) return failure();
+    if (!hasBoundedShape(lhsType) || !hasBoundedShape(rhsType))
+      return failure();
+
+    int64_t resultRank = resultType.getRank();
+    auto lhsDimensions = getBroadcastDimensions(
+        lhsType.getRank(), resultRank, op.getBroadcastDimensions());
+    auto rhsDimensions = getBroadcastDimensions(
+        rhsType.getRank(), resultRank, op.getBroadcastDimensions());
+    if (failed(lhsDimensions) || failed(rhsDimensions)) return failure();
+
+    Location loc = op.getLoc();
+    Value resultExtents =
+        computeBroadcastExtents(rewriter, loc, {lhs, rhs},
+                                {*lhsDimensions, *rhsDimensions}, resultType);
+    auto broadcast = [&](Value operand, ArrayRef<int64_t> dims) -> Value {
+      auto type = cast<RankedTensorType>(operand.getType());
+      return rewriter.create<mlir::stablehlo::DynamicBroadcastInDimOp>(
+          loc,
+          RankedTensorType::get(resultType.getShape(), type.getElementType(),
+                                resultType.getEncoding()),
+          operand, resultExtents, rewriter.getDenseI64ArrayAttr(dims));
+    };
+    Value broadcastedLhs = broadcast(lhs, *lhsDimensions);
+    Value broadcastedRhs = broadcast(rhs, *rhsDimensions);
+
+    rewriter.replaceOp(
+        op, ValueRange{Adaptor::createOp(
+                op, resultType, {broadcastedLhs, broadcastedRhs}, rewriter)});
+    return success();
+  }
+};
+
 // Converts a binary op with ranked broadcasting operands to explicitly
 // broadcast and invoke the corresponding stablehlo non-broadcasting op.
 // Note that dynamic broadcasting supported by this pattern is only valid for
@@ -370,6 +581,20 @@ struct ConvertSelectOp final
       return failure();
     }
 
+    // Pred has an implicit broadcast for scalars, so it's only broadcast if it
+    // isn't a scalar.
+    SmallVector<Value> operands = {onTrue, onFalse};
+    if (predType.getRank() > 0) operands.insert(operands.begin(), pred);
+    auto broadcastedOperands =
+        broadcastStaticOperands(rewriter, op.getLoc(), operands, resultType);
+    if (succeeded(broadcastedOperands)) {
+      auto broadcasted = ArrayRef<Value>(*broadcastedOperands);
+      rewriter.replaceOpWithNewOp<mlir::stablehlo::SelectOp>(
+          op, resultType, predType.getRank() > 0 ? broadcasted.front() : pred,
+          broadcasted.take_back(2)[0], broadcasted.back());
+      return success();
+    }
+
     Location loc = op.getLoc();
     Value predShape = rewriter.createOrFold<shape::ShapeOfOp>(loc, pred);
     Value onTrueShape = rewriter.createOrFold<shape::ShapeOfOp>(loc, onTrue);
@@ -574,11 +799,11 @@ static Value materializeBesselI1eApproximationF64(
                                                    kI1eCoeffsA, kI1eCoeffsB);
 }
 
-static Value materializeWithUpcast(ConversionPatternRewriter &rewriter,
-                                   Location loc, ValueRange args,
-                                   FloatType minPrecisionTy,
-                                   Value callback(ConversionPatternRewriter &,
-                                                  Location, ValueRange)) {
+static Value materializeWithUpcast(
+    ConversionPatternRewriter &rewriter, Location loc, ValueRange args,
+    FloatType minPrecisionTy,
+    function_ref<Value(ConversionPatternRewriter &, Location, ValueRange)>
+        callback) {
   Type originalTy = getElementTypeOrSelf(args.front().getType());
   auto floatOriginalTy = dyn_cast<FloatType>(originalTy);
   bool needsUpcast =
@@ -1239,6 +1464,82 @@ constexpr std::array<double, 8> kLanczosCoefficients = {
     12.507343278686904814458936853,     -0.13857109526572011689554707,
     9.984369578019570859563e-6,         1.50563273514931155834e-7};
 
+// Coefficients of the Lanczos sum
+//   a(z) = kBaseLanczosCoeff + sum(k = 1, n, kLanczosCoefficients[i] / (z + k))
+// as a rational function p(y) / q(y) of y = 1 / (z + 1), and of d(y) in its
+// logarithmic derivative
+//   a'(z) / a(z) = -y^2 * d(y) / (p(y) * q(y)),
+// in decreasing powers of y. Unlike the sum, these take a couple of divisions
+// rather than one per coefficient, and since z > -1/2 where they're evaluated,
+// y is in (0, 2) and the polynomials don't overflow.
+struct LanczosRationalCoefficients {
+  SmallVector<double> p;
+  SmallVector<double> q;
+  SmallVector<double> d;
+};
+
+static const LanczosRationalCoefficients &getLanczosRationalCoefficients() {
+  static const auto *coefficients = [] {
+    // Polynomials are in increasing powers of y until they're returned.
+    auto multiply = [](ArrayRef<double> lhs, ArrayRef<double> rhs) {
+      SmallVector<double> result(lhs.size() + rhs.size() - 1, 0.0);
+      for (auto [i, l] : llvm::enumerate(lhs))
+        for (auto [j, r] : llvm::enumerate(rhs)) result[i + j] += l * r;
+      return result;
+    };
+    auto derive = [](ArrayRef<double> poly) {
+      SmallVector<double> result;
+      for (size_t i = 1; i < poly.size(); ++i) result.push_back(i * poly[i]);
+      return result;
+    };
+
+    // As z + k = (1 + (k - 1) * y) / y, the k-th term of the sum is
+    //   kLanczosCoefficients[k - 1] * y / (1 + (k - 1) * y).
+    int64_t n = kLanczosCoefficients.size();
+    auto *result = new LanczosRationalCoefficients();
+    result->q = {1.0};
+    for (int64_t k = 2; k <= n; ++k)
+      result->q = multiply(result->q, {1.0, static_cast<double>(k - 1)});
+    for (double c : result->q) result->p.push_back(kBaseLanczosCoeff * c);
+    result->p.push_back(0.0);
+    for (int64_t k = 1; k <= n; ++k) {
+      SmallVector<double> term = {0.0, kLanczosCoefficients[k - 1]};
+      for (int64_t j = 2; j <= n; ++j)
+        if (j != k) term = multiply(term, {1.0, static_cast<double>(j - 1)});
+      for (auto [i, c] : llvm::enumerate(term)) result->p[i] += c;
+    }
+
+    // d = p' * q - p * q'.
+    result->d = multiply(derive(result->p), result->q);
+    for (auto [i, c] : llvm::enumerate(multiply(result->p, derive(result->q))))
+      result->d[i] -= c;
+
+    std::reverse(result->p.begin(), result->p.end());
+    std::reverse(result->q.begin(), result->q.end());
+    std::reverse(result->d.begin(), result->d.end());
+    return result;
+  }();
+  return *coefficients;
+}
+
+// Materializes y = 1 / (z + 1), p(y) and q(y) of the Lanczos sum
+//   a(z) = p(y) / q(y).
+// Fast decompositions of lgamma and digamma of the same operand materialize
+// them identically, so that CSE merges them.
+static std::tuple<Value, Value, Value> materializeLanczosRational(
+    ConversionPatternRewriter &rewriter, Location loc, Value z) {
+  const auto &coefficients = getLanczosRationalCoefficients();
+  Value y = rewriter.create<mlir::stablehlo::DivOp>(
+      loc, getConstantLike(rewriter, loc, 1, z),
+      rewriter.create<mlir::stablehlo::AddOp>(
+          loc, z, getConstantLike(rewriter, loc, 1, z)));
+  Value p = materializePolynomialApproximation(
+      rewriter, loc, y, ArrayRef<double>(coefficients.p));
+  Value q = materializePolynomialApproximation(
+      rewriter, loc, y, ArrayRef<double>(coefficients.q));
+  return {y, p, q};
+}
+
 // Compute the Lgamma function using Lanczos' approximation from "A Precision
 // Approximation of the Gamma Function". SIAM Journal on Numerical Analysis
 // series B. Vol. 1:
@@ -1249,7 +1550,7 @@ constexpr std::array<double, 8> kLanczosCoefficients = {
 //          a(z) = kBaseLanczosCoeff
 //                   + sum(k = 1, n, kLanczosCoefficients[i] / (z + k))
 static Value materializeLgamma(ConversionPatternRewriter &rewriter,
-                               Location loc, ValueRange args) {
+                               Location loc, ValueRange args, bool fast) {
   // If the input is less than 0.5 use Euler's reflection formula.
   //   gamma(x) = pi / (sin(pi * x) * gamma(1 - x))
   // Let z be
@@ -1268,14 +1569,21 @@ static Value materializeLgamma(ConversionPatternRewriter &rewriter,
   // Materialize
   //   a(z) = kBaseLanczosCoeff
   //            + sum(k = 1, n, kLanczosCoefficients[i] / (z + k))
-  Value a = getConstantLike(rewriter, loc, kBaseLanczosCoeff, x);
-  for (int i = 0, end = kLanczosCoefficients.size(); i < end; ++i) {
-    Value coeff = getConstantLike(rewriter, loc, kLanczosCoefficients[i], x);
-    Value oneBasedIndex = getConstantLike(rewriter, loc, i + 1, x);
-    Value quotient = rewriter.create<mlir::stablehlo::DivOp>(
-        loc, coeff,
-        rewriter.create<mlir::stablehlo::AddOp>(loc, z, oneBasedIndex));
-    a = rewriter.create<mlir::stablehlo::AddOp>(loc, a, quotient);
+  // or, if fast, the equivalent rational function.
+  Value a;
+  if (fast) {
+    auto [y, p, q] = materializeLanczosRational(rewriter, loc, z);
+    a = rewriter.create<mlir::stablehlo::DivOp>(loc, p, q);
+  } else {
+    a = getConstantLike(rewriter, loc, kBaseLanczosCoeff, x);
+    for (int i = 0, end = kLanczosCoefficients.size(); i < end; ++i) {
+      Value coeff = getConstantLike(rewriter, loc, kLanczosCoefficients[i], x);
+      Value oneBasedIndex = getConstantLike(rewriter, loc, i + 1, x);
+      Value quotient = rewriter.create<mlir::stablehlo::DivOp>(
+          loc, coeff,
+          rewriter.create<mlir::stablehlo::AddOp>(loc, z, oneBasedIndex));
+      a = rewriter.create<mlir::stablehlo::AddOp>(loc, a, quotient);
+    }
   }
 
   // To improve accuracy on platforms with less-precise log implementations,
@@ -1431,7 +1739,7 @@ struct ConvertCoshOp final : OpConversionPattern<mlir::chlo::CoshOp> {
 //                   + sum(k = 1, n, kLanczosCoefficients[i] / (z + k))
 //          a'(z) = - sum(k = 1, n, kLanczosCoefficients[i] / (z + k) / (z + k))
 static Value materializeDigamma(ConversionPatternRewriter &rewriter,
-                                Location loc, ValueRange args) {
+                                Location loc, ValueRange args, bool fast) {
   // If the input is less than 0.5 use Euler's reflection formula.
   //   digamma(x) = digamma(1 - x) - pi * cot(pi * x)
   // Let z be
@@ -1451,21 +1759,37 @@ static Value materializeDigamma(ConversionPatternRewriter &rewriter,
   //   a(z) = kBaseLanczosCoeff
   //            + sum(k = 1, n, kLanczosCoefficients[i] / (z + k))
   //   a'(z) = - sum(k = 1, n, kLanczosCoefficients[i] / (z + k) / (z + k))
+  // or, if fast, a'(z) / a(z) as the equivalent rational function.
   Value zero = getConstantLike(rewriter, loc, 0.0, x);
-  Value a = getConstantLike(rewriter, loc, kBaseLanczosCoeff, x);
-  Value aPrime = zero;
-  for (int i = 0, end = kLanczosCoefficients.size(); i < end; ++i) {
-    Value coeff = getConstantLike(rewriter, loc, kLanczosCoefficients[i], x);
-    Value oneBasedIndex = getConstantLike(rewriter, loc, i + 1, x);
-    Value zTerm =
-        rewriter.create<mlir::stablehlo::AddOp>(loc, z, oneBasedIndex);
-    aPrime = rewriter.create<mlir::stablehlo::SubtractOp>(
-        loc, aPrime,
-        rewriter.create<mlir::stablehlo::DivOp>(
-            loc, coeff,
-            rewriter.create<mlir::stablehlo::MulOp>(loc, zTerm, zTerm)));
-    a = rewriter.create<mlir::stablehlo::AddOp>(
-        loc, a, rewriter.create<mlir::stablehlo::DivOp>(loc, coeff, zTerm));
+  Value a, aPrime, aPrimeDivA;
+  if (fast) {
+    auto [y, p, q] = materializeLanczosRational(rewriter, loc, z);
+    Value d = materializePolynomialApproximation(
+        rewriter, loc, y,
+        ArrayRef<double>(getLanczosRationalCoefficients().d));
+    aPrimeDivA = rewriter.create<mlir::stablehlo::NegOp>(
+        loc, rewriter.create<mlir::stablehlo::DivOp>(
+                 loc,
+                 rewriter.create<mlir::stablehlo::MulOp>(
+                     loc, rewriter.create<mlir::stablehlo::MulOp>(loc, y, y),
+                     d),
+                 rewriter.create<mlir::stablehlo::MulOp>(loc, p, q)));
+  } else {
+    a = getConstantLike(rewriter, loc, kBaseLanczosCoeff, x);
+    aPrime = zero;
+    for (int i = 0, end = kLanczosCoefficients.size(); i < end; ++i) {
+      Value coeff = getConstantLike(rewriter, loc, kLanczosCoefficients[i], x);
+      Value oneBasedIndex = getConstantLike(rewriter, loc, i + 1, x);
+      Value zTerm =
+          rewriter.create<mlir::stablehlo::AddOp>(loc, z, oneBasedIndex);
+      aPrime = rewriter.create<mlir::stablehlo::SubtractOp>(
+          loc, aPrime,
+          rewriter.create<mlir::stablehlo::DivOp>(
+              loc, coeff,
+              rewriter.create<mlir::stablehlo::MulOp>(loc, zTerm, zTerm)));
+      a = rewriter.create<mlir::stablehlo::AddOp>(
+          loc, a, rewriter.create<mlir::stablehlo::DivOp>(loc, coeff, zTerm));
+    }
   }
 
   // To improve accuracy on platforms with less-precise log implementations,
@@ -1485,7 +1809,8 @@ static Value materializeDigamma(ConversionPatternRewriter &rewriter,
 
   // Materialize the final result (modulo reflection) as
   //   digamma(z + 1) = log(t(z)) + a'(z) / a(z) - kLanczosGamma / t(z).
-  Value aPrimeDivA = rewriter.create<mlir::stablehlo::DivOp>(loc, aPrime, a);
+  if (!fast)
+    aPrimeDivA = rewriter.create<mlir::stablehlo::DivOp>(loc, aPrime, a);
   Value lanczosGammaDivT = rewriter.create<mlir::stablehlo::DivOp>(
       loc, getConstantLike(rewriter, loc, kLanczosGamma, x), t);
   Value digamma = rewriter.create<mlir::stablehlo::SubtractOp>(
@@ -1739,31 +2064,47 @@ static Value materializePolygamma(ConversionPatternRewriter &rewriter,
 }
 
 struct ConvertLgammaOp final : OpConversionPattern<mlir::chlo::LgammaOp> {
-  using OpConversionPattern::OpConversionPattern;
+  ConvertLgammaOp(MLIRContext *context, bool fast)
+      : OpConversionPattern(context), fast(fast) {}
 
   LogicalResult matchAndRewrite(
       mlir::chlo::LgammaOp op, OpAdaptor adaptor,
       ConversionPatternRewriter &rewriter) const override {
     FloatType minPrecisionTy = rewriter.getF32Type();
     rewriter.replaceOp(
-        op, materializeWithUpcast(rewriter, op.getLoc(), adaptor.getOperands(),
-                                  minPrecisionTy, &materializeLgamma));
+        op, materializeWithUpcast(
+                rewriter, op.getLoc(), adaptor.getOperands(), minPrecisionTy,
+                [&](ConversionPatternRewriter &b, Location loc,
+                    ValueRange args) {
+                  return materializeLgamma(b, loc, args, fast);
+                }));
     return success();
   }
+
+ private:
+  bool fast;
 };
 
 struct ConvertDigammaOp final : OpConversionPattern<mlir::chlo::DigammaOp> {
-  using OpConversionPattern::OpConversionPattern;
+  ConvertDigammaOp(MLIRContext *context, bool fast)
+      : OpConversionPattern(context), fast(fast) {}
 
   LogicalResult matchAndRewrite(
       mlir::chlo::DigammaOp op, OpAdaptor adaptor,
       ConversionPatternRewriter &rewriter) const override {
     FloatType minPrecisionTy = rewriter.getF32Type();
     rewriter.replaceOp(
-        op, materializeWithUpcast(rewriter, op.getLoc(), adaptor.getOperands(),
-                                  minPrecisionTy, &materializeDigamma));
+        op, materializeWithUpcast(
+                rewriter, op.getLoc(), adaptor.getOperands(), minPrecisionTy,
+                [&](ConversionPatternRewriter &b, Location loc,
+                    ValueRange args) {
+                  return materializeDigamma(b, loc, args, fast);
+                }));
     return success();
   }
+
+ private:
+  bool fast;
 };
 
 static Value materializeNextAfter(ConversionPatternRewriter &rewriter,
@@ -1992,14 +2333,142 @@ struct ConvertSinhOp final : OpConversionPattern<mlir::chlo::SinhOp> {
 //                              (tensor<16x16xf32>) -> tensor<16x8xf32>
 // %6 = "hlo.slice"(%4) ...
 //
+// Returns the lowest value of `elementType` in the order of sort comparators
+// created by `createSortOp`, e.g. the negative NaN with all bits set for
+// floats, or nullptr if `elementType` isn't a float or integer type.
+static TypedAttr getLowestSortValue(Type elementType) {
+  if (auto floatType = dyn_cast<FloatType>(elementType)) {
+    return FloatAttr::get(
+        floatType,
+        APFloat(floatType.getFloatSemantics(),
+                APInt::getAllOnes(floatType.getIntOrFloatBitWidth())));
+  }
+  if (auto integerType = dyn_cast<IntegerType>(elementType)) {
+    unsigned width = integerType.getWidth();
+    bool isUnsigned = integerType.isUnsigned() || width == 1;
+    return IntegerAttr::get(integerType,
+                            isUnsigned ? APInt::getMinValue(width)
+                                       : APInt::getSignedMinValue(width));
+  }
+  return nullptr;
+}
+
+// Sorts `values` and `indices` along their last dim by decreasing values and
+// slices the first `k` of them.
+static std::pair<Value, Value> materializeSortedPrefix(
+    ConversionPatternRewriter &rewriter, Location loc, Value values,
+    Value indices, int64_t k) {
+  auto type = cast<RankedTensorType>(values.getType());
+  int64_t lastDimIndex = type.getRank() - 1;
+  auto sortOp = createSortOp(
+      &rewriter, loc, {values, indices},
+      {type.getElementType(), getElementTypeOrSelf(indices.getType())},
+      lastDimIndex, /*isStable=*/true,
+      /*direction=*/mlir::stablehlo::ComparisonDirection::GT);
+
+  SmallVector<int64_t> beginIndices(type.getRank(), 0);
+  auto endIndices = llvm::to_vector(type.getShape());
+  endIndices.back() = k;
+  SmallVector<int64_t> strides(type.getRank(), 1);
+  auto slice = [&](Value operand) -> Value {
+    return rewriter.create<mlir::stablehlo::SliceOp>(
+        loc, operand, rewriter.getDenseI64ArrayAttr(beginIndices),
+        rewriter.getDenseI64ArrayAttr(endIndices),
+        rewriter.getDenseI64ArrayAttr(strides));
+  };
+  return {slice(sortOp.getResult(0)), slice(sortOp.getResult(1))};
+}
+
+// Materializes top_k of a statically shaped `operand` by selecting the top
+// `k` elements of every block of `blockSize` elements of its last dim, and
+// then the top `k` of these candidates, repeatedly until at most `blockSize`
+// candidates remain. This sorts O(n) rather than O(n log n) elements of a last
+// dim of size n when k is much smaller than n. The last dim is padded with the
+// lowest value to a multiple of `blockSize`, which is never selected since
+// ties are broken by position. Returns failure if `blockSize` isn't at least
+// twice `k`, so that every level halves the candidates at least.
+static FailureOr<std::pair<Value, Value>> materializeBlockwiseTopK(
+    ConversionPatternRewriter &rewriter, Location loc, Value operand,
+    int64_t k, int64_t blockSize) {
+  auto operandType = cast<RankedTensorType>(operand.getType());
+  int64_t lastDimIndex = operandType.getRank() - 1;
+  if (!operandType.hasStaticShape() || lastDimIndex < 0 ||
+      operandType.getDimSize(lastDimIndex) <= blockSize || 2 * k > blockSize)
+    return failure();
+  Type elementType = operandType.getElementType();
+  TypedAttr lowest = getLowestSortValue(elementType);
+  if (!lowest) return failure();
+
+  auto i32Type = rewriter.getI32Type();
+  Value values = operand;
+  Value indices = rewriter.create<mlir::stablehlo::IotaOp>(
+      loc, RankedTensorType::get(operandType.getShape(), i32Type),
+      rewriter.getI64IntegerAttr(lastDimIndex));
+  Value lowestValue = rewriter.create<mlir::stablehlo::ConstantOp>(
+      loc, DenseElementsAttr::get(RankedTensorType::get({}, elementType),
+                                  ArrayRef<Attribute>{lowest}));
+  Value zeroIndex = rewriter.create<mlir::stablehlo::ConstantOp>(
+      loc, DenseIntElementsAttr::get(RankedTensorType::get({}, i32Type),
+                                     static_cast<int32_t>(0)));
+
+  auto batchShape = operandType.getShape().drop_back();
+  int64_t size = operandType.getDimSize(lastDimIndex);
+  while (size > blockSize) {
+    int64_t numBlocks = llvm::divideCeil(size, blockSize);
+    if (int64_t padding = numBlocks * blockSize - size) {
+      SmallVector<int64_t> zeros(lastDimIndex + 1, 0);
+      SmallVector<int64_t> high = zeros;
+      high.back() = padding;
+      auto pad = [&](Value input, Value paddingValue) -> Value {
+        return rewriter.create<mlir::stablehlo::PadOp>(
+            loc, input, paddingValue, rewriter.getDenseI64ArrayAttr(zeros),
+            rewriter.getDenseI64ArrayAttr(high),
+            rewriter.getDenseI64ArrayAttr(zeros));
+      };
+      values = pad(values, lowestValue);
+      indices = pad(indices, zeroIndex);
+    }
+
+    auto reshape = [&](Value input, ArrayRef<int64_t> shape) -> Value {
+      return rewriter.create<mlir::stablehlo::ReshapeOp>(
+          loc, RankedTensorType::get(shape, getElementTypeOrSelf(input)),
+          input);
+    };
+    auto blocksShape = llvm::to_vector(batchShape);
+    blocksShape.append({numBlocks, blockSize});
+    auto [blockValues, blockIndices] = materializeSortedPrefix(
+        rewriter, loc, reshape(values, blocksShape),
+        reshape(indices, blocksShape), k);
+
+    size = numBlocks * k;
+    auto candidatesShape = llvm::to_vector(batchShape);
+    candidatesShape.push_back(size);
+    values = reshape(blockValues, candidatesShape);
+    indices = reshape(blockIndices, candidatesShape);
+  }
+  return materializeSortedPrefix(rewriter, loc, values, indices, k);
+}
+
 struct ConvertTopKOp final : OpConversionPattern<mlir::chlo::TopKOp> {
-  using OpConversionPattern::OpConversionPattern;
+  ConvertTopKOp(MLIRContext *context, int64_t blockSize)
+      : OpConversionPattern(context), blockSize(blockSize) {}
 
   LogicalResult matchAndRewrite(
       mlir::chlo::TopKOp op, OpAdaptor /*adaptor*/,
       ConversionPatternRewriter &rewriter) const override {
     auto operandType = dyn_cast<RankedTensorType>(op.getOperand().getType());
     if (!operandType) return failure();
+
+    if (blockSize > 0) {
+      auto topK = materializeBlockwiseTopK(rewriter, op.getLoc(),
+                                           op.getOperand(), op.getK(),
+                                           blockSize);
+      if (succeeded(topK)) {
+        rewriter.replaceOp(op, {topK->first, topK->second});
+        return success();
+      }
+    }
+
     int64_t operandRank = operandType.getRank();
     int64_t lastDimIndex = operandRank - 1;
     int64_t lastDimSize = operandType.getDimSize(lastDimIndex);
@@ -2105,6 +2574,9 @@ struct ConvertTopKOp final : OpConversionPattern<mlir::chlo::TopKOp> {
     rewriter.replaceOp(op, {values, indices});
     return success();
   }
+
+ private:
+  int64_t blockSize;
 };
 
 struct ConvertZetaOp final : OpConversionPattern<mlir::chlo::ZetaOp> {
@@ -2128,6 +2600,8 @@ struct ConvertZetaOp final : OpConversionPattern<mlir::chlo::ZetaOp> {
 
 struct ChloLegalizeToStablehloPass final
     : impl::ChloLegalizeToStablehloPassBase<ChloLegalizeToStablehloPass> {
+  using ChloLegalizeToStablehloPassBase::ChloLegalizeToStablehloPassBase;
+
   LogicalResult initialize(MLIRContext *context) override {
     target = std::make_shared<ConversionTarget>(*context);
     target->addIllegalDialect<chlo::ChloDialect>();
@@ -2137,7 +2611,8 @@ struct ChloLegalizeToStablehloPass final
                             mlir::tensor::TensorDialect>();
 
     RewritePatternSet patterns_(context);
-    populateChloToStablehloPatterns(context, &patterns_);
+    populateChloToStablehloPatterns(context, &patterns_, fastSpecialFunctions,
+                                    topKBlockSize);
     patterns = std::move(patterns_);
 
     return success();
@@ -2165,25 +2640,37 @@ static void populateChloBroadcastingPatterns(MLIRContext *context,
   // not have special attributes that need to be preserved.
   populateForBroadcastingBinaryOp<ConvertTrivialNonBroadcastBinaryOp>(
       context, patterns, 10);
+  populateForBroadcastingBinaryOp<ConvertStaticBroadcastBinaryOp>(
+      context, patterns, 8);
+  populateForBroadcastingBinaryOp<ConvertBoundedBroadcastBinaryOp>(
+      context, patterns, 7);
   populateForBroadcastingBinaryOp<ConvertRankedDynamicBroadcastBinaryOp>(
       context, patterns, 5);
   patterns->add<ConvertConstantLikeOp, ConvertSelectOp>(context);
 }
 
 static void populateChloDecompositionPatterns(MLIRContext *context,
-                                              RewritePatternSet *patterns) {
+                                              RewritePatternSet *patterns,
+                                              bool fastSpecialFunctions,
+                                              int64_t topKBlockSize) {
   populateWithGenerated(*patterns);
   patterns->add<ConvertConstantOp, ConvertBesselI1eOp, ConvertCoshOp,
-                ConvertDigammaOp, ConvertErfOp, ConvertErfcOp, ConvertErfInvOp,
-                ConvertLgammaOp, ConvertNextAfterOp, ConvertPolygammaOp,
-                ConvertSinhOp, ConvertTopKOp, ConvertZetaOp>(context);
+                ConvertErfOp, ConvertErfcOp, ConvertErfInvOp,
+                ConvertNextAfterOp, ConvertPolygammaOp, ConvertSinhOp,
+                ConvertZetaOp>(context);
+  patterns->add<ConvertDigammaOp, ConvertLgammaOp>(context,
+                                                   fastSpecialFunctions);
+  patterns->add<ConvertTopKOp>(context, topKBlockSize);
 }
 }  // namespace
 
 void populateChloToStablehloPatterns(MLIRContext *context,
-                                     RewritePatternSet *patterns) {
+                                     RewritePatternSet *patterns,
+                                     bool fastSpecialFunctions,
+                                     int64_t topKBlockSize) {
   populateChloBroadcastingPatterns(context, patterns);
-  populateChloDecompositionPatterns(context, patterns);
+  populateChloDecompositionPatterns(context, patterns, fastSpecialFunctions,
+                                    topKBlockSize);
 }
 
 }  // namespace stablehlo
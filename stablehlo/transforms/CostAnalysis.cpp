@@ -0,0 +1,412 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/transforms/CostAnalysis.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/Quant/QuantTypes.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Region.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "stablehlo/dialect/Base.h"
+#include "stablehlo/dialect/StablehloOps.h"
+
+namespace mlir {
+namespace stablehlo {
+
+OpCost &OpCost::operator+=(const OpCost &other) {
+  count += other.count;
+  flops += other.flops;
+  bytesRead += other.bytesRead;
+  bytesWritten += other.bytesWritten;
+  return *this;
+}
+
+namespace {
+
+// Returns the number of elements of `type`, using bounds for bounded dynamic
+// dimensions, or std::nullopt if it has unbounded ones.
+std::optional<int64_t> getNumElements(ShapedType type) {
+  if (!type.hasRank()) return std::nullopt;
+  ArrayRef<int64_t> bounds;
+  if (auto rankedType = dyn_cast<RankedTensorType>(type))
+    bounds = hlo::encodingToBounds(rankedType.getEncoding());
+  int64_t numElements = 1;
+  for (auto [i, dimSize] : llvm::enumerate(type.getShape())) {
+    if (ShapedType::isDynamic(dimSize)) {
+      if (bounds.empty() || ShapedType::isDynamic(bounds[i]))
+        return std::nullopt;
+      dimSize = bounds[i];
+    }
+    numElements *= dimSize;
+  }
+  return numElements;
+}
+
+int64_t getElementSizeInBytes(Type type) {
+  if (auto complexType = dyn_cast<ComplexType>(type))
+    return 2 * getElementSizeInBytes(complexType.getElementType());
+  if (auto quantizedType = dyn_cast<quant::QuantizedType>(type))
+    return getElementSizeInBytes(quantizedType.getStorageType());
+  if (type.isIndex()) return 8;
+  if (type.isIntOrFloat())
+    return llvm::divideCeil(type.getIntOrFloatBitWidth(), 8);
+  return 0;
+}
+
+// Returns the number of operations in the body of a reduction, which are
+// applied once per element it combines.
+int64_t getNumBodyOps(Region &region) {
+  int64_t numOps = 0;
+  region.walk([&](Operation *op) {
+    if (!op->hasTrait<OpTrait::IsTerminator>()) ++numOps;
+  });
+  return std::max<int64_t>(numOps, 1);
+}
+
+// Returns the number of FLOPs of `op`, which has no control flow, or
+// std::nullopt if the shapes it depends on aren't known.
+std::optional<int64_t> getFlops(Operation *op) {
+  auto numElements = [](Value value) {
+    return getNumElements(cast<ShapedType>(value.getType()));
+  };
+  auto product = [](ArrayRef<int64_t> sizes) {
+    int64_t result = 1;
+    for (int64_t size : sizes) result *= size;
+    return result;
+  };
+
+  if (op->hasTrait<OpTrait::Elementwise>())
+    return numElements(op->getResult(0));
+
+  if (auto dotGeneralOp = dyn_cast<DotGeneralOp>(op)) {
+    auto resultSize = numElements(dotGeneralOp.getResult());
+    auto lhsType = dotGeneralOp.getLhs().getType();
+    int64_t contractingSize = 1;
+    for (auto dim : dotGeneralOp.getDotDimensionNumbers()
+                        .getLhsContractingDimensions()) {
+      if (lhsType.isDynamicDim(dim)) return std::nullopt;
+      contractingSize *= lhsType.getDimSize(dim);
+    }
+    if (!resultSize) return std::nullopt;
+    return 2 * *resultSize * contractingSize;
+  }
+  if (auto dotOp = dyn_cast<DotOp>(op)) {
+    auto resultSize = numElements(dotOp.getResult());
+    auto lhsType = dyn_cast<RankedTensorType>(dotOp.getLhs().getType());
+    if (!resultSize || !lhsType || lhsType.isDynamicDim(lhsType.getRank() - 1))
+      return std::nullopt;
+    return 2 * *resultSize * lhsType.getShape().back();
+  }
+  if (auto convolutionOp = dyn_cast<ConvolutionOp>(op)) {
+    // Every output element is a dot product over the input features and the
+    // spatial dimensions of the kernel.
+    auto resultSize = numElements(convolutionOp.getResult());
+    auto rhsType = convolutionOp.getRhs().getType();
+    auto dimensionNumbers = convolutionOp.getDimensionNumbers();
+    if (!resultSize || !rhsType.hasStaticShape()) return std::nullopt;
+    int64_t dotSize =
+        rhsType.getDimSize(dimensionNumbers.getKernelInputFeatureDimension());
+    for (auto dim : dimensionNumbers.getKernelSpatialDimensions())
+      dotSize *= rhsType.getDimSize(dim);
+    return 2 * *resultSize * dotSize;
+  }
+
+  if (auto reduceOp = dyn_cast<ReduceOp>(op)) {
+    auto inputSize = numElements(reduceOp.getInputs().front());
+    if (!inputSize) return std::nullopt;
+    return *inputSize * getNumBodyOps(reduceOp.getBody());
+  }
+  if (auto reduceWindowOp = dyn_cast<ReduceWindowOp>(op)) {
+    auto resultSize = numElements(reduceWindowOp.getResult(0));
+    if (!resultSize) return std::nullopt;
+    return *resultSize * product(reduceWindowOp.getWindowDimensions()) *
+           getNumBodyOps(reduceWindowOp.getBody());
+  }
+  if (auto selectAndScatterOp = dyn_cast<SelectAndScatterOp>(op)) {
+    auto sourceSize = numElements(selectAndScatterOp.getSource());
+    if (!sourceSize) return std::nullopt;
+    int64_t windowSize = 1;
+    if (auto windowDimensions = selectAndScatterOp.getWindowDimensions())
+      windowSize = product(*windowDimensions);
+    return *sourceSize *
+           (windowSize * getNumBodyOps(selectAndScatterOp.getSelect()) +
+            getNumBodyOps(selectAndScatterOp.getScatter()));
+  }
+  if (auto scatterOp = dyn_cast<ScatterOp>(op)) {
+    auto updatesSize = numElements(scatterOp.getUpdates().front());
+    if (!updatesSize) return std::nullopt;
+    return *updatesSize * getNumBodyOps(scatterOp.getUpdateComputation());
+  }
+  if (isa<MapOp, AllReduceOp, ReduceScatterOp>(op)) {
+    if (op->getNumOperands() == 0) return 0;
+    auto operandSize = numElements(op->getOperand(0));
+    if (!operandSize) return std::nullopt;
+    return *operandSize * getNumBodyOps(op->getRegion(0));
+  }
+  if (auto sortOp = dyn_cast<SortOp>(op)) {
+    // Comparison sorts compare every element about log2(n) times.
+    auto inputSize = numElements(sortOp.getInputs().front());
+    auto inputType = cast<ShapedType>(sortOp.getInputs().front().getType());
+    if (!inputSize || inputType.isDynamicDim(sortOp.getDimension()))
+      return std::nullopt;
+    int64_t dimSize = inputType.getDimSize(sortOp.getDimension());
+    return *inputSize * llvm::Log2_64_Ceil(std::max<int64_t>(dimSize, 1)) *
+           getNumBodyOps(sortOp.getComparator());
+  }
+
+  if (auto fftOp = dyn_cast<FftOp>(op)) {
+    // Fast Fourier transforms take about 5 n log2(n) FLOPs each.
+    auto operandSize = numElements(fftOp.getOperand());
+    int64_t length = product(fftOp.getFftLength());
+    if (!operandSize || length == 0) return std::nullopt;
+    int64_t numTransforms = *operandSize / length;
+    return numTransforms * 5 * length * llvm::Log2_64_Ceil(length);
+  }
+  if (auto choleskyOp = dyn_cast<CholeskyOp>(op)) {
+    // Every matrix of the batch takes about n^3 / 3 FLOPs.
+    auto operandSize = numElements(choleskyOp.getA());
+    if (!operandSize) return std::nullopt;
+    int64_t n = choleskyOp.getA().getType().getShape().back();
+    if (n == 0) return 0;
+    return *operandSize / (n * n) * (n * n * n / 3);
+  }
+  if (auto triangularSolveOp = dyn_cast<TriangularSolveOp>(op)) {
+    // Every element of the solution is a dot product with a row of `a`.
+    auto resultSize = numElements(triangularSolveOp.getResult());
+    if (!resultSize || !numElements(triangularSolveOp.getA()))
+      return std::nullopt;
+    int64_t n = triangularSolveOp.getA().getType().getShape().back();
+    return 2 * *resultSize * n;
+  }
+
+  // Other ops only move data.
+  return 0;
+}
+
+// Returns the cost of evaluating `op` once, which has no control flow, and
+// sets `isApproximate` if it isn't exact.
+OpCost getOpCost(Operation *op, bool &isApproximate) {
+  OpCost cost;
+  cost.count = 1;
+  for (Type type : op->getOperandTypes()) {
+    auto size = CostAnalysis::getSizeInBytes(type);
+    if (!size) isApproximate = true;
+    cost.bytesRead += size.value_or(0);
+  }
+  for (Type type : op->getResultTypes()) {
+    auto size = CostAnalysis::getSizeInBytes(type);
+    if (!size) isApproximate = true;
+    cost.bytesWritten += size.value_or(0);
+  }
+  // Custom calls are opaque.
+  if (isa<CustomCallOp>(op)) isApproximate = true;
+  auto flops = getFlops(op);
+  if (!flops) isApproximate = true;
+  cost.flops = flops.value_or(0);
+  return cost;
+}
+
+// Returns the maximum number of bytes of tensors which are live at the same
+// time in `block`. Arguments are live throughout the block, and other values
+// from their definition to their last use.
+int64_t getPeakLiveBytes(Block &block, bool &isApproximate) {
+  llvm::DenseMap<Operation *, size_t> indices;
+  for (auto [i, op] : llvm::enumerate(block)) indices[&op] = i;
+
+  int64_t liveBytes = 0;
+  for (Value arg : block.getArguments()) {
+    auto size = CostAnalysis::getSizeInBytes(arg.getType());
+    if (!size) isApproximate = true;
+    liveBytes += size.value_or(0);
+  }
+
+  // Results are freed after the op which uses them last in the block, which
+  // is the ancestor of their users in nested regions.
+  SmallVector<int64_t> freedBytes(block.getOperations().size(), 0);
+  for (auto [i, op] : llvm::enumerate(block)) {
+    for (Value result : op.getResults()) {
+      size_t lastUse = i;
+      for (Operation *user : result.getUsers())
+        if (Operation *ancestor = block.findAncestorOpInBlock(*user))
+          lastUse = std::max(lastUse, indices[ancestor]);
+      freedBytes[lastUse] +=
+          CostAnalysis::getSizeInBytes(result.getType()).value_or(0);
+    }
+  }
+
+  int64_t peakLiveBytes = liveBytes;
+  for (auto [i, op] : llvm::enumerate(block)) {
+    for (Type type : op.getResultTypes())
+      liveBytes += CostAnalysis::getSizeInBytes(type).value_or(0);
+    peakLiveBytes = std::max(peakLiveBytes, liveBytes);
+    liveBytes -= freedBytes[i];
+  }
+  return peakLiveBytes;
+}
+
+void addCost(FunctionCost &cost, const FunctionCost &other) {
+  cost.total += other.total;
+  for (const auto &[name, opCost] : other.opKinds) cost.opKinds[name] += opCost;
+  cost.isApproximate |= other.isApproximate;
+}
+
+}  // namespace
+
+CostAnalysis::CostAnalysis(ModuleOp module) : symbolTable(module) {}
+
+std::optional<int64_t> CostAnalysis::getSizeInBytes(Type type) {
+  if (auto tupleType = dyn_cast<TupleType>(type)) {
+    int64_t size = 0;
+    for (Type elementType : tupleType.getTypes()) {
+      auto elementSize = getSizeInBytes(elementType);
+      if (!elementSize) return std::nullopt;
+      size += *elementSize;
+    }
+    return size;
+  }
+  auto shapedType = dyn_cast<ShapedType>(type);
+  if (!shapedType) return 0;
+  auto numElements = getNumElements(shapedType);
+  if (!numElements) return std::nullopt;
+  return *numElements * getElementSizeInBytes(shapedType.getElementType());
+}
+
+void CostAnalysis::addOpCost(Operation *op, FunctionCost &cost) {
+  if (op->hasTrait<OpTrait::IsTerminator>()) return;
+
+  if (auto callOp = dyn_cast<func::CallOp>(op)) {
+    auto callee = symbolTable.lookup<func::FuncOp>(callOp.getCallee());
+    if (!callee || callee.isExternal()) {
+      cost.isApproximate = true;
+      return;
+    }
+    addCost(cost, getFunctionCost(callee));
+    return;
+  }
+
+  auto addRegionCost = [&](Region &region, FunctionCost &regionCost) {
+    for (Block &block : region)
+      for (Operation &nestedOp : block) addOpCost(&nestedOp, regionCost);
+  };
+  if (isa<IfOp, CaseOp>(op)) {
+    // Branches are estimated by the most expensive one.
+    FunctionCost branchesCost;
+    for (Region &region : op->getRegions()) {
+      FunctionCost branchCost;
+      addRegionCost(region, branchCost);
+      if (branchCost.total.flops >= branchesCost.total.flops)
+        branchesCost = std::move(branchCost);
+    }
+    addCost(cost, branchesCost);
+  } else if (isa<WhileOp>(op)) {
+    // The trip count of loops isn't known, so they're counted once.
+    cost.isApproximate = true;
+    for (Region &region : op->getRegions()) addRegionCost(region, cost);
+  }
+  if (isa<IfOp, CaseOp, WhileOp>(op)) {
+    // The op itself only forwards values.
+    OpCost opCost;
+    opCost.count = 1;
+    cost.total += opCost;
+    cost.opKinds[op->getName().getStringRef()] += opCost;
+    return;
+  }
+
+  OpCost opCost = getOpCost(op, cost.isApproximate);
+  cost.total += opCost;
+  cost.opKinds[op->getName().getStringRef()] += opCost;
+}
+
+const FunctionCost &CostAnalysis::getFunctionCost(func::FuncOp func) {
+  auto it = functionCosts.find(func);
+  if (it != functionCosts.end()) return it->second;
+
+  // Recursive calls, which StableHLO doesn't allow, cost nothing.
+  functionCosts[func].isApproximate = true;
+  FunctionCost cost;
+  if (!func.isExternal()) {
+    for (Operation &op : func.getBody().front()) addOpCost(&op, cost);
+    cost.peakLiveBytes =
+        getPeakLiveBytes(func.getBody().front(), cost.isApproximate);
+  }
+  return functionCosts[func] = std::move(cost);
+}
+
+void printCostAnalysis(ModuleOp module, llvm::raw_ostream &os, bool json) {
+  CostAnalysis analysis(module);
+  auto funcs = llvm::to_vector(module.getOps<func::FuncOp>());
+  llvm::erase_if(funcs, [](func::FuncOp func) { return func.isExternal(); });
+
+  if (!json) {
+    for (func::FuncOp func : funcs) {
+      const FunctionCost &cost = analysis.getFunctionCost(func);
+      os << "func @" << func.getSymName() << ": " << cost.total.flops
+         << " flops, " << cost.total.bytesRead << " bytes read, "
+         << cost.total.bytesWritten << " bytes written, "
+         << cost.peakLiveBytes << " peak live bytes"
+         << (cost.isApproximate ? " (approximate)" : "") << "\n";
+      for (const auto &[name, opCost] : cost.opKinds)
+        os << "  " << name << ": " << opCost.count << " ops, "
+           << opCost.flops << " flops, " << opCost.bytesRead
+           << " bytes read, " << opCost.bytesWritten << " bytes written\n";
+    }
+    return;
+  }
+
+  llvm::json::OStream stream(os, /*IndentSize=*/2);
+  auto writeOpCost = [&](const OpCost &opCost) {
+    stream.attribute("count", opCost.count);
+    stream.attribute("flops", opCost.flops);
+    stream.attribute("bytes_read", opCost.bytesRead);
+    stream.attribute("bytes_written", opCost.bytesWritten);
+  };
+  stream.object([&] {
+    stream.attributeArray("functions", [&] {
+      for (func::FuncOp func : funcs) {
+        const FunctionCost &cost = analysis.getFunctionCost(func);
+        stream.object([&] {
+          stream.attribute("name", func.getSymName());
+          writeOpCost(cost.total);
+          stream.attribute("peak_live_bytes", cost.peakLiveBytes);
+          stream.attribute("approximate", cost.isApproximate);
+          stream.attributeObject("ops", [&] {
+            for (const auto &[name, opCost] : cost.opKinds)
+              stream.attributeObject(name, [&] { writeOpCost(opCost); });
+          });
+        });
+      }
+    });
+  });
+  os << "\n";
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,96 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_TRANSFORMS_COST_ANALYSIS_H
+#define STABLEHLO_TRANSFORMS_COST_ANALYSIS_H
+
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Types.h"
+
+namespace mlir {
+namespace stablehlo {
+
+// The estimated cost of evaluating operations.
+struct OpCost {
+  // Number of operations.
+  int64_t count = 0;
+  // Number of arithmetic operations on elements, e.g. 2 per multiply-add of
+  // dot_general and convolution, and 1 per element of elementwise ops.
+  int64_t flops = 0;
+  // Number of bytes of operands and results.
+  int64_t bytesRead = 0;
+  int64_t bytesWritten = 0;
+
+  OpCost &operator+=(const OpCost &other);
+};
+
+// The estimated cost of evaluating a function once.
+struct FunctionCost {
+  // The cost of all the operations of the function, including the operations
+  // nested in their regions and the functions they call.
+  OpCost total;
+  // The cost of every kind of operation, in order of first appearance.
+  llvm::MapVector<StringRef, OpCost> opKinds;
+  // The maximum number of bytes of tensors which are live at the same time
+  // in the body of the function, including its arguments.
+  int64_t peakLiveBytes = 0;
+  // Whether the cost is only a lower bound, because some tensors have
+  // unbounded dynamic dimensions, which are counted as empty, or the trip
+  // count of some while loops isn't known, which are counted once.
+  bool isApproximate = false;
+};
+
+// Estimates the cost of StableHLO programs from the shapes of their values,
+// e.g. for routing models to hardware before compiling them. Operations which
+// only move data, e.g. transpose or gather, cost no FLOPs, and the bodies of
+// reductions cost FLOPs for every element they combine.
+//
+// Costs are computed once per function and reused for every call.
+class CostAnalysis {
+ public:
+  explicit CostAnalysis(ModuleOp module);
+
+  // Returns the cost of `func`, which must be in the module of the analysis.
+  const FunctionCost &getFunctionCost(func::FuncOp func);
+
+  // Returns the size in bytes of values of type `type`, using bounds for
+  // bounded dynamic dimensions, or std::nullopt if it has unbounded ones.
+  static std::optional<int64_t> getSizeInBytes(Type type);
+
+ private:
+  void addOpCost(Operation *op, FunctionCost &cost);
+
+  SymbolTable symbolTable;
+  llvm::DenseMap<Operation *, FunctionCost> functionCosts;
+};
+
+// Prints the costs of all the functions of `module` to `os`, as text or as
+// JSON.
+void printCostAnalysis(ModuleOp module, llvm::raw_ostream &os, bool json);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_TRANSFORMS_COST_ANALYSIS_H
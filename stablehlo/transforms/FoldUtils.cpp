@@ -0,0 +1,120 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/transforms/FoldUtils.h"
+
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/BuiltinAttributeInterfaces.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/DialectResourceBlobManager.h"
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Returns the width in bits of the integer or floating-point storage of the
+// elements of `type`, and of each part of complex elements.
+std::optional<unsigned> getStorageBitWidth(ShapedType type) {
+  Type elementType = type.getElementType();
+  if (auto complexType = dyn_cast<ComplexType>(elementType))
+    elementType = complexType.getElementType();
+  if (elementType.isIndex()) return 64;
+  if (!elementType.isIntOrFloat()) return std::nullopt;
+  return elementType.getIntOrFloatBitWidth();
+}
+
+}  // namespace
+
+int64_t getConstantSizeInBytes(ShapedType type) {
+  auto bitWidth = getStorageBitWidth(type);
+  if (!bitWidth) return 0;
+  int64_t elementSize = llvm::divideCeil(*bitWidth, 8);
+  if (isa<ComplexType>(type.getElementType())) elementSize *= 2;
+  return type.getNumElements() * elementSize;
+}
+
+bool hasByteSizedElements(ShapedType type) {
+  auto bitWidth = getStorageBitWidth(type);
+  return bitWidth && *bitWidth % 8 == 0;
+}
+
+bool isLosslessFloatConversion(Type from, Type to) {
+  auto fromType = dyn_cast<FloatType>(from);
+  auto toType = dyn_cast<FloatType>(to);
+  if (!fromType || !toType) return false;
+  // Types of the same width, e.g. f16 and bf16, or f8E5M2 and f8E5M2FNUZ,
+  // differ in range or precision even if they have as many exponent bits.
+  int64_t fromExponentWidth =
+      fromType.getWidth() - fromType.getFPMantissaWidth();
+  int64_t toExponentWidth = toType.getWidth() - toType.getFPMantissaWidth();
+  return toType.getWidth() > fromType.getWidth() &&
+         toType.getFPMantissaWidth() >= fromType.getFPMantissaWidth() &&
+         toExponentWidth >= fromExponentWidth;
+}
+
+std::optional<RawElements> RawElements::get(ElementsAttr attr) {
+  auto type = attr.getShapedType();
+  if (!hasByteSizedElements(type)) return std::nullopt;
+  int64_t elementSize = getConstantSizeInBytes(type.clone({}));
+  if (auto denseAttr = dyn_cast<DenseIntOrFPElementsAttr>(attr))
+    return RawElements(denseAttr.getRawData(), elementSize,
+                       denseAttr.isSplat());
+  if (auto resourceAttr = dyn_cast<DenseResourceElementsAttr>(attr)) {
+    auto *blob = resourceAttr.getRawHandle().getBlob();
+    if (!blob) return std::nullopt;
+    return RawElements(blob->getData(), elementSize, /*isSplat=*/false);
+  }
+  return std::nullopt;
+}
+
+void RawElements::append(int64_t index, int64_t count,
+                         SmallVectorImpl<char> &result) const {
+  if (!isSplat_) {
+    auto data = data_.slice(index * elementSize_, count * elementSize_);
+    result.append(data.begin(), data.end());
+    return;
+  }
+  for (int64_t i = 0; i < count; ++i)
+    result.append(data_.begin(), data_.end());
+}
+
+ElementsAttr makeFoldedElementsAttr(ShapedType type, ArrayRef<char> data,
+                                    const FoldLimits &limits) {
+  // Splats are stored as their only element, like DenseElementsAttr::get does.
+  size_t elementSize = getConstantSizeInBytes(type.clone({}));
+  if (elementSize > 0 && data.size() > elementSize) {
+    auto first = data.take_front(elementSize);
+    bool isSplat = true;
+    for (size_t i = elementSize; isSplat && i < data.size(); i += elementSize)
+      isSplat = data.slice(i, elementSize) == first;
+    if (isSplat) return DenseElementsAttr::getFromRawBuffer(type, first);
+  }
+
+  if (static_cast<int64_t>(data.size()) <= limits.resourceByteThreshold)
+    return DenseElementsAttr::getFromRawBuffer(type, data);
+  return DenseResourceElementsAttr::get(
+      type, "folded",
+      HeapAsmResourceBlob::allocateAndCopyWithAlign(data, alignof(uint64_t)));
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
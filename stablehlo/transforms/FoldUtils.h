@@ -0,0 +1,99 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_TRANSFORMS_FOLD_UTILS_H
+#define STABLEHLO_TRANSFORMS_FOLD_UTILS_H
+
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/BuiltinAttributeInterfaces.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/Support/LLVM.h"
+
+namespace mlir {
+namespace stablehlo {
+
+// Limits on the constants which folding patterns materialize.
+struct FoldLimits {
+  // Maximum size in bytes of the constants materialized by folding an op.
+  int64_t foldOpByteLimit = 256 * 1024;
+  // Constants larger than this many bytes are materialized as
+  // DenseResourceElementsAttr blobs, which aren't hashed and uniqued in the
+  // context like DenseElementsAttr.
+  int64_t resourceByteThreshold = 64 * 1024;
+};
+
+// Returns the size in bytes of the elements of `type` as stored by constants,
+// which round the width of elements up to whole bytes.
+int64_t getConstantSizeInBytes(ShapedType type);
+
+// Returns whether constants store every element of `type` in whole bytes
+// without padding, so that they can be built from raw bytes. This excludes
+// e.g. i1 and i4.
+bool hasByteSizedElements(ShapedType type);
+
+// Returns whether converting floats of type `from` to type `to` is exact, so
+// that converting them back restores the original values, e.g. for bf16 to
+// f32.
+bool isLosslessFloatConversion(Type from, Type to);
+
+// Raw bytes of the elements of a constant in canonical order, which lets
+// folding patterns copy elements without converting them to attributes.
+class RawElements {
+ public:
+  // Returns the raw bytes of `attr` if it is a DenseElementsAttr or a
+  // DenseResourceElementsAttr whose blob is available, and if its elements
+  // are byte-sized.
+  static std::optional<RawElements> get(ElementsAttr attr);
+
+  // Returns whether the constant is a splat, whose data is its only element.
+  bool isSplat() const { return isSplat_; }
+
+  // Returns the raw bytes of the elements, or of the only element of splats.
+  ArrayRef<char> getData() const { return data_; }
+
+  // Returns the raw bytes of the element at flattened position `index`.
+  ArrayRef<char> operator[](int64_t index) const {
+    return data_.slice(isSplat_ ? 0 : index * elementSize_, elementSize_);
+  }
+
+  // Appends the raw bytes of `count` elements starting at flattened position
+  // `index` to `result`.
+  void append(int64_t index, int64_t count,
+              SmallVectorImpl<char> &result) const;
+
+ private:
+  RawElements(ArrayRef<char> data, int64_t elementSize, bool isSplat)
+      : data_(data), elementSize_(elementSize), isSplat_(isSplat) {}
+
+  ArrayRef<char> data_;
+  int64_t elementSize_;
+  bool isSplat_;
+};
+
+// Creates a constant value of `type`, whose elements must be byte-sized, from
+// the raw bytes `data` of its elements in canonical order. Values larger than
+// `limits.resourceByteThreshold` are DenseResourceElementsAttr blobs unless
+// they are splats, and others are DenseElementsAttr.
+ElementsAttr makeFoldedElementsAttr(ShapedType type, ArrayRef<char> data,
+                                    const FoldLimits &limits);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_TRANSFORMS_FOLD_UTILS_H
@@ -0,0 +1,171 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/transforms/MemoryPlanning.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Region.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "stablehlo/transforms/CostAnalysis.h"
+
+namespace mlir {
+namespace stablehlo {
+
+namespace {
+
+// Positions of operations in a pre-order walk of a function. The operations
+// nested in an op are numbered after it, up to its end position.
+struct OpPositions {
+  void number(Operation *op) {
+    int64_t position = next++;
+    for (Region &region : op->getRegions())
+      for (Block &block : region)
+        for (Operation &nestedOp : block) number(&nestedOp);
+    positions[op] = {position, next - 1};
+  }
+
+  llvm::DenseMap<Operation *, std::pair<int64_t, int64_t>> positions;
+  int64_t next = 0;
+};
+
+// Places `buffer` at the lowest offset of the smallest gap between `placed`
+// buffers which overlap it in time that fits it, or above all of them.
+int64_t findOffset(const BufferAssignment &buffer,
+                   ArrayRef<const BufferAssignment *> placed) {
+  SmallVector<const BufferAssignment *> overlapping;
+  for (const BufferAssignment *other : placed)
+    if (other->start <= buffer.end && buffer.start <= other->end)
+      overlapping.push_back(other);
+  llvm::sort(overlapping, [](auto *lhs, auto *rhs) {
+    return lhs->offset < rhs->offset;
+  });
+
+  int64_t bestOffset = -1;
+  int64_t bestGap = std::numeric_limits<int64_t>::max();
+  int64_t gapStart = 0;
+  for (const BufferAssignment *other : overlapping) {
+    int64_t gap = other->offset - gapStart;
+    if (gap >= buffer.size && gap < bestGap) {
+      bestOffset = gapStart;
+      bestGap = gap;
+    }
+    gapStart = std::max(gapStart, other->offset + other->size);
+  }
+  return bestOffset >= 0 ? bestOffset : gapStart;
+}
+
+}  // namespace
+
+FailureOr<MemoryPlan> planMemory(func::FuncOp func, int64_t alignment) {
+  MemoryPlan plan;
+  if (func.isExternal()) return plan;
+
+  OpPositions positions;
+  Block &body = func.getBody().front();
+  for (Operation &op : body) positions.number(&op);
+
+  // Values stay live until the op which holds their last use in the region
+  // they're defined in finishes, so that values used in loops stay live for
+  // all their iterations.
+  auto addBuffer = [&](Value value, int64_t start,
+                       int64_t end) -> LogicalResult {
+    auto size = CostAnalysis::getSizeInBytes(value.getType());
+    if (!size)
+      return emitError(value.getLoc())
+             << "can't plan memory for value of type " << value.getType()
+             << " with unbounded dynamic dimensions";
+    if (*size == 0) return success();
+
+    Region *region = value.getParentRegion();
+    for (Operation *user : value.getUsers()) {
+      Operation *ancestor = region->findAncestorOpInRegion(*user);
+      if (!ancestor) continue;
+      auto [userStart, userEnd] = positions.positions[ancestor];
+      end = std::max(end, ancestor == user ? userStart : userEnd);
+      if (isa<func::ReturnOp>(user) && user->getBlock() == &body)
+        end = positions.next;
+    }
+
+    plan.bufferIndices[value] = plan.buffers.size();
+    BufferAssignment buffer;
+    buffer.value = value;
+    buffer.size = llvm::alignTo(*size, alignment);
+    buffer.start = start;
+    buffer.end = end;
+    plan.buffers.push_back(buffer);
+    return success();
+  };
+
+  auto result = func.walk<WalkOrder::PreOrder>([&](Operation *op) {
+    auto [start, end] = positions.positions[op];
+    // Arguments of regions are live while the op which holds them runs.
+    for (Region &region : op->getRegions())
+      for (Block &block : region)
+        for (Value arg : block.getArguments())
+          if (op != func && failed(addBuffer(arg, start, end)))
+            return WalkResult::interrupt();
+    for (Value result : op->getResults())
+      if (failed(addBuffer(result, start, start)))
+        return WalkResult::interrupt();
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted()) return failure();
+
+  // The peak of the sizes of live buffers bounds the size of the arena.
+  SmallVector<std::pair<int64_t, int64_t>> events;
+  for (const BufferAssignment &buffer : plan.buffers) {
+    events.emplace_back(buffer.start, buffer.size);
+    events.emplace_back(buffer.end + 1, -buffer.size);
+  }
+  llvm::sort(events);
+  int64_t liveBytes = 0;
+  for (auto [position, delta] : events) {
+    liveBytes += delta;
+    plan.peakLiveBytes = std::max(plan.peakLiveBytes, liveBytes);
+  }
+
+  // Larger buffers are placed first, which packs intervals tightly in
+  // practice. Ties are placed in order of liveness.
+  SmallVector<size_t> order(plan.buffers.size());
+  std::iota(order.begin(), order.end(), 0);
+  llvm::stable_sort(order, [&](size_t lhs, size_t rhs) {
+    return plan.buffers[lhs].size > plan.buffers[rhs].size;
+  });
+  SmallVector<const BufferAssignment *> placed;
+  for (size_t i : order) {
+    BufferAssignment &buffer = plan.buffers[i];
+    buffer.offset = findOffset(buffer, placed);
+    plan.arenaSize = std::max(plan.arenaSize, buffer.offset + buffer.size);
+    placed.push_back(&buffer);
+  }
+  return plan;
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
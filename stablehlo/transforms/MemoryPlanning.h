@@ -0,0 +1,79 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_TRANSFORMS_MEMORY_PLANNING_H
+#define STABLEHLO_TRANSFORMS_MEMORY_PLANNING_H
+
+#include <cstdint>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LogicalResult.h"
+
+namespace mlir {
+namespace stablehlo {
+
+// The buffer of a value in the arena of a function.
+struct BufferAssignment {
+  Value value;
+  // Offset and size in bytes in the arena. Sizes are rounded up to the
+  // alignment of the plan.
+  int64_t offset = 0;
+  int64_t size = 0;
+  // The first and last positions, in a pre-order walk of the operations of
+  // the function, at which the value is live.
+  int64_t start = 0;
+  int64_t end = 0;
+};
+
+// Buffers for the tensors of a function in a single arena, such that buffers
+// of values which are live at the same time don't overlap.
+struct MemoryPlan {
+  // Buffers in order of definition of their values. Function arguments, which
+  // are owned by callers, and values of zero size, e.g. tokens, have none.
+  SmallVector<BufferAssignment> buffers;
+  llvm::DenseMap<Value, size_t> bufferIndices;
+  // The size of the arena in bytes.
+  int64_t arenaSize = 0;
+  // The maximum size of the buffers which are live at the same time, which
+  // is a lower bound of the size of the arena.
+  int64_t peakLiveBytes = 0;
+
+  // Returns the buffer of `value`, or nullptr if it has none.
+  const BufferAssignment *lookup(Value value) const {
+    auto it = bufferIndices.find(value);
+    return it == bufferIndices.end() ? nullptr : &buffers[it->second];
+  }
+};
+
+// Plans the memory of the tensors of `func`, whose sizes must be static or
+// bounded, with offsets aligned to `alignment` bytes.
+//
+// Values are live from their definition to their last use. Values used in a
+// nested region, e.g. the body of a `while` loop, stay live until the op
+// which holds the region finishes, and so do the arguments of the region.
+// Results of the function are live until it returns.
+//
+// Buffers are packed greedily, from the largest to the smallest, at the
+// lowest offset of the smallest gap between the buffers they overlap in time
+// that fits them.
+FailureOr<MemoryPlan> planMemory(func::FuncOp func, int64_t alignment = 64);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_TRANSFORMS_MEMORY_PLANNING_H
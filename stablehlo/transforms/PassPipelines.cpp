@@ -30,6 +30,11 @@ void createStablehloDeserializePipeline(OpPassManager &pm) {
 
 void createStablehloRemoveDynamismPipeline(OpPassManager &pm,
                                            TypeRange refinedTypes) {
+  // Refining arguments updates the signature of the main function, so it has
+  // to run on the module. Shape refinement runs on the module too, but only
+  // refines the main function, since the refined argument types only reach
+  // that function. Canonicalizing dynamism is nested so that functions are
+  // processed concurrently.
   pm.addPass(stablehlo::createStablehloRefineArgumentsPass(refinedTypes));
   pm.addPass(stablehlo::createStablehloRefineShapesPass());
   pm.addNestedPass<mlir::func::FuncOp>(
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef STABLEHLO_TRANSFORMS_PASSES_H
 #define STABLEHLO_TRANSFORMS_PASSES_H
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 
 #include "mlir/Dialect/Func/IR/FuncOps.h"
@@ -25,6 +27,8 @@ limitations under the License.
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/FoldUtils.h"
 
 namespace mlir {
 namespace stablehlo {
@@ -37,6 +41,12 @@ namespace stablehlo {
 void populateStablehloCanonicalizeDynamismPatterns(RewritePatternSet *patterns,
                                                    MLIRContext *context);
 
+// Populates the --stablehlo-canonicalize-dynamism patterns which rewrite ops
+// with bounded results into static ops padded to the bounds followed by
+// set_dimension_size.
+void populateStablehloCanonicalizeBoundedDynamismPatterns(
+    RewritePatternSet *patterns, MLIRContext *context);
+
 // Populates --stablehlo-refine-shapes patterns.
 void populateStablehloRefineShapesPatterns(RewritePatternSet *patterns,
                                            MLIRContext *context);
@@ -57,23 +67,68 @@ void populateVhloToVersionPatterns(RewritePatternSet *patterns,
                                    MLIRContext *contexts);
 
 /// Collection of rewrite patterns for lowering of CHLO ops to StableHLO and
-/// Shape ops.
+/// Shape ops. If `fastSpecialFunctions`, lgamma and digamma are decomposed
+/// with fewer ops, and if `topKBlockSize` is positive, top_k selects the top
+/// elements of blocks of that size first, see --chlo-legalize-to-stablehlo.
 void populateChloToStablehloPatterns(MLIRContext *context,
-                                     RewritePatternSet *patterns);
+                                     RewritePatternSet *patterns,
+                                     bool fastSpecialFunctions = false,
+                                     int64_t topKBlockSize = 0);
 
 /// Collection of folding patterns for StableHLO.
 void populateStablehloAggressiveFolderPatterns(RewritePatternSet *patterns,
                                                MLIRContext *context);
 
+/// Folding pattern for StableHLO which evaluates any pure op whose operands
+/// are constants with the reference interpreter, unless its results take
+/// more than `limits.foldOpByteLimit` bytes or it costs more than `costLimit`
+/// element operations.
+void populateStablehloInterpreterFolderPatterns(RewritePatternSet *patterns,
+                                                MLIRContext *context,
+                                                const FoldLimits &limits,
+                                                int64_t costLimit);
+
 /// A subset of folding patterns for StableHLO that is necessary for shape
 /// refinement.
 void populateStablehloShapeFolderPatterns(RewritePatternSet *patterns,
                                           MLIRContext *context);
 
-/// Collection of canonicalization patterns for StableHLO.
+/// Collection of canonicalization patterns for StableHLO. Patterns which fold
+/// ops into new constants respect `limits`.
 void populateStablehloCanonicalizationPatterns(MLIRContext *context,
                                                RewritePatternSet *patterns,
-                                               PatternBenefit benefit = 1);
+                                               PatternBenefit benefit = 1,
+                                               const FoldLimits &limits = {});
+
+/// Collection of patterns which hoist broadcasts past elementwise ops, sink
+/// transposes and reshapes below them, and reassociate chains of elementwise
+/// ops so that their broadcast operands are combined before broadcasting.
+void populateStablehloElementwiseReassociationPatterns(
+    RewritePatternSet *patterns, MLIRContext *context);
+
+/// Collection of patterns which hoist invariant ops out of while loops, forward
+/// and remove their invariant and dead loop-carried values, and fully unroll
+/// them if it creates at most `unrollOpLimit` ops.
+void populateStablehloOptimizeWhileLoopsPatterns(RewritePatternSet *patterns,
+                                                 MLIRContext *context,
+                                                 int64_t unrollOpLimit = 128);
+
+/// Collection of patterns which remove the unused results of case, if, while,
+/// reduce, reduce_window, scatter and sort ops.
+void populateStablehloRemoveDeadValuesPatterns(RewritePatternSet *patterns,
+                                               MLIRContext *context);
+
+/// Collection of patterns which compose transposes, sink them below
+/// elementwise, concatenate, pad and reduce ops, and fold them into
+/// broadcast_in_dim, convolution and dot_general ops.
+void populateStablehloTransposePropagationPatterns(RewritePatternSet *patterns,
+                                                   MLIRContext *context);
+
+/// Collection of patterns which compose slices and dynamic slices with
+/// constant indices, and fold slices of concatenate and pad ops and
+/// concatenations of adjacent slices.
+void populateStablehloSimplifySlicesPatterns(RewritePatternSet *patterns,
+                                             MLIRContext *context);
 
 /// Collection of patterns to upgrade deprecated ops to long-term supported ops.
 void populateStablehloLegalizeDeprecatedOpsPatterns(
@@ -83,11 +138,32 @@ void populateStablehloLegalizeDeprecatedOpsPatterns(
 void populateShapeToStablehloPatterns(MLIRContext *context,
                                       RewritePatternSet *patterns);
 
+/// How --stablehlo-inline-composites legalizes a composite.
+enum class CompositeLegalization {
+  /// Keeps the composite, e.g. for a backend which has a fused kernel for it
+  /// or for --stablehlo-legalize-composite-to-call.
+  kKeep,
+  /// Replaces the composite with a call to its decomposition.
+  kCall,
+  /// Replaces the composite with a copy of the body of its decomposition.
+  /// Decompositions with multiple blocks are called instead.
+  kInline,
+};
+
+/// Decides how to legalize a composite given its decomposition.
+using CompositeCostModel = std::function<CompositeLegalization(
+    CompositeOp op, func::FuncOp decomposition)>;
+
 //// Additional pass constructors ////
 
 std::unique_ptr<OperationPass<ModuleOp>> createStablehloRefineArgumentsPass(
     TypeRange refinedTypes);
 
+/// Creates --stablehlo-inline-composites which legalizes every composite as
+/// decided by `costModel` rather than by the options of the pass.
+std::unique_ptr<OperationPass<ModuleOp>> createStablehloInlineCompositesPass(
+    CompositeCostModel costModel);
+
 //// Pass pipelines ////
 
 // StableHLO consumers can add this pipeline to convert portable artifacts to
@@ -111,9 +187,20 @@ void createStablehloDeserializePipeline(OpPassManager &pm);
 //   2. Refining shape information of operations within functions.
 //   3. Replaces dynamic StableHLO ops with the corresponding static
 //   counterparts if applicable.
+//
+// To specialize a module to many input signatures, e.g. to serve a
+// shape-polymorphic model, see `ShapeSpecializationCache`.
 void createStablehloRemoveDynamismPipeline(OpPassManager &pm,
                                            TypeRange refinedTypes);
 
+// Replaces the main function of `module` with a dispatcher to specializations
+// of it for every size in `bucketSizes` of dimension `dimension` of its
+// arguments, refined with `createStablehloRemoveDynamismPipeline`. See
+// --stablehlo-bucket-shapes.
+LogicalResult specializeToShapeBuckets(ModuleOp module,
+                                       ArrayRef<int64_t> bucketSizes,
+                                       int64_t dimension);
+
 // Adds `stablehlo-deserialize` pipeline as a registered pass pipeline
 // for opt tools.
 void registerPassPipelines();
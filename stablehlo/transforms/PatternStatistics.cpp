@@ -0,0 +1,107 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/transforms/PatternStatistics.h"
+
+#include <chrono>
+#include <cstdint>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Rewrite/FrozenRewritePatternSet.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+namespace mlir {
+namespace stablehlo {
+
+void PatternStatistics::notifyPatternBegin(const Pattern &pattern,
+                                           Operation *op) {
+  patternStart = std::chrono::steady_clock::now();
+}
+
+void PatternStatistics::notifyPatternEnd(const Pattern &pattern,
+                                         LogicalResult status) {
+  StringRef name = pattern.getDebugName();
+  if (name.empty()) name = "<unnamed pattern>";
+  auto &entry = patterns[name];
+  entry.time += std::chrono::steady_clock::now() - patternStart;
+  ++(succeeded(status) ? entry.numApplications : entry.numFailures);
+}
+
+int64_t PatternStatistics::getNumApplications() const {
+  int64_t result = 0;
+  for (auto &[name, entry] : patterns) result += entry.numApplications;
+  return result;
+}
+
+int64_t PatternStatistics::getNumFailures() const {
+  int64_t result = 0;
+  for (auto &[name, entry] : patterns) result += entry.numFailures;
+  return result;
+}
+
+void PatternStatistics::emitRemark(Operation *op) const {
+  InFlightDiagnostic diag = op->emitRemark();
+  diag << "pattern statistics: " << numIterations << " iterations, "
+       << getNumApplications() << " applications, " << getNumFailures()
+       << " failures";
+  auto entries = llvm::to_vector(patterns);
+  llvm::stable_sort(entries, [](const auto &lhs, const auto &rhs) {
+    return lhs.second.time > rhs.second.time;
+  });
+  for (auto &[name, entry] : entries) {
+    // Patterns are named after their classes, e.g.
+    // `mlir::stablehlo::(anonymous namespace)::AddOpCanon`.
+    StringRef shortName = name.rsplit("::").second;
+    if (shortName.empty()) shortName = name;
+    double milliseconds =
+        std::chrono::duration<double, std::milli>(entry.time).count();
+    diag.attachNote() << shortName << ": " << entry.numApplications
+                      << " applications, "
+                      << entry.numFailures << " failures, "
+                      << llvm::formatv("{0:F3}", milliseconds).str() << " ms";
+  }
+}
+
+LogicalResult applyPatternsGreedilyWithStatistics(
+    Operation *op, const FrozenRewritePatternSet &patterns,
+    GreedyRewriteConfig config, PatternStatistics &statistics) {
+  // Every iteration of the driver starts over from a worklist of all ops, so
+  // running one iteration per call is equivalent to running all of them in
+  // one call.
+  int64_t maxIterations = config.maxIterations;
+  config.maxIterations = 1;
+  config.listener = &statistics;
+  bool changed = true;
+  while (changed) {
+    if (maxIterations != GreedyRewriteConfig::kNoLimit &&
+        statistics.numIterations >= maxIterations)
+      return failure();
+    ++statistics.numIterations;
+    // Fails whenever the iteration changed anything, since it never gets to
+    // check that another iteration wouldn't.
+    (void)applyPatternsAndFoldGreedily(op, patterns, config, &changed);
+  }
+  return success();
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,78 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_TRANSFORMS_PATTERN_STATISTICS_H
+#define STABLEHLO_TRANSFORMS_PATTERN_STATISTICS_H
+
+#include <chrono>
+#include <cstdint>
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Rewrite/FrozenRewritePatternSet.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+namespace mlir {
+namespace stablehlo {
+
+// Records how often every pattern applied by the greedy pattern rewrite driver
+// succeeds and fails and how long it takes, and how many iterations the driver
+// needs to converge, so that passes can report where their time goes.
+class PatternStatistics : public RewriterBase::Listener {
+ public:
+  void notifyPatternBegin(const Pattern &pattern, Operation *op) override;
+  void notifyPatternEnd(const Pattern &pattern, LogicalResult status) override;
+
+  int64_t getNumIterations() const { return numIterations; }
+  int64_t getNumApplications() const;
+  int64_t getNumFailures() const;
+
+  // Emits a remark on `op` with the totals, and a note for every pattern
+  // which was attempted, slowest first.
+  void emitRemark(Operation *op) const;
+
+ private:
+  friend LogicalResult applyPatternsGreedilyWithStatistics(
+      Operation *op, const FrozenRewritePatternSet &patterns,
+      GreedyRewriteConfig config, PatternStatistics &statistics);
+
+  struct PatternEntry {
+    int64_t numApplications = 0;
+    int64_t numFailures = 0;
+    std::chrono::steady_clock::duration time{};
+  };
+
+  // Keyed by the debug names of patterns, which are the names of their
+  // classes unless set otherwise.
+  llvm::MapVector<StringRef, PatternEntry> patterns;
+  std::chrono::steady_clock::time_point patternStart;
+  int64_t numIterations = 0;
+};
+
+// Like `applyPatternsAndFoldGreedily`, but runs the iterations of the driver
+// one at a time to count them in `statistics`, which is also the listener of
+// the driver. Fails if the driver doesn't converge within
+// `config.maxIterations` iterations.
+LogicalResult applyPatternsGreedilyWithStatistics(
+    Operation *op, const FrozenRewritePatternSet &patterns,
+    GreedyRewriteConfig config, PatternStatistics &statistics);
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_TRANSFORMS_PATTERN_STATISTICS_H
@@ -18,6 +18,8 @@ limitations under the License.
 #include <memory>
 #include <utility>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
@@ -33,10 +35,12 @@ limitations under the License.
 #include "mlir/IR/Location.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Operation.h"
+#include "mlir/IR/OperationSupport.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/TypeUtilities.h"
 #include "mlir/IR/Value.h"
 #include "mlir/IR/ValueRange.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
@@ -518,6 +522,98 @@ struct CastOperandsPattern : public OpRewritePattern<OpType> {
   }
 };
 
+// Hashes and compares ops by their name, attributes, operands and result
+// types, like CSE does.
+struct ShapeComputationInfo : public llvm::DenseMapInfo<Operation*> {
+  static unsigned getHashValue(const Operation* op) {
+    return OperationEquivalence::computeHash(
+        const_cast<Operation*>(op), OperationEquivalence::directHashValue,
+        OperationEquivalence::ignoreHashValue,
+        OperationEquivalence::IgnoreLocations);
+  }
+  static bool isEqual(const Operation* lhs, const Operation* rhs) {
+    if (lhs == rhs) return true;
+    if (lhs == getTombstoneKey() || rhs == getTombstoneKey() ||
+        lhs == getEmptyKey() || rhs == getEmptyKey())
+      return false;
+    return OperationEquivalence::isEquivalentTo(
+        const_cast<Operation*>(lhs), const_cast<Operation*>(rhs),
+        OperationEquivalence::IgnoreLocations);
+  }
+};
+
+// Shape computations are side-effect free StableHLO ops without regions
+// which produce a single statically-shaped integer tensor of rank 0 or 1,
+// i.e. a size or a shape.
+bool isShapeComputation(Operation* op) {
+  if (!isa<StablehloDialect>(op->getDialect()) || op->getNumRegions() != 0 ||
+      op->getNumResults() != 1 || !isMemoryEffectFree(op))
+    return false;
+  auto type = dyn_cast<RankedTensorType>(op->getResult(0).getType());
+  return type && type.getRank() <= 1 && type.hasStaticShape() &&
+         isa<IntegerType>(type.getElementType());
+}
+
+// Elementwise ops have the shape of their operands, so the sizes of their
+// results are the sizes of their operands. Following them back lets sizes
+// of values computed from the same arguments be shared.
+Value getShapeSource(Value value) {
+  while (auto* op = value.getDefiningOp()) {
+    if (!op->hasTrait<OpTrait::Elementwise>()) break;
+    auto type = dyn_cast<RankedTensorType>(value.getType());
+    auto operand = llvm::find_if(op->getOperands(), [&](Value operand) {
+      auto operandType = dyn_cast<RankedTensorType>(operand.getType());
+      return type && operandType && operandType.getRank() == type.getRank();
+    });
+    if (operand == op->getOperands().end()) break;
+    value = *operand;
+  }
+  return value;
+}
+
+// Moves the shape computations of `func` which only depend on the sizes of
+// its arguments to the start of its body, and deduplicates them, so that
+// every distinct size or shape is computed once however many ops use it.
+void hoistShapeComputations(func::FuncOp func) {
+  Block& entry = func.getBody().front();
+  SmallVector<Operation*> ops;
+  func.walk<WalkOrder::PreOrder>([&](Operation* op) {
+    if (isShapeComputation(op)) ops.push_back(op);
+  });
+
+  DenseMap<Operation*, Operation*, ShapeComputationInfo> hoistedOps;
+  DenseSet<Value> hoistedValues;
+  Operation* insertionPoint = nullptr;
+  for (Operation* op : ops) {
+    if (auto getDimensionSize = dyn_cast<GetDimensionSizeOp>(op)) {
+      Value source = getShapeSource(getDimensionSize.getOperand());
+      auto arg = dyn_cast<BlockArgument>(source);
+      if (!arg || arg.getOwner() != &entry) continue;
+      getDimensionSize.getOperandMutable().assign(arg);
+    } else if (!llvm::all_of(op->getOperands(), [&](Value operand) {
+                 return hoistedValues.contains(operand);
+               })) {
+      continue;
+    }
+
+    // The operands of `op` are hoisted already and have been deduplicated,
+    // so equivalent ops compute the same value.
+    auto it = hoistedOps.find(op);
+    if (it != hoistedOps.end()) {
+      op->getResult(0).replaceAllUsesWith(it->second->getResult(0));
+      op->erase();
+      continue;
+    }
+    if (insertionPoint)
+      op->moveAfter(insertionPoint);
+    else
+      op->moveBefore(&entry, entry.begin());
+    insertionPoint = op;
+    hoistedOps[op] = op;
+    hoistedValues.insert(op->getResult(0));
+  }
+}
+
 struct ShapeLegalizeToStablehloPass
     : public impl::ShapeLegalizeToStablehloPassBase<
           ShapeLegalizeToStablehloPass> {
@@ -578,6 +674,7 @@ struct ShapeLegalizeToStablehloPass
   void runOnOperation() override {
     if (failed(applyPartialConversion(getOperation(), *target, patterns)))
       return signalPassFailure();
+    if (hoistShapeComputationsOption) hoistShapeComputations(getOperation());
   }
 
  private:
@@ -0,0 +1,48 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "stablehlo/transforms/SpecializationCache.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/IR/TypeRange.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/LogicalResult.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+ShapeSpecializationCache::ShapeSpecializationCache(ModuleOp module,
+                                                   size_t capacity)
+    : SpecializationCache(
+          module.getContext(), capacity,
+          [module](TypeRange refinedTypes) -> FailureOr<ShapeSpecialization> {
+            OwningOpRef<ModuleOp> specialization = module.clone();
+            PassManager pm(module.getContext());
+            createStablehloRemoveDynamismPipeline(pm, refinedTypes);
+            if (failed(pm.run(*specialization)))
+              return module.emitError()
+                     << "failed to specialize the module to " << refinedTypes;
+            return std::make_shared<const OwningOpRef<ModuleOp>>(
+                std::move(specialization));
+          }) {}
+
+}  // namespace stablehlo
+}  // namespace mlir
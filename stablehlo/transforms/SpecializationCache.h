@@ -0,0 +1,187 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef STABLEHLO_TRANSFORMS_SPECIALIZATION_CACHE_H
+#define STABLEHLO_TRANSFORMS_SPECIALIZATION_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "llvm/ADT/DenseMap.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/IR/TypeRange.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+
+namespace mlir {
+namespace stablehlo {
+
+// Counters of the requests to a `SpecializationCache`, e.g. to monitor whether
+// its capacity covers the shape buckets of a model.
+struct SpecializationStatistics {
+  int64_t numHits = 0;
+  int64_t numMisses = 0;
+  int64_t numEvictions = 0;
+};
+
+// Caches values specialized to static argument types, e.g. copies of a
+// shape-polymorphic module refined to these types, so that the potentially
+// expensive specialization runs only once per input signature.
+//
+// Specializations are keyed by their refined types and evicted in least
+// recently used order once there are more than `capacity` of them. Evicted
+// specializations stay alive as long as they are referenced by the callers
+// which requested them.
+//
+// The cache is thread-safe. Concurrent requests for different types
+// specialize concurrently, and concurrent requests for the same types
+// specialize only once.
+template <typename T>
+class SpecializationCache {
+ public:
+  // Specializes to the given refined types. Returns failure and emits an
+  // error if they can't be specialized to.
+  using Specializer =
+      std::function<FailureOr<std::shared_ptr<const T>>(TypeRange)>;
+
+  // A `capacity` of 0 means that specializations are never evicted.
+  SpecializationCache(MLIRContext *context, size_t capacity,
+                      Specializer specialize)
+      : context_(context),
+        capacity_(capacity),
+        specialize_(std::move(specialize)) {}
+
+  // Returns the specialization to `refinedTypes`, specializing on the first
+  // request for these types. Returns failure if specializing fails, in which
+  // case nothing is cached and the next request for these types tries again.
+  FailureOr<std::shared_ptr<const T>> get(TypeRange refinedTypes) {
+    auto signature = FunctionType::get(context_, refinedTypes, /*results=*/{});
+
+    std::shared_ptr<Entry> entry;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = index_.find(signature);
+      if (it != index_.end()) {
+        ++statistics_.numHits;
+        entry = *it->second;
+        entries_.splice(entries_.begin(), entries_, it->second);
+      } else {
+        ++statistics_.numMisses;
+        entry = std::make_shared<Entry>();
+        entry->signature = signature;
+        entries_.push_front(entry);
+        index_[signature] = entries_.begin();
+        evict();
+      }
+    }
+
+    // Specializes outside of the lock of the cache, so that requests for
+    // other types don't wait for it.
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (entry->specialization) return entry->specialization;
+
+    auto specialization = specialize_(refinedTypes);
+    if (failed(specialization)) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = index_.find(signature);
+      if (it != index_.end() && *it->second == entry) {
+        entries_.erase(it->second);
+        index_.erase(it);
+      }
+      return failure();
+    }
+    entry->specialization = std::move(*specialization);
+    return entry->specialization;
+  }
+
+  using Statistics = SpecializationStatistics;
+  Statistics getStatistics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return statistics_;
+  }
+
+  // Evicts all specializations.
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_.numEvictions += entries_.size();
+    entries_.clear();
+    index_.clear();
+  }
+
+ private:
+  struct Entry {
+    FunctionType signature;
+    // Guards `specialization`, so that only one request specializes.
+    std::mutex mutex;
+    // The specialization, or nullptr until it's specialized.
+    std::shared_ptr<const T> specialization;
+  };
+  using EntryList = std::list<std::shared_ptr<Entry>>;
+
+  // Evicts the least recently used specializations beyond the capacity.
+  void evict() {
+    if (capacity_ == 0) return;
+    while (entries_.size() > capacity_) {
+      index_.erase(entries_.back()->signature);
+      entries_.pop_back();
+      ++statistics_.numEvictions;
+    }
+  }
+
+  MLIRContext *context_;
+  size_t capacity_;
+  Specializer specialize_;
+
+  // Guards all the members below.
+  mutable std::mutex mutex_;
+  // Entries in most recently used order.
+  EntryList entries_;
+  // Entries by the function type whose inputs are their refined types.
+  llvm::DenseMap<FunctionType, typename EntryList::iterator> index_;
+  Statistics statistics_;
+};
+
+// A module specialized to static argument types. Specializations are shared
+// by all the requests for the same types and must not be modified.
+using ShapeSpecialization = std::shared_ptr<const OwningOpRef<ModuleOp>>;
+
+// Caches copies of a shape-polymorphic module specialized to static argument
+// types with `createStablehloRemoveDynamismPipeline`, so that serving a model
+// runs the pipeline only once per shape bucket rather than once per request,
+// see `SpecializationCache`. Specializations only copy the ops of the module:
+// its attributes, including the contents of its constants, are uniqued in the
+// context and shared by all specializations.
+class ShapeSpecializationCache
+    : public SpecializationCache<OwningOpRef<ModuleOp>> {
+ public:
+  // `module` must outlive the cache and must not be modified while it's
+  // alive. A `capacity` of 0 means that specializations are never evicted.
+  // `get` returns the copy of the module whose main function is refined to
+  // the requested types.
+  ShapeSpecializationCache(ModuleOp module, size_t capacity);
+};
+
+}  // namespace stablehlo
+}  // namespace mlir
+
+#endif  // STABLEHLO_TRANSFORMS_SPECIALIZATION_CACHE_H
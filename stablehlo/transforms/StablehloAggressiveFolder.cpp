@@ -12,13 +12,16 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <cstdint>
+#include <optional>
 #include <utility>
 
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -27,26 +30,38 @@ limitations under the License.
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/Tensor/IR/Tensor.h"
 #include "mlir/Dialect/Utils/IndexingUtils.h"
+#include "mlir/IR/AsmState.h"
 #include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/Builders.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/IRMapping.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Matchers.h"
 #include "mlir/IR/OpDefinition.h"
 #include "mlir/IR/Operation.h"
+#include "mlir/IR/OwningOpRef.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/Types.h"
 #include "mlir/IR/Value.h"
 #include "mlir/IR/ValueRange.h"
 #include "mlir/Interfaces/InferTypeOpInterface.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "mlir/Transforms/RegionUtils.h"
 #include "stablehlo/dialect/Base.h"
 #include "stablehlo/dialect/ChloOps.h"
 #include "stablehlo/dialect/StablehloOps.h"
 #include "stablehlo/dialect/TypeInference.h"
+#include "stablehlo/reference/Ops.h"
+#include "stablehlo/reference/Tensor.h"
+#include "stablehlo/reference/Types.h"
+#include "stablehlo/reference/Value.h"
+#include "stablehlo/transforms/FoldUtils.h"
 #include "stablehlo/transforms/Passes.h"
+#include "stablehlo/transforms/PatternStatistics.h"
 
 namespace mlir {
 namespace stablehlo {
@@ -518,6 +533,162 @@ struct EvalIotaOpPattern : public OpRewritePattern<IotaOp> {
   }
 };
 
+// Returns a rough estimate of the number of element operations which
+// evaluating `op` takes.
+double estimateEvalCost(Operation* op) {
+  double cost = 0;
+  for (auto type : op->getOperandTypes())
+    cost += cast<ShapedType>(type).getNumElements();
+  for (auto type : op->getResultTypes())
+    cost += cast<ShapedType>(type).getNumElements();
+
+  if (auto dotGeneralOp = dyn_cast<DotGeneralOp>(op)) {
+    auto lhsType = dotGeneralOp.getLhs().getType();
+    double contractingSize = 1;
+    for (auto dim : dotGeneralOp.getDotDimensionNumbers()
+                        .getLhsContractingDimensions())
+      contractingSize *= lhsType.getDimSize(dim);
+    cost += dotGeneralOp.getType().getNumElements() * contractingSize;
+  } else if (auto convolutionOp = dyn_cast<ConvolutionOp>(op)) {
+    auto rhsType = convolutionOp.getRhs().getType();
+    auto outputFeatures = rhsType.getDimSize(
+        convolutionOp.getDimensionNumbers().getKernelOutputFeatureDimension());
+    cost += convolutionOp.getType().getNumElements() *
+            (rhsType.getNumElements() / std::max<int64_t>(outputFeatures, 1));
+  }
+
+  // Ops with regions may evaluate them once for every element.
+  int64_t numNestedOps = 0;
+  for (Region& region : op->getRegions())
+    region.walk([&](Operation*) { ++numNestedOps; });
+  return cost * (1 + numNestedOps);
+}
+
+bool isFoldableElementType(Type type) {
+  auto elementType = getElementTypeOrSelf(type);
+  return isSupportedIntegerType(elementType) ||
+         isSupportedBooleanType(elementType) ||
+         isSupportedFloatType(elementType) ||
+         isSupportedComplexType(elementType);
+}
+
+// Folds any pure op whose operands are constants by evaluating it with the
+// reference interpreter, which implements every op, rather than with a
+// pattern of its own. The op is cloned into a function of its own, whose
+// arguments are tensors which share the storage of the constants.
+struct EvalOpWithInterpreterPattern : public RewritePattern {
+  EvalOpWithInterpreterPattern(MLIRContext* context, const FoldLimits& limits,
+                               int64_t costLimit)
+      // Ops which other patterns fold are left to them.
+      : RewritePattern(MatchAnyOpTypeTag(), /*benefit=*/0, context),
+        limits(limits),
+        costLimit(costLimit) {}
+
+  LogicalResult matchAndRewrite(Operation* op,
+                                PatternRewriter& rewriter) const override {
+    if (!isa_and_nonnull<StablehloDialect>(op->getDialect()) ||
+        isa<ConstantOp>(op) || op->getNumResults() == 0)
+      return failure();
+
+    // Ops which depend on the process which evaluates them or which are
+    // random aren't folded, and neither are integer divisions, which abort
+    // the interpreter on division by zero.
+    if (isa<ReplicaIdOp, PartitionIdOp, RngOp, RngBitGeneratorOp>(op))
+      return rewriter.notifyMatchFailure(op, "unsupported op");
+    if (isa<DivOp, RemOp>(op) &&
+        isa<IntegerType>(getElementTypeOrSelf(op->getResult(0))))
+      return rewriter.notifyMatchFailure(op, "integer division");
+    if (!isMemoryEffectFree(op) || !isInterpretable(*op))
+      return rewriter.notifyMatchFailure(op, "expected pure interpretable op");
+
+    auto isStaticTensor = [](Type type) {
+      auto rankedType = dyn_cast<RankedTensorType>(type);
+      return rankedType && rankedType.hasStaticShape() &&
+             isFoldableElementType(rankedType);
+    };
+    if (!llvm::all_of(op->getOperandTypes(), isStaticTensor) ||
+        !llvm::all_of(op->getResultTypes(), isStaticTensor))
+      return rewriter.notifyMatchFailure(op, "expected static tensor types");
+
+    int64_t resultSize = 0;
+    for (auto type : op->getResultTypes())
+      resultSize += getConstantSizeInBytes(cast<ShapedType>(type));
+    if (resultSize > limits.foldOpByteLimit)
+      return rewriter.notifyMatchFailure(op, "results too large to fold");
+    if (estimateEvalCost(op) > static_cast<double>(costLimit))
+      return rewriter.notifyMatchFailure(op, "too expensive to fold");
+
+    // The op is evaluated in a function of its own, so its regions must not
+    // use values defined outside of the op nor call functions. Loops, which
+    // may not terminate, aren't folded either.
+    llvm::SetVector<Value> usedValuesAbove;
+    getUsedValuesDefinedAbove(op->getRegions(), usedValuesAbove);
+    bool hasCallsOrLoops = op->walk([](Operation* nestedOp) {
+                               return isa<func::CallOp, WhileOp>(nestedOp)
+                                          ? WalkResult::interrupt()
+                                          : WalkResult::advance();
+                             }).wasInterrupted();
+    if (!usedValuesAbove.empty() || hasCallsOrLoops)
+      return rewriter.notifyMatchFailure(op, "expected isolated regions");
+
+    SmallVector<InterpreterValue> args;
+    for (auto operand : op->getOperands()) {
+      auto arg = makeConstantTensor(operand);
+      if (!arg)
+        return rewriter.notifyMatchFailure(op, "expected constant operands");
+      args.emplace_back(*arg);
+    }
+
+    OpBuilder builder(op->getContext());
+    auto funcType = builder.getFunctionType(op->getOperandTypes(),
+                                            op->getResultTypes());
+    OwningOpRef<func::FuncOp> funcOp =
+        builder.create<func::FuncOp>(op->getLoc(), "fold", funcType);
+    Block* block = funcOp->addEntryBlock();
+    builder.setInsertionPointToStart(block);
+    IRMapping mapping;
+    mapping.map(op->getOperands(), block->getArguments());
+    Operation* clone = builder.clone(*op, mapping);
+    builder.create<func::ReturnOp>(op->getLoc(), clone->getResults());
+
+    SmallVector<Value> results;
+    for (auto [result, value] :
+         llvm::zip(op->getResults(), eval(funcOp->getBody(), args))) {
+      auto tensor = value.getTensor();
+      ElementsAttr attr;
+      if (hasByteSizedElements(tensor.getType()))
+        attr = makeFoldedElementsAttr(tensor.getType(),
+                                      tensor.getData<char>(), limits);
+      else
+        attr = makeDenseElementsAttr(tensor);
+      results.push_back(
+          rewriter.create<ConstantOp>(op->getLoc(), attr).getResult());
+    }
+    rewriter.replaceOp(op, results);
+    return success();
+  }
+
+ private:
+  // Returns a tensor which shares the storage of the constant `value`, which
+  // may be a resource blob folded before, if it is a constant.
+  static std::optional<Tensor> makeConstantTensor(Value value) {
+    ElementsAttr attr;
+    if (!matchPattern(value, m_Constant(&attr))) return std::nullopt;
+    if (auto denseAttr = dyn_cast<DenseElementsAttr>(attr))
+      return makeTensorView(denseAttr);
+    auto rawElements = RawElements::get(attr);
+    if (!rawElements || rawElements->isSplat()) return std::nullopt;
+    // Blobs live as long as the context, which outlives the tensor.
+    return Tensor(attr.getShapedType(),
+                  UnmanagedAsmResourceBlob::allocateWithAlign(
+                      rawElements->getData(), alignof(uint64_t),
+                      /*deleter=*/{}, /*dataIsMutable=*/false));
+  }
+
+  FoldLimits limits;
+  int64_t costLimit;
+};
+
 struct StablehloAggressiveFolderPass
     : public impl::StablehloAggressiveFolderPassBase<
           StablehloAggressiveFolderPass> {
@@ -526,14 +697,26 @@ struct StablehloAggressiveFolderPass
   LogicalResult initialize(MLIRContext* context) override {
     RewritePatternSet patterns_(context);
     populateStablehloAggressiveFolderPatterns(&patterns_, context);
+    if (foldWithInterpreter)
+      populateStablehloInterpreterFolderPatterns(
+          &patterns_, context, {foldOpByteLimit, resourceByteThreshold},
+          foldOpCostLimit);
     patterns = std::move(patterns_);
 
     return success();
   }
 
   void runOnOperation() override {
-    if (failed(applyPatternsAndFoldGreedily(getOperation(), patterns)))
-      signalPassFailure();
+    GreedyRewriteConfig config;
+    config.maxIterations = maxIterations;
+    PatternStatistics statistics;
+    LogicalResult result = applyPatternsGreedilyWithStatistics(
+        getOperation(), patterns, config, statistics);
+    numIterations += statistics.getNumIterations();
+    numPatternApplications += statistics.getNumApplications();
+    numPatternFailures += statistics.getNumFailures();
+    if (reportPatternStatistics) statistics.emitRemark(getOperation());
+    if (failed(result)) signalPassFailure();
   }
 
  private:
@@ -548,6 +731,13 @@ void populateStablehloAggressiveFolderPatterns(RewritePatternSet* patterns,
   patterns->add<EvalIotaOpPattern>(context);
 }
 
+void populateStablehloInterpreterFolderPatterns(RewritePatternSet* patterns,
+                                                MLIRContext* context,
+                                                const FoldLimits& limits,
+                                                int64_t costLimit) {
+  patterns->add<EvalOpWithInterpreterPattern>(context, limits, costLimit);
+}
+
 void populateStablehloShapeFolderPatterns(RewritePatternSet* patterns,
                                           MLIRContext* context) {
   patterns->add<EvalAddOpPattern>(context);
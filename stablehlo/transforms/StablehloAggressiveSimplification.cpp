@@ -28,7 +28,9 @@
 #include "mlir/Interfaces/FunctionInterfaces.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/FoldUtils.h"
 #include "stablehlo/transforms/Passes.h"
+#include "stablehlo/transforms/PatternStatistics.h"
 
 using llvm::SmallBitVector;
 
@@ -39,10 +41,6 @@ namespace stablehlo {
 #include "stablehlo/transforms/Passes.h.inc"
 
 namespace {
-// This is an upper limit on how many elements canonicalization patterns are
-// allowed to materialize as new constants.
-constexpr int64_t kFoldOpEltLimit = 65536;
-
 static bool isIotaRange(ArrayRef<int64_t> dims) {
   return llvm::all_of(llvm::enumerate(dims), [](const auto &it) {
     return static_cast<int64_t>(it.index()) == it.value();
@@ -345,7 +343,9 @@ struct CompareOpCanon final : OpRewritePattern<mlir::stablehlo::CompareOp> {
 };
 
 struct SelectOpCanon final : OpRewritePattern<mlir::stablehlo::SelectOp> {
-  using OpRewritePattern::OpRewritePattern;
+  SelectOpCanon(MLIRContext *context, const FoldLimits &limits,
+                PatternBenefit benefit)
+      : OpRewritePattern(context, benefit), limits(limits) {}
 
   LogicalResult matchAndRewrite(mlir::stablehlo::SelectOp op,
                                 PatternRewriter &rewriter) const override {
@@ -373,7 +373,9 @@ struct SelectOpCanon final : OpRewritePattern<mlir::stablehlo::SelectOp> {
 
     // Handle elementwise selection when both outcomes are also constants. This
     // will create a new, likely non-splat constant.
-    if (cond.getNumElements() > kFoldOpEltLimit) return failure();
+    if (!type.hasStaticShape() ||
+        getConstantSizeInBytes(type) > limits.foldOpByteLimit)
+      return failure();
 
     ElementsAttr trueAttr;
     if (!matchPattern(trueVal, m_Constant(&trueAttr))) return failure();
@@ -381,6 +383,22 @@ struct SelectOpCanon final : OpRewritePattern<mlir::stablehlo::SelectOp> {
     ElementsAttr falseAttr;
     if (!matchPattern(falseVal, m_Constant(&falseAttr))) return failure();
 
+    // Copy raw bytes where possible, so that large results can be emitted as
+    // resource blobs without going through attributes.
+    auto trueElems = RawElements::get(trueAttr);
+    auto falseElems = RawElements::get(falseAttr);
+    if (trueElems && falseElems) {
+      SmallVector<char> data;
+      data.reserve(getConstantSizeInBytes(type));
+      for (auto [i, condElem] : llvm::enumerate(cond.getValues<bool>())) {
+        auto elem = condElem ? (*trueElems)[i] : (*falseElems)[i];
+        data.append(elem.begin(), elem.end());
+      }
+      rewriter.replaceOpWithNewOp<mlir::stablehlo::ConstantOp>(
+          op, makeFoldedElementsAttr(type, data, limits));
+      return success();
+    }
+
     SmallVector<Attribute> newValues;
     newValues.reserve(cond.getNumElements());
     for (auto [condElem, trueElem, falseElem] : llvm::zip_equal(
@@ -393,6 +411,9 @@ struct SelectOpCanon final : OpRewritePattern<mlir::stablehlo::SelectOp> {
         op, DenseElementsAttr::get(type, newValues));
     return success();
   }
+
+ private:
+  FoldLimits limits;
 };
 
 struct CompareSelectIntoMinMax final
@@ -505,7 +526,9 @@ struct BroadcastInDimOpCanon final
 
 struct ConcatenateOpCanon final
     : OpRewritePattern<mlir::stablehlo::ConcatenateOp> {
-  using OpRewritePattern::OpRewritePattern;
+  ConcatenateOpCanon(MLIRContext *context, const FoldLimits &limits,
+                     PatternBenefit benefit)
+      : OpRewritePattern(context, benefit), limits(limits) {}
 
   LogicalResult matchAndRewrite(mlir::stablehlo::ConcatenateOp op,
                                 PatternRewriter &rewriter) const override {
@@ -513,11 +536,12 @@ struct ConcatenateOpCanon final
     if (!type.hasStaticShape()) return failure();
 
     size_t numElems = type.getNumElements();
-    if (numElems > kFoldOpEltLimit) return failure();
+    if (getConstantSizeInBytes(type) > limits.foldOpByteLimit)
+      return failure();
 
     // Fold concatenate when all inputs are constants.
     OperandRange inputs = op.getInputs();
-    SmallVector<DenseElementsAttr> constants(inputs.size());
+    SmallVector<ElementsAttr> constants(inputs.size());
     for (auto [input, constant] : llvm::zip_equal(inputs, constants)) {
       if (!matchPattern(input, m_Constant(&constant))) return failure();
     }
@@ -527,6 +551,31 @@ struct ConcatenateOpCanon final
     int64_t topSize = std::accumulate(shape.begin(), shape.begin() + dim,
                                       int64_t{1}, std::multiplies<>{});
 
+    // Copy raw bytes where possible, so that large results can be emitted as
+    // resource blobs without going through attributes.
+    SmallVector<RawElements> rawConstants;
+    for (ElementsAttr attr : constants) {
+      auto rawElems = RawElements::get(attr);
+      if (!rawElems) break;
+      rawConstants.push_back(*rawElems);
+    }
+    if (rawConstants.size() == constants.size()) {
+      SmallVector<char> data;
+      data.reserve(getConstantSizeInBytes(type));
+      for (int64_t i = 0; i != topSize; ++i) {
+        for (auto [attr, rawElems] : llvm::zip_equal(constants, rawConstants)) {
+          int64_t bottomSize = attr.getNumElements() / topSize;
+          rawElems.append(i * bottomSize, bottomSize, data);
+        }
+      }
+      rewriter.replaceOpWithNewOp<mlir::stablehlo::ConstantOp>(
+          op, makeFoldedElementsAttr(type, data, limits));
+      return success();
+    }
+
+    if (!llvm::all_of(constants, llvm::IsaPred<DenseElementsAttr>))
+      return failure();
+
     SmallVector<Attribute> newElems;
     newElems.reserve(numElems);
 
@@ -543,6 +592,9 @@ struct ConcatenateOpCanon final
         op, DenseElementsAttr::get(op.getType(), newElems));
     return success();
   }
+
+ private:
+  FoldLimits limits;
 };
 
 struct ConvertOpCanon final : OpRewritePattern<mlir::stablehlo::ConvertOp> {
@@ -551,9 +603,21 @@ struct ConvertOpCanon final : OpRewritePattern<mlir::stablehlo::ConvertOp> {
   LogicalResult matchAndRewrite(mlir::stablehlo::ConvertOp op,
                                 PatternRewriter &rewriter) const override {
     // Check if this convert is a noop.
-    if (op.getOperand().getType() != op.getType()) return failure();
+    if (op.getOperand().getType() == op.getType()) {
+      rewriter.replaceOp(op, op.getOperand());
+      return success();
+    }
 
-    rewriter.replaceOp(op, op.getOperand());
+    // Check if this convert undoes a lossless conversion, e.g. of bf16 to
+    // f32 and back.
+    auto operandOp =
+        op.getOperand().getDefiningOp<mlir::stablehlo::ConvertOp>();
+    if (!operandOp || operandOp.getOperand().getType() != op.getType() ||
+        !isLosslessFloatConversion(getElementTypeOrSelf(op.getType()),
+                                   getElementTypeOrSelf(operandOp.getType())))
+      return failure();
+
+    rewriter.replaceOp(op, operandOp.getOperand());
     return success();
   }
 };
@@ -1187,16 +1251,29 @@ struct ReorderElementwiseAndShapeOp final
 struct StablehloAggressiveSimplificationPass final
     : impl::StablehloAggressiveSimplificationPassBase<
           StablehloAggressiveSimplificationPass> {
+  using StablehloAggressiveSimplificationPassBase::
+      StablehloAggressiveSimplificationPassBase;
+
   LogicalResult initialize(MLIRContext *context) override {
     RewritePatternSet patterns_(context);
-    populateStablehloCanonicalizationPatterns(context, &patterns_);
+    FoldLimits limits{foldOpByteLimit, resourceByteThreshold};
+    populateStablehloCanonicalizationPatterns(context, &patterns_,
+                                              /*benefit=*/1, limits);
     patterns = std::move(patterns_);
     return success();
   }
 
   void runOnOperation() override {
-    if (failed(applyPatternsAndFoldGreedily(getOperation(), patterns)))
-      signalPassFailure();
+    GreedyRewriteConfig config;
+    config.maxIterations = maxIterations;
+    PatternStatistics statistics;
+    LogicalResult result = applyPatternsGreedilyWithStatistics(
+        getOperation(), patterns, config, statistics);
+    numIterations += statistics.getNumIterations();
+    numPatternApplications += statistics.getNumApplications();
+    numPatternFailures += statistics.getNumFailures();
+    if (reportPatternStatistics) statistics.emitRemark(getOperation());
+    if (failed(result)) signalPassFailure();
   }
 
  private:
@@ -1206,10 +1283,11 @@ struct StablehloAggressiveSimplificationPass final
 
 void populateStablehloCanonicalizationPatterns(MLIRContext *context,
                                                RewritePatternSet *patterns,
-                                               PatternBenefit benefit) {
+                                               PatternBenefit benefit,
+                                               const FoldLimits &limits) {
   patterns->add<
       // Arithmetic ops.
-      AddOpCanon, SubtractOpCanon, MulOpCanon, CompareOpCanon, SelectOpCanon,
+      AddOpCanon, SubtractOpCanon, MulOpCanon, CompareOpCanon,
       CompareSelectIntoMinMax,
       // Complex ops.
       RealOpCanon, ImagOpCanon,
@@ -1222,10 +1300,12 @@ void populateStablehloCanonicalizationPatterns(MLIRContext *context,
       // Reduce op.
       NoopReduceOpCanon, EmptyReduceOpCanon, UnusedResultReduceOpCanon,
       // Shape manipulation(-ish) ops.
-      ConcatenateOpCanon, ConvertOpCanon, DynamicReshapeOpCanon, GatherOpCanon,
-      ReshapeOpCanon, MergeConsecutiveReshapes, TransposeIsReshape,
+      ConvertOpCanon, DynamicReshapeOpCanon, GatherOpCanon, ReshapeOpCanon,
+      MergeConsecutiveReshapes, TransposeIsReshape,
       // Types.
       ZeroExtentTensorCanon>(context, benefit);
+  // Patterns which fold ops into new constants.
+  patterns->add<SelectOpCanon, ConcatenateOpCanon>(context, limits, benefit);
   patterns->add<ReorderElementwiseAndShapeOp>(context);
 }
 
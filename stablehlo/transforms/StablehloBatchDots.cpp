@@ -0,0 +1,176 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/CostAnalysis.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOBATCHDOTSPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Returns whether `op` can be batched with other dots, i.e. whether it's a
+// `dot_general` of static shapes whose operands and result are at most
+// `threshold` bytes in total.
+bool isBatchable(Operation *op, int64_t threshold) {
+  if (!isa<DotGeneralOp>(op)) return false;
+  int64_t size = 0;
+  for (Type type : llvm::concat<Type>(op->getOperandTypes(),
+                                      op->getResultTypes())) {
+    auto rankedType = dyn_cast<RankedTensorType>(type);
+    if (!rankedType || !rankedType.hasStaticShape()) return false;
+    size += CostAnalysis::getSizeInBytes(rankedType).value_or(0);
+  }
+  return size <= threshold;
+}
+
+bool areBatchable(Operation *lhs, Operation *rhs) {
+  return lhs->getOperandTypes() == rhs->getOperandTypes() &&
+         lhs->getResultTypes() == rhs->getResultTypes() &&
+         lhs->getAttrDictionary() == rhs->getAttrDictionary();
+}
+
+// Returns `dims` shifted by the leading batch dimension.
+SmallVector<int64_t> shiftDims(ArrayRef<int64_t> dims) {
+  return llvm::to_vector(
+      llvm::map_range(dims, [](int64_t dim) { return dim + 1; }));
+}
+
+// Stacks operand `index` of `ops` along a new leading dimension.
+Value stackOperands(OpBuilder &builder, Location loc,
+                    ArrayRef<DotGeneralOp> ops, int64_t index) {
+  auto type = cast<RankedTensorType>(ops.front()->getOperand(index).getType());
+  SmallVector<int64_t> shape(type.getShape());
+  shape.insert(shape.begin(), 1);
+  auto reshapedType = RankedTensorType::get(shape, type.getElementType());
+  SmallVector<Value> operands;
+  for (DotGeneralOp op : ops)
+    operands.push_back(builder.create<ReshapeOp>(loc, reshapedType,
+                                                 op->getOperand(index)));
+  return builder.create<ConcatenateOp>(loc, operands, 0);
+}
+
+// Replaces `ops`, which are batchable and independent, with a single dot of
+// their stacked operands right before the last of them, with an additional
+// leading batching dimension along which its result is sliced.
+void batch(ArrayRef<DotGeneralOp> ops) {
+  DotGeneralOp first = ops.front();
+  OpBuilder builder(ops.back());
+  Location loc = builder.getFusedLoc(llvm::to_vector(
+      llvm::map_range(ops, [](DotGeneralOp op) { return op->getLoc(); })));
+
+  Value lhs = stackOperands(builder, loc, ops, 0);
+  Value rhs = stackOperands(builder, loc, ops, 1);
+  auto dims = first.getDotDimensionNumbers();
+  SmallVector<int64_t> lhsBatchingDims = {0};
+  llvm::append_range(lhsBatchingDims,
+                     shiftDims(dims.getLhsBatchingDimensions()));
+  SmallVector<int64_t> rhsBatchingDims = {0};
+  llvm::append_range(rhsBatchingDims,
+                     shiftDims(dims.getRhsBatchingDimensions()));
+
+  auto resultType = cast<RankedTensorType>(first.getType());
+  SmallVector<int64_t> resultShape(resultType.getShape());
+  resultShape.insert(resultShape.begin(), ops.size());
+  auto batched = builder.create<DotGeneralOp>(
+      loc, RankedTensorType::get(resultShape, resultType.getElementType()),
+      lhs, rhs,
+      DotDimensionNumbersAttr::get(
+          builder.getContext(), lhsBatchingDims, rhsBatchingDims,
+          shiftDims(dims.getLhsContractingDimensions()),
+          shiftDims(dims.getRhsContractingDimensions())),
+      first.getPrecisionConfigAttr());
+
+  SmallVector<int64_t> start(resultShape.size(), 0);
+  SmallVector<int64_t> limit(resultShape);
+  SmallVector<int64_t> strides(resultShape.size(), 1);
+  for (auto [i, op] : llvm::enumerate(ops)) {
+    start[0] = i;
+    limit[0] = i + 1;
+    Value slice = builder.create<SliceOp>(
+        loc, batched, builder.getDenseI64ArrayAttr(start),
+        builder.getDenseI64ArrayAttr(limit),
+        builder.getDenseI64ArrayAttr(strides));
+    op.getResult().replaceAllUsesWith(
+        builder.create<ReshapeOp>(loc, resultType, slice));
+  }
+  for (DotGeneralOp op : ops) op->erase();
+}
+
+// Batches the identical dots of `block` while their users all follow them,
+// so that none of them depends on another and the batched dot doesn't delay
+// any of them.
+void batchDots(Block &block, int64_t threshold) {
+  struct Group {
+    SmallVector<DotGeneralOp> ops;
+    bool isOpen = true;
+  };
+  SmallVector<Group> groups;
+  llvm::DenseMap<Operation *, size_t> groupIndices;
+
+  for (Operation &op : block) {
+    // The users of a dot must follow the batched dot, so its group can't
+    // grow anymore.
+    op.walk([&](Operation *nestedOp) {
+      for (Value operand : nestedOp->getOperands()) {
+        auto it = groupIndices.find(operand.getDefiningOp());
+        if (it != groupIndices.end()) groups[it->second].isOpen = false;
+      }
+    });
+
+    if (!isBatchable(&op, threshold)) continue;
+
+    auto group = llvm::find_if(groups, [&](Group &group) {
+      return group.isOpen && areBatchable(group.ops.front(), &op);
+    });
+    if (group == groups.end()) group = &groups.emplace_back();
+    group->ops.push_back(cast<DotGeneralOp>(op));
+    groupIndices[&op] = std::distance(groups.begin(), group);
+  }
+
+  for (Group &group : groups)
+    if (group.ops.size() > 1) batch(group.ops);
+}
+
+struct StablehloBatchDotsPass
+    : public impl::StablehloBatchDotsPassBase<StablehloBatchDotsPass> {
+  using StablehloBatchDotsPassBase::StablehloBatchDotsPassBase;
+
+  void runOnOperation() override {
+    SmallVector<Block *> blocks;
+    getOperation().walk([&](Block *block) { blocks.push_back(block); });
+    for (Block *block : blocks) batchDots(*block, threshold);
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,298 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/Passes.h"
+#include "stablehlo/transforms/StablehloRefineShapes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOBUCKETSHAPESPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Returns whether dimension `dimension` of `type` is the dynamic dimension
+// which is bucketed.
+bool isBucketed(Type type, int64_t dimension) {
+  auto rankedType = dyn_cast<RankedTensorType>(type);
+  return rankedType && dimension < rankedType.getRank() &&
+         rankedType.isDynamicDim(dimension);
+}
+
+Value makeI32Constant(OpBuilder& builder, Location loc,
+                      ArrayRef<int32_t> values) {
+  return builder.create<ConstantOp>(loc, builder.getI32TensorAttr(values));
+}
+
+Value makeScalarI32Constant(OpBuilder& builder, Location loc, int64_t value) {
+  return builder.create<ConstantOp>(
+      loc, DenseIntElementsAttr::get(
+               RankedTensorType::get({}, builder.getI32Type()),
+               static_cast<int32_t>(value)));
+}
+
+// Returns a vector of `rank` sizes which are `value` in dimension `dimension`
+// and `base` elsewhere, where `value` is a scalar tensor<i32>.
+Value makeShapeWithSize(OpBuilder& builder, Location loc,
+                        ArrayRef<int32_t> base, int64_t dimension,
+                        Value value) {
+  int64_t rank = base.size();
+  auto vectorType = RankedTensorType::get({rank}, builder.getI32Type());
+  SmallVector<int32_t> oneHot(rank, 0);
+  oneHot[dimension] = 1;
+  Value broadcast = builder.create<BroadcastInDimOp>(
+      loc, vectorType, value, builder.getDenseI64ArrayAttr({}));
+  Value size = builder.create<MulOp>(loc, broadcast,
+                                     makeI32Constant(builder, loc, oneHot));
+  return builder.create<AddOp>(loc, size, makeI32Constant(builder, loc, base));
+}
+
+// Clones the module of `func` and refines the arguments of its copy of `func`
+// to `refinedTypes` with the remove dynamism pipeline. Returns the refined
+// function, which is owned by `clone`.
+FailureOr<func::FuncOp> specialize(func::FuncOp func, TypeRange refinedTypes,
+                                   OwningOpRef<ModuleOp>& clone) {
+  auto module = func->getParentOfType<ModuleOp>();
+  clone = module.clone();
+  PassManager pm(module.getContext());
+  createStablehloRemoveDynamismPipeline(pm, refinedTypes);
+  if (failed(pm.run(*clone))) return failure();
+  auto refined = clone->lookupSymbol<func::FuncOp>(func.getSymName());
+  if (!refined) return failure();
+  return refined;
+}
+
+// Builds the branch of the dispatcher which pads the bucketed arguments to
+// `bucketSize`, calls `specialization` and slices its bucketed results back
+// to `size`.
+void buildBucketBranch(OpBuilder& builder, Location loc, Region& branch,
+                       func::FuncOp dispatcher, func::FuncOp specialization,
+                       int64_t dimension, int64_t bucketSize, Value size) {
+  OpBuilder::InsertionGuard guard(builder);
+  builder.createBlock(&branch);
+  Value padding = builder.create<SubtractOp>(
+      loc, makeScalarI32Constant(builder, loc, bucketSize), size);
+
+  SmallVector<Value> operands;
+  for (auto [arg, refinedType] :
+       llvm::zip(dispatcher.getArguments(),
+                 specialization.getArgumentTypes())) {
+    if (!isBucketed(arg.getType(), dimension)) {
+      operands.push_back(arg);
+      continue;
+    }
+    auto paddedType = cast<RankedTensorType>(refinedType);
+    SmallVector<int32_t> zeros(paddedType.getRank(), 0);
+    Value paddingValue = builder.create<ConstantOp>(
+        loc, builder.getZeroAttr(
+                 RankedTensorType::get({}, paddedType.getElementType())));
+    operands.push_back(builder.create<DynamicPadOp>(
+        loc, paddedType, arg, paddingValue,
+        makeI32Constant(builder, loc, zeros),
+        makeShapeWithSize(builder, loc, zeros, dimension, padding),
+        makeI32Constant(builder, loc, zeros)));
+  }
+  auto call = builder.create<func::CallOp>(loc, specialization, operands);
+
+  SmallVector<Value> results;
+  for (auto [result, resultType] :
+       llvm::zip(call.getResults(), dispatcher.getResultTypes())) {
+    if (!isBucketed(resultType, dimension)) {
+      results.push_back(result);
+      continue;
+    }
+    auto staticType = cast<RankedTensorType>(result.getType());
+    SmallVector<int32_t> zeros(staticType.getRank(), 0);
+    SmallVector<int32_t> ones(staticType.getRank(), 1);
+    SmallVector<int32_t> limits(staticType.getShape());
+    limits[dimension] = 0;
+    results.push_back(builder.create<RealDynamicSliceOp>(
+        loc, resultType, result, makeI32Constant(builder, loc, zeros),
+        makeShapeWithSize(builder, loc, limits, dimension, size),
+        makeI32Constant(builder, loc, ones)));
+  }
+  builder.create<ReturnOp>(loc, results);
+}
+
+struct StablehloBucketShapesPass
+    : public impl::StablehloBucketShapesPassBase<StablehloBucketShapesPass> {
+  using StablehloBucketShapesPassBase::StablehloBucketShapesPassBase;
+
+  void runOnOperation() override {
+    if (failed(specializeToShapeBuckets(getOperation(), bucketSizes,
+                                        dimension)))
+      signalPassFailure();
+  }
+};
+
+}  // namespace
+
+LogicalResult specializeToShapeBuckets(ModuleOp module,
+                                       ArrayRef<int64_t> bucketSizes,
+                                       int64_t dimension) {
+  auto func = getStablehloRefineShapesTarget(module);
+  if (!func) return failure();
+  if (bucketSizes.empty() || !llvm::is_sorted(bucketSizes) ||
+      llvm::adjacent_find(bucketSizes) != bucketSizes.end() ||
+      bucketSizes.front() <= 0 ||
+      bucketSizes.back() > std::numeric_limits<int32_t>::max())
+    return module.emitError()
+           << "bucket sizes must be positive 32-bit integers in increasing "
+              "order";
+  if (dimension < 0) return module.emitError() << "invalid dimension";
+  if (!SymbolTable::symbolKnownUseEmpty(func, module))
+    return func.emitError() << "must not be referenced to be bucketed";
+
+  // Only the bucketed dimension may be dynamic, and all the bucketed arguments
+  // are expected to have the same size at run time, like a batch dimension.
+  SmallVector<int64_t> bucketedArgs;
+  for (auto [i, type] : llvm::enumerate(func.getArgumentTypes())) {
+    auto rankedType = dyn_cast<RankedTensorType>(type);
+    if (!rankedType)
+      return func.emitError() << "argument " << i << " must be ranked";
+    int64_t numDynamicDims = rankedType.getNumDynamicDims();
+    if (isBucketed(type, dimension)) {
+      bucketedArgs.push_back(i);
+      --numDynamicDims;
+    }
+    if (numDynamicDims != 0)
+      return func.emitError() << "argument " << i
+                              << " must only be dynamic in dimension "
+                              << dimension;
+  }
+  if (bucketedArgs.empty())
+    return func.emitError() << "no argument is dynamic in dimension "
+                            << dimension;
+
+  // Specializations are built before changing the module, so that they are
+  // refined from the original function, and only their main function is kept.
+  // Other functions are never refined.
+  SmallVector<OwningOpRef<ModuleOp>> clones(bucketSizes.size());
+  SmallVector<func::FuncOp> specializations;
+  for (auto [bucketSize, clone] : llvm::zip(bucketSizes, clones)) {
+    SmallVector<Type> refinedTypes;
+    for (Type type : func.getArgumentTypes()) {
+      if (!isBucketed(type, dimension)) {
+        refinedTypes.push_back(type);
+        continue;
+      }
+      auto rankedType = cast<RankedTensorType>(type);
+      SmallVector<int64_t> shape(rankedType.getShape());
+      shape[dimension] = bucketSize;
+      refinedTypes.push_back(rankedType.clone(shape));
+    }
+    auto specialization = specialize(func, refinedTypes, clone);
+    if (failed(specialization))
+      return func.emitError() << "failed to specialize to bucket size "
+                              << bucketSize;
+
+    // Bucketed results are sliced back to the size of the arguments, so they
+    // must follow the bucketed dimension. Other results must keep their type.
+    for (auto [i, types] :
+         llvm::enumerate(llvm::zip(func.getResultTypes(),
+                                   specialization->getResultTypes()))) {
+      auto [type, refinedType] = types;
+      auto rankedType = dyn_cast<RankedTensorType>(refinedType);
+      bool isValid = isBucketed(type, dimension)
+                         ? rankedType && rankedType.hasStaticShape() &&
+                               rankedType.getDimSize(dimension) == bucketSize
+                         : type == refinedType;
+      if (!isValid)
+        return func.emitError()
+               << "result " << i << " doesn't follow dimension " << dimension
+               << " of the arguments with bucket size " << bucketSize;
+    }
+    specializations.push_back(*specialization);
+  }
+
+  // The dispatcher replaces the original function, which becomes the
+  // fallback for sizes beyond the largest bucket. It isn't referenced, so it
+  // is renamed without updating any uses.
+  SymbolTable symbolTable(module);
+  Location loc = func.getLoc();
+  std::string name = func.getSymName().str();
+  symbolTable.remove(func);
+  func.setSymName(name + "_dynamic");
+  func.setPrivate();
+  symbolTable.insert(func);
+  auto dispatcher = func::FuncOp::create(loc, name, func.getFunctionType());
+  dispatcher.setAllArgAttrs(func.getAllArgAttrs());
+  dispatcher.setAllResultAttrs(func.getAllResultAttrs());
+  symbolTable.insert(dispatcher, Block::iterator(func));
+
+  SmallVector<func::FuncOp> buckets;
+  for (auto [bucketSize, specialization] :
+       llvm::zip(bucketSizes, specializations)) {
+    auto bucket = cast<func::FuncOp>(specialization->clone());
+    bucket.setSymName((name + "_bucket_" + Twine(bucketSize)).str());
+    bucket.setPrivate();
+    symbolTable.insert(bucket, Block::iterator(func));
+    buckets.push_back(bucket);
+  }
+
+  // Branch `i` handles sizes of at most `bucketSizes[i]`, and the last branch
+  // calls the original function.
+  auto builder = OpBuilder::atBlockBegin(dispatcher.addEntryBlock());
+  Value size = builder.create<GetDimensionSizeOp>(
+      loc, dispatcher.getArgument(bucketedArgs.front()), dimension);
+  Value index = makeScalarI32Constant(builder, loc, 0);
+  for (int64_t bucketSize : bucketSizes) {
+    Value isLarger = builder.create<CompareOp>(
+        loc, size, makeScalarI32Constant(builder, loc, bucketSize),
+        ComparisonDirection::GT);
+    index = builder.create<AddOp>(
+        loc, index,
+        builder.create<ConvertOp>(loc, index.getType(), isLarger));
+  }
+  auto caseOp = builder.create<CaseOp>(loc, dispatcher.getResultTypes(), index,
+                                       bucketSizes.size() + 1);
+  for (auto [i, bucketSize] : llvm::enumerate(bucketSizes))
+    buildBucketBranch(builder, loc, caseOp.getBranches()[i], dispatcher,
+                      buckets[i], dimension, bucketSize, size);
+  {
+    OpBuilder::InsertionGuard guard(builder);
+    builder.createBlock(&caseOp.getBranches().back());
+    auto call =
+        builder.create<func::CallOp>(loc, func, dispatcher.getArguments());
+    builder.create<ReturnOp>(loc, call.getResults());
+  }
+  builder.create<func::ReturnOp>(loc, caseOp.getResults());
+  return success();
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
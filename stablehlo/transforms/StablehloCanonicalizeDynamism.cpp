@@ -13,6 +13,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cstdint>
+
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
@@ -24,6 +26,7 @@ limitations under the License.
 #include "mlir/Interfaces/InferTypeOpInterface.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "stablehlo/dialect/Base.h"
 #include "stablehlo/dialect/StablehloOps.h"
 #include "stablehlo/transforms/Passes.h"
 
@@ -292,6 +295,126 @@ struct CanonicalizeRealDynamicSliceOpToSliceOpPattern
   }
 };
 
+// Returns the static shape which has the bounds of `type` in place of its
+// dynamic dimensions, or failure if some dynamic dimension is unbounded.
+FailureOr<SmallVector<int64_t>> getBoundedShape(RankedTensorType type) {
+  auto bounds = hlo::encodingToBounds(type.getEncoding());
+  if (bounds.empty()) return failure();
+  SmallVector<int64_t> shape(type.getShape());
+  for (auto [dim, bound] : llvm::zip(shape, bounds)) {
+    if (!ShapedType::isDynamic(dim)) continue;
+    if (ShapedType::isDynamic(bound)) return failure();
+    dim = bound;
+  }
+  return shape;
+}
+
+// Returns element `dim` of the 1-dimensional `shape` as a tensor<i32>, which
+// is what set_dimension_size expects.
+Value getDimensionSize(PatternRewriter& rewriter, Location loc, Value shape,
+                       int64_t dim) {
+  auto elementType = cast<ShapedType>(shape.getType()).getElementType();
+  auto size = rewriter.create<SliceOp>(
+      loc, RankedTensorType::get({1}, elementType), shape,
+      ArrayRef<int64_t>{dim}, ArrayRef<int64_t>{dim + 1}, ArrayRef<int64_t>{1});
+  Value scalar = rewriter.create<ReshapeOp>(
+      loc, RankedTensorType::get({}, elementType), size);
+  if (elementType.isInteger(32)) return scalar;
+  return rewriter.create<ConvertOp>(loc, scalar, rewriter.getI32Type());
+}
+
+// Replaces `op`, whose result type is bounded, with `padded`, which has the
+// static shape of the bounds, by setting the dynamic dimensions of `padded`
+// to the corresponding elements of `shape`.
+void replaceWithSetDimensionSizes(PatternRewriter& rewriter, Operation* op,
+                                  Value padded, Value shape) {
+  auto type = cast<RankedTensorType>(op->getResult(0).getType());
+  auto bounds = hlo::encodingToBounds(type.getEncoding());
+  SmallVector<int64_t> dims(
+      cast<RankedTensorType>(padded.getType()).getShape());
+  SmallVector<int64_t> partialBounds(type.getRank(), ShapedType::kDynamic);
+  Value result = padded;
+  for (auto [i, dim] : llvm::enumerate(type.getShape())) {
+    if (!ShapedType::isDynamic(dim)) continue;
+    dims[i] = ShapedType::kDynamic;
+    partialBounds[i] = bounds[i];
+    auto resultType = RankedTensorType::get(
+        dims, type.getElementType(),
+        hlo::boundsToEncoding(type.getEncoding(), partialBounds));
+    result = rewriter.create<SetDimensionSizeOp>(
+        op->getLoc(), resultType, result,
+        getDimensionSize(rewriter, op->getLoc(), shape, i), i);
+  }
+  rewriter.replaceOp(op, result);
+}
+
+LogicalResult checkShapeElementType(PatternRewriter& rewriter, Operation* op,
+                                    Value shape) {
+  if (!isa<IntegerType>(cast<ShapedType>(shape.getType()).getElementType()))
+    return rewriter.notifyMatchFailure(op, "expected integer shape operand");
+  return success();
+}
+
+struct CanonicalizeBoundedDynamicBroadcastInDimOpPattern
+    : public OpRewritePattern<DynamicBroadcastInDimOp> {
+  using OpRewritePattern::OpRewritePattern;
+  LogicalResult matchAndRewrite(DynamicBroadcastInDimOp op,
+                                PatternRewriter& rewriter) const override {
+    // The operand is broadcast to the bounds of the result, and the actual
+    // sizes are attached with set_dimension_size, which lets the padded
+    // result be allocated statically.
+    auto operandType = op.getOperand().getType();
+    if (!operandType.hasStaticShape())
+      return rewriter.notifyMatchFailure(op, "expected static operand type");
+    auto type = op.getType();
+    if (type.hasStaticShape())
+      return rewriter.notifyMatchFailure(op, "expected dynamic result type");
+    auto paddedShape = getBoundedShape(type);
+    if (failed(paddedShape))
+      return rewriter.notifyMatchFailure(op, "expected bounded result type");
+    if (failed(checkShapeElementType(rewriter, op, op.getOutputDimensions())))
+      return failure();
+
+    // Broadcasting to the bound is only correct if the operand dimensions
+    // which map to dynamic dimensions are expanded.
+    for (auto [operandDim, resultDim] :
+         llvm::enumerate(op.getBroadcastDimensions())) {
+      if (ShapedType::isDynamic(type.getDimSize(resultDim)) &&
+          operandType.getDimSize(operandDim) != 1)
+        return rewriter.notifyMatchFailure(op, "expected expanding dimension");
+    }
+
+    auto padded = rewriter.create<BroadcastInDimOp>(
+        op.getLoc(), RankedTensorType::get(*paddedShape, type.getElementType()),
+        op.getOperand(), op.getBroadcastDimensionsAttr());
+    replaceWithSetDimensionSizes(rewriter, op, padded,
+                                 op.getOutputDimensions());
+    return success();
+  }
+};
+
+struct CanonicalizeBoundedDynamicIotaOpPattern
+    : public OpRewritePattern<DynamicIotaOp> {
+  using OpRewritePattern::OpRewritePattern;
+  LogicalResult matchAndRewrite(DynamicIotaOp op,
+                                PatternRewriter& rewriter) const override {
+    auto type = cast<RankedTensorType>(op.getType());
+    if (type.hasStaticShape())
+      return rewriter.notifyMatchFailure(op, "expected dynamic result type");
+    auto paddedShape = getBoundedShape(type);
+    if (failed(paddedShape))
+      return rewriter.notifyMatchFailure(op, "expected bounded result type");
+    if (failed(checkShapeElementType(rewriter, op, op.getOutputShape())))
+      return failure();
+
+    auto padded = rewriter.create<IotaOp>(
+        op.getLoc(), RankedTensorType::get(*paddedShape, type.getElementType()),
+        op.getIotaDimension());
+    replaceWithSetDimensionSizes(rewriter, op, padded, op.getOutputShape());
+    return success();
+  }
+};
+
 struct StablehloCanonicalizeDynamismPass
     : public impl::StablehloCanonicalizeDynamismPassBase<
           StablehloCanonicalizeDynamismPass> {
@@ -307,6 +430,9 @@ struct StablehloCanonicalizeDynamismPass
 
     RewritePatternSet patterns_(context);
     populateStablehloCanonicalizeDynamismPatterns(&patterns_, context);
+    if (bounded)
+      populateStablehloCanonicalizeBoundedDynamismPatterns(&patterns_,
+                                                           context);
     patterns = std::move(patterns_);
 
     return success();
@@ -340,5 +466,11 @@ void populateStablehloCanonicalizeDynamismPatterns(RewritePatternSet* patterns,
   patterns->add<CanonicalizeRealDynamicSliceOpToSliceOpPattern>(context);
 }
 
+void populateStablehloCanonicalizeBoundedDynamismPatterns(
+    RewritePatternSet* patterns, MLIRContext* context) {
+  patterns->add<CanonicalizeBoundedDynamicBroadcastInDimOpPattern>(context);
+  patterns->add<CanonicalizeBoundedDynamicIotaOpPattern>(context);
+}
+
 }  // namespace stablehlo
 }  // namespace mlir
@@ -0,0 +1,278 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OperationSupport.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/CostAnalysis.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOCOMBINECOLLECTIVESPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Returns the dimension along which `op` gathers or scatters, if any.
+std::optional<int64_t> getCollectiveDim(Operation *op) {
+  if (auto allGatherOp = dyn_cast<AllGatherOp>(op))
+    return allGatherOp.getAllGatherDim();
+  if (auto reduceScatterOp = dyn_cast<ReduceScatterOp>(op))
+    return reduceScatterOp.getScatterDimension();
+  return std::nullopt;
+}
+
+// Returns the number of processes in the groups of `op`, from the sizes of
+// its operand and result along the dimension it gathers or scatters.
+int64_t getNumProcesses(Operation *op) {
+  auto dim = getCollectiveDim(op);
+  if (!dim) return 1;
+  auto operandType = cast<RankedTensorType>(op->getOperand(0).getType());
+  auto resultType = cast<RankedTensorType>(op->getResult(0).getType());
+  if (isa<AllGatherOp>(op))
+    return resultType.getDimSize(*dim) / operandType.getDimSize(*dim);
+  return operandType.getDimSize(*dim) / resultType.getDimSize(*dim);
+}
+
+// Returns the attributes of `op` other than the dimension along which it
+// gathers or scatters, which must match to combine collectives.
+NamedAttrList getConfiguration(Operation *op) {
+  NamedAttrList attrs(op->getAttrDictionary());
+  if (isa<AllGatherOp>(op))
+    attrs.erase(cast<AllGatherOp>(op).getAllGatherDimAttrName());
+  if (isa<ReduceScatterOp>(op))
+    attrs.erase(cast<ReduceScatterOp>(op).getScatterDimensionAttrName());
+  return attrs;
+}
+
+// Returns the size in bytes of `op` if it can be combined with other
+// collectives, i.e. if it's an `all_reduce`, `all_gather` or
+// `reduce_scatter` of static shapes of at most `threshold` bytes.
+std::optional<int64_t> getCombinableSize(Operation *op, int64_t threshold) {
+  if (!isa<AllReduceOp, AllGatherOp, ReduceScatterOp>(op)) return std::nullopt;
+  auto operandType = dyn_cast<RankedTensorType>(op->getOperand(0).getType());
+  auto resultType = dyn_cast<RankedTensorType>(op->getResult(0).getType());
+  if (!operandType || !operandType.hasStaticShape() || !resultType ||
+      !resultType.hasStaticShape() || getNumProcesses(op) <= 0)
+    return std::nullopt;
+  auto size = std::max(CostAnalysis::getSizeInBytes(operandType).value_or(0),
+                       CostAnalysis::getSizeInBytes(resultType).value_or(0));
+  if (size > threshold) return std::nullopt;
+  return size;
+}
+
+bool areCombinable(Operation *lhs, Operation *rhs) {
+  if (lhs->getName() != rhs->getName() ||
+      getElementTypeOrSelf(lhs->getOperand(0)) !=
+          getElementTypeOrSelf(rhs->getOperand(0)) ||
+      getNumProcesses(lhs) != getNumProcesses(rhs) ||
+      getConfiguration(lhs).getDictionary(lhs->getContext()) !=
+          getConfiguration(rhs).getDictionary(rhs->getContext()))
+    return false;
+  return llvm::all_of_zip(lhs->getRegions(), rhs->getRegions(),
+                          [](Region &lhsRegion, Region &rhsRegion) {
+                            return OperationEquivalence::isRegionEquivalentTo(
+                                &lhsRegion, &rhsRegion,
+                                OperationEquivalence::IgnoreLocations);
+                          });
+}
+
+// Transposes `value` so that its dimension `from` becomes dimension `to`.
+Value moveDim(OpBuilder &builder, Location loc, Value value, int64_t from,
+              int64_t to) {
+  if (from == to) return value;
+  int64_t rank = cast<RankedTensorType>(value.getType()).getRank();
+  SmallVector<int64_t> permutation(rank);
+  std::iota(permutation.begin(), permutation.end(), 0);
+  permutation.erase(permutation.begin() + from);
+  permutation.insert(permutation.begin() + to, from);
+  return builder.create<TransposeOp>(loc, value,
+                                     builder.getDenseI64ArrayAttr(permutation));
+}
+
+Value reshape(OpBuilder &builder, Location loc, Value value,
+              ArrayRef<int64_t> shape) {
+  auto type = RankedTensorType::get(shape, getElementTypeOrSelf(value));
+  return builder.create<ReshapeOp>(loc, type, value);
+}
+
+// Packs the operand of `op` into a 2D tensor of one row per process, whose
+// rows are concatenated with those of the other collectives.
+Value packOperand(OpBuilder &builder, Location loc, Operation *op,
+                  int64_t numProcesses) {
+  Value operand = op->getOperand(0);
+  auto type = cast<RankedTensorType>(operand.getType());
+  if (!isa<ReduceScatterOp>(op))
+    return reshape(builder, loc, operand, {1, type.getNumElements()});
+
+  // Splits the scatter dimension into the parts of every process, and moves
+  // them to the front.
+  int64_t dim = *getCollectiveDim(op);
+  SmallVector<int64_t> shape(type.getShape());
+  shape[dim] /= numProcesses;
+  shape.insert(shape.begin() + dim, numProcesses);
+  Value split = reshape(builder, loc, operand, shape);
+  Value transposed = moveDim(builder, loc, split, dim, 0);
+  return reshape(builder, loc, transposed,
+                 {numProcesses, type.getNumElements() / numProcesses});
+}
+
+// Extracts the result of `op` from the columns at `offset` of the result of
+// the combined collective, and returns the number of columns it spans.
+int64_t unpackResult(OpBuilder &builder, Location loc, Operation *op,
+                     Value combined, int64_t offset) {
+  auto combinedType = cast<RankedTensorType>(combined.getType());
+  auto type = cast<RankedTensorType>(op->getResult(0).getType());
+  int64_t numRows = combinedType.getDimSize(0);
+  int64_t numColumns = type.getNumElements() / numRows;
+  Value result = builder.create<SliceOp>(
+      loc, combined, builder.getDenseI64ArrayAttr({0, offset}),
+      builder.getDenseI64ArrayAttr({numRows, offset + numColumns}),
+      builder.getDenseI64ArrayAttr({1, 1}));
+
+  // Moves the rows gathered from every process into the gather dimension.
+  if (isa<AllGatherOp>(op)) {
+    auto operandType = cast<RankedTensorType>(op->getOperand(0).getType());
+    SmallVector<int64_t> shape(operandType.getShape());
+    shape.insert(shape.begin(), numRows);
+    result = reshape(builder, loc, result, shape);
+    result = moveDim(builder, loc, result, 0, *getCollectiveDim(op));
+  }
+  result = reshape(builder, loc, result, type.getShape());
+  op->getResult(0).replaceAllUsesWith(result);
+  return numColumns;
+}
+
+// Replaces `ops`, which are combinable and independent, with a single
+// collective of their flattened operands, right before the last of them.
+void combine(ArrayRef<Operation *> ops) {
+  Operation *first = ops.front();
+  OpBuilder builder(ops.back());
+  Location loc = builder.getFusedLoc(llvm::to_vector(
+      llvm::map_range(ops, [](Operation *op) { return op->getLoc(); })));
+  int64_t numProcesses = getNumProcesses(first);
+
+  SmallVector<Value> packedOperands;
+  for (Operation *op : ops)
+    packedOperands.push_back(packOperand(builder, loc, op, numProcesses));
+  Value operand = builder.create<ConcatenateOp>(loc, packedOperands, 1);
+
+  auto operandType = cast<RankedTensorType>(operand.getType());
+  SmallVector<int64_t> resultShape(operandType.getShape());
+  if (isa<AllGatherOp>(first)) resultShape[0] = numProcesses;
+  if (isa<ReduceScatterOp>(first)) resultShape[0] = 1;
+  NamedAttrList attrs = getConfiguration(first);
+  if (isa<AllGatherOp>(first))
+    attrs.set(cast<AllGatherOp>(first).getAllGatherDimAttrName(),
+              builder.getI64IntegerAttr(0));
+  if (isa<ReduceScatterOp>(first))
+    attrs.set(cast<ReduceScatterOp>(first).getScatterDimensionAttrName(),
+              builder.getI64IntegerAttr(0));
+
+  OperationState state(loc, first->getName());
+  state.addOperands(operand);
+  state.addTypes(
+      RankedTensorType::get(resultShape, operandType.getElementType()));
+  state.addAttributes(attrs);
+  for (Region &region : first->getRegions()) {
+    IRMapping mapping;
+    region.cloneInto(state.addRegion(), mapping);
+  }
+  Value combined = builder.create(state)->getResult(0);
+
+  int64_t offset = 0;
+  for (Operation *op : ops)
+    offset += unpackResult(builder, loc, op, combined, offset);
+  for (Operation *op : ops) op->erase();
+}
+
+// Combines the compatible collectives of `block` while their users all
+// follow them, so that the combined collective doesn't delay any of them.
+void combineCollectives(Block &block, int64_t threshold) {
+  struct Group {
+    SmallVector<Operation *> ops;
+    int64_t sizeInBytes = 0;
+    bool isOpen = true;
+  };
+  SmallVector<Group> groups;
+  llvm::DenseMap<Operation *, size_t> groupIndices;
+
+  for (Operation &op : block) {
+    // The users of a collective must follow the combined collective, so its
+    // group can't grow anymore.
+    op.walk([&](Operation *nestedOp) {
+      for (Value operand : nestedOp->getOperands()) {
+        auto it = groupIndices.find(operand.getDefiningOp());
+        if (it != groupIndices.end()) groups[it->second].isOpen = false;
+      }
+    });
+
+    auto size = getCombinableSize(&op, threshold);
+    if (!size) {
+      // Collectives aren't moved across other ops with side effects.
+      if (!isMemoryEffectFree(&op))
+        for (Group &group : groups) group.isOpen = false;
+      continue;
+    }
+
+    auto group = llvm::find_if(groups, [&](Group &group) {
+      return group.isOpen && group.sizeInBytes + *size <= threshold &&
+             areCombinable(group.ops.front(), &op);
+    });
+    if (group == groups.end()) group = &groups.emplace_back();
+    group->ops.push_back(&op);
+    group->sizeInBytes += *size;
+    groupIndices[&op] = std::distance(groups.begin(), group);
+  }
+
+  for (Group &group : groups)
+    if (group.ops.size() > 1) combine(group.ops);
+}
+
+struct StablehloCombineCollectivesPass
+    : public impl::StablehloCombineCollectivesPassBase<
+          StablehloCombineCollectivesPass> {
+  using StablehloCombineCollectivesPassBase::
+      StablehloCombineCollectivesPassBase;
+
+  void runOnOperation() override {
+    SmallVector<Block *> blocks;
+    getOperation().walk([&](Block *block) { blocks.push_back(block); });
+    for (Block *block : blocks) combineCollectives(*block, threshold);
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
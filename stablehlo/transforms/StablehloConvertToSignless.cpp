@@ -27,7 +27,9 @@ limitations under the License.
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Pass/Pass.h"
+#include "mlir/Rewrite/FrozenRewritePatternSet.h"
 #include "mlir/Support/LogicalResult.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "stablehlo/conversions/linalg/transforms/TypeConversion.h"
@@ -124,8 +126,19 @@ struct StablehloConvertToSignlessPass
     populateFunctionOpInterfaceTypeConversionPattern<func::FuncOp>(patterns,
                                                                    converter);
 
-    auto module = getOperation();
-    if (failed(applyFullConversion(module, target, std::move(patterns)))) {
+    // The patterns only rewrite the op they are applied to, and a function is
+    // only updated in place, so functions are converted concurrently like in
+    // a nested pass manager. Converting the signature of every function and
+    // the calls to it in the same pass keeps the module consistent for the
+    // passes which follow. Other ops of the module are converted afterwards.
+    FrozenRewritePatternSet frozenPatterns(std::move(patterns));
+    SmallVector<Operation*> funcs, others;
+    for (Operation& op : getOperation().getOps())
+      (isa<func::FuncOp>(op) ? funcs : others).push_back(&op);
+    if (failed(failableParallelForEach(&context, funcs, [&](Operation* op) {
+          return applyFullConversion(op, target, frozenPatterns);
+        })) ||
+        failed(applyFullConversion(others, target, frozenPatterns))) {
       signalPassFailure();
     }
   }
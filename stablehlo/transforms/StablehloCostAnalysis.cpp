@@ -0,0 +1,42 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/transforms/CostAnalysis.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOCOSTANALYSISPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+struct StablehloCostAnalysisPass
+    : public impl::StablehloCostAnalysisPassBase<StablehloCostAnalysisPass> {
+  using StablehloCostAnalysisPassBase::StablehloCostAnalysisPassBase;
+
+  void runOnOperation() override {
+    printCostAnalysis(getOperation(), llvm::errs(), json);
+    markAllAnalysesPreserved();
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
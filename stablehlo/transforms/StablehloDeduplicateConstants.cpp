@@ -0,0 +1,96 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <tuple>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/xxhash.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/BuiltinAttributeInterfaces.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/FoldUtils.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLODEDUPLICATECONSTANTSPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Maps constants to the first constant of the module with the same type and
+// elements, whatever their attribute kind, e.g. DenseElementsAttr or
+// DenseResourceElementsAttr of different blobs.
+class ConstantTable {
+ public:
+  ElementsAttr getCanonical(ElementsAttr attr) {
+    auto elements = RawElements::get(attr);
+    if (!elements) return attr;
+    ArrayRef<char> data = elements->getData();
+    // Payloads are hashed once and only compared in full on hash collisions.
+    uint64_t hash = llvm::xxh3_64bits(llvm::ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(data.data()), data.size()));
+    auto &candidates =
+        candidates_[std::make_tuple(attr.getType(), elements->isSplat(), hash)];
+    for (ElementsAttr candidate : candidates)
+      if (candidate == attr || RawElements::get(candidate)->getData() == data)
+        return candidate;
+    candidates.push_back(attr);
+    return attr;
+  }
+
+ private:
+  llvm::DenseMap<std::tuple<Type, bool, uint64_t>, SmallVector<ElementsAttr>>
+      candidates_;
+};
+
+struct StablehloDeduplicateConstantsPass
+    : public impl::StablehloDeduplicateConstantsPassBase<
+          StablehloDeduplicateConstantsPass> {
+  using StablehloDeduplicateConstantsPassBase::
+      StablehloDeduplicateConstantsPassBase;
+
+  void runOnOperation() override {
+    // Constants of all functions share the attributes, and thus the
+    // payloads, of identical constants.
+    ConstantTable table;
+    llvm::DenseMap<Block *, llvm::DenseMap<Attribute, ConstantOp>> firstOps;
+    SmallVector<ConstantOp> duplicateOps;
+    getOperation().walk([&](ConstantOp op) {
+      ElementsAttr value = table.getCanonical(op.getValue());
+      if (value != op.getValue()) op.setValueAttr(value);
+
+      // Identical constants of a block are replaced by the first of them.
+      auto [it, inserted] = firstOps[op->getBlock()].try_emplace(value, op);
+      if (!inserted && it->second.getType() == op.getType()) {
+        op.getResult().replaceAllUsesWith(it->second.getResult());
+        duplicateOps.push_back(op);
+      }
+    });
+    for (ConstantOp op : duplicateOps) op->erase();
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,308 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Quant/QuantTypes.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Dominance.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Transforms/CSE.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOELEMENTWISEREASSOCIATIONPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Returns whether `op` is a StableHLO elementwise op whose operands all have
+// the shape of its single result, which can then be evaluated on operands of
+// any other shape.
+bool isShapePreservingElementwise(Operation *op) {
+  if (!isa_and_nonnull<StablehloDialect>(op->getDialect()) ||
+      !op->hasTrait<OpTrait::Elementwise>() || op->getNumResults() != 1 ||
+      op->getNumOperands() == 0 || op->getNumRegions() != 0)
+    return false;
+  auto resultType = dyn_cast<RankedTensorType>(op->getResult(0).getType());
+  if (!resultType || !resultType.hasStaticShape() ||
+      isa<quant::UniformQuantizedPerAxisType>(resultType.getElementType()))
+    return false;
+  return llvm::all_of(op->getOperandTypes(), [&](Type type) {
+    auto operandType = dyn_cast<RankedTensorType>(type);
+    // Per-axis quantization depends on the shape, so it isn't preserved.
+    return operandType && operandType.getShape() == resultType.getShape() &&
+           !isa<quant::UniformQuantizedPerAxisType>(
+               operandType.getElementType());
+  });
+}
+
+// Returns the splat value of `value` if it is a splat constant.
+std::optional<Attribute> getSplatConstant(Value value) {
+  SplatElementsAttr attr;
+  if (!matchPattern(value, m_Constant(&attr))) return std::nullopt;
+  return attr.getSplatValue<Attribute>();
+}
+
+// Recreates `op` on `operands`, whose shape is `shape`, rather than on its
+// operands. Splat constants among `operands` are nullptr and recreated with
+// `shape` too.
+Value createElementwiseOp(PatternRewriter &rewriter, Operation *op,
+                          ArrayRef<Value> operands, ArrayRef<int64_t> shape) {
+  SmallVector<Value> newOperands;
+  for (auto [operand, newOperand] : llvm::zip(op->getOperands(), operands)) {
+    if (newOperand) {
+      newOperands.push_back(newOperand);
+      continue;
+    }
+    auto type = RankedTensorType::get(shape, getElementTypeOrSelf(operand));
+    newOperands.push_back(rewriter.create<ConstantOp>(
+        operand.getLoc(),
+        SplatElementsAttr::get(type, *getSplatConstant(operand))));
+  }
+
+  auto resultType =
+      RankedTensorType::get(shape, getElementTypeOrSelf(op->getResult(0)));
+  OperationState state(op->getLoc(), op->getName(), newOperands, {resultType},
+                       op->getAttrs());
+  return rewriter.create(state)->getResult(0);
+}
+
+// Hoists broadcasts past elementwise ops, so that the elementwise ops compute
+// on the smaller operands of the broadcasts and only their result is
+// broadcast, e.g.
+//   %0 = broadcast_in_dim %a, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+//   %1 = broadcast_in_dim %b, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+//   %2 = add %0, %1 : tensor<8x4xf32>
+// becomes
+//   %0 = add %a, %b : tensor<4xf32>
+//   %2 = broadcast_in_dim %0, dims = [1] : (tensor<4xf32>) -> tensor<8x4xf32>
+// Splat constants may stand in for broadcasts.
+struct HoistBroadcastInDimPastElementwise : public RewritePattern {
+  explicit HoistBroadcastInDimPastElementwise(MLIRContext *context)
+      : RewritePattern(MatchAnyOpTypeTag(), /*benefit=*/1, context) {}
+
+  LogicalResult matchAndRewrite(Operation *op,
+                                PatternRewriter &rewriter) const override {
+    if (!isShapePreservingElementwise(op)) return failure();
+
+    BroadcastInDimOp first;
+    SmallVector<Value> operands;
+    for (Value operand : op->getOperands()) {
+      auto broadcast = operand.getDefiningOp<BroadcastInDimOp>();
+      if (!broadcast) {
+        if (!getSplatConstant(operand))
+          return rewriter.notifyMatchFailure(op, "expected broadcasts");
+        operands.push_back(nullptr);
+        continue;
+      }
+      if (!first) first = broadcast;
+      if (broadcast.getOperand().getType().getShape() !=
+              first.getOperand().getType().getShape() ||
+          broadcast.getBroadcastDimensions() !=
+              first.getBroadcastDimensions())
+        return rewriter.notifyMatchFailure(op, "expected same broadcasts");
+      operands.push_back(broadcast.getOperand());
+    }
+    if (!first) return rewriter.notifyMatchFailure(op, "expected broadcasts");
+
+    auto shape = first.getOperand().getType().getShape();
+    Value result = createElementwiseOp(rewriter, op, operands, shape);
+    rewriter.replaceOpWithNewOp<BroadcastInDimOp>(
+        op, op->getResult(0).getType(), result,
+        first.getBroadcastDimensionsAttr());
+    return success();
+  }
+};
+
+// Sinks transposes and reshapes below elementwise ops, so that chains of
+// elementwise ops aren't split by them, e.g.
+//   %0 = transpose %a, dims = [1, 0] : (tensor<4x8xf32>) -> tensor<8x4xf32>
+//   %1 = transpose %b, dims = [1, 0] : (tensor<4x8xf32>) -> tensor<8x4xf32>
+//   %2 = add %0, %1 : tensor<8x4xf32>
+// becomes
+//   %0 = add %a, %b : tensor<4x8xf32>
+//   %2 = transpose %0, dims = [1, 0] : (tensor<4x8xf32>) -> tensor<8x4xf32>
+// Splat constants may stand in for transposes and reshapes. Transposes and
+// reshapes with other users are left alone, since sinking them would
+// duplicate them.
+template <typename ShapeOp>
+struct SinkShapeOpPastElementwise : public RewritePattern {
+  explicit SinkShapeOpPastElementwise(MLIRContext *context)
+      : RewritePattern(MatchAnyOpTypeTag(), /*benefit=*/1, context) {}
+
+  LogicalResult matchAndRewrite(Operation *op,
+                                PatternRewriter &rewriter) const override {
+    if (!isShapePreservingElementwise(op)) return failure();
+
+    ShapeOp first;
+    SmallVector<Value> operands;
+    for (Value operand : op->getOperands()) {
+      auto shapeOp = operand.getDefiningOp<ShapeOp>();
+      if (!shapeOp) {
+        if (!getSplatConstant(operand))
+          return rewriter.notifyMatchFailure(op, "expected shape ops");
+        operands.push_back(nullptr);
+        continue;
+      }
+      if (!shapeOp->hasOneUse())
+        return rewriter.notifyMatchFailure(op, "expected single use");
+      if (!first) first = shapeOp;
+      if (!isSameShapeOp(shapeOp, first))
+        return rewriter.notifyMatchFailure(op, "expected same shape ops");
+      operands.push_back(shapeOp.getOperand());
+    }
+    if (!first) return rewriter.notifyMatchFailure(op, "expected shape ops");
+
+    auto shape = first.getOperand().getType().getShape();
+    Value result = createElementwiseOp(rewriter, op, operands, shape);
+    auto resultType = op->getResult(0).getType();
+    if constexpr (std::is_same_v<ShapeOp, TransposeOp>)
+      rewriter.replaceOpWithNewOp<TransposeOp>(op, resultType, result,
+                                               first.getPermutationAttr());
+    else
+      rewriter.replaceOpWithNewOp<ReshapeOp>(op, resultType, result);
+    return success();
+  }
+
+ private:
+  static bool isSameShapeOp(ShapeOp shapeOp, ShapeOp first) {
+    if (shapeOp.getOperand().getType().getShape() !=
+        first.getOperand().getType().getShape())
+      return false;
+    if constexpr (std::is_same_v<ShapeOp, TransposeOp>)
+      return shapeOp.getPermutation() == first.getPermutation();
+    return true;
+  }
+};
+
+// Reassociates chains of associative and commutative ops so that broadcast
+// operands meet and the broadcast can be hoisted, e.g.
+//   add(add(%x, broadcast(%a)), broadcast(%b))
+// becomes
+//   add(%x, broadcast(add(%a, %b)))
+// Floating-point additions and multiplications aren't associative, so they
+// are left alone.
+template <typename OpTy>
+struct ReassociateBroadcastOperands : public OpRewritePattern<OpTy> {
+  using OpRewritePattern<OpTy>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(OpTy op,
+                                PatternRewriter &rewriter) const override {
+    auto elementType = getElementTypeOrSelf(op.getType());
+    if constexpr (std::is_same_v<OpTy, AddOp> || std::is_same_v<OpTy, MulOp>) {
+      if (!isa<IntegerType>(elementType))
+        return rewriter.notifyMatchFailure(op, "expected integer type");
+    }
+
+    for (auto [innerValue, outerValue] :
+         {std::pair(op.getLhs(), op.getRhs()),
+          std::pair(op.getRhs(), op.getLhs())}) {
+      auto outerBroadcast =
+          outerValue.template getDefiningOp<BroadcastInDimOp>();
+      auto inner = innerValue.template getDefiningOp<OpTy>();
+      if (!outerBroadcast || !inner || !inner->hasOneUse()) continue;
+
+      for (auto [innerBroadcastValue, other] :
+           {std::pair(inner.getLhs(), inner.getRhs()),
+            std::pair(inner.getRhs(), inner.getLhs())}) {
+        auto innerBroadcast =
+            innerBroadcastValue.template getDefiningOp<BroadcastInDimOp>();
+        if (!innerBroadcast ||
+            other.template getDefiningOp<BroadcastInDimOp>())
+          continue;
+        if (innerBroadcast.getOperand().getType() !=
+                outerBroadcast.getOperand().getType() ||
+            innerBroadcast.getBroadcastDimensions() !=
+                outerBroadcast.getBroadcastDimensions())
+          continue;
+
+        auto combined = rewriter.create<OpTy>(
+            op.getLoc(), innerBroadcast.getOperand(),
+            outerBroadcast.getOperand());
+        auto broadcast = rewriter.create<BroadcastInDimOp>(
+            op.getLoc(), op.getType(), combined,
+            outerBroadcast.getBroadcastDimensionsAttr());
+        rewriter.replaceOpWithNewOp<OpTy>(op, other, broadcast);
+        return success();
+      }
+    }
+    return rewriter.notifyMatchFailure(op, "no broadcasts to reassociate");
+  }
+};
+
+struct StablehloElementwiseReassociationPass
+    : public impl::StablehloElementwiseReassociationPassBase<
+          StablehloElementwiseReassociationPass> {
+  using StablehloElementwiseReassociationPassBase::
+      StablehloElementwiseReassociationPassBase;
+
+  LogicalResult initialize(MLIRContext *context) override {
+    RewritePatternSet patterns_(context);
+    populateStablehloElementwiseReassociationPatterns(&patterns_, context);
+    patterns = std::move(patterns_);
+    return success();
+  }
+
+  void runOnOperation() override {
+    // Common subexpressions are eliminated first, so that equal broadcasts
+    // and shape ops are recognized as such, and again at the end, since
+    // hoisting creates duplicates.
+    IRRewriter rewriter(&getContext());
+    auto &domInfo = getAnalysis<DominanceInfo>();
+    eliminateCommonSubExpressions(rewriter, domInfo, getOperation());
+    if (failed(applyPatternsAndFoldGreedily(getOperation(), patterns)))
+      return signalPassFailure();
+    eliminateCommonSubExpressions(rewriter, domInfo, getOperation());
+  }
+
+ private:
+  FrozenRewritePatternSet patterns;
+};
+
+}  // namespace
+
+void populateStablehloElementwiseReassociationPatterns(
+    RewritePatternSet *patterns, MLIRContext *context) {
+  patterns->add<HoistBroadcastInDimPastElementwise,
+                SinkShapeOpPastElementwise<ReshapeOp>,
+                SinkShapeOpPastElementwise<TransposeOp>>(context);
+  patterns->add<ReassociateBroadcastOperands<AddOp>,
+                ReassociateBroadcastOperands<AndOp>,
+                ReassociateBroadcastOperands<MaxOp>,
+                ReassociateBroadcastOperands<MinOp>,
+                ReassociateBroadcastOperands<MulOp>,
+                ReassociateBroadcastOperands<OrOp>,
+                ReassociateBroadcastOperands<XorOp>>(context);
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,229 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OperationSupport.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/CostAnalysis.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOFUSESIBLINGDOTSPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// The dimensions along which sibling dots are fused: the dimension of their
+// concatenated operand, and the dimension of their results it maps to.
+struct FusionDims {
+  int64_t operandDim;
+  int64_t resultDim;
+};
+
+// Returns the dimensions along which `op` can be fused with siblings whose
+// operand `index` is concatenated with its own, i.e. the first dimension of
+// this operand which is neither a batching nor a contracting dimension.
+std::optional<FusionDims> getFusionDims(DotGeneralOp op, int64_t index) {
+  auto dims = op.getDotDimensionNumbers();
+  ArrayRef<int64_t> batchingDims = index == 0
+                                       ? dims.getLhsBatchingDimensions()
+                                       : dims.getRhsBatchingDimensions();
+  ArrayRef<int64_t> contractingDims = index == 0
+                                          ? dims.getLhsContractingDimensions()
+                                          : dims.getRhsContractingDimensions();
+  // The result dimensions are the batching dimensions, followed by the free
+  // dimensions of the lhs and those of the rhs.
+  int64_t resultDim = batchingDims.size();
+  if (index == 1)
+    resultDim += cast<RankedTensorType>(op.getLhs().getType()).getRank() -
+                 dims.getLhsBatchingDimensions().size() -
+                 dims.getLhsContractingDimensions().size();
+  int64_t rank = cast<RankedTensorType>(op->getOperand(index).getType())
+                     .getRank();
+  for (int64_t dim = 0; dim < rank; ++dim)
+    if (!llvm::is_contained(batchingDims, dim) &&
+        !llvm::is_contained(contractingDims, dim))
+      return FusionDims{dim, resultDim};
+  return std::nullopt;
+}
+
+// Returns the size in bytes of operand `index` of `op` if `op` can be fused
+// with siblings along this operand, i.e. if it has static shapes and this
+// operand is at most `threshold` bytes.
+std::optional<int64_t> getFusibleSize(Operation *op, int64_t index,
+                                      int64_t threshold) {
+  auto dotOp = dyn_cast<DotGeneralOp>(op);
+  if (!dotOp || !getFusionDims(dotOp, index)) return std::nullopt;
+  auto operandType = cast<RankedTensorType>(op->getOperand(index).getType());
+  if (!operandType.hasStaticShape() ||
+      !cast<RankedTensorType>(op->getOperand(1 - index).getType())
+           .hasStaticShape() ||
+      !cast<RankedTensorType>(op->getResult(0).getType()).hasStaticShape())
+    return std::nullopt;
+  auto size = CostAnalysis::getSizeInBytes(operandType);
+  if (!size || *size > threshold) return std::nullopt;
+  return size;
+}
+
+// Returns whether `lhs` and `rhs`, which share their operand `1 - index`,
+// compute the same contraction of operands `index` which only differ along
+// the dimension they're concatenated.
+bool areFusible(DotGeneralOp lhs, DotGeneralOp rhs, int64_t index) {
+  if (lhs->getAttrDictionary() != rhs->getAttrDictionary() ||
+      getElementTypeOrSelf(lhs.getType()) !=
+          getElementTypeOrSelf(rhs.getType()))
+    return false;
+  auto lhsType = cast<RankedTensorType>(lhs->getOperand(index).getType());
+  auto rhsType = cast<RankedTensorType>(rhs->getOperand(index).getType());
+  if (lhsType.getElementType() != rhsType.getElementType()) return false;
+  int64_t operandDim = getFusionDims(lhs, index)->operandDim;
+  for (auto [dim, sizes] : llvm::enumerate(
+           llvm::zip_equal(lhsType.getShape(), rhsType.getShape())))
+    if (static_cast<int64_t>(dim) != operandDim &&
+        std::get<0>(sizes) != std::get<1>(sizes))
+      return false;
+  return true;
+}
+
+// Replaces `ops`, which share their operand `1 - index` and are fusible
+// along operand `index`, with a single dot of their concatenated operands
+// `index` right before the last of them, whose result is sliced.
+void fuse(ArrayRef<DotGeneralOp> ops, int64_t index) {
+  DotGeneralOp first = ops.front();
+  OpBuilder builder(ops.back());
+  Location loc = builder.getFusedLoc(llvm::to_vector(
+      llvm::map_range(ops, [](DotGeneralOp op) { return op->getLoc(); })));
+  FusionDims dims = *getFusionDims(first, index);
+
+  SmallVector<Value> operands;
+  for (DotGeneralOp op : ops) operands.push_back(op->getOperand(index));
+  Value concatenated =
+      builder.create<ConcatenateOp>(loc, operands, dims.operandDim);
+
+  auto getResultSize = [&](DotGeneralOp op) {
+    return cast<RankedTensorType>(op.getType()).getDimSize(dims.resultDim);
+  };
+  auto resultType = cast<RankedTensorType>(first.getType());
+  SmallVector<int64_t> resultShape(resultType.getShape());
+  resultShape[dims.resultDim] = 0;
+  for (DotGeneralOp op : ops) resultShape[dims.resultDim] += getResultSize(op);
+
+  OperationState state(loc, first->getName());
+  state.addOperands(index == 0 ? concatenated : first.getLhs());
+  state.addOperands(index == 1 ? concatenated : first.getRhs());
+  state.addTypes(
+      RankedTensorType::get(resultShape, resultType.getElementType()));
+  state.addAttributes(first->getAttrs());
+  Value fused = builder.create(state)->getResult(0);
+
+  SmallVector<int64_t> start(resultShape.size(), 0);
+  SmallVector<int64_t> limit(resultShape);
+  SmallVector<int64_t> strides(resultShape.size(), 1);
+  for (DotGeneralOp op : ops) {
+    limit[dims.resultDim] = start[dims.resultDim] + getResultSize(op);
+    Value result = builder.create<SliceOp>(
+        loc, fused, builder.getDenseI64ArrayAttr(start),
+        builder.getDenseI64ArrayAttr(limit),
+        builder.getDenseI64ArrayAttr(strides));
+    op.getResult().replaceAllUsesWith(result);
+    start[dims.resultDim] = limit[dims.resultDim];
+  }
+  for (DotGeneralOp op : ops) op->erase();
+}
+
+// Fuses the dots of `block` which share their operand `1 - index` while
+// their users all follow them, so that the fused dot doesn't delay any of
+// them.
+void fuseSiblingDots(Block &block, int64_t index, int64_t threshold) {
+  struct Group {
+    SmallVector<DotGeneralOp> ops;
+    int64_t sizeInBytes = 0;
+    bool isOpen = true;
+  };
+  SmallVector<Group> groups;
+  llvm::DenseMap<Value, SmallVector<size_t>> groupsBySharedOperand;
+  llvm::DenseMap<Operation *, size_t> groupIndices;
+
+  for (Operation &op : block) {
+    // The users of a dot must follow the fused dot, so its group can't grow
+    // anymore.
+    op.walk([&](Operation *nestedOp) {
+      for (Value operand : nestedOp->getOperands()) {
+        auto it = groupIndices.find(operand.getDefiningOp());
+        if (it != groupIndices.end()) groups[it->second].isOpen = false;
+      }
+    });
+
+    auto size = getFusibleSize(&op, index, threshold);
+    if (!size) continue;
+
+    auto dotOp = cast<DotGeneralOp>(op);
+    auto &candidates = groupsBySharedOperand[op.getOperand(1 - index)];
+    auto candidate = llvm::find_if(candidates, [&](size_t i) {
+      return groups[i].isOpen && groups[i].sizeInBytes + *size <= threshold &&
+             areFusible(groups[i].ops.front(), dotOp, index);
+    });
+    size_t groupIndex;
+    if (candidate != candidates.end()) {
+      groupIndex = *candidate;
+    } else {
+      groupIndex = groups.size();
+      groups.emplace_back();
+      candidates.push_back(groupIndex);
+    }
+    groups[groupIndex].ops.push_back(dotOp);
+    groups[groupIndex].sizeInBytes += *size;
+    groupIndices[&op] = groupIndex;
+  }
+
+  for (Group &group : groups)
+    if (group.ops.size() > 1) fuse(group.ops, index);
+}
+
+struct StablehloFuseSiblingDotsPass
+    : public impl::StablehloFuseSiblingDotsPassBase<
+          StablehloFuseSiblingDotsPass> {
+  using StablehloFuseSiblingDotsPassBase::StablehloFuseSiblingDotsPassBase;
+
+  void runOnOperation() override {
+    SmallVector<Block *> blocks;
+    getOperation().walk([&](Block *block) { blocks.push_back(block); });
+    // Dots sharing their lhs, e.g. the projections of attention, are fused
+    // first, and the resulting dots may then share their rhs.
+    for (Block *block : blocks) {
+      fuseSiblingDots(*block, /*index=*/1, threshold);
+      fuseSiblingDots(*block, /*index=*/0, threshold);
+    }
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,132 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Value.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOINLINECOMPOSITESPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Returns the number of ops in the body of `func`, excluding terminators.
+int64_t getNumOps(func::FuncOp func) {
+  int64_t numOps = 0;
+  func.getBody().walk([&](Operation *op) {
+    if (!op->hasTrait<OpTrait::IsTerminator>()) ++numOps;
+  });
+  return numOps;
+}
+
+// Replaces `op` with a copy of the body of `decomposition`.
+void inlineComposite(CompositeOp op, func::FuncOp decomposition,
+                     RewriterBase &rewriter) {
+  Block &body = decomposition.getBody().front();
+  IRMapping mapping;
+  mapping.map(body.getArguments(), op.getOperands());
+  rewriter.setInsertionPoint(op);
+  for (Operation &nested : body.without_terminator())
+    rewriter.clone(nested, mapping);
+  auto results = llvm::map_to_vector(
+      body.getTerminator()->getOperands(),
+      [&](Value result) { return mapping.lookupOrDefault(result); });
+  rewriter.replaceOp(op, results);
+}
+
+struct StablehloInlineCompositesPass
+    : public impl::StablehloInlineCompositesPassBase<
+          StablehloInlineCompositesPass> {
+  using StablehloInlineCompositesPassBase::StablehloInlineCompositesPassBase;
+
+  StablehloInlineCompositesPass(CompositeCostModel costModel)
+      : StablehloInlineCompositesPassBase(), costModel(std::move(costModel)) {}
+
+  void runOnOperation() override {
+    ModuleOp module = getOperation();
+    SymbolTable symbolTable(module);
+
+    DenseSet<StringRef> excludedNames(exceptListOption.begin(),
+                                      exceptListOption.end());
+    CompositeCostModel legalize = costModel;
+    if (!legalize) {
+      legalize = [&](CompositeOp op, func::FuncOp decomposition) {
+        if (!excludedNames.contains(op.getName()) && decomposition &&
+            getNumOps(decomposition) <= opLimit)
+          return CompositeLegalization::kInline;
+        return CompositeLegalization::kKeep;
+      };
+    }
+
+    // Composites are collected up front, so that the ones in copied bodies
+    // aren't inlined again.
+    SmallVector<CompositeOp> composites;
+    module.walk([&](CompositeOp op) { composites.push_back(op); });
+
+    IRRewriter rewriter(&getContext());
+    for (CompositeOp op : composites) {
+      auto decomposition =
+          symbolTable.lookup<func::FuncOp>(op.getDecomposition());
+      switch (legalize(op, decomposition)) {
+        case CompositeLegalization::kKeep:
+          break;
+        case CompositeLegalization::kInline:
+          // Decompositions with multiple blocks are called instead.
+          if (decomposition && decomposition.getBody().hasOneBlock()) {
+            inlineComposite(op, decomposition, rewriter);
+            break;
+          }
+          [[fallthrough]];
+        case CompositeLegalization::kCall:
+          rewriter.setInsertionPoint(op);
+          rewriter.replaceOpWithNewOp<func::CallOp>(op, op.getResultTypes(),
+                                                    op.getDecomposition(),
+                                                    op.getOperands());
+          break;
+      }
+    }
+  }
+
+ private:
+  CompositeCostModel costModel;
+};
+
+}  // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>> createStablehloInlineCompositesPass(
+    CompositeCostModel costModel) {
+  return std::make_unique<StablehloInlineCompositesPass>(std::move(costModel));
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
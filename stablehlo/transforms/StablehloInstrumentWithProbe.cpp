@@ -13,11 +13,16 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <optional>
 #include <string>
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Regex.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/Value.h"
+#include "mlir/Support/DebugStringHelper.h"
 #include "mlir/Support/LLVM.h"
 #include "stablehlo/dialect/StablehloOps.h"
 #include "stablehlo/reference/InterpreterOps.h"
@@ -57,8 +62,10 @@ class StablehloInstrumentWithProbePass
 
   // Determine if a given operation is suitable for instrumentation. A suitable
   // operation is defined as any operation which is not a ConstantOp, and that
-  // has at least 1 return value.
-  bool shouldProbeOp(Operation& op) const;
+  // has at least 1 return value, and which passes the filters of the pass
+  // options, where `locationRegex` is the compiled `locationRegexOption`, if
+  // set.
+  bool shouldProbeOp(Operation& op, const llvm::Regex* locationRegex) const;
 
   // Determine if a given value can be instrumented. Only values that are of
   // TensorType are suitable for instrumentation
@@ -83,7 +90,9 @@ void StablehloInstrumentWithProbePass::probeValue(Value value,
                                                   OpBuilder& builder) {
   builder.setInsertionPointAfterValue(value);
   Value instrumentedValue = builder.create<interpreter::ProbeOp>(
-      value.getLoc(), value, StringAttr::get(&getContext(), probe_id));
+      value.getLoc(), value, StringAttr::get(&getContext(), probe_id),
+      summarizeOption ? builder.getUnitAttr() : UnitAttr(),
+      digestOption ? builder.getUnitAttr() : UnitAttr());
   value.replaceAllUsesExcept(instrumentedValue,
                              instrumentedValue.getDefiningOp());
 }
@@ -92,12 +101,28 @@ void StablehloInstrumentWithProbePass::runOnOperation() {
   ModuleOp module = getOperation();
   OpBuilder builder(module);
 
+  if (summarizeOption && digestOption) {
+    module.emitError("summarize and digest cannot both be set");
+    return signalPassFailure();
+  }
+
+  std::optional<llvm::Regex> locationRegex;
+  if (!locationRegexOption.empty()) {
+    locationRegex.emplace(locationRegexOption);
+    std::string error;
+    if (!locationRegex->isValid(error)) {
+      module.emitError("invalid location-regex: ") << error;
+      return signalPassFailure();
+    }
+  }
+
   // Strictly increasing counter to uniquely identify probe operations when MLIR
   // location data is not available/used.
   unsigned int probeId = 0;
 
   module.walk([&](Operation* op) {
-    if (!shouldProbeOp(*op)) return WalkResult::advance();
+    if (!shouldProbeOp(*op, locationRegex ? &*locationRegex : nullptr))
+      return WalkResult::advance();
 
     for (auto res : op->getResults()) {
       if (shouldProbeValue(res))
@@ -109,13 +134,31 @@ void StablehloInstrumentWithProbePass::runOnOperation() {
   });
 }
 
-bool StablehloInstrumentWithProbePass::shouldProbeOp(Operation& op) const {
+bool StablehloInstrumentWithProbePass::shouldProbeOp(
+    Operation& op, const llvm::Regex* locationRegex) const {
   if (isa<ConstantOp>(op)) return false;
 
   // Operations that do not produce values should not be instrumented
   // (ReturnOp, CustomCallOp with no result, etc)
   if (op.getNumResults() == 0) return false;
 
+  if (!opNamesOption.empty() &&
+      !llvm::is_contained(opNamesOption, op.getName().getStringRef()))
+    return false;
+
+  if (!functionsOption.empty()) {
+    auto funcOp = op.getParentOfType<func::FuncOp>();
+    if (!funcOp || !llvm::is_contained(functionsOption, funcOp.getSymName()))
+      return false;
+  }
+
+  if (locationRegex && !locationRegex->match(debugString(op.getLoc())))
+    return false;
+
+  // The values of loops are probed once they leave the outermost loop, i.e.
+  // as its results.
+  if (loopExitsOnlyOption && op.getParentOfType<WhileOp>()) return false;
+
   return true;
 }
 
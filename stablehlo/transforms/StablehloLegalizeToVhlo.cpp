@@ -85,8 +85,25 @@ class StablehloToVhloTypeConverter : public vhlo::VhloTypeConverter {
   if (!vhloValue.has_value()) return {};                             \
   return vhlo::Name##Version##Attr::get(attr.getContext(), vhloValue.value())
 
+Attribute convertGenericUncached(Attribute stablehloAttr,
+                                 const TypeConverter* typeConverter);
+
+// Converts attributes which have a 1:1 mapping, memoizing the conversions in
+// the type converter, which is always a VhloTypeConverterBase.
 Attribute convertGeneric(Attribute stablehloAttr,
                          const TypeConverter* typeConverter) {
+  auto* vhloTypeConverter =
+      static_cast<const vhlo::VhloTypeConverterBase*>(typeConverter);
+  if (auto cachedAttr = vhloTypeConverter->lookupAttribute(stablehloAttr))
+    return cachedAttr;
+  auto convertedAttr = convertGenericUncached(stablehloAttr, typeConverter);
+  if (convertedAttr)
+    vhloTypeConverter->cacheAttribute(stablehloAttr, convertedAttr);
+  return convertedAttr;
+}
+
+Attribute convertGenericUncached(Attribute stablehloAttr,
+                                 const TypeConverter* typeConverter) {
   // Handle StableHLO attributes.
   // The logic that handles attributes from other dialects (e.g. builtin
   // attributes) lives below.
@@ -138,8 +155,8 @@ Attribute convertGeneric(Attribute stablehloAttr,
     auto vhloType = typeConverter->convertType(attr.getType());
     LLVM_DEBUG(llvm::dbgs() << "Converted " << vhloType << '\n');
     if (!vhloType) return {};
-    return vhlo::TensorV1Attr::get(attr.getContext(), vhloType,
-                                   attr.getRawData());
+    // References the data of `attr` rather than copying it.
+    return vhlo::TensorV1Attr::get(attr.getContext(), vhloType, attr);
   }
   if (auto attr = dyn_cast<DenseI64ArrayAttr>(stablehloAttr)) {
     // Leverage the serialization for DenseElements.
@@ -912,6 +929,7 @@ struct StablehloLegalizeToVhloPass
   }
 
   void runOnOperation() override {
+    converter.clearAttributeCache();
     // StableHLO should always be convertible to VHLO.
     if (failed(applyPartialConversion(getOperation(), *target, patterns))) {
       LLVM_DEBUG(llvm::dbgs() << "Failed partial conversion\n");
@@ -0,0 +1,181 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOMERGESIBLINGREDUCESPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Returns the static shape of the inputs of `op` if it can be merged with
+// siblings, i.e. if its body is a single block ending with a return.
+std::optional<ArrayRef<int64_t>> getMergeableShape(Operation *op) {
+  auto reduceOp = dyn_cast<ReduceOp>(op);
+  if (!reduceOp || !reduceOp.getBody().hasOneBlock() ||
+      !isa<ReturnOp>(reduceOp.getBody().front().getTerminator()))
+    return std::nullopt;
+  auto inputType = cast<ShapedType>(reduceOp.getInputs().front().getType());
+  if (!inputType.hasStaticShape()) return std::nullopt;
+  return inputType.getShape();
+}
+
+// Returns whether `lhs` and `rhs` reduce inputs of the same shape over the
+// same dimensions, which a single variadic reduce requires.
+bool areMergeable(ReduceOp lhs, ReduceOp rhs) {
+  return lhs.getDimensions() == rhs.getDimensions() &&
+         *getMergeableShape(lhs) == *getMergeableShape(rhs);
+}
+
+// Replaces `ops`, which are mergeable, with a single variadic reduce of all
+// their inputs right before the last of them, whose body computes each of
+// their bodies on its own arguments.
+void merge(ArrayRef<ReduceOp> ops) {
+  OpBuilder builder(ops.back());
+  Location loc = builder.getFusedLoc(llvm::to_vector(
+      llvm::map_range(ops, [](ReduceOp op) { return op->getLoc(); })));
+
+  SmallVector<Value> inputs, initValues;
+  SmallVector<Type> elementTypes;
+  for (ReduceOp op : ops) {
+    llvm::append_range(inputs, op.getInputs());
+    llvm::append_range(initValues, op.getInitValues());
+    for (Type type : op.getResultTypes())
+      elementTypes.push_back(getElementTypeOrSelf(type));
+  }
+  auto merged = builder.create<ReduceOp>(
+      loc, inputs, initValues, ops.front().getDimensionsAttr(), elementTypes);
+
+  // The arguments of the merged body are the accumulators of all ops,
+  // followed by the elements of all their inputs, in the order of the ops.
+  Block *body = builder.createBlock(&merged.getBody());
+  SmallVector<BlockArgument> accumulators, elements;
+  for (ReduceOp op : ops) {
+    Block &opBody = op.getBody().front();
+    size_t numInputs = op.getInputs().size();
+    for (BlockArgument arg : opBody.getArguments().take_front(numInputs))
+      accumulators.push_back(body->addArgument(arg.getType(), arg.getLoc()));
+  }
+  for (ReduceOp op : ops) {
+    Block &opBody = op.getBody().front();
+    size_t numInputs = op.getInputs().size();
+    for (BlockArgument arg : opBody.getArguments().drop_front(numInputs))
+      elements.push_back(body->addArgument(arg.getType(), arg.getLoc()));
+  }
+
+  SmallVector<Value> results;
+  SmallVector<Location> returnLocs;
+  size_t offset = 0;
+  for (ReduceOp op : ops) {
+    Block &opBody = op.getBody().front();
+    size_t numInputs = op.getInputs().size();
+    IRMapping mapping;
+    for (size_t i = 0; i < numInputs; ++i) {
+      mapping.map(opBody.getArgument(i), accumulators[offset + i]);
+      mapping.map(opBody.getArgument(numInputs + i), elements[offset + i]);
+    }
+    for (Operation &bodyOp : opBody.without_terminator())
+      builder.clone(bodyOp, mapping);
+    for (Value result : opBody.getTerminator()->getOperands())
+      results.push_back(mapping.lookupOrDefault(result));
+    returnLocs.push_back(opBody.getTerminator()->getLoc());
+    offset += numInputs;
+  }
+  builder.create<ReturnOp>(builder.getFusedLoc(returnLocs), results);
+
+  offset = 0;
+  for (ReduceOp op : ops) {
+    op->replaceAllUsesWith(
+        merged->getResults().slice(offset, op->getNumResults()));
+    offset += op->getNumResults();
+    op->erase();
+  }
+}
+
+// Merges the reduces of `block` which are mergeable while their users all
+// follow them, so that the merged reduce doesn't delay any of them.
+void mergeSiblingReduces(Block &block) {
+  struct Group {
+    SmallVector<ReduceOp> ops;
+    bool isOpen = true;
+  };
+  SmallVector<Group> groups;
+  llvm::DenseMap<Operation *, size_t> groupIndices;
+
+  for (Operation &op : block) {
+    // The users of a reduce, e.g. a reduce of values computed from its
+    // result, must follow the merged reduce, so its group can't grow anymore.
+    op.walk([&](Operation *nestedOp) {
+      for (Value operand : nestedOp->getOperands()) {
+        auto it = groupIndices.find(operand.getDefiningOp());
+        if (it != groupIndices.end()) groups[it->second].isOpen = false;
+      }
+    });
+
+    if (!getMergeableShape(&op)) continue;
+
+    auto reduceOp = cast<ReduceOp>(op);
+    auto *group = llvm::find_if(groups, [&](const Group &group) {
+      return group.isOpen && areMergeable(group.ops.front(), reduceOp);
+    });
+    if (group == groups.end()) {
+      groups.emplace_back();
+      group = &groups.back();
+    }
+    group->ops.push_back(reduceOp);
+    groupIndices[&op] = group - groups.begin();
+  }
+
+  for (Group &group : groups)
+    if (group.ops.size() > 1) merge(group.ops);
+}
+
+struct StablehloMergeSiblingReducesPass
+    : public impl::StablehloMergeSiblingReducesPassBase<
+          StablehloMergeSiblingReducesPass> {
+  using StablehloMergeSiblingReducesPassBase::
+      StablehloMergeSiblingReducesPassBase;
+
+  void runOnOperation() override {
+    SmallVector<Block *> blocks;
+    getOperation().walk([&](Block *block) { blocks.push_back(block); });
+    for (Block *block : blocks) mergeSiblingReduces(*block);
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
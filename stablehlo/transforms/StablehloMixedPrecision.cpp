@@ -0,0 +1,120 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/FoldUtils.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOMIXEDPRECISIONPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Returns whether the f32 operands of `op` are converted to a narrower type
+// under the policy of the pass, i.e. if it's one of `opNames` whose operands
+// and result are f32 tensors and whose operands have at least `minElements`
+// elements in total.
+bool isConvertible(Operation *op, ArrayRef<std::string> opNames,
+                   int64_t minElements) {
+  if (!isa<DotGeneralOp, ConvolutionOp>(op)) return false;
+  if (!opNames.empty() &&
+      !llvm::is_contained(opNames, op->getName().getStringRef()))
+    return false;
+  if (!getElementTypeOrSelf(op->getResult(0)).isF32()) return false;
+  int64_t numElements = 0;
+  for (Value operand : op->getOperands()) {
+    auto type = dyn_cast<RankedTensorType>(operand.getType());
+    if (!type || !type.getElementType().isF32()) return false;
+    if (!type.hasStaticShape()) return minElements <= 0;
+    numElements += type.getNumElements();
+  }
+  return numElements >= minElements;
+}
+
+// Returns `value` converted to `elementType`. Converts of values which were
+// losslessly converted from `elementType`, e.g. from bf16 to f32, are
+// cancelled like `ConvertOpCanon` does, and the original values are used.
+Value convert(OpBuilder &builder, Location loc, Value value,
+              Type elementType) {
+  if (auto convertOp = value.getDefiningOp<ConvertOp>()) {
+    Value operand = convertOp.getOperand();
+    if (getElementTypeOrSelf(operand) == elementType &&
+        isLosslessFloatConversion(elementType, getElementTypeOrSelf(value)))
+      return operand;
+  }
+  auto type = cast<ShapedType>(value.getType()).clone(elementType);
+  return builder.create<ConvertOp>(loc, type, value);
+}
+
+struct StablehloMixedPrecisionPass
+    : public impl::StablehloMixedPrecisionPassBase<
+          StablehloMixedPrecisionPass> {
+  using StablehloMixedPrecisionPassBase::StablehloMixedPrecisionPassBase;
+
+  void runOnOperation() override {
+    func::FuncOp func = getOperation();
+    Builder builder(&getContext());
+    Type elementType;
+    if (elementTypeOption == "bf16") elementType = builder.getBF16Type();
+    if (elementTypeOption == "f16") elementType = builder.getF16Type();
+    if (!elementType) {
+      func.emitError("invalid element-type: ") << elementTypeOption;
+      return signalPassFailure();
+    }
+
+    SmallVector<std::string> opNames(opNamesOption.begin(),
+                                     opNamesOption.end());
+    SmallVector<Operation *> ops;
+    func.walk([&](Operation *op) {
+      if (isConvertible(op, opNames, minElementsOption)) ops.push_back(op);
+    });
+
+    // The results keep their f32 element type, so that ops accumulate in f32.
+    llvm::SetVector<Operation *> convertOps;
+    for (Operation *op : ops) {
+      OpBuilder opBuilder(op);
+      for (OpOperand &operand : op->getOpOperands()) {
+        if (auto convertOp = operand.get().getDefiningOp<ConvertOp>())
+          convertOps.insert(convertOp);
+        operand.set(
+            convert(opBuilder, op->getLoc(), operand.get(), elementType));
+      }
+    }
+
+    // Converts to f32 which were cancelled may be left without users.
+    for (Operation *convertOp : llvm::reverse(convertOps))
+      if (convertOp->use_empty()) convertOp->erase();
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,296 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <utility>
+
+#include "llvm/ADT/APSInt.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOOPTIMIZEWHILELOOPSPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Returns whether `value` is defined outside of `whileOp`, or inside of `op`.
+bool isDefinedOutsideOrIn(Value value, WhileOp whileOp, Operation *op) {
+  Operation *parent = value.getParentRegion()->getParentOp();
+  return !whileOp->isAncestor(parent) || op->isAncestor(parent);
+}
+
+// Moves the pure ops of the cond and body of while ops whose operands are
+// defined outside of the loop before the loop, so that they are evaluated
+// once rather than on every iteration. Pure ops are speculatable, so they
+// can be evaluated even if the loop has no iterations.
+struct HoistLoopInvariantOps : public OpRewritePattern<WhileOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(WhileOp op,
+                                PatternRewriter &rewriter) const override {
+    SmallVector<Operation *> invariantOps;
+    for (Region &region : op->getRegions()) {
+      for (Operation &nested :
+           llvm::make_early_inc_range(region.front().without_terminator())) {
+        if (!isPure(&nested)) continue;
+        auto isInvariant = nested.walk([&](Operation *nestedOp) {
+          for (Value operand : nestedOp->getOperands())
+            if (!isDefinedOutsideOrIn(operand, op, &nested))
+              return WalkResult::interrupt();
+          return WalkResult::advance();
+        });
+        if (isInvariant.wasInterrupted()) continue;
+        // Moves the op right away, so that its users can be moved too.
+        rewriter.moveOpBefore(&nested, op);
+        invariantOps.push_back(&nested);
+      }
+    }
+    return success(!invariantOps.empty());
+  }
+};
+
+// Replaces loop-carried values which every iteration leaves unchanged with
+// their initial values, so that the loop doesn't carry them anymore once
+// they're dead. This includes values which every iteration sets to the same
+// constant as their initial value.
+struct ForwardInvariantLoopCarriedValues : public OpRewritePattern<WhileOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(WhileOp op,
+                                PatternRewriter &rewriter) const override {
+    Block &cond = op.getCond().front();
+    Block &body = op.getBody().front();
+    Operation *terminator = body.getTerminator();
+
+    bool changed = false;
+    for (auto [i, init] : llvm::enumerate(op.getOperand())) {
+      Value next = terminator->getOperand(i);
+      Value arg = body.getArgument(i);
+      if (next != arg && next != init && !isSameConstant(next, init)) continue;
+      if (init.getType() != arg.getType() ||
+          init.getType() != op->getResult(i).getType())
+        continue;
+
+      Value condArg = cond.getArgument(i);
+      Value result = op->getResult(i);
+      if (arg.use_empty() && condArg.use_empty() && result.use_empty())
+        continue;
+      rewriter.replaceAllUsesWith(arg, init);
+      rewriter.replaceAllUsesWith(condArg, init);
+      rewriter.replaceAllUsesWith(result, init);
+      changed = true;
+    }
+    return success(changed);
+  }
+
+ private:
+  static bool isSameConstant(Value lhs, Value rhs) {
+    Attribute lhsAttr, rhsAttr;
+    return matchPattern(lhs, m_Constant(&lhsAttr)) &&
+           matchPattern(rhs, m_Constant(&rhsAttr)) && lhsAttr == rhsAttr;
+  }
+};
+
+// Unrolls while ops whose trip count is a small constant by cloning their
+// body once per iteration.
+//
+// The trip count is known for loops with a scalar integer induction variable
+// which starts from a constant, is incremented by a constant in the body, and
+// is compared to a constant in the cond. The cond must have no other effect.
+struct UnrollSmallWhileLoops : public OpRewritePattern<WhileOp> {
+  UnrollSmallWhileLoops(MLIRContext *context, int64_t opLimit)
+      : OpRewritePattern(context), opLimit(opLimit) {}
+
+  LogicalResult matchAndRewrite(WhileOp op,
+                                PatternRewriter &rewriter) const override {
+    Block &body = op.getBody().front();
+    int64_t numBodyOps = std::max<int64_t>(
+        1, std::distance(body.without_terminator().begin(),
+                         body.without_terminator().end()));
+    int64_t maxTripCount = opLimit / numBodyOps;
+    auto tripCount = getTripCount(op, maxTripCount);
+    if (!tripCount)
+      return rewriter.notifyMatchFailure(op, "unknown or large trip count");
+
+    SmallVector<Value> values(op.getOperand());
+    rewriter.setInsertionPoint(op);
+    for (int64_t iteration = 0; iteration < *tripCount; ++iteration) {
+      IRMapping mapping;
+      mapping.map(body.getArguments(), values);
+      for (Operation &bodyOp : body.without_terminator())
+        rewriter.clone(bodyOp, mapping);
+      values = llvm::map_to_vector(
+          body.getTerminator()->getOperands(),
+          [&](Value value) { return mapping.lookupOrDefault(value); });
+    }
+    rewriter.replaceOp(op, values);
+    return success();
+  }
+
+ private:
+  // Returns the trip count of `op` if it's at most `maxTripCount`.
+  static std::optional<int64_t> getTripCount(WhileOp op,
+                                             int64_t maxTripCount) {
+    Block &cond = op.getCond().front();
+    if (!llvm::all_of(cond.without_terminator(), [](Operation &nested) {
+          return isMemoryEffectFree(&nested);
+        }))
+      return std::nullopt;
+    auto compare =
+        cond.getTerminator()->getOperand(0).getDefiningOp<CompareOp>();
+    if (!compare) return std::nullopt;
+
+    // Finds the induction variable and the limit it's compared to, in this
+    // order.
+    auto direction = compare.getComparisonDirection();
+    auto arg = dyn_cast<BlockArgument>(compare.getLhs());
+    Value limit = compare.getRhs();
+    if (!arg || arg.getOwner() != &cond) {
+      arg = dyn_cast<BlockArgument>(compare.getRhs());
+      limit = compare.getLhs();
+      direction = swapDirection(direction);
+    }
+    if (!arg || arg.getOwner() != &cond) return std::nullopt;
+    unsigned index = arg.getArgNumber();
+
+    auto type = dyn_cast<RankedTensorType>(arg.getType());
+    if (!type || type.getRank() != 0 ||
+        !isa<IntegerType>(type.getElementType()))
+      return std::nullopt;
+    bool isUnsigned = type.getElementType().isUnsignedInteger();
+
+    // The body must increment the induction variable by a constant.
+    Block &body = op.getBody().front();
+    auto add = body.getTerminator()->getOperand(index).getDefiningOp<AddOp>();
+    if (!add) return std::nullopt;
+    Value step = add.getRhs();
+    if (add.getLhs() != body.getArgument(index)) {
+      if (add.getRhs() != body.getArgument(index)) return std::nullopt;
+      step = add.getLhs();
+    }
+
+    auto getConstant = [&](Value value) -> std::optional<APSInt> {
+      DenseIntElementsAttr attr;
+      if (!matchPattern(value, m_Constant(&attr))) return std::nullopt;
+      return APSInt(attr.getSplatValue<APInt>(), isUnsigned);
+    };
+    auto counter = getConstant(op.getOperand()[index]);
+    auto limitValue = getConstant(limit);
+    auto stepValue = getConstant(step);
+    if (!counter || !limitValue || !stepValue) return std::nullopt;
+
+    // Evaluates the loop, whose trip count is bounded by `maxTripCount`, with
+    // the wraparound semantics of stablehlo.add.
+    for (int64_t tripCount = 0; tripCount <= maxTripCount; ++tripCount) {
+      if (!compareValues(direction, *counter, *limitValue)) return tripCount;
+      *counter = APSInt(*counter + *stepValue, isUnsigned);
+    }
+    return std::nullopt;
+  }
+
+  static ComparisonDirection swapDirection(ComparisonDirection direction) {
+    switch (direction) {
+      case ComparisonDirection::GE:
+        return ComparisonDirection::LE;
+      case ComparisonDirection::GT:
+        return ComparisonDirection::LT;
+      case ComparisonDirection::LE:
+        return ComparisonDirection::GE;
+      case ComparisonDirection::LT:
+        return ComparisonDirection::GT;
+      default:
+        return direction;
+    }
+  }
+
+  static bool compareValues(ComparisonDirection direction, const APSInt &lhs,
+                            const APSInt &rhs) {
+    switch (direction) {
+      case ComparisonDirection::EQ:
+        return lhs == rhs;
+      case ComparisonDirection::NE:
+        return lhs != rhs;
+      case ComparisonDirection::GE:
+        return lhs >= rhs;
+      case ComparisonDirection::GT:
+        return lhs > rhs;
+      case ComparisonDirection::LE:
+        return lhs <= rhs;
+      case ComparisonDirection::LT:
+        return lhs < rhs;
+    }
+    llvm_unreachable("unknown comparison direction");
+  }
+
+  int64_t opLimit;
+};
+
+struct StablehloOptimizeWhileLoopsPass
+    : public impl::StablehloOptimizeWhileLoopsPassBase<
+          StablehloOptimizeWhileLoopsPass> {
+  using StablehloOptimizeWhileLoopsPassBase::
+      StablehloOptimizeWhileLoopsPassBase;
+
+  LogicalResult initialize(MLIRContext *context) override {
+    RewritePatternSet patterns_(context);
+    populateStablehloOptimizeWhileLoopsPatterns(&patterns_, context,
+                                                unrollOpLimit);
+    patterns = std::move(patterns_);
+    return success();
+  }
+
+  void runOnOperation() override {
+    if (failed(applyPatternsAndFoldGreedily(getOperation(), patterns)))
+      signalPassFailure();
+  }
+
+ private:
+  FrozenRewritePatternSet patterns;
+};
+
+}  // namespace
+
+void populateStablehloOptimizeWhileLoopsPatterns(RewritePatternSet *patterns,
+                                                 MLIRContext *context,
+                                                 int64_t unrollOpLimit) {
+  patterns->add<ForwardInvariantLoopCarriedValues, HoistLoopInvariantOps>(
+      context);
+  if (unrollOpLimit > 0)
+    patterns->add<UnrollSmallWhileLoops>(context, unrollOpLimit);
+  // Forwarded and hoisted values leave dead loop-carried values behind.
+  populateStablehloRemoveDeadValuesPatterns(patterns, context);
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
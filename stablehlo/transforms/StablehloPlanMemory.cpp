@@ -0,0 +1,71 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/transforms/MemoryPlanning.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOPLANMEMORYPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+struct StablehloPlanMemoryPass
+    : public impl::StablehloPlanMemoryPassBase<StablehloPlanMemoryPass> {
+  using StablehloPlanMemoryPassBase::StablehloPlanMemoryPassBase;
+
+  void runOnOperation() override {
+    if (alignment <= 0) {
+      getOperation().emitError("alignment must be positive");
+      return signalPassFailure();
+    }
+
+    Builder builder(&getContext());
+    for (auto func : getOperation().getOps<func::FuncOp>()) {
+      auto plan = planMemory(func, alignment);
+      if (failed(plan)) return signalPassFailure();
+
+      func->setAttr("stablehlo.arena_size",
+                    builder.getI64IntegerAttr(plan->arenaSize));
+      func->setAttr("stablehlo.peak_live_bytes",
+                    builder.getI64IntegerAttr(plan->peakLiveBytes));
+      func.walk([&](Operation *op) {
+        if (op->getNumResults() == 0) return;
+        SmallVector<int64_t> offsets;
+        for (Value result : op->getResults()) {
+          const BufferAssignment *buffer = plan->lookup(result);
+          offsets.push_back(buffer ? buffer->offset : -1);
+        }
+        op->setAttr("stablehlo.buffer_offsets",
+                    builder.getDenseI64ArrayAttr(offsets));
+      });
+    }
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,381 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <type_traits>
+
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Sequence.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/RegionUtils.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLORECOGNIZECOMPOSITESPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// A decomposed op computing `root` from `inputs`, which becomes a composite.
+struct Match {
+  StringRef name;
+  Value root;
+  SmallVector<Value> inputs;
+  SmallVector<NamedAttribute> attributes;
+};
+
+// Returns the value of the float splat `value`, which may be broadcast.
+std::optional<APFloat> getSplatFloat(Value value) {
+  if (auto broadcast = value.getDefiningOp<BroadcastInDimOp>())
+    value = broadcast.getOperand();
+  DenseFPElementsAttr attr;
+  if (!matchPattern(value, m_Constant(&attr)) || !attr.isSplat())
+    return std::nullopt;
+  return attr.getSplatValue<APFloat>();
+}
+
+// Returns whether `value` is the initial value of a max, i.e. -inf or the
+// lowest finite float.
+bool isMaxInitValue(Value value) {
+  auto init = getSplatFloat(value);
+  return init && init->isNegative() &&
+         (init->isInfinity() ||
+          *init == APFloat::getLargest(init->getSemantics(), true));
+}
+
+// Returns whether `value` is a float splat of `expected`.
+bool isSplatFloatOf(Value value, double expected) {
+  auto splat = getSplatFloat(value);
+  return splat && splat->convertToDouble() == expected;
+}
+
+// Returns whether `op` reduces a single input with a body applying `OpTy` to
+// its arguments, starting from the neutral element of an add or max.
+template <typename OpTy>
+bool isReductionOf(ReduceOp op) {
+  if (!op || op.getInputs().size() != 1 || !op.getBody().hasOneBlock())
+    return false;
+  Block &body = op.getBody().front();
+  auto bodyOp = dyn_cast<OpTy>(&body.front());
+  if (!bodyOp || &body.front() == body.getTerminator() ||
+      bodyOp->getNextNode() != body.getTerminator() ||
+      body.getTerminator()->getOperands() != bodyOp->getResults())
+    return false;
+  Value lhs = bodyOp->getOperand(0), rhs = bodyOp->getOperand(1);
+  if (!(lhs == body.getArgument(0) && rhs == body.getArgument(1)) &&
+      !(lhs == body.getArgument(1) && rhs == body.getArgument(0)))
+    return false;
+  if constexpr (std::is_same_v<OpTy, AddOp>)
+    return isSplatFloatOf(op.getInitValues().front(), 0.0);
+  return isMaxInitValue(op.getInitValues().front());
+}
+
+// Returns the op of type `OpTy` defining the value which `value` broadcasts,
+// looking through a reshape which keeps reduced dimensions as unit dimensions.
+template <typename OpTy>
+OpTy getBroadcastSource(Value value) {
+  auto broadcast = value.getDefiningOp<BroadcastInDimOp>();
+  if (!broadcast) return {};
+  Value source = broadcast.getOperand();
+  if (auto reshape = source.getDefiningOp<ReshapeOp>())
+    source = reshape.getOperand();
+  return source.getDefiningOp<OpTy>();
+}
+
+// Returns whether `value` broadcasts a value reduced over `dimensions` back to
+// the shape of `input`, as `getBroadcastSource` looks through it.
+bool isBroadcastOfReduced(Value value, Value input,
+                          ArrayRef<int64_t> dimensions) {
+  auto broadcast = value.getDefiningOp<BroadcastInDimOp>();
+  auto inputType = cast<ShapedType>(input.getType());
+  if (!broadcast || broadcast.getType() != inputType ||
+      !inputType.hasStaticShape())
+    return false;
+
+  // Without a reshape, the broadcast adds the reduced dimensions back.
+  ArrayRef<int64_t> broadcastDims = broadcast.getBroadcastDimensions();
+  auto operandType = cast<ShapedType>(broadcast.getOperand().getType());
+  if (operandType.getRank() + static_cast<int64_t>(dimensions.size()) ==
+      inputType.getRank()) {
+    SmallVector<int64_t> keptDims;
+    for (int64_t dim = 0; dim < inputType.getRank(); ++dim)
+      if (!llvm::is_contained(dimensions, dim)) keptDims.push_back(dim);
+    return broadcastDims == ArrayRef<int64_t>(keptDims);
+  }
+
+  // With a reshape, the reduced dimensions are unit dimensions.
+  if (!broadcast.getOperand().getDefiningOp<ReshapeOp>() ||
+      operandType.getRank() != inputType.getRank())
+    return false;
+  for (int64_t dim = 0; dim < inputType.getRank(); ++dim) {
+    int64_t expected = llvm::is_contained(dimensions, dim)
+                           ? 1
+                           : inputType.getDimSize(dim);
+    if (broadcastDims[dim] != dim || operandType.getDimSize(dim) != expected)
+      return false;
+  }
+  return true;
+}
+
+// Returns the number of elements of `value` reduced over `dimensions`.
+int64_t getNumReducedElements(Value value, ArrayRef<int64_t> dimensions) {
+  auto type = cast<ShapedType>(value.getType());
+  int64_t numElements = 1;
+  for (int64_t dim : dimensions) numElements *= type.getDimSize(dim);
+  return numElements;
+}
+
+// softmax(x) = exp(x - max(x)) / sum(exp(x - max(x)))
+std::optional<Match> matchSoftmax(Operation *op) {
+  auto div = dyn_cast_or_null<DivOp>(op);
+  if (!div || !isa<FloatType>(getElementTypeOrSelf(div.getType())))
+    return std::nullopt;
+  auto exp = div.getLhs().getDefiningOp<ExpOp>();
+  auto sum = getBroadcastSource<ReduceOp>(div.getRhs());
+  if (!exp || !isReductionOf<AddOp>(sum) || sum.getInputs().front() != exp ||
+      !isBroadcastOfReduced(div.getRhs(), exp, sum.getDimensions()))
+    return std::nullopt;
+
+  auto sub = exp.getOperand().getDefiningOp<SubtractOp>();
+  if (!sub) return std::nullopt;
+  Value input = sub.getLhs();
+  auto max = getBroadcastSource<ReduceOp>(sub.getRhs());
+  if (!isReductionOf<MaxOp>(max) || max.getInputs().front() != input ||
+      max.getDimensions() != sum.getDimensions() ||
+      !isBroadcastOfReduced(sub.getRhs(), input, max.getDimensions()))
+    return std::nullopt;
+
+  Builder builder(op->getContext());
+  return Match{"stablehlo.softmax",
+               div,
+               {input},
+               {builder.getNamedAttr("dimensions", sum.getDimensionsAttr())}};
+}
+
+// layer_norm(x) = (x - mean(x)) * rsqrt(mean((x - mean(x))^2) + epsilon)
+std::optional<Match> matchLayerNorm(Operation *op) {
+  auto mul = dyn_cast_or_null<MulOp>(op);
+  if (!mul || !isa<FloatType>(getElementTypeOrSelf(mul.getType())))
+    return std::nullopt;
+  auto centered = mul.getLhs().getDefiningOp<SubtractOp>();
+  if (!centered) return std::nullopt;
+  Value input = centered.getLhs();
+
+  auto mean = getBroadcastSource<DivOp>(centered.getRhs());
+  if (!mean) return std::nullopt;
+  auto meanSum = mean.getLhs().getDefiningOp<ReduceOp>();
+  if (!isReductionOf<AddOp>(meanSum) || meanSum.getInputs().front() != input)
+    return std::nullopt;
+  ArrayRef<int64_t> dimensions = meanSum.getDimensions();
+  double numElements = getNumReducedElements(input, dimensions);
+  if (!isBroadcastOfReduced(centered.getRhs(), input, dimensions) ||
+      !isSplatFloatOf(mean.getRhs(), numElements))
+    return std::nullopt;
+
+  auto rsqrt = getBroadcastSource<RsqrtOp>(mul.getRhs());
+  if (!rsqrt || !isBroadcastOfReduced(mul.getRhs(), input, dimensions))
+    return std::nullopt;
+  auto add = rsqrt.getOperand().getDefiningOp<AddOp>();
+  if (!add) return std::nullopt;
+  auto epsilon = getSplatFloat(add.getRhs());
+  auto variance = add.getLhs().getDefiningOp<DivOp>();
+  if (!epsilon || !variance ||
+      !isSplatFloatOf(variance.getRhs(), numElements))
+    return std::nullopt;
+  auto varianceSum = variance.getLhs().getDefiningOp<ReduceOp>();
+  if (!isReductionOf<AddOp>(varianceSum) ||
+      varianceSum.getDimensions() != dimensions)
+    return std::nullopt;
+  auto square = varianceSum.getInputs().front().getDefiningOp<MulOp>();
+  if (!square || square.getLhs() != centered || square.getRhs() != centered)
+    return std::nullopt;
+
+  Builder builder(op->getContext());
+  return Match{
+      "stablehlo.layer_norm",
+      mul,
+      {input},
+      {builder.getNamedAttr("dimensions", meanSum.getDimensionsAttr()),
+       builder.getNamedAttr("epsilon",
+                            builder.getF32FloatAttr(
+                                epsilon->convertToDouble()))}};
+}
+
+// Returns whether `op` multiplies matrices in the last two dimensions of its
+// operands, with all other dimensions being leading batch dimensions. The
+// rhs contracts its dimension `rhsContractingDim` from the end.
+bool isBatchMatmul(DotGeneralOp op, int64_t rhsContractingDim) {
+  auto lhsType = cast<ShapedType>(op.getLhs().getType());
+  auto rhsType = cast<ShapedType>(op.getRhs().getType());
+  int64_t rank = lhsType.getRank();
+  if (rank < 2 || rhsType.getRank() != rank) return false;
+  auto batchDims = llvm::to_vector(llvm::seq<int64_t>(0, rank - 2));
+  auto dims = op.getDotDimensionNumbers();
+  return dims.getLhsBatchingDimensions() == ArrayRef<int64_t>(batchDims) &&
+         dims.getRhsBatchingDimensions() == ArrayRef<int64_t>(batchDims) &&
+         dims.getLhsContractingDimensions() == ArrayRef<int64_t>{rank - 1} &&
+         dims.getRhsContractingDimensions() ==
+             ArrayRef<int64_t>{rank - rhsContractingDim};
+}
+
+// attention(q, k, v) = softmax(q k^T * scale) v
+std::optional<Match> matchAttention(Operation *op) {
+  auto output = dyn_cast_or_null<DotGeneralOp>(op);
+  if (!output || !isBatchMatmul(output, 2)) return std::nullopt;
+  Value probabilities = output.getLhs();
+  auto softmax = matchSoftmax(probabilities.getDefiningOp());
+  if (!softmax) return std::nullopt;
+  int64_t rank = cast<ShapedType>(probabilities.getType()).getRank();
+  auto dimensions = cast<DenseI64ArrayAttr>(softmax->attributes[0].getValue());
+  if (dimensions.asArrayRef() != ArrayRef<int64_t>{rank - 1})
+    return std::nullopt;
+
+  // The scores are scaled by a multiplication or division by a constant.
+  Value scaled = softmax->inputs.front();
+  std::optional<APFloat> scale;
+  Value scores;
+  if (auto mulOp = scaled.getDefiningOp<MulOp>()) {
+    scale = getSplatFloat(mulOp.getRhs());
+    scores = mulOp.getLhs();
+  } else if (auto divOp = scaled.getDefiningOp<DivOp>()) {
+    scale = getSplatFloat(divOp.getRhs());
+    if (scale) scale = APFloat(1.0 / scale->convertToDouble());
+    scores = divOp.getLhs();
+  }
+  auto scoresOp = scores ? scores.getDefiningOp<DotGeneralOp>() : nullptr;
+  if (!scale || !scoresOp || !isBatchMatmul(scoresOp, 1))
+    return std::nullopt;
+
+  Builder builder(op->getContext());
+  return Match{
+      "stablehlo.scaled_dot_product_attention",
+      output,
+      {scoresOp.getLhs(), scoresOp.getRhs(), output.getRhs()},
+      {builder.getNamedAttr(
+          "scale", builder.getF32FloatAttr(scale->convertToDouble()))}};
+}
+
+// Replaces the ops computing `match.root` from `match.inputs` with a composite
+// whose decomposition is a new private function holding them. Fails if the
+// ops read other values or if other ops use their results, except for
+// constants, which are copied into the decomposition.
+LogicalResult outline(const Match &match, SymbolTable &symbolTable) {
+  Operation *root = match.root.getDefiningOp();
+  if (root->getNumResults() != 1) return failure();
+
+  llvm::SetVector<Operation *> ops;
+  SmallVector<Operation *> worklist = {root};
+  ops.insert(root);
+  while (!worklist.empty()) {
+    Operation *op = worklist.pop_back_val();
+    SetVector<Value> operands(op->getOperands().begin(),
+                              op->getOperands().end());
+    getUsedValuesDefinedAbove(op->getRegions(), operands);
+    for (Value operand : operands) {
+      if (llvm::is_contained(match.inputs, operand)) continue;
+      Operation *def = operand.getDefiningOp();
+      if (!def || def->getBlock() != root->getBlock()) return failure();
+      if (ops.insert(def)) worklist.push_back(def);
+    }
+  }
+  for (Operation *op : ops) {
+    if (op == root || op->hasTrait<OpTrait::ConstantLike>()) continue;
+    for (Operation *user : op->getUsers())
+      if (!ops.contains(user)) return failure();
+  }
+  SmallVector<Operation *> sortedOps = ops.takeVector();
+  llvm::sort(sortedOps,
+             [](Operation *a, Operation *b) { return a->isBeforeInBlock(b); });
+
+  // The decomposition is named after the composite, and renamed if needed.
+  auto module = cast<ModuleOp>(symbolTable.getOp());
+  OpBuilder builder = OpBuilder::atBlockEnd(module.getBody());
+  auto inputTypes = llvm::to_vector(
+      llvm::map_range(match.inputs, [](Value v) { return v.getType(); }));
+  auto decomposition = builder.create<func::FuncOp>(
+      root->getLoc(), match.name.rsplit('.').second,
+      builder.getFunctionType(inputTypes, root->getResultTypes()));
+  decomposition.setPrivate();
+  symbolTable.insert(decomposition);
+
+  builder.setInsertionPointToStart(decomposition.addEntryBlock());
+  IRMapping mapping;
+  mapping.map(match.inputs, decomposition.getArguments());
+  for (Operation *op : sortedOps) builder.clone(*op, mapping);
+  builder.create<func::ReturnOp>(root->getLoc(),
+                                 mapping.lookup(match.root));
+
+  builder.setInsertionPoint(root);
+  auto composite = builder.create<CompositeOp>(
+      root->getLoc(), root->getResultTypes(), match.inputs,
+      builder.getStringAttr(match.name),
+      builder.getDictionaryAttr(match.attributes),
+      FlatSymbolRefAttr::get(builder.getContext(),
+                             decomposition.getSymName()),
+      /*version=*/IntegerAttr());
+  root->replaceAllUsesWith(composite);
+  for (Operation *op : llvm::reverse(sortedOps))
+    if (op->use_empty()) op->erase();
+  return success();
+}
+
+struct StablehloRecognizeCompositesPass
+    : public impl::StablehloRecognizeCompositesPassBase<
+          StablehloRecognizeCompositesPass> {
+  using StablehloRecognizeCompositesPassBase::
+      StablehloRecognizeCompositesPassBase;
+
+  void runOnOperation() override {
+    ModuleOp module = getOperation();
+    SymbolTable symbolTable(module);
+
+    // Attention contains a softmax, so it is matched first. The softmax is
+    // then matched again in the decomposition of the attention.
+    using Matcher = std::function<std::optional<Match>(Operation *)>;
+    for (const Matcher &matcher :
+         {Matcher(matchAttention), Matcher(matchLayerNorm),
+          Matcher(matchSoftmax)}) {
+      SmallVector<Operation *> roots;
+      module.walk([&](Operation *op) { roots.push_back(op); });
+      for (Operation *root : roots)
+        if (auto match = matcher(root)) (void)outline(*match, symbolTable);
+    }
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
@@ -22,6 +22,7 @@ limitations under the License.
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -38,6 +39,8 @@ limitations under the License.
 #include "mlir/IR/OpDefinition.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/IR/Types.h"
 #include "mlir/IR/Value.h"
 #include "mlir/IR/ValueRange.h"
@@ -49,6 +52,7 @@ limitations under the License.
 #include "stablehlo/dialect/StablehloOps.h"
 #include "stablehlo/dialect/TypeInference.h"
 #include "stablehlo/transforms/Passes.h"
+#include "stablehlo/transforms/PatternStatistics.h"
 
 namespace mlir {
 namespace stablehlo {
@@ -88,6 +92,11 @@ LogicalResult refineValues(PatternRewriter& rewriter, Operation* op,
   if (!needsRefinement)
     return rewriter.notifyMatchFailure(op, "doesn't need refinement");
 
+  // Users of refined values, which need to be visited again to propagate the
+  // refinements. Refinements are thus incremental: an op is only revisited
+  // when the types of its operands change, rather than on every sweep over
+  // the program.
+  llvm::SetVector<Operation*> usersToVisit;
   for (auto it : llvm::zip(values, refinedTypes)) {
     // Cannot use structured bindings to simplify this because capturing
     // structured bindings in a lambda is a C++ 20 extension.
@@ -126,6 +135,7 @@ LogicalResult refineValues(PatternRewriter& rewriter, Operation* op,
     // fine with that.
     auto unrefinedType = value.getType();
     value.setType(refinedType);
+    usersToVisit.insert(value.getUsers().begin(), value.getUsers().end());
 
     // Special case: for `func.return`, guard the refinement with a cast
     // and leave propagation of the refined return type to a dedicated pattern.
@@ -139,21 +149,16 @@ LogicalResult refineValues(PatternRewriter& rewriter, Operation* op,
     value.replaceUsesWithIf(castToUnrefinedType.getOutputs()[0], isFuncReturn);
   }
 
+  // There is no upstream API to ask the rewriter to visit an op without
+  // changing it, so this reports an empty in-place modification instead.
+  for (Operation* user : usersToVisit)
+    rewriter.modifyOpInPlace(user, [&]() {});
   return success();
 }
 
 LogicalResult refineReturnTypes(PatternRewriter& rewriter, Operation* op,
                                 ArrayRef<Type> types) {
-  if (failed(refineValues(rewriter, op, op->getResults(), types)))
-    return failure();
-
-  // This `replaceOpUsesWithIf` call doesn't actually change the IR, but
-  // it does ask the rewriter to visit all the users of this op. There is no
-  // upstream API to achieve this directly, but if it's introduced in the
-  // future, we could use it here.
-  rewriter.replaceOpUsesWithIf(op, op->getResults(),
-                               [](OpOperand& use) { return false; });
-  return success();
+  return refineValues(rewriter, op, op->getResults(), types);
 }
 
 LogicalResult refineReturnTypes(PatternRewriter& rewriter, Operation* op,
@@ -684,7 +689,7 @@ struct UpdateFunctionTypePattern : public OpRewritePattern<func::ReturnOp> {
 
     // If the type of the enclosing `func.func` needs an update, we simply
     // call setType. We can afford this simplicity because our algorithm
-    // currently supports only one function per module.
+    // never refines functions which are referenced, e.g. by calls.
     auto func = cast<func::FuncOp>(op->getParentOp());
     func.setType(
         rewriter.getFunctionType(func.getArgumentTypes(), updatedResultTypes));
@@ -721,15 +726,17 @@ struct StablehloRefineShapesPass
   using StablehloRefineShapesPassBase::StablehloRefineShapesPassBase;
 
   LogicalResult initialize(MLIRContext* context) override {
-    // The algorithm behind this pass consists of a single traversal of the
-    // function. This is sufficient because we only support one function per
-    // program at the moment.
-    // TODO(#1048): Find out why .maxIterations = 1 no longer works.
-    // There have been recent refactors to applyPatternsAndFoldGreedily
-    // upstream, and that might be the reason.
+    // The algorithm behind this pass consists of a single forward traversal
+    // of every refined function. This is sufficient because functions are
+    // refined independently of each other (functions which are called are
+    // never refined, see `getTargets`), and because `refineValues` puts the
+    // users of every refined value back on the worklist of the driver, which
+    // drains the worklist before finishing the traversal. Another traversal
+    // would revisit every op only to find that nothing changed, which used to
+    // double the cost of the pass on large programs.
     config.useTopDownTraversal = true;
     config.enableRegionSimplification = true;
-    config.maxIterations = 2;
+    config.maxIterations = 1;
     config.maxNumRewrites = GreedyRewriteConfig::kNoLimit;
     config.strictMode = GreedyRewriteStrictness::AnyOp;
 
@@ -747,16 +754,82 @@ struct StablehloRefineShapesPass
   }
 
   void runOnOperation() override {
-    auto func = getStablehloRefineShapesTarget(getOperation());
-    if (!func) return signalPassFailure();
+    SmallVector<func::FuncOp> funcs;
+    if (failed(getTargets(funcs))) return signalPassFailure();
 
-    if (failed(applyPatternsAndFoldGreedily(func, patterns, config))) {
-      func.emitError("Failed to converge StablehloRefineShapes in ")
-          << config.maxIterations << " iterations";
-    }
+    // Refinements never cross function boundaries, so functions are refined
+    // concurrently like in a nested pass manager.
+    parallelForEach(&getContext(), funcs, [&](func::FuncOp func) {
+      refineFunction(func);
+    });
   }
 
  private:
+  // Returns the function identified by `getStablehloRefineShapesTarget`, or
+  // with `all-functions` every function which isn't referenced by any other
+  // op. Referenced functions, e.g. callees and called computations of custom
+  // calls, keep their types like with a single target, since refining the
+  // result types of a function would invalidate its uses.
+  LogicalResult getTargets(SmallVector<func::FuncOp>& funcs) {
+    ModuleOp module = getOperation();
+    if (!refineAllFunctions) {
+      auto func = getStablehloRefineShapesTarget(module);
+      if (!func) return failure();
+      funcs.push_back(func);
+      return success();
+    }
+
+    for (auto func : module.getOps<func::FuncOp>()) {
+      if (func.isDeclaration() ||
+          !SymbolTable::symbolKnownUseEmpty(func, module))
+        continue;
+      if (!func.getRegion().hasOneBlock())
+        return func.emitOpError() << "must have exactly one block";
+      funcs.push_back(func);
+    }
+    return success();
+  }
+
+  void refineFunction(func::FuncOp func) {
+    // With a single traversal, the driver reports that it didn't converge
+    // whenever the traversal changed anything, since it never gets to check
+    // that another traversal wouldn't. The worklist is drained nonetheless,
+    // so the result is ignored.
+    RefinementStatistics statistics;
+    (void)applyPatternsGreedilyWithStatistics(func, patterns, config,
+                                              statistics);
+
+    numUpdatedOps += statistics.numUpdatedOps;
+    numReplacedOps += statistics.numReplacedOps;
+    numPatternApplications += statistics.getNumApplications();
+    numPatternFailures += statistics.getNumFailures();
+    if (reportPatternStatistics) statistics.emitRemark(func);
+    func.walk([&](Operation* op) {
+      for (Region& region : op->getRegions())
+        for (Block& block : region)
+          numDynamicValues +=
+              llvm::count_if(block.getArgumentTypes(), isDynamic);
+      numDynamicValues += llvm::count_if(op->getResultTypes(), isDynamic);
+    });
+  }
+
+  // Counts the rewrites of the driver for the statistics of the pass.
+  struct RefinementStatistics : public PatternStatistics {
+    void notifyOperationModified(Operation* op) override { ++numUpdatedOps; }
+    void notifyOperationReplaced(Operation* op,
+                                 ValueRange replacement) override {
+      ++numReplacedOps;
+    }
+
+    int64_t numUpdatedOps = 0;
+    int64_t numReplacedOps = 0;
+  };
+
+  static bool isDynamic(Type type) {
+    auto shapedType = dyn_cast<ShapedType>(type);
+    return shapedType && !shapedType.hasStaticShape();
+  }
+
   FrozenRewritePatternSet patterns;
   GreedyRewriteConfig config;
 };
@@ -41,9 +41,9 @@ func::FuncOp getStablehloRefineShapesTarget(ModuleOp module);
 //      dimension size out of an entire tensor type got refined. This is done
 //      via inferMostSpecificType.
 //   2) Need to signal propagation of the refined shapes across the
-//      StableHLO program. Different callers of this function have different
-//      propagation needs, so this function doesn't signal anything on its own
-//      and leaves that to the callers.
+//      StableHLO program. This function signals PatternRewriter that it needs
+//      to visit all the users of the refined values, and only them, so that
+//      refinements propagate without sweeping over the whole program again.
 LogicalResult refineValues(PatternRewriter& rewriter, Operation* op,
                            ValueRange values, TypeRange types);
 
@@ -0,0 +1,261 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/CostAnalysis.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOREMATERIALIZEPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// The maximum number of ops recomputed to rematerialize a single value.
+constexpr int64_t kMaxRematerializedOps = 8;
+
+int64_t getSizeInBytes(Value value) {
+  return CostAnalysis::getSizeInBytes(value.getType()).value_or(0);
+}
+
+// Returns whether `op` costs at most a few FLOPs per element of its result
+// and doesn't read memory other than its operands, so that recomputing it is
+// cheaper than keeping its result live.
+bool isCheapToRecompute(Operation *op) {
+  if (!op || op->getNumRegions() != 0 || !isMemoryEffectFree(op))
+    return false;
+  if (auto constantOp = dyn_cast<ConstantOp>(op))
+    return constantOp.getValue().isSplat();
+  return isa<BroadcastInDimOp, BroadcastOp, ConvertOp, IotaOp, ReshapeOp>(
+             op) ||
+         op->hasTrait<OpTrait::Elementwise>();
+}
+
+// The live intervals of the values defined by the ops of a block, in
+// positions of the ops in the block.
+struct LiveIntervals {
+  explicit LiveIntervals(Block &block) {
+    for (Operation &op : block) {
+      positions[&op] = ops.size();
+      ops.push_back(&op);
+    }
+    for (Operation &op : block) {
+      for (Value result : op.getResults()) {
+        int64_t start = positions[&op];
+        SmallVector<int64_t> uses;
+        for (Operation *user : result.getUsers())
+          if (Operation *ancestor = block.findAncestorOpInBlock(*user))
+            uses.push_back(positions[ancestor]);
+        llvm::sort(uses);
+        int64_t end = uses.empty() ? start : uses.back();
+        intervals[result] = {start, end, getSizeInBytes(result)};
+        usePositions[result] = std::move(uses);
+      }
+    }
+  }
+
+  struct Interval {
+    int64_t start;
+    int64_t end;
+    int64_t size;
+  };
+
+  // Returns the peak of the sizes of the intervals which are live at the
+  // same position, and the first position with that size.
+  static std::pair<int64_t, int64_t> getPeak(ArrayRef<Interval> intervals) {
+    SmallVector<std::pair<int64_t, int64_t>> events;
+    for (const Interval &interval : intervals) {
+      events.emplace_back(interval.start, interval.size);
+      events.emplace_back(interval.end + 1, -interval.size);
+    }
+    llvm::sort(events);
+    int64_t liveBytes = 0;
+    std::pair<int64_t, int64_t> peak = {0, 0};
+    for (auto it = events.begin(); it != events.end();) {
+      int64_t position = it->first;
+      for (; it != events.end() && it->first == position; ++it)
+        liveBytes += it->second;
+      if (liveBytes > peak.first) peak = {liveBytes, position};
+    }
+    return peak;
+  }
+
+  SmallVector<Operation *> ops;
+  llvm::DenseMap<Operation *, int64_t> positions;
+  llvm::MapVector<Value, Interval> intervals;
+  llvm::DenseMap<Value, SmallVector<int64_t>> usePositions;
+};
+
+// Rematerializing a value which is live across the peak of a block, by
+// recomputing it right before its first use after the peak.
+struct Rematerialization {
+  Value value;
+  // Position of the first use of the value after the peak.
+  int64_t position;
+  // The ops to recompute, in order.
+  SmallVector<Operation *> ops;
+  // The peak size of live values after rematerializing.
+  int64_t peakLiveBytes;
+};
+
+// Returns how to rematerialize `value` which is live across `peakPosition`,
+// or std::nullopt if it can't be recomputed cheaply.
+std::optional<Rematerialization> planRematerialization(
+    const LiveIntervals &liveIntervals, Value value, int64_t peakPosition) {
+  const auto &uses = liveIntervals.usePositions.find(value)->second;
+  auto lateUse = llvm::upper_bound(uses, peakPosition);
+  if (lateUse == uses.end() ||
+      liveIntervals.intervals.find(value)->second.start >= peakPosition)
+    return std::nullopt;
+
+  Rematerialization remat;
+  remat.value = value;
+  remat.position = *lateUse;
+
+  // Collects the ops which compute `value` from values which are live at the
+  // position of the rematerialization, or which must be kept live until then.
+  llvm::SetVector<Operation *> ops;
+  llvm::SetVector<Value> extendedValues;
+  auto collect = [&](auto &self, Value current) -> bool {
+    Operation *op = current.getDefiningOp();
+    if (!isCheapToRecompute(op) ||
+        static_cast<int64_t>(ops.size()) >= kMaxRematerializedOps)
+      return false;
+    for (Value operand : op->getOperands()) {
+      auto it = liveIntervals.intervals.find(operand);
+      if (it == liveIntervals.intervals.end() ||
+          it->second.end >= remat.position)
+        continue;
+      if (!self(self, operand)) extendedValues.insert(operand);
+    }
+    ops.insert(op);
+    return true;
+  };
+  if (!collect(collect, value)) return std::nullopt;
+  remat.ops = llvm::to_vector(ops);
+  llvm::sort(remat.ops, [&](Operation *lhs, Operation *rhs) {
+    return liveIntervals.positions.lookup(lhs) <
+           liveIntervals.positions.lookup(rhs);
+  });
+
+  // Simulates the intervals after rematerializing: the value dies at its
+  // last use before the peak, the operands of the recomputation live until
+  // it, and the recomputed values live from it.
+  SmallVector<LiveIntervals::Interval> intervals;
+  for (auto &[other, interval] : liveIntervals.intervals) {
+    LiveIntervals::Interval newInterval = interval;
+    if (other == value) {
+      newInterval.end = lateUse == uses.begin()
+                            ? interval.start
+                            : std::max(interval.start, *std::prev(lateUse));
+    } else if (extendedValues.contains(other)) {
+      newInterval.end = remat.position;
+    }
+    intervals.push_back(newInterval);
+  }
+  for (Operation *op : remat.ops) {
+    for (Value result : op->getResults()) {
+      int64_t end = result == value ? uses.back() : remat.position;
+      intervals.push_back({remat.position, end, getSizeInBytes(result)});
+    }
+  }
+  remat.peakLiveBytes = LiveIntervals::getPeak(intervals).first;
+  return remat;
+}
+
+// Rematerializes values of `block` until its peak size of live values is at
+// most `memoryBudget`, or rematerializing doesn't reduce it anymore.
+void rematerializeBlock(Block &block, int64_t memoryBudget) {
+  int64_t maxIterations = std::distance(block.begin(), block.end());
+  for (int64_t iteration = 0; iteration < maxIterations; ++iteration) {
+    LiveIntervals liveIntervals(block);
+    SmallVector<LiveIntervals::Interval> intervals;
+    for (auto &[value, interval] : liveIntervals.intervals)
+      intervals.push_back(interval);
+    auto [peakLiveBytes, peakPosition] = LiveIntervals::getPeak(intervals);
+    if (peakLiveBytes <= memoryBudget) return;
+
+    // Picks the rematerialization which reduces the peak the most, and
+    // recomputes the fewest ops on ties.
+    std::optional<Rematerialization> best;
+    for (auto &[value, interval] : liveIntervals.intervals) {
+      if (interval.start >= peakPosition || interval.end <= peakPosition)
+        continue;
+      auto remat = planRematerialization(liveIntervals, value, peakPosition);
+      if (!remat || remat->peakLiveBytes >= peakLiveBytes) continue;
+      if (!best || remat->peakLiveBytes < best->peakLiveBytes ||
+          (remat->peakLiveBytes == best->peakLiveBytes &&
+           remat->ops.size() < best->ops.size()))
+        best = std::move(remat);
+    }
+    if (!best) return;
+
+    // Recomputes the value right before its first use after the peak, and
+    // replaces its uses after the peak.
+    Operation *lateUser = liveIntervals.ops[best->position];
+    OpBuilder builder(lateUser);
+    IRMapping mapping;
+    for (Operation *op : best->ops) builder.clone(*op, mapping);
+    Value newValue = mapping.lookup(best->value);
+    best->value.replaceUsesWithIf(newValue, [&](OpOperand &use) {
+      Operation *ancestor = block.findAncestorOpInBlock(*use.getOwner());
+      return ancestor &&
+             liveIntervals.positions.lookup(ancestor) > peakPosition;
+    });
+
+    best->value.getDefiningOp()->emitRemark()
+        << "rematerialized " << best->ops.size() << " op(s) before '"
+        << lateUser->getName() << "' to reduce peak live bytes from "
+        << peakLiveBytes << " to " << best->peakLiveBytes;
+    for (Operation *op : llvm::reverse(best->ops))
+      if (op->use_empty()) op->erase();
+  }
+}
+
+struct StablehloRematerializePass
+    : public impl::StablehloRematerializePassBase<
+          StablehloRematerializePass> {
+  using StablehloRematerializePassBase::StablehloRematerializePassBase;
+
+  void runOnOperation() override {
+    SmallVector<Block *> blocks;
+    getOperation().walk([&](Block *block) { blocks.push_back(block); });
+    for (Block *block : blocks) rematerializeBlock(*block, memoryBudget);
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,408 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOREMOVEDEADVALUESPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+bool isBodyMemoryEffectFree(Block &block) {
+  return llvm::all_of(block.without_terminator(), [](Operation &op) {
+    return isMemoryEffectFree(&op);
+  });
+}
+
+// Creates a copy of `op` with `operands` and `resultTypes`, and moves the
+// regions of `op` into it. Only applies to ops without operand segments.
+Operation *rebuildOp(PatternRewriter &rewriter, Operation *op,
+                     ValueRange operands, TypeRange resultTypes) {
+  OperationState state(op->getLoc(), op->getName(), operands, resultTypes,
+                       op->getAttrs());
+  for (unsigned i = 0; i < op->getNumRegions(); ++i) state.addRegion();
+  Operation *newOp = rewriter.create(state);
+  for (auto [region, newRegion] :
+       llvm::zip(op->getRegions(), newOp->getRegions()))
+    rewriter.inlineRegionBefore(region, newRegion, newRegion.end());
+  return newOp;
+}
+
+// Replaces `op` with the results of `newOp`, which has the results of `op`
+// which aren't in `removedResults`, which must have no uses.
+void replaceKeptResults(PatternRewriter &rewriter, Operation *op,
+                        Operation *newOp, const BitVector &removedResults) {
+  SmallVector<Value> results(op->getNumResults());
+  unsigned newIndex = 0;
+  for (unsigned i = 0; i < op->getNumResults(); ++i)
+    if (!removedResults[i]) results[i] = newOp->getResult(newIndex++);
+  rewriter.replaceOp(op, results);
+}
+
+SmallVector<Value> getKeptValues(ValueRange values, const BitVector &removed) {
+  SmallVector<Value> result;
+  for (auto [i, value] : llvm::enumerate(values))
+    if (!removed[i]) result.push_back(value);
+  return result;
+}
+
+SmallVector<Type> getKeptTypes(TypeRange types, const BitVector &removed) {
+  SmallVector<Type> result;
+  for (auto [i, type] : llvm::enumerate(types))
+    if (!removed[i]) result.push_back(type);
+  return result;
+}
+
+// Removes `removedOperands` from the terminator of `block`, and then erases
+// the ops of `block` whose results became unused, in reverse order so that
+// ops which were only used by erased ops are erased too.
+void removeReturnedValues(PatternRewriter &rewriter, Block &block,
+                          const BitVector &removedOperands) {
+  Operation *terminator = block.getTerminator();
+  rewriter.modifyOpInPlace(
+      terminator, [&]() { terminator->eraseOperands(removedOperands); });
+  for (Operation &op : llvm::make_early_inc_range(
+           llvm::reverse(block.without_terminator())))
+    if (op.use_empty() && isMemoryEffectFree(&op)) rewriter.eraseOp(&op);
+}
+
+// Removes the unused results of reduce, reduce_window and scatter ops. The
+// body of these ops takes arguments `i` and `n + i` for their `i`-th result
+// and returns the `i`-th result, so a result can be removed with its operands
+// if the return values of the other results aren't computed from these
+// arguments.
+template <typename OpType>
+struct RemoveUnusedReductionResults : public OpRewritePattern<OpType> {
+  using OpRewritePattern<OpType>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(OpType op,
+                                PatternRewriter &rewriter) const override {
+    unsigned numResults = op->getNumResults();
+    Block &body = op->getRegion(0).front();
+    if (llvm::all_of(op->getResults(), [](Value v) { return v.use_empty(); }))
+      return rewriter.notifyMatchFailure(op, "dead op");
+    if (!isBodyMemoryEffectFree(body))
+      return rewriter.notifyMatchFailure(op, "body has side effects");
+
+    // Finds the results whose arguments are used to compute the return
+    // values of the used results.
+    BitVector usedResults(numResults);
+    SmallVector<Value> worklist;
+    for (auto [i, result] : llvm::enumerate(op->getResults())) {
+      if (result.use_empty()) continue;
+      usedResults.set(i);
+      worklist.push_back(body.getTerminator()->getOperand(i));
+    }
+    DenseSet<Operation *> visited;
+    while (!worklist.empty()) {
+      Value value = worklist.pop_back_val();
+      if (auto arg = dyn_cast<BlockArgument>(value)) {
+        if (arg.getOwner() == &body)
+          usedResults.set(arg.getArgNumber() % numResults);
+        continue;
+      }
+      Operation *def = value.getDefiningOp();
+      if (def->getBlock() != &body || !visited.insert(def).second) continue;
+      llvm::append_range(worklist, def->getOperands());
+      def->walk([&](Operation *nested) {
+        llvm::append_range(worklist, nested->getOperands());
+      });
+    }
+    if (usedResults.all())
+      return rewriter.notifyMatchFailure(op, "no removable results");
+
+    BitVector removedResults = ~usedResults;
+    BitVector removedOperands(op->getNumOperands());
+    BitVector removedArgs(body.getNumArguments());
+    for (unsigned i : removedResults.set_bits()) {
+      removedOperands.set(i);
+      removedOperands.set(getOperandIndex(op, i));
+      removedArgs.set(i);
+      removedArgs.set(numResults + i);
+    }
+
+    Operation *newOp = rebuildOp(
+        rewriter, op, getKeptValues(op->getOperands(), removedOperands),
+        getKeptTypes(op->getResultTypes(), removedResults));
+    Block &newBody = newOp->getRegion(0).front();
+    removeReturnedValues(rewriter, newBody, removedResults);
+    newBody.eraseArguments(removedArgs);
+    replaceKeptResults(rewriter, op, newOp, removedResults);
+    return success();
+  }
+
+ private:
+  // Returns the index of the second operand of the `i`-th result, i.e. of
+  // its init value or of its updates.
+  static unsigned getOperandIndex(OpType op, unsigned i) {
+    if constexpr (std::is_same_v<OpType, ScatterOp>)
+      return op->getNumResults() + 1 + i;
+    return op->getNumResults() + i;
+  }
+};
+
+// Removes the unused results of sort ops whose comparator doesn't compare
+// them, along with their operands.
+struct RemoveUnusedSortResults : public OpRewritePattern<SortOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(SortOp op,
+                                PatternRewriter &rewriter) const override {
+    Block &comparator = op.getComparator().front();
+    BitVector removedResults(op->getNumResults());
+    BitVector removedArgs(comparator.getNumArguments());
+    for (auto [i, result] : llvm::enumerate(op->getResults())) {
+      if (!result.use_empty() || !comparator.getArgument(2 * i).use_empty() ||
+          !comparator.getArgument(2 * i + 1).use_empty())
+        continue;
+      removedResults.set(i);
+      removedArgs.set(2 * i);
+      removedArgs.set(2 * i + 1);
+    }
+    if (removedResults.none() || removedResults.all())
+      return rewriter.notifyMatchFailure(op, "no removable results");
+
+    Operation *newOp = rebuildOp(
+        rewriter, op, getKeptValues(op->getOperands(), removedResults),
+        getKeptTypes(op->getResultTypes(), removedResults));
+    newOp->getRegion(0).front().eraseArguments(removedArgs);
+    replaceKeptResults(rewriter, op, newOp, removedResults);
+    return success();
+  }
+};
+
+// Removes the unused results of if and case ops from all their branches.
+template <typename OpType>
+struct RemoveUnusedBranchResults : public OpRewritePattern<OpType> {
+  using OpRewritePattern<OpType>::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(OpType op,
+                                PatternRewriter &rewriter) const override {
+    BitVector removedResults(op->getNumResults());
+    for (auto [i, result] : llvm::enumerate(op->getResults()))
+      if (result.use_empty()) removedResults.set(i);
+    if (removedResults.none())
+      return rewriter.notifyMatchFailure(op, "all results are used");
+
+    Operation *newOp =
+        rebuildOp(rewriter, op, op->getOperands(),
+                  getKeptTypes(op->getResultTypes(), removedResults));
+    for (Region &branch : newOp->getRegions())
+      removeReturnedValues(rewriter, branch.front(), removedResults);
+    replaceKeptResults(rewriter, op, newOp, removedResults);
+    return success();
+  }
+};
+
+// Removes the loop-carried values of while ops which aren't used after the
+// loop, by the condition, or to compute other loop-carried values which are
+// kept, along with the computations of their next values.
+struct RemoveDeadLoopCarriedValues : public OpRewritePattern<WhileOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(WhileOp op,
+                                PatternRewriter &rewriter) const override {
+    Block &cond = op.getCond().front();
+    Block &body = op.getBody().front();
+    unsigned numValues = op->getNumResults();
+
+    // Candidates are removed until all the values computed from the remaining
+    // ones are candidates too.
+    BitVector candidates(numValues);
+    SmallVector<std::optional<BitVector>> computedValues(numValues);
+    for (unsigned i = 0; i < numValues; ++i) {
+      if (!op->getResult(i).use_empty() || !cond.getArgument(i).use_empty())
+        continue;
+      computedValues[i] = getComputedValues(body, i);
+      if (computedValues[i]) candidates.set(i);
+    }
+    for (bool changed = true; changed;) {
+      changed = false;
+      for (unsigned i : candidates.set_bits()) {
+        BitVector escaped = *computedValues[i];
+        escaped.reset(candidates);
+        if (escaped.none()) continue;
+        candidates.reset(i);
+        changed = true;
+      }
+    }
+    if (candidates.none())
+      return rewriter.notifyMatchFailure(op, "no dead loop-carried values");
+
+    Operation *newOp =
+        rebuildOp(rewriter, op, getKeptValues(op->getOperands(), candidates),
+                  getKeptTypes(op->getResultTypes(), candidates));
+    Block &newBody = newOp->getRegion(1).front();
+    removeReturnedValues(rewriter, newBody, candidates);
+    newBody.eraseArguments(candidates);
+    newOp->getRegion(0).front().eraseArguments(candidates);
+    replaceKeptResults(rewriter, op, newOp, candidates);
+    return success();
+  }
+
+ private:
+  // Returns the loop-carried values whose next values are computed from the
+  // `i`-th argument of `body`, or nullopt if the argument is used by an op
+  // with side effects, which must be kept.
+  static std::optional<BitVector> getComputedValues(Block &body, unsigned i) {
+    Operation *terminator = body.getTerminator();
+    BitVector result(terminator->getNumOperands());
+    SmallVector<Value> worklist = {body.getArgument(i)};
+    DenseSet<Operation *> visited;
+    while (!worklist.empty()) {
+      Value value = worklist.pop_back_val();
+      for (OpOperand &use : value.getUses()) {
+        Operation *user = body.findAncestorOpInBlock(*use.getOwner());
+        if (user == terminator) {
+          result.set(use.getOperandNumber());
+          continue;
+        }
+        if (!visited.insert(user).second) continue;
+        if (!isMemoryEffectFree(user)) return std::nullopt;
+        llvm::append_range(worklist, user->getResults());
+      }
+    }
+    return result;
+  }
+};
+
+// Returns the calls of `func`, or nullopt if it is referenced by other ops or
+// isn't private, in which case its signature must be kept.
+std::optional<SmallVector<func::CallOp>> getCalls(func::FuncOp func,
+                                                  ModuleOp module) {
+  if (!func.isPrivate() || func.isDeclaration()) return std::nullopt;
+  auto uses = SymbolTable::getSymbolUses(func, module);
+  if (!uses) return std::nullopt;
+  SmallVector<func::CallOp> calls;
+  for (const SymbolTable::SymbolUse &use : *uses) {
+    auto call = dyn_cast<func::CallOp>(use.getUser());
+    if (!call || call.getCalleeAttr() != use.getSymbolRef())
+      return std::nullopt;
+    calls.push_back(call);
+  }
+  return calls;
+}
+
+// Removes the unused arguments of the private functions of `module`, and
+// their results which are unused by all calls. Returns whether anything was
+// removed.
+bool removeDeadFunctionValues(ModuleOp module) {
+  bool changed = false;
+  for (auto func : module.getOps<func::FuncOp>()) {
+    auto calls = getCalls(func, module);
+    if (!calls) continue;
+
+    BitVector removedArgs(func.getNumArguments());
+    for (BlockArgument arg : func.getArguments())
+      if (arg.use_empty()) removedArgs.set(arg.getArgNumber());
+    BitVector removedResults(func.getNumResults(), true);
+    for (func::CallOp call : *calls)
+      for (OpResult result : call->getResults())
+        if (!result.use_empty()) removedResults.reset(result.getResultNumber());
+    if (removedArgs.none() && removedResults.none()) continue;
+    changed = true;
+
+    func.eraseArguments(removedArgs);
+    for (Block &block : func.getBody())
+      if (auto ret = dyn_cast<func::ReturnOp>(block.getTerminator()))
+        ret->eraseOperands(removedResults);
+    func.eraseResults(removedResults);
+
+    for (func::CallOp call : *calls) {
+      OpBuilder builder(call);
+      auto newCall = builder.create<func::CallOp>(
+          call.getLoc(), func, getKeptValues(call.getOperands(), removedArgs));
+      unsigned newIndex = 0;
+      for (OpResult result : call->getResults())
+        if (!removedResults[result.getResultNumber()])
+          result.replaceAllUsesWith(newCall.getResult(newIndex++));
+      call.erase();
+    }
+  }
+  return changed;
+}
+
+struct StablehloRemoveDeadValuesPass
+    : public impl::StablehloRemoveDeadValuesPassBase<
+          StablehloRemoveDeadValuesPass> {
+  using StablehloRemoveDeadValuesPassBase::StablehloRemoveDeadValuesPassBase;
+
+  LogicalResult initialize(MLIRContext *context) override {
+    RewritePatternSet patterns_(context);
+    populateStablehloRemoveDeadValuesPatterns(&patterns_, context);
+    patterns = std::move(patterns_);
+    return success();
+  }
+
+  // Removing values of functions makes the computations of their arguments
+  // and return values dead, which in turn may make other values dead, so the
+  // patterns and functions are processed alternately until nothing changes.
+  // The patterns never look beyond the function they rewrite, so functions
+  // are simplified concurrently like in a nested pass manager.
+  void runOnOperation() override {
+    ModuleOp module = getOperation();
+    do {
+      SmallVector<func::FuncOp> funcs(module.getOps<func::FuncOp>());
+      if (failed(failableParallelForEach(
+              &getContext(), funcs, [&](func::FuncOp func) {
+                return applyPatternsAndFoldGreedily(func, patterns);
+              })))
+        return signalPassFailure();
+    } while (removeDeadFunctionValues(module));
+  }
+
+ private:
+  FrozenRewritePatternSet patterns;
+};
+
+}  // namespace
+
+void populateStablehloRemoveDeadValuesPatterns(RewritePatternSet *patterns,
+                                               MLIRContext *context) {
+  patterns->add<RemoveDeadLoopCarriedValues, RemoveUnusedBranchResults<CaseOp>,
+                RemoveUnusedBranchResults<IfOp>,
+                RemoveUnusedReductionResults<ReduceOp>,
+                RemoveUnusedReductionResults<ReduceWindowOp>,
+                RemoveUnusedReductionResults<ScatterOp>,
+                RemoveUnusedSortResults>(context);
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
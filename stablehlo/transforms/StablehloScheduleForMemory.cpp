@@ -0,0 +1,207 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "stablehlo/transforms/CostAnalysis.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOSCHEDULEFORMEMORYPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+int64_t getSizeInBytes(Value value) {
+  return CostAnalysis::getSizeInBytes(value.getType()).value_or(0);
+}
+
+// The dependencies between the ops of a block, other than its terminator,
+// and the values defined in the block which every op uses.
+class BlockSchedule {
+ public:
+  explicit BlockSchedule(Block &block) : block(block) {
+    for (Operation &op : block.without_terminator()) {
+      indices[&op] = ops.size();
+      ops.push_back(&op);
+    }
+    users.resize(ops.size());
+    usedValues.resize(ops.size());
+    numDeps.resize(ops.size());
+
+    std::optional<unsigned> lastEffectingOp;
+    for (auto [i, op] : llvm::enumerate(ops)) {
+      llvm::SetVector<unsigned> deps;
+      llvm::SetVector<Value> used;
+      collectUsedValues(block, op, used);
+      for (Value value : used) {
+        Operation *def = value.getDefiningOp();
+        if (!def) continue;
+        deps.insert(indices[def]);
+        usedValues[i].push_back(value);
+        ++numUsers[value];
+      }
+      // Ops with side effects, e.g. custom calls and ops threading tokens,
+      // keep their relative order.
+      if (!isMemoryEffectFree(op)) {
+        if (lastEffectingOp) deps.insert(*lastEffectingOp);
+        lastEffectingOp = i;
+      }
+      for (unsigned dep : deps) users[dep].push_back(i);
+      numDeps[i] = deps.size();
+    }
+
+    // Values used by the terminator stay live until the end of the block.
+    llvm::SetVector<Value> used;
+    collectUsedValues(block, block.getTerminator(), used);
+    for (Value value : used) ++numUsers[value];
+  }
+
+  // Returns the order of the ops which greedily picks the ready op which
+  // grows the size of live values the least, in original order on ties.
+  SmallVector<unsigned> schedule() const {
+    SmallVector<unsigned> order;
+    SmallVector<unsigned> pendingDeps = numDeps;
+    llvm::DenseMap<Value, unsigned> remainingUsers = numUsers;
+    SmallVector<unsigned> ready;
+    for (unsigned i = 0; i < ops.size(); ++i)
+      if (pendingDeps[i] == 0) ready.push_back(i);
+
+    while (!ready.empty()) {
+      auto best = ready.begin();
+      int64_t bestDelta = getLiveBytesDelta(*best, remainingUsers);
+      for (auto it = std::next(ready.begin()); it != ready.end(); ++it) {
+        int64_t delta = getLiveBytesDelta(*it, remainingUsers);
+        if (delta < bestDelta || (delta == bestDelta && *it < *best)) {
+          best = it;
+          bestDelta = delta;
+        }
+      }
+      unsigned i = *best;
+      ready.erase(best);
+      order.push_back(i);
+      for (Value value : usedValues[i]) --remainingUsers[value];
+      for (unsigned user : users[i])
+        if (--pendingDeps[user] == 0) ready.push_back(user);
+    }
+    return order;
+  }
+
+  // Returns the peak size of the values defined in the block which are live
+  // at the same time if the ops run in `order`.
+  int64_t getPeakLiveBytes(ArrayRef<unsigned> order) const {
+    llvm::DenseMap<Value, unsigned> remainingUsers = numUsers;
+    int64_t liveBytes = 0;
+    int64_t peakLiveBytes = 0;
+    for (unsigned i : order) {
+      for (Value result : ops[i]->getResults())
+        liveBytes += getSizeInBytes(result);
+      peakLiveBytes = std::max(peakLiveBytes, liveBytes);
+      for (Value value : usedValues[i])
+        if (--remainingUsers[value] == 0) liveBytes -= getSizeInBytes(value);
+      for (Value result : ops[i]->getResults())
+        if (!numUsers.count(result)) liveBytes -= getSizeInBytes(result);
+    }
+    return peakLiveBytes;
+  }
+
+  // Moves the ops of the block, other than its terminator, into `order`.
+  void reorder(ArrayRef<unsigned> order) {
+    Operation *terminator = block.getTerminator();
+    for (unsigned i : order) ops[i]->moveBefore(terminator);
+  }
+
+  size_t size() const { return ops.size(); }
+
+ private:
+  // Collects the values defined in `block` which `op` uses, including in its
+  // regions.
+  static void collectUsedValues(Block &block, Operation *op,
+                                llvm::SetVector<Value> &used) {
+    op->walk([&](Operation *nestedOp) {
+      for (Value operand : nestedOp->getOperands())
+        if (operand.getParentBlock() == &block) used.insert(operand);
+    });
+  }
+
+  // Returns by how much running op `i` grows the size of live values: the
+  // size of its results minus the size of the values it uses last.
+  int64_t getLiveBytesDelta(
+      unsigned i, const llvm::DenseMap<Value, unsigned> &remainingUsers) const {
+    int64_t delta = 0;
+    for (Value result : ops[i]->getResults()) delta += getSizeInBytes(result);
+    for (Value value : usedValues[i])
+      if (remainingUsers.lookup(value) == 1) delta -= getSizeInBytes(value);
+    return delta;
+  }
+
+  Block &block;
+  SmallVector<Operation *> ops;
+  llvm::DenseMap<Operation *, unsigned> indices;
+  // The ops which depend on every op.
+  SmallVector<SmallVector<unsigned>> users;
+  // The number of ops every op depends on.
+  SmallVector<unsigned> numDeps;
+  // The values defined in the block which every op uses.
+  SmallVector<SmallVector<Value>> usedValues;
+  // The number of ops, including the terminator, which use every value
+  // defined in the block.
+  llvm::DenseMap<Value, unsigned> numUsers;
+};
+
+void scheduleBlockForMemory(Block &block) {
+  if (block.empty() || !block.back().hasTrait<OpTrait::IsTerminator>())
+    return;
+
+  BlockSchedule schedule(block);
+  if (schedule.size() < 2) return;
+  SmallVector<unsigned> originalOrder =
+      llvm::to_vector(llvm::seq<unsigned>(0, schedule.size()));
+  SmallVector<unsigned> order = schedule.schedule();
+  if (schedule.getPeakLiveBytes(order) <
+      schedule.getPeakLiveBytes(originalOrder))
+    schedule.reorder(order);
+}
+
+struct StablehloScheduleForMemoryPass
+    : public impl::StablehloScheduleForMemoryPassBase<
+          StablehloScheduleForMemoryPass> {
+  using StablehloScheduleForMemoryPassBase::StablehloScheduleForMemoryPassBase;
+
+  void runOnOperation() override {
+    SmallVector<Block *> blocks;
+    getOperation().walk([&](Block *block) { blocks.push_back(block); });
+    for (Block *block : blocks) scheduleBlockForMemory(*block);
+  }
+};
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
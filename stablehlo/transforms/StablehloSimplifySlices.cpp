@@ -0,0 +1,333 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOSIMPLIFYSLICESPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Returns the slice of `operand` with the given indices, or `operand` itself
+// if the slice would extract all of it.
+Value createSlice(PatternRewriter &rewriter, Location loc, Value operand,
+                  ArrayRef<int64_t> start, ArrayRef<int64_t> limit,
+                  ArrayRef<int64_t> strides) {
+  auto type = cast<RankedTensorType>(operand.getType());
+  if (type.hasStaticShape() && llvm::all_of(start, [](int64_t index) {
+        return index == 0;
+      }) &&
+      limit == type.getShape() &&
+      llvm::all_of(strides, [](int64_t stride) { return stride == 1; }))
+    return operand;
+  return rewriter.create<SliceOp>(loc, operand,
+                                  rewriter.getDenseI64ArrayAttr(start),
+                                  rewriter.getDenseI64ArrayAttr(limit),
+                                  rewriter.getDenseI64ArrayAttr(strides));
+}
+
+// slice(x) -> x if the slice extracts all of x.
+struct RemoveIdentitySlice : public OpRewritePattern<SliceOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(SliceOp op,
+                                PatternRewriter &rewriter) const override {
+    // Slices are static, so this implies zero starts and unit strides for
+    // all dimensions of size greater than one.
+    if (op.getOperand().getType() != op.getType())
+      return rewriter.notifyMatchFailure(op, "expected identity slice");
+    rewriter.replaceOp(op, op.getOperand());
+    return success();
+  }
+};
+
+// slice(slice(x, s1, l1, t1), s2, l2, t2) ->
+//   slice(x, s1 + s2 * t1, s1 + (l2 - 1) * t1 + 1, t1 * t2)
+struct ComposeSlices : public OpRewritePattern<SliceOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(SliceOp op,
+                                PatternRewriter &rewriter) const override {
+    auto inner = op.getOperand().getDefiningOp<SliceOp>();
+    if (!inner) return rewriter.notifyMatchFailure(op, "expected slice");
+    // Empty slices are replaced with empty constants elsewhere.
+    if (op.getType().getNumElements() == 0)
+      return rewriter.notifyMatchFailure(op, "expected non-empty slice");
+
+    SmallVector<int64_t> start, limit, strides;
+    for (auto [innerStart, innerStride, outerStart, outerLimit, outerStride] :
+         llvm::zip_equal(inner.getStartIndices(), inner.getStrides(),
+                         op.getStartIndices(), op.getLimitIndices(),
+                         op.getStrides())) {
+      start.push_back(innerStart + outerStart * innerStride);
+      limit.push_back(innerStart + (outerLimit - 1) * innerStride + 1);
+      strides.push_back(innerStride * outerStride);
+    }
+    rewriter.replaceOp(op, createSlice(rewriter, op.getLoc(),
+                                       inner.getOperand(), start, limit,
+                                       strides));
+    return success();
+  }
+};
+
+// slice(concatenate(x, y, z, dim)) -> slice(y) if the slice is within y, and
+// concatenate(slice(x), y, slice(z), dim) if it extracts a contiguous range
+// along dim which overlaps several inputs.
+struct SliceOfConcatenate : public OpRewritePattern<SliceOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(SliceOp op,
+                                PatternRewriter &rewriter) const override {
+    auto concatenate = op.getOperand().getDefiningOp<ConcatenateOp>();
+    if (!concatenate || !concatenate.getType().hasStaticShape())
+      return rewriter.notifyMatchFailure(op, "expected static concatenate");
+    if (op.getType().getNumElements() == 0)
+      return rewriter.notifyMatchFailure(op, "expected non-empty slice");
+
+    int64_t dim = concatenate.getDimension();
+    int64_t sliceStart = op.getStartIndices()[dim];
+    int64_t sliceLimit = op.getLimitIndices()[dim];
+    int64_t sliceStride = op.getStrides()[dim];
+
+    // Slices of the inputs overlapping [sliceStart, sliceLimit).
+    SmallVector<Value> inputs;
+    int64_t offset = 0;
+    for (Value input : concatenate.getInputs()) {
+      int64_t size = cast<RankedTensorType>(input.getType()).getDimSize(dim);
+      int64_t inputStart = offset;
+      offset += size;
+      if (offset <= sliceStart || inputStart >= sliceLimit) continue;
+
+      // The first input which overlaps the slice contains all of it, unless
+      // it spans several inputs.
+      bool isWithinInput = inputStart <= sliceStart && sliceLimit <= offset;
+      if (!isWithinInput && (sliceStride != 1 || !concatenate->hasOneUse()))
+        return rewriter.notifyMatchFailure(
+            op, "expected unit stride and a single use across inputs");
+
+      SmallVector<int64_t> start(op.getStartIndices());
+      SmallVector<int64_t> limit(op.getLimitIndices());
+      start[dim] = std::max(sliceStart, inputStart) - inputStart;
+      limit[dim] = std::min(sliceLimit, offset) - inputStart;
+      inputs.push_back(createSlice(rewriter, op.getLoc(), input, start, limit,
+                                   op.getStrides()));
+    }
+
+    if (inputs.size() == 1)
+      rewriter.replaceOp(op, inputs.front());
+    else
+      rewriter.replaceOpWithNewOp<ConcatenateOp>(op, op.getType(), inputs,
+                                                 dim);
+    return success();
+  }
+};
+
+// concatenate(slice(x, [a:b]), slice(x, [b:c]), dim) -> slice(x, [a:c]) for
+// slices of adjacent ranges along dim with unit strides, which otherwise
+// extract the same elements of x.
+struct ConcatenateAdjacentSlices : public OpRewritePattern<ConcatenateOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(ConcatenateOp op,
+                                PatternRewriter &rewriter) const override {
+    int64_t dim = op.getDimension();
+    auto areAdjacent = [&](SliceOp lhs, SliceOp rhs) {
+      if (!lhs || !rhs || lhs.getOperand() != rhs.getOperand() ||
+          lhs.getStrides()[dim] != 1 || rhs.getStrides()[dim] != 1 ||
+          lhs.getLimitIndices()[dim] != rhs.getStartIndices()[dim])
+        return false;
+      for (int64_t i = 0, e = op.getType().getRank(); i < e; ++i) {
+        if (i == dim) continue;
+        if (lhs.getStartIndices()[i] != rhs.getStartIndices()[i] ||
+            lhs.getLimitIndices()[i] != rhs.getLimitIndices()[i] ||
+            lhs.getStrides()[i] != rhs.getStrides()[i])
+          return false;
+      }
+      return true;
+    };
+
+    // Each run of adjacent slices is replaced with a single slice, which
+    // takes the start of its first slice and the limit of its last one.
+    SmallVector<Value> inputs;
+    bool changed = false;
+    SmallVector<SliceOp> slices =
+        llvm::map_to_vector(op.getInputs(), [](Value input) {
+          return input.getDefiningOp<SliceOp>();
+        });
+    for (size_t i = 0, e = slices.size(); i < e;) {
+      SliceOp first = slices[i];
+      size_t end = i + 1;
+      while (end < e && areAdjacent(slices[end - 1], slices[end])) ++end;
+      if (end == i + 1) {
+        inputs.push_back(op.getInputs()[i]);
+      } else {
+        SliceOp last = slices[end - 1];
+        SmallVector<int64_t> limit(first.getLimitIndices());
+        limit[dim] = last.getLimitIndices()[dim];
+        inputs.push_back(createSlice(rewriter, op.getLoc(), first.getOperand(),
+                                     first.getStartIndices(), limit,
+                                     first.getStrides()));
+        changed = true;
+      }
+      i = end;
+    }
+    if (!changed)
+      return rewriter.notifyMatchFailure(op, "expected adjacent slices");
+
+    if (inputs.size() == 1)
+      rewriter.replaceOp(op, inputs.front());
+    else
+      rewriter.replaceOpWithNewOp<ConcatenateOp>(op, op.getType(), inputs,
+                                                 dim);
+    return success();
+  }
+};
+
+// slice(pad(x, low, high)) -> slice(x) if the slice only extracts elements of
+// x, and pad(x, low', high') with less padding if the slice only removes
+// padding.
+struct SliceOfPad : public OpRewritePattern<SliceOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(SliceOp op,
+                                PatternRewriter &rewriter) const override {
+    auto pad = op.getOperand().getDefiningOp<PadOp>();
+    if (!pad || !pad.getOperand().getType().hasStaticShape() ||
+        llvm::any_of(pad.getInteriorPadding(),
+                     [](int64_t padding) { return padding != 0; }))
+      return rewriter.notifyMatchFailure(op, "expected static edge padding");
+    if (op.getType().getNumElements() == 0)
+      return rewriter.notifyMatchFailure(op, "expected non-empty slice");
+
+    // The elements of x are at [low, low + size) of the padded tensor.
+    ArrayRef<int64_t> shape = pad.getOperand().getType().getShape();
+    ArrayRef<int64_t> low = pad.getEdgePaddingLow();
+    bool isWithinOperand = true;
+    bool hasUnitStrides = true;
+    SmallVector<int64_t> start, limit, newLow, newHigh;
+    for (auto [dim, size] : llvm::enumerate(shape)) {
+      int64_t sliceStart = op.getStartIndices()[dim];
+      int64_t sliceLimit = op.getLimitIndices()[dim];
+      isWithinOperand &=
+          sliceStart >= low[dim] && sliceLimit <= low[dim] + size;
+      hasUnitStrides &= op.getStrides()[dim] == 1;
+      start.push_back(sliceStart - low[dim]);
+      limit.push_back(sliceLimit - low[dim]);
+      newLow.push_back(low[dim] - sliceStart);
+      newHigh.push_back(sliceLimit - low[dim] - size);
+    }
+
+    if (isWithinOperand) {
+      rewriter.replaceOp(op, createSlice(rewriter, op.getLoc(),
+                                         pad.getOperand(), start, limit,
+                                         op.getStrides()));
+      return success();
+    }
+
+    auto isNonNegative = [](int64_t padding) { return padding >= 0; };
+    if (!hasUnitStrides || !llvm::all_of(newLow, isNonNegative) ||
+        !llvm::all_of(newHigh, isNonNegative))
+      return rewriter.notifyMatchFailure(op, "expected slice of padding");
+    rewriter.replaceOpWithNewOp<PadOp>(
+        op, op.getType(), pad.getOperand(), pad.getPaddingValue(),
+        rewriter.getDenseI64ArrayAttr(newLow),
+        rewriter.getDenseI64ArrayAttr(newHigh), pad.getInteriorPaddingAttr());
+    return success();
+  }
+};
+
+// dynamic_slice(x, constant indices, sizes) -> slice(x) with the clamped
+// indices, which then composes with other slices.
+struct DynamicSliceToSlice : public OpRewritePattern<DynamicSliceOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(DynamicSliceOp op,
+                                PatternRewriter &rewriter) const override {
+    auto operandType = cast<RankedTensorType>(op.getOperand().getType());
+    if (!operandType.hasStaticShape())
+      return rewriter.notifyMatchFailure(op, "expected static shape");
+
+    SmallVector<int64_t> start, limit;
+    for (auto [index, size, dimSize] :
+         llvm::zip_equal(op.getStartIndices(), op.getSliceSizes(),
+                         operandType.getShape())) {
+      DenseIntElementsAttr attr;
+      if (!matchPattern(index, m_Constant(&attr)))
+        return rewriter.notifyMatchFailure(op, "expected constant indices");
+      APInt value = *attr.getValues<APInt>().begin();
+      int64_t startIndex = attr.getElementType().isUnsignedInteger()
+                               ? static_cast<int64_t>(value.getZExtValue())
+                               : value.getSExtValue();
+      // Start indices are clamped so that the slice is in bounds.
+      startIndex = std::clamp<int64_t>(startIndex, 0, dimSize - size);
+      start.push_back(startIndex);
+      limit.push_back(startIndex + size);
+    }
+    SmallVector<int64_t> strides(start.size(), 1);
+    rewriter.replaceOp(op, createSlice(rewriter, op.getLoc(), op.getOperand(),
+                                       start, limit, strides));
+    return success();
+  }
+};
+
+struct StablehloSimplifySlicesPass
+    : public impl::StablehloSimplifySlicesPassBase<
+          StablehloSimplifySlicesPass> {
+  using StablehloSimplifySlicesPassBase::StablehloSimplifySlicesPassBase;
+
+  LogicalResult initialize(MLIRContext *context) override {
+    RewritePatternSet patterns_(context);
+    populateStablehloSimplifySlicesPatterns(&patterns_, context);
+    patterns = std::move(patterns_);
+    return success();
+  }
+
+  void runOnOperation() override {
+    if (failed(applyPatternsAndFoldGreedily(getOperation(), patterns)))
+      signalPassFailure();
+  }
+
+ private:
+  FrozenRewritePatternSet patterns;
+};
+
+}  // namespace
+
+void populateStablehloSimplifySlicesPatterns(RewritePatternSet *patterns,
+                                             MLIRContext *context) {
+  patterns->add<ComposeSlices, ConcatenateAdjacentSlices, DynamicSliceToSlice,
+                RemoveIdentitySlice, SliceOfConcatenate, SliceOfPad>(context);
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -0,0 +1,442 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <cstdint>
+#include <utility>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Quant/QuantTypes.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/TypeUtilities.h"
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "stablehlo/dialect/StablehloOps.h"
+#include "stablehlo/transforms/Passes.h"
+
+namespace mlir {
+namespace stablehlo {
+
+#define GEN_PASS_DEF_STABLEHLOTRANSPOSEPROPAGATIONPASS
+#include "stablehlo/transforms/Passes.h.inc"
+
+namespace {
+
+// Dimension `i` of the result of a transpose with `permutation` is dimension
+// `permutation[i]` of its operand. The helpers below map dimensions, shapes
+// and per-dimension attributes of the result to those of the operand.
+
+// Returns the dimensions of the operand which are `dims` of the result.
+SmallVector<int64_t> mapDims(ArrayRef<int64_t> dims,
+                             ArrayRef<int64_t> permutation) {
+  return llvm::map_to_vector(dims, [&](int64_t dim) {
+    return permutation[dim];
+  });
+}
+
+// Returns `values`, which are indexed by the dimensions of the result, indexed
+// by the dimensions of the operand.
+SmallVector<int64_t> mapPerDim(ArrayRef<int64_t> values,
+                               ArrayRef<int64_t> permutation) {
+  SmallVector<int64_t> result(values.size());
+  for (auto [dim, value] : llvm::enumerate(values))
+    result[permutation[dim]] = value;
+  return result;
+}
+
+bool isIdentity(ArrayRef<int64_t> permutation) {
+  for (auto [i, dim] : llvm::enumerate(permutation))
+    if (static_cast<int64_t>(i) != dim) return false;
+  return true;
+}
+
+// Returns the transpose which defines `value` if it has no other users, since
+// propagating a transpose with other users would duplicate it.
+TransposeOp getSingleUseTranspose(Value value) {
+  auto transpose = value.getDefiningOp<TransposeOp>();
+  if (!transpose || !transpose->hasOneUse()) return nullptr;
+  return transpose;
+}
+
+// Returns the transposes which define all of `values` if they have the same
+// permutation and no other users.
+SmallVector<TransposeOp> getSameTransposes(ValueRange values) {
+  SmallVector<TransposeOp> transposes;
+  for (Value value : values) {
+    auto transpose = getSingleUseTranspose(value);
+    if (!transpose || (!transposes.empty() &&
+                       transpose.getPermutation() !=
+                           transposes.front().getPermutation()))
+      return {};
+    transposes.push_back(transpose);
+  }
+  return transposes;
+}
+
+// transpose(transpose(x, p1), p2) -> transpose(x, p1[p2]), which cancels if
+// the composed permutation is the identity.
+struct ComposeTransposes : public OpRewritePattern<TransposeOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(TransposeOp op,
+                                PatternRewriter &rewriter) const override {
+    if (isIdentity(op.getPermutation())) {
+      rewriter.replaceOp(op, op.getOperand());
+      return success();
+    }
+
+    auto operand = op.getOperand().getDefiningOp<TransposeOp>();
+    if (!operand) return failure();
+    auto permutation = mapDims(op.getPermutation(), operand.getPermutation());
+    if (isIdentity(permutation)) {
+      rewriter.replaceOp(op, operand.getOperand());
+      return success();
+    }
+    rewriter.replaceOpWithNewOp<TransposeOp>(
+        op, op.getType(), operand.getOperand(),
+        rewriter.getDenseI64ArrayAttr(permutation));
+    return success();
+  }
+};
+
+// elementwise(transpose(x, p), transpose(y, p)) ->
+//   transpose(elementwise(x, y), p)
+// Splat constants may stand in for transposes. Per-axis quantization depends
+// on the order of the dimensions, so it isn't supported.
+struct SinkTransposePastElementwise : public RewritePattern {
+  explicit SinkTransposePastElementwise(MLIRContext *context)
+      : RewritePattern(MatchAnyOpTypeTag(), /*benefit=*/1, context) {}
+
+  LogicalResult matchAndRewrite(Operation *op,
+                                PatternRewriter &rewriter) const override {
+    if (!isa_and_nonnull<StablehloDialect>(op->getDialect()) ||
+        !op->hasTrait<OpTrait::Elementwise>() || op->getNumResults() != 1 ||
+        op->getNumRegions() != 0)
+      return failure();
+    auto resultType = dyn_cast<RankedTensorType>(op->getResult(0).getType());
+    if (!resultType ||
+        isa<quant::UniformQuantizedPerAxisType>(resultType.getElementType()))
+      return failure();
+
+    TransposeOp first;
+    SmallVector<Value> operands;
+    for (Value operand : op->getOperands()) {
+      auto operandType = dyn_cast<RankedTensorType>(operand.getType());
+      if (!operandType || operandType.getShape() != resultType.getShape() ||
+          isa<quant::UniformQuantizedPerAxisType>(
+              operandType.getElementType()))
+        return failure();
+      if (auto transpose = getSingleUseTranspose(operand)) {
+        if (first && transpose.getPermutation() != first.getPermutation())
+          return rewriter.notifyMatchFailure(op, "different permutations");
+        if (!first) first = transpose;
+        operands.push_back(transpose.getOperand());
+        continue;
+      }
+      SplatElementsAttr splat;
+      if (!matchPattern(operand, m_Constant(&splat)))
+        return rewriter.notifyMatchFailure(op, "expected transposes");
+      operands.push_back(nullptr);
+    }
+    if (!first) return rewriter.notifyMatchFailure(op, "expected transposes");
+
+    auto shape = first.getOperand().getType().getShape();
+    for (auto [operand, newOperand] : llvm::zip(op->getOperands(), operands)) {
+      if (newOperand) continue;
+      SplatElementsAttr splat;
+      matchPattern(operand, m_Constant(&splat));
+      newOperand = rewriter.create<ConstantOp>(
+          op->getLoc(), splat.resizeSplat(RankedTensorType::get(
+                            shape, getElementTypeOrSelf(operand))));
+    }
+    OperationState state(
+        op->getLoc(), op->getName(), operands,
+        {RankedTensorType::get(shape, resultType.getElementType())},
+        op->getAttrs());
+    Operation *newOp = rewriter.create(state);
+    rewriter.replaceOpWithNewOp<TransposeOp>(op, resultType,
+                                             newOp->getResult(0),
+                                             first.getPermutationAttr());
+    return success();
+  }
+};
+
+// broadcast_in_dim(transpose(x, p), dims) -> broadcast_in_dim(x, dims[p^-1])
+struct FoldTransposeIntoBroadcastInDim
+    : public OpRewritePattern<BroadcastInDimOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(BroadcastInDimOp op,
+                                PatternRewriter &rewriter) const override {
+    auto transpose = op.getOperand().getDefiningOp<TransposeOp>();
+    if (!transpose) return failure();
+    auto dims =
+        mapPerDim(op.getBroadcastDimensions(), transpose.getPermutation());
+    rewriter.replaceOpWithNewOp<BroadcastInDimOp>(
+        op, op.getType(), transpose.getOperand(),
+        rewriter.getDenseI64ArrayAttr(dims));
+    return success();
+  }
+};
+
+// reduce(transpose(x, p), dims) -> transpose(reduce(x, p[dims]), q), where q
+// is the permutation of the dimensions which aren't reduced, if any.
+struct SinkTransposePastReduce : public OpRewritePattern<ReduceOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(ReduceOp op,
+                                PatternRewriter &rewriter) const override {
+    auto transposes = getSameTransposes(op.getInputs());
+    if (transposes.empty()) return failure();
+    auto permutation = transposes.front().getPermutation();
+    auto dims = mapDims(op.getDimensions(), permutation);
+    llvm::sort(dims);
+
+    // The dimensions of `x` which aren't reduced, in the order of the result
+    // of the reduce of `x` and in the order of the result of `op`.
+    SmallVector<int64_t> keptDims;
+    for (int64_t dim = 0; dim < static_cast<int64_t>(permutation.size());
+         ++dim)
+      if (!llvm::is_contained(dims, dim)) keptDims.push_back(dim);
+    SmallVector<int64_t> resultPermutation;
+    for (auto [dim, operandDim] : llvm::enumerate(permutation))
+      if (!llvm::is_contained(op.getDimensions(), static_cast<int64_t>(dim)))
+        resultPermutation.push_back(
+            llvm::find(keptDims, operandDim) - keptDims.begin());
+
+    rewriter.setInsertionPointAfter(op);
+    rewriter.modifyOpInPlace(op, [&]() {
+      for (auto [i, transpose] : llvm::enumerate(transposes))
+        op->setOperand(i, transpose.getOperand());
+      op.setDimensionsAttr(rewriter.getDenseI64ArrayAttr(dims));
+      for (OpResult result : op->getResults()) {
+        auto type = cast<RankedTensorType>(result.getType());
+        result.setType(RankedTensorType::get(
+            mapPerDim(type.getShape(), resultPermutation),
+            type.getElementType()));
+      }
+    });
+    if (isIdentity(resultPermutation)) return success();
+
+    for (OpResult result : op->getResults()) {
+      auto type = cast<RankedTensorType>(result.getType());
+      auto resultType = RankedTensorType::get(
+          mapDims(resultPermutation, type.getShape()), type.getElementType());
+      auto transpose = rewriter.create<TransposeOp>(
+          op.getLoc(), resultType, result,
+          rewriter.getDenseI64ArrayAttr(resultPermutation));
+      rewriter.replaceAllUsesExcept(result, transpose, transpose);
+    }
+    return success();
+  }
+};
+
+// concatenate(transpose(x, p), transpose(y, p), dim) ->
+//   transpose(concatenate(x, y, p[dim]), p)
+struct SinkTransposePastConcatenate
+    : public OpRewritePattern<ConcatenateOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(ConcatenateOp op,
+                                PatternRewriter &rewriter) const override {
+    auto transposes = getSameTransposes(op.getInputs());
+    if (transposes.empty()) return failure();
+    auto permutation = transposes.front().getPermutation();
+
+    auto inputs = llvm::map_to_vector(transposes, [](TransposeOp transpose) {
+      return transpose.getOperand();
+    });
+    auto type = op.getType();
+    auto concatenate = rewriter.create<ConcatenateOp>(
+        op.getLoc(),
+        RankedTensorType::get(mapPerDim(type.getShape(), permutation),
+                              type.getElementType()),
+        inputs, permutation[op.getDimension()]);
+    rewriter.replaceOpWithNewOp<TransposeOp>(
+        op, type, concatenate, transposes.front().getPermutationAttr());
+    return success();
+  }
+};
+
+// pad(transpose(x, p), value, low, high, interior) ->
+//   transpose(pad(x, value, low[p^-1], high[p^-1], interior[p^-1]), p)
+struct SinkTransposePastPad : public OpRewritePattern<PadOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(PadOp op,
+                                PatternRewriter &rewriter) const override {
+    auto transpose = getSingleUseTranspose(op.getOperand());
+    if (!transpose) return failure();
+    auto permutation = transpose.getPermutation();
+
+    auto type = op.getType();
+    auto pad = rewriter.create<PadOp>(
+        op.getLoc(),
+        RankedTensorType::get(mapPerDim(type.getShape(), permutation),
+                              type.getElementType()),
+        transpose.getOperand(), op.getPaddingValue(),
+        rewriter.getDenseI64ArrayAttr(
+            mapPerDim(op.getEdgePaddingLow(), permutation)),
+        rewriter.getDenseI64ArrayAttr(
+            mapPerDim(op.getEdgePaddingHigh(), permutation)),
+        rewriter.getDenseI64ArrayAttr(
+            mapPerDim(op.getInteriorPadding(), permutation)));
+    rewriter.replaceOpWithNewOp<TransposeOp>(op, type, pad,
+                                             transpose.getPermutationAttr());
+    return success();
+  }
+};
+
+// dot_general(transpose(x, p), y) -> dot_general(x, y) with the dimension
+// numbers of x, and likewise for the rhs. The free dimensions of an operand
+// appear in the result in increasing order, so this only applies if the
+// transpose doesn't reorder them.
+struct FoldTransposeIntoDotGeneral : public OpRewritePattern<DotGeneralOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(DotGeneralOp op,
+                                PatternRewriter &rewriter) const override {
+    auto dimensionNumbers = op.getDotDimensionNumbers();
+    SmallVector<int64_t> lhsBatch(dimensionNumbers.getLhsBatchingDimensions());
+    SmallVector<int64_t> rhsBatch(dimensionNumbers.getRhsBatchingDimensions());
+    SmallVector<int64_t> lhsContracting(
+        dimensionNumbers.getLhsContractingDimensions());
+    SmallVector<int64_t> rhsContracting(
+        dimensionNumbers.getRhsContractingDimensions());
+
+    auto lhs = foldOperand(op.getLhs(), lhsBatch, lhsContracting);
+    auto rhs = foldOperand(op.getRhs(), rhsBatch, rhsContracting);
+    if (!lhs && !rhs) return failure();
+
+    rewriter.modifyOpInPlace(op, [&]() {
+      if (lhs) op->setOperand(0, lhs);
+      if (rhs) op->setOperand(1, rhs);
+      op.setDotDimensionNumbersAttr(DotDimensionNumbersAttr::get(
+          op.getContext(), lhsBatch, rhsBatch, lhsContracting,
+          rhsContracting));
+    });
+    return success();
+  }
+
+ private:
+  // Returns the operand of the transpose which defines `operand` and maps
+  // `batch` and `contracting` to its dimensions, if the transpose doesn't
+  // reorder the free dimensions.
+  static Value foldOperand(Value operand, SmallVector<int64_t> &batch,
+                           SmallVector<int64_t> &contracting) {
+    auto transpose = operand.getDefiningOp<TransposeOp>();
+    if (!transpose) return nullptr;
+    auto permutation = transpose.getPermutation();
+
+    int64_t previousFreeDim = -1;
+    for (auto [dim, operandDim] : llvm::enumerate(permutation)) {
+      auto isFree = !llvm::is_contained(batch, static_cast<int64_t>(dim)) &&
+                    !llvm::is_contained(contracting, static_cast<int64_t>(dim));
+      if (!isFree) continue;
+      if (operandDim < previousFreeDim) return nullptr;
+      previousFreeDim = operandDim;
+    }
+
+    batch = mapDims(batch, permutation);
+    contracting = mapDims(contracting, permutation);
+    return transpose.getOperand();
+  }
+};
+
+// convolution(transpose(x, p), transpose(y, q)) -> convolution(x, y) with the
+// dimension numbers of x and y, which describe every dimension of the input
+// and the kernel.
+struct FoldTransposeIntoConvolution
+    : public OpRewritePattern<ConvolutionOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  LogicalResult matchAndRewrite(ConvolutionOp op,
+                                PatternRewriter &rewriter) const override {
+    auto lhsTranspose = op.getLhs().getDefiningOp<TransposeOp>();
+    auto rhsTranspose = op.getRhs().getDefiningOp<TransposeOp>();
+    if (!lhsTranspose && !rhsTranspose) return failure();
+
+    auto dims = op.getDimensionNumbers();
+    int64_t inputBatch = dims.getInputBatchDimension();
+    int64_t inputFeature = dims.getInputFeatureDimension();
+    SmallVector<int64_t> inputSpatial(dims.getInputSpatialDimensions());
+    if (lhsTranspose) {
+      auto permutation = lhsTranspose.getPermutation();
+      inputBatch = permutation[inputBatch];
+      inputFeature = permutation[inputFeature];
+      inputSpatial = mapDims(inputSpatial, permutation);
+    }
+
+    int64_t kernelInputFeature = dims.getKernelInputFeatureDimension();
+    int64_t kernelOutputFeature = dims.getKernelOutputFeatureDimension();
+    SmallVector<int64_t> kernelSpatial(dims.getKernelSpatialDimensions());
+    if (rhsTranspose) {
+      auto permutation = rhsTranspose.getPermutation();
+      kernelInputFeature = permutation[kernelInputFeature];
+      kernelOutputFeature = permutation[kernelOutputFeature];
+      kernelSpatial = mapDims(kernelSpatial, permutation);
+    }
+
+    rewriter.modifyOpInPlace(op, [&]() {
+      if (lhsTranspose) op->setOperand(0, lhsTranspose.getOperand());
+      if (rhsTranspose) op->setOperand(1, rhsTranspose.getOperand());
+      op.setDimensionNumbersAttr(ConvDimensionNumbersAttr::get(
+          op.getContext(), inputBatch, inputFeature, inputSpatial,
+          kernelInputFeature, kernelOutputFeature, kernelSpatial,
+          dims.getOutputBatchDimension(), dims.getOutputFeatureDimension(),
+          dims.getOutputSpatialDimensions()));
+    });
+    return success();
+  }
+};
+
+struct StablehloTransposePropagationPass
+    : public impl::StablehloTransposePropagationPassBase<
+          StablehloTransposePropagationPass> {
+  using StablehloTransposePropagationPassBase::
+      StablehloTransposePropagationPassBase;
+
+  LogicalResult initialize(MLIRContext *context) override {
+    RewritePatternSet patterns_(context);
+    populateStablehloTransposePropagationPatterns(&patterns_, context);
+    patterns = std::move(patterns_);
+    return success();
+  }
+
+  void runOnOperation() override {
+    if (failed(applyPatternsAndFoldGreedily(getOperation(), patterns)))
+      signalPassFailure();
+  }
+
+ private:
+  FrozenRewritePatternSet patterns;
+};
+
+}  // namespace
+
+void populateStablehloTransposePropagationPatterns(RewritePatternSet *patterns,
+                                                   MLIRContext *context) {
+  patterns->add<ComposeTransposes, FoldTransposeIntoBroadcastInDim,
+                FoldTransposeIntoConvolution, FoldTransposeIntoDotGeneral,
+                SinkTransposePastConcatenate, SinkTransposePastElementwise,
+                SinkTransposePastPad, SinkTransposePastReduce>(context);
+}
+
+}  // namespace stablehlo
+}  // namespace mlir
@@ -12,15 +12,22 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/Debug.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/AsmState.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/BuiltinAttributeInterfaces.h"
 #include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/DialectResourceBlobManager.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "stablehlo/dialect/StablehloOps.h"
 #include "stablehlo/dialect/VhloOps.h"
@@ -75,8 +82,24 @@ class VhloToStablehloTypeConverter : public vhlo::VhloTypeConverter {
   if (!stablehloValue.has_value()) return {};                       \
   return stablehlo::Name##Attr::get(attr.getContext(), stablehloValue.value())
 
+Attribute convertGenericUncached(Attribute vhloAttr,
+                                 const TypeConverter* typeConverter);
+
+// Converts attributes which have a 1:1 mapping, memoizing the conversions in
+// the type converter, which is always a VhloTypeConverterBase.
 Attribute convertGeneric(Attribute vhloAttr,
                          const TypeConverter* typeConverter) {
+  auto* vhloTypeConverter =
+      static_cast<const vhlo::VhloTypeConverterBase*>(typeConverter);
+  if (auto cachedAttr = vhloTypeConverter->lookupAttribute(vhloAttr))
+    return cachedAttr;
+  auto convertedAttr = convertGenericUncached(vhloAttr, typeConverter);
+  if (convertedAttr) vhloTypeConverter->cacheAttribute(vhloAttr, convertedAttr);
+  return convertedAttr;
+}
+
+Attribute convertGenericUncached(Attribute vhloAttr,
+                                 const TypeConverter* typeConverter) {
   LLVM_DEBUG(llvm::dbgs() << "Converting attr " << vhloAttr);
   if (auto vhloAttrs = dyn_cast<vhlo::ArrayV1Attr>(vhloAttr)) {
     SmallVector<Attribute> stablehloAttrs;
@@ -198,6 +221,46 @@ LogicalResult convertInt(Attribute vhloAttr, int64_t& result) {
   return success();
 }
 
+// Legalizes a tensor read from an artifact retained by the VHLO dialect to a
+// DenseResourceElementsAttr which references the data of the artifact, if it
+// is large enough. Returns a null attribute otherwise.
+Attribute convertTensorToResource(Attribute vhloAttr,
+                                  const TypeConverter* typeConverter) {
+  auto attr = dyn_cast<vhlo::TensorV1Attr>(vhloAttr);
+  if (!attr) return {};
+  auto data = attr.getData();
+  auto* dialect = cast<vhlo::VhloDialect>(attr.getDialect());
+  auto minResourceSize = dialect->getRetainedArtifactResourceSize(data);
+  if (!minResourceSize || static_cast<int64_t>(data.size()) < *minResourceSize)
+    return {};
+
+  auto builtinType =
+      dyn_cast_or_null<ShapedType>(typeConverter->convertType(attr.getType()));
+  if (!builtinType || !builtinType.hasStaticShape()) return {};
+  Type elementType = builtinType.getElementType();
+  int64_t numComponents = 1;
+  if (auto complexType = dyn_cast<ComplexType>(elementType)) {
+    elementType = complexType.getElementType();
+    numComponents = 2;
+  }
+  // Booleans are bit-packed, and splats only store one element.
+  if (!elementType.isIntOrFloat() || elementType.getIntOrFloatBitWidth() % 8)
+    return {};
+  size_t alignment = elementType.getIntOrFloatBitWidth() / 8;
+  if (static_cast<int64_t>(data.size()) !=
+      builtinType.getNumElements() * numComponents * alignment)
+    return {};
+
+  // Resources must be aligned to their elements, which bytecode doesn't
+  // guarantee for tensors, so misaligned data is copied.
+  auto blob =
+      reinterpret_cast<uintptr_t>(data.data()) % alignment == 0
+          ? UnmanagedAsmResourceBlob::allocateWithAlign(data, alignment)
+          : HeapAsmResourceBlob::allocateAndCopyWithAlign(data, alignment);
+  return DenseResourceElementsAttr::get(builtinType, "vhlo_constant",
+                                        std::move(blob));
+}
+
 LogicalResult convertInts(Attribute vhloAttr,
                           const TypeConverter* typeConverter,
                           SmallVector<int64_t>& result) {
@@ -499,6 +562,10 @@ SpecialResult convertSpecial(const OpConversionPattern<VhloOpTy>& pattern,
       stablehloAttr = UnitAttr::get(pattern.getContext());
     }
   }
+  if constexpr (std::is_same<VhloOpTy, vhlo::ConstantOpV1>::value) {
+    if (vhloName == "value")
+      stablehloAttr = convertTensorToResource(vhloAttr, typeConverter);
+  }
   if constexpr (std::is_same<VhloOpTy, vhlo::CustomCallOpV1>::value) {
     if (vhloName == "called_computations") {
       stablehloAttr = convertCustomCallCalledComputations(
@@ -930,6 +997,7 @@ struct VhloLegalizeToStablehloPass
   }
 
   void runOnOperation() override {
+    converter.clearAttributeCache();
     // Upgraded VHLO should always be convertible to StableHLO.
     // Arbitrary VHLO might not be convertible if it uses deprecated features
     // which are no longer available in StableHLO.
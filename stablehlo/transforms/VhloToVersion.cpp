@@ -277,7 +277,8 @@ TensorV1Attr getEmptyI64Tensor(OpBuilder& builder) {
   auto shape = vhlo::RankedTensorV1Type::get(
       builder.getContext(), {0},
       vhlo::IntegerSI64V1Type::get(builder.getContext()), {});
-  return vhlo::TensorV1Attr::get(builder.getContext(), shape, {});
+  return vhlo::TensorV1Attr::get(builder.getContext(), shape,
+                                 ArrayRef<char>{});
 }
 
 bool isEmptyTensor(Attribute attr) {
@@ -302,7 +303,7 @@ TensorV1Attr getDefaultConvPadding(OpBuilder& builder, Value lhs) {
       RankedTensorV1Type::get(builder.getContext(), paddingShape,
                               IntegerSI64V1Type::get(builder.getContext()),
                               nullptr),
-      denseElements.getRawData());
+      denseElements);
 }
 
 // DRR has limited support for ops with regions
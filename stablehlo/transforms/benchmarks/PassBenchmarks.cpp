@@ -0,0 +1,390 @@
+/* Copyright 2024 The StableHLO Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Compile-time benchmarks of the StableHLO passes and of the serialization to
+// and from portable artifacts. Every benchmark runs on a synthetic transformer
+// of `state.range(0)` layers, which is parsed once and cloned before every
+// iteration outside of the measured time.
+//
+// Items are the ops of the input module, so that `items_per_second` is the
+// throughput in ops/sec. `peak_memory_MiB` is the peak resident set size of
+// the process, which is a high-water mark across all benchmarks run so far,
+// so run a single benchmark with `--benchmark_filter` to attribute it.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/DialectRegistry.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassRegistry.h"
+#include "mlir/Support/LogicalResult.h"
+#include "stablehlo/conversions/linalg/transforms/Passes.h"
+#include "stablehlo/dialect/Register.h"
+#include "stablehlo/dialect/Serialization.h"
+#include "stablehlo/dialect/Version.h"
+#include "stablehlo/transforms/Passes.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace mlir {
+namespace stablehlo {
+namespace {
+
+// Sizes of the synthetic transformer: batch size, sequence length, and the
+// model and hidden dimensions of its layers.
+constexpr int64_t kBatch = 4;
+constexpr int64_t kSequence = 128;
+constexpr int64_t kModel = 256;
+constexpr int64_t kHidden = 1024;
+
+// One layer of the transformer: layer norm, single-head self-attention and a
+// GELU MLP, each with a residual connection. Layer `{0}` reads `%x{0}` and
+// defines `%x{1}`. `{2}` is the batch dimension of all values but the
+// weights, which is `?` in dynamic modules, and `{3}` to `{5}` are the
+// sequence length, model and hidden dimensions. `{6}` and `{7}` are the bias
+// add and the `erf` of the GELU, which use either CHLO or StableHLO ops.
+constexpr StringRef kLayerTemplate = R"mlir(
+  %l{0}_sum = stablehlo.reduce(%x{0} init: %zero) applies stablehlo.add across dimensions = [2] : (tensor<{2}x{3}x{4}xf32>, tensor<f32>) -> tensor<{2}x{3}xf32>
+  %l{0}_inv_d = stablehlo.broadcast_in_dim %inv_d, dims = [] : (tensor<f32>) -> tensor<{2}x{3}xf32>
+  %l{0}_mean = stablehlo.multiply %l{0}_sum, %l{0}_inv_d : tensor<{2}x{3}xf32>
+  %l{0}_mean_b = stablehlo.broadcast_in_dim %l{0}_mean, dims = [0, 1] : (tensor<{2}x{3}xf32>) -> tensor<{2}x{3}x{4}xf32>
+  %l{0}_centered = stablehlo.subtract %x{0}, %l{0}_mean_b : tensor<{2}x{3}x{4}xf32>
+  %l{0}_squared = stablehlo.multiply %l{0}_centered, %l{0}_centered : tensor<{2}x{3}x{4}xf32>
+  %l{0}_var_sum = stablehlo.reduce(%l{0}_squared init: %zero) applies stablehlo.add across dimensions = [2] : (tensor<{2}x{3}x{4}xf32>, tensor<f32>) -> tensor<{2}x{3}xf32>
+  %l{0}_var = stablehlo.multiply %l{0}_var_sum, %l{0}_inv_d : tensor<{2}x{3}xf32>
+  %l{0}_eps = stablehlo.broadcast_in_dim %eps, dims = [] : (tensor<f32>) -> tensor<{2}x{3}xf32>
+  %l{0}_var_eps = stablehlo.add %l{0}_var, %l{0}_eps : tensor<{2}x{3}xf32>
+  %l{0}_rstd = stablehlo.rsqrt %l{0}_var_eps : tensor<{2}x{3}xf32>
+  %l{0}_rstd_b = stablehlo.broadcast_in_dim %l{0}_rstd, dims = [0, 1] : (tensor<{2}x{3}xf32>) -> tensor<{2}x{3}x{4}xf32>
+  %l{0}_norm = stablehlo.multiply %l{0}_centered, %l{0}_rstd_b : tensor<{2}x{3}x{4}xf32>
+  %l{0}_q = stablehlo.dot_general %l{0}_norm, %wq{0}, contracting_dims = [2] x [0] : (tensor<{2}x{3}x{4}xf32>, tensor<{4}x{4}xf32>) -> tensor<{2}x{3}x{4}xf32>
+  %l{0}_k = stablehlo.dot_general %l{0}_norm, %wk{0}, contracting_dims = [2] x [0] : (tensor<{2}x{3}x{4}xf32>, tensor<{4}x{4}xf32>) -> tensor<{2}x{3}x{4}xf32>
+  %l{0}_v = stablehlo.dot_general %l{0}_norm, %wv{0}, contracting_dims = [2] x [0] : (tensor<{2}x{3}x{4}xf32>, tensor<{4}x{4}xf32>) -> tensor<{2}x{3}x{4}xf32>
+  %l{0}_scores = stablehlo.dot_general %l{0}_q, %l{0}_k, batching_dims = [0] x [0], contracting_dims = [2] x [2] : (tensor<{2}x{3}x{4}xf32>, tensor<{2}x{3}x{4}xf32>) -> tensor<{2}x{3}x{3}xf32>
+  %l{0}_max = stablehlo.reduce(%l{0}_scores init: %neg_inf) applies stablehlo.maximum across dimensions = [2] : (tensor<{2}x{3}x{3}xf32>, tensor<f32>) -> tensor<{2}x{3}xf32>
+  %l{0}_max_b = stablehlo.broadcast_in_dim %l{0}_max, dims = [0, 1] : (tensor<{2}x{3}xf32>) -> tensor<{2}x{3}x{3}xf32>
+  %l{0}_shifted = stablehlo.subtract %l{0}_scores, %l{0}_max_b : tensor<{2}x{3}x{3}xf32>
+  %l{0}_exp = stablehlo.exponential %l{0}_shifted : tensor<{2}x{3}x{3}xf32>
+  %l{0}_denom = stablehlo.reduce(%l{0}_exp init: %zero) applies stablehlo.add across dimensions = [2] : (tensor<{2}x{3}x{3}xf32>, tensor<f32>) -> tensor<{2}x{3}xf32>
+  %l{0}_denom_b = stablehlo.broadcast_in_dim %l{0}_denom, dims = [0, 1] : (tensor<{2}x{3}xf32>) -> tensor<{2}x{3}x{3}xf32>
+  %l{0}_probs = stablehlo.divide %l{0}_exp, %l{0}_denom_b : tensor<{2}x{3}x{3}xf32>
+  %l{0}_attn = stablehlo.dot_general %l{0}_probs, %l{0}_v, batching_dims = [0] x [0], contracting_dims = [2] x [1] : (tensor<{2}x{3}x{3}xf32>, tensor<{2}x{3}x{4}xf32>) -> tensor<{2}x{3}x{4}xf32>
+  %l{0}_proj = stablehlo.dot_general %l{0}_attn, %wo{0}, contracting_dims = [2] x [0] : (tensor<{2}x{3}x{4}xf32>, tensor<{4}x{4}xf32>) -> tensor<{2}x{3}x{4}xf32>
+  %l{0}_residual = stablehlo.add %x{0}, %l{0}_proj : tensor<{2}x{3}x{4}xf32>
+  %l{0}_up = stablehlo.dot_general %l{0}_residual, %w1{0}, contracting_dims = [2] x [0] : (tensor<{2}x{3}x{4}xf32>, tensor<{4}x{5}xf32>) -> tensor<{2}x{3}x{5}xf32>
+{6}
+  %l{0}_inv_sqrt2 = stablehlo.broadcast_in_dim %inv_sqrt2, dims = [] : (tensor<f32>) -> tensor<{2}x{3}x{5}xf32>
+  %l{0}_scaled = stablehlo.multiply %l{0}_biased, %l{0}_inv_sqrt2 : tensor<{2}x{3}x{5}xf32>
+{7}
+  %l{0}_one = stablehlo.broadcast_in_dim %one, dims = [] : (tensor<f32>) -> tensor<{2}x{3}x{5}xf32>
+  %l{0}_erf_1 = stablehlo.add %l{0}_erf, %l{0}_one : tensor<{2}x{3}x{5}xf32>
+  %l{0}_gate = stablehlo.multiply %l{0}_biased, %l{0}_erf_1 : tensor<{2}x{3}x{5}xf32>
+  %l{0}_half = stablehlo.broadcast_in_dim %half, dims = [] : (tensor<f32>) -> tensor<{2}x{3}x{5}xf32>
+  %l{0}_gelu = stablehlo.multiply %l{0}_gate, %l{0}_half : tensor<{2}x{3}x{5}xf32>
+  %l{0}_down = stablehlo.dot_general %l{0}_gelu, %w2{0}, contracting_dims = [2] x [0] : (tensor<{2}x{3}x{5}xf32>, tensor<{5}x{4}xf32>) -> tensor<{2}x{3}x{4}xf32>
+  %x{1} = stablehlo.add %l{0}_residual, %l{0}_down : tensor<{2}x{3}x{4}xf32>)mlir";
+
+constexpr StringRef kChloBiasTemplate = R"mlir(
+  %l{0}_biased = chlo.broadcast_add %l{0}_up, %b1{0} : (tensor<{1}x{2}x{3}xf32>, tensor<{3}xf32>) -> tensor<{1}x{2}x{3}xf32>)mlir";
+
+constexpr StringRef kStablehloBiasTemplate = R"mlir(
+  %l{0}_b1 = stablehlo.broadcast_in_dim %b1{0}, dims = [2] : (tensor<{3}xf32>) -> tensor<{1}x{2}x{3}xf32>
+  %l{0}_biased = stablehlo.add %l{0}_up, %l{0}_b1 : tensor<{1}x{2}x{3}xf32>)mlir";
+
+// StableHLO has no `erf`, so pure StableHLO modules use `tanh`, which makes
+// the same number of ops of a similar cost to compile.
+constexpr StringRef kChloErfTemplate = R"mlir(
+  %l{0}_erf = chlo.erf %l{0}_scaled : tensor<{1}x{2}x{3}xf32> -> tensor<{1}x{2}x{3}xf32>)mlir";
+
+constexpr StringRef kStablehloErfTemplate = R"mlir(
+  %l{0}_erf = stablehlo.tanh %l{0}_scaled : tensor<{1}x{2}x{3}xf32>)mlir";
+
+// Returns a transformer of `numLayers` layers, see `kLayerTemplate`. The
+// arguments of dynamic modules are static, but all other values have a
+// dynamic batch dimension until shapes are refined. Modules `withChlo` use
+// CHLO ops for broadcasting and `erf`.
+std::string makeTransformer(int64_t numLayers, bool dynamic, bool withChlo) {
+  std::string batch = dynamic ? "?" : std::to_string(kBatch);
+  std::string source;
+  llvm::raw_string_ostream os(source);
+
+  os << "func.func @main(%input: tensor<" << kBatch << "x" << kSequence << "x"
+     << kModel << "xf32>";
+  for (int64_t i = 0; i < numLayers; ++i) {
+    os << llvm::formatv(
+        ", %wq{0}: tensor<{1}x{1}xf32>, %wk{0}: tensor<{1}x{1}xf32>, "
+        "%wv{0}: tensor<{1}x{1}xf32>, %wo{0}: tensor<{1}x{1}xf32>, "
+        "%w1{0}: tensor<{1}x{2}xf32>, %b1{0}: tensor<{2}xf32>, "
+        "%w2{0}: tensor<{2}x{1}xf32>",
+        i, kModel, kHidden);
+  }
+  os << llvm::formatv(") -> tensor<{0}x{1}x{2}xf32> {{", batch, kSequence,
+                      kModel);
+  os << R"mlir(
+  %zero = stablehlo.constant dense<0.000000e+00> : tensor<f32>
+  %neg_inf = stablehlo.constant dense<0xFF800000> : tensor<f32>
+  %one = stablehlo.constant dense<1.000000e+00> : tensor<f32>
+  %half = stablehlo.constant dense<5.000000e-01> : tensor<f32>
+  %inv_sqrt2 = stablehlo.constant dense<0.707106769> : tensor<f32>
+  %eps = stablehlo.constant dense<9.99999974E-6> : tensor<f32>)mlir";
+  os << llvm::formatv(R"mlir(
+  %inv_d = stablehlo.constant dense<{0:e}> : tensor<f32>)mlir",
+                      1.0 / kModel);
+  os << llvm::formatv(R"mlir(
+  %x0 = stablehlo.convert %input : (tensor<{0}x{2}x{3}xf32>) -> tensor<{1}x{2}x{3}xf32>)mlir",
+                      kBatch, batch, kSequence, kModel);
+
+  for (int64_t i = 0; i < numLayers; ++i) {
+    auto bias =
+        llvm::formatv(withChlo ? kChloBiasTemplate.data()
+                               : kStablehloBiasTemplate.data(),
+                      i, batch, kSequence, kHidden);
+    auto erf = llvm::formatv(withChlo ? kChloErfTemplate.data()
+                                      : kStablehloErfTemplate.data(),
+                             i, batch, kSequence, kHidden);
+    os << llvm::formatv(kLayerTemplate.data(), i, i + 1, batch, kSequence,
+                        kModel, kHidden, bias.str(), erf.str());
+  }
+  os << llvm::formatv(R"mlir(
+  func.return %x{0} : tensor<{1}x{2}x{3}xf32>
+}
+)mlir",
+                      numLayers, batch, kSequence, kModel);
+  return source;
+}
+
+// Returns the peak resident set size of the process in MiB, or 0 on
+// platforms where it isn't known.
+double getPeakMemoryMiB() {
+#if defined(__linux__) || defined(__APPLE__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+  // Reported in bytes.
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  // Reported in KiB.
+  return usage.ru_maxrss / 1024.0;
+#endif
+#else
+  return 0;
+#endif
+}
+
+// A module which is prepared once and cloned on every benchmark iteration.
+struct Program {
+  MLIRContext context;
+  OwningOpRef<ModuleOp> module;
+  int64_t numOps = 0;
+};
+
+// Parses a transformer of `state.range(0)` layers, see `makeTransformer`, and
+// runs `preparePipeline` on it if it isn't empty, e.g. to lower the ops which
+// the benchmarked pass doesn't support. Returns nullptr and reports the error
+// to `state` on failure.
+std::unique_ptr<Program> prepareProgram(benchmark::State &state, bool dynamic,
+                                        bool withChlo,
+                                        StringRef preparePipeline = "") {
+  auto program = std::make_unique<Program>();
+  DialectRegistry registry;
+  registerAllDialects(registry);
+  program->context.appendDialectRegistry(registry);
+  program->context.loadAllAvailableDialects();
+
+  auto source = makeTransformer(state.range(0), dynamic, withChlo);
+  program->module = parseSourceString<ModuleOp>(source, &program->context);
+  if (!program->module) {
+    state.SkipWithError("Failed to parse the program");
+    return nullptr;
+  }
+
+  if (!preparePipeline.empty()) {
+    PassManager pm(&program->context);
+    if (failed(parsePassPipeline(preparePipeline, pm, llvm::errs())) ||
+        failed(pm.run(*program->module))) {
+      state.SkipWithError("Failed to prepare the program");
+      return nullptr;
+    }
+  }
+
+  program->module->walk([&](Operation *) { ++program->numOps; });
+  return program;
+}
+
+// Reports the ops of the input module as items, see the top of this file.
+void reportCounters(benchmark::State &state, const Program &program) {
+  state.SetItemsProcessed(state.iterations() * program.numOps);
+  state.counters["ops"] = program.numOps;
+  state.counters["peak_memory_MiB"] = getPeakMemoryMiB();
+}
+
+// Runs the textual pass `pipeline` on a clone of the program on every
+// iteration.
+void benchmarkPipeline(benchmark::State &state, StringRef pipeline,
+                       bool dynamic, bool withChlo,
+                       StringRef preparePipeline) {
+  auto program = prepareProgram(state, dynamic, withChlo, preparePipeline);
+  if (!program) return;
+
+  PassManager pm(&program->context);
+  if (failed(parsePassPipeline(pipeline, pm, llvm::errs()))) {
+    state.SkipWithError("Failed to parse the pipeline");
+    return;
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    OwningOpRef<ModuleOp> module = program->module->clone();
+    state.ResumeTiming();
+    if (failed(pm.run(*module))) {
+      state.SkipWithError("Failed to run the pipeline");
+      return;
+    }
+    state.PauseTiming();
+    module = nullptr;
+    state.ResumeTiming();
+  }
+  reportCounters(state, *program);
+}
+
+// Serializes a clone of the program to a portable artifact of the current
+// version on every iteration.
+void benchmarkSerialize(benchmark::State &state) {
+  auto program = prepareProgram(state, /*dynamic=*/false, /*withChlo=*/false);
+  if (!program) return;
+
+  auto version = vhlo::Version::getCurrentVersion().toString();
+  for (auto _ : state) {
+    state.PauseTiming();
+    OwningOpRef<ModuleOp> module = program->module->clone();
+    std::string artifact;
+    llvm::raw_string_ostream os(artifact);
+    state.ResumeTiming();
+    if (failed(serializePortableArtifact(*module, version, os))) {
+      state.SkipWithError("Failed to serialize the program");
+      return;
+    }
+    state.PauseTiming();
+    module = nullptr;
+    state.ResumeTiming();
+  }
+  reportCounters(state, *program);
+}
+
+// Deserializes a portable artifact of the program on every iteration.
+void benchmarkDeserialize(benchmark::State &state) {
+  auto program = prepareProgram(state, /*dynamic=*/false, /*withChlo=*/false);
+  if (!program) return;
+
+  std::string artifact;
+  llvm::raw_string_ostream os(artifact);
+  OwningOpRef<ModuleOp> clone = program->module->clone();
+  if (failed(serializePortableArtifact(
+          *clone, vhlo::Version::getCurrentVersion().toString(), os))) {
+    state.SkipWithError("Failed to serialize the program");
+    return;
+  }
+
+  for (auto _ : state) {
+    auto module = deserializePortableArtifact(artifact, &program->context);
+    if (!module) {
+      state.SkipWithError("Failed to deserialize the program");
+      return;
+    }
+    state.PauseTiming();
+    module = nullptr;
+    state.ResumeTiming();
+  }
+  reportCounters(state, *program);
+}
+
+constexpr StringRef kChloLegalizeToStablehlo =
+    "builtin.module(func.func(chlo-legalize-to-stablehlo))";
+
+BENCHMARK_CAPTURE(benchmarkPipeline, chlo_legalize_to_stablehlo_static,
+                  kChloLegalizeToStablehlo, /*dynamic=*/false,
+                  /*withChlo=*/true, /*preparePipeline=*/"")
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(benchmarkPipeline, chlo_legalize_to_stablehlo_dynamic,
+                  kChloLegalizeToStablehlo, /*dynamic=*/true,
+                  /*withChlo=*/true, /*preparePipeline=*/"")
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(benchmarkPipeline, stablehlo_refine_shapes_dynamic,
+                  "builtin.module(stablehlo-refine-shapes)", /*dynamic=*/true,
+                  /*withChlo=*/false, /*preparePipeline=*/"")
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(benchmarkPipeline,
+                  stablehlo_aggressive_simplification_static,
+                  "builtin.module(func.func("
+                  "stablehlo-aggressive-simplification))",
+                  /*dynamic=*/false, /*withChlo=*/false,
+                  /*preparePipeline=*/"")
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(benchmarkPipeline,
+                  stablehlo_aggressive_simplification_dynamic,
+                  "builtin.module(func.func("
+                  "stablehlo-aggressive-simplification))",
+                  /*dynamic=*/true, /*withChlo=*/false,
+                  /*preparePipeline=*/"")
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(benchmarkPipeline, stablehlo_legalize_to_linalg_static,
+                  "builtin.module(stablehlo-legalize-to-linalg)",
+                  /*dynamic=*/false, /*withChlo=*/false,
+                  /*preparePipeline=*/"")
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmarkSerialize)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(benchmarkDeserialize)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace stablehlo
+}  // namespace mlir
+
+int main(int argc, char **argv) {
+  mlir::stablehlo::registerPasses();
+  mlir::stablehlo::registerStablehloLinalgTransformsPasses();
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}